@@ -12,6 +12,7 @@
 #include <string.h>
 #include "flash.h"
 #include "eboot_command.h"
+#include "inflate.h"
 
 #define SWRST do { (*((volatile uint32_t*) 0x60000700)) |= 0x80000000; } while(0);
 
@@ -125,9 +126,83 @@ int copy_raw(const uint32_t src_addr,
 
 
 
+// A gzip image staged at src_addr, size bytes, decompressed to dst_addr.
+// It is decoded once to check it, the output has to be an image ending
+// before src_addr.
+int copy_gzip(const uint32_t src_addr,
+              const uint32_t dst_addr,
+              const uint32_t size)
+{
+    if ((src_addr & (FLASH_SECTOR_SIZE - 1)) || (dst_addr & (FLASH_SECTOR_SIZE - 1)) ||
+        src_addr <= dst_addr) {
+        return 1;
+    }
+    uint32_t head = 0;
+    if (!inflate_gzip(src_addr, size, dst_addr, src_addr - dst_addr, false, &head) ||
+        (head & 0xff) != 0xe9) {
+        return 2;
+    }
+    if (!inflate_gzip(src_addr, size, dst_addr, src_addr - dst_addr, true, &head)) {
+        return 3;
+    }
+    return 0;
+}
+
+// crc32 of slot 0's first image sector, as home_crc
+static uint32_t home_crc()
+{
+    uint32_t buffer[64];
+    uint32_t crc = 0xffffffff;
+    for (uint32_t pos = 0; pos < FLASH_SECTOR_SIZE; pos += sizeof(buffer)) {
+        if (SPIRead(APP_START_OFFSET + pos, buffer, sizeof(buffer))) {
+            return 0;
+        }
+        crc = crc_update(crc, (const uint8_t*) buffer, sizeof(buffer));
+    }
+    return crc;
+}
+
+// The slot of an A/B layout to start, -1 for the other layouts (no log)
+int choose_slot()
+{
+    struct eboot_slot_record rec;
+    struct eboot_slot_record last;
+    uint32_t last_addr = 0;
+    for (uint32_t addr = EBOOT_SLOT_LOG; addr < EBOOT_SLOT_LOG + FLASH_SECTOR_SIZE; addr += sizeof(rec)) {
+        if (SPIRead(addr, &rec, sizeof(rec)) || rec.magic == 0xffffffff) {
+            break;
+        }
+        if (rec.magic == EBOOT_SLOT_MAGIC && rec.slot < 2 && rec.fallback < 2 &&
+            rec.crc32 == crc_update(0xffffffff, (const uint8_t*) &rec, offsetof(struct eboot_slot_record, crc32))) {
+            last = rec;
+            last_addr = addr;
+        }
+    }
+    if (!last_addr) {
+        return -1;
+    }
+    if (last.home_crc != home_crc()) {
+        return 0;
+    }
+    if (!last.trial) {
+        return last.slot;
+    }
+    if (!last.tries) {
+        // it never confirmed
+        ets_putc('f');
+        return last.fallback;
+    }
+    // one more try; flash bits only go from 1 to 0, no erase needed
+    last.tries &= last.tries - 1;
+    SPIWrite(last_addr + offsetof(struct eboot_slot_record, tries), &last.tries, sizeof(last.tries));
+    ets_putc('t');
+    return last.slot;
+}
+
 void main()
 {
     int res = 9;
+    int slot = -1;
     struct eboot_command cmd;
     
     print_version(0);
@@ -139,7 +214,8 @@ void main()
     } else {
         // no valid command found
         cmd.action = ACTION_LOAD_APP;
-        cmd.args[0] = 0;
+        slot = choose_slot();
+        cmd.args[0] = (slot > 0) ? slot * EBOOT_SLOT_SIZE : 0;
         ets_putc('~');
     }
 
@@ -155,7 +231,25 @@ void main()
         }
     }
 
+    if (cmd.action == ACTION_COPY_GZIP) {
+        ets_putc('g'); ets_putc('z'); ets_putc(':');
+        ets_wdt_disable();
+        res = copy_gzip(cmd.args[0], cmd.args[1], cmd.args[2]);
+        ets_wdt_enable();
+        ets_putc('0'+res); ets_putc('\n');
+        // up to the check nothing was overwritten, the old sketch is there
+        if (res < 3) {
+            cmd.action = ACTION_LOAD_APP;
+            cmd.args[0] = cmd.args[1];
+        }
+    }
+
     if (cmd.action == ACTION_LOAD_APP) {
+        // for the sketch to map its slot, see Cache_Read_Enable_New();
+        // other layouts may have the word in their RTC user memory
+        if (slot >= 0 || (EBOOT_SLOT_BOOTED & ~1) == EBOOT_SLOT_BOOTED_MAGIC) {
+            EBOOT_SLOT_BOOTED = EBOOT_SLOT_BOOTED_MAGIC | ((cmd.args[0] / EBOOT_SLOT_SIZE) & 1);
+        }
         ets_putc('l'); ets_putc('d'); ets_putc('\n');
         res = load_app_from_flash_raw(cmd.args[0]);
         //we will get to this only on load fail
@@ -16,6 +16,7 @@
 
 enum action_t {
     ACTION_COPY_RAW = 0x00000001,
+    ACTION_COPY_GZIP = 0x00000002,
     ACTION_LOAD_APP = 0xffffffff
 };
 
@@ -30,6 +31,38 @@ struct eboot_command {
 };
 
 
+// A/B layouts (eagle.flash.4m2m.ab.ld) keep two sketches, each in its own
+// MB of flash with eboot's sector ahead of it, and the cache maps the one
+// running at the usual addresses: an update is written to the other slot
+// and eboot only has to start that one. The slot log sector says which:
+// records are appended, the last one with a good CRC counts. The one
+// written by an update starts a trial, the sketch has EBOOT_SLOT_TRIES
+// boots to confirm it works before eboot goes back to the fallback slot.
+#define EBOOT_SLOT_SIZE     0x100000
+#define EBOOT_SLOT_LOG      0x3FA000
+#define EBOOT_SLOT_MAGIC    0xeb00a0b1
+#define EBOOT_SLOT_TRIES    3
+
+struct eboot_slot_record {
+    uint32_t magic;
+    uint32_t slot;          // to start
+    uint32_t fallback;      // to start if a trial fails
+    uint32_t home_crc;      // of slot 0's first image sector: a sketch
+                            // uploaded over serial changes it, and then
+                            // eboot starts slot 0 whatever the log says
+    uint32_t crc32;         // of the fields above
+    uint32_t tries;         // trial boots left, one bit cleared by each
+    uint32_t trial;         // not 0 until the sketch confirms it works
+    uint32_t reserved;
+};
+
+// eboot leaves the slot it started here for the sketch, (magic | slot),
+// in a word of the command that it has read by then
+#define EBOOT_SLOT_BOOTED   (RTC_MEM[30])
+#define EBOOT_SLOT_BOOTED_MAGIC 0xeb051000
+
+uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t length);
+
 int eboot_command_read(struct eboot_command* cmd);
 void eboot_command_write(struct eboot_command* cmd);
 void eboot_command_clear();
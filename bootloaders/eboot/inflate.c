@@ -0,0 +1,423 @@
+/* This file is part of eboot bootloader.
+ *
+ * Redistribution and use is permitted according to the conditions of the
+ * 3-clause BSD license to be found in the LICENSE file.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash.h"
+#include "inflate.h"
+
+// The decoding follows zlib's contrib/puff, as the core's Inflater does:
+// canonical Huffman codes are decoded a bit at a time, with no tables but
+// the code lengths. eboot runs from IRAM, where only whole words can be
+// read, so there are no byte tables: the length and distance bases are
+// worked out, and the state is on the stack.
+
+// All of the 32 KB a match can reach back, in the RAM the sketch isn't
+// loaded into yet; sectors are written from it as they fill up.
+#ifndef INFLATE_WINDOW
+#define INFLATE_WINDOW ((uint8_t*) 0x3FFE8000)
+#endif
+#define WINDOW_SIZE 0x8000
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+
+#define GZIP_FHCRC    0x02
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+
+static const uint32_t code_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+struct inflate_state {
+    uint32_t in[64];
+    uint32_t in_addr;       // of the next piece to read
+    uint32_t in_end;
+    uint32_t in_pos;
+    uint32_t in_len;
+    uint32_t bit_buf;
+    int bit_count;
+    bool error;
+
+    uint8_t* window;
+    uint32_t out_pos;
+    uint32_t flushed;
+    uint32_t dst_addr;
+    uint32_t max_size;
+    bool write;
+    uint32_t head;
+    uint32_t crc;
+
+    uint16_t len_count[16];
+    uint16_t len_symbol[288];
+    uint16_t dist_count[16];
+    uint16_t dist_symbol[30];
+};
+
+static uint32_t next_byte(struct inflate_state* s)
+{
+    if (s->in_pos == s->in_len) {
+        if (s->error || s->in_addr >= s->in_end) {
+            s->error = true;
+            return 0;
+        }
+        if (SPIRead(s->in_addr, s->in, sizeof(s->in))) {
+            s->error = true;
+            return 0;
+        }
+        s->in_len = s->in_end - s->in_addr;
+        if (s->in_len > sizeof(s->in)) {
+            s->in_len = sizeof(s->in);
+        }
+        s->in_addr += s->in_len;
+        s->in_pos = 0;
+    }
+    return ((uint8_t*) s->in)[s->in_pos++];
+}
+
+static uint32_t bits(struct inflate_state* s, int count)
+{
+    while (s->bit_count < count) {
+        s->bit_buf |= next_byte(s) << s->bit_count;
+        s->bit_count += 8;
+    }
+    uint32_t value = s->bit_buf & ((1u << count) - 1);
+    s->bit_buf >>= count;
+    s->bit_count -= count;
+    return value;
+}
+
+static int decode(struct inflate_state* s, const uint16_t* count, const uint16_t* symbol)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len < 16; ++len) {
+        code |= bits(s, 1);
+        int n = count[len];
+        if (code - n < first) {
+            return symbol[index + (code - first)];
+        }
+        index += n;
+        first += n;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// 0 for a complete code, more for an incomplete one, less than 0 for one
+// that is over subscribed
+static int build_code(uint16_t* count, uint16_t* symbol, const uint8_t* length, int n)
+{
+    for (int len = 0; len < 16; ++len) {
+        count[len] = 0;
+    }
+    for (int sym = 0; sym < n; ++sym) {
+        ++count[length[sym]];
+    }
+    if (count[0] == n) {
+        return 0;
+    }
+    int left = 1;
+    for (int len = 1; len < 16; ++len) {
+        left <<= 1;
+        left -= count[len];
+        if (left < 0) {
+            return left;
+        }
+    }
+    uint16_t offs[16];
+    offs[1] = 0;
+    for (int len = 1; len < 15; ++len) {
+        offs[len + 1] = offs[len] + count[len];
+    }
+    for (int sym = 0; sym < n; ++sym) {
+        if (length[sym] != 0) {
+            symbol[offs[length[sym]]++] = sym;
+        }
+    }
+    return left;
+}
+
+static bool flush(struct inflate_state* s)
+{
+    uint32_t size = s->out_pos - s->flushed;
+    if (size == 0) {
+        return true;
+    }
+    // whole sectors are erased
+    if (s->flushed + FLASH_SECTOR_SIZE > s->max_size) {
+        return false;
+    }
+    if (s->flushed == 0) {
+        s->head = *(uint32_t*) s->window;
+    }
+    if (s->write) {
+        uint32_t addr = s->dst_addr + s->flushed;
+        if (SPIEraseSector(addr / FLASH_SECTOR_SIZE) ||
+            SPIWrite(addr, s->window + (s->flushed & WINDOW_MASK), (size + 3) & ~3)) {
+            return false;
+        }
+    }
+    s->flushed = s->out_pos;
+    return true;
+}
+
+static bool put(struct inflate_state* s, uint32_t value)
+{
+    s->window[s->out_pos & WINDOW_MASK] = value;
+    ++s->out_pos;
+    s->crc ^= value;
+    for (int i = 0; i < 8; ++i) {
+        s->crc = (s->crc >> 1) ^ (0xedb88320 & -(s->crc & 1));
+    }
+    if ((s->out_pos & (FLASH_SECTOR_SIZE - 1)) == 0) {
+        return flush(s);
+    }
+    return true;
+}
+
+static bool stored(struct inflate_state* s)
+{
+    s->bit_buf = 0;
+    s->bit_count = 0;
+    uint32_t length = bits(s, 16);
+    if (length != (~bits(s, 16) & 0xffff)) {
+        return false;
+    }
+    while (length-- && !s->error) {
+        if (!put(s, next_byte(s))) {
+            return false;
+        }
+    }
+    return !s->error;
+}
+
+static bool codes(struct inflate_state* s)
+{
+    for (;;) {
+        int symbol = decode(s, s->len_count, s->len_symbol);
+        if (symbol < 0 || s->error) {
+            return false;
+        }
+        if (symbol < 256) {
+            if (!put(s, symbol)) {
+                return false;
+            }
+            continue;
+        }
+        if (symbol == 256) {
+            return true;
+        }
+        symbol -= 257;
+        uint32_t length;
+        if (symbol < 8) {
+            length = symbol + 3;
+        } else if (symbol < 28) {
+            int extra = (symbol >> 2) - 1;
+            length = ((4 + (symbol & 3)) << extra) + 3 + bits(s, extra);
+        } else if (symbol == 28) {
+            length = 258;
+        } else {
+            return false;
+        }
+        symbol = decode(s, s->dist_count, s->dist_symbol);
+        if (symbol < 0 || symbol >= 30) {
+            return false;
+        }
+        uint32_t distance;
+        if (symbol < 4) {
+            distance = symbol + 1;
+        } else {
+            int extra = (symbol >> 1) - 1;
+            distance = ((2 + (symbol & 1)) << extra) + 1 + bits(s, extra);
+        }
+        if (s->error || distance > s->out_pos) {
+            return false;
+        }
+        // byte by byte, the match may overlap what it produces
+        while (length--) {
+            if (!put(s, s->window[(s->out_pos - distance) & WINDOW_MASK])) {
+                return false;
+            }
+        }
+    }
+}
+
+static bool fixed(struct inflate_state* s)
+{
+    uint8_t lengths[288];
+    int sym = 0;
+    for (; sym < 144; ++sym) {
+        lengths[sym] = 8;
+    }
+    for (; sym < 256; ++sym) {
+        lengths[sym] = 9;
+    }
+    for (; sym < 280; ++sym) {
+        lengths[sym] = 7;
+    }
+    for (; sym < 288; ++sym) {
+        lengths[sym] = 8;
+    }
+    build_code(s->len_count, s->len_symbol, lengths, 288);
+    for (sym = 0; sym < 30; ++sym) {
+        lengths[sym] = 5;
+    }
+    build_code(s->dist_count, s->dist_symbol, lengths, 30);
+    return codes(s);
+}
+
+static bool dynamic(struct inflate_state* s)
+{
+    int nlen = bits(s, 5) + 257;
+    int ndist = bits(s, 5) + 1;
+    int ncode = bits(s, 4) + 4;
+    if (nlen > 286 || ndist > 30) {
+        return false;
+    }
+    uint8_t lengths[288 + 30];
+    int index;
+    for (index = 0; index < 19; ++index) {
+        lengths[code_order[index]] = (index < ncode) ? bits(s, 3) : 0;
+    }
+    // the code for the code lengths, kept in the literal/length tables
+    if (build_code(s->len_count, s->len_symbol, lengths, 19) != 0) {
+        return false;
+    }
+    index = 0;
+    while (index < nlen + ndist) {
+        int symbol = decode(s, s->len_count, s->len_symbol);
+        if (symbol < 0 || s->error) {
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[index++] = symbol;
+            continue;
+        }
+        uint8_t length = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) {
+                return false;
+            }
+            length = lengths[index - 1];
+            repeat = 3 + bits(s, 2);
+        } else if (symbol == 17) {
+            repeat = 3 + bits(s, 3);
+        } else {
+            repeat = 11 + bits(s, 7);
+        }
+        if (index + repeat > nlen + ndist) {
+            return false;
+        }
+        while (repeat--) {
+            lengths[index++] = length;
+        }
+    }
+    if (lengths[256] == 0) {
+        return false;
+    }
+    // an incomplete code is only allowed if it has a single length
+    int err = build_code(s->len_count, s->len_symbol, lengths, nlen);
+    if (err < 0 || (err > 0 && nlen - s->len_count[0] != 1)) {
+        return false;
+    }
+    err = build_code(s->dist_count, s->dist_symbol, lengths + nlen, ndist);
+    if (err < 0 || (err > 0 && ndist - s->dist_count[0] != 1)) {
+        return false;
+    }
+    return !s->error && codes(s);
+}
+
+static bool header(struct inflate_state* s)
+{
+    if (bits(s, 8) != 0x1f || bits(s, 8) != 0x8b || bits(s, 8) != 8) {
+        return false;
+    }
+    uint32_t flags = bits(s, 8);
+    if (flags & 0xe0) {
+        return false;
+    }
+    // modification time, extra flags, operating system
+    for (int i = 0; i < 6; ++i) {
+        bits(s, 8);
+    }
+    if (flags & GZIP_FEXTRA) {
+        for (uint32_t skip = bits(s, 16); skip && !s->error; --skip) {
+            bits(s, 8);
+        }
+    }
+    if (flags & GZIP_FNAME) {
+        while (bits(s, 8) && !s->error) {
+        }
+    }
+    if (flags & GZIP_FCOMMENT) {
+        while (bits(s, 8) && !s->error) {
+        }
+    }
+    if (flags & GZIP_FHCRC) {
+        bits(s, 16);
+    }
+    return !s->error;
+}
+
+uint32_t inflate_gzip(uint32_t src_addr, uint32_t size, uint32_t dst_addr,
+                      uint32_t max_size, bool write, uint32_t* head)
+{
+    struct inflate_state s;
+    s.in_addr = src_addr;
+    s.in_end = src_addr + size;
+    s.in_pos = 0;
+    s.in_len = 0;
+    s.bit_buf = 0;
+    s.bit_count = 0;
+    s.error = false;
+    s.window = INFLATE_WINDOW;
+    s.out_pos = 0;
+    s.flushed = 0;
+    s.dst_addr = dst_addr;
+    s.max_size = max_size;
+    s.write = write;
+    s.head = 0;
+    s.crc = 0xffffffff;
+
+    if (!header(&s)) {
+        return 0;
+    }
+    bool last;
+    do {
+        last = bits(&s, 1);
+        uint32_t type = bits(&s, 2);
+        bool ok;
+        if (type == 0) {
+            ok = stored(&s);
+        } else if (type == 1) {
+            ok = fixed(&s);
+        } else if (type == 2) {
+            ok = dynamic(&s);
+        } else {
+            ok = false;
+        }
+        if (!ok || s.error) {
+            return 0;
+        }
+    } while (!last);
+
+    s.bit_buf = 0;
+    s.bit_count = 0;
+    uint32_t crc = bits(&s, 16);
+    crc |= bits(&s, 16) << 16;
+    uint32_t out_size = bits(&s, 16);
+    out_size |= bits(&s, 16) << 16;
+    if (s.error || crc != ~s.crc || out_size != s.out_pos || !flush(&s)) {
+        return 0;
+    }
+    *head = s.head;
+    return s.out_pos;
+}
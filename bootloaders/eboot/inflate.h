@@ -0,0 +1,22 @@
+/* This file is part of eboot bootloader.
+ *
+ * Redistribution and use is permitted according to the conditions of the
+ * 3-clause BSD license to be found in the LICENSE file.
+ */
+
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Decompresses the gzip data of size bytes at src_addr (sector aligned)
+// to dst_addr (sector aligned), erasing the sectors it writes to, which
+// must end within max_size bytes. With write false it only decodes it,
+// to check the CRC and the size before anything is overwritten; head
+// gets the first word of the output.
+// Returns the size of the output, 0 on bad data or a flash error.
+uint32_t inflate_gzip(uint32_t src_addr, uint32_t size, uint32_t dst_addr,
+                      uint32_t max_size, bool write, uint32_t* head);
+
+#endif //INFLATE_H
@@ -38,6 +38,7 @@ extern "C" {
 #include "esp8266_peri.h"
 #include "twi.h"
 #include "core_esp8266_features.h"
+#include "yield_budget.h"
 
 #define HIGH 0x1
 #define LOW  0x0
@@ -165,7 +166,10 @@ void ets_intr_unlock();
 #define noInterrupts() xt_rsil(15)
 
 
-#define clockCyclesPerMicrosecond() ( F_CPU / 1000000L )
+// F_CPU is the frequency at boot, ESP.setCpuFrequencyMHz() changes it
+uint32_t esp_get_cpu_freq_mhz(void);
+
+#define clockCyclesPerMicrosecond() ( esp_get_cpu_freq_mhz() )
 #define clockCyclesToMicroseconds(a) ( (a) / clockCyclesPerMicrosecond() )
 #define microsecondsToClockCycles(a) ( (a) * clockCyclesPerMicrosecond() )
 
@@ -199,10 +203,12 @@ void pinMode(uint8_t pin, uint8_t mode);
 void digitalWrite(uint8_t pin, uint8_t val);
 int digitalRead(uint8_t pin);
 int analogRead(uint8_t pin);
+bool analogReadBurst(uint16_t* buffer, size_t count, uint8_t clkdiv);
 void analogReference(uint8_t mode);
 void analogWrite(uint8_t pin, int val);
 void analogWriteFreq(uint32_t freq);
 void analogWriteRange(uint32_t range);
+void analogWritePhase(uint8_t pin, int phase);
 
 unsigned long millis(void);
 unsigned long micros(void);
@@ -258,6 +264,7 @@ const int TIM_DIV265 __attribute__((deprecated, weak)) = TIM_DIV256;
 #include "WString.h"
 
 #include "HardwareSerial.h"
+#include "LogBuffer.h"
 #include "Esp.h"
 #include "Updater.h"
 #include "debug.h"
@@ -291,6 +298,11 @@ long map(long, long, long, long, long);
 
 extern "C" void configTime(long timezone, int daylightOffset_sec,
     const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+// Keep the time in RTC user memory from rtcOffset (7 blocks, see
+// ESP.rtcUserMemoryWrite(); TIME_RTC_OFFSET in RtcMemoryMap.h is kept
+// for it) at each SNTP sync, and set the clock from it
+// now if it is there: after a deep sleep the time is known right away.
+extern "C" bool configTimeRTC(uint32_t rtcOffset);
 
 #endif
 
@@ -298,7 +310,7 @@ extern "C" void configTime(long timezone, int daylightOffset_sec,
 
 #endif
 
-#ifdef DEBUG_ESP_OOM
+#if defined(DEBUG_ESP_OOM) || defined(DEBUG_ESP_HEAP_PROFILE) || defined(DEBUG_ESP_HEAP_TRACE)
 // reinclude *alloc redefinition because of <cstdlib> undefining them
 // this is mandatory for allowing OOM *alloc definitions in .ino files
 #include "umm_malloc/umm_malloc_cfg.h"
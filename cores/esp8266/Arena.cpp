@@ -0,0 +1,72 @@
+/*
+ Arena.cpp - bump allocator for short-lived temporary memory
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "Arena.h"
+
+Arena::Arena(size_t size) :
+    _buf((uint8_t*) malloc(size)), _size(size), _used(0), _peak(0), _owned(true) {
+    if(!_buf) {
+        _size = 0;
+    }
+}
+
+Arena::Arena(void* buffer, size_t size) :
+    _buf((uint8_t*) buffer), _size(size), _used(0), _peak(0), _owned(false) {
+    // keep allocations aligned even if the buffer isn't
+    size_t skip = (4 - ((uintptr_t) _buf & 3)) & 3;
+    if(skip > _size) {
+        skip = _size;
+    }
+    _buf += skip;
+    _size -= skip;
+}
+
+Arena::~Arena() {
+    if(_owned) {
+        free(_buf);
+    }
+}
+
+void* Arena::alloc(size_t size) {
+    size = (size + 3) & ~3;
+    if(size == 0 || size > _size - _used) {
+        return nullptr;
+    }
+    void* ret = _buf + _used;
+    _used += size;
+    if(_used > _peak) {
+        _peak = _used;
+    }
+    return ret;
+}
+
+char* Arena::strdup(const char* str, size_t len) {
+    char* ret = (char*) alloc(len + 1);
+    if(ret) {
+        memcpy(ret, str, len);
+        ret[len] = 0;
+    }
+    return ret;
+}
+
+char* Arena::strdup(const char* str) {
+    return strdup(str, strlen(str));
+}
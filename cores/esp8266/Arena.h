@@ -0,0 +1,95 @@
+/*
+ Arena.h - bump allocator for short-lived temporary memory
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __arena_h
+#define __arena_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+// One block of memory handed out front to back, and given back all at once.
+// Meant for the temporaries of one job, e.g. handling a request: they take
+// one heap allocation of a known size instead of many small ones mixed with
+// the long-lived ones. Nothing is freed on its own; objects with destructors
+// allocated with new (arena) have to be destroyed by hand before the memory
+// is released.
+class Arena {
+    public:
+        Arena(size_t size);                 // block taken from the heap
+        Arena(void* buffer, size_t size);   // caller's block, e.g. on the stack
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // 4-byte aligned, nullptr when the rest of the block is too small
+        void* alloc(size_t size);
+        // copy of len chars and a terminating 0
+        char* strdup(const char* str, size_t len);
+        char* strdup(const char* str);
+
+        // release everything
+        void reset() {
+            _used = 0;
+        }
+
+        size_t size() const {
+            return _size;
+        }
+        size_t used() const {
+            return _used;
+        }
+        size_t available() const {
+            return _size - _used;
+        }
+        size_t peak() const {
+            return _peak;
+        }
+
+        // Releases what was allocated during its lifetime
+        class Scope {
+            public:
+                Scope(Arena& arena) : _arena(arena), _mark(arena._used) {}
+                ~Scope() {
+                    _arena._used = _mark;
+                }
+
+            private:
+                Arena& _arena;
+                size_t _mark;
+        };
+
+    private:
+        uint8_t* _buf;
+        size_t _size;
+        size_t _used;
+        size_t _peak;
+        bool _owned;
+};
+
+inline void* operator new(size_t size, Arena& arena) noexcept {
+    return arena.alloc(size);
+}
+
+inline void* operator new[](size_t size, Arena& arena) noexcept {
+    return arena.alloc(size);
+}
+
+#endif//__arena_h
@@ -0,0 +1,383 @@
+/*
+ AssetFS.cpp - read only file system for files packed at build time
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+#include "AssetFS.h"
+#include "debug.h"
+
+using namespace fs;
+
+// the same unaligned reads SPIFFS does, see spiffs_hal.cpp
+extern int32_t spiffs_hal_read(uint32_t addr, uint32_t size, uint8_t *dst);
+
+#define ASSETFS_HEADER_SIZE 16
+#define ASSETFS_ENTRY_SIZE  28
+#define ASSETFS_MAX_PATH    64
+
+static_assert(sizeof(AssetFSImpl::Entry) == ASSETFS_ENTRY_SIZE, "entries are packed");
+
+static uint32_t assetfs_hash(const char* path)
+{
+    // FNV-1a, tools/assetfs_pack.py has to agree
+    uint32_t hash = 2166136261u;
+    while (*path) {
+        hash ^= (uint8_t) *path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+class AssetFSFileImpl : public FileImpl
+{
+public:
+    AssetFSFileImpl(AssetFSImpl* fs, const AssetFSImpl::Entry& entry)
+        : _fs(fs), _entry(entry), _name(fs->readString(entry.path)) { }
+
+    size_t write(const uint8_t *buf, size_t size) override
+    {
+        (void) buf;
+        (void) size;
+        return 0;
+    }
+
+    size_t read(uint8_t* buf, size_t size) override
+    {
+        if (_pos + size > _entry.size) {
+            size = _entry.size - _pos;
+        }
+        if (size == 0 || !_fs->read(_entry.offset + _pos, buf, size)) {
+            return 0;
+        }
+        _pos += size;
+        return size;
+    }
+
+    void flush() override { }
+
+    bool seek(uint32_t pos, SeekMode mode) override
+    {
+        int64_t to = pos;
+        if (mode == SeekCur) {
+            to = _pos + (int64_t) pos;
+        } else if (mode == SeekEnd) {
+            to = _entry.size - (int64_t) pos;
+        }
+        if (to < 0 || to > _entry.size) {
+            return false;
+        }
+        _pos = to;
+        return true;
+    }
+
+    size_t position() const override
+    {
+        return _pos;
+    }
+
+    size_t size() const override
+    {
+        return _entry.size;
+    }
+
+    void close() override { }
+
+    const char* name() const override
+    {
+        return _name.c_str();
+    }
+
+    const uint8_t* mapped(size_t& size) override
+    {
+        // the data of a file is in one piece
+        size = _entry.size - _pos;
+        const uint8_t* data = size ? _fs->mapped(_entry.offset + _pos, size) : nullptr;
+        if (!data) {
+            size = 0;
+        }
+        return data;
+    }
+
+protected:
+    AssetFSImpl* _fs;
+    AssetFSImpl::Entry _entry;
+    String _name;
+    uint32_t _pos = 0;
+};
+
+class AssetFSDirImpl : public DirImpl
+{
+public:
+    AssetFSDirImpl(AssetFSImpl* fs, const char* prefix)
+        : _fs(fs), _prefix(prefix) { }
+
+    FileImplPtr openFile(OpenMode openMode, AccessMode accessMode) override
+    {
+        if (!_valid || openMode != OM_DEFAULT || accessMode != AM_READ) {
+            return FileImplPtr();
+        }
+        return std::make_shared<AssetFSFileImpl>(_fs, _entry);
+    }
+
+    const char* fileName() override
+    {
+        if (!_valid) {
+            return nullptr;
+        }
+        return _name.c_str();
+    }
+
+    size_t fileSize() override
+    {
+        if (!_valid) {
+            return 0;
+        }
+        return _entry.size;
+    }
+
+    bool next() override
+    {
+        _valid = false;
+        while (_index < _fs->count()) {
+            if (!_fs->readEntry(_index++, _entry)) {
+                return false;
+            }
+            _name = _fs->readString(_entry.path);
+            if (_name.startsWith(_prefix)) {
+                _valid = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+protected:
+    AssetFSImpl* _fs;
+    String _prefix;
+    AssetFSImpl::Entry _entry;
+    String _name;
+    uint16_t _index = 0;
+    bool _valid = false;
+};
+
+bool AssetFSImpl::begin()
+{
+    _mounted = false;
+    uint8_t header[ASSETFS_HEADER_SIZE];
+    if (!read(0, header, sizeof(header))) {
+        return false;
+    }
+    uint32_t magic;
+    uint16_t version, count, slots;
+    uint32_t used;
+    memcpy(&magic, header, 4);
+    memcpy(&version, header + 4, 2);
+    memcpy(&count, header + 6, 2);
+    memcpy(&slots, header + 8, 2);
+    memcpy(&used, header + 12, 4);
+    if (magic != ASSETFS_MAGIC || version != ASSETFS_VERSION || used > _size ||
+            slots == 0 || (slots & (slots - 1)) != 0 || count > slots) {
+        DEBUGV("AssetFSImpl::begin: no image at %x\r\n", _start);
+        return false;
+    }
+    _count = count;
+    _slots = slots;
+    _used = used;
+    _mounted = true;
+    return true;
+}
+
+void AssetFSImpl::end()
+{
+    _mounted = false;
+}
+
+bool AssetFSImpl::format()
+{
+    return false;
+}
+
+bool AssetFSImpl::info(FSInfo& info)
+{
+    if (!_mounted) {
+        return false;
+    }
+    info.totalBytes = _size;
+    info.usedBytes = _used;
+    info.blockSize = 0;
+    info.pageSize = 0;
+    info.maxOpenFiles = 0;
+    info.maxPathLength = ASSETFS_MAX_PATH;
+    return true;
+}
+
+FileImplPtr AssetFSImpl::open(const char* path, OpenMode openMode, AccessMode accessMode)
+{
+    if (openMode != OM_DEFAULT || accessMode != AM_READ) {
+        DEBUGV("AssetFSImpl::open: read only, path=`%s`\r\n", path);
+        return FileImplPtr();
+    }
+    Entry entry;
+    if (!_find(path, entry)) {
+        return FileImplPtr();
+    }
+    return std::make_shared<AssetFSFileImpl>(this, entry);
+}
+
+bool AssetFSImpl::exists(const char* path)
+{
+    Entry entry;
+    return _find(path, entry);
+}
+
+DirImplPtr AssetFSImpl::openDir(const char* path)
+{
+    if (!_mounted) {
+        return DirImplPtr();
+    }
+    return std::make_shared<AssetFSDirImpl>(this, path);
+}
+
+bool AssetFSImpl::rename(const char* pathFrom, const char* pathTo)
+{
+    (void) pathFrom;
+    (void) pathTo;
+    return false;
+}
+
+bool AssetFSImpl::remove(const char* path)
+{
+    (void) path;
+    return false;
+}
+
+bool AssetFSImpl::stat(const char* path, AssetInfo& info)
+{
+    Entry entry;
+    if (!_find(path, entry)) {
+        return false;
+    }
+    info.size = entry.size;
+    info.contentType = readString(entry.contentType);
+    info.etag = readString(entry.etag);
+    info.gzip = (entry.flags & ASSETFS_FLAG_GZIP) != 0;
+    return true;
+}
+
+bool AssetFSImpl::readEntry(uint16_t index, Entry& entry)
+{
+    if (index >= _count) {
+        return false;
+    }
+    uint32_t offset = ASSETFS_HEADER_SIZE + ((_slots * 2 + 3) & ~3) + index * ASSETFS_ENTRY_SIZE;
+    return read(offset, &entry, sizeof(entry));
+}
+
+String AssetFSImpl::readString(uint32_t offset)
+{
+    // the packer keeps paths and the other strings shorter than this
+    char buf[ASSETFS_MAX_PATH];
+    size_t size = (offset < _used) ? _used - offset : 0;
+    if (size > sizeof(buf)) {
+        size = sizeof(buf);
+    }
+    if (size == 0 || !read(offset, buf, size)) {
+        return String();
+    }
+    buf[size - 1] = 0;
+    return String(buf);
+}
+
+bool AssetFSImpl::read(uint32_t offset, void* dst, size_t size)
+{
+    if (offset + size > _size) {
+        return false;
+    }
+    return spiffs_hal_read(_start + offset, size, (uint8_t*) dst) == 0;
+}
+
+const uint8_t* AssetFSImpl::mapped(uint32_t offset, size_t size)
+{
+#ifdef ARDUINO
+    // the cache maps the first megabyte of the flash
+    uint32_t addr = _start + offset;
+    if (offset + size > _used || addr + size > 0x100000) {
+        return nullptr;
+    }
+    return (const uint8_t*) (0x40200000 + addr);
+#else
+    (void) offset;
+    (void) size;
+    return nullptr;
+#endif
+}
+
+bool AssetFSImpl::_find(const char* path, Entry& entry)
+{
+    if (!_mounted || !path) {
+        return false;
+    }
+    size_t length = strlen(path);
+    if (length == 0 || length >= ASSETFS_MAX_PATH) {
+        return false;
+    }
+    uint32_t hash = assetfs_hash(path);
+    for (uint16_t probe = 0; probe < _slots; ++probe) {
+        uint16_t slot = (hash + probe) & (_slots - 1);
+        uint16_t index;
+        if (!read(ASSETFS_HEADER_SIZE + slot * 2, &index, 2) || index == 0) {
+            return false;
+        }
+        if (!readEntry(index - 1, entry)) {
+            return false;
+        }
+        if (entry.hash != hash) {
+            continue;
+        }
+        char name[ASSETFS_MAX_PATH];
+        if (!read(entry.path, name, length + 1)) {
+            return false;
+        }
+        if (memcmp(name, path, length + 1) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef ARDUINO
+extern "C" uint32_t _SPIFFS_start;
+extern "C" uint32_t _SPIFFS_end;
+
+AssetFS::AssetFS()
+    : AssetFS(new AssetFSImpl(
+                  (uint32_t) (&_SPIFFS_start) - 0x40200000,
+                  (uint32_t) (&_SPIFFS_end) - (uint32_t) (&_SPIFFS_start)))
+{
+}
+#endif
+
+AssetFS::AssetFS(uint32_t start, uint32_t size)
+    : AssetFS(new AssetFSImpl(start, size))
+{
+}
+
+bool AssetFS::stat(const char* path, AssetInfo& info)
+{
+    return _assets->stat(path, info);
+}
@@ -0,0 +1,131 @@
+/*
+ AssetFS.h - read only file system for files packed at build time
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef ASSETFS_H
+#define ASSETFS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FS.h"
+#include "FSImpl.h"
+#include "WString.h"
+
+/*
+ An image made by tools/assetfs_pack.py from a directory of files that
+ don't change at runtime, like the pages of a web interface. The paths are
+ kept in a hash table, so opening a file takes one probe and no scan, and
+ reading it is reading the flash. Everything is little endian, offsets are
+ from the start of the image:
+
+   header   magic "AFS1", u16 version, u16 entry count, u16 slot count
+            (a power of two), u16 reserved, u32 image size
+   slots    u16 per slot, index + 1 of an entry, 0 for none; a path goes in
+            the first free slot from its hash on
+   entries  sorted by path: u32 hash (FNV-1a of the path), u32 path,
+            u32 content type, u32 ETag (all three string offsets), u32 data
+            offset, u32 size, u32 flags
+   strings  and data, each file's data 4 byte aligned
+*/
+
+#define ASSETFS_MAGIC    0x31534641
+#define ASSETFS_VERSION  1
+
+// the data is compressed with gzip, send it with Content-Encoding: gzip
+#define ASSETFS_FLAG_GZIP 1
+
+struct AssetInfo {
+    size_t size;
+    String contentType;
+    String etag;
+    bool gzip;
+};
+
+class AssetFSImpl : public fs::FSImpl
+{
+public:
+    struct Entry {
+        uint32_t hash;
+        uint32_t path;
+        uint32_t contentType;
+        uint32_t etag;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t flags;
+    };
+
+    AssetFSImpl(uint32_t start, uint32_t size)
+        : _start(start), _size(size) { }
+
+    bool begin() override;
+    void end() override;
+    bool format() override;
+    bool info(fs::FSInfo& info) override;
+    fs::FileImplPtr open(const char* path, fs::OpenMode openMode, fs::AccessMode accessMode) override;
+    bool exists(const char* path) override;
+    fs::DirImplPtr openDir(const char* path) override;
+    bool rename(const char* pathFrom, const char* pathTo) override;
+    bool remove(const char* path) override;
+
+    bool stat(const char* path, AssetInfo& info);
+
+    // used by the file and directory objects
+    uint16_t count() const {
+        return _count;
+    }
+    bool readEntry(uint16_t index, Entry& entry);
+    String readString(uint32_t offset);
+    bool read(uint32_t offset, void* dst, size_t size);
+    const uint8_t* mapped(uint32_t offset, size_t size);
+
+protected:
+    bool _find(const char* path, Entry& entry);
+
+    uint32_t _start;
+    uint32_t _size;
+    uint32_t _used = 0;
+    uint16_t _count = 0;
+    uint16_t _slots = 0;
+    bool _mounted = false;
+};
+
+// A file system on an AssetFS image. Without arguments the image is
+// expected where SPIFFS would be, written there by uploading it instead of
+// a SPIFFS image.
+class AssetFS : public fs::FS
+{
+public:
+#ifdef ARDUINO
+    AssetFS();
+#endif
+    AssetFS(uint32_t start, uint32_t size);
+
+    // content type, ETag and gzip flag of a file as packed
+    bool stat(const char* path, AssetInfo& info);
+    bool stat(const String& path, AssetInfo& info) {
+        return stat(path.c_str(), info);
+    }
+
+protected:
+    explicit AssetFS(AssetFSImpl* assets)
+        : fs::FS(fs::FSImplPtr(assets)), _assets(assets) { }
+
+    AssetFSImpl* _assets;
+};
+
+#endif //ASSETFS_H
@@ -0,0 +1,85 @@
+/*
+ BufferedPrint.cpp - Print that gathers small writes before passing them on
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "BufferedPrint.h"
+
+BufferedPrint::BufferedPrint(Print& out, size_t size) :
+    _out(out), _buf((uint8_t*) malloc(size)), _size(size), _used(0), _owned(true) {
+    if(!_buf) {
+        // without a buffer everything goes straight through
+        _size = 0;
+    }
+}
+
+BufferedPrint::BufferedPrint(Print& out, void* buffer, size_t size) :
+    _out(out), _buf((uint8_t*) buffer), _size(buffer ? size : 0), _used(0), _owned(false) {
+}
+
+BufferedPrint::~BufferedPrint() {
+    drain();
+    if(_owned) {
+        free(_buf);
+    }
+}
+
+bool BufferedPrint::drain() {
+    size_t sent = 0;
+    while(sent < _used) {
+        size_t n = _out.write(_buf + sent, _used - sent);
+        if(n == 0) {
+            break;
+        }
+        sent += n;
+    }
+    bool ok = sent == _used;
+    if(!ok) {
+        // what the output refused is lost
+        setWriteError();
+    }
+    _used = 0;
+    return ok;
+}
+
+size_t BufferedPrint::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t BufferedPrint::write(const uint8_t *buffer, size_t size) {
+    if(size > _size - _used && _used) {
+        if(!drain()) {
+            return 0;
+        }
+    }
+    if(size > _size) {
+        return _out.write(buffer, size);
+    }
+    memcpy(_buf + _used, buffer, size);
+    _used += size;
+    if(_used == _size) {
+        drain();
+    }
+    return size;
+}
+
+void BufferedPrint::flush() {
+    drain();
+    _out.flush();
+}
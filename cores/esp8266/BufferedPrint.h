@@ -0,0 +1,66 @@
+/*
+ BufferedPrint.h - Print that gathers small writes before passing them on
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __bufferedprint_h
+#define __bufferedprint_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Print.h"
+
+// Collects what is printed to it and writes it to the wrapped Print in
+// blocks of the buffer size, e.g. to send a log line through a WiFiClient
+// in one segment instead of one per print() call. Writes larger than the
+// buffer go straight through. Nothing reaches the output before the buffer
+// is full or flush() is called; the destructor sends what is left.
+class BufferedPrint: public Print {
+    public:
+        BufferedPrint(Print& out, size_t size = 128);        // buffer taken from the heap
+        BufferedPrint(Print& out, void* buffer, size_t size); // caller's buffer
+        virtual ~BufferedPrint();
+
+        BufferedPrint(const BufferedPrint&) = delete;
+        BufferedPrint& operator=(const BufferedPrint&) = delete;
+
+        virtual size_t write(uint8_t c) override;
+        virtual size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+
+        // sends the buffered bytes and flushes the output
+        virtual void flush() override;
+
+        size_t size() const {
+            return _size;
+        }
+        size_t buffered() const {
+            return _used;
+        }
+
+    protected:
+        // sends the buffered bytes, false if the output didn't take them all
+        bool drain();
+
+        Print& _out;
+        uint8_t* _buf;
+        size_t _size;
+        size_t _used;
+        bool _owned;
+};
+
+#endif//__bufferedprint_h
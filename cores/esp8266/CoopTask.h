@@ -0,0 +1,47 @@
+/*
+ CoopTask.h - cooperative tasks running next to loop()
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef COOP_TASK_H
+#define COOP_TASK_H
+
+#include <stddef.h>
+
+// Each task is a continuation with its own stack, like the one loop() runs
+// in. Whenever loop() or a task yields (yield(), delay(), or waiting inside
+// the network code), the next one that can go on runs, so a slow connect
+// in one task doesn't hold up the others. Tasks are never preempted: a
+// task that doesn't yield stalls everything, the WiFi stack included.
+
+typedef struct coop_task_ coop_task_t;
+
+// Start running fn(arg) with a stack of stack_size bytes, taken from the
+// heap together with the task. The task is released when fn returns, and
+// the pointer isn't valid anymore then. Returns NULL without memory.
+coop_task_t* coop_task_create(void (*fn)(void* arg), void* arg, size_t stack_size);
+
+// The task running the caller, NULL in loop() (and setup()).
+coop_task_t* coop_task_current();
+
+// Stack of task never used so far in bytes, of loop() for NULL.
+int coop_task_free_stack(coop_task_t* task);
+
+// Size of the stack of task in bytes, of loop() for NULL.
+int coop_task_stack_size(coop_task_t* task);
+
+#endif // COOP_TASK_H
@@ -0,0 +1,99 @@
+/*
+ CrashDump.h - crash record kept in a flash sector across resets
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CRASH_DUMP_H
+#define CRASH_DUMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// What the postmortem handler prints over the UART after an exception,
+// a panic or a watchdog reset, written to a flash sector instead of being
+// lost: read it after the reset and send it wherever crashes are
+// collected, tools/crash_decode.py turns it back into the usual dump with
+// the addresses looked up in the ELF of the sketch.
+//
+// The stack window starts where the handler's own frames end and takes at
+// most CRASH_DUMP_STACK_BYTES of the stack that was running.
+#ifndef CRASH_DUMP_STACK_BYTES
+#define CRASH_DUMP_STACK_BYTES 2048
+#endif
+
+#define CRASH_DUMP_MAGIC   0x48535243   // "CRSH"
+#define CRASH_DUMP_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // sizeof(crash_dump_t), the stack follows
+    uint32_t crc;               // CRC-32 of header and stack, with this field 0
+    uint32_t reason;            // rst_info.reason
+    uint32_t exccause;
+    uint32_t epc1;
+    uint32_t epc2;
+    uint32_t epc3;
+    uint32_t excvaddr;
+    uint32_t depc;
+    uint32_t panic_file;        // PROGMEM string addresses, read from the ELF
+    uint32_t panic_func;
+    uint32_t panic_what;
+    uint32_t panic_line;        // 0 unless it was a panic or assert
+    uint32_t flags;             // CRASH_DUMP_*
+    uint32_t sp;
+    uint32_t stack_start;       // address of the first word of the window
+    uint32_t stack_end;         // of the stack that was running
+    uint32_t stack_size;        // bytes of stack that follow
+    uint32_t cont_stack_free;   // bytes of the loop() stack never used
+    uint32_t heap_free;
+    uint32_t last_fail_alloc_addr;
+    uint32_t last_fail_alloc_size;
+    uint32_t time_us;           // system_get_time() since boot
+} crash_dump_t;
+
+#define CRASH_DUMP_CONT  0x01   // on the loop() stack, else the system one
+#define CRASH_DUMP_ABORT 0x02   // abort() was called
+
+// Save crashes to sector from now on (the flash sector number, as for
+// spi_flash_erase_sector(), 0 to stop). The sector is only written to
+// when it holds no record, so that a device resetting over and over
+// doesn't wear it out: clear it once the record was read.
+void crash_dump_begin(uint32_t sector);
+
+// Size of the record in the sector, header and stack, 0 if there is none.
+size_t crash_dump_size(void);
+
+// Copy up to size bytes of the record into buffer and return how many
+// were copied, 0 if there is no record.
+size_t crash_dump_read(void* buffer, size_t size);
+
+// Number of crashes after the saved one that could not be saved (up to 32).
+uint32_t crash_dump_missed(void);
+
+// Erase the sector, making room for the next crash.
+bool crash_dump_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRASH_DUMP_H
@@ -0,0 +1,282 @@
+/*
+ Deflater.cpp - streaming encoder for gzip and deflate data
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+#include "Deflater.h"
+
+// The input is kept in a buffer of two windows. Once it is full, the
+// first window is dropped and the second one moved down, so a match can
+// always reach DEFLATER_WINDOW bytes back. The hash of the 3 bytes at
+// each position points to the last position they were seen at; that
+// one candidate is all a match is looked for in.
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define HASH_BITS 9       // of the 512 entries in _head
+#define BUF_SIZE  (2 * DEFLATER_WINDOW)
+
+static_assert(MAX_MATCH < DEFLATER_WINDOW, "a match is looked ahead for within the second window");
+static_assert(BUF_SIZE < 65536, "the positions fit the hash table");
+
+static const uint16_t s_lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t s_lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t s_distBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t s_distExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// CRC-32 four bits at a time
+static const uint32_t s_crcTable[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+static inline uint32_t hash(const uint8_t* p)
+{
+    uint32_t v = ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void Deflater::begin(bool gzip)
+{
+    _gzip = gzip;
+    _failed = false;
+    _pos = 0;
+    _end = 0;
+    memset(_head, 0, sizeof(_head));
+    _bitBuf = 0;
+    _bitCount = 0;
+    _outLen = 0;
+    _inSize = 0;
+    _outSize = 0;
+    _crc = 0xffffffff;
+
+    if (_gzip) {
+        // deflate, no name, no time, fastest, unknown OS
+        static const uint8_t header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 4, 0xff };
+        for (size_t i = 0; i < sizeof(header); ++i) {
+            _byte(header[i]);
+        }
+    }
+    // a block with the fixed codes, not the last one
+    _bits(2, 3);
+}
+
+bool Deflater::write(const uint8_t* data, size_t size)
+{
+    if (_failed) {
+        return false;
+    }
+    _inSize += size;
+    while (size) {
+        size_t chunk = BUF_SIZE - _end;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(_buf + _end, data, chunk);
+        for (size_t i = 0; i < chunk; ++i) {
+            _crc ^= data[i];
+            _crc = (_crc >> 4) ^ s_crcTable[_crc & 15];
+            _crc = (_crc >> 4) ^ s_crcTable[_crc & 15];
+        }
+        _end += chunk;
+        data += chunk;
+        size -= chunk;
+
+        _encode(false);
+        if (_end == BUF_SIZE) {
+            // the lookahead left _pos in the second window
+            memmove(_buf, _buf + DEFLATER_WINDOW, DEFLATER_WINDOW);
+            _pos -= DEFLATER_WINDOW;
+            _end -= DEFLATER_WINDOW;
+            for (size_t i = 0; i < sizeof(_head) / sizeof(_head[0]); ++i) {
+                _head[i] = (_head[i] > DEFLATER_WINDOW) ? _head[i] - DEFLATER_WINDOW : 0;
+            }
+        }
+    }
+    return !_failed;
+}
+
+bool Deflater::flush()
+{
+    if (_failed) {
+        return false;
+    }
+    _encode(true);
+    _code(0, 7);            // end of block
+    _bits(0, 3);            // empty stored block
+    _align();
+    _byte(0x00);
+    _byte(0x00);
+    _byte(0xff);
+    _byte(0xff);
+    _bits(2, 3);            // the next fixed block
+    return _send();
+}
+
+bool Deflater::end()
+{
+    if (_failed) {
+        return false;
+    }
+    _encode(true);
+    _code(0, 7);            // end of block
+    _bits(3, 3);            // an empty last block
+    _code(0, 7);
+    _align();
+    if (_gzip) {
+        uint32_t crc = ~_crc;
+        uint32_t size = _inSize;
+        for (int i = 0; i < 4; ++i) {
+            _byte(crc >> (8 * i));
+        }
+        for (int i = 0; i < 4; ++i) {
+            _byte(size >> (8 * i));
+        }
+    }
+    bool ok = _send();
+    _failed = true;
+    return ok;
+}
+
+// Encodes the input up to the last MAX_MATCH bytes, which a match starting
+// before them could take in, or all of it.
+void Deflater::_encode(bool all)
+{
+    size_t keep = all ? 0 : MAX_MATCH;
+    while (_end - _pos > keep) {
+        size_t length = 0;
+        size_t distance = 0;
+        size_t left = _end - _pos;
+        if (left >= MIN_MATCH) {
+            uint32_t h = hash(_buf + _pos);
+            size_t last = _head[h];
+            _head[h] = _pos + 1;
+            if (last) {
+                const uint8_t* from = _buf + last - 1;
+                const uint8_t* at = _buf + _pos;
+                size_t limit = (left < MAX_MATCH) ? left : MAX_MATCH;
+                while (length < limit && from[length] == at[length]) {
+                    ++length;
+                }
+                distance = _pos + 1 - last;
+            }
+        }
+        if (length < MIN_MATCH || distance > DEFLATER_WINDOW) {
+            _literal(_buf[_pos]);
+            ++_pos;
+            continue;
+        }
+        _match(length, distance);
+        // the positions the match covers are candidates as well
+        for (size_t i = 1; i < length && _pos + i + MIN_MATCH <= _end; ++i) {
+            _head[hash(_buf + _pos + i)] = _pos + i + 1;
+        }
+        _pos += length;
+    }
+}
+
+void Deflater::_literal(uint8_t value)
+{
+    if (value < 144) {
+        _code(0x30 + value, 8);
+    } else {
+        _code(0x190 + value - 144, 9);
+    }
+}
+
+void Deflater::_match(size_t length, size_t distance)
+{
+    int symbol = 28;
+    while (s_lengthBase[symbol] > length) {
+        --symbol;
+    }
+    // 257 to 279 have 7 bit codes, 280 to 287 8 bit ones
+    if (symbol < 23) {
+        _code(symbol + 1, 7);
+    } else {
+        _code(0xc0 + symbol - 23, 8);
+    }
+    _bits(length - s_lengthBase[symbol], s_lengthExtra[symbol]);
+
+    symbol = 29;
+    while (s_distBase[symbol] > distance) {
+        --symbol;
+    }
+    _code(symbol, 5);
+    _bits(distance - s_distBase[symbol], s_distExtra[symbol]);
+}
+
+// Huffman codes go most significant bit first, the rest least first.
+void Deflater::_code(uint32_t code, int length)
+{
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; ++i) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    _bits(reversed, length);
+}
+
+void Deflater::_bits(uint32_t value, int count)
+{
+    _bitBuf |= value << _bitCount;
+    _bitCount += count;
+    while (_bitCount >= 8) {
+        _byte(_bitBuf);
+        _bitBuf >>= 8;
+        _bitCount -= 8;
+    }
+}
+
+void Deflater::_align()
+{
+    if (_bitCount) {
+        _bits(0, 8 - _bitCount);
+    }
+}
+
+// Only the whole bytes; _bits() keeps the rest.
+void Deflater::_byte(uint8_t value)
+{
+    _out[_outLen++] = value;
+    if (_outLen == sizeof(_out)) {
+        _send();
+    }
+}
+
+bool Deflater::_send()
+{
+    if (_outLen && !_failed) {
+        _failed = !output(_out, _outLen);
+        _outSize += _outLen;
+    }
+    _outLen = 0;
+    return !_failed;
+}
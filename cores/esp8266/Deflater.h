@@ -0,0 +1,99 @@
+/*
+ Deflater.h - streaming encoder for gzip and deflate data
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef DEFLATER_H
+#define DEFLATER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// how far back a match can reach; twice that is kept in RAM
+#define DEFLATER_WINDOW 1024
+// output collected before it is given to output()
+#define DEFLATER_OUTPUT 256
+
+/*
+ Encodes deflate data (RFC 1951), raw or in a gzip wrapper (RFC 1952),
+ as it arrives in pieces of any size. It is meant for what a sketch
+ makes up as it goes (HTML, JSON, logs), not for the best ratio: matches
+ are looked for in the last DEFLATER_WINDOW bytes only, with one try per
+ position, and the blocks use the fixed Huffman codes, so there is no
+ block to buffer and no table to build. That takes about 3.5 KB of RAM.
+
+ Output goes to output() in pieces of at most DEFLATER_OUTPUT bytes.
+*/
+class Deflater
+{
+public:
+    Deflater() { }
+    virtual ~Deflater() { }
+
+    // gzip: write a gzip header, and the CRC and size at the end
+    void begin(bool gzip = true);
+    // Encodes data, keeping the last bytes for matches to come.
+    // Returns false if output() failed, now or before.
+    bool write(const uint8_t* data, size_t size);
+    // Encodes all that was written and ends the output on a byte, with an
+    // empty stored block, so the other end can decode all of it already.
+    bool flush();
+    // There is no more data: ends the stream.
+    bool end();
+
+    size_t inputSize() const
+    {
+        return _inSize;
+    }
+    size_t outputSize() const
+    {
+        return _outSize;
+    }
+
+protected:
+    // the next size bytes of output
+    virtual bool output(const uint8_t* data, size_t size) = 0;
+
+    void _encode(bool all);
+    void _literal(uint8_t value);
+    void _match(size_t length, size_t distance);
+    void _code(uint32_t code, int length);
+    void _bits(uint32_t value, int count);
+    void _align();
+    void _byte(uint8_t value);
+    bool _send();
+
+    bool _gzip = true;
+    bool _failed = true;
+
+    uint8_t _buf[2 * DEFLATER_WINDOW];
+    size_t _pos = 0;
+    size_t _end = 0;
+    // position + 1 of the last 3 bytes with each hash, 0 for none
+    uint16_t _head[512];
+
+    uint32_t _bitBuf = 0;
+    int _bitCount = 0;
+    uint8_t _out[DEFLATER_OUTPUT];
+    size_t _outLen = 0;
+
+    size_t _inSize = 0;
+    size_t _outSize = 0;
+    uint32_t _crc = 0;
+};
+
+#endif //DEFLATER_H
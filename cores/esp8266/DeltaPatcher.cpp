@@ -0,0 +1,182 @@
+/*
+ DeltaPatcher.cpp - applies binary patches made by tools/delta_patch.py
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+#include "DeltaPatcher.h"
+
+static uint32_t readU32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+bool DeltaPatcher::isPatch(const uint8_t* data, size_t size)
+{
+    return size >= 4 && readU32(data) == DELTA_MAGIC;
+}
+
+void DeltaPatcher::begin()
+{
+    _state = S_HEADER;
+    _hdrLen = 0;
+    _oldSize = 0;
+    _newSize = 0;
+    _oldPos = 0;
+    _newPos = 0;
+    _addLeft = 0;
+    _extraLeft = 0;
+    _seek = 0;
+}
+
+bool DeltaPatcher::write(const uint8_t* data, size_t size)
+{
+    while (size && _state != S_ERROR) {
+        switch (_state) {
+        case S_HEADER:
+            if (!_fill(data, size, DELTA_HEADER_SIZE)) {
+                break;
+            }
+            _oldSize = readU32(_hdr + 4);
+            _newSize = readU32(_hdr + 8);
+            memcpy(_oldMD5, _hdr + 12, sizeof(_oldMD5));
+            if (readU32(_hdr) != DELTA_MAGIC || !header()) {
+                _state = S_ERROR;
+                break;
+            }
+            _state = _newSize ? S_RECORD : S_DONE;
+            break;
+
+        case S_RECORD:
+            if (_fill(data, size, DELTA_RECORD_SIZE) && !_record()) {
+                _state = S_ERROR;
+            }
+            break;
+
+        case S_ADD: {
+            size_t piece = (size < _addLeft) ? size : _addLeft;
+            if (!_add(data, piece)) {
+                _state = S_ERROR;
+                break;
+            }
+            data += piece;
+            size -= piece;
+            _addLeft -= piece;
+            if (_addLeft == 0) {
+                _state = _extraLeft ? S_EXTRA : S_RECORD;
+            }
+            break;
+        }
+
+        case S_EXTRA: {
+            size_t piece = (size < _extraLeft) ? size : _extraLeft;
+            if (!output(data, piece)) {
+                _state = S_ERROR;
+                break;
+            }
+            data += piece;
+            size -= piece;
+            _extraLeft -= piece;
+            _newPos += piece;
+            if (_extraLeft == 0) {
+                _state = S_RECORD;
+            }
+            break;
+        }
+
+        case S_DONE:
+            // anything after the end is ignored
+            size = 0;
+            break;
+
+        case S_ERROR:
+        default:
+            break;
+        }
+        if (_state == S_RECORD && _newPos == _newSize) {
+            _state = S_DONE;
+        }
+    }
+    return _state != S_ERROR;
+}
+
+bool DeltaPatcher::end()
+{
+    if (_state != S_DONE) {
+        _state = S_ERROR;
+        return false;
+    }
+    return true;
+}
+
+// Collects want bytes of a header in _hdr, true once they are all there.
+bool DeltaPatcher::_fill(const uint8_t*& data, size_t& size, size_t want)
+{
+    size_t piece = want - _hdrLen;
+    if (piece > size) {
+        piece = size;
+    }
+    memcpy(_hdr + _hdrLen, data, piece);
+    _hdrLen += piece;
+    data += piece;
+    size -= piece;
+    if (_hdrLen < want) {
+        return false;
+    }
+    _hdrLen = 0;
+    return true;
+}
+
+bool DeltaPatcher::_record()
+{
+    uint32_t add = readU32(_hdr);
+    uint32_t extra = readU32(_hdr + 4);
+    // the seek of the record before this one
+    int64_t oldPos = (int64_t) _oldPos + _seek;
+    _seek = (int32_t) readU32(_hdr + 8);
+    if (oldPos < 0 || oldPos + add > _oldSize ||
+            (uint64_t) _newPos + add + extra > _newSize) {
+        return false;
+    }
+    _oldPos = oldPos;
+    _addLeft = add;
+    _extraLeft = extra;
+    _state = add ? S_ADD : (extra ? S_EXTRA : S_RECORD);
+    return true;
+}
+
+bool DeltaPatcher::_add(const uint8_t* data, size_t size)
+{
+    uint8_t buf[64];
+    while (size) {
+        size_t piece = (size < sizeof(buf)) ? size : sizeof(buf);
+        if (!source(_oldPos, buf, piece)) {
+            return false;
+        }
+        for (size_t i = 0; i < piece; ++i) {
+            buf[i] += data[i];
+        }
+        if (!output(buf, piece)) {
+            return false;
+        }
+        _oldPos += piece;
+        _newPos += piece;
+        data += piece;
+        size -= piece;
+    }
+    return true;
+}
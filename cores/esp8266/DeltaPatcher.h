@@ -0,0 +1,120 @@
+/*
+ DeltaPatcher.h - applies binary patches made by tools/delta_patch.py
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef DELTAPATCHER_H
+#define DELTAPATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ A patch turns an old image into a new one, in the order bsdiff uses but
+ with everything in one stream, so it can be applied as it arrives.
+ Little endian:
+
+   header   magic "ESPD", u32 old size, u32 new size, MD5 of the old
+            image (16 bytes)
+   records  until the new image is complete, each one
+              u32 add length, u32 extra length, s32 seek
+              add length bytes, each added (mod 256) to the next byte of
+              the old image
+              extra length bytes, copied as they are
+            then seek is added to the position in the old image
+
+ The byte differences are mostly zero where code only moved, so the patch
+ compresses well; sent gzip compressed, the Updater undoes both.
+*/
+
+#define DELTA_MAGIC        0x44505345
+#define DELTA_HEADER_SIZE  28
+#define DELTA_RECORD_SIZE  12
+
+class DeltaPatcher
+{
+public:
+    DeltaPatcher() { }
+    virtual ~DeltaPatcher() { }
+
+    void begin();
+    // Applies what it can of data. Returns false on a bad patch, or if
+    // header(), source() or output() failed.
+    bool write(const uint8_t* data, size_t size);
+    // the patch is over: true if the new image is complete
+    bool end();
+
+    bool finished() const
+    {
+        return _state == S_DONE;
+    }
+    // valid once header() was called
+    uint32_t oldSize() const
+    {
+        return _oldSize;
+    }
+    uint32_t newSize() const
+    {
+        return _newSize;
+    }
+    const uint8_t* oldMD5() const
+    {
+        return _oldMD5;
+    }
+
+    static bool isPatch(const uint8_t* data, size_t size);
+
+protected:
+    // called with the header read, false if the patch isn't for this image
+    virtual bool header()
+    {
+        return true;
+    }
+    // size bytes of the old image from pos on
+    virtual bool source(size_t pos, uint8_t* dst, size_t size) = 0;
+    // the next size bytes of the new image
+    virtual bool output(const uint8_t* data, size_t size) = 0;
+
+    enum State {
+        S_HEADER,
+        S_RECORD,
+        S_ADD,
+        S_EXTRA,
+        S_DONE,
+        S_ERROR,
+    };
+
+    bool _fill(const uint8_t*& data, size_t& size, size_t want);
+    bool _add(const uint8_t* data, size_t size);
+    bool _record();
+
+    State _state = S_ERROR;
+    uint8_t _hdr[DELTA_HEADER_SIZE];
+    size_t _hdrLen = 0;
+
+    uint32_t _oldSize = 0;
+    uint32_t _newSize = 0;
+    uint8_t _oldMD5[16];
+
+    uint32_t _oldPos = 0;
+    uint32_t _newPos = 0;
+    uint32_t _addLeft = 0;
+    uint32_t _extraLeft = 0;
+    int32_t _seek = 0;
+};
+
+#endif //DELTAPATCHER_H
@@ -21,12 +21,17 @@
 #include "Arduino.h"
 #include "flash_utils.h"
 #include "eboot_command.h"
+#include "coredecls.h"
 #include <memory>
 #include "interrupts.h"
 #include "MD5Builder.h"
+#include "CoopTask.h"
+#include "RtcSnapshot.h"
+#include "Metrics.h"
 
 extern "C" {
 #include "user_interface.h"
+#include "umm_malloc/umm_malloc.h"
 
 extern struct rst_info resetInfo;
 }
@@ -81,6 +86,19 @@ unsigned long long operator"" _GB(unsigned long long x) {
 
 EspClass ESP;
 
+// what every report has
+namespace {
+uint32_t readHeapFree() { return ESP.getFreeHeap(); }
+uint32_t readHeapMaxBlock() { return ESP.getMaxFreeBlockSize(); }
+uint32_t readHeapFragmentation() { return ESP.getHeapFragmentation(); }
+uint32_t readUptime() { return millis(); }
+
+METRIC_GAUGE(s_uptime, "uptime_ms", readUptime);
+METRIC_GAUGE(s_heapFree, "heap.free", readHeapFree);
+METRIC_GAUGE(s_heapMaxBlock, "heap.max_block", readHeapMaxBlock);
+METRIC_GAUGE(s_heapFragmentation, "heap.fragmentation", readHeapFragmentation);
+}
+
 void EspClass::wdtEnable(uint32_t timeout_ms)
 {
     (void) timeout_ms;
@@ -109,6 +127,7 @@ extern "C" void esp_yield();
 
 void EspClass::deepSleep(uint64_t time_us, WakeMode mode)
 {
+    RtcSnapshotBase::commitAll();
     system_deep_sleep_set_option(static_cast<int>(mode));
     system_deep_sleep(time_us);
     esp_yield();
@@ -164,6 +183,115 @@ uint32_t EspClass::getFreeHeap(void)
     return system_get_free_heap_size();
 }
 
+uint32_t EspClass::getMaxFreeBlockSize(void)
+{
+    return umm_max_free_block_size();
+}
+
+uint8_t EspClass::getHeapFragmentation(void)
+{
+    return umm_fragmentation_metric();
+}
+
+uint32_t EspClass::getFreeBlockCount(void)
+{
+    return umm_free_block_count();
+}
+
+uint32_t EspClass::getFreeContStack(void)
+{
+    return coop_task_free_stack(coop_task_current());
+}
+
+uint32_t EspClass::getRecommendedLoopStack(void)
+{
+    uint32_t used = coop_task_stack_size(NULL) - coop_task_free_stack(NULL);
+    uint32_t margin = std::max<uint32_t>(used / 4, 512);
+    return (used + margin + 255) & ~255;
+}
+
+// kept by the loop task, in core_esp8266_main.cpp
+void loop_stats_enable(bool enable);
+void loop_stats_get(EspLoopStats& stats);
+void loop_stats_reset();
+void loop_stats_on_stall(uint32_t threshold_us, std::function<void(uint32_t)> fn);
+
+void EspClass::enableLoopStats(bool enable)
+{
+    loop_stats_enable(enable);
+}
+
+void EspClass::getLoopStats(EspLoopStats& stats)
+{
+    loop_stats_get(stats);
+}
+
+void EspClass::resetLoopStats(void)
+{
+    loop_stats_reset();
+}
+
+void EspClass::onLoopStall(uint32_t threshold_us, std::function<void(uint32_t)> fn)
+{
+    loop_stats_on_stall(threshold_us, std::move(fn));
+}
+
+void boot_times_get(EspBootTimes& times);
+size_t boot_ctors_get(EspBootCtor* ctors, size_t count);
+
+void EspClass::getBootTimes(EspBootTimes& times)
+{
+    boot_times_get(times);
+}
+
+size_t EspClass::getBootCtors(EspBootCtor* ctors, size_t count)
+{
+    return boot_ctors_get(ctors, count);
+}
+
+void EspClass::printBootTimes(Print& out)
+{
+    EspBootTimes t;
+    boot_times_get(t);
+    out.printf_P(PSTR("ROM, eboot, SDK start  %8u us\n"), t.rfPreInitUs);
+    out.printf_P(PSTR("RF init                %8u us\n"), t.userInitUs - t.rfPreInitUs);
+    out.printf_P(PSTR("SDK init               %8u us\n"), t.initDoneUs - t.userInitUs);
+    out.printf_P(PSTR("global constructors    %8u us\n"), t.setupUs - t.initDoneUs);
+    out.printf_P(PSTR("setup()                %8u us\n"), t.loopUs ? t.loopUs - t.setupUs : 0);
+    if (t.gotIpUs) {
+        out.printf_P(PSTR("reset to Wi-Fi got IP  %8u us\n"), t.gotIpUs);
+    } else {
+        out.println(F("Wi-Fi got no IP yet"));
+    }
+    EspBootCtor ctors[8];
+    size_t count = boot_ctors_get(ctors, 8);
+    for (size_t i = 0; i < count; ++i) {
+        out.printf_P(PSTR("  constructor 0x%08x %8u us\n"), ctors[i].ctor, ctors[i].us);
+    }
+}
+
+void EspClass::printHeapProfile(Print& out)
+{
+    HEAP_PROFILE_SITE site;
+    if (heap_profile_get(0, &site) == 0) {
+        out.println(F("heap profile not enabled, build with -DDEBUG_ESP_HEAP_PROFILE"));
+        return;
+    }
+    out.println(F("  live   peak  allocs  site"));
+    // new sites may show up while printing
+    for (int i = 0; i < heap_profile_get(i, &site); ++i) {
+        out.printf_P(PSTR("%6u %6u %7lu  "), site.live, site.peak, site.allocs);
+        if (i == 0) {
+            out.println(F("(other)"));
+        } else if (site.file) {
+            out.print(FPSTR(site.file));
+            out.printf_P(PSTR(":%d\n"), site.line);
+        } else {
+            out.printf_P(PSTR("caller 0x%08x\n"), (uint32_t) site.caller);
+        }
+    }
+}
+
 uint32_t EspClass::getChipId(void)
 {
     return system_get_chip_id();
@@ -202,6 +330,26 @@ uint8_t EspClass::getCpuFreqMHz(void)
     return system_get_cpu_freq();
 }
 
+bool EspClass::setCpuFrequencyMHz(uint8_t mhz)
+{
+    return cpu_freq_set(mhz);
+}
+
+void EspClass::setCpuFrequencyAuto(bool enable)
+{
+    cpu_freq_auto(enable);
+}
+
+EspCpuBoost::EspCpuBoost()
+{
+    cpu_freq_boost(true);
+}
+
+EspCpuBoost::~EspCpuBoost()
+{
+    cpu_freq_boost(false);
+}
+
 
 uint32_t EspClass::getFlashChipId(void)
 {
@@ -423,7 +571,8 @@ uint32_t EspClass::getSketchSize() {
         return result;
 
     image_header_t image_header;
-    uint32_t pos = APP_START_OFFSET;
+    uint32_t base = app_slot_address(app_slot_current());
+    uint32_t pos = base + APP_START_OFFSET;
     if (spi_flash_read(pos, (uint32_t*) &image_header, sizeof(image_header))) {
         return 0;
     }
@@ -445,7 +594,7 @@ uint32_t EspClass::getSketchSize() {
         DEBUG_SERIAL.printf("section=%u size=%u pos=%u\r\n", section_index, section_header.size, pos);
 #endif
     }
-    result = (pos + 16) & ~15;
+    result = (pos - base + 16) & ~15;
     return result;
 }
 
@@ -453,6 +602,10 @@ extern "C" uint32_t _SPIFFS_start;
 
 uint32_t EspClass::getFreeSketchSpace() {
 
+    if (app_slot_current() >= 0) {
+        // all of the other slot
+        return EBOOT_SLOT_SIZE;
+    }
     uint32_t usedSize = getSketchSize();
     // round one sector up
     uint32_t freeSpaceStart = (usedSize + FLASH_SECTOR_SIZE - 1) & (~(FLASH_SECTOR_SIZE - 1));
@@ -464,6 +617,22 @@ uint32_t EspClass::getFreeSketchSpace() {
     return freeSpaceEnd - freeSpaceStart;
 }
 
+int EspClass::getBootSlot() {
+    return app_slot_current();
+}
+
+bool EspClass::isBootTrial() {
+    return app_slot_is_trial();
+}
+
+bool EspClass::confirmBoot() {
+    return app_slot_confirm();
+}
+
+void EspClass::deferBootConfirm() {
+    app_slot_defer_confirm();
+}
+
 bool EspClass::updateSketch(Stream& in, uint32_t size, bool restartOnFail, bool restartOnSuccess) {
   if(!Update.begin(size)){
 #ifdef DEBUG_SERIAL
@@ -531,7 +700,7 @@ String EspClass::getSketchMD5()
     uint32_t lengthLeft = getSketchSize();
     const size_t bufSize = 512;
     std::unique_ptr<uint8_t[]> buf(new uint8_t[bufSize]);
-    uint32_t offset = 0;
+    uint32_t offset = app_slot_address(app_slot_current());
     if(!buf.get()) {
         return String();
     }
@@ -22,6 +22,10 @@
 #define ESP_H
 
 #include <Arduino.h>
+#include <functional>
+extern "C" {
+#include "cont.h"
+}
 
 /**
  * AVR macros for WDT managment
@@ -58,6 +62,17 @@ enum RFMode {
 #define RF_MODE(mode) int __get_rf_mode() { return mode; }
 #define RF_PRE_INIT() void __run_user_rf_pre_init()
 
+// RF calibration at boot, byte 114 of the PHY init data. The SDK keeps the
+// results of a full calibration in the RF calibration sector of the
+// flash, and the other modes start from them.
+enum RFCalMode {
+    RF_CAL_FROM_FLASH = 0,  // no calibration, all data from flash, RF init takes about 2ms
+    RF_CAL_TX_POWER = 1,    // only TX power calibrated (the default), about 20ms
+    RF_CAL_FULL = 3         // full calibration, about 200ms
+};
+
+#define RF_CAL_MODE(mode) int __get_rf_cal_mode() { return (int) (mode); }
+
 // compatibility definitions
 #define WakeMode RFMode
 #define WAKE_RF_DEFAULT  RF_DEFAULT
@@ -74,6 +89,21 @@ enum ADCMode {
 
 #define ADC_MODE(mode) int __get_adc_mode(void) { return (int) (mode); }
 
+// The stack of loop() and setup(), CONT_STACKSIZE (4096) bytes by default.
+// LOOP_STACK_SIZE(size) in the sketch makes it size bytes instead, and
+// LOOP_STACK_HEAP(size) takes it from the heap at boot, where size may be
+// worked out then. Either way what the stack doesn't take is left to the
+// heap; ESP.getRecommendedLoopStack() tells what the sketch needs.
+#define LOOP_STACK_SIZE(size) cont_t* __get_loop_cont(void) { \
+        static unsigned cont[CONT_SIZE(size) / 4] __attribute__ ((aligned (16))); \
+        cont_init_size((cont_t*) cont, (size)); \
+        return (cont_t*) cont; }
+#define LOOP_STACK_HEAP(size) cont_t* __get_loop_cont(void) { \
+        size_t stack_size = (size); \
+        cont_t* cont = (cont_t*) malloc(CONT_SIZE(stack_size)); \
+        if (cont) cont_init_size(cont, stack_size); \
+        return cont; }
+
 typedef enum {
      FM_QIO = 0x00,
      FM_QOUT = 0x01,
@@ -82,6 +112,55 @@ typedef enum {
      FM_UNKNOWN = 0xff
 } FlashMode_t;
 
+#define ESP_LOOP_STATS_BUCKETS 8
+
+// Timing of loop() and everything else run from the loop task, collected
+// after ESP.enableLoopStats()
+struct EspLoopStats {
+    uint32_t loops;
+    // loop() calls by duration: histogram[i] the ones under 2^i ms, the
+    // last one all from 2^(ESP_LOOP_STATS_BUCKETS - 2) ms on
+    uint32_t histogram[ESP_LOOP_STATS_BUCKETS];
+    uint32_t maxLoopUs;
+    // longest time the system had to wait for loop() or a task to yield
+    uint32_t maxYieldGapUs;
+    // time spent in scheduled functions, summed up and per pass
+    uint32_t scheduledUs;
+    uint32_t maxScheduledUs;
+    // yield gaps over the onLoopStall() threshold
+    uint32_t stalls;
+};
+
+// When the steps of the boot were reached, in us of system_get_time(),
+// which counts from reset
+struct EspBootTimes {
+    uint32_t rfPreInitUs;   // user_rf_pre_init(): after the ROM, eboot and the SDK start
+    uint32_t userInitUs;    // user_init(): after RF init
+    uint32_t initDoneUs;    // the SDK init done, global constructors start
+    uint32_t setupUs;       // global constructors done, setup() starts
+    uint32_t loopUs;        // setup() done
+    uint32_t gotIpUs;       // the station got its first IP address, 0 until then
+};
+
+// A global constructor and the time it took, recorded with
+// -DDEBUG_ESP_BOOT_CTORS. The function is the _GLOBAL__sub_I_ of a file,
+// xtensa-lx106-elf-addr2line -f -e sketch.elf tells which.
+struct EspBootCtor {
+    uint32_t ctor;      // address of the constructor function
+    uint32_t us;
+};
+
+// 160 MHz for as long as it exists, whatever ESP.setCpuFrequencyMHz() and
+// the automatic mode say, for bursts like a TLS handshake:
+//   { EspCpuBoost boost; client.connect(host, 443); }
+class EspCpuBoost {
+    public:
+        EspCpuBoost();
+        ~EspCpuBoost();
+        EspCpuBoost(const EspCpuBoost&) = delete;
+        EspCpuBoost& operator=(const EspCpuBoost&) = delete;
+};
+
 class EspClass {
     public:
         // TODO: figure out how to set WDT timeout
@@ -103,6 +182,31 @@ class EspClass {
 
         uint16_t getVcc();
         uint32_t getFreeHeap();
+        uint32_t getMaxFreeBlockSize();
+        uint8_t getHeapFragmentation(); // in %
+        uint32_t getFreeBlockCount();
+        // stack never used so far by loop(), or by the running CoopTask
+        uint32_t getFreeContStack();
+        // used at most so far by loop() plus a margin, rounded up to 256
+        // bytes, for LOOP_STACK_SIZE(); only as good as the code that ran
+        uint32_t getRecommendedLoopStack();
+
+        // starts collecting EspLoopStats from zero, or stops
+        void enableLoopStats(bool enable = true);
+        void getLoopStats(EspLoopStats& stats);
+        void resetLoopStats();
+        // fn(gapUs) is called from the system context, right after loop()
+        // or a task yielded having kept the system waiting longer than
+        // threshold_us; needs enableLoopStats()
+        void onLoopStall(uint32_t threshold_us, std::function<void(uint32_t)> fn);
+        void getBootTimes(EspBootTimes& times);
+        // the slowest global constructors, slowest first, up to count (at
+        // most 8 are kept); returns how many, 0 without -DDEBUG_ESP_BOOT_CTORS
+        size_t getBootCtors(EspBootCtor* ctors, size_t count);
+        // the time of each step of getBootTimes(), and the slowest constructors
+        void printBootTimes(Print& out);
+        // allocations by call site, with -DDEBUG_ESP_HEAP_PROFILE
+        void printHeapProfile(Print& out);
 
         uint32_t getChipId();
 
@@ -114,6 +218,12 @@ class EspClass {
         uint8_t getBootMode();
 
         uint8_t getCpuFreqMHz();
+        // 80 or 160, from the next loop() on if called from an interrupt;
+        // millis(), micros(), Serial, PWM, Servo and Wire keep their timing
+        bool setCpuFrequencyMHz(uint8_t mhz);
+        // 160 MHz while the loop task is busy for half of the time, back to
+        // 80 MHz under a fifth; off: the frequency of setCpuFrequencyMHz()
+        void setCpuFrequencyAuto(bool enable = true);
 
         uint32_t getFlashChipId();
         //gets the actual chip size based on the flash id
@@ -137,6 +247,15 @@ class EspClass {
         uint32_t getSketchSize();
         String getSketchMD5();
         uint32_t getFreeSketchSpace();
+        // with an A/B flash layout, the slot running (0 or 1), else -1
+        int getBootSlot();
+        // until it is confirmed, an update has EBOOT_SLOT_TRIES boots
+        // before eboot goes back to the sketch it replaced; that happens
+        // after the first loop(), or when the sketch says so after
+        // deferBootConfirm() in setup()
+        bool isBootTrial();
+        bool confirmBoot();
+        void deferBootConfirm();
         bool updateSketch(Stream& in, uint32_t size, bool restartOnFail = false, bool restartOnSuccess = true);
 
         String getResetReason();
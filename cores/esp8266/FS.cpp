@@ -121,6 +121,60 @@ const char* File::name() const {
     return _p->name();
 }
 
+bool File::mapIndex(void* buffer, size_t size) {
+    if (!_p)
+        return false;
+
+    return _p->mapIndex(buffer, size);
+}
+
+void File::unmapIndex() {
+    if (_p) {
+        _p->unmapIndex();
+    }
+}
+
+bool File::setBufferSize(size_t size) {
+    if (!_p)
+        return false;
+
+    return _p->setBufferSize(size);
+}
+
+bool File::hasPeekBufferAPI() const {
+    size_t size;
+    return _p && _p->peekBuffer(size);
+}
+
+const char* File::peekBuffer() {
+    size_t size;
+    if (!_p)
+        return nullptr;
+
+    return (const char*) _p->peekBuffer(size);
+}
+
+size_t File::peekAvailable() {
+    size_t size = 0;
+    if (_p)
+        _p->peekBuffer(size);
+    return size;
+}
+
+void File::peekConsume(size_t consume) {
+    if (_p)
+        _p->peekConsume(consume);
+}
+
+const uint8_t* File::mapped(size_t& size) {
+    if (!_p) {
+        size = 0;
+        return nullptr;
+    }
+
+    return _p->mapped(size);
+}
+
 File Dir::openFile(const char* mode) {
     if (!_impl) {
         return File();
@@ -160,8 +214,15 @@ bool Dir::next() {
     return _impl->next();
 }
 
+bool FS::_load() {
+    if (!_impl && _factory) {
+        _impl = _factory();
+    }
+    return (bool) _impl;
+}
+
 bool FS::begin() {
-    if (!_impl) {
+    if (!_load()) {
         return false;
     }
     return _impl->begin();
@@ -174,25 +235,52 @@ void FS::end() {
 }
 
 bool FS::format() {
-    if (!_impl) {
+    if (!_load()) {
         return false;
     }
     return _impl->format();
 }
 
 bool FS::info(FSInfo& info){
-    if (!_impl) {
+    if (!_load()) {
         return false;
     }
     return _impl->info(info);
 }
 
+bool FS::setConfig(const FSConfig& config) {
+    if (!_load()) {
+        return false;
+    }
+    return _impl->setConfig(config);
+}
+
+bool FS::stats(FSStats& stats) {
+    if (!_load()) {
+        return false;
+    }
+    return _impl->stats(stats);
+}
+
+void FS::resetStats() {
+    if (_impl) {
+        _impl->resetStats();
+    }
+}
+
+bool FS::gc(uint32_t budget_us) {
+    if (!_load()) {
+        return false;
+    }
+    return _impl->gc(budget_us);
+}
+
 File FS::open(const String& path, const char* mode) {
     return open(path.c_str(), mode);
 }
 
 File FS::open(const char* path, const char* mode) {
-    if (!_impl) {
+    if (!_load()) {
         return File();
     }
 
@@ -207,7 +295,7 @@ File FS::open(const char* path, const char* mode) {
 }
 
 bool FS::exists(const char* path) {
-    if (!_impl) {
+    if (!_load()) {
         return false;
     }
     return _impl->exists(path);
@@ -218,7 +306,7 @@ bool FS::exists(const String& path) {
 }
 
 Dir FS::openDir(const char* path) {
-    if (!_impl) {
+    if (!_load()) {
         return Dir();
     }
     return Dir(_impl->openDir(path));
@@ -229,7 +317,7 @@ Dir FS::openDir(const String& path) {
 }
 
 bool FS::remove(const char* path) {
-    if (!_impl) {
+    if (!_load()) {
         return false;
     }
     return _impl->remove(path);
@@ -240,7 +328,7 @@ bool FS::remove(const String& path) {
 }
 
 bool FS::rename(const char* pathFrom, const char* pathTo) {
-    if (!_impl) {
+    if (!_load()) {
         return false;
     }
     return _impl->rename(pathFrom, pathTo);
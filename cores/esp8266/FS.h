@@ -73,6 +73,41 @@ public:
     operator bool() const;
     const char* name() const;
 
+    // Keep where the pages of the file are in RAM, so that seeking and
+    // reading don't have to look them up in flash. Without a buffer, one
+    // for the whole file is taken from the heap (2 bytes per page of
+    // data); a given buffer maps as much of the start of the file as fits.
+    // The map is dropped by unmapIndex() or when the file is closed.
+    bool mapIndex(void* buffer = nullptr, size_t size = 0);
+    void unmapIndex();
+
+    // Where the data at the current position sits in the memory mapped
+    // flash, and in size how many bytes from there on are stored in one
+    // piece (up to the end of a SPIFFS page). The bytes are read like
+    // PROGMEM, with memcpy_P() or write_P(); seek() past them for the next
+    // piece. Returns nullptr if the data isn't mapped, which is the case
+    // beyond the first megabyte of flash. Writing to the file system may
+    // move the data, so don't keep the pointer across writes.
+    const uint8_t* mapped(size_t& size);
+
+    // Gather reads and writes in a buffer of size bytes taken from the
+    // heap, so that reading line by line or writing small records doesn't
+    // make a file system call each. Reads fetch a buffer full ahead,
+    // writes are held until it is full or on flush(), seek() or close().
+    // 0 (the default) turns it off.
+    bool setBufferSize(size_t size);
+
+    // at the end of the file, reads don't wait for more
+    bool inputCanTimeout() override {
+        return false;
+    }
+
+    // With a buffer, its bytes can be parsed in place (see Stream)
+    bool hasPeekBufferAPI() const override;
+    const char* peekBuffer() override;
+    size_t peekAvailable() override;
+    void peekConsume(size_t consume) override;
+
 protected:
     FileImplPtr _p;
 };
@@ -90,6 +125,22 @@ protected:
     DirImplPtr _impl;
 };
 
+// Set with FS::setConfig() before begin()
+struct FSConfig {
+    size_t cachePages = 0;      // pages of the read cache, 0 for one per open file
+    bool writeCache = true;     // keep writes in the cache until it is full or the file is closed
+    size_t gcFreeBlocks = 4;    // erased blocks gc() keeps ready, writes collect below 4
+    bool nameIndex = false;     // look names up in a hash table in RAM, 8 bytes per file
+};
+
+struct FSStats {
+    uint32_t cacheHits;         // reads served from the cache
+    uint32_t cacheMisses;       // reads that went to the flash
+    uint32_t cacheEvictions;    // pages dropped from the full cache
+    size_t cachePages;
+    size_t cacheBytes;          // RAM the cache takes
+};
+
 struct FSInfo {
     size_t totalBytes;
     size_t usedBytes;
@@ -99,16 +150,30 @@ struct FSInfo {
     size_t maxPathLength;
 };
 
+typedef FSImplPtr (*FSImplFactory)();
+
 class FS
 {
 public:
     FS(FSImplPtr impl) : _impl(impl) { }
+    // the implementation is made on first use, for a global that costs
+    // nothing at boot and no heap until the sketch needs it
+    FS(FSImplFactory factory) : _factory(factory) { }
 
     bool begin();
     void end();
     
     bool format();
     bool info(FSInfo& info);
+    bool setConfig(const FSConfig& config);
+    // since begin() or resetStats()
+    bool stats(FSStats& stats);
+    void resetStats();
+
+    // Collect garbage until gcFreeBlocks blocks are erased and ready, so that
+    // writes don't have to; starts no new step after budget_us. A step
+    // erases a block, which takes tens of ms. Returns true when done.
+    bool gc(uint32_t budget_us);
 
     File open(const char* path, const char* mode);
     File open(const String& path, const char* mode);
@@ -126,7 +191,10 @@ public:
     bool rename(const String& pathFrom, const String& pathTo);
 
 protected:
+    bool _load();
+
     FSImplPtr _impl;
+    FSImplFactory _factory = nullptr;
 };
 
 } // namespace fs
@@ -140,6 +208,8 @@ using fs::SeekSet;
 using fs::SeekCur;
 using fs::SeekEnd;
 using fs::FSInfo;
+using fs::FSConfig;
+using fs::FSStats;
 #endif //FS_NO_GLOBALS
 
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_SPIFFS)
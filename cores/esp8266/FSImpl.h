@@ -36,6 +36,14 @@ public:
     virtual size_t size() const = 0;
     virtual void close() = 0;
     virtual const char* name() const = 0;
+    virtual bool mapIndex(void* buffer, size_t size) { (void) buffer; (void) size; return false; }
+    virtual void unmapIndex() { }
+    virtual const uint8_t* mapped(size_t& size) { size = 0; return nullptr; }
+    virtual bool setBufferSize(size_t size) { (void) size; return false; }
+    // The read buffer of setBufferSize(), filled again once used up: size
+    // bytes from the current position. nullptr when there is no buffer.
+    virtual const uint8_t* peekBuffer(size_t& size) { size = 0; return nullptr; }
+    virtual void peekConsume(size_t size) { (void) size; }
 };
 
 enum OpenMode {
@@ -66,6 +74,10 @@ public:
     virtual void end() = 0;
     virtual bool format() = 0;
     virtual bool info(FSInfo& info) = 0;
+    virtual bool setConfig(const FSConfig& config) { (void) config; return false; }
+    virtual bool stats(FSStats& stats) { (void) stats; return false; }
+    virtual void resetStats() { }
+    virtual bool gc(uint32_t budget_us) { (void) budget_us; return false; }
     virtual FileImplPtr open(const char* path, OpenMode openMode, AccessMode accessMode) = 0;
     virtual bool exists(const char* path) = 0;
     virtual DirImplPtr openDir(const char* path) = 0;
@@ -0,0 +1,239 @@
+#include <Arduino.h>
+#include "FlashQueue.h"
+#include "Schedule.h"
+
+struct flash_job_slot_t
+{
+    flash_job_t id;         // 0 for a free slot
+    uint32_t seq;           // order of the jobs of a priority
+    bool erase;
+    uint8_t priority;
+    uint32_t addr;          // next sector, or next offset
+    const uint32_t* data;
+    size_t left;            // sectors, or bytes
+    flash_job_done_t done;
+    bool finished;          // done, the callback not called yet
+    bool ok;
+};
+
+static flash_job_slot_t sJobs[FLASH_QUEUE_JOBS];
+static flash_job_t sLastId = 0;
+static uint32_t sSeq = 0;
+static size_t sPending = 0;
+static size_t sFinished = 0;
+static int sSuspended = 0;
+static schedule_handle_t sRunner = 0;
+
+static void run_pass();
+
+// the runner is only scheduled while there is something for it; callbacks
+// are called from it, so after loop(), even when suspended
+static void arm_runner()
+{
+    if (!sRunner && ((sPending && !sSuspended) || sFinished)) {
+        sRunner = schedule_recurrent_function_us(0, run_pass, SCHEDULE_PRIORITY_LOW);
+    }
+}
+
+static void call_done()
+{
+    for (auto& job : sJobs) {
+        if (!job.id || !job.finished) {
+            continue;
+        }
+        // the slot is free before the callback, which may queue more
+        flash_job_done_t done = std::move(job.done);
+        bool ok = job.ok;
+        job.done = nullptr;
+        job.finished = false;
+        job.id = 0;
+        --sFinished;
+        done(ok);
+    }
+}
+
+static void run_pass()
+{
+    call_done();
+    if ((sSuspended || !flash_queue_step()) && !sFinished) {
+        schedule_cancel(sRunner);
+        sRunner = 0;
+    }
+}
+
+static flash_job_slot_t* next_job()
+{
+    flash_job_slot_t* next = nullptr;
+    for (auto& job : sJobs) {
+        if (job.id && !job.finished && (!next || job.priority < next->priority ||
+                       (job.priority == next->priority && (int32_t) (job.seq - next->seq) < 0))) {
+            next = &job;
+        }
+    }
+    return next;
+}
+
+static flash_job_t queue_job(bool erase, uint32_t addr, const uint32_t* data, size_t left,
+        flash_job_done_t& done, flash_job_priority_t priority)
+{
+    if (priority > FLASH_JOB_LOW) {
+        return 0;
+    }
+    for (auto& job : sJobs) {
+        if (job.id) {
+            continue;
+        }
+        if (++sLastId == 0) {
+            ++sLastId;
+        }
+        job.id = sLastId;
+        job.seq = sSeq++;
+        job.erase = erase;
+        job.priority = priority;
+        job.addr = addr;
+        job.data = data;
+        job.left = left;
+        job.done = std::move(done);
+        job.finished = false;
+        ++sPending;
+        arm_runner();
+        return job.id;
+    }
+    return 0;
+}
+
+flash_job_t flash_queue_erase(uint32_t sector, size_t count,
+        flash_job_done_t done, flash_job_priority_t priority)
+{
+    return queue_job(true, sector, nullptr, count, done, priority);
+}
+
+flash_job_t flash_queue_write(uint32_t offset, const uint32_t* data, size_t size,
+        flash_job_done_t done, flash_job_priority_t priority)
+{
+    if (offset & 3) {
+        return 0;
+    }
+    return queue_job(false, offset, data, size, done, priority);
+}
+
+// Runs a slice of the job at addr, returns false if it failed. left is 0
+// once the job is done.
+static bool run_slice(bool erase, uint32_t& addr, const uint32_t*& data, size_t& left)
+{
+    if (erase) {
+        bool ok = !left || ESP.flashEraseSector(addr);
+        addr += 1;
+        left -= left ? 1 : 0;
+        return ok;
+    }
+    size_t size = std::min(left, (size_t) FLASH_QUEUE_WRITE_SLICE);
+    bool ok = !size || ESP.flashWrite(addr, const_cast<uint32_t*>(data), size);
+    addr += size;
+    data += size / 4;
+    left -= size;
+    return ok;
+}
+
+// Runs a slice of a queued job. Returns true when the job is done, or
+// failed; its callback is left for the runner.
+static bool run_job_slice(flash_job_slot_t* job)
+{
+    bool ok = run_slice(job->erase, job->addr, job->data, job->left);
+    if (ok && job->left) {
+        return false;
+    }
+    --sPending;
+    job->ok = ok;
+    if (job->done) {
+        job->finished = true;
+        ++sFinished;
+        arm_runner();
+    }
+    else {
+        job->id = 0;
+    }
+    return true;
+}
+
+bool flash_queue_step()
+{
+    flash_job_slot_t* job = next_job();
+    if (!job) {
+        return false;
+    }
+    run_job_slice(job);
+    return true;
+}
+
+static flash_job_slot_t* find_job(flash_job_t job)
+{
+    for (auto& slot : sJobs) {
+        if (job && slot.id == job) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+bool flash_queue_wait(flash_job_t job)
+{
+    flash_job_slot_t* slot = find_job(job);
+    if (!slot) {
+        return false;
+    }
+    while (!slot->finished) {
+        if (run_job_slice(slot)) {
+            // without a callback the slot is free already
+            return slot->ok;
+        }
+        yield_budget(YIELD_OP_FLASH);
+    }
+    return slot->ok;
+}
+
+// The blocking calls of the core run their own job only: they come from
+// SPIFFS, EEPROM and the Updater, which mustn't see the sketch's callbacks
+// (or the jobs of others on the flash they use) in the middle of theirs.
+static bool run_now(bool erase, uint32_t addr, const uint32_t* data, size_t left)
+{
+    for (;;) {
+        if (!run_slice(erase, addr, data, left)) {
+            return false;
+        }
+        if (!left) {
+            return true;
+        }
+        yield_budget(YIELD_OP_FLASH);
+    }
+}
+
+bool flash_queue_erase_now(uint32_t sector, size_t count)
+{
+    return run_now(true, sector, nullptr, count);
+}
+
+bool flash_queue_write_now(uint32_t offset, const uint32_t* data, size_t size)
+{
+    if (offset & 3) {
+        return false;
+    }
+    return run_now(false, offset, data, size);
+}
+
+void flash_queue_suspend()
+{
+    ++sSuspended;
+}
+
+void flash_queue_resume()
+{
+    if (sSuspended && !--sSuspended) {
+        arm_runner();
+    }
+}
+
+size_t flash_queue_pending()
+{
+    return sPending;
+}
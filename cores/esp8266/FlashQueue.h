@@ -0,0 +1,74 @@
+#ifndef ESP_FLASH_QUEUE_H
+#define ESP_FLASH_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+// Erasing and writing the flash stops the code running from it until the
+// chip is done: 30 to 50 ms for a sector. The queue cuts these jobs into
+// slices, a sector erase or FLASH_QUEUE_WRITE_SLICE bytes written, and runs
+// one slice at a time, after loop() returns, so nothing else waits longer
+// than one slice. The jobs with a higher priority go first, also ahead of
+// a longer job that has already started; jobs of the same priority are run
+// in the order they were queued, so use the same one for the jobs on a
+// given area.
+//
+// SPIFFS, the Updater and EEPROM use flash_queue_erase_now() and
+// flash_queue_write_now(), which run their own job only (and none of the
+// callbacks), so that these never run in the middle of their flash work.
+
+#ifndef FLASH_QUEUE_JOBS
+#define FLASH_QUEUE_JOBS 8
+#endif
+
+#ifndef FLASH_QUEUE_WRITE_SLICE
+#define FLASH_QUEUE_WRITE_SLICE 1024
+#endif
+
+enum flash_job_priority_t
+{
+    FLASH_JOB_HIGH,
+    FLASH_JOB_NORMAL,
+    FLASH_JOB_LOW
+};
+typedef uint32_t flash_job_t;
+// called after loop() once the job is done, ok false if a slice failed
+// (the rest of the job is dropped)
+typedef std::function<void(bool ok)> flash_job_done_t;
+
+// Queue erasing count sectors from sector on (a number as for
+// ESP.flashEraseSector()), or writing size bytes of data at offset (a
+// multiple of 4). data must stay as it is until the job is done.
+// Returns the job, 0 if all FLASH_QUEUE_JOBS are taken.
+flash_job_t flash_queue_erase(uint32_t sector, size_t count,
+        flash_job_done_t done = nullptr, flash_job_priority_t priority = FLASH_JOB_NORMAL);
+flash_job_t flash_queue_write(uint32_t offset, const uint32_t* data, size_t size,
+        flash_job_done_t done = nullptr, flash_job_priority_t priority = FLASH_JOB_NORMAL);
+
+// Run the rest of job now, yielding between the slices when loop() can,
+// and return whether it went fine; false if it isn't queued. The other
+// jobs stay queued, and the callback of job is still called after loop().
+bool flash_queue_wait(flash_job_t job);
+
+// Erase or write right away, yielding between the slices: the blocking
+// ESP.flashEraseSector() and ESP.flashWrite() of those who share the flash
+// with the queue. The job takes no slot and doesn't wait for the queued
+// ones, which are not run meanwhile.
+bool flash_queue_erase_now(uint32_t sector, size_t count);
+bool flash_queue_write_now(uint32_t offset, const uint32_t* data, size_t size);
+
+// Run the next slice now, the callback of a job it ends is left for after
+// loop(). Returns false if there was none.
+bool flash_queue_step();
+
+// Hold the slices run after loop() (until as many resume() calls), e.g.
+// while something can't stand the flash being away for a moment. Waiting
+// for a job still runs the queue.
+void flash_queue_suspend();
+void flash_queue_resume();
+
+// jobs queued, the one being run included
+size_t flash_queue_pending();
+
+#endif //ESP_FLASH_QUEUE_H
@@ -6,19 +6,33 @@ typedef void (*voidFuncPtr)(void);
 
 // Helper functions for Functional interrupt routines
 extern "C" void ICACHE_RAM_ATTR __attachInterruptArg(uint8_t pin, voidFuncPtr userFunc, void*fp , int mode);
+extern "C" void ICACHE_RAM_ATTR __detachInterrupt(uint8_t pin);
 
 // Structure for communication
 struct ArgStructure {
 	std::function<void(void)> reqFunction;
 };
 
-void interruptFunctional(void* arg)
+// One slot per pin, in RAM: attaching again replaces the routine of the
+// pin instead of allocating a new one. A function pointer or a lambda
+// capturing up to two pointers is kept inside the std::function without
+// allocating; it should be ICACHE_RAM_ATTR itself.
+static ArgStructure interruptFunctionals[16];
+
+void ICACHE_RAM_ATTR interruptFunctional(void* arg)
 {
 	((ArgStructure*)arg)->reqFunction();
 }
 
 void attachInterrupt(uint8_t pin, std::function<void(void)> intRoutine, int mode)
 {
+	if (pin >= 16) {
+		return;
+	}
+	// the old routine must not run while it is replaced
+	__detachInterrupt(pin);
+	ArgStructure* slot = &interruptFunctionals[pin];
+	slot->reqFunction = std::move(intRoutine);
 	// use the local interrupt routine which takes the ArgStructure as argument
-	__attachInterruptArg (pin, (voidFuncPtr)interruptFunctional, new ArgStructure{intRoutine}, mode);
+	__attachInterruptArg (pin, (voidFuncPtr)interruptFunctional, slot, mode);
 }
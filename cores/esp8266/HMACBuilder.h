@@ -0,0 +1,91 @@
+/*
+  HMACBuilder.h - HMAC (RFC 2104) over MD5Builder, SHA256Builder and the like
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef __ESP8266_HMAC_BUILDER__
+#define __ESP8266_HMAC_BUILDER__
+
+#include <WString.h>
+#include <Stream.h>
+#include <MD5Builder.h>
+#include <SHA256Builder.h>
+
+// Builder is one of the hash builders, all of which take 64 byte blocks,
+// and hashSize the length of its digest. The message is added in pieces
+// like to the builder itself, after begin() with the key.
+template<typename Builder, size_t hashSize>
+class HMACBuilder {
+  private:
+    static const size_t blockSize = 64;
+    Builder _inner;
+    uint8_t _key[blockSize];
+    uint8_t _buf[hashSize];
+  public:
+    void begin(const uint8_t * key, size_t keyLen){
+        memset(_key, 0, sizeof(_key));
+        if(keyLen > blockSize) {
+            _inner.begin();
+            _inner.add(key, keyLen);
+            _inner.calculate();
+            _inner.getBytes(_key);
+        } else {
+            memcpy(_key, key, keyLen);
+        }
+        uint8_t pad[blockSize];
+        for(size_t i = 0; i < blockSize; i++) {
+            pad[i] = _key[i] ^ 0x36;
+        }
+        _inner.begin();
+        _inner.add(pad, blockSize);
+    }
+    void begin(const char * key){ begin((const uint8_t*)key, strlen(key)); }
+    void begin(const String& key){ begin((const uint8_t*)key.c_str(), key.length()); }
+    void add(const uint8_t * data, size_t len){ _inner.add(data, len); }
+    void add(const char * data){ add((const uint8_t*)data, strlen(data)); }
+    void add(const String& data){ add((const uint8_t*)data.c_str(), data.length()); }
+    bool addStream(Stream & stream, const size_t maxLen){ return _inner.addStream(stream, maxLen); }
+    void calculate(void){
+        _inner.calculate();
+        _inner.getBytes(_buf);
+        uint8_t pad[blockSize];
+        for(size_t i = 0; i < blockSize; i++) {
+            pad[i] = _key[i] ^ 0x5c;
+        }
+        memset(_key, 0, sizeof(_key));
+        _inner.begin();
+        _inner.add(pad, blockSize);
+        _inner.add(_buf, hashSize);
+        _inner.calculate();
+        _inner.getBytes(_buf);
+    }
+    void getBytes(uint8_t * output){ memcpy(output, _buf, hashSize); }
+    void getChars(char * output){
+        for(size_t i = 0; i < hashSize; i++) {
+            sprintf(output + (i * 2), "%02x", _buf[i]);
+        }
+    }
+    String toString(void){
+        char out[hashSize * 2 + 1];
+        getChars(out);
+        return String(out);
+    }
+};
+
+typedef HMACBuilder<MD5Builder, 16> HMACMD5Builder;
+typedef HMACBuilder<SHA256Builder, 32> HMACSHA256Builder;
+
+#endif
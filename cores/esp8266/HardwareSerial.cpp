@@ -30,17 +30,25 @@
 #include "Arduino.h"
 #include "HardwareSerial.h"
 #include "Esp.h"
+#include "Schedule.h"
 
 HardwareSerial::HardwareSerial(int uart_nr)
-    : _uart_nr(uart_nr), _rx_size(256)
+    : _uart_nr(uart_nr), _rx_size(256), _tx_size(0)
 {}
 
 void HardwareSerial::begin(unsigned long baud, SerialConfig config, SerialMode mode, uint8_t tx_pin)
 {
     end();
     _uart = uart_init(_uart_nr, baud, (int) config, (int) mode, tx_pin, _rx_size);
+    if(_tx_size) {
+        _tx_size = uart_resize_tx_buffer(_uart, _tx_size);
+    }
+    uart_set_rx_thresholds(_uart, _rx_fifo_full, _rx_timeout);
+    if(_on_receive) {
+        uart_set_rx_timeout_callback(_uart, _s_rx_timeout, this);
+    }
 #if defined(DEBUG_ESP_PORT) && !defined(NDEBUG)
-    if (this == &DEBUG_ESP_PORT)
+    if (static_cast<Print*>(this) == static_cast<Print*>(&DEBUG_ESP_PORT))
     {
         setDebugOutput(true);
         println();
@@ -68,6 +76,51 @@ size_t HardwareSerial::setRxBufferSize(size_t size){
     return _rx_size;
 }
 
+size_t HardwareSerial::setTxBufferSize(size_t size){
+    if(_uart) {
+        _tx_size = uart_resize_tx_buffer(_uart, size);
+    } else {
+        _tx_size = size;
+    }
+    return _tx_size;
+}
+
+void HardwareSerial::setRxFIFOFull(uint8_t count)
+{
+    _rx_fifo_full = count;
+    uart_set_rx_thresholds(_uart, _rx_fifo_full, _rx_timeout);
+}
+
+void HardwareSerial::setRxTimeout(uint8_t byteTimes)
+{
+    _rx_timeout = byteTimes;
+    uart_set_rx_thresholds(_uart, _rx_fifo_full, _rx_timeout);
+}
+
+void HardwareSerial::onReceive(std::function<void(void)> fn)
+{
+    _on_receive = fn;
+    uart_set_rx_timeout_callback(_uart, _on_receive ? _s_rx_timeout : NULL, this);
+}
+
+// from the uart interrupt, the call is left to the scheduler
+void ICACHE_RAM_ATTR HardwareSerial::_s_rx_timeout(void* arg)
+{
+    HardwareSerial* self = static_cast<HardwareSerial*>(arg);
+    if(!self->_receive_pending) {
+        self->_receive_pending = schedule_function_from_isr(_s_on_receive, self);
+    }
+}
+
+void HardwareSerial::_s_on_receive(void* arg)
+{
+    HardwareSerial* self = static_cast<HardwareSerial*>(arg);
+    self->_receive_pending = false;
+    if(self->_on_receive) {
+        self->_on_receive();
+    }
+}
+
 void HardwareSerial::setDebugOutput(bool en)
 {
     if(!_uart) {
@@ -91,11 +144,54 @@ int HardwareSerial::available(void)
 {
     int result = static_cast<int>(uart_rx_available(_uart));
     if (!result) {
-        optimistic_yield(10000);
+        yield_budget(YIELD_OP_SERIAL);
     }
     return result;
 }
 
+// the wait for the next byte timedRead() does
+bool HardwareSerial::waitForData()
+{
+    _startMillis = millis();
+    while(!uart_rx_available(_uart)) {
+        if(millis() - _startMillis >= _timeout) {
+            return false;
+        }
+        yield();
+    }
+    return true;
+}
+
+size_t HardwareSerial::readBytes(char* buffer, size_t size)
+{
+    size_t count = 0;
+    while(count < size) {
+        size_t got = uart_read(_uart, buffer + count, size - count);
+        if(!got && !waitForData()) {
+            break;
+        }
+        count += got;
+    }
+    return count;
+}
+
+size_t HardwareSerial::readBytesUntil(char terminator, char* buffer, size_t size)
+{
+    size_t count = 0;
+    while(count < size) {
+        bool terminated;
+        size_t got = uart_read_until(_uart, (uint8_t) terminator, buffer + count, size - count, &terminated);
+        count += got;
+        if(terminated) {
+            break;
+        }
+        if(!got && !waitForData()) {
+            break;
+        }
+    }
+    return count;
+}
+
 void HardwareSerial::flush()
 {
     if(!_uart || !uart_tx_enabled(_uart)) {
@@ -28,6 +28,7 @@
 #define HardwareSerial_h
 
 #include <inttypes.h>
+#include <functional>
 #include "Stream.h"
 #include "uart.h"
 
@@ -88,6 +89,23 @@ public:
     void end();
 
     size_t setRxBufferSize(size_t size);
+    // Bytes written are kept in a buffer of this size, taken from the heap,
+    // and sent from the uart interrupt, so write() only waits while it is
+    // full. 0, the default, writes to the hardware fifo of 128 bytes.
+    size_t setTxBufferSize(size_t size);
+
+    // The receive interrupt moves the bytes from the hardware fifo to the
+    // buffer once it holds count of them (1 to 127, default 100), fewer
+    // make for shorter delays and more interrupts...
+    void setRxFIFOFull(uint8_t count);
+    // ... or once nothing was received for byteTimes characters (1 to 127,
+    // default 2), e.g. 4 for the 3.5 character gap between Modbus frames.
+    void setRxTimeout(uint8_t byteTimes);
+    // fn is called from loop() when the receive timeout interrupt came,
+    // i.e. after a pause in the received data, like at the end of a frame.
+    // A frame that ends exactly when the fifo full interrupt had emptied
+    // the fifo is not seen this way.
+    void onReceive(std::function<void(void)> fn);
 
     void swap()
     {
@@ -128,6 +146,34 @@ public:
         // this may return -1, but that's okay
         return uart_read_char(_uart);
     }
+    // as Stream's, copying whatever was received in one go
+    size_t readBytes(char* buffer, size_t size) override;
+    size_t readBytes(uint8_t* buffer, size_t size) override
+    {
+        return readBytes((char*) buffer, size);
+    }
+    size_t readBytesUntil(char terminator, char* buffer, size_t size) override;
+    using Stream::readBytesUntil;
+    // the rx buffer, up to where it wraps
+    bool hasPeekBufferAPI() const override
+    {
+        return true;
+    }
+    const char* peekBuffer() override
+    {
+        size_t size;
+        return uart_peek_buffer(_uart, &size);
+    }
+    size_t peekAvailable() override
+    {
+        size_t size;
+        uart_peek_buffer(_uart, &size);
+        return size;
+    }
+    void peekConsume(size_t consume) override
+    {
+        uart_peek_consume(_uart, consume);
+    }
     int availableForWrite(void)
     {
         return static_cast<int>(uart_tx_free(_uart));
@@ -184,10 +230,30 @@ public:
         return uart_has_overrun(_uart);
     }
 
+    // Counters since begin() or resetStats(), e.g. to size the buffer with
+    // setRxBufferSize() from the high water mark.
+    void getStats(uart_stats_t& stats)
+    {
+        uart_get_stats(_uart, &stats);
+    }
+    void resetStats(void)
+    {
+        uart_reset_stats(_uart);
+    }
+
 protected:
+    bool waitForData();
+    static void _s_rx_timeout(void* arg);
+    static void _s_on_receive(void* arg);
+
     int _uart_nr;
     uart_t* _uart = nullptr;
     size_t _rx_size;
+    size_t _tx_size;
+    uint8_t _rx_fifo_full = 100;
+    uint8_t _rx_timeout = 2;
+    std::function<void(void)> _on_receive;
+    volatile bool _receive_pending = false;
 };
 
 extern HardwareSerial Serial;
@@ -0,0 +1,532 @@
+/*
+ Inflater.cpp - streaming decoder for gzip and deflate data
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+#include "Inflater.h"
+
+// The decoding follows zlib's contrib/puff: canonical Huffman codes are
+// decoded a bit at a time, which needs no lookup tables beyond the code
+// lengths. The state is saved between pieces of a block, so decoding only
+// goes ahead when the input holds enough for the next step:
+
+// a block header, with the code lengths of a dynamic block (at most about
+// 4500 bits)
+#define NEED_BLOCK  600
+// a length and distance code with their extra bits (48 bits)
+#define NEED_SYMBOL 8
+
+#define WINDOW_MASK (INFLATER_WINDOW - 1)
+#define FLUSH_SIZE  (INFLATER_WINDOW / 2)
+
+#define GZIP_FHCRC    0x02
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+
+static_assert((INFLATER_WINDOW & WINDOW_MASK) == 0, "the window is a power of two");
+static_assert(NEED_BLOCK < INFLATER_INPUT, "a block header fits the input buffer");
+
+static const uint16_t s_lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t s_lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t s_distBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t s_distExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t s_codeOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+// CRC-32 four bits at a time
+static const uint32_t s_crcTable[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+// Makes the canonical code for the lengths. Returns 0 for a complete
+// code, more than 0 for an incomplete one and less than 0 for one that is
+// over subscribed.
+static int buildCode(uint16_t* count, uint16_t* symbol, const uint8_t* length, int n)
+{
+    for (int len = 0; len < 16; ++len) {
+        count[len] = 0;
+    }
+    for (int sym = 0; sym < n; ++sym) {
+        ++count[length[sym]];
+    }
+    if (count[0] == n) {
+        return 0;
+    }
+    int left = 1;
+    for (int len = 1; len < 16; ++len) {
+        left <<= 1;
+        left -= count[len];
+        if (left < 0) {
+            return left;
+        }
+    }
+    uint16_t offs[16];
+    offs[1] = 0;
+    for (int len = 1; len < 15; ++len) {
+        offs[len + 1] = offs[len] + count[len];
+    }
+    for (int sym = 0; sym < n; ++sym) {
+        if (length[sym] != 0) {
+            symbol[offs[length[sym]]++] = sym;
+        }
+    }
+    return left;
+}
+
+void Inflater::begin(bool gzip)
+{
+    _gzip = gzip;
+    _state = gzip ? S_HEADER : S_BLOCK;
+    _last = false;
+    _short = false;
+    _final = false;
+    _inPos = 0;
+    _inEnd = 0;
+    _bitBuf = 0;
+    _bitCount = 0;
+    _outPos = 0;
+    _flushed = 0;
+    _crc = 0xffffffff;
+}
+
+bool Inflater::write(const uint8_t* data, size_t size)
+{
+    while (size && _state != S_ERROR) {
+        if (_inPos) {
+            memmove(_in, _in + _inPos, _inEnd - _inPos);
+            _inEnd -= _inPos;
+            _inPos = 0;
+        }
+        size_t piece = INFLATER_INPUT - _inEnd;
+        if (piece > size) {
+            piece = size;
+        }
+        memcpy(_in + _inEnd, data, piece);
+        _inEnd += piece;
+        data += piece;
+        size -= piece;
+        if (!_run()) {
+            _state = S_ERROR;
+        }
+    }
+    return _state != S_ERROR;
+}
+
+bool Inflater::end()
+{
+    if (_state == S_ERROR) {
+        return false;
+    }
+    _last = true;
+    if (!_run() || _state != S_DONE || !_flush()) {
+        _state = S_ERROR;
+        return false;
+    }
+    return true;
+}
+
+bool Inflater::_have(size_t bytes) const
+{
+    return _last || (_inEnd - _inPos) * 8 + _bitCount >= bytes * 8;
+}
+
+uint32_t Inflater::_bits(int count)
+{
+    while (_bitCount < count) {
+        if (_inPos == _inEnd) {
+            _short = true;
+            return 0;
+        }
+        _bitBuf |= (uint32_t) _in[_inPos++] << _bitCount;
+        _bitCount += 8;
+    }
+    uint32_t value = _bitBuf & ((1u << count) - 1);
+    _bitBuf >>= count;
+    _bitCount -= count;
+    return value;
+}
+
+int Inflater::_decode(const uint16_t* count, const uint16_t* symbol)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len < 16; ++len) {
+        code |= _bits(1);
+        int n = count[len];
+        if (code - n < first) {
+            return symbol[index + (code - first)];
+        }
+        index += n;
+        first += n;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// Steps through the stream as far as the input allows. Returns false on
+// bad or truncated data.
+bool Inflater::_run()
+{
+    for (;;) {
+        if (_short) {
+            return false;
+        }
+        switch (_state) {
+        case S_HEADER:
+            if (!_have(10)) {
+                return true;
+            }
+            if (_bits(8) != 0x1f || _bits(8) != 0x8b || _bits(8) != 8) {
+                return false;
+            }
+            _flags = _bits(8);
+            if (_flags & 0xe0) {
+                return false;
+            }
+            // modification time, extra flags, operating system
+            _bits(16);
+            _bits(16);
+            _bits(16);
+            _state = S_EXTRA_LENGTH;
+            break;
+
+        case S_EXTRA_LENGTH:
+            if (_flags & GZIP_FEXTRA) {
+                if (!_have(2)) {
+                    return true;
+                }
+                _skip = _bits(16);
+            } else {
+                _skip = 0;
+            }
+            _state = S_EXTRA;
+            break;
+
+        case S_EXTRA:
+            while (_skip && _have(1) && !_short) {
+                _bits(8);
+                --_skip;
+            }
+            if (_skip) {
+                if (_short) {
+                    return false;
+                }
+                return true;
+            }
+            _state = S_NAME;
+            break;
+
+        case S_NAME:
+        case S_COMMENT: {
+            uint8_t flag = (_state == S_NAME) ? GZIP_FNAME : GZIP_FCOMMENT;
+            State next = (_state == S_NAME) ? S_COMMENT : S_HEADER_CRC;
+            if (_flags & flag) {
+                bool ended = false;
+                while (!ended && _have(1) && !_short) {
+                    ended = _bits(8) == 0;
+                }
+                if (!ended) {
+                    if (_short) {
+                        return false;
+                    }
+                    return true;
+                }
+            }
+            _state = next;
+            break;
+        }
+
+        case S_HEADER_CRC:
+            if (_flags & GZIP_FHCRC) {
+                if (!_have(2)) {
+                    return true;
+                }
+                _bits(16);
+            }
+            _state = S_BLOCK;
+            break;
+
+        case S_BLOCK:
+            if (!_have(NEED_BLOCK)) {
+                return true;
+            }
+            if (!_block()) {
+                return false;
+            }
+            break;
+
+        case S_STORED:
+            while (_skip && _have(1)) {
+                uint8_t value = _bits(8);
+                if (_short || !_put(value)) {
+                    return false;
+                }
+                --_skip;
+            }
+            if (_skip) {
+                return true;
+            }
+            _state = _final ? S_TRAILER : S_BLOCK;
+            break;
+
+        case S_CODES:
+            if (!_codes()) {
+                return false;
+            }
+            if (_state == S_CODES) {
+                return true;
+            }
+            break;
+
+        case S_TRAILER:
+            if (!_gzip) {
+                _state = S_DONE;
+                break;
+            }
+            if (!_have(9)) {
+                return true;
+            }
+            {
+                _bits(_bitCount & 7);
+                uint32_t crc = _bits(16);
+                crc |= _bits(16) << 16;
+                uint32_t size = _bits(16);
+                size |= _bits(16) << 16;
+                if (_short || crc != ~_crc || size != (uint32_t) _outPos) {
+                    return false;
+                }
+            }
+            _state = S_DONE;
+            break;
+
+        case S_DONE:
+            // anything after the end is ignored
+            _inPos = _inEnd;
+            _bitCount = 0;
+            return true;
+
+        case S_ERROR:
+        default:
+            return false;
+        }
+    }
+}
+
+bool Inflater::_block()
+{
+    _final = _bits(1);
+    uint32_t type = _bits(2);
+    if (type == 0) {
+        _bits(_bitCount & 7);
+        uint32_t length = _bits(16);
+        uint32_t check = _bits(16);
+        if (_short || length != (~check & 0xffff)) {
+            return false;
+        }
+        _skip = length;
+        _state = S_STORED;
+        return true;
+    }
+    if (type == 1) {
+        uint8_t lengths[288 + 30];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        memset(lengths + 288, 5, 30);
+        buildCode(_lenCount, _lenSymbol, lengths, 288);
+        buildCode(_distCount, _distSymbol, lengths + 288, 30);
+        _state = S_CODES;
+        return true;
+    }
+    if (type == 2 && _dynamic()) {
+        _state = S_CODES;
+        return true;
+    }
+    return false;
+}
+
+bool Inflater::_dynamic()
+{
+    int nlen = _bits(5) + 257;
+    int ndist = _bits(5) + 1;
+    int ncode = _bits(4) + 4;
+    if (nlen > 286 || ndist > 30) {
+        return false;
+    }
+    uint8_t lengths[288 + 30];
+    int index;
+    for (index = 0; index < ncode; ++index) {
+        lengths[s_codeOrder[index]] = _bits(3);
+    }
+    for (; index < 19; ++index) {
+        lengths[s_codeOrder[index]] = 0;
+    }
+    // the code for the code lengths, kept in the literal/length tables
+    if (buildCode(_lenCount, _lenSymbol, lengths, 19) != 0) {
+        return false;
+    }
+    index = 0;
+    while (index < nlen + ndist) {
+        int symbol = _decode(_lenCount, _lenSymbol);
+        if (symbol < 0 || _short) {
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[index++] = symbol;
+            continue;
+        }
+        uint8_t length = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) {
+                return false;
+            }
+            length = lengths[index - 1];
+            repeat = 3 + _bits(2);
+        } else if (symbol == 17) {
+            repeat = 3 + _bits(3);
+        } else {
+            repeat = 11 + _bits(7);
+        }
+        if (index + repeat > nlen + ndist) {
+            return false;
+        }
+        while (repeat--) {
+            lengths[index++] = length;
+        }
+    }
+    if (lengths[256] == 0) {
+        return false;
+    }
+    // an incomplete code is only allowed if it has a single length
+    int err = buildCode(_lenCount, _lenSymbol, lengths, nlen);
+    if (err < 0 || (err > 0 && nlen - _lenCount[0] != 1)) {
+        return false;
+    }
+    err = buildCode(_distCount, _distSymbol, lengths + nlen, ndist);
+    if (err < 0 || (err > 0 && ndist - _distCount[0] != 1)) {
+        return false;
+    }
+    return !_short;
+}
+
+bool Inflater::_codes()
+{
+    while (_have(NEED_SYMBOL)) {
+        int symbol = _decode(_lenCount, _lenSymbol);
+        if (symbol < 0 || _short) {
+            return false;
+        }
+        if (symbol < 256) {
+            if (!_put(symbol)) {
+                return false;
+            }
+            continue;
+        }
+        if (symbol == 256) {
+            _state = _final ? S_TRAILER : S_BLOCK;
+            return true;
+        }
+        symbol -= 257;
+        if (symbol >= 29) {
+            return false;
+        }
+        size_t length = s_lengthBase[symbol] + _bits(s_lengthExtra[symbol]);
+        symbol = _decode(_distCount, _distSymbol);
+        if (symbol < 0 || symbol >= 30) {
+            return false;
+        }
+        size_t distance = s_distBase[symbol] + _bits(s_distExtra[symbol]);
+        if (_short || distance > _outPos || !_copy(length, distance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Inflater::_put(uint8_t value)
+{
+    _window[_outPos & WINDOW_MASK] = value;
+    ++_outPos;
+    _crc ^= value;
+    _crc = (_crc >> 4) ^ s_crcTable[_crc & 15];
+    _crc = (_crc >> 4) ^ s_crcTable[_crc & 15];
+    if ((_outPos & (FLUSH_SIZE - 1)) == 0) {
+        return _flush();
+    }
+    return true;
+}
+
+bool Inflater::_copy(size_t length, size_t distance)
+{
+    if (distance <= INFLATER_WINDOW) {
+        // byte by byte, the match may overlap what it produces
+        while (length--) {
+            if (!_put(_window[(_outPos - distance) & WINDOW_MASK])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // further back than the window: given to output() already, and too far
+    // back to overlap
+    uint8_t buf[64];
+    while (length) {
+        size_t piece = (length < sizeof(buf)) ? length : sizeof(buf);
+        if (!history(_outPos - distance, buf, piece)) {
+            return false;
+        }
+        for (size_t i = 0; i < piece; ++i) {
+            if (!_put(buf[i])) {
+                return false;
+            }
+        }
+        length -= piece;
+    }
+    return true;
+}
+
+bool Inflater::_flush()
+{
+    // flushed at every half window, so this never wraps around
+    size_t size = _outPos - _flushed;
+    if (size == 0) {
+        return true;
+    }
+    const uint8_t* data = _window + (_flushed & WINDOW_MASK);
+    _flushed = _outPos;
+    return output(data, size);
+}
@@ -0,0 +1,121 @@
+/*
+ Inflater.h - streaming decoder for gzip and deflate data
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef INFLATER_H
+#define INFLATER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// output kept in RAM for matches to copy from, a power of two
+#define INFLATER_WINDOW 2048
+// input kept until there is enough of it to decode the next piece
+#define INFLATER_INPUT  1024
+
+/*
+ Decodes deflate data (RFC 1951), raw or in a gzip wrapper (RFC 1952),
+ as it arrives in pieces of any size. Only the last INFLATER_WINDOW bytes
+ of output are kept; a match reaching further back than that, up to the
+ 32 KB deflate allows, is read back with history(), so whoever takes the
+ output has to be able to read it again (from flash, say).
+
+ Output goes to output() in pieces of at most INFLATER_WINDOW / 2 bytes.
+*/
+class Inflater
+{
+public:
+    Inflater() { }
+    virtual ~Inflater() { }
+
+    // gzip: expect a gzip header and check the CRC and size at the end
+    void begin(bool gzip = true);
+    // Decodes what it can of data, keeping the rest for the next call.
+    // Returns false on bad data or if output() or history() failed.
+    bool write(const uint8_t* data, size_t size);
+    // There is no more data: decodes what is left and checks that the
+    // stream ended where it should.
+    bool end();
+
+    bool finished() const
+    {
+        return _state == S_DONE;
+    }
+    size_t outputSize() const
+    {
+        return _outPos;
+    }
+
+protected:
+    // the next size bytes of output
+    virtual bool output(const uint8_t* data, size_t size) = 0;
+    // size bytes of the output from pos on, all given to output() before
+    virtual bool history(size_t pos, uint8_t* dst, size_t size) = 0;
+
+    enum State {
+        S_HEADER,
+        S_EXTRA_LENGTH,
+        S_EXTRA,
+        S_NAME,
+        S_COMMENT,
+        S_HEADER_CRC,
+        S_BLOCK,
+        S_STORED,
+        S_CODES,
+        S_TRAILER,
+        S_DONE,
+        S_ERROR,
+    };
+
+    bool _run();
+    bool _have(size_t bytes) const;
+    uint32_t _bits(int count);
+    int _decode(const uint16_t* count, const uint16_t* symbol);
+    bool _block();
+    bool _dynamic();
+    bool _codes();
+    bool _put(uint8_t value);
+    bool _copy(size_t length, size_t distance);
+    bool _flush();
+
+    State _state = S_ERROR;
+    bool _gzip = true;
+    bool _last = false;
+    bool _short = false;
+    bool _final = false;
+    uint8_t _flags = 0;
+    size_t _skip = 0;
+
+    uint8_t _in[INFLATER_INPUT];
+    size_t _inPos = 0;
+    size_t _inEnd = 0;
+    uint32_t _bitBuf = 0;
+    int _bitCount = 0;
+
+    uint16_t _lenCount[16];
+    uint16_t _lenSymbol[288];
+    uint16_t _distCount[16];
+    uint16_t _distSymbol[30];
+
+    uint8_t _window[INFLATER_WINDOW];
+    size_t _outPos = 0;
+    size_t _flushed = 0;
+    uint32_t _crc = 0;
+};
+
+#endif //INFLATER_H
@@ -0,0 +1,292 @@
+/*
+  JsonReader.cpp - JSON read token by token from a Stream
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include <Arduino.h>
+#include <JsonReader.h>
+
+JsonReader::JsonReader(Stream & in, char * buffer, size_t size)
+    : _in(in), _text(buffer), _size(size), _textLen(0), _truncated(false),
+      _rxPos(0), _rxLen(0), _position(0), _token(NULL_VALUE), _arrays(0), _depth(0),
+      _afterOpen(false), _afterKey(false), _afterValue(false) {
+    if(_size) {
+        _text[0] = 0;
+    }
+}
+
+// what is there, in pieces of up to 64 bytes, or one byte within the timeout
+int JsonReader::_get(){
+    if(_rxPos == _rxLen) {
+        int available = _in.available();
+        size_t len = available > 0 ? (size_t) available : 1;
+        if(len > sizeof(_rx)) {
+            len = sizeof(_rx);
+        }
+        _rxLen = _in.readBytes(_rx, len);
+        _rxPos = 0;
+        if(_rxLen == 0) {
+            return -1;
+        }
+    }
+    _position++;
+    return (uint8_t) _rx[_rxPos++];
+}
+
+// only right after a _get() that gave a character
+void JsonReader::_unget(){
+    _rxPos--;
+    _position--;
+}
+
+int JsonReader::_getNonSpace(){
+    int c;
+    do {
+        c = _get();
+    } while(c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    return c;
+}
+
+JsonReader::Token JsonReader::_fail(){
+    return _token = ERROR;
+}
+
+void JsonReader::_append(char c){
+    if(_textLen + 1 < _size) {
+        _text[_textLen++] = c;
+        _text[_textLen] = 0;
+    } else {
+        _truncated = true;
+    }
+}
+
+void JsonReader::_appendUtf8(uint32_t cp){
+    if(cp < 0x80) {
+        _append(cp);
+    } else if(cp < 0x800) {
+        _append(0xc0 | (cp >> 6));
+        _append(0x80 | (cp & 0x3f));
+    } else if(cp < 0x10000) {
+        _append(0xe0 | (cp >> 12));
+        _append(0x80 | ((cp >> 6) & 0x3f));
+        _append(0x80 | (cp & 0x3f));
+    } else {
+        _append(0xf0 | (cp >> 18));
+        _append(0x80 | ((cp >> 12) & 0x3f));
+        _append(0x80 | ((cp >> 6) & 0x3f));
+        _append(0x80 | (cp & 0x3f));
+    }
+}
+
+static int hexDigit(int c){
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// after the opening quote
+bool JsonReader::_readString(){
+    uint32_t high = 0;  // surrogate waiting for the low half
+    while(true) {
+        int c = _get();
+        if(c < 0x20) {
+            return false;
+        }
+        if(c == '"') {
+            break;
+        }
+        if(c != '\\') {
+            _append(c);
+            continue;
+        }
+        c = _get();
+        uint32_t cp = 0;
+        switch(c) {
+            case '"': case '\\': case '/': _append(c); continue;
+            case 'b': _append('\b'); continue;
+            case 'f': _append('\f'); continue;
+            case 'n': _append('\n'); continue;
+            case 'r': _append('\r'); continue;
+            case 't': _append('\t'); continue;
+            case 'u':
+                for(int i = 0; i < 4; i++) {
+                    int d = hexDigit(_get());
+                    if(d < 0) {
+                        return false;
+                    }
+                    cp = (cp << 4) | d;
+                }
+                break;
+            default:
+                return false;
+        }
+        if(cp >= 0xd800 && cp < 0xdc00) {
+            high = cp;
+            continue;
+        }
+        if(cp >= 0xdc00 && cp < 0xe000 && high) {
+            cp = 0x10000 + ((high - 0xd800) << 10) + (cp - 0xdc00);
+        }
+        high = 0;
+        _appendUtf8(cp);
+    }
+    return true;
+}
+
+bool JsonReader::_readNumber(int c){
+    while((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+        _append(c);
+        c = _get();
+    }
+    if(c >= 0) {
+        _unget();
+    }
+    char last = _text[_textLen ? _textLen - 1 : 0];
+    return _textLen && last >= '0' && last <= '9';
+}
+
+bool JsonReader::_readLiteral(const char * rest){
+    for(; *rest; rest++) {
+        if(_get() != *rest) {
+            return false;
+        }
+    }
+    return true;
+}
+
+JsonReader::Token JsonReader::next(){
+    if(_token == ERROR || _token == END) {
+        return _token;
+    }
+    if(_depth == 0 && _afterValue) {
+        return _token = END;
+    }
+    _textLen = 0;
+    _truncated = false;
+    if(_size) {
+        _text[0] = 0;
+    }
+
+    int c = _getNonSpace();
+    if(c < 0) {
+        return _fail();
+    }
+    bool inArray = _depth && (_arrays & (1UL << (_depth - 1)));
+    char close = inArray ? ']' : '}';
+
+    if(_afterValue || _afterOpen) {
+        if(c == close && !_afterKey) {
+            _depth--;
+            _afterOpen = false;
+            _afterValue = true;
+            return _token = inArray ? END_ARRAY : END_OBJECT;
+        }
+        if(_afterValue) {
+            if(c != ',') {
+                return _fail();
+            }
+            c = _getNonSpace();
+        }
+        _afterOpen = false;
+        _afterValue = false;
+    }
+
+    if(_depth && !inArray && !_afterKey) {
+        if(c != '"' || !_readString()) {
+            return _fail();
+        }
+        if(_getNonSpace() != ':') {
+            return _fail();
+        }
+        _afterKey = true;
+        return _token = KEY;
+    }
+    _afterKey = false;
+
+    Token token;
+    switch(c) {
+        case '{':
+        case '[':
+            if(_depth == 32) {
+                return _fail();
+            }
+            if(c == '[') {
+                _arrays |= 1UL << _depth;
+            } else {
+                _arrays &= ~(1UL << _depth);
+            }
+            _depth++;
+            _afterOpen = true;
+            return _token = (c == '[') ? BEGIN_ARRAY : BEGIN_OBJECT;
+        case '"':
+            if(!_readString()) {
+                return _fail();
+            }
+            token = STRING;
+            break;
+        case 't':
+            if(!_readLiteral("rue")) {
+                return _fail();
+            }
+            token = TRUE_VALUE;
+            break;
+        case 'f':
+            if(!_readLiteral("alse")) {
+                return _fail();
+            }
+            token = FALSE_VALUE;
+            break;
+        case 'n':
+            if(!_readLiteral("ull")) {
+                return _fail();
+            }
+            token = NULL_VALUE;
+            break;
+        default:
+            if(c != '-' && (c < '0' || c > '9')) {
+                return _fail();
+            }
+            if(!_readNumber(c)) {
+                return _fail();
+            }
+            token = NUMBER;
+    }
+    _afterValue = true;
+    return _token = token;
+}
+
+bool JsonReader::skip(){
+    Token token = next();
+    if(token == BEGIN_OBJECT || token == BEGIN_ARRAY) {
+        uint8_t depth = _depth;
+        while(_depth >= depth) {
+            token = next();
+            if(token == ERROR || token == END) {
+                return false;
+            }
+        }
+    }
+    return token != ERROR && token != END;
+}
+
+long JsonReader::toInt() const {
+    return strtol(_text, nullptr, 10);
+}
+
+double JsonReader::toFloat() const {
+    return strtod(_text, nullptr);
+}
@@ -0,0 +1,107 @@
+/*
+  JsonReader.h - JSON read token by token from a Stream
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef __ESP8266_JSON_READER__
+#define __ESP8266_JSON_READER__
+
+#include <Stream.h>
+
+// Parses a JSON document as it is read from in, one token per next(), so
+// that a document of any size takes no more RAM than the reader and the
+// buffer given for the text of keys, strings and numbers; longer ones are
+// cut to fit and truncated() tells. Members nobody wants are passed over
+// with skip():
+//
+//   char text[64];
+//   JsonReader json(file, text, sizeof(text));
+//   if (json.next() == JsonReader::BEGIN_OBJECT) {
+//     while (json.next() == JsonReader::KEY) {
+//       if (!strcmp(text, "ssid") && json.next() == JsonReader::STRING)
+//         ssid = text;
+//       else
+//         json.skip();
+//     }
+//   }
+//
+// Reading goes through the timeout of in, and up to 64 bytes beyond the end
+// of the document may be read from it. Nesting goes 32 levels deep.
+class JsonReader {
+  public:
+    enum Token {
+        END,            // the document is complete
+        ERROR,          // it isn't JSON, or in ended before it was complete
+        BEGIN_OBJECT,
+        END_OBJECT,
+        BEGIN_ARRAY,
+        END_ARRAY,
+        KEY,            // the name of a member, in text()
+        STRING,         // in text(), with the escapes resolved
+        NUMBER,         // in text() as it was written
+        TRUE_VALUE,
+        FALSE_VALUE,
+        NULL_VALUE
+    };
+
+    JsonReader(Stream & in, char * buffer, size_t size);
+
+    Token next();
+    Token token() const { return _token; }
+    // the value that follows, with all that is in it if it is an object or
+    // array; false if that ended the document or was an error
+    bool skip();
+
+    const char * text() const { return _text; }
+    bool truncated() const { return _truncated; }
+    long toInt() const;
+    double toFloat() const;
+    // levels of objects and arrays the reader is in
+    uint8_t depth() const { return _depth; }
+    // characters read, e.g. for where an error is
+    size_t position() const { return _position; }
+
+  private:
+    int _get();
+    void _unget();
+    int _getNonSpace();
+    Token _fail();
+    bool _readString();
+    bool _readNumber(int c);
+    bool _readLiteral(const char * rest);
+    void _append(char c);
+    void _appendUtf8(uint32_t cp);
+
+    Stream & _in;
+    char * _text;
+    size_t _size;
+    size_t _textLen;
+    bool _truncated;
+
+    char _rx[64];
+    uint8_t _rxPos;
+    uint8_t _rxLen;
+    size_t _position;
+
+    Token _token;
+    uint32_t _arrays;   // bit per level, set for an array
+    uint8_t _depth;
+    bool _afterOpen;    // nothing yet in the object or array just begun
+    bool _afterKey;
+    bool _afterValue;   // a member is complete, a ',' or the end comes next
+};
+
+#endif
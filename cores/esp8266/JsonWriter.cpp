@@ -0,0 +1,236 @@
+/*
+  JsonWriter.cpp - JSON written piece by piece to a Print
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include <Arduino.h>
+#include <JsonWriter.h>
+#include <math.h>
+
+JsonWriter::JsonWriter(Print & out)
+    : _out(out), _arrays(0), _items(0), _depth(0), _afterKey(false), _ok(true) {
+}
+
+void JsonWriter::_write(const char * s, size_t len){
+    if(len && _out.write((const uint8_t *) s, len) != len) {
+        _ok = false;
+    }
+}
+
+// the comma before all but the first member, checking there is a key for
+// a value in an object
+bool JsonWriter::_beforeValue(){
+    if(!_ok) {
+        return false;
+    }
+    if(_afterKey) {
+        _afterKey = false;
+        return true;
+    }
+    if(_depth == 0) {
+        return true;
+    }
+    uint32_t bit = 1UL << (_depth - 1);
+    if(!(_arrays & bit)) {
+        _ok = false;
+        return false;
+    }
+    if(_items & bit) {
+        _write(",", 1);
+    }
+    _items |= bit;
+    return true;
+}
+
+bool JsonWriter::_open(bool array){
+    if(!_beforeValue()) {
+        return false;
+    }
+    if(_depth == 32) {
+        _ok = false;
+        return false;
+    }
+    uint32_t bit = 1UL << _depth;
+    _depth++;
+    if(array) {
+        _arrays |= bit;
+    } else {
+        _arrays &= ~bit;
+    }
+    _items &= ~bit;
+    _write(array ? "[" : "{", 1);
+    return true;
+}
+
+bool JsonWriter::_close(bool array){
+    if(!_ok || _depth == 0 || _afterKey || !(_arrays & (1UL << (_depth - 1))) != !array) {
+        _ok = false;
+        return false;
+    }
+    _depth--;
+    _write(array ? "]" : "}", 1);
+    return true;
+}
+
+JsonWriter & JsonWriter::beginObject(){
+    _open(false);
+    return *this;
+}
+
+JsonWriter & JsonWriter::endObject(){
+    _close(false);
+    return *this;
+}
+
+JsonWriter & JsonWriter::beginArray(){
+    _open(true);
+    return *this;
+}
+
+JsonWriter & JsonWriter::endArray(){
+    _close(true);
+    return *this;
+}
+
+// quoted, in runs of the characters that need no escape
+void JsonWriter::_string(const char * s, bool progmem){
+    char chunk[32];
+    size_t len = 0;
+    _write("\"", 1);
+    while(_ok) {
+        char c = progmem ? pgm_read_byte(s) : *s;
+        if(!c) {
+            break;
+        }
+        s++;
+        const char * escape = nullptr;
+        char hex[7];
+        switch(c) {
+            case '"':  escape = "\\\""; break;
+            case '\\': escape = "\\\\"; break;
+            case '\n': escape = "\\n"; break;
+            case '\r': escape = "\\r"; break;
+            case '\t': escape = "\\t"; break;
+            case '\b': escape = "\\b"; break;
+            case '\f': escape = "\\f"; break;
+            default:
+                if((uint8_t) c < 0x20) {
+                    sprintf(hex, "\\u%04x", c);
+                    escape = hex;
+                }
+        }
+        if(escape || len == sizeof(chunk)) {
+            _write(chunk, len);
+            len = 0;
+        }
+        if(escape) {
+            _write(escape, strlen(escape));
+        } else {
+            chunk[len++] = c;
+        }
+    }
+    _write(chunk, len);
+    _write("\"", 1);
+}
+
+// the comma before all but the first member, checking it is in an object
+bool JsonWriter::_beforeKey(){
+    if(!_ok || _afterKey || _depth == 0 || (_arrays & (1UL << (_depth - 1)))) {
+        _ok = false;
+        return false;
+    }
+    uint32_t bit = 1UL << (_depth - 1);
+    if(_items & bit) {
+        _write(",", 1);
+    }
+    _items |= bit;
+    return true;
+}
+
+JsonWriter & JsonWriter::key(const char * name){
+    if(_beforeKey()) {
+        _string(name, false);
+        _write(":", 1);
+        _afterKey = true;
+    }
+    return *this;
+}
+
+JsonWriter & JsonWriter::key(const __FlashStringHelper * name){
+    if(_beforeKey()) {
+        _string((const char *) name, true);
+        _write(":", 1);
+        _afterKey = true;
+    }
+    return *this;
+}
+
+JsonWriter & JsonWriter::value(const char * s){
+    if(!s) {
+        return null();
+    }
+    if(_beforeValue()) {
+        _string(s, false);
+    }
+    return *this;
+}
+
+JsonWriter & JsonWriter::value(const __FlashStringHelper * s){
+    if(!s) {
+        return null();
+    }
+    if(_beforeValue()) {
+        _string((const char *) s, true);
+    }
+    return *this;
+}
+
+JsonWriter & JsonWriter::value(bool b){
+    return raw(b ? "true" : "false");
+}
+
+JsonWriter & JsonWriter::value(long n){
+    char buf[22];
+    snprintf(buf, sizeof(buf), "%ld", n);
+    return raw(buf);
+}
+
+JsonWriter & JsonWriter::value(unsigned long n){
+    char buf[22];
+    snprintf(buf, sizeof(buf), "%lu", n);
+    return raw(buf);
+}
+
+JsonWriter & JsonWriter::value(double d, int digits){
+    if(isnan(d) || isinf(d)) {
+        return null();
+    }
+    if(_beforeValue() && _out.print(d, digits) == 0) {
+        _ok = false;
+    }
+    return *this;
+}
+
+JsonWriter & JsonWriter::null(){
+    return raw("null");
+}
+
+JsonWriter & JsonWriter::raw(const char * json){
+    if(_beforeValue()) {
+        _write(json, strlen(json));
+    }
+    return *this;
+}
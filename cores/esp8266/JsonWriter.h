@@ -0,0 +1,88 @@
+/*
+  JsonWriter.h - JSON written piece by piece to a Print
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef __ESP8266_JSON_WRITER__
+#define __ESP8266_JSON_WRITER__
+
+#include <Print.h>
+#include <WString.h>
+
+// Writes a JSON document to out as it is described, with the commas,
+// colons and string escapes put in, so that it needn't be built in a
+// String first. out may be a WiFiClient, a File or a chunked response; the
+// calls chain:
+//
+//   JsonWriter json(client);
+//   json.beginObject().member("uptime", millis()).key("pins").beginArray();
+//   for (int pin : pins) json.value(digitalRead(pin));
+//   json.endArray().endObject();
+//
+// Nesting goes 32 levels deep.
+class JsonWriter {
+  public:
+    JsonWriter(Print & out);
+
+    JsonWriter & beginObject();
+    JsonWriter & endObject();
+    JsonWriter & beginArray();
+    JsonWriter & endArray();
+
+    // the name of the next member of an object
+    JsonWriter & key(const char * name);
+    JsonWriter & key(const String & name){ return key(name.c_str()); }
+    JsonWriter & key(const __FlashStringHelper * name);
+
+    // a nullptr string is written as null
+    JsonWriter & value(const char * s);
+    JsonWriter & value(const String & s){ return value(s.c_str()); }
+    JsonWriter & value(const __FlashStringHelper * s);
+    JsonWriter & value(bool b);
+    JsonWriter & value(int n){ return value((long) n); }
+    JsonWriter & value(unsigned int n){ return value((unsigned long) n); }
+    JsonWriter & value(long n);
+    JsonWriter & value(unsigned long n);
+    // NaN and infinity, which JSON doesn't have, are written as null
+    JsonWriter & value(double d, int digits = 6);
+    JsonWriter & null();
+    // a value that already is JSON text, written as it is
+    JsonWriter & raw(const char * json);
+
+    template<typename K, typename T>
+    JsonWriter & member(K name, T v){ key(name); return value(v); }
+
+    // false once something was out of place, like a value in an object
+    // without a key, or out took less than was written to it
+    bool ok() const { return _ok; }
+
+  private:
+    bool _beforeKey();
+    bool _beforeValue();
+    bool _open(bool array);
+    bool _close(bool array);
+    void _write(const char * s, size_t len);
+    void _string(const char * s, bool progmem);
+
+    Print & _out;
+    uint32_t _arrays;   // bit per level, set for an array
+    uint32_t _items;    // bit per level, set once it has a member
+    uint8_t _depth;
+    bool _afterKey;
+    bool _ok;
+};
+
+#endif
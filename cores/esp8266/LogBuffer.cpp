@@ -0,0 +1,170 @@
+/*
+ LogBuffer.cpp - debug output collected in RAM and sent from loop()
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Arduino.h>
+#include "LogBuffer.h"
+extern "C" {
+#include "ets_sys.h"
+#include "user_interface.h"
+}
+
+// the one os_printf() writes to
+static LogBuffer* s_debug_log = nullptr;
+
+LogBuffer::~LogBuffer() {
+    setDebugOutput(false);
+    end();
+}
+
+bool LogBuffer::begin(Print& out, size_t size, size_t chunk) {
+    Print* output = &out;
+    return begin([output](const uint8_t* data, size_t size) {
+        return output->write(data, size);
+    }, size, chunk);
+}
+
+bool LogBuffer::begin(Output out, size_t size, size_t chunk) {
+    end();
+    if(size < 2 || !out) {
+        return false;
+    }
+    uint8_t* buf = (uint8_t*) malloc(size);
+    if(!buf) {
+        return false;
+    }
+    _out = out;
+    _chunk = chunk ? chunk : size;
+    uint32_t savedPS = xt_rsil(15);
+    _buf = buf;
+    _size = size;
+    _rpos = 0;
+    _wpos = 0;
+    xt_wsr_ps(savedPS);
+    _drainer = schedule_recurrent_function_us(0, [this]() {
+        drain(_chunk);
+    }, SCHEDULE_PRIORITY_LOW);
+    if(!_drainer) {
+        end();
+        return false;
+    }
+    return true;
+}
+
+void LogBuffer::end() {
+    if(_drainer) {
+        schedule_cancel(_drainer);
+        _drainer = 0;
+    }
+    uint32_t savedPS = xt_rsil(15);
+    uint8_t* buf = _buf;
+    _buf = nullptr;
+    _size = 0;
+    _rpos = 0;
+    _wpos = 0;
+    xt_wsr_ps(savedPS);
+    free(buf);
+    _out = nullptr;
+}
+
+void LogBuffer::setDebugOutput(bool enable) {
+    if(enable) {
+        s_debug_log = this;
+        system_set_os_print(1);
+        ets_install_putc1((void *) &_s_putc);
+    } else if(s_debug_log == this) {
+        s_debug_log = nullptr;
+        // back to the uart chosen with Serial.setDebugOutput()
+        uart_set_debug(uart_get_debug());
+    }
+}
+
+void ICACHE_RAM_ATTR LogBuffer::_s_putc(char c) {
+    LogBuffer* log = s_debug_log;
+    if(log) {
+        uint8_t byte = c;
+        log->LogBuffer::write(&byte, 1);
+    }
+}
+
+size_t ICACHE_RAM_ATTR LogBuffer::write(uint8_t c) {
+    return LogBuffer::write(&c, 1);
+}
+
+size_t ICACHE_RAM_ATTR LogBuffer::write(const uint8_t *buffer, size_t size) {
+    uint32_t savedPS = xt_rsil(15);
+    size_t wpos = _wpos;
+    size_t used = (wpos >= _rpos) ? wpos - _rpos : wpos + _size - _rpos;
+    if(!_buf || size > _size - 1 - used) {
+        // all or nothing, so no message arrives cut short
+        _dropped += size;
+        xt_wsr_ps(savedPS);
+        return size;
+    }
+    for(size_t i = 0; i < size; ++i) {
+        _buf[wpos] = buffer[i];
+        if(++wpos == _size) {
+            wpos = 0;
+        }
+    }
+    _wpos = wpos;
+    xt_wsr_ps(savedPS);
+    return size;
+}
+
+void LogBuffer::flush() {
+    while(buffered() && drain(_size)) {
+    }
+}
+
+size_t LogBuffer::buffered() const {
+    size_t wpos = _wpos;
+    size_t rpos = _rpos;
+    return (wpos >= rpos) ? wpos - rpos : wpos + _size - rpos;
+}
+
+// hands up to limit bytes to the output, returns how many it took
+size_t LogBuffer::drain(size_t limit) {
+    size_t sent = 0;
+    while(_buf && sent < limit) {
+        size_t wpos = _wpos;
+        size_t rpos = _rpos;
+        if(rpos == wpos) {
+            break;
+        }
+        size_t n = ((wpos > rpos) ? wpos : _size) - rpos;
+        if(n > limit - sent) {
+            n = limit - sent;
+        }
+        size_t taken = _out(_buf + rpos, n);
+        if(!taken) {
+            break;
+        }
+        rpos += taken;
+        if(rpos == _size) {
+            rpos = 0;
+        }
+        _rpos = rpos;
+        sent += taken;
+    }
+    return sent;
+}
+
+#if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_DEBUGLOG)
+LogBuffer DebugLog;
+#endif
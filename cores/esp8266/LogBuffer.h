@@ -0,0 +1,88 @@
+/*
+ LogBuffer.h - debug output collected in RAM and sent from loop()
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __logbuffer_h
+#define __logbuffer_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include "Print.h"
+#include "Schedule.h"
+
+// What is printed to a LogBuffer goes into a ring buffer and returns at
+// once, from interrupts too; between two passes of loop() the ring is
+// handed to the output. When it is full, writes are dropped and counted
+// instead of waiting, so logging doesn't change the timing of the code
+// it logs. Build with -DDEBUG_ESP_PORT=DebugLog to have the core and
+// library debug messages go through the global one.
+class LogBuffer: public Print {
+    public:
+        // gets a block of the log, returns how much of it it took
+        typedef std::function<size_t(const uint8_t* data, size_t size)> Output;
+
+        LogBuffer() {}
+        virtual ~LogBuffer();
+
+        LogBuffer(const LogBuffer&) = delete;
+        LogBuffer& operator=(const LogBuffer&) = delete;
+
+        // Take a ring of size bytes from the heap and send it to out, at
+        // most chunk bytes per pass of loop(). The output function returns
+        // how much it took, 0 to be called again later.
+        bool begin(Print& out, size_t size = 1024, size_t chunk = 64);
+        bool begin(Output out, size_t size = 1024, size_t chunk = 64);
+        void end();
+
+        // Route os_printf(), ets_printf() and with them DEBUGV() here too,
+        // instead of to the Serial port setDebugOutput() chose.
+        void setDebugOutput(bool enable);
+
+        virtual size_t write(uint8_t c) override;
+        virtual size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+
+        // sends everything now, waiting for the output
+        virtual void flush() override;
+
+        // bytes waiting, and bytes dropped so far
+        size_t buffered() const;
+        uint32_t dropped() const {
+            return _dropped;
+        }
+
+    protected:
+        size_t drain(size_t limit);
+        static void _s_putc(char c);
+
+        Output _out;
+        uint8_t* _buf = nullptr;
+        size_t _size = 0;
+        size_t _chunk = 0;
+        volatile size_t _rpos = 0;
+        volatile size_t _wpos = 0;
+        volatile uint32_t _dropped = 0;
+        schedule_handle_t _drainer = 0;
+};
+
+#if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_DEBUGLOG)
+extern LogBuffer DebugLog;
+#endif
+
+#endif//__logbuffer_h
@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include <MD5Builder.h>
+#include <new>
 
 uint8_t hex_char_to_byte(uint8_t c){
     return  (c >= 'a' && c <= 'f') ? (c - ((uint8_t)'a' - 0xa)) :
@@ -31,48 +32,56 @@ void MD5Builder::addHexString(const char * data){
     free(tmp);
 }
 
-bool MD5Builder::addStream(Stream & stream, const size_t maxLen){
-    const int buf_size = 512;
-    int maxLengthLeft = maxLen;
-    uint8_t * buf = (uint8_t*) malloc(buf_size);
+MD5Builder& MD5Builder::operator=(const MD5Builder& other){
+    // the stream buffer stays with each builder
+    _ctx = other._ctx;
+    memcpy(_buf, other._buf, 16);
+    return *this;
+}
 
-    if(!buf) {
-        return false;
+bool MD5Builder::addStream(Stream & stream, const size_t maxLen){
+    if(!_streamBuf) {
+        _streamBuf.reset(new (std::nothrow) uint8_t[MD5_STREAM_CHUNK]);
+        if(!_streamBuf) {
+            return false;
+        }
     }
 
-    int bytesAvailable = stream.available();
-    while((bytesAvailable > 0) && (maxLengthLeft > 0)) {
+    size_t maxLengthLeft = maxLen;
+    while(maxLengthLeft > 0) {
+        int bytesAvailable = stream.available();
+        if(bytesAvailable <= 0) {
+            break;
+        }
 
         // determine number of bytes to read
-        int readBytes = bytesAvailable;
+        size_t readBytes = (size_t) bytesAvailable;
         if(readBytes > maxLengthLeft) {
-            readBytes = maxLengthLeft ;    // read only until max_len
+            readBytes = maxLengthLeft;    // read only until max_len
         }
-        if(readBytes > buf_size) {
-            readBytes = buf_size;    // not read more the buffer can handle
+        if(readBytes > MD5_STREAM_CHUNK) {
+            readBytes = MD5_STREAM_CHUNK;    // not read more the buffer can handle
         }
 
         // read data and check if we got something
-        int numBytesRead = stream.readBytes(buf, readBytes);
-        if(numBytesRead< 1) {
+        size_t numBytesRead = stream.readBytes(_streamBuf.get(), readBytes);
+        if(numBytesRead == 0) {
             return false;
         }
 
         // Update MD5 with buffer payload
-        MD5Update(&_ctx, buf, numBytesRead);
+        MD5Update(&_ctx, _streamBuf.get(), numBytesRead);
 
         yield();      // time for network streams
 
-        // update available number of bytes
         maxLengthLeft -= numBytesRead;
-        bytesAvailable = stream.available();
     }
-    free(buf);
     return true;
 }
 
 void MD5Builder::calculate(void){
     MD5Final(_buf, &_ctx);
+    _streamBuf.reset();
 }
 
 void MD5Builder::getBytes(uint8_t * output){
@@ -80,9 +89,12 @@ void MD5Builder::getBytes(uint8_t * output){
 }
 
 void MD5Builder::getChars(char * output){
+    static const char hex[] = "0123456789abcdef";
     for(uint8_t i = 0; i < 16; i++) {
-        sprintf(output + (i * 2), "%02x", _buf[i]);
+        output[i * 2] = hex[_buf[i] >> 4];
+        output[i * 2 + 1] = hex[_buf[i] & 15];
     }
+    output[32] = 0;
 }
 
 String MD5Builder::toString(void){
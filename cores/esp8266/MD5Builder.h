@@ -23,13 +23,24 @@
 
 #include <WString.h>
 #include <Stream.h>
+#include <memory>
 #include "md5.h"
 
+// addStream() reads into a buffer of this size, a multiple of the 64 byte
+// block, taken on the first call and kept until calculate()
+#ifndef MD5_STREAM_CHUNK
+#define MD5_STREAM_CHUNK 1024
+#endif
+
 class MD5Builder {
   private:
     md5_context_t _ctx;
     uint8_t _buf[16];
+    std::unique_ptr<uint8_t[]> _streamBuf;
   public:
+    MD5Builder(){}
+    MD5Builder(const MD5Builder& other){ *this = other; }
+    MD5Builder& operator=(const MD5Builder& other);
     void begin(void);
     void add(const uint8_t * data, const uint16_t len);
     void add(const char * data){ add((const uint8_t*)data, strlen(data)); }
@@ -41,6 +52,7 @@ class MD5Builder {
     bool addStream(Stream & stream, const size_t maxLen);
     void calculate(void);
     void getBytes(uint8_t * output);
+    // 32 hex digits and a terminating 0 into output
     void getChars(char * output);
     String toString(void);
 };
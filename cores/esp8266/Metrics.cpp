@@ -0,0 +1,136 @@
+/*
+ Metrics.cpp - counters and histograms of the core and libraries, and their report
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Metrics.h"
+#include "IPAddress.h"
+#include "Udp.h"
+
+// the longest name printed in full
+#define NAME_MAX_LEN 47
+
+// A function's static, so that it is there before the metrics of the
+// other files register, whatever order their constructors run in.
+static Metric*& head()
+{
+    static Metric* first = nullptr;
+    return first;
+}
+
+Metric::Metric(const char* name, Type type) : _name(name), _type(type)
+{
+    // appended, so that the report keeps the order of definition within a file
+    Metric** link = &head();
+    while (*link) {
+        link = &(*link)->_next;
+    }
+    _next = nullptr;
+    *link = this;
+}
+
+Metric* Metric::first()
+{
+    return head();
+}
+
+void MetricHistogram::reset()
+{
+    uint32_t savedPS = xt_rsil(15);
+    for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; ++i) {
+        _buckets[i] = 0;
+    }
+    _count = 0;
+    _sum = 0;
+    _max = 0;
+    xt_wsr_ps(savedPS);
+}
+
+void metrics_reset()
+{
+    for (Metric* m = Metric::first(); m; m = m->next()) {
+        if (m->type() == Metric::COUNTER) {
+            static_cast<MetricCounter*>(m)->reset();
+        } else if (m->type() == Metric::HISTOGRAM) {
+            static_cast<MetricHistogram*>(m)->reset();
+        }
+    }
+}
+
+// the report line of m, with its newline; returns its length
+static size_t format(const Metric* m, char* line, size_t size)
+{
+    strncpy_P(line, m->name(), NAME_MAX_LEN);
+    line[NAME_MAX_LEN] = 0;
+    size_t len = strlen(line);
+    if (m->type() == Metric::COUNTER) {
+        len += snprintf(line + len, size - len, " %u", (unsigned) static_cast<const MetricCounter*>(m)->value());
+    } else if (m->type() == Metric::GAUGE) {
+        len += snprintf(line + len, size - len, " %u", (unsigned) static_cast<const MetricGauge*>(m)->value());
+    } else {
+        // a copy first, an interrupt could add to it while it is printed
+        uint32_t savedPS = xt_rsil(15);
+        MetricHistogram h = *static_cast<const MetricHistogram*>(m);
+        xt_wsr_ps(savedPS);
+        len += snprintf(line + len, size - len, " %u %u %u",
+                        (unsigned) h.count(), (unsigned) h.sum(), (unsigned) h.maximum());
+        for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; ++i) {
+            len += snprintf(line + len, size - len, " %u", (unsigned) h.bucket(i));
+        }
+    }
+    line[len++] = '\n';
+    return len;
+}
+
+size_t metrics_print(Print& out, size_t first, size_t max_bytes)
+{
+    char line[NAME_MAX_LEN + 1 + (METRICS_HISTOGRAM_BUCKETS + 3) * 11 + 2];
+    size_t index = 0;
+    size_t printed = 0;
+    for (Metric* m = Metric::first(); m; m = m->next(), ++index) {
+        if (index < first) {
+            continue;
+        }
+        size_t len = format(m, line, sizeof(line) - 1);
+        if (printed && printed + len > max_bytes) {
+            break;
+        }
+        out.write((const uint8_t*) line, len);
+        printed += len;
+    }
+    return index;
+}
+
+bool metrics_send(UDP& udp, const IPAddress& ip, uint16_t port, size_t packet_size)
+{
+    size_t count = 0;
+    for (Metric* m = Metric::first(); m; m = m->next()) {
+        ++count;
+    }
+    for (size_t next = 0; next < count; ) {
+        if (!udp.beginPacket(ip, port)) {
+            return false;
+        }
+        next = metrics_print(udp, next, packet_size);
+        if (!udp.endPacket()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,208 @@
+/*
+ Metrics.h - counters and histograms of the core and libraries, and their report
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <Arduino.h>
+#include "Print.h"
+
+class UDP;
+class IPAddress;
+
+// buckets of a histogram, see MetricHistogram
+#ifndef METRICS_HISTOGRAM_BUCKETS
+#define METRICS_HISTOGRAM_BUCKETS 16
+#endif
+
+// the most a report sent by metrics_send() puts in one datagram
+#ifndef METRICS_UDP_PACKET
+#define METRICS_UDP_PACKET 1200
+#endif
+
+/*
+ A metric is a static object: it registers itself in a list when the
+ global constructors run and is never freed, so nothing is allocated and
+ a counter can be updated at any time, from an interrupt as well. The
+ lx106 has no atomic add, so an update is the few instructions of a
+ read-modify-write with the interrupts off; the inline methods are placed
+ where the caller is, in IRAM for an IRAM_ATTR handler.
+
+ Define them with the macros, which keep the name in flash:
+
+     METRIC_COUNTER(s_rxFrames, "uart.rx_frames");
+     METRIC_HISTOGRAM(s_writeUs, "fs.write_us");
+     METRIC_GAUGE(s_queued, "app.queued", readQueued);
+
+     s_rxFrames.add();
+     s_writeUs.record(micros() - start);
+
+ and report them all with metrics_print(), metrics_send() or, from
+ ESP8266WebServer, serveMetrics().
+*/
+class Metric
+{
+public:
+    enum Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    // in flash
+    const char* name() const
+    {
+        return _name;
+    }
+    Type type() const
+    {
+        return _type;
+    }
+    Metric* next() const
+    {
+        return _next;
+    }
+    static Metric* first();
+
+protected:
+    Metric(const char* name, Type type);
+
+    const char* _name;
+    Type _type;
+    Metric* _next;
+};
+
+// counts events or bytes, from 0 at boot or metrics_reset()
+class MetricCounter : public Metric
+{
+public:
+    MetricCounter(const char* name) : Metric(name, COUNTER) {}
+
+    inline void add(uint32_t n = 1) __attribute__((always_inline))
+    {
+        uint32_t savedPS = xt_rsil(15);
+        _value += n;
+        xt_wsr_ps(savedPS);
+    }
+    uint32_t value() const
+    {
+        return _value;
+    }
+    void reset()
+    {
+        _value = 0;
+    }
+
+protected:
+    volatile uint32_t _value = 0;
+};
+
+// a value read when the report is made, e.g. the free heap
+class MetricGauge : public Metric
+{
+public:
+    typedef uint32_t (*Read)();
+
+    MetricGauge(const char* name, Read read) : Metric(name, GAUGE), _read(read) {}
+
+    uint32_t value() const
+    {
+        return _read ? _read() : 0;
+    }
+
+protected:
+    Read _read;
+};
+
+// Durations or sizes in powers of two: bucket 0 counts the zeros, bucket
+// i the values from 2^(i-1) to 2^i - 1, the last one all from
+// 2^(METRICS_HISTOGRAM_BUCKETS - 2) on. Also the count, sum and maximum.
+class MetricHistogram : public Metric
+{
+public:
+    MetricHistogram(const char* name) : Metric(name, HISTOGRAM) {}
+
+    inline void record(uint32_t value) __attribute__((always_inline))
+    {
+        uint32_t bucket = 0;
+        while (bucket < METRICS_HISTOGRAM_BUCKETS - 1 && (value >> bucket)) {
+            ++bucket;
+        }
+        uint32_t savedPS = xt_rsil(15);
+        ++_buckets[bucket];
+        ++_count;
+        _sum += value;
+        if (value > _max) {
+            _max = value;
+        }
+        xt_wsr_ps(savedPS);
+    }
+    uint32_t count() const
+    {
+        return _count;
+    }
+    uint32_t sum() const
+    {
+        return _sum;
+    }
+    uint32_t maximum() const
+    {
+        return _max;
+    }
+    uint32_t bucket(size_t i) const
+    {
+        return (i < METRICS_HISTOGRAM_BUCKETS) ? _buckets[i] : 0;
+    }
+    void reset();
+
+protected:
+    volatile uint32_t _buckets[METRICS_HISTOGRAM_BUCKETS] = { 0 };
+    volatile uint32_t _count = 0;
+    volatile uint32_t _sum = 0;
+    volatile uint32_t _max = 0;
+};
+
+#define METRIC_COUNTER(var, name) \
+    static const char var##_name[] PROGMEM = name; \
+    MetricCounter var(var##_name)
+#define METRIC_GAUGE(var, name, read) \
+    static const char var##_name[] PROGMEM = name; \
+    MetricGauge var(var##_name, read)
+#define METRIC_HISTOGRAM(var, name) \
+    static const char var##_name[] PROGMEM = name; \
+    MetricHistogram var(var##_name)
+
+// the counters and histograms back to zero
+void metrics_reset();
+
+// One line per metric, from the first'th on in the order of the list:
+//     name value
+//     name count sum max bucket0 bucket1 ...
+// Stops before a line that would go over max_bytes, unless it is the
+// first one. Returns the index of the next metric not printed, which is
+// the number of metrics once all are.
+size_t metrics_print(Print& out, size_t first = 0, size_t max_bytes = (size_t) -1);
+
+// The report in datagrams of up to packet_size bytes, lines not cut.
+// Returns false if one couldn't be sent.
+bool metrics_send(UDP& udp, const IPAddress& ip, uint16_t port, size_t packet_size = METRICS_UDP_PACKET);
+
+#endif // METRICS_H
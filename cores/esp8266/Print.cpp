@@ -28,6 +28,7 @@
 #include <Arduino.h>
 
 #include "Print.h"
+#include "stdlib_noniso.h"
 
 // Public Methods //////////////////////////////////////////////////////////////
 
@@ -55,46 +56,92 @@ size_t Print::write(const uint8_t *buffer, size_t size) {
     return n;
 }
 
+// printf() formats through a stdio stream whose buffer lives on the stack
+// and is handed to write() whenever it fills up, so output of any length
+// goes out in pieces without a heap copy of the whole text.
+struct PrintCookie {
+    Print* out;
+    size_t written;
+};
+
+#ifdef __ets__
+
+static int print_cookie_write(struct _reent* unused, void* cookie, const char* buf, int size) {
+    (void) unused;
+    PrintCookie* c = (PrintCookie*) cookie;
+    size_t n = c->out->write((const uint8_t*) buf, size);
+    c->written += n;
+    // a short write fails the stream, which ends the formatting
+    return n;
+}
+
+static size_t print_formatted(Print& out, const char* format, va_list arg) {
+    PrintCookie cookie = { &out, 0 };
+    char temp[64];
+    // the same kind of temporary stream newlib sets up in __sbprintf()
+    FILE f;
+    memset(&f, 0, sizeof(f));
+    f._flags = __SWR;
+    f._file = -1;
+    f._bf._base = f._p = (unsigned char*) temp;
+    f._bf._size = f._w = sizeof(temp);
+    f._cookie = &cookie;
+    f._write = print_cookie_write;
+    if (_vfprintf_r(_REENT, &f, format, arg) >= 0) {
+        _fflush_r(_REENT, &f);
+    }
+    return cookie.written;
+}
+
+#else // host build
+
+static ssize_t print_cookie_write(void* cookie, const char* buf, size_t size) {
+    PrintCookie* c = (PrintCookie*) cookie;
+    size_t n = c->out->write((const uint8_t*) buf, size);
+    c->written += n;
+    return n;
+}
+
+static size_t print_formatted(Print& out, const char* format, va_list arg) {
+    PrintCookie cookie = { &out, 0 };
+    char temp[64];
+    cookie_io_functions_t io = { NULL, print_cookie_write, NULL, NULL };
+    FILE* f = fopencookie(&cookie, "w", io);
+    if (!f) {
+        return 0;
+    }
+    setvbuf(f, temp, _IOFBF, sizeof(temp));
+    vfprintf(f, format, arg);
+    fclose(f);
+    return cookie.written;
+}
+
+#endif
+
 size_t Print::printf(const char *format, ...) {
     va_list arg;
     va_start(arg, format);
-    char temp[64];
-    char* buffer = temp;
-    size_t len = vsnprintf(temp, sizeof(temp), format, arg);
+    size_t len = print_formatted(*this, format, arg);
     va_end(arg);
-    if (len > sizeof(temp) - 1) {
-        buffer = new char[len + 1];
-        if (!buffer) {
-            return 0;
-        }
-        va_start(arg, format);
-        vsnprintf(buffer, len + 1, format, arg);
-        va_end(arg);
-    }
-    len = write((const uint8_t*) buffer, len);
-    if (buffer != temp) {
-        delete[] buffer;
-    }
     return len;
 }
 
 size_t Print::printf_P(PGM_P format, ...) {
-    va_list arg;
-    va_start(arg, format);
+    // the format is read byte by byte, which flash doesn't allow
     char temp[64];
     char* buffer = temp;
-    size_t len = vsnprintf_P(temp, sizeof(temp), format, arg);
-    va_end(arg);
-    if (len > sizeof(temp) - 1) {
-        buffer = new char[len + 1];
+    size_t fmtLen = strlen_P(format);
+    if (fmtLen > sizeof(temp) - 1) {
+        buffer = new char[fmtLen + 1];
         if (!buffer) {
             return 0;
         }
-        va_start(arg, format);
-        vsnprintf_P(buffer, len + 1, format, arg);
-        va_end(arg);
     }
-    len = write((const uint8_t*) buffer, len);
+    strcpy_P(buffer, format);
+    va_list arg;
+    va_start(arg, format);
+    size_t len = print_formatted(*this, buffer, arg);
+    va_end(arg);
     if (buffer != temp) {
         delete[] buffer;
     }
@@ -240,28 +287,18 @@ size_t Print::println(const Printable& x) {
 // Private Methods /////////////////////////////////////////////////////////////
 
 size_t Print::printNumber(unsigned long n, uint8_t base) {
-    char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-    char *str = &buf[sizeof(buf) - 1];
-
-    *str = '\0';
+    char buf[8 * sizeof(long)]; // Assumes 8-bit chars.
+    char *end = &buf[sizeof(buf)];
 
-    // prevent crash if called with base == 1
-    if(base < 2)
+    // prevent crash if called with base == 1, or past 'Z'
+    if(base < 2 || base > 36)
         base = 10;
 
-    do {
-        unsigned long m = n;
-        n /= base;
-        char c = m - base * n;
-        *--str = c < 10 ? c + '0' : c + 'A' - 10;
-    } while(n);
-
-    return write(str);
+    char *str = ulltoa_end(n, end, base, true);
+    return write(str, end - str);
 }
 
 size_t Print::printFloat(double number, uint8_t digits) {
-    size_t n = 0;
-
     if(isnan(number))
         return print("nan");
     if(isinf(number))
@@ -271,36 +308,10 @@ size_t Print::printFloat(double number, uint8_t digits) {
     if(number < -4294967040.0)
         return print("ovf");  // constant determined empirically
 
-    // Handle negative numbers
-    if(number < 0.0) {
-        n += print('-');
-        number = -number;
-    }
-
-    // Round correctly so that print(1.999, 2) prints as "2.00"
-    double rounding = 0.5;
-    for(uint8_t i = 0; i < digits; ++i)
-        rounding /= 10.0;
-
-    number += rounding;
-
-    // Extract the integer part of the number and print it
-    unsigned long int_part = (unsigned long) number;
-    double remainder = number - (double) int_part;
-    n += print(int_part);
-
-    // Print the decimal point, but only if there are digits beyond
-    if(digits > 0) {
-        n += print(".");
-    }
-
-    // Extract digits from the remainder one at a time
-    while(digits-- > 0) {
-        remainder *= 10.0;
-        int toPrint = int(remainder);
-        n += print(toPrint);
-        remainder -= toPrint;
-    }
-
-    return n;
+    // rounded as printf() does, so print(1.999, 2) prints as "2.00"
+    char buf[24 + 255];
+    size_t n = dtoa_fixed(number, digits, buf);
+    if(!n)
+        return printf("%.*f", digits, number);  // tiny, with many digits
+    return write(buf, n);
 }
@@ -0,0 +1,47 @@
+/*
+ Profiler.h - sampling profiler driven by the timer1 NMI
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Print.h"
+
+#ifndef PROFILER_SLOTS
+#define PROFILER_SLOTS 512
+#endif
+
+// Records where the CPU is, rate_hz times per second, from the timer1 NMI,
+// so interrupt handlers and code running with interrupts disabled are seen
+// too. Every distinct address takes one of slots entries of 8 bytes, taken
+// from the heap; samples at new addresses are only counted once the table
+// is full. Timer1 is not available to analogWrite(), tone() or Servo while
+// profiling. Returns false without memory.
+bool profiler_start(uint32_t rate_hz, size_t slots = PROFILER_SLOTS);
+// stops sampling, the samples stay until the next start
+void profiler_stop();
+// forget the samples and go on
+void profiler_reset();
+
+// The samples, in the format tools/profiler_report.py reads: a header line,
+// one "address count" line per address, in hex and decimal, and "end".
+void profiler_print(Print& out);
+
+#endif // PROFILER_H
@@ -0,0 +1,93 @@
+/*
+ RtcMemoryMap.h - the parts of the RTC user memory the core and libraries use
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef RTC_MEMORY_MAP_H
+#define RTC_MEMORY_MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ The RTC user memory is 128 blocks of 4 bytes, the unit the offsets of
+ ESP.rtcUserMemoryRead() and Write() count in. By default it is shared as
+ follows:
+
+      0 -  31  the command the Updater leaves for eboot (eboot_command.h);
+               on the A/B layouts eboot leaves the slot it started in 30
+     32 -  56  RtcSnapshot
+     57 -  63  configTimeRTC(TIME_RTC_OFFSET)
+     64 -  85  ESP8266httpUpdate, a download to resume
+     86 -  94  WiFi.beginQuick(), the last connection
+     95        free
+     96 - 127  RtcTrace
+
+ Every area but the first can be moved with -D..._OFFSET in the build
+ flags, which all files have to see alike. The data of a sketch goes where
+ the parts it doesn't use are.
+*/
+
+#define RTC_USER_BLOCKS 128
+
+#define EBOOT_RTC_OFFSET 0
+#define EBOOT_RTC_BLOCKS 32
+
+#ifndef RTC_SNAPSHOT_OFFSET
+#define RTC_SNAPSHOT_OFFSET 32
+#endif
+
+#ifndef TIME_RTC_OFFSET
+#define TIME_RTC_OFFSET 57
+#endif
+#define TIME_RTC_BLOCKS 7
+
+#ifndef HTTP_UPDATE_RESUME_RTC_OFFSET
+#define HTTP_UPDATE_RESUME_RTC_OFFSET 64
+#endif
+#define HTTP_UPDATE_RESUME_RTC_BLOCKS 22
+
+#ifndef WIFI_QUICK_RTC_OFFSET
+#define WIFI_QUICK_RTC_OFFSET 86
+#endif
+#define WIFI_QUICK_RTC_BLOCKS 9
+
+#ifndef RTC_TRACE_OFFSET
+#define RTC_TRACE_OFFSET 96
+#endif
+#ifndef RTC_TRACE_BLOCKS
+#define RTC_TRACE_BLOCKS 32
+#endif
+
+static inline bool rtc_memory_overlaps(uint32_t offset, uint32_t blocks, uint32_t area, uint32_t area_blocks)
+{
+    return offset < area + area_blocks && area < offset + blocks;
+}
+
+// True if blocks from offset on are inside the user memory and clear of
+// the areas above, those of RtcSnapshot aside.
+static inline bool rtc_memory_unclaimed(uint32_t offset, uint32_t blocks)
+{
+    return offset + blocks <= RTC_USER_BLOCKS && offset + blocks >= offset &&
+           !rtc_memory_overlaps(offset, blocks, EBOOT_RTC_OFFSET, EBOOT_RTC_BLOCKS) &&
+           !rtc_memory_overlaps(offset, blocks, TIME_RTC_OFFSET, TIME_RTC_BLOCKS) &&
+           !rtc_memory_overlaps(offset, blocks, HTTP_UPDATE_RESUME_RTC_OFFSET, HTTP_UPDATE_RESUME_RTC_BLOCKS) &&
+           !rtc_memory_overlaps(offset, blocks, WIFI_QUICK_RTC_OFFSET, WIFI_QUICK_RTC_BLOCKS) &&
+           !rtc_memory_overlaps(offset, blocks, RTC_TRACE_OFFSET, RTC_TRACE_BLOCKS);
+}
+
+#endif // RTC_MEMORY_MAP_H
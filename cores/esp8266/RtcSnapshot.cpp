@@ -0,0 +1,120 @@
+/*
+ RtcSnapshot.cpp - application state kept in RTC memory across deep sleep
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Arduino.h>
+#include "RtcSnapshot.h"
+#include "eboot_command.h"
+
+#define RTC_SNAPSHOT_MAGIC 0x52534e50
+#define RTC_SNAPSHOT_HEADER 3
+
+RtcSnapshotBase* RtcSnapshotBase::_first = nullptr;
+
+RtcSnapshotBase::RtcSnapshotBase(void* data, size_t size, uint16_t version, uint32_t offset) :
+    _data(data), _size(size), _version(version), _offset(offset), _next(_first)
+{
+    _first = this;
+}
+
+RtcSnapshotBase::~RtcSnapshotBase()
+{
+    for (RtcSnapshotBase** p = &_first; *p; p = &(*p)->_next) {
+        if (*p == this) {
+            *p = _next;
+            break;
+        }
+    }
+}
+
+bool RtcSnapshotBase::_fits() const
+{
+    return rtc_memory_unclaimed(_offset, RTC_SNAPSHOT_HEADER + (_size + 3) / 4);
+}
+
+uint32_t RtcSnapshotBase::_crc() const
+{
+    return crc_update(0xffffffff, (const uint8_t*) _data, _size);
+}
+
+bool RtcSnapshotBase::restore()
+{
+    if (!_fits()) {
+        return false;
+    }
+    volatile uint32_t* mem = RTC_USER_MEM + _offset;
+    if (mem[0] != RTC_SNAPSHOT_MAGIC || mem[1] != (((uint32_t) _version << 16) | _size)) {
+        return false;
+    }
+    // only whole words can be read from it; the data is left alone until
+    // the CRC says it is good
+    uint32_t crc = 0xffffffff;
+    for (size_t pos = 0; pos < _size; pos += 4) {
+        uint32_t word = mem[RTC_SNAPSHOT_HEADER + pos / 4];
+        crc = crc_update(crc, (const uint8_t*) &word, std::min<size_t>(4, _size - pos));
+    }
+    if (crc != mem[2]) {
+        return false;
+    }
+    for (size_t pos = 0; pos < _size; pos += 4) {
+        uint32_t word = mem[RTC_SNAPSHOT_HEADER + pos / 4];
+        memcpy((uint8_t*) _data + pos, &word, std::min<size_t>(4, _size - pos));
+    }
+    _dirty = false;
+    return true;
+}
+
+bool RtcSnapshotBase::commit()
+{
+    return !_dirty || write();
+}
+
+bool RtcSnapshotBase::write()
+{
+    if (!_fits()) {
+        return false;
+    }
+    volatile uint32_t* mem = RTC_USER_MEM + _offset;
+    // invalid until the data is all there
+    mem[0] = 0;
+    for (size_t pos = 0; pos < _size; pos += 4) {
+        uint32_t word = 0;
+        memcpy(&word, (const uint8_t*) _data + pos, std::min<size_t>(4, _size - pos));
+        mem[RTC_SNAPSHOT_HEADER + pos / 4] = word;
+    }
+    mem[1] = ((uint32_t) _version << 16) | _size;
+    mem[2] = _crc();
+    mem[0] = RTC_SNAPSHOT_MAGIC;
+    _dirty = false;
+    return true;
+}
+
+void RtcSnapshotBase::invalidate()
+{
+    if (_fits()) {
+        RTC_USER_MEM[_offset] = 0;
+    }
+    _dirty = true;
+}
+
+void RtcSnapshotBase::commitAll()
+{
+    for (RtcSnapshotBase* s = _first; s; s = s->_next) {
+        s->commit();
+    }
+}
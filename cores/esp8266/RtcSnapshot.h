@@ -0,0 +1,108 @@
+/*
+ RtcSnapshot.h - application state kept in RTC memory across deep sleep
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __rtcsnapshot_h
+#define __rtcsnapshot_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include "RtcMemoryMap.h"
+
+// Snapshots go at RTC_SNAPSHOT_OFFSET by default, in the 4 byte blocks of
+// ESP.rtcUserMemoryRead() and Write(): blocks 32 to 56, see RtcMemoryMap.h.
+// A snapshot takes 3 blocks of header and its data, 88 bytes of it there.
+// One that would overlap another area of the map is neither restored nor
+// written.
+
+class RtcSnapshotBase {
+    public:
+        // Reads the snapshot back, true if RTC memory held one of this
+        // version and size with a good CRC. The data is left alone
+        // otherwise (after power on, a new firmware changing the version):
+        // load it from flash then, it is written at the next deep sleep.
+        bool restore();
+
+        // Writes the data if it was changed since it was restored or
+        // written; the snapshots left dirty are written by ESP.deepSleep().
+        bool commit();
+        // writes it whatever
+        bool write();
+        void markDirty() { _dirty = true; }
+        bool isDirty() const { return _dirty; }
+        // so that the next restore() fails
+        void invalidate();
+
+        // commit() of every snapshot there is
+        static void commitAll();
+
+    protected:
+        RtcSnapshotBase(void* data, size_t size, uint16_t version, uint32_t offset);
+        ~RtcSnapshotBase();
+        RtcSnapshotBase(const RtcSnapshotBase&) = delete;
+        RtcSnapshotBase& operator=(const RtcSnapshotBase&) = delete;
+
+        bool _fits() const;
+        uint32_t _crc() const;
+
+        void* _data;
+        size_t _size;
+        uint16_t _version;
+        uint32_t _offset;
+        bool _dirty = true;
+        RtcSnapshotBase* _next;
+
+        static RtcSnapshotBase* _first;
+};
+
+// A copy of T, a plain struct, that survives deep sleep:
+//
+//     struct State { uint32_t count; float lastReading; };
+//     RtcSnapshot<State, 2> state;   // bump the version when State changes
+//
+//     if (!state.restore())
+//         loadStateFromFlash(state.edit());
+//     state.edit().count++;
+//     ESP.deepSleep(60e6);           // writes it back
+//
+// Reading and writing go to the mapped RTC memory directly, a few
+// microseconds for a small struct.
+template<typename T, uint16_t VERSION = 1>
+class RtcSnapshot : public RtcSnapshotBase {
+        static_assert(std::is_pod<T>::value, "RtcSnapshot holds plain structs only");
+
+    public:
+        explicit RtcSnapshot(uint32_t offset = RTC_SNAPSHOT_OFFSET) :
+            RtcSnapshotBase(&_value, sizeof(T), VERSION, offset), _value() {}
+
+        const T& get() const { return _value; }
+        const T& operator*() const { return _value; }
+        const T* operator->() const { return &_value; }
+
+        // for changing it, marks it to be written back
+        T& edit() {
+            markDirty();
+            return _value;
+        }
+
+    private:
+        T _value;
+};
+
+#endif//__rtcsnapshot_h
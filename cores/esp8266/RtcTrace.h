@@ -0,0 +1,73 @@
+/*
+ RtcTrace.h - event trace kept in RTC memory across resets
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef RTC_TRACE_H
+#define RTC_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "RtcMemoryMap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Where the trace lives in RTC user memory, RTC_TRACE_OFFSET and
+// RTC_TRACE_BLOCKS, is in RtcMemoryMap.h: by default the last 128 bytes.
+// Two blocks are a header, every event takes two more.
+
+#define RTC_TRACE_EVENTS ((RTC_TRACE_BLOCKS - 2) / 2)
+
+typedef struct {
+    uint32_t cycles;    // CPU cycle counter when it happened, to 256 cycles
+    uint8_t id;
+    uint32_t arg;
+} rtc_trace_event_t;
+
+// Record an event in the trace, from anywhere, interrupts included.
+// Nothing is recorded before rtc_trace_begin().
+void rtc_trace(uint8_t id, uint32_t arg);
+
+// Start a new trace, dropping what the one before recorded: read that
+// first, e.g. in setup() together with ESP.getResetInfoPtr().
+void rtc_trace_begin(void);
+void rtc_trace_end(void);
+
+// Copy up to count of the last events, oldest first, into events and
+// return how many there were; these are the ones from before the reset
+// until rtc_trace_begin() is called. 0 when RTC memory held no trace,
+// e.g. after power on.
+size_t rtc_trace_read(rtc_trace_event_t* events, size_t count);
+
+// Events recorded since the trace began, including the overwritten ones.
+uint32_t rtc_trace_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// RTC_TRACE(id, arg) compiles to nothing with RTC_TRACE_DISABLED defined,
+// to leave the trace points in place.
+#ifndef RTC_TRACE_DISABLED
+#define RTC_TRACE(id, arg) rtc_trace((id), (uint32_t) (arg))
+#else
+#define RTC_TRACE(id, arg) do { } while (0)
+#endif
+
+#endif // RTC_TRACE_H
@@ -0,0 +1,176 @@
+/*
+  SHA256Builder.cpp - SHA-256 in pieces, like MD5Builder
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include <SHA256Builder.h>
+
+// FIPS 180-4
+static const uint32_t sha256_k[64] PROGMEM = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t ror(uint32_t x, int n){
+    return (x >> n) | (x << (32 - n));
+}
+
+void SHA256Builder::begin(void){
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(_state, init, sizeof(_state));
+    _length = 0;
+    memset(_buf, 0x00, sizeof(_buf));
+}
+
+void SHA256Builder::_process(const uint8_t * block){
+    uint32_t w[16];
+    if(((uintptr_t) block & 3) == 0) {
+        // whole words, which add() passes on from the caller's buffer
+        const uint32_t * words = (const uint32_t *) block;
+        for(int i = 0; i < 16; i++) {
+            w[i] = __builtin_bswap32(words[i]);
+        }
+    } else {
+        for(int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+        }
+    }
+    uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+    uint32_t e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+    for(int i = 0; i < 64; i++) {
+        // the schedule in place, 16 words at a time
+        if(i >= 16) {
+            uint32_t w15 = w[(i + 1) & 15], w2 = w[(i + 14) & 15];
+            uint32_t s0 = ror(w15, 7) ^ ror(w15, 18) ^ (w15 >> 3);
+            uint32_t s1 = ror(w2, 17) ^ ror(w2, 19) ^ (w2 >> 10);
+            w[i & 15] += s0 + w[(i + 9) & 15] + s1;
+        }
+        uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + pgm_read_dword(&sha256_k[i]) + w[i & 15];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    _state[0] += a;
+    _state[1] += b;
+    _state[2] += c;
+    _state[3] += d;
+    _state[4] += e;
+    _state[5] += f;
+    _state[6] += g;
+    _state[7] += h;
+}
+
+void SHA256Builder::add(const uint8_t * data, size_t len){
+    size_t used = _length & 63;
+    _length += len;
+    if(used) {
+        size_t piece = (len < 64 - used) ? len : 64 - used;
+        memcpy(_block + used, data, piece);
+        data += piece;
+        len -= piece;
+        if(used + piece < 64)
+            return;
+        _process(_block);
+    }
+    for(; len >= 64; data += 64, len -= 64) {
+        _process(data);
+    }
+    memcpy(_block, data, len);
+}
+
+bool SHA256Builder::addStream(Stream & stream, const size_t maxLen){
+    // whole blocks, so that they keep the alignment of buf
+    const size_t bufSize = 1024;
+    size_t left = maxLen;
+    uint8_t * buf = (uint8_t*) malloc(bufSize);
+    if(!buf) {
+        return false;
+    }
+    bool ok = true;
+    while(left > 0) {
+        int available = stream.available();
+        if(available <= 0) {
+            break;
+        }
+        size_t len = (size_t) available;
+        if(len > left) {
+            len = left;
+        }
+        if(len > bufSize) {
+            len = bufSize;
+        }
+        size_t got = stream.readBytes(buf, len);
+        if(got == 0) {
+            ok = false;
+            break;
+        }
+        add(buf, got);
+        left -= got;
+        yield();      // time for network streams
+    }
+    free(buf);
+    return ok;
+}
+
+void SHA256Builder::calculate(void){
+    uint64_t bits = _length * 8;
+    uint8_t pad[72];
+    size_t padLen = 64 - ((_length + 8) & 63);
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for(int i = 0; i < 8; i++) {
+        pad[padLen + i] = bits >> (56 - 8 * i);
+    }
+    add(pad, padLen + 8);
+    for(int i = 0; i < 8; i++) {
+        _buf[i * 4] = _state[i] >> 24;
+        _buf[i * 4 + 1] = _state[i] >> 16;
+        _buf[i * 4 + 2] = _state[i] >> 8;
+        _buf[i * 4 + 3] = _state[i];
+    }
+}
+
+void SHA256Builder::getBytes(uint8_t * output){
+    memcpy(output, _buf, 32);
+}
+
+void SHA256Builder::getChars(char * output){
+    for(uint8_t i = 0; i < 32; i++) {
+        sprintf(output + (i * 2), "%02x", _buf[i]);
+    }
+}
+
+String SHA256Builder::toString(void){
+    char out[65];
+    getChars(out);
+    return String(out);
+}
@@ -0,0 +1,45 @@
+/*
+  SHA256Builder.h - SHA-256 in pieces, like MD5Builder
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef __ESP8266_SHA256_BUILDER__
+#define __ESP8266_SHA256_BUILDER__
+
+#include <WString.h>
+#include <Stream.h>
+
+class SHA256Builder {
+  private:
+    uint32_t _state[8];
+    uint64_t _length;
+    uint8_t _block[64];
+    uint8_t _buf[32];
+    void _process(const uint8_t * block);
+  public:
+    void begin(void);
+    void add(const uint8_t * data, size_t len);
+    void add(const char * data){ add((const uint8_t*)data, strlen(data)); }
+    void add(const String& data){ add(data.c_str()); }
+    // reads up to maxLen bytes while the stream has them
+    bool addStream(Stream & stream, const size_t maxLen);
+    void calculate(void);
+    void getBytes(uint8_t * output);
+    void getChars(char * output);
+    String toString(void);
+};
+
+#endif
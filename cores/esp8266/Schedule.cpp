@@ -1,9 +1,19 @@
+#include <Arduino.h>
 #include "Schedule.h"
 
 struct scheduled_fn_t
 {
     scheduled_fn_t* mNext;
     std::function<void(void)> mFunc;
+    // used instead of mFunc when set
+    schedule_fn_ptr_t mPlain;
+    void* mArg;
+    // timed functions only
+    uint64_t mWhen;
+    uint32_t mPeriod;
+    schedule_handle_t mHandle;
+    bool mRecurrent;
+    bool mCancelled;
 };
 
 static scheduled_fn_t* sFirst = 0;
@@ -14,6 +24,34 @@ static scheduled_fn_t* sLastUnused = 0;
 
 static int sCount = 0;
 
+// timed functions, one list per priority sorted by due time, so a pass
+// only looks at the functions that are due
+static scheduled_fn_t* sTimers[SCHEDULE_PRIORITY_LOW + 1];
+// due functions taken off their list, being run
+static scheduled_fn_t* sDue = 0;
+static scheduled_fn_t* sRunning = 0;
+
+static schedule_handle_t sLastHandle = 0;
+
+// how early a timed function may run, see schedule_set_coalesce_us()
+static uint32_t sCoalesceUs = 0;
+
+// functions queued from interrupts: the interrupt handlers only add at
+// sIsrHead, with interrupts masked against each other (there's no atomic
+// compare-and-swap on the lx106), and the loop only takes from sIsrTail
+struct isr_fn_t
+{
+    schedule_fn_ptr_t mFunc;
+    void* mArg;
+};
+
+// one more than can be used, to tell full from empty
+static isr_fn_t sIsrSlots[SCHEDULED_FN_ISR_COUNT + 1];
+static volatile uint8_t sIsrHead = 0;
+static volatile uint8_t sIsrTail = 0;
+
+static void run_timers();
+
 static scheduled_fn_t* get_fn() {
     scheduled_fn_t* result = NULL;
     // try to get an item from unused items list
@@ -27,7 +65,11 @@ static scheduled_fn_t* get_fn() {
     // if no unused items, and count not too high, allocate a new one
     else if (sCount != SCHEDULED_FN_MAX_COUNT) {
         result = new scheduled_fn_t;
+        if (!result) {
+            return NULL;
+        }
         result->mNext = NULL;
+        result->mPlain = NULL;
         ++sCount;
     }
     return result;
@@ -45,13 +87,8 @@ static void recycle_fn(scheduled_fn_t* fn)
     sLastUnused = fn;
 }
 
-bool schedule_function(std::function<void(void)> fn)
+static void queue_fn(scheduled_fn_t* item)
 {
-    scheduled_fn_t* item = get_fn();
-    if (!item) {
-        return false;
-    }
-    item->mFunc = fn;
     item->mNext = NULL;
     if (!sFirst) {
         sFirst = item;
@@ -60,19 +97,233 @@ bool schedule_function(std::function<void(void)> fn)
         sLast->mNext = item;
     }
     sLast = item;
+}
+
+bool schedule_function(std::function<void(void)> fn)
+{
+    scheduled_fn_t* item = get_fn();
+    if (!item) {
+        return false;
+    }
+    item->mFunc = std::move(fn);
+    queue_fn(item);
+    return true;
+}
+
+bool schedule_function(schedule_fn_ptr_t fn, void* arg)
+{
+    scheduled_fn_t* item = get_fn();
+    if (!item) {
+        return false;
+    }
+    item->mPlain = fn;
+    item->mArg = arg;
+    queue_fn(item);
     return true;
 }
 
+bool ICACHE_RAM_ATTR schedule_function_from_isr(schedule_fn_ptr_t fn, void* arg)
+{
+    uint32_t savedPS = xt_rsil(15);
+    uint8_t head = sIsrHead;
+    uint8_t next = (head + 1) % (SCHEDULED_FN_ISR_COUNT + 1);
+    bool queued = next != sIsrTail;
+    if (queued) {
+        sIsrSlots[head].mFunc = fn;
+        sIsrSlots[head].mArg = arg;
+        sIsrHead = next;
+    }
+    xt_wsr_ps(savedPS);
+    return queued;
+}
+
+static void run_isr_functions()
+{
+    // only the ones queued so far, an interrupt firing all the time
+    // mustn't keep the loop here
+    uint8_t head = sIsrHead;
+    uint8_t tail = sIsrTail;
+    while (tail != head) {
+        isr_fn_t slot = sIsrSlots[tail];
+        tail = (tail + 1) % (SCHEDULED_FN_ISR_COUNT + 1);
+        // the slot can be reused from here on
+        sIsrTail = tail;
+        slot.mFunc(slot.mArg);
+    }
+}
+
 void run_scheduled_functions()
 {
+    run_isr_functions();
 	scheduled_fn_t* rFirst = sFirst;
 	sFirst = NULL;
 	sLast  = NULL;
     while (rFirst) {
         scheduled_fn_t* item = rFirst;
         rFirst = item->mNext;
-        item->mFunc();
-        item->mFunc = std::function<void(void)>();
+        if (item->mPlain) {
+            item->mPlain(item->mArg);
+            item->mPlain = NULL;
+        }
+        else {
+            item->mFunc();
+            item->mFunc = std::function<void(void)>();
+        }
         recycle_fn(item);
     }
+    run_timers();
+}
+
+static void insert_timer(scheduled_fn_t* item, schedule_priority_t priority)
+{
+    scheduled_fn_t** link = &sTimers[priority];
+    // after the ones due at the same time, which keeps their order
+    while (*link && (*link)->mWhen <= item->mWhen) {
+        link = &(*link)->mNext;
+    }
+    item->mNext = *link;
+    *link = item;
+}
+
+static schedule_handle_t schedule_timer(uint32_t delay_us, bool recurrent,
+        std::function<void(void)> fn, schedule_priority_t priority)
+{
+    if (priority > SCHEDULE_PRIORITY_LOW) {
+        return 0;
+    }
+    scheduled_fn_t* item = get_fn();
+    if (!item) {
+        return 0;
+    }
+    item->mFunc = std::move(fn);
+    item->mWhen = micros64() + delay_us;
+    item->mPeriod = delay_us;
+    item->mRecurrent = recurrent;
+    item->mCancelled = false;
+    if (++sLastHandle == 0) {
+        ++sLastHandle;
+    }
+    item->mHandle = sLastHandle;
+    insert_timer(item, priority);
+    return item->mHandle;
+}
+
+schedule_handle_t schedule_delayed_function(uint32_t delay_us, std::function<void(void)> fn,
+        schedule_priority_t priority)
+{
+    return schedule_timer(delay_us, false, std::move(fn), priority);
+}
+
+schedule_handle_t schedule_recurrent_function_us(uint32_t period_us, std::function<void(void)> fn,
+        schedule_priority_t priority)
+{
+    return schedule_timer(period_us, true, std::move(fn), priority);
+}
+
+static void release_timer(scheduled_fn_t* item)
+{
+    item->mFunc = std::function<void(void)>();
+    item->mHandle = 0;
+    recycle_fn(item);
+}
+
+bool schedule_cancel(schedule_handle_t handle)
+{
+    if (!handle) {
+        return false;
+    }
+    if (sRunning && sRunning->mHandle == handle) {
+        // a recurrent function stopping itself
+        sRunning->mCancelled = true;
+        return true;
+    }
+    for (scheduled_fn_t* item = sDue; item; item = item->mNext) {
+        if (item->mHandle == handle) {
+            item->mCancelled = true;
+            return true;
+        }
+    }
+    for (int priority = 0; priority <= SCHEDULE_PRIORITY_LOW; ++priority) {
+        for (scheduled_fn_t** link = &sTimers[priority]; *link; link = &(*link)->mNext) {
+            scheduled_fn_t* item = *link;
+            if (item->mHandle == handle) {
+                *link = item->mNext;
+                release_timer(item);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void schedule_set_coalesce_us(uint32_t window_us)
+{
+    sCoalesceUs = window_us;
+}
+
+// when the first of the timed functions is due, UINT64_MAX without any
+static uint64_t first_timer()
+{
+    uint64_t first = UINT64_MAX;
+    for (int priority = 0; priority <= SCHEDULE_PRIORITY_LOW; ++priority) {
+        // the lists are sorted, only their first one matters
+        if (sTimers[priority] && sTimers[priority]->mWhen < first) {
+            first = sTimers[priority]->mWhen;
+        }
+    }
+    return first;
+}
+
+uint32_t schedule_next_due_us()
+{
+    if (sFirst || sIsrHead != sIsrTail) {
+        return 0;
+    }
+    uint64_t now = micros64();
+    uint64_t first = first_timer();
+    if (first <= now) {
+        return 0;
+    }
+    return (first - now < UINT32_MAX) ? (uint32_t)(first - now) : UINT32_MAX;
+}
+
+static void run_timers()
+{
+    // with coalescing, the ones due soon go along with one that is due
+    uint32_t early = (sCoalesceUs && first_timer() <= micros64()) ? sCoalesceUs : 0;
+    for (int priority = 0; priority <= SCHEDULE_PRIORITY_LOW; ++priority) {
+        uint64_t now = micros64();
+        uint64_t until = now + early;
+        // take all the due functions first, so one that is due again
+        // right away (or reschedules) doesn't run twice in a pass
+        scheduled_fn_t** link = &sTimers[priority];
+        while (*link && (*link)->mWhen <= until) {
+            link = &(*link)->mNext;
+        }
+        if (link == &sTimers[priority]) {
+            continue;
+        }
+        sDue = sTimers[priority];
+        sTimers[priority] = *link;
+        *link = NULL;
+        while (sDue) {
+            sRunning = sDue;
+            sDue = sRunning->mNext;
+            if (!sRunning->mCancelled) {
+                sRunning->mFunc();
+            }
+            if (sRunning->mRecurrent && !sRunning->mCancelled) {
+                sRunning->mWhen += sRunning->mPeriod;
+                if (sRunning->mWhen <= now) {
+                    // too late for some periods, skip them
+                    sRunning->mWhen = now + sRunning->mPeriod;
+                }
+                insert_timer(sRunning, (schedule_priority_t) priority);
+            }
+            else {
+                release_timer(sRunning);
+            }
+        }
+        sRunning = NULL;
+    }
 }
@@ -1,11 +1,16 @@
 #ifndef ESP_SCHEDULE_H
 #define ESP_SCHEDULE_H
 
+#include <stdint.h>
 #include <functional>
 
 #define SCHEDULED_FN_MAX_COUNT 32
 #define SCHEDULED_FN_INITIAL_COUNT 4
 
+#ifndef SCHEDULED_FN_ISR_COUNT
+#define SCHEDULED_FN_ISR_COUNT 8
+#endif
+
 // Warning 
 // This API is not considered stable. 
 // Function signatures will change.
@@ -14,11 +19,58 @@
 // Run given function next time `loop` function returns, 
 // or `run_scheduled_functions` is called.
 // Use std::bind to pass arguments to a function, or call a class member function.
-// Note: there is no mechanism for cancelling scheduled functions.
+// Note: there is no mechanism for cancelling these scheduled functions.
 // Keep that in mind when binding functions to objects which may have short lifetime.
 // Returns false if the number of scheduled functions exceeds SCHEDULED_FN_MAX_COUNT.
 bool schedule_function(std::function<void(void)> fn);
 
+// Same, for a plain function called with arg. Unlike a std::function with
+// captures, this never allocates once the queue has grown to the number of
+// pending functions, so it suits frequent events, e.g. from network callbacks.
+typedef void (*schedule_fn_ptr_t)(void* arg);
+bool schedule_function(schedule_fn_ptr_t fn, void* arg);
+
+// Same, callable from an interrupt handler (GPIO, timer1, Ticker...). The
+// function goes into one of SCHEDULED_FN_ISR_COUNT preallocated slots, which
+// are emptied at the start of the next pass. Returns false if all slots are
+// taken.
+bool schedule_function_from_isr(schedule_fn_ptr_t fn, void* arg);
+
+// Run given function from the same place, once after delay_us, or every
+// period_us until it is cancelled. The timed functions come from the same
+// SCHEDULED_FN_MAX_COUNT entries as the ones above. When several are due
+// in the same pass, the ones with a higher priority run first; a function
+// that is late skips the periods it missed instead of running repeatedly.
+// Returns a handle for schedule_cancel(), 0 if the function couldn't be
+// scheduled.
+enum schedule_priority_t
+{
+    SCHEDULE_PRIORITY_HIGH,
+    SCHEDULE_PRIORITY_NORMAL,
+    SCHEDULE_PRIORITY_LOW
+};
+typedef uint32_t schedule_handle_t;
+
+schedule_handle_t schedule_delayed_function(uint32_t delay_us, std::function<void(void)> fn,
+        schedule_priority_t priority = SCHEDULE_PRIORITY_NORMAL);
+schedule_handle_t schedule_recurrent_function_us(uint32_t period_us, std::function<void(void)> fn,
+        schedule_priority_t priority = SCHEDULE_PRIORITY_NORMAL);
+
+// Stop a timed function from running (again), also from inside itself.
+// Returns false if handle is not scheduled anymore.
+bool schedule_cancel(schedule_handle_t handle);
+
+// Let timed functions run up to window_us early, with one that is due
+// already, so that the ones due close together share a pass (and a
+// wake-up, see WiFi.lightSleep()) instead of taking one each. Recurrent
+// functions keep their period. 0, the default, runs each one on time.
+void schedule_set_coalesce_us(uint32_t window_us);
+
+// How long there is nothing to run: 0 if a function is queued or due,
+// UINT32_MAX if none is, neither timed. micros64() goes on through light
+// sleep, so a timed function is not late after it.
+uint32_t schedule_next_due_us();
+
 // Run all scheduled functions. 
 // Use this function if your are not using `loop`, or `loop` does not return
 // on a regular basis.
@@ -33,6 +33,8 @@ int Stream::timedRead() {
         c = read();
         if(c >= 0)
             return c;
+        if(!inputCanTimeout())
+            break;
         yield();
     } while(millis() - _startMillis < _timeout);
     return -1;     // -1 indicates timeout
@@ -41,16 +43,46 @@ int Stream::timedRead() {
 // private method to peek stream with timeout
 int Stream::timedPeek() {
     int c;
+    if(hasPeekBufferAPI()) {
+        if(!timedPeekAvailable())
+            return -1;
+        return (uint8_t) *peekBuffer();
+    }
     _startMillis = millis();
     do {
         c = peek();
         if(c >= 0)
             return c;
+        if(!inputCanTimeout())
+            break;
         yield();
     } while(millis() - _startMillis < _timeout);
     return -1;     // -1 indicates timeout
 }
 
+// waits for data in the peek buffer, returns how much there is or 0 if timeout
+size_t Stream::timedPeekAvailable() {
+    size_t avail;
+    _startMillis = millis();
+    do {
+        avail = peekAvailable();
+        if(avail)
+            return avail;
+        if(!inputCanTimeout())
+            break;
+        yield();
+    } while(millis() - _startMillis < _timeout);
+    return 0;
+}
+
+// consumes the character timedPeek() returned
+void Stream::skipPeeked() {
+    if(hasPeekBufferAPI())
+        peekConsume(1);
+    else
+        read();
+}
+
 // returns peek of the next digit in the stream or -1 if timeout
 // discards non-numeric characters
 int Stream::peekNextDigit() {
@@ -63,7 +95,7 @@ int Stream::peekNextDigit() {
             return c;
         if(c >= '0' && c <= '9')
             return c;
-        read();  // discard non-numeric
+        skipPeeked();  // discard non-numeric
     }
 }
 
@@ -94,6 +126,26 @@ bool Stream::findUntil(const char *target, const char *terminator) {
 // reads data from the stream until the target string of the given length is found
 // search terminated if the terminator string is found
 // returns true if target string is found, false if terminated or timed out
+// one character of findUntil(): 1 when the target is complete, -1 when the
+// terminator is, 0 to go on
+static int findUntilStep(char c, const char *target, size_t targetLen, size_t& index,
+                         const char *terminator, size_t termLen, size_t& termIndex) {
+    if(c != target[index])
+        index = 0; // reset index if any char does not match
+
+    if(c == target[index]) {
+        if(++index >= targetLen) // return true if all chars in the target match
+            return 1;
+    }
+
+    if(termLen > 0 && c == terminator[termIndex]) {
+        if(++termIndex >= termLen)
+            return -1;       // return false if terminate string found before target string
+    } else
+        termIndex = 0;
+    return 0;
+}
+
 bool Stream::findUntil(const char *target, size_t targetLen, const char *terminator, size_t termLen) {
     size_t index = 0;  // maximum target string length is 64k bytes!
     size_t termIndex = 0;
@@ -101,23 +153,44 @@ bool Stream::findUntil(const char *target, size_t targetLen, const char *termina
 
     if(*target == 0)
         return true;   // return true if target is a null string
-    while((c = timedRead()) > 0) {
-
-        if(c != target[index])
-            index = 0; // reset index if any char does not match
 
-        if(c == target[index]) {
-            //////Serial.print("found "); Serial.write(c); Serial.print("index now"); Serial.println(index+1);
-            if(++index >= targetLen) { // return true if all chars in the target match
-                return true;
+    if(hasPeekBufferAPI()) {
+        size_t avail;
+        while((avail = timedPeekAvailable())) {
+            const char* buf = peekBuffer();
+            size_t pos = 0;
+            // nothing can start before the first character of the target
+            if(index == 0 && termIndex == 0) {
+                const char* first = (const char*) memchr(buf, target[0], avail);
+                if(!termLen) {
+                    const char* stop = (const char*) memchr(buf, 0, first ? first - buf : avail);
+                    if(stop) {
+                        peekConsume(stop - buf + 1); // a null ends the search, as timedRead() giving 0
+                        return false;
+                    }
+                    pos = first ? first - buf : avail;
+                }
             }
+            for(; pos < avail; ++pos) {
+                if(buf[pos] == 0) {
+                    peekConsume(pos + 1);
+                    return false;
+                }
+                int step = findUntilStep(buf[pos], target, targetLen, index, terminator, termLen, termIndex);
+                if(step) {
+                    peekConsume(pos + 1);
+                    return step > 0;
+                }
+            }
+            peekConsume(avail);
         }
+        return false;
+    }
 
-        if(termLen > 0 && c == terminator[termIndex]) {
-            if(++termIndex >= termLen)
-                return false;       // return false if terminate string found before target string
-        } else
-            termIndex = 0;
+    while((c = timedRead()) > 0) {
+        int step = findUntilStep(c, target, targetLen, index, terminator, termLen, termIndex);
+        if(step)
+            return step > 0;
     }
     return false;
 }
@@ -148,7 +221,7 @@ long Stream::parseInt(char skipChar) {
             isNegative = true;
         else if(c >= '0' && c <= '9')        // is c a digit?
             value = value * 10 + c - '0';
-        read();  // consume the character we got with peek
+        skipPeeked();  // consume the character we got with peek
         c = timedPeek();
     } while((c >= '0' && c <= '9') || c == skipChar);
 
@@ -188,7 +261,7 @@ float Stream::parseFloat(char skipChar) {
             if(isFraction)
                 fraction *= 0.1;
         }
-        read();  // consume the character we got with peek
+        skipPeeked();  // consume the character we got with peek
         c = timedPeek();
     } while((c >= '0' && c <= '9') || c == '.' || c == skipChar);
 
@@ -207,6 +280,17 @@ float Stream::parseFloat(char skipChar) {
 //
 size_t Stream::readBytes(char *buffer, size_t length) {
     size_t count = 0;
+    if(hasPeekBufferAPI()) {
+        size_t avail;
+        while(count < length && (avail = timedPeekAvailable())) {
+            if(avail > length - count)
+                avail = length - count;
+            memcpy(buffer + count, peekBuffer(), avail);
+            peekConsume(avail);
+            count += avail;
+        }
+        return count;
+    }
     while(count < length) {
         int c = timedRead();
         if(c < 0)
@@ -225,6 +309,22 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
     if(length < 1)
         return 0;
     size_t index = 0;
+    if(hasPeekBufferAPI()) {
+        size_t avail;
+        while(index < length && (avail = timedPeekAvailable())) {
+            const char* buf = peekBuffer();
+            if(avail > length - index)
+                avail = length - index;
+            const char* found = (const char*) memchr(buf, terminator, avail);
+            size_t chunk = found ? found - buf : avail;
+            memcpy(buffer + index, buf, chunk);
+            index += chunk;
+            peekConsume(found ? chunk + 1 : chunk);
+            if(found)
+                break;
+        }
+        return index;
+    }
     while(index < length) {
         int c = timedRead();
         if(c < 0 || c == terminator)
@@ -237,6 +337,15 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
 
 String Stream::readString() {
     String ret;
+    if(hasPeekBufferAPI()) {
+        size_t avail;
+        while((avail = timedPeekAvailable())) {
+            if(!ret.concat(peekBuffer(), avail))
+                break;
+            peekConsume(avail);
+        }
+        return ret;
+    }
     int c = timedRead();
     while(c >= 0) {
         ret += (char) c;
@@ -247,6 +356,20 @@ String Stream::readString() {
 
 String Stream::readStringUntil(char terminator) {
     String ret;
+    if(hasPeekBufferAPI()) {
+        size_t avail;
+        while((avail = timedPeekAvailable())) {
+            const char* buf = peekBuffer();
+            const char* found = (const char*) memchr(buf, terminator, avail);
+            size_t chunk = found ? found - buf : avail;
+            if(!ret.concat(buf, chunk))
+                break;
+            peekConsume(found ? chunk + 1 : chunk);
+            if(found)
+                break;
+        }
+        return ret;
+    }
     int c = timedRead();
     while(c >= 0 && c != terminator) {
         ret += (char) c;
@@ -42,6 +42,8 @@ class Stream: public Print {
         int timedRead();    // private method to read stream with timeout
         int timedPeek();    // private method to peek stream with timeout
         int peekNextDigit(); // returns the next numeric digit in the stream or -1 if timeout
+        size_t timedPeekAvailable(); // waits for buffered data, returns its size or 0 on timeout
+        void skipPeeked(); // drops the character peek() returned
 
     public:
         virtual int available() = 0;
@@ -52,9 +54,35 @@ class Stream: public Print {
             _timeout = 1000;
         }
 
+        // Zero-copy access to data the stream already holds in RAM (a
+        // received pbuf, the serial rx buffer, a file's read buffer): when
+        // hasPeekBufferAPI(), peekBuffer() is valid for peekAvailable()
+        // bytes until peekConsume() or another read. The parsing methods
+        // below then go through the buffer instead of a read() per byte.
+        virtual bool hasPeekBufferAPI() const {
+            return false;
+        }
+        virtual const char* peekBuffer() {
+            return nullptr;
+        }
+        virtual size_t peekAvailable() {
+            return 0;
+        }
+        virtual void peekConsume(size_t consume) {
+            (void) consume;
+        }
+
 // parsing methods
 
         void setTimeout(unsigned long timeout);  // sets maximum milliseconds to wait for stream data, default is 1 second
+        unsigned long getTimeout() const {
+            return _timeout;
+        }
+        // false when waiting won't bring more than is available now (the
+        // end of a file, a closed connection): reads then give up at once
+        virtual bool inputCanTimeout() {
+            return true;
+        }
 
         bool find(const char *target);   // reads data from the stream until the target string is found
         bool find(uint8_t *target) {
@@ -93,7 +121,7 @@ class Stream: public Print {
         // terminates if length characters have been read or timeout (see setTimeout)
         // returns the number of characters placed in the buffer (0 means no valid data found)
 
-        size_t readBytesUntil(char terminator, char *buffer, size_t length); // as readBytes with terminator character
+        virtual size_t readBytesUntil(char terminator, char *buffer, size_t length); // as readBytes with terminator character
         size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) {
             return readBytesUntil(terminator, (char *) buffer, length);
         }
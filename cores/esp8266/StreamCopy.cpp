@@ -0,0 +1,147 @@
+/*
+ StreamCopy.cpp - copying from a Stream to a Print
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Arduino.h>
+#include "StreamCopy.h"
+
+#define STREAMCOPY_STACK_BUFFER 256
+
+static uint8_t* s_buffer = nullptr;
+static size_t s_bufferSize = 0;
+static bool s_bufferUsed = false;
+
+bool streamCopyBuffer(size_t size) {
+    if (s_bufferUsed) {
+        return false;
+    }
+    free(s_buffer);
+    s_buffer = nullptr;
+    s_bufferSize = 0;
+    if (size == 0) {
+        return true;
+    }
+    s_buffer = (uint8_t*) malloc(size);
+    if (!s_buffer) {
+        return false;
+    }
+    s_bufferSize = size;
+    return true;
+}
+
+size_t streamCopy(Stream& src, Print& dst, size_t len) {
+    return streamCopy(src, dst, len, src.getTimeout());
+}
+
+size_t streamCopy(Stream& src, Print& dst, size_t len, unsigned long timeout,
+                  StreamCopyStats* stats) {
+    uint8_t stackBuffer[STREAMCOPY_STACK_BUFFER];
+    uint8_t* buffer = stackBuffer;
+    size_t bufferSize = sizeof(stackBuffer);
+    bool shared = false;
+    bool zeroCopy = src.hasPeekBufferAPI();
+    if (!zeroCopy && s_buffer && !s_bufferUsed) {
+        buffer = s_buffer;
+        bufferSize = s_bufferSize;
+        s_bufferUsed = shared = true;
+    }
+
+    StreamCopyResult result = STREAMCOPY_DONE;
+    size_t copied = 0;
+    size_t pending = 0;     // read into the buffer, not written yet
+    size_t pendingOff = 0;
+    uint32_t waits = 0;
+    uint32_t start = millis();
+    uint32_t lastProgress = start;
+    while (copied < len) {
+        const uint8_t* data;
+        size_t size;
+        if (zeroCopy) {
+            size = src.peekAvailable();
+            data = (const uint8_t*) src.peekBuffer();
+        } else {
+            if (!pending) {
+                int available = src.available();
+                size = (available > 0) ? available : 0;
+                if (size > bufferSize) {
+                    size = bufferSize;
+                }
+                if (size > len - copied) {
+                    size = len - copied;
+                }
+                pendingOff = 0;
+                pending = size ? src.readBytes(buffer, size) : 0;
+            }
+            size = pending;
+            data = buffer + pendingOff;
+        }
+
+        if (!size) {
+            if (!src.inputCanTimeout()) {
+                result = STREAMCOPY_END;
+                break;
+            }
+            if (millis() - lastProgress >= timeout) {
+                result = STREAMCOPY_SOURCE_TIMEOUT;
+                break;
+            }
+            ++waits;
+            yield();
+            continue;
+        }
+
+        if (size > len - copied) {
+            size = len - copied;
+        }
+        size_t written = dst.write(data, size);
+        if (zeroCopy) {
+            src.peekConsume(written);
+        } else {
+            pending -= written;
+            pendingOff += written;
+        }
+        copied += written;
+        if (dst.getWriteError()) {
+            result = STREAMCOPY_WRITE_ERROR;
+            break;
+        }
+        if (written) {
+            lastProgress = millis();
+            yield_budget(YIELD_OP_STREAM);
+        } else {
+            if (millis() - lastProgress >= timeout) {
+                result = STREAMCOPY_WRITE_TIMEOUT;
+                break;
+            }
+            ++waits;
+            yield();
+        }
+    }
+
+    if (shared) {
+        s_bufferUsed = false;
+    }
+    if (stats) {
+        stats->bytes = copied;
+        stats->ms = millis() - start;
+        stats->waits = waits;
+        stats->zeroCopy = zeroCopy;
+        stats->result = result;
+    }
+    return copied;
+}
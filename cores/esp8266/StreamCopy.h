@@ -0,0 +1,67 @@
+/*
+ StreamCopy.h - copying from a Stream to a Print
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __streamcopy_h
+#define __streamcopy_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Stream.h"
+
+enum StreamCopyResult {
+    STREAMCOPY_DONE,           // len bytes were copied
+    STREAMCOPY_END,            // the source has no more (end of file, connection closed)
+    STREAMCOPY_SOURCE_TIMEOUT, // nothing came from the source for timeout ms
+    STREAMCOPY_WRITE_TIMEOUT,  // the destination took nothing for timeout ms
+    STREAMCOPY_WRITE_ERROR     // the destination set its write error
+};
+
+struct StreamCopyStats {
+    size_t bytes;
+    uint32_t ms;
+    uint32_t waits;     // times one of the sides had to be waited for
+    bool zeroCopy;      // written straight from the source's peek buffer
+    StreamCopyResult result;
+
+    uint32_t bytesPerSecond() const {
+        return ms ? (uint32_t) ((uint64_t) bytes * 1000 / ms) : 0;
+    }
+};
+
+// Copies up to len bytes from src to dst, SIZE_MAX for all there is, and
+// returns how many. A source with a peek buffer (see Stream) is written out
+// from there without a copy; others go through a buffer, of 256 bytes on
+// the stack unless streamCopyBuffer() set one up. Waiting for either side
+// yields; the copy stops after timeout ms without progress (the source's
+// setTimeout() when not given), or at once when an empty source says its
+// input can't time out, which is how the end of a file or of a closed
+// connection is told from data still on its way. Between blocks it yields
+// only when it has kept the CPU for a while. On a write timeout or error,
+// what was read from a source without a peek buffer and not written is
+// lost.
+size_t streamCopy(Stream& src, Print& dst, size_t len = SIZE_MAX);
+size_t streamCopy(Stream& src, Print& dst, size_t len, unsigned long timeout,
+                  StreamCopyStats* stats = nullptr);
+
+// Have copies from sources without a peek buffer go through size bytes
+// taken from the heap once and kept, instead of 256 on the stack. A copy
+// started while another has it uses the stack. 0 frees it.
+bool streamCopyBuffer(size_t size);
+
+#endif//__streamcopy_h
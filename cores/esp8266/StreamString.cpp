@@ -25,10 +25,10 @@
 
 size_t StreamString::write(const uint8_t *data, size_t size) {
     if(size && data) {
-        if(reserve(length() + size + 1)) {
-            memcpy((void *) (buffer + len), (const void *) data, size);
-            len += size;
-            *(buffer + len) = 0x00; // add null for string end
+        if(growTo(length() + size + 1)) {
+            memcpy((void *) (wbuffer() + len()), (const void *) data, size);
+            setLen(len() + size);
+            *(wbuffer() + len()) = 0x00; // add null for string end
             return size;
         }
     }
@@ -64,3 +64,15 @@ int StreamString::peek() {
 void StreamString::flush() {
 }
 
+const char* StreamString::peekBuffer() {
+    return c_str();
+}
+
+size_t StreamString::peekAvailable() {
+    return length();
+}
+
+void StreamString::peekConsume(size_t consume) {
+    remove(0, consume);
+}
+
@@ -33,6 +33,18 @@ public:
     int read() override;
     int peek() override;
     void flush() override;
+
+    bool inputCanTimeout() override {
+        return false;
+    }
+
+    // the string itself; consuming removes from its start
+    bool hasPeekBufferAPI() const override {
+        return true;
+    }
+    const char* peekBuffer() override;
+    size_t peekAvailable() override;
+    void peekConsume(size_t consume) override;
 };
 
 
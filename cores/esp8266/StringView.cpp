@@ -0,0 +1,152 @@
+/*
+ StringView.cpp - non-owning view of a run of characters
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <ctype.h>
+#include "StringView.h"
+
+StringView StringView::substring(size_t beginIndex, size_t endIndex) const {
+    if(beginIndex > endIndex) {
+        size_t temp = endIndex;
+        endIndex = beginIndex;
+        beginIndex = temp;
+    }
+    if(beginIndex > _len) {
+        beginIndex = _len;
+    }
+    if(endIndex > _len) {
+        endIndex = _len;
+    }
+    StringView ret(*this);
+    ret._data += beginIndex;
+    ret._len = endIndex - beginIndex;
+    return ret;
+}
+
+StringView StringView::trim() const {
+    size_t begin = 0;
+    size_t end = _len;
+    while(begin < end && isspace((*this)[begin])) {
+        begin++;
+    }
+    while(end > begin && isspace((*this)[end - 1])) {
+        end--;
+    }
+    return substring(begin, end);
+}
+
+int StringView::indexOf(char ch, size_t fromIndex) const {
+    if(!_progmem) {
+        if(fromIndex >= _len) {
+            return -1;
+        }
+        const char* found = (const char*) memchr(_data + fromIndex, ch, _len - fromIndex);
+        return found ? found - _data : -1;
+    }
+    for(size_t i = fromIndex; i < _len; i++) {
+        if((*this)[i] == ch) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int StringView::indexOf(const StringView& str, size_t fromIndex) const {
+    if(str._len > _len) {
+        return -1;
+    }
+    for(size_t i = fromIndex; i <= _len - str._len; i++) {
+        if(regionMatches(i, str, false)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int StringView::lastIndexOf(char ch) const {
+    for(size_t i = _len; i > 0; i--) {
+        if((*this)[i - 1] == ch) {
+            return i - 1;
+        }
+    }
+    return -1;
+}
+
+bool StringView::regionMatches(size_t offset, const StringView& str, bool ignoreCase) const {
+    if(offset > _len || str._len > _len - offset) {
+        return false;
+    }
+    if(!ignoreCase && !_progmem) {
+        if(!str._progmem) {
+            return memcmp(_data + offset, str._data, str._len) == 0;
+        }
+        return memcmp_P(_data + offset, str._data, str._len) == 0;
+    }
+    for(size_t i = 0; i < str._len; i++) {
+        char a = (*this)[offset + i];
+        char b = str[i];
+        if(a != b && (!ignoreCase || tolower(a) != tolower(b))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StringView::equals(const StringView& str) const {
+    return _len == str._len && regionMatches(0, str, false);
+}
+
+bool StringView::equalsIgnoreCase(const StringView& str) const {
+    return _len == str._len && regionMatches(0, str, true);
+}
+
+bool StringView::startsWith(const StringView& prefix) const {
+    return regionMatches(0, prefix, false);
+}
+
+bool StringView::endsWith(const StringView& suffix) const {
+    return suffix._len <= _len && regionMatches(_len - suffix._len, suffix, false);
+}
+
+long StringView::toInt() const {
+    size_t i = 0;
+    while(i < _len && isspace((*this)[i])) {
+        i++;
+    }
+    bool negative = false;
+    if(i < _len && ((*this)[i] == '-' || (*this)[i] == '+')) {
+        negative = (*this)[i] == '-';
+        i++;
+    }
+    long value = 0;
+    for(; i < _len && isdigit((*this)[i]); i++) {
+        value = value * 10 + ((*this)[i] - '0');
+    }
+    return negative ? -value : value;
+}
+
+String StringView::toString() const {
+    String ret;
+    if(!ret.reserve(_len)) {
+        return ret;
+    }
+    for(size_t i = 0; i < _len; i++) {
+        ret += (*this)[i];
+    }
+    return ret;
+}
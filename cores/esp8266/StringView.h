@@ -0,0 +1,110 @@
+/*
+ StringView.h - non-owning view of a run of characters
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __stringview_h
+#define __stringview_h
+
+#include <stddef.h>
+#include <string.h>
+#include <pgmspace.h>
+#include "WString.h"
+
+// Pointer and length into characters owned by someone else: a String, a
+// C string, a received buffer or a string in flash (F() / FPSTR()).
+// Cutting it with substring() or trim() copies nothing, so a parser can
+// look at its input without allocating, and only call toString() for the
+// parts it keeps. The characters don't have to be 0-terminated, and the
+// view must not outlive them.
+class StringView {
+    public:
+        StringView() : _data(""), _len(0), _progmem(false) {}
+        StringView(const char* cstr) :
+            _data(cstr ? cstr : ""), _len(cstr ? strlen(cstr) : 0), _progmem(false) {}
+        StringView(const char* data, size_t len) :
+            _data(data), _len(data ? len : 0), _progmem(false) {}
+        StringView(const String& str) :
+            _data(str.c_str()), _len(str.length()), _progmem(false) {}
+        StringView(const __FlashStringHelper* str) :
+            _data(str ? (PGM_P) str : ""), _len(str ? strlen_P((PGM_P) str) : 0), _progmem(str != nullptr) {}
+
+        static StringView P(PGM_P data, size_t len) {
+            StringView ret(data, len);
+            ret._progmem = true;
+            return ret;
+        }
+
+        size_t length() const {
+            return _len;
+        }
+        bool isEmpty() const {
+            return _len == 0;
+        }
+        // not 0-terminated, and in flash when isProgmem()
+        const char* data() const {
+            return _data;
+        }
+        bool isProgmem() const {
+            return _progmem;
+        }
+
+        char operator[](size_t index) const {
+            return _progmem ? pgm_read_byte(_data + index) : _data[index];
+        }
+        char charAt(size_t index) const {
+            return index < _len ? (*this)[index] : 0;
+        }
+
+        // same bounds handling as String::substring
+        StringView substring(size_t beginIndex) const {
+            return substring(beginIndex, _len);
+        }
+        StringView substring(size_t beginIndex, size_t endIndex) const;
+        // without the leading and trailing white space
+        StringView trim() const;
+
+        int indexOf(char ch, size_t fromIndex = 0) const;
+        int indexOf(const StringView& str, size_t fromIndex = 0) const;
+        int lastIndexOf(char ch) const;
+
+        bool equals(const StringView& str) const;
+        bool equalsIgnoreCase(const StringView& str) const;
+        bool startsWith(const StringView& prefix) const;
+        bool endsWith(const StringView& suffix) const;
+
+        // leading white space and sign as atol(), 0 without digits
+        long toInt() const;
+        // owning copy, for the parts that are kept
+        String toString() const;
+
+        bool operator ==(const StringView& rhs) const {
+            return equals(rhs);
+        }
+        bool operator !=(const StringView& rhs) const {
+            return !equals(rhs);
+        }
+
+    private:
+        bool regionMatches(size_t offset, const StringView& str, bool ignoreCase) const;
+
+        const char* _data;
+        size_t _len;
+        bool _progmem;
+};
+
+#endif//__stringview_h
@@ -0,0 +1,360 @@
+/*
+ TarExtractor.cpp - unpacking a tar archive into a file system as it arrives
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+#include "TarExtractor.h"
+
+// ustar header fields, offset and length
+#define TAR_NAME      0, 100
+#define TAR_SIZE      124, 12
+#define TAR_CHECKSUM  148, 8
+#define TAR_TYPE      156
+#define TAR_MAGIC     257
+#define TAR_PREFIX    345, 155
+
+static uint32_t octal(const uint8_t* block, size_t offset, size_t length)
+{
+    uint32_t value = 0;
+    const uint8_t* p = block + offset;
+    const uint8_t* end = p + length;
+    while (p < end && *p == ' ') {
+        ++p;
+    }
+    while (p < end && *p >= '0' && *p <= '7') {
+        value = (value << 3) | (*p++ - '0');
+    }
+    return value;
+}
+
+static String field(const uint8_t* block, size_t offset, size_t length)
+{
+    const char* p = reinterpret_cast<const char*>(block) + offset;
+    size_t len = 0;
+    while (len < length && p[len]) {
+        ++len;
+    }
+    String s;
+    s.reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+        s += p[i];
+    }
+    return s;
+}
+
+TarExtractor::TarExtractor(fs::FS& fs, const char* root)
+    : _fs(fs), _root(root)
+{
+    if (!_root.endsWith("/")) {
+        _root += '/';
+    }
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+TarExtractor::~TarExtractor()
+{
+    abort();
+}
+
+bool TarExtractor::begin()
+{
+    abort();
+    _buf = new uint8_t[TAR_EXTRACTOR_BUFFER];
+    if (!_buf) {
+        _error = TAR_ERROR_MEMORY;
+        return false;
+    }
+    memset(&_stats, 0, sizeof(_stats));
+    _error = TAR_OK;
+    _state = ST_HEADER;
+    _blockLen = 0;
+    _path = String();
+    // left over by an archive that stopped part way
+    _fs.remove(TAR_EXTRACTOR_TEMP);
+    return true;
+}
+
+size_t TarExtractor::write(const uint8_t* data, size_t size)
+{
+    size_t taken = 0;
+    while (taken < size && _state != ST_FAILED) {
+        const uint8_t* p = data + taken;
+        size_t n = size - taken;
+        size_t used = 0;
+        switch (_state) {
+        case ST_HEADER:
+            used = (n < sizeof(_block) - _blockLen) ? n : sizeof(_block) - _blockLen;
+            memcpy(_block + _blockLen, p, used);
+            _blockLen += used;
+            if (_blockLen == sizeof(_block)) {
+                _blockLen = 0;
+                _header();
+            }
+            break;
+        case ST_COMPARE:
+            used = _compare(p, (n < _left) ? n : _left);
+            break;
+        case ST_WRITE:
+            used = _store(p, (n < _left) ? n : _left);
+            break;
+        case ST_SKIP:
+            used = (n < _left) ? n : _left;
+            _left -= used;
+            if (!_left) {
+                _endData();
+            }
+            break;
+        case ST_PADDING:
+            used = (n < _padding) ? n : _padding;
+            _padding -= used;
+            if (!_padding) {
+                _state = ST_HEADER;
+            }
+            break;
+        case ST_END:
+            used = n;
+            break;
+        case ST_FAILED:
+            break;
+        }
+        taken += used;
+    }
+    _stats.bytes += taken;
+    return (_state == ST_FAILED) ? 0 : size;
+}
+
+bool TarExtractor::end(uint32_t gc_budget_us)
+{
+    if (_state != ST_FAILED && _state != ST_END && !(_state == ST_HEADER && !_blockLen)) {
+        _fail(TAR_ERROR_TRUNCATED);
+    }
+    abort();
+    if (gc_budget_us) {
+        _fs.gc(gc_budget_us);
+    }
+    return _error == TAR_OK;
+}
+
+void TarExtractor::abort()
+{
+    _old.close();
+    if (_out) {
+        _out.close();
+        _fs.remove(TAR_EXTRACTOR_TEMP);
+    }
+    delete[] _buf;
+    _buf = nullptr;
+    _bufLen = 0;
+    _bufPos = 0;
+    _state = ST_FAILED;
+}
+
+void TarExtractor::_header()
+{
+    uint32_t sum = 0;
+    bool zero = true;
+    for (size_t i = 0; i < sizeof(_block); ++i) {
+        zero = zero && !_block[i];
+        // the checksum field counts as spaces
+        sum += (i >= 148 && i < 156) ? ' ' : _block[i];
+    }
+    if (zero) {
+        _state = ST_END;
+        return;
+    }
+    _path = String();
+    if (memcmp(_block + TAR_MAGIC, "ustar", 5) != 0 || octal(_block, TAR_CHECKSUM) != sum) {
+        _fail(TAR_ERROR_HEADER);
+        return;
+    }
+
+    size_t size = octal(_block, TAR_SIZE);
+    _padding = (sizeof(_block) - size % sizeof(_block)) % sizeof(_block);
+    uint8_t type = _block[TAR_TYPE];
+    if (type != '0' && type != 0) {
+        ++_stats.skipped;
+        _left = size;
+        if (_left) {
+            _state = ST_SKIP;
+        } else {
+            _endData();
+        }
+        return;
+    }
+
+    String name = field(_block, TAR_PREFIX);
+    if (name.length()) {
+        name += '/';
+    }
+    name += field(_block, TAR_NAME);
+    while (name.startsWith("./") || name.startsWith("/")) {
+        name.remove(0, name[0] == '/' ? 1 : 2);
+    }
+    _path = _root + name;
+    if (!name.length()) {
+        _fail(TAR_ERROR_HEADER);
+        return;
+    }
+    ++_stats.files;
+    _startFile(size);
+}
+
+void TarExtractor::_startFile(size_t size)
+{
+    _left = size;
+    _offset = 0;
+    _bufLen = 0;
+    _bufPos = 0;
+    _old = _fs.open(_path, "r");
+    if (_old && _old.size() == size) {
+        _state = ST_COMPARE;
+    } else if (!_startWrite()) {
+        return;
+    }
+    if (!_left) {
+        _endData();
+    }
+}
+
+// Opens the temporary file, with what was the same so far copied over.
+bool TarExtractor::_startWrite()
+{
+    _out = _fs.open(TAR_EXTRACTOR_TEMP, "w");
+    if (!_out) {
+        _fail(TAR_ERROR_WRITE);
+        return false;
+    }
+    if (_offset) {
+        _old.seek(0, fs::SeekSet);
+        for (size_t left = _offset; left; ) {
+            size_t n = (left < TAR_EXTRACTOR_BUFFER) ? left : TAR_EXTRACTOR_BUFFER;
+            if (_old.read(_buf, n) != n || _out.write(_buf, n) != n) {
+                _fail(TAR_ERROR_WRITE);
+                return false;
+            }
+            left -= n;
+        }
+    }
+    _old.close();
+    _bufLen = 0;
+    _bufPos = 0;
+    _state = ST_WRITE;
+    return true;
+}
+
+size_t TarExtractor::_compare(const uint8_t* data, size_t size)
+{
+    size_t used = 0;
+    while (used < size) {
+        if (_bufPos == _bufLen) {
+            size_t want = (_left < TAR_EXTRACTOR_BUFFER) ? _left : TAR_EXTRACTOR_BUFFER;
+            _bufLen = _old.read(_buf, want);
+            _bufPos = 0;
+            if (_bufLen != want) {
+                _startWrite();
+                return used;
+            }
+        }
+        size_t n = size - used;
+        if (n > _bufLen - _bufPos) {
+            n = _bufLen - _bufPos;
+        }
+        if (memcmp(_buf + _bufPos, data + used, n) != 0) {
+            // the rest goes to the new file, from where they were the same
+            _startWrite();
+            return used;
+        }
+        _bufPos += n;
+        _offset += n;
+        _left -= n;
+        used += n;
+    }
+    if (!_left) {
+        _endData();
+    }
+    return used;
+}
+
+size_t TarExtractor::_store(const uint8_t* data, size_t size)
+{
+    size_t used = 0;
+    while (used < size) {
+        size_t n = size - used;
+        if (!_bufLen && n >= TAR_EXTRACTOR_BUFFER) {
+            // whole buffers straight from the caller's data
+            n -= n % TAR_EXTRACTOR_BUFFER;
+            if (_out.write(data + used, n) != n) {
+                _fail(TAR_ERROR_WRITE);
+                return used;
+            }
+        } else {
+            if (n > TAR_EXTRACTOR_BUFFER - _bufLen) {
+                n = TAR_EXTRACTOR_BUFFER - _bufLen;
+            }
+            memcpy(_buf + _bufLen, data + used, n);
+            _bufLen += n;
+            if (_bufLen == TAR_EXTRACTOR_BUFFER && !_flush()) {
+                return used;
+            }
+        }
+        _offset += n;
+        _left -= n;
+        used += n;
+    }
+    if (!_left) {
+        _endData();
+    }
+    return used;
+}
+
+bool TarExtractor::_flush()
+{
+    if (_bufLen && _out.write(_buf, _bufLen) != _bufLen) {
+        _fail(TAR_ERROR_WRITE);
+        return false;
+    }
+    _bufLen = 0;
+    return true;
+}
+
+// The entry's data is all there: puts the file in place.
+void TarExtractor::_endData()
+{
+    if (_state == ST_COMPARE) {
+        _old.close();
+        ++_stats.unchanged;
+    } else if (_state == ST_WRITE) {
+        if (!_flush()) {
+            return;
+        }
+        _out.close();
+        _fs.remove(_path);
+        if (!_fs.rename(TAR_EXTRACTOR_TEMP, _path)) {
+            _fail(TAR_ERROR_WRITE);
+            return;
+        }
+        ++_stats.written;
+    }
+    _state = _padding ? ST_PADDING : ST_HEADER;
+}
+
+void TarExtractor::_fail(TarExtractorError error)
+{
+    _error = error;
+    abort();
+}
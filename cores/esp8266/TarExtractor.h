@@ -0,0 +1,140 @@
+/*
+ TarExtractor.h - unpacking a tar archive into a file system as it arrives
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TAR_EXTRACTOR_H
+#define TAR_EXTRACTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FS.h"
+#include "Print.h"
+#include "WString.h"
+
+// file data collected before it is written, and read at a time to compare
+#ifndef TAR_EXTRACTOR_BUFFER
+#define TAR_EXTRACTOR_BUFFER 1024
+#endif
+
+// what a file is written to until all of it is there
+#define TAR_EXTRACTOR_TEMP "/.tar~"
+
+enum TarExtractorError {
+    TAR_OK,
+    TAR_ERROR_HEADER,       // not a ustar header, or a bad checksum
+    TAR_ERROR_WRITE,        // a file couldn't be written (name too long, no space)
+    TAR_ERROR_TRUNCATED,    // end() came in the middle of an entry
+    TAR_ERROR_MEMORY
+};
+
+struct TarExtractorStats {
+    size_t files;       // regular files in the archive
+    size_t written;     // the ones that were new or differed
+    size_t unchanged;   // the ones already there with the same contents
+    size_t skipped;     // entries that aren't regular files
+    size_t bytes;       // of the archive taken so far
+};
+
+/*
+ Takes a tar archive (the ustar format of `tar --format=ustar`) through
+ write(), in pieces of any size, and puts the regular files it holds
+ under root: an upload or a stream goes through without being kept
+ anywhere. Directories and other entries are skipped; the directories of
+ a path just become part of the file name.
+
+ A file that is there already with the same size is compared as the
+ archive goes by, with no hash to keep in either place, and left alone
+ if it is the same. Others are written in TAR_EXTRACTOR_BUFFER pieces to
+ TAR_EXTRACTOR_TEMP and renamed once complete, so a file is either the
+ old or the new one, even if the archive stops part way. end() collects
+ the garbage once at the end, instead of a little before each file.
+*/
+class TarExtractor : public Print
+{
+public:
+    TarExtractor(fs::FS& fs, const char* root = "/");
+    virtual ~TarExtractor();
+
+    bool begin();
+    size_t write(const uint8_t* data, size_t size) override;
+    size_t write(uint8_t c) override
+    {
+        return write(&c, 1);
+    }
+    // There is no more: false if the archive stopped in the middle of an
+    // entry, or something failed before. Then collects garbage for up to
+    // gc_budget_us (see FS::gc()), 0 to leave it to later writes.
+    bool end(uint32_t gc_budget_us = 2000000);
+    // Drop the file being written and stop.
+    void abort();
+
+    TarExtractorError error() const
+    {
+        return _error;
+    }
+    // the file the error is about, if any
+    const String& errorPath() const
+    {
+        return _path;
+    }
+    const TarExtractorStats& stats() const
+    {
+        return _stats;
+    }
+
+protected:
+    enum State {
+        ST_HEADER,
+        ST_COMPARE,     // file data, the same as the old file so far
+        ST_WRITE,       // file data, going to the temporary file
+        ST_SKIP,        // the data of an entry that isn't a file
+        ST_PADDING,     // up to the next 512 byte block
+        ST_END,         // after the zero blocks
+        ST_FAILED
+    };
+
+    void _header();
+    void _startFile(size_t size);
+    bool _startWrite();
+    size_t _compare(const uint8_t* data, size_t size);
+    size_t _store(const uint8_t* data, size_t size);
+    bool _flush();
+    void _endData();
+    void _fail(TarExtractorError error);
+
+    fs::FS& _fs;
+    String _root;
+    State _state = ST_FAILED;
+    TarExtractorError _error = TAR_OK;
+    TarExtractorStats _stats;
+
+    uint8_t _block[512];
+    size_t _blockLen = 0;
+    size_t _left = 0;       // of the entry's data
+    size_t _padding = 0;
+    size_t _offset = 0;     // in the file
+
+    String _path;
+    fs::File _old;
+    fs::File _out;
+    uint8_t* _buf = nullptr;
+    size_t _bufLen = 0;     // written: what waits in _buf; compared: what was read
+    size_t _bufPos = 0;     // compared: how far into _buf
+};
+
+#endif //TAR_EXTRACTOR_H
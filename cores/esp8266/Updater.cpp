@@ -1,6 +1,11 @@
 #include "Updater.h"
 #include "Arduino.h"
+#include "Inflater.h"
+#include "FlashQueue.h"
+#include "DeltaPatcher.h"
+#include "SHA256Builder.h"
 #include "eboot_command.h"
+#include "coredecls.h"
 #include "interrupts.h"
 #include "esp8266_peri.h"
 
@@ -13,16 +18,89 @@ extern "C" {
 }
 
 extern "C" uint32_t _SPIFFS_start;
+extern "C" uint32_t _SPIFFS_end;
+
+#define GZIP_MAGIC_0 0x1f
+#define GZIP_MAGIC_1 0x8b
+
+// reads size bytes at any flash address; flashRead wants whole aligned words
+static bool flashReadBytes(uint32_t address, uint8_t* dst, size_t size) {
+  while(size) {
+    uint32_t words[17];
+    uint32_t aligned = address & ~3;
+    size_t piece = (size < sizeof(words) - 4) ? size : sizeof(words) - 4;
+    size_t readSize = (address + piece - aligned + 3) & ~3;
+    if(!ESP.flashRead(aligned, words, readSize))
+      return false;
+    memcpy(dst, (uint8_t*)words + (address - aligned), piece);
+    address += piece;
+    dst += piece;
+    size -= piece;
+  }
+  return true;
+}
+
+// decompresses into the Updater's buffer, reading older output back from
+// the flash it was written to
+class UpdaterInflater : public Inflater {
+  public:
+    UpdaterInflater(UpdaterClass& updater) : _updater(updater) {}
+
+  protected:
+    bool output(const uint8_t* data, size_t size) override {
+      return _updater._decoded(data, size);
+    }
+    bool history(size_t pos, uint8_t* dst, size_t size) override {
+      return _updater._readWritten(pos, dst, size);
+    }
+
+    UpdaterClass& _updater;
+};
+
+// applies a patch to the running sketch, at the start of the flash or of
+// its slot
+class UpdaterPatcher : public DeltaPatcher {
+  public:
+    UpdaterPatcher(UpdaterClass& updater) : _updater(updater) {}
+
+  protected:
+    bool header() override {
+      return _updater._checkPatch();
+    }
+    bool source(size_t pos, uint8_t* dst, size_t size) override {
+      return flashReadBytes(app_slot_address(app_slot_current()) + pos, dst, size);
+    }
+    bool output(const uint8_t* data, size_t size) override {
+      return _updater._image(data, size);
+    }
+
+    UpdaterClass& _updater;
+};
 
 UpdaterClass::UpdaterClass()
 : _async(false)
 , _error(0)
 , _buffer(0)
 , _bufferLen(0)
+, _bufferSizeWanted(0)
 , _size(0)
 , _startAddress(0)
 , _currentAddress(0)
+, _erasedAddress(0)
+, _resumePoint(0)
+, _hashedAddress(0)
+, _eraseAhead(false)
+, _decompressAtBoot(false)
+, _bootGzip(false)
+, _inputChecked(false)
+, _decoding(false)
+, _inflater(0)
+, _patcher(0)
+, _imageChecked(false)
+, _inSize(0)
+, _inPos(0)
 , _command(U_FLASH)
+, _sha256(0)
 {
 }
 
@@ -31,8 +109,20 @@ void UpdaterClass::_reset() {
     delete[] _buffer;
   _buffer = 0;
   _bufferLen = 0;
+  delete _inflater;
+  _inflater = 0;
+  delete _patcher;
+  _patcher = 0;
+  _decoding = false;
+  _bootGzip = false;
+  _inputChecked = false;
+  _imageChecked = false;
+  _inSize = 0;
+  _inPos = 0;
   _startAddress = 0;
   _currentAddress = 0;
+  _erasedAddress = 0;
+  _hashedAddress = 0;
   _size = 0;
   _command = U_FLASH;
 }
@@ -74,11 +164,23 @@ bool UpdaterClass::begin(size_t size, int command) {
 
   _reset();
   clearError(); //  _error = 0
+  _resumePoint = 0;
+  delete _sha256;
+  _sha256 = 0;
+  _target_sha256 = String();
 
   wifi_set_sleep_type(NONE_SLEEP_T);
 
   uint32_t updateStartAddress = 0;
-  if (command == U_FLASH) {
+  if (command == U_FLASH && app_slot_current() >= 0) {
+    // A/B layout: the other slot, eboot won't have to copy it
+    updateStartAddress = app_slot_address(!app_slot_current());
+    if(size > EBOOT_SLOT_SIZE) {
+      _setError(UPDATE_ERROR_SPACE);
+      return false;
+    }
+  }
+  else if (command == U_FLASH) {
     //size of current sketch rounded to a sector
     uint32_t currentSketchSize = (ESP.getSketchSize() + FLASH_SECTOR_SIZE - 1) & (~(FLASH_SECTOR_SIZE - 1));
     //address of the end of the space available for sketch and update
@@ -114,8 +216,12 @@ bool UpdaterClass::begin(size_t size, int command) {
   //initialize
   _startAddress = updateStartAddress;
   _currentAddress = _startAddress;
+  _erasedAddress = _startAddress;
+  _hashedAddress = _startAddress;
   _size = size;
-  if (ESP.getFreeHeap() > 2 * FLASH_SECTOR_SIZE) {
+  if (_bufferSizeWanted > FLASH_SECTOR_SIZE && ESP.getFreeHeap() > _bufferSizeWanted + FLASH_SECTOR_SIZE) {
+    _bufferSize = _bufferSizeWanted;
+  } else if (ESP.getFreeHeap() > 2 * FLASH_SECTOR_SIZE) {
     _bufferSize = FLASH_SECTOR_SIZE;
   } else {
     _bufferSize = 256;
@@ -133,6 +239,103 @@ bool UpdaterClass::begin(size_t size, int command) {
   return true;
 }
 
+bool UpdaterClass::setBufferSize(size_t size){
+  if(_size > 0)
+    return false;
+  _bufferSizeWanted = size & (~(FLASH_SECTOR_SIZE - 1));
+  return true;
+}
+
+bool UpdaterClass::resume(size_t written){
+  if(hasError() || !isRunning() || _inputChecked || _currentAddress != _startAddress)
+    return false;
+  if(written > _size || (written & (FLASH_SECTOR_SIZE - 1))) {
+    _setError(UPDATE_ERROR_SIZE);
+    return false;
+  }
+  // what is there gets hashed from the flash like everything written
+  uint32_t magic;
+  if(written && !ESP.flashRead(_startAddress, &magic, sizeof(magic))) {
+    _setError(UPDATE_ERROR_READ);
+    return false;
+  }
+  bool gzip = written && _canDecompressAtBoot() && (magic & 0xffff) == (GZIP_MAGIC_1 << 8 | GZIP_MAGIC_0);
+  if(written && _command == U_FLASH && (magic & 0xff) != 0xE9 && !gzip) {
+    _setError(UPDATE_ERROR_MAGIC_BYTE);
+    return false;
+  }
+  _bootGzip = gzip;
+  _inputChecked = true;
+  _currentAddress = _startAddress + written;
+  _erasedAddress = _currentAddress;
+  _resumePoint = written;
+#ifdef DEBUG_UPDATER
+  DEBUG_UPDATER.printf("[resume] from 0x%08X\n", _currentAddress);
+#endif
+  return true;
+}
+
+bool UpdaterClass::hashNext(size_t bytes){
+  if(hasError() || !isRunning())
+    return false;
+  // read back from the flash, so the hashes are of what is really there
+  uint32_t words[64];
+  while(bytes && _hashedAddress < _currentAddress) {
+    size_t piece = _currentAddress - _hashedAddress;
+    if(piece > sizeof(words))
+      piece = sizeof(words);
+    if(piece > bytes)
+      piece = bytes;
+    if(!ESP.flashRead(_hashedAddress, words, (piece + 3) & ~3)) {
+      _setError(UPDATE_ERROR_READ);
+      return false;
+    }
+    _md5.add((uint8_t*) words, piece);
+    if(_sha256)
+      _sha256->add((uint8_t*) words, piece);
+    _hashedAddress += piece;
+    bytes -= piece;
+  }
+  return _hashedAddress < _currentAddress;
+}
+
+bool UpdaterClass::eraseNext(size_t sectors){
+  if(hasError() || !isRunning())
+    return false;
+  uint32_t endAddress = _startAddress + ((_size + FLASH_SECTOR_SIZE - 1) & (~(FLASH_SECTOR_SIZE - 1)));
+  if(_decoding) {
+    // the end of a compressed image or a patch isn't known, stay a few sectors ahead
+    uint32_t ahead = ((_currentAddress + _bufferLen + FLASH_SECTOR_SIZE - 1) & (~(FLASH_SECTOR_SIZE - 1))) + 8 * FLASH_SECTOR_SIZE;
+    if(ahead < endAddress)
+      endAddress = ahead;
+  }
+  for(; sectors && _erasedAddress < endAddress; --sectors) {
+    if(!flash_queue_erase_now(_erasedAddress/FLASH_SECTOR_SIZE, 1)) {
+      _currentAddress = (_startAddress + _size);
+      _setError(UPDATE_ERROR_ERASE);
+      return false;
+    }
+    _erasedAddress += FLASH_SECTOR_SIZE;
+    if(!_async && sectors > 1) yield_budget(YIELD_OP_UPDATE);
+  }
+  return _erasedAddress < endAddress;
+}
+
+bool UpdaterClass::setSHA256(const char * expected_sha256){
+  if(strlen(expected_sha256) != 64 || !isRunning() || _hashedAddress != _startAddress)
+  {
+    return false;
+  }
+  if(!_sha256)
+    _sha256 = new SHA256Builder;
+  if(!_sha256)
+    return false;
+  _sha256->begin();
+  _target_sha256 = expected_sha256;
+  _target_sha256.toLowerCase();
+  return true;
+}
+
 bool UpdaterClass::setMD5(const char * expected_md5){
   if(strlen(expected_md5) != 32)
   {
@@ -159,16 +362,53 @@ bool UpdaterClass::end(bool evenIfRemaining){
     return false;
   }
 
-  if(evenIfRemaining) {
+  if(_decoding) {
+    if(_inflater && !_inflater->end()) {
+      if(!hasError())
+        _setError(UPDATE_ERROR_DECOMPRESS);
+      _reset();
+      return false;
+    }
+    if(_patcher && !_patcher->end()) {
+      if(!hasError())
+        _setError(UPDATE_ERROR_PATCH);
+      _reset();
+      return false;
+    }
+    if(_bufferLen > 0 && !_writeBuffer()) {
+      _reset();
+      return false;
+    }
+    _md5Input.calculate();
+    // from here on the sizes are those of the image written
+    _size = _currentAddress - _startAddress;
+  }
+  else if(evenIfRemaining) {
     if(_bufferLen > 0) {
       _writeBuffer();
     }
     _size = progress();
   }
 
+  // catch up with what was written since the stream last waited
+  while(hashNext(FLASH_SECTOR_SIZE)) {
+    if(!_async) yield_budget(YIELD_OP_UPDATE);
+  }
+  if(hasError()) {
+    _reset();
+    return false;
+  }
   _md5.calculate();
+  if(_sha256) {
+    _sha256->calculate();
+    if(_target_sha256 != _sha256->toString()) {
+      _setError(UPDATE_ERROR_SHA256);
+      _reset();
+      return false;
+    }
+  }
   if(_target_md5.length()) {
-    if(_target_md5 != _md5.toString()){
+    if(_target_md5 != _md5.toString() && !(_decoding && _target_md5 == _md5Input.toString())){
       _setError(UPDATE_ERROR_MD5);
       _reset();
       return false;
@@ -183,9 +423,19 @@ bool UpdaterClass::end(bool evenIfRemaining){
     return false;
   }
 
-  if (_command == U_FLASH) {
+  if (_command == U_FLASH && app_slot_current() >= 0) {
+    if(!app_slot_switch(!app_slot_current())) {
+      _setError(UPDATE_ERROR_WRITE);
+      _reset();
+      return false;
+    }
+#ifdef DEBUG_UPDATER
+    DEBUG_UPDATER.printf("Slot %d: address:0x%08X, size:0x%08X\n", !app_slot_current(), _startAddress, _size);
+#endif
+  }
+  else if (_command == U_FLASH) {
     eboot_command ebcmd;
-    ebcmd.action = ACTION_COPY_RAW;
+    ebcmd.action = _bootGzip ? ACTION_COPY_GZIP : ACTION_COPY_RAW;
     ebcmd.args[0] = _startAddress;
     ebcmd.args[1] = 0x00000;
     ebcmd.args[2] = _size;
@@ -206,14 +456,16 @@ bool UpdaterClass::end(bool evenIfRemaining){
 bool UpdaterClass::_writeBuffer(){
 
   bool eraseResult = true, writeResult = true;
-  if (_currentAddress % FLASH_SECTOR_SIZE == 0) {
-    if(!_async) yield();
-    eraseResult = ESP.flashEraseSector(_currentAddress/FLASH_SECTOR_SIZE);
+  // erase the sectors the buffer reaches into, unless eraseNext() did
+  while (eraseResult && _erasedAddress < _currentAddress + _bufferLen) {
+    if(!_async) yield_budget(YIELD_OP_UPDATE);
+    eraseResult = flash_queue_erase_now(_erasedAddress/FLASH_SECTOR_SIZE, 1);
+    _erasedAddress += FLASH_SECTOR_SIZE;
   }
   
   if (eraseResult) {
-    if(!_async) yield();
-    writeResult = ESP.flashWrite(_currentAddress, (uint32_t*) _buffer, _bufferLen);
+    if(!_async) yield_budget(YIELD_OP_UPDATE);
+    writeResult = flash_queue_write_now(_currentAddress, (uint32_t*) _buffer, _bufferLen);
   } else { // if erase was unsuccessful
     _currentAddress = (_startAddress + _size);
     _setError(UPDATE_ERROR_ERASE);
@@ -225,9 +477,153 @@ bool UpdaterClass::_writeBuffer(){
     _setError(UPDATE_ERROR_WRITE);
     return false;
   }
-  _md5.add(_buffer, _bufferLen);
   _currentAddress += _bufferLen;
   _bufferLen = 0;
+  if(!_decoding)
+    _resumePoint = (_currentAddress - _startAddress) & (~(FLASH_SECTOR_SIZE - 1));
+  return true;
+}
+
+bool UpdaterClass::_beginDecoding(bool gzip){
+  // the size of the image isn't known yet: write from the start of the
+  // space there is, right after the running sketch, in the other slot or at
+  // the start of SPIFFS
+  uint32_t startAddress = _startAddress;
+  uint32_t endAddress = (uint32_t)&_SPIFFS_end - 0x40200000;
+  if (_command == U_FLASH && app_slot_current() >= 0) {
+    endAddress = startAddress + EBOOT_SLOT_SIZE;
+  }
+  else if (_command == U_FLASH) {
+    startAddress = (ESP.getSketchSize() + FLASH_SECTOR_SIZE - 1) & (~(FLASH_SECTOR_SIZE - 1));
+    endAddress = (uint32_t)&_SPIFFS_start - 0x40200000;
+  }
+  if (gzip) {
+    _inflater = new UpdaterInflater(*this);
+    if (!_inflater) {
+      _setError(UPDATE_ERROR_DECOMPRESS);
+      return false;
+    }
+    _inflater->begin();
+  }
+  _decoding = true;
+  _inSize = _size;
+  _inPos = 0;
+  _startAddress = startAddress;
+  _currentAddress = startAddress;
+  _erasedAddress = startAddress;
+  _hashedAddress = startAddress;
+  _size = endAddress - startAddress;
+  _md5Input.begin();
+#ifdef DEBUG_UPDATER
+  DEBUG_UPDATER.printf("[write] %s, writing from 0x%08X, up to 0x%08X\n", gzip ? "gzip" : "patch", _startAddress, endAddress);
+#endif
+  return true;
+}
+
+size_t UpdaterClass::_writeDecoded(const uint8_t *data, size_t len){
+  if(len > _inSize - _inPos){
+    _setError(UPDATE_ERROR_SPACE);
+    return 0;
+  }
+  _md5Input.add(data, len);
+  bool ok = _inflater ? _inflater->write(data, len) : _decoded(data, len);
+  if(!ok) {
+    if(!hasError())
+      _setError(_inflater ? UPDATE_ERROR_DECOMPRESS : UPDATE_ERROR_PATCH);
+    return 0;
+  }
+  _inPos += len;
+  if(!_async) yield_budget(YIELD_OP_UPDATE);
+  return len;
+}
+
+bool UpdaterClass::_decoded(const uint8_t *data, size_t len){
+  if(hasError())
+    return false;
+  if(!_imageChecked) {
+    // a patch, maybe compressed, can only be applied to the running sketch
+    _imageChecked = true;
+    if(_command == U_FLASH && DeltaPatcher::isPatch(data, len)) {
+      _patcher = new UpdaterPatcher(*this);
+      if(!_patcher) {
+        _setError(UPDATE_ERROR_PATCH);
+        return false;
+      }
+      _patcher->begin();
+    }
+  }
+  if(_patcher) {
+    if(!_patcher->write(data, len)) {
+      if(!hasError())
+        _setError(UPDATE_ERROR_PATCH);
+      return false;
+    }
+    return true;
+  }
+  return _image(data, len);
+}
+
+bool UpdaterClass::_checkPatch(){
+  uint32_t sketchSize = ESP.getSketchSize();
+  String md5;
+  const uint8_t* expected = _patcher->oldMD5();
+  for(int i = 0; i < 16; ++i) {
+    md5 += "0123456789abcdef"[expected[i] >> 4];
+    md5 += "0123456789abcdef"[expected[i] & 15];
+  }
+  if(_patcher->oldSize() != sketchSize || md5 != ESP.getSketchMD5()) {
+#ifdef DEBUG_UPDATER
+    DEBUG_UPDATER.printf("[write] patch is for a sketch of %u bytes, md5 %s\n", _patcher->oldSize(), md5.c_str());
+#endif
+    _setError(UPDATE_ERROR_PATCH);
+    return false;
+  }
+  if(_patcher->newSize() > _size) {
+    _setError(UPDATE_ERROR_SPACE);
+    return false;
+  }
+  return true;
+}
+
+bool UpdaterClass::_image(const uint8_t *data, size_t len){
+  if(hasError())
+    return false;
+  while(len) {
+    if(_currentAddress - _startAddress + _bufferLen + len > _size) {
+      _currentAddress = (_startAddress + _size);
+      _setError(UPDATE_ERROR_SPACE);
+      return false;
+    }
+    size_t toBuff = _bufferSize - _bufferLen;
+    if(toBuff > len)
+      toBuff = len;
+    memcpy(_buffer + _bufferLen, data, toBuff);
+    _bufferLen += toBuff;
+    data += toBuff;
+    len -= toBuff;
+    if(_bufferLen == _bufferSize && !_writeBuffer())
+      return false;
+  }
+  return true;
+}
+
+bool UpdaterClass::_readWritten(size_t pos, uint8_t *dst, size_t len){
+  size_t flashed = _currentAddress - _startAddress;
+  if(pos < flashed) {
+    size_t piece = (flashed - pos < len) ? flashed - pos : len;
+    if(!flashReadBytes(_startAddress + pos, dst, piece)) {
+      _setError(UPDATE_ERROR_READ);
+      return false;
+    }
+    pos += piece;
+    dst += piece;
+    len -= piece;
+  }
+  if(len) {
+    if(pos + len > flashed + _bufferLen)
+      return false;
+    memcpy(dst, _buffer + (pos - flashed), len);
+  }
   return true;
 }
 
@@ -235,6 +631,18 @@ size_t UpdaterClass::write(uint8_t *data, size_t len) {
   if(hasError() || !isRunning())
     return 0;
 
+  if(!_inputChecked) {
+    _inputChecked = true;
+    bool gzip = len >= 2 && data[0] == GZIP_MAGIC_0 && data[1] == GZIP_MAGIC_1;
+    bool patch = _command == U_FLASH && DeltaPatcher::isPatch(data, len);
+    if(gzip && _canDecompressAtBoot())
+      _bootGzip = true;
+    else if((gzip || patch) && !_beginDecoding(gzip))
+      return 0;
+  }
+  if(_decoding)
+    return _writeDecoded(data, len);
+
   if(len > remaining()){
     //len = remaining();
     //fail instead
@@ -252,7 +660,7 @@ size_t UpdaterClass::write(uint8_t *data, size_t len) {
       return len - left;
     }
     left -= toBuff;
-    if(!_async) yield();
+    if(!_async) yield_budget(YIELD_OP_UPDATE);
   }
   //lets see whats left
   memcpy(_buffer + _bufferLen, data + (len - left), left);
@@ -268,8 +676,10 @@ size_t UpdaterClass::write(uint8_t *data, size_t len) {
 
 bool UpdaterClass::_verifyHeader(uint8_t data) {
     if(_command == U_FLASH) {
-        // check for valid first magic byte (is always 0xE9)
-        if(data != 0xE9) {
+        // check for valid first magic byte (is always 0xE9), or a gzip
+        // header or a patch, in which case the image is checked when it is
+        // written
+        if(data != 0xE9 && data != GZIP_MAGIC_0 && data != (DELTA_MAGIC & 0xff)) {
             _currentAddress = (_startAddress + _size);
             _setError(UPDATE_ERROR_MAGIC_BYTE);
             return false;
@@ -282,8 +692,41 @@ bool UpdaterClass::_verifyHeader(uint8_t data) {
     return false;
 }
 
+bool UpdaterClass::_canDecompressAtBoot() {
+    // the eboot shipped would clear the command and boot the old sketch
+    return UPDATER_BOOT_GZIP && _command == U_FLASH && _decompressAtBoot && app_slot_current() < 0;
+}
+
 bool UpdaterClass::_verifyEnd() {
-    if(_command == U_FLASH) {
+    if(_command == U_FLASH && _bootGzip) {
+        // eboot checks the rest before it overwrites anything; the size of
+        // the image is at the end of the gzip file
+        uint8_t head[3];
+        uint32_t imageSize;
+        if(_size < 18) {
+            _currentAddress = (_startAddress);
+            _setError(UPDATE_ERROR_MAGIC_BYTE);
+            return false;
+        }
+        if(!flashReadBytes(_startAddress, head, sizeof(head)) ||
+           !flashReadBytes(_startAddress + _size - 4, (uint8_t*) &imageSize, sizeof(imageSize))) {
+            _currentAddress = (_startAddress);
+            _setError(UPDATE_ERROR_READ);
+            return false;
+        }
+        if(head[0] != GZIP_MAGIC_0 || head[1] != GZIP_MAGIC_1 || head[2] != 8) {
+            _currentAddress = (_startAddress);
+            _setError(UPDATE_ERROR_MAGIC_BYTE);
+            return false;
+        }
+        // it is decompressed from the start of the flash up to the staged file
+        if(((imageSize + FLASH_SECTOR_SIZE - 1) & (~(FLASH_SECTOR_SIZE - 1))) > _startAddress) {
+            _currentAddress = (_startAddress);
+            _setError(UPDATE_ERROR_SPACE);
+            return false;
+        }
+        return true;
+    } else if(_command == U_FLASH) {
 
         uint8_t buf[4];
         if(!ESP.flashRead(_startAddress, (uint32_t *) &buf[0], 4)) {
@@ -322,7 +765,9 @@ size_t UpdaterClass::writeStream(Stream &data) {
     if(hasError() || !isRunning())
         return 0;
 
-    if(!_verifyHeader(data.peek())) {
+    // a resumed update was checked by resume()
+    int first = data.peek();
+    if(!_inputChecked && !_verifyHeader(first)) {
 #ifdef DEBUG_UPDATER
         printError(DEBUG_UPDATER);
 #endif
@@ -330,11 +775,24 @@ size_t UpdaterClass::writeStream(Stream &data) {
         return 0;
     }
 
+    // what may be gzip goes through write() in pieces, the rest straight
+    // into the buffer
+    bool chunked = !_inputChecked && (first == GZIP_MAGIC_0 || first == (DELTA_MAGIC & 0xff));
+    _inputChecked = _inputChecked || !chunked;
+    uint8_t chunk[256];
     while(remaining()) {
-        toRead = data.readBytes(_buffer + _bufferLen,  (_bufferSize - _bufferLen));
+        if(!data.available() && !hashNext() && _eraseAhead)
+            eraseNext();
+        uint8_t *dst = _buffer + _bufferLen;
+        size_t want = _bufferSize - _bufferLen;
+        if(chunked) {
+            dst = chunk;
+            want = (remaining() < sizeof(chunk)) ? remaining() : sizeof(chunk);
+        }
+        toRead = data.readBytes(dst, want);
         if(toRead == 0) { //Timeout
             delay(100);
-            toRead = data.readBytes(_buffer + _bufferLen, (_bufferSize - _bufferLen));
+            toRead = data.readBytes(dst, want);
             if(toRead == 0) { //Timeout
                 _currentAddress = (_startAddress + _size);
                 _setError(UPDATE_ERROR_STREAM);
@@ -342,11 +800,16 @@ size_t UpdaterClass::writeStream(Stream &data) {
                 return written;
             }
         }
-        _bufferLen += toRead;
-        if((_bufferLen == remaining() || _bufferLen == _bufferSize) && !_writeBuffer())
-            return written;
+        if(chunked) {
+            if(write(chunk, toRead) != toRead)
+                return written;
+        } else {
+            _bufferLen += toRead;
+            if((_bufferLen == remaining() || _bufferLen == _bufferSize) && !_writeBuffer())
+                return written;
+        }
         written += toRead;
-        yield();
+        yield_budget(YIELD_OP_UPDATE);
     }
     return written;
 }
@@ -385,6 +848,12 @@ void UpdaterClass::printError(Print &out){
     out.println(F("Magic byte is wrong, not 0xE9"));
   } else if (_error == UPDATE_ERROR_BOOTSTRAP){
     out.println(F("Invalid bootstrapping state, reset ESP8266 before updating"));
+  } else if (_error == UPDATE_ERROR_DECOMPRESS){
+    out.println(F("Decompression Failed"));
+  } else if (_error == UPDATE_ERROR_PATCH){
+    out.println(F("Patch Failed, or not for the running sketch"));
+  } else if (_error == UPDATE_ERROR_SHA256){
+    out.printf_P(PSTR("SHA-256 Failed: expected:%s, calculated:%s\n"), _target_sha256.c_str(), _sha256 ? _sha256->toString().c_str() : "");
   } else {
     out.println(F("UNKNOWN"));
   }
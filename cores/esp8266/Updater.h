@@ -17,17 +17,31 @@
 #define UPDATE_ERROR_NEW_FLASH_CONFIG   (9)
 #define UPDATE_ERROR_MAGIC_BYTE         (10)
 #define UPDATE_ERROR_BOOTSTRAP          (11)
+#define UPDATE_ERROR_DECOMPRESS         (12)
+#define UPDATE_ERROR_PATCH              (13)
+#define UPDATE_ERROR_SHA256             (14)
 
 #define U_FLASH   0
 #define U_SPIFFS  100
 #define U_AUTH    200
 
+// The eboot.elf that comes with the core only copies raw images. An eboot
+// built from bootloaders/eboot with inflate.c also takes ACTION_COPY_GZIP;
+// with it, build with -DUPDATER_BOOT_GZIP=1 for decompressAtBoot().
+#ifndef UPDATER_BOOT_GZIP
+#define UPDATER_BOOT_GZIP 0
+#endif
+
 #ifdef DEBUG_ESP_UPDATER
 #ifdef DEBUG_ESP_PORT
 #define DEBUG_UPDATER DEBUG_ESP_PORT
 #endif
 #endif
 
+class SHA256Builder;
+class UpdaterInflater;
+class UpdaterPatcher;
+
 class UpdaterClass {
   public:
     UpdaterClass();
@@ -42,6 +56,69 @@ class UpdaterClass {
     */
     void runAsync(bool async){ _async = async; }
 
+    /*
+      Size of the buffer the data is collected in before it is written,
+      rounded down to whole sectors, for the next begin()
+      A larger buffer means fewer, longer writes; begin() falls back to
+      one sector if there isn't the heap for it
+      Returns false if an update is running
+    */
+    bool setBufferSize(size_t size);
+
+    /*
+      When enabled, writeStream() and write(T&) erase the sectors ahead of
+      the data while the stream has nothing to read, instead of erasing
+      each one when the data gets there
+    */
+    void eraseAhead(bool enable){ _eraseAhead = enable; }
+
+#if UPDATER_BOOT_GZIP
+    /*
+      When enabled, a gzip compressed sketch is staged as it is received and
+      eboot decompresses it over the running sketch at the next boot, so the
+      space needed is only that of the compressed file. It has no effect on
+      the A/B layouts, and patches are still applied as they are written.
+      Needs an eboot with ACTION_COPY_GZIP, see UPDATER_BOOT_GZIP
+    */
+    void decompressAtBoot(bool enable){ _decompressAtBoot = enable; }
+#endif
+
+    /*
+      Erases up to `sectors` sectors of the update area the data hasn't
+      reached yet, about 40 ms each. Call it while there's nothing else to
+      do, or in a loop right after begin() to erase everything up front
+      Returns false once there is nothing left to erase, or on error
+      For a compressed update it erases no more than 8 sectors ahead
+    */
+    bool eraseNext(size_t sectors = 1);
+
+    /*
+      Hashes up to `bytes` more of what was written, reading it back from
+      the flash; writing doesn't hash, so the stream isn't kept waiting,
+      and end() hashes what is left. writeStream() and write(T&) call it
+      while the stream has nothing to read, call it in the same way when
+      feeding write() yourself
+      Returns false once all that was written is hashed, or on error
+    */
+    bool hashNext(size_t bytes = 1024);
+
+    /*
+      Takes up an update that stopped part way: call it right after the
+      same begin() as the first time, with what resumePoint() said then,
+      and write the rest of the image from there
+      Reads back what is on the flash for the MD5 and checks it starts
+      like an image; not for compressed updates or patches
+    */
+    bool resume(size_t written);
+
+    /*
+      How much of the image is on the flash for good, in whole sectors,
+      to give resume() when the update stops; still there after a stream
+      timeout, until the next begin()
+      Stays 0 for a compressed update or a patch
+    */
+    size_t resumePoint(){ return _resumePoint; }
+
     /*
       Writes a buffer to the flash and increments the address
       Returns the amount written
@@ -76,9 +153,18 @@ class UpdaterClass {
 
     /*
       sets the expected MD5 for the firmware (hexString)
+      for a gzip compressed update or a patch it may be the MD5 of either
+      what is sent or the resulting image
     */
     bool setMD5(const char * expected_md5);
 
+    /*
+      sets the expected SHA-256 for the firmware (hexString) and turns on
+      hashing it, after begin() and before anything is written
+      for a compressed update or a patch it is that of the resulting image
+    */
+    bool setSHA256(const char * expected_sha256);
+
     /*
       returns the MD5 String of the sucessfully ended firmware
     */
@@ -94,10 +180,16 @@ class UpdaterClass {
     void clearError(){ _error = UPDATE_ERROR_OK; }
     bool hasError(){ return _error != UPDATE_ERROR_OK; }
     bool isRunning(){ return _size > 0; }
-    bool isFinished(){ return _currentAddress == (_startAddress + _size); }
-    size_t size(){ return _size; }
-    size_t progress(){ return _currentAddress - _startAddress; }
-    size_t remaining(){ return _size - (_currentAddress - _startAddress); }
+    // for a compressed update or a patch these count what was received,
+    // not what was written
+    bool isFinished(){ return _decoding ? (hasError() || _inPos == _inSize) : _currentAddress == (_startAddress + _size); }
+    size_t size(){ return _decoding ? _inSize : _size; }
+    size_t progress(){ return _decoding ? _inPos : _currentAddress - _startAddress; }
+    size_t remaining(){ return _decoding ? (hasError() ? 0 : _inSize - _inPos) : _size - (_currentAddress - _startAddress); }
+    // the update is gzip compressed, or a patch made by tools/delta_patch.py
+    // for the running sketch; known once the first bytes are written
+    bool isCompressed(){ return _inflater != 0 || _bootGzip; }
+    bool isPatch(){ return _patcher != 0; }
 
     /*
       Template to write from objects that expose
@@ -111,6 +203,24 @@ class UpdaterClass {
       if (hasError() || !isRunning())
         return 0;
 
+      if (!_inputChecked || _decoding) {
+        // through write(), which finds out if the image is compressed or a
+        // patch and decodes it
+        uint8_t chunk[128];
+        size_t available = data.available();
+        while(available && remaining()) {
+          size_t toRead = (available < sizeof(chunk)) ? available : sizeof(chunk);
+          if(toRead > remaining())
+            toRead = remaining();
+          data.read(chunk, toRead);
+          if(write(chunk, toRead) != toRead)
+            return written;
+          written += toRead;
+          available = data.available();
+        }
+        return written;
+      }
+
       size_t available = data.available();
       while(available) {
         if(_bufferLen + available > remaining()){
@@ -135,15 +245,26 @@ class UpdaterClass {
         }
         if(remaining() == 0)
           return written;
-        delay(1);
+        if(data.available() || (!hashNext() && (!_eraseAhead || !eraseNext())))
+          delay(1);
         available = data.available();
       }
       return written;
     }
 
   private:
+    friend class UpdaterInflater;
+    friend class UpdaterPatcher;
+
     void _reset();
     bool _writeBuffer();
+    bool _beginDecoding(bool gzip);
+    size_t _writeDecoded(const uint8_t *data, size_t len);
+    bool _decoded(const uint8_t *data, size_t len);
+    bool _checkPatch();
+    bool _image(const uint8_t *data, size_t len);
+    bool _readWritten(size_t pos, uint8_t *dst, size_t len);
+    bool _canDecompressAtBoot();
 
     bool _verifyHeader(uint8_t data);
     bool _verifyEnd();
@@ -155,13 +276,30 @@ class UpdaterClass {
     uint8_t *_buffer;
     size_t _bufferLen; // amount of data written into _buffer
     size_t _bufferSize; // total size of _buffer
+    size_t _bufferSizeWanted; // set by setBufferSize, 0 for one sector
     size_t _size;
     uint32_t _startAddress;
     uint32_t _currentAddress;
+    uint32_t _erasedAddress; // erased from _startAddress up to this
+    size_t _resumePoint;
+    uint32_t _hashedAddress; // hashed from _startAddress up to this
+    bool _eraseAhead;
+    bool _decompressAtBoot;
+    bool _bootGzip; // staged compressed, for eboot to decompress
+    bool _inputChecked; // the first bytes were looked at for a gzip header
+    bool _decoding; // compressed or a patch, what is written isn't the image
+    UpdaterInflater *_inflater;
+    UpdaterPatcher *_patcher;
+    bool _imageChecked; // the first bytes of the image were looked at
+    size_t _inSize; // size given to begin()
+    size_t _inPos;
     uint32_t _command;
 
     String _target_md5;
     MD5Builder _md5;
+    MD5Builder _md5Input; // of the data as received
+    String _target_sha256;
+    SHA256Builder *_sha256; // set by setSHA256()
 };
 
 extern UpdaterClass Update;
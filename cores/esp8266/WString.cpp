@@ -68,21 +68,21 @@ String::String(char c) {
 String::String(unsigned char value, unsigned char base) {
     init();
     char buf[1 + 8 * sizeof(unsigned char)];
-    utoa(value, buf, base);
+    ultoa(value, buf, base);
     *this = buf;
 }
 
 String::String(int value, unsigned char base) {
     init();
     char buf[2 + 8 * sizeof(int)];
-    itoa(value, buf, base);
+    ltoa(value, buf, base);
     *this = buf;
 }
 
 String::String(unsigned int value, unsigned char base) {
     init();
     char buf[1 + 8 * sizeof(unsigned int)];
-    utoa(value, buf, base);
+    ultoa(value, buf, base);
     *this = buf;
 }
 
@@ -113,10 +113,7 @@ String::String(double value, unsigned char decimalPlaces) {
 }
 
 String::~String() {
-    if(buffer) {
-        free(buffer);
-    }
-    init();
+    invalidate();
 }
 
 // /*********************************************/
@@ -124,39 +121,103 @@ String::~String() {
 // /*********************************************/
 
 inline void String::init(void) {
-    buffer = NULL;
-    capacity = 0;
-    len = 0;
+    setSSO(false);
+    ptr.buff = NULL;
+    ptr.cap = 0;
+    ptr.len = 0;
 }
 
 void String::invalidate(void) {
-    if(buffer)
-        free(buffer);
+    if(!isSSO() && ptr.buff)
+        free(ptr.buff);
     init();
 }
 
 unsigned char String::reserve(unsigned int size) {
-    if(buffer && capacity >= size)
+    if(buffer() && capacity() >= size)
         return 1;
     if(changeBuffer(size)) {
-        if(len == 0)
-            buffer[0] = 0;
+        if(len() == 0)
+            wbuffer()[0] = 0;
         return 1;
     }
     return 0;
 }
 
+unsigned char String::growTo(unsigned int size) {
+    if(buffer() && capacity() >= size)
+        return 1;
+    // appending: grow by half at least, so that a string built piece by
+    // piece is copied a logarithmic number of times, not once per piece
+    unsigned int grown = capacity() + (capacity() >> 1);
+    if(grown > CAPACITY_MAX)
+        grown = CAPACITY_MAX;
+    if(buffer() && grown > size) {
+        if(reserve(grown))
+            return 1;
+    }
+    // no room for the headroom, try the exact size
+    return reserve(size);
+}
+
+void String::shrink_to_fit(void) {
+    if(isSSO() || !ptr.buff)
+        return;
+    unsigned int length = ptr.len;
+    if(length < SSOSIZE) {
+        char *old = ptr.buff;
+        memcpy(sso.buff, old, length + 1);
+        setSSO(true);
+        sso.len = length;
+        free(old);
+        return;
+    }
+    size_t newSize = (length + 16) & (~0xf);
+    if(newSize >= (size_t) ptr.cap + 1)
+        return;
+    char *newbuffer = (char *) realloc(ptr.buff, newSize);
+    if(newbuffer) {
+        ptr.buff = newbuffer;
+        ptr.cap = newSize - 1;
+    }
+}
+
 unsigned char String::changeBuffer(unsigned int maxStrLen) {
+    // short strings live in the object itself
+    if(maxStrLen < SSOSIZE && (isSSO() || !ptr.buff)) {
+        if(!isSSO()) {
+            memset(sso.buff, 0, SSOSIZE);
+            setSSO(true);
+            sso.len = 0;
+        }
+        return 1;
+    }
+    if(maxStrLen > CAPACITY_MAX)
+        return 0;
     size_t newSize = (maxStrLen + 16) & (~0xf);
-    char *newbuffer = (char *) realloc(buffer, newSize);
+    if(isSSO()) {
+        // moving out, the inline buffer becomes the heap pointer
+        char *newbuffer = (char *) malloc(newSize);
+        if(!newbuffer)
+            return 0;
+        unsigned int oldLen = sso.len;
+        memcpy(newbuffer, sso.buff, SSOSIZE);
+        memset(newbuffer + SSOSIZE, 0, newSize - SSOSIZE);
+        setSSO(false);
+        ptr.buff = newbuffer;
+        ptr.cap = newSize - 1;
+        ptr.len = oldLen;
+        return 1;
+    }
+    char *newbuffer = (char *) realloc(ptr.buff, newSize);
     if(newbuffer) {
-        size_t oldSize = capacity + 1; // include NULL.
+        size_t oldSize = ptr.cap + 1; // include NULL.
         if (newSize > oldSize)
         {
             memset(newbuffer + oldSize, 0, newSize - oldSize);
         }
-        capacity = newSize - 1;
-        buffer = newbuffer;
+        ptr.cap = newSize - 1;
+        ptr.buff = newbuffer;
         return 1;
     }
     return 0;
@@ -171,8 +232,8 @@ String & String::copy(const char *cstr, unsigned int length) {
         invalidate();
         return *this;
     }
-    len = length;
-    strcpy(buffer, cstr);
+    setLen(length);
+    strcpy(wbuffer(), cstr);
     return *this;
 }
 
@@ -181,29 +242,30 @@ String & String::copy(const __FlashStringHelper *pstr, unsigned int length) {
         invalidate();
         return *this;
     }
-    len = length;
-    strcpy_P(buffer, (PGM_P)pstr);
+    setLen(length);
+    memcpy_P(wbuffer(), (PGM_P)pstr, length);
+    wbuffer()[length] = 0;
     return *this;
 }
 
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 void String::move(String &rhs) {
-    if(buffer) {
-        if(capacity >= rhs.len) {
-            strcpy(buffer, rhs.buffer);
-            len = rhs.len;
-            rhs.len = 0;
+    if(buffer() && rhs.buffer()) {
+        if(capacity() >= rhs.len()) {
+            strcpy(wbuffer(), rhs.buffer());
+            setLen(rhs.len());
+            rhs.setLen(0);
             return;
-        } else {
-            free(buffer);
         }
     }
-    buffer = rhs.buffer;
-    capacity = rhs.capacity;
-    len = rhs.len;
-    rhs.buffer = NULL;
-    rhs.capacity = 0;
-    rhs.len = 0;
+    invalidate();
+    // an inline string has to be copied, a heap one changes owner
+    if(rhs.isSSO()) {
+        memcpy(&sso, &rhs.sso, sizeof(sso));
+    } else {
+        ptr = rhs.ptr;
+    }
+    rhs.init();
 }
 #endif
 
@@ -211,8 +273,8 @@ String & String::operator =(const String &rhs) {
     if(this == &rhs)
         return *this;
 
-    if(rhs.buffer)
-        copy(rhs.buffer, rhs.len);
+    if(rhs.buffer())
+        copy(rhs.buffer(), rhs.len());
     else
         invalidate();
 
@@ -255,19 +317,30 @@ String & String::operator = (const __FlashStringHelper *pstr)
 // /*********************************************/
 
 unsigned char String::concat(const String &s) {
-    return concat(s.buffer, s.len);
+    return concat(s.buffer(), s.len());
 }
 
 unsigned char String::concat(const char *cstr, unsigned int length) {
-    unsigned int newlen = len + length;
+    unsigned int newlen = len() + length;
     if(!cstr)
         return 0;
     if(length == 0)
         return 1;
-    if(!reserve(newlen))
+    if(cstr >= buffer() && cstr < buffer() + len()) {
+        // a part of ourselves, which reserve() may move
+        unsigned int offset = cstr - buffer();
+        if(!growTo(newlen))
+            return 0;
+        memmove(wbuffer() + len(), buffer() + offset, length);
+        wbuffer()[newlen] = 0;
+        setLen(newlen);
+        return 1;
+    }
+    if(!growTo(newlen))
         return 0;
-    strcpy(buffer + len, cstr);
-    len = newlen;
+    memcpy(wbuffer() + len(), cstr, length);
+    wbuffer()[newlen] = 0;
+    setLen(newlen);
     return 1;
 }
 
@@ -286,19 +359,19 @@ unsigned char String::concat(char c) {
 
 unsigned char String::concat(unsigned char num) {
     char buf[1 + 3 * sizeof(unsigned char)];
-    itoa(num, buf, 10);
+    ltoa(num, buf, 10);
     return concat(buf, strlen(buf));
 }
 
 unsigned char String::concat(int num) {
     char buf[2 + 3 * sizeof(int)];
-    itoa(num, buf, 10);
+    ltoa(num, buf, 10);
     return concat(buf, strlen(buf));
 }
 
 unsigned char String::concat(unsigned int num) {
     char buf[1 + 3 * sizeof(unsigned int)];
-    utoa(num, buf, 10);
+    ultoa(num, buf, 10);
     return concat(buf, strlen(buf));
 }
 
@@ -330,10 +403,10 @@ unsigned char String::concat(const __FlashStringHelper * str) {
     if (!str) return 0;
     int length = strlen_P((PGM_P)str);
     if (length == 0) return 1;
-    unsigned int newlen = len + length;
-    if (!reserve(newlen)) return 0;
-    strcpy_P(buffer + len, (PGM_P)str);
-    len = newlen;
+    unsigned int newlen = len() + length;
+    if (!growTo(newlen)) return 0;
+    memcpy_P(wbuffer() + len(), (PGM_P)str, length + 1);
+    setLen(newlen);
     return 1;
 }
 
@@ -343,7 +416,7 @@ unsigned char String::concat(const __FlashStringHelper * str) {
 
 StringSumHelper & operator +(const StringSumHelper &lhs, const String &rhs) {
     StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-    if(!a.concat(rhs.buffer, rhs.len))
+    if(!a.concat(rhs.buffer(), rhs.len()))
         a.invalidate();
     return a;
 }
@@ -423,26 +496,26 @@ StringSumHelper & operator + (const StringSumHelper &lhs, const __FlashStringHel
 // /*********************************************/
 
 int String::compareTo(const String &s) const {
-    if(!buffer || !s.buffer) {
-        if(s.buffer && s.len > 0)
-            return 0 - *(unsigned char *) s.buffer;
-        if(buffer && len > 0)
-            return *(unsigned char *) buffer;
+    if(!buffer() || !s.buffer()) {
+        if(s.buffer() && s.len() > 0)
+            return 0 - *(unsigned char *) s.buffer();
+        if(buffer() && len() > 0)
+            return *(unsigned char *) buffer();
         return 0;
     }
-    return strcmp(buffer, s.buffer);
+    return strcmp(buffer(), s.buffer());
 }
 
 unsigned char String::equals(const String &s2) const {
-    return (len == s2.len && compareTo(s2) == 0);
+    return (len() == s2.len() && compareTo(s2) == 0);
 }
 
 unsigned char String::equals(const char *cstr) const {
-    if(len == 0)
+    if(len() == 0)
         return (cstr == NULL || *cstr == 0);
     if(cstr == NULL)
-        return buffer[0] == 0;
-    return strcmp(buffer, cstr) == 0;
+        return buffer()[0] == 0;
+    return strcmp(buffer(), cstr) == 0;
 }
 
 unsigned char String::operator<(const String &rhs) const {
@@ -464,12 +537,12 @@ unsigned char String::operator>=(const String &rhs) const {
 unsigned char String::equalsIgnoreCase(const String &s2) const {
     if(this == &s2)
         return 1;
-    if(len != s2.len)
+    if(len() != s2.len())
         return 0;
-    if(len == 0)
+    if(len() == 0)
         return 1;
-    const char *p1 = buffer;
-    const char *p2 = s2.buffer;
+    const char *p1 = buffer();
+    const char *p2 = s2.buffer();
     while(*p1) {
         if(tolower(*p1++) != tolower(*p2++))
             return 0;
@@ -480,14 +553,14 @@ unsigned char String::equalsIgnoreCase(const String &s2) const {
 unsigned char String::equalsConstantTime(const String &s2) const {
     // To avoid possible time-based attacks present function
     // compares given strings in a constant time.
-    if(len != s2.len)
+    if(len() != s2.len())
         return 0;
     //at this point lengths are the same
-    if(len == 0)
+    if(len() == 0)
         return 1;
     //at this point lenghts are the same and non-zero
-    const char *p1 = buffer;
-    const char *p2 = s2.buffer;
+    const char *p1 = buffer();
+    const char *p2 = s2.buffer();
     unsigned int equalchars = 0;
     unsigned int diffchars = 0;
     while(*p1) {
@@ -499,27 +572,27 @@ unsigned char String::equalsConstantTime(const String &s2) const {
         ++p2;
     }
     //the following should force a constant time eval of the condition without a compiler "logical shortcut"
-    unsigned char equalcond = (equalchars == len);
+    unsigned char equalcond = (equalchars == len());
     unsigned char diffcond = (diffchars == 0);
     return (equalcond & diffcond); //bitwise AND
 }
 
 unsigned char String::startsWith(const String &s2) const {
-    if(len < s2.len)
+    if(len() < s2.len())
         return 0;
     return startsWith(s2, 0);
 }
 
 unsigned char String::startsWith(const String &s2, unsigned int offset) const {
-    if(offset > len - s2.len || !buffer || !s2.buffer)
+    if(offset > len() - s2.len() || !buffer() || !s2.buffer())
         return 0;
-    return strncmp(&buffer[offset], s2.buffer, s2.len) == 0;
+    return strncmp(&buffer()[offset], s2.buffer(), s2.len()) == 0;
 }
 
 unsigned char String::endsWith(const String &s2) const {
-    if(len < s2.len || !buffer || !s2.buffer)
+    if(len() < s2.len() || !buffer() || !s2.buffer())
         return 0;
-    return strcmp(&buffer[len - s2.len], s2.buffer) == 0;
+    return strcmp(&buffer()[len() - s2.len()], s2.buffer()) == 0;
 }
 
 // /*********************************************/
@@ -531,36 +604,36 @@ char String::charAt(unsigned int loc) const {
 }
 
 void String::setCharAt(unsigned int loc, char c) {
-    if(loc < len)
-        buffer[loc] = c;
+    if(loc < len())
+        wbuffer()[loc] = c;
 }
 
 char & String::operator[](unsigned int index) {
     static char dummy_writable_char;
-    if(index >= len || !buffer) {
+    if(index >= len() || !buffer()) {
         dummy_writable_char = 0;
         return dummy_writable_char;
     }
-    return buffer[index];
+    return wbuffer()[index];
 }
 
 char String::operator[](unsigned int index) const {
-    if(index >= len || !buffer)
+    if(index >= len() || !buffer())
         return 0;
-    return buffer[index];
+    return buffer()[index];
 }
 
 void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const {
     if(!bufsize || !buf)
         return;
-    if(index >= len) {
+    if(index >= len()) {
         buf[0] = 0;
         return;
     }
     unsigned int n = bufsize - 1;
-    if(n > len - index)
-        n = len - index;
-    strncpy((char *) buf, buffer + index, n);
+    if(n > len() - index)
+        n = len() - index;
+    strncpy((char *) buf, buffer() + index, n);
     buf[n] = 0;
 }
 
@@ -573,12 +646,12 @@ int String::indexOf(char c) const {
 }
 
 int String::indexOf(char ch, unsigned int fromIndex) const {
-    if(fromIndex >= len)
+    if(fromIndex >= len())
         return -1;
-    const char* temp = strchr(buffer + fromIndex, ch);
+    const char* temp = strchr(buffer() + fromIndex, ch);
     if(temp == NULL)
         return -1;
-    return temp - buffer;
+    return temp - buffer();
 }
 
 int String::indexOf(const String &s2) const {
@@ -586,46 +659,46 @@ int String::indexOf(const String &s2) const {
 }
 
 int String::indexOf(const String &s2, unsigned int fromIndex) const {
-    if(fromIndex >= len)
+    if(fromIndex >= len())
         return -1;
-    const char *found = strstr(buffer + fromIndex, s2.buffer);
+    const char *found = strstr(buffer() + fromIndex, s2.buffer());
     if(found == NULL)
         return -1;
-    return found - buffer;
+    return found - buffer();
 }
 
 int String::lastIndexOf(char theChar) const {
-    return lastIndexOf(theChar, len - 1);
+    return lastIndexOf(theChar, len() - 1);
 }
 
 int String::lastIndexOf(char ch, unsigned int fromIndex) const {
-    if(fromIndex >= len)
+    if(fromIndex >= len())
         return -1;
-    char tempchar = buffer[fromIndex + 1];
-    buffer[fromIndex + 1] = '\0';
-    char* temp = strrchr(buffer, ch);
-    buffer[fromIndex + 1] = tempchar;
+    char tempchar = wbuffer()[fromIndex + 1];
+    wbuffer()[fromIndex + 1] = '\0';
+    char* temp = strrchr(wbuffer(), ch);
+    wbuffer()[fromIndex + 1] = tempchar;
     if(temp == NULL)
         return -1;
-    return temp - buffer;
+    return temp - buffer();
 }
 
 int String::lastIndexOf(const String &s2) const {
-    return lastIndexOf(s2, len - s2.len);
+    return lastIndexOf(s2, len() - s2.len());
 }
 
 int String::lastIndexOf(const String &s2, unsigned int fromIndex) const {
-    if(s2.len == 0 || len == 0 || s2.len > len)
+    if(s2.len() == 0 || len() == 0 || s2.len() > len())
         return -1;
-    if(fromIndex >= len)
-        fromIndex = len - 1;
+    if(fromIndex >= len())
+        fromIndex = len() - 1;
     int found = -1;
-    for(char *p = buffer; p <= buffer + fromIndex; p++) {
-        p = strstr(p, s2.buffer);
+    for(char *p = wbuffer(); p <= wbuffer() + fromIndex; p++) {
+        p = strstr(p, s2.buffer());
         if(!p)
             break;
-        if((unsigned int) (p - buffer) <= fromIndex)
-            found = p - buffer;
+        if((unsigned int) (p - wbuffer()) <= fromIndex)
+            found = p - wbuffer();
     }
     return found;
 }
@@ -637,14 +710,14 @@ String String::substring(unsigned int left, unsigned int right) const {
         left = temp;
     }
     String out;
-    if(left >= len)
+    if(left >= len())
         return out;
-    if(right > len)
-        right = len;
-    char temp = buffer[right];  // save the replaced character
-    buffer[right] = '\0';
-    out = buffer + left;  // pointer arithmetic
-    buffer[right] = temp;  //restore character
+    if(right > len())
+        right = len();
+    char temp = wbuffer()[right];  // save the replaced character
+    wbuffer()[right] = '\0';
+    out = wbuffer() + left;  // pointer arithmetic
+    wbuffer()[right] = temp;  //restore character
     return out;
 }
 
@@ -653,57 +726,125 @@ String String::substring(unsigned int left, unsigned int right) const {
 // /*********************************************/
 
 void String::replace(char find, char replace) {
-    if(!buffer)
+    if(!buffer())
         return;
-    for(char *p = buffer; *p; p++) {
+    for(char *p = wbuffer(); *p; p++) {
         if(*p == find)
             *p = replace;
     }
 }
 
 void String::replace(const String& find, const String& replace) {
-    if(len == 0 || find.len == 0)
+    if(len() == 0 || find.len() == 0)
         return;
-    int diff = replace.len - find.len;
-    char *readFrom = buffer;
+    int diff = replace.len() - find.len();
+    char *readFrom = wbuffer();
     char *foundAt;
     if(diff == 0) {
-        while((foundAt = strstr(readFrom, find.buffer)) != NULL) {
-            memcpy(foundAt, replace.buffer, replace.len);
-            readFrom = foundAt + replace.len;
+        while((foundAt = strstr(readFrom, find.buffer())) != NULL) {
+            memcpy(foundAt, replace.buffer(), replace.len());
+            readFrom = foundAt + replace.len();
         }
-    } else if(diff < 0) {
-        char *writeTo = buffer;
-        while((foundAt = strstr(readFrom, find.buffer)) != NULL) {
-            unsigned int n = foundAt - readFrom;
-            memcpy(writeTo, readFrom, n);
-            writeTo += n;
-            memcpy(writeTo, replace.buffer, replace.len);
-            writeTo += replace.len;
-            readFrom = foundAt + find.len;
-            len += diff;
-        }
-        strcpy(writeTo, readFrom);
-    } else {
-        unsigned int size = len; // compute size needed for result
-        while((foundAt = strstr(readFrom, find.buffer)) != NULL) {
-            readFrom = foundAt + find.len;
+        return;
+    }
+    char *writeTo = wbuffer();
+    if(diff > 0) {
+        unsigned int size = len(); // compute size needed for result
+        while((foundAt = strstr(readFrom, find.buffer())) != NULL) {
+            readFrom = foundAt + find.len();
             size += diff;
         }
-        if(size == len)
+        if(size == len())
             return;
-        if(size > capacity && !changeBuffer(size))
+        if(size > capacity() && !changeBuffer(size))
             return; // XXX: tell user!
-        int index = len - 1;
-        while(index >= 0 && (index = lastIndexOf(find, index)) >= 0) {
-            readFrom = buffer + index + find.len;
-            memmove(readFrom + diff, readFrom, len - (readFrom - buffer));
-            len += diff;
-            buffer[len] = 0;
-            memcpy(buffer + index, replace.buffer, replace.len);
-            index--;
+        // Move the text to the end of the buffer and copy it back to the
+        // front with the replacements, in one pass: the copy gains diff at
+        // each match and never reaches what is still to be read.
+        unsigned int gap = size - len();
+        memmove(wbuffer() + gap, wbuffer(), len() + 1);
+        writeTo = wbuffer();
+        readFrom = writeTo + gap;
+    }
+    while((foundAt = strstr(readFrom, find.buffer())) != NULL) {
+        unsigned int n = foundAt - readFrom;
+        memmove(writeTo, readFrom, n);
+        writeTo += n;
+        memcpy(writeTo, replace.buffer(), replace.len());
+        writeTo += replace.len();
+        readFrom = foundAt + find.len();
+    }
+    unsigned int rest = strlen(readFrom);
+    memmove(writeTo, readFrom, rest + 1);
+    setLen(writeTo + rest - wbuffer());
+}
+
+// the first of find[] that is at p, or -1
+static int matchAt(const char *p, const char* const find[], unsigned int count, unsigned int *findLen) {
+    for(unsigned int i = 0; i < count; ++i) {
+        const char *f = find[i];
+        if(f && *f == *p) {
+            unsigned int n = strlen(f);
+            if(strncmp(p, f, n) == 0) {
+                *findLen = n;
+                return i;
+            }
         }
     }
+    return -1;
+}
+
+void String::replace(const char* const find[], const String with[], unsigned int count) {
+    if(len() == 0 || count == 0)
+        return;
+    // the characters a find starts with, so that most are passed by at once
+    uint32_t first[8] = { 0 };
+    for(unsigned int i = 0; i < count; ++i) {
+        if(find[i] && *find[i]) {
+            unsigned char c = *find[i];
+            first[c >> 5] |= 1u << (c & 31);
+        }
+    }
+    auto mayMatch = [&first](unsigned char c) {
+        return first[c >> 5] & (1u << (c & 31));
+    };
+    unsigned int size = len();
+    unsigned int matches = 0;
+    unsigned int n;
+    for(const char *p = buffer(); *p; ) {
+        int i = mayMatch(*p) ? matchAt(p, find, count, &n) : -1;
+        if(i >= 0) {
+            size += with[i].len() - n;
+            p += n;
+            ++matches;
+        } else {
+            ++p;
+        }
+    }
+    if(!matches)
+        return;
+    String result;
+    if(!result.reserve(size))
+        return; // XXX: tell user!
+    const char *copyFrom = buffer();
+    const char *p = copyFrom;
+    while(*p) {
+        int i = mayMatch(*p) ? matchAt(p, find, count, &n) : -1;
+        if(i < 0) {
+            ++p;
+            continue;
+        }
+        result.concat(copyFrom, p - copyFrom);
+        result.concat(with[i]);
+        p += n;
+        copyFrom = p;
+    }
+    result.concat(copyFrom, p - copyFrom);
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+    move(result);
+#else
+    *this = result;
+#endif
 }
 
 void String::remove(unsigned int index) {
@@ -714,50 +855,50 @@ void String::remove(unsigned int index) {
 }
 
 void String::remove(unsigned int index, unsigned int count) {
-    if(index >= len) {
+    if(index >= len()) {
         return;
     }
     if(count <= 0) {
         return;
     }
-    if(count > len - index) {
-        count = len - index;
+    if(count > len() - index) {
+        count = len() - index;
     }
-    char *writeTo = buffer + index;
-    len = len - count;
-    strncpy(writeTo, buffer + index + count, len - index);
-    buffer[len] = 0;
+    char *writeTo = wbuffer() + index;
+    setLen(len() - count);
+    memmove(writeTo, wbuffer() + index + count, len() - index);
+    wbuffer()[len()] = 0;
 }
 
 void String::toLowerCase(void) {
-    if(!buffer)
+    if(!buffer())
         return;
-    for(char *p = buffer; *p; p++) {
+    for(char *p = wbuffer(); *p; p++) {
         *p = tolower(*p);
     }
 }
 
 void String::toUpperCase(void) {
-    if(!buffer)
+    if(!buffer())
         return;
-    for(char *p = buffer; *p; p++) {
+    for(char *p = wbuffer(); *p; p++) {
         *p = toupper(*p);
     }
 }
 
 void String::trim(void) {
-    if(!buffer || len == 0)
+    if(!buffer() || len() == 0)
         return;
-    char *begin = buffer;
+    char *begin = wbuffer();
     while(isspace(*begin))
         begin++;
-    char *end = buffer + len - 1;
+    char *end = wbuffer() + len() - 1;
     while(isspace(*end) && end >= begin)
         end--;
-    len = end + 1 - begin;
-    if(begin > buffer)
-        memcpy(buffer, begin, len);
-    buffer[len] = 0;
+    setLen(end + 1 - begin);
+    if(begin > wbuffer())
+        memmove(wbuffer(), begin, len());
+    wbuffer()[len()] = 0;
 }
 
 // /*********************************************/
@@ -765,13 +906,13 @@ void String::trim(void) {
 // /*********************************************/
 
 long String::toInt(void) const {
-    if(buffer)
-        return atol(buffer);
+    if(buffer())
+        return atol(buffer());
     return 0;
 }
 
 float String::toFloat(void) const {
-    if(buffer)
-        return atof(buffer);
+    if(buffer())
+        return atof(buffer());
     return 0;
 }
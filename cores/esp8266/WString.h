@@ -24,6 +24,7 @@
 #ifdef __cplusplus
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
 #include <pgmspace.h>
@@ -75,9 +76,11 @@ class String {
         // is left unchanged).  reserve(0), if successful, will validate an
         // invalid string (i.e., "if (s)" will be true afterwards)
         unsigned char reserve(unsigned int size);
+        // give back the memory not needed for the current value
+        void shrink_to_fit(void);
         inline unsigned int length(void) const {
-            if(buffer) {
-                return len;
+            if(buffer()) {
+                return len();
             } else {
                 return 0;
             }
@@ -101,6 +104,7 @@ class String {
         // concatenation is considered unsucessful.
         unsigned char concat(const String &str);
         unsigned char concat(const char *cstr);
+        unsigned char concat(const char *cstr, unsigned int length); // length bytes of cstr
         unsigned char concat(char c);
         unsigned char concat(unsigned char c);
         unsigned char concat(int num);
@@ -172,7 +176,7 @@ class String {
 
         // comparison (only works w/ Strings and "strings")
         operator StringIfHelperType() const {
-            return buffer ? &String::StringIfHelper : 0;
+            return buffer() ? &String::StringIfHelper : 0;
         }
         int compareTo(const String &s) const;
         unsigned char equals(const String &s) const;
@@ -208,9 +212,9 @@ class String {
         void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const {
             getBytes((unsigned char *) buf, bufsize, index);
         }
-        const char* c_str() const { return buffer; }
-        char* begin() { return buffer; }
-        char* end() { return buffer + length(); }
+        const char* c_str() const { return buffer(); }
+        char* begin() { return wbuffer(); }
+        char* end() { return wbuffer() + length(); }
         const char* begin() const { return c_str(); }
         const char* end() const { return c_str() + length(); }
 
@@ -224,7 +228,7 @@ class String {
         int lastIndexOf(const String &str) const;
         int lastIndexOf(const String &str, unsigned int fromIndex) const;
         String substring(unsigned int beginIndex) const {
-            return substring(beginIndex, len);
+            return substring(beginIndex, len());
         }
         ;
         String substring(unsigned int beginIndex, unsigned int endIndex) const;
@@ -232,6 +236,10 @@ class String {
         // modification
         void replace(char find, char replace);
         void replace(const String& find, const String& replace);
+        // Replaces each find[i] with with[i], for templates with many
+        // placeholders: one pass over the string and a single allocation.
+        // Where several finds match, the first one in find[] is taken.
+        void replace(const char* const find[], const String with[], unsigned int count);
         void remove(unsigned int index);
         void remove(unsigned int index, unsigned int count);
         void toLowerCase(void);
@@ -243,14 +251,56 @@ class String {
         float toFloat(void) const;
 
     protected:
-        char *buffer;	        // the actual char array
-        unsigned int capacity;  // the array length minus one (for the '\0')
-        unsigned int len;       // the String length (not counting the '\0')
+        // Strings shorter than SSOSIZE are kept in the object itself (sso),
+        // longer ones on the heap (ptr). isSSO tells which, and shares the
+        // last byte with the inline length; a heap string never uses it.
+        struct _ptr {
+            char *buff;         // the actual char array, NULL when invalid
+            uint16_t cap;       // the array length minus one (for the '\0')
+            uint16_t len;       // the String length (not counting the '\0')
+        };
+        enum { SSOSIZE = sizeof(struct _ptr) + 8 - 1 };
+        struct _sso {
+            char buff[SSOSIZE];
+            unsigned char len : 7;
+            unsigned char isSSO : 1;
+        } __attribute__((packed));
+        enum { CAPACITY_MAX = 65535 };
+        union {
+            struct _ptr ptr;
+            struct _sso sso;
+        };
+
+        inline bool isSSO() const {
+            return sso.isSSO;
+        }
+        inline void setSSO(bool set) {
+            sso.isSSO = set;
+        }
+        inline unsigned int len() const {
+            return isSSO() ? sso.len : ptr.len;
+        }
+        inline void setLen(unsigned int len) {
+            if(isSSO())
+                sso.len = len;
+            else
+                ptr.len = len;
+        }
+        inline unsigned int capacity() const {
+            return isSSO() ? (unsigned int) SSOSIZE - 1 : ptr.cap;
+        }
+        inline const char *buffer() const {
+            return isSSO() ? sso.buff : ptr.buff;
+        }
+        // writable, also from const methods that restore what they change
+        inline char *wbuffer() const {
+            return isSSO() ? const_cast<char *>(sso.buff) : ptr.buff;
+        }
     protected:
         void init(void);
         void invalidate(void);
         unsigned char changeBuffer(unsigned int maxStrLen);
-        unsigned char concat(const char *cstr, unsigned int length);
+        unsigned char growTo(unsigned int size);
 
         // copy and move
         String & copy(const char *cstr, unsigned int length);
@@ -30,7 +30,12 @@ extern int umm_last_fail_alloc_size;
 
 void *operator new(size_t size)
 {
+#ifdef DEBUG_ESP_HEAP_PROFILE
+    // charge the object to the code doing the new
+    void *ret = malloc_caller(size, __builtin_return_address(0));
+#else
     void *ret = malloc(size);
+#endif
     if (0 != size && 0 == ret) {
         umm_last_fail_alloc_addr = __builtin_return_address(0);
         umm_last_fail_alloc_size = size;
@@ -40,7 +45,12 @@ void *operator new(size_t size)
 
 void *operator new[](size_t size)
 {
+#ifdef DEBUG_ESP_HEAP_PROFILE
+    // charge the object to the code doing the new
+    void *ret = malloc_caller(size, __builtin_return_address(0));
+#else
     void *ret = malloc(size);
+#endif
     if (0 != size && 0 == ret) {
         umm_last_fail_alloc_addr = __builtin_return_address(0);
         umm_last_fail_alloc_size = size;
@@ -22,7 +22,7 @@
  *
  */
 
-#include "Arduino.h"
+#include <Arduino.h>
 extern "C" {
 #include "libb64/cdecode.h"
 #include "libb64/cencode.h"
@@ -68,3 +68,142 @@ String base64::encode(String text, bool doNewLines) {
     return base64::encode((uint8_t *) text.c_str(), text.length(), doNewLines);
 }
 
+// encoding 192 bytes at a time gives 256 characters and up to 4 newlines
+#define BASE64_ENCODE_CHUNK 192
+// and decoding 64 characters at most 48 bytes, and the one libb64 adds
+#define BASE64_DECODE_CHUNK 64
+
+Base64Encoder::Base64Encoder(Print & out, bool doNewLines) : _out(out), _ended(false) {
+    if(doNewLines) {
+        base64_init_encodestate(&_state);
+    } else {
+        base64_init_encodestate_nonewlines(&_state);
+    }
+}
+
+Base64Encoder::~Base64Encoder() {
+    end();
+}
+
+size_t Base64Encoder::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t Base64Encoder::write(const uint8_t * data, size_t size) {
+    if(_ended) {
+        return 0;
+    }
+    char code[BASE64_ENCODE_CHUNK / 3 * 4 + 8];
+    size_t done = 0;
+    while(done < size) {
+        size_t chunk = size - done;
+        if(chunk > BASE64_ENCODE_CHUNK) {
+            chunk = BASE64_ENCODE_CHUNK;
+        }
+        int len = base64_encode_block((const char *) data + done, chunk, code, &_state);
+        if(_out.write((const uint8_t *) code, len) != (size_t) len) {
+            setWriteError();
+            break;
+        }
+        done += chunk;
+    }
+    return done;
+}
+
+size_t Base64Encoder::end() {
+    if(_ended) {
+        return 0;
+    }
+    _ended = true;
+    char code[4];
+    int len = base64_encode_blockend(code, &_state);
+    return _out.write((const uint8_t *) code, len);
+}
+
+Base64Decoder::Base64Decoder(Print & out) : _out(out) {
+    base64_init_decodestate(&_state);
+}
+
+size_t Base64Decoder::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t Base64Decoder::write(const uint8_t * data, size_t size) {
+    char plain[BASE64_DECODE_CHUNK / 4 * 3 + 1];
+    size_t done = 0;
+    while(done < size) {
+        size_t chunk = size - done;
+        if(chunk > BASE64_DECODE_CHUNK) {
+            chunk = BASE64_DECODE_CHUNK;
+        }
+        int len = base64_decode_block((const char *) data + done, chunk, plain, &_state);
+        if(len > 0 && _out.write((const uint8_t *) plain, len) != (size_t) len) {
+            setWriteError();
+            break;
+        }
+        done += chunk;
+    }
+    return done;
+}
+
+Base64DecodeStream::Base64DecodeStream(Stream & in) : _in(in), _pos(0), _len(0) {
+    base64_init_decodestate(&_state);
+}
+
+// decodes what in has, up to a chunk; false when that gave nothing
+bool Base64DecodeStream::_fill() {
+    _pos = 0;
+    _len = 0;
+    char code[BASE64_DECODE_CHUNK];
+    while(_len == 0) {
+        int available = _in.available();
+        if(available <= 0) {
+            return false;
+        }
+        size_t len = (size_t) available;
+        if(len > sizeof(code)) {
+            len = sizeof(code);
+        }
+        len = _in.readBytes(code, len);
+        if(len == 0) {
+            return false;
+        }
+        _len = base64_decode_block(code, len, (char *) _buf, &_state);
+    }
+    return true;
+}
+
+int Base64DecodeStream::available() {
+    return (_len - _pos) + _in.available() / 4 * 3;
+}
+
+int Base64DecodeStream::read() {
+    if(_pos == _len && !_fill()) {
+        return -1;
+    }
+    return _buf[_pos++];
+}
+
+int Base64DecodeStream::peek() {
+    if(_pos == _len && !_fill()) {
+        return -1;
+    }
+    return _buf[_pos];
+}
+
+size_t Base64DecodeStream::readBytes(char * buffer, size_t length) {
+    size_t done = 0;
+    while(done < length) {
+        if(_pos == _len && !_fill()) {
+            break;
+        }
+        size_t piece = _len - _pos;
+        if(piece > length - done) {
+            piece = length - done;
+        }
+        memcpy(buffer + done, _buf + _pos, piece);
+        _pos += piece;
+        done += piece;
+    }
+    return done;
+}
@@ -25,6 +25,10 @@
 #ifndef CORE_BASE64_H_
 #define CORE_BASE64_H_
 
+#include <Stream.h>
+#include "libb64/cencode.h"
+#include "libb64/cdecode.h"
+
 class base64 {
     public:
         // NOTE: The default behaviour of backend (lib64)
@@ -35,5 +39,61 @@ class base64 {
     private:
 };
 
+// A Print that base64 encodes what is written to it on the fly and writes
+// the characters to out, a chunk at a time, e.g. a file through a
+// WiFiClient without holding either in RAM. end() writes the padding; the
+// destructor calls it if that wasn't done.
+class Base64Encoder : public Print {
+    public:
+        Base64Encoder(Print & out, bool doNewLines = true);
+        ~Base64Encoder();
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t * data, size_t size) override;
+        using Print::write;
+        // the last characters and padding, after which nothing more is taken
+        size_t end();
+    private:
+        Print & _out;
+        base64_encodestate _state;
+        bool _ended;
+};
+
+// A Print that decodes the base64 written to it and writes the data to out,
+// e.g. a firmware image from a JSON string into Update. Newlines, padding
+// and other characters outside the alphabet are skipped.
+class Base64Decoder : public Print {
+    public:
+        Base64Decoder(Print & out);
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t * data, size_t size) override;
+        using Print::write;
+    private:
+        Print & _out;
+        base64_decodestate _state;
+};
+
+// A Stream that reads base64 from in and gives the decoded data, for what
+// reads from a Stream, like Update.writeStream() or MD5Builder::addStream().
+// readBytes() returns what in has now rather than wait for more; available()
+// counts three bytes for every four characters in has, which newlines in
+// them make a little too many.
+class Base64DecodeStream : public Stream {
+    public:
+        Base64DecodeStream(Stream & in);
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t readBytes(char * buffer, size_t length) override;
+        using Stream::readBytes;
+        size_t write(uint8_t) override { return 0; }
+    private:
+        bool _fill();
+        Stream & _in;
+        base64_decodestate _state;
+        uint8_t _buf[49];   // decoded and not read yet, one more for libb64
+        uint8_t _pos;
+        uint8_t _len;
+};
+
 
 #endif /* CORE_BASE64_H_ */
@@ -177,3 +177,164 @@ size_t cbuf::remove(size_t size) {
     _begin = wrap_if_bufend(_begin + size_to_remove);
     return available();
 }
+
+cbuf_span cbuf::getReadSpan() {
+    if(_end >= _begin) {
+        return { _begin, (size_t) (_end - _begin), _buf, 0 };
+    }
+    return { _begin, (size_t) (_bufend - _begin), _buf, (size_t) (_end - _buf) };
+}
+
+cbuf_span cbuf::getWriteSpan() {
+    // one byte stays free, to tell a full buffer from an empty one
+    if(_end < _begin) {
+        return { _end, (size_t) (_begin - _end - 1), _buf, 0 };
+    }
+    if(_begin == _buf) {
+        return { _end, (size_t) (_bufend - _end - 1), _buf, 0 };
+    }
+    return { _end, (size_t) (_bufend - _end), _buf, (size_t) (_begin - _buf - 1) };
+}
+
+size_t cbuf::commitWrite(size_t size) {
+    size_t bytes_available = room();
+    size_t size_to_write = (size < bytes_available) ? size : bytes_available;
+    size_t top_size = _bufend - _end;
+    if(size_to_write >= top_size) {
+        _end = _buf + (size_to_write - top_size);
+    } else {
+        _end += size_to_write;
+    }
+    return size_to_write;
+}
+
+// Data is copied before the index that hands it over is moved, and read
+// after the index that says it is there; on the single core an interrupt
+// sees the stores in program order, so keeping the compiler from moving
+// them is all it takes.
+static inline void spsc_barrier() {
+    __asm__ __volatile__ ("" ::: "memory");
+}
+
+spsc_cbuf::spsc_cbuf(size_t size) :
+    _buf(nullptr), _size(0), _head(0), _tail(0) {
+    size_t rounded = 1;
+    while(rounded < size) {
+        rounded <<= 1;
+    }
+    _buf = new char[rounded];
+    if(_buf) {
+        _size = rounded;
+    }
+}
+
+spsc_cbuf::~spsc_cbuf() {
+    delete[] _buf;
+}
+
+cbuf_span ICACHE_RAM_ATTR spsc_cbuf::span(size_t pos, size_t size) {
+    size_t start = pos & (_size - 1);
+    size_t top_size = _size - start;
+    if(size <= top_size) {
+        return { _buf + start, size, _buf, 0 };
+    }
+    return { _buf + start, top_size, _buf, size - top_size };
+}
+
+int ICACHE_RAM_ATTR spsc_cbuf::peek() {
+    size_t tail = _tail;
+    if(_head == tail)
+        return -1;
+
+    spsc_barrier();
+    return static_cast<int>(_buf[tail & (_size - 1)]);
+}
+
+size_t ICACHE_RAM_ATTR spsc_cbuf::peek(char *dst, size_t size) {
+    cbuf_span data = getReadSpan();
+    if(size > data.size()) {
+        size = data.size();
+    }
+    size_t top_size = (size < data.firstSize) ? size : data.firstSize;
+    memcpy(dst, data.first, top_size);
+    memcpy(dst + top_size, data.second, size - top_size);
+    return size;
+}
+
+int ICACHE_RAM_ATTR spsc_cbuf::read() {
+    size_t tail = _tail;
+    if(_head == tail)
+        return -1;
+
+    spsc_barrier();
+    char result = _buf[tail & (_size - 1)];
+    spsc_barrier();
+    _tail = tail + 1;
+    return static_cast<int>(result);
+}
+
+size_t ICACHE_RAM_ATTR spsc_cbuf::read(char* dst, size_t size) {
+    return commitRead(peek(dst, size));
+}
+
+size_t ICACHE_RAM_ATTR spsc_cbuf::write(char c) {
+    size_t head = _head;
+    if(head - _tail == _size)
+        return 0;
+
+    _buf[head & (_size - 1)] = c;
+    spsc_barrier();
+    _head = head + 1;
+    return 1;
+}
+
+size_t ICACHE_RAM_ATTR spsc_cbuf::write(const char* src, size_t size) {
+    cbuf_span free_space = getWriteSpan();
+    if(size > free_space.size()) {
+        size = free_space.size();
+    }
+    size_t top_size = (size < free_space.firstSize) ? size : free_space.firstSize;
+    memcpy(free_space.first, src, top_size);
+    memcpy(free_space.second, src + top_size, size - top_size);
+    return commitWrite(size);
+}
+
+void ICACHE_RAM_ATTR spsc_cbuf::flush() {
+    _tail = _head;
+}
+
+cbuf_span ICACHE_RAM_ATTR spsc_cbuf::getReadSpan() {
+    size_t tail = _tail;
+    size_t size = _head - tail;
+    spsc_barrier();
+    return span(tail, size);
+}
+
+size_t ICACHE_RAM_ATTR spsc_cbuf::commitRead(size_t size) {
+    size_t tail = _tail;
+    size_t bytes_available = _head - tail;
+    if(size > bytes_available) {
+        size = bytes_available;
+    }
+    spsc_barrier();
+    _tail = tail + size;
+    return size;
+}
+
+cbuf_span ICACHE_RAM_ATTR spsc_cbuf::getWriteSpan() {
+    size_t head = _head;
+    size_t size = _size - (head - _tail);
+    spsc_barrier();
+    return span(head, size);
+}
+
+size_t ICACHE_RAM_ATTR spsc_cbuf::commitWrite(size_t size) {
+    size_t head = _head;
+    size_t bytes_available = _size - (head - _tail);
+    if(size > bytes_available) {
+        size = bytes_available;
+    }
+    spsc_barrier();
+    _head = head + size;
+    return size;
+}
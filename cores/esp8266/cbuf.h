@@ -25,6 +25,19 @@
 #include <stdint.h>
 #include <string.h>
 
+// A region of a ring buffer, in at most two contiguous pieces: second is
+// only used when the region wraps around the end of the buffer.
+struct cbuf_span {
+    char* first;
+    size_t firstSize;
+    char* second;
+    size_t secondSize;
+
+    size_t size() const {
+        return firstSize + secondSize;
+    }
+};
+
 class cbuf {
     public:
         cbuf(size_t size);
@@ -57,6 +70,14 @@ class cbuf {
         void flush();
         size_t remove(size_t size);
 
+        // The data available, to be used in place; remove() then drops
+        // what was used.
+        cbuf_span getReadSpan();
+        // The room left, to be filled in place (e.g. by a DMA or a memcpy);
+        // commitWrite() then adds what was filled to the data available.
+        cbuf_span getWriteSpan();
+        size_t commitWrite(size_t size);
+
         cbuf *next;
 
     private:
@@ -72,4 +93,66 @@ class cbuf {
 
 };
 
+// A cbuf for one producer and one consumer, which can be an interrupt and
+// loop(): neither side takes a lock or disables interrupts. The size is
+// rounded up to a power of two and all of it can be used. The producer
+// only calls write(), getWriteSpan() and commitWrite(), the consumer only
+// peek(), read(), getReadSpan(), commitRead() and flush(); available(),
+// room() and the like can be called from either side.
+class spsc_cbuf {
+    public:
+        spsc_cbuf(size_t size);
+        ~spsc_cbuf();
+
+        spsc_cbuf(const spsc_cbuf&) = delete;
+        spsc_cbuf& operator=(const spsc_cbuf&) = delete;
+
+        size_t size() const {
+            return _size;
+        }
+
+        size_t available() const {
+            return _head - _tail;
+        }
+
+        size_t room() const {
+            return _size - (_head - _tail);
+        }
+
+        inline bool empty() const {
+            return _head == _tail;
+        }
+
+        inline bool full() const {
+            return room() == 0;
+        }
+
+        int peek();
+        size_t peek(char *dst, size_t size);
+
+        int read();
+        size_t read(char* dst, size_t size);
+
+        size_t write(char c);
+        size_t write(const char* src, size_t size);
+
+        // drops all the data available
+        void flush();
+
+        cbuf_span getReadSpan();
+        size_t commitRead(size_t size);
+
+        cbuf_span getWriteSpan();
+        size_t commitWrite(size_t size);
+
+    private:
+        cbuf_span span(size_t pos, size_t size);
+
+        char* _buf;
+        size_t _size;
+        // free running: the producer moves _head, the consumer _tail
+        volatile size_t _head;
+        volatile size_t _tail;
+};
+
 #endif//__cbuf_h
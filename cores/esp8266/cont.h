@@ -22,6 +22,7 @@
 #define CONT_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifndef CONT_STACKSIZE
 #define CONT_STACKSIZE 4096
@@ -48,6 +49,15 @@ typedef struct cont_ {
 // Initialize the cont_t structure before calling cont_run
 void cont_init(cont_t*);
 
+// Bytes taken by a cont_t with a stack of stack_size bytes instead of
+// CONT_STACKSIZE, for continuations allocated at run time
+#define CONT_SIZE(stack_size) (offsetof(cont_t, stack) + ((stack_size) & ~3) + 2 * sizeof(unsigned))
+
+// Initialize a cont_t of CONT_SIZE(stack_size) bytes. The guard and the
+// pointer back to the structure, which cont_run expects after the stack,
+// are placed after the stack_size bytes.
+void cont_init_size(cont_t*, size_t stack_size);
+
 // Run function pfn in a separate stack, or continue execution
 // at the point where cont_yield was called
 void cont_run(cont_t*, void (*pfn)(void));
@@ -64,6 +74,9 @@ int cont_check(cont_t* cont);
 // and thus weren't used by the user code. i.e. that stack space is free. (high water mark)
 int cont_get_free_stack(cont_t* cont);
 
+// Bytes of stack, as given to cont_init_size()
+int cont_get_stack_size(cont_t* cont);
+
 // Check if yield() may be called. Returns true if we are running inside
 // continuation stack
 bool cont_can_yield(cont_t* cont);
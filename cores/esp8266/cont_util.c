@@ -26,20 +26,28 @@
 #define CONT_STACKGUARD 0xfeefeffe
 
 void ICACHE_RAM_ATTR cont_init(cont_t* cont) {
+    cont_init_size(cont, sizeof(cont->stack));
+}
+
+void ICACHE_RAM_ATTR cont_init_size(cont_t* cont, size_t stack_size) {
+    cont->pc_ret = 0;
+    cont->pc_yield = 0;
     cont->stack_guard1 = CONT_STACKGUARD;
-    cont->stack_guard2 = CONT_STACKGUARD;
-    cont->stack_end = cont->stack + (sizeof(cont->stack) / 4);
-    cont->struct_start = (unsigned*) cont;
+    // the stack pointer has to stay 16-byte aligned
+    cont->stack_end = (unsigned*) ((uint32_t) (cont->stack + (stack_size / 4)) & ~15);
+    // stack_guard2 and struct_start of a full size cont_t
+    cont->stack_end[0] = CONT_STACKGUARD;
+    cont->stack_end[1] = (unsigned) cont;
     
     // fill stack with magic values to check high water mark
-    for(int pos = 0; pos < (int)(sizeof(cont->stack) / 4); pos++)
+    for(unsigned* pos = cont->stack; pos < cont->stack_end; pos++)
     {
-        cont->stack[pos] = CONT_STACKGUARD;
+        *pos = CONT_STACKGUARD;
     }
 }
 
 int ICACHE_RAM_ATTR cont_check(cont_t* cont) {
-    if(cont->stack_guard1 != CONT_STACKGUARD || cont->stack_guard2 != CONT_STACKGUARD) return 1;
+    if(cont->stack_guard1 != CONT_STACKGUARD || cont->stack_end[0] != CONT_STACKGUARD) return 1;
 
     return 0;
 }
@@ -48,7 +56,7 @@ int ICACHE_RAM_ATTR cont_get_free_stack(cont_t* cont) {
     uint32_t *head = cont->stack;
     int freeWords = 0;
 
-    while(*head == CONT_STACKGUARD)
+    while(head < cont->stack_end && *head == CONT_STACKGUARD)
     {
         head++;
         freeWords++;
@@ -57,6 +65,10 @@ int ICACHE_RAM_ATTR cont_get_free_stack(cont_t* cont) {
     return freeWords * 4;
 }
 
+int ICACHE_RAM_ATTR cont_get_stack_size(cont_t* cont) {
+    return (cont->stack_end - cont->stack) * 4;
+}
+
 bool ICACHE_RAM_ATTR cont_can_yield(cont_t* cont) {
     return !ETS_INTR_WITHINISR() &&
            cont->pc_ret != 0 && cont->pc_yield == 0;
@@ -0,0 +1,159 @@
+/*
+ core_esp8266_app_slots.c - the slot log of the A/B layouts
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "c_types.h"
+#include "spi_flash.h"
+#include "flash_utils.h"
+#include "eboot_command.h"
+#include "coredecls.h"
+
+// in core_esp8266_app_slots_mmap.c, linked by the A/B ld scripts only
+extern uint8_t app_slot_booted __attribute__((weak));
+
+#define SLOT_LOG_RECORDS (SPI_FLASH_SEC_SIZE / sizeof(struct eboot_slot_record))
+
+static bool s_defer_confirm = false;
+
+static uint32_t record_crc(const struct eboot_slot_record* rec)
+{
+    return crc_update(0xffffffff, (const uint8_t*) rec, offsetof(struct eboot_slot_record, crc32));
+}
+
+// Find the record that counts, as eboot does. Returns its index, -1 if
+// there is none; blank gets the index of the first free one, -1 if full.
+static int read_log(struct eboot_slot_record* last, int* blank)
+{
+    struct eboot_slot_record rec;
+    int found = -1;
+    *blank = -1;
+    for (size_t i = 0; i < SLOT_LOG_RECORDS; ++i) {
+        if (spi_flash_read(EBOOT_SLOT_LOG + i * sizeof(rec), (uint32_t*) &rec, sizeof(rec)) != SPI_FLASH_RESULT_OK) {
+            break;
+        }
+        if (rec.magic == 0xffffffff) {
+            *blank = i;
+            break;
+        }
+        if (rec.magic == EBOOT_SLOT_MAGIC && rec.slot < 2 && rec.fallback < 2 && rec.crc32 == record_crc(&rec)) {
+            *last = rec;
+            found = i;
+        }
+    }
+    return found;
+}
+
+static uint32_t home_crc(void)
+{
+    uint32_t buffer[64];
+    uint32_t crc = 0xffffffff;
+    for (uint32_t pos = 0; pos < SPI_FLASH_SEC_SIZE; pos += sizeof(buffer)) {
+        if (spi_flash_read(APP_START_OFFSET + pos, buffer, sizeof(buffer)) != SPI_FLASH_RESULT_OK) {
+            return 0;
+        }
+        crc = crc_update(crc, (const uint8_t*) buffer, sizeof(buffer));
+    }
+    return crc;
+}
+
+int app_slot_current(void)
+{
+    if (!&app_slot_booted) {
+        return -1;
+    }
+    return app_slot_booted & 1;
+}
+
+uint32_t app_slot_address(int slot)
+{
+    return (slot > 0) ? slot * EBOOT_SLOT_SIZE : 0;
+}
+
+static bool is_trial(const struct eboot_slot_record* last)
+{
+    return last->trial && last->slot == (uint32_t) app_slot_current();
+}
+
+bool app_slot_is_trial(void)
+{
+    struct eboot_slot_record last;
+    int blank;
+    return app_slot_current() >= 0 && read_log(&last, &blank) >= 0 && is_trial(&last);
+}
+
+bool app_slot_switch(int slot)
+{
+    int current = app_slot_current();
+    if (current < 0 || slot < 0 || slot > 1) {
+        return false;
+    }
+    struct eboot_slot_record rec;
+    int blank;
+    read_log(&rec, &blank);   // for the first free record
+
+    rec.magic = EBOOT_SLOT_MAGIC;
+    rec.slot = slot;
+    rec.fallback = current;
+    rec.home_crc = home_crc();
+    rec.crc32 = record_crc(&rec);
+    rec.tries = (1 << EBOOT_SLOT_TRIES) - 1;
+    // the other slot starts a trial
+    rec.trial = (slot == current) ? 0 : 0xffffffff;
+    rec.reserved = 0xffffffff;
+
+    if (blank < 0) {
+        if (spi_flash_erase_sector(EBOOT_SLOT_LOG / SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK) {
+            return false;
+        }
+        blank = 0;
+    }
+    return spi_flash_write(EBOOT_SLOT_LOG + blank * sizeof(rec), (uint32_t*) &rec, sizeof(rec)) == SPI_FLASH_RESULT_OK;
+}
+
+bool app_slot_confirm(void)
+{
+    if (app_slot_current() < 0) {
+        return false;
+    }
+    struct eboot_slot_record last;
+    int blank;
+    int found = read_log(&last, &blank);
+    if (found < 0 || !is_trial(&last)) {
+        return true;
+    }
+    // clearing bits needs no erase
+    uint32_t confirmed = 0;
+    uint32_t addr = EBOOT_SLOT_LOG + found * sizeof(last) + offsetof(struct eboot_slot_record, trial);
+    return spi_flash_write(addr, &confirmed, sizeof(confirmed)) == SPI_FLASH_RESULT_OK;
+}
+
+void app_slot_defer_confirm(void)
+{
+    s_defer_confirm = true;
+}
+
+// after the first loop(), unless the sketch confirms itself
+void app_slot_auto_confirm(void)
+{
+    if (!s_defer_confirm && app_slot_current() >= 0) {
+        app_slot_confirm();
+    }
+}
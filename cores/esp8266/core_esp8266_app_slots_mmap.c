@@ -0,0 +1,44 @@
+/*
+ core_esp8266_app_slots_mmap.c - maps the sketch slot eboot started
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Only the A/B ld scripts link this (EXTERN(app_slot_booted)), the other
+// layouts keep the Cache_Read_Enable_New() of libmain, made weak for this
+// by tools/sdk/lib/fix_sdk_libs.sh, which maps the first MB.
+
+#include <stdint.h>
+#include "c_types.h"
+#include "eboot_command.h"
+
+extern void Cache_Read_Enable(uint8_t odd_even, uint8_t mb_count, uint8_t no_idea);
+
+// the slot running, 0xff until the first call below; in .data, which eboot
+// loads, as the SDK maps the flash before the sketch clears .bss
+uint8_t app_slot_booted = 0xff;
+
+// The SDK calls it at start and after each flash operation, to map the
+// flash at 0x40200000 again
+void ICACHE_RAM_ATTR Cache_Read_Enable_New(void)
+{
+    if (app_slot_booted == 0xff) {
+        uint32_t booted = EBOOT_SLOT_BOOTED;
+        app_slot_booted = ((booted & ~1) == EBOOT_SLOT_BOOTED_MAGIC) ? (booted & 1) : 0;
+    }
+    // MB of the slot: odd or even, in which 2 MB block
+    Cache_Read_Enable(app_slot_booted & 1, app_slot_booted >> 1, 1);
+}
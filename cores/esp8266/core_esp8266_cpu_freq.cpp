@@ -0,0 +1,137 @@
+/*
+ core_esp8266_cpu_freq.cpp - switching the CPU between 80 and 160 MHz
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// millis(), micros(), the UARTs and timer1 run on clocks of their own and
+// don't notice a switch. What counts CPU cycles does: the PWM and servo
+// edges, which are due at a cycle count, are moved to the cycle they now
+// fall on, and the bit-banged I2C picks the delays for the new clock.
+// Switches only happen from the loop task, never during an I2C transfer
+// or pulseIn(), nor from an interrupt.
+
+#include <Arduino.h>
+#include "coredecls.h"
+extern "C" {
+#include "user_interface.h"
+}
+
+// only there when the sketch uses analogWrite(), Servo or Wire
+extern "C" void pwm_cpu_freq_before(void) __attribute__((weak));
+extern "C" void pwm_cpu_freq_after(uint32_t old_mhz, uint32_t new_mhz) __attribute__((weak));
+extern "C" void twi_cpu_freq_changed(void) __attribute__((weak));
+extern "C" uint32_t ets_get_cpu_frequency(void);
+
+#define CPU_FREQ_WINDOW_US 100000
+// part of the window the loop task has to be busy for, in %
+#define CPU_FREQ_UP_BUSY   50
+#define CPU_FREQ_DOWN_BUSY 20
+
+static uint8_t s_base_mhz = F_CPU / 1000000L;   // set by ESP.setCpuFrequencyMHz()
+static uint8_t s_auto_mhz = F_CPU / 1000000L;   // picked by the automatic mode
+static bool s_auto = false;
+static uint8_t s_boosts = 0;
+static uint32_t s_window_start = 0;
+static uint32_t s_window_busy = 0;
+
+uint32_t ICACHE_RAM_ATTR esp_get_cpu_freq_mhz(void)
+{
+    return ets_get_cpu_frequency();
+}
+
+static void cpu_freq_switch(uint8_t mhz)
+{
+    uint8_t old_mhz = ets_get_cpu_frequency();
+    if (mhz == old_mhz) {
+        return;
+    }
+    uint32_t savedPS = xt_rsil(15);
+    if (pwm_cpu_freq_before) {
+        pwm_cpu_freq_before();
+    }
+    system_update_cpu_freq(mhz);
+    if (pwm_cpu_freq_after) {
+        pwm_cpu_freq_after(old_mhz, mhz);
+    }
+    xt_wsr_ps(savedPS);
+    if (twi_cpu_freq_changed) {
+        twi_cpu_freq_changed();
+    }
+}
+
+// The frequency wanted now. Called before every loop(), as the SDK may have
+// set another one meanwhile.
+void cpu_freq_update(void)
+{
+    if (ETS_INTR_WITHINISR()) {
+        return;    // before the next loop()
+    }
+    uint8_t mhz = s_auto ? s_auto_mhz : s_base_mhz;
+    cpu_freq_switch(s_boosts ? 160 : mhz);
+}
+
+bool cpu_freq_set(uint8_t mhz)
+{
+    if (mhz != 80 && mhz != 160) {
+        return false;
+    }
+    s_base_mhz = mhz;
+    cpu_freq_update();
+    return true;
+}
+
+void cpu_freq_auto(bool enable)
+{
+    s_auto = enable;
+    s_auto_mhz = s_base_mhz;
+    s_window_start = system_get_time();
+    s_window_busy = 0;
+    cpu_freq_update();
+}
+
+void cpu_freq_boost(bool begin)
+{
+    if (begin) {
+        ++s_boosts;
+    } else if (s_boosts) {
+        --s_boosts;
+    }
+    cpu_freq_update();
+}
+
+// After each run of the loop task, which was busy for busy_us: the share of
+// a window it was busy for decides the frequency, with some hysteresis
+void cpu_freq_loop_task(uint32_t busy_us)
+{
+    if (!s_auto) {
+        return;
+    }
+    s_window_busy += busy_us;
+    uint32_t elapsed = system_get_time() - s_window_start;
+    if (elapsed < CPU_FREQ_WINDOW_US) {
+        return;
+    }
+    uint32_t busy = (uint64_t) s_window_busy * 100 / elapsed;
+    if (busy >= CPU_FREQ_UP_BUSY) {
+        s_auto_mhz = 160;
+    } else if (busy < CPU_FREQ_DOWN_BUSY) {
+        s_auto_mhz = 80;
+    }
+    s_window_start += elapsed;
+    s_window_busy = 0;
+    cpu_freq_update();
+}
@@ -0,0 +1,185 @@
+/*
+ core_esp8266_crash_dump.c - crash record kept in a flash sector across resets
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "c_types.h"
+#include "spi_flash.h"
+#include "CrashDump.h"
+
+// The record starts the sector, the last word counts the crashes that
+// found it still there: each one clears a bit, which needs no erase.
+#define CRASH_DUMP_MISSED_OFFSET (SPI_FLASH_SEC_SIZE - 4)
+#define CRASH_DUMP_MAX_STACK (CRASH_DUMP_MISSED_OFFSET - sizeof(crash_dump_t))
+
+static uint32_t s_sector = 0;
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t size)
+{
+    // bit by bit, no table: it runs once per crash and once per read
+    while (size--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+static bool read_header(crash_dump_t* dump)
+{
+    if (!s_sector || spi_flash_read(s_sector * SPI_FLASH_SEC_SIZE, (uint32_t*) dump, sizeof(*dump)) != SPI_FLASH_RESULT_OK) {
+        return false;
+    }
+    return dump->magic == CRASH_DUMP_MAGIC && dump->version == CRASH_DUMP_VERSION &&
+           dump->header_size == sizeof(*dump) && dump->stack_size <= CRASH_DUMP_MAX_STACK &&
+           !(dump->stack_size & 3);
+}
+
+// Check the CRC reading the record in pieces, copying up to size bytes of it
+// to buffer on the way. Returns the size of the record, 0 if it isn't one.
+static size_t read_record(uint8_t* buffer, size_t size)
+{
+    crash_dump_t dump;
+    if (!read_header(&dump)) {
+        return 0;
+    }
+    uint32_t expected = dump.crc;
+    dump.crc = 0;
+    uint32_t crc = crc32_update(0xffffffff, (const uint8_t*) &dump, sizeof(dump));
+    dump.crc = expected;
+    if (size) {
+        memcpy(buffer, &dump, (size < sizeof(dump)) ? size : sizeof(dump));
+    }
+
+    uint32_t chunk[32];
+    uint32_t addr = s_sector * SPI_FLASH_SEC_SIZE + sizeof(dump);
+    for (size_t done = 0; done < dump.stack_size; ) {
+        size_t len = dump.stack_size - done;
+        if (len > sizeof(chunk)) {
+            len = sizeof(chunk);
+        }
+        if (spi_flash_read(addr + done, chunk, len) != SPI_FLASH_RESULT_OK) {
+            return 0;
+        }
+        crc = crc32_update(crc, (const uint8_t*) chunk, len);
+        size_t offset = sizeof(dump) + done;
+        if (offset < size) {
+            memcpy(buffer + offset, chunk, (size - offset < len) ? size - offset : len);
+        }
+        done += len;
+    }
+    if ((crc ^ 0xffffffff) != expected) {
+        return 0;
+    }
+    return sizeof(dump) + dump.stack_size;
+}
+
+void crash_dump_begin(uint32_t sector)
+{
+    s_sector = sector;
+    if (!s_sector) {
+        return;
+    }
+    // what a crash writes to must be erased beforehand, as there may be no
+    // time to do it then: anything that is neither a record nor blank goes
+    uint32_t words[sizeof(crash_dump_t) / 4];
+    if (spi_flash_read(s_sector * SPI_FLASH_SEC_SIZE, words, sizeof(words)) != SPI_FLASH_RESULT_OK) {
+        return;
+    }
+    bool blank = true;
+    for (size_t i = 0; i < sizeof(words) / 4; ++i) {
+        blank = blank && words[i] == 0xffffffff;
+    }
+    if (!blank && !read_record(NULL, 0)) {
+        crash_dump_clear();
+    }
+}
+
+size_t crash_dump_size(void)
+{
+    return read_record(NULL, 0);
+}
+
+size_t crash_dump_read(void* buffer, size_t size)
+{
+    size_t total = read_record((uint8_t*) buffer, size);
+    return (total < size) ? total : size;
+}
+
+uint32_t crash_dump_missed(void)
+{
+    uint32_t missed;
+    if (!s_sector || spi_flash_read(s_sector * SPI_FLASH_SEC_SIZE + CRASH_DUMP_MISSED_OFFSET, &missed, 4) != SPI_FLASH_RESULT_OK) {
+        return 0;
+    }
+    return 32 - __builtin_popcount(missed);
+}
+
+bool crash_dump_clear(void)
+{
+    return s_sector && spi_flash_erase_sector(s_sector) == SPI_FLASH_RESULT_OK;
+}
+
+// From the postmortem handler, with everything but the magic, CRC and
+// stack filled in. Runs from flash as the rest of the handler does.
+void crash_dump_save(crash_dump_t* dump, uint32_t stack_start, uint32_t stack_end)
+{
+    if (!s_sector) {
+        return;
+    }
+    uint32_t base = s_sector * SPI_FLASH_SEC_SIZE;
+    uint32_t magic;
+    if (spi_flash_read(base, &magic, 4) != SPI_FLASH_RESULT_OK) {
+        return;
+    }
+    if (magic != 0xffffffff) {
+        // the last one wasn't read yet, it is the one that counts
+        uint32_t missed;
+        if (spi_flash_read(base + CRASH_DUMP_MISSED_OFFSET, &missed, 4) == SPI_FLASH_RESULT_OK && missed) {
+            missed <<= 1;
+            spi_flash_write(base + CRASH_DUMP_MISSED_OFFSET, &missed, 4);
+        }
+        return;
+    }
+
+    uint32_t stack_size = (stack_end > stack_start) ? (stack_end - stack_start) & ~3 : 0;
+    if (stack_size > CRASH_DUMP_STACK_BYTES) {
+        stack_size = CRASH_DUMP_STACK_BYTES;
+    }
+    if (stack_size > CRASH_DUMP_MAX_STACK) {
+        stack_size = CRASH_DUMP_MAX_STACK;
+    }
+    dump->magic = CRASH_DUMP_MAGIC;
+    dump->version = CRASH_DUMP_VERSION;
+    dump->header_size = sizeof(*dump);
+    dump->stack_start = stack_start;
+    dump->stack_end = stack_end;
+    dump->stack_size = stack_size;
+    dump->crc = 0;
+    uint32_t crc = crc32_update(0xffffffff, (const uint8_t*) dump, sizeof(*dump));
+    crc = crc32_update(crc, (const uint8_t*) stack_start, stack_size);
+    dump->crc = crc ^ 0xffffffff;
+
+    // the stack first, so that a record cut short has no magic
+    if (stack_size) {
+        spi_flash_write(base + sizeof(*dump), (uint32_t*) stack_start, stack_size);
+    }
+    spi_flash_write(base, (uint32_t*) dump, sizeof(*dump));
+}
@@ -33,15 +33,21 @@
 #define I2SO_WS 2
 #define I2SO_DATA 3
 #define I2SO_BCK 15
+#define I2SI_DATA 12
+#define I2SI_BCK 13
+#define I2SI_WS 14
 
-#define SLC_BUF_CNT (8) //Number of buffers in the I2S circular buffer
-#define SLC_BUF_LEN (64) //Length of one buffer, in 32-bit words.
+#define SLC_BUF_CNT (8) //Default number of buffers in the I2S circular buffer
+#define SLC_BUF_LEN (64) //Default length of one buffer, in 32-bit words.
+#define SLC_BUF_CNT_MAX (128) //queue_len is 8 bits
+#define SLC_BUF_LEN_MAX (1023) //blocksize and datalen are 12 bits, in bytes
 
 //We use a queue to keep track of the DMA buffers that are empty. The ISR will push buffers to the back of the queue,
 //the mp3 decode will pull them from the front and fill them. For ease, the queue will contain *pointers* to the DMA
 //buffers, not the data itself. The queue depth is one smaller than the amount of buffers we have, because there's
 //always a buffer that is being used by the DMA subsystem *right now* and we don't want to be able to write to that
-//simultaneously.
+//simultaneously. Receiving works the same way the other way round: the ISR pushes the buffers the DMA filled, and
+//i2s_read_buffer() pulls them from the front.
 
 struct slc_queue_item {
   uint32  blocksize:12;
@@ -54,74 +60,199 @@ struct slc_queue_item {
   uint32  next_link_ptr;
 };
 
-static uint32_t i2s_slc_queue[SLC_BUF_CNT-1];
-static uint8_t i2s_slc_queue_len;
-static uint32_t *i2s_slc_buf_pntr[SLC_BUF_CNT]; //Pointer to the I2S DMA buffer data
-static struct slc_queue_item i2s_slc_items[SLC_BUF_CNT]; //I2S DMA buffer descriptors
-static uint32_t *i2s_curr_slc_buf=NULL;//current buffer for writing
-static int i2s_curr_slc_buf_pos=0; //position in the current buffer
-static void (*i2s_callback) (void)=0; //Callback function should be defined as 'void ICACHE_RAM_ATTR function_name()', placing the function in IRAM for faster execution. Avoid long computational tasks in this function, use it to set flags and process later.
+//The buffers of one direction
+struct i2s_dma {
+  uint32_t *queue; //buffers for the sketch, i2s_slc_buf_cnt-1 entries
+  volatile uint8_t queue_len;
+  uint32_t **buf_pntr; //Pointer to the I2S DMA buffer data
+  struct slc_queue_item *items; //I2S DMA buffer descriptors, NULL when stopped
+  uint32_t *curr_buf; //current buffer for writing or reading
+  size_t curr_buf_pos; //position in the current buffer
+  void (*callback) (void); //Callback function should be defined as 'void ICACHE_RAM_ATTR function_name()', placing the function in IRAM for faster execution. Avoid long computational tasks in this function, use it to set flags and process later.
+  volatile uint32_t lost; //buffers played empty (TX) or dropped before they were read (RX)
+};
+
+static size_t i2s_slc_buf_cnt = SLC_BUF_CNT; //set by i2s_set_buffers(), used from i2s_begin() on
+static size_t i2s_slc_buf_len = SLC_BUF_LEN;
+static struct i2s_dma i2s_tx; //sent to I2S through the SLC RX link
+static struct i2s_dma i2s_rx; //received from I2S through the SLC TX link
+static void (*i2s_refill_callback) (uint32_t *buffer, size_t length)=0; //Fills the buffer the DMA just finished with, from the ISR. Same rules as the callback.
+
+//A stream is sent once straight from the buffer of the sketch, through descriptors of its own. Its last one
+//leads to i2s_idle_item, which sends zeros in a loop without interrupts until the next stream.
+#define I2S_STREAM_ITEM_LEN (1023) //32-bit words per descriptor, datalen is 12 bits
+static struct slc_queue_item *i2s_stream_items = NULL;
+static size_t i2s_stream_items_cnt = 0;
+static struct slc_queue_item *volatile i2s_stream_last = NULL; //NULL once the DMA is done with the stream
+static bool i2s_stream_mode = false; //the ring isn't sent anymore
+static void (*i2s_stream_callback) (void)=0; //Same rules as the callback.
+static uint32_t i2s_idle_buf[4];
+static struct slc_queue_item i2s_idle_item;
 
 bool i2s_is_full(){
-  return (i2s_curr_slc_buf_pos==SLC_BUF_LEN || i2s_curr_slc_buf==NULL) && (i2s_slc_queue_len == 0);
+  return (i2s_tx.curr_buf_pos==i2s_slc_buf_len || i2s_tx.curr_buf==NULL) && (i2s_tx.queue_len == 0);
 }
 
 bool i2s_is_empty(){
-  return (i2s_slc_queue_len >= SLC_BUF_CNT-1);
+  return (i2s_tx.queue_len >= i2s_slc_buf_cnt-1);
 }
 
 int16_t i2s_available(){
-  return (SLC_BUF_CNT - i2s_slc_queue_len) * SLC_BUF_LEN;
+  return (i2s_slc_buf_cnt - i2s_tx.queue_len) * i2s_slc_buf_len;
+}
+
+uint32_t i2s_rx_available(){
+  if (!i2s_rx.items) {
+    return 0;
+  }
+  uint32_t samples = i2s_rx.queue_len * i2s_slc_buf_len;
+  if (i2s_rx.curr_buf) {
+    samples += i2s_slc_buf_len - i2s_rx.curr_buf_pos;
+  }
+  return samples;
+}
+
+uint32_t i2s_tx_underruns(){
+  return i2s_tx.lost;
+}
+
+uint32_t i2s_rx_overruns(){
+  return i2s_rx.lost;
 }
 
-uint32_t ICACHE_RAM_ATTR i2s_slc_queue_next_item(){ //pop the top off the queue
+static uint32_t ICACHE_RAM_ATTR i2s_slc_queue_next_item(struct i2s_dma *dma){ //pop the top off the queue
   uint8_t i;
-  uint32_t item = i2s_slc_queue[0];
-  i2s_slc_queue_len--;
-  for(i=0;i<i2s_slc_queue_len;i++)
-    i2s_slc_queue[i] = i2s_slc_queue[i+1];
+  uint32_t item = dma->queue[0];
+  dma->queue_len--;
+  for(i=0;i<dma->queue_len;i++)
+    dma->queue[i] = dma->queue[i+1];
   return item;
 }
 
+static void ICACHE_RAM_ATTR i2s_slc_queue_push(struct i2s_dma *dma, uint32_t buf_ptr){
+  if (dma->queue_len >= i2s_slc_buf_cnt-1) { //All buffers are queued: the sketch didn't keep up
+    i2s_slc_queue_next_item(dma); //free space for buf_ptr
+    dma->lost++;
+  }
+  dma->queue[dma->queue_len++] = buf_ptr;
+}
+
 //This routine is called as soon as the DMA routine has something to tell us. All we
 //handle here is the RX_EOF_INT status, which indicate the DMA has sent a buffer whose
-//descriptor has the 'EOF' field set to 1.
+//descriptor has the 'EOF' field set to 1, and TX_EOF_INT, for a buffer it filled.
 void ICACHE_RAM_ATTR i2s_slc_isr(void) {
   uint32_t slc_intr_status = SLCIS;
   SLCIC = 0xFFFFFFFF;
+  ETS_SLC_INTR_DISABLE();
   if (slc_intr_status & SLCIRXEOF) {
-    ETS_SLC_INTR_DISABLE();
     struct slc_queue_item *finished_item = (struct slc_queue_item*)SLCRXEDA;
-    ets_memset((void *)finished_item->buf_ptr, 0x00, SLC_BUF_LEN * 4);//zero the buffer so it is mute in case of underflow
-    if (i2s_slc_queue_len >= SLC_BUF_CNT-1) { //All buffers are empty. This means we have an underflow
-      i2s_slc_queue_next_item(); //free space for finished_item
+    if (i2s_stream_mode) {
+      if (finished_item == i2s_stream_last) {
+        i2s_stream_last = NULL;
+        if (i2s_stream_callback) i2s_stream_callback();
+      }
+    } else if (i2s_refill_callback) {
+      //The buffer plays again after the other ones, fill it where it is
+      i2s_refill_callback((uint32_t *)finished_item->buf_ptr, i2s_slc_buf_len);
+    } else {
+      ets_memset((void *)finished_item->buf_ptr, 0x00, i2s_slc_buf_len * 4);//zero the buffer so it is mute in case of underflow
+      i2s_slc_queue_push(&i2s_tx, finished_item->buf_ptr);
     }
-    i2s_slc_queue[i2s_slc_queue_len++] = finished_item->buf_ptr;
-    if (i2s_callback) i2s_callback();
-    ETS_SLC_INTR_ENABLE();
+    if (i2s_tx.callback && !i2s_stream_mode) i2s_tx.callback();
+  }
+  if (slc_intr_status & SLCITXEOF) {
+    struct slc_queue_item *finished_item = (struct slc_queue_item*)SLCTXEDA;
+    finished_item->owner = 1; //give it back to the DMA, or receiving stops
+    i2s_slc_queue_push(&i2s_rx, finished_item->buf_ptr);
+    if (i2s_rx.callback) i2s_rx.callback();
   }
+  ETS_SLC_INTR_ENABLE();
 }
 
 void i2s_set_callback(void (*callback) (void)){
-    i2s_callback = callback;
+    i2s_tx.callback = callback;
 }
 
-void i2s_slc_begin(){
-  i2s_slc_queue_len = 0;
-  int x, y;
-  
-  for (x=0; x<SLC_BUF_CNT; x++) {
-    i2s_slc_buf_pntr[x] = malloc(SLC_BUF_LEN*4);
-    for (y=0; y<SLC_BUF_LEN; y++) i2s_slc_buf_pntr[x][y] = 0;
-
-    i2s_slc_items[x].unused = 0;
-    i2s_slc_items[x].owner = 1;
-    i2s_slc_items[x].eof = 1;
-    i2s_slc_items[x].sub_sof = 0;
-    i2s_slc_items[x].datalen = SLC_BUF_LEN*4;
-    i2s_slc_items[x].blocksize = SLC_BUF_LEN*4;
-    i2s_slc_items[x].buf_ptr = (uint32_t)&i2s_slc_buf_pntr[x][0];
-    i2s_slc_items[x].next_link_ptr = (int)((x<(SLC_BUF_CNT-1))?(&i2s_slc_items[x+1]):(&i2s_slc_items[0]));
+void i2s_set_rx_callback(void (*callback) (void)){
+    i2s_rx.callback = callback;
+}
+
+void i2s_set_refill_callback(void (*callback) (uint32_t *buffer, size_t length)){
+  ETS_SLC_INTR_DISABLE();
+  i2s_refill_callback = callback;
+  //what was queued for writing belongs to the DMA again
+  i2s_tx.queue_len = 0;
+  i2s_tx.curr_buf = NULL;
+  i2s_tx.curr_buf_pos = 0;
+  if (i2s_tx.items || i2s_rx.items) ETS_SLC_INTR_ENABLE();
+}
+
+bool i2s_set_buffers(size_t count, size_t length){
+  if (i2s_tx.items || i2s_rx.items || count < 2 || count > SLC_BUF_CNT_MAX || length < 1 || length > SLC_BUF_LEN_MAX) {
+    return false;
+  }
+  i2s_slc_buf_cnt = count;
+  i2s_slc_buf_len = length;
+  return true;
+}
+
+size_t i2s_get_buffer_length(){
+  return i2s_slc_buf_len;
+}
+
+static void i2s_dma_free(struct i2s_dma *dma){
+  if (dma->buf_pntr) {
+    for (size_t x = 0; x < i2s_slc_buf_cnt; x++) {
+      free(dma->buf_pntr[x]);
+    }
+  }
+  free(dma->buf_pntr);
+  free(dma->items);
+  free(dma->queue);
+  dma->buf_pntr = NULL;
+  dma->items = NULL;
+  dma->queue = NULL;
+  dma->queue_len = 0;
+  dma->curr_buf = NULL;
+  dma->curr_buf_pos = 0;
+}
+
+static bool i2s_dma_alloc(struct i2s_dma *dma){
+  size_t x;
+
+  dma->queue_len = 0;
+  dma->lost = 0;
+  dma->buf_pntr = calloc(i2s_slc_buf_cnt, sizeof(uint32_t *));
+  dma->items = calloc(i2s_slc_buf_cnt, sizeof(struct slc_queue_item));
+  dma->queue = calloc(i2s_slc_buf_cnt - 1, sizeof(uint32_t));
+  if (!dma->buf_pntr || !dma->items || !dma->queue) {
+    i2s_dma_free(dma);
+    return false;
+  }
+  for (x=0; x<i2s_slc_buf_cnt; x++) {
+    dma->buf_pntr[x] = calloc(i2s_slc_buf_len, 4);
+    if (!dma->buf_pntr[x]) {
+      i2s_dma_free(dma);
+      return false;
+    }
+
+    dma->items[x].unused = 0;
+    dma->items[x].owner = 1;
+    dma->items[x].eof = 1;
+    dma->items[x].sub_sof = 0;
+    dma->items[x].datalen = i2s_slc_buf_len*4;
+    dma->items[x].blocksize = i2s_slc_buf_len*4;
+    dma->items[x].buf_ptr = (uint32_t)&dma->buf_pntr[x][0];
+    dma->items[x].next_link_ptr = (int)((x<(i2s_slc_buf_cnt-1))?(&dma->items[x+1]):(&dma->items[0]));
+  }
+  return true;
+}
+
+static bool i2s_slc_begin(bool enableRx, bool enableTx){
+  if ((enableTx && !i2s_dma_alloc(&i2s_tx)) || (enableRx && !i2s_dma_alloc(&i2s_rx))) {
+    i2s_dma_free(&i2s_tx);
+    i2s_dma_free(&i2s_rx);
+    return false;
   }
 
   ETS_SLC_INTR_DISABLE();
@@ -137,44 +268,124 @@ void i2s_slc_begin(){
 
   //Feed DMA the 1st buffer desc addr
   //To send data to the I2S subsystem, counter-intuitively we use the RXLINK part, not the TXLINK as you might
-  //expect. The TXLINK part still needs a valid DMA descriptor, even if it's unused: the DMA engine will throw
-  //an error at us otherwise. Just feed it any random descriptor.
+  //expect, and to receive the TXLINK part. When only sending, the TXLINK part still needs a valid DMA descriptor,
+  //even if it's unused: the DMA engine will throw an error at us otherwise. Just feed it any random descriptor.
+  struct i2s_dma *rx = enableRx ? &i2s_rx : &i2s_tx;
+  struct i2s_dma *tx = enableTx ? &i2s_tx : &i2s_rx;
   SLCTXL &= ~(SLCTXLAM << SLCTXLA); // clear TX descriptor address
-  SLCTXL |= (uint32)&i2s_slc_items[1] << SLCTXLA; //set TX descriptor address. any random desc is OK, we don't use TX but it needs to be valid
+  SLCTXL |= (uint32)&rx->items[enableRx ? 0 : 1] << SLCTXLA; //set TX descriptor address
   SLCRXL &= ~(SLCRXLAM << SLCRXLA); // clear RX descriptor address
-  SLCRXL |= (uint32)&i2s_slc_items[0] << SLCRXLA; //set RX descriptor address
+  SLCRXL |= (uint32)&tx->items[0] << SLCRXLA; //set RX descriptor address
 
   ETS_SLC_INTR_ATTACH(i2s_slc_isr, NULL);
-  SLCIE = SLCIRXEOF; //Enable only for RX EOF interrupt
+  SLCIE = (enableTx ? SLCIRXEOF : 0) | (enableRx ? SLCITXEOF : 0); //Enable only the EOF interrupts
 
   ETS_SLC_INTR_ENABLE();
 
   //Start transmission
   SLCTXL |= SLCTXLS;
-  SLCRXL |= SLCRXLS;
+  if (enableTx) SLCRXL |= SLCRXLS;
+  return true;
 }
 
-void i2s_slc_end(){
+static void i2s_slc_end(){
   ETS_SLC_INTR_DISABLE();
   SLCIC = 0xFFFFFFFF;
   SLCIE = 0;
   SLCTXL &= ~(SLCTXLAM << SLCTXLA); // clear TX descriptor address
   SLCRXL &= ~(SLCRXLAM << SLCRXLA); // clear RX descriptor address
 
-  for (int x = 0; x<SLC_BUF_CNT; x++) {
-	  free(i2s_slc_buf_pntr[x]);
+  i2s_dma_free(&i2s_tx);
+  i2s_dma_free(&i2s_rx);
+  free(i2s_stream_items);
+  i2s_stream_items = NULL;
+  i2s_stream_items_cnt = 0;
+  i2s_stream_last = NULL;
+  i2s_stream_mode = false;
+}
+
+bool i2s_stream_busy(){
+  return i2s_stream_last != NULL;
+}
+
+bool i2s_write_stream(const uint32_t *words, size_t count, void (*callback) (void)){
+  if (!i2s_tx.items || i2s_stream_last || count == 0) {
+    return false;
   }
+  size_t items = (count + I2S_STREAM_ITEM_LEN - 1) / I2S_STREAM_ITEM_LEN;
+  if (items > i2s_stream_items_cnt) {
+    struct slc_queue_item *grown = realloc(i2s_stream_items, items * sizeof(struct slc_queue_item));
+    if (!grown) {
+      return false;
+    }
+    i2s_stream_items = grown;
+    i2s_stream_items_cnt = items;
+  }
+  for (size_t x = 0; x < items; x++) {
+    size_t len = (x < items - 1) ? I2S_STREAM_ITEM_LEN : count - x * I2S_STREAM_ITEM_LEN;
+    struct slc_queue_item *item = &i2s_stream_items[x];
+    item->unused = 0;
+    item->owner = 1;
+    item->eof = (x == items - 1); //interrupt once, when the last one is sent
+    item->sub_sof = 0;
+    item->datalen = len * 4;
+    item->blocksize = len * 4;
+    item->buf_ptr = (uint32_t)&words[x * I2S_STREAM_ITEM_LEN];
+    item->next_link_ptr = (int)((x < items - 1) ? &i2s_stream_items[x + 1] : &i2s_idle_item);
+  }
+  i2s_idle_item.unused = 0;
+  i2s_idle_item.owner = 1;
+  i2s_idle_item.eof = 0;
+  i2s_idle_item.sub_sof = 0;
+  i2s_idle_item.datalen = sizeof(i2s_idle_buf);
+  i2s_idle_item.blocksize = sizeof(i2s_idle_buf);
+  i2s_idle_item.buf_ptr = (uint32_t)i2s_idle_buf;
+  i2s_idle_item.next_link_ptr = (int)&i2s_idle_item;
+
+  ETS_SLC_INTR_DISABLE();
+  i2s_stream_mode = true;
+  i2s_stream_callback = callback;
+  i2s_stream_last = &i2s_stream_items[items - 1];
+  //The DMA is in the ring, or sending zeros after the last stream: move it to this one
+  SLCRXL |= SLCRXLE;
+  SLCRXL &= ~(SLCRXLAM << SLCRXLA);
+  SLCRXL |= (uint32)&i2s_stream_items[0] << SLCRXLA;
+  SLCRXL |= SLCRXLS;
+  ETS_SLC_INTR_ENABLE();
+  return true;
 }
 
-//This routine pushes a single, 32-bit sample to the I2S buffers. Call this at (on average) 
-//at least the current sample rate. You can also call it quicker: it will suspend the calling
-//thread if the buffer is full and resume when there's room again.
+//WS2812 bits are four I2S bits each at I2S_WS2812_RATE, 1000 for a 0 and 1110 for a 1: high for 0.31us or
+//0.94us of 1.25us. The right channel, the upper half of a word, is sent first, MSB first.
+static const uint16_t i2s_ws2812_nibbles[16] = {
+  0x8888, 0x888E, 0x88E8, 0x88EE, 0x8E88, 0x8E8E, 0x8EE8, 0x8EEE,
+  0xE888, 0xE88E, 0xE8E8, 0xE8EE, 0xEE88, 0xEE8E, 0xEEE8, 0xEEEE,
+};
 
-bool i2s_write_sample(uint32_t sample) {
-  if (i2s_curr_slc_buf_pos==SLC_BUF_LEN || i2s_curr_slc_buf==NULL) {
-    if(i2s_slc_queue_len == 0){
+#define I2S_WS2812_RESET_WORDS (30) //10us each: the 300us low that ends a frame
+
+size_t i2s_ws2812_length(size_t bytes){
+  return bytes + I2S_WS2812_RESET_WORDS;
+}
+
+void i2s_ws2812_encode(uint32_t *words, const uint8_t *bytes, size_t count){
+  for (size_t i = 0; i < count; i++) {
+    uint8_t b = bytes[i];
+    words[i] = ((uint32_t)i2s_ws2812_nibbles[b >> 4] << 16) | i2s_ws2812_nibbles[b & 0x0F];
+  }
+  memset(&words[count], 0, I2S_WS2812_RESET_WORDS * 4);
+}
+
+//Makes the next buffer from the queue the current one. If blocking, it suspends the
+//calling thread until the DMA gives one back.
+static bool i2s_next_buffer(struct i2s_dma *dma, bool blocking) {
+  if (dma->curr_buf_pos==i2s_slc_buf_len || dma->curr_buf==NULL) {
+    if(dma->queue_len == 0){
+      if (!blocking || !dma->items || (dma == &i2s_tx && (i2s_refill_callback || i2s_stream_mode))) {
+        return false;
+      }
       while(1){
-        if(i2s_slc_queue_len > 0){
+        if(dma->queue_len > 0){
           break;
         } else {
           optimistic_yield(10000);
@@ -182,25 +393,53 @@ bool i2s_write_sample(uint32_t sample) {
       }
     }
     ETS_SLC_INTR_DISABLE();
-    i2s_curr_slc_buf = (uint32_t *)i2s_slc_queue_next_item();
+    dma->curr_buf = (uint32_t *)i2s_slc_queue_next_item(dma);
     ETS_SLC_INTR_ENABLE();
-    i2s_curr_slc_buf_pos=0;
+    dma->curr_buf_pos=0;
   }
-  i2s_curr_slc_buf[i2s_curr_slc_buf_pos++]=sample;
   return true;
 }
 
-bool i2s_write_sample_nb(uint32_t sample) {
-  if (i2s_curr_slc_buf_pos==SLC_BUF_LEN || i2s_curr_slc_buf==NULL) {
-    if(i2s_slc_queue_len == 0){
-      return false;
+//Copies whole frames of a left and a right int16_t to or from the buffers. In
+//memory they are the 32-bit sample i2s_write_lr() makes of them, so they are copied as they are.
+static size_t i2s_copy_frames(struct i2s_dma *dma, int16_t *frames, size_t count, bool blocking, bool write) {
+  size_t done = 0;
+  while (done < count) {
+    if (!i2s_next_buffer(dma, blocking)) {
+      break;
     }
-    ETS_SLC_INTR_DISABLE();
-    i2s_curr_slc_buf = (uint32_t *)i2s_slc_queue_next_item();
-    ETS_SLC_INTR_ENABLE();
-    i2s_curr_slc_buf_pos=0;
+    size_t n = i2s_slc_buf_len - dma->curr_buf_pos;
+    if (n > count - done) {
+      n = count - done;
+    }
+    if (write) {
+      memcpy(&dma->curr_buf[dma->curr_buf_pos], &frames[2 * done], n * 4);
+    } else {
+      memcpy(&frames[2 * done], &dma->curr_buf[dma->curr_buf_pos], n * 4);
+    }
+    dma->curr_buf_pos += n;
+    done += n;
+  }
+  return done;
+}
+
+//This routine pushes a single, 32-bit sample to the I2S buffers. Call this at (on average) 
+//at least the current sample rate. You can also call it quicker: it will suspend the calling
+//thread if the buffer is full and resume when there's room again.
+
+bool i2s_write_sample(uint32_t sample) {
+  if (!i2s_next_buffer(&i2s_tx, true)) {
+    return false;
+  }
+  i2s_tx.curr_buf[i2s_tx.curr_buf_pos++]=sample;
+  return true;
+}
+
+bool i2s_write_sample_nb(uint32_t sample) {
+  if (!i2s_next_buffer(&i2s_tx, false)) {
+    return false;
   }
-  i2s_curr_slc_buf[i2s_curr_slc_buf_pos++]=sample;
+  i2s_tx.curr_buf[i2s_tx.curr_buf_pos++]=sample;
   return true;
 }
 
@@ -211,6 +450,24 @@ bool i2s_write_lr(int16_t left, int16_t right){
   return i2s_write_sample(sample);
 }
 
+size_t i2s_write_buffer(const int16_t *frames, size_t count, bool blocking) {
+  return i2s_copy_frames(&i2s_tx, (int16_t *)frames, count, blocking, true);
+}
+
+bool i2s_read_sample(int16_t *left, int16_t *right, bool blocking) {
+  if (!i2s_next_buffer(&i2s_rx, blocking)) {
+    return false;
+  }
+  uint32_t sample = i2s_rx.curr_buf[i2s_rx.curr_buf_pos++];
+  *left = sample & 0xFFFF;
+  *right = sample >> 16;
+  return true;
+}
+
+size_t i2s_read_buffer(int16_t *frames, size_t count, bool blocking) {
+  return i2s_copy_frames(&i2s_rx, frames, count, blocking, false);
+}
+
 //  END DMA
 // =========
 // START I2S
@@ -251,24 +508,37 @@ void i2s_set_dividers(uint8_t div1, uint8_t div2) {
 
   // I2SRF = Send/recv right channel first (? may be swapped form I2S spec of WS=0 => left)
   // I2SMR = MSB recv/xmit first
-  // I2SRSM = Receive slave mode (?)
+  // I2SRSM = Receive slave mode, unless receiving: then the RX side drives BCK and WS of the microphone
   // I2SRMS, I2STMS = 1-bit delay from WS to MSB (I2S format)
   // div1, div2 = Set I2S WS clock frequency.  BCLK seems to be generated from 32x this
-  I2SC |= I2SRF | I2SMR | I2SRSM | I2SRMS | I2STMS | (div1 << I2SBD) | (div2 << I2SCD);
+  I2SC &= ~I2SRSM;
+  I2SC |= I2SRF | I2SMR | (i2s_rx.items ? 0 : I2SRSM) | I2SRMS | I2STMS | (div1 << I2SBD) | (div2 << I2SCD);
 }
 
 float i2s_get_real_rate(){
   return (float)I2SBASEFREQ/32/((I2SC>>I2SBD) & I2SBDM)/((I2SC >> I2SCD) & I2SCDM);
 }
 
-void i2s_begin() {
+bool i2s_rxtx_begin(bool enableRx, bool enableTx) {
+  if ((!enableRx && !enableTx) || i2s_tx.items || i2s_rx.items) {
+    return false;
+  }
   _i2s_sample_rate = 0;
-  i2s_slc_begin();
+  if (!i2s_slc_begin(enableRx, enableTx)) {
+    return false; //no memory for the buffers
+  }
 
   // Redirect control of IOs to the I2S block
-  pinMode(I2SO_WS, FUNCTION_1);
-  pinMode(I2SO_DATA, FUNCTION_1);
-  pinMode(I2SO_BCK, FUNCTION_1);
+  if (enableTx) {
+    pinMode(I2SO_WS, FUNCTION_1);
+    pinMode(I2SO_DATA, FUNCTION_1);
+    pinMode(I2SO_BCK, FUNCTION_1);
+  }
+  if (enableRx) {
+    pinMode(I2SI_WS, FUNCTION_1);
+    pinMode(I2SI_DATA, FUNCTION_1);
+    pinMode(I2SI_BCK, FUNCTION_1);
+  }
   
   I2S_CLK_ENABLE();
   I2SIC = 0x3F;
@@ -285,11 +555,21 @@ void i2s_begin() {
   // I2STXCMM, I2SRXCMM=0 => Dual channel mode
   I2SCC &= ~((I2STXCMM << I2STXCM) | (I2SRXCMM << I2SRXCM)); //Set RX/TX CHAN_MOD=0
   i2s_set_rate(44100);
-  I2SC |= I2STXS; //Start transmission
+  if (enableRx) {
+    I2SRXEN = i2s_slc_buf_len; //samples received before the DMA closes a buffer
+  }
+  I2SC |= (enableRx ? I2SRXS : 0) | (enableTx ? I2STXS : 0); //Start reception and transmission
+  return true;
+}
+
+void i2s_begin() {
+  i2s_rxtx_begin(false, true);
 }
 
 void i2s_end(){
-  I2SC &= ~I2STXS;
+  bool rx = i2s_rx.items != NULL;
+  bool tx = i2s_tx.items != NULL;
+  I2SC &= ~(I2STXS | I2SRXS);
 
   //Reset I2S
   I2SC &= ~(I2SRST);
@@ -297,9 +577,16 @@ void i2s_end(){
   I2SC &= ~(I2SRST);
 
   // Redirect IOs to user control/GPIO
-  pinMode(I2SO_WS, INPUT);
-  pinMode(I2SO_DATA, INPUT);
-  pinMode(I2SO_BCK, INPUT);
+  if (tx) {
+    pinMode(I2SO_WS, INPUT);
+    pinMode(I2SO_DATA, INPUT);
+    pinMode(I2SO_BCK, INPUT);
+  }
+  if (rx) {
+    pinMode(I2SI_WS, INPUT);
+    pinMode(I2SI_DATA, INPUT);
+    pinMode(I2SI_BCK, INPUT);
+  }
 
   i2s_slc_end();
 }
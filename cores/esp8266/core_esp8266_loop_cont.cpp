@@ -0,0 +1,36 @@
+/*
+ core_esp8266_loop_cont.cpp - the default stack of loop()
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// CONT_STACKSIZE bytes, which -DCONT_STACKSIZE=... changes. This is in a
+// file of its own so that the linker leaves the stack out of a sketch with
+// LOOP_STACK_SIZE() or LOOP_STACK_HEAP() (Esp.h), which define their own
+// __get_loop_cont().
+
+extern "C" {
+#include "cont.h"
+}
+
+static cont_t s_loop_cont __attribute__ ((aligned (16)));
+
+cont_t* __get_loop_cont(void) __attribute__((weak));
+cont_t* __get_loop_cont(void)
+{
+    cont_init(&s_loop_cont);
+    return &s_loop_cont;
+}
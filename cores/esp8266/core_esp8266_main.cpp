@@ -24,6 +24,7 @@
 //#define CONT_STACKSIZE 4096
 #include <Arduino.h>
 #include "Schedule.h"
+#include "CoopTask.h"
 extern "C" {
 #include "ets_sys.h"
 #include "os_type.h"
@@ -34,6 +35,7 @@ extern "C" {
 }
 #include <core_version.h>
 #include "gdb_hooks.h"
+#include "coredecls.h"
 
 #define LOOP_TASK_PRIORITY 1
 #define LOOP_QUEUE_SIZE    1
@@ -57,7 +59,6 @@ int atexit(void (*func)()) {
     return 0;
 }
 
-extern "C" void ets_update_cpu_frequency(int freqmhz);
 void initVariant() __attribute__((weak));
 void initVariant() {
 }
@@ -65,34 +66,144 @@ void initVariant() {
 extern void loop();
 extern void setup();
 
+// F_CPU, or what was set by ESP.setCpuFrequencyMHz() since
 void preloop_update_frequency() __attribute__((weak));
 void preloop_update_frequency() {
-#if defined(F_CPU) && (F_CPU == 160000000L)
-    REG_SET_BIT(0x3ff00014, BIT(0));
-    ets_update_cpu_frequency(160);
-#endif
+    cpu_freq_update();
 }
 
 extern void (*__init_array_start)(void);
 extern void (*__init_array_end)(void);
 
-cont_t g_cont __attribute__ ((aligned (16)));
+// the continuation of loop(), from __get_loop_cont() in
+// core_esp8266_loop_cont.cpp or LOOP_STACK_SIZE() / LOOP_STACK_HEAP()
+cont_t* __get_loop_cont(void);
+static cont_t* s_loop_cont = NULL;
+// the continuation running now, s_loop_cont or the one of a task
+cont_t* g_pcont = NULL;
 static os_event_t g_loop_queue[LOOP_QUEUE_SIZE];
 
 static uint32_t g_micros_at_task_start;
 
+extern "C" uint32_t boot_rf_pre_init_us;
+static EspBootTimes s_boot_times;
+
+void boot_times_get(EspBootTimes& times) {
+    times = s_boot_times;
+    times.rfPreInitUs = boot_rf_pre_init_us;
+}
+
+extern "C" {
+uint32_t net_activity_ms = 0;
+
+void net_activity(void) {
+    net_activity_ms = millis();
+}
+}
+
+extern "C" void boot_times_got_ip(void) {
+    if (!s_boot_times.gotIpUs) {
+        s_boot_times.gotIpUs = system_get_time();
+    }
+}
+
+struct coop_task_ {
+    coop_task_t* next;
+    void (*fn)(void*);
+    void* arg;
+    os_timer_t delay_timer;
+    bool ready;
+    cont_t cont;    // with its own stack size, must be last
+};
+
+// EspLoopStats, updated while enabled
+static bool s_loop_stats_enabled = false;
+static EspLoopStats s_loop_stats;
+static uint32_t s_loop_stall_us = 0;
+static std::function<void(uint32_t)> s_loop_stall_fn;
+
+void loop_stats_reset() {
+    memset(&s_loop_stats, 0, sizeof(s_loop_stats));
+}
+
+void loop_stats_enable(bool enable) {
+    loop_stats_reset();
+    s_loop_stats_enabled = enable;
+}
+
+void loop_stats_get(EspLoopStats& stats) {
+    stats = s_loop_stats;
+}
+
+void loop_stats_on_stall(uint32_t threshold_us, std::function<void(uint32_t)> fn) {
+    s_loop_stall_us = threshold_us;
+    s_loop_stall_fn = std::move(fn);
+}
+
+static void loop_stats_loop(uint32_t loop_us) {
+    uint32_t ms = loop_us / 1000;
+    int bucket = 0;
+    while (bucket < ESP_LOOP_STATS_BUCKETS - 1 && ms >= (1u << bucket)) {
+        ++bucket;
+    }
+    ++s_loop_stats.histogram[bucket];
+    ++s_loop_stats.loops;
+    if (loop_us > s_loop_stats.maxLoopUs) {
+        s_loop_stats.maxLoopUs = loop_us;
+    }
+}
+
+static void loop_stats_scheduled(uint32_t scheduled_us) {
+    s_loop_stats.scheduledUs += scheduled_us;
+    if (scheduled_us > s_loop_stats.maxScheduledUs) {
+        s_loop_stats.maxScheduledUs = scheduled_us;
+    }
+}
+
+static void loop_stats_gap(uint32_t gap_us) {
+    if (gap_us > s_loop_stats.maxYieldGapUs) {
+        s_loop_stats.maxYieldGapUs = gap_us;
+    }
+    if (s_loop_stall_us && gap_us > s_loop_stall_us) {
+        ++s_loop_stats.stalls;
+        if (s_loop_stall_fn) {
+            s_loop_stall_fn(gap_us);
+        }
+    }
+}
+
+static coop_task_t* s_tasks = NULL;
+static coop_task_t* s_current_task = NULL;
+static bool s_loop_ready = true;
+
 extern "C" void esp_yield() {
-    if (cont_can_yield(&g_cont)) {
-        cont_yield(&g_cont);
+    if (cont_can_yield(g_pcont)) {
+        cont_yield(g_pcont);
     }
 }
 
 extern "C" void esp_schedule() {
+    if (cont_can_yield(g_pcont)) {
+        // about to yield, going on right away
+        if (s_current_task) {
+            s_current_task->ready = true;
+        }
+        else {
+            s_loop_ready = true;
+        }
+    }
+    else {
+        // a callback, for whichever continuation is waiting for it
+        s_loop_ready = true;
+        for (coop_task_t* task = s_tasks; task; task = task->next) {
+            task->ready = true;
+        }
+    }
     ets_post(LOOP_TASK_PRIORITY, 0, 0);
 }
 
 extern "C" void __yield() {
-    if (cont_can_yield(&g_cont)) {
+    if (cont_can_yield(g_pcont)) {
         esp_schedule();
         esp_yield();
     }
@@ -104,60 +215,265 @@ extern "C" void __yield() {
 extern "C" void yield(void) __attribute__ ((weak, alias("__yield")));
 
 extern "C" void optimistic_yield(uint32_t interval_us) {
-    if (cont_can_yield(&g_cont) &&
+    if (cont_can_yield(g_pcont) &&
         (system_get_time() - g_micros_at_task_start) > interval_us)
     {
         yield();
     }
 }
 
+// yield_budget(), the budgets scaled by s_yield_scale / 256 while
+// yield_budget_auto() is on
+static uint32_t s_yield_budget_us[YIELD_OP_COUNT] = YIELD_BUDGET_DEFAULTS_US;
+static uint32_t s_yield_target_us = 0;
+static uint32_t s_yield_scale = 256;
+
+extern "C" void yield_budget(yield_op_t op) {
+    uint32_t us = (op < YIELD_OP_COUNT) ? s_yield_budget_us[op] : 0;
+    optimistic_yield((us >> 8) * s_yield_scale + (((us & 0xff) * s_yield_scale) >> 8));
+}
+
+extern "C" void yield_budget_set(yield_op_t op, uint32_t us) {
+    for (int i = 0; i < YIELD_OP_COUNT; ++i) {
+        if (op == YIELD_OP_ALL || op == i) {
+            s_yield_budget_us[i] = us;
+        }
+    }
+}
+
+extern "C" uint32_t yield_budget_get(yield_op_t op) {
+    return (op < YIELD_OP_COUNT) ? s_yield_budget_us[op] : 0;
+}
+
+extern "C" void yield_budget_auto(uint32_t target_us) {
+    s_yield_target_us = target_us;
+    s_yield_scale = 256;
+}
+
+// With the time the system just waited for the loop task: halve the
+// budgets at once when it was too long, and give them back slowly.
+static void yield_budget_adapt(uint32_t gap_us) {
+    if (!s_yield_target_us) {
+        return;
+    }
+    if (gap_us > s_yield_target_us) {
+        s_yield_scale = (s_yield_scale > 32) ? s_yield_scale / 2 : 16;
+    } else if (gap_us < s_yield_target_us / 2 && s_yield_scale < 256) {
+        ++s_yield_scale;
+    }
+}
+
+static void task_delay_end(void* arg) {
+    // only the task that is waiting
+    reinterpret_cast<coop_task_t*>(arg)->ready = true;
+    ets_post(LOOP_TASK_PRIORITY, 0, 0);
+}
+
+// delay() inside a task: the timer of delay() is taken by loop(), and
+// another continuation's callback may resume the task early
+extern "C" bool esp_task_delay(unsigned long ms) {
+    coop_task_t* task = s_current_task;
+    if (!task || !cont_can_yield(g_pcont)) {
+        return false;
+    }
+    unsigned long start = millis();
+    unsigned long elapsed = 0;
+    while (elapsed < ms) {
+        os_timer_setfn(&task->delay_timer, (os_timer_func_t*) &task_delay_end, task);
+        os_timer_arm(&task->delay_timer, ms - elapsed, 0);
+        esp_yield();
+        os_timer_disarm(&task->delay_timer);
+        elapsed = millis() - start;
+    }
+    return true;
+}
+
+static void task_wrapper() {
+    s_current_task->fn(s_current_task->arg);
+}
+
+coop_task_t* coop_task_create(void (*fn)(void* arg), void* arg, size_t stack_size) {
+    coop_task_t* task = (coop_task_t*) malloc(offsetof(coop_task_t, cont) + CONT_SIZE(stack_size));
+    if (!task) {
+        return NULL;
+    }
+    cont_init_size(&task->cont, stack_size);
+    task->fn = fn;
+    task->arg = arg;
+    task->ready = true;
+    task->next = s_tasks;
+    s_tasks = task;
+    ets_post(LOOP_TASK_PRIORITY, 0, 0);
+    return task;
+}
+
+coop_task_t* coop_task_current() {
+    return s_current_task;
+}
+
+int coop_task_free_stack(coop_task_t* task) {
+    return cont_get_free_stack(task ? &task->cont : s_loop_cont);
+}
+
+int coop_task_stack_size(coop_task_t* task) {
+    return cont_get_stack_size(task ? &task->cont : s_loop_cont);
+}
+
+static void run_tasks() {
+    coop_task_t** link = &s_tasks;
+    while (*link) {
+        coop_task_t* task = *link;
+        if (!task->ready) {
+            link = &task->next;
+            continue;
+        }
+        task->ready = false;
+        s_current_task = task;
+        g_pcont = &task->cont;
+        cont_run(&task->cont, &task_wrapper);
+        g_pcont = s_loop_cont;
+        s_current_task = NULL;
+        if (cont_check(&task->cont) != 0) {
+            panic();
+        }
+        if (task->cont.pc_ret == 0) {
+            // fn returned
+            *link = task->next;
+            free(task);
+            continue;
+        }
+        link = &task->next;
+    }
+}
+
 static void loop_wrapper() {
     static bool setup_done = false;
+    static bool loop_done = false;
     preloop_update_frequency();
     if(!setup_done) {
+        s_boot_times.setupUs = system_get_time();
         setup();
+        s_boot_times.loopUs = system_get_time();
         setup_done = true;
     }
-    loop();
-    run_scheduled_functions();
+    if (!s_loop_stats_enabled) {
+        loop();
+        run_scheduled_functions();
+    }
+    else {
+        uint32_t start = system_get_time();
+        loop();
+        uint32_t loop_end = system_get_time();
+        run_scheduled_functions();
+        loop_stats_loop(loop_end - start);
+        loop_stats_scheduled(system_get_time() - loop_end);
+    }
+    if (!loop_done) {
+        // an update that got this far works, unless the sketch checks more
+        app_slot_auto_confirm();
+        loop_done = true;
+    }
     esp_schedule();
 }
 
 static void loop_task(os_event_t *events) {
     (void) events;
     g_micros_at_task_start = system_get_time();
-    cont_run(&g_cont, &loop_wrapper);
-    if (cont_check(&g_cont) != 0) {
-        panic();
+    if (s_loop_ready) {
+        s_loop_ready = false;
+        cont_run(s_loop_cont, &loop_wrapper);
+        if (cont_check(s_loop_cont) != 0) {
+            panic();
+        }
+    }
+    run_tasks();
+    uint32_t busy_us = system_get_time() - g_micros_at_task_start;
+    if (s_loop_stats_enabled) {
+        loop_stats_gap(busy_us);
+    }
+    yield_budget_adapt(busy_us);
+    cpu_freq_loop_task(busy_us);
+}
+
+#ifdef DEBUG_ESP_BOOT_CTORS
+#define BOOT_CTORS_KEPT 8
+static EspBootCtor s_boot_ctors[BOOT_CTORS_KEPT];
+static size_t s_boot_ctors_count = 0;
+
+// keeps the slowest ones, slowest first
+static void boot_ctors_add(void (*ctor)(void), uint32_t us) {
+    size_t i = s_boot_ctors_count;
+    if (i == BOOT_CTORS_KEPT) {
+        if (us <= s_boot_ctors[i - 1].us) {
+            return;
+        }
+        --i;
+    } else {
+        ++s_boot_ctors_count;
+    }
+    for (; i > 0 && s_boot_ctors[i - 1].us < us; --i) {
+        s_boot_ctors[i] = s_boot_ctors[i - 1];
+    }
+    s_boot_ctors[i].ctor = (uint32_t) ctor;
+    s_boot_ctors[i].us = us;
+}
+#endif
+
+size_t boot_ctors_get(EspBootCtor* ctors, size_t count) {
+#ifdef DEBUG_ESP_BOOT_CTORS
+    if (count > s_boot_ctors_count) {
+        count = s_boot_ctors_count;
     }
+    memcpy(ctors, s_boot_ctors, count * sizeof(*ctors));
+    return count;
+#else
+    (void) ctors;
+    (void) count;
+    return 0;
+#endif
 }
 
 static void do_global_ctors(void) {
     void (**p)(void) = &__init_array_end;
-    while (p != &__init_array_start)
+    while (p != &__init_array_start) {
+#ifdef DEBUG_ESP_BOOT_CTORS
+        uint32_t start = system_get_time();
+        (*--p)();
+        boot_ctors_add(*p, system_get_time() - start);
+#else
         (*--p)();
+#endif
+    }
 }
 
 void init_done() {
     system_set_os_print(1);
     gdb_init();
+    s_boot_times.initDoneUs = system_get_time();
     do_global_ctors();
     esp_schedule();
 }
 
 
 extern "C" void user_init(void) {
+    s_boot_times.userInitUs = system_get_time();
     struct rst_info *rtc_info_ptr = system_get_rst_info();
     memcpy((void *) &resetInfo, (void *) rtc_info_ptr, sizeof(resetInfo));
 
     uart_div_modify(0, UART_CLK_FREQ / (115200));
 
+    // before init() and initVariant(), where a delay() or yield() checks
+    // the continuation through cont_can_yield()
+    s_loop_cont = __get_loop_cont();
+    if (!s_loop_cont) {
+        panic();
+    }
+    g_pcont = s_loop_cont;
+
     init();
 
     initVariant();
 
-    cont_init(&g_cont);
-
     ets_task(loop_task,
         LOOP_TASK_PRIORITY, g_loop_queue,
         LOOP_QUEUE_SIZE);
@@ -22,6 +22,7 @@
 
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
@@ -41,121 +42,240 @@ void reverse(char* begin, char* end) {
     }
 }
 
+// "00" to "99": decimal digits go out two at a time, and the quotients
+// come from multiplications by reciprocals. The lx106 has no divide
+// instruction, each division is a libgcc loop.
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// the 4 digits of value < 10000, before end
+static char* put4(uint32_t value, char* end)
+{
+    uint32_t hi = (value * 5243) >> 19;     // value / 100
+    memcpy(end - 2, &digit_pairs[2 * (value - hi * 100)], 2);
+    memcpy(end - 4, &digit_pairs[2 * hi], 2);
+    return end - 4;
+}
+
+static char* utoa10(uint64_t value, char* end)
+{
+    while (value >> 32) {
+        // only for 64-bit values
+        uint64_t q = value / 100000000;
+        uint32_t r = value - q * 100000000;
+        end = put4(r / 10000, put4(r % 10000, end));
+        value = q;
+    }
+    uint32_t v = value;
+    while (v >= 10000) {
+        uint32_t q = ((uint64_t) v * 0xD1B71759) >> 45;  // v / 10000
+        end = put4(v - q * 10000, end);
+        v = q;
+    }
+    while (v >= 100) {
+        uint32_t q = (v * 5243) >> 19;
+        end -= 2;
+        memcpy(end, &digit_pairs[2 * (v - q * 100)], 2);
+        v = q;
+    }
+    if (v >= 10) {
+        end -= 2;
+        memcpy(end, &digit_pairs[2 * v], 2);
+    } else {
+        *--end = '0' + v;
+    }
+    return end;
+}
+
+char* ulltoa_end(unsigned long long value, char* end, int base, bool upper)
+{
+    if (base == 10) {
+        return utoa10(value, end);
+    }
+    const char* digits = upper ? "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ" : "0123456789abcdefghijklmnopqrstuvwxyz";
+    if (!(base & (base - 1))) {
+        int shift = __builtin_ctz(base);
+        do {
+            *--end = digits[value & (base - 1)];
+            value >>= shift;
+        } while (value);
+        return end;
+    }
+    if (value >> 32) {
+        do {
+            unsigned long long q = value / base;
+            *--end = digits[value - q * base];
+            value = q;
+        } while (value >> 32);
+    }
+    uint32_t v = value;
+    do {
+        uint32_t q = v / base;
+        *--end = digits[v - q * base];
+        v = q;
+    } while (v);
+    return end;
+}
+
 char* ltoa(long value, char* result, int base) {
-    if(base < 2 || base > 16) {
+    if(base < 2 || base > 36) {
         *result = 0;
         return result;
     }
 
+    char buf[8 * sizeof(long) + 1];
+    char* end = &buf[sizeof(buf)];
+    unsigned long magnitude = (value < 0) ? -(unsigned long) value : (unsigned long) value;
+    char* start = ulltoa_end(magnitude, end, base, false);
     char* out = result;
-    long quotient = abs(value);
-
-    do {
-        const long tmp = quotient / base;
-        *out = "0123456789abcdef"[quotient - (tmp * base)];
-        ++out;
-        quotient = tmp;
-    } while(quotient);
-
-    // Apply negative sign
     if(value < 0)
         *out++ = '-';
-
-    reverse(result, out);
-    *out = 0;
+    memcpy(out, start, end - start);
+    out[end - start] = 0;
     return result;
 }
 
 char* ultoa(unsigned long value, char* result, int base) {
-    if(base < 2 || base > 16) {
+    if(base < 2 || base > 36) {
         *result = 0;
         return result;
     }
 
-    char* out = result;
-    unsigned long quotient = value;
-
-    do {
-        const unsigned long tmp = quotient / base;
-        *out = "0123456789abcdef"[quotient - (tmp * base)];
-        ++out;
-        quotient = tmp;
-    } while(quotient);
-
-    reverse(result, out);
-    *out = 0;
+    char buf[8 * sizeof(long)];
+    char* end = &buf[sizeof(buf)];
+    char* start = ulltoa_end(value, end, base, false);
+    memcpy(result, start, end - start);
+    result[end - start] = 0;
     return result;
 }
 
-char * dtostrf(double number, signed char width, unsigned char prec, char *s) {
-    bool negative = false;
+static const uint32_t pow10[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
 
-    if (isnan(number)) {
-        strcpy(s, "nan");
-        return s;
-    }
-    if (isinf(number)) {
-        strcpy(s, "inf");
-        return s;
+// frac * p, frac in 2^-128 with f[0] the lowest word; returns the
+// integer part of the product and leaves its fraction in frac
+static uint32_t mul_frac(uint32_t* frac, uint32_t p)
+{
+    uint64_t carry = 0;
+    for (int i = 0; i < 4; ++i) {
+        carry += (uint64_t) frac[i] * p;
+        frac[i] = carry;
+        carry >>= 32;
     }
+    return carry;
+}
 
-    char* out = s;
-
-    int fillme = width; // how many cells to fill for the integer part
-    if (prec > 0) {
-        fillme -= (prec+1);
+// The double is taken apart into its integer part and its fraction, both
+// exact, the fraction in 128 bits; the decimals are the fraction
+// multiplied by up to 10^9 at a time. Nothing is rounded until the last
+// digit: the result is what printf("%.*f") prints.
+size_t dtoa_fixed(double number, unsigned char prec, char* s)
+{
+    union {
+        double d;
+        uint64_t u;
+    } bits = { number };
+    int exp = (bits.u >> 52) & 0x7ff;
+    uint64_t mant = bits.u & ((1ULL << 52) - 1);
+    if (exp == 0x7ff) {
+        return 0;
     }
-
-    // Handle negative numbers
-    if (number < 0.0) {
-        negative = true;
-        fillme--;
-        number = -number;
+    if (exp) {
+        mant |= 1ULL << 52;
+    } else {
+        exp = 1;
     }
+    int shift = exp - 1075;     // number is mant * 2^shift
 
-    // Round correctly so that print(1.999, 2) prints as "2.00"
-    // I optimized out most of the divisions
-    double rounding = 2.0;
-    for (uint8_t i = 0; i < prec; ++i)
-        rounding *= 10.0;
-    rounding = 1.0 / rounding;
-
-    number += rounding;
-
-    // Figure out how big our number really is
-    double tenpow = 1.0;
-    int digitcount = 1;
-    while (number >= 10.0 * tenpow) {
-        tenpow *= 10.0;
-        digitcount++;
+    uint64_t ip = 0;
+    uint64_t hi = 0, lo = 0;    // the fraction, in 2^-128
+    if (shift >= 0) {
+        if (shift > 11) {
+            return 0;
+        }
+        ip = mant << shift;
+    } else if (shift >= -128) {
+        ip = (shift > -53) ? mant >> -shift : 0;
+        int up = shift + 128;
+        if (up >= 64) {
+            hi = mant << (up - 64);
+        } else {
+            lo = mant << up;
+            hi = up ? mant >> (64 - up) : 0;
+        }
+    } else if (prec > 22) {
+        // below 2^-75, and digits that would need more bits
+        return 0;
     }
+    // else below 2^-75: 0 to 22 decimals
 
-    number /= tenpow;
-    fillme -= digitcount;
-
-    // Pad unused cells with spaces
-    while (fillme-- > 0) {
-        *out++ = ' ';
+    char* out = s;
+    if (bits.u >> 63) {
+        *out++ = '-';
+    }
+    // the digits go after room for the integer part, which can still grow
+    // by a carry
+    char* dec = out + 21;
+    char* p = dec;
+    if (prec) {
+        *p++ = '.';
+    }
+    uint32_t frac[4] = { (uint32_t) lo, (uint32_t) (lo >> 32), (uint32_t) hi, (uint32_t) (hi >> 32) };
+    for (unsigned left = prec; left; ) {
+        unsigned n = (left > 9) ? 9 : left;
+        uint32_t chunk = mul_frac(frac, pow10[n]);
+        memset(p, '0', n);
+        p += n;
+        utoa10(chunk, p);
+        left -= n;
     }
 
-    // Handle negative sign
-    if (negative) *out++ = '-';
-
-    // Print the digits, and if necessary, the decimal point
-    digitcount += prec;
-    int8_t digit = 0;
-    while (digitcount-- > 0) {
-        digit = (int8_t)number;
-        if (digit > 9) digit = 9; // insurance
-        *out++ = (char)('0' | digit);
-        if ((digitcount == prec) && (prec > 0)) {
-            *out++ = '.';
+    // to nearest, ties to even
+    bool above = frac[3] > 0x80000000 || (frac[3] == 0x80000000 && (frac[2] | frac[1] | frac[0]));
+    bool tie = frac[3] == 0x80000000 && !(frac[2] | frac[1] | frac[0]);
+    int odd = prec ? (p[-1] - '0') & 1 : ip & 1;
+    if (above || (tie && odd)) {
+        char* d = p;
+        while (d > dec + 1 && d[-1] == '9') {
+            *--d = '0';
+        }
+        if (d > dec + 1) {
+            ++d[-1];
+        } else {
+            ++ip;
         }
-        number -= digit;
-        number *= 10.0;
     }
 
-    // make sure the string is terminated
+    char* istart = ulltoa_end(ip, dec, 10, false);
+    size_t ilen = dec - istart;
+    memmove(out, istart, ilen);
+    memmove(out + ilen, dec, p - dec);
+    out += ilen + (p - dec);
     *out = 0;
+    return out - s;
+}
+
+char * dtostrf(double number, signed char width, unsigned char prec, char *s) {
+    if (isnan(number)) {
+        strcpy(s, "nan");
+        return s;
+    }
+    if (isinf(number)) {
+        strcpy(s, "inf");
+        return s;
+    }
+
+    size_t len = dtoa_fixed(number, prec, s);
+    if (!len) {
+        // 2^64 and up, or tiny with many decimals
+        len = sprintf(s, "%.*f", prec, number);
+    }
+    if (width > (int) len) {
+        memmove(s + width - len, s, len + 1);
+        memset(s, ' ', width - len);
+    }
     return s;
 }
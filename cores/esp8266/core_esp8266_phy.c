@@ -255,9 +255,15 @@ static const uint8_t ICACHE_FLASH_ATTR phy_init_data[128] =
 #define __get_adc_mode _Z14__get_adc_modev
 #define __get_rf_mode _Z13__get_rf_modev
 #define __run_user_rf_pre_init _Z22__run_user_rf_pre_initv
+#define __get_rf_cal_mode _Z17__get_rf_cal_modev
 
 static bool spoof_init_data = false;
 
+// system_get_time() in user_rf_pre_init(), for ESP.getBootTimes()
+uint32_t boot_rf_pre_init_us = 0;
+
+extern int __get_rf_cal_mode(void);
+
 extern int __real_spi_flash_read(uint32_t addr, uint32_t* dst, size_t size);
 extern int ICACHE_RAM_ATTR __wrap_spi_flash_read(uint32_t addr, uint32_t* dst, size_t size);
 
@@ -269,6 +275,10 @@ extern int ICACHE_RAM_ATTR __wrap_spi_flash_read(uint32_t addr, uint32_t* dst, s
 
     memcpy(dst, phy_init_data, sizeof(phy_init_data));
     ((uint8_t*)dst)[107] = __get_adc_mode();
+    int rf_cal_mode = __get_rf_cal_mode();
+    if (rf_cal_mode >= 0) {
+        ((uint8_t*)dst)[114] = rf_cal_mode;
+    }
     return 0;
 }
 
@@ -284,6 +294,12 @@ extern int __get_adc_mode(void)
     return 33; // default ADC mode
 }
 
+extern int __get_rf_cal_mode(void) __attribute__((weak));
+extern int __get_rf_cal_mode(void)
+{
+    return -1;  // rf_cal_use_flash of phy_init_data
+}
+
 extern void __run_user_rf_pre_init(void) __attribute__((weak));
 extern void __run_user_rf_pre_init(void)
 {
@@ -299,6 +315,7 @@ uint32_t user_rf_cal_sector_set(void)
 void user_rf_pre_init()
 {
     // *((volatile uint32_t*) 0x60000710) = 0;
+    boot_rf_pre_init_us = system_get_time();
     spoof_init_data = false;
     volatile uint32_t* rtc_reg = (volatile uint32_t*) 0x60001000;
     if((rtc_reg[24] >> 16) > 4) {
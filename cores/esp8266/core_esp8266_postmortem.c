@@ -29,10 +29,12 @@
 #include "cont.h"
 #include "pgmspace.h"
 #include "gdb_hooks.h"
+#include "CrashDump.h"
 
 extern void __real_system_restart_local();
+extern void crash_dump_save(crash_dump_t* dump, uint32_t stack_start, uint32_t stack_end);
 
-extern cont_t g_cont;
+extern cont_t* g_pcont;
 
 // These will be pointers to PROGMEM const strings
 static const char* s_panic_file = 0;
@@ -47,6 +49,7 @@ static void uart_write_char_d(char c);
 static void uart0_write_char_d(char c);
 static void uart1_write_char_d(char c);
 static void print_stack(uint32_t start, uint32_t end);
+static void save_crash(struct rst_info* rst_info, uint32_t sp, uint32_t stack_start, uint32_t stack_end, bool cont);
 
 // From UMM, the last caller of a malloc/realloc/calloc which failed:
 extern void *umm_last_fail_alloc_addr;
@@ -131,8 +134,10 @@ void __wrap_system_restart_local() {
         ets_printf_P("\nSoft WDT reset\n");
     }
 
-    uint32_t cont_stack_start = (uint32_t) &(g_cont.stack);
-    uint32_t cont_stack_end = (uint32_t) g_cont.stack_end;
+    // loop() or the cooperative task that was running, none before
+    // user_init() made the one of loop()
+    uint32_t cont_stack_start = g_pcont ? (uint32_t) &(g_pcont->stack) : 0;
+    uint32_t cont_stack_end = g_pcont ? (uint32_t) g_pcont->stack_end : 0;
     uint32_t stack_end;
 
     // amount of stack taken by interrupt or exception handler
@@ -149,7 +154,8 @@ void __wrap_system_restart_local() {
         offset = 0x10;
     }
 
-    if (sp > cont_stack_start && sp < cont_stack_end) {
+    bool in_cont = sp > cont_stack_start && sp < cont_stack_end;
+    if (in_cont) {
         ets_printf_P("\nctx: cont \n");
         stack_end = cont_stack_end;
     }
@@ -169,6 +175,8 @@ void __wrap_system_restart_local() {
       ets_printf("\nlast failed alloc call: %08X(%d)\n", (uint32_t)umm_last_fail_alloc_addr, umm_last_fail_alloc_size);
     }
 
+    save_crash(&rst_info, sp, sp + offset, stack_end, in_cont);
+
     custom_crash_callback( &rst_info, sp + offset, stack_end );
 
     delayMicroseconds(10000);
@@ -190,6 +198,30 @@ static void ICACHE_RAM_ATTR print_stack(uint32_t start, uint32_t end) {
     ets_printf_P("<<<stack<<<\n");
 }
 
+// What was printed, to the sector of crash_dump_begin() if there is one
+static void save_crash(struct rst_info* rst_info, uint32_t sp, uint32_t stack_start, uint32_t stack_end, bool cont) {
+    crash_dump_t dump = {0};
+    dump.reason = rst_info->reason;
+    dump.exccause = rst_info->exccause;
+    dump.epc1 = rst_info->epc1;
+    dump.epc2 = rst_info->epc2;
+    dump.epc3 = rst_info->epc3;
+    dump.excvaddr = rst_info->excvaddr;
+    dump.depc = rst_info->depc;
+    dump.panic_file = (uint32_t) s_panic_file;
+    dump.panic_func = (uint32_t) s_panic_func;
+    dump.panic_what = (uint32_t) s_panic_what;
+    dump.panic_line = s_panic_line;
+    dump.flags = (cont ? CRASH_DUMP_CONT : 0) | (s_abort_called ? CRASH_DUMP_ABORT : 0);
+    dump.sp = sp;
+    dump.cont_stack_free = g_pcont ? cont_get_free_stack(g_pcont) : 0;
+    dump.heap_free = system_get_free_heap_size();
+    dump.last_fail_alloc_addr = (uint32_t) umm_last_fail_alloc_addr;
+    dump.last_fail_alloc_size = umm_last_fail_alloc_size;
+    dump.time_us = system_get_time();
+    crash_dump_save(&dump, stack_start, stack_end);
+}
+
 static void uart_write_char_d(char c) {
     uart0_write_char_d(c);
     uart1_write_char_d(c);
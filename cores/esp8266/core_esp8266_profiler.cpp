@@ -0,0 +1,131 @@
+/*
+ core_esp8266_profiler.cpp - sampling profiler driven by the timer1 NMI
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Arduino.h>
+#include "Profiler.h"
+extern "C" {
+#include "ets_sys.h"
+}
+
+#define PROFILER_PROBES 8
+
+struct profiler_slot_t {
+    uint32_t pc;
+    uint32_t count;
+};
+
+static profiler_slot_t* s_slots = NULL;
+static uint32_t s_slot_mask = 0;
+static uint32_t s_rate_hz = 0;
+static volatile uint32_t s_samples = 0;
+static volatile uint32_t s_dropped = 0;
+
+static void ICACHE_RAM_ATTR profiler_isr()
+{
+    uint32_t pc;
+    // where the NMI came in
+    __asm__ __volatile__("rsr %0, epc3" : "=a" (pc));
+    T1I = 0;
+    ++s_samples;
+    uint32_t index = ((pc >> 2) * 2654435761u) & s_slot_mask;
+    for (int probe = 0; probe < PROFILER_PROBES; ++probe) {
+        profiler_slot_t* slot = &s_slots[(index + probe) & s_slot_mask];
+        if (slot->pc == pc) {
+            ++slot->count;
+            return;
+        }
+        if (slot->pc == 0) {
+            slot->pc = pc;
+            slot->count = 1;
+            return;
+        }
+    }
+    ++s_dropped;
+}
+
+bool profiler_start(uint32_t rate_hz, size_t slots)
+{
+    profiler_stop();
+    if (!rate_hz) {
+        return false;
+    }
+    // a power of two
+    size_t size = 1;
+    while (size < slots) {
+        size <<= 1;
+    }
+    if (!s_slots || s_slot_mask + 1 != size) {
+        free(s_slots);
+        s_slots = (profiler_slot_t*) malloc(size * sizeof(profiler_slot_t));
+        if (!s_slots) {
+            return false;
+        }
+        s_slot_mask = size - 1;
+    }
+    s_rate_hz = rate_hz;
+    profiler_reset();
+    // 5 ticks per us, like the PWM takes timer1 over
+    uint32_t ticks = 5000000 / rate_hz;
+    if (ticks < 50) {
+        ticks = 50;
+    }
+    timer1_disable();
+    ETS_FRC_TIMER1_INTR_ATTACH(NULL, NULL);
+    ETS_FRC_TIMER1_NMI_INTR_ATTACH(profiler_isr);
+    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+    timer1_write(ticks);
+    return true;
+}
+
+void profiler_stop()
+{
+    if (!s_rate_hz) {
+        return;
+    }
+    timer1_disable();
+    ETS_FRC_TIMER1_NMI_INTR_ATTACH(NULL);
+    timer1_isr_init();
+    s_rate_hz = 0;
+}
+
+void profiler_reset()
+{
+    if (!s_slots) {
+        return;
+    }
+    uint32_t savedPS = xt_rsil(15);
+    memset(s_slots, 0, (s_slot_mask + 1) * sizeof(profiler_slot_t));
+    s_samples = 0;
+    s_dropped = 0;
+    xt_wsr_ps(savedPS);
+}
+
+void profiler_print(Print& out)
+{
+    out.printf_P(PSTR("profile: %u samples %u dropped %u Hz\n"),
+        (unsigned) s_samples, (unsigned) s_dropped, (unsigned) s_rate_hz);
+    for (uint32_t i = 0; s_slots && i <= s_slot_mask; ++i) {
+        // read once, the NMI may be counting
+        profiler_slot_t slot = s_slots[i];
+        if (slot.pc) {
+            out.printf_P(PSTR("%08x %u\n"), (unsigned) slot.pc, (unsigned) slot.count);
+        }
+    }
+    out.print(F("end\n"));
+}
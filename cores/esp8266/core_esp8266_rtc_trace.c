@@ -0,0 +1,94 @@
+/*
+ core_esp8266_rtc_trace.c - event trace kept in RTC memory across resets
+ This file is part of the esp8266 core for Arduino environment.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <Arduino.h>
+#include "RtcTrace.h"
+
+#define RTC_TRACE_MAGIC 0x54524345
+
+// RTC memory is mapped, writing the words directly is much cheaper than
+// system_rtc_mem_write(); block 0 of the user memory is block 64 of it,
+// at RTC_USER_MEM
+#define RTC_TRACE_MEM (RTC_USER_MEM + RTC_TRACE_OFFSET)
+
+static bool s_active = false;
+static uint32_t s_count;
+static uint32_t s_next;
+
+void ICACHE_RAM_ATTR rtc_trace(uint8_t id, uint32_t arg)
+{
+    if (!s_active) {
+        return;
+    }
+    uint32_t cycles;
+    __asm__ __volatile__("rsr %0, ccount" : "=a" (cycles));
+    uint32_t savedPS = xt_rsil(15);
+    volatile uint32_t* event = &RTC_TRACE_MEM[2 + 2 * s_next];
+    event[0] = (cycles & ~0xff) | id;
+    event[1] = arg;
+    if (++s_next == RTC_TRACE_EVENTS) {
+        s_next = 0;
+    }
+    RTC_TRACE_MEM[1] = ++s_count;
+    xt_wsr_ps(savedPS);
+}
+
+void rtc_trace_begin(void)
+{
+    uint32_t savedPS = xt_rsil(15);
+    s_count = 0;
+    s_next = 0;
+    RTC_TRACE_MEM[0] = RTC_TRACE_MAGIC;
+    RTC_TRACE_MEM[1] = 0;
+    s_active = true;
+    xt_wsr_ps(savedPS);
+}
+
+void rtc_trace_end(void)
+{
+    s_active = false;
+}
+
+uint32_t rtc_trace_count(void)
+{
+    if (RTC_TRACE_MEM[0] != RTC_TRACE_MAGIC) {
+        return 0;
+    }
+    return RTC_TRACE_MEM[1];
+}
+
+size_t rtc_trace_read(rtc_trace_event_t* events, size_t count)
+{
+    uint32_t savedPS = xt_rsil(15);
+    uint32_t total = rtc_trace_count();
+    size_t n = (total < RTC_TRACE_EVENTS) ? total : RTC_TRACE_EVENTS;
+    if (n > count) {
+        n = count;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        // total - n is the oldest one wanted
+        uint32_t index = (total - n + i) % RTC_TRACE_EVENTS;
+        uint32_t stamp = RTC_TRACE_MEM[2 + 2 * index];
+        events[i].cycles = stamp & ~0xff;
+        events[i].id = stamp & 0xff;
+        events[i].arg = RTC_TRACE_MEM[3 + 2 * index];
+    }
+    xt_wsr_ps(savedPS);
+    return n;
+}
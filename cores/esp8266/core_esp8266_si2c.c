@@ -21,11 +21,15 @@
 #include "twi.h"
 #include "pins_arduino.h"
 #include "wiring_private.h"
+#include "ets_sys.h"
 
 unsigned int preferred_si2c_clock = 100000;
 unsigned char twi_dcount = 18;
 static unsigned char twi_sda, twi_scl;
 static uint32_t twi_clockStretchLimit;
+static uint32_t twi_clockStretchLimitUs;
+
+static void twi_async_wait(void);
 
 #define SDA_LOW()   (GPES = (1 << twi_sda)) //Enable SDA (becomes output and since GPO is 0 for the pin, it will pull the line low)
 #define SDA_HIGH()  (GPEC = (1 << twi_sda)) //Disable SDA (becomes input and since it has pullup it will go high)
@@ -38,35 +42,40 @@ static uint32_t twi_clockStretchLimit;
 #define FCPU80 80000000L
 #endif
 
-#if F_CPU == FCPU80
-#define TWI_CLOCK_STRETCH_MULTIPLIER 3
-#else
-#define TWI_CLOCK_STRETCH_MULTIPLIER 6
-#endif
+// the delays are loops, which depend on the CPU frequency
+#define TWI_CPU_80MHZ() (clockCyclesPerMicrosecond() == FCPU80 / 1000000L)
+#define TWI_CLOCK_STRETCH_MULTIPLIER (TWI_CPU_80MHZ() ? 3 : 6)
 
 void twi_setClock(unsigned int freq){
   preferred_si2c_clock = freq;
-#if F_CPU == FCPU80
-  if(freq <= 50000) twi_dcount = 38;//about 50KHz
-  else if(freq <= 100000) twi_dcount = 19;//about 100KHz
-  else if(freq <= 200000) twi_dcount = 8;//about 200KHz
-  else if(freq <= 300000) twi_dcount = 3;//about 300KHz
-  else if(freq <= 400000) twi_dcount = 1;//about 400KHz
-  else twi_dcount = 1;//about 400KHz
-#else
-  if(freq <= 50000) twi_dcount = 64;//about 50KHz
-  else if(freq <= 100000) twi_dcount = 32;//about 100KHz
-  else if(freq <= 200000) twi_dcount = 14;//about 200KHz
-  else if(freq <= 300000) twi_dcount = 8;//about 300KHz
-  else if(freq <= 400000) twi_dcount = 5;//about 400KHz
-  else if(freq <= 500000) twi_dcount = 3;//about 500KHz
-  else if(freq <= 600000) twi_dcount = 2;//about 600KHz
-  else twi_dcount = 1;//about 700KHz
-#endif
+  if (TWI_CPU_80MHZ()) {
+    if(freq <= 50000) twi_dcount = 38;//about 50KHz
+    else if(freq <= 100000) twi_dcount = 19;//about 100KHz
+    else if(freq <= 200000) twi_dcount = 8;//about 200KHz
+    else if(freq <= 300000) twi_dcount = 3;//about 300KHz
+    else if(freq <= 400000) twi_dcount = 1;//about 400KHz
+    else twi_dcount = 1;//about 400KHz
+  } else {
+    if(freq <= 50000) twi_dcount = 64;//about 50KHz
+    else if(freq <= 100000) twi_dcount = 32;//about 100KHz
+    else if(freq <= 200000) twi_dcount = 14;//about 200KHz
+    else if(freq <= 300000) twi_dcount = 8;//about 300KHz
+    else if(freq <= 400000) twi_dcount = 5;//about 400KHz
+    else if(freq <= 500000) twi_dcount = 3;//about 500KHz
+    else if(freq <= 600000) twi_dcount = 2;//about 600KHz
+    else twi_dcount = 1;//about 700KHz
+  }
 }
 
 void twi_setClockStretchLimit(uint32_t limit){
   twi_clockStretchLimit = limit * TWI_CLOCK_STRETCH_MULTIPLIER;
+  twi_clockStretchLimitUs = limit;
+}
+
+// after ESP.setCpuFrequencyMHz() and the like
+void twi_cpu_freq_changed(void){
+  twi_setClock(preferred_si2c_clock);
+  twi_setClockStretchLimit(twi_clockStretchLimitUs);
 }
 
 void twi_init(unsigned char sda, unsigned char scl){
@@ -79,7 +88,10 @@ void twi_init(unsigned char sda, unsigned char scl){
 }
 
 
+static void twi_slave_end(void);
+
 void twi_stop(void){
+  twi_slave_end();
   pinMode(twi_sda, INPUT);
   pinMode(twi_scl, INPUT);
 }
@@ -165,6 +177,7 @@ static unsigned char twi_read_byte(bool nack) {
 
 unsigned char twi_writeTo(unsigned char address, unsigned char * buf, unsigned int len, unsigned char sendStop){
   unsigned int i;
+  twi_async_wait();
   if(!twi_write_start()) 
     return 4;//line busy
   if(!twi_write_byte(((address << 1) | 0) & 0xFF)) {
@@ -193,6 +206,7 @@ unsigned char twi_writeTo(unsigned char address, unsigned char * buf, unsigned i
 
 unsigned char twi_readFrom(unsigned char address, unsigned char* buf, unsigned int len, unsigned char sendStop){
   unsigned int i;
+  twi_async_wait();
   if(!twi_write_start()) 
     return 4;//line busy
   if(!twi_write_byte(((address << 1) | 1) & 0xFF)) {
@@ -216,6 +230,7 @@ unsigned char twi_readFrom(unsigned char address, unsigned char* buf, unsigned i
 }
 
 uint8_t twi_status() {           
+    twi_async_wait();
     if (SCL_READ()==0)     
         return I2C_SCL_HELD_LOW;             //SCL held low by another device, no procedure available to recover
     int clockCount = 20;                   
@@ -236,3 +251,419 @@ uint8_t twi_status() {
     return I2C_OK;                       //all ok
 
 }
+
+// Transactions clocked from the timer1 interrupt, half a bit period a tick,
+// so that the sketch runs while they do. What a tick costs limits the clock.
+
+#define TWI_ASYNC_MAX_CLOCK 100000
+
+enum twi_async_state_e {
+  TWI_ASYNC_IDLE,
+  TWI_ASYNC_START,      // release both lines
+  TWI_ASYNC_START_SDA,  // SDA low while SCL is high
+  TWI_ASYNC_BIT_LOW,    // SCL low, set SDA for the bit
+  TWI_ASYNC_BIT_HIGH,   // SCL high
+  TWI_ASYNC_BIT_END,    // wait for a stretched clock, sample SDA
+  TWI_ASYNC_STOP,       // SCL and SDA low
+  TWI_ASYNC_STOP_SCL,   // SCL high
+  TWI_ASYNC_STOP_SDA,   // SDA high once SCL is
+  TWI_ASYNC_DONE
+};
+
+static volatile uint8_t twi_async_state = TWI_ASYNC_IDLE;
+static uint8_t twi_async_address;   // with the read bit
+static unsigned char *twi_async_buf;
+static unsigned int twi_async_len;
+static unsigned int twi_async_pos;
+static bool twi_async_reading;
+static bool twi_async_sendStop;
+static bool twi_async_addressing;   // the byte being sent is the address
+static uint8_t twi_async_byte;
+static uint8_t twi_async_bit;       // 0 to 7 the data, 8 the acknowledge
+static uint8_t twi_async_status;
+static uint32_t twi_async_stretch;
+static uint32_t twi_async_stretchLimit; // in ticks
+static twi_callback_t twi_async_callback;
+static void *twi_async_arg;
+
+static void twi_async_wait(void){
+  while(twi_async_state != TWI_ASYNC_IDLE)
+    optimistic_yield(1000);
+}
+
+bool twi_busy(void){
+  return twi_async_state != TWI_ASYNC_IDLE;
+}
+
+static void ICACHE_RAM_ATTR twi_async_finish(uint8_t status){
+  timer1_disable();
+  timer1_detachInterrupt();
+  twi_async_state = TWI_ASYNC_IDLE;
+  if (twi_async_callback)
+    twi_async_callback(status, twi_async_arg); // may start the next one
+}
+
+// the slave drives SDA for the data bits it sends and for the ACK of the bytes it receives
+static inline bool ICACHE_RAM_ATTR twi_async_slave_bit(void){
+  bool receiving = twi_async_reading && !twi_async_addressing;
+  return (twi_async_bit == 8) ? !receiving : receiving;
+}
+
+static void ICACHE_RAM_ATTR twi_async_tick(void){
+  for (;;) {
+    switch (twi_async_state) {
+    case TWI_ASYNC_START:
+      SCL_HIGH();
+      SDA_HIGH();
+      twi_async_state = TWI_ASYNC_START_SDA;
+      return;
+
+    case TWI_ASYNC_START_SDA:
+      if (SDA_READ() == 0) {
+        twi_async_finish(4); //line busy
+        return;
+      }
+      SDA_LOW();
+      twi_async_byte = twi_async_address;
+      twi_async_bit = 0;
+      twi_async_addressing = true;
+      twi_async_state = TWI_ASYNC_BIT_LOW;
+      return;
+
+    case TWI_ASYNC_BIT_LOW:
+      SCL_LOW();
+      if (twi_async_slave_bit())
+        SDA_HIGH();
+      else if (twi_async_bit == 8) {
+        if (twi_async_pos == twi_async_len - 1)
+          SDA_HIGH(); //NACK the last byte read
+        else
+          SDA_LOW();
+      } else if (twi_async_byte & 0x80)
+        SDA_HIGH();
+      else
+        SDA_LOW();
+      twi_async_state = TWI_ASYNC_BIT_HIGH;
+      return;
+
+    case TWI_ASYNC_BIT_HIGH:
+      SCL_HIGH();
+      twi_async_stretch = 0;
+      twi_async_state = TWI_ASYNC_BIT_END;
+      return;
+
+    case TWI_ASYNC_BIT_END: {
+      if (SCL_READ() == 0 && (twi_async_stretch++) < twi_async_stretchLimit)
+        return; // Clock stretching
+      bool bit = SDA_READ();
+      if (twi_async_bit < 8) {
+        twi_async_byte = (twi_async_byte << 1) | (twi_async_slave_bit() ? bit : 0);
+        twi_async_bit++;
+        twi_async_state = TWI_ASYNC_BIT_LOW;
+        continue;
+      }
+      if (twi_async_addressing) {
+        twi_async_addressing = false;
+        if (bit) {
+          twi_async_status = 2; //received NACK on transmit of address
+          break;
+        }
+      } else if (twi_async_reading) {
+        twi_async_buf[twi_async_pos++] = twi_async_byte;
+      } else {
+        if (bit) {
+          twi_async_status = 3; //received NACK on transmit of data
+          break;
+        }
+        twi_async_pos++;
+      }
+      if (twi_async_pos < twi_async_len) {
+        twi_async_byte = twi_async_reading ? 0 : twi_async_buf[twi_async_pos];
+        twi_async_bit = 0;
+        twi_async_state = TWI_ASYNC_BIT_LOW;
+        continue;
+      }
+      twi_async_status = 0;
+      break;
+    }
+
+    case TWI_ASYNC_STOP:
+      SCL_LOW();
+      SDA_LOW();
+      twi_async_state = TWI_ASYNC_STOP_SCL;
+      return;
+
+    case TWI_ASYNC_STOP_SCL:
+      SCL_HIGH();
+      twi_async_stretch = 0;
+      twi_async_state = TWI_ASYNC_STOP_SDA;
+      return;
+
+    case TWI_ASYNC_STOP_SDA:
+      if (SCL_READ() == 0 && (twi_async_stretch++) < twi_async_stretchLimit)
+        return; // Clock stretching
+      SDA_HIGH();
+      twi_async_state = TWI_ASYNC_DONE;
+      return;
+
+    case TWI_ASYNC_DONE:
+    default:
+      twi_async_finish(twi_async_status);
+      return;
+    }
+
+    // the transaction ended, with or without error
+    if (twi_async_sendStop) {
+      twi_async_state = TWI_ASYNC_STOP;
+      continue;
+    }
+    twi_async_finish(twi_async_status);
+    return;
+  }
+}
+
+static bool twi_async_begin(unsigned char address, bool reading, unsigned char *buf, unsigned int len,
+                            unsigned char sendStop, twi_callback_t callback, void *arg){
+  if (twi_async_state != TWI_ASYNC_IDLE || timer1_enabled())
+    return false;
+  unsigned int freq = preferred_si2c_clock;
+  if (freq > TWI_ASYNC_MAX_CLOCK)
+    freq = TWI_ASYNC_MAX_CLOCK;
+  if (freq == 0)
+    freq = 1000;
+
+  twi_async_address = ((address << 1) | (reading ? 1 : 0)) & 0xFF;
+  twi_async_reading = reading;
+  twi_async_buf = buf;
+  twi_async_len = len;
+  twi_async_pos = 0;
+  twi_async_sendStop = sendStop;
+  twi_async_status = 0;
+  twi_async_callback = callback;
+  twi_async_arg = arg;
+  twi_async_stretchLimit = (uint64_t)twi_clockStretchLimitUs * 2 * freq / 1000000 + 1;
+  twi_async_state = TWI_ASYNC_START;
+
+  timer1_attachInterrupt(twi_async_tick);
+  timer1_enable(TIM_DIV1, TIM_EDGE, TIM_LOOP);
+  timer1_write(80000000L / 2 / freq); // timer1 counts at 80 MHz whatever the CPU clock
+  return true;
+}
+
+bool twi_writeToAsync(unsigned char address, unsigned char * buf, unsigned int len, unsigned char sendStop,
+                      twi_callback_t callback, void *arg){
+  return twi_async_begin(address, false, buf, len, sendStop, callback, arg);
+}
+
+bool twi_readFromAsync(unsigned char address, unsigned char * buf, unsigned int len, unsigned char sendStop,
+                       twi_callback_t callback, void *arg){
+  return twi_async_begin(address, true, buf, len, sendStop, callback, arg);
+}
+
+// Slave mode: a state machine run from the interrupts of both lines. When
+// the master reads, SCL is held low (clock stretching) until the
+// onRequest handler, run in a task, has given the bytes to send.
+
+#define TWI_SLAVE_BUFFER_LENGTH 32
+#define TWI_SLAVE_TASK_PRIO 2
+#define TWI_SIG_RX 1
+#define TWI_SIG_TX 2
+
+enum twi_slave_state_e {
+  TWI_SLAVE_OFF,
+  TWI_SLAVE_IDLE,     // waiting for a start
+  TWI_SLAVE_ADDRESS,  // receiving the address
+  TWI_SLAVE_RX,       // receiving data
+  TWI_SLAVE_TX,       // sending data
+  TWI_SLAVE_WAIT_TX,  // holding SCL low until there is data to send
+  TWI_SLAVE_IGNORE    // not for us, or the master is done reading
+};
+
+static volatile uint8_t twi_slave_state = TWI_SLAVE_OFF;
+static uint8_t twi_slave_address;
+static uint8_t twi_slave_bits;  // clocked in this byte, 8 is the acknowledge
+static uint8_t twi_slave_byte;
+static uint8_t twi_slave_rxBuffer[TWI_SLAVE_BUFFER_LENGTH];
+static volatile uint8_t twi_slave_rxLength;
+static volatile bool twi_slave_rxBusy; // not handed to onReceive yet
+static uint8_t twi_slave_txBuffer[TWI_SLAVE_BUFFER_LENGTH];
+static volatile uint8_t twi_slave_txLength;
+static uint8_t twi_slave_txIndex;
+static void (*twi_onSlaveReceive)(uint8_t*, int);
+static void (*twi_onSlaveTransmit)(void);
+static ETSEvent twi_slave_queue[2];
+
+void twi_setAddress(uint8_t address){
+  twi_slave_address = address & 0x7F;
+}
+
+void twi_attachSlaveRxEvent(void (*function)(uint8_t*, int)){
+  twi_onSlaveReceive = function;
+}
+
+void twi_attachSlaveTxEvent(void (*function)(void)){
+  twi_onSlaveTransmit = function;
+}
+
+uint8_t twi_transmit(const uint8_t* data, uint8_t length){
+  if(twi_slave_state == TWI_SLAVE_OFF)
+    return 2;
+  if(twi_slave_txLength + length > TWI_SLAVE_BUFFER_LENGTH)
+    return 1;
+  memcpy(&twi_slave_txBuffer[twi_slave_txLength], data, length);
+  twi_slave_txLength += length;
+  return 0;
+}
+
+static void ICACHE_RAM_ATTR twi_slave_rx_done(void){
+  if(twi_slave_state == TWI_SLAVE_RX && twi_slave_rxLength){
+    twi_slave_rxBusy = true;
+    ets_post(TWI_SLAVE_TASK_PRIO, TWI_SIG_RX, 0);
+  }
+}
+
+static uint8_t ICACHE_RAM_ATTR twi_slave_next_byte(void){
+  if(twi_slave_txIndex < twi_slave_txLength)
+    return twi_slave_txBuffer[twi_slave_txIndex++];
+  return 0xFF;
+}
+
+static void ICACHE_RAM_ATTR twi_slave_sda_bit(bool bit){
+  if(bit)
+    SDA_HIGH();
+  else
+    SDA_LOW();
+}
+
+// SDA changing while SCL is high is a start or a stop
+static void ICACHE_RAM_ATTR twi_slave_onSda(void){
+  uint32_t in = GPI;
+  if(!(in & (1 << twi_scl)) || twi_slave_state == TWI_SLAVE_OFF)
+    return;
+  twi_slave_rx_done();
+  if(in & (1 << twi_sda)){
+    twi_slave_state = TWI_SLAVE_IDLE; // stop
+  } else {
+    twi_slave_state = TWI_SLAVE_ADDRESS; // start, or a repeated start
+    twi_slave_bits = 0;
+    twi_slave_byte = 0;
+  }
+  SDA_HIGH();
+}
+
+static void ICACHE_RAM_ATTR twi_slave_onScl(void){
+  uint32_t in = GPI;
+  bool sda = (in & (1 << twi_sda)) != 0;
+  switch(twi_slave_state){
+  case TWI_SLAVE_ADDRESS:
+  case TWI_SLAVE_RX:
+    if(in & (1 << twi_scl)){
+      if(twi_slave_bits < 8)
+        twi_slave_byte = (twi_slave_byte << 1) | sda;
+      twi_slave_bits++;
+      break;
+    }
+    if(twi_slave_bits == 8){
+      // after the 8th bit: acknowledge it, or not
+      if(twi_slave_state == TWI_SLAVE_ADDRESS){
+        if((twi_slave_byte >> 1) != twi_slave_address){
+          twi_slave_state = TWI_SLAVE_IGNORE;
+          break;
+        }
+        SDA_LOW();
+      } else if(!twi_slave_rxBusy && twi_slave_rxLength < TWI_SLAVE_BUFFER_LENGTH){
+        twi_slave_rxBuffer[twi_slave_rxLength++] = twi_slave_byte;
+        SDA_LOW();
+      }
+    } else if(twi_slave_bits == 9){
+      SDA_HIGH();
+      twi_slave_bits = 0;
+      if(twi_slave_state == TWI_SLAVE_ADDRESS){
+        if(twi_slave_byte & 1){
+          // the master reads: hold the clock until onRequest is done
+          SCL_LOW();
+          twi_slave_state = TWI_SLAVE_WAIT_TX;
+          ets_post(TWI_SLAVE_TASK_PRIO, TWI_SIG_TX, 0);
+        } else {
+          twi_slave_state = twi_slave_rxBusy ? TWI_SLAVE_IGNORE : TWI_SLAVE_RX;
+          twi_slave_rxLength = 0;
+        }
+      }
+      twi_slave_byte = 0;
+    }
+    break;
+
+  case TWI_SLAVE_TX:
+    if(in & (1 << twi_scl)){
+      if(twi_slave_bits == 8){
+        if(sda){
+          twi_slave_state = TWI_SLAVE_IGNORE; // NACK: the master has had enough
+          break;
+        }
+        twi_slave_byte = twi_slave_next_byte();
+        twi_slave_bits = 0;
+      } else {
+        twi_slave_bits++;
+      }
+      break;
+    }
+    if(twi_slave_bits < 8)
+      twi_slave_sda_bit(twi_slave_byte & (0x80 >> twi_slave_bits));
+    else
+      SDA_HIGH(); // the master acknowledges
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void twi_slave_task(ETSEvent *e){
+  if(e->sig == TWI_SIG_RX){
+    if(twi_onSlaveReceive)
+      twi_onSlaveReceive(twi_slave_rxBuffer, twi_slave_rxLength);
+    twi_slave_rxLength = 0;
+    twi_slave_rxBusy = false;
+  } else if(e->sig == TWI_SIG_TX){
+    twi_slave_txLength = 0;
+    twi_slave_txIndex = 0;
+    if(twi_onSlaveTransmit)
+      twi_onSlaveTransmit();
+    ETS_GPIO_INTR_DISABLE();
+    if(twi_slave_state == TWI_SLAVE_WAIT_TX){
+      twi_slave_byte = twi_slave_next_byte();
+      twi_slave_bits = 0;
+      twi_slave_state = TWI_SLAVE_TX;
+      twi_slave_sda_bit(twi_slave_byte & 0x80);
+    }
+    SCL_HIGH();
+    ETS_GPIO_INTR_ENABLE();
+  }
+}
+
+void twi_enableSlaveMode(void){
+  if(twi_slave_state != TWI_SLAVE_OFF)
+    return;
+  static bool taskStarted = false;
+  if(!taskStarted){
+    ets_task(twi_slave_task, TWI_SLAVE_TASK_PRIO, twi_slave_queue, sizeof(twi_slave_queue) / sizeof(twi_slave_queue[0]));
+    taskStarted = true;
+  }
+  twi_slave_rxLength = 0;
+  twi_slave_rxBusy = false;
+  twi_slave_state = TWI_SLAVE_IDLE;
+  SDA_HIGH();
+  SCL_HIGH();
+  attachInterrupt(twi_scl, twi_slave_onScl, CHANGE);
+  attachInterrupt(twi_sda, twi_slave_onSda, CHANGE);
+}
+
+static void twi_slave_end(void){
+  if(twi_slave_state == TWI_SLAVE_OFF)
+    return;
+  detachInterrupt(twi_scl);
+  detachInterrupt(twi_sda);
+  twi_slave_state = TWI_SLAVE_OFF;
+  SDA_HIGH();
+  SCL_HIGH();
+}
@@ -21,11 +21,7 @@
 
 #include "Arduino.h" // using pinMode
 
-// definitions in esp8266_peri.h style
-#define GPSD  ESP8266_REG(0x368) // GPIO_SIGMA_DELTA register @ 0x600000368
-#define GPSDT 0  // target, 8 bits
-#define GPSDP 8  // prescaler, 8 bits
-#define GPSDE 16 // enable
+// GPSD, the GPIO_SIGMA_DELTA register, is in esp8266_peri.h
 
 void sigmaDeltaSetPrescaler(uint8_t prescaler); // avoids compiler warning
 
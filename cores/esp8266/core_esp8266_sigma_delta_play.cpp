@@ -0,0 +1,160 @@
+/*
+  core_esp8266_sigma_delta_play.cpp - samples played through sigma delta
+  This file is part of the esp8266 core for Arduino environment.
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+*/
+
+#include <Arduino.h>
+#include "sigma_delta.h"
+#include "Schedule.h"
+
+typedef size_t (*sd_refill_t)(uint8_t* samples, size_t count, void* arg);
+
+// the counters only grow, the ring positions are them masked
+static uint8_t* s_ring = nullptr;
+static uint32_t s_mask;
+static volatile uint32_t s_in;
+static volatile uint32_t s_out;     // moved by the interrupt
+static volatile uint32_t s_underruns;
+static volatile bool s_starved;
+static volatile bool s_refill_pending;
+static sd_refill_t s_refill = nullptr;
+static void* s_refill_arg;
+
+static void sd_play_refill(void*);
+
+static void ICACHE_RAM_ATTR sd_play_isr(void)
+{
+    uint32_t queued = s_in - s_out;
+    if (queued) {
+        GPSD = (GPSD & ~(0xFF << GPSDT)) | (s_ring[s_out & s_mask] << GPSDT);
+        s_out = s_out + 1;
+        s_starved = false;
+    } else if (!s_starved) {
+        s_starved = true;
+        s_underruns = s_underruns + 1;
+    }
+    if (s_refill && !s_refill_pending && queued <= (s_mask + 1) / 2) {
+        s_refill_pending = schedule_function_from_isr(sd_play_refill, nullptr);
+    }
+}
+
+// from loop()
+static void sd_play_refill(void*)
+{
+    s_refill_pending = false;
+    if (!s_ring || !s_refill) {
+        return;
+    }
+    for (;;) {
+        size_t room = sigmaDeltaPlayAvailable();
+        uint32_t pos = s_in & s_mask;
+        // up to the end of the ring, the rest the next time round
+        size_t count = std::min<size_t>(room, s_mask + 1 - pos);
+        if (!count) {
+            return;
+        }
+        size_t got = s_refill(s_ring + pos, count, s_refill_arg);
+        if (got > count) {
+            got = count;
+        }
+        s_in = s_in + got;
+        if (got < count) {
+            return;
+        }
+    }
+}
+
+bool sigmaDeltaPlayBegin(uint32_t rate, size_t size)
+{
+    if (!rate || size < 2 || (size & (size - 1))) {
+        return false;
+    }
+    sigmaDeltaPlayEnd();
+    s_ring = (uint8_t*) malloc(size);
+    if (!s_ring) {
+        return false;
+    }
+    s_mask = size - 1;
+    s_in = 0;
+    s_out = 0;
+    s_underruns = 0;
+    s_starved = true;
+    s_refill_pending = false;
+
+    timer1_disable();
+    timer1_isr_init();
+    timer1_attachInterrupt(sd_play_isr);
+    timer1_enable(TIM_DIV1, TIM_EDGE, TIM_LOOP);
+    // the timer counts at 80MHz, whatever the CPU runs at
+    timer1_write(ESP8266_CLOCK / rate);
+    // a first fill, not to wait for the interrupt
+    if (s_refill) {
+        sd_play_refill(nullptr);
+    }
+    return true;
+}
+
+void sigmaDeltaPlayEnd(void)
+{
+    if (!s_ring) {
+        return;
+    }
+    timer1_disable();
+    timer1_detachInterrupt();
+    free(s_ring);
+    s_ring = nullptr;
+}
+
+size_t sigmaDeltaPlayWrite(const uint8_t* samples, size_t count)
+{
+    count = std::min(count, sigmaDeltaPlayAvailable());
+    for (size_t done = 0; done < count; ) {
+        uint32_t pos = s_in & s_mask;
+        size_t n = std::min<size_t>(count - done, s_mask + 1 - pos);
+        memcpy(s_ring + pos, samples + done, n);
+        done += n;
+        s_in = s_in + n;
+    }
+    return count;
+}
+
+size_t sigmaDeltaPlayAvailable(void)
+{
+    if (!s_ring) {
+        return 0;
+    }
+    return s_mask + 1 - (s_in - s_out);
+}
+
+size_t sigmaDeltaPlayQueued(void)
+{
+    if (!s_ring) {
+        return 0;
+    }
+    return s_in - s_out;
+}
+
+void sigmaDeltaPlaySetRefill(sd_refill_t refill, void* arg)
+{
+    s_refill_arg = arg;
+    s_refill = refill;
+}
+
+uint32_t sigmaDeltaPlayUnderruns(void)
+{
+    return s_underruns;
+}
@@ -27,11 +27,15 @@
 
 extern void esp_schedule();
 extern void esp_yield();
+extern bool esp_task_delay(unsigned long ms);
 
 static os_timer_t delay_timer;
 static os_timer_t micros_overflow_timer;
 static uint32_t micros_at_last_overflow_tick = 0;
 static uint32_t micros_overflow_count = 0;
+// the time the system timer stood still in forced light sleep, counted by
+// the RTC instead (see micros_sleep_compensate())
+static uint64_t micros_sleep_offset = 0;
 #define ONCE 0
 #define REPEAT 1
 
@@ -41,6 +45,9 @@ void delay_end(void* arg) {
 }
 
 void delay(unsigned long ms) {
+    if(ms && esp_task_delay(ms)) {
+        return;
+    }
     if(ms) {
         os_timer_setfn(&delay_timer, (os_timer_func_t*) &delay_end, 0);
         os_timer_arm(&delay_timer, ms, ONCE);
@@ -61,6 +68,13 @@ void micros_overflow_tick(void* arg) {
     micros_at_last_overflow_tick = m;
 }
 
+void micros_sleep_compensate(uint64_t us) {
+    // interrupts off, an ISR reading millis() mustn't see half of it
+    uint32_t savedPS = xt_rsil(15);
+    micros_sleep_offset += us;
+    xt_wsr_ps(savedPS);
+}
+
 //---------------------------------------------------------------------------
 // millis() 'magic multiplier' approximation
 //
@@ -171,6 +185,13 @@ unsigned long ICACHE_RAM_ATTR millis()
   uint32_t  c = micros_overflow_count +
                    ((m < micros_at_last_overflow_tick) ? 1 : 0);
 
+  // time slept: onto the 64-bit count of microseconds, and back
+  if (micros_sleep_offset) {
+    uint64_t us = ((uint64_t)c << 32 | m) + micros_sleep_offset;
+    m = (uint32_t)us;
+    c = (uint32_t)(us >> 32);
+  }
+
   // (a) Init. low-acc with high-word of 1st product. The right-shift
   //     falls on a byte boundary, hence is relatively quick.
   
@@ -190,14 +211,14 @@ unsigned long ICACHE_RAM_ATTR millis()
 } //millis
 
 unsigned long ICACHE_RAM_ATTR micros() {
-    return system_get_time();
+    return system_get_time() + (uint32_t)micros_sleep_offset;
 }
 
 uint64_t ICACHE_RAM_ATTR micros64() {
     uint32_t low32_us = system_get_time();
     uint32_t high32_us = micros_overflow_count + ((low32_us < micros_at_last_overflow_tick) ? 1 : 0);
     uint64_t duration64_us = (uint64_t)high32_us << 32 | low32_us;
-    return duration64_us;
+    return duration64_us + micros_sleep_offset;
 }
 
 void ICACHE_RAM_ATTR delayMicroseconds(unsigned int us) {
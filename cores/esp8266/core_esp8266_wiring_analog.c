@@ -24,6 +24,7 @@
 
 #include "wiring_private.h"
 #include "pins_arduino.h"
+#include "user_interface.h"
 
 
 extern int __analogRead(uint8_t pin)
@@ -35,4 +36,24 @@ extern int __analogRead(uint8_t pin)
     return digitalRead(pin) * 1023;
 }
 
+// system_adc_read_fast() only works with the RF off, and samples with
+// the interrupts disabled
+extern bool __analogReadBurst(uint16_t* buffer, size_t count, uint8_t clkdiv)
+{
+    if(!buffer || count == 0 || count > 0xffff) {
+        return false;
+    }
+    if(wifi_get_opmode() != NULL_MODE) {
+        return false;
+    }
+    if(clkdiv < 8) {
+        clkdiv = 8;
+    } else if(clkdiv > 32) {
+        clkdiv = 32;
+    }
+    system_adc_read_fast(buffer, count, clkdiv);
+    return true;
+}
+
 extern int analogRead(uint8_t pin) __attribute__ ((weak, alias("__analogRead")));
+extern bool analogReadBurst(uint16_t* buffer, size_t count, uint8_t clkdiv) __attribute__ ((weak, alias("__analogReadBurst")));
@@ -0,0 +1,159 @@
+/*
+  core_esp8266_wiring_capture.c - pulse and frequency measurement
+
+  This file is part of the esp8266 core for Arduino environment.
+
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "wiring_private.h"
+#include "pulse_capture.h"
+
+typedef void (*voidFuncPtrArg)(void*);
+
+extern void __attachInterruptArg(uint8_t pin, voidFuncPtr userFunc, void *arg, int mode);
+extern void __detachInterrupt(uint8_t pin);
+
+typedef struct {
+  uint32_t mask;                    // of the pin in GPI
+  uint32_t ccount[CAPTURE_EDGES];
+  uint32_t levels;                  // bit i set: high after edge i
+  volatile uint32_t count;
+} capture_state_t;
+
+static capture_state_t* capture_states[16];
+
+static uint32_t ICACHE_RAM_ATTR capture_ccount(void) {
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0,ccount":"=a"(ccount));
+  return ccount;
+}
+
+static void ICACHE_RAM_ATTR capture_isr(void* arg) {
+  uint32_t now = capture_ccount();
+  capture_state_t* state = (capture_state_t*) arg;
+  uint32_t i = state->count & (CAPTURE_EDGES - 1);
+  state->ccount[i] = now;
+  if (GPI & state->mask) {
+    state->levels |= 1UL << i;
+  } else {
+    state->levels &= ~(1UL << i);
+  }
+  state->count++;
+}
+
+bool capture_begin(uint8_t pin) {
+  if (pin >= 16) {
+    return false;
+  }
+  capture_state_t* state = capture_states[pin];
+  if (!state) {
+    state = (capture_state_t*) malloc(sizeof(capture_state_t));
+    if (!state) {
+      return false;
+    }
+  }
+  // the interrupt of the pin is off until __attachInterruptArg()
+  __detachInterrupt(pin);
+  memset(state, 0, sizeof(*state));
+  state->mask = 1UL << pin;
+  capture_states[pin] = state;
+  __attachInterruptArg(pin, (voidFuncPtr) capture_isr, state, CHANGE);
+  return true;
+}
+
+void capture_end(uint8_t pin) {
+  if (pin >= 16 || !capture_states[pin]) {
+    return;
+  }
+  __detachInterrupt(pin);
+  free(capture_states[pin]);
+  capture_states[pin] = NULL;
+}
+
+// The edges with the interrupt off, oldest first. Returns how many.
+static uint32_t capture_read(uint8_t pin, uint32_t* ccount, uint32_t* levels) {
+  capture_state_t* state = pin < 16 ? capture_states[pin] : NULL;
+  if (!state) {
+    return 0;
+  }
+  ETS_GPIO_INTR_DISABLE();
+  uint32_t count = state->count;
+  uint32_t n = count < CAPTURE_EDGES ? count : CAPTURE_EDGES;
+  uint32_t bits = 0;
+  for (uint32_t k = 0; k < n; k++) {
+    uint32_t i = (count - n + k) & (CAPTURE_EDGES - 1);
+    ccount[k] = state->ccount[i];
+    if (state->levels & (1UL << i)) {
+      bits |= 1UL << k;
+    }
+  }
+  ETS_GPIO_INTR_ENABLE();
+  *levels = bits;
+  return n;
+}
+
+uint32_t capture_count(uint8_t pin) {
+  capture_state_t* state = pin < 16 ? capture_states[pin] : NULL;
+  return state ? state->count : 0;
+}
+
+uint32_t capture_pulse_us(uint8_t pin, uint8_t state) {
+  uint32_t ccount[CAPTURE_EDGES];
+  uint32_t levels;
+  uint32_t n = capture_read(pin, ccount, &levels);
+  for (uint32_t k = n; k-- > 1; ) {
+    bool before = levels & (1UL << (k - 1));
+    bool after = levels & (1UL << k);
+    if (before == !!state && after != !!state) {
+      return clockCyclesToMicroseconds(ccount[k] - ccount[k - 1]);
+    }
+  }
+  return 0;
+}
+
+uint32_t capture_period_us(uint8_t pin) {
+  uint32_t ccount[CAPTURE_EDGES];
+  uint32_t levels;
+  uint32_t n = capture_read(pin, ccount, &levels);
+  uint32_t first = 0, last = 0, rises = 0;
+  for (uint32_t k = 0; k < n; k++) {
+    // a high after a high is a missed pulse, not a rising edge
+    if ((levels & (1UL << k)) && (k == 0 || !(levels & (1UL << (k - 1))))) {
+      if (!rises) {
+        first = ccount[k];
+      }
+      last = ccount[k];
+      rises++;
+    }
+  }
+  if (rises < 2) {
+    return 0;
+  }
+  uint32_t period = (last - first) / (rises - 1);
+  uint32_t since = capture_ccount() - last;
+  if (since > period) {
+    period = since;
+  }
+  return clockCyclesToMicroseconds(period);
+}
+
+float capture_frequency(uint8_t pin) {
+  uint32_t period = capture_period_us(pin);
+  return period ? 1000000.0f / period : 0.0f;
+}
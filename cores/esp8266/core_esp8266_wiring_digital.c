@@ -124,11 +124,10 @@ void ICACHE_RAM_ATTR interrupt_handler(void *arg) {
   uint32_t levels = GPI;
   if(status == 0 || interrupt_reg == 0) return;
   ETS_GPIO_INTR_DISABLE();
-  int i = 0;
   uint32_t changedbits = status & interrupt_reg;
   while(changedbits){
-    while(!(changedbits & (1 << i))) i++;
-    changedbits &= ~(1 << i);
+    int i = __builtin_ctz(changedbits);
+    changedbits &= changedbits - 1;
     interrupt_handler_t *handler = &interrupt_handlers[i];
     if (handler->fn && 
         (handler->mode == CHANGE || 
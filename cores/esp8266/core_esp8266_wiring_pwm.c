@@ -23,199 +23,646 @@
 #include "c_types.h"
 #include "eagle_soc.h"
 #include "ets_sys.h"
+#include "pwm_frames.h"
+#include "pwm_waves.h"
 
-#ifndef F_CPU
-#define F_CPU 800000000L
-#endif
+// Every pin is high from its phase for value/range of the period. The
+// rising and falling edges of all the pins are kept sorted in pwm_edges,
+// changing one pin moves its two edges only; from them the table the timer
+// ISR walks is rebuilt in one pass, and taken by the ISR at the start of
+// the next period. The table sets the state of every pin at the start of
+// the period, so a changed pin can't be left high or low for a period.
+//
+// The servo pulses of pwm_frames.h have a table of their own, for a frame
+// of 20ms by default, taken by the ISR at the start of a frame in the same
+// way: all the pins go high at its start, then low in the order of their
+// widths.
+//
+// The square waves of pwm_waves.h have no table: each has the cycle of its
+// next edge, and adds its high or low time to it as it makes it, so waves of
+// any frequency run at once. The ISR makes the earliest edge of the tables
+// and the waves, so its cost per edge grows with the number of waves only.
+//
+// Both tables and the waves are walked on the CPU cycle counter, not on the
+// timer: the timer interrupt comes PWM_ISR_EARLY_US before the next edge,
+// and the ISR waits for its cycle, then makes the edges due until the next
+// one is far enough to wait for the timer again. So the latency of the
+// NMI doesn't add up, and edges are as accurate as the cycle counter.
+
+#define PWM_PINS 17
+#define PWM_MAX_EDGES (2 * PWM_PINS)
+#define PWM_MAX_STEPS (PWM_MAX_EDGES + 1)
+#define PWM_MIN_FREQ 10     // the period has to fit in the 23 bits of timer1
+#define PWM_MAX_FREQ 40000
+#define PWM_ISR_EARLY_US 2  // more than it takes the NMI to start the ISR
+#define PWM_FRAME_PERIOD_MAX 100000 // us, the 23 bits of timer1 at 80MHz are 104ms
+#define PWM_WAVE_MIN_TICKS (4 * PWM_ISR_EARLY_US * (ESP8266_CLOCK / 1000000L))
+#define PWM_WAVE_MAX_TICKS ESP8266_CLOCK // so that its cycles fit in an int32_t
+#define PWM_TIMER_MAX_TICKS 0x7FFFFF
 
 struct pwm_isr_table {
     uint8_t len;
-    uint16_t steps[17];
-    uint32_t masks[17];
+    uint32_t steps[PWM_MAX_STEPS]; // ticks to the next step
+    uint32_t set[PWM_MAX_STEPS];
+    uint32_t clr[PWM_MAX_STEPS];
 };
 
 struct pwm_isr_data {
     struct pwm_isr_table tables[2];
     uint8_t active;//0 or 1, which table is active in ISR
+    volatile uint8_t changed;//the other one is to be taken at the next start of a period
+    uint8_t step;
+    uint32_t next;//CPU cycle its next step is due at
+};
+
+struct pwm_edge {
+    uint32_t at;    // ticks from the start of the period
+    uint8_t pin;
+    uint8_t rising;
+};
+
+struct pwm_wave {
+    uint32_t next;      // CPU cycle its next edge is due at
+    uint32_t high;      // ticks
+    uint32_t low;
+    uint32_t periods;   // left, 0 for until stopped
+    uint8_t pin;
+    uint8_t level;      // of the pin until the next edge
 };
 
 static struct pwm_isr_data _pwm_isr_data;
+static struct pwm_isr_data _pwm_frame_data;
+static struct pwm_edge pwm_edges[PWM_MAX_EDGES];
+static uint8_t pwm_edges_len = 0;
+static bool pwm_timer_running = false;
 
 uint32_t pwm_mask = 0;
-uint16_t pwm_values[17] = {0,};
+uint16_t pwm_values[PWM_PINS] = {0,};
+uint16_t pwm_phases[PWM_PINS] = {0,};
 uint32_t pwm_freq = 1000;
 uint32_t pwm_range = PWMRANGE;
 
-uint8_t pwm_steps_changed = 0;
-uint32_t pwm_multiplier = 0;
+static uint32_t pwm_period = 0; // ticks
+
+static uint32_t pwm_frame_mask = 0; // pins the frames drive, high or low
+static uint16_t pwm_frame_pulses[PWM_PINS] = {0,}; // us
+static uint32_t pwm_frame_period = 20000; // us
+
+static struct pwm_wave pwm_waves[PWM_WAVES];
+static uint32_t pwm_wave_on = 0;    // bits of the pwm_waves running
+static uint32_t pwm_wave_mask = 0;  // their pins
+
+// the timer counts at 80MHz, the CPU at F_CPU until pwm_cpu_freq_after()
+static uint32_t pwm_cycles_per_tick = F_CPU / ESP8266_CLOCK;
+static uint32_t pwm_early_cycles = PWM_ISR_EARLY_US * (F_CPU / 1000000L);
+static uint32_t pwm_switch_cycles;
+
+static inline uint32_t ICACHE_RAM_ATTR pwm_cycles()
+{
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0,ccount":"=a" (ccount));
+    return ccount;
+}
 
-int pwm_sort_array(uint16_t a[], uint16_t al)
+static void pwm_remove_edges(uint8_t pin)
 {
-    uint16_t i, j;
-    for (i = 1; i < al; i++) {
-        uint16_t tmp = a[i];
-        for (j = i; j >= 1 && tmp < a[j-1]; j--) {
-            a[j] = a[j-1];
+    int i, j = 0;
+    for(i = 0; i < pwm_edges_len; i++) {
+        if(pwm_edges[i].pin != pin) {
+            pwm_edges[j++] = pwm_edges[i];
         }
-        a[j] = tmp;
     }
-    int bl = 1;
-    for(i = 1; i < al; i++) {
-        if(a[i] != a[i-1]) {
-            a[bl++] = a[i];
-        }
+    pwm_edges_len = j;
+}
+
+static void pwm_insert_edge(uint32_t at, uint8_t pin, uint8_t rising)
+{
+    int i = pwm_edges_len++;
+    for(; i > 0 && pwm_edges[i-1].at > at; i--) {
+        pwm_edges[i] = pwm_edges[i-1];
+    }
+    pwm_edges[i].at = at;
+    pwm_edges[i].pin = pin;
+    pwm_edges[i].rising = rising;
+}
+
+static uint32_t pwm_ticks(uint32_t value)
+{
+    return (uint32_t)(((uint64_t)value * pwm_period) / pwm_range);
+}
+
+// Puts the edges of pin, if its output is not constant, where its value and phase say
+static void pwm_update_edges(uint8_t pin)
+{
+    pwm_remove_edges(pin);
+    if(!(pwm_mask & (1 << pin))) {
+        return;
+    }
+    uint32_t duty = pwm_ticks(pwm_values[pin]);
+    if(duty == 0 || duty >= pwm_period) {
+        return;
     }
-    return bl;
+    uint32_t rise = pwm_ticks(pwm_phases[pin]) % pwm_period;
+    uint32_t fall = (rise + duty) % pwm_period;
+    pwm_insert_edge(rise, pin, 1);
+    pwm_insert_edge(fall, pin, 0);
 }
 
-uint32_t pwm_get_mask(uint16_t value)
+// Pins high right after the start of the period
+static uint32_t pwm_start_mask()
 {
-    uint32_t mask = 0;
+    uint32_t high = 0;
     int i;
-    for(i=0; i<17; i++) {
-        if((pwm_mask & (1 << i)) != 0 && pwm_values[i] == value) {
-            mask |= (1 << i);
+    for(i = 0; i < PWM_PINS; i++) {
+        if(!(pwm_mask & (1 << i))) {
+            continue;
         }
+        uint32_t duty = pwm_ticks(pwm_values[i]);
+        uint32_t rise = pwm_ticks(pwm_phases[i]) % pwm_period;
+        if(duty >= pwm_period || (duty && (rise == 0 || rise + duty > pwm_period))) {
+            high |= 1 << i;
+        }
+    }
+    return high;
+}
+
+static void pwm_merge_edge(struct pwm_isr_table *table, int step, const struct pwm_edge *edge)
+{
+    uint32_t bit = 1 << edge->pin;
+    if(edge->rising) {
+        table->set[step] |= bit;
+        table->clr[step] &= ~bit;
+    } else {
+        table->clr[step] |= bit;
+        table->set[step] &= ~bit;
     }
-    return mask;
 }
 
-void prep_pwm_steps()
+static void prep_pwm_steps()
 {
     if(pwm_mask == 0) {
         return;
     }
 
-    int pwm_temp_steps_len = 0;
-    uint16_t pwm_temp_steps[17];
-    uint32_t pwm_temp_masks[17];
-    uint32_t range = pwm_range;
+    _pwm_isr_data.changed = 0;
+    struct pwm_isr_table *table = &(_pwm_isr_data.tables[!_pwm_isr_data.active]);
 
-    if((F_CPU / ESP8266_CLOCK) == 1) {
-        range /= 2;
+    uint32_t high = pwm_start_mask();
+    uint32_t last = 0;
+    int len = 1;
+    table->set[0] = high;
+    table->clr[0] = pwm_mask & ~high;
+    int i;
+    for(i = 0; i < pwm_edges_len; i++) {
+        const struct pwm_edge *edge = &pwm_edges[i];
+        if(!(pwm_mask & (1 << edge->pin)) || edge->at == 0) {
+            continue;
+        }
+        if(edge->at == last) {
+            pwm_merge_edge(table, len - 1, edge);
+            continue;
+        }
+        table->steps[len - 1] = edge->at - last;
+        table->set[len] = 0;
+        table->clr[len] = 0;
+        pwm_merge_edge(table, len, edge);
+        last = edge->at;
+        len++;
     }
+    table->steps[len - 1] = pwm_period - last;
+    table->len = len;
+    _pwm_isr_data.changed = 1;
+}
 
+static void prep_pwm_all()
+{
+    pwm_period = ESP8266_CLOCK / pwm_freq;
+    pwm_edges_len = 0;
     int i;
-    for(i=0; i<17; i++) {
-        if((pwm_mask & (1 << i)) != 0 && pwm_values[i] != 0) {
-            pwm_temp_steps[pwm_temp_steps_len++] = pwm_values[i];
+    for(i = 0; i < PWM_PINS; i++) {
+        pwm_update_edges(i);
+    }
+    prep_pwm_steps();
+}
+
+// The frame table: all the pins with a pulse high at the start, low after
+// their pulse, in the order of the widths
+static void prep_frame_steps()
+{
+    _pwm_frame_data.changed = 0;
+    struct pwm_isr_table *table = &(_pwm_frame_data.tables[!_pwm_frame_data.active]);
+
+    uint32_t high = 0;
+    int i;
+    for(i = 0; i < PWM_PINS; i++) {
+        if((pwm_frame_mask & (1 << i)) && pwm_frame_pulses[i]) {
+            high |= 1 << i;
+        }
+    }
+    table->set[0] = high;
+    table->clr[0] = pwm_frame_mask & ~high;
+    uint32_t last = 0;
+    uint32_t left = high;
+    int len = 1;
+    while(left) {
+        // the next shortest pulse, and the others as long
+        uint32_t width = ~0U;
+        for(i = 0; i < PWM_PINS; i++) {
+            if((left & (1 << i)) && pwm_frame_pulses[i] < width) {
+                width = pwm_frame_pulses[i];
+            }
+        }
+        uint32_t clr = 0;
+        for(i = 0; i < PWM_PINS; i++) {
+            if((left & (1 << i)) && pwm_frame_pulses[i] == width) {
+                clr |= 1 << i;
+            }
         }
+        left &= ~clr;
+        uint32_t at = width * (ESP8266_CLOCK / 1000000L);
+        table->steps[len - 1] = at - last;
+        table->set[len] = 0;
+        table->clr[len] = clr;
+        last = at;
+        len++;
+    }
+    table->steps[len - 1] = pwm_frame_period * (ESP8266_CLOCK / 1000000L) - last;
+    // without pulses the frames stop once the pins are low
+    table->len = high ? len : 0;
+    _pwm_frame_data.changed = 1;
+}
+
+// whether the ISR walks the table: it has one, or is about to take one
+static inline bool ICACHE_RAM_ATTR pwm_isr_on(struct pwm_isr_data *data, uint32_t mask)
+{
+    return mask && (data->tables[data->active].len || (data->step == 0 && data->changed));
+}
+
+static inline void ICACHE_RAM_ATTR pwm_write_pins(uint32_t set, uint32_t clr)
+{
+    if(set & 0xFFFF) {
+        GPOS = set & 0xFFFF;
     }
-    pwm_temp_steps[pwm_temp_steps_len++] = range;
-    pwm_temp_steps_len = pwm_sort_array(pwm_temp_steps, pwm_temp_steps_len) - 1;
-    for(i=0; i<pwm_temp_steps_len; i++) {
-        pwm_temp_masks[i] = pwm_get_mask(pwm_temp_steps[i]);
+    if(clr & 0xFFFF) {
+        GPOC = clr & 0xFFFF;
     }
-    for(i=pwm_temp_steps_len; i>0; i--) {
-        pwm_temp_steps[i] = pwm_temp_steps[i] - pwm_temp_steps[i-1];
+    if(set & 0x10000) {
+        GP16O = 1;
+    } else if(clr & 0x10000) {
+        GP16O = 0;
     }
+}
 
-    pwm_steps_changed = 0;
-    struct pwm_isr_table *table = &(_pwm_isr_data.tables[!_pwm_isr_data.active]);
-    table->len = pwm_temp_steps_len;
-    ets_memcpy(table->steps, pwm_temp_steps, (pwm_temp_steps_len + 1) * 2);
-    ets_memcpy(table->masks, pwm_temp_masks, pwm_temp_steps_len * 4);
-    pwm_multiplier = ESP8266_CLOCK/(range * pwm_freq);
-    pwm_steps_changed = 1;
+static inline void ICACHE_RAM_ATTR pwm_isr_step(struct pwm_isr_data *data, uint32_t mask)
+{
+    if(data->step == 0 && data->changed) {
+        data->active = !data->active;
+        data->changed = 0;
+    }
+    struct pwm_isr_table *table = &(data->tables[data->active]);
+    pwm_write_pins(table->set[data->step] & mask, table->clr[data->step] & mask);
+    data->next += table->steps[data->step] * pwm_cycles_per_tick;
+    if(++data->step >= table->len) {
+        data->step = 0;
+    }
 }
 
-void ICACHE_RAM_ATTR pwm_timer_isr() //103-138
+static inline void ICACHE_RAM_ATTR pwm_wave_step(int i)
 {
-    struct pwm_isr_table *table = &(_pwm_isr_data.tables[_pwm_isr_data.active]);
-    static uint8_t current_step = 0;
-    TEIE &= ~TEIE1;//14
-    T1I = 0;//9
-    if(current_step < table->len) { //20/21
-        uint32_t mask = table->masks[current_step] & pwm_mask;
-        if(mask & 0xFFFF) {
-            GPOC = mask & 0xFFFF;    //15/21
-        }
-        if(mask & 0x10000) {
-            GP16O = 0;    //6/13
+    struct pwm_wave *wave = &pwm_waves[i];
+    uint32_t bit = 1 << wave->pin;
+    if(wave->level) {
+        pwm_write_pins(0, bit);
+        wave->level = 0;
+        wave->next += wave->low * pwm_cycles_per_tick;
+        if(wave->periods && --wave->periods == 0) {
+            pwm_wave_on &= ~(1 << i);
+            pwm_wave_mask &= ~bit;
         }
-        current_step++;//1
     } else {
-        current_step = 0;//1
-        if(pwm_mask == 0) { //12
-            table->len = 0;
-            return;
+        pwm_write_pins(bit, 0);
+        wave->level = 1;
+        wave->next += wave->high * pwm_cycles_per_tick;
+    }
+}
+
+// the table step or the wave edge due first: -1 for the PWM table, -2 for
+// the frames, the index of the wave, or -3 for none
+static inline int ICACHE_RAM_ATTR pwm_isr_next(uint32_t *next)
+{
+    int which = -3;
+    if(pwm_isr_on(&_pwm_isr_data, pwm_mask)) {
+        *next = _pwm_isr_data.next;
+        which = -1;
+    }
+    if(pwm_isr_on(&_pwm_frame_data, pwm_frame_mask) &&
+       (which == -3 || (int32_t)(_pwm_frame_data.next - *next) < 0)) {
+        *next = _pwm_frame_data.next;
+        which = -2;
+    }
+    uint32_t on = pwm_wave_on;
+    int i;
+    for(i = 0; on; i++, on >>= 1) {
+        if((on & 1) && (which == -3 || (int32_t)(pwm_waves[i].next - *next) < 0)) {
+            *next = pwm_waves[i].next;
+            which = i;
         }
-        if(pwm_mask & 0xFFFF) {
-            GPOS = pwm_mask & 0xFFFF;    //11
+    }
+    return which;
+}
+
+void ICACHE_RAM_ATTR pwm_timer_isr()
+{
+    TEIE &= ~TEIE1;
+    T1I = 0;
+    for(;;) {
+        uint32_t next;
+        int which = pwm_isr_next(&next);
+        if(which == -3) {
+            return;
         }
-        if(pwm_mask & 0x10000) {
-            GP16O = 1;    //5/13
+        int32_t left = next - pwm_cycles();
+        if(left > 2 * (int32_t) pwm_early_cycles) {
+            uint32_t ticks = (left - pwm_early_cycles) / pwm_cycles_per_tick;
+            T1L = (ticks > PWM_TIMER_MAX_TICKS) ? PWM_TIMER_MAX_TICKS : ticks;
+            TEIE |= TEIE1;
+            return;
         }
-        if(pwm_steps_changed) { //12/21
-            _pwm_isr_data.active = !_pwm_isr_data.active;
-            table = &(_pwm_isr_data.tables[_pwm_isr_data.active]);
-            pwm_steps_changed = 0;
+        while((int32_t)(next - pwm_cycles()) > 0);
+        if(which == -1) {
+            pwm_isr_step(&_pwm_isr_data, pwm_mask);
+        } else if(which == -2) {
+            pwm_isr_step(&_pwm_frame_data, pwm_frame_mask);
+        } else {
+            pwm_wave_step(which);
         }
     }
-    T1L = (table->steps[current_step] * pwm_multiplier);//23
-    TEIE |= TEIE1;//13
 }
 
-void pwm_start_timer()
+static void pwm_attach_timer()
 {
-    timer1_disable();
-    ETS_FRC_TIMER1_INTR_ATTACH(NULL, NULL);
-    ETS_FRC_TIMER1_NMI_INTR_ATTACH(pwm_timer_isr);
-    timer1_enable(TIM_DIV1, TIM_EDGE, TIM_SINGLE);
+    if(!pwm_timer_running) {
+        timer1_disable();
+        ETS_FRC_TIMER1_INTR_ATTACH(NULL, NULL);
+        ETS_FRC_TIMER1_NMI_INTR_ATTACH(pwm_timer_isr);
+        timer1_enable(TIM_DIV1, TIM_EDGE, TIM_SINGLE);
+        pwm_timer_running = true;
+    }
+}
+
+// Starts the timer, or makes it interrupt now to take a table that was not walked
+static void pwm_start_timer(struct pwm_isr_data *data)
+{
+    pwm_attach_timer();
+    TEIE &= ~TEIE1;
+    data->step = 0;
+    data->next = pwm_cycles() + 2 * pwm_early_cycles;
     timer1_write(1);
 }
 
+static void pwm_cpu_freq_move(uint32_t *next, uint32_t now, uint32_t old_mhz, uint32_t new_mhz)
+{
+    int32_t left = *next - pwm_switch_cycles;
+    if(left < 0) {
+        left = 0;
+    }
+    *next = now + (uint32_t)((uint64_t) left * new_mhz / old_mhz);
+}
+
+// Called by the CPU frequency governor around a switch, interrupts off: the
+// timer NMI is held, and the edges due are moved to their cycle at the new
+// frequency
+void pwm_cpu_freq_before(void)
+{
+    if(pwm_timer_running) {
+        TEIE &= ~TEIE1;
+    }
+    pwm_switch_cycles = pwm_cycles();
+}
+
+void pwm_cpu_freq_after(uint32_t old_mhz, uint32_t new_mhz)
+{
+    uint32_t now = pwm_cycles();
+    pwm_cycles_per_tick = new_mhz * 1000000L / ESP8266_CLOCK;
+    pwm_early_cycles = PWM_ISR_EARLY_US * new_mhz;
+    if(pwm_timer_running) {
+        pwm_cpu_freq_move(&_pwm_isr_data.next, now, old_mhz, new_mhz);
+        pwm_cpu_freq_move(&_pwm_frame_data.next, now, old_mhz, new_mhz);
+        int i;
+        for(i = 0; i < PWM_WAVES; i++) {
+            pwm_cpu_freq_move(&pwm_waves[i].next, now, old_mhz, new_mhz);
+        }
+        timer1_write(1);
+    }
+}
+
+static void ICACHE_RAM_ATTR pwm_wave_remove(uint8_t pin)
+{
+    int i;
+    for(i = 0; i < PWM_WAVES; i++) {
+        if((pwm_wave_on & (1 << i)) && pwm_waves[i].pin == pin) {
+            pwm_wave_on &= ~(1 << i);
+        }
+    }
+    pwm_wave_mask &= ~(1 << pin);
+}
+
 void ICACHE_RAM_ATTR pwm_stop_pin(uint8_t pin)
 {
+    pwm_frame_mask &= ~(1 << pin);
     if(pwm_mask){
         pwm_mask &= ~(1 << pin);
-        if(pwm_mask == 0) {
-            ETS_FRC_TIMER1_NMI_INTR_ATTACH(NULL);
-            timer1_disable();
-            timer1_isr_init();
-        }
+    }
+    if(pwm_wave_mask & (1 << pin)) {
+        TEIE &= ~TEIE1;
+        pwm_wave_remove(pin);
+        timer1_write(1);
+    }
+    if(pwm_timer_running && pwm_mask == 0 && pwm_frame_mask == 0 && pwm_wave_on == 0) {
+        ETS_FRC_TIMER1_NMI_INTR_ATTACH(NULL);
+        timer1_disable();
+        timer1_isr_init();
+        pwm_timer_running = false;
     }
 }
 
 extern void __analogWrite(uint8_t pin, int value)
 {
     bool start_timer = false;
-    if(value == 0) {
+    if(pin >= PWM_PINS) {
+        return;
+    }
+    if(value <= 0) {
         digitalWrite(pin, LOW);
+        pwm_update_edges(pin);
         prep_pwm_steps();
         return;
     }
     if((pwm_mask & (1 << pin)) == 0) {
         if(pwm_mask == 0) {
-            memset(&_pwm_isr_data, 0, sizeof(_pwm_isr_data));
+            if(pwm_timer_running) {
+                TEIE &= ~TEIE1; // until pwm_start_timer(), the frames may be running
+            }
+            memset(_pwm_isr_data.tables, 0, sizeof(_pwm_isr_data.tables));
+            _pwm_isr_data.changed = 0;
+            pwm_period = ESP8266_CLOCK / pwm_freq;
             start_timer = true;
         }
         pinMode(pin, OUTPUT);
         digitalWrite(pin, LOW);
         pwm_mask |= (1 << pin);
     }
-    if((F_CPU / ESP8266_CLOCK) == 1) {
-        value = (value+1) / 2;
-    }
-    pwm_values[pin] = value % (pwm_range + 1);
+    pwm_values[pin] = ((uint32_t)value > pwm_range) ? pwm_range : value;
+    pwm_update_edges(pin);
     prep_pwm_steps();
     if(start_timer) {
-        pwm_start_timer();
+        pwm_start_timer(&_pwm_isr_data);
+    }
+}
+
+extern void __analogWritePhase(uint8_t pin, int phase)
+{
+    if(pin >= PWM_PINS) {
+        return;
+    }
+    pwm_phases[pin] = (phase < 0) ? 0 : (((uint32_t)phase > pwm_range) ? pwm_range : phase);
+    if(pwm_mask & (1 << pin)) {
+        pwm_update_edges(pin);
+        prep_pwm_steps();
     }
 }
 
 extern void __analogWriteFreq(uint32_t freq)
 {
+    if(freq < PWM_MIN_FREQ) {
+        freq = PWM_MIN_FREQ;
+    } else if(freq > PWM_MAX_FREQ) {
+        freq = PWM_MAX_FREQ;
+    }
     pwm_freq = freq;
-    prep_pwm_steps();
+    prep_pwm_all();
 }
 
 extern void __analogWriteRange(uint32_t range)
 {
+    if(range == 0) {
+        return;
+    }
     pwm_range = range;
-    prep_pwm_steps();
+    prep_pwm_all();
+}
+
+void pwm_frame_write(uint8_t pin, uint32_t pulse_us)
+{
+    if(pin >= PWM_PINS) {
+        return;
+    }
+    if(pulse_us >= pwm_frame_period) {
+        pulse_us = pwm_frame_period - 1;
+    }
+    if(!(pwm_frame_mask & (1 << pin))) {
+        if(!pulse_us) {
+            return;
+        }
+        pinMode(pin, OUTPUT);
+        digitalWrite(pin, LOW); // also takes it from analogWrite()
+    }
+    if(pwm_timer_running) {
+        TEIE &= ~TEIE1; // so that the frames can't stop meanwhile
+    }
+    bool frames_on = pwm_timer_running && pwm_isr_on(&_pwm_frame_data, pwm_frame_mask);
+    pwm_frame_mask |= 1 << pin;
+    pwm_frame_pulses[pin] = pulse_us;
+    prep_frame_steps();
+    if(frames_on) {
+        timer1_write(1);
+    } else {
+        pwm_start_timer(&_pwm_frame_data);
+    }
+}
+
+void pwm_frame_set_period(uint32_t period_us)
+{
+    if(period_us < 1000) {
+        period_us = 1000;
+    } else if(period_us > PWM_FRAME_PERIOD_MAX) {
+        period_us = PWM_FRAME_PERIOD_MAX;
+    }
+    pwm_frame_period = period_us;
+    if(pwm_frame_mask) {
+        prep_frame_steps();
+    }
+}
+
+bool pwm_wave_start(uint8_t pin, uint32_t high_ticks, uint32_t low_ticks, uint32_t periods)
+{
+    if(pin >= PWM_PINS) {
+        return false;
+    }
+    if(high_ticks < PWM_WAVE_MIN_TICKS) {
+        high_ticks = PWM_WAVE_MIN_TICKS;
+    } else if(high_ticks > PWM_WAVE_MAX_TICKS) {
+        high_ticks = PWM_WAVE_MAX_TICKS;
+    }
+    if(low_ticks < PWM_WAVE_MIN_TICKS) {
+        low_ticks = PWM_WAVE_MIN_TICKS;
+    } else if(low_ticks > PWM_WAVE_MAX_TICKS) {
+        low_ticks = PWM_WAVE_MAX_TICKS;
+    }
+    if(pwm_timer_running) {
+        TEIE &= ~TEIE1; // the ISR can't stop the wave or take it meanwhile
+    }
+    int i, slot = -1;
+    for(i = 0; i < PWM_WAVES; i++) {
+        if((pwm_wave_on & (1 << i)) && pwm_waves[i].pin == pin) {
+            slot = i;
+            break;
+        }
+        if(slot < 0 && !(pwm_wave_on & (1 << i))) {
+            slot = i;
+        }
+    }
+    if(slot < 0) {
+        if(pwm_timer_running) {
+            TEIE |= TEIE1;
+        }
+        return false;
+    }
+    struct pwm_wave *wave = &pwm_waves[slot];
+    if(!(pwm_wave_on & (1 << slot))) {
+        // also takes it from analogWrite() or the frames, and stops the timer
+        // if they were its last users
+        pinMode(pin, OUTPUT);
+        digitalWrite(pin, LOW);
+        wave->pin = pin;
+        wave->level = 0;
+        pwm_attach_timer();
+        TEIE &= ~TEIE1;
+        wave->next = pwm_cycles() + 2 * pwm_early_cycles;
+        pwm_wave_on |= 1 << slot;
+        pwm_wave_mask |= 1 << pin;
+    }
+    wave->high = high_ticks;
+    wave->low = low_ticks;
+    wave->periods = periods;
+    timer1_write(1);
+    return true;
+}
+
+void pwm_wave_stop(uint8_t pin)
+{
+    if(pin >= PWM_PINS || !(pwm_wave_mask & (1 << pin))) {
+        return;
+    }
+    digitalWrite(pin, LOW);
+}
+
+bool pwm_wave_running(uint8_t pin)
+{
+    return pin < PWM_PINS && (pwm_wave_mask & (1 << pin));
 }
 
 extern void analogWrite(uint8_t pin, int val) __attribute__ ((weak, alias("__analogWrite")));
+extern void analogWritePhase(uint8_t pin, int phase) __attribute__ ((weak, alias("__analogWritePhase")));
 extern void analogWriteFreq(uint32_t freq) __attribute__ ((weak, alias("__analogWriteFreq")));
 extern void analogWriteRange(uint32_t range) __attribute__ ((weak, alias("__analogWriteRange")));
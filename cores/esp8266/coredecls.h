@@ -11,8 +11,42 @@ extern "C" {
 extern bool timeshift64_is_set;
 
 void tune_timeshift64 (uint64_t now_us);
+void adjust_timeshift64 (uint64_t now_us);
+extern bool time_is_synced;
+uint64_t time_now_us (void);
+uint32_t time_now_sec (void);
 void settimeofday_cb (void (*cb)(void));
 
+// for ESP.getBootTimes(), when the station gets an IP address
+void boot_times_got_ip (void);
+
+// millis() of the last TCP or UDP data sent or received, kept by
+// ClientContext and UdpContext for WiFi.setAutoSleep()
+extern uint32_t net_activity_ms;
+void net_activity (void);
+
+// the sketch slots of the A/B layouts (eboot_command.h), the slot running
+// is -1 with the other layouts
+int app_slot_current (void);
+uint32_t app_slot_address (int slot);
+bool app_slot_switch (int slot);
+bool app_slot_is_trial (void);
+bool app_slot_confirm (void);
+void app_slot_defer_confirm (void);
+void app_slot_auto_confirm (void);
+
+// the CPU frequency governor behind ESP.setCpuFrequencyMHz(): 80 or 160 MHz
+// as set, or following the load of the loop task, 160 MHz while boosted
+bool cpu_freq_set (uint8_t mhz);
+void cpu_freq_auto (bool enable);
+void cpu_freq_boost (bool begin);
+void cpu_freq_update (void);
+void cpu_freq_loop_task (uint32_t busy_us);
+
+// add the time the system timer stood still, in light sleep, to millis(),
+// micros() and micros64()
+void micros_sleep_compensate (uint64_t us);
+
 #ifdef __cplusplus
 }
 #endif
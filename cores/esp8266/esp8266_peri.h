@@ -82,6 +82,12 @@
 #define GPCD   2  //DRIVER 0:normal,1:open drain
 #define GPCS   0  //SOURCE 0:GPIO_DATA,1:SigmaDelta
 
+//GPIO Sigma Delta Register
+#define GPSD   ESP8266_REG(0x368) //GPIO_SIGMA_DELTA
+#define GPSDT  0  //target, 8 bits
+#define GPSDP  8  //prescaler, 8 bits
+#define GPSDE  16 //enable
+
 #define GPMUX  ESP8266_REG(0x800)
 //GPIO (0-15) PIN Function Registers
 #define GPF0   ESP8266_REG(0x834)
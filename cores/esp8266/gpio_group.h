@@ -0,0 +1,114 @@
+/*
+  gpio_group.h - several GPIO pins in one register access
+
+  This file is part of the esp8266 core for Arduino environment.
+
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef GPIO_GROUP_H
+#define GPIO_GROUP_H
+
+#include <stdint.h>
+#include "esp8266_peri.h"
+
+// Pins 0 to 15 share the GPO and GPI registers: one write sets or clears
+// any of them at the same time, one read gets all their levels. These are
+// always inlined, so they may be used from ICACHE_RAM_ATTR code. They
+// don't change the pin modes: set the pins with pinMode() first. GPIO16
+// is not in these registers.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline __attribute__((always_inline)) void gpioWriteMask(uint32_t set, uint32_t clear)
+{
+    GPOS = set & 0xffff;
+    GPOC = clear & 0xffff;
+}
+
+static inline __attribute__((always_inline)) uint32_t gpioReadAll(void)
+{
+    return GPI & 0xffff;
+}
+
+#ifdef __cplusplus
+}
+
+// Up to 8 pins taken as the bits of a value, bit 0 for the first pin.
+// The masks of every value are worked out once, in the constructor, so
+// write() is two table lookups and gpioWriteMask().
+class GpioGroup
+{
+public:
+    GpioGroup(const uint8_t* pins, uint8_t count)
+    : _mask(0), _count(count > 8 ? 8 : count)
+    {
+        for (uint8_t i = 0; i < _count; ++i) {
+            _pins[i] = pins[i];
+            if (pins[i] < 16) {
+                _mask |= 1UL << pins[i];
+            }
+        }
+        for (uint32_t v = 0; v < 16; ++v) {
+            _low[v] = _bits(v, 0);
+            _high[v] = _bits(v, 4);
+        }
+    }
+
+    inline __attribute__((always_inline)) void write(uint8_t value) const
+    {
+        uint32_t set = _low[value & 0xf] | _high[value >> 4];
+        gpioWriteMask(set, _mask & ~set);
+    }
+
+    inline __attribute__((always_inline)) uint8_t read() const
+    {
+        uint32_t levels = gpioReadAll();
+        uint8_t value = 0;
+        for (uint8_t i = 0; i < _count; ++i) {
+            if (levels & (1UL << _pins[i])) {
+                value |= 1 << i;
+            }
+        }
+        return value;
+    }
+
+    uint32_t mask() const { return _mask; }
+
+protected:
+    uint32_t _bits(uint32_t v, uint8_t first) const
+    {
+        uint32_t bits = 0;
+        for (uint8_t i = 0; i < 4 && first + i < _count; ++i) {
+            if ((v & (1 << i)) && _pins[first + i] < 16) {
+                bits |= 1UL << _pins[first + i];
+            }
+        }
+        return bits;
+    }
+
+    uint32_t _mask;
+    uint32_t _low[16];
+    uint32_t _high[16];
+    uint8_t _pins[8];
+    uint8_t _count;
+};
+
+#endif
+
+#endif
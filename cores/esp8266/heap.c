@@ -4,6 +4,7 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include "umm_malloc/umm_malloc.h"
 #include <c_types.h>
 #include <sys/reent.h>
@@ -12,10 +13,292 @@
 void *umm_last_fail_alloc_addr = NULL;
 int umm_last_fail_alloc_size = 0;
 
+#ifdef DEBUG_ESP_HEAP_PROFILE
+
+#ifndef HEAP_PROFILE_SITES
+#define HEAP_PROFILE_SITES 48
+#endif
+
+// Every profiled block starts with the call site that allocated it and the
+// size that was asked for, the caller gets what follows. Site 0 collects the
+// allocations of all sites that didn't fit in the table anymore.
+typedef struct {
+    uint16_t site;
+    uint16_t size;
+} heap_profile_header_t;
+
+static HEAP_PROFILE_SITE heap_profile_table[HEAP_PROFILE_SITES];
+static int heap_profile_count = 1;
+
+static int heap_profile_site(const char* file, int line, const void* caller)
+{
+    int i;
+    if (file)
+        caller = NULL;
+    for (i = 1; i < heap_profile_count; ++i) {
+        HEAP_PROFILE_SITE* site = &heap_profile_table[i];
+        if (site->file == file && site->line == line && site->caller == caller)
+            return i;
+    }
+    if (heap_profile_count == HEAP_PROFILE_SITES)
+        return 0;
+    heap_profile_table[i].file = file;
+    heap_profile_table[i].line = line;
+    heap_profile_table[i].caller = caller;
+    return heap_profile_count++;
+}
+
+static void* heap_profile_track(void* block, size_t size, const char* file, int line, const void* caller)
+{
+    heap_profile_header_t* header = (heap_profile_header_t*) block;
+    HEAP_PROFILE_SITE* site;
+    if (!header)
+        return NULL;
+    ets_intr_lock();
+    header->site = heap_profile_site(file, line, caller);
+    header->size = size;
+    site = &heap_profile_table[header->site];
+    site->live += size;
+    ++site->allocs;
+    if (site->live > site->peak)
+        site->peak = site->live;
+    ets_intr_unlock();
+    return header + 1;
+}
+
+static void heap_profile_untrack(heap_profile_header_t* header)
+{
+    ets_intr_lock();
+    heap_profile_table[header->site].live -= header->size;
+    ets_intr_unlock();
+}
+
+static void* heap_profile_malloc(size_t size, const char* file, int line, const void* caller)
+{
+    if (0 == size || size > UINT16_MAX)
+        return NULL;
+    return heap_profile_track(umm_malloc(size + sizeof(heap_profile_header_t)), size, file, line, caller);
+}
+
+static void* heap_profile_calloc(size_t count, size_t size, const char* file, int line, const void* caller)
+{
+    if (0 == count || 0 == size || size > UINT16_MAX / count)
+        return NULL;
+    size *= count;
+    return heap_profile_track(umm_calloc(1, size + sizeof(heap_profile_header_t)), size, file, line, caller);
+}
+
+static void* heap_profile_realloc(void* ptr, size_t size, const char* file, int line, const void* caller)
+{
+    heap_profile_header_t* header;
+    if (!ptr)
+        return heap_profile_malloc(size, file, line, caller);
+    if (0 == size) {
+        free(ptr);
+        return NULL;
+    }
+    if (size > UINT16_MAX)
+        return NULL;
+    header = (heap_profile_header_t*) umm_realloc((heap_profile_header_t*) ptr - 1, size + sizeof(heap_profile_header_t));
+    if (!header)
+        return NULL;
+    // the old site and size moved along with the data
+    heap_profile_untrack(header);
+    return heap_profile_track(header, size, file, line, caller);
+}
+
+void free(void* ptr)
+{
+    if (ptr) {
+        heap_profile_header_t* header = (heap_profile_header_t*) ptr - 1;
+        heap_profile_untrack(header);
+        umm_free(header);
+    }
+}
+
+void* malloc_caller(size_t size, const void* caller)
+{
+    return heap_profile_malloc(size, NULL, 0, caller);
+}
+
+int heap_profile_get(int index, HEAP_PROFILE_SITE* site)
+{
+    int count;
+    ets_intr_lock();
+    if (index >= 0 && index < heap_profile_count)
+        *site = heap_profile_table[index];
+    count = heap_profile_count;
+    ets_intr_unlock();
+    return count;
+}
+
+void heap_profile_reset(void)
+{
+    int i;
+    ets_intr_lock();
+    for (i = 0; i < heap_profile_count; ++i) {
+        heap_profile_table[i].allocs = 0;
+        heap_profile_table[i].peak = heap_profile_table[i].live;
+    }
+    ets_intr_unlock();
+}
+
+// the allocations of newlib are recorded by caller
+#define heap_malloc(s)     heap_profile_malloc(s, NULL, 0, __builtin_return_address(0))
+#define heap_calloc(n, s)  heap_profile_calloc(n, s, NULL, 0, __builtin_return_address(0))
+#define heap_realloc(p, s) heap_profile_realloc(p, s, NULL, 0, __builtin_return_address(0))
+
+#else
+
+int heap_profile_get(int index, HEAP_PROFILE_SITE* site)
+{
+    (void) index;
+    (void) site;
+    return 0;
+}
+
+void heap_profile_reset(void)
+{
+}
+
+#define heap_malloc(s)     malloc(s)
+#define heap_calloc(n, s)  calloc(n, s)
+#define heap_realloc(p, s) realloc(p, s)
+
+#endif // !defined(DEBUG_ESP_HEAP_PROFILE)
+
+#ifdef DEBUG_ESP_HEAP_TRACE
+
+// Every heap operation from heap_trace_start() on comes out as a line on the
+// debug output, for tests/host/heap/heap_replay to run against the host build
+// of umm_malloc (pointers in hex, sizes those asked for):
+//   ~h <heap addr> <heap size> <poison> <slab> the trace starts
+//   ~l <ptr> <size>                            live when it started
+//   ~m <ptr> <size>[ <file>:<line>]            malloc, ptr 0 if it failed
+//   ~c <ptr> <size>[ <file>:<line>]            calloc, of count * size
+//   ~r <ptr> <old ptr> <size>[ <file>:<line>]  realloc
+//   ~f <ptr>                                   free
+// The lines are printed with interrupts off, so that they don't get mixed
+// up; a fast baud rate keeps the workload closer to the real thing.
+
+#ifdef UMM_POISON
+#define HEAP_TRACE_POISON 1
+#else
+#define HEAP_TRACE_POISON 0
+#endif
+#ifdef UMM_SLAB
+#define HEAP_TRACE_SLAB 1
+#else
+#define HEAP_TRACE_SLAB 0
+#endif
+
+static bool heap_trace_on = false;
+
+static const char trace_fmt_h[]    ICACHE_RODATA_ATTR STORE_ATTR = "~h %x %u %d %d\n";
+static const char trace_fmt_l[]    ICACHE_RODATA_ATTR STORE_ATTR = "~l %x %u\n";
+static const char trace_fmt_m[]    ICACHE_RODATA_ATTR STORE_ATTR = "~m %x %u";
+static const char trace_fmt_c[]    ICACHE_RODATA_ATTR STORE_ATTR = "~c %x %u";
+static const char trace_fmt_r[]    ICACHE_RODATA_ATTR STORE_ATTR = "~r %x %x %u";
+static const char trace_fmt_f[]    ICACHE_RODATA_ATTR STORE_ATTR = "~f %x\n";
+static const char trace_fmt_sp[]   ICACHE_RODATA_ATTR STORE_ATTR = " ";
+static const char trace_fmt_line[] ICACHE_RODATA_ATTR STORE_ATTR = ":%d\n";
+static const char trace_fmt_nl[]   ICACHE_RODATA_ATTR STORE_ATTR = "\n";
+
+static void heap_trace_site(const char* file, int line)
+{
+    if (file) {
+        os_printf(trace_fmt_sp);
+        os_printf(file);
+        os_printf(trace_fmt_line, line);
+    } else {
+        os_printf(trace_fmt_nl);
+    }
+}
+
+static void heap_trace_live(void* ptr, size_t size, void* arg)
+{
+    (void) arg;
+    os_printf(trace_fmt_l, (uint32_t) ptr, size);
+}
+
+void heap_trace_start(void)
+{
+    ets_intr_lock();
+    os_printf(trace_fmt_h, UMM_MALLOC_CFG__HEAP_ADDR, UMM_MALLOC_CFG__HEAP_SIZE, HEAP_TRACE_POISON, HEAP_TRACE_SLAB);
+    umm_walk(heap_trace_live, NULL);
+    heap_trace_on = true;
+    ets_intr_unlock();
+}
+
+void heap_trace_stop(void)
+{
+    heap_trace_on = false;
+}
+
+static void* heap_trace_malloc(size_t size, const char* file, int line)
+{
+    void* ret;
+    ets_intr_lock();
+    ret = umm_malloc(size);
+    if (heap_trace_on) {
+        os_printf(trace_fmt_m, (uint32_t) ret, size);
+        heap_trace_site(file, line);
+    }
+    ets_intr_unlock();
+    return ret;
+}
+
+static void* heap_trace_calloc(size_t count, size_t size, const char* file, int line)
+{
+    void* ret;
+    ets_intr_lock();
+    ret = umm_calloc(count, size);
+    if (heap_trace_on) {
+        os_printf(trace_fmt_c, (uint32_t) ret, count * size);
+        heap_trace_site(file, line);
+    }
+    ets_intr_unlock();
+    return ret;
+}
+
+static void* heap_trace_realloc(void* ptr, size_t size, const char* file, int line)
+{
+    void* ret;
+    ets_intr_lock();
+    ret = umm_realloc(ptr, size);
+    if (heap_trace_on) {
+        os_printf(trace_fmt_r, (uint32_t) ret, (uint32_t) ptr, size);
+        heap_trace_site(file, line);
+    }
+    ets_intr_unlock();
+    return ret;
+}
+
+void free(void* ptr)
+{
+    ets_intr_lock();
+    if (heap_trace_on && ptr)
+        os_printf(trace_fmt_f, (uint32_t) ptr);
+    umm_free(ptr);
+    ets_intr_unlock();
+}
+
+#else
+
+void heap_trace_start(void)
+{
+}
+
+void heap_trace_stop(void)
+{
+}
+
+#endif // !defined(DEBUG_ESP_HEAP_TRACE)
+
 void* _malloc_r(struct _reent* unused, size_t size)
 {
     (void) unused;
-    void *ret = malloc(size);
+    void *ret = heap_malloc(size);
     if (0 != size && 0 == ret) {
         umm_last_fail_alloc_addr = __builtin_return_address(0);
         umm_last_fail_alloc_size = size;
@@ -32,7 +315,7 @@ void _free_r(struct _reent* unused, void* ptr)
 void* _realloc_r(struct _reent* unused, void* ptr, size_t size)
 {
     (void) unused;
-    void *ret = realloc(ptr, size);
+    void *ret = heap_realloc(ptr, size);
     if (0 != size && 0 == ret) {
         umm_last_fail_alloc_addr = __builtin_return_address(0);
         umm_last_fail_alloc_size = size;
@@ -43,7 +326,7 @@ void* _realloc_r(struct _reent* unused, void* ptr, size_t size)
 void* _calloc_r(struct _reent* unused, size_t count, size_t size)
 {
     (void) unused;
-    void *ret = calloc(count, size);
+    void *ret = heap_calloc(count, size);
     if (0 != (count * size) && 0 == ret) {
         umm_last_fail_alloc_addr = __builtin_return_address(0);
         umm_last_fail_alloc_size = count * size;
@@ -88,9 +371,23 @@ static const char oom_fmt[]   ICACHE_RODATA_ATTR STORE_ATTR = ":oom(%d)@?\n";
 static const char oom_fmt_1[] ICACHE_RODATA_ATTR STORE_ATTR = ":oom(%d)@";
 static const char oom_fmt_2[] ICACHE_RODATA_ATTR STORE_ATTR = ":%d\n";
 
+#ifdef DEBUG_ESP_HEAP_PROFILE
+#define oom_malloc(s, file, line)     heap_profile_malloc(s, file, line, __builtin_return_address(0))
+#define oom_calloc(n, s, file, line)  heap_profile_calloc(n, s, file, line, __builtin_return_address(0))
+#define oom_realloc(p, s, file, line) heap_profile_realloc(p, s, file, line, __builtin_return_address(0))
+#elif defined(DEBUG_ESP_HEAP_TRACE)
+#define oom_malloc(s, file, line)     heap_trace_malloc(s, file, line)
+#define oom_calloc(n, s, file, line)  heap_trace_calloc(n, s, file, line)
+#define oom_realloc(p, s, file, line) heap_trace_realloc(p, s, file, line)
+#else
+#define oom_malloc(s, file, line)     umm_malloc(s)
+#define oom_calloc(n, s, file, line)  umm_calloc(n, s)
+#define oom_realloc(p, s, file, line) umm_realloc(p, s)
+#endif
+
 void* malloc (size_t s)
 {
-    void* ret = umm_malloc(s);
+    void* ret = oom_malloc(s, NULL, 0);
     if (!ret)
         os_printf(oom_fmt, (int)s);
     return ret;
@@ -98,7 +395,7 @@ void* malloc (size_t s)
 
 void* calloc (size_t n, size_t s)
 {
-    void* ret = umm_calloc(n, s);
+    void* ret = oom_calloc(n, s, NULL, 0);
     if (!ret)
         os_printf(oom_fmt, (int)s);
     return ret;
@@ -106,7 +403,7 @@ void* calloc (size_t n, size_t s)
 
 void* realloc (void* p, size_t s)
 {
-    void* ret = umm_realloc(p, s);
+    void* ret = oom_realloc(p, s, NULL, 0);
     if (!ret)
         os_printf(oom_fmt, (int)s);
     return ret;
@@ -121,7 +418,7 @@ void print_loc (size_t s, const char* file, int line)
 
 void* malloc_loc (size_t s, const char* file, int line)
 {
-    void* ret = umm_malloc(s);
+    void* ret = oom_malloc(s, file, line);
     if (!ret)
         print_loc(s, file, line);
     return ret;
@@ -129,7 +426,7 @@ void* malloc_loc (size_t s, const char* file, int line)
 
 void* calloc_loc (size_t n, size_t s, const char* file, int line)
 {
-    void* ret = umm_calloc(n, s);
+    void* ret = oom_calloc(n, s, file, line);
     if (!ret)
         print_loc(s, file, line);
     return ret;
@@ -137,7 +434,7 @@ void* calloc_loc (size_t n, size_t s, const char* file, int line)
 
 void* realloc_loc (void* p, size_t s, const char* file, int line)
 {
-    void* ret = umm_realloc(p, s);
+    void* ret = oom_realloc(p, s, file, line);
     if (!ret)
         print_loc(s, file, line);
     return ret;
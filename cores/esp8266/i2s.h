@@ -34,13 +34,38 @@ the left and right channel) concatenated as (Rout<<16)+Lout
 i2s_write_sample will block when you're sending data too quickly, so you can just
 generate and push data as fast as you can and i2s_write_sample will regulate the
 speed.
+
+To feed whole blocks, call i2s_write_buffer() with frames of a left and a right
+int16_t each; it copies as many as fit into the DMA buffers at once. Instead of
+writing, i2s_set_refill_callback() can have the interrupt hand every buffer the
+DMA is done with to a function that fills it in place with i2s_get_buffer_length()
+samples; like the i2s_set_callback() one, it runs in the interrupt and must be in
+IRAM. i2s_set_buffers() changes how many buffers there are, and how long, before
+i2s_begin(): more or longer ones take more RAM and add latency, but let the sketch
+fall behind longer.
+
+To receive, from a MEMS microphone for example, start with i2s_rxtx_begin(true, false)
+(or true, true to also send). The ESP drives BCK (GPIO13) and WS (GPIO14) and reads
+data on GPIO12. The DMA fills the buffers in a ring; i2s_read_buffer() and
+i2s_read_sample() take the samples in the order they came. When the sketch doesn't
+read them in time the oldest buffer is dropped and counted by i2s_rx_overruns().
+
+For bit streams with exact timing, like the data of WS2812 LEDs, i2s_write_stream() has the
+DMA send a buffer of 32-bit words once, straight from RAM, and zeros after it; the CPU does
+nothing meanwhile and Wi-Fi can't make the timing jitter. The buffer must stay untouched until
+i2s_stream_busy() is false, or the callback ran (from the ISR, in IRAM). From then on the
+buffers of i2s_write_sample() and friends aren't sent anymore, until i2s_end().
+For WS2812s, call i2s_begin() and i2s_set_rate(I2S_WS2812_RATE), encode the GRB bytes of the
+pixels into i2s_ws2812_length(bytes) words with i2s_ws2812_encode(), connect the data in of
+the first LED to GPIO3 (RX) and send the words with i2s_write_stream().
 */
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void i2s_begin();
+void i2s_begin();//same as i2s_rxtx_begin(false, true)
+bool i2s_rxtx_begin(bool enableRx, bool enableTx);//false if there's no RAM for the buffers
 void i2s_end();
 void i2s_set_rate(uint32_t rate);//Sample Rate in Hz (ex 44100, 48000)
 void i2s_set_dividers(uint8_t div1, uint8_t div2);//Direct control over output rate
@@ -52,6 +77,22 @@ bool i2s_is_full();//returns true if DMA is full and can not take more bytes (ov
 bool i2s_is_empty();//returns true if DMA is empty (underflow)
 int16_t i2s_available();// returns the number of samples than can be written before blocking
 void i2s_set_callback(void (*callback) (void));
+size_t i2s_write_buffer(const int16_t *frames, size_t count, bool blocking);//writes count frames of left and right, returns how many fit (all if blocking)
+void i2s_set_refill_callback(void (*callback) (uint32_t *buffer, size_t length));//fill the buffer from the ISR instead of writing, NULL to write again
+bool i2s_set_buffers(size_t count, size_t length);//buffers (2 to 128) of length 32-bit samples (up to 1023) used by the next i2s_begin(), 8 of 64 by default
+size_t i2s_get_buffer_length();//32-bit samples in a buffer
+size_t i2s_read_buffer(int16_t *frames, size_t count, bool blocking);//reads count frames of left and right, returns how many there were (all if blocking)
+bool i2s_read_sample(int16_t *left, int16_t *right, bool blocking);//one frame, false if there's none and not blocking
+uint32_t i2s_rx_available();//samples that can be read without blocking
+void i2s_set_rx_callback(void (*callback) (void));//called from the ISR when a buffer was received
+uint32_t i2s_rx_overruns();//received buffers dropped because they weren't read in time
+uint32_t i2s_tx_underruns();//buffers the DMA gave back while all others were empty too
+bool i2s_write_stream(const uint32_t *words, size_t count, void (*callback) (void));//sends count words in RAM once, then zeros; false while the last one is still being sent
+bool i2s_stream_busy();//true until the DMA has sent the last stream
+
+#define I2S_WS2812_RATE 100000 //one 32-bit word is 8 WS2812 bits of 1.25us
+size_t i2s_ws2812_length(size_t bytes);//words i2s_ws2812_encode() writes for bytes of pixel data, with the reset after them
+void i2s_ws2812_encode(uint32_t *words, const uint8_t *bytes, size_t count);//turns bytes of pixel data into a stream for i2s_write_stream()
 
 #ifdef __cplusplus
 }
@@ -24,11 +24,39 @@
 #include <stdarg.h>
 #include "pgmspace.h"
 
+// Flash can only be read a 32 bit word at a time, so pgm_read_byte() loads
+// the word around the byte and shifts it out. The functions that go through
+// a lot of bytes load whole aligned words instead, and only the bytes before
+// the first and after the last of them one at a time.
+#define IS_ALIGNED(p)       ((((uintptr_t) (p)) & 3) == 0)
+
+// true if one of the bytes of w is 0
+static inline bool has_zero_byte(uint32_t w) {
+    return ((w - 0x01010101u) & ~w & 0x80808080u) != 0;
+}
+
+static inline void store_word(uint8_t* dest, uint32_t w) {
+    if (IS_ALIGNED(dest)) {
+        *reinterpret_cast<uint32_t*>(dest) = w;
+    } else {
+        dest[0] = w;
+        dest[1] = w >> 8;
+        dest[2] = w >> 16;
+        dest[3] = w >> 24;
+    }
+}
+
 extern "C" {
 
 size_t strnlen_P(PGM_P s, size_t size) {
-    const char* cp;
-    for (cp = s; size != 0 && pgm_read_byte(cp) != '\0'; cp++, size--);
+    const char* cp = s;
+    for (; size != 0 && !IS_ALIGNED(cp); cp++, size--) {
+        if (pgm_read_byte(cp) == '\0') {
+            return (size_t) (cp - s);
+        }
+    }
+    for (; size >= 4 && !has_zero_byte(pgm_read_dword(cp)); cp += 4, size -= 4);
+    for (; size != 0 && pgm_read_byte(cp) != '\0'; cp++, size--);
     return (size_t) (cp - s);
 }
 
@@ -63,6 +91,20 @@ void* memcpy_P(void* dest, PGM_VOID_P src, size_t count) {
     const uint8_t* read = reinterpret_cast<const uint8_t*>(src);
     uint8_t* write = reinterpret_cast<uint8_t*>(dest);
 
+    while (count && !IS_ALIGNED(read))
+    {
+        *write++ = pgm_read_byte(read++);
+        count--;
+    }
+
+    while (count >= 4)
+    {
+        store_word(write, pgm_read_dword(read));
+        read += 4;
+        write += 4;
+        count -= 4;
+    }
+
     while (count)
     {
         *write++ = pgm_read_byte(read++);
@@ -153,6 +195,28 @@ char* strncpy_P(char* dest, PGM_P src, size_t size) {
     const char* read = src;
     char* write = dest;
     char ch = '.';
+    while (size > 0 && ch != '\0' && !IS_ALIGNED(read))
+    {
+        ch = pgm_read_byte(read++);
+        *write++ = ch;
+        size--;
+    }
+    if (ch != '\0')
+    {
+        // whole words up to the one with the terminator
+        while (size >= 4)
+        {
+            uint32_t w = pgm_read_dword(read);
+            if (has_zero_byte(w))
+            {
+                break;
+            }
+            store_word(reinterpret_cast<uint8_t*>(write), w);
+            read += 4;
+            write += 4;
+            size -= 4;
+        }
+    }
     while (size > 0 && ch != '\0')
     {
         ch = pgm_read_byte(read++);
@@ -203,15 +267,21 @@ int strncmp_P(const char* str1, PGM_P str2P, size_t size) {
 
     while (size > 0)
     {
-        char ch1 = *str1++;
-        char ch2 = pgm_read_byte(str2P++);
-        result = ch1 - ch2;
-        if (result != 0 || ch2 == '\0')
+        // the rest of the word str2P is in, one load for all of it
+        uintptr_t offset = ((uintptr_t) str2P) & 3;
+        uint32_t w = pgm_read_dword(str2P - offset) >> (offset * 8);
+        for (size_t n = 4 - offset; n > 0 && size > 0; n--, size--)
         {
-            break;
+            char ch1 = *str1++;
+            char ch2 = (char) w;
+            w >>= 8;
+            str2P++;
+            result = ch1 - ch2;
+            if (result != 0 || ch2 == '\0')
+            {
+                return result;
+            }
         }
-
-        size--;
     }
 
     return result;
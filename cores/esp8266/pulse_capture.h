@@ -0,0 +1,61 @@
+/*
+  pulse_capture.h - pulse and frequency measurement from the GPIO interrupt
+
+  This file is part of the esp8266 core for Arduino environment.
+
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PULSE_CAPTURE_H
+#define PULSE_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// While a pin is captured, its GPIO interrupt keeps the cycle counter
+// value and the level of its last CAPTURE_EDGES edges, and the functions
+// below work them out without waiting, unlike pulseIn(). Any number of
+// pins from 0 to 15 can be captured at once; the interrupt of the pin is
+// taken as by attachInterrupt(). Times are limited by the cycle counter
+// to 53s at 80MHz and 26s at 160MHz.
+#define CAPTURE_EDGES 16
+
+bool capture_begin(uint8_t pin);
+void capture_end(uint8_t pin);
+
+// edges seen since capture_begin(), to tell when there are new ones
+uint32_t capture_count(uint8_t pin);
+
+// length of the last full pulse at state (HIGH or LOW), 0 if none yet
+uint32_t capture_pulse_us(uint8_t pin, uint8_t state);
+
+// rising edge to rising edge, averaged over the edges kept, or the time
+// since the last rising edge when that is longer, so that it grows when
+// the signal slows down or stops; 0 before the second rising edge
+uint32_t capture_period_us(uint8_t pin);
+
+// 1 / capture_period_us(), in Hz
+float capture_frequency(uint8_t pin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
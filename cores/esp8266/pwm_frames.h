@@ -0,0 +1,47 @@
+/*
+  pwm_frames.h - servo pulses on the timer of analogWrite()
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PWM_FRAMES_H
+#define PWM_FRAMES_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Every frame, 20ms unless changed, all the pins given a pulse go high
+// together and go low again after their own pulse width, all edges timed
+// on the CPU cycle counter from the timer1 NMI that analogWrite() uses on
+// other pins at the same time. This is what the Servo library sends.
+//
+// A new width is sent from the next frame on, and a width of 0 ends the
+// pulses of the pin after the current one, leaving it low.
+// pinMode(), digitalWrite() and analogWrite() on the pin end them at once.
+void pwm_frame_write(uint8_t pin, uint32_t pulse_us);
+
+// From 1000 to 100000 us
+void pwm_frame_set_period(uint32_t period_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+/*
+  pwm_waves.h - square waves on the timer of analogWrite()
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PWM_WAVES_H
+#define PWM_WAVES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Up to PWM_WAVES pins at a time, each with a period of its own: high for
+// high_ticks then low for low_ticks of the 80MHz timer clock, from 8us
+// (640 ticks) to 1s each. The edges are timed on the CPU cycle counter
+// from the timer1 NMI that analogWrite() and the servo frames use on other
+// pins at the same time, and don't drift: each is due a whole number of
+// ticks after the one before. This is what tone() plays.
+//
+// The pin stops low after periods periods, 0 for until pwm_wave_stop().
+// Starting the pin again changes its wave, the half period under way
+// ending as it was started.
+// pinMode(), digitalWrite() and analogWrite() on the pin stop it at once.
+// Returns false if PWM_WAVES other pins have a wave already.
+#define PWM_WAVES 8
+
+bool pwm_wave_start(uint8_t pin, uint32_t high_ticks, uint32_t low_ticks, uint32_t periods);
+
+// Stops the wave of the pin, leaving it low
+void pwm_wave_stop(uint8_t pin);
+
+// Whether the pin has a wave that has not stopped yet
+bool pwm_wave_running(uint8_t pin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
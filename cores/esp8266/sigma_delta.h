@@ -41,11 +41,24 @@ Usage :
      This will set the pin to NORMAL output mode (pinMode(pin,OUTPUT))
 3. sigmaDeltaWrite(0,dc) : set the output signal duty cycle, duty cycle = dc/256
 
+Playing sound, voice prompts for example, from unsigned 8 bit samples used as
+the duty: set up a high frequency first (sigmaDeltaSetup(0, 312500)), then
+sigmaDeltaPlayBegin(rate, size) plays samples at rate Hz from a ring of size
+(a power of 2) in RAM, from timer1, which Tone, analogWrite() and the async
+Wire are then not to use. sigmaDeltaPlayWrite() adds samples to it, or
+sigmaDeltaPlaySetRefill() has a function called from loop() to fill it,
+whenever it is half empty, with up to count samples; it returns how many it
+gave. When the ring runs empty the last duty is held. An RC low pass on the
+pin (1k and 47nF for 8 kHz) makes it an analog output.
+
 *******************************************************************************/
 
 #ifndef SIGMA_DELTA_H
 #define SIGMA_DELTA_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -64,6 +77,15 @@ bool        sigmaDeltaIsPinAttached(uint8_t pin);
 uint8_t     sigmaDeltaGetPrescaler(void);
 void        sigmaDeltaSetPrescaler(uint8_t prescaler);
 
+// sample playback, false if there is no RAM or size isn't a power of 2
+bool        sigmaDeltaPlayBegin(uint32_t rate, size_t size);
+void        sigmaDeltaPlayEnd(void);
+size_t      sigmaDeltaPlayWrite(const uint8_t* samples, size_t count); // copies as many as fit
+size_t      sigmaDeltaPlayAvailable(void);  // room in the ring
+size_t      sigmaDeltaPlayQueued(void);     // samples yet to play
+void        sigmaDeltaPlaySetRefill(size_t (*refill)(uint8_t* samples, size_t count, void* arg), void* arg);
+uint32_t    sigmaDeltaPlayUnderruns(void);  // times it ran empty
+
 
 #ifdef __cplusplus
 }
@@ -32,9 +32,7 @@
  * because it does not belong to lwip.
  *
  * TODOs:
- * settimeofday(): handle tv->tv_usec
  * sntp_mktm_r(): review, fix DST handling (this one is currently untouched from lwip-1.4)
- * implement adjtime()
  */
 
 #include <lwip/init.h>
@@ -83,10 +81,8 @@ int settimeofday(const struct timeval* tv, const struct timezone* tz)
 
 #include <lwip/apps/sntp.h>
 
-static uint32 realtime_stamp = 0;
 static uint16 dst = 0;
 static sint8 time_zone = 8; // espressif HQ's default timezone
-LOCAL os_timer_t sntp_timer;
 
 /*****************************************/
 #define SECSPERMIN	60L
@@ -398,7 +394,10 @@ char* sntp_asctime(struct tm *tim_p)
 
 uint32 ICACHE_RAM_ATTR sntp_get_current_timestamp(void)
 {
-    return realtime_stamp;
+    // local time, 0 until the time is known
+    if (!time_is_synced)
+        return 0;
+    return time_now_sec() + time_zone * 60 * 60 + dst;
 }
 
 char* sntp_get_real_time(time_t t)
@@ -426,19 +425,6 @@ void sntp_set_daylight(int daylight)
     dst = daylight;
 }
 
-void ICACHE_RAM_ATTR sntp_time_inc (void)
-{
-    realtime_stamp++;
-}
-
-static void sntp_set_system_time (uint32_t t)
-{
-    realtime_stamp = t + time_zone * 60 * 60 + dst;
-    os_timer_disarm(&sntp_timer);
-    os_timer_setfn(&sntp_timer, (os_timer_func_t *)sntp_time_inc, NULL);
-    os_timer_arm(&sntp_timer, 1000, 1);
-}
-
 int settimeofday(const struct timeval* tv, const struct timezone* tz)
 {
     if (tz) /*before*/
@@ -449,10 +435,8 @@ int settimeofday(const struct timeval* tv, const struct timezone* tz)
     }
     if (tv) /* after*/
     {
-        // reset time subsystem
-        tune_timeshift64(tv->tv_sec * 1000000ULL + tv->tv_usec);
-
-        sntp_set_system_time(tv->tv_sec);
+        // small corrections are slewed, see time.c
+        adjust_timeshift64(tv->tv_sec * 1000000ULL + tv->tv_usec);
 
         if (_settimeofday_cb)
             _settimeofday_cb();
@@ -21,10 +21,228 @@
  License along with this library; if not, write to the Free Software
  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
+#include <algorithm>
 #include "spiffs_api.h"
+extern "C" {
+#include "spiffs/spiffs_nucleus.h"
+}
 
 using namespace fs;
 
+bool SPIFFSImpl::gc(uint32_t budget_us)
+{
+    if (SPIFFS_mounted(&_fs) == 0) {
+        return false;
+    }
+    unsigned long start = micros();
+    while (_fs.free_blocks < _gcFreeBlocks) {
+        if (micros() - start >= budget_us) {
+            return false;
+        }
+        // a block holding nothing but deleted pages only needs the erase
+        if (SPIFFS_gc_quick(&_fs, 0) == SPIFFS_OK) {
+            continue;
+        }
+        if (_fs.stats_p_deleted == 0) {
+            // nothing to win
+            return false;
+        }
+        // Asking for one page more than is free makes the collector move
+        // out the live pages of one block and erase it, and stop there.
+        s32_t freePages = (SPIFFS_PAGES_PER_BLOCK(&_fs) - SPIFFS_OBJ_LOOKUP_PAGES(&_fs)) * (_fs.block_count - 2)
+                          - _fs.stats_p_allocated - _fs.stats_p_deleted;
+        auto rc = SPIFFS_gc(&_fs, (freePages + 1) * SPIFFS_DATA_PAGE_SIZE(&_fs));
+        if (rc != SPIFFS_OK) {
+            DEBUGV("SPIFFS_gc: rc=%d, err=%d\r\n", rc, _fs.err_code);
+            return false;
+        }
+    }
+    return true;
+}
+
+const uint8_t* SPIFFSFileImpl::mapped(size_t& size)
+{
+    CHECKFD();
+
+    size = 0;
+    spiffs* fs = _fs->getFs();
+    // what is still buffered or in the write cache isn't in flash yet
+    _flushBuffer();
+    SPIFFS_fflush(fs, _fd);
+    spiffs_fd* fd;
+    if (spiffs_fd_get(fs, SPIFFS_FH_UNOFFS(fs, _fd), &fd) != SPIFFS_OK) {
+        return nullptr;
+    }
+    size_t length = this->size();
+    size_t offset = position();
+    if (offset >= length) {
+        return nullptr;
+    }
+    spiffs_span_ix spix = offset / SPIFFS_DATA_PAGE_SIZE(fs);
+    spiffs_page_ix pix = 0;
+    if (_mapped && spix >= _ixMap.start_spix && spix <= _ixMap.end_spix) {
+        pix = _ixMap.map_buf[spix - _ixMap.start_spix];
+    }
+    if (pix == 0 && _lastPix && spix == _lastSpix + 1) {
+        // written in one go, the next piece is usually in the next page
+        spiffs_page_ix next = _lastPix + 1;
+        spiffs_page_header ph;
+        if (next % SPIFFS_PAGES_PER_BLOCK(fs) >= SPIFFS_OBJ_LOOKUP_PAGES(fs) &&
+                next < SPIFFS_MAX_PAGES(fs) &&
+                spiffs_hal_read(SPIFFS_PAGE_TO_PADDR(fs, next), sizeof(ph), (uint8_t*) &ph) == SPIFFS_OK &&
+                ph.obj_id == (fd->obj_id & ~SPIFFS_OBJ_ID_IX_FLAG) && ph.span_ix == spix &&
+                (ph.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_INDEX | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_USED)) ==
+                (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_INDEX)) {
+            pix = next;
+        }
+    }
+    if (pix == 0) {
+        auto rc = spiffs_obj_lu_find_id_and_span(fs, fd->obj_id & ~SPIFFS_OBJ_ID_IX_FLAG, spix, 0, &pix);
+        if (rc != SPIFFS_OK) {
+            DEBUGV("SPIFFSFileImpl::mapped: rc=%d\r\n", rc);
+            return nullptr;
+        }
+    }
+    _lastSpix = spix;
+    _lastPix = pix;
+    uint32_t inPage = offset % SPIFFS_DATA_PAGE_SIZE(fs);
+    uint32_t addr = SPIFFS_PAGE_TO_PADDR(fs, pix) + sizeof(spiffs_page_header) + inPage;
+    size_t count = std::min<size_t>(SPIFFS_DATA_PAGE_SIZE(fs) - inPage, length - offset);
+#ifdef ARDUINO
+    // the cache maps the first megabyte of the flash
+    if (addr + count > 0x100000) {
+        return nullptr;
+    }
+    size = count;
+    return (const uint8_t*) (0x40200000 + addr);
+#else
+    (void) addr;
+    (void) count;
+    return nullptr;
+#endif
+}
+
+static uint32_t nameHash(const char* name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint8_t) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool isIndexHeader(spiffs* fs, spiffs_page_ix pix, spiffs_obj_id id, const char* name)
+{
+    spiffs_page_object_ix_header hdr;
+    if (_spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ, 0, SPIFFS_PAGE_TO_PADDR(fs, pix),
+                   sizeof(hdr), (u8_t*) &hdr) != SPIFFS_OK) {
+        return false;
+    }
+    return hdr.p_hdr.obj_id == (id | SPIFFS_OBJ_ID_IX_FLAG) && hdr.p_hdr.span_ix == 0 &&
+           (hdr.p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE)) ==
+           (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE) &&
+           strcmp((const char*) hdr.name, name) == 0;
+}
+
+void SPIFFSImpl::_indexBuild()
+{
+    _indexClear();
+    spiffs_DIR dir;
+    if (!SPIFFS_opendir(&_fs, "", &dir)) {
+        return;
+    }
+    spiffs_dirent entry;
+    while (SPIFFS_readdir(&dir, &entry)) {
+        _index.push_back({nameHash((const char*) entry.name),
+                          (spiffs_obj_id) (entry.obj_id & ~SPIFFS_OBJ_ID_IX_FLAG), entry.pix});
+    }
+    SPIFFS_closedir(&dir);
+    std::sort(_index.begin(), _index.end(), [](const IndexEntry& a, const IndexEntry& b) {
+        return a.hash < b.hash;
+    });
+    _indexValid = true;
+}
+
+bool SPIFFSImpl::_indexFind(const char* path, spiffs_page_ix& pix)
+{
+    uint32_t hash = nameHash(path);
+    auto it = std::lower_bound(_index.begin(), _index.end(), hash, [](const IndexEntry& e, uint32_t h) {
+        return e.hash < h;
+    });
+    for (; it != _index.end() && it->hash == hash; ++it) {
+        if (!isIndexHeader(&_fs, it->pix, it->id, path)) {
+            // moved since, find it by its id
+            spiffs_page_ix moved;
+            if (spiffs_obj_lu_find_id_and_span(&_fs, it->id | SPIFFS_OBJ_ID_IX_FLAG, 0, 0, &moved) != SPIFFS_OK ||
+                    !isIndexHeader(&_fs, moved, it->id, path)) {
+                continue;
+            }
+            it->pix = moved;
+        }
+        pix = it->pix;
+        return true;
+    }
+    return false;
+}
+
+void SPIFFSImpl::_indexAdd(const char* path, spiffs_obj_id id, spiffs_page_ix pix)
+{
+    if (!_indexValid) {
+        return;
+    }
+    IndexEntry entry = {nameHash(path), (spiffs_obj_id) (id & ~SPIFFS_OBJ_ID_IX_FLAG), pix};
+    auto it = std::upper_bound(_index.begin(), _index.end(), entry, [](const IndexEntry& a, const IndexEntry& b) {
+        return a.hash < b.hash;
+    });
+    _index.insert(it, entry);
+}
+
+void SPIFFSImpl::_indexRemove(const char* path)
+{
+    if (!_indexValid) {
+        return;
+    }
+    // the name is gone from the flash: drop the entries under its hash
+    // whose object can't be found any more
+    uint32_t hash = nameHash(path);
+    auto it = std::lower_bound(_index.begin(), _index.end(), hash, [](const IndexEntry& e, uint32_t h) {
+        return e.hash < h;
+    });
+    while (it != _index.end() && it->hash == hash) {
+        spiffs_page_ix pix;
+        if (spiffs_obj_lu_find_id_and_span(&_fs, it->id | SPIFFS_OBJ_ID_IX_FLAG, 0, 0, &pix) != SPIFFS_OK) {
+            it = _index.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SPIFFSImpl::_indexRename(const char* pathFrom, const char* pathTo)
+{
+    if (!_indexValid) {
+        return;
+    }
+    // the object keeps its id, only the name in its index header changes
+    uint32_t hash = nameHash(pathFrom);
+    auto it = std::lower_bound(_index.begin(), _index.end(), hash, [](const IndexEntry& e, uint32_t h) {
+        return e.hash < h;
+    });
+    for (; it != _index.end() && it->hash == hash; ++it) {
+        spiffs_page_ix pix;
+        if (spiffs_obj_lu_find_id_and_span(&_fs, it->id | SPIFFS_OBJ_ID_IX_FLAG, 0, 0, &pix) == SPIFFS_OK &&
+                isIndexHeader(&_fs, pix, it->id, pathTo)) {
+            spiffs_obj_id id = it->id;
+            _index.erase(it);
+            _indexAdd(pathTo, id, pix);
+            return;
+        }
+    }
+    _indexBuild();
+}
+
 FileImplPtr SPIFFSImpl::open(const char* path, OpenMode openMode, AccessMode accessMode)
 {
     if (!isSpiffsFilenameValid(path)) {
@@ -32,6 +250,20 @@ FileImplPtr SPIFFSImpl::open(const char* path, OpenMode openMode, AccessMode acc
         return FileImplPtr();
     }
     int mode = getSpiffsMode(openMode, accessMode);
+    if (!_writeCache) {
+        mode |= SPIFFS_O_DIRECT;
+    }
+    if (_indexValid) {
+        spiffs_page_ix pix;
+        if (_indexFind(path, pix)) {
+            int fd = SPIFFS_open_by_page(&_fs, pix, mode, 0);
+            if (fd >= 0) {
+                return std::make_shared<SPIFFSFileImpl>(this, fd);
+            }
+        } else if (!(openMode & OM_CREATE)) {
+            return FileImplPtr();
+        }
+    }
     int fd = SPIFFS_open(&_fs, path, mode, 0);
     if (fd < 0 && _fs.err_code == SPIFFS_ERR_DELETED && (openMode & OM_CREATE)) {
         DEBUGV("SPIFFSImpl::open: fd=%d path=`%s` openMode=%d accessMode=%d err=%d, trying to remove\r\n",
@@ -49,6 +281,13 @@ FileImplPtr SPIFFSImpl::open(const char* path, OpenMode openMode, AccessMode acc
                fd, path, openMode, accessMode, _fs.err_code);
         return FileImplPtr();
     }
+    if (_indexValid && (openMode & OM_CREATE)) {
+        spiffs_page_ix pix;
+        spiffs_stat stat;
+        if (!_indexFind(path, pix) && SPIFFS_fstat(&_fs, fd, &stat) == SPIFFS_OK) {
+            _indexAdd(path, stat.obj_id, stat.pix);
+        }
+    }
     return std::make_shared<SPIFFSFileImpl>(this, fd);
 }
 
@@ -58,6 +297,10 @@ bool SPIFFSImpl::exists(const char* path)
         DEBUGV("SPIFFSImpl::exists: invalid path=`%s` \r\n", path);
         return false;
     }
+    if (_indexValid) {
+        spiffs_page_ix pix;
+        return _indexFind(path, pix);
+    }
     spiffs_stat stat;
     int rc = SPIFFS_stat(&_fs, path, &stat);
     return rc == SPIFFS_OK;
@@ -125,12 +368,17 @@ extern "C" uint32_t _SPIFFS_block;
 #endif
 
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_SPIFFS)
-FS SPIFFS = FS(FSImplPtr(new SPIFFSImpl(
-                             SPIFFS_PHYS_ADDR,
-                             SPIFFS_PHYS_SIZE,
-                             SPIFFS_PHYS_PAGE,
-                             SPIFFS_PHYS_BLOCK,
-                             SPIFFS_MAX_OPEN_FILES)));
+static FSImplPtr makeSPIFFS()
+{
+    return FSImplPtr(new SPIFFSImpl(
+                         SPIFFS_PHYS_ADDR,
+                         SPIFFS_PHYS_SIZE,
+                         SPIFFS_PHYS_PAGE,
+                         SPIFFS_PHYS_BLOCK,
+                         SPIFFS_MAX_OPEN_FILES));
+}
+
+FS SPIFFS = FS(makeSPIFFS);
 #endif
 
 #endif
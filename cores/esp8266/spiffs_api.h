@@ -25,6 +25,8 @@
  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include <limits>
+#include <new>
+#include <vector>
 #include "FS.h"
 #undef max
 #undef min
@@ -78,6 +80,7 @@ public:
                    pathFrom, pathTo);
             return false;
         }
+        _indexRename(pathFrom, pathTo);
         return true;
     }
     bool info(FSInfo& info) override
@@ -98,6 +101,50 @@ public:
         return true;
     }
 
+    bool setConfig(const FSConfig& config) override
+    {
+        if (SPIFFS_mounted(&_fs) != 0) {
+            DEBUGV("SPIFFSImpl::setConfig: mounted\r\n");
+            return false;
+        }
+        size_t cachePages = config.cachePages;
+        if (cachePages > 32) {
+            // the cache keeps its pages in a 32 bit map
+            cachePages = 32;
+        }
+        if (cachePages != _cachePages) {
+            // taken again by the next begin()
+            _cacheBuf.reset();
+        }
+        _cachePages = cachePages;
+        _writeCache = config.writeCache;
+        _gcFreeBlocks = config.gcFreeBlocks;
+        _nameIndex = config.nameIndex;
+        return true;
+    }
+
+    bool stats(FSStats& stats) override
+    {
+        if (SPIFFS_mounted(&_fs) == 0) {
+            return false;
+        }
+        stats.cacheHits = _fs.cache_hits;
+        stats.cacheMisses = _fs.cache_misses;
+        stats.cacheEvictions = _fs.cache_evictions;
+        stats.cachePages = _cachePagesUsed();
+        stats.cacheBytes = _fs.cache_size;
+        return true;
+    }
+
+    bool gc(uint32_t budget_us) override;
+
+    void resetStats() override
+    {
+        _fs.cache_hits = 0;
+        _fs.cache_misses = 0;
+        _fs.cache_evictions = 0;
+    }
+
     bool remove(const char* path) override
     {
         if (!isSpiffsFilenameValid(path)) {
@@ -109,6 +156,7 @@ public:
             DEBUGV("SPIFFS_remove: rc=%d path=`%s`\r\n", rc, path);
             return false;
         }
+        _indexRemove(path);
         return true;
     }
 
@@ -138,6 +186,7 @@ public:
             return;
         }
         SPIFFS_unmount(&_fs);
+        _indexClear();
     }
 
     bool format() override
@@ -152,6 +201,7 @@ public:
         if (_tryMount()) {
             SPIFFS_unmount(&_fs);
         }
+        _indexClear();
         auto rc = SPIFFS_format(&_fs);
         if (rc != SPIFFS_OK) {
             DEBUGV("SPIFFS_format: rc=%d, err=%d\r\n", rc, _fs.err_code);
@@ -217,14 +267,16 @@ protected:
 
         size_t workBufSize = 2 * _pageSize;
         size_t fdsBufSize = SPIFFS_buffer_bytes_for_filedescs(&_fs, _maxOpenFds);
-        size_t cacheBufSize = SPIFFS_buffer_bytes_for_cache(&_fs, _maxOpenFds);
+        size_t cacheBufSize = SPIFFS_buffer_bytes_for_cache(&_fs, _cachePagesUsed());
 
         if (!_workBuf) {
-            DEBUGV("SPIFFSImpl: allocating %d+%d+%d=%d bytes\r\n",
-                   workBufSize, fdsBufSize, cacheBufSize,
-                   workBufSize + fdsBufSize + cacheBufSize);
+            DEBUGV("SPIFFSImpl: allocating %d+%d=%d bytes\r\n",
+                   workBufSize, fdsBufSize, workBufSize + fdsBufSize);
             _workBuf.reset(new uint8_t[workBufSize]);
             _fdsBuf.reset(new uint8_t[fdsBufSize]);
+        }
+        if (!_cacheBuf) {
+            DEBUGV("SPIFFSImpl: allocating %d bytes of cache\r\n", cacheBufSize);
             _cacheBuf.reset(new uint8_t[cacheBufSize]);
         }
 
@@ -237,9 +289,36 @@ protected:
 
         DEBUGV("SPIFFSImpl: mount rc=%d\r\n", err);
 
+        if (err == SPIFFS_OK && _nameIndex) {
+            _indexBuild();
+        }
         return err == SPIFFS_OK;
     }
 
+    // Names hashed to where the file is, sorted by hash. The page is only a
+    // hint as files move when written; the object id is what stays.
+    struct IndexEntry {
+        uint32_t hash;
+        spiffs_obj_id id;
+        spiffs_page_ix pix;
+    };
+
+    void _indexBuild();
+    void _indexClear()
+    {
+        std::vector<IndexEntry>().swap(_index);
+        _indexValid = false;
+    }
+    bool _indexFind(const char* path, spiffs_page_ix& pix);
+    void _indexAdd(const char* path, spiffs_obj_id id, spiffs_page_ix pix);
+    void _indexRemove(const char* path);
+    void _indexRename(const char* pathFrom, const char* pathTo);
+
+    size_t _cachePagesUsed() const
+    {
+        return _cachePages ? _cachePages : _maxOpenFds;
+    }
+
     static void _check_cb(spiffs_check_type type, spiffs_check_report report,
                           uint32_t arg1, uint32_t arg2)
     {
@@ -260,6 +339,12 @@ protected:
     uint32_t _pageSize;
     uint32_t _blockSize;
     uint32_t _maxOpenFds;
+    size_t _cachePages = 0;
+    bool _writeCache = true;
+    size_t _gcFreeBlocks = 4;
+    bool _nameIndex = false;
+    bool _indexValid = false;
+    std::vector<IndexEntry> _index;
 
     std::unique_ptr<uint8_t[]> _workBuf;
     std::unique_ptr<uint8_t[]> _fdsBuf;
@@ -289,6 +374,23 @@ public:
     {
         CHECKFD();
 
+        if (_buf) {
+            if (!_bufDirty || _bufLen + size > _bufSize) {
+                // drop what was read ahead, write out what is pending
+                if (!_flushBuffer()) {
+                    return 0;
+                }
+            }
+            if (size < _bufSize) {
+                if (_bufLen == 0) {
+                    _bufStart = SPIFFS_lseek(_fs->getFs(), _fd, 0, SPIFFS_SEEK_CUR);
+                }
+                memcpy(_buf.get() + _bufLen, buf, size);
+                _bufLen += size;
+                _bufDirty = true;
+                return size;
+            }
+        }
         auto result = SPIFFS_write(_fs->getFs(), _fd, (void*) buf, size);
         if (result < 0) {
             DEBUGV("SPIFFS_write rc=%d\r\n", result);
@@ -301,6 +403,9 @@ public:
     size_t read(uint8_t* buf, size_t size) override
     {
         CHECKFD();
+        if (_buf) {
+            return _readBuffered(buf, size);
+        }
         auto result = SPIFFS_read(_fs->getFs(), _fd, (void*) buf, size);
         if (result < 0) {
             DEBUGV("SPIFFS_read rc=%d\r\n", result);
@@ -314,6 +419,7 @@ public:
     {
         CHECKFD();
 
+        _flushBuffer();
         auto rc = SPIFFS_fflush(_fs->getFs(), _fd);
         if (rc < 0) {
             DEBUGV("SPIFFS_fflush rc=%d\r\n", rc);
@@ -326,6 +432,17 @@ public:
         CHECKFD();
 
         int32_t offset = static_cast<int32_t>(pos);
+        if (_bufLen && !_bufDirty && mode != SeekEnd) {
+            // still in what was read ahead?
+            int64_t to = (mode == SeekSet) ? offset : (int64_t) _bufStart + _bufOff + offset;
+            if (to >= _bufStart && to <= (int64_t) (_bufStart + _bufLen)) {
+                _bufOff = to - _bufStart;
+                return true;
+            }
+        }
+        if (!_flushBuffer()) {
+            return false;
+        }
         if (mode == SeekEnd) {
             offset = -offset;
         }
@@ -342,6 +459,9 @@ public:
     {
         CHECKFD();
 
+        if (_bufLen) {
+            return _bufStart + (_bufDirty ? _bufLen : _bufOff);
+        }
         auto result = SPIFFS_lseek(_fs->getFs(), _fd, 0, SPIFFS_SEEK_CUR);
         if (result < 0) {
             DEBUGV("SPIFFS_tell rc=%d\r\n", result);
@@ -357,6 +477,9 @@ public:
         if (_written) {
             _getStat();
         }
+        if (_bufDirty && _bufStart + _bufLen > _stat.size) {
+            return _bufStart + _bufLen;
+        }
         return _stat.size;
     }
 
@@ -364,7 +487,12 @@ public:
     {
         CHECKFD();
 
+        _flushBuffer();
+        _buf.reset();
+        _bufSize = 0;
+        // unmaps the index too
         SPIFFS_close(_fs->getFs(), _fd);
+        _mapped = false;
         DEBUGV("SPIFFS_close: fd=%d\r\n", _fd);
     }
 
@@ -375,7 +503,159 @@ public:
         return (const char*) _stat.name;
     }
 
+    bool mapIndex(void* buffer, size_t size) override
+    {
+        CHECKFD();
+
+        unmapIndex();
+        spiffs* fs = _fs->getFs();
+        size_t length = this->size();
+        if (length == 0) {
+            return false;
+        }
+        if (buffer) {
+            size_t mapped = SPIFFS_ix_map_entries_to_bytes(fs, size / sizeof(spiffs_page_ix));
+            if (mapped < length) {
+                length = mapped;
+            }
+        } else {
+            _ixBuf.reset(new spiffs_page_ix[SPIFFS_bytes_to_ix_map_entries(fs, length)]);
+            buffer = _ixBuf.get();
+        }
+        auto rc = SPIFFS_ix_map(fs, _fd, &_ixMap, 0, length, (spiffs_page_ix*) buffer);
+        if (rc != SPIFFS_OK) {
+            DEBUGV("SPIFFS_ix_map rc=%d\r\n", rc);
+            _ixBuf.reset();
+            return false;
+        }
+        _mapped = true;
+        return true;
+    }
+
+    void unmapIndex() override
+    {
+        CHECKFD();
+
+        if (_mapped) {
+            SPIFFS_ix_unmap(_fs->getFs(), _fd);
+            _mapped = false;
+        }
+        _ixBuf.reset();
+    }
+
+    const uint8_t* mapped(size_t& size) override;
+
+    bool setBufferSize(size_t size) override
+    {
+        CHECKFD();
+
+        if (!_flushBuffer()) {
+            return false;
+        }
+        if (size == 0) {
+            _buf.reset();
+        } else if (size != _bufSize) {
+            _buf.reset(new (std::nothrow) uint8_t[size]);
+            if (!_buf) {
+                _bufSize = 0;
+                return false;
+            }
+        }
+        _bufSize = size;
+        return true;
+    }
+
+    const uint8_t* peekBuffer(size_t& size) override
+    {
+        CHECKFD();
+
+        size = 0;
+        if (!_buf || (_bufDirty && !_flushBuffer())) {
+            return nullptr;
+        }
+        if (_bufOff == _bufLen) {
+            _fillBuffer();
+        }
+        size = _bufLen - _bufOff;
+        return _buf.get() + _bufOff;
+    }
+
+    void peekConsume(size_t size) override
+    {
+        if (size > _bufLen - _bufOff) {
+            size = _bufLen - _bufOff;
+        }
+        _bufOff += size;
+    }
+
 protected:
+    size_t _readBuffered(uint8_t* buf, size_t size)
+    {
+        if (_bufDirty && !_flushBuffer()) {
+            return 0;
+        }
+        size_t done = (size < _bufLen - _bufOff) ? size : _bufLen - _bufOff;
+        memcpy(buf, _buf.get() + _bufOff, done);
+        _bufOff += done;
+        if (done == size) {
+            return done;
+        }
+        // the buffer is used up, the file is at its end
+        spiffs* fs = _fs->getFs();
+        _bufLen = 0;
+        _bufOff = 0;
+        if (size - done >= _bufSize) {
+            auto result = SPIFFS_read(fs, _fd, (void*) (buf + done), size - done);
+            return (result > 0) ? done + result : done;
+        }
+        if (!_fillBuffer()) {
+            return done;
+        }
+        _bufOff = (size - done < _bufLen) ? size - done : _bufLen;
+        memcpy(buf + done, _buf.get(), _bufOff);
+        return done + _bufOff;
+    }
+
+    // reads the next buffer full, the current one being used up
+    bool _fillBuffer()
+    {
+        spiffs* fs = _fs->getFs();
+        _bufLen = 0;
+        _bufOff = 0;
+        _bufStart = SPIFFS_lseek(fs, _fd, 0, SPIFFS_SEEK_CUR);
+        auto result = SPIFFS_read(fs, _fd, (void*) _buf.get(), _bufSize);
+        if (result <= 0) {
+            // SPIFFS_ERR_END_OF_OBJECT once there is nothing left
+            return false;
+        }
+        _bufLen = result;
+        return true;
+    }
+
+    // writes out pending data or puts the file back where the reader is
+    bool _flushBuffer()
+    {
+        if (_bufLen == 0) {
+            return true;
+        }
+        bool ok = true;
+        spiffs* fs = _fs->getFs();
+        if (_bufDirty) {
+            auto result = SPIFFS_write(fs, _fd, (void*) _buf.get(), _bufLen);
+            if (result < (int32_t) _bufLen) {
+                DEBUGV("SPIFFS_write rc=%d\r\n", result);
+                ok = false;
+            }
+            _written = true;
+        } else if (_bufOff < _bufLen) {
+            SPIFFS_lseek(fs, _fd, _bufStart + _bufOff, SPIFFS_SEEK_SET);
+        }
+        _bufLen = 0;
+        _bufOff = 0;
+        _bufDirty = false;
+        return ok;
+    }
+
     void _getStat() const
     {
         CHECKFD();
@@ -391,6 +671,17 @@ protected:
     spiffs_file _fd;
     mutable spiffs_stat _stat;
     mutable bool        _written;
+    bool                _mapped = false;
+    spiffs_ix_map       _ixMap;
+    std::unique_ptr<spiffs_page_ix[]> _ixBuf;
+    spiffs_span_ix      _lastSpix = 0;
+    spiffs_page_ix      _lastPix = 0;
+    std::unique_ptr<uint8_t[]> _buf;
+    size_t              _bufSize = 0;
+    uint32_t            _bufStart = 0;
+    size_t              _bufLen = 0;
+    size_t              _bufOff = 0;
+    bool                _bufDirty = false;
 };
 
 class SPIFFSDirImpl : public DirImpl
@@ -27,6 +27,7 @@
 extern "C" {
 #include "c_types.h"
 #include "spi_flash.h"
+#include "FlashQueue.h"
 }
 /*
  spi_flash_read function requires flash address to be aligned on word boundary.
@@ -42,8 +43,8 @@ alignedBegin:            ^
 alignedEnd:                      ^
 */
 
-int32_t spiffs_hal_read(uint32_t addr, uint32_t size, uint8_t *dst) {
-    optimistic_yield(10000);
+static int32_t spiffs_hal_read_flash(uint32_t addr, uint32_t size, uint8_t *dst) {
+    yield_budget(YIELD_OP_FLASH);
 
     uint32_t result = SPIFFS_OK;
     uint32_t alignedBegin = (addr + 3) & (~3);
@@ -87,6 +88,46 @@ int32_t spiffs_hal_read(uint32_t addr, uint32_t size, uint8_t *dst) {
     return result;
 }
 
+/*
+ SPIFFS reads object headers and index entries a few bytes at a time, mostly
+ next to each other. Reads smaller than a line are served from the last line
+ read, which is filled with a single aligned flash read, so a run of them
+ costs one trip to the flash instead of up to three each. Larger reads go to
+ the flash directly. Writes and erases drop the line when they touch it.
+*/
+
+static const uint32_t READ_LINE_SIZE = 64;
+
+static uint32_t s_line[READ_LINE_SIZE / 4];
+static uint32_t s_line_addr = 0;
+static bool s_line_valid = false;
+
+static void spiffs_hal_drop_line(uint32_t addr, uint32_t size) {
+    if (s_line_valid && addr < s_line_addr + READ_LINE_SIZE && addr + size > s_line_addr) {
+        s_line_valid = false;
+    }
+}
+
+int32_t spiffs_hal_read(uint32_t addr, uint32_t size, uint8_t *dst) {
+    if (size > READ_LINE_SIZE - 4) {
+        return spiffs_hal_read_flash(addr, size, dst);
+    }
+    if (!s_line_valid || addr < s_line_addr || addr + size > s_line_addr + READ_LINE_SIZE) {
+        yield_budget(YIELD_OP_FLASH);
+        uint32_t lineAddr = addr & (~3);
+        if (!ESP.flashRead(lineAddr, s_line, READ_LINE_SIZE)) {
+            DEBUGV("_spif_read(%d) addr=%x size=%x line=%x\r\n",
+                __LINE__, addr, size, lineAddr);
+            s_line_valid = false;
+            return SPIFFS_ERR_INTERNAL;
+        }
+        s_line_addr = lineAddr;
+        s_line_valid = true;
+    }
+    memcpy(dst, ((uint8_t*) s_line) + addr - s_line_addr, size);
+    return SPIFFS_OK;
+}
+
 /*
  Like spi_flash_read, spi_flash_write has a requirement for flash address to be
  aligned. However it also requires RAM address to be aligned as it reads data
@@ -100,7 +141,8 @@ int32_t spiffs_hal_read(uint32_t addr, uint32_t size, uint8_t *dst) {
 static const int UNALIGNED_WRITE_BUFFER_SIZE = 512;
 
 int32_t spiffs_hal_write(uint32_t addr, uint32_t size, uint8_t *src) {
-    optimistic_yield(10000);
+    yield_budget(YIELD_OP_FLASH);
+    spiffs_hal_drop_line(addr, size);
 
     uint32_t alignedBegin = (addr + 3) & (~3);
     uint32_t alignedEnd = (addr + size) & (~3);
@@ -171,14 +213,11 @@ int32_t spiffs_hal_erase(uint32_t addr, uint32_t size) {
         DEBUGV("_spif_erase called with addr=%x, size=%d\r\n", addr, size);
         abort();
     }
-    const uint32_t sector = addr / SPI_FLASH_SEC_SIZE;
-    const uint32_t sectorCount = size / SPI_FLASH_SEC_SIZE;
-    for (uint32_t i = 0; i < sectorCount; ++i) {
-        optimistic_yield(10000);
-        if (!ESP.flashEraseSector(sector + i)) {
-            DEBUGV("_spif_erase addr=%x size=%d i=%d\r\n", addr, size, i);
-            return SPIFFS_ERR_INTERNAL;
-        }
+    spiffs_hal_drop_line(addr, size);
+    // a sector at a time, yielding in between
+    if (!flash_queue_erase_now(addr / SPI_FLASH_SEC_SIZE, size / SPI_FLASH_SEC_SIZE)) {
+        DEBUGV("_spif_erase addr=%x size=%d\r\n", addr, size);
+        return SPIFFS_ERR_INTERNAL;
     }
     return SPIFFS_OK;
 }
@@ -22,6 +22,9 @@
 #ifndef STDLIB_NONISO_H
 #define STDLIB_NONISO_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -42,6 +45,17 @@ char* ultoa (unsigned long val, char *s, int radix);
  
 char* dtostrf (double val, signed char width, unsigned char prec, char *s);
 
+// Digits of val in radix (2 to 36, letters in upper case or not) written
+// backwards ending just before end; returns where they start. Needs up to
+// 64 chars, 20 in base 10.
+char* ulltoa_end (unsigned long long val, char *end, int radix, bool upper);
+
+// val with prec decimals, rounded as printf("%.*f") does, into s: needs
+// up to 24 + prec chars. Returns the length, 0 if val is not finite, has
+// 2^64 or more as its integer part, or is below 2^-75 with more than 22
+// decimals.
+size_t dtoa_fixed (double val, unsigned char prec, char *s);
+
 void reverse(char* begin, char* end);
 
 #ifdef __cplusplus
@@ -19,6 +19,9 @@
 #include <time.h>
 #include <sys/time.h>
 #include <sys/reent.h>
+#include <stdlib.h>
+#include <c_types.h>
+#include <user_interface.h>
 #include "sntp.h"
 #include "coredecls.h"
 
@@ -37,13 +40,197 @@ extern uint64_t micros64();
 // time gap in seconds from 01.01.1900 (NTP time) to 01.01.1970 (UNIX time)
 #define DIFF1900TO1970 2208988800UL
 
+// Corrections smaller than this to a clock already set are slewed, at
+// TIME_SLEW_PPM: the clock runs that much faster or slower until it is
+// right, without jumping back or skipping seconds.
+#ifndef TIME_SLEW_MAX_US
+#define TIME_SLEW_MAX_US 1000000
+#endif
+#ifndef TIME_SLEW_PPM
+#define TIME_SLEW_PPM 500
+#endif
+
 bool timeshift64_is_set = false;
+bool time_is_synced = false;
 static uint64_t timeshift64 = 0;
+static int64_t s_slew_us = 0;          // still to slew, from s_slew_start
+static uint64_t s_slew_start = 0;      // micros64()
+static uint64_t s_second_end = 0;      // micros64() when time_now_sec() changes
+static uint32_t s_second = 0;
+
+static void rtc_time_save(uint64_t now_us);
+
+// what of the slew is done at micros64() m; folded into timeshift64 when
+// it is all done
+static int64_t ICACHE_RAM_ATTR slewed(uint64_t m)
+{
+    if (!s_slew_us) {
+        return 0;
+    }
+    uint64_t done = (m - s_slew_start) * TIME_SLEW_PPM / 1000000;
+    uint64_t total = (s_slew_us < 0) ? -s_slew_us : s_slew_us;
+    if (done >= total) {
+        timeshift64 += s_slew_us;
+        s_slew_us = 0;
+        return 0;
+    }
+    return (s_slew_us < 0) ? -(int64_t) done : (int64_t) done;
+}
+
+uint64_t ICACHE_RAM_ATTR time_now_us(void)
+{
+    uint64_t m = micros64();
+    return timeshift64 + m + slewed(m);
+}
+
+// the seconds of time_now_us(), computed once per second
+uint32_t ICACHE_RAM_ATTR time_now_sec(void)
+{
+    uint64_t m = micros64();
+    if (m >= s_second_end) {
+        uint64_t now = timeshift64 + m + slewed(m);
+        s_second = now / 1000000;
+        s_second_end = m + 1000000 - now % 1000000;
+    }
+    return s_second;
+}
 
 void tune_timeshift64 (uint64_t now_us)
 {
      timeshift64 = now_us - micros64();
      timeshift64_is_set = true;
+     s_slew_us = 0;
+     s_second_end = 0;
+}
+
+void adjust_timeshift64 (uint64_t now_us)
+{
+    if (!time_is_synced) {
+        tune_timeshift64(now_us);
+        time_is_synced = true;
+    } else {
+        uint64_t m = micros64();
+        int64_t delta = (int64_t) (now_us - (timeshift64 + m + slewed(m)));
+        if (llabs(delta) > TIME_SLEW_MAX_US) {
+            tune_timeshift64(now_us);
+        } else {
+            // start over from where the last slew got to
+            timeshift64 += slewed(m);
+            s_slew_us = delta;
+            s_slew_start = m;
+            s_second_end = 0;
+        }
+    }
+    rtc_time_save(now_us);
+}
+
+int adjtime(const struct timeval* delta, struct timeval* olddelta)
+{
+    uint64_t m = micros64();
+    int64_t left = s_slew_us - slewed(m);
+    if (olddelta) {
+        olddelta->tv_sec = left / 1000000;
+        olddelta->tv_usec = left % 1000000;
+    }
+    if (delta) {
+        timeshift64 += slewed(m);
+        s_slew_us = left + delta->tv_sec * 1000000LL + delta->tv_usec;
+        s_slew_start = m;
+        s_second_end = 0;
+    }
+    return 0;
+}
+
+// The time kept in RTC user memory with configTimeRTC(): the UTC time
+// and the RTC counter of the last sync, with the drift of the RTC clock
+// against it. The RTC counter goes on in deep sleep, so the time can be
+// worked out again after it, before SNTP answers.
+#define RTC_TIME_MAGIC 0x52544d31
+#define RTC_TIME_MIN_DRIFT_US (10 * 60 * 1000000ULL) // shortest interval to estimate the drift over
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sec;
+    uint32_t usec;
+    uint32_t rtc;       // system_get_rtc_time()
+    uint32_t cali;      // system_rtc_clock_cali_proc(), us per RTC tick, Q12
+    int32_t drift_ppm;  // of the RTC clock, corrected by
+    uint32_t check;
+} rtc_time_t;
+
+static int s_rtc_offset = -1;
+
+static uint32_t rtc_time_check(const rtc_time_t* state)
+{
+    return state->magic ^ state->sec ^ state->usec ^ state->rtc ^ state->cali ^ (uint32_t) state->drift_ppm ^ 0xa5a5a5a5;
+}
+
+// UTC time from state, in the RTC ticks since; 0 if state is no good
+static uint64_t rtc_time_elapsed(const rtc_time_t* state, uint32_t rtc, uint64_t* elapsed_us)
+{
+    if (state->magic != RTC_TIME_MAGIC || state->check != rtc_time_check(state) || rtc < state->rtc) {
+        // not saved, or the counter started again since
+        return 0;
+    }
+    uint64_t elapsed = ((uint64_t) (rtc - state->rtc) * state->cali) >> 12;
+    *elapsed_us = elapsed;
+    return state->sec * 1000000ULL + state->usec + elapsed + (int64_t) elapsed * state->drift_ppm / 1000000;
+}
+
+static void rtc_time_save(uint64_t now_us)
+{
+    if (s_rtc_offset < 0) {
+        return;
+    }
+    rtc_time_t state;
+    uint32_t rtc = system_get_rtc_time();
+    int32_t drift = 0;
+    uint64_t elapsed = 0;
+    if (system_rtc_mem_read(64 + s_rtc_offset, &state, sizeof(state))) {
+        uint64_t expected = rtc_time_elapsed(&state, rtc, &elapsed);
+        drift = (expected) ? state.drift_ppm : 0;
+        if (expected && elapsed >= RTC_TIME_MIN_DRIFT_US) {
+            // how far off the RTC clock was, averaged with the last estimate
+            int64_t error = (int64_t) (now_us - expected);
+            drift += (int32_t) (error * 1000000 / (int64_t) elapsed / 2);
+        }
+        else if (expected) {
+            // too soon to tell, keep measuring from the older sync
+            return;
+        }
+    }
+    state.magic = RTC_TIME_MAGIC;
+    state.sec = now_us / 1000000;
+    state.usec = now_us % 1000000;
+    state.rtc = rtc;
+    state.cali = system_rtc_clock_cali_proc();
+    state.drift_ppm = drift;
+    state.check = rtc_time_check(&state);
+    system_rtc_mem_write(64 + s_rtc_offset, &state, sizeof(state));
+}
+
+bool configTimeRTC(uint32_t rtcOffset)
+{
+    if (rtcOffset + sizeof(rtc_time_t) / 4 > 128) {
+        return false;
+    }
+    s_rtc_offset = rtcOffset;
+    rtc_time_t state;
+    uint64_t elapsed;
+    // the RTC counter starts from 0 again after a power on or the reset pin
+    int reason = system_get_rst_info()->reason;
+    if (time_is_synced || reason == REASON_DEFAULT_RST || reason == REASON_EXT_SYS_RST ||
+        !system_rtc_mem_read(64 + s_rtc_offset, &state, sizeof(state))) {
+        return false;
+    }
+    uint64_t now_us = rtc_time_elapsed(&state, system_get_rtc_time(), &elapsed);
+    if (!now_us) {
+        return false;
+    }
+    // as good as synced: SNTP slews what it finds off
+    tune_timeshift64(now_us);
+    time_is_synced = true;
+    return true;
 }
 
 static void setServer(int id, const char* name_or_ip)
@@ -95,9 +282,28 @@ int _gettimeofday_r(struct _reent* unused, struct timeval *tp, void *tzp)
     {
         if (!timeshift64_is_set)
             tune_timeshift64(sntp_get_current_timestamp() * 1000000ULL);
-        uint64_t currentTime_us = timeshift64 + micros64();
+        uint64_t currentTime_us = time_now_us();
         tp->tv_sec = currentTime_us / 1000000ULL;
         tp->tv_usec = currentTime_us % 1000000ULL;
     }
     return 0;
 }
+
+// localtime() is called for every log line or so, and every time works
+// out the time zone and the date again: only when the second changes
+// here. The result is the one localtime_r() gives, in the same buffer
+// for all callers as localtime() has.
+struct tm* localtime(const time_t* clock)
+{
+    static struct tm s_tm;
+    static time_t s_clock = -1;
+    static long s_timezone;
+    static int s_daylight;
+    if (*clock != s_clock || _timezone != s_timezone || _daylight != s_daylight) {
+        localtime_r(clock, &s_tm);
+        s_clock = *clock;
+        s_timezone = _timezone;
+        s_daylight = _daylight;
+    }
+    return &s_tm;
+}
@@ -40,6 +40,27 @@ uint8_t twi_writeTo(unsigned char address, unsigned char * buf, unsigned int len
 uint8_t twi_readFrom(unsigned char address, unsigned char * buf, unsigned int len, unsigned char sendStop);
 uint8_t twi_status();
 
+// Transactions clocked from the timer1 interrupt, at up to 100 kHz: they
+// return at once, false if one is running already or timer1 is in use.
+// callback gets the status twi_writeTo()/twi_readFrom() would have returned,
+// from the interrupt, so it must be ICACHE_RAM_ATTR and short; it may start
+// the next transaction. buf must stay valid until then. The functions above
+// wait for a running transaction to end.
+typedef void (*twi_callback_t)(uint8_t status, void *arg);
+bool twi_writeToAsync(unsigned char address, unsigned char * buf, unsigned int len, unsigned char sendStop, twi_callback_t callback, void *arg);
+bool twi_readFromAsync(unsigned char address, unsigned char * buf, unsigned int len, unsigned char sendStop, twi_callback_t callback, void *arg);
+bool twi_busy(void);
+
+// Slave mode, from the interrupts of SDA and SCL. The handlers are called
+// from a task, when the master stopped writing and when it wants to read;
+// the clock is stretched until the TX handler has called twi_transmit().
+// Up to 32 bytes each way.
+void twi_setAddress(uint8_t address);
+void twi_attachSlaveRxEvent(void (*function)(uint8_t*, int));
+void twi_attachSlaveTxEvent(void (*function)(void));
+uint8_t twi_transmit(const uint8_t* data, uint8_t length);
+void twi_enableSlaveMode(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -57,6 +57,14 @@ struct uart_rx_buffer_
     uint8_t * buffer;
 };
 
+struct uart_tx_buffer_
+{
+    size_t size;
+    size_t rpos;
+    size_t wpos;
+    uint8_t * buffer;
+};
+
 struct uart_ 
 {
     int uart_nr;
@@ -67,8 +75,20 @@ struct uart_
     uint8_t rx_pin;
     uint8_t tx_pin;
     struct uart_rx_buffer_ * rx_buffer;
+    struct uart_tx_buffer_ * tx_buffer;
+    uint8_t rx_fifo_full;
+    uint8_t rx_timeout;
+    uart_rx_timeout_cb_t rx_timeout_cb;
+    void * rx_timeout_arg;
+    uart_stats_t stats;
 };
 
+// both uarts share one interrupt, these are the ones the isr serves
+static uart_t* s_uart_isr[2] = { NULL, NULL };
+
+// with a tx buffer, the isr refills the tx fifo when it has less than this
+#define UART_TX_FIFO_REFILL 16
+
 
 /*
    In the context of the naming conventions in this file, "_unsafe" means two things:
@@ -119,9 +139,11 @@ uart_rx_copy_fifo_to_buffer_unsafe(uart_t* uart)
 
     while(uart_rx_fifo_available(uart->uart_nr))
     {
+        ++uart->stats.rx_bytes;
         size_t nextPos = (rx_buffer->wpos + 1) % rx_buffer->size;
         if(nextPos == rx_buffer->rpos) 
         {
+            ++uart->stats.rx_overruns;
 
             if (!uart->overrun) 
             {
@@ -146,6 +168,10 @@ uart_rx_copy_fifo_to_buffer_unsafe(uart_t* uart)
         rx_buffer->buffer[rx_buffer->wpos] = data;
         rx_buffer->wpos = nextPos;
     }
+
+    size_t used = uart_rx_buffer_available_unsafe(rx_buffer);
+    if(used > uart->stats.rx_high_water)
+        uart->stats.rx_high_water = used;
 }
 
 inline int 
@@ -170,6 +196,56 @@ uart_read_char_unsafe(uart_t* uart)
     return data;
 }
 
+// Copy up to size received bytes into buffer, from the rx buffer and then
+// from the fifo, stopping after terminator (not copied) unless it is -1
+static size_t
+uart_read_unsafe(uart_t* uart, int terminator, char* buffer, size_t size, bool* terminated)
+{
+    struct uart_rx_buffer_ *rx_buffer = uart->rx_buffer;
+    size_t count = 0;
+
+    *terminated = false;
+    while(count < size && rx_buffer->rpos != rx_buffer->wpos)
+    {
+        size_t end = (rx_buffer->wpos < rx_buffer->rpos) ? rx_buffer->size : rx_buffer->wpos;
+        size_t chunk = end - rx_buffer->rpos;
+        if(chunk > size - count)
+            chunk = size - count;
+        const uint8_t* src = rx_buffer->buffer + rx_buffer->rpos;
+        size_t consumed = chunk;
+        if(terminator >= 0)
+        {
+            const uint8_t* found = (const uint8_t*) memchr(src, terminator, chunk);
+            if(found)
+            {
+                chunk = found - src;
+                consumed = chunk + 1;
+                *terminated = true;
+            }
+        }
+        memcpy(buffer + count, src, chunk);
+        count += chunk;
+        rx_buffer->rpos += consumed;
+        if(rx_buffer->rpos == rx_buffer->size)
+            rx_buffer->rpos = 0;
+        if(*terminated)
+            return count;
+    }
+
+    while(count < size && uart_rx_fifo_available(uart->uart_nr))
+    {
+        char c = USF(uart->uart_nr);
+        ++uart->stats.rx_bytes;
+        if(terminator >= 0 && c == (char) terminator)
+        {
+            *terminated = true;
+            break;
+        }
+        buffer[count++] = c;
+    }
+    return count;
+}
+
 
 /**********************************************************/
 
@@ -212,6 +288,59 @@ uart_read_char(uart_t* uart)
     return data;
 }
 
+size_t
+uart_read(uart_t* uart, char* buffer, size_t size)
+{
+    bool terminated;
+    return uart_read_until(uart, -1, buffer, size, &terminated);
+}
+
+size_t
+uart_read_until(uart_t* uart, int terminator, char* buffer, size_t size, bool* terminated)
+{
+    *terminated = false;
+    if(uart == NULL || !uart->rx_enabled)
+        return 0;
+
+    ETS_UART_INTR_DISABLE();
+    size_t count = uart_read_unsafe(uart, terminator, buffer, size, terminated);
+    ETS_UART_INTR_ENABLE();
+    return count;
+}
+
+const char*
+uart_peek_buffer(uart_t* uart, size_t* size)
+{
+    *size = 0;
+    if(uart == NULL || !uart->rx_enabled)
+        return NULL;
+
+    struct uart_rx_buffer_ *rx_buffer = uart->rx_buffer;
+    ETS_UART_INTR_DISABLE();
+    // what is still in the fifo goes into the buffer first
+    uart_rx_copy_fifo_to_buffer_unsafe(uart);
+    size_t end = (rx_buffer->wpos < rx_buffer->rpos) ? rx_buffer->size : rx_buffer->wpos;
+    *size = end - rx_buffer->rpos;
+    const char* data = (const char*) rx_buffer->buffer + rx_buffer->rpos;
+    ETS_UART_INTR_ENABLE();
+    return data;
+}
+
+void
+uart_peek_consume(uart_t* uart, size_t consume)
+{
+    if(uart == NULL || !uart->rx_enabled)
+        return;
+
+    struct uart_rx_buffer_ *rx_buffer = uart->rx_buffer;
+    ETS_UART_INTR_DISABLE();
+    size_t available = uart_rx_buffer_available_unsafe(rx_buffer);
+    if(consume > available)
+        consume = available;
+    rx_buffer->rpos = (rx_buffer->rpos + consume) % rx_buffer->size;
+    ETS_UART_INTR_ENABLE();
+}
+
 size_t 
 uart_resize_rx_buffer(uart_t* uart, size_t new_size)
 {
@@ -242,70 +371,219 @@ uart_resize_rx_buffer(uart_t* uart, size_t new_size)
 
 
 
+/*
+  Reference for uart_tx_fifo_available() and uart_tx_fifo_full():
+  -Espressif Techinical Reference doc, chapter 11.3.7
+  -tools/sdk/uart_register.h
+  -cores/esp8266/esp8266_peri.h
+  */
+inline size_t
+uart_tx_fifo_available(const int uart_nr)
+{
+    return (USS(uart_nr) >> USTXC) & 0xff;
+}
+
+inline bool
+uart_tx_fifo_full(const int uart_nr)
+{
+    return uart_tx_fifo_available(uart_nr) >= 0x7f;
+}
+
+inline size_t
+uart_tx_buffer_available_unsafe(const struct uart_tx_buffer_ * tx_buffer)
+{
+    if(tx_buffer->wpos < tx_buffer->rpos)
+      return (tx_buffer->wpos + tx_buffer->size) - tx_buffer->rpos;
+
+    return tx_buffer->wpos - tx_buffer->rpos;
+}
+
+// Move what the tx fifo takes from the tx buffer into it, and have the isr
+// called for the rest
+static void ICACHE_RAM_ATTR
+uart_tx_copy_buffer_to_fifo_unsafe(uart_t* uart)
+{
+    struct uart_tx_buffer_ *tx_buffer = uart->tx_buffer;
+    const int uart_nr = uart->uart_nr;
+
+    while(tx_buffer->rpos != tx_buffer->wpos && !uart_tx_fifo_full(uart_nr))
+    {
+        USF(uart_nr) = tx_buffer->buffer[tx_buffer->rpos];
+        if(++tx_buffer->rpos == tx_buffer->size)
+            tx_buffer->rpos = 0;
+    }
+
+    if(tx_buffer->rpos == tx_buffer->wpos)
+        USIE(uart_nr) &= ~(1 << UIFE);
+    else
+        USIE(uart_nr) |= (1 << UIFE);
+}
+
+// Put as much of buf as fits into the tx buffer, returns how much it took.
+// The fifo is filled here too, so this goes on when the isr can't run.
+static size_t
+uart_tx_buffer_write_unsafe(uart_t* uart, const char* buf, size_t size)
+{
+    struct uart_tx_buffer_ *tx_buffer = uart->tx_buffer;
+    size_t count = 0;
+
+    uart_tx_copy_buffer_to_fifo_unsafe(uart);
+    while(count < size)
+    {
+        size_t nextPos = tx_buffer->wpos + 1;
+        if(nextPos == tx_buffer->size)
+            nextPos = 0;
+        if(nextPos == tx_buffer->rpos)
+            break;
+        tx_buffer->buffer[tx_buffer->wpos] = buf[count++];
+        tx_buffer->wpos = nextPos;
+    }
+    uart_tx_copy_buffer_to_fifo_unsafe(uart);
+    return count;
+}
+
 void ICACHE_RAM_ATTR 
 uart_isr(void * arg)
 {
-    uart_t* uart = (uart_t*)arg;
-    if(uart == NULL || !uart->rx_enabled) 
+    (void) arg;
+    for(int uart_nr = UART0; uart_nr <= UART1; ++uart_nr)
     {
-        USIC(uart->uart_nr) = USIS(uart->uart_nr);
-        ETS_UART_INTR_DISABLE();
-        return;
+        uart_t* uart = s_uart_isr[uart_nr];
+        uint32_t status = USIS(uart_nr);
+        if(uart == NULL)
+        {
+            USIC(uart_nr) = status;
+            continue;
+        }
+        ++uart->stats.isr_count;
+        if(uart->rx_enabled && (status & ((1 << UIFF) | (1 << UITO))))
+            uart_rx_copy_fifo_to_buffer_unsafe(uart);
+        if(uart->rx_timeout_cb && (status & (1 << UITO)))
+            uart->rx_timeout_cb(uart->rx_timeout_arg);
+        if(uart->tx_buffer && (status & (1 << UIFE)))
+            uart_tx_copy_buffer_to_fifo_unsafe(uart);
+
+        USIC(uart_nr) = status;
     }
-    if(USIS(uart->uart_nr) & ((1 << UIFF) | (1 << UITO)))
-        uart_rx_copy_fifo_to_buffer_unsafe(uart);
-    
-    USIC(uart->uart_nr) = USIS(uart->uart_nr);
 }
 
 static void 
 uart_start_isr(uart_t* uart)
 {
-    if(uart == NULL || !uart->rx_enabled)
+    if(uart == NULL || (!uart->rx_enabled && uart->tx_buffer == NULL))
         return;
 
-    // UCFFT value is when the RX fifo full interrupt triggers.  A value of 1
-    // triggers the IRS very often.  A value of 127 would not leave much time
-    // for ISR to clear fifo before the next byte is dropped.  So pick a value
-    // in the middle.
-    USC1(uart->uart_nr) = (100   << UCFFT) | (0x02 << UCTOT) | (1 <<UCTOE );
-    USIC(uart->uart_nr) = 0xffff;
-    USIE(uart->uart_nr) = (1 << UIFF) | (1 << UIFR) | (1 << UITO);
-    ETS_UART_INTR_ATTACH(uart_isr,  (void *)uart);
+    const int uart_nr = uart->uart_nr;
+    uint32_t usc1 = (UART_TX_FIFO_REFILL << UCFET);
+    uint32_t usie = 0;
+
+    if(uart->rx_enabled)
+    {
+        usc1 |= (uart->rx_fifo_full << UCFFT) | (uart->rx_timeout << UCTOT) | (1 <<UCTOE );
+        usie |= (1 << UIFF) | (1 << UIFR) | (1 << UITO);
+    }
+
+    ETS_UART_INTR_DISABLE();
+    s_uart_isr[uart_nr] = uart;
+    USC1(uart_nr) = usc1;
+    USIC(uart_nr) = 0xffff;
+    USIE(uart_nr) = usie;
+    // bytes already buffered
+    if(uart->tx_buffer)
+        uart_tx_copy_buffer_to_fifo_unsafe(uart);
+    ETS_UART_INTR_ATTACH(uart_isr, NULL);
     ETS_UART_INTR_ENABLE();
 }
 
 static void 
 uart_stop_isr(uart_t* uart)
 {
-    if(uart == NULL || !uart->rx_enabled)
+    if(uart == NULL || s_uart_isr[uart->uart_nr] != uart)
         return;
 
     ETS_UART_INTR_DISABLE();
     USC1(uart->uart_nr) = 0;
     USIC(uart->uart_nr) = 0xffff;
     USIE(uart->uart_nr) = 0;
-    ETS_UART_INTR_ATTACH(NULL, NULL);
+    s_uart_isr[uart->uart_nr] = NULL;
+    if(s_uart_isr[UART0] || s_uart_isr[UART1])
+        ETS_UART_INTR_ENABLE();
+    else
+        ETS_UART_INTR_ATTACH(NULL, NULL);
 }
 
+void
+uart_set_rx_thresholds(uart_t* uart, uint8_t fifo_full, uint8_t timeout)
+{
+    if(uart == NULL || !uart->rx_enabled)
+        return;
 
+    // both are 7 bit fields
+    uart->rx_fifo_full = (fifo_full < 1) ? 1 : (fifo_full > 127) ? 127 : fifo_full;
+    uart->rx_timeout = (timeout < 1) ? 1 : (timeout > 127) ? 127 : timeout;
 
-/*
-  Reference for uart_tx_fifo_available() and uart_tx_fifo_full():
-  -Espressif Techinical Reference doc, chapter 11.3.7
-  -tools/sdk/uart_register.h
-  -cores/esp8266/esp8266_peri.h
-  */
-inline size_t
-uart_tx_fifo_available(const int uart_nr)
+    if(s_uart_isr[uart->uart_nr] == uart)
+    {
+        ETS_UART_INTR_DISABLE();
+        USC1(uart->uart_nr) = (UART_TX_FIFO_REFILL << UCFET) | (uart->rx_fifo_full << UCFFT) |
+                              (uart->rx_timeout << UCTOT) | (1 << UCTOE);
+        ETS_UART_INTR_ENABLE();
+    }
+}
+
+void
+uart_set_rx_timeout_callback(uart_t* uart, uart_rx_timeout_cb_t cb, void* arg)
 {
-    return (USS(uart_nr) >> USTXC) & 0xff;
+    if(uart == NULL || !uart->rx_enabled)
+        return;
+
+    ETS_UART_INTR_DISABLE();
+    uart->rx_timeout_cb = cb;
+    uart->rx_timeout_arg = arg;
+    if(s_uart_isr[UART0] || s_uart_isr[UART1])
+        ETS_UART_INTR_ENABLE();
 }
 
-inline bool
-uart_tx_fifo_full(const int uart_nr)
+size_t
+uart_resize_tx_buffer(uart_t* uart, size_t new_size)
 {
-    return uart_tx_fifo_available(uart_nr) >= 0x7f;
+    if(uart == NULL || !uart->tx_enabled)
+        return 0;
+
+    if(new_size < 2)
+        new_size = 0;
+
+    size_t old_size = uart->tx_buffer ? uart->tx_buffer->size : 0;
+    if(old_size == new_size)
+        return old_size;
+
+    struct uart_tx_buffer_ * tx_buffer = NULL;
+    if(new_size)
+    {
+        tx_buffer = (struct uart_tx_buffer_ *)malloc(sizeof(struct uart_tx_buffer_) + new_size);
+        if(tx_buffer == NULL)
+            return old_size;
+        tx_buffer->size = new_size;
+        tx_buffer->rpos = 0;
+        tx_buffer->wpos = 0;
+        tx_buffer->buffer = (uint8_t *)(tx_buffer + 1);
+    }
+
+    // what the old buffer holds goes out first
+    struct uart_tx_buffer_ * old_buffer = uart->tx_buffer;
+    ETS_UART_INTR_DISABLE();
+    while(old_buffer && old_buffer->rpos != old_buffer->wpos)
+        uart_tx_copy_buffer_to_fifo_unsafe(uart);
+    uart->tx_buffer = tx_buffer;
+    if(s_uart_isr[UART0] || s_uart_isr[UART1])
+        ETS_UART_INTR_ENABLE();
+
+    if(tx_buffer)
+        uart_start_isr(uart);
+    else if(!uart->rx_enabled)
+        uart_stop_isr(uart);
+    free(old_buffer);
+    return new_size;
 }
 
 
@@ -318,27 +596,44 @@ uart_do_write_char(const int uart_nr, char c)
 }
 
 size_t 
-uart_write_char(uart_t* uart, char c)
+uart_write(uart_t* uart, const char* buf, size_t size)
 {
     if(uart == NULL || !uart->tx_enabled)
         return 0;
 
-    uart_do_write_char(uart->uart_nr, c);
-    return 1;
+    size_t ret = size;
+    const int uart_nr = uart->uart_nr;
+    if(uart->tx_buffer)
+    {
+        // waits only while the buffer is full
+        while(size)
+        {
+            ETS_UART_INTR_DISABLE();
+            size_t count = uart_tx_buffer_write_unsafe(uart, buf, size);
+            ETS_UART_INTR_ENABLE();
+            buf += count;
+            size -= count;
+        }
+        return ret;
+    }
+
+    while (size--)
+        uart_do_write_char(uart_nr, *buf++);
+
+    return ret;
 }
 
 size_t 
-uart_write(uart_t* uart, const char* buf, size_t size)
+uart_write_char(uart_t* uart, char c)
 {
     if(uart == NULL || !uart->tx_enabled)
         return 0;
 
-    size_t ret = size;
-    const int uart_nr = uart->uart_nr;
-    while (size--)
-        uart_do_write_char(uart_nr, *buf++);
+    if(uart->tx_buffer)
+        return uart_write(uart, &c, 1);
 
-    return ret;
+    uart_do_write_char(uart->uart_nr, c);
+    return 1;
 }
 
 
@@ -349,6 +644,17 @@ uart_tx_free(uart_t* uart)
     if(uart == NULL || !uart->tx_enabled)
         return 0;
 
+    if(uart->tx_buffer)
+    {
+        ETS_UART_INTR_DISABLE();
+        size_t used = uart_tx_buffer_available_unsafe(uart->tx_buffer);
+        ETS_UART_INTR_ENABLE();
+        size_t free_size = uart->tx_buffer->size - 1 - used;
+        if(used == 0)
+            free_size += UART_TX_FIFO_SIZE - uart_tx_fifo_available(uart->uart_nr);
+        return free_size;
+    }
+
     return UART_TX_FIFO_SIZE - uart_tx_fifo_available(uart->uart_nr);
 }
 
@@ -358,11 +664,13 @@ uart_wait_tx_empty(uart_t* uart)
     if(uart == NULL || !uart->tx_enabled)
         return;
 
+    while(uart->tx_buffer && uart->tx_buffer->rpos != uart->tx_buffer->wpos)
+        delay(0);
+
     while(uart_tx_fifo_available(uart->uart_nr) > 0)
         delay(0);
 
 }
-
 void 
 uart_flush(uart_t* uart)
 {
@@ -380,7 +688,18 @@ uart_flush(uart_t* uart)
     }
 
     if(uart->tx_enabled)
+    {
         tmp |= (1 << UCTXRST);
+        if(uart->tx_buffer)
+        {
+            ETS_UART_INTR_DISABLE();
+            uart->tx_buffer->rpos = 0;
+            uart->tx_buffer->wpos = 0;
+            USIE(uart->uart_nr) &= ~(1 << UIFE);
+            if(s_uart_isr[UART0] || s_uart_isr[UART1])
+                ETS_UART_INTR_ENABLE();
+        }
+    }
 
     USC0(uart->uart_nr) |= (tmp);
     USC0(uart->uart_nr) &= ~(tmp);
@@ -414,12 +733,25 @@ uart_init(int uart_nr, int baudrate, int config, int mode, int tx_pin, size_t rx
 
     uart->uart_nr = uart_nr;
     uart->overrun = false;
+    uart->tx_buffer = NULL;
+    // UCFFT value is when the RX fifo full interrupt triggers.  A value of 1
+    // triggers the IRS very often.  A value of 127 would not leave much time
+    // for ISR to clear fifo before the next byte is dropped.  So pick a value
+    // in the middle.
+    uart->rx_fifo_full = 100;
+    uart->rx_timeout = 2;
+    uart->rx_timeout_cb = NULL;
+    uart->rx_timeout_arg = NULL;
+    memset(&uart->stats, 0, sizeof(uart->stats));
 
     switch(uart->uart_nr) 
     {
     case UART0:
-        ETS_UART_INTR_DISABLE();
-        ETS_UART_INTR_ATTACH(NULL, NULL);
+        if(s_uart_isr[UART1] == NULL)
+        {
+            ETS_UART_INTR_DISABLE();
+            ETS_UART_INTR_ATTACH(NULL, NULL);
+        }
         uart->rx_enabled = (mode != UART_TX_ONLY);
         uart->tx_enabled = (mode != UART_RX_ONLY);
         uart->rx_pin = (uart->rx_enabled)?3:255;
@@ -531,6 +863,7 @@ uart_uninit(uart_t* uart)
         free(uart->rx_buffer->buffer);
         free(uart->rx_buffer);
     }
+    free(uart->tx_buffer);
     free(uart);
 }
 
@@ -673,6 +1006,33 @@ uart_rx_enabled(uart_t* uart)
     return uart->rx_enabled;
 }
 
+void
+uart_get_stats(uart_t* uart, uart_stats_t* stats)
+{
+    if(uart == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    ETS_UART_INTR_DISABLE();
+    *stats = uart->stats;
+    if(s_uart_isr[UART0] || s_uart_isr[UART1])
+        ETS_UART_INTR_ENABLE();
+}
+
+void
+uart_reset_stats(uart_t* uart)
+{
+    if(uart == NULL)
+        return;
+
+    ETS_UART_INTR_DISABLE();
+    memset(&uart->stats, 0, sizeof(uart->stats));
+    if(s_uart_isr[UART0] || s_uart_isr[UART1])
+        ETS_UART_INTR_ENABLE();
+}
+
 bool 
 uart_has_overrun (uart_t* uart)
 {
@@ -703,13 +1063,20 @@ uart_write_char_delay(const int uart_nr, char c)
 static void 
 uart0_write_char(char c)
 {
-    uart_write_char_delay(0, c);
+    // behind what is buffered
+    if(s_uart_isr[UART0] && s_uart_isr[UART0]->tx_buffer)
+        uart_write(s_uart_isr[UART0], &c, 1);
+    else
+        uart_write_char_delay(0, c);
 }
 
 static void 
 uart1_write_char(char c)
 {
-    uart_write_char_delay(1, c);
+    if(s_uart_isr[UART1] && s_uart_isr[UART1]->tx_buffer)
+        uart_write(s_uart_isr[UART1], &c, 1);
+    else
+        uart_write_char_delay(1, c);
 }
 
 void 
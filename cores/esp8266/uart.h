@@ -126,11 +126,31 @@ void uart_set_baudrate(uart_t* uart, int baud_rate);
 int uart_get_baudrate(uart_t* uart);
 
 size_t uart_resize_rx_buffer(uart_t* uart, size_t new_size);
+// The rx interrupt comes when the fifo holds fifo_full bytes (default 100),
+// or when no byte came for timeout byte times (default 2) and some are
+// waiting. Both go from 1 to 127.
+void uart_set_rx_thresholds(uart_t* uart, uint8_t fifo_full, uint8_t timeout);
+// cb(arg) is called from the rx interrupt, after the received bytes are
+// put into the rx buffer, when it came for the timeout: it must be in IRAM.
+typedef void (*uart_rx_timeout_cb_t)(void* arg);
+void uart_set_rx_timeout_callback(uart_t* uart, uart_rx_timeout_cb_t cb, void* arg);
+// 0 writes straight to the tx fifo, waiting while it is full
+size_t uart_resize_tx_buffer(uart_t* uart, size_t new_size);
 
 size_t uart_write_char(uart_t* uart, char c);
 size_t uart_write(uart_t* uart, const char* buf, size_t size);
 int uart_read_char(uart_t* uart);
+// Copy up to size received bytes into buffer at once, without waiting
+size_t uart_read(uart_t* uart, char* buffer, size_t size);
+// The same, stopping at terminator, which is taken out but not copied.
+// terminated tells whether it was found.
+size_t uart_read_until(uart_t* uart, int terminator, char* buffer, size_t size, bool* terminated);
 int uart_peek_char(uart_t* uart);
+// The received bytes that follow each other in the rx buffer, read in
+// place: size of them from the pointer, which stays valid until
+// uart_peek_consume() or another read (or an overrun dropping them).
+const char* uart_peek_buffer(uart_t* uart, size_t* size);
+void uart_peek_consume(uart_t* uart, size_t consume);
 size_t uart_rx_available(uart_t* uart);
 size_t uart_tx_free(uart_t* uart);
 void uart_wait_tx_empty(uart_t* uart);
@@ -138,6 +158,16 @@ void uart_flush(uart_t* uart);
 
 bool uart_has_overrun (uart_t* uart); // returns then clear overrun flag
 
+typedef struct {
+    uint32_t rx_bytes;      // received
+    uint32_t rx_overruns;   // lost because the rx buffer was full
+    uint32_t isr_count;     // uart interrupts served
+    size_t rx_high_water;   // most bytes the rx buffer held
+} uart_stats_t;
+
+void uart_get_stats(uart_t* uart, uart_stats_t* stats);
+void uart_reset_stats(uart_t* uart);
+
 void uart_set_debug(int uart_nr);
 int uart_get_debug();
 
@@ -634,6 +634,20 @@ unsigned short int umm_numblocks = 0;
 
 #define UMM_NUMBLOCKS (umm_numblocks)
 
+/*
+ * Running totals of the free list, kept up to date by every heap operation
+ * so that they can be read without walking the heap like umm_info() does.
+ * The largest free block can only be tracked cheaply while blocks are freed;
+ * when the largest one gets used, it's marked stale and looked up again from
+ * the free list on the next request.
+ */
+static struct {
+  unsigned short int freeBlocks;
+  unsigned short int freeEntries;
+  unsigned short int maxFreeBlocks;
+  unsigned char      maxFreeStale;
+} ummStats;
+
 /* ------------------------------------------------------------------------ */
 
 #define UMM_BLOCK(b)  (umm_heap[b])
@@ -644,8 +658,29 @@ unsigned short int umm_numblocks = 0;
 #define UMM_PFREE(b)  (UMM_BLOCK(b).body.free.prev)
 #define UMM_DATA(b)   (UMM_BLOCK(b).body.data)
 
+/* incremental check, cursor (UMM_INTEGRITY_CHECK, UMM_POISON) {{{ */
+#if (defined(UMM_INTEGRITY_CHECK) || defined(UMM_POISON)) && !defined(UMM_CHECK_FULL)
+#define UMM_CHECK_INCREMENTAL
+
+/*
+ * The next block the incremental check looks at, taking the heap in turn.
+ * When a block is merged into another one, the cursor moves to the block
+ * that remains, so that it always is at the start of a block.
+ */
+static unsigned short int umm_check_next = 0;
+
+#define UMM_CHECK_FORGET(gone, kept) do { \
+    if (umm_check_next == (gone)) {       \
+      umm_check_next = (kept);            \
+    }                                     \
+  } while (0)
+#else
+#define UMM_CHECK_FORGET(gone, kept)
+#endif
+/* }}} */
+
 /* integrity check (UMM_INTEGRITY_CHECK) {{{ */
-#if defined(UMM_INTEGRITY_CHECK)
+#if defined(UMM_INTEGRITY_CHECK) && !defined(UMM_CHECK_INCREMENTAL)
 /*
  * Perform integrity check of the whole heap data. Returns 1 in case of
  * success, 0 otherwise.
@@ -765,7 +800,7 @@ clean:
 #define INTEGRITY_CHECK() integrity_check()
 #else
 /*
- * Integrity check is disabled, so just define stub macro
+ * Integrity check is disabled or incremental, so just define stub macro
  */
 #define INTEGRITY_CHECK() 1
 #endif
@@ -868,6 +903,7 @@ clean:
   return ok;
 }
 
+#if !defined(UMM_CHECK_INCREMENTAL)
 /*
  * Iterates through all blocks in the heap, and checks poison for all used
  * blocks.
@@ -897,6 +933,7 @@ static int check_poison_all_blocks(void) {
 
   return ok;
 }
+#endif
 
 /*
  * Takes a pointer returned by actual allocator function (`_umm_malloc` or
@@ -945,7 +982,11 @@ static void *get_unpoisoned( unsigned char *ptr ) {
   return ptr;
 }
 
+#if !defined(UMM_CHECK_INCREMENTAL)
 #define CHECK_POISON_ALL_BLOCKS() check_poison_all_blocks()
+#else
+#define CHECK_POISON_ALL_BLOCKS() 1
+#endif
 #define GET_POISONED(ptr, size)   get_poisoned(ptr, size)
 #define GET_UNPOISONED(ptr)       get_unpoisoned(ptr)
 
@@ -1154,6 +1195,13 @@ static void umm_make_new_block( unsigned short int c,
 /* ------------------------------------------------------------------------ */
 
 static void umm_disconnect_from_free_list( unsigned short int c ) {
+  /* Keep track of the free list */
+
+  --ummStats.freeEntries;
+  if( (UMM_NBLOCK(c) & UMM_BLOCKNO_MASK) - c == ummStats.maxFreeBlocks ) {
+    ummStats.maxFreeStale = 1;
+  }
+
   /* Disconnect this block from the FREE list */
 
   UMM_NFREE(UMM_PFREE(c)) = UMM_NFREE(c);
@@ -1179,6 +1227,7 @@ static void umm_assimilate_up( unsigned short int c ) {
     /* Disconnect the next block from the FREE list */
 
     umm_disconnect_from_free_list( UMM_NBLOCK(c) );
+    UMM_CHECK_FORGET( UMM_NBLOCK(c) & UMM_BLOCKNO_MASK, c );
 
     /* Assimilate the next block with this one */
 
@@ -1191,6 +1240,8 @@ static void umm_assimilate_up( unsigned short int c ) {
 
 static unsigned short int umm_assimilate_down( unsigned short int c, unsigned short int freemask ) {
 
+  UMM_CHECK_FORGET( c, UMM_PBLOCK(c) );
+
   UMM_NBLOCK(UMM_PBLOCK(c)) = UMM_NBLOCK(c) | freemask;
   UMM_PBLOCK(UMM_NBLOCK(c)) = UMM_PBLOCK(c);
 
@@ -1199,6 +1250,167 @@ static unsigned short int umm_assimilate_down( unsigned short int c, unsigned sh
 
 /* ------------------------------------------------------------------------- */
 
+/* slab front-end (UMM_SLAB) {{{ */
+#if defined(UMM_SLAB)
+
+/*
+ * Every size class is a run of equally sized slots inside one umm block
+ * allocated by umm_init(). Free slots are kept in a singly linked list
+ * through their first word, so taking or returning one is a couple of
+ * pointer moves. Which class a pointer belongs to follows from its address.
+ */
+
+#define UMM_SLAB_GRANULE (16)
+#define UMM_SLAB_MAX     (UMM_SLAB_CLASSES * UMM_SLAB_GRANULE)
+
+typedef struct umm_slab_t {
+  void *free;
+  char *start;
+  UMM_SLAB_STATS stats;
+} umm_slab;
+
+static umm_slab umm_slabs[UMM_SLAB_CLASSES];
+static char *umm_slab_start = NULL;
+static char *umm_slab_end = NULL;
+
+static void *_umm_malloc( size_t size );
+
+static void umm_slab_init( void ) {
+  size_t total = 0;
+  char *p;
+  int i, j;
+
+  umm_slab_start = NULL;
+  umm_slab_end = NULL;
+
+  for( i = 0; i < UMM_SLAB_CLASSES; ++i ) {
+    total += (i + 1) * UMM_SLAB_GRANULE * UMM_SLAB_SLOTS;
+  }
+
+  /* the heap is empty, so this ends up at its very bottom */
+  p = (char *)_umm_malloc( total );
+  if( NULL == p ) {
+    DBG_LOG_DEBUG( "Can't allocate %d bytes of slabs\n", total );
+    return;
+  }
+
+  umm_slab_start = p;
+
+  for( i = 0; i < UMM_SLAB_CLASSES; ++i ) {
+    umm_slab *slab = &umm_slabs[i];
+    unsigned short int size = (i + 1) * UMM_SLAB_GRANULE;
+
+    memset( slab, 0, sizeof( *slab ) );
+    slab->start = p;
+    slab->stats.size = size;
+    slab->stats.slots = UMM_SLAB_SLOTS;
+
+    for( j = UMM_SLAB_SLOTS - 1; j >= 0; --j ) {
+      *(void **)(p + j * size) = slab->free;
+      slab->free = p + j * size;
+    }
+
+    p += size * UMM_SLAB_SLOTS;
+  }
+
+  umm_slab_end = p;
+}
+
+static umm_slab *umm_slab_owner( void *ptr ) {
+  int i;
+
+  if( (char *)ptr < umm_slab_start || (char *)ptr >= umm_slab_end ) {
+    return NULL;
+  }
+
+  for( i = UMM_SLAB_CLASSES - 1; (char *)ptr < umm_slabs[i].start; --i )
+    ;
+
+  return &umm_slabs[i];
+}
+
+static void *umm_slab_alloc( size_t size ) {
+  umm_slab *slab;
+  void *ret;
+
+  if( NULL == umm_slab_start || size > UMM_SLAB_MAX ) {
+    return NULL;
+  }
+
+  slab = &umm_slabs[(size - 1) / UMM_SLAB_GRANULE];
+
+  UMM_CRITICAL_ENTRY();
+
+  ret = slab->free;
+  if( ret ) {
+    slab->free = *(void **)ret;
+    ++slab->stats.allocs;
+    if( ++slab->stats.used > slab->stats.highWater ) {
+      slab->stats.highWater = slab->stats.used;
+    }
+  } else {
+    ++slab->stats.misses;
+  }
+
+  UMM_CRITICAL_EXIT();
+
+  return ret;
+}
+
+static void umm_slab_put( umm_slab *slab, void *ptr ) {
+  UMM_CRITICAL_ENTRY();
+
+  *(void **)ptr = slab->free;
+  slab->free = ptr;
+  ++slab->stats.frees;
+  --slab->stats.used;
+
+  UMM_CRITICAL_EXIT();
+}
+
+static int umm_slab_free( void *ptr ) {
+  umm_slab *slab = umm_slab_owner( ptr );
+
+  if( NULL == slab ) {
+    return 0;
+  }
+
+  DBG_LOG_DEBUG( "Freeing slab slot of %d bytes\n", slab->stats.size );
+
+  umm_slab_put( slab, ptr );
+
+  return 1;
+}
+
+static size_t umm_slab_free_bytes( void ) {
+  size_t ret = 0;
+  int i;
+
+  if( NULL == umm_slab_start ) {
+    return 0;
+  }
+
+  for( i = 0; i < UMM_SLAB_CLASSES; ++i ) {
+    ret += (size_t)(umm_slabs[i].stats.slots - umm_slabs[i].stats.used) * umm_slabs[i].stats.size;
+  }
+
+  return ret;
+}
+
+#else
+/*
+ * Slabs are disabled, so just define stub macros
+ */
+#define umm_slab_init()
+#define umm_slab_alloc(s)    NULL
+#define umm_slab_free(p)     0
+#define umm_slab_owner(p)    NULL
+#define umm_slab_free_bytes() 0
+#endif
+/* }}} */
+
+/* ------------------------------------------------------------------------- */
+
 void umm_init( void ) {
   /* init heap pointer and size, and memset it to 0 */
   umm_heap = (umm_block *)UMM_MALLOC_CFG__HEAP_ADDR;
@@ -1251,7 +1463,19 @@ void umm_init( void ) {
      */
     UMM_NBLOCK(block_last) = 0;
     UMM_PBLOCK(block_last) = block_1th;
+
+    /* the free list is just the 1st `umm_block` */
+    ummStats.freeBlocks    = block_last - block_1th;
+    ummStats.freeEntries   = 1;
+    ummStats.maxFreeBlocks = block_last - block_1th;
+    ummStats.maxFreeStale  = 0;
   }
+
+#if defined(UMM_CHECK_INCREMENTAL)
+  umm_check_next = 0;
+#endif
+
+  umm_slab_init();
 }
 
 /* ------------------------------------------------------------------------ */
@@ -1268,6 +1492,10 @@ static void _umm_free( void *ptr ) {
     return;
   }
 
+  if( umm_slab_free( ptr ) ) {
+    return;
+  }
+
   /*
    * FIXME: At some point it might be a good idea to add a check to make sure
    *        that the pointer we're being asked to free up is actually within
@@ -1286,6 +1514,8 @@ static void _umm_free( void *ptr ) {
 
   DBG_LOG_DEBUG( "Freeing block %6d\n", c );
 
+  ummStats.freeBlocks += (UMM_NBLOCK(c) & UMM_BLOCKNO_MASK) - c;
+
   /* Now let's assimilate this block with the next one if possible. */
 
   umm_assimilate_up( c );
@@ -1311,6 +1541,15 @@ static void _umm_free( void *ptr ) {
     UMM_NFREE(0)            = c;
 
     UMM_NBLOCK(c)          |= UMM_FREELIST_MASK;
+
+    ++ummStats.freeEntries;
+  }
+
+  /* Freeing only ever makes free blocks larger */
+
+  if( !ummStats.maxFreeStale &&
+      (UMM_NBLOCK(c) & UMM_BLOCKNO_MASK) - c > ummStats.maxFreeBlocks ) {
+    ummStats.maxFreeBlocks = (UMM_NBLOCK(c) & UMM_BLOCKNO_MASK) - c;
   }
 
 #if 0
@@ -1368,6 +1607,14 @@ static void *_umm_malloc( size_t size ) {
     return( (void *)NULL );
   }
 
+  /* Small sizes are served by their slab, as long as it has free slots */
+  {
+    void *slot = umm_slab_alloc( size );
+    if( slot ) {
+      return( slot );
+    }
+  }
+
   /* Protect the critical section... */
   UMM_CRITICAL_ENTRY();
 
@@ -1430,6 +1677,10 @@ static void *_umm_malloc( size_t size ) {
       /* It's not an exact fit and we need to split off a block. */
       DBG_LOG_DEBUG( "Allocating %6d blocks starting at %6d - existing\n", blocks, cf );
 
+      if( blockSize == ummStats.maxFreeBlocks ) {
+        ummStats.maxFreeStale = 1;
+      }
+
       /*
        * split current free block `cf` into two blocks. The first one will be
        * returned to user, so it's not free, and the second one will be free.
@@ -1464,6 +1715,8 @@ static void *_umm_malloc( size_t size ) {
     return( (void *)NULL );
   }
 
+  ummStats.freeBlocks -= blocks;
+
   /* Release the critical section... */
   UMM_CRITICAL_EXIT();
 
@@ -1513,6 +1766,32 @@ static void *_umm_realloc( void *ptr, size_t size ) {
     return( (void *)NULL );
   }
 
+#if defined(UMM_SLAB)
+  /*
+   * A slab slot stays where it is while the new size fits in it, otherwise
+   * the data moves to a new allocation, which may be a slot of a larger class.
+   */
+  {
+    umm_slab *slab = umm_slab_owner( ptr );
+
+    if( slab ) {
+      void *ret;
+
+      if( size <= slab->stats.size ) {
+        return( ptr );
+      }
+
+      ret = _umm_malloc( size );
+      if( ret ) {
+        memcpy( ret, ptr, slab->stats.size );
+        umm_slab_put( slab, ptr );
+      }
+
+      return( ret );
+    }
+  }
+#endif
+
   /* Protect the critical section... */
   UMM_CRITICAL_ENTRY();
 
@@ -1603,6 +1882,10 @@ static void *_umm_realloc( void *ptr, size_t size ) {
     ptr    = (void *)&UMM_DATA(c);
   }
 
+  /* Whatever was assimilated up or down isn't free anymore */
+
+  ummStats.freeBlocks -= (UMM_NBLOCK(c) - c) - blockSize;
+
   /* Now calculate the block size again...and we'll have three cases */
 
   blockSize = (UMM_NBLOCK(c) - c);
@@ -1647,18 +1930,121 @@ static void *_umm_realloc( void *ptr, size_t size ) {
   return( ptr );
 }
 
+/* incremental check (UMM_INTEGRITY_CHECK, UMM_POISON) {{{ */
+#if defined(UMM_CHECK_INCREMENTAL)
+/*
+ * Checks the links of block `b` with the blocks around it, in the heap and,
+ * if it is free, in the free list; and its poison if it is used. Returns 1
+ * in case of success, 0 otherwise.
+ */
+static int check_block( unsigned short int b ) {
+  unsigned short int n = UMM_NBLOCK(b) & UMM_BLOCKNO_MASK;
+  int is_free = (UMM_NBLOCK(b) & UMM_FREELIST_MASK) != 0;
+
+#if defined(UMM_INTEGRITY_CHECK)
+  unsigned short int p = UMM_PBLOCK(b);
+
+  if (n >= UMM_NUMBLOCKS || p >= UMM_NUMBLOCKS) {
+    printf("heap integrity broken: too large block num: %d -> %d, %d "
+        "(addr 0x%lx)\n", b, n, p, (unsigned long)&UMM_NBLOCK(b));
+    return 0;
+  }
+  if ((n != 0 && (n <= b || UMM_PBLOCK(n) != b)) ||
+      (b != 0 && (p >= b || (UMM_NBLOCK(p) & UMM_BLOCKNO_MASK) != b))) {
+    printf("heap integrity broken: block links don't match: "
+        "%d -> %d -> %d\n", p, b, n);
+    return 0;
+  }
+  if (is_free) {
+    unsigned short int nf = UMM_NFREE(b);
+    unsigned short int pf = UMM_PFREE(b);
+
+    if (nf >= UMM_NUMBLOCKS || pf >= UMM_NUMBLOCKS ||
+        (nf != 0 && (!(UMM_NBLOCK(nf) & UMM_FREELIST_MASK) || UMM_PFREE(nf) != b)) ||
+        (pf != 0 && !(UMM_NBLOCK(pf) & UMM_FREELIST_MASK)) || UMM_NFREE(pf) != b) {
+      printf("heap integrity broken: free links don't match: "
+          "%d -> %d -> %d\n", pf, b, nf);
+      return 0;
+    }
+  }
+#endif
+
+#if defined(UMM_POISON)
+  /* the 0th and the last blocks hold no data */
+  if (!is_free && b != 0 && n != 0 && !check_poison_block(&UMM_BLOCK(b))) {
+    return 0;
+  }
+#endif
+
+  return 1;
+}
+
+/*
+ * Instead of the whole heap, checks the block of `ptr` (a pointer the
+ * allocator returned, or NULL) with the blocks next to it, which are those
+ * an operation on it changes, and `blocks` more blocks in turn, so that
+ * corruption anywhere is still found after a number of calls. Returns 1 in
+ * case of success, 0 otherwise.
+ */
+static int check_incremental( void *ptr, int blocks ) {
+  int ok = 1;
+  int i;
+
+  if (umm_heap == NULL) {
+    umm_init();
+  }
+
+  UMM_CRITICAL_ENTRY();
+
+  if (ptr != NULL && umm_slab_owner(ptr) == NULL) {
+    if ((char *)ptr < (char *)&UMM_DATA(1) ||
+        (char *)ptr >= (char *)&UMM_DATA(UMM_NUMBLOCKS - 1)) {
+      printf("heap check: 0x%lx is not in the heap\n", (unsigned long)ptr);
+      ok = 0;
+    } else {
+      unsigned short int c = (((char *)ptr)-(char *)(&(umm_heap[0])))/sizeof(umm_block);
+
+      ok = check_block(c) &&
+           check_block(UMM_PBLOCK(c)) &&
+           check_block(UMM_NBLOCK(c) & UMM_BLOCKNO_MASK);
+    }
+  }
+
+  for (i = 0; ok && i < blocks; ++i) {
+    ok = check_block(umm_check_next);
+    if (ok) {
+      /* back to the 0th after the last one */
+      umm_check_next = UMM_NBLOCK(umm_check_next) & UMM_BLOCKNO_MASK;
+    }
+  }
+
+  UMM_CRITICAL_EXIT();
+
+  if (!ok) {
+    UMM_HEAP_CORRUPTION_CB();
+  }
+  return ok;
+}
+
+#define UMM_CHECK(ptr)     check_incremental(ptr, UMM_CHECK_BLOCKS_PER_CALL)
+#define UMM_CHECK_NEW(ptr) check_incremental(ptr, 0)
+#else
+/*
+ * Full checks of the heap before each operation, or none
+ */
+#define UMM_CHECK(ptr)     (CHECK_POISON_ALL_BLOCKS() && INTEGRITY_CHECK())
+#define UMM_CHECK_NEW(ptr) 1
+#endif
+/* }}} */
+
 /* ------------------------------------------------------------------------ */
 
 void *umm_malloc( size_t size ) {
   void *ret;
+  void *block;
 
-  /* check poison of each blocks, if poisoning is enabled */
-  if (!CHECK_POISON_ALL_BLOCKS()) {
-    return NULL;
-  }
-
-  /* check full integrity of the heap, if this check is enabled */
-  if (!INTEGRITY_CHECK()) {
+  /* check the heap, if poisoning or the integrity check is enabled */
+  if (!UMM_CHECK(NULL)) {
     return NULL;
   }
 
@@ -1670,8 +2056,14 @@ void *umm_malloc( size_t size ) {
     umm_last_fail_alloc_size = size;
   }
 
+  block = ret;
   ret = GET_POISONED(ret, size);
 
+  /* and where the new block was made */
+  if (block != NULL && !UMM_CHECK_NEW(block)) {
+    return NULL;
+  }
+
   return ret;
 }
 
@@ -1679,15 +2071,11 @@ void *umm_malloc( size_t size ) {
 
 void *umm_calloc( size_t num, size_t item_size ) {
   void *ret;
+  void *block;
   size_t size = item_size * num;
 
-  /* check poison of each blocks, if poisoning is enabled */
-  if (!CHECK_POISON_ALL_BLOCKS()) {
-    return NULL;
-  }
-
-  /* check full integrity of the heap, if this check is enabled */
-  if (!INTEGRITY_CHECK()) {
+  /* check the heap, if poisoning or the integrity check is enabled */
+  if (!UMM_CHECK(NULL)) {
     return NULL;
   }
 
@@ -1701,8 +2089,14 @@ void *umm_calloc( size_t num, size_t item_size ) {
     umm_last_fail_alloc_size = size;
   }
 
+  block = ret;
   ret = GET_POISONED(ret, size);
 
+  /* and where the new block was made */
+  if (block != NULL && !UMM_CHECK_NEW(block)) {
+    return NULL;
+  }
+
   return ret;
 }
 
@@ -1710,16 +2104,12 @@ void *umm_calloc( size_t num, size_t item_size ) {
 
 void *umm_realloc( void *ptr, size_t size ) {
   void *ret;
+  void *block;
 
   ptr = GET_UNPOISONED(ptr);
 
-  /* check poison of each blocks, if poisoning is enabled */
-  if (!CHECK_POISON_ALL_BLOCKS()) {
-    return NULL;
-  }
-
-  /* check full integrity of the heap, if this check is enabled */
-  if (!INTEGRITY_CHECK()) {
+  /* check the heap, if poisoning or the integrity check is enabled */
+  if (!UMM_CHECK(ptr)) {
     return NULL;
   }
 
@@ -1730,8 +2120,14 @@ void *umm_realloc( void *ptr, size_t size ) {
     umm_last_fail_alloc_size = size;
   }
 
+  block = ret;
   ret = GET_POISONED(ret, size);
 
+  /* and where the new block was made */
+  if (block != NULL && !UMM_CHECK_NEW(block)) {
+    return NULL;
+  }
+
   return ret;
 }
 
@@ -1741,13 +2137,8 @@ void umm_free( void *ptr ) {
 
   ptr = GET_UNPOISONED(ptr);
 
-  /* check poison of each blocks, if poisoning is enabled */
-  if (!CHECK_POISON_ALL_BLOCKS()) {
-    return;
-  }
-
-  /* check full integrity of the heap, if this check is enabled */
-  if (!INTEGRITY_CHECK()) {
+  /* check the heap, if poisoning or the integrity check is enabled */
+  if (!UMM_CHECK(ptr)) {
     return;
   }
 
@@ -1757,8 +2148,166 @@ void umm_free( void *ptr ) {
 /* ------------------------------------------------------------------------ */
 
 size_t ICACHE_FLASH_ATTR umm_free_heap_size( void ) {
-  umm_info(NULL, 0);
-  return (size_t)ummHeapInfo.freeBlocks * sizeof(umm_block);
+  if (umm_heap == NULL) {
+    umm_init();
+  }
+
+  return (size_t)ummStats.freeBlocks * sizeof(umm_block) + umm_slab_free_bytes();
+}
+
+/* ------------------------------------------------------------------------ */
+
+size_t ICACHE_FLASH_ATTR umm_max_free_block_size( void ) {
+  unsigned short int cf;
+
+  if (umm_heap == NULL) {
+    umm_init();
+  }
+
+  UMM_CRITICAL_ENTRY();
+
+  if( ummStats.maxFreeStale ) {
+    ummStats.maxFreeBlocks = 0;
+
+    for( cf = UMM_NFREE(0); cf; cf = UMM_NFREE(cf) ) {
+      unsigned short int blockSize = (UMM_NBLOCK(cf) & UMM_BLOCKNO_MASK) - cf;
+
+      if( blockSize > ummStats.maxFreeBlocks ) {
+        ummStats.maxFreeBlocks = blockSize;
+      }
+    }
+
+    ummStats.maxFreeStale = 0;
+  }
+
+  cf = ummStats.maxFreeBlocks;
+
+  UMM_CRITICAL_EXIT();
+
+  /* a block of n blocks holds all of them but the header of the first */
+  if( 0 == cf ) {
+    return 0;
+  }
+
+  return (size_t)cf * sizeof(umm_block) - sizeof(((umm_block *)0)->header);
+}
+
+/* ------------------------------------------------------------------------ */
+
+size_t ICACHE_FLASH_ATTR umm_free_block_count( void ) {
+  if (umm_heap == NULL) {
+    umm_init();
+  }
+
+  return ummStats.freeEntries;
+}
+
+/* ------------------------------------------------------------------------ */
+
+int ICACHE_FLASH_ATTR umm_fragmentation_metric( void ) {
+  size_t maxFree = umm_max_free_block_size();
+  size_t freeBytes = (size_t)ummStats.freeBlocks * sizeof(umm_block);
+
+  if( 0 == freeBytes ) {
+    return 0;
+  }
+
+  /* 0 when all the free memory is one block, near 100 when it's all crumbs */
+  return 100 - (int)((maxFree + sizeof(((umm_block *)0)->header)) * 100 / freeBytes);
+}
+
+/* ------------------------------------------------------------------------ */
+
+int ICACHE_FLASH_ATTR umm_slab_stats( UMM_SLAB_STATS *stats, int count ) {
+#if defined(UMM_SLAB)
+  int i;
+
+  if (umm_heap == NULL) {
+    umm_init();
+  }
+
+  if( NULL == umm_slab_start ) {
+    return 0;
+  }
+
+  UMM_CRITICAL_ENTRY();
+  for( i = 0; i < count && i < UMM_SLAB_CLASSES; ++i ) {
+    stats[i] = umm_slabs[i].stats;
+  }
+  UMM_CRITICAL_EXIT();
+
+  return UMM_SLAB_CLASSES;
+#else
+  (void)stats;
+  (void)count;
+  return 0;
+#endif
+}
+
+/* ------------------------------------------------------------------------ */
+
+/*
+ * Calls cb for every allocated block with the pointer and size its owner
+ * was given (as far as the heap knows it: without UMM_POISON, the size is
+ * that of the whole block). The slab region shows up as its used slots.
+ * The callback runs with the heap locked and must not allocate or free.
+ */
+void ICACHE_FLASH_ATTR umm_walk( umm_walk_cb cb, void *arg ) {
+  unsigned short int blockNo;
+
+  if (umm_heap == NULL) {
+    umm_init();
+  }
+
+  UMM_CRITICAL_ENTRY();
+
+  for( blockNo = UMM_NBLOCK(0) & UMM_BLOCKNO_MASK;
+       UMM_NBLOCK(blockNo) & UMM_BLOCKNO_MASK;
+       blockNo = UMM_NBLOCK(blockNo) & UMM_BLOCKNO_MASK ) {
+    unsigned char *data = UMM_DATA(blockNo);
+    size_t size;
+
+    if( UMM_NBLOCK(blockNo) & UMM_FREELIST_MASK ) {
+      continue;
+    }
+
+#if defined(UMM_SLAB)
+    if( (char *)data == umm_slab_start ) {
+      int i, j;
+
+      for( i = 0; i < UMM_SLAB_CLASSES; ++i ) {
+        umm_slab *slab = &umm_slabs[i];
+
+        for( j = 0; j < slab->stats.slots; ++j ) {
+          char *slot = slab->start + j * slab->stats.size;
+          void *p;
+
+          for( p = slab->free; p && p != slot; p = *(void **)p )
+            ;
+          if( NULL == p ) {
+            cb( slot, slab->stats.size, arg );
+          }
+        }
+      }
+      continue;
+    }
+#endif
+
+    size = ((UMM_NBLOCK(blockNo) & UMM_BLOCKNO_MASK) - blockNo) * sizeof(umm_block)
+           - sizeof(((umm_block *)0)->header);
+#if defined(UMM_POISON)
+    {
+      UMM_POISONED_BLOCK_LEN_TYPE len;
+
+      memcpy( &len, data, sizeof(len) );
+      size = len - (UMM_POISON_SIZE_BEFORE + UMM_POISON_SIZE_AFTER + sizeof(UMM_POISONED_BLOCK_LEN_TYPE));
+      data += sizeof(UMM_POISONED_BLOCK_LEN_TYPE) + UMM_POISON_SIZE_BEFORE;
+    }
+#endif
+    cb( data, size, arg );
+  }
+
+  UMM_CRITICAL_EXIT();
 }
 
 /* ------------------------------------------------------------------------ */
@@ -31,6 +31,18 @@ UMM_HEAP_INFO;
 
 extern UMM_HEAP_INFO ummHeapInfo;
 
+typedef struct UMM_SLAB_STATS_t {
+  unsigned short int size;
+  unsigned short int slots;
+  unsigned short int used;
+  unsigned short int highWater;
+
+  unsigned long allocs;
+  unsigned long frees;
+  unsigned long misses;
+}
+UMM_SLAB_STATS;
+
 void umm_init( void );
 
 void *umm_info( void *ptr, int force );
@@ -41,6 +53,36 @@ void *umm_realloc( void *ptr, size_t size );
 void umm_free( void *ptr );
 
 size_t umm_free_heap_size( void );
+size_t umm_max_free_block_size( void );
+size_t umm_free_block_count( void );
+int umm_fragmentation_metric( void );
+
+int umm_slab_stats( UMM_SLAB_STATS *stats, int count );
+
+typedef void (*umm_walk_cb)( void *ptr, size_t size, void *arg );
+void umm_walk( umm_walk_cb cb, void *arg );
+
+/* Allocations by call site, recorded with DEBUG_ESP_HEAP_PROFILE */
+
+typedef struct HEAP_PROFILE_SITE_t {
+  const char *file;     /* in flash, NULL when only the caller is known */
+  int line;
+  const void *caller;   /* return address, when file is NULL */
+
+  size_t live;
+  size_t peak;
+  unsigned long allocs;
+}
+HEAP_PROFILE_SITE;
+
+/* copies site index if there's one, returns the number of sites */
+int heap_profile_get( int index, HEAP_PROFILE_SITE *site );
+void heap_profile_reset( void );
+
+/* Every heap operation on the debug output, with DEBUG_ESP_HEAP_TRACE */
+
+void heap_trace_start( void );
+void heap_trace_stop( void );
 
 #ifdef __cplusplus
 }
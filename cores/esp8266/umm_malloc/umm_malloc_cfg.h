@@ -61,6 +61,18 @@ extern "C" {
  */
 
 /////////////////////////////////////////////////
+// the heap profiler keeps its books by call site (see heap.c)
+#if defined(DEBUG_ESP_HEAP_PROFILE) && !defined(DEBUG_ESP_OOM)
+#define DEBUG_ESP_OOM
+#endif
+// and the heap trace records them with it
+#if defined(DEBUG_ESP_HEAP_TRACE) && !defined(DEBUG_ESP_OOM)
+#define DEBUG_ESP_OOM
+#endif
+#if defined(DEBUG_ESP_HEAP_TRACE) && defined(DEBUG_ESP_HEAP_PROFILE)
+#error "DEBUG_ESP_HEAP_TRACE and DEBUG_ESP_HEAP_PROFILE can't be used together"
+#endif
+
 #ifdef DEBUG_ESP_OOM
 
 #define MEMLEAK_DEBUG
@@ -70,12 +82,21 @@ extern "C" {
 void *umm_malloc( size_t size );
 void *umm_calloc( size_t num, size_t size );
 void *umm_realloc( void *ptr, size_t size );
+#if defined(DEBUG_ESP_HEAP_PROFILE) || defined(DEBUG_ESP_HEAP_TRACE)
+// free() needs to account for the block too
+void umm_free( void *ptr );
+#else
 #define umm_free    free
+#endif
 #define umm_zalloc(s) umm_calloc(1,s)
 
 void* malloc_loc (size_t s, const char* file, int line);
 void* calloc_loc (size_t n, size_t s, const char* file, int line);
 void* realloc_loc (void* p, size_t s, const char* file, int line);
+#ifdef DEBUG_ESP_HEAP_PROFILE
+// for allocations charged to whoever called the allocating function
+void* malloc_caller (size_t s, const void* caller);
+#endif
 
 // *alloc are macro calling *alloc_loc calling+checking umm_*alloc()
 // they are defined at the bottom of this file
@@ -168,6 +189,59 @@ extern char _heap_start;
 
 #define UMM_HEAP_CORRUPTION_CB() panic()
 
+/*
+ * -D UMM_CHECK_FULL :
+ *
+ * UMM_INTEGRITY_CHECK and UMM_POISON check the heap incrementally: each
+ * operation checks the block it works on and the blocks next to it, which
+ * are those it changes, and UMM_CHECK_BLOCKS_PER_CALL more blocks of the
+ * heap, taken in turn. The cost of a call doesn't grow with the heap, and
+ * corruption anywhere is still found after some calls, if not on the first
+ * one after it happened.
+ *
+ * With UMM_CHECK_FULL the whole heap is checked before every operation
+ * instead, which makes debug builds much slower.
+ */
+/*
+#define UMM_CHECK_FULL
+*/
+
+#ifndef UMM_CHECK_BLOCKS_PER_CALL
+#define UMM_CHECK_BLOCKS_PER_CALL 8
+#endif
+
+/*
+ * -D UMM_SLAB :
+ *
+ * Serves small allocations from per-size-class free lists in front of the
+ * fit search: there are UMM_SLAB_CLASSES classes of 16, 32, 48... bytes,
+ * each with UMM_SLAB_SLOTS slots carved out of the bottom of the heap by
+ * umm_init(). Allocating or freeing a slot is O(1), and short-lived small
+ * buffers no longer split the large free blocks. When a class has no free
+ * slot left, the request falls through to the regular allocator.
+ *
+ * The slots are taken from the heap up front, whether they are used or not.
+ * umm_slab_stats() reports the use of every class, to help picking the
+ * numbers.
+ *
+ * Not available together with UMM_POISON.
+ */
+/*
+#define UMM_SLAB
+*/
+
+#if defined(UMM_SLAB) && defined(UMM_POISON)
+#undef UMM_SLAB
+#endif
+
+#ifndef UMM_SLAB_CLASSES
+#define UMM_SLAB_CLASSES 4
+#endif
+
+#ifndef UMM_SLAB_SLOTS
+#define UMM_SLAB_SLOTS 16
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,58 @@
+/*
+  yield_budget.h - how long the core's long loops run before they yield
+
+  This file is part of the esp8266 core for Arduino environment.
+
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef YIELD_BUDGET_H
+#define YIELD_BUDGET_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// How long the core's long loops run before they yield, per kind of work,
+// in us; each one calls yield_budget() where optimistic_yield() used
+// to be. YIELD_OP_ALL sets them all. With yield_budget_auto(target_us)
+// the budgets are scaled down, to 1/16 at most, while the system waits
+// longer than target_us for loop() to yield, and back up when it doesn't;
+// 0 turns that off.
+typedef enum {
+    YIELD_OP_FLASH,     // SPIFFS flash reads and writes, the flash queue (10 ms)
+    YIELD_OP_UPDATE,    // Updater writes (10 ms)
+    YIELD_OP_STREAM,    // Stream copies (1 ms)
+    YIELD_OP_SERIAL,    // HardwareSerial::available() with nothing to read (10 ms)
+    YIELD_OP_COUNT,
+    YIELD_OP_ALL = YIELD_OP_COUNT
+} yield_op_t;
+
+// the budgets above, in the order of yield_op_t
+#define YIELD_BUDGET_DEFAULTS_US { 10000, 10000, 1000, 10000 }
+
+void yield_budget(yield_op_t op);
+void yield_budget_set(yield_op_t op, uint32_t us);
+uint32_t yield_budget_get(yield_op_t op);
+void yield_budget_auto(uint32_t target_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YIELD_BUDGET_H
@@ -37,6 +37,7 @@ ArduinoOTAClass::ArduinoOTAClass()
 , _size(0)
 , _cmd(0)
 , _ota_port(0)
+, _window(0)
 , _start_callback(NULL)
 , _end_callback(NULL)
 , _error_callback(NULL)
@@ -188,6 +189,15 @@ void ArduinoOTAClass::_onRx(){
     _md5.trim();
     if(_md5.length() != 32)
       return;
+    // a newer espota.py offers to stream, on a line older versions of
+    // this code don't read: W<most it would send ahead>
+    _window = 0;
+    if(_udp_ota->peek() == 'W'){
+      _udp_ota->read();
+      _window = parseInt();
+      if(_window > ARDUINO_OTA_WINDOW)
+        _window = ARDUINO_OTA_WINDOW;
+    }
 
     ota_ip.addr = (uint32_t)_ota_ip;
 
@@ -264,7 +274,13 @@ void ArduinoOTAClass::_runUpdate() {
     _state = OTA_IDLE;
     return;
   }
-  _udp_ota->append("OK", 2);
+  if (_window) {
+    char ok[16];
+    sprintf(ok, "OK W%u", _window);
+    _udp_ota->append(ok, strlen(ok));
+  } else {
+    _udp_ota->append("OK", 2);
+  }
   _udp_ota->send(&ota_ip, _ota_udp_port);
   delay(100);
 
@@ -291,12 +307,20 @@ void ArduinoOTAClass::_runUpdate() {
     _state = OTA_IDLE;
   }
 
-  uint32_t written, total = 0;
+  // streaming, the acknowledgements are the total received, one line
+  // for every half window, so the uploader keeps sending meanwhile
+  if (_window)
+    client.setNoDelay(true);
+  uint32_t written, total = 0, acked = 0;
   while (!Update.isFinished() && client.connected()) {
-    int waited = 1000;
-    while (!client.available() && waited--)
-      delay(1);
-    if (!waited){
+    // wait for data without sleeping a millisecond each time, hashing
+    // what was written and erasing the flash ahead meanwhile
+    uint32_t start = millis();
+    while (!client.available() && client.connected() && millis() - start < 1000) {
+      if (!Update.hashNext() && !Update.eraseNext())
+        yield();
+    }
+    if (!client.available()){
 #ifdef OTA_DEBUG
       OTA_DEBUG.printf("Receive Failed\n");
 #endif
@@ -305,11 +329,17 @@ void ArduinoOTAClass::_runUpdate() {
         _error_callback(OTA_RECEIVE_ERROR);
       }
       _state = OTA_IDLE;
+      break;
     }
     written = Update.write(client);
     if (written > 0) {
-      client.print(written, DEC);
       total += written;
+      if (!_window) {
+        client.print(written, DEC);
+      } else if (total - acked >= _window / 2 || Update.isFinished()) {
+        client.printf("%u\n", total);
+        acked = total;
+      }
       if(_progress_callback) {
         _progress_callback(total, _size);
       }
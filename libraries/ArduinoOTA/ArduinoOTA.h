@@ -7,6 +7,13 @@
 
 class UdpContext;
 
+// Most the uploader may send ahead of the acknowledgements, when it asks
+// for the streaming mode; larger takes no more memory here, TCP keeps the
+// sender to what there is room for
+#ifndef ARDUINO_OTA_WINDOW
+#define ARDUINO_OTA_WINDOW 16384
+#endif
+
 typedef enum {
   OTA_IDLE,
   OTA_WAITAUTH,
@@ -83,6 +90,7 @@ class ArduinoOTAClass
     uint16_t _ota_udp_port;
     IPAddress _ota_ip;
     String _md5;
+    uint32_t _window; // 0 for one acknowledgement per write
 
     THandlerFunction _start_callback;
     THandlerFunction _end_callback;
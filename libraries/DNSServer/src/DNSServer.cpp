@@ -13,7 +13,6 @@ bool DNSServer::start(const uint16_t &port, const String &domainName,
                      const IPAddress &resolvedIP)
 {
   _port = port;
-  _buffer = NULL;
   _domainName = domainName;
   _resolvedIP[0] = resolvedIP[0];
   _resolvedIP[1] = resolvedIP[1];
@@ -36,8 +35,6 @@ void DNSServer::setTTL(const uint32_t &ttl)
 void DNSServer::stop()
 {
   _udp.stop();
-  free(_buffer);
-  _buffer = NULL;
 }
 
 void DNSServer::downcaseAndRemoveWwwPrefix(String &domainName)
@@ -48,116 +45,129 @@ void DNSServer::downcaseAndRemoveWwwPrefix(String &domainName)
 
 void DNSServer::processNextRequest()
 {
-  _currentPacketSize = _udp.parsePacket();
-  if (_currentPacketSize)
-  {
-    if (_buffer != NULL) free(_buffer);
-    _buffer = (unsigned char*)malloc(_currentPacketSize * sizeof(char));
-    if (_buffer == NULL) return;
-    _udp.read(_buffer, _currentPacketSize);
-    _dnsHeader = (DNSHeader*) _buffer;
-
-    if (_dnsHeader->QR == DNS_QR_QUERY &&
-        _dnsHeader->OPCode == DNS_OPCODE_QUERY &&
-        requestIncludesOnlyOneQuestion() &&
-        (_domainName == "*" || getDomainNameWithoutWwwPrefix() == _domainName)
-       )
-    {
-      replyWithIP();
-    }
-    else if (_dnsHeader->QR == DNS_QR_QUERY)
-    {
-      replyWithCustomCode();
-    }
+  // the queries are read where they were received, in the pbufs
+  _udp.parsePackets([this](const uint8_t* data, size_t size, const WiFiUDP::PacketInfo& info) {
+    processRequest(data, size, info.remoteIP, info.remotePort);
+  });
+}
 
-    free(_buffer);
-    _buffer = NULL;
+void DNSServer::processRequest(const uint8_t* packet, size_t size,
+                               const IPAddress &remoteIP, uint16_t remotePort)
+{
+  if (size < DNS_HEADER_SIZE) return;
+  // the payload of a pbuf may not be aligned for the 16 bit fields
+  DNSHeader header;
+  memcpy(&header, packet, DNS_HEADER_SIZE);
+
+  if (header.QR == DNS_QR_QUERY &&
+      header.OPCode == DNS_OPCODE_QUERY &&
+      requestIncludesOnlyOneQuestion(header) &&
+      (_domainName == "*" || requestMatchesDomainName(packet, size))
+     )
+  {
+    replyWithIP(packet, size, remoteIP, remotePort);
+  }
+  else if (header.QR == DNS_QR_QUERY)
+  {
+    replyWithCustomCode(packet, remoteIP, remotePort);
   }
 }
 
-bool DNSServer::requestIncludesOnlyOneQuestion()
+bool DNSServer::requestIncludesOnlyOneQuestion(const DNSHeader &header)
 {
-  return ntohs(_dnsHeader->QDCount) == 1 &&
-         _dnsHeader->ANCount == 0 &&
-         _dnsHeader->NSCount == 0 &&
-         _dnsHeader->ARCount == 0;
+  return ntohs(header.QDCount) == 1 &&
+         header.ANCount == 0 &&
+         header.NSCount == 0 &&
+         header.ARCount == 0;
 }
 
-String DNSServer::getDomainNameWithoutWwwPrefix()
+// Compares the name of the question, label by label, with _domainName,
+// ignoring case and a leading www.
+bool DNSServer::requestMatchesDomainName(const uint8_t* packet, size_t size)
 {
-  String parsedDomainName = "";
-  if (_buffer == NULL) return parsedDomainName;
-  unsigned char *start = _buffer + 12;
-  if (*start == 0)
+  size_t pos = DNS_HEADER_SIZE;
+  const char* domain = _domainName.c_str();
+
+  if (pos + 4 < size && packet[pos] == 3 && packet[pos + 4] != 0 &&
+      tolower(packet[pos + 1]) == 'w' &&
+      tolower(packet[pos + 2]) == 'w' &&
+      tolower(packet[pos + 3]) == 'w')
   {
-    return parsedDomainName;
+    pos += 4;
   }
-  int pos = 0;
-  while(true)
+
+  while (pos < size)
   {
-    unsigned char labelLength = *(start + pos);
-    for(int i = 0; i < labelLength; i++)
+    unsigned char labelLength = packet[pos++];
+    if (labelLength == 0)
+    {
+      return *domain == 0;
+    }
+    // no compression pointers in a single question
+    if (labelLength > 63 || pos + labelLength >= size)
     {
-      pos++;
-      parsedDomainName += (char)*(start + pos);
+      return false;
     }
-    pos++;
-    if (*(start + pos) == 0)
+    if (domain != _domainName.c_str() && *domain++ != '.')
     {
-      downcaseAndRemoveWwwPrefix(parsedDomainName);
-      return parsedDomainName;
+      return false;
     }
-    else
+    for (int i = 0; i < labelLength; i++)
     {
-      parsedDomainName += ".";
+      if (*domain == 0 || tolower(packet[pos++]) != *domain++)
+      {
+        return false;
+      }
     }
   }
+  return false;
 }
 
-void DNSServer::replyWithIP()
+void DNSServer::replyWithIP(const uint8_t* packet, size_t size,
+                            const IPAddress &remoteIP, uint16_t remotePort)
 {
-  if (_buffer == NULL) return;
-  _dnsHeader->QR = DNS_QR_RESPONSE;
-  _dnsHeader->ANCount = _dnsHeader->QDCount;
-  _dnsHeader->QDCount = _dnsHeader->QDCount; 
-  //_dnsHeader->RA = 1;  
-
-  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
-  _udp.write(_buffer, _currentPacketSize);
-
-  _udp.write((uint8_t)192); //  answer name is a pointer
-  _udp.write((uint8_t)12);  // pointer to offset at 0x00c
-
-  _udp.write((uint8_t)0);   // 0x0001  answer is type A query (host address)
-  _udp.write((uint8_t)1);
-
-  _udp.write((uint8_t)0);   //0x0001 answer is class IN (internet address)
-  _udp.write((uint8_t)1);
- 
-  _udp.write((unsigned char*)&_ttl, 4);
-
+  // the reply is built right in the pbuf that is sent
+  _udp.beginPacket(remoteIP, remotePort);
+  uint8_t* reply = _udp.reserve(size + DNS_ANSWER_SIZE);
+  if (reply == NULL) return;
+  memcpy(reply, packet, size);
+
+  DNSHeader* dnsHeader = (DNSHeader*) reply;
+  dnsHeader->QR = DNS_QR_RESPONSE;
+  dnsHeader->ANCount = dnsHeader->QDCount;
+  //dnsHeader->RA = 1;
+
+  uint8_t* answer = reply + size;
+  answer[0] = 192;  // answer name is a pointer
+  answer[1] = 12;   // pointer to offset at 0x00c
+  answer[2] = 0;    // 0x0001  answer is type A query (host address)
+  answer[3] = 1;
+  answer[4] = 0;    // 0x0001 answer is class IN (internet address)
+  answer[5] = 1;
+  memcpy(answer + 6, &_ttl, 4);
   // Length of RData is 4 bytes (because, in this case, RData is IPv4)
-  _udp.write((uint8_t)0);
-  _udp.write((uint8_t)4);
-  _udp.write(_resolvedIP, sizeof(_resolvedIP));
+  answer[10] = 0;
+  answer[11] = 4;
+  memcpy(answer + 12, _resolvedIP, sizeof(_resolvedIP));
   _udp.endPacket();
 
-
-
   #ifdef DEBUG_ESP_DNS
-    DEBUG_ESP_PORT.printf("DNS responds: %s for %s\n",
-            IPAddress(_resolvedIP).toString().c_str(), getDomainNameWithoutWwwPrefix().c_str() );
+    DEBUG_ESP_PORT.printf("DNS responds: %s to %s\n",
+            IPAddress(_resolvedIP).toString().c_str(), remoteIP.toString().c_str());
   #endif
 }
 
-void DNSServer::replyWithCustomCode()
+void DNSServer::replyWithCustomCode(const uint8_t* packet,
+                                    const IPAddress &remoteIP, uint16_t remotePort)
 {
-  if (_buffer == NULL) return;
-  _dnsHeader->QR = DNS_QR_RESPONSE;
-  _dnsHeader->RCode = (unsigned char)_errorReplyCode;
-  _dnsHeader->QDCount = 0;
-
-  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
-  _udp.write(_buffer, sizeof(DNSHeader));
+  _udp.beginPacket(remoteIP, remotePort);
+  uint8_t* reply = _udp.reserve(DNS_HEADER_SIZE);
+  if (reply == NULL) return;
+  memcpy(reply, packet, DNS_HEADER_SIZE);
+
+  DNSHeader* dnsHeader = (DNSHeader*) reply;
+  dnsHeader->QR = DNS_QR_RESPONSE;
+  dnsHeader->RCode = (unsigned char)_errorReplyCode;
+  dnsHeader->QDCount = 0;
   _udp.endPacket();
 }
@@ -5,6 +5,8 @@
 #define DNS_QR_QUERY 0
 #define DNS_QR_RESPONSE 1
 #define DNS_OPCODE_QUERY 0
+#define DNS_HEADER_SIZE 12
+#define DNS_ANSWER_SIZE 16  // name pointer, type, class, ttl, length, IPv4 address
 
 enum class DNSReplyCode
 {
@@ -40,6 +42,7 @@ class DNSServer
 {
   public:
     DNSServer();
+    // Answers all the queries received since the last call
     void processNextRequest();
     void setErrorReplyCode(const DNSReplyCode &replyCode);
     void setTTL(const uint32_t &ttl);
@@ -54,18 +57,19 @@ class DNSServer
   private:
     WiFiUDP _udp;
     uint16_t _port;
-    String _domainName;
+    String _domainName;     // lowercase, without www.
     unsigned char _resolvedIP[4];
-    int _currentPacketSize;
-    unsigned char* _buffer;
-    DNSHeader* _dnsHeader;
     uint32_t _ttl;
     DNSReplyCode _errorReplyCode;
 
     void downcaseAndRemoveWwwPrefix(String &domainName);
-    String getDomainNameWithoutWwwPrefix();
-    bool requestIncludesOnlyOneQuestion();
-    void replyWithIP();
-    void replyWithCustomCode();
+    void processRequest(const uint8_t* packet, size_t size,
+                        const IPAddress &remoteIP, uint16_t remotePort);
+    bool requestIncludesOnlyOneQuestion(const DNSHeader &header);
+    bool requestMatchesDomainName(const uint8_t* packet, size_t size);
+    void replyWithIP(const uint8_t* packet, size_t size,
+                     const IPAddress &remoteIP, uint16_t remotePort);
+    void replyWithCustomCode(const uint8_t* packet,
+                             const IPAddress &remoteIP, uint16_t remotePort);
 };
 #endif
\ No newline at end of file
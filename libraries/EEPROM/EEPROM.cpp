@@ -28,6 +28,7 @@ extern "C" {
 #include "os_type.h"
 #include "osapi.h"
 #include "spi_flash.h"
+#include "FlashQueue.h"
 }
 
 extern "C" uint32_t _SPIFFS_end;
@@ -120,14 +121,13 @@ bool EEPROMClass::commit() {
   if(!_data)
     return false;
 
-  noInterrupts();
-  if(spi_flash_erase_sector(_sector) == SPI_FLASH_RESULT_OK) {
-    if(spi_flash_write(_sector * SPI_FLASH_SEC_SIZE, reinterpret_cast<uint32_t*>(_data), _size) == SPI_FLASH_RESULT_OK) {
-      _dirty = false;
-      ret = true;
-    }
+  // the flash sensitive interrupts are masked for each job, the others
+  // stay on
+  if(flash_queue_erase_now(_sector, 1) &&
+     flash_queue_write_now(_sector * SPI_FLASH_SEC_SIZE, reinterpret_cast<uint32_t*>(_data), _size)) {
+    _dirty = false;
+    ret = true;
   }
-  interrupts();
 
   return ret;
 }
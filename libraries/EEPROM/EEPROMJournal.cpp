@@ -0,0 +1,392 @@
+/*
+  EEPROMJournal.cpp - esp8266 EEPROM emulation that appends what changed
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "EEPROMJournal.h"
+
+/*
+  Every sector starts with the magic number and its sequence number, one
+  more than that of the sector before, and then holds commits until it is
+  full. A commit is its length and a checksum, then for every run of
+  changed bytes their offset and length (16 bits each) and the bytes,
+  padded to 4. The first commit of a sector is all of the data, so only
+  the sector with the highest sequence number is read back.
+*/
+#define JOURNAL_MAGIC         0x314a4545
+#define SECTOR_HEADER_SIZE    8
+#define COMMIT_HEADER_SIZE    8
+#define ENTRY_HEADER_SIZE     4
+
+static uint32_t journalHash(uint32_t hash, const uint8_t* data, size_t size) {
+  while (size--) {
+    hash = (hash ^ *data++) * 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t journalSeed(uint32_t sequence) {
+  return journalHash(2166136261u, (const uint8_t*) &sequence, sizeof(sequence));
+}
+
+EEPROMJournal::EEPROMJournal(uint32_t sector, size_t sectors)
+: _sector(sector)
+, _sectors(sectors)
+, _data(0)
+, _dirty(0)
+, _size(0)
+, _anyDirty(false)
+, _current(sectors)
+, _sequence(0)
+, _writePos(EEPROM_JOURNAL_SECTOR_SIZE)
+{
+}
+
+EEPROMJournal::~EEPROMJournal() {
+  delete[] _data;
+  delete[] _dirty;
+}
+
+void EEPROMJournal::begin(size_t size) {
+  if (size <= 0 || _sectors < 2)
+    return;
+  if (size > EEPROM_JOURNAL_MAX_SIZE)
+    size = EEPROM_JOURNAL_MAX_SIZE;
+
+  size = (size + 3) & (~3);
+
+  //In case begin() is called a 2nd+ time, don't reallocate if size is the same
+  size_t dirtySize = ((size + EEPROM_JOURNAL_CHUNK - 1) / EEPROM_JOURNAL_CHUNK + 7) / 8;
+  if (_data && size != _size) {
+    delete[] _data;
+    delete[] _dirty;
+    _data = 0;
+  }
+  if (!_data) {
+    _data = new uint8_t[size];
+    _dirty = new uint8_t[dirtySize];
+  }
+
+  _size = size;
+  memset(_data, 0xff, _size);
+  memset(_dirty, 0, dirtySize);
+  _anyDirty = false;
+
+  // the newest sector that starts with a whole copy; one that doesn't was
+  // cut short while it was being written, the one before is still there
+  _current = _sectors;
+  _sequence = 0;
+  _writePos = EEPROM_JOURNAL_SECTOR_SIZE;
+  uint32_t below = 0xffffffff;
+  uint32_t highest = 0;
+  while (true) {
+    size_t found = _sectors;
+    uint32_t foundSequence = 0;
+    for (size_t i = 0; i < _sectors; ++i) {
+      uint32_t header[2];
+      if (_flashRead(i * EEPROM_JOURNAL_SECTOR_SIZE, header, sizeof(header)) &&
+          header[0] == JOURNAL_MAGIC && header[1] < below &&
+          (found == _sectors || header[1] > foundSequence)) {
+        found = i;
+        foundSequence = header[1];
+      }
+    }
+    if (found == _sectors) {
+      // none is whole: the next one written has to come after them all
+      _sequence = highest;
+      break;
+    }
+    if (below == 0xffffffff)
+      highest = foundSequence;
+    if (_replay(found, foundSequence))
+      break;
+    below = foundSequence;
+  }
+}
+
+void EEPROMJournal::end() {
+  if (!_size)
+    return;
+
+  commit();
+  delete[] _data;
+  delete[] _dirty;
+  _data = 0;
+  _dirty = 0;
+  _size = 0;
+  _anyDirty = false;
+}
+
+uint8_t EEPROMJournal::read(int const address) {
+  if (address < 0 || (size_t)address >= _size)
+    return 0;
+  if(!_data)
+    return 0;
+
+  return _data[address];
+}
+
+void EEPROMJournal::write(int const address, uint8_t const value) {
+  if (address < 0 || (size_t)address >= _size)
+    return;
+  if(!_data)
+    return;
+
+  if (_data[address] != value) {
+    _data[address] = value;
+    _changed(address, 1);
+  }
+}
+
+bool EEPROMJournal::commit() {
+  if (!_size)
+    return false;
+  if (!_anyDirty)
+    return true;
+  if (!_data)
+    return false;
+
+  // appended if there is room, else everything goes to the next sector
+  bool ok = (_current < _sectors && _append(false)) || _compact();
+  if (ok) {
+    memset(_dirty, 0, ((_size + EEPROM_JOURNAL_CHUNK - 1) / EEPROM_JOURNAL_CHUNK + 7) / 8);
+    _anyDirty = false;
+  }
+  return ok;
+}
+
+uint8_t * EEPROMJournal::getDataPtr() {
+  _changed(0, _size);
+  return &_data[0];
+}
+
+uint8_t const * EEPROMJournal::getConstDataPtr() const {
+  return &_data[0];
+}
+
+void EEPROMJournal::_changed(size_t address, size_t size) {
+  if (!size)
+    return;
+  for (size_t chunk = address / EEPROM_JOURNAL_CHUNK; chunk <= (address + size - 1) / EEPROM_JOURNAL_CHUNK; ++chunk) {
+    _dirty[chunk / 8] |= 1 << (chunk % 8);
+  }
+  _anyDirty = true;
+}
+
+bool EEPROMJournal::_replay(size_t sector, uint32_t sequence) {
+  uint32_t base = sector * EEPROM_JOURNAL_SECTOR_SIZE;
+  uint32_t pos = SECTOR_HEADER_SIZE;
+  bool first = true;
+  _sequence = sequence;
+  while (pos + COMMIT_HEADER_SIZE <= EEPROM_JOURNAL_SECTOR_SIZE) {
+    uint32_t header[2];
+    if (!_flashRead(base + pos, header, sizeof(header)))
+      return false;
+    if (header[0] == 0xffffffff)
+      break;
+    size_t snapshot = 0;
+    if (header[0] == 0 || (header[0] & 3) || header[0] > EEPROM_JOURNAL_SECTOR_SIZE - pos - COMMIT_HEADER_SIZE ||
+        !_checkCommit(base + pos + COMMIT_HEADER_SIZE, header[0], header[1], snapshot)) {
+      // cut short: nothing more can be written after it
+      pos = EEPROM_JOURNAL_SECTOR_SIZE;
+      break;
+    }
+    if (first && !snapshot)
+      return false;
+    if (!_applyCommit(base + pos + COMMIT_HEADER_SIZE, header[0]))
+      return false;
+    first = false;
+    pos += COMMIT_HEADER_SIZE + header[0];
+  }
+  if (first)
+    return false;
+  _current = sector;
+  _writePos = pos;
+  return true;
+}
+
+// true if the payload has the checksum; snapshot is set if it has the
+// data from offset 0 in one piece
+bool EEPROMJournal::_checkCommit(uint32_t address, uint32_t length, uint32_t checksum, size_t& snapshot) {
+  uint32_t hash = journalSeed(_sequence);
+  uint32_t buf[16];
+  for (uint32_t pos = 0; pos < length; pos += sizeof(buf)) {
+    size_t piece = (length - pos < sizeof(buf)) ? length - pos : sizeof(buf);
+    if (!_flashRead(address + pos, buf, piece))
+      return false;
+    if (pos == 0) {
+      uint32_t offset = buf[0] & 0xffff;
+      uint32_t size = buf[0] >> 16;
+      snapshot = offset == 0 && ENTRY_HEADER_SIZE + ((size + 3) & ~3) == length;
+    }
+    hash = journalHash(hash, (const uint8_t*) buf, piece);
+  }
+  return hash == checksum;
+}
+
+bool EEPROMJournal::_applyCommit(uint32_t address, uint32_t length) {
+  uint32_t pos = 0;
+  while (pos < length) {
+    uint32_t entry;
+    if (!_flashRead(address + pos, &entry, sizeof(entry)))
+      return false;
+    uint32_t offset = entry & 0xffff;
+    uint32_t size = entry >> 16;
+    pos += ENTRY_HEADER_SIZE;
+    if (pos + size > length)
+      return false;
+    uint32_t buf[16];
+    for (uint32_t done = 0; done < size; done += sizeof(buf)) {
+      size_t piece = (size - done < sizeof(buf)) ? size - done : sizeof(buf);
+      if (!_flashRead(address + pos + done, buf, (piece + 3) & ~3))
+        return false;
+      // what is beyond the size given to begin() is dropped
+      for (size_t i = 0; i < piece; ++i) {
+        if (offset + done + i < _size)
+          _data[offset + done + i] = ((const uint8_t*) buf)[i];
+      }
+    }
+    pos += (size + 3) & ~3;
+  }
+  return true;
+}
+
+bool EEPROMJournal::_append(bool snapshot) {
+  uint32_t base = _current * EEPROM_JOURNAL_SECTOR_SIZE;
+  // the first pass only counts, the second writes
+  uint32_t length = 0;
+  uint32_t checksum = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    uint32_t pos = _writePos + COMMIT_HEADER_SIZE;
+    uint32_t hash = journalSeed(_sequence);
+    if (pass == 1) {
+      uint32_t header[2] = { length, checksum };
+      if (_writePos + COMMIT_HEADER_SIZE + length > EEPROM_JOURNAL_SECTOR_SIZE)
+        return false;
+      if (!_flashWrite(base + _writePos, header, sizeof(header))) {
+        _writePos = EEPROM_JOURNAL_SECTOR_SIZE;
+        return false;
+      }
+    }
+    size_t chunks = (_size + EEPROM_JOURNAL_CHUNK - 1) / EEPROM_JOURNAL_CHUNK;
+    for (size_t chunk = 0; chunk < chunks; ) {
+      if (!snapshot && !(_dirty[chunk / 8] & (1 << (chunk % 8)))) {
+        ++chunk;
+        continue;
+      }
+      size_t end = chunk + 1;
+      while (end < chunks && (snapshot || (_dirty[end / 8] & (1 << (end % 8)))))
+        ++end;
+      uint32_t offset = chunk * EEPROM_JOURNAL_CHUNK;
+      uint32_t size = end * EEPROM_JOURNAL_CHUNK;
+      if (size > _size)
+        size = _size;
+      size -= offset;
+      chunk = end;
+
+      uint32_t buf[16];
+      buf[0] = offset | (size << 16);
+      hash = journalHash(hash, (const uint8_t*) buf, ENTRY_HEADER_SIZE);
+      if (pass == 1 && !_flashWrite(base + pos, buf, ENTRY_HEADER_SIZE)) {
+        _writePos = EEPROM_JOURNAL_SECTOR_SIZE;
+        return false;
+      }
+      pos += ENTRY_HEADER_SIZE;
+      for (uint32_t done = 0; done < size; done += sizeof(buf)) {
+        size_t piece = (size - done < sizeof(buf)) ? size - done : sizeof(buf);
+        size_t padded = (piece + 3) & ~3;
+        memset((uint8_t*) buf + piece, 0xff, padded - piece);
+        memcpy(buf, _data + offset + done, piece);
+        hash = journalHash(hash, (const uint8_t*) buf, padded);
+        if (pass == 1 && !_flashWrite(base + pos, buf, padded)) {
+          _writePos = EEPROM_JOURNAL_SECTOR_SIZE;
+          return false;
+        }
+        pos += padded;
+      }
+      if (pass == 0 && !snapshot && pos - _writePos - COMMIT_HEADER_SIZE >= _size) {
+        // as big as a whole copy, which also makes room
+        return false;
+      }
+    }
+    length = pos - _writePos - COMMIT_HEADER_SIZE;
+    checksum = hash;
+  }
+  _writePos += COMMIT_HEADER_SIZE + length;
+  return true;
+}
+
+bool EEPROMJournal::_compact() {
+  size_t current = _current;
+  uint32_t sequence = _sequence;
+  uint32_t writePos = _writePos;
+
+  _current = (current < _sectors) ? (current + 1) % _sectors : 0;
+  _sequence = sequence + 1;
+  _writePos = SECTOR_HEADER_SIZE;
+  uint32_t header[2] = { JOURNAL_MAGIC, _sequence };
+  if (_flashErase(_current) &&
+      _flashWrite(_current * EEPROM_JOURNAL_SECTOR_SIZE, header, sizeof(header)) &&
+      _append(true)) {
+    return true;
+  }
+  // the sector before is still the one begin() finds
+  _current = current;
+  _sequence = sequence;
+  _writePos = (writePos < EEPROM_JOURNAL_SECTOR_SIZE) ? writePos : EEPROM_JOURNAL_SECTOR_SIZE;
+  return false;
+}
+
+#ifdef ARDUINO
+
+bool EEPROMJournal::_flashRead(uint32_t address, uint32_t* data, size_t size) {
+  return ESP.flashRead(_sector * EEPROM_JOURNAL_SECTOR_SIZE + address, data, size);
+}
+
+bool EEPROMJournal::_flashWrite(uint32_t address, const uint32_t* data, size_t size) {
+  return ESP.flashWrite(_sector * EEPROM_JOURNAL_SECTOR_SIZE + address, const_cast<uint32_t*>(data), size);
+}
+
+bool EEPROMJournal::_flashErase(uint32_t sector) {
+  return ESP.flashEraseSector(_sector + sector);
+}
+
+#else
+
+// host tests give their own flash
+bool EEPROMJournal::_flashRead(uint32_t address, uint32_t* data, size_t size) {
+  (void) address;
+  (void) data;
+  (void) size;
+  return false;
+}
+
+bool EEPROMJournal::_flashWrite(uint32_t address, const uint32_t* data, size_t size) {
+  (void) address;
+  (void) data;
+  (void) size;
+  return false;
+}
+
+bool EEPROMJournal::_flashErase(uint32_t sector) {
+  (void) sector;
+  return false;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+  EEPROMJournal.h - esp8266 EEPROM emulation that appends what changed
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef EEPROMJournal_h
+#define EEPROMJournal_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+  The same interface as EEPROMClass, but commit() appends the bytes that
+  changed to a journal instead of erasing and rewriting the sector. Only
+  when the sector is full is everything written to the next one, so the
+  sectors are erased in turn, once every few hundred small commits.
+
+  It needs two or more sectors of its own, which aren't the one EEPROM
+  uses, for example the last ones of the SPIFFS area with SPIFFS not used
+  or made smaller. The size is at most EEPROM_JOURNAL_MAX_SIZE, the space
+  left in a sector for a full copy.
+
+  A commit cut short by a reset is not seen by begin(), which finds the
+  data as of the commit before.
+*/
+
+#define EEPROM_JOURNAL_SECTOR_SIZE  4096
+#define EEPROM_JOURNAL_MAX_SIZE     (EEPROM_JOURNAL_SECTOR_SIZE - 20)
+// bytes that are marked changed together
+#define EEPROM_JOURNAL_CHUNK        8
+
+class EEPROMJournal {
+public:
+  EEPROMJournal(uint32_t sector, size_t sectors);
+  virtual ~EEPROMJournal();
+
+  void begin(size_t size);
+  uint8_t read(int const address);
+  void write(int const address, uint8_t const val);
+  bool commit();
+  void end();
+
+  uint8_t * getDataPtr();
+  uint8_t const * getConstDataPtr() const;
+
+  template<typename T>
+  T &get(int const address, T &t) {
+    if (address < 0 || address + sizeof(T) > _size)
+      return t;
+
+    memcpy((uint8_t*) &t, _data + address, sizeof(T));
+    return t;
+  }
+
+  template<typename T>
+  const T &put(int const address, const T &t) {
+    if (address < 0 || address + sizeof(T) > _size)
+      return t;
+    if (memcmp(_data + address, (const uint8_t*)&t, sizeof(T)) != 0) {
+      memcpy(_data + address, (const uint8_t*)&t, sizeof(T));
+      _changed(address, sizeof(T));
+    }
+
+    return t;
+  }
+
+  size_t length() {return _size;}
+
+  uint8_t& operator[](int const address) {return getDataPtr()[address];}
+  uint8_t const & operator[](int const address) const {return getConstDataPtr()[address];}
+
+protected:
+  // the flash, addresses from the first sector given; true if it worked
+  virtual bool _flashRead(uint32_t address, uint32_t* data, size_t size);
+  virtual bool _flashWrite(uint32_t address, const uint32_t* data, size_t size);
+  virtual bool _flashErase(uint32_t sector);
+
+  void _changed(size_t address, size_t size);
+  bool _replay(size_t sector, uint32_t sequence);
+  bool _checkCommit(uint32_t address, uint32_t length, uint32_t checksum, size_t& snapshot);
+  bool _applyCommit(uint32_t address, uint32_t length);
+  bool _append(bool snapshot);
+  bool _compact();
+
+  uint32_t _sector;
+  size_t _sectors;
+  uint8_t* _data;
+  uint8_t* _dirty;  // a bit for every EEPROM_JOURNAL_CHUNK bytes
+  size_t _size;
+  bool _anyDirty;
+
+  size_t _current;      // the sector written to, _sectors if none yet
+  uint32_t _sequence;   // of the current sector, higher for each new one
+  uint32_t _writePos;   // in the current sector, where the next commit goes
+};
+
+#endif
@@ -0,0 +1,40 @@
+/*
+   EEPROM Journal
+
+   Counts how many times the board was started. A commit with
+   EEPROMJournal writes only the bytes that changed, so the flash
+   sectors are erased once every few hundred commits instead of
+   every time.
+
+   It uses the last two sectors of the SPIFFS area, so this sketch
+   must not use SPIFFS, or has to be built with a flash layout
+   that leaves SPIFFS room for them.
+*/
+
+#include <EEPROMJournal.h>
+
+extern "C" uint32_t _SPIFFS_end;
+
+#define JOURNAL_SECTORS 2
+
+EEPROMJournal journal(((uint32_t)&_SPIFFS_end - 0x40200000) / SPI_FLASH_SEC_SIZE - JOURNAL_SECTORS, JOURNAL_SECTORS);
+
+void setup() {
+  Serial.begin(115200);
+  journal.begin(64);
+
+  uint32_t boots;
+  journal.get(0, boots);
+  if (boots == 0xffffffff) {
+    // never written
+    boots = 0;
+  }
+  ++boots;
+  journal.put(0, boots);
+  journal.commit();
+
+  Serial.printf("\nstarted %u times\n", boots);
+}
+
+void loop() {
+}
@@ -54,9 +54,14 @@ void ESP8266AVRISP::setSpiFrequency(uint32_t freq) {
     _spi_freq = freq;
     if (_state == AVRISP_STATE_ACTIVE) {
         SPI.setFrequency(freq);
+        _spi_fast = false;
     }
 }
 
+void ESP8266AVRISP::setSpiFastFrequency(uint32_t freq) {
+    _spi_fast_freq = freq;
+}
+
 void ESP8266AVRISP::setReset(bool rst) {
     _reset_state = rst;
     digitalWrite(_reset_pin, _resetLevel(_reset_state));
@@ -85,6 +90,8 @@ AVRISPState_t ESP8266AVRISP::update() {
                 _client.stop();
                 AVRISP_DEBUG("client disconnect");
                 if (pmode) {
+                    // it has been acknowledged
+                    program_flush();
                     SPI.end();
                     pmode = 0;
                 }
@@ -112,6 +119,7 @@ AVRISPState_t ESP8266AVRISP::serve() {
             while (_client.available()) {
                 avrisp();
             }
+            program_step(AVRISP_PROG_WORDS);
             return update();
         }
     }
@@ -122,8 +130,15 @@ inline void ESP8266AVRISP::_reject_incoming(void) {
     while (_server.hasClient()) _server.available().stop();
 }
 
+void ESP8266AVRISP::wait_data() {
+    while (!_client.available()) {
+        program_step(AVRISP_PROG_WORDS);
+        yield();
+    }
+}
+
 uint8_t ESP8266AVRISP::getch() {
-    while (!_client.available()) yield();
+    wait_data();
     uint8_t b = (uint8_t)_client.read();
     // AVRISP_DEBUG("< %02x", b);
     return b;
@@ -131,8 +146,10 @@ uint8_t ESP8266AVRISP::getch() {
 
 void ESP8266AVRISP::fill(int n) {
     // AVRISP_DEBUG("fill(%u)", n);
-    for (int x = 0; x < n; x++) {
-        buff[x] = getch();
+    int x = 0;
+    while (x < n) {
+        wait_data();
+        x += _client.read(buff + x, n - x);
     }
 }
 
@@ -214,6 +231,7 @@ void ESP8266AVRISP::start_pmode() {
     SPI.begin();
     SPI.setFrequency(_spi_freq);
     SPI.setHwCs(false);
+    _spi_fast = false;
 
     // try to sync the bus
     SPI.transfer(0x00);
@@ -236,6 +254,11 @@ void ESP8266AVRISP::universal() {
     uint8_t ch;
 
     fill(4);
+    // new fuses may slow the target's clock down
+    if (_spi_fast && buff[0] == 0xAC && (buff[1] == 0xA0 || buff[1] == 0xA8 || buff[1] == 0xA4)) {
+        SPI.setFrequency(_spi_freq);
+        _spi_fast = false;
+    }
     ch = spi_transaction(buff[0], buff[1], buff[2], buff[3]);
     breply(ch);
 }
@@ -247,9 +270,11 @@ void ESP8266AVRISP::flash(uint8_t hilo, int addr, uint8_t data) {
                     data);
 }
 
+// the target is busy for AVRISP_PTIME, see program_step()
 void ESP8266AVRISP::commit(int addr) {
     spi_transaction(0x4C, (addr >> 8) & 0xFF, addr & 0xFF, 0);
-    delay(AVRISP_PTIME);
+    _commit_ms = millis();
+    _commit_pending = true;
 }
 
 //#define _addr_page(x) (here & 0xFFFFE0)
@@ -263,33 +288,60 @@ int ESP8266AVRISP::addr_page(int addr) {
 }
 
 
+// The page is acknowledged as soon as it is in, and programmed while the
+// next one comes, see wait_data()
 void ESP8266AVRISP::write_flash(int length) {
     fill(length);
 
     if (Sync_CRC_EOP == getch()) {
+        program_flush();
+        memcpy(_prog, buff, length);
+        _prog_len = length;
+        _prog_pos = 0;
+        _prog_here = here;
+        _prog_page = addr_page(here);
+        here += (length + 1) / 2;
         _client.print((char) Resp_STK_INSYNC);
-        _client.print((char) write_flash_pages(length));
+        _client.print((char) Resp_STK_OK);
     } else {
       error++;
       _client.print((char) Resp_STK_NOSYNC);
     }
 }
 
-uint8_t ESP8266AVRISP::write_flash_pages(int length) {
-    int x = 0;
-    int page = addr_page(here);
-    while (x < length) {
-        yield();
-        if (page != addr_page(here)) {
-            commit(page);
-            page = addr_page(here);
+// Load up to words of the queued page into the target, committing each
+// target page filled; the next one is loaded once the commit is over.
+bool ESP8266AVRISP::program_step(int words) {
+    if (_commit_pending) {
+        if (millis() - _commit_ms < AVRISP_PTIME) {
+            return true;
         }
-        flash(LOW, here, buff[x++]);
-        flash(HIGH, here, buff[x++]);
-        here++;
+        _commit_pending = false;
+    }
+    if (!_prog_len) {
+        return false;
+    }
+    while (words-- > 0 && _prog_pos < _prog_len) {
+        if (_prog_page != addr_page(_prog_here)) {
+            commit(_prog_page);
+            _prog_page = addr_page(_prog_here);
+            return true;
+        }
+        flash(LOW, _prog_here, _prog[_prog_pos++]);
+        flash(HIGH, _prog_here, _prog[_prog_pos++]);
+        _prog_here++;
+    }
+    if (_prog_pos >= _prog_len) {
+        commit(_prog_page);
+        _prog_len = 0;
+    }
+    return true;
+}
+
+void ESP8266AVRISP::program_flush() {
+    while (program_step(AVRISP_PROG_WORDS)) {
+        yield();
     }
-    commit(page);
-    return Resp_STK_OK;
 }
 
 uint8_t ESP8266AVRISP::write_eeprom(int length) {
@@ -335,6 +387,7 @@ void ESP8266AVRISP::program_page() {
     }
 
     if (memtype == 'E') {
+        program_flush();
         result = (char)write_eeprom(length);
         if (Sync_CRC_EOP == getch()) {
             _client.print((char) Resp_STK_INSYNC);
@@ -408,12 +461,23 @@ void ESP8266AVRISP::read_signature() {
     }
     _client.print((char) Resp_STK_INSYNC);
 
-    uint8_t high = spi_transaction(0x30, 0x00, 0x00, 0x00);
-    _client.print((char) high);
-    uint8_t middle = spi_transaction(0x30, 0x00, 0x01, 0x00);
-    _client.print((char) middle);
-    uint8_t low = spi_transaction(0x30, 0x00, 0x02, 0x00);
-    _client.print((char) low);
+    uint8_t sig[3];
+    for (int x = 0; x < 3; x++) {
+        sig[x] = spi_transaction(0x30, 0x00, x, 0x00);
+    }
+    // a target that gives the same answer at the fast clock keeps it
+    if (!_spi_fast && _spi_fast_freq > _spi_freq && sig[0] != 0x00 && sig[0] != 0xFF) {
+        SPI.setFrequency(_spi_fast_freq);
+        _spi_fast = true;
+        for (int x = 0; x < 3; x++) {
+            if (spi_transaction(0x30, 0x00, x, 0x00) != sig[x]) {
+                SPI.setFrequency(_spi_freq);
+                _spi_fast = false;
+                break;
+            }
+        }
+    }
+    _client.write((const uint8_t *)sig, (size_t)3);
     _client.print((char) Resp_STK_OK);
 }
 
@@ -427,6 +491,11 @@ void ESP8266AVRISP::avrisp() {
     (void) low;
     (void) high;
     // AVRISP_DEBUG("CMD 0x%02x", ch);
+    // the queued page must be in the target before anything else is done
+    // with it; pages and their addresses keep coming meanwhile
+    if (ch != Cmnd_STK_LOAD_ADDRESS && ch != Cmnd_STK_PROG_PAGE) {
+        program_flush();
+    }
     switch (ch) {
     case Cmnd_STK_GET_SYNC:
         error = 0;
@@ -19,6 +19,11 @@ Original version:
 
 // SPI clock frequency in Hz
 #define AVRISP_SPI_FREQ   300e3
+// SPI clock frequency used once the target reads its signature back the
+// same at it, 0 to stay at the one above
+#define AVRISP_SPI_FREQ_FAST 1e6
+// flash words loaded into the target between checks for incoming data
+#define AVRISP_PROG_WORDS 16
 
 // programmer states
 typedef enum {
@@ -54,6 +59,10 @@ public:
     // set the SPI clock frequency
     void setSpiFrequency(uint32_t);
 
+    // set the SPI clock frequency to switch to after reading the signature
+    // see AVRISP_SPI_FREQ_FAST
+    void setSpiFastFrequency(uint32_t);
+
     // control the state of the RESET pin of the target
     // see AVRISP_ACTIVE_HIGH_RESET
     void setReset(bool);
@@ -73,6 +82,7 @@ protected:
 
     void avrisp(void);           // handle incoming STK500 commands
 
+    void wait_data(void);       // program the queued page until data comes
     uint8_t getch(void);        // retrieve a character from the remote end
     uint8_t spi_transaction(uint8_t, uint8_t, uint8_t, uint8_t);
     void empty_reply(void);
@@ -83,7 +93,8 @@ protected:
     int addr_page(int);
     void flash(uint8_t, int, uint8_t);
     void write_flash(int);
-    uint8_t write_flash_pages(int length);
+    bool program_step(int words);   // false once the queued page is done
+    void program_flush(void);       // finish the queued page
     uint8_t write_eeprom(int length);
     uint8_t write_eeprom_chunk(int start, int length);
     void commit(int addr);
@@ -103,6 +114,8 @@ protected:
     inline bool _resetLevel(bool reset_state) { return reset_state == _reset_activehigh; }
 
     uint32_t _spi_freq;
+    uint32_t _spi_fast_freq = AVRISP_SPI_FREQ_FAST;
+    bool _spi_fast = false;     // running at _spi_fast_freq
     WiFiServer _server;
     WiFiClient _client;
     AVRISPState_t _state;
@@ -114,6 +127,14 @@ protected:
     AVRISP_parameter_t param;
     // page buffer
     uint8_t buff[256];
+    // page acknowledged and being programmed while the next one comes in
+    uint8_t _prog[256];
+    int _prog_len = 0;          // bytes, 0 when there is none
+    int _prog_pos = 0;
+    int _prog_here = 0;         // word address of _prog[_prog_pos]
+    int _prog_page = 0;         // target page being loaded
+    bool _commit_pending = false;
+    uint32_t _commit_ms = 0;    // when the last commit started
 
     int error = 0;
     bool pmode = 0;
@@ -0,0 +1,65 @@
+/**
+   AsyncHttpClient.ino
+
+   Posts a reading every ten seconds while loop() keeps sampling.
+
+*/
+
+#include <Arduino.h>
+
+#include <ESP8266WiFi.h>
+#include <ESP8266WiFiMulti.h>
+
+#include <AsyncHTTPRequest.h>
+
+#define USE_SERIAL Serial
+
+ESP8266WiFiMulti WiFiMulti;
+
+AsyncHTTPRequest request;
+
+unsigned long lastPost = 0;
+unsigned long samples = 0;
+int reading = 0;
+
+void setup() {
+
+  USE_SERIAL.begin(115200);
+  // USE_SERIAL.setDebugOutput(true);
+
+  USE_SERIAL.println();
+  USE_SERIAL.println();
+  USE_SERIAL.println();
+
+  WiFi.mode(WIFI_STA);
+  WiFiMulti.addAP("SSID", "PASSWORD");
+
+  request.onBody([](const uint8_t* data, size_t size) {
+    USE_SERIAL.write(data, size);
+  });
+  request.onDone([](int result) {
+    if (result > 0) {
+      USE_SERIAL.printf("\n[HTTP] POST... code: %d, %lu samples taken meanwhile\n", result, samples);
+    } else {
+      USE_SERIAL.printf("[HTTP] POST... failed, error: %s\n", HTTPClient::errorToString(result).c_str());
+    }
+  });
+}
+
+void loop() {
+  // never blocks, so sampling goes on at full rate
+  reading = analogRead(A0);
+  samples++;
+
+  request.poll();
+
+  if ((WiFiMulti.run() == WL_CONNECTED) && !request.busy() && (millis() - lastPost > 10000)) {
+    lastPost = millis();
+    samples = 0;
+    request.begin("http://192.168.1.12/telemetry");
+    request.addHeader("Content-Type", "application/json");
+    if (!request.send("POST", String("{\"a0\":") + reading + "}")) {
+      USE_SERIAL.println("[HTTP] POST... could not start");
+    }
+  }
+}
@@ -37,7 +37,8 @@ void setup() {
   WiFi.mode(WIFI_STA);
   WiFiMulti.addAP("SSID", "PASSWORD");
 
-  // allow reuse (if server supports it)
+  // allow reuse (if server supports it); on end() the connection goes to a pool
+  // shared by all HTTPClient objects, where requests to the same server find it
   http.setReuse(true);
 }
 
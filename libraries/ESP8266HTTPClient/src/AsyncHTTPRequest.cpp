@@ -0,0 +1,478 @@
+/**
+ * AsyncHTTPRequest.cpp
+ *
+ * HTTP request that runs in the background while the sketch goes on.
+ * This file is part of the ESP8266HTTPClient for Arduino.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <base64.h>
+
+#include "AsyncHTTPRequest.h"
+
+enum {
+    CHUNK_SIZE,     // size line expected
+    CHUNK_DATA,
+    CHUNK_END,      // the line break after the data
+    CHUNK_TRAILER   // trailer lines up to an empty one
+};
+
+/// name lookup in flight; it cannot be cancelled, so a request that gives
+/// up only lets go and the lookup's handler frees it
+struct AsyncHTTPLookup
+{
+    AsyncHTTPRequest* request;
+    bool done;
+    uint32_t addr;
+};
+
+AsyncHTTPRequest::AsyncHTTPRequest()
+{
+}
+
+AsyncHTTPRequest::~AsyncHTTPRequest()
+{
+    _close();
+}
+
+bool AsyncHTTPRequest::begin(const String& url)
+{
+    if(busy()) {
+        return false;
+    }
+    if(!url.startsWith("http://")) {
+        DEBUG_HTTPCLIENT("[HTTP-Async][begin] only http:// is supported: %s\n", url.c_str());
+        return false;
+    }
+    String host = url.substring(7);
+    int index = host.indexOf('/');
+    String uri = index >= 0 ? host.substring(index) : String("/");
+    if(index >= 0) {
+        host.remove(index);
+    }
+
+    String auth;
+    index = host.indexOf('@');
+    if(index >= 0) {
+        auth = base64::encode(host.substring(0, index));
+        auth.replace("\n", "");
+        host.remove(0, index + 1);
+    }
+
+    uint16_t port = 80;
+    index = host.indexOf(':');
+    if(index >= 0) {
+        port = host.substring(index + 1).toInt();
+        host.remove(index);
+    }
+    if(!begin(host, port, uri)) {
+        return false;
+    }
+    if(auth.length()) {
+        addHeader(F("Authorization"), String(F("Basic ")) + auth);
+    }
+    return true;
+}
+
+bool AsyncHTTPRequest::begin(const String& host, uint16_t port, const String& uri)
+{
+    if(busy()) {
+        return false;
+    }
+    _host = host;
+    _port = port;
+    _uri = uri.length() ? uri : String("/");
+    _headers = "";
+    _state = ASYNC_HTTP_IDLE;
+    DEBUG_HTTPCLIENT("[HTTP-Async][begin] host: %s port: %d uri: %s\n", _host.c_str(), _port, _uri.c_str());
+    return _host.length() > 0;
+}
+
+void AsyncHTTPRequest::setTimeout(uint16_t timeout)
+{
+    _timeout = timeout;
+}
+
+void AsyncHTTPRequest::setUserAgent(const String& userAgent)
+{
+    _userAgent = userAgent;
+}
+
+void AsyncHTTPRequest::addHeader(const String& name, const String& value)
+{
+    _headers += name + ": " + value + "\r\n";
+}
+
+void AsyncHTTPRequest::onBody(THandlerFunction_Body handler)
+{
+    _bodyHandler = handler;
+}
+
+void AsyncHTTPRequest::onDone(THandlerFunction_Done handler)
+{
+    _doneHandler = handler;
+}
+
+bool AsyncHTTPRequest::send(const char* type, const String& payload)
+{
+    return send(type, (const uint8_t*) payload.c_str(), payload.length());
+}
+
+/**
+ * start a request
+ * @param type const char *     "GET", "POST", ....
+ * @param payload uint8_t *     data for the message body, copied
+ * @param size size_t           size for the message body
+ * @return false if the request could not be started, onDone() is not called then
+ */
+bool AsyncHTTPRequest::send(const char* type, const uint8_t* payload, size_t size)
+{
+    if(busy() || !_host.length()) {
+        return false;
+    }
+
+    _request = String(type) + " " + _uri + F(" HTTP/1.1\r\nHost: ") + _host;
+    if(_port != 80) {
+        _request += ':';
+        _request += String(_port);
+    }
+    _request += String(F("\r\nUser-Agent: ")) + _userAgent +
+                F("\r\nConnection: close\r\nAccept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n");
+    if(payload && size > 0) {
+        _request += String(F("Content-Length: ")) + String(size) + "\r\n";
+    }
+    _request += _headers + "\r\n";
+    if(!_request.reserve(_request.length() + size)) {
+        _request = String();
+        return false;
+    }
+    for(size_t i = 0; payload && i < size; i++) {
+        _request += (char) payload[i];
+    }
+
+    _requestSent = 0;
+    _lineLen = 0;
+    _head = !strcmp(type, "HEAD");
+    _code = 0;
+    _size = -1;
+    _chunked = false;
+    _bodyLeft = 0;
+    _lastActivity = millis();
+
+    IPAddress ip;
+    if(ip.fromString(_host)) {
+        _connect(ip);
+        return true;
+    }
+
+    AsyncHTTPLookup* lookup = new AsyncHTTPLookup { this, false, 0 };
+    if(!lookup) {
+        _request = String();
+        return false;
+    }
+    bool started = WiFi.hostByName(_host.c_str(), [lookup](const char*, const IPAddress& ip) {
+        if(!lookup->request) {
+            delete lookup;
+            return;
+        }
+        lookup->addr = ip;
+        lookup->done = true;
+        lookup->request->_pump();
+    });
+    if(!started) {
+        DEBUG_HTTPCLIENT("[HTTP-Async] lookup of %s failed\n", _host.c_str());
+        delete lookup;
+        _request = String();
+        return false;
+    }
+    _lookup = lookup;
+    _state = ASYNC_HTTP_RESOLVING;
+    return true;
+}
+
+/**
+ * move the request on and check for timeouts, call from loop()
+ */
+void AsyncHTTPRequest::poll()
+{
+    if(!busy()) {
+        return;
+    }
+    _pump();
+    if(busy() && (millis() - _lastActivity) > _timeout) {
+        DEBUG_HTTPCLIENT("[HTTP-Async] timeout in state %d\n", (int) _state);
+        _finish(_state <= ASYNC_HTTP_CONNECTING ? HTTPC_ERROR_CONNECTION_REFUSED : HTTPC_ERROR_READ_TIMEOUT);
+    }
+}
+
+/**
+ * give up on the request in flight, onDone() is not called
+ */
+void AsyncHTTPRequest::abort()
+{
+    if(busy()) {
+        _close();
+        _state = ASYNC_HTTP_IDLE;
+    }
+}
+
+void AsyncHTTPRequest::_pump()
+{
+    // handlers may end up here again, e.g. by calling poll()
+    if(_inPump) {
+        return;
+    }
+    _inPump = true;
+
+    if(_state == ASYNC_HTTP_RESOLVING && _lookup->done) {
+        uint32_t addr = _lookup->addr;
+        delete _lookup;
+        _lookup = nullptr;
+        if(addr) {
+            _connect(IPAddress(addr));
+        } else {
+            DEBUG_HTTPCLIENT("[HTTP-Async] no address for %s\n", _host.c_str());
+            _finish(HTTPC_ERROR_CONNECTION_REFUSED);
+        }
+    }
+
+    if(_state == ASYNC_HTTP_CONNECTING || _state == ASYNC_HTTP_SENDING) {
+        _sendSome();
+    }
+
+    while(_state == ASYNC_HTTP_HEADERS && _readLine()) {
+        _parseHeaderLine();
+    }
+
+    if(_state == ASYNC_HTTP_BODY) {
+        _readBody();
+    }
+
+    if(_state == ASYNC_HTTP_CONNECTING) {
+        if(_client.status() == CLOSED) {
+            _finish(HTTPC_ERROR_CONNECTION_REFUSED);
+        }
+    } else if(busy() && _state != ASYNC_HTTP_RESOLVING && !_client.connected()) {
+        if(_state == ASYNC_HTTP_BODY && !_chunked && _bodyLeft < 0) {
+            _finish(_code);
+        } else {
+            _finish(HTTPC_ERROR_CONNECTION_LOST);
+        }
+    }
+
+    _inPump = false;
+}
+
+void AsyncHTTPRequest::_connect(IPAddress ip)
+{
+    DEBUG_HTTPCLIENT("[HTTP-Async] connecting to %s:%u\n", ip.toString().c_str(), _port);
+    _state = ASYNC_HTTP_CONNECTING;
+    _lastActivity = millis();
+    if(!_client.connectAsync(ip, _port)) {
+        _finish(HTTPC_ERROR_CONNECTION_REFUSED);
+        return;
+    }
+    _client.setAsync(true);
+    _client.setNoDelay(true);
+    // sent data acknowledged, or connected: runs in the network stack
+    _client.onSent([this](size_t) {
+        _sendSome();
+    });
+    _client.onData([this]() {
+        _pump();
+    });
+    _client.onDisconnect([this]() {
+        _pump();
+    });
+}
+
+void AsyncHTTPRequest::_sendSome()
+{
+    if(_state == ASYNC_HTTP_CONNECTING) {
+        if(_client.status() != ESTABLISHED) {
+            return;
+        }
+        DEBUG_HTTPCLIENT("[HTTP-Async] connected\n");
+        _state = ASYNC_HTTP_SENDING;
+        _lastActivity = millis();
+    }
+    if(_state != ASYNC_HTTP_SENDING) {
+        return;
+    }
+    size_t sent = _client.write((const uint8_t*) _request.c_str() + _requestSent, _request.length() - _requestSent);
+    if(sent) {
+        _requestSent += sent;
+        _lastActivity = millis();
+    }
+    if(_requestSent == _request.length()) {
+        _request = String();
+        _state = ASYNC_HTTP_HEADERS;
+    }
+}
+
+/**
+ * collect received bytes up to the next line break in _line
+ * @return true once a line is complete
+ */
+bool AsyncHTTPRequest::_readLine()
+{
+    size_t avail;
+    while((avail = _client.peekAvailable()) > 0) {
+        const char* data = _client.peekBuffer();
+        const char* end = (const char*) memchr(data, '\n', avail);
+        size_t len = end ? end - data : avail;
+        size_t copy = std::min(len, ASYNC_HTTP_MAX_LINE - _lineLen);
+        memcpy(_line + _lineLen, data, copy);
+        _lineLen += copy;
+        _client.peekConsume(end ? len + 1 : len);
+        _lastActivity = millis();
+        if(end) {
+            if(_lineLen && _line[_lineLen - 1] == '\r') {
+                _lineLen--;
+            }
+            _line[_lineLen] = 0;
+            _lineLen = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+void AsyncHTTPRequest::_parseHeaderLine()
+{
+    DEBUG_HTTPCLIENT("[HTTP-Async] RX: '%s'\n", _line);
+
+    if(!_code) {
+        if(strncmp(_line, "HTTP/1.", 7) || strlen(_line) < 12) {
+            _finish(HTTPC_ERROR_NO_HTTP_SERVER);
+            return;
+        }
+        _code = atoi(_line + 9);
+        return;
+    }
+
+    if(_line[0]) {
+        char* value = strchr(_line, ':');
+        if(!value) {
+            return;
+        }
+        *value++ = 0;
+        while(*value == ' ' || *value == '\t') {
+            value++;
+        }
+        if(!strcasecmp(_line, "Content-Length")) {
+            _size = atoi(value);
+        } else if(!strcasecmp(_line, "Transfer-Encoding")) {
+            if(!strcasecmp(value, "chunked")) {
+                _chunked = true;
+            } else if(strcasecmp(value, "identity")) {
+                _finish(HTTPC_ERROR_ENCODING);
+            }
+        }
+        return;
+    }
+
+    // end of the headers
+    if(_code == HTTP_CODE_CONTINUE) {
+        _code = 0;
+        _size = -1;
+        _chunked = false;
+        return;
+    }
+    if(_head || _code == HTTP_CODE_NO_CONTENT || _code == HTTP_CODE_NOT_MODIFIED || (!_chunked && _size == 0)) {
+        _finish(_code);
+        return;
+    }
+    _state = ASYNC_HTTP_BODY;
+    _chunkState = CHUNK_SIZE;
+    _bodyLeft = _chunked ? 0 : _size;
+}
+
+void AsyncHTTPRequest::_readBody()
+{
+    while(_state == ASYNC_HTTP_BODY) {
+        if(_chunked && _chunkState != CHUNK_DATA) {
+            if(!_readLine()) {
+                return;
+            }
+            if(_chunkState == CHUNK_SIZE) {
+                _bodyLeft = strtol(_line, nullptr, 16);
+                _chunkState = _bodyLeft > 0 ? CHUNK_DATA : CHUNK_TRAILER;
+            } else if(_chunkState == CHUNK_END) {
+                _chunkState = CHUNK_SIZE;
+            } else if(!_line[0]) {
+                _finish(_code);
+            }
+            continue;
+        }
+
+        size_t avail = _client.peekAvailable();
+        if(!avail) {
+            return;
+        }
+        if(_bodyLeft >= 0 && avail > (size_t) _bodyLeft) {
+            avail = _bodyLeft;
+        }
+        if(_bodyHandler) {
+            _bodyHandler((const uint8_t*) _client.peekBuffer(), avail);
+            if(_state != ASYNC_HTTP_BODY) {
+                return;
+            }
+        }
+        _client.peekConsume(avail);
+        _lastActivity = millis();
+        if(_bodyLeft < 0) {
+            continue;
+        }
+        _bodyLeft -= avail;
+        if(!_bodyLeft) {
+            if(_chunked) {
+                _chunkState = CHUNK_END;
+            } else {
+                _finish(_code);
+            }
+        }
+    }
+}
+
+void AsyncHTTPRequest::_finish(int result)
+{
+    DEBUG_HTTPCLIENT("[HTTP-Async] done: %d\n", result);
+    _close();
+    _state = ASYNC_HTTP_DONE;
+    if(_doneHandler) {
+        // may start the next request
+        THandlerFunction_Done handler = _doneHandler;
+        handler(result);
+    }
+}
+
+void AsyncHTTPRequest::_close()
+{
+    if(_lookup) {
+        // the lookup's handler frees it
+        _lookup->request = nullptr;
+        _lookup = nullptr;
+    }
+    _client.onSent(nullptr);
+    _client.onData(nullptr);
+    _client.onDisconnect(nullptr);
+    _client.stop();
+    _request = String();
+}
@@ -0,0 +1,125 @@
+/**
+ * AsyncHTTPRequest.h
+ *
+ * HTTP request that runs in the background while the sketch goes on.
+ * This file is part of the ESP8266HTTPClient for Arduino.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef AsyncHTTPRequest_H_
+#define AsyncHTTPRequest_H_
+
+#include <functional>
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "ESP8266HTTPClient.h"
+
+/// longest status or header line read, the rest of longer lines is skipped
+#ifndef ASYNC_HTTP_MAX_LINE
+#define ASYNC_HTTP_MAX_LINE (256)
+#endif
+
+typedef enum {
+    ASYNC_HTTP_IDLE,
+    ASYNC_HTTP_RESOLVING,
+    ASYNC_HTTP_CONNECTING,
+    ASYNC_HTTP_SENDING,
+    ASYNC_HTTP_HEADERS,
+    ASYNC_HTTP_BODY,
+    ASYNC_HTTP_DONE
+} asyncHTTPState_t;
+
+struct AsyncHTTPLookup;
+
+/**
+ * A plain HTTP request that never blocks: send() only starts it, then
+ * it moves on whenever the connection reports progress, and on every
+ * poll() from loop(). Body data is passed to the onBody() handler as it
+ * arrives, and the onDone() handler gets the status code, or one of the
+ * HTTPC_ERROR_* codes when the request failed. Handlers run from the
+ * loop context; one request is in flight at a time per object.
+ */
+class AsyncHTTPRequest
+{
+public:
+    typedef std::function<void(const uint8_t* data, size_t size)> THandlerFunction_Body;
+    typedef std::function<void(int result)> THandlerFunction_Done;
+
+    AsyncHTTPRequest();
+    ~AsyncHTTPRequest();
+
+    bool begin(const String& url);
+    bool begin(const String& host, uint16_t port, const String& uri = "/");
+
+    void setTimeout(uint16_t timeout); /// ms without progress before giving up
+    void setUserAgent(const String& userAgent);
+    void addHeader(const String& name, const String& value);
+
+    void onBody(THandlerFunction_Body handler);
+    void onDone(THandlerFunction_Done handler);
+
+    /// start the request, the payload is copied
+    bool send(const char* type, const uint8_t* payload = nullptr, size_t size = 0);
+    bool send(const char* type, const String& payload);
+
+    void poll();
+    void abort();
+
+    asyncHTTPState_t state() const { return _state; }
+    bool busy() const { return _state != ASYNC_HTTP_IDLE && _state != ASYNC_HTTP_DONE; }
+    int code() const { return _code; }
+    int getSize() const { return _size; } /// Content-Length, -1 if not known
+
+protected:
+    void _pump();
+    void _connect(IPAddress ip);
+    void _sendSome();
+    bool _readLine();
+    void _parseHeaderLine();
+    void _readBody();
+    void _finish(int result);
+    void _close();
+
+    WiFiClient _client;
+    AsyncHTTPLookup* _lookup = nullptr;
+
+    String _host;
+    uint16_t _port = 80;
+    String _uri;
+    String _headers;
+    String _userAgent = "ESP8266HTTPClient";
+    uint16_t _timeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+
+    THandlerFunction_Body _bodyHandler;
+    THandlerFunction_Done _doneHandler;
+
+    asyncHTTPState_t _state = ASYNC_HTTP_IDLE;
+    String _request;
+    size_t _requestSent = 0;
+    char _line[ASYNC_HTTP_MAX_LINE + 1];
+    size_t _lineLen = 0;
+    bool _head = false;
+    int _code = 0;
+    int _size = -1;
+    bool _chunked = false;
+    uint8_t _chunkState = 0;
+    int _bodyLeft = 0;       // of the chunk or response, -1 for up to the end of the connection
+    bool _inPump = false;
+    unsigned long _lastActivity = 0;
+};
+
+#endif /* AsyncHTTPRequest_H_ */
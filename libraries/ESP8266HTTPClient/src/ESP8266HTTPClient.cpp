@@ -26,6 +26,7 @@
 #include <ESP8266WiFi.h>
 #include <WiFiClientSecure.h>
 #include <StreamString.h>
+#include <StreamCopy.h>
 #include <base64.h>
 
 #include "ESP8266HTTPClient.h"
@@ -48,6 +49,12 @@ public:
         (void)host;
         return true;
     }
+
+    // pooled connections are only reused for requests with the same key
+    virtual String poolKey()
+    {
+        return String();
+    }
 };
 
 class TLSTraits : public TransportTraits
@@ -69,10 +76,27 @@ public:
         return wcs.verify(_fingerprint.c_str(), host);
     }
 
+    String poolKey() override
+    {
+        return String(F("tls ")) + _fingerprint;
+    }
+
 protected:
     String _fingerprint;
 };
 
+/// idle connection kept open for the next request to the same server
+struct PooledConnection
+{
+    std::unique_ptr<WiFiClient> client;
+    String host;
+    uint16_t port;
+    String key;
+    unsigned long lastUsed;
+};
+
+static PooledConnection s_pool[HTTPCLIENT_POOL_SIZE ? HTTPCLIENT_POOL_SIZE : 1];
+
 /**
  * constructor
  */
@@ -95,6 +119,14 @@ HTTPClient::~HTTPClient()
 
 void HTTPClient::clear()
 {
+    if(_pipelined) {
+        // responses still to come would be taken for those of the next request
+        DEBUG_HTTPCLIENT("[HTTP-Client] dropping %u pipelined responses\n", _pipelined);
+        _pipelined = 0;
+        if(_tcp) {
+            _tcp->stop();
+        }
+    }
     _returnCode = 0;
     _size = -1;
     _headers = "";
@@ -220,6 +252,11 @@ bool HTTPClient::begin(String host, uint16_t port, String uri, String httpsFinge
 void HTTPClient::end(void)
 {
     if(connected()) {
+        if(_pipelined && _canReuse) {
+            DEBUG_HTTPCLIENT("[HTTP-Client][end] %u pipelined responses pending\n", _pipelined);
+            return;
+        }
+        _pipelined = 0;
         if(_tcp->available() > 0) {
             DEBUG_HTTPCLIENT("[HTTP-Client][end] still data in buffer (%d), clean up.\n", _tcp->available());
             while(_tcp->available() > 0) {
@@ -228,12 +265,14 @@ void HTTPClient::end(void)
         }
         if(_reuse && _canReuse) {
             DEBUG_HTTPCLIENT("[HTTP-Client][end] tcp keep open for reuse\n");
+            returnToPool();
         } else {
             DEBUG_HTTPCLIENT("[HTTP-Client][end] tcp stop\n");
             _tcp->stop();
         }
     } else {
         DEBUG_HTTPCLIENT("[HTTP-Client][end] tcp is closed\n");
+        _pipelined = 0;
     }
 }
 
@@ -413,6 +452,74 @@ int HTTPClient::sendRequest(const char * type, uint8_t * payload, size_t size)
     return returnError(handleHeaderResponse());
 }
 
+/**
+ * pipelining: send a request without waiting for the responses to the
+ * ones sent before; needs setReuse(true), and the responses have to be
+ * read in order with nextResponse()
+ * @param type const char *     "GET", "POST", ....
+ * @param payload uint8_t *     data for the message body if null not send
+ * @param size size_t           size for the message body if 0 not send
+ * @return true if the request was sent
+ */
+bool HTTPClient::queueRequest(const char * type, const uint8_t * payload, size_t size)
+{
+    if(!_reuse || _pipelined >= HTTPCLIENT_MAX_PIPELINE) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][queueRequest] not possible (reuse: %d, queued: %u)\n", _reuse, _pipelined);
+        return false;
+    }
+
+    if(_pipelined) {
+        if(!_canReuse || !connected()) {
+            // the server closes after the responses sent so far
+            return false;
+        }
+    } else if(!connect()) {
+        return false;
+    }
+
+    // the length is only for this request
+    String headers = _headers;
+    if(payload && size > 0) {
+        addHeader(F("Content-Length"), String(size));
+    }
+    bool sent = sendHeader(type) && (!payload || !size || _tcp->write(payload, size) == size);
+    _headers = headers;
+
+    if(!sent) {
+        returnError(HTTPC_ERROR_SEND_HEADER_FAILED);
+        return false;
+    }
+    // until the first response tells otherwise
+    _canReuse = true;
+    _pipelined++;
+    return true;
+}
+
+bool HTTPClient::queueRequest(const char * type, const String& payload)
+{
+    return queueRequest(type, (const uint8_t *) payload.c_str(), payload.length());
+}
+
+/**
+ * wait for the response to the oldest request sent with queueRequest(),
+ * its body is read as after sendRequest()
+ * @return http code, or < 0 if the connection failed and the responses still pending are lost
+ */
+int HTTPClient::nextResponse()
+{
+    if(!_pipelined) {
+        return returnError(HTTPC_ERROR_NOT_CONNECTED);
+    }
+    _pipelined--;
+    int code = handleHeaderResponse();
+    if(code < 0) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][nextResponse] %u pipelined responses lost\n", _pipelined);
+    } else if(!_canReuse && _pipelined) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][nextResponse] server closes, %u pipelined responses lost\n", _pipelined);
+    }
+    return returnError(code);
+}
+
 /**
  * sendRequest
  * @param type const char *     "GET", "POST", ....
@@ -826,6 +933,11 @@ bool HTTPClient::hasHeader(const char* name)
 bool HTTPClient::connect(void)
 {
 
+    if(_pipelined) {
+        DEBUG_HTTPCLIENT("[HTTP-Client] connect. pipelined responses pending, read them first!\n");
+        return false;
+    }
+
     if(connected()) {
         DEBUG_HTTPCLIENT("[HTTP-Client] connect. already connected, try reuse!\n");
         while(_tcp->available() > 0) {
@@ -839,6 +951,12 @@ bool HTTPClient::connect(void)
         return false;
     }
 
+    if(takeFromPool()) {
+        DEBUG_HTTPCLIENT("[HTTP-Client] connect. reusing idle connection to %s:%u\n", _host.c_str(), _port);
+        _tcp->setTimeout(_tcpTimeout);
+        return true;
+    }
+
     _tcp = _transportTraits->create();
     _tcp->setTimeout(_tcpTimeout);
 
@@ -862,6 +980,76 @@ bool HTTPClient::connect(void)
     return connected();
 }
 
+/**
+ * take an idle connection to the server from the pool, closing stale ones on the way
+ * @return true if _tcp is such a connection
+ */
+bool HTTPClient::takeFromPool()
+{
+    String key = _transportTraits->poolKey();
+    for(size_t i = 0; i < HTTPCLIENT_POOL_SIZE; i++) {
+        PooledConnection& entry = s_pool[i];
+        if(!entry.client) {
+            continue;
+        }
+        // unsolicited data means the server is about to close, or broke the protocol
+        if(!entry.client->connected() || entry.client->available() > 0 ||
+                (millis() - entry.lastUsed) > HTTPCLIENT_POOL_IDLE_TIMEOUT) {
+            DEBUG_HTTPCLIENT("[HTTP-Client] pool: dropping connection to %s:%u\n", entry.host.c_str(), entry.port);
+            entry.client->stop();
+            entry.client.reset();
+            continue;
+        }
+        if(!_tcp && entry.port == _port && entry.key == key && entry.host.equalsIgnoreCase(_host)) {
+            _tcp = std::move(entry.client);
+        }
+    }
+    return (bool) _tcp;
+}
+
+/**
+ * hand the connection over to the pool, taking the place of the least recently used one if it is full
+ */
+void HTTPClient::returnToPool()
+{
+    if(!HTTPCLIENT_POOL_SIZE || !_transportTraits) {
+        // without a pool the connection stays with this client
+        return;
+    }
+    PooledConnection* slot = &s_pool[0];
+    for(size_t i = 0; i < HTTPCLIENT_POOL_SIZE; i++) {
+        if(!s_pool[i].client) {
+            slot = &s_pool[i];
+            break;
+        }
+        if((long) (s_pool[i].lastUsed - slot->lastUsed) < 0) {
+            slot = &s_pool[i];
+        }
+    }
+    if(slot->client) {
+        DEBUG_HTTPCLIENT("[HTTP-Client] pool: full, closing connection to %s:%u\n", slot->host.c_str(), slot->port);
+        slot->client->stop();
+    }
+    slot->client = std::move(_tcp);
+    slot->host = _host;
+    slot->port = _port;
+    slot->key = _transportTraits->poolKey();
+    slot->lastUsed = millis();
+}
+
+/**
+ * close all idle connections kept for reuse, e.g. to free the heap taken by TLS connections
+ */
+void HTTPClient::clearConnectionPool()
+{
+    for(size_t i = 0; i < HTTPCLIENT_POOL_SIZE; i++) {
+        if(s_pool[i].client) {
+            s_pool[i].client->stop();
+            s_pool[i].client.reset();
+        }
+    }
+}
+
 /**
  * sends HTTP request header
  * @param type (GET, POST, ...)
@@ -915,6 +1103,35 @@ bool HTTPClient::sendHeader(const char * type)
     return (_tcp->write((const uint8_t *) header.c_str(), header.length()) == header.length());
 }
 
+/**
+ * collect received bytes up to the next line break, without copying more than fits
+ * @param line char *           buffer, zero terminated once the line is complete
+ * @param size size_t           size of the buffer, longer lines are cut short
+ * @param len size_t &          bytes collected so far, kept between calls
+ * @return true if the line is complete
+ */
+bool HTTPClient::readHeaderLine(char * line, size_t size, size_t & len)
+{
+    size_t avail;
+    while((avail = _tcp->peekAvailable()) > 0) {
+        const char * data = _tcp->peekBuffer();
+        const char * end = (const char *) memchr(data, '\n', avail);
+        size_t lineBytes = end ? end - data : avail;
+        size_t copy = std::min(lineBytes, size - 1 - len);
+        memcpy(line + len, data, copy);
+        len += copy;
+        _tcp->peekConsume(end ? lineBytes + 1 : lineBytes);
+        if(end) {
+            while(len > 0 && isspace((unsigned char) line[len - 1])) {
+                len--;
+            }
+            line[len] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * reads the response from the server
  * @return int http code
@@ -926,39 +1143,51 @@ int HTTPClient::handleHeaderResponse()
         return HTTPC_ERROR_NOT_CONNECTED;
     }
 
-    String transferEncoding;
     _returnCode = -1;
     _size = -1;
     _transferEncoding = HTTPC_TE_IDENTITY;
+    _canReuse = false;
+    bool keepAlive = false;
+    bool unknownEncoding = false;
     unsigned long lastDataTime = millis();
 
-    while(connected()) {
-        size_t len = _tcp->available();
-        if(len > 0) {
-            String headerLine = _tcp->readStringUntil('\n');
-            headerLine.trim(); // remove \r
-
-            lastDataTime = millis();
-
-            DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] RX: '%s'\n", headerLine.c_str());
+    for(size_t i = 0; i < _headerKeysCount; i++) {
+        _currentHeaders[i].value = String();
+    }
 
-            if(headerLine.startsWith("HTTP/1.")) {
-                _returnCode = headerLine.substring(9, headerLine.indexOf(' ', 9)).toInt();
-            } else if(headerLine.indexOf(':')) {
-                String headerName = headerLine.substring(0, headerLine.indexOf(':'));
-                String headerValue = headerLine.substring(headerLine.indexOf(':') + 1);
-                headerValue.trim();
+    // header lines are parsed in place, only collected values become Strings
+    char headerLine[HTTPCLIENT_HEADER_LINE_SIZE];
+    size_t lineLen = 0;
 
-                if(headerName.equalsIgnoreCase("Content-Length")) {
-                    _size = headerValue.toInt();
-                }
+    while(connected()) {
+        if(readHeaderLine(headerLine, sizeof(headerLine), lineLen)) {
+            lineLen = 0;
+            lastDataTime = millis();
 
-                if(headerName.equalsIgnoreCase("Connection")) {
-                    _canReuse = headerValue.equalsIgnoreCase("keep-alive");
+            DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] RX: '%s'\n", headerLine);
+
+            if(!strncmp(headerLine, "HTTP/1.", 7)) {
+                _returnCode = atoi(headerLine + 9);
+                // HTTP/1.1 connections persist unless the server says otherwise
+                keepAlive = headerLine[7] != '0';
+            } else if(char * headerValue = strchr(headerLine, ':')) {
+                const char * headerName = headerLine;
+                *headerValue++ = 0;
+                while(isspace((unsigned char) *headerValue)) {
+                    headerValue++;
                 }
 
-                if(headerName.equalsIgnoreCase("Transfer-Encoding")) {
-                    transferEncoding = headerValue;
+                if(!strcasecmp(headerName, "Content-Length")) {
+                    _size = atoi(headerValue);
+                } else if(!strcasecmp(headerName, "Connection")) {
+                    keepAlive = !strcasecmp(headerValue, "keep-alive");
+                } else if(!strcasecmp(headerName, "Transfer-Encoding")) {
+                    DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] Transfer-Encoding: %s\n", headerValue);
+                    if(!strcasecmp(headerValue, "chunked")) {
+                        _transferEncoding = HTTPC_TE_CHUNKED;
+                    } else {
+                        unknownEncoding = true;
+                    }
                 }
 
                 for(size_t i = 0; i < _headerKeysCount; i++) {
@@ -969,24 +1198,20 @@ int HTTPClient::handleHeaderResponse()
                 }
             }
 
-            if(headerLine == "") {
+            if(!headerLine[0]) {
                 DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] code: %d\n", _returnCode);
 
                 if(_size > 0) {
                     DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] size: %d\n", _size);
                 }
 
-                if(transferEncoding.length() > 0) {
-                    DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] Transfer-Encoding: %s\n", transferEncoding.c_str());
-                    if(transferEncoding.equalsIgnoreCase("chunked")) {
-                        _transferEncoding = HTTPC_TE_CHUNKED;
-                    } else {
-                        return HTTPC_ERROR_ENCODING;
-                    }
-                } else {
-                    _transferEncoding = HTTPC_TE_IDENTITY;
+                if(unknownEncoding) {
+                    return HTTPC_ERROR_ENCODING;
                 }
 
+                // without a length the body ends when the connection does
+                _canReuse = keepAlive && (_size >= 0 || _transferEncoding == HTTPC_TE_CHUNKED);
+
                 if(_returnCode) {
                     return _returnCode;
                 } else {
@@ -995,7 +1220,7 @@ int HTTPClient::handleHeaderResponse()
                 }
             }
 
-        } else {
+        } else if(_tcp->peekAvailable() == 0) {
             if((millis() - lastDataTime) > _tcpTimeout) {
                 return HTTPC_ERROR_READ_TIMEOUT;
             }
@@ -1008,114 +1233,32 @@ int HTTPClient::handleHeaderResponse()
 
 /**
  * write one Data Block to Stream
+ * the data goes straight from the received segments to the stream, which
+ * buffers it as it sees fit (Updater and File collect whole flash pages)
  * @param stream Stream *
  * @param size int
  * @return < 0 = error >= 0 = size written
  */
 int HTTPClient::writeToStreamDataBlock(Stream * stream, int size)
 {
-    int buff_size = HTTP_TCP_BUFFER_SIZE;
-    int len = size;
-    int bytesWritten = 0;
-
-    // if possible create smaller buffer then HTTP_TCP_BUFFER_SIZE
-    if((len > 0) && (len < HTTP_TCP_BUFFER_SIZE)) {
-        buff_size = len;
+    // without a size, until the server closes the connection
+    StreamCopyStats stats;
+    streamCopy(*_tcp, *stream, (size > 0) ? (size_t) size : SIZE_MAX, _tcpTimeout, &stats);
+    DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] written: %d in %d ms (%d B/s), result %d\n", stats.bytes, stats.ms, stats.bytesPerSecond(), stats.result);
+
+    if(stats.result == STREAMCOPY_WRITE_TIMEOUT || stats.result == STREAMCOPY_WRITE_ERROR) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] stream write error %d\n", stream->getWriteError());
+        return HTTPC_ERROR_STREAM_WRITE;
     }
-
-    // create buffer for read
-    uint8_t * buff = (uint8_t *) malloc(buff_size);
-
-    if(buff) {
-        // read all data from server
-        while(connected() && (len > 0 || len == -1)) {
-
-            // get available data size
-            size_t sizeAvailable = _tcp->available();
-
-            if(sizeAvailable) {
-
-                int readBytes = sizeAvailable;
-
-                // read only the asked bytes
-                if(len > 0 && readBytes > len) {
-                    readBytes = len;
-                }
-
-                // not read more the buffer can handle
-                if(readBytes > buff_size) {
-                    readBytes = buff_size;
-                }
-
-                // read data
-                int bytesRead = _tcp->readBytes(buff, readBytes);
-
-                // write it to Stream
-                int bytesWrite = stream->write(buff, bytesRead);
-                bytesWritten += bytesWrite;
-
-                // are all Bytes a writen to stream ?
-                if(bytesWrite != bytesRead) {
-                    DEBUG_HTTPCLIENT("[HTTP-Client][writeToStream] short write asked for %d but got %d retry...\n", bytesRead, bytesWrite);
-
-                    // check for write error
-                    if(stream->getWriteError()) {
-                        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] stream write error %d\n", stream->getWriteError());
-
-                        //reset write error for retry
-                        stream->clearWriteError();
-                    }
-
-                    // some time for the stream
-                    delay(1);
-
-                    int leftBytes = (readBytes - bytesWrite);
-
-                    // retry to send the missed bytes
-                    bytesWrite = stream->write((buff + bytesWrite), leftBytes);
-                    bytesWritten += bytesWrite;
-
-                    if(bytesWrite != leftBytes) {
-                        // failed again
-                        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStream] short write asked for %d but got %d failed.\n", leftBytes, bytesWrite);
-                        free(buff);
-                        return HTTPC_ERROR_STREAM_WRITE;
-                    }
-                }
-
-                // check for write error
-                if(stream->getWriteError()) {
-                    DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] stream write error %d\n", stream->getWriteError());
-                    free(buff);
-                    return HTTPC_ERROR_STREAM_WRITE;
-                }
-
-                // count bytes to read left
-                if(len > 0) {
-                    len -= readBytes;
-                }
-
-                delay(0);
-            } else {
-                delay(1);
-            }
-        }
-
-        free(buff);
-
-        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] connection closed or file end (written: %d).\n", bytesWritten);
-
-        if((size > 0) && (size != bytesWritten)) {
-            DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] bytesWritten %d and size %d mismatch!.\n", bytesWritten, size);
-            return HTTPC_ERROR_STREAM_WRITE;
-        }
-
-    } else {
-        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] too less ram! need %d\n", HTTP_TCP_BUFFER_SIZE);
-        return HTTPC_ERROR_TOO_LESS_RAM;
+    if(stats.result == STREAMCOPY_SOURCE_TIMEOUT) {
+        return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    if((size > 0) && (size != (int) stats.bytes)) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] bytesWritten %d and size %d mismatch!.\n", stats.bytes, size);
+        return HTTPC_ERROR_STREAM_WRITE;
     }
 
-    return bytesWritten;
+    return stats.bytes;
 }
 
 /**
@@ -1127,6 +1270,7 @@ int HTTPClient::returnError(int error)
 {
     if(error < 0) {
         DEBUG_HTTPCLIENT("[HTTP-Client][returnError] error(%d): %s\n", error, errorToString(error).c_str());
+        _pipelined = 0;
         if(connected()) {
             DEBUG_HTTPCLIENT("[HTTP-Client][returnError] tcp stop\n");
             _tcp->stop();
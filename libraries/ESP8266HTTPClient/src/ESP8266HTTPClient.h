@@ -41,6 +41,16 @@
 
 #define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
 
+/// idle keep-alive connections kept for all HTTPClient objects to reuse, 0 to disable
+#ifndef HTTPCLIENT_POOL_SIZE
+#define HTTPCLIENT_POOL_SIZE (3)
+#endif
+
+/// idle connections older than this (ms) are closed instead of reused
+#ifndef HTTPCLIENT_POOL_IDLE_TIMEOUT
+#define HTTPCLIENT_POOL_IDLE_TIMEOUT (10000)
+#endif
+
 /// HTTP client errors
 #define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
 #define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
@@ -57,6 +67,16 @@
 /// size for the stream handling
 #define HTTP_TCP_BUFFER_SIZE (1460)
 
+/// most requests sent ahead of their responses with queueRequest()
+#ifndef HTTPCLIENT_MAX_PIPELINE
+#define HTTPCLIENT_MAX_PIPELINE (8)
+#endif
+
+/// longest response header line read, on the stack; the rest of longer lines is skipped
+#ifndef HTTPCLIENT_HEADER_LINE_SIZE
+#define HTTPCLIENT_HEADER_LINE_SIZE (512)
+#endif
+
 /// HTTP codes see RFC7231
 typedef enum {
     HTTP_CODE_CONTINUE = 100,
@@ -144,7 +164,7 @@ public:
 
     bool connected(void);
 
-    void setReuse(bool reuse); /// keep-alive
+    void setReuse(bool reuse); /// keep-alive, connections go to the shared pool on end()
     void setUserAgent(const String& userAgent);
     void setAuthorization(const char * user, const char * password);
     void setAuthorization(const char * auth);
@@ -164,6 +184,12 @@ public:
     int sendRequest(const char * type, uint8_t * payload = NULL, size_t size = 0);
     int sendRequest(const char * type, Stream * stream, size_t size = 0);
 
+    /// pipelining (needs setReuse(true)): send requests ahead, then read the responses in order
+    bool queueRequest(const char * type, const uint8_t * payload = NULL, size_t size = 0);
+    bool queueRequest(const char * type, const String& payload);
+    int nextResponse();
+    size_t pendingResponses() const { return _pipelined; }
+
     void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
 
     /// Response handling
@@ -183,6 +209,7 @@ public:
     String getString(void);
 
     static String errorToString(int error);
+    static void clearConnectionPool(); /// close all idle connections of the pool
 
 protected:
     struct RequestArgument {
@@ -194,8 +221,11 @@ protected:
     void clear();
     int returnError(int error);
     bool connect(void);
+    bool takeFromPool();
+    void returnToPool();
     bool sendHeader(const char * type);
     int handleHeaderResponse();
+    bool readHeaderLine(char * line, size_t size, size_t & len);
     int writeToStreamDataBlock(Stream * stream, int len);
 
 
@@ -222,6 +252,7 @@ protected:
     int _returnCode = 0;
     int _size = -1;
     bool _canReuse = false;
+    size_t _pipelined = 0;
     transferEncoding_t _transferEncoding = HTTPC_TE_IDENTITY;
 };
 
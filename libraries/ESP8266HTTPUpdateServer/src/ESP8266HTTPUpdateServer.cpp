@@ -4,14 +4,23 @@
 #include <ESP8266WebServer.h>
 #include <WiFiUdp.h>
 #include "StreamString.h"
+#include <FS.h>
+#include <TarExtractor.h>
 #include "ESP8266HTTPUpdateServer.h"
 
+extern "C" uint32_t _SPIFFS_start;
+extern "C" uint32_t _SPIFFS_end;
+
 
 static const char serverIndex[] PROGMEM =
   R"(<html><body><form method='POST' action='' enctype='multipart/form-data'>
                   <input type='file' name='update'>
                   <input type='submit' value='Update'>
                </form>
+               <form method='POST' action='' enctype='multipart/form-data'>
+                  <input type='file' name='filesystem'>
+                  <input type='submit' value='Update file system'>
+               </form>
          </body></html>)";
 static const char successResponse[] PROGMEM = 
   "<META http-equiv=\"refresh\" content=\"15;URL=/\">Update Success! Rebooting...\n";
@@ -23,6 +32,7 @@ ESP8266HTTPUpdateServer::ESP8266HTTPUpdateServer(bool serial_debug)
   _username = NULL;
   _password = NULL;
   _authenticated = false;
+  _sync = NULL;
 }
 
 void ESP8266HTTPUpdateServer::setup(ESP8266WebServer *server, const char * path, const char * username, const char * password)
@@ -71,10 +81,34 @@ void ESP8266HTTPUpdateServer::setup(ESP8266WebServer *server, const char * path,
         WiFiUDP::stopAll();
         if (_serial_output)
           Serial.printf("Update: %s\n", upload.filename.c_str());
-        uint32_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
-        if(!Update.begin(maxSketchSpace)){//start with max available size
+        bool ok;
+        if (upload.name == "filesystem") {
+          // the whole image, as made by mkspiffs
+          size_t fsSize = ((size_t) &_SPIFFS_end - (size_t) &_SPIFFS_start);
+          SPIFFS.end();
+          ok = Update.begin(fsSize, U_SPIFFS);
+        } else {
+          uint32_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+          ok = Update.begin(maxSketchSpace);//start with max available size
+        }
+        if(!ok){
           _setUpdaterError();
+          return;
         }
+        // the file goes from the network buffers into the Updater's sector
+        // buffer; what is written is hashed while the client has nothing
+        // for us, so end() has little left to do
+        upload.sink = [this](const uint8_t* data, size_t len){
+          if(!len){
+            Update.hashNext();
+            return !Update.hasError();
+          }
+          if(Update.write(const_cast<uint8_t*>(data), len) != len){
+            _setUpdaterError();
+            return false;
+          }
+          return true;
+        };
       } else if(_authenticated && upload.status == UPLOAD_FILE_WRITE && !_updaterError.length()){
         if (_serial_output) Serial.printf(".");
         if(Update.write(upload.buf, upload.currentSize) != upload.currentSize){
@@ -95,6 +129,52 @@ void ESP8266HTTPUpdateServer::setup(ESP8266WebServer *server, const char * path,
     });
 }
 
+void ESP8266HTTPUpdateServer::setupFileSync(const char * path, fs::FS& fs, const char * root)
+{
+    String rootPath = root;
+    fs::FS* target = &fs;
+
+    // handler for the POST, once the archive is in
+    _server->on(path, HTTP_POST, [&](){
+      if(!_authenticated)
+        return _server->requestAuthentication();
+      _server->send(_syncResult.startsWith("error") ? 500 : 200, F("text/plain"), _syncResult);
+    },[target, rootPath, this](){
+      // the archive goes through the extractor as it arrives
+      HTTPUpload& upload = _server->upload();
+
+      if(upload.status == UPLOAD_FILE_START){
+        _syncResult = String();
+        _authenticated = (_username == NULL || _password == NULL || _server->authenticate(_username, _password));
+        if(!_authenticated)
+          return;
+        delete _sync;
+        _sync = new TarExtractor(*target, rootPath.c_str());
+        if(!_sync || !_sync->begin()){
+          _syncResult = F("error: out of memory");
+          return;
+        }
+        upload.sink = [this](const uint8_t* data, size_t len){
+          return !len || _sync->write(data, len) == len;
+        };
+      } else if(_sync && (upload.status == UPLOAD_FILE_END || upload.status == UPLOAD_FILE_ABORTED)){
+        bool ok = _sync->end();
+        const TarExtractorStats& stats = _sync->stats();
+        if(ok && upload.status == UPLOAD_FILE_END){
+          _syncResult = String(stats.files) + F(" files, ") + String(stats.written) + F(" written, ") +
+                        String(stats.unchanged) + F(" unchanged\n");
+        } else {
+          _syncResult = String(F("error ")) + String((int) _sync->error()) + F(" at ") + _sync->errorPath() + '\n';
+        }
+        if (_serial_output)
+          Serial.print(_syncResult);
+        delete _sync;
+        _sync = NULL;
+      }
+      delay(0);
+    });
+}
+
 void ESP8266HTTPUpdateServer::_setUpdaterError()
 {
   if (_serial_output) Update.printError(Serial);
@@ -2,6 +2,11 @@
 #define __HTTP_UPDATE_SERVER_H
 
 class ESP8266WebServer;
+class TarExtractor;
+
+namespace fs {
+class FS;
+}
 
 class ESP8266HTTPUpdateServer
 {
@@ -25,6 +30,10 @@ class ESP8266HTTPUpdateServer
 
     void setup(ESP8266WebServer *server, const char * path, const char * username, const char * password);
 
+    // After setup(), take POSTs of a tar archive of files at path and put
+    // them into fs under root, leaving those that didn't change alone
+    void setupFileSync(const char * path, fs::FS& fs, const char * root = "/");
+
   protected:
     void _setUpdaterError();
 
@@ -35,6 +44,8 @@ class ESP8266HTTPUpdateServer
     char * _password;
     bool _authenticated;
     String _updaterError;
+    TarExtractor *_sync;
+    String _syncResult;
 };
 
 
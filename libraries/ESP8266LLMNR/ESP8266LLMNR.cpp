@@ -47,6 +47,7 @@ extern "C" {
 #include <lwip/udp.h>
 #include <lwip/igmp.h>
 #include <include/UdpContext.h>
+#include <include/UdpMulticast.h>
 
 //#define LLMNR_DEBUG
 
@@ -61,21 +62,20 @@ extern "C" {
 #define FLAGS_RCODE_SHIFT       0
 #define FLAGS_RCODE_MASK        0xf
 
-#define _conn_read16() (((uint16_t)_conn->read() << 8) | _conn->read())
-#define _conn_read8() _conn->read()
-#define _conn_readS(b, l) _conn->read((b), (l));
+#define _conn_readS(b, l) _conn->read(reinterpret_cast<char*>(b), (l));
 
 static const IPAddress LLMNR_MULTICAST_ADDR(224, 0, 0, 252);
 static const int LLMNR_MULTICAST_TTL = 1;
 static const int LLMNR_PORT = 5355;
 
 LLMNRResponder::LLMNRResponder() :
-    _conn(0) {
+    _conn(0),
+    _response_size(0) {
 }
 
 LLMNRResponder::~LLMNRResponder() {
     if (_conn)
-        _conn->unref();
+        UdpMulticast::unsubscribe(this);
 }
 
 bool LLMNRResponder::begin(const char* hostname) {
@@ -85,6 +85,7 @@ bool LLMNRResponder::begin(const char* hostname) {
 
     _hostname = hostname;
     _hostname.toLowerCase();
+    _build_response();
 
     _sta_got_ip_handler = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP& event){
         (void) event;
@@ -105,113 +106,110 @@ void LLMNRResponder::notify_ap_change() {
 
 bool LLMNRResponder::_restart() {
     if (_conn) {
-        _conn->unref();
+        UdpMulticast::unsubscribe(this);
         _conn = 0;
     }
 
     ip_addr_t multicast_addr;
     multicast_addr.addr = (uint32_t)LLMNR_MULTICAST_ADDR;
 
-    if (igmp_joingroup(IP_ADDR_ANY, &multicast_addr) != ERR_OK)
-        return false;
-
-    _conn = new UdpContext;
-    _conn->ref();
-
-    if (!_conn->listen(*IP_ADDR_ANY, LLMNR_PORT))
+    // only queries for our name get to _process_packet()
+    auto filter = [this](const uint8_t* data, size_t size) {
+        return _is_query_for_us(data, size);
+    };
+    _conn = UdpMulticast::subscribe(this, multicast_addr.addr, LLMNR_PORT,
+                                    [this](UdpContext&) { _process_packet(); }, filter);
+    if (!_conn)
         return false;
 
     _conn->setMulticastTTL(LLMNR_MULTICAST_TTL);
-    _conn->onRx(std::bind(&LLMNRResponder::_process_packet, this));
     _conn->connect(multicast_addr, LLMNR_PORT);
     return true;
 }
 
-void LLMNRResponder::_process_packet() {
-    if (!_conn || !_conn->next())
-        return;
-
-#ifdef LLMNR_DEBUG
-    Serial.println("LLMNR: RX'd packet");
-#endif
+void LLMNRResponder::_build_response() {
+    uint8_t namelen = _hostname.length();
+    uint8_t* p = _response;
 
-    uint16_t id = _conn_read16();
-    uint16_t flags = _conn_read16();
-    uint16_t qdcount = _conn_read16();
-    uint16_t ancount = _conn_read16();
-    uint16_t nscount = _conn_read16();
-    uint16_t arcount = _conn_read16();
+    // Header
+    uint8_t header[] = {
+        0, 0, // ID
+        (uint8_t)(FLAGS_QR >> 8), 0, // FLAGS
+        0, 1, // QDCOUNT
+        0, 1, // ANCOUNT
+        0, 0, // NSCOUNT
+        0, 0, // ARCOUNT
+    };
+    memcpy(p, header, sizeof(header));
+    p += sizeof(header);
+    // Question, then the answer with the same name
+    for (int i = 0; i < 2; i++) {
+        *p++ = namelen;
+        memcpy(p, _hostname.c_str(), namelen);
+        p += namelen;
+        uint8_t q[] = {
+            0, // Name terminator
+            0, 1, // TYPE (A)
+            0, 1, // CLASS (IN)
+        };
+        memcpy(p, q, sizeof(q));
+        p += sizeof(q);
+    }
+    uint8_t rr[] = {
+        0, 0, 0, 30, // TTL (30 seconds)
+        0, 4, // RDLENGTH
+        0, 0, 0, 0 // RDATA, the address the query came to
+    };
+    memcpy(p, rr, sizeof(rr));
+    p += sizeof(rr);
+    _response_size = p - _response;
+}
 
-#ifdef LLMNR_DEBUG
-    Serial.print("LLMNR: ID=");
-    Serial.println(id, HEX);
-    Serial.print("LLMNR: FLAGS=");
-    Serial.println(flags, HEX);
-    Serial.print("LLMNR: QDCOUNT=");
-    Serial.println(qdcount);
-    Serial.print("LLMNR: ANCOUNT=");
-    Serial.println(ancount);
-    Serial.print("LLMNR: NSCOUNT=");
-    Serial.println(nscount);
-    Serial.print("LLMNR: ARCOUNT=");
-    Serial.println(arcount);
-#endif
+bool LLMNRResponder::_is_query_for_us(const uint8_t* data, size_t size) const {
+    DNSHeaderView header;
+    if (!header.parse(data, size))
+        return false;
 
 #define BAD_FLAGS (FLAGS_QR | (FLAGS_OP_MASK << FLAGS_OP_SHIFT) | FLAGS_C)
-    if (flags & BAD_FLAGS) {
-#ifdef LLMNR_DEBUG
-        Serial.println("Bad flags");
-#endif
-        return;
-    }
-
-    if (qdcount != 1) {
-#ifdef LLMNR_DEBUG
-        Serial.println("QDCOUNT != 1");
-#endif
-        return;
-    }
+    if ((header.flags & BAD_FLAGS) || header.qdcount != 1 ||
+        header.ancount || header.nscount || header.arcount)
+        return false;
 
-    if (ancount || nscount || arcount) {
-#ifdef LLMNR_DEBUG
-        Serial.println("AN/NS/AR-COUNT != 0");
-#endif
-        return;
+    // a single label, compared without regard to case
+    size_t namelen = _hostname.length();
+    if (size < 12 + 1 + namelen + 1 + 4 || data[12] != namelen || data[13 + namelen] != 0)
+        return false;
+    const char* name = _hostname.c_str();
+    for (size_t i = 0; i < namelen; i++) {
+        if (tolower(data[13 + i]) != name[i])
+            return false;
     }
+    return true;
+}
 
-    uint8_t namelen = _conn_read8();
-#ifdef LLMNR_DEBUG
-    Serial.print("QNAME len ");
-    Serial.println(namelen);
-#endif
-    if (namelen != _hostname.length()) {
-#ifdef LLMNR_DEBUG
-        Serial.println("QNAME len mismatch");
-#endif
+void LLMNRResponder::_process_packet() {
+    if (!_conn)
         return;
-    }
 
-    char qname[64];
-    _conn_readS(qname, namelen);
-    _conn_read8();
-    qname[namelen] = '\0';
-#ifdef LLMNR_DEBUG
-    Serial.print("QNAME ");
-    Serial.println(qname);
-#endif
-
-    if (strcmp(_hostname.c_str(), qname)) {
-#ifdef LLMNR_DEBUG
-        Serial.println("QNAME mismatch");
-#endif
-        return;
-    }
+    size_t namelen = _hostname.length();
+    size_t question_size = 1 + namelen + 1 + 4;
+    uint8_t packet[MAX_RESPONSE_SIZE];
+    memcpy(packet, _response, _response_size);
+
+    // the filter checked the header and the name already: take the ID, and
+    // the question as it was asked
+    uint8_t header[12];
+    _conn_readS(header, sizeof(header));
+    packet[0] = header[0];
+    packet[1] = header[1];
+    _conn_readS(packet + 12, question_size);
+    _conn->flush();
 
-    uint16_t qtype = _conn_read16();
-    uint16_t qclass = _conn_read16();
+    uint16_t qtype = (packet[12 + namelen + 2] << 8) | packet[12 + namelen + 3];
+    uint16_t qclass = (packet[12 + namelen + 4] << 8) | packet[12 + namelen + 5];
 
 #ifdef LLMNR_DEBUG
-    Serial.print("QTYPE ");
+    Serial.print("LLMNR: QTYPE ");
     Serial.print(qtype);
     Serial.print(" QCLASS ");
     Serial.println(qclass);
@@ -221,8 +219,6 @@ void LLMNRResponder::_process_packet() {
         (qtype == 1) && /* A */
         (qclass == 1); /* IN */
 
-    _conn->flush();
-
 #ifdef LLMNR_DEBUG
     Serial.println("Match; responding");
     if (!have_rr)
@@ -243,39 +239,14 @@ void LLMNRResponder::_process_packet() {
         wifi_get_ip_info(STATION_IF, &ip_info);
     uint32_t ip = ip_info.ip.addr;
 
-    // Header
-    uint8_t header[] = {
-        (uint8_t)(id >> 8), (uint8_t)(id & 0xff), // ID
-        (uint8_t)(FLAGS_QR >> 8), 0, // FLAGS
-        0, 1, // QDCOUNT
-        0, !!have_rr, // ANCOUNT
-        0, 0, // NSCOUNT
-        0, 0, // ARCOUNT
-    };
-    _conn->append(reinterpret_cast<const char*>(header), sizeof(header));
-    // Question
-    _conn->append(reinterpret_cast<const char*>(&namelen), 1);
-    _conn->append(qname, namelen);
-    uint8_t q[] = {
-        0, // Name terminator
-        0, 1, // TYPE (A)
-        0, 1, // CLASS (IN)
-    };
-    _conn->append(reinterpret_cast<const char*>(q), sizeof(q));
-    // Answer, if we have one
+    size_t size = 12 + question_size;
     if (have_rr) {
-        _conn->append(reinterpret_cast<const char*>(&namelen), 1);
-        _conn->append(qname, namelen);
-        uint8_t rr[] = {
-            0, // Name terminator
-            0, 1, // TYPE (A)
-            0, 1, // CLASS (IN)
-            0, 0, 0, 30, // TTL (30 seconds)
-            0, 4, // RDLENGTH
-            (uint8_t)(ip & 0xff), (uint8_t)((ip >> 8) & 0xff), (uint8_t)((ip >> 16) & 0xff), (uint8_t)((ip >> 24) & 0xff) // RDATA
-        };
-        _conn->append(reinterpret_cast<const char*>(rr), sizeof(rr));
+        size = _response_size;
+        memcpy(packet + size - 4, &ip, 4);
+    } else {
+        packet[7] = 0; // ANCOUNT
     }
+    _conn->append(reinterpret_cast<const char*>(packet), size);
     _conn->setMulticastInterface(remote_ip);
     _conn->send(&remote_ip, _conn->getRemotePort());
 }
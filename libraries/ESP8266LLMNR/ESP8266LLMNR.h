@@ -50,12 +50,20 @@ public:
     void notify_ap_change();
 
 private:
+    // header, question and A record, the longest label being 63 bytes
+    static const size_t MAX_RESPONSE_SIZE = 12 + 2 * (1 + 63 + 1 + 4) + 10;
+
     String _hostname;
     UdpContext *_conn;
+    // prepared by begin(), only the ID, question and address change
+    uint8_t _response[MAX_RESPONSE_SIZE];
+    size_t _response_size;
     WiFiEventHandler _sta_got_ip_handler;
     WiFiEventHandler _sta_disconnected_handler;
 
     bool _restart();
+    void _build_response();
+    bool _is_query_for_us(const uint8_t* data, size_t size) const;
     void _process_packet();
 };
 
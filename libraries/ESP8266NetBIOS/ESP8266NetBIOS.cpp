@@ -127,7 +127,26 @@ void ESP8266NetBIOS::_makenbname(char *name, char *nbname, uint8_t outlen)
     *nbname = 0; // ulozime ukoncovaci 0 retezce
 }
 
-ESP8266NetBIOS::ESP8266NetBIOS():_pcb(NULL)
+/** Porovnani jmena z dotazu (v NETBIOS kodovani) se jmenem v nbname.
+ *	Za jmenem smi byt jen mezery nebo 0, priponu (typ sluzby) bereme jen 0x00 a 0x20.
+ *	\param qname Jmeno z dotazu, 32 znaku.
+ *	\param nbname Hledane jmeno v NETBIOS kodovani.
+ *	\param len Pocet znaku nbname, nejvyse 30.
+ */
+static bool _nbname_match(const char *qname, const char *nbname, size_t len)
+{
+    if (memcmp(qname, nbname, len) != 0) {
+        return false;
+    }
+    for (size_t i = len; i < 32; i += 2) {
+        if (qname[i + 1] != 'A' || (qname[i] != 'A' && qname[i] != 'C')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ESP8266NetBIOS::ESP8266NetBIOS():_pcb(NULL), _answer(NULL), _status(NULL)
 {
 
 }
@@ -151,6 +170,48 @@ bool ESP8266NetBIOS::begin(const char *name)
     }
     _name[n] = '\0';
 
+    if (!_answer) {
+        _answer = new NBNSANSWER;
+        _status = new NBNSANSWERN;
+    }
+
+    struct NBNSANSWER& nbnsa = *_answer;
+    nbnsa.NBNSA_ID = 0; // doplni se z dotazu
+    nbnsa.NBNSA_FLAGS1 = 0x85;	// priznak odpovedi
+    nbnsa.NBNSA_FLAGS2 = 0; // vlajky 2 a response code
+    nbnsa.NBNSA_QUESTIONCOUNT = LWIP_PLATFORM_HTONS(0);
+    nbnsa.NBNSA_ANSWERCOUNT = LWIP_PLATFORM_HTONS(1);// poradove cislo odpovedi
+    nbnsa.NBNSA_AUTHORITYCOUNT = LWIP_PLATFORM_HTONS(0);
+    nbnsa.NBNSA_ADDITIONALRECORDCOUNT = LWIP_PLATFORM_HTONS(0);
+    nbnsa.NBNSA_NAMESIZE = sizeof(nbnsa.NBNSA_NAME) - 1; // prekopirujeme delku jmena stanice
+    _makenbname(_name, &nbnsa.NBNSA_NAME[0], sizeof(nbnsa.NBNSA_NAME) - 1); // prevedeme jmeno
+    nbnsa.NBNSA_TYPE = LWIP_PLATFORM_HTONS(0x20); // NetBIOS name
+    nbnsa.NBNSA_CLASS = LWIP_PLATFORM_HTONS(1); // Internet name
+    nbnsa.NBNSA_TIMETOLIVE = LWIP_PLATFORM_HTONL(300000UL);// Time to live (30000 sekund)
+    nbnsa.NBNSA_LENGTH = LWIP_PLATFORM_HTONS(6);
+    nbnsa.NBNSA_NODEFLAGS = LWIP_PLATFORM_HTONS(0);
+    nbnsa.NBNSA_NODEADDRESS = 0; // doplni se pri odeslani
+
+    struct NBNSANSWERN& nbnsan = *_status;
+    nbnsan.NBNSAN_ID = 0; // doplni se z dotazu
+    nbnsan.NBNSAN_FLAGS1 = 0x84;	// priznak odpovedi
+    nbnsan.NBNSAN_FLAGS2 = 0; // vlajky 2 a response code
+    nbnsan.NBNSAN_QUESTIONCOUNT = LWIP_PLATFORM_HTONS(0);
+    nbnsan.NBNSAN_ANSWERCOUNT = LWIP_PLATFORM_HTONS(1);// poradove cislo odpovedi
+    nbnsan.NBNSAN_AUTHORITYCOUNT = LWIP_PLATFORM_HTONS(0);
+    nbnsan.NBNSAN_ADDITIONALRECORDCOUNT = LWIP_PLATFORM_HTONS(0);
+    nbnsan.NBNSAN_NAMESIZE = sizeof(nbnsan.NBNSAN_NAME) - 1;
+    memset(nbnsan.NBNSAN_NAME, 0, sizeof(nbnsan.NBNSAN_NAME)); // doplni se z dotazu
+    nbnsan.NBNSAN_TYPE = LWIP_PLATFORM_HTONS(0x21); // NBSTAT
+    nbnsan.NBNSAN_CLASS = LWIP_PLATFORM_HTONS(1); // Internet name
+    nbnsan.NBNSAN_TIMETOLIVE = LWIP_PLATFORM_HTONL(0);
+    nbnsan.NBNSAN_LENGTH = LWIP_PLATFORM_HTONS(4 + sizeof(nbnsan.NBNSAN_NNAME));
+    nbnsan.NBNSAN_NUMBER = 1; // Number of names
+    memset(nbnsan.NBNSAN_NNAME, 0x20, sizeof(nbnsan.NBNSAN_NNAME));
+    memcpy(nbnsan.NBNSAN_NNAME, _name, n < sizeof(nbnsan.NBNSAN_NNAME) ? n : sizeof(nbnsan.NBNSAN_NNAME));
+    nbnsan.NBNSAN_NTYPE = 0; // Workstation/Redirector
+    nbnsan.NBNSAN_NFLAGS = LWIP_PLATFORM_HTONS(0x400); // b-node, unique, active
+
     if(_pcb != NULL) {
         return true;
     }
@@ -172,6 +233,20 @@ void ESP8266NetBIOS::end()
         udp_remove(_pcb);
         _pcb = NULL;
     }
+    delete _answer;
+    delete _status;
+    _answer = NULL;
+    _status = NULL;
+}
+
+void ESP8266NetBIOS::_send(const void *packet, size_t size, const ip_addr_t *addr)
+{
+    pbuf* pbt = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_RAM);
+    if(pbt != NULL) {
+        memcpy(pbt->payload, packet, size);
+        udp_sendto(_pcb, pbt, addr, NBNS_PORT);
+        pbuf_free(pbt);
+    }
 }
 
 #if LWIP_VERSION_MAJOR == 1 
@@ -190,75 +265,25 @@ void ESP8266NetBIOS::_recv(udp_pcb *upcb, pbuf *pb, const ip_addr_t *addr, uint1
         ip_addr_t saddr;
         saddr.addr = iphdr->src.addr;
 
-        if (len >= sizeof(struct NBNSQUESTION)) {
-            struct NBNSQUESTION * question = (struct NBNSQUESTION *)data;
-            if (0 == (question->NBNSQ_FLAGS1 & 0x80)) {
-                char name[ NBNS_MAX_HOSTNAME_LEN + 1 ]; // dekodovane dotazovane jmeno
-                char *str; // pomocna promenna, pouze pro praci s retezcem
-
-                _getnbname(&question->NBNSQ_NAME[0], (char *)&name, question->NBNSQ_NAMESIZE); // prevedeme dotazovane jmeno
-                if ((str = strchr(name, ' ')) != NULL) { // jmeno hledaneho zarizeni v tomto pripade ukoncuje i mezera
-                    *str = '\0';    // ukoncime retezec na vyskytu prvni mezery
-                }
-
-                if (0 == strcmp(name, _name)) {
-                    // dotaz primo na nas
-                    struct NBNSANSWER nbnsa; // buffer, do ktereho je sestavena odpoved na dotaz
-
-                    nbnsa.NBNSA_ID = question->NBNSQ_ID;// ID dotazu kopirujeme do ID odpovedi
-                    nbnsa.NBNSA_FLAGS1 = 0x85;	// priznak odpovedi
-                    nbnsa.NBNSA_FLAGS2 = 0; // vlajky 2 a response code
-                    nbnsa.NBNSA_QUESTIONCOUNT = LWIP_PLATFORM_HTONS(0);
-                    nbnsa.NBNSA_ANSWERCOUNT = LWIP_PLATFORM_HTONS(1);// poradove cislo odpovedi
-                    nbnsa.NBNSA_AUTHORITYCOUNT = LWIP_PLATFORM_HTONS(0);
-                    nbnsa.NBNSA_ADDITIONALRECORDCOUNT = LWIP_PLATFORM_HTONS(0);
-                    nbnsa.NBNSA_NAMESIZE = sizeof(nbnsa.NBNSA_NAME) - 1; // prekopirujeme delku jmena stanice
-                    _makenbname(_name, &nbnsa.NBNSA_NAME[0], sizeof(nbnsa.NBNSA_NAME) - 1); // prevedeme jmeno
-                    nbnsa.NBNSA_TYPE = LWIP_PLATFORM_HTONS(0x20); // NetBIOS name
-                    nbnsa.NBNSA_CLASS = LWIP_PLATFORM_HTONS(1); // Internet name
-                    nbnsa.NBNSA_TIMETOLIVE = LWIP_PLATFORM_HTONL(300000UL);// Time to live (30000 sekund)
-                    nbnsa.NBNSA_LENGTH = LWIP_PLATFORM_HTONS(6);
-                    nbnsa.NBNSA_NODEFLAGS = LWIP_PLATFORM_HTONS(0);
-                    nbnsa.NBNSA_NODEADDRESS = WiFi.localIP(); // ulozime nasi IP adresu
-
-                    pbuf* pbt = pbuf_alloc(PBUF_TRANSPORT, sizeof(nbnsa), PBUF_RAM);
-                    if(pbt != NULL) {
-                        uint8_t* dst = reinterpret_cast<uint8_t*>(pbt->payload);
-                        memcpy(dst, (uint8_t *)&nbnsa, sizeof(nbnsa));
-                        udp_sendto(_pcb, pbt, &saddr, NBNS_PORT);
-                        pbuf_free(pbt);
-                    }
-                } else if (0 == strcmp(name, "*")) {
-                    // obecny dotaz - mireny nejspis na nasi IP adresu
-                    struct NBNSANSWERN nbnsan; // buffer, do ktereho je sestavena odpoved na dotaz
-
-                    nbnsan.NBNSAN_ID = question->NBNSQ_ID;// ID dotazu kopirujeme do ID odpovedi
-                    nbnsan.NBNSAN_FLAGS1 = 0x84;	// priznak odpovedi
-                    nbnsan.NBNSAN_FLAGS2 = 0; // vlajky 2 a response code
-                    nbnsan.NBNSAN_QUESTIONCOUNT = LWIP_PLATFORM_HTONS(0);
-                    nbnsan.NBNSAN_ANSWERCOUNT = LWIP_PLATFORM_HTONS(1);// poradove cislo odpovedi
-                    nbnsan.NBNSAN_AUTHORITYCOUNT = LWIP_PLATFORM_HTONS(0);
-                    nbnsan.NBNSAN_ADDITIONALRECORDCOUNT = LWIP_PLATFORM_HTONS(0);
-                    nbnsan.NBNSAN_NAMESIZE = question->NBNSQ_NAMESIZE; // prekopirujeme delku jmena stanice
-                    memcpy(nbnsan.NBNSAN_NAME, question->NBNSQ_NAME, sizeof(nbnsan.NBNSAN_NAME)); // prekopirujeme dotazovane jmeno
-                    nbnsan.NBNSAN_TYPE = LWIP_PLATFORM_HTONS(0x21); // NBSTAT
-                    nbnsan.NBNSAN_CLASS = LWIP_PLATFORM_HTONS(1); // Internet name
-                    nbnsan.NBNSAN_TIMETOLIVE = LWIP_PLATFORM_HTONL(0);
-                    nbnsan.NBNSAN_LENGTH = LWIP_PLATFORM_HTONS(4 + sizeof(nbnsan.NBNSAN_NNAME));
-                    nbnsan.NBNSAN_NUMBER = 1; // Number of names
-                    memset(nbnsan.NBNSAN_NNAME, 0x20, sizeof(nbnsan.NBNSAN_NNAME));
-                    memcpy(nbnsan.NBNSAN_NNAME, _name, strlen(_name));
-                    nbnsan.NBNSAN_NTYPE = 0; // Workstation/Redirector
-                    nbnsan.NBNSAN_NFLAGS = LWIP_PLATFORM_HTONS(0x400); // b-node, unique, active
-
-                    pbuf* pbt = pbuf_alloc(PBUF_TRANSPORT, sizeof(nbnsan), PBUF_RAM);
-                    if(pbt != NULL) {
-                        uint8_t* dst = reinterpret_cast<uint8_t*>(pbt->payload);
-                        memcpy(dst, (uint8_t *)&nbnsan, sizeof(nbnsan));
-                        udp_sendto(_pcb, pbt, &saddr, NBNS_PORT);
-                        pbuf_free(pbt);
-                    }
-                }
+        // vetsina dotazu neni pro nas: rozhodne par porovnani, bez dekodovani jmena
+        struct NBNSQUESTION * question = (struct NBNSQUESTION *)data;
+        if (len >= sizeof(struct NBNSQUESTION) && _answer &&
+                0 == (question->NBNSQ_FLAGS1 & 0x80) &&
+                question->NBNSQ_NAMESIZE == 32) {
+            size_t namelen = 2 * strlen(_name);
+            if (namelen > 30) {
+                namelen = 30;
+            }
+            if (_nbname_match(question->NBNSQ_NAME, _answer->NBNSA_NAME, namelen)) {
+                // dotaz primo na nas
+                _answer->NBNSA_ID = question->NBNSQ_ID;// ID dotazu kopirujeme do ID odpovedi
+                _answer->NBNSA_NODEADDRESS = WiFi.localIP(); // ulozime nasi IP adresu
+                _send(_answer, sizeof(*_answer), &saddr);
+            } else if (_nbname_match(question->NBNSQ_NAME, "CK", 2)) {
+                // obecny dotaz "*" - mireny nejspis na nasi IP adresu
+                _status->NBNSAN_ID = question->NBNSQ_ID;// ID dotazu kopirujeme do ID odpovedi
+                memcpy(_status->NBNSAN_NAME, question->NBNSQ_NAME, sizeof(_status->NBNSAN_NAME)); // prekopirujeme dotazovane jmeno
+                _send(_status, sizeof(*_status), &saddr);
             }
         }
 
@@ -19,14 +19,20 @@ extern "C" {
 
 struct udp_pcb;
 struct pbuf;
+struct NBNSANSWER;
+struct NBNSANSWERN;
 
 class ESP8266NetBIOS
 {
 protected:
     udp_pcb* _pcb;
     char _name[NBNS_MAX_HOSTNAME_LEN + 1];
+    // odpovedi pripravene v begin(), pri dotazu se doplni jen ID a adresa
+    NBNSANSWER* _answer;
+    NBNSANSWERN* _status;
     void _getnbname(char *nbname, char *name, uint8_t maxlen);
     void _makenbname(char *name, char *nbname, uint8_t outlen);
+    void _send(const void *packet, size_t size, const ip_addr_t *addr);
    
 #if LWIP_VERSION_MAJOR == 1 
     void _recv(udp_pcb *upcb, pbuf *pb, struct ip_addr *addr, uint16_t port);
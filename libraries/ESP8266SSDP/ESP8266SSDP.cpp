@@ -45,6 +45,7 @@ extern "C" {
 #include "lwip/igmp.h"
 #include "lwip/mem.h"
 #include "include/UdpContext.h"
+#include "include/UdpMulticast.h"
 
 // #define DEBUG_SSDP  Serial
 
@@ -54,6 +55,7 @@ extern "C" {
 #define SSDP_URI_SIZE     2
 #define SSDP_BUFFER_SIZE  64
 #define SSDP_MULTICAST_TTL 2
+#define SSDP_MAX_MX       5   // longer delays are to be taken as 5 s
 static const IPAddress SSDP_MULTICAST_ADDR(239, 255, 255, 250);
 
 
@@ -122,19 +124,52 @@ static const char _ssdp_schema_template[] PROGMEM =
 
 
 struct SSDPTimer {
-  ETSTimer timer;
+  ETSTimer timer;     // notify
+  ETSTimer response;  // the reply to a search, after its random delay
 };
 
+struct SSDPPacket {
+  char* data;
+  size_t size;
+};
+
+// The packets only change with the settings and the address, they are
+// formatted once and then sent as they are.
+struct SSDPPackets {
+  SSDPPacket response;
+  SSDPPacket notify;
+  SSDPPacket schema;
+  uint32_t ip;
+};
+
+static bool _ssdp_render(SSDPPacket& packet, PGM_P format, ...) {
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf_P(NULL, 0, format, args);
+  va_end(args);
+
+  free(packet.data);
+  packet.size = 0;
+  packet.data = (char*) malloc(len + 1);
+  if (!packet.data) {
+    return false;
+  }
+  va_start(args, format);
+  vsnprintf_P(packet.data, len + 1, format, args);
+  va_end(args);
+  packet.size = len;
+  return true;
+}
+
 SSDPClass::SSDPClass() :
 _server(0),
 _timer(new SSDPTimer),
+_packets(new SSDPPackets()),
 _port(80),
 _ttl(SSDP_MULTICAST_TTL),
 _respondToPort(0),
 _pending(false),
-_delay(0),
-_process_time(0),
-_notify_time(0)
+_delay(0)
 {
   _uuid[0] = '\0';
   _modelNumber[0] = '\0';
@@ -150,74 +185,121 @@ _notify_time(0)
 }
 
 SSDPClass::~SSDPClass(){
+  if (_server) {
+    UdpMulticast::unsubscribe(this);
+  }
+  os_timer_disarm(&_timer->timer);
+  os_timer_disarm(&_timer->response);
   delete _timer;
+  _invalidate();
+  delete _packets;
+}
+
+void SSDPClass::_invalidate(){
+  free(_packets->response.data);
+  free(_packets->notify.data);
+  free(_packets->schema.data);
+  *_packets = SSDPPackets();
+}
+
+bool SSDPClass::_render(){
+  IPAddress ip = WiFi.localIP();
+  if (_packets->schema.data && _packets->ip == (uint32_t) ip) {
+    return true;
+  }
+  _invalidate();
+  _packets->ip = ip;
+
+  bool ok = true;
+  for (int i = 0; i < 2; i++) {
+    SSDPPacket& packet = i ? _packets->notify : _packets->response;
+    char valueBuffer[strlen_P(_ssdp_notify_template)+1];
+    strcpy_P(valueBuffer, i ? _ssdp_notify_template : _ssdp_response_template);
+    ok &= _ssdp_render(packet,
+      _ssdp_packet_template,
+      valueBuffer,
+      SSDP_INTERVAL,
+      _modelName, _modelNumber,
+      _uuid,
+      i ? "NT" : "ST",
+      _deviceType,
+      ip[0], ip[1], ip[2], ip[3], _port, _schemaURL
+    );
+  }
+  ok &= _ssdp_render(_packets->schema,
+    _ssdp_schema_template,
+    ip[0], ip[1], ip[2], ip[3], _port,
+    _deviceType,
+    _friendlyName,
+    _presentationURL,
+    _serialNumber,
+    _modelName,
+    _modelNumber,
+    _modelURL,
+    _manufacturer,
+    _manufacturerURL,
+    _uuid
+  );
+  if (!ok) {
+    _invalidate();
+  }
+  return ok;
 }
 
 bool SSDPClass::begin(){
   _pending = false;
+  os_timer_disarm(&_timer->response);
 
   uint32_t chipId = ESP.getChipId();
   sprintf(_uuid, "38323636-4558-4dda-9188-cda0e6%02x%02x%02x",
     (uint16_t) ((chipId >> 16) & 0xff),
     (uint16_t) ((chipId >>  8) & 0xff),
     (uint16_t)   chipId        & 0xff  );
+  _invalidate();
 
 #ifdef DEBUG_SSDP
   DEBUG_SSDP.printf("SSDP UUID: %s\n", (char *)_uuid);
 #endif
 
   if (_server) {
-    _server->unref();
+    UdpMulticast::unsubscribe(this);
     _server = 0;
   }
 
-  _server = new UdpContext;
-  _server->ref();
-
   ip_addr_t ifaddr;
   ifaddr.addr = WiFi.localIP();
   ip_addr_t multicast_addr;
   multicast_addr.addr = (uint32_t) SSDP_MULTICAST_ADDR;
-  if (igmp_joingroup(&ifaddr, &multicast_addr) != ERR_OK ) {
-    DEBUGV("SSDP failed to join igmp group");
-    return false;
-  }
 
-  if (!_server->listen(*IP_ADDR_ANY, SSDP_PORT)) {
+  // while a reply is pending further searches are ignored
+  auto filter = [this](const uint8_t* data, size_t size) {
+    return !_pending && size >= 9 && memcmp(data, "M-SEARCH ", 9) == 0;
+  };
+  _server = UdpMulticast::subscribe(this, multicast_addr.addr, SSDP_PORT,
+                                    [this](UdpContext&) { _parsePacket(); }, filter);
+  if (!_server) {
+    DEBUGV("SSDP failed to join igmp group");
     return false;
   }
 
   _server->setMulticastInterface(ifaddr);
   _server->setMulticastTTL(_ttl);
-  _server->onRx(std::bind(&SSDPClass::_update, this));
   if (!_server->connect(multicast_addr, SSDP_PORT)) {
     return false;
   }
 
   _startTimer();
+  _send(NOTIFY);
 
   return true;
 }
 
 void SSDPClass::_send(ssdp_method_t method){
-  char buffer[1460];
-  IPAddress ip = WiFi.localIP();
-
-  char valueBuffer[strlen_P(_ssdp_notify_template)+1];
-  strcpy_P(valueBuffer, (method == NONE)?_ssdp_response_template:_ssdp_notify_template);
-
-  int len = snprintf_P(buffer, sizeof(buffer),
-    _ssdp_packet_template,
-    valueBuffer,
-    SSDP_INTERVAL,
-    _modelName, _modelNumber,
-    _uuid,
-    (method == NONE)?"ST":"NT",
-    _deviceType,
-   ip[0], ip[1], ip[2], ip[3], _port, _schemaURL
-  );
-
-  _server->append(buffer, len);
+  if (!_render()) {
+    return;
+  }
+  const SSDPPacket& packet = (method == NONE) ? _packets->response : _packets->notify;
+  _server->append(packet.data, packet.size);
 
   ip_addr_t remoteAddr;
   uint16_t remotePort;
@@ -244,26 +326,13 @@ void SSDPClass::_send(ssdp_method_t method){
 }
 
 void SSDPClass::schema(WiFiClient client){
-  IPAddress ip = WiFi.localIP();
-  char buffer[strlen_P(_ssdp_schema_template)+1];
-  strcpy_P(buffer, _ssdp_schema_template);
-  client.printf(buffer,
-    ip[0], ip[1], ip[2], ip[3], _port,
-    _deviceType,
-    _friendlyName,
-    _presentationURL,
-    _serialNumber,
-    _modelName,
-    _modelNumber,
-    _modelURL,
-    _manufacturer,
-    _manufacturerURL,
-    _uuid
-  );
+  if (_render()) {
+    client.write((const uint8_t*) _packets->schema.data, _packets->schema.size);
+  }
 }
 
-void SSDPClass::_update(){
-  if(!_pending && _server->next()) {
+void SSDPClass::_parsePacket(){
+  if(!_pending) {
     ssdp_method_t method = NONE;
 
     _respondToAddr = _server->getRemoteAddress();
@@ -307,7 +376,7 @@ void SSDPClass::_update(){
           if(cr == 2){ state = KEY; cursor = 0; }
           break;
         case KEY:
-          if(cr == 4){ _pending = true; _process_time = millis(); }
+          if(cr == 4){ _pending = true; }
           else if(c == ' '){ cursor = 0; state = VALUE; }
           else if(c != '\r' && c != '\n' && c != ':' && cursor < SSDP_BUFFER_SIZE - 1){ buffer[cursor++] = c; buffer[cursor] = '\0'; }
           break;
@@ -331,12 +400,14 @@ void SSDPClass::_update(){
                 // if the search type matches our type, we should respond instead of ABORT
                 if(strcasecmp(buffer, _deviceType) == 0){
                   _pending = true;
-                  _process_time = millis();
                   state = KEY;
                 }
                 break;
               case MX:
-                _delay = random(0, atoi(buffer)) * 1000L;
+                {
+                  int mx = constrain(atoi(buffer), 1, SSDP_MAX_MX);
+                  _delay = random(0, mx * 1000L);
+                }
                 break;
             }
 
@@ -356,69 +427,79 @@ void SSDPClass::_update(){
           break;
       }
     }
-  }
-
-  if(_pending && (millis() - _process_time) > _delay){
-    _pending = false; _delay = 0;
-    _send(NONE);
-  } else if(_notify_time == 0 || (millis() - _notify_time) > (SSDP_INTERVAL * 1000L)){
-    _notify_time = millis();
-    _send(NOTIFY);
-  }
 
-  if (_pending) {
-    while (_server->next())
-      _server->flush();
+    if(_pending){
+      // the reply is sent by the timer, further searches are ignored until then
+      ETSTimer* tm = &(_timer->response);
+      os_timer_disarm(tm);
+      os_timer_setfn(tm, reinterpret_cast<ETSTimerFunc*>(&SSDPClass::_onResponseTimerStatic), reinterpret_cast<void*>(this));
+      os_timer_arm(tm, _delay ? _delay : 1, 0);
+    }
   }
+}
 
+void SSDPClass::_update(){
+  _send(NOTIFY);
 }
 
 void SSDPClass::setSchemaURL(const char *url){
   strlcpy(_schemaURL, url, sizeof(_schemaURL));
+  _invalidate();
 }
 
 void SSDPClass::setHTTPPort(uint16_t port){
   _port = port;
+  _invalidate();
 }
 
 void SSDPClass::setDeviceType(const char *deviceType){
   strlcpy(_deviceType, deviceType, sizeof(_deviceType));
+  _invalidate();
 }
 
 void SSDPClass::setName(const char *name){
   strlcpy(_friendlyName, name, sizeof(_friendlyName));
+  _invalidate();
 }
 
 void SSDPClass::setURL(const char *url){
   strlcpy(_presentationURL, url, sizeof(_presentationURL));
+  _invalidate();
 }
 
 void SSDPClass::setSerialNumber(const char *serialNumber){
   strlcpy(_serialNumber, serialNumber, sizeof(_serialNumber));
+  _invalidate();
 }
 
 void SSDPClass::setSerialNumber(const uint32_t serialNumber){
   snprintf(_serialNumber, sizeof(uint32_t)*2+1, "%08X", serialNumber);
+  _invalidate();
 }
 
 void SSDPClass::setModelName(const char *name){
   strlcpy(_modelName, name, sizeof(_modelName));
+  _invalidate();
 }
 
 void SSDPClass::setModelNumber(const char *num){
   strlcpy(_modelNumber, num, sizeof(_modelNumber));
+  _invalidate();
 }
 
 void SSDPClass::setModelURL(const char *url){
   strlcpy(_modelURL, url, sizeof(_modelURL));
+  _invalidate();
 }
 
 void SSDPClass::setManufacturer(const char *name){
   strlcpy(_manufacturer, name, sizeof(_manufacturer));
+  _invalidate();
 }
 
 void SSDPClass::setManufacturerURL(const char *url){
   strlcpy(_manufacturerURL, url, sizeof(_manufacturerURL));
+  _invalidate();
 }
 
 void SSDPClass::setTTL(const uint8_t ttl){
@@ -429,9 +510,15 @@ void SSDPClass::_onTimerStatic(SSDPClass* self) {
   self->_update();
 }
 
+void SSDPClass::_onResponseTimerStatic(SSDPClass* self) {
+  self->_pending = false;
+  self->_delay = 0;
+  self->_send(NONE);
+}
+
 void SSDPClass::_startTimer() {
   ETSTimer* tm = &(_timer->timer);
-  const int interval = 1000;
+  const int interval = SSDP_INTERVAL * 1000;
   os_timer_disarm(tm);
   os_timer_setfn(tm, reinterpret_cast<ETSTimerFunc*>(&SSDPClass::_onTimerStatic), reinterpret_cast<void*>(this));
   os_timer_arm(tm, interval, 1 /* repeat */);
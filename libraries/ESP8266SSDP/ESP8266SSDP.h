@@ -55,6 +55,7 @@ typedef enum {
 
 
 struct SSDPTimer;
+struct SSDPPackets;
 
 class SSDPClass{
   public:
@@ -91,12 +92,17 @@ class SSDPClass{
 
   protected:
     void _send(ssdp_method_t method);
+    void _parsePacket();
     void _update();
     void _startTimer();
+    void _invalidate();
+    bool _render();
     static void _onTimerStatic(SSDPClass* self);
+    static void _onResponseTimerStatic(SSDPClass* self);
 
     UdpContext* _server;
     SSDPTimer* _timer;
+    SSDPPackets* _packets;  // rendered from the settings when first needed
     uint16_t _port;
     uint8_t _ttl;
 
@@ -104,9 +110,7 @@ class SSDPClass{
     uint16_t  _respondToPort;
 
     bool _pending;
-    unsigned short _delay;
-    unsigned long _process_time;
-    unsigned long _notify_time;
+    uint32_t _delay;
 
     char _schemaURL[SSDP_SCHEMA_URL_SIZE];
     char _uuid[SSDP_UUID_SIZE];
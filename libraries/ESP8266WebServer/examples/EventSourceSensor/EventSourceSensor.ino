@@ -0,0 +1,57 @@
+/*
+  Streams the readings of the analog input to every open page once a
+  second with Server-Sent Events, instead of having the pages poll.
+*/
+
+#include <ESP8266WiFi.h>
+#include <ESP8266WebServer.h>
+#include <EventSource.h>
+
+const char* ssid = "........";
+const char* password = "........";
+
+ESP8266WebServer server(80);
+EventSource events("/events");
+
+static const char PAGE[] PROGMEM = R"(<!DOCTYPE html>
+<html><body>A0: <span id="a0">?</span><script>
+var source = new EventSource('/events');
+source.addEventListener('a0', function(e) { document.getElementById('a0').textContent = e.data; });
+</script></body></html>)";
+
+void setup(void) {
+  Serial.begin(115200);
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+  Serial.println();
+  Serial.print("IP address: ");
+  Serial.println(WiFi.localIP());
+
+  server.on("/", []() {
+    server.send_P(200, "text/html", PAGE);
+  });
+  events.onConnect([](uint8_t num) {
+    Serial.printf("subscriber %u\n", num);
+  });
+  server.addHandler(&events);
+  server.setMaxClients(4);
+  server.begin();
+}
+
+void loop(void) {
+  server.handleClient();
+  events.loop();
+
+  static unsigned long last = 0;
+  static uint32_t id = 0;
+  if (millis() - last >= 1000) {
+    last = millis();
+    char value[8];
+    snprintf(value, sizeof(value), "%d", analogRead(A0));
+    events.send(value, "a0", ++id);
+  }
+}
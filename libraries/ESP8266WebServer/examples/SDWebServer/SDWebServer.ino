@@ -210,32 +210,28 @@ void printDirectory() {
     return returnFail("NOT DIR");
   }
   dir.rewindDirectory();
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/json", "");
-  WiFiClient client = server.client();
+  Print& out = server.beginResponse(200, "text/json");
 
-  server.sendContent("[");
+  out.print('[');
   for (int cnt = 0; true; ++cnt) {
     File entry = dir.openNextFile();
     if (!entry) {
       break;
     }
 
-    String output;
     if (cnt > 0) {
-      output = ',';
+      out.print(',');
     }
 
-    output += "{\"type\":\"";
-    output += (entry.isDirectory()) ? "dir" : "file";
-    output += "\",\"name\":\"";
-    output += entry.name();
-    output += "\"";
-    output += "}";
-    server.sendContent(output);
+    out.print("{\"type\":\"");
+    out.print((entry.isDirectory()) ? "dir" : "file");
+    out.print("\",\"name\":\"");
+    out.print(entry.name());
+    out.print("\"}");
     entry.close();
   }
-  server.sendContent("]");
+  out.print(']');
+  server.endResponse();
   dir.close();
 }
 
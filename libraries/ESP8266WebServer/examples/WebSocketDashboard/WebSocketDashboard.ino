@@ -0,0 +1,71 @@
+/*
+  Pushes the free heap and uptime to every open page twice a second over
+  a WebSocket, instead of having the pages poll for them.
+*/
+
+#include <ESP8266WiFi.h>
+#include <ESP8266WebServer.h>
+#include <WebSocketServer.h>
+
+const char* ssid = "........";
+const char* password = "........";
+
+ESP8266WebServer server(80);
+WebSocketServer webSocket("/ws");
+
+static const char PAGE[] PROGMEM = R"(<!DOCTYPE html>
+<html><body><pre id="status"></pre><script>
+var ws = new WebSocket('ws://' + location.host + '/ws');
+ws.onmessage = function(e) { document.getElementById('status').textContent = e.data; };
+</script></body></html>)";
+
+void onWebSocketEvent(uint8_t num, WebSocketEvent event, uint8_t* data, size_t length, const WebSocketDataInfo& info) {
+  switch (event) {
+    case WS_CONNECTED:
+      Serial.printf("[%u] connected from %s\n", num, webSocket.remoteIP(num).toString().c_str());
+      break;
+    case WS_DISCONNECTED:
+      Serial.printf("[%u] disconnected\n", num);
+      break;
+    case WS_TEXT:
+      // a long message may come in several pieces
+      Serial.printf("[%u] text at %u: %.*s%s\n", num, info.index, length, (const char*) data, info.final ? "" : "...");
+      break;
+    default:
+      break;
+  }
+}
+
+void setup(void) {
+  Serial.begin(115200);
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+  Serial.println();
+  Serial.print("IP address: ");
+  Serial.println(WiFi.localIP());
+
+  server.on("/", []() {
+    server.send_P(200, "text/html", PAGE);
+  });
+  webSocket.onEvent(onWebSocketEvent);
+  server.addHandler(&webSocket);
+  server.setMaxClients(4);
+  server.begin();
+}
+
+void loop(void) {
+  server.handleClient();
+  webSocket.loop();
+
+  static unsigned long last = 0;
+  if (millis() - last >= 500) {
+    last = millis();
+    char status[64];
+    int length = snprintf(status, sizeof(status), "heap %u\nuptime %lu s", ESP.getFreeHeap(), millis() / 1000);
+    webSocket.broadcastText(status, length);
+  }
+}
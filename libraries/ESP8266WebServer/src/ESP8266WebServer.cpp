@@ -1,6 +1,6 @@
 /*
   ESP8266WebServer.cpp - Dead simple web-server.
-  Supports only one simultaneous client, knows how to handle GET and POST.
+  Services a small pool of simultaneous clients, knows how to handle GET and POST.
 
   Copyright (c) 2014 Ivan Grokhotkov. All rights reserved.
 
@@ -27,7 +27,9 @@
 #include "WiFiClient.h"
 #include "ESP8266WebServer.h"
 #include "FS.h"
+#include "Metrics.h"
 #include "detail/RequestHandlersImpl.h"
+#include "include/DataSource.h"
 
 //#define DEBUG_ESP_HTTP_SERVER
 #ifdef DEBUG_ESP_PORT
@@ -37,44 +39,82 @@
 #endif
 
 static const char AUTHORIZATION_HEADER[] PROGMEM = "Authorization";
-static const char qop_auth[] PROGMEM = "qop=auth";
 static const char WWW_Authenticate[] PROGMEM = "WWW-Authenticate";
 static const char Content_Length[] PROGMEM = "Content-Length";
+static const char IF_NONE_MATCH_HEADER[] PROGMEM = "If-None-Match";
+static const char UPGRADE_HEADER[] PROGMEM = "Upgrade";
+static const char SEC_WEBSOCKET_KEY_HEADER[] PROGMEM = "Sec-WebSocket-Key";
+static const char SEC_WEBSOCKET_VERSION_HEADER[] PROGMEM = "Sec-WebSocket-Version";
+static const char RANGE_HEADER[] PROGMEM = "Range";
 
 
 ESP8266WebServer::ESP8266WebServer(IPAddress addr, int port)
 : _server(addr, port)
+, _maxClients(1)
+, _nextConnection(0)
+, _keepAlive(false)
+, _keepAliveTimeout(HTTP_MAX_KEEPALIVE_WAIT)
+, _keepAliveMaxRequests(HTTP_MAX_KEEPALIVE_REQUESTS)
 , _currentMethod(HTTP_ANY)
 , _currentVersion(0)
 , _currentStatus(HC_NONE)
 , _statusChange(0)
+, _requestKeepAlive(false)
+, _requestGzip(false)
+, _currentKeepAlive(false)
+, _currentDetached(false)
 , _currentHandler(nullptr)
 , _firstHandler(nullptr)
 , _lastHandler(nullptr)
 , _currentArgCount(0)
+, _currentArgCapacity(0)
 , _currentArgs(nullptr)
+, _requestData(nullptr)
+, _requestDataLength(0)
+, _requestDataCapacity(0)
 , _headerKeysCount(0)
 , _currentHeaders(nullptr)
 , _contentLength(0)
 , _chunked(false)
+, _responseWriter(*this)
+, _eTagEnabled(false)
+, _compressEnabled(false)
+, _compressMinSize(HTTP_COMPRESS_MIN_SIZE)
 {
 }
 
 ESP8266WebServer::ESP8266WebServer(int port)
 : _server(port)
+, _maxClients(1)
+, _nextConnection(0)
+, _keepAlive(false)
+, _keepAliveTimeout(HTTP_MAX_KEEPALIVE_WAIT)
+, _keepAliveMaxRequests(HTTP_MAX_KEEPALIVE_REQUESTS)
 , _currentMethod(HTTP_ANY)
 , _currentVersion(0)
 , _currentStatus(HC_NONE)
 , _statusChange(0)
+, _requestKeepAlive(false)
+, _requestGzip(false)
+, _currentKeepAlive(false)
+, _currentDetached(false)
 , _currentHandler(nullptr)
 , _firstHandler(nullptr)
 , _lastHandler(nullptr)
 , _currentArgCount(0)
+, _currentArgCapacity(0)
 , _currentArgs(nullptr)
+, _requestData(nullptr)
+, _requestDataLength(0)
+, _requestDataCapacity(0)
 , _headerKeysCount(0)
 , _currentHeaders(nullptr)
 , _contentLength(0)
 , _chunked(false)
+, _responseWriter(*this)
+, _eTagEnabled(false)
+, _compressEnabled(false)
+, _compressMinSize(HTTP_COMPRESS_MIN_SIZE)
 {
 }
 
@@ -82,6 +122,8 @@ ESP8266WebServer::~ESP8266WebServer() {
   _server.close();
   if (_currentHeaders)
     delete[]_currentHeaders;
+  free(_currentArgs);
+  free(_requestData);
   RequestHandler* handler = _firstHandler;
   while (handler) {
     RequestHandler* next = handler->next();
@@ -100,11 +142,61 @@ void ESP8266WebServer::begin(uint16_t port) {
   _server.begin(port);
 }
 
-String ESP8266WebServer::_extractParam(String& authReq,const String& param,const char delimit){
-  int _begin = authReq.indexOf(param);
-  if (_begin == -1) 
-    return "";
-  return authReq.substring(_begin+param.length(),authReq.indexOf(delimit,_begin+param.length()));
+// The fields of a digest Authorization header, pointing into it.
+struct DigestParams {
+  StringView username, realm, nonce, uri, response, opaque, qop, nc, cnonce;
+};
+
+// Splits the name=value and name="value" pairs after "Digest " in one pass.
+static bool parseDigest(StringView value, DigestParams& params) {
+  size_t pos = 0;
+  size_t len = value.length();
+  while (pos < len) {
+    while (pos < len && (value[pos] == ' ' || value[pos] == ','))
+      ++pos;
+    int equal = value.indexOf('=', pos);
+    if (equal < 0)
+      break;
+    StringView name = value.substring(pos, equal).trim();
+    size_t start = equal + 1;
+    size_t end;
+    if (start < len && value[start] == '"') {
+      ++start;
+      int quote = value.indexOf('"', start);
+      if (quote < 0)
+        return false;
+      end = quote;
+      pos = end + 1;
+    } else {
+      int comma = value.indexOf(',', start);
+      end = comma < 0 ? len : comma;
+      pos = end;
+    }
+    StringView field = value.substring(start, end).trim();
+    if (name.equals(F("username")))
+      params.username = field;
+    else if (name.equals(F("realm")))
+      params.realm = field;
+    else if (name.equals(F("nonce")))
+      params.nonce = field;
+    else if (name.equals(F("uri")))
+      params.uri = field;
+    else if (name.equals(F("response")))
+      params.response = field;
+    else if (name.equals(F("opaque")))
+      params.opaque = field;
+    else if (name.equals(F("qop")))
+      params.qop = field;
+    else if (name.equals(F("nc")))
+      params.nc = field;
+    else if (name.equals(F("cnonce")))
+      params.cnonce = field;
+  }
+  return true;
+}
+
+static void md5Add(MD5Builder& md5, StringView text) {
+  md5.add((const uint8_t*) text.data(), text.length());
 }
 
 bool ESP8266WebServer::authenticate(const char * username, const char * password){
@@ -135,82 +227,120 @@ bool ESP8266WebServer::authenticate(const char * username, const char * password
       delete[] toencode;
       delete[] encoded;
     } else if(authReq.startsWith(F("Digest"))) {
-      authReq = authReq.substring(7);
       #ifdef DEBUG_ESP_HTTP_SERVER
       DEBUG_OUTPUT.println(authReq);
       #endif
-      String _username = _extractParam(authReq,F("username=\""));
-      if(!_username.length() || _username != String(username)) {
-        authReq = "";
-        return false;
-      }
-      // extracting required parameters for RFC 2069 simpler Digest
-      String _realm    = _extractParam(authReq, F("realm=\""));
-      String _nonce    = _extractParam(authReq, F("nonce=\""));
-      String _uri      = _extractParam(authReq, F("uri=\""));
-      String _response = _extractParam(authReq, F("response=\""));
-      String _opaque   = _extractParam(authReq, F("opaque=\""));
-
-      if((!_realm.length()) || (!_nonce.length()) || (!_uri.length()) || (!_response.length()) || (!_opaque.length())) {
-        authReq = "";
-        return false;
-      }
-      if((_opaque != _sopaque) || (_nonce != _snonce) || (_realm != _srealm)) {
-        authReq = "";
-        return false;
-      }
-      // parameters for the RFC 2617 newer Digest
-      String _nc,_cnonce;
-      if(authReq.indexOf(FPSTR(qop_auth)) != -1) {
-        _nc = _extractParam(authReq, F("nc="), ',');
-        _cnonce = _extractParam(authReq, F("cnonce=\""));
-      }
-      MD5Builder md5;
-      md5.begin();
-      md5.add(String(username) + ':' + _realm + ':' + String(password));  // md5 of the user:realm:user
-      md5.calculate();
-      String _H1 = md5.toString();
-      #ifdef DEBUG_ESP_HTTP_SERVER
-      DEBUG_OUTPUT.println("Hash of user:realm:pass=" + _H1);
-      #endif
-      md5.begin();
-      if(_currentMethod == HTTP_GET){
-        md5.add(String(F("GET:")) + _uri);
-      }else if(_currentMethod == HTTP_POST){
-        md5.add(String(F("POST:")) + _uri);
-      }else if(_currentMethod == HTTP_PUT){
-        md5.add(String(F("PUT:")) + _uri);
-      }else if(_currentMethod == HTTP_DELETE){
-        md5.add(String(F("DELETE:")) + _uri);
-      }else{
-        md5.add(String(F("GET:")) + _uri);
-      }
-      md5.calculate();
-      String _H2 = md5.toString();
-      #ifdef DEBUG_ESP_HTTP_SERVER
-      DEBUG_OUTPUT.println("Hash of GET:uri=" + _H2);
-      #endif
-      md5.begin();
-      if(authReq.indexOf(FPSTR(qop_auth)) != -1) {
-        md5.add(_H1 + ':' + _nonce + ':' + _nc + ':' + _cnonce + F(":auth:") + _H2);
-      } else {
-        md5.add(_H1 + ':' + _nonce + ':' + _H2);
-      }
-      md5.calculate();
-      String _responsecheck = md5.toString();
-      #ifdef DEBUG_ESP_HTTP_SERVER
-      DEBUG_OUTPUT.println("The Proper response=" +_responsecheck);
-      #endif
-      if(_response == _responsecheck){
-        authReq = "";
-        return true;
-      }
+      return _authenticateDigest(username, password, StringView(authReq).substring(7));
     }
     authReq = "";
   }
   return false;
 }
 
+// HA1 only changes with the credentials, so it is computed once for them.
+void ESP8266WebServer::_digestHA1(const char* username, StringView realm, const char* password, char* ha1) {
+  for (uint8_t i = 0; i < HTTP_AUTH_HA1_CACHE; ++i) {
+    AuthHA1& entry = _authHA1[i];
+    if (entry.username == username && realm.equals(entry.realm) && entry.password == password) {
+      memcpy(ha1, entry.ha1, sizeof(entry.ha1));
+      return;
+    }
+  }
+  MD5Builder md5;
+  md5.begin();
+  md5.add(username);
+  md5.add(":");
+  md5Add(md5, realm);
+  md5.add(":");
+  md5.add(password);
+  md5.calculate();
+  md5.getChars(ha1);
+
+  AuthHA1& entry = _authHA1[_authHA1Next];
+  _authHA1Next = (_authHA1Next + 1) % HTTP_AUTH_HA1_CACHE;
+  entry.username = username;
+  entry.realm = realm.toString();
+  entry.password = password;
+  memcpy(entry.ha1, ha1, sizeof(entry.ha1));
+}
+
+bool ESP8266WebServer::_authenticateDigest(const char* username, const char* password, StringView authReq) {
+  DigestParams params;
+  if (!parseDigest(authReq, params))
+    return false;
+  if (!params.username.length() || !params.username.equals(username))
+    return false;
+  // RFC 2069 fields, qop (RFC 2617) adds nc and cnonce
+  if (!params.realm.length() || !params.nonce.length() || !params.uri.length() ||
+      !params.response.length() || !params.opaque.length())
+    return false;
+  bool qop = params.qop.length() > 0;
+  if (qop && (!params.qop.equals(F("auth")) || !params.nc.length() || !params.cnonce.length()))
+    return false;
+  if (!params.opaque.equals(_sopaque) || !params.realm.equals(_srealm))
+    return false;
+
+  const AuthNonce* nonce = nullptr;
+  for (uint8_t i = 0; i < HTTP_AUTH_NONCES; ++i) {
+    if (_authNonces[i].nonce[0] && params.nonce.equals(_authNonces[i].nonce)) {
+      nonce = &_authNonces[i];
+      break;
+    }
+  }
+  if (!nonce)
+    return false;
+  bool expired = millis() - nonce->issued > HTTP_AUTH_NONCE_TTL;
+
+  char ha1[33];
+  _digestHA1(username, params.realm, password, ha1);
+  #ifdef DEBUG_ESP_HTTP_SERVER
+  DEBUG_OUTPUT.println(String("Hash of user:realm:pass=") + ha1);
+  #endif
+
+  static const char* const methods[] = { "GET", "GET", "POST", "PUT", "PATCH", "DELETE", "OPTIONS" };
+  uint8_t method = (uint8_t) _currentMethod < sizeof(methods) / sizeof(methods[0]) ? (uint8_t) _currentMethod : 0;
+  MD5Builder md5;
+  md5.begin();
+  md5.add(methods[method]);
+  md5.add(":");
+  md5Add(md5, params.uri);
+  md5.calculate();
+  char ha2[33];
+  md5.getChars(ha2);
+
+  md5.begin();
+  md5.add(ha1);
+  md5.add(":");
+  md5Add(md5, params.nonce);
+  md5.add(":");
+  if (qop) {
+    md5Add(md5, params.nc);
+    md5.add(":");
+    md5Add(md5, params.cnonce);
+    md5.add(":auth:");
+  }
+  md5.add(ha2);
+  md5.calculate();
+  char response[33];
+  md5.getChars(response);
+  #ifdef DEBUG_ESP_HTTP_SERVER
+  DEBUG_OUTPUT.println(String("The Proper response=") + response);
+  #endif
+
+  // compared in constant time
+  uint8_t diff = params.response.length() != 32;
+  for (size_t i = 0; i < 32 && i < params.response.length(); ++i)
+    diff |= params.response[i] ^ response[i];
+  if (diff)
+    return false;
+  if (expired) {
+    // right credentials: the client only needs a fresh nonce
+    _authStale = true;
+    return false;
+  }
+  return true;
+}
+
 String ESP8266WebServer::_getRandomHexString() {
   char buffer[33];  // buffer to hold 32 Hex Digit + /0
   int i;
@@ -229,10 +359,19 @@ void ESP8266WebServer::requestAuthentication(HTTPAuthMethod mode, const char* re
   if(mode == BASIC_AUTH) {
     sendHeader(String(FPSTR(WWW_Authenticate)), String(F("Basic realm=\"")) + _srealm + String(F("\"")));
   } else {
-    _snonce=_getRandomHexString();
-    _sopaque=_getRandomHexString();
-    sendHeader(String(FPSTR(WWW_Authenticate)), String(F("Digest realm=\"")) +_srealm + String(F("\", qop=\"auth\", nonce=\"")) + _snonce + String(F("\", opaque=\"")) + _sopaque + String(F("\"")));
+    // the oldest nonce makes room for the new one
+    AuthNonce& nonce = _authNonces[_authNonceNext];
+    _authNonceNext = (_authNonceNext + 1) % HTTP_AUTH_NONCES;
+    strcpy(nonce.nonce, _getRandomHexString().c_str());
+    nonce.issued = millis();
+    if (!_sopaque.length())
+      _sopaque=_getRandomHexString();
+    String value = String(F("Digest realm=\"")) +_srealm + String(F("\", qop=\"auth\", nonce=\"")) + nonce.nonce + String(F("\", opaque=\"")) + _sopaque + String(F("\""));
+    if (_authStale)
+      value += F(", stale=true");
+    sendHeader(String(FPSTR(WWW_Authenticate)), value);
   }
+  _authStale = false;
   using namespace mime;
   send(401, String(FPSTR(mimeTable[html].mimeType)), authFailMsg);
 }
@@ -246,14 +385,39 @@ void ESP8266WebServer::on(const String &uri, HTTPMethod method, ESP8266WebServer
 }
 
 void ESP8266WebServer::on(const String &uri, HTTPMethod method, ESP8266WebServer::THandlerFunction fn, ESP8266WebServer::THandlerFunction ufn) {
-  _addRequestHandler(new FunctionRequestHandler(fn, ufn, uri, method));
+  RequestHandler* handler = new FunctionRequestHandler(fn, ufn, uri, method);
+  _addRequestHandler(handler, false);
+  if (!_routeIndex.add(handler, uri, method))
+    _routeIndexMissed();
 }
 
 void ESP8266WebServer::addHandler(RequestHandler* handler) {
     _addRequestHandler(handler);
 }
 
-void ESP8266WebServer::_addRequestHandler(RequestHandler* handler) {
+// the index is short of a handler, requests are matched against the list
+// of all of them from now on, as slow as that is
+void ESP8266WebServer::_routeIndexMissed() {
+#ifdef DEBUG_ESP_HTTP_SERVER
+  DEBUG_OUTPUT.println("route index out of memory, walking the handlers");
+#endif
+  _routesIndexed = false;
+}
+
+RequestHandler* ESP8266WebServer::_findHandler() {
+  if (_routesIndexed)
+    return _routeIndex.find(_currentMethod, _currentUri);
+  RequestHandler* handler;
+  for (handler = _firstHandler; handler; handler = handler->next()) {
+    if (handler->canHandle(_currentMethod, _currentUri))
+      break;
+  }
+  return handler;
+}
+
+void ESP8266WebServer::_addRequestHandler(RequestHandler* handler, bool generic) {
+    if (generic && !_routeIndex.addGeneric(handler))
+      _routeIndexMissed();
     if (!_lastHandler) {
       _firstHandler = handler;
       _lastHandler = handler;
@@ -268,54 +432,198 @@ void ESP8266WebServer::serveStatic(const char* uri, FS& fs, const char* path, co
     _addRequestHandler(new StaticRequestHandler(fs, path, uri, cache_header));
 }
 
-void ESP8266WebServer::handleClient() {
-  if (_currentStatus == HC_NONE) {
-    WiFiClient client = _server.available();
-    if (!client) {
-      return;
+void ESP8266WebServer::serveMetrics(const char* uri) {
+    on(uri, HTTP_GET, [this]() {
+        metrics_print(beginResponse(200, "text/plain"));
+    });
+}
+
+void ESP8266WebServer::setMaxClients(uint8_t maxClients) {
+  if (maxClients < 1)
+    maxClients = 1;
+  if (maxClients > HTTP_MAX_CLIENTS)
+    maxClients = HTTP_MAX_CLIENTS;
+  // drop connections which no longer fit in the pool
+  for (uint8_t i = maxClients; i < _maxClients; ++i) {
+    _connections[i].client = WiFiClient();
+    _connections[i].status = HC_NONE;
+  }
+  _maxClients = maxClients;
+  _nextConnection = 0;
+}
+
+bool ESP8266WebServer::reserve(int args, bool upload, size_t requestData) {
+  if (args > _currentArgCapacity) {
+    RequestArgument* grown = (RequestArgument*) realloc(_currentArgs, args * sizeof(RequestArgument));
+    if (!grown)
+      return false;
+    _currentArgs = grown;
+    _currentArgCapacity = args;
+  }
+  if (requestData > _requestDataCapacity) {
+    char* data = (char*) realloc(_requestData, requestData);
+    if (!data)
+      return false;
+    _requestData = data;
+    _requestDataCapacity = requestData;
+  }
+  _requestDataReserved = requestData;
+  _uploadReserved = upload;
+  if (upload && !_currentUpload) {
+    _currentUpload.reset(new HTTPUpload());
+    if (!_currentUpload) {
+      _uploadReserved = false;
+      return false;
     }
+  }
+  return true;
+}
+
+void ESP8266WebServer::enableETag(bool enable, ETagFunction fn) {
+  _eTagEnabled = enable;
+  _eTagFunction = fn;
+}
+
+void ESP8266WebServer::enableCompression(bool enable, size_t minSize) {
+  _compressEnabled = enable;
+  _compressMinSize = minSize;
+}
+
+void ESP8266WebServer::setKeepAlive(bool enable, unsigned long idleTimeout, uint16_t maxRequests) {
+  _keepAlive = enable;
+  _keepAliveTimeout = idleTimeout;
+  _keepAliveMaxRequests = maxRequests;
+}
+
+void ESP8266WebServer::handleClient() {
+  // claim pending connections into free slots
+  bool full = true;
+  for (uint8_t i = 0; i < _maxClients && _server.hasClient(); ++i) {
+    HTTPConnection& conn = _connections[i];
+    if (conn.status != HC_NONE)
+      continue;
+    full = false;
 
 #ifdef DEBUG_ESP_HTTP_SERVER
-    DEBUG_OUTPUT.println("New client");
+    DEBUG_OUTPUT.print("New client in slot ");
+    DEBUG_OUTPUT.println(i);
 #endif
 
-    _currentClient = client;
-    _currentStatus = HC_WAIT_READ;
-    _statusChange = millis();
+    conn.client = _server.available();
+    conn.status = HC_WAIT_READ;
+    conn.statusChange = millis();
+    conn.head = String();
+    conn.headComplete = false;
+    conn.requests = 0;
+  }
+
+  // make room for waiting clients by closing an idle persistent connection
+  if (full && _server.hasClient()) {
+    for (uint8_t i = 0; i < _maxClients; ++i) {
+      HTTPConnection& conn = _connections[i];
+      if (conn.status == HC_WAIT_READ && conn.requests && !conn.head.length()) {
+        conn.client.stop();
+        conn.client = WiFiClient();
+        conn.status = HC_NONE;
+        break;
+      }
+    }
   }
 
+  // service every open connection once, rotating the starting slot
+  // so that no connection gets starved
+  bool callYield = false;
+  bool active = false;
+  uint8_t first = _nextConnection;
+  _nextConnection = (first + 1) % _maxClients;
+  for (uint8_t n = 0; n < _maxClients; ++n) {
+    HTTPConnection& conn = _connections[(first + n) % _maxClients];
+    if (conn.status == HC_NONE)
+      continue;
+    active = true;
+    if (_handleConnection(conn))
+      callYield = true;
+  }
+
+  if (!active) {
+    // nothing to do, give the network stack a chance (as WiFiServer::available() would)
+    optimistic_yield(1000);
+  }
+  if (callYield) {
+    yield();
+  }
+}
+
+// Advances the state of one connection.
+// Returns true when the connection is idle, waiting for the client.
+bool ESP8266WebServer::_handleConnection(HTTPConnection& conn) {
   bool keepCurrentClient = false;
   bool callYield = false;
 
-  if (_currentClient.connected()) {
-    switch (_currentStatus) {
+  if (conn.client.connected()) {
+    switch (conn.status) {
     case HC_NONE:
       // No-op to avoid C++ compiler warning
       break;
     case HC_WAIT_READ:
-      // Wait for data from client to become available
-      if (_currentClient.available()) {
-        if (_parseRequest(_currentClient)) {
-          _currentClient.setTimeout(HTTP_MAX_SEND_WAIT);
-          _contentLength = CONTENT_LENGTH_NOT_SET;
-          _handleRequest();
-
-          if (_currentClient.connected()) {
-            _currentStatus = HC_WAIT_CLOSE;
-            _statusChange = millis();
-            keepCurrentClient = true;
+      // Collect the request head as it arrives, without waiting for more
+      if (!conn.headComplete && conn.client.available()) {
+        if (_readRequestHead(conn.client, conn.head)) {
+          conn.headComplete = true;
+          conn.bodyLength = _headContentLength(conn.head);
+          conn.statusChange = millis();
+        } else if (conn.head.length() > HTTP_MAX_HEAD_LENGTH) {
+#ifdef DEBUG_ESP_HTTP_SERVER
+          DEBUG_OUTPUT.println("Request head too long");
+#endif
+          break;
+        }
+      }
+      // Once the head is in, wait for the body (or enough of it) to become available
+      if (conn.headComplete) {
+        size_t available = conn.client.available();
+        if (available >= conn.bodyLength || available >= HTTP_BODY_READAHEAD) {
+          _currentClient = conn.client;
+          bool parsed = _parseRequest(_currentClient, conn.head);
+          conn.head = String();
+          conn.headComplete = false;
+          if (parsed) {
+            _currentClient.setTimeout(HTTP_MAX_SEND_WAIT);
+            _contentLength = CONTENT_LENGTH_NOT_SET;
+            _currentKeepAlive = _keepAlive && _requestKeepAlive && conn.requests + 1 < _keepAliveMaxRequests;
+            _handleRequest();
+
+            if (_currentDetached) {
+              // the handler took the connection over, just let go of it
+              _currentDetached = false;
+            } else if (_currentClient.connected()) {
+              // _prepareHeader() may have withdrawn keep-alive
+              conn.status = _currentKeepAlive ? HC_WAIT_READ : HC_WAIT_CLOSE;
+              conn.statusChange = millis();
+              ++conn.requests;
+              keepCurrentClient = true;
+            }
+            _currentKeepAlive = false;
           }
+          _currentClient = WiFiClient();
+          break;
         }
-      } else { // !_currentClient.available()
-        if (millis() - _statusChange <= HTTP_MAX_DATA_WAIT) {
+      }
+      {
+        unsigned long timeout = HTTP_MAX_DATA_WAIT;
+        if (conn.headComplete)
+          timeout = HTTP_MAX_POST_WAIT;
+        else if (conn.requests && !conn.head.length())
+          timeout = _keepAliveTimeout;
+        if (millis() - conn.statusChange <= timeout) {
           keepCurrentClient = true;
         }
-        callYield = true;
       }
+      callYield = true;
       break;
     case HC_WAIT_CLOSE:
       // Wait for client to close the connection
-      if (millis() - _statusChange <= HTTP_MAX_CLOSE_WAIT) {
+      if (millis() - conn.statusChange <= HTTP_MAX_CLOSE_WAIT) {
         keepCurrentClient = true;
         callYield = true;
       }
@@ -323,19 +631,29 @@ void ESP8266WebServer::handleClient() {
   }
 
   if (!keepCurrentClient) {
-    _currentClient = WiFiClient();
-    _currentStatus = HC_NONE;
-    _currentUpload.reset();
+    conn.client = WiFiClient();
+    conn.status = HC_NONE;
+    conn.head = String();
+    conn.headComplete = false;
+    _endUpload();
   }
 
-  if (callYield) {
-    yield();
-  }
+  return callYield;
+}
+
+WiFiClient ESP8266WebServer::detachClient() {
+  _currentDetached = true;
+  _currentKeepAlive = false;
+  return _currentClient;
 }
 
 void ESP8266WebServer::close() {
   _server.close();
   _currentStatus = HC_NONE;
+  for (uint8_t i = 0; i < _maxClients; ++i) {
+    _connections[i].client = WiFiClient();
+    _connections[i].status = HC_NONE;
+  }
   if(!_headerKeysCount)
     collectHeaders(0, 0);
 }
@@ -383,8 +701,15 @@ void ESP8266WebServer::_prepareHeader(String& response, int code, const char* co
       _chunked = true;
       sendHeader(String(F("Accept-Ranges")),String(F("none")));
       sendHeader(String(F("Transfer-Encoding")),String(F("chunked")));
+    } else {
+      // the end of the body is only marked by closing the connection
+      _currentKeepAlive = false;
+    }
+    if (_currentKeepAlive) {
+      sendHeader(String(F("Connection")), String(F("keep-alive")));
+    } else {
+      sendHeader(String(F("Connection")), String(F("close")));
     }
-    sendHeader(String(F("Connection")), String(F("close")));
 
     response += _responseHeaders;
     response += "\r\n";
@@ -397,9 +722,15 @@ void ESP8266WebServer::send(int code, const char* content_type, const String& co
     //if(code == 200 && content.length() == 0 && _contentLength == CONTENT_LENGTH_NOT_SET)
     //  _contentLength = CONTENT_LENGTH_UNKNOWN;
     _prepareHeader(header, code, content_type, content.length());
-    _currentClientWrite(header.c_str(), header.length());
-    if(content.length())
-      sendContent(content);
+    if (_chunked || !content.length()) {
+      _currentClientWrite(header.c_str(), header.length());
+      if(content.length())
+        sendContent(content);
+      return;
+    }
+    // header and body leave in one go, sharing segments
+    WiFiClient::IOVec parts[] = { header, content };
+    _currentClientWritev(parts, 2);
 }
 
 void ESP8266WebServer::send_P(int code, PGM_P content_type, PGM_P content) {
@@ -413,8 +744,13 @@ void ESP8266WebServer::send_P(int code, PGM_P content_type, PGM_P content) {
     char type[64];
     memccpy_P((void*)type, (PGM_VOID_P)content_type, 0, sizeof(type));
     _prepareHeader(header, code, (const char* )type, contentLength);
-    _currentClientWrite(header.c_str(), header.length());
-    sendContent_P(content);
+    if (_chunked || !contentLength) {
+      _currentClientWrite(header.c_str(), header.length());
+      sendContent_P(content);
+      return;
+    }
+    WiFiClient::IOVec parts[] = { header, WiFiClient::IOVec::P(content, contentLength) };
+    _currentClientWritev(parts, 2);
 }
 
 void ESP8266WebServer::send_P(int code, PGM_P content_type, PGM_P content, size_t contentLength) {
@@ -437,21 +773,28 @@ void ESP8266WebServer::send(int code, const String& content_type, const String&
 void ESP8266WebServer::sendContent(const String& content) {
   const char * footer = "\r\n";
   size_t len = content.length();
-  if(_chunked) {
-    char * chunkSize = (char *)malloc(11);
-    if(chunkSize){
-      sprintf(chunkSize, "%x%s", len, footer);
-      _currentClientWrite(chunkSize, strlen(chunkSize));
-      free(chunkSize);
+  if (_responseWriter.active()) {
+    _responseWriter.flush();
+    // the rest of a compressed body has to go through the compressor too
+    if (_responseWriter.compressing()) {
+      if (len)
+        _responseWriter.write((const uint8_t*) content.c_str(), len);
+      else
+        _responseWriter.end();
+      return;
     }
   }
-  _currentClientWrite(content.c_str(), len);
-  if(_chunked){
-    _currentClient.write(footer, 2);
+  if(_chunked) {
+    char chunkSize[11];
+    sprintf(chunkSize, "%x%s", len, footer);
+    WiFiClient::IOVec parts[] = { { chunkSize, strlen(chunkSize) }, content, { footer, 2 } };
+    _currentClientWritev(parts, 3);
     if (len == 0) {
       _chunked = false;
     }
+    return;
   }
+  _currentClientWrite(content.c_str(), len);
 }
 
 void ESP8266WebServer::sendContent_P(PGM_P content) {
@@ -460,54 +803,319 @@ void ESP8266WebServer::sendContent_P(PGM_P content) {
 
 void ESP8266WebServer::sendContent_P(PGM_P content, size_t size) {
   const char * footer = "\r\n";
-  if(_chunked) {
-    char * chunkSize = (char *)malloc(11);
-    if(chunkSize){
-      sprintf(chunkSize, "%x%s", size, footer);
-      _currentClientWrite(chunkSize, strlen(chunkSize));
-      free(chunkSize);
+  if (_responseWriter.active()) {
+    _responseWriter.flush();
+    if (_responseWriter.compressing()) {
+      if (!size)
+        _responseWriter.end();
+      char piece[64];
+      for (size_t pos = 0; pos < size; pos += sizeof(piece)) {
+        size_t n = std::min(sizeof(piece), size - pos);
+        memcpy_P(piece, content + pos, n);
+        _responseWriter.write((const uint8_t*) piece, n);
+      }
+      return;
     }
   }
-  _currentClientWrite_P(content, size);
-  if(_chunked){
-    _currentClient.write(footer, 2);
+  if(_chunked) {
+    char chunkSize[11];
+    sprintf(chunkSize, "%x%s", size, footer);
+    WiFiClient::IOVec parts[] = { { chunkSize, strlen(chunkSize) }, WiFiClient::IOVec::P(content, size), { footer, 2 } };
+    _currentClientWritev(parts, 3);
     if (size == 0) {
       _chunked = false;
     }
+    return;
+  }
+  _currentClientWrite_P(content, size);
+}
+
+Print& ESP8266WebServer::beginResponse(int code, const char* content_type) {
+  if (_responseWriter.active())
+    _responseWriter.end();
+  if (_compressEnabled && _requestGzip && _responseHeaders.indexOf(F("Content-Encoding:")) < 0 &&
+      _responseWriter.defer(code, content_type))
+    return _responseWriter;
+  setContentLength(CONTENT_LENGTH_UNKNOWN);
+  send(code, content_type, "");
+  _responseWriter.begin();
+  return _responseWriter;
+}
+
+void ESP8266WebServer::endResponse() {
+  if (_responseWriter.active())
+    _responseWriter.end();
+}
+
+void ESP8266WebServer::sendTemplate_P(int code, const char* content_type, PGM_P tmpl, const TTemplateProcessor& processor) {
+  ProgmemStream source(tmpl, strlen_P(tmpl));
+  TemplateRenderer renderer(beginResponse(code, content_type), processor);
+  renderer.render(source);
+  endResponse();
+}
+
+void ESP8266WebServer::sendTemplate(int code, const char* content_type, fs::File& tmpl, const TTemplateProcessor& processor) {
+  MappedFileStream source(tmpl);
+  TemplateRenderer renderer(beginResponse(code, content_type), processor);
+  renderer.render(source);
+  endResponse();
+}
+
+// Chunks are written as "hhhh\r\n<payload>\r\n" from one buffer, so that each
+// one goes out in a single write; leading zeros in the size are allowed.
+#define RESPONSE_CHUNK_HEADER 6
+#define RESPONSE_CHUNK_PAYLOAD (HTTP_DOWNLOAD_UNIT_SIZE - RESPONSE_CHUNK_HEADER - 2)
+
+bool ESP8266WebServer::ResponseWriter::begin() {
+  if (!_buf)
+    _buf = (char*) malloc(HTTP_DOWNLOAD_UNIT_SIZE);
+  _len = 0;
+  _active = true;
+  clearWriteError();
+  // without a buffer every write becomes a chunk of its own
+  return _buf != nullptr;
+}
+
+bool ESP8266WebServer::ResponseWriter::defer(int code, const char* content_type) {
+  if (!begin()) {
+    _active = false;
+    return false;
+  }
+  _deferred = true;
+  _code = code;
+  _type = content_type ? String(FPSTR(content_type)) : String();
+  return true;
+}
+
+void ESP8266WebServer::ResponseWriter::end() {
+  if (_deferred)
+    _start(_len >= std::min(_server._compressMinSize, (size_t) RESPONSE_CHUNK_PAYLOAD), true);
+  if (_deflater) {
+    _deflater->end();
+    delete _deflater;
+    _deflater = nullptr;
+  }
+  _sendBuffer();
+  _active = false;
+  free(_buf);
+  _buf = nullptr;
+  if (_server._chunked) {
+    _server._currentClientWrite("0\r\n\r\n", 5);
+    _server._chunked = false;
+  }
+}
+
+size_t ESP8266WebServer::ResponseWriter::write(const uint8_t* data, size_t size) {
+  if (!_active || getWriteError())
+    return 0;
+  if (_deflater)
+    return (_deflater->write(data, size) && !getWriteError()) ? size : 0;
+  if (!_buf)
+    return _send((const char*) data, size) ? size : 0;
+
+  size_t written = 0;
+  while (written < size) {
+    size_t room = RESPONSE_CHUNK_PAYLOAD - _len;
+    if (_deferred && (room == 0 || _len >= _server._compressMinSize)) {
+      _start(true, false);
+      if (_deflater)
+        return written + write(data + written, size - written);
+      continue;
+    }
+    if (room == 0) {
+      flush();
+      if (getWriteError())
+        break;
+      continue;
+    }
+    size_t n = std::min(room, size - written);
+    memcpy(_buf + RESPONSE_CHUNK_HEADER + _len, data + written, n);
+    _len += n;
+    written += n;
   }
+  return written;
+}
+
+void ESP8266WebServer::ResponseWriter::flush() {
+  if (_deferred)
+    _start(_len >= _server._compressMinSize, false);
+  // what was compressed so far can be decoded as soon as it arrives
+  if (_deflater && !_deflater->flush())
+    return;
+  _sendBuffer();
 }
 
+// Sends the head of a deferred response, then whatever is buffered: as it
+// is, or through a new compressor into a new buffer. last: nothing more
+// comes, so a plain body gets a Content-Length.
+void ESP8266WebServer::ResponseWriter::_start(bool compress, bool last) {
+  _deferred = false;
+  char* plain = _buf;
+  size_t len = _len;
+  if (compress) {
+    _deflater = new Compressor(*this);
+    _buf = (char*) malloc(HTTP_DOWNLOAD_UNIT_SIZE);
+    if (!_deflater || !_buf) {
+      // not enough heap, it goes out as it is
+      delete _deflater;
+      _deflater = nullptr;
+      free(_buf);
+      _buf = plain;
+      compress = false;
+    }
+  }
+  _server.sendHeader(String(F("Vary")), String(F("Accept-Encoding")));
+  if (compress)
+    _server.sendHeader(String(F("Content-Encoding")), String(F("gzip")));
+  _server.setContentLength((last && !compress) ? len : CONTENT_LENGTH_UNKNOWN);
+  _server.send(_code, _type.length() ? _type.c_str() : nullptr, "");
+  _type = String();
+  if (!compress)
+    return;
+  _len = 0;
+  _deflater->begin();
+  _deflater->write((const uint8_t*) plain + RESPONSE_CHUNK_HEADER, len);
+  free(plain);
+}
 
-void ESP8266WebServer::_streamFileCore(const size_t fileSize, const String & fileName, const String & contentType)
+bool ESP8266WebServer::ResponseWriter::_append(const uint8_t* data, size_t size) {
+  while (size) {
+    size_t n = std::min(RESPONSE_CHUNK_PAYLOAD - _len, size);
+    memcpy(_buf + RESPONSE_CHUNK_HEADER + _len, data, n);
+    _len += n;
+    data += n;
+    size -= n;
+    if (_len == RESPONSE_CHUNK_PAYLOAD) {
+      _sendBuffer();
+      if (getWriteError())
+        return false;
+    }
+  }
+  return true;
+}
+
+void ESP8266WebServer::ResponseWriter::_sendBuffer() {
+  if (!_buf || !_len)
+    return;
+  size_t len = _len;
+  _len = 0;
+  char* payload = _buf + RESPONSE_CHUNK_HEADER;
+  if (_server._chunked) {
+    char size[RESPONSE_CHUNK_HEADER + 1];
+    sprintf(size, "%04x\r\n", (unsigned) len);
+    memcpy(_buf, size, RESPONSE_CHUNK_HEADER);
+    memcpy(payload + len, "\r\n", 2);
+    if (_server._currentClientWrite(_buf, len + RESPONSE_CHUNK_HEADER + 2) != len + RESPONSE_CHUNK_HEADER + 2)
+      setWriteError();
+  } else if (_server._currentClientWrite(payload, len) != len) {
+    setWriteError();
+  }
+}
+
+bool ESP8266WebServer::ResponseWriter::_send(const char* data, size_t size) {
+  if (!size)
+    return true;
+  bool ok;
+  if (_server._chunked) {
+    char chunkSize[11];
+    sprintf(chunkSize, "%x\r\n", (unsigned) size);
+    WiFiClient::IOVec parts[] = { { chunkSize, strlen(chunkSize) }, { data, size }, { "\r\n", 2 } };
+    ok = _server._currentClientWritev(parts, 3) == strlen(chunkSize) + size + 2;
+  } else {
+    ok = _server._currentClientWrite(data, size) == size;
+  }
+  if (!ok)
+    setWriteError();
+  return ok;
+}
+
+// Parses a Range header of a single "bytes=first-last" range, also
+// "first-" and "-suffix". Returns false when there is none, or it is malformed
+// or asks for several ranges, all of which get the whole file. A range
+// starting past the end leaves length 0.
+static bool parseRange(const String& value, size_t size, size_t& start, size_t& length) {
+  if (!value.startsWith(F("bytes=")) || value.indexOf(',') >= 0)
+    return false;
+  int dash = value.indexOf('-');
+  if (dash < 0)
+    return false;
+  String first = value.substring(6, dash);
+  String last = value.substring(dash + 1);
+  first.trim();
+  last.trim();
+  for (const String* part : { &first, &last })
+    for (size_t i = 0; i < part->length(); ++i)
+      if (!isdigit((*part)[i]))
+        return false;
+  if (!first.length()) {
+    // the last bytes
+    size_t suffix = strtoul(last.c_str(), nullptr, 10);
+    if (!last.length() || !suffix)
+      return false;
+    length = std::min(suffix, size);
+    start = size - length;
+    return true;
+  }
+  start = strtoul(first.c_str(), nullptr, 10);
+  size_t end = last.length() ? strtoul(last.c_str(), nullptr, 10) : size - 1;
+  if (last.length() && end < start)
+    return false;
+  if (start >= size) {
+    length = 0;
+    return true;
+  }
+  length = std::min(end, size - 1) - start + 1;
+  return true;
+}
+
+bool ESP8266WebServer::_streamFileCore(const size_t fileSize, const String & fileName, const String & contentType, size_t& start, size_t& length)
 {
   using namespace mime;
-  setContentLength(fileSize);
+  start = 0;
+  length = fileSize;
+  int code = 200;
+  sendHeader(F("Accept-Ranges"), F("bytes"));
+  if (_currentMethod == HTTP_GET && parseRange(header(FPSTR(RANGE_HEADER)), fileSize, start, length)) {
+    char contentRange[40];
+    if (!length) {
+      sprintf(contentRange, "bytes */%u", (unsigned) fileSize);
+      sendHeader(F("Content-Range"), contentRange);
+      send(416, "text/plain", "");
+      return false;
+    }
+    sprintf(contentRange, "bytes %u-%u/%u", (unsigned) start, (unsigned) (start + length - 1), (unsigned) fileSize);
+    sendHeader(F("Content-Range"), contentRange);
+    code = 206;
+  }
+  setContentLength(length);
   if (fileName.endsWith(String(FPSTR(mimeTable[gz].endsWith))) &&
       contentType != String(FPSTR(mimeTable[gz].mimeType)) &&
       contentType != String(FPSTR(mimeTable[none].mimeType))) {
     sendHeader(F("Content-Encoding"), F("gzip"));
   }
-  send(200, contentType, "");
+  send(code, contentType, "");
+  return true;
 }
 
-
-String ESP8266WebServer::arg(String name) {
+String ESP8266WebServer::arg(StringView name) {
+  uint32_t hash = _hashName(name, false);
   for (int i = 0; i < _currentArgCount; ++i) {
-    if ( _currentArgs[i].key == name )
-      return _currentArgs[i].value;
+    const RequestArgument& arg = _currentArgs[i];
+    if (arg.hash == hash && name.equals(_requestView(arg.key, arg.keyLength)))
+      return _requestView(arg.value, arg.valueLength).toString();
   }
   return "";
 }
 
 String ESP8266WebServer::arg(int i) {
   if (i < _currentArgCount)
-    return _currentArgs[i].value;
+    return _requestView(_currentArgs[i].value, _currentArgs[i].valueLength).toString();
   return "";
 }
 
 String ESP8266WebServer::argName(int i) {
   if (i < _currentArgCount)
-    return _currentArgs[i].key;
+    return _requestView(_currentArgs[i].key, _currentArgs[i].keyLength).toString();
   return "";
 }
 
@@ -515,37 +1123,57 @@ int ESP8266WebServer::args() {
   return _currentArgCount;
 }
 
-bool ESP8266WebServer::hasArg(String  name) {
+bool ESP8266WebServer::hasArg(StringView name) {
+  uint32_t hash = _hashName(name, false);
   for (int i = 0; i < _currentArgCount; ++i) {
-    if (_currentArgs[i].key == name)
+    const RequestArgument& arg = _currentArgs[i];
+    if (arg.hash == hash && name.equals(_requestView(arg.key, arg.keyLength)))
       return true;
   }
   return false;
 }
 
 
-String ESP8266WebServer::header(String name) {
+String ESP8266WebServer::header(StringView name) {
+  uint32_t hash = _hashName(name, true);
   for (int i = 0; i < _headerKeysCount; ++i) {
-    if (_currentHeaders[i].key.equalsIgnoreCase(name))
-      return _currentHeaders[i].value;
+    const RequestHeader& header = _currentHeaders[i];
+    if (header.hash == hash && name.equalsIgnoreCase(header.key))
+      return _requestView(header.value, header.valueLength).toString();
   }
   return "";
 }
 
 void ESP8266WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
-  _headerKeysCount = headerKeysCount + 1;
+  // always collected, for authenticate(), ETags, WebSocketServer and ranges;
+  // Authorization comes first and the others after the sketch's headers,
+  // which keep the numbers they always had: headerKeys[i] is header(i + 1)
+  static const char* const builtin[] = {
+    IF_NONE_MATCH_HEADER, UPGRADE_HEADER, SEC_WEBSOCKET_KEY_HEADER,
+    SEC_WEBSOCKET_VERSION_HEADER, RANGE_HEADER
+  };
+  const int builtinCount = sizeof(builtin) / sizeof(builtin[0]);
+  _headerKeysCount = 1 + headerKeysCount + builtinCount;
   if (_currentHeaders)
      delete[]_currentHeaders;
-  _currentHeaders = new RequestArgument[_headerKeysCount];
+  _currentHeaders = new RequestHeader[_headerKeysCount];
   _currentHeaders[0].key = FPSTR(AUTHORIZATION_HEADER);
-  for (int i = 1; i < _headerKeysCount; i++){
-    _currentHeaders[i].key = headerKeys[i-1];
+  for (size_t i = 0; i < headerKeysCount; i++){
+    _currentHeaders[1 + i].key = headerKeys[i];
+  }
+  for (int i = 0; i < builtinCount; i++){
+    _currentHeaders[1 + headerKeysCount + i].key = FPSTR(builtin[i]);
+  }
+  for (int i = 0; i < _headerKeysCount; i++){
+    _currentHeaders[i].hash = _hashName(_currentHeaders[i].key, true);
+    _currentHeaders[i].value = 0;
+    _currentHeaders[i].valueLength = 0;
   }
 }
 
 String ESP8266WebServer::header(int i) {
   if (i < _headerKeysCount)
-    return _currentHeaders[i].value;
+    return _requestView(_currentHeaders[i].value, _currentHeaders[i].valueLength).toString();
   return "";
 }
 
@@ -559,9 +1187,11 @@ int ESP8266WebServer::headers() {
   return _headerKeysCount;
 }
 
-bool ESP8266WebServer::hasHeader(String name) {
+bool ESP8266WebServer::hasHeader(StringView name) {
+  uint32_t hash = _hashName(name, true);
   for (int i = 0; i < _headerKeysCount; ++i) {
-    if ((_currentHeaders[i].key.equalsIgnoreCase(name)) &&  (_currentHeaders[i].value.length() > 0))
+    const RequestHeader& header = _currentHeaders[i];
+    if (header.hash == hash && name.equalsIgnoreCase(header.key) && header.valueLength > 0)
       return true;
   }
   return false;
@@ -611,6 +1241,9 @@ void ESP8266WebServer::_handleRequest() {
 
 
 void ESP8266WebServer::_finalizeResponse() {
+  if (_responseWriter.active()) {
+    _responseWriter.end();
+  }
   if (_chunked) {
     sendContent("");
   }
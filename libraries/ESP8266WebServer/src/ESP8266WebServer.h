@@ -1,6 +1,6 @@
 /*
   ESP8266WebServer.h - Dead simple web-server.
-  Supports only one simultaneous client, knows how to handle GET and POST.
+  Services a small pool of simultaneous clients, knows how to handle GET and POST.
 
   Copyright (c) 2014 Ivan Grokhotkov. All rights reserved.
 
@@ -27,6 +27,8 @@
 #include <functional>
 #include <memory>
 #include <ESP8266WiFi.h>
+#include <StringView.h>
+#include <Deflater.h>
 
 enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
 enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END,
@@ -45,11 +47,50 @@ enum HTTPAuthMethod { BASIC_AUTH, DIGEST_AUTH };
 #define HTTP_MAX_SEND_WAIT 5000 //ms to wait for data chunk to be ACKed
 #define HTTP_MAX_CLOSE_WAIT 2000 //ms to wait for the client to close the connection
 
+#ifndef HTTP_MAX_HEAD_LENGTH
+#define HTTP_MAX_HEAD_LENGTH 4096 //longest request line and headers accepted from a client
+#endif
+
+#ifndef HTTP_BODY_READAHEAD
+#define HTTP_BODY_READAHEAD 1024 //body bytes to wait for before handling a request with a longer body
+#endif
+
+#define HTTP_MAX_KEEPALIVE_WAIT 2000 //ms to wait for the next request on a persistent connection
+#define HTTP_MAX_KEEPALIVE_REQUESTS 100 //requests served over one persistent connection
+
+#ifndef HTTP_COMPRESS_MIN_SIZE
+#define HTTP_COMPRESS_MIN_SIZE 1024 //smallest body beginResponse() gzips, see enableCompression()
+#endif
+
+#ifndef HTTP_MAX_CLIENTS
+#define HTTP_MAX_CLIENTS 4 //connections which can be serviced concurrently, see setMaxClients()
+#endif
+
+#ifndef HTTP_AUTH_NONCES
+#define HTTP_AUTH_NONCES 4 //digest nonces handed out by requestAuthentication() that stay valid
+#endif
+
+#ifndef HTTP_AUTH_NONCE_TTL
+#define HTTP_AUTH_NONCE_TTL 300000 //ms a digest nonce stays valid
+#endif
+
+#ifndef HTTP_AUTH_HA1_CACHE
+#define HTTP_AUTH_HA1_CACHE 2 //credentials whose digest hash is remembered
+#endif
+
+#ifndef HTTP_REQUEST_DATA_KEEP
+#define HTTP_REQUEST_DATA_KEEP 2048 //bytes of argument and header buffer kept from one request to the next
+#endif
+
 #define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
 #define CONTENT_LENGTH_NOT_SET ((size_t) -2)
 
 class ESP8266WebServer;
 
+// Takes the file data as it is received, instead of buf; called with len 0
+// while the client has nothing to read. Returns false to abort the upload.
+typedef std::function<bool(const uint8_t* data, size_t len)> HTTPUploadSink;
+
 typedef struct {
   HTTPUploadStatus status;
   String  filename;
@@ -58,9 +99,14 @@ typedef struct {
   size_t  totalSize;    // file size
   size_t  currentSize;  // size of data currently in buf
   uint8_t buf[HTTP_UPLOAD_BUFLEN];
+  // set at UPLOAD_FILE_START to skip buf: UPLOAD_FILE_WRITE isn't called and
+  // the data goes straight from the network buffers to the sink
+  HTTPUploadSink sink;
 } HTTPUpload;
 
 #include "detail/RequestHandler.h"
+#include "detail/RouteIndex.h"
+#include "detail/TemplateRenderer.h"
 
 namespace fs {
 class FS;
@@ -80,6 +126,23 @@ public:
   virtual void close();
   void stop();
 
+  // number of connections kept open and serviced in turn by handleClient()
+  // (1 to HTTP_MAX_CLIENTS, default 1)
+  void setMaxClients(uint8_t maxClients);
+  uint8_t getMaxClients() const { return _maxClients; }
+
+  // Allocate now what requests take: room for args arguments, for
+  // requestData bytes of their text and the headers, and with upload the
+  // HTTPUpload and its HTTP_UPLOAD_BUFLEN buffer. It is all kept until
+  // the server goes, and reused by each request and upload instead of
+  // being allocated for it. Returns false without memory, so that this
+  // shows in setup() rather than in the middle of an upload.
+  bool reserve(int args, bool upload = true, size_t requestData = 0);
+
+  // keep HTTP/1.1 connections open after a response (unless the client asks
+  // otherwise), waiting up to idleTimeout ms for each next request
+  void setKeepAlive(bool enable, unsigned long idleTimeout = HTTP_MAX_KEEPALIVE_WAIT, uint16_t maxRequests = HTTP_MAX_KEEPALIVE_REQUESTS);
+
   bool authenticate(const char * username, const char * password);
   void requestAuthentication(HTTPAuthMethod mode = BASIC_AUTH, const char* realm = NULL, const String& authFailMsg = String("") );
 
@@ -89,25 +152,41 @@ public:
   void on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
   void addHandler(RequestHandler* handler);
   void serveStatic(const char* uri, fs::FS& fs, const char* path, const char* cache_header = NULL );
+  // answer GET uri with the report of metrics_print() (see Metrics.h)
+  void serveMetrics(const char* uri = "/metrics");
+  // send ETag validators with files served by serveStatic and answer
+  // matching If-None-Match requests with 304; by default the ETag is the
+  // MD5 of the file contents, computed when the file is first served
+  typedef std::function<String(fs::FS& fs, const String& path)> ETagFunction;
+  void enableETag(bool enable, ETagFunction fn = nullptr);
+  // gzip the bodies written through beginResponse() (and so sendTemplate())
+  // for clients that accept it, as they are written; a body that ends
+  // before minSize bytes (at most a segment) goes out as it is, with its
+  // length. A response that already has a Content-Encoding is left alone.
+  void enableCompression(bool enable, size_t minSize = HTTP_COMPRESS_MIN_SIZE);
   void onNotFound(THandlerFunction fn);  //called when handler is not assigned
   void onFileUpload(THandlerFunction fn); //handle file uploads
 
   String uri() { return _currentUri; }
   HTTPMethod method() { return _currentMethod; }
   virtual WiFiClient client() { return _currentClient; }
+  // hand the connection of the current request over to the caller (e.g. for
+  // a protocol upgrade): once the handler returns, the server neither reads
+  // from it nor closes it, it stays open as long as the returned copy is kept
+  WiFiClient detachClient();
   HTTPUpload& upload() { return *_currentUpload; }
 
-  String arg(String name);        // get request argument value by name
+  String arg(StringView name);    // get request argument value by name
   String arg(int i);              // get request argument value by number
   String argName(int i);          // get request argument name by number
   int args();                     // get arguments count
-  bool hasArg(String name);       // check if argument exists
+  bool hasArg(StringView name);   // check if argument exists
   void collectHeaders(const char* headerKeys[], const size_t headerKeysCount); // set the request headers to collect
-  String header(String name);      // get request header value by name
+  String header(StringView name);    // get request header value by name
   String header(int i);              // get request header value by number
   String headerName(int i);          // get request header name by number
   int headers();                     // get header count
-  bool hasHeader(String name);       // check if header exists
+  bool hasHeader(StringView name);   // check if header exists
 
   String hostHeader();            // get request host header if available or empty String if not
 
@@ -127,69 +206,228 @@ public:
   void sendContent_P(PGM_P content);
   void sendContent_P(PGM_P content, size_t size);
 
-  static String urlDecode(const String& text);
-
+  // start a response whose body is written piecewise through the returned
+  // Print; small writes are gathered into segments of up to
+  // HTTP_DOWNLOAD_UNIT_SIZE bytes and sent with chunked transfer encoding
+  // (HTTP/1.0 clients get the raw body and the connection is closed).
+  // The response is completed by endResponse() or when the handler returns.
+  Print& beginResponse(int code, const char* content_type = NULL);
+  void endResponse();
+
+  // send a page made from a template, with each %NAME% in it replaced by
+  // what processor prints for NAME (see TemplateRenderer). The template is
+  // read in pieces, from flash for sendTemplate_P(), and the page goes out
+  // through beginResponse() in full segments.
+  typedef TemplateRenderer::Processor TTemplateProcessor;
+  void sendTemplate_P(int code, const char* content_type, PGM_P tmpl, const TTemplateProcessor& processor);
+  void sendTemplate(int code, const char* content_type, fs::File& tmpl, const TTemplateProcessor& processor);
+
+  static String urlDecode(StringView text);
+
+  // sends the file, or the part of it asked for with a single range
+  // Range header (206); returns the number of bytes sent
   template<typename T> 
   size_t streamFile(T &file, const String& contentType) {
-    _streamFileCore(file.size(), file.name(), contentType);
-    return _currentClient.write(file);
+    size_t start, length;
+    if (!_streamFileCore(file.size(), file.name(), contentType, start, length))
+      return 0;
+    if (length == (size_t) file.size())
+      return _currentClient.write(file);
+    return _streamFileRange(file, start, length);
   }
   
 protected:
   virtual size_t _currentClientWrite(const char* b, size_t l) { return _currentClient.write( b, l ); }
   virtual size_t _currentClientWrite_P(PGM_P b, size_t l) { return _currentClient.write_P( b, l ); }
-  void _addRequestHandler(RequestHandler* handler);
+  virtual size_t _currentClientWritev(const WiFiClient::IOVec* v, size_t n) { return _currentClient.writev( v, n ); }
+  void _addRequestHandler(RequestHandler* handler, bool generic = true);
+  void _routeIndexMissed();
+  RequestHandler* _findHandler();
   void _handleRequest();
   void _finalizeResponse();
   bool _parseRequest(WiFiClient& client);
-  void _parseArguments(String data);
+  bool _parseRequest(WiFiClient& client, const String& head);
+  static bool _readRequestHead(WiFiClient& client, String& head);
+  static size_t _headContentLength(const String& head);
+  void _parseArguments(size_t offset, size_t length);
+  bool _startUpload();
+  void _endUpload();
+  bool _addArgument(size_t key, size_t keyLength, size_t value, size_t valueLength);
+  size_t _storeRequestData(StringView text);
+  bool _reserveRequestData(size_t length);
+  void _resetRequestData();
+  StringView _requestView(size_t offset, size_t length) const { return length ? StringView(_requestData + offset, length) : StringView(); }
+  static uint32_t _hashName(StringView name, bool ignoreCase);
+  static size_t _urlDecodeInPlace(char* text, size_t length);
   static String _responseCodeToString(int code);
   bool _parseForm(WiFiClient& client, String boundary, uint32_t len);
   bool _parseFormUploadAborted();
-  void _uploadWriteByte(uint8_t b);
-  uint8_t _uploadReadByte(WiFiClient& client);
+  bool _uploadWriteBytes(const uint8_t* data, size_t len);
+  bool _uploadReadPart(WiFiClient& client, const String& boundary);
   void _prepareHeader(String& response, int code, const char* content_type, size_t contentLength);
-  bool _collectHeader(const char* headerName, const char* headerValue);
+  bool _collectHeader(StringView headerName, StringView headerValue);
+  void _parseConnectionHeader(const String& value);
+  void _parseAcceptEncodingHeader(const String& value);
  
-  void _streamFileCore(const size_t fileSize, const String & fileName, const String & contentType);
+  // sends the head for streamFile(), false when there is nothing to send
+  bool _streamFileCore(const size_t fileSize, const String & fileName, const String & contentType, size_t& start, size_t& length);
+  template<typename T>
+  size_t _streamFileRange(T &file, size_t start, size_t length) {
+    if (!file.seek(start))
+      return 0;
+    WiFiClient::IOVec part(file, length);
+    return _currentClientWritev(&part, 1);
+  }
 
   String _getRandomHexString();
-  // for extracting Auth parameters
-  String _extractParam(String& authReq,const String& param,const char delimit = '"');
+  bool _authenticateDigest(const char* username, const char* password, StringView authReq);
+  void _digestHA1(const char* username, StringView realm, const char* password, char* ha1);
 
+  // Argument names and values, and the values of the collected headers, are
+  // kept in _requestData, one buffer for the whole request reused by the
+  // next ones, and found through a hash of the name (lowercased for headers).
   struct RequestArgument {
-    String key;
-    String value;
+    uint32_t hash;
+    size_t   key;
+    size_t   keyLength;
+    size_t   value;
+    size_t   valueLength;
+  };
+  struct RequestHeader {
+    String   key;
+    uint32_t hash;
+    size_t   value;
+    size_t   valueLength;
+  };
+
+  // body sink returned by beginResponse()
+  class ResponseWriter : public Print {
+  public:
+    ResponseWriter(ESP8266WebServer& server) : _server(server) {}
+    ~ResponseWriter() { free(_buf); delete _deflater; }
+
+    bool begin();
+    // begin() without the head sent yet: it goes out once it is known
+    // whether the body gets compressed. False if there is no buffer for it.
+    bool defer(int code, const char* content_type);
+    void end();
+    bool active() const { return _active; }
+    bool compressing() const { return _deflater != nullptr; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t size) override;
+    void flush() override;
+
+  protected:
+    // feeds the compressed body into the segments
+    class Compressor : public Deflater {
+    public:
+      Compressor(ResponseWriter& writer) : _writer(writer) {}
+    protected:
+      bool output(const uint8_t* data, size_t size) override { return _writer._append(data, size); }
+      ResponseWriter& _writer;
+    };
+
+    void _start(bool compress, bool last);
+    bool _append(const uint8_t* data, size_t size);
+    void _sendBuffer();
+    bool _send(const char* data, size_t size);
+
+    ESP8266WebServer& _server;
+    char*   _buf = nullptr;  // chunk header, payload and trailing CRLF
+    size_t  _len = 0;        // payload bytes buffered
+    bool    _active = false;
+    // deferred: the status and content type of the head still to send
+    bool    _deferred = false;
+    int     _code = 0;
+    String  _type;
+    Compressor* _deflater = nullptr;
+  };
+
+  // state of one accepted connection, see handleClient()
+  struct HTTPConnection {
+    WiFiClient       client;
+    HTTPClientStatus status = HC_NONE;
+    unsigned long    statusChange = 0;
+    String           head;                // request line and headers received so far
+    bool             headComplete = false;
+    size_t           bodyLength = 0;      // Content-Length announced in head
+    uint16_t         requests = 0;        // requests served so far
   };
 
+  bool _handleConnection(HTTPConnection& conn);
+
   WiFiServer  _server;
 
+  HTTPConnection _connections[HTTP_MAX_CLIENTS];
+  uint8_t     _maxClients;
+  uint8_t     _nextConnection;
+  bool        _keepAlive;
+  unsigned long _keepAliveTimeout;
+  uint16_t    _keepAliveMaxRequests;
+
   WiFiClient  _currentClient;
   HTTPMethod  _currentMethod;
   String      _currentUri;
   uint8_t     _currentVersion;
   HTTPClientStatus _currentStatus;
   unsigned long _statusChange;
+  bool        _requestKeepAlive;  // the client asked for a persistent connection
+  bool        _requestGzip;       // the client accepts gzip bodies
+  bool        _currentKeepAlive;  // the connection stays open after this response
+  bool        _currentDetached;   // detachClient() was called for this request
 
   RequestHandler*  _currentHandler;
   RequestHandler*  _firstHandler;
   RequestHandler*  _lastHandler;
+  RouteIndex       _routeIndex;
+  bool             _routesIndexed = true;  // false once _routeIndex missed a handler
   THandlerFunction _notFoundHandler;
   THandlerFunction _fileUploadHandler;
 
   int              _currentArgCount;
+  int              _currentArgCapacity;
   RequestArgument* _currentArgs;
+  char*            _requestData;
+  size_t           _requestDataLength;
+  size_t           _requestDataCapacity;
   std::unique_ptr<HTTPUpload> _currentUpload;
+  bool             _uploadReserved = false;
+  size_t           _requestDataReserved = 0;
 
   int              _headerKeysCount;
-  RequestArgument* _currentHeaders;
+  RequestHeader*   _currentHeaders;
   size_t           _contentLength;
   String           _responseHeaders;
 
   String           _hostHeader;
   bool             _chunked;
-
-  String           _snonce;  // Store noance and opaque for future comparison
+  ResponseWriter   _responseWriter;
+
+  bool             _eTagEnabled;
+  ETagFunction     _eTagFunction;
+  bool             _compressEnabled;
+  size_t           _compressMinSize;
+  friend class StaticRequestHandler;
+
+  // digest nonces handed out, each valid for HTTP_AUTH_NONCE_TTL ms, so
+  // that several clients can be logged in at a time
+  struct AuthNonce {
+    char          nonce[33] = "";
+    unsigned long issued = 0;
+  };
+  AuthNonce        _authNonces[HTTP_AUTH_NONCES];
+  uint8_t          _authNonceNext = 0;
+  bool             _authStale = false;  // the last digest failed on an expired nonce only
+  // MD5(username:realm:password) of the last credentials checked
+  struct AuthHA1 {
+    String        username;
+    String        realm;
+    String        password;
+    char          ha1[33];
+  };
+  AuthHA1          _authHA1[HTTP_AUTH_HA1_CACHE];
+  uint8_t          _authHA1Next = 0;
   String           _sopaque;
   String           _srealm;  // Store the Auth realm between Calls
 
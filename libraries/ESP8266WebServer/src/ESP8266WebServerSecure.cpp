@@ -88,6 +88,7 @@ void ESP8266WebServerSecure::handleClient() {
     _currentClientSecure = client;
     _currentStatus = HC_WAIT_READ;
     _statusChange = millis();
+    _currentRequests = 0;
   }
 
   bool keepCurrentClient = false;
@@ -104,16 +105,24 @@ void ESP8266WebServerSecure::handleClient() {
         if (_parseRequest(_currentClientSecure)) {
           _currentClientSecure.setTimeout(HTTP_MAX_SEND_WAIT);
           _contentLength = CONTENT_LENGTH_NOT_SET;
+          _currentKeepAlive = _keepAlive && _requestKeepAlive && _currentRequests + 1 < _keepAliveMaxRequests;
           _handleRequest();
 
           if (_currentClientSecure.connected()) {
-            _currentStatus = HC_WAIT_CLOSE;
+            // the next request on this connection skips the handshake altogether
+            _currentStatus = _currentKeepAlive ? HC_WAIT_READ : HC_WAIT_CLOSE;
             _statusChange = millis();
+            ++_currentRequests;
             keepCurrentClient = true;
           }
+          _currentKeepAlive = false;
         }
       } else { // !_currentClient.available()
-        if (millis() - _statusChange <= HTTP_MAX_DATA_WAIT) {
+        // Connections are served one at a time, so an idle kept-alive one
+        // makes way as soon as another client is waiting; it can come back
+        // and resume its TLS session cheaply.
+        unsigned long timeout = _currentRequests ? _keepAliveTimeout : HTTP_MAX_DATA_WAIT;
+        if (millis() - _statusChange <= timeout && !(_currentRequests && _serverSecure.hasClient())) {
           keepCurrentClient = true;
         }
         callYield = true;
@@ -44,17 +44,23 @@ public:
 
   template<typename T>
   size_t streamFile(T &file, const String& contentType) {
-    _streamFileCore(file.size(), file.name(), contentType);
-    return _currentClientSecure.write(file);
+    size_t start, length;
+    if (!_streamFileCore(file.size(), file.name(), contentType, start, length))
+      return 0;
+    if (length == (size_t) file.size())
+      return _currentClientSecure.write(file);
+    return _streamFileRange(file, start, length);
   }
 
 private:
   size_t _currentClientWrite (const char *bytes, size_t len) override { return _currentClientSecure.write((const uint8_t *)bytes, len); }
   size_t _currentClientWrite_P (PGM_P bytes, size_t len) override { return _currentClientSecure.write_P(bytes, len); }
+  size_t _currentClientWritev (const WiFiClient::IOVec* parts, size_t count) override { return _currentClientSecure.writev(parts, count); }
 
 protected:
   WiFiServerSecure _serverSecure;
   WiFiClientSecure _currentClientSecure;
+  uint16_t         _currentRequests = 0;   // requests served on _currentClientSecure
 };
 
 
@@ -0,0 +1,176 @@
+/*
+  EventSource.cpp - Server-Sent Events endpoint for ESP8266WebServer
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include "EventSource.h"
+
+EventSource::EventSource(const String& uri)
+: _uri(uri)
+{
+}
+
+EventSource::~EventSource() {
+  for (uint8_t i = 0; i < EVENTSOURCE_MAX_CLIENTS; ++i)
+    _clients[i].client.stop();
+}
+
+bool EventSource::canHandle(HTTPMethod method, String uri) {
+  return method == HTTP_GET && uri == _uri;
+}
+
+bool EventSource::handle(ESP8266WebServer& server, HTTPMethod requestMethod, String requestUri) {
+  if (!canHandle(requestMethod, requestUri))
+    return false;
+
+  uint8_t num = 0;
+  while (num < EVENTSOURCE_MAX_CLIENTS && _clients[num].client)
+    ++num;
+  if (num == EVENTSOURCE_MAX_CLIENTS) {
+    // tells the browser not to reconnect right away
+    server.send(503, "text/plain", F("Too many event stream clients"));
+    return true;
+  }
+  WiFiClient client = server.detachClient();
+  if (!client) {
+    // the server does not give its connections away (ESP8266WebServerSecure)
+    server.send(501, "text/plain", "");
+    return true;
+  }
+
+  static const char head[] PROGMEM = "HTTP/1.1 200 OK\r\n"
+                                     "Content-Type: text/event-stream\r\n"
+                                     "Cache-Control: no-cache\r\n"
+                                     "Connection: keep-alive\r\n"
+                                     "\r\n";
+  client.setNoDelay(true);
+  if (client.write_P(head, sizeof(head) - 1) != sizeof(head) - 1) {
+    client.stop();
+    return true;
+  }
+  // from now on writes only queue what fits
+  client.setAsync(true);
+
+  Subscriber& subscriber = _clients[num];
+  subscriber.client = client;
+  subscriber.missed = 0;
+  subscriber.missedTotal = 0;
+  if (_connectHandler)
+    _connectHandler(num);
+  return true;
+}
+
+void EventSource::loop() {
+  bool any = false;
+  for (uint8_t i = 0; i < EVENTSOURCE_MAX_CLIENTS; ++i) {
+    WiFiClient& client = _clients[i].client;
+    if (!client) {
+      // gone, or stopped by _write()
+      client = WiFiClient();
+      continue;
+    }
+    // nothing is expected from the browser
+    if (client.available())
+      client.peekConsume(client.peekAvailable());
+    any = true;
+  }
+  if (EVENTSOURCE_KEEPALIVE && any && millis() - _lastSent >= EVENTSOURCE_KEEPALIVE) {
+    _frame = ":\n";
+    for (uint8_t i = 0; i < EVENTSOURCE_MAX_CLIENTS; ++i)
+      if (_clients[i].client)
+        _write(i);
+    _lastSent = millis();
+  }
+}
+
+// Each line of data becomes a "data:" field, the browser joins them again.
+void EventSource::_format(const char* data, const char* event, uint32_t id) {
+  size_t lines = 1;
+  for (const char* p = data; *p; ++p)
+    if (*p == '\n')
+      ++lines;
+  // reserved at once; the buffer of earlier events is kept and reused
+  _frame = "";
+  _frame.reserve(strlen(data) + lines * 7 + (event ? strlen(event) + 8 : 0) + (id ? 15 : 0) + 1);
+  if (id) {
+    _frame += F("id: ");
+    _frame += id;
+    _frame += '\n';
+  }
+  if (event) {
+    _frame += F("event: ");
+    _frame += event;
+    _frame += '\n';
+  }
+  _frame += F("data: ");
+  for (const char* p = data; *p; ++p) {
+    if (*p == '\n')
+      _frame += F("\ndata: ");
+    else
+      _frame += *p;
+  }
+  _frame += F("\n\n");
+}
+
+bool EventSource::_write(uint8_t num) {
+  Subscriber& subscriber = _clients[num];
+  if (!subscriber.client.connected())
+    return false;
+  size_t length = _frame.length();
+  if (subscriber.client.availableForWrite() < length) {
+    ++subscriber.missedTotal;
+    if (++subscriber.missed > EVENTSOURCE_MAX_MISSED)
+      subscriber.client.stop();
+    return false;
+  }
+  if (subscriber.client.write((const uint8_t*) _frame.c_str(), length) != length) {
+    // half an event would garble the stream
+    subscriber.client.stop();
+    return false;
+  }
+  subscriber.missed = 0;
+  return true;
+}
+
+size_t EventSource::send(const char* data, const char* event, uint32_t id) {
+  _format(data, event, id);
+  size_t sent = 0;
+  for (uint8_t i = 0; i < EVENTSOURCE_MAX_CLIENTS; ++i)
+    if (_clients[i].client && _write(i))
+      ++sent;
+  _lastSent = millis();
+  return sent;
+}
+
+bool EventSource::send(uint8_t num, const char* data, const char* event, uint32_t id) {
+  if (num >= EVENTSOURCE_MAX_CLIENTS || !_clients[num].client)
+    return false;
+  _format(data, event, id);
+  return _write(num);
+}
+
+bool EventSource::connected(uint8_t num) {
+  return num < EVENTSOURCE_MAX_CLIENTS && _clients[num].client && _clients[num].client.connected();
+}
+
+size_t EventSource::connectedClients() {
+  size_t count = 0;
+  for (uint8_t i = 0; i < EVENTSOURCE_MAX_CLIENTS; ++i)
+    if (connected(i))
+      ++count;
+  return count;
+}
@@ -0,0 +1,91 @@
+/*
+  EventSource.h - Server-Sent Events endpoint for ESP8266WebServer
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef EVENTSOURCE_H
+#define EVENTSOURCE_H
+
+#include "ESP8266WebServer.h"
+
+#ifndef EVENTSOURCE_MAX_CLIENTS
+#define EVENTSOURCE_MAX_CLIENTS 4
+#endif
+
+// consecutive events a client may miss for lack of room before it is dropped
+#ifndef EVENTSOURCE_MAX_MISSED
+#define EVENTSOURCE_MAX_MISSED 8
+#endif
+
+// a comment line is sent after this long without events, so that idle
+// connections are noticed when they break (0 to never send one)
+#ifndef EVENTSOURCE_KEEPALIVE
+#define EVENTSOURCE_KEEPALIVE 15000
+#endif
+
+// A text/event-stream endpoint (Server-Sent Events, the browser's
+// EventSource), added to a server with addHandler(). A GET request for its
+// URI is answered with the stream headers and the connection is taken over
+// from the server, which goes on serving the other requests; loop() has to
+// be called as often as the server's handleClient().
+//
+// send() formats the event once and queues it to every subscriber without
+// waiting for any of them. A client that has no room for it right now
+// (availableForWrite()) misses that event; one that keeps missing them is
+// dropped, and an EventSource in a browser reconnects by itself.
+class EventSource : public RequestHandler {
+public:
+  typedef std::function<void(uint8_t num)> THandlerFunction;
+
+  EventSource(const String& uri);
+  ~EventSource();
+
+  void onConnect(THandlerFunction handler) { _connectHandler = handler; }
+  void loop();
+
+  // data may hold several lines; event and id are left out when NULL or 0.
+  // Returns the number of clients the event went to.
+  size_t send(const char* data, const char* event = NULL, uint32_t id = 0);
+  size_t send(const String& data, const char* event = NULL, uint32_t id = 0) { return send(data.c_str(), event, id); }
+  // to one client only
+  bool send(uint8_t num, const char* data, const char* event = NULL, uint32_t id = 0);
+
+  bool connected(uint8_t num);
+  size_t connectedClients();
+  // events not queued to num for lack of room, since it connected
+  uint32_t missed(uint8_t num) { return num < EVENTSOURCE_MAX_CLIENTS ? _clients[num].missedTotal : 0; }
+
+  bool canHandle(HTTPMethod method, String uri) override;
+  bool handle(ESP8266WebServer& server, HTTPMethod requestMethod, String requestUri) override;
+
+protected:
+  struct Subscriber {
+    WiFiClient client;
+    uint8_t    missed = 0;       // in a row
+    uint32_t   missedTotal = 0;
+  };
+
+  void _format(const char* data, const char* event, uint32_t id);
+  bool _write(uint8_t num);
+
+  String        _uri;
+  String        _frame;          // the event being sent, kept for its buffer
+  THandlerFunction _connectHandler;
+  Subscriber    _clients[EVENTSOURCE_MAX_CLIENTS];
+  unsigned long _lastSent = 0;
+};
+
+#endif //EVENTSOURCE_H
@@ -20,10 +20,12 @@
 */
 
 #include <Arduino.h>
+#include <algorithm>
 #include "WiFiServer.h"
 #include "WiFiClient.h"
 #include "ESP8266WebServer.h"
 #include "detail/mimetable.h"
+#include "detail/KeywordTable.h"
 
 //#define DEBUG_ESP_HTTP_SERVER
 #ifdef DEBUG_ESP_PORT
@@ -35,46 +37,161 @@
 static const char Content_Type[] PROGMEM = "Content-Type";
 static const char filename[] PROGMEM = "filename";
 
-static char* readBytesWithTimeout(WiFiClient& client, size_t maxLength, size_t& dataLength, int timeout_ms)
+#define HTTP_METHODS(X) \
+  X("GET", HTTP_GET) \
+  X("POST", HTTP_POST) \
+  X("DELETE", HTTP_DELETE) \
+  X("OPTIONS", HTTP_OPTIONS) \
+  X("PUT", HTTP_PUT) \
+  X("PATCH", HTTP_PATCH)
+
+// the headers the parser acts on
+#define KNOWN_HEADERS(X) \
+  X(Header_Content_Type, "Content-Type") \
+  X(Header_Content_Length, "Content-Length") \
+  X(Header_Host, "Host") \
+  X(Header_Connection, "Connection") \
+  X(Header_Accept_Encoding, "Accept-Encoding")
+
+#define METHOD_NAME(name, method) name,
+#define METHOD_VALUE(name, method) method,
+#define HEADER_ENUM(id, name) id,
+#define HEADER_NAME(id, name) name,
+
+static constexpr const char* methodKeys[] = { HTTP_METHODS(METHOD_NAME) };
+static const char methodNames[][8] PROGMEM = { HTTP_METHODS(METHOD_NAME) };
+static const uint8_t methodValues[] PROGMEM = { HTTP_METHODS(METHOD_VALUE) };
+static constexpr keyword::Table<16> methodTable PROGMEM =
+    keyword::make<16>(methodKeys, sizeof(methodKeys) / sizeof(methodKeys[0]));
+
+enum KnownHeader { KNOWN_HEADERS(HEADER_ENUM) Header_Other };
+static constexpr const char* headerKeys[] = { KNOWN_HEADERS(HEADER_NAME) };
+static const char headerNames[][16] PROGMEM = { KNOWN_HEADERS(HEADER_NAME) };
+static constexpr keyword::Table<16> headerTable PROGMEM =
+    keyword::make<16>(headerKeys, Header_Other);
+
+// methods are case sensitive, HTTP_GET for an unknown one as before
+static HTTPMethod methodOf(const StringView& name)
 {
-  char *buf = nullptr;
-  dataLength = 0;
-  while (dataLength < maxLength) {
+  uint8_t i = keyword::find(methodTable, name);
+  if (i == keyword::NONE || name != FPSTR(methodNames[i]))
+    return HTTP_GET;
+  return (HTTPMethod) pgm_read_byte(&methodValues[i]);
+}
+
+static KnownHeader knownHeader(const StringView& name)
+{
+  uint8_t i = keyword::find(headerTable, name);
+  if (i == keyword::NONE || !name.equalsIgnoreCase(FPSTR(headerNames[i])))
+    return Header_Other;
+  return (KnownHeader) i;
+}
+
+// Reads up to length bytes into buf, waiting up to timeout_ms for each
+// piece to arrive. Returns the number of bytes read.
+static size_t readBytesWithTimeout(WiFiClient& client, char* buf, size_t length, int timeout_ms)
+{
+  size_t done = 0;
+  while (done < length) {
     int tries = timeout_ms;
-    size_t newLength;
-    while (!(newLength = client.available()) && tries--) delay(1);
-    if (!newLength) {
+    size_t available;
+    while (!(available = client.available()) && tries--) delay(1);
+    if (!available) {
       break;
     }
-    if (!buf) {
-      buf = (char *) malloc(newLength + 1);
-      if (!buf) {
-        return nullptr;
-      }
-    }
-    else {
-      char* newBuf = (char *) realloc(buf, dataLength + newLength + 1);
-      if (!newBuf) {
-        free(buf);
-        return nullptr;
-      }
-      buf = newBuf;
+    done += client.readBytes(buf + done, std::min(available, length - done));
+  }
+  return done;
+}
+
+// Appends one received character to the request head.
+// Returns true when it completes the empty line ending the headers.
+static bool appendHeadChar(String& head, char c)
+{
+  head += c;
+  if (c != '\n')
+    return false;
+  unsigned int len = head.length();
+  if (len <= 2 && (len == 1 || head[0] == '\r')) {
+    // tolerate empty lines preceding the request line
+    head = String();
+    return false;
+  }
+  return (head[len - 2] == '\n') || (len >= 3 && head[len - 2] == '\r' && head[len - 3] == '\n');
+}
+
+// Returns the line of the request head starting at pos, without its line
+// ending, and moves pos to the start of the next line. The line points
+// into head.
+static StringView headLine(const String& head, int& pos)
+{
+  int end = head.indexOf('\n', pos);
+  if (end == -1)
+    end = head.length();
+  int next = end + 1;
+  if (end > pos && head[end - 1] == '\r')
+    --end;
+  StringView line = StringView(head).substring(pos, end);
+  pos = next;
+  return line;
+}
+
+bool ESP8266WebServer::_readRequestHead(WiFiClient& client, String& head) {
+  while (client.available() && head.length() <= HTTP_MAX_HEAD_LENGTH) {
+    const char* buf = client.peekBuffer();
+    size_t len = client.peekAvailable();
+    if (!buf || !len) {
+      // no direct access to the received data, take it one byte at a time
+      int c = client.read();
+      if (c < 0)
+        break;
+      if (appendHeadChar(head, (char) c))
+        return true;
+      continue;
     }
-    client.readBytes(buf + dataLength, newLength);
-    dataLength += newLength;
-    buf[dataLength] = '\0';
+    // scan the received segment in place, leaving whatever follows the head
+    head.reserve(head.length() + len);
+    size_t used = 0;
+    bool complete = false;
+    while (used < len && !complete)
+      complete = appendHeadChar(head, buf[used++]);
+    client.peekConsume(used);
+    if (complete)
+      return true;
   }
-  return buf;
+  return false;
+}
+
+size_t ESP8266WebServer::_headContentLength(const String& head) {
+  int pos = head.indexOf('\n') + 1;
+  while (pos > 0 && pos < (int) head.length()) {
+    StringView line = headLine(head, pos);
+    int headerDiv = line.indexOf(':');
+    if (headerDiv == -1)
+      break;
+    if (line.substring(0, headerDiv).equalsIgnoreCase(F("Content-Length")))
+      return line.substring(headerDiv + 1).toInt();
+  }
+  return 0;
 }
 
 bool ESP8266WebServer::_parseRequest(WiFiClient& client) {
+  // Collect the request head, waiting for it to arrive
+  String head;
+  unsigned long start = millis();
+  while (!_readRequestHead(client, head)) {
+    if (!client.connected() || head.length() > HTTP_MAX_HEAD_LENGTH || millis() - start > HTTP_MAX_DATA_WAIT)
+      return false;
+    delay(1);
+  }
+  return _parseRequest(client, head);
+}
+
+bool ESP8266WebServer::_parseRequest(WiFiClient& client, const String& head) {
   // Read the first line of HTTP request
-  String req = client.readStringUntil('\r');
-  client.readStringUntil('\n');
-  //reset header value
-  for (int i = 0; i < _headerKeysCount; ++i) {
-    _currentHeaders[i].value =String();
-   }
+  int headPos = 0;
+  StringView req = headLine(head, headPos);
+  _resetRequestData();
 
   // First line of HTTP request looks like "GET /path HTTP/1.1"
   // Retrieve the "/path" part by finding the spaces
@@ -83,86 +200,76 @@ bool ESP8266WebServer::_parseRequest(WiFiClient& client) {
   if (addr_start == -1 || addr_end == -1) {
 #ifdef DEBUG_ESP_HTTP_SERVER
     DEBUG_OUTPUT.print("Invalid request: ");
-    DEBUG_OUTPUT.println(req);
+    DEBUG_OUTPUT.println(req.toString());
 #endif
     return false;
   }
 
-  String methodStr = req.substring(0, addr_start);
-  String url = req.substring(addr_start + 1, addr_end);
-  String versionEnd = req.substring(addr_end + 8);
-  _currentVersion = atoi(versionEnd.c_str());
-  String searchStr = "";
+  StringView methodStr = req.substring(0, addr_start);
+  StringView url = req.substring(addr_start + 1, addr_end);
+  _currentVersion = req.substring(addr_end + 8).toInt();
+  // HTTP/1.1 connections are persistent unless the client says otherwise
+  _requestKeepAlive = _currentVersion >= 1;
+  _requestGzip = false;
+  StringView searchStr;
   int hasSearch = url.indexOf('?');
   if (hasSearch != -1){
     searchStr = url.substring(hasSearch + 1);
     url = url.substring(0, hasSearch);
   }
-  _currentUri = url;
+  _currentUri = url.toString();
   _chunked = false;
 
-  HTTPMethod method = HTTP_GET;
-  if (methodStr == F("POST")) {
-    method = HTTP_POST;
-  } else if (methodStr == F("DELETE")) {
-    method = HTTP_DELETE;
-  } else if (methodStr == F("OPTIONS")) {
-    method = HTTP_OPTIONS;
-  } else if (methodStr == F("PUT")) {
-    method = HTTP_PUT;
-  } else if (methodStr == F("PATCH")) {
-    method = HTTP_PATCH;
-  }
+  HTTPMethod method = methodOf(methodStr);
   _currentMethod = method;
 
 #ifdef DEBUG_ESP_HTTP_SERVER
   DEBUG_OUTPUT.print("method: ");
-  DEBUG_OUTPUT.print(methodStr);
+  DEBUG_OUTPUT.print(methodStr.toString());
   DEBUG_OUTPUT.print(" url: ");
-  DEBUG_OUTPUT.print(url);
+  DEBUG_OUTPUT.print(_currentUri);
   DEBUG_OUTPUT.print(" search: ");
-  DEBUG_OUTPUT.println(searchStr);
+  DEBUG_OUTPUT.println(searchStr.toString());
 #endif
 
   //attach handler
-  RequestHandler* handler;
-  for (handler = _firstHandler; handler; handler = handler->next()) {
-    if (handler->canHandle(_currentMethod, _currentUri))
-      break;
-  }
-  _currentHandler = handler;
+  _currentHandler = _findHandler();
+
+  // the query goes into the request buffer, where it is decoded in place
+  size_t searchOffset = _storeRequestData(searchStr);
+  if (searchOffset == (size_t) -1)
+    return false;
 
   String formData;
   // below is needed only when POST type request
   if (method == HTTP_POST || method == HTTP_PUT || method == HTTP_PATCH || method == HTTP_DELETE){
     String boundaryStr;
-    String headerName;
-    String headerValue;
+    StringView headerName;
+    StringView headerValue;
     bool isForm = false;
     bool isEncoded = false;
     uint32_t contentLength = 0;
     //parse headers
     while(1){
-      req = client.readStringUntil('\r');
-      client.readStringUntil('\n');
-      if (req == "") break;//no moar headers
+      req = headLine(head, headPos);
+      if (req.isEmpty()) break;//no moar headers
       int headerDiv = req.indexOf(':');
       if (headerDiv == -1){
         break;
       }
       headerName = req.substring(0, headerDiv);
-      headerValue = req.substring(headerDiv + 1);
-      headerValue.trim();
-       _collectHeader(headerName.c_str(),headerValue.c_str());
+      headerValue = req.substring(headerDiv + 1).trim();
+      _collectHeader(headerName, headerValue);
 
       #ifdef DEBUG_ESP_HTTP_SERVER
       DEBUG_OUTPUT.print("headerName: ");
-      DEBUG_OUTPUT.println(headerName);
+      DEBUG_OUTPUT.println(headerName.toString());
       DEBUG_OUTPUT.print("headerValue: ");
-      DEBUG_OUTPUT.println(headerValue);
+      DEBUG_OUTPUT.println(headerValue.toString());
       #endif
 
-      if (headerName.equalsIgnoreCase(FPSTR(Content_Type))){
+      KnownHeader known = knownHeader(headerName);
+      if (known == Header_Content_Type){
         using namespace mime;
         if (headerValue.startsWith(FPSTR(mimeTable[txt].mimeType))){
           isForm = false;
@@ -170,199 +277,353 @@ bool ESP8266WebServer::_parseRequest(WiFiClient& client) {
           isForm = false;
           isEncoded = true;
         } else if (headerValue.startsWith(F("multipart/"))){
-          boundaryStr = headerValue.substring(headerValue.indexOf('=') + 1);
+          boundaryStr = headerValue.substring(headerValue.indexOf('=') + 1).toString();
           boundaryStr.replace("\"","");
           isForm = true;
         }
-      } else if (headerName.equalsIgnoreCase(F("Content-Length"))){
+      } else if (known == Header_Content_Length){
         contentLength = headerValue.toInt();
-      } else if (headerName.equalsIgnoreCase(F("Host"))){
-        _hostHeader = headerValue;
+      } else if (known == Header_Host){
+        _hostHeader = headerValue.toString();
+      } else if (known == Header_Connection){
+        _parseConnectionHeader(headerValue.toString());
+      } else if (known == Header_Accept_Encoding){
+        _parseAcceptEncodingHeader(headerValue.toString());
       }
     }
 
     if (!isForm){
-      size_t plainLength;
-      char* plainBuf = readBytesWithTimeout(client, contentLength, plainLength, HTTP_MAX_POST_WAIT);
-      if (plainLength < contentLength) {
-      	free(plainBuf);
-      	return false;
-      }
+      _parseArguments(searchOffset, searchStr.length());
       if (contentLength > 0) {
+        // the body is read straight into the request buffer
+        if (!_reserveRequestData(contentLength))
+          return false;
+        size_t bodyOffset = _requestDataLength;
+        size_t plainLength = readBytesWithTimeout(client, _requestData + bodyOffset, contentLength, HTTP_MAX_POST_WAIT);
+        _requestDataLength += plainLength;
+        if (plainLength < contentLength)
+          return false;
         if(isEncoded){
           //url encoded form
-          if (searchStr != "") searchStr += '&';
-          searchStr += plainBuf;
-        }
-        _parseArguments(searchStr);
-        if(!isEncoded){
+          _parseArguments(bodyOffset, plainLength);
+        } else {
           //plain post json or other data
-          RequestArgument& arg = _currentArgs[_currentArgCount++];
-          arg.key = F("plain");
-          arg.value = String(plainBuf);
+          size_t key = _storeRequestData(F("plain"));
+          if (key == (size_t) -1 || !_addArgument(key, 5, bodyOffset, plainLength))
+            return false;
         }
 
   #ifdef DEBUG_ESP_HTTP_SERVER
         DEBUG_OUTPUT.print("Plain: ");
-        DEBUG_OUTPUT.println(plainBuf);
+        DEBUG_OUTPUT.println(_requestView(bodyOffset, plainLength).toString());
   #endif
-        free(plainBuf);
-      } else {
-        // No content - but we can still have arguments in the URL.
-        _parseArguments(searchStr);
       }
     }
 
     if (isForm){
-      _parseArguments(searchStr);
+      _parseArguments(searchOffset, searchStr.length());
       if (!_parseForm(client, boundaryStr, contentLength)) {
         return false;
       }
     }
   } else {
-    String headerName;
-    String headerValue;
+    StringView headerName;
+    StringView headerValue;
     //parse headers
     while(1){
-      req = client.readStringUntil('\r');
-      client.readStringUntil('\n');
-      if (req == "") break;//no moar headers
+      req = headLine(head, headPos);
+      if (req.isEmpty()) break;//no moar headers
       int headerDiv = req.indexOf(':');
       if (headerDiv == -1){
         break;
       }
       headerName = req.substring(0, headerDiv);
       headerValue = req.substring(headerDiv + 2);
-      _collectHeader(headerName.c_str(),headerValue.c_str());
+      _collectHeader(headerName, headerValue);
 
 	  #ifdef DEBUG_ESP_HTTP_SERVER
 	  DEBUG_OUTPUT.print("headerName: ");
-	  DEBUG_OUTPUT.println(headerName);
+	  DEBUG_OUTPUT.println(headerName.toString());
 	  DEBUG_OUTPUT.print("headerValue: ");
-	  DEBUG_OUTPUT.println(headerValue);
+	  DEBUG_OUTPUT.println(headerValue.toString());
 	  #endif
 
-	  if (headerName.equalsIgnoreCase("Host")){
-        _hostHeader = headerValue;
+	  KnownHeader known = knownHeader(headerName);
+	  if (known == Header_Host){
+        _hostHeader = headerValue.toString();
+      } else if (known == Header_Connection){
+        _parseConnectionHeader(headerValue.toString());
+      } else if (known == Header_Accept_Encoding){
+        _parseAcceptEncodingHeader(headerValue.toString());
       }
     }
-    _parseArguments(searchStr);
+    _parseArguments(searchOffset, searchStr.length());
   }
   client.flush();
 
 #ifdef DEBUG_ESP_HTTP_SERVER
   DEBUG_OUTPUT.print("Request: ");
-  DEBUG_OUTPUT.println(url);
+  DEBUG_OUTPUT.println(_currentUri);
   DEBUG_OUTPUT.print(" Arguments: ");
-  DEBUG_OUTPUT.println(searchStr);
+  DEBUG_OUTPUT.println(searchStr.toString());
 #endif
 
   return true;
 }
 
-bool ESP8266WebServer::_collectHeader(const char* headerName, const char* headerValue) {
+void ESP8266WebServer::_parseConnectionHeader(const String& value) {
+  String options = value;
+  options.toLowerCase();
+  if (options.indexOf(F("close")) != -1)
+    _requestKeepAlive = false;
+  else if (options.indexOf(F("keep-alive")) != -1)
+    _requestKeepAlive = true;
+}
+
+// gzip, unless its quality is 0 ("gzip;q=0")
+void ESP8266WebServer::_parseAcceptEncodingHeader(const String& value) {
+  String options = value;
+  options.toLowerCase();
+  int gzip = options.indexOf(F("gzip"));
+  if (gzip == -1)
+    return;
+  int end = options.indexOf(',', gzip);
+  String params = options.substring(gzip + 4, end == -1 ? options.length() : end);
+  params.replace(" ", "");
+  _requestGzip = !params.startsWith(F(";q=")) || params.substring(3).toFloat() > 0;
+}
+
+bool ESP8266WebServer::_collectHeader(StringView headerName, StringView headerValue) {
+  uint32_t hash = _hashName(headerName, true);
   for (int i = 0; i < _headerKeysCount; i++) {
-    if (_currentHeaders[i].key.equalsIgnoreCase(headerName)) {
-            _currentHeaders[i].value=headerValue;
-            return true;
-        }
+    RequestHeader& header = _currentHeaders[i];
+    if (header.hash == hash && headerName.equalsIgnoreCase(header.key)) {
+      size_t value = _storeRequestData(headerValue);
+      if (value == (size_t) -1)
+        return false;
+      header.value = value;
+      header.valueLength = headerValue.length();
+      return true;
+    }
   }
   return false;
 }
 
-void ESP8266WebServer::_parseArguments(String data) {
-#ifdef DEBUG_ESP_HTTP_SERVER
-  DEBUG_OUTPUT.print("args: ");
-  DEBUG_OUTPUT.println(data);
-#endif
-  if (_currentArgs)
-    delete[] _currentArgs;
-  _currentArgs = 0;
-  if (data.length() == 0) {
-    _currentArgCount = 0;
-    _currentArgs = new RequestArgument[1];
-    return;
+// FNV-1a
+uint32_t ESP8266WebServer::_hashName(StringView name, bool ignoreCase) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < name.length(); ++i) {
+    char c = name[i];
+    if (ignoreCase && c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    hash = (hash ^ (uint8_t) c) * 16777619UL;
   }
-  _currentArgCount = 1;
+  return hash;
+}
 
-  for (int i = 0; i < (int)data.length(); ) {
-    i = data.indexOf('&', i);
-    if (i == -1)
-      break;
-    ++i;
-    ++_currentArgCount;
+// Forgets the previous request; a buffer grown for a large one is let go,
+// or shrunk back to what reserve() asked for.
+void ESP8266WebServer::_resetRequestData() {
+  _requestDataLength = 0;
+  _currentArgCount = 0;
+  if (_requestDataCapacity > HTTP_REQUEST_DATA_KEEP && _requestDataCapacity > _requestDataReserved) {
+    char* data = _requestDataReserved ? (char*) realloc(_requestData, _requestDataReserved) : nullptr;
+    if (data) {
+      _requestData = data;
+      _requestDataCapacity = _requestDataReserved;
+    } else {
+      free(_requestData);
+      _requestData = nullptr;
+      _requestDataCapacity = 0;
+    }
   }
-#ifdef DEBUG_ESP_HTTP_SERVER
-  DEBUG_OUTPUT.print("args count: ");
-  DEBUG_OUTPUT.println(_currentArgCount);
-#endif
+  for (int i = 0; i < _headerKeysCount; ++i)
+    _currentHeaders[i].valueLength = 0;
+}
 
-  _currentArgs = new RequestArgument[_currentArgCount+1];
-  int pos = 0;
-  int iarg;
-  for (iarg = 0; iarg < _currentArgCount;) {
-    int equal_sign_index = data.indexOf('=', pos);
-    int next_arg_index = data.indexOf('&', pos);
-#ifdef DEBUG_ESP_HTTP_SERVER
-    DEBUG_OUTPUT.print("pos ");
-    DEBUG_OUTPUT.print(pos);
-    DEBUG_OUTPUT.print("=@ ");
-    DEBUG_OUTPUT.print(equal_sign_index);
-    DEBUG_OUTPUT.print(" &@ ");
-    DEBUG_OUTPUT.println(next_arg_index);
-#endif
-    if ((equal_sign_index == -1) || ((equal_sign_index > next_arg_index) && (next_arg_index != -1))) {
-#ifdef DEBUG_ESP_HTTP_SERVER
-      DEBUG_OUTPUT.print("arg missing value: ");
-      DEBUG_OUTPUT.println(iarg);
-#endif
-      if (next_arg_index == -1)
-        break;
-      pos = next_arg_index + 1;
-      continue;
-    }
-    RequestArgument& arg = _currentArgs[iarg];
-    arg.key = urlDecode(data.substring(pos, equal_sign_index));
-    arg.value = urlDecode(data.substring(equal_sign_index + 1, next_arg_index));
-#ifdef DEBUG_ESP_HTTP_SERVER
-    DEBUG_OUTPUT.print("arg ");
-    DEBUG_OUTPUT.print(iarg);
-    DEBUG_OUTPUT.print(" key: ");
-    DEBUG_OUTPUT.print(arg.key);
-    DEBUG_OUTPUT.print(" value: ");
-    DEBUG_OUTPUT.println(arg.value);
-#endif
-    ++iarg;
-    if (next_arg_index == -1)
-      break;
-    pos = next_arg_index + 1;
+bool ESP8266WebServer::_reserveRequestData(size_t length) {
+  size_t needed = _requestDataLength + length;
+  if (needed <= _requestDataCapacity)
+    return true;
+  size_t capacity = _requestDataCapacity ? _requestDataCapacity : 128;
+  while (capacity < needed)
+    capacity *= 2;
+  char* data = (char*) realloc(_requestData, capacity);
+  if (!data)
+    return false;
+  _requestData = data;
+  _requestDataCapacity = capacity;
+  return true;
+}
+
+// Appends text to the request buffer, returns its offset or -1.
+size_t ESP8266WebServer::_storeRequestData(StringView text) {
+  if (!_reserveRequestData(text.length()))
+    return (size_t) -1;
+  size_t offset = _requestDataLength;
+  if (text.isProgmem())
+    memcpy_P(_requestData + offset, text.data(), text.length());
+  else
+    memcpy(_requestData + offset, text.data(), text.length());
+  _requestDataLength += text.length();
+  return offset;
+}
+
+// The upload reserve() kept, or a new one.
+bool ESP8266WebServer::_startUpload() {
+  if (!_currentUpload)
+    _currentUpload.reset(new HTTPUpload());
+  if (!_currentUpload)
+    return false;
+  _currentUpload->sink = nullptr;
+  return true;
+}
+
+// Done with the connection: a reserved upload stays, only what it held goes.
+void ESP8266WebServer::_endUpload() {
+  if (!_uploadReserved) {
+    _currentUpload.reset();
+  } else if (_currentUpload) {
+    _currentUpload->sink = nullptr;
+    _currentUpload->filename = String();
+    _currentUpload->name = String();
+    _currentUpload->type = String();
   }
-  _currentArgCount = iarg;
+}
+
+bool ESP8266WebServer::_addArgument(size_t key, size_t keyLength, size_t value, size_t valueLength) {
+  if (_currentArgCount == _currentArgCapacity) {
+    int capacity = _currentArgCapacity ? _currentArgCapacity * 2 : 8;
+    RequestArgument* args = (RequestArgument*) realloc(_currentArgs, capacity * sizeof(RequestArgument));
+    if (!args)
+      return false;
+    _currentArgs = args;
+    _currentArgCapacity = capacity;
+  }
+  RequestArgument& arg = _currentArgs[_currentArgCount++];
+  arg.hash = _hashName(_requestView(key, keyLength), false);
+  arg.key = key;
+  arg.keyLength = keyLength;
+  arg.value = value;
+  arg.valueLength = valueLength;
 #ifdef DEBUG_ESP_HTTP_SERVER
-  DEBUG_OUTPUT.print("args count: ");
-  DEBUG_OUTPUT.println(_currentArgCount);
+  DEBUG_OUTPUT.print("arg ");
+  DEBUG_OUTPUT.print(_currentArgCount - 1);
+  DEBUG_OUTPUT.print(" key: ");
+  DEBUG_OUTPUT.print(_requestView(key, keyLength).toString());
+  DEBUG_OUTPUT.print(" value: ");
+  DEBUG_OUTPUT.println(_requestView(value, valueLength).toString());
 #endif
+  return true;
+}
 
+// Adds the name=value pairs separated by '&' of the text at offset in the
+// request buffer, decoding them where they are. Pairs without '=' are
+// skipped.
+void ESP8266WebServer::_parseArguments(size_t offset, size_t length) {
+  size_t pos = 0;
+  while (pos < length) {
+    char* data = _requestData + offset;
+    char* end = (char*) memchr(data + pos, '&', length - pos);
+    size_t next = end ? end - data : length;
+    char* equal = (char*) memchr(data + pos, '=', next - pos);
+    if (equal) {
+      size_t keyLength = _urlDecodeInPlace(data + pos, equal - (data + pos));
+      size_t value = equal + 1 - data;
+      size_t valueLength = _urlDecodeInPlace(equal + 1, next - value);
+      if (!_addArgument(offset + pos, keyLength, offset + value, valueLength))
+        return;
+    }
+    pos = next + 1;
+  }
 }
 
-void ESP8266WebServer::_uploadWriteByte(uint8_t b){
-  if (_currentUpload->currentSize == HTTP_UPLOAD_BUFLEN){
-    if(_currentHandler && _currentHandler->canUpload(_currentUri))
-      _currentHandler->upload(*this, _currentUri, *_currentUpload);
-    _currentUpload->totalSize += _currentUpload->currentSize;
-    _currentUpload->currentSize = 0;
+bool ESP8266WebServer::_uploadWriteBytes(const uint8_t* data, size_t len){
+  if (_currentUpload->sink) {
+    if (!len)
+      return true;
+    _currentUpload->totalSize += len;
+    return _currentUpload->sink(data, len);
   }
-  _currentUpload->buf[_currentUpload->currentSize++] = b;
+  while (len) {
+    if (_currentUpload->currentSize == HTTP_UPLOAD_BUFLEN){
+      if(_currentHandler && _currentHandler->canUpload(_currentUri))
+        _currentHandler->upload(*this, _currentUri, *_currentUpload);
+      _currentUpload->totalSize += _currentUpload->currentSize;
+      _currentUpload->currentSize = 0;
+    }
+    size_t space = HTTP_UPLOAD_BUFLEN - _currentUpload->currentSize;
+    size_t copy = (len < space) ? len : space;
+    memcpy(_currentUpload->buf + _currentUpload->currentSize, data, copy);
+    _currentUpload->currentSize += copy;
+    data += copy;
+    len -= copy;
+  }
+  return true;
 }
 
-uint8_t ESP8266WebServer::_uploadReadByte(WiFiClient& client){
-  int res = client.read();
-  if(res == -1){
-    while(!client.available() && client.connected())
-      yield();
-    res = client.read();
+// Moves the contents of a file part into the upload buffer, block by block,
+// up to and including the "\r\n--boundary" delimiter which ends it.
+// Received data is scanned in place, so nothing past the delimiter is read.
+// Returns false if the client went away or stopped sending, or the sink
+// gave up.
+bool ESP8266WebServer::_uploadReadPart(WiFiClient& client, const String& boundary){
+  String delimiter = "\r\n--" + boundary;
+  size_t matched = 0;  // delimiter bytes seen at the end of the data so far
+  unsigned long lastData = millis();
+  while (true) {
+    const char* buf = client.peekBuffer();
+    size_t len = buf ? client.peekAvailable() : 0;
+    char byte;
+    bool consumed = false;
+    if (!len) {
+      int c = client.available() ? client.read() : -1;
+      if (c < 0) {
+        if (!client.connected() || millis() - lastData > HTTP_MAX_POST_WAIT)
+          return false;
+        if (_currentUpload->sink && !_currentUpload->sink(nullptr, 0))
+          return false;
+        yield();
+        continue;
+      }
+      // no direct access to the received data, take it one byte at a time
+      byte = (char) c;
+      buf = &byte;
+      len = 1;
+      consumed = true;
+    }
+    lastData = millis();
+
+    size_t used = 0;
+    size_t runStart = 0;
+    bool found = false;
+    while (used < len) {
+      if (buf[used] == delimiter[matched]) {
+        if (matched == 0 && !_uploadWriteBytes((const uint8_t*) buf + runStart, used - runStart))
+          return false;
+        ++used;
+        runStart = used;
+        if (++matched == delimiter.length()) {
+          found = true;
+          break;
+        }
+      } else if (matched) {
+        // what looked like the delimiter was data, look at this byte again
+        if (!_uploadWriteBytes((const uint8_t*) delimiter.c_str(), matched))
+          return false;
+        matched = 0;
+      } else {
+        ++used;
+      }
+    }
+    bool written = _uploadWriteBytes((const uint8_t*) buf + runStart, used - runStart);
+    if (!consumed)
+      client.peekConsume(used);
+    if (!written)
+      return false;
+    if (found)
+      return true;
   }
-  return (uint8_t)res;
 }
 
 bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t len){
@@ -383,8 +644,7 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
   client.readStringUntil('\n');
   //start reading the form
   if (line == ("--"+boundary)){
-    RequestArgument* postArgs = new RequestArgument[32];
-    int postArgsLen = 0;
+    int queryArgs = _currentArgCount;
     while(1){
       String argName;
       String argValue;
@@ -445,9 +705,11 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
             DEBUG_OUTPUT.println();
 #endif
 
-            RequestArgument& arg = postArgs[postArgsLen++];
-            arg.key = argName;
-            arg.value = argValue;
+            size_t key = _storeRequestData(argName);
+            size_t value = _storeRequestData(argValue);
+            if (key == (size_t) -1 || value == (size_t) -1 ||
+                !_addArgument(key, argName.length(), value, argValue.length()))
+              return false;
 
             if (line == ("--"+boundary+"--")){
 #ifdef DEBUG_ESP_HTTP_SERVER
@@ -456,7 +718,8 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
               break;
             }
           } else {
-            _currentUpload.reset(new HTTPUpload());
+            if (!_startUpload())
+              return false;
             _currentUpload->status = UPLOAD_FILE_START;
             _currentUpload->name = argName;
             _currentUpload->filename = argFilename;
@@ -472,102 +735,38 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
             if(_currentHandler && _currentHandler->canUpload(_currentUri))
               _currentHandler->upload(*this, _currentUri, *_currentUpload);
             _currentUpload->status = UPLOAD_FILE_WRITE;
-            uint8_t argByte = _uploadReadByte(client);
-readfile:
-            while(argByte != 0x0D){
-              if (!client.connected()) return _parseFormUploadAborted();
-              _uploadWriteByte(argByte);
-              argByte = _uploadReadByte(client);
-            }
+            if (!_uploadReadPart(client, boundary))
+              return _parseFormUploadAborted();
 
-            argByte = _uploadReadByte(client);
-            if (!client.connected()) return _parseFormUploadAborted();
-            if (argByte == 0x0A){
-              argByte = _uploadReadByte(client);
-              if (!client.connected()) return _parseFormUploadAborted();
-              if ((char)argByte != '-'){
-                //continue reading the file
-                _uploadWriteByte(0x0D);
-                _uploadWriteByte(0x0A);
-                goto readfile;
-              } else {
-                argByte = _uploadReadByte(client);
-                if (!client.connected()) return _parseFormUploadAborted();
-                if ((char)argByte != '-'){
-                  //continue reading the file
-                  _uploadWriteByte(0x0D);
-                  _uploadWriteByte(0x0A);
-                  _uploadWriteByte((uint8_t)('-'));
-                  goto readfile;
-                }
-              }
-
-              uint8_t endBuf[boundary.length()];
-              client.readBytes(endBuf, boundary.length());
-
-              if (strstr((const char*)endBuf, boundary.c_str()) != NULL){
-                if(_currentHandler && _currentHandler->canUpload(_currentUri))
-                  _currentHandler->upload(*this, _currentUri, *_currentUpload);
-                _currentUpload->totalSize += _currentUpload->currentSize;
-                _currentUpload->status = UPLOAD_FILE_END;
-                if(_currentHandler && _currentHandler->canUpload(_currentUri))
-                  _currentHandler->upload(*this, _currentUri, *_currentUpload);
+            if(!_currentUpload->sink && _currentHandler && _currentHandler->canUpload(_currentUri))
+              _currentHandler->upload(*this, _currentUri, *_currentUpload);
+            _currentUpload->totalSize += _currentUpload->currentSize;
+            _currentUpload->status = UPLOAD_FILE_END;
+            if(_currentHandler && _currentHandler->canUpload(_currentUri))
+              _currentHandler->upload(*this, _currentUri, *_currentUpload);
 #ifdef DEBUG_ESP_HTTP_SERVER
-                DEBUG_OUTPUT.print("End File: ");
-                DEBUG_OUTPUT.print(_currentUpload->filename);
-                DEBUG_OUTPUT.print(" Type: ");
-                DEBUG_OUTPUT.print(_currentUpload->type);
-                DEBUG_OUTPUT.print(" Size: ");
-                DEBUG_OUTPUT.println(_currentUpload->totalSize);
+            DEBUG_OUTPUT.print("End File: ");
+            DEBUG_OUTPUT.print(_currentUpload->filename);
+            DEBUG_OUTPUT.print(" Type: ");
+            DEBUG_OUTPUT.print(_currentUpload->type);
+            DEBUG_OUTPUT.print(" Size: ");
+            DEBUG_OUTPUT.println(_currentUpload->totalSize);
 #endif
-                line = client.readStringUntil(0x0D);
-                client.readStringUntil(0x0A);
-                if (line == "--"){
+            line = client.readStringUntil(0x0D);
+            client.readStringUntil(0x0A);
+            if (line == "--"){
 #ifdef DEBUG_ESP_HTTP_SERVER
-                  DEBUG_OUTPUT.println("Done Parsing POST");
+              DEBUG_OUTPUT.println("Done Parsing POST");
 #endif
-                  break;
-                }
-                continue;
-              } else {
-                _uploadWriteByte(0x0D);
-                _uploadWriteByte(0x0A);
-                _uploadWriteByte((uint8_t)('-'));
-                _uploadWriteByte((uint8_t)('-'));
-                uint32_t i = 0;
-                while(i < boundary.length()){
-                  _uploadWriteByte(endBuf[i++]);
-                }
-                argByte = _uploadReadByte(client);
-                goto readfile;
-              }
-            } else {
-              _uploadWriteByte(0x0D);
-              goto readfile;
+              break;
             }
-            break;
           }
         }
       }
     }
 
-    int iarg;
-    int totalArgs = ((32 - postArgsLen) < _currentArgCount)?(32 - postArgsLen):_currentArgCount;
-    for (iarg = 0; iarg < totalArgs; iarg++){
-      RequestArgument& arg = postArgs[postArgsLen++];
-      arg.key = _currentArgs[iarg].key;
-      arg.value = _currentArgs[iarg].value;
-    }
-    if (_currentArgs) delete[] _currentArgs;
-    _currentArgs = new RequestArgument[postArgsLen];
-    for (iarg = 0; iarg < postArgsLen; iarg++){
-      RequestArgument& arg = _currentArgs[iarg];
-      arg.key = postArgs[iarg].key;
-      arg.value = postArgs[iarg].value;
-    }
-    _currentArgCount = iarg;
-    if (postArgs) 
-      delete[] postArgs;
+    // the form arguments come before those of the query
+    std::rotate(_currentArgs, _currentArgs + queryArgs, _currentArgs + _currentArgCount);
     return true;
   }
 #ifdef DEBUG_ESP_HTTP_SERVER
@@ -577,37 +776,58 @@ readfile:
   return false;
 }
 
-String ESP8266WebServer::urlDecode(const String& text)
+static int hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+String ESP8266WebServer::urlDecode(StringView text)
 {
-	String decoded = "";
-	char temp[] = "0x00";
+	String decoded;
 	unsigned int len = text.length();
+	// decoding only ever shortens the text
+	decoded.reserve(len);
 	unsigned int i = 0;
 	while (i < len)
 	{
-		char decodedChar;
-		char encodedChar = text.charAt(i++);
-		if ((encodedChar == '%') && (i + 1 < len))
+		char decodedChar = text[i++];
+		if (decodedChar == '%' && i + 1 < len && hexValue(text[i]) >= 0 && hexValue(text[i + 1]) >= 0)
 		{
-			temp[2] = text.charAt(i++);
-			temp[3] = text.charAt(i++);
-
-			decodedChar = strtol(temp, NULL, 16);
+			decodedChar = (hexValue(text[i]) << 4) | hexValue(text[i + 1]);
+			i += 2;
 		}
-		else {
-			if (encodedChar == '+')
-			{
-				decodedChar = ' ';
-			}
-			else {
-				decodedChar = encodedChar;  // normal ascii char
-			}
+		else if (decodedChar == '+')
+		{
+			decodedChar = ' ';
 		}
 		decoded += decodedChar;
 	}
 	return decoded;
 }
 
+// as urlDecode(), writing over the text; returns the decoded length
+size_t ESP8266WebServer::_urlDecodeInPlace(char* text, size_t length)
+{
+  size_t out = 0;
+  size_t i = 0;
+  while (i < length) {
+    char c = text[i++];
+    if (c == '%' && i + 1 < length && hexValue(text[i]) >= 0 && hexValue(text[i + 1]) >= 0) {
+      c = (hexValue(text[i]) << 4) | hexValue(text[i + 1]);
+      i += 2;
+    } else if (c == '+') {
+      c = ' ';
+    }
+    text[out++] = c;
+  }
+  return out;
+}
+
 bool ESP8266WebServer::_parseFormUploadAborted(){
   _currentUpload->status = UPLOAD_FILE_ABORTED;
   if(_currentHandler && _currentHandler->canUpload(_currentUri))
@@ -0,0 +1,404 @@
+/*
+  WebSocketServer.cpp - WebSocket endpoint for ESP8266WebServer
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include <base64.h>
+#include <SHA1Builder.h>
+#include "WebSocketServer.h"
+
+enum {
+  WS_OP_CONTINUATION = 0x0,
+  WS_OP_TEXT         = 0x1,
+  WS_OP_BINARY       = 0x2,
+  WS_OP_CLOSE        = 0x8,
+  WS_OP_PING         = 0x9,
+  WS_OP_PONG         = 0xa,
+};
+
+#define WS_CLOSE_PROTOCOL_ERROR 1002
+
+static const char WS_GUID[] PROGMEM = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+WebSocketServer::WebSocketServer(const String& uri)
+: _uri(uri)
+{
+  for (uint8_t i = 0; i < WEBSOCKET_MAX_CLIENTS; ++i)
+    _connections[i] = nullptr;
+}
+
+WebSocketServer::~WebSocketServer() {
+  for (uint8_t i = 0; i < WEBSOCKET_MAX_CLIENTS; ++i) {
+    if (_connections[i]) {
+      _connections[i]->client.stop();
+      delete _connections[i];
+    }
+  }
+}
+
+bool WebSocketServer::canHandle(HTTPMethod method, String uri) {
+  return method == HTTP_GET && uri == _uri;
+}
+
+bool WebSocketServer::handle(ESP8266WebServer& server, HTTPMethod requestMethod, String requestUri) {
+  if (!canHandle(requestMethod, requestUri))
+    return false;
+
+  String key = server.header(F("Sec-WebSocket-Key"));
+  if (!server.header(F("Upgrade")).equalsIgnoreCase(F("websocket")) || !key.length()) {
+    server.send(400, "text/plain", F("WebSocket upgrade expected"));
+    return true;
+  }
+  if (server.header(F("Sec-WebSocket-Version")) != F("13")) {
+    server.sendHeader(F("Sec-WebSocket-Version"), F("13"));
+    server.send(426, "text/plain", "");
+    return true;
+  }
+  uint8_t num = 0;
+  while (num < WEBSOCKET_MAX_CLIENTS && _connections[num])
+    ++num;
+  if (num == WEBSOCKET_MAX_CLIENTS) {
+    server.send(503, "text/plain", F("Too many WebSocket clients"));
+    return true;
+  }
+  WiFiClient client = server.detachClient();
+  if (!client) {
+    // the server does not give its connections away (ESP8266WebServerSecure)
+    server.send(501, "text/plain", "");
+    return true;
+  }
+
+  SHA1Builder sha1;
+  sha1.begin();
+  sha1.add(key);
+  sha1.add(String(FPSTR(WS_GUID)));
+  sha1.calculate();
+  uint8_t hash[20];
+  sha1.getBytes(hash);
+
+  String response = F("HTTP/1.1 101 Switching Protocols\r\n"
+                      "Upgrade: websocket\r\n"
+                      "Connection: Upgrade\r\n"
+                      "Sec-WebSocket-Accept: ");
+  response += base64::encode(hash, sizeof(hash), false);
+  response += F("\r\n\r\n");
+  client.setNoDelay(true);
+  if (client.write((const uint8_t*) response.c_str(), response.length()) != response.length()) {
+    client.stop();
+    return true;
+  }
+
+  Connection* conn = new Connection;
+  conn->client = client;
+  _connections[num] = conn;
+  if (_handler) {
+    WebSocketDataInfo info = { 0, true };
+    _handler(num, WS_CONNECTED, nullptr, 0, info);
+  }
+  return true;
+}
+
+void WebSocketServer::loop() {
+  for (uint8_t i = 0; i < WEBSOCKET_MAX_CLIENTS; ++i) {
+    if (!_connections[i])
+      continue;
+    if (!_connections[i]->closed)
+      _receive(i);
+    if (_connections[i]->closed || !_connections[i]->client.connected())
+      _release(i);
+  }
+}
+
+// Frame headers are gathered a byte at a time (they may be split between two
+// segments), payloads are unmasked where they are and passed on directly.
+void WebSocketServer::_receive(uint8_t num) {
+  Connection& conn = *_connections[num];
+  size_t available;
+  while (!conn.closed && (available = conn.client.peekAvailable()) > 0) {
+    // the segment is ours until consumed, so it can be written to
+    uint8_t* data = (uint8_t*) conn.client.peekBuffer();
+
+    if (!conn.inPayload) {
+      size_t used = 0;
+      bool complete = false;
+      while (used < available && !complete) {
+        conn.header[conn.headerLen++] = data[used++];
+        complete = _parseHeader(conn);
+      }
+      conn.client.peekConsume(used);
+      if (!complete)
+        continue;
+      if (!conn.inPayload) {
+        _close(num, WS_CLOSE_PROTOCOL_ERROR);
+        return;
+      }
+      if (conn.remaining)
+        continue;
+      // empty payload
+      conn.inPayload = false;
+      if (conn.opcode >= WS_OP_CLOSE)
+        _control(num);
+      else
+        _data(num, nullptr, 0);
+      continue;
+    }
+
+    size_t length = std::min(available, conn.remaining);
+    _unmask(conn, data, length);
+    conn.remaining -= length;
+    if (!conn.remaining)
+      conn.inPayload = false;
+    if (conn.opcode >= WS_OP_CLOSE) {
+      memcpy(conn.control + conn.controlLen, data, length);
+      conn.controlLen += length;
+      conn.client.peekConsume(length);
+      if (!conn.remaining)
+        _control(num);
+    } else {
+      _data(num, data, length);
+      conn.client.peekConsume(length);
+    }
+  }
+}
+
+// Returns true once conn.header holds a whole frame header, which is then
+// checked: conn.inPayload is set if it is acceptable, left false if not.
+bool WebSocketServer::_parseHeader(Connection& conn) {
+  if (conn.headerLen < 2)
+    return false;
+  uint8_t length7 = conn.header[1] & 0x7f;
+  size_t size = 2 + (length7 == 126 ? 2 : length7 == 127 ? 8 : 0) + ((conn.header[1] & 0x80) ? 4 : 0);
+  if (conn.headerLen < size)
+    return false;
+  conn.headerLen = 0;
+
+  // no extensions were negotiated, and client frames have to be masked
+  if ((conn.header[0] & 0x70) || !(conn.header[1] & 0x80))
+    return true;
+  conn.opcode = conn.header[0] & 0x0f;
+  conn.fin = conn.header[0] & 0x80;
+
+  uint8_t pos = 2;
+  size_t length = length7;
+  if (length7 == 126) {
+    length = (conn.header[2] << 8) | conn.header[3];
+    pos = 4;
+  } else if (length7 == 127) {
+    // more than 4GB will not do
+    if (conn.header[2] | conn.header[3] | conn.header[4] | conn.header[5])
+      return true;
+    length = ((size_t) conn.header[6] << 24) | ((size_t) conn.header[7] << 16) | (conn.header[8] << 8) | conn.header[9];
+    pos = 10;
+  }
+  memcpy(conn.mask, conn.header + pos, 4);
+  conn.maskIndex = 0;
+
+  switch (conn.opcode) {
+  case WS_OP_CONTINUATION:
+    if (!conn.message)
+      return true;
+    break;
+  case WS_OP_TEXT:
+  case WS_OP_BINARY:
+    if (conn.message)
+      return true;
+    conn.message = conn.opcode == WS_OP_TEXT ? WS_TEXT : WS_BINARY;
+    conn.messageIndex = 0;
+    break;
+  case WS_OP_CLOSE:
+  case WS_OP_PING:
+  case WS_OP_PONG:
+    if (!conn.fin || length > sizeof(conn.control))
+      return true;
+    conn.controlLen = 0;
+    break;
+  default:
+    return true;
+  }
+  conn.remaining = length;
+  conn.inPayload = true;
+  return true;
+}
+
+void WebSocketServer::_data(uint8_t num, uint8_t* data, size_t length) {
+  Connection& conn = *_connections[num];
+  WebSocketDataInfo info = { conn.messageIndex, conn.fin && !conn.inPayload };
+  WebSocketEvent event = (WebSocketEvent) conn.message;
+  conn.messageIndex += length;
+  if (info.final)
+    conn.message = 0;
+  if (_handler && (length || info.final))
+    _handler(num, event, data, length, info);
+}
+
+void WebSocketServer::_control(uint8_t num) {
+  Connection& conn = *_connections[num];
+  switch (conn.opcode) {
+  case WS_OP_CLOSE: {
+    // answered with the code it came with
+    uint16_t code = 1000;
+    if (conn.controlLen >= 2)
+      code = (conn.control[0] << 8) | conn.control[1];
+    _close(num, code);
+    break;
+  }
+  case WS_OP_PING:
+    _send(num, WS_OP_PONG, conn.control, conn.controlLen);
+    break;
+  case WS_OP_PONG:
+    if (_handler) {
+      WebSocketDataInfo info = { 0, true };
+      _handler(num, WS_PONG, conn.control, conn.controlLen, info);
+    }
+    break;
+  }
+}
+
+// The connection is stopped by loop(), so that a handler calling
+// disconnect() keeps the data it was given.
+void WebSocketServer::_close(uint8_t num, uint16_t code) {
+  Connection* conn = _connections[num];
+  if (!conn || conn->closed)
+    return;
+  uint8_t payload[2] = { (uint8_t) (code >> 8), (uint8_t) code };
+  _send(num, WS_OP_CLOSE, payload, sizeof(payload));
+  conn->closed = true;
+}
+
+void WebSocketServer::_release(uint8_t num) {
+  Connection* conn = _connections[num];
+  conn->client.stop();
+  delete conn;
+  _connections[num] = nullptr;
+  if (_handler) {
+    WebSocketDataInfo info = { 0, true };
+    _handler(num, WS_DISCONNECTED, nullptr, 0, info);
+  }
+}
+
+size_t WebSocketServer::_frameHeader(uint8_t* header, uint8_t opcode, size_t length) {
+  header[0] = 0x80 | opcode;
+  if (length < 126) {
+    header[1] = length;
+    return 2;
+  }
+  if (length <= 0xffff) {
+    header[1] = 126;
+    header[2] = length >> 8;
+    header[3] = length;
+    return 4;
+  }
+  header[1] = 127;
+  memset(header + 2, 0, 4);
+  header[6] = length >> 24;
+  header[7] = length >> 16;
+  header[8] = length >> 8;
+  header[9] = length;
+  return 10;
+}
+
+bool WebSocketServer::_send(uint8_t num, uint8_t opcode, const uint8_t* data, size_t length) {
+  Connection* conn = num < WEBSOCKET_MAX_CLIENTS ? _connections[num] : nullptr;
+  if (!conn || conn->closed)
+    return false;
+  uint8_t header[10];
+  size_t headerLen = _frameHeader(header, opcode, length);
+  WiFiClient::IOVec parts[] = { { header, headerLen }, { data, length } };
+  return conn->client.writev(parts, length ? 2 : 1) == headerLen + length;
+}
+
+size_t WebSocketServer::_broadcast(uint8_t opcode, const uint8_t* data, size_t length) {
+  uint8_t header[10];
+  size_t headerLen = _frameHeader(header, opcode, length);
+  WiFiClient::IOVec parts[] = { { header, headerLen }, { data, length } };
+  size_t sent = 0;
+  for (uint8_t i = 0; i < WEBSOCKET_MAX_CLIENTS; ++i) {
+    Connection* conn = _connections[i];
+    if (!conn || conn->closed)
+      continue;
+    if (conn->client.writev(parts, length ? 2 : 1) == headerLen + length)
+      ++sent;
+  }
+  return sent;
+}
+
+// XORs with the mask a word at a time where data is aligned; the applied
+// mask is rotated to the position of the first byte of the word.
+void WebSocketServer::_unmask(Connection& conn, uint8_t* data, size_t length) {
+  size_t i = 0;
+  uint8_t k = conn.maskIndex;
+  while (i < length && ((uintptr_t) (data + i) & 3)) {
+    data[i++] ^= conn.mask[k];
+    k = (k + 1) & 3;
+  }
+  if (length - i >= 4) {
+    uint8_t rotated[4] = { conn.mask[k], conn.mask[(k + 1) & 3], conn.mask[(k + 2) & 3], conn.mask[(k + 3) & 3] };
+    uint32_t mask;
+    memcpy(&mask, rotated, 4);
+    for (; i + 4 <= length; i += 4)
+      *(uint32_t*) (data + i) ^= mask;
+  }
+  while (i < length) {
+    data[i++] ^= conn.mask[k];
+    k = (k + 1) & 3;
+  }
+  conn.maskIndex = k;
+}
+
+bool WebSocketServer::sendText(uint8_t num, const char* data, size_t length) {
+  return _send(num, WS_OP_TEXT, (const uint8_t*) data, length);
+}
+
+bool WebSocketServer::sendBinary(uint8_t num, const uint8_t* data, size_t length) {
+  return _send(num, WS_OP_BINARY, data, length);
+}
+
+size_t WebSocketServer::broadcastText(const char* data, size_t length) {
+  return _broadcast(WS_OP_TEXT, (const uint8_t*) data, length);
+}
+
+size_t WebSocketServer::broadcastBinary(const uint8_t* data, size_t length) {
+  return _broadcast(WS_OP_BINARY, data, length);
+}
+
+bool WebSocketServer::ping(uint8_t num) {
+  return _send(num, WS_OP_PING, nullptr, 0);
+}
+
+void WebSocketServer::disconnect(uint8_t num, uint16_t code) {
+  if (num < WEBSOCKET_MAX_CLIENTS)
+    _close(num, code);
+}
+
+bool WebSocketServer::connected(uint8_t num) {
+  return num < WEBSOCKET_MAX_CLIENTS && _connections[num] && !_connections[num]->closed
+      && _connections[num]->client.connected();
+}
+
+size_t WebSocketServer::connectedClients() {
+  size_t count = 0;
+  for (uint8_t i = 0; i < WEBSOCKET_MAX_CLIENTS; ++i)
+    if (connected(i))
+      ++count;
+  return count;
+}
+
+IPAddress WebSocketServer::remoteIP(uint8_t num) {
+  if (!connected(num))
+    return IPAddress();
+  return _connections[num]->client.remoteIP();
+}
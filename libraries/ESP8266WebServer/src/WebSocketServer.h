@@ -0,0 +1,110 @@
+/*
+  WebSocketServer.h - WebSocket endpoint for ESP8266WebServer
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef WEBSOCKETSERVER_H
+#define WEBSOCKETSERVER_H
+
+#include "ESP8266WebServer.h"
+
+#ifndef WEBSOCKET_MAX_CLIENTS
+#define WEBSOCKET_MAX_CLIENTS 4
+#endif
+
+enum WebSocketEvent { WS_CONNECTED, WS_DISCONNECTED, WS_TEXT, WS_BINARY, WS_PONG };
+
+// where the data given to the event handler lies in its message
+struct WebSocketDataInfo {
+  size_t index;   // message bytes before this piece
+  bool   final;   // last piece of the message
+};
+
+// A WebSocket (RFC 6455) endpoint, added to a server with addHandler(): a
+// GET request for its URI asking for an upgrade is answered with 101 and the
+// connection is taken over from the server, which goes on serving the other
+// requests. loop() has to be called as often as the server's handleClient().
+//
+// Received data is unmasked in place in the network buffers and handed to the
+// event handler from there, a message in as many pieces as it arrives in
+// (fragmented messages too), so messages of any size take no memory of their
+// own; collect the pieces where a whole message is needed. Pieces are only
+// valid during the call.
+// Frames are sent from the caller's buffer, a broadcast builds its frame
+// header once and queues the same payload to every client.
+class WebSocketServer : public RequestHandler {
+public:
+  typedef std::function<void(uint8_t num, WebSocketEvent event, uint8_t* data, size_t length, const WebSocketDataInfo& info)> TEventHandler;
+
+  WebSocketServer(const String& uri);
+  ~WebSocketServer();
+
+  void onEvent(TEventHandler handler) { _handler = handler; }
+  void loop();
+
+  bool sendText(uint8_t num, const char* data, size_t length);
+  bool sendText(uint8_t num, const String& text) { return sendText(num, text.c_str(), text.length()); }
+  bool sendBinary(uint8_t num, const uint8_t* data, size_t length);
+  // return the number of clients the message went to
+  size_t broadcastText(const char* data, size_t length);
+  size_t broadcastText(const String& text) { return broadcastText(text.c_str(), text.length()); }
+  size_t broadcastBinary(const uint8_t* data, size_t length);
+  bool ping(uint8_t num);
+  // sends a close frame with code and drops the connection
+  void disconnect(uint8_t num, uint16_t code = 1000);
+
+  bool connected(uint8_t num);
+  size_t connectedClients();
+  IPAddress remoteIP(uint8_t num);
+
+  bool canHandle(HTTPMethod method, String uri) override;
+  bool handle(ESP8266WebServer& server, HTTPMethod requestMethod, String requestUri) override;
+
+protected:
+  struct Connection {
+    WiFiClient client;
+    bool     closed = false;     // disconnected, released by loop()
+    uint8_t  header[14];
+    uint8_t  headerLen = 0;
+    bool     inPayload = false;  // header done, remaining bytes of payload to come
+    uint8_t  opcode = 0;         // of the current frame
+    bool     fin = false;
+    uint8_t  mask[4];
+    uint8_t  maskIndex = 0;      // of the next payload byte
+    size_t   remaining = 0;
+    uint8_t  message = 0;        // WS_TEXT or WS_BINARY while a message is received, else 0
+    size_t   messageIndex = 0;
+    uint8_t  control[125];       // payload of a control frame
+    uint8_t  controlLen = 0;
+  };
+
+  void _receive(uint8_t num);
+  bool _parseHeader(Connection& conn);
+  void _data(uint8_t num, uint8_t* data, size_t length);
+  void _control(uint8_t num);
+  void _close(uint8_t num, uint16_t code);
+  void _release(uint8_t num);
+  bool _send(uint8_t num, uint8_t opcode, const uint8_t* data, size_t length);
+  size_t _broadcast(uint8_t opcode, const uint8_t* data, size_t length);
+  static size_t _frameHeader(uint8_t* header, uint8_t opcode, size_t length);
+  static void _unmask(Connection& conn, uint8_t* data, size_t length);
+
+  String        _uri;
+  TEventHandler _handler;
+  Connection*   _connections[WEBSOCKET_MAX_CLIENTS];
+};
+
+#endif //WEBSOCKETSERVER_H
@@ -0,0 +1,111 @@
+#ifndef __KEYWORDTABLE_H__
+#define __KEYWORDTABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pgmspace.h>
+#include <StringView.h>
+
+// Perfect hash tables of fixed keywords (file extensions, methods, header
+// names), worked out by the compiler: a seed is searched for that gives
+// each keyword a slot of its own, so a lookup is one hash, one read of the
+// table in flash and one compare with the keyword found there. The hash
+// ignores case; the compare decides whether case matters.
+namespace keyword
+{
+
+static const uint8_t NONE = 0xff;
+
+template<size_t SLOTS>
+struct Table
+{
+  uint32_t seed;
+  uint8_t index[SLOTS];   // keyword in each slot, NONE for none
+};
+
+// FNV-1a of the lower case characters, from a seeded basis
+constexpr uint32_t step(uint32_t h, char c)
+{
+  return (h ^ (uint8_t) ((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c)) * 16777619UL;
+}
+
+constexpr uint32_t basis(uint32_t seed)
+{
+  return 2166136261UL ^ (seed * 0x9e3779b9UL);
+}
+
+constexpr uint32_t finish(uint32_t h)
+{
+  return h ^ (h >> 15);
+}
+
+constexpr uint32_t hashFrom(const char* s, uint32_t h)
+{
+  return *s ? hashFrom(s + 1, step(h, *s)) : h;
+}
+
+constexpr uint32_t hash(const char* s, uint32_t seed)
+{
+  return finish(hashFrom(s, basis(seed)));
+}
+
+inline uint32_t hash(const StringView& s, uint32_t seed)
+{
+  uint32_t h = basis(seed);
+  for (size_t i = 0; i < s.length(); ++i)
+    h = step(h, s[i]);
+  return finish(h);
+}
+
+// building the table, in C++11 constexpr style
+
+constexpr bool clashes(const char* const* keys, size_t i, size_t j, uint32_t seed, uint32_t mask)
+{
+  return j < i && (((hash(keys[i], seed) ^ hash(keys[j], seed)) & mask) == 0 || clashes(keys, i, j + 1, seed, mask));
+}
+
+constexpr bool perfect(const char* const* keys, size_t n, uint32_t seed, uint32_t mask, size_t i = 0)
+{
+  return i == n || (!clashes(keys, i, 0, seed, mask) && perfect(keys, n, seed, mask, i + 1));
+}
+
+constexpr uint32_t findSeed(const char* const* keys, size_t n, uint32_t mask, uint32_t seed = 0)
+{
+  return perfect(keys, n, seed, mask) ? seed : findSeed(keys, n, mask, seed + 1);
+}
+
+constexpr uint8_t owner(const char* const* keys, size_t n, uint32_t seed, uint32_t mask, size_t slot, size_t i = 0)
+{
+  return i == n ? NONE : (hash(keys[i], seed) & mask) == slot ? (uint8_t) i : owner(keys, n, seed, mask, slot, i + 1);
+}
+
+template<size_t... I> struct Indices {};
+template<size_t N, size_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template<size_t... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+template<size_t SLOTS, size_t... I>
+constexpr Table<SLOTS> makeTable(const char* const* keys, size_t n, uint32_t seed, Indices<I...>)
+{
+  return Table<SLOTS>{ seed, { owner(keys, n, seed, SLOTS - 1, I)... } };
+}
+
+// SLOTS a power of 2, at least n and better 2 or 3 times that
+template<size_t SLOTS>
+constexpr Table<SLOTS> make(const char* const* keys, size_t n)
+{
+  static_assert((SLOTS & (SLOTS - 1)) == 0 && SLOTS <= NONE, "SLOTS must be a power of 2 below 256");
+  return makeTable<SLOTS>(keys, n, findSeed(keys, n, SLOTS - 1), typename MakeIndices<SLOTS>::type());
+}
+
+// the only keyword s can be, NONE if there is none; it is still to be
+// compared with s
+template<size_t SLOTS>
+uint8_t find(const Table<SLOTS>& table, const StringView& s)
+{
+  uint32_t h = hash(s, pgm_read_dword(&table.seed));
+  return pgm_read_byte(&table.index[h & (SLOTS - 1)]);
+}
+
+}
+
+#endif
@@ -57,6 +57,10 @@ protected:
     HTTPMethod _method;
 };
 
+#ifndef STATIC_HANDLER_CACHE_SIZE
+#define STATIC_HANDLER_CACHE_SIZE 8 // request URIs whose resolved file is remembered, 0 to disable
+#endif
+
 class StaticRequestHandler : public RequestHandler {
 public:
     StaticRequestHandler(FS& fs, const char* path, const char* uri, const char* cache_header)
@@ -64,6 +68,7 @@ public:
     , _uri(uri)
     , _path(path)
     , _cache_header(cache_header)
+    , _cacheNext(0)
     {
         _isFile = fs.exists(path);
         DEBUGV("StaticRequestHandler: path=%s uri=%s isFile=%d, cache_header=%s\r\n", path, uri, _isFile, cache_header);
@@ -86,20 +91,113 @@ public:
 
         DEBUGV("StaticRequestHandler::handle: request=%s _uri=%s\r\n", requestUri.c_str(), _uri.c_str());
 
+        // A remembered resolution is used as long as its file can be opened,
+        // which spares the exists() lookups and the MIME table scan.
+        // A client still holding a remembered ETag gets 304 without the
+        // file being opened at all.
+        File f;
+        CacheEntry* entry = _cacheLookup(requestUri);
+        if (entry && server._eTagEnabled && entry->eTag.length() &&
+            server.header(F("If-None-Match")) == entry->eTag) {
+            _sendNotModified(server, *entry);
+            return true;
+        }
+        if (entry) {
+            f = _fs.open(entry->path, "r");
+            if (!f) {
+                entry->uri = String();
+                entry = nullptr;
+            }
+        }
+
+        CacheEntry resolved;
+        if (!entry) {
+            if (!_resolve(requestUri, resolved))
+                return false;
+            f = _fs.open(resolved.path, "r");
+            if (!f)
+                return false;
+            resolved.size = f.size();
+            entry = _cacheStore(resolved);
+            if (!entry)
+                entry = &resolved;
+        }
+
+        if (server._eTagEnabled) {
+            if (!entry->eTag.length())
+                entry->eTag = _makeETag(server, f, entry->path);
+            if (entry->eTag.length() && server.header(F("If-None-Match")) == entry->eTag) {
+                f.close();
+                _sendNotModified(server, *entry);
+                return true;
+            }
+            if (entry->eTag.length())
+                server.sendHeader(F("ETag"), entry->eTag);
+        }
+
+        if (_cache_header.length() != 0)
+            server.sendHeader("Cache-Control", _cache_header);
+
+        server.streamFile(f, entry->contentType);
+        return true;
+    }
+
+    static String getContentType(const String& path) {
+        // none, the default type, if the extension isn't known
+        return String(FPSTR(mimeTable[fromPath(path)].mimeType));
+    }
+
+protected:
+    struct CacheEntry {
+        String uri;          // request URI, empty if the entry is unused
+        String path;         // file to serve, the .gz variant if there is one
+        String contentType;
+        size_t size = 0;
+        String eTag;         // quoted, empty until first needed
+    };
+
+    String _makeETag(ESP8266WebServer& server, File& f, const String& path) {
+        String eTag;
+        if (server._eTagFunction) {
+            eTag = server._eTagFunction(_fs, path);
+        } else {
+            MD5Builder md5;
+            md5.begin();
+            if (md5.addStream(f, f.size())) {
+                md5.calculate();
+                eTag = md5.toString();
+            }
+            f.seek(0, SeekSet);
+        }
+        if (!eTag.length())
+            return eTag;
+        return String('"') + eTag + '"';
+    }
+
+    void _sendNotModified(ESP8266WebServer& server, const CacheEntry& entry) {
+        server.sendHeader(F("ETag"), entry.eTag);
+        if (_cache_header.length() != 0)
+            server.sendHeader("Cache-Control", _cache_header);
+        server.send(304);
+    }
+
+    // Maps a request URI to the file serving it, as the uncached path always did.
+    bool _resolve(const String& requestUri, CacheEntry& entry) {
         String path(_path);
 
         if (!_isFile) {
+            String uri = requestUri;
             // Base URI doesn't point to a file.
             // If a directory is requested, look for index file.
-            if (requestUri.endsWith("/")) 
-              requestUri += "index.htm";
+            if (uri.endsWith("/"))
+              uri += "index.htm";
 
             // Append whatever follows this URI in request to get the file path.
-            path += requestUri.substring(_baseUriLength);
+            path += uri.substring(_baseUriLength);
         }
         DEBUGV("StaticRequestHandler::handle: path=%s, isFile=%d\r\n", path.c_str(), _isFile);
 
-        String contentType = getContentType(path);
+        entry.contentType = getContentType(path);
 
         // look for gz file, only if the original specified path is not a gz.  So part only works to send gzip via content encoding when a non compressed is asked for
         // if you point the the path to gzip you will serve the gzip as content type "application/x-gzip", not text or javascript etc...
@@ -109,39 +207,47 @@ public:
                 path += FPSTR(mimeTable[gz].endsWith);
         }
 
-        File f = _fs.open(path, "r");
-        if (!f)
-            return false;
-
-        if (_cache_header.length() != 0)
-            server.sendHeader("Cache-Control", _cache_header);
-
-        server.streamFile(f, contentType);
+        entry.uri = requestUri;
+        entry.path = path;
         return true;
     }
 
-    static String getContentType(const String& path) {
-        char buff[sizeof(mimeTable[0].mimeType)];
-        // Check all entries but last one for match, return if found
-        for (size_t i=0; i < sizeof(mimeTable)/sizeof(mimeTable[0])-1; i++) {
-            strcpy_P(buff, mimeTable[i].endsWith);
-            if (path.endsWith(buff)) {
-                strcpy_P(buff, mimeTable[i].mimeType);
-                return String(buff);
-            }
+    CacheEntry* _cacheLookup(const String& requestUri) {
+        if (!_cache)
+            return nullptr;
+        for (size_t i = 0; i < STATIC_HANDLER_CACHE_SIZE; ++i) {
+            if (_cache[i].uri.length() && _cache[i].uri == requestUri)
+                return &_cache[i];
         }
-        // Fall-through and just return default type
-        strcpy_P(buff, mimeTable[sizeof(mimeTable)/sizeof(mimeTable[0])-1].mimeType);
-        return String(buff);
+        return nullptr;
+    }
+
+    CacheEntry* _cacheStore(const CacheEntry& resolved) {
+#if STATIC_HANDLER_CACHE_SIZE > 0
+        if (!_cache) {
+            _cache.reset(new CacheEntry[STATIC_HANDLER_CACHE_SIZE]);
+            if (!_cache)
+                return nullptr;
+        }
+        // replace entries round-robin
+        CacheEntry* entry = &_cache[_cacheNext];
+        _cacheNext = (_cacheNext + 1) % STATIC_HANDLER_CACHE_SIZE;
+        *entry = resolved;
+        return entry;
+#else
+        (void) resolved;
+        return nullptr;
+#endif
     }
 
-protected:
     FS _fs;
     String _uri;
     String _path;
     String _cache_header;
     bool _isFile;
     size_t _baseUriLength;
+    std::unique_ptr<CacheEntry[]> _cache;
+    size_t _cacheNext;
 };
 
 
@@ -0,0 +1,87 @@
+#include <Arduino.h>
+#include "ESP8266WebServer.h"
+#include "RouteIndex.h"
+
+RouteIndex::~RouteIndex() {
+    free(_routes);
+    free(_generic);
+}
+
+// FNV-1a
+uint32_t RouteIndex::hash(const String& uri) {
+    uint32_t h = 2166136261UL;
+    for (const char* p = uri.c_str(); p && *p; ++p) {
+        h ^= (uint8_t) *p;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+bool RouteIndex::add(RequestHandler* handler, const String& uri, HTTPMethod method) {
+    // keep the table at most 3/4 full
+    if ((_count + 1) * 4 > _size * 3 && !_grow())
+        return addGeneric(handler);
+    Route route = { hash(uri), _order++, method, handler };
+    _insert(route);
+    ++_count;
+    return true;
+}
+
+bool RouteIndex::addGeneric(RequestHandler* handler) {
+    Generic* generic = (Generic*) realloc(_generic, (_genericCount + 1) * sizeof(Generic));
+    if (!generic)
+        return false;
+    _generic = generic;
+    _generic[_genericCount].order = _order++;
+    _generic[_genericCount].handler = handler;
+    ++_genericCount;
+    return true;
+}
+
+RequestHandler* RouteIndex::find(HTTPMethod method, const String& uri) const {
+    RequestHandler* found = nullptr;
+    uint16_t foundOrder = 0xffff;
+    if (_size) {
+        uint32_t h = hash(uri);
+        size_t mask = _size - 1;
+        for (size_t i = h & mask; _routes[i].handler; i = (i + 1) & mask) {
+            const Route& route = _routes[i];
+            if (route.hash == h && route.order < foundOrder &&
+                (route.method == HTTP_ANY || route.method == method) &&
+                route.handler->canHandle(method, uri)) {
+                found = route.handler;
+                foundOrder = route.order;
+            }
+        }
+    }
+    for (size_t i = 0; i < _genericCount && _generic[i].order < foundOrder; ++i) {
+        if (_generic[i].handler->canHandle(method, uri))
+            return _generic[i].handler;
+    }
+    return found;
+}
+
+bool RouteIndex::_grow() {
+    size_t newSize = _size ? _size * 2 : 16;
+    Route* newRoutes = (Route*) calloc(newSize, sizeof(Route));
+    if (!newRoutes)
+        return false;
+    Route* oldRoutes = _routes;
+    size_t oldSize = _size;
+    _routes = newRoutes;
+    _size = newSize;
+    for (size_t i = 0; i < oldSize; ++i) {
+        if (oldRoutes[i].handler)
+            _insert(oldRoutes[i]);
+    }
+    free(oldRoutes);
+    return true;
+}
+
+void RouteIndex::_insert(const Route& route) {
+    size_t mask = _size - 1;
+    size_t i = route.hash & mask;
+    while (_routes[i].handler)
+        i = (i + 1) & mask;
+    _routes[i] = route;
+}
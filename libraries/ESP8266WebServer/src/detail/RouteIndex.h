@@ -0,0 +1,52 @@
+#ifndef ROUTEINDEX_H
+#define ROUTEINDEX_H
+
+#include "RequestHandler.h"
+
+// Index of the request handlers registered with a server.
+// Handlers for an exact URI (ESP8266WebServer::on) go into an open addressing
+// hash table keyed on the URI, all others are kept in registration order and
+// asked through canHandle(). find() returns the same handler a walk over all
+// handlers in registration order would, at the cost of one hash probe plus
+// the canHandle() calls of the generic handlers registered before it.
+class RouteIndex {
+public:
+    RouteIndex() { }
+    ~RouteIndex();
+
+    // false without the memory for the handler, which find() then misses
+    bool add(RequestHandler* handler, const String& uri, HTTPMethod method);
+    bool addGeneric(RequestHandler* handler);
+    RequestHandler* find(HTTPMethod method, const String& uri) const;
+
+    static uint32_t hash(const String& uri);
+
+protected:
+    struct Route {
+        uint32_t hash;
+        uint16_t order;
+        HTTPMethod method;
+        RequestHandler* handler;
+    };
+
+    struct Generic {
+        uint16_t order;
+        RequestHandler* handler;
+    };
+
+    bool _grow();
+    void _insert(const Route& route);
+
+    Route* _routes = nullptr;      // hash table, _size is a power of two
+    size_t _size = 0;
+    size_t _count = 0;
+    Generic* _generic = nullptr;   // in registration order
+    size_t _genericCount = 0;
+    uint16_t _order = 0;
+
+private:
+    RouteIndex(const RouteIndex&);
+    RouteIndex& operator=(const RouteIndex&);
+};
+
+#endif //ROUTEINDEX_H
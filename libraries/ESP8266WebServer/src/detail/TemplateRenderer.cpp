@@ -0,0 +1,49 @@
+#include "TemplateRenderer.h"
+
+void TemplateRenderer::feed(const char* data, size_t size) {
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end) {
+        if (!_inName) {
+            const char* pct = (const char*) memchr(p, '%', end - p);
+            if (!pct) {
+                _out.write(p, end - p);
+                return;
+            }
+            if (pct > p)
+                _out.write(p, pct - p);
+            p = pct + 1;
+            _inName = true;
+            _nameLen = 0;
+            continue;
+        }
+
+        char c = *p;
+        if (c == '%') {
+            if (_nameLen == 0) {
+                _out.write('%');
+            } else if (_processor) {
+                _name[_nameLen] = 0;
+                _processor(_out, _name);
+            }
+            _inName = false;
+            p++;
+        } else if (_isNameChar(c) && _nameLen < TEMPLATE_PLACEHOLDER_LEN) {
+            _name[_nameLen++] = c;
+            p++;
+        } else {
+            // not a placeholder after all; c is looked at again as text
+            _out.write('%');
+            _out.write(_name, _nameLen);
+            _inName = false;
+        }
+    }
+}
+
+void TemplateRenderer::end() {
+    if (!_inName)
+        return;
+    _out.write('%');
+    _out.write(_name, _nameLen);
+    _inName = false;
+}
@@ -0,0 +1,56 @@
+#ifndef TEMPLATERENDERER_H
+#define TEMPLATERENDERER_H
+
+#include <Arduino.h>
+#include <functional>
+
+#ifndef TEMPLATE_PLACEHOLDER_LEN
+#define TEMPLATE_PLACEHOLDER_LEN 32
+#endif
+
+#ifndef TEMPLATE_READ_CHUNK
+#define TEMPLATE_READ_CHUNK 128
+#endif
+
+// Copies a template to a Print, replacing each %NAME% by what the processor
+// prints for NAME. "%%" stands for a single '%'. A '%' not followed by a name
+// of up to TEMPLATE_PLACEHOLDER_LEN letters, digits or '_' and a closing '%'
+// is copied as it is, so that "100% sure" needs no escaping.
+// The template is fed in pieces of any size: static text between placeholders
+// is written in runs as long as the piece holding it, and only the name of a
+// placeholder split between two pieces is held back.
+class TemplateRenderer {
+public:
+    typedef std::function<void(Print& out, const char* name)> Processor;
+
+    TemplateRenderer(Print& out, const Processor& processor)
+    : _out(out), _processor(processor) { }
+
+    void feed(const char* data, size_t size);
+    // writes what an unterminated placeholder held back
+    void end();
+
+    // renders a whole source with a readBytes(char*, size_t) method, such as
+    // ProgmemStream, MappedFileStream or a Stream
+    template<typename TSource>
+    void render(TSource& source) {
+        char buf[TEMPLATE_READ_CHUNK];
+        size_t n;
+        while ((n = source.readBytes(buf, sizeof(buf))) > 0)
+            feed(buf, n);
+        end();
+    }
+
+protected:
+    static bool _isNameChar(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    Print& _out;
+    const Processor& _processor;
+    char   _name[TEMPLATE_PLACEHOLDER_LEN + 1];
+    size_t _nameLen = 0;
+    bool   _inName = false;  // after an opening '%'
+};
+
+#endif //TEMPLATERENDERER_H
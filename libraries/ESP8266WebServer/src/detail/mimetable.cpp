@@ -1,35 +1,36 @@
 #include "mimetable.h"
+#include "KeywordTable.h"
 #include "pgmspace.h"
 
 namespace mime
 {
 
+#define MIME_TYPE_ENTRY(name, ext, type) { ext, type },
+#define MIME_TYPE_EXT(name, ext, type) ext,
+
 // Table of extension->MIME strings stored in PROGMEM, needs to be global due to GCC section typing rules
 const Entry mimeTable[maxType] ICACHE_RODATA_ATTR = 
 {
-    { ".html", "text/html" },
-    { ".htm", "text/html" },
-    { ".css", "text/css" },
-    { ".txt", "text/plain" },
-    { ".js", "application/javascript" },
-    { ".json", "application/json" },
-    { ".png", "image/png" },
-    { ".gif", "image/gif" },
-    { ".jpg", "image/jpeg" },
-    { ".ico", "image/x-icon" },
-    { ".svg", "image/svg+xml" },
-    { ".ttf", "application/x-font-ttf" },
-    { ".otf", "application/x-font-opentype" },
-    { ".woff", "application/font-woff" },
-    { ".woff2", "application/font-woff2" },
-    { ".eot", "application/vnd.ms-fontobject" },
-    { ".sfnt", "application/font-sfnt" },
-    { ".xml", "text/xml" },
-    { ".pdf", "application/pdf" },
-    { ".zip", "application/zip" },
-    { ".gz", "application/x-gzip" },
-    { ".appcache", "text/cache-manifest" },
+    MIME_TYPES(MIME_TYPE_ENTRY)
     { "", "application/octet-stream" } 
 };
 
+// only seen by the compiler
+static constexpr const char* extensions[] = { MIME_TYPES(MIME_TYPE_EXT) };
+
+static constexpr keyword::Table<64> extensionTable ICACHE_RODATA_ATTR =
+    keyword::make<64>(extensions, none);
+
+type fromPath(const StringView& path)
+{
+    int dot = path.lastIndexOf('.');
+    if (dot < 0 || path.indexOf('/', dot) >= 0)
+        return none;
+    StringView ext = path.substring(dot);
+    uint8_t i = keyword::find(extensionTable, ext);
+    if (i == keyword::NONE || !ext.equalsIgnoreCase(FPSTR(mimeTable[i].endsWith)))
+        return none;
+    return (type) i;
+}
+
 }
@@ -1,38 +1,47 @@
 #ifndef __MIMETABLE_H__
 #define __MIMETABLE_H__
 
+#include <StringView.h>
 
 namespace mime
 {
 
+// name, extension, MIME type
+#define MIME_TYPES(X) \
+  X(html, ".html", "text/html") \
+  X(htm, ".htm", "text/html") \
+  X(css, ".css", "text/css") \
+  X(txt, ".txt", "text/plain") \
+  X(js, ".js", "application/javascript") \
+  X(json, ".json", "application/json") \
+  X(png, ".png", "image/png") \
+  X(gif, ".gif", "image/gif") \
+  X(jpg, ".jpg", "image/jpeg") \
+  X(ico, ".ico", "image/x-icon") \
+  X(svg, ".svg", "image/svg+xml") \
+  X(ttf, ".ttf", "application/x-font-ttf") \
+  X(otf, ".otf", "application/x-font-opentype") \
+  X(woff, ".woff", "application/font-woff") \
+  X(woff2, ".woff2", "application/font-woff2") \
+  X(eot, ".eot", "application/vnd.ms-fontobject") \
+  X(sfnt, ".sfnt", "application/font-sfnt") \
+  X(xml, ".xml", "text/xml") \
+  X(pdf, ".pdf", "application/pdf") \
+  X(zip, ".zip", "application/zip") \
+  X(gz, ".gz", "application/x-gzip") \
+  X(appcache, ".appcache", "text/cache-manifest")
+
+#define MIME_TYPE_ENUM(name, ext, type) name,
+
 enum type
 {
-  html,
-  htm,
-  css,
-  txt,
-  js,
-  json,
-  png,
-  gif,
-  jpg,
-  ico,
-  svg,
-  ttf,
-  otf,
-  woff,
-  woff2,
-  eot,
-  sfnt,
-  xml,
-  pdf,
-  zip,
-  gz,
-  appcache,
+  MIME_TYPES(MIME_TYPE_ENUM)
   none,
   maxType
 };
 
+#undef MIME_TYPE_ENUM
+
 struct Entry
 {
   const char endsWith[16]; 
@@ -41,6 +50,9 @@ struct Entry
 
 
 extern const Entry mimeTable[maxType];
+
+// by the extension of path (whatever case), none if it has no known one
+type fromPath(const StringView& path);
 }
 
 
@@ -33,9 +33,18 @@ extern "C" {
 #include "osapi.h"
 #include "mem.h"
 #include "user_interface.h"
+#include "lwip/init.h" // LWIP_VERSION_
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
 }
 
 #include "debug.h"
+#include "Schedule.h"
+
+extern "C" {
+// in libmain, not declared by user_interface.h
+bool wifi_softap_deauth(uint8 mac[6]);
+}
 
 
 
@@ -45,6 +54,108 @@ extern "C" {
 
 static bool softap_config_equal(const softap_config& lhs, const softap_config& rhs);
 
+struct softap_station_t {
+    bool used;
+    bool kick;              // to be sent away by the next check
+    WiFiSoftAPStation info;
+};
+
+static softap_station_t sStations[SOFTAP_STATIONS_MAX];
+static WiFiSoftAPStationPolicy sPolicy;
+static schedule_handle_t sPolicyCheck = 0;
+
+static softap_station_t* find_station(const uint8_t* mac) {
+    for(auto& station : sStations) {
+        if(station.used && memcmp(station.info.mac, mac, 6) == 0) {
+            return &station;
+        }
+    }
+    return nullptr;
+}
+
+static size_t station_count() {
+    size_t count = 0;
+    for(auto& station : sStations) {
+        count += station.used ? 1 : 0;
+    }
+    return count;
+}
+
+static void check_policy() {
+    uint32_t now = millis();
+    for(auto& station : sStations) {
+        if(!station.used) {
+            continue;
+        }
+        WiFiSoftAPStation& info = station.info;
+        bool idle = sPolicy.idleTimeout && now - info.lastActivity > sPolicy.idleTimeout;
+        bool weak = sPolicy.minRssi && info.rssi && info.rssi < sPolicy.minRssi;
+        if(station.kick || idle || weak) {
+            DEBUG_WIFI("[AP] sending station away (%d%d%d)\n", station.kick, idle, weak);
+            station.kick = false;
+            wifi_softap_deauth(info.mac);
+        }
+    }
+}
+
+#if LWIP_VERSION_MAJOR != 1
+// The frames of the AP interface are counted on their way between the
+// driver and lwIP: the source address of those received, the destination
+// of those sent.
+static netif_input_fn sApInput = nullptr;
+static netif_linkoutput_fn sApLinkOutput = nullptr;
+
+static void count_frame(pbuf* p, bool rx) {
+    if(p->len < 12) {
+        return;
+    }
+    const uint8_t* frame = reinterpret_cast<const uint8_t*>(p->payload);
+    softap_station_t* station = find_station(rx ? frame + 6 : frame);
+    if(!station) {
+        return;
+    }
+    WiFiSoftAPStation& info = station->info;
+    if(rx) {
+        info.rxBytes += p->tot_len;
+        ++info.rxPackets;
+        info.lastActivity = millis();
+    } else {
+        info.txBytes += p->tot_len;
+        ++info.txPackets;
+    }
+}
+
+static err_t ap_input(pbuf* p, netif* inp) {
+    count_frame(p, true);
+    return sApInput(p, inp);
+}
+
+static err_t ap_linkoutput(netif* nif, pbuf* p) {
+    count_frame(p, false);
+    return sApLinkOutput(nif, p);
+}
+
+// the interface comes and goes with the AP, so this is looked at on each connection
+static void hook_ap_netif() {
+    uint8_t mac[6];
+    wifi_get_macaddr(SOFTAP_IF, mac);
+    for(netif* nif = netif_list; nif; nif = nif->next) {
+        if(nif->hwaddr_len != 6 || memcmp(nif->hwaddr, mac, 6) != 0) {
+            continue;
+        }
+        if(nif->input != ap_input) {
+            sApInput = nif->input;
+            nif->input = ap_input;
+        }
+        if(nif->linkoutput != ap_linkoutput) {
+            sApLinkOutput = nif->linkoutput;
+            nif->linkoutput = ap_linkoutput;
+        }
+        return;
+    }
+}
+#endif
+
 
 
 /**
@@ -306,6 +417,136 @@ uint8_t ESP8266WiFiAPClass::softAPgetStationNum() {
     return wifi_softap_get_station_num();
 }
 
+/**
+ * Get the stations connected to the softAP interface
+ * @param stations  filled with up to max of them
+ * @param max       entries in stations
+ * @return          stations filled
+ */
+size_t ESP8266WiFiAPClass::softAPgetStations(WiFiSoftAPStation* stations, size_t max) {
+    size_t count = 0;
+    for(auto& station : sStations) {
+        if(station.used && count < max) {
+            stations[count++] = station.info;
+        }
+    }
+    return count;
+}
+
+/**
+ * Get one station connected to the softAP interface
+ * @param mac       its MAC address
+ * @param station   filled if it is connected
+ * @return          whether it is
+ */
+bool ESP8266WiFiAPClass::softAPgetStation(const uint8_t* mac, WiFiSoftAPStation& station) {
+    softap_station_t* found = find_station(mac);
+    if(!found) {
+        return false;
+    }
+    station = found->info;
+    return true;
+}
+
+/**
+ * Deauthenticate a station connected to the softAP interface
+ * @param mac   its MAC address
+ * @return      whether the SDK took it
+ */
+bool ESP8266WiFiAPClass::softAPkickStation(const uint8_t* mac) {
+    uint8_t addr[6];
+    memcpy(addr, mac, 6);
+    return wifi_softap_deauth(addr);
+}
+
+/**
+ * Set when stations are sent away
+ * @param policy    see WiFiSoftAPStationPolicy
+ */
+void ESP8266WiFiAPClass::softAPsetStationPolicy(const WiFiSoftAPStationPolicy& policy) {
+    sPolicy = policy;
+    bool periodic = sPolicy.idleTimeout || sPolicy.minRssi;
+    if(periodic && !sPolicyCheck) {
+        sPolicyCheck = schedule_recurrent_function_us(1000000, check_policy, SCHEDULE_PRIORITY_LOW);
+    } else if(!periodic && sPolicyCheck) {
+        schedule_cancel(sPolicyCheck);
+        sPolicyCheck = 0;
+    }
+}
+
+const WiFiSoftAPStationPolicy& ESP8266WiFiAPClass::softAPgetStationPolicy() const {
+    return sPolicy;
+}
+
+/**
+ * Keep track of the stations, called for each WiFi event before it is
+ * handed to the handlers
+ * @param arg   System_Event_t
+ */
+void ESP8266WiFiAPClass::_stationEvent(void* arg) {
+    System_Event_t* event = reinterpret_cast<System_Event_t*>(arg);
+    switch(event->event) {
+    case EVENT_SOFTAPMODE_STACONNECTED: {
+        const uint8_t* mac = event->event_info.sta_connected.mac;
+        softap_station_t* station = find_station(mac);
+        if(!station) {
+            for(auto& slot : sStations) {
+                if(!slot.used) {
+                    station = &slot;
+                    break;
+                }
+            }
+        }
+        if(!station) {
+            DEBUG_WIFI("[AP] more than %d stations\n", SOFTAP_STATIONS_MAX);
+            break;
+        }
+        bool known = station->used;
+        station->used = true;
+        station->kick = false;
+        if(!known) {
+            station->info = WiFiSoftAPStation();
+            memcpy(station->info.mac, mac, 6);
+        }
+        station->info.connectedAt = millis();
+        station->info.lastActivity = station->info.connectedAt;
+#if LWIP_VERSION_MAJOR != 1
+        hook_ap_netif();
+#endif
+        if(sPolicy.maxStations && station_count() > sPolicy.maxStations) {
+            // not from the SDK's callback, the check does it
+            station->kick = true;
+            schedule_function(check_policy);
+        }
+        break;
+    }
+    case EVENT_SOFTAPMODE_STADISCONNECTED: {
+        softap_station_t* station = find_station(event->event_info.sta_disconnected.mac);
+        if(station) {
+            station->used = false;
+            station->kick = false;
+        }
+        break;
+    }
+    case EVENT_SOFTAPMODE_DISTRIBUTE_STA_IP: {
+        softap_station_t* station = find_station(event->event_info.distribute_sta_ip.mac);
+        if(station) {
+            station->info.ip = event->event_info.distribute_sta_ip.ip.addr;
+        }
+        break;
+    }
+    case EVENT_SOFTAPMODE_PROBEREQRECVED: {
+        softap_station_t* station = find_station(event->event_info.ap_probereqrecved.mac);
+        if(station) {
+            station->info.rssi = event->event_info.ap_probereqrecved.rssi;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
 /**
  * Get the softAP interface IP address.
  * @return IPAddress softAP IP
@@ -27,6 +27,33 @@
 #include "ESP8266WiFiType.h"
 #include "ESP8266WiFiGeneric.h"
 
+// stations tracked by softAPgetStations()
+#ifndef SOFTAP_STATIONS_MAX
+#define SOFTAP_STATIONS_MAX 8
+#endif
+
+// What is known of a station connected to the soft AP. The SDK gives no
+// link statistics for them: the RSSI is that of the probe requests they
+// keep sending, and the counters are of the frames through lwIP.
+struct WiFiSoftAPStation {
+    uint8_t mac[6];
+    IPAddress ip;           // 0 until the DHCP server leases one
+    int rssi;               // 0 until a probe request was heard
+    uint32_t rxBytes;       // received from it, Ethernet headers included
+    uint32_t txBytes;       // sent to it
+    uint32_t rxPackets;
+    uint32_t txPackets;
+    uint32_t connectedAt;   // millis()
+    uint32_t lastActivity;  // millis() of the last frame from it
+};
+
+// When to send stations away; 0 turns each rule off.
+struct WiFiSoftAPStationPolicy {
+    uint8_t maxStations = 0;    // stations connecting past this are sent away
+    uint32_t idleTimeout = 0;   // ms without a frame from a station
+    int minRssi = 0;            // weakest RSSI kept, e.g. -80
+};
+
 
 class ESP8266WiFiAPClass {
 
@@ -42,6 +69,18 @@ class ESP8266WiFiAPClass {
 
         uint8_t softAPgetStationNum();
 
+        // Fill stations with up to max of the connected stations, returns how many.
+        size_t softAPgetStations(WiFiSoftAPStation* stations, size_t max);
+        bool softAPgetStation(const uint8_t* mac, WiFiSoftAPStation& station);
+        // Deauthenticate a station; it may come back.
+        bool softAPkickStation(const uint8_t* mac);
+        // Checked once a second, and for each station as it connects.
+        void softAPsetStationPolicy(const WiFiSoftAPStationPolicy& policy);
+        const WiFiSoftAPStationPolicy& softAPgetStationPolicy() const;
+
+        // from the WiFi event callback, as the SDK calls it
+        static void _stationEvent(void* event);
+
         IPAddress softAPIP();
 
         uint8_t* softAPmacAddress(uint8_t* mac);
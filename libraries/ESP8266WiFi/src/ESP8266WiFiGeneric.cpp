@@ -44,6 +44,8 @@ extern "C" {
 #include "WiFiClient.h"
 #include "WiFiUdp.h"
 #include "debug.h"
+#include "Schedule.h"
+#include "coredecls.h"
 
 extern "C" void esp_schedule();
 extern "C" void esp_yield();
@@ -77,7 +79,23 @@ struct WiFiEventHandlerOpaque
     bool mCanExpire = true; /* stopgap solution to handle deprecated void onEvent(cb, evt) case */
 };
 
-static std::list<WiFiEventHandler> sCbEventList;
+// the handlers of every event, and of WIFI_EVENT_ANY last
+static std::list<WiFiEventHandler> sCbEventLists[WIFI_EVENT_MAX + 1];
+
+static void addEventHandler(const WiFiEventHandler& handler)
+{
+    std::list<WiFiEventHandler>& handlers = sCbEventLists[handler->mEvent < WIFI_EVENT_MAX ? handler->mEvent : WIFI_EVENT_ANY];
+    // drop the ones that are not held anymore, also for events that never come
+    handlers.remove_if([](const WiFiEventHandler& h) { return h->canExpire() && h.unique(); });
+    handlers.push_back(handler);
+}
+
+// events waiting for loop() with setEventsScheduled(true)
+#define WIFI_EVENT_QUEUE_SIZE 8
+static bool sEventsScheduled = false;
+static System_Event_t sEventQueue[WIFI_EVENT_QUEUE_SIZE];
+static uint8_t sEventQueueHead = 0;
+static uint8_t sEventQueueCount = 0;
 
 bool ESP8266WiFiGenericClass::_persistent = true;
 WiFiMode_t ESP8266WiFiGenericClass::_forceSleepLastMode = WIFI_OFF;
@@ -93,7 +111,7 @@ void ESP8266WiFiGenericClass::onEvent(WiFiEventCb f, WiFiEvent_t event)
         (*f)(static_cast<WiFiEvent>(e->event));
     });
     handler->mCanExpire = false;
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
 }
 
 WiFiEventHandler ESP8266WiFiGenericClass::onStationModeConnected(std::function<void(const WiFiEventStationModeConnected&)> f)
@@ -106,7 +124,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onStationModeConnected(std::function<v
         dst.channel = src.channel;
         f(dst);
     });
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
     return handler;
 }
 
@@ -120,7 +138,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onStationModeDisconnected(std::functio
         dst.reason = static_cast<WiFiDisconnectReason>(src.reason);
         f(dst);
     });
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
     return handler;
 }
 
@@ -133,7 +151,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onStationModeAuthModeChanged(std::func
         dst.newMode = src.new_mode;
         f(dst);
     });
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
     return handler;
 }
 
@@ -147,7 +165,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onStationModeGotIP(std::function<void(
         dst.gw = src.gw.addr;
         f(dst);
     });
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
     return handler;
 }
 
@@ -157,7 +175,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onStationModeDHCPTimeout(std::function
         (void) e;
         f();
     });
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
     return handler;
 }
 
@@ -170,7 +188,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onSoftAPModeStationConnected(std::func
         dst.aid = src.aid;
         f(dst);
     });
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
     return handler;
 }
 
@@ -183,7 +201,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onSoftAPModeStationDisconnected(std::f
         dst.aid = src.aid;
         f(dst);
     });
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
     return handler;
 }
 
@@ -196,7 +214,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onSoftAPModeProbeRequestReceived(std::
         dst.rssi = src.rssi;
         f(dst);
     });
-    sCbEventList.push_back(handler);
+    addEventHandler(handler);
     return handler;
 }
 
@@ -206,7 +224,7 @@ WiFiEventHandler ESP8266WiFiGenericClass::onSoftAPModeProbeRequestReceived(std::
 //         WiFiEventModeChange& dst = *reinterpret_cast<WiFiEventModeChange*>(&e->event_info);
 //         f(dst);
 //     });
-//     sCbEventList.push_back(handler);
+//     addEventHandler(handler);
 //     return handler;
 // }
 
@@ -219,23 +237,75 @@ void ESP8266WiFiGenericClass::_eventCallback(void* arg)
     System_Event_t* event = reinterpret_cast<System_Event_t*>(arg);
     DEBUG_WIFI("wifi evt: %d\n", event->event);
 
+    if(event->event == EVENT_STAMODE_GOT_IP) {
+        boot_times_got_ip();
+    }
+
     if(event->event == EVENT_STAMODE_DISCONNECTED) {
         DEBUG_WIFI("STA disconnect: %d\n", event->event_info.disconnected.reason);
         WiFiClient::stopAll();
     }
 
-    for(auto it = std::begin(sCbEventList); it != std::end(sCbEventList); ) {
-        WiFiEventHandler &handler = *it;
-        if (handler->canExpire() && handler.unique()) {
-            it = sCbEventList.erase(it);
+    ESP8266WiFiAPClass::_stationEvent(event);
+
+    if(sEventsScheduled) {
+        if(sEventQueueCount == WIFI_EVENT_QUEUE_SIZE) {
+            DEBUG_WIFI("wifi evt queue full, dropped %d\n", event->event);
+            return;
         }
-        else {
-            (*handler)(event);
-            ++it;
+        sEventQueue[(sEventQueueHead + sEventQueueCount) % WIFI_EVENT_QUEUE_SIZE] = *event;
+        if(sEventQueueCount++ == 0) {
+            schedule_function(_runScheduledEvents, NULL);
+        }
+        return;
+    }
+    _dispatchEvent(event);
+}
+
+void ESP8266WiFiGenericClass::_runScheduledEvents(void* arg)
+{
+    (void) arg;
+    while(sEventQueueCount) {
+        System_Event_t event = sEventQueue[sEventQueueHead];
+        sEventQueueHead = (sEventQueueHead + 1) % WIFI_EVENT_QUEUE_SIZE;
+        --sEventQueueCount;
+        _dispatchEvent(&event);
+    }
+}
+
+void ESP8266WiFiGenericClass::_dispatchEvent(void* arg)
+{
+    System_Event_t* event = reinterpret_cast<System_Event_t*>(arg);
+    std::list<WiFiEventHandler>* lists[2] = { NULL, &sCbEventLists[WIFI_EVENT_ANY] };
+    if(event->event < WIFI_EVENT_MAX) {
+        lists[0] = &sCbEventLists[event->event];
+    }
+    for(std::list<WiFiEventHandler>* handlers : lists) {
+        if(!handlers) {
+            continue;
+        }
+        for(auto it = std::begin(*handlers); it != std::end(*handlers); ) {
+            WiFiEventHandler &handler = *it;
+            if (handler->canExpire() && handler.unique()) {
+                it = handlers->erase(it);
+            }
+            else {
+                (*handler)(event);
+                ++it;
+            }
         }
     }
 }
 
+/**
+ * run the event handlers from loop(), like scheduled functions, instead of the SDK event callback
+ * @param scheduled bool
+ */
+void ESP8266WiFiGenericClass::setEventsScheduled(bool scheduled)
+{
+    sEventsScheduled = scheduled;
+}
+
 /**
  * Return the current channel associated with the network
  * @return channel (1-13)
@@ -261,6 +331,62 @@ WiFiSleepType_t ESP8266WiFiGenericClass::getSleepMode() {
     return (WiFiSleepType_t) wifi_get_sleep_type();
 }
 
+uint32_t ESP8266WiFiGenericClass::_autoSleepIdleMs = 0;
+WiFiSleepType_t ESP8266WiFiGenericClass::_autoSleepIdleType = WIFI_NONE_SLEEP;
+WiFiSleepType_t ESP8266WiFiGenericClass::_autoSleepActiveType = WIFI_NONE_SLEEP;
+uint32_t ESP8266WiFiGenericClass::_autoSleepHandle = 0;
+
+/**
+ * sleep with idleType when there is no TCP or UDP traffic, with activeType else
+ * @param idleType sleep_type_t when idle
+ * @param idleMs time without traffic before idleType
+ * @param activeType sleep_type_t after traffic
+ * @return bool
+ */
+bool ESP8266WiFiGenericClass::setAutoSleep(WiFiSleepType_t idleType, uint32_t idleMs, WiFiSleepType_t activeType) {
+    stopAutoSleep();
+    _autoSleepIdleType = idleType;
+    _autoSleepActiveType = activeType;
+    _autoSleepIdleMs = idleMs;
+    // checked a few times per idleMs, so the switch is at most a quarter late
+    uint32_t periodMs = idleMs / 4;
+    if(periodMs < 10) {
+        periodMs = 10;
+    }
+    _autoSleepHandle = schedule_recurrent_function_us(periodMs * 1000, _autoSleepCheck, SCHEDULE_PRIORITY_LOW);
+    if(!_autoSleepHandle) {
+        return false;
+    }
+    _autoSleepCheck();
+    return true;
+}
+
+/**
+ * stop setAutoSleep(), keeping the sleep mode it set last
+ */
+void ESP8266WiFiGenericClass::stopAutoSleep() {
+    if(_autoSleepHandle) {
+        schedule_cancel(_autoSleepHandle);
+        _autoSleepHandle = 0;
+    }
+}
+
+void ESP8266WiFiGenericClass::_autoSleepCheck() {
+    WiFiSleepType_t type = (millis() - net_activity_ms >= _autoSleepIdleMs) ? _autoSleepIdleType : _autoSleepActiveType;
+    if((WiFiSleepType_t) wifi_get_sleep_type() != type) {
+        wifi_set_sleep_type((sleep_type_t) type);
+    }
+}
+
+/**
+ * wake up from light sleep on a GPIO level
+ * @param pin 0 to 15
+ * @param level LOW or HIGH
+ */
+void ESP8266WiFiGenericClass::setSleepWakePin(uint8_t pin, uint8_t level) {
+    wifi_enable_gpio_wakeup(pin, level ? GPIO_PIN_INTR_HILEVEL : GPIO_PIN_INTR_LOLEVEL);
+}
+
 /**
  * set phy Mode
  * @param mode phy_mode_t
@@ -427,6 +553,68 @@ bool ESP8266WiFiGenericClass::forceSleepWake() {
 }
 
 
+void ESP8266WiFiGenericClass::_lightSleepWake() {
+    // end the delay() in lightSleep() now instead of after the whole time
+    esp_schedule();
+}
+
+/**
+ * light sleep with the WiFi off, also of the CPU and the system timer
+ * @param sleepUs uint32_t in microseconds, 0 until the next timed function is due
+ * @return ok
+ */
+bool ESP8266WiFiGenericClass::lightSleep(uint32_t sleepUs) {
+    if(sleepUs == 0) {
+        sleepUs = schedule_next_due_us();
+    }
+    if(sleepUs < WIFI_LIGHT_SLEEP_MIN_US) {
+        return false;
+    }
+    if(sleepUs > WIFI_LIGHT_SLEEP_MAX_US) {
+        sleepUs = WIFI_LIGHT_SLEEP_MAX_US;
+    }
+
+    WiFiMode_t lastMode = getMode();
+    if(lastMode != WIFI_OFF && !mode(WIFI_OFF)) {
+        return false;
+    }
+
+    // the RTC goes on in light sleep, the system timer doesn't
+    uint32_t rtcPeriod = system_rtc_clock_cali_proc();
+    uint32_t rtcStart = system_get_rtc_time();
+    uint32_t timerStart = system_get_time();
+
+    wifi_fpm_set_sleep_type(LIGHT_SLEEP_T);
+    wifi_fpm_open();
+    wifi_fpm_set_wakeup_cb(_lightSleepWake);
+    bool slept = (wifi_fpm_do_sleep(sleepUs) == 0);
+    if(slept) {
+        // the CPU sleeps as soon as nothing runs
+        delay(sleepUs / 1000 + 1);
+    }
+    wifi_fpm_close();
+
+    if(slept) {
+        // the period is in microseconds, with 12 bits of fraction
+        uint64_t rtcUs = ((uint64_t) (system_get_rtc_time() - rtcStart) * rtcPeriod) >> 12;
+        uint32_t timerUs = system_get_time() - timerStart;
+        if(rtcUs > timerUs) {
+            micros_sleep_compensate(rtcUs - timerUs);
+        }
+    }
+
+    if(lastMode != WIFI_OFF) {
+        if(!mode(lastMode)) {
+            return false;
+        }
+        if((lastMode & WIFI_STA) != 0) {
+            wifi_station_connect();
+        }
+    }
+    return slept;
+}
+
+
 // -----------------------------------------------------------------------------------------------------------------------
 // ------------------------------------------------ Generic Network function ---------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
@@ -439,6 +627,97 @@ void wifi_dns_found_callback(const char *name, const ip_addr_t *ipaddr, void *ca
 
 static bool _dns_lookup_pending = false;
 
+// Number of host names whose addresses are remembered, 0 to disable
+#ifndef HOST_CACHE_SIZE
+#define HOST_CACHE_SIZE 4
+#endif
+
+// lwIP does not pass the TTL of answers on, so addresses are kept for at
+// most this long (ms); lwIP itself honours the TTL for the names it keeps
+#ifndef HOST_CACHE_TTL
+#define HOST_CACHE_TTL 30000
+#endif
+
+// Names that did not resolve are not asked for again for this long (ms)
+#ifndef HOST_CACHE_NEGATIVE_TTL
+#define HOST_CACHE_NEGATIVE_TTL 5000
+#endif
+
+struct HostCacheEntry
+{
+    String name;        // empty: unused
+    uint32_t addr;      // 0: the name did not resolve
+    uint32_t expires;   // millis()
+};
+
+static HostCacheEntry _hostCache[HOST_CACHE_SIZE ? HOST_CACHE_SIZE : 1];
+
+static HostCacheEntry* _findHost(const char* name)
+{
+    for (size_t i = 0; i < HOST_CACHE_SIZE; ++i) {
+        HostCacheEntry& entry = _hostCache[i];
+        if (entry.name.length() && (int32_t) (entry.expires - millis()) > 0 && entry.name.equalsIgnoreCase(name)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static void _cacheHost(const char* name, uint32_t addr)
+{
+    // the name's entry, or else the one expiring first
+    HostCacheEntry* slot = nullptr;
+    for (size_t i = 0; i < HOST_CACHE_SIZE; ++i) {
+        HostCacheEntry& entry = _hostCache[i];
+        if (entry.name.equalsIgnoreCase(name)) {
+            slot = &entry;
+            break;
+        }
+        if (!slot || (int32_t) (entry.expires - slot->expires) < 0) {
+            slot = &entry;
+        }
+    }
+    if (!slot) {
+        return;
+    }
+    slot->name = name;
+    slot->addr = addr;
+    slot->expires = millis() + (addr ? HOST_CACHE_TTL : HOST_CACHE_NEGATIVE_TTL);
+}
+
+// lookup started by the asynchronous hostByName()
+struct HostLookup
+{
+    String name;
+    ESP8266WiFiGenericClass::THandlerFunction_HostByName handler;
+};
+
+static bool _reportHost(HostLookup* lookup, uint32_t addr)
+{
+    bool scheduled = schedule_function([lookup, addr]() {
+        lookup->handler(lookup->name.c_str(), IPAddress(addr));
+        delete lookup;
+    });
+    if (!scheduled) {
+        DEBUG_WIFI_GENERIC("[hostByName] could not report %s\n", lookup->name.c_str());
+        delete lookup;
+    }
+    return scheduled;
+}
+
+#if LWIP_VERSION_MAJOR == 1
+static void _hostFound(const char *name, ip_addr_t *ipaddr, void *callback_arg)
+#else
+static void _hostFound(const char *name, const ip_addr_t *ipaddr, void *callback_arg)
+#endif
+{
+    (void) name;
+    HostLookup* lookup = reinterpret_cast<HostLookup*>(callback_arg);
+    uint32_t addr = ipaddr ? ipaddr->addr : 0;
+    _cacheHost(lookup->name.c_str(), addr);
+    _reportHost(lookup, addr);
+}
+
 /**
  * Resolve the given hostname to an IP address.
  * @param aHostname     Name to be resolved
@@ -463,10 +742,17 @@ int ESP8266WiFiGenericClass::hostByName(const char* aHostname, IPAddress& aResul
         return 1;
     }
 
+    if(HostCacheEntry* cached = _findHost(aHostname)) {
+        aResult = cached->addr;
+        DEBUG_WIFI_GENERIC("[hostByName] Host: %s cached: %s\n", aHostname, aResult.toString().c_str());
+        return cached->addr ? 1 : 0;
+    }
+
     DEBUG_WIFI_GENERIC("[hostByName] request IP for: %s\n", aHostname);
     err_t err = dns_gethostbyname(aHostname, &addr, &wifi_dns_found_callback, &aResult);
     if(err == ERR_OK) {
         aResult = addr.addr;
+        _cacheHost(aHostname, addr.addr);
     } else if(err == ERR_INPROGRESS) {
         _dns_lookup_pending = true;
         delay(timeout_ms);
@@ -498,7 +784,8 @@ void wifi_dns_found_callback(const char *name, ip_addr_t *ipaddr, void *callback
 void wifi_dns_found_callback(const char *name, const ip_addr_t *ipaddr, void *callback_arg)
 #endif
 {
-    (void) name;
+    // also when hostByName() has given up waiting
+    _cacheHost(name, ipaddr ? ipaddr->addr : 0);
     if (!_dns_lookup_pending) {
         return;
     }
@@ -508,4 +795,43 @@ void wifi_dns_found_callback(const char *name, const ip_addr_t *ipaddr, void *ca
     esp_schedule(); // resume the hostByName function
 }
 
+/**
+ * Resolve the given hostname without waiting for the answer.
+ * @param aHostname     Name to be resolved
+ * @param handler       Called from the loop context with the address, INADDR_NONE if there is none
+ * @return true if the handler is going to be called
+ */
+bool ESP8266WiFiGenericClass::hostByName(const char* aHostname, THandlerFunction_HostByName handler)
+{
+    if(!aHostname || !handler) {
+        return false;
+    }
+
+    HostLookup* lookup = new HostLookup { aHostname, handler };
+    if(!lookup) {
+        return false;
+    }
+
+    IPAddress ip;
+    if(ip.fromString(aHostname)) {
+        return _reportHost(lookup, ip);
+    }
+    if(HostCacheEntry* cached = _findHost(aHostname)) {
+        return _reportHost(lookup, cached->addr);
+    }
+
+    ip_addr_t addr;
+    err_t err = dns_gethostbyname(aHostname, &addr, &_hostFound, lookup);
+    if(err == ERR_INPROGRESS) {
+        return true;
+    }
+    if(err != ERR_OK) {
+        DEBUG_WIFI_GENERIC("[hostByName] Host: %s lookup error: %d!\n", aHostname, (int)err);
+        delete lookup;
+        return false;
+    }
+    _cacheHost(aHostname, addr.addr);
+    return _reportHost(lookup, addr.addr);
+}
+
 
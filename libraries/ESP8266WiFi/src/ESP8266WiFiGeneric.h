@@ -42,6 +42,12 @@ typedef std::shared_ptr<WiFiEventHandlerOpaque> WiFiEventHandler;
 
 typedef void (*WiFiEventCb)(WiFiEvent_t);
 
+// the shortest and longest sleep the SDK takes in lightSleep()
+#ifndef WIFI_LIGHT_SLEEP_MIN_US
+#define WIFI_LIGHT_SLEEP_MIN_US 10000
+#endif
+#define WIFI_LIGHT_SLEEP_MAX_US 0xFFFFFFF
+
 class ESP8266WiFiGenericClass {
         // ----------------------------------------------------------------------------------------------
         // -------------------------------------- Generic WiFi function ---------------------------------
@@ -64,11 +70,26 @@ class ESP8266WiFiGenericClass {
         WiFiEventHandler onSoftAPModeProbeRequestReceived(std::function<void(const WiFiEventSoftAPModeProbeRequestReceived&)>);
         // WiFiEventHandler onWiFiModeChange(std::function<void(const WiFiEventModeChange&)>);
 
+        // Run the event handlers from loop(), where they may take their time,
+        // instead of from the SDK. Up to 8 events wait there, more are dropped.
+        void setEventsScheduled(bool scheduled);
+
         int32_t channel(void);
 
         bool setSleepMode(WiFiSleepType_t type);
         WiFiSleepType_t getSleepMode();
 
+        // Switches the sleep mode with the TCP and UDP traffic: idleType
+        // (modem or light sleep) once there was none for idleMs, activeType
+        // as soon as there is some, so that replies come without waiting for
+        // the next beacon. A longer idleMs keeps the latency low for longer
+        // after every exchange; a shorter one saves more. The SDK only sleeps
+        // while loop() is in delay(), or the system has nothing to run.
+        bool setAutoSleep(WiFiSleepType_t idleType, uint32_t idleMs = 200, WiFiSleepType_t activeType = WIFI_NONE_SLEEP);
+        void stopAutoSleep();
+        // in light sleep, pin at level (LOW or HIGH) wakes the CPU up
+        void setSleepWakePin(uint8_t pin, uint8_t level);
+
         bool setPhyMode(WiFiPhyMode_t mode);
         WiFiPhyMode_t getPhyMode();
 
@@ -85,11 +106,30 @@ class ESP8266WiFiGenericClass {
         bool forceSleepBegin(uint32 sleepUs = 0);
         bool forceSleepWake();
 
+        // Turns the WiFi off and the CPU to light sleep for sleepUs, or with
+        // 0 until the next of the timed functions of Schedule.h is due (with
+        // schedule_set_coalesce_us(), the ones due close to it run in the
+        // same pass), or a level on the setSleepWakePin() pin. millis() and
+        // micros64() are corrected for the time the system timer stood
+        // still, as measured by the RTC; SDK timers (Ticker) are not, they
+        // are just late. Then restores the WiFi mode. Returns false if the
+        // time is shorter than WIFI_LIGHT_SLEEP_MIN_US, or the SDK refused.
+        bool lightSleep(uint32_t sleepUs = 0);
+
     protected:
         static bool _persistent;
         static WiFiMode_t _forceSleepLastMode;
+        static void _lightSleepWake();
+
+        static uint32_t _autoSleepIdleMs;
+        static WiFiSleepType_t _autoSleepIdleType;
+        static WiFiSleepType_t _autoSleepActiveType;
+        static uint32_t _autoSleepHandle;
+        static void _autoSleepCheck();
 
         static void _eventCallback(void *event);
+        static void _runScheduledEvents(void* arg);
+        static void _dispatchEvent(void* event);
 
         // ----------------------------------------------------------------------------------------------
         // ------------------------------------ Generic Network function --------------------------------
@@ -99,6 +139,9 @@ class ESP8266WiFiGenericClass {
 
         int hostByName(const char* aHostname, IPAddress& aResult);
         int hostByName(const char* aHostname, IPAddress& aResult, uint32_t timeout_ms);
+        // resolve in the background, answers are remembered for a while (see HOST_CACHE_TTL)
+        typedef std::function<void(const char* name, const IPAddress& ip)> THandlerFunction_HostByName;
+        bool hostByName(const char* aHostname, THandlerFunction_HostByName handler);
         bool getPersistent();
     protected:
 
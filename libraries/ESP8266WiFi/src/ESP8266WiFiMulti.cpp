@@ -27,7 +27,10 @@
 #include <limits.h>
 #include <string.h>
 
-ESP8266WiFiMulti::ESP8266WiFiMulti() {
+ESP8266WiFiMulti::ESP8266WiFiMulti()
+: _state(WIFI_MULTI_IDLE)
+, _connecting(-1)
+, _connectStart(0) {
 }
 
 ESP8266WiFiMulti::~ESP8266WiFiMulti() {
@@ -41,140 +44,157 @@ bool ESP8266WiFiMulti::addAP(const char* ssid, const char *passphrase) {
 wl_status_t ESP8266WiFiMulti::run(void) {
 
     wl_status_t status = WiFi.status();
-    if(status == WL_DISCONNECTED || status == WL_NO_SSID_AVAIL || status == WL_IDLE_STATUS || status == WL_CONNECT_FAILED) {
-
-        int8_t scanResult = WiFi.scanComplete();
-
-        if(scanResult == WIFI_SCAN_RUNNING) {
-            // scan is running, do nothing yet
-            status = WL_NO_SSID_AVAIL;
-            return status;
-        } 
-
-        if(scanResult == 0) {
-            // scan done, no ssids found. Start another scan.
-            DEBUG_WIFI_MULTI("[WIFI] scan done\n");
-            DEBUG_WIFI_MULTI("[WIFI] no networks found\n");
-            WiFi.scanDelete();
-            DEBUG_WIFI_MULTI("\n\n");
-            delay(0);
-            WiFi.disconnect();
-            DEBUG_WIFI_MULTI("[WIFI] start scan\n");
-            // scan wifi async mode
-            WiFi.scanNetworks(true);
-            return status;
-        } 
-
-        if(scanResult > 0) {
-            // scan done, analyze
-            WifiAPEntry bestNetwork { NULL, NULL };
-            int bestNetworkDb = INT_MIN;
-            uint8 bestBSSID[6];
-            int32_t bestChannel;
-
-            DEBUG_WIFI_MULTI("[WIFI] scan done\n");
-            delay(0);
-
-            DEBUG_WIFI_MULTI("[WIFI] %d networks found\n", scanResult);
-            for(int8_t i = 0; i < scanResult; ++i) {
-
-                String ssid_scan;
-                int32_t rssi_scan;
-                uint8_t sec_scan;
-                uint8_t* BSSID_scan;
-                int32_t chan_scan;
-                bool hidden_scan;
-
-                WiFi.getNetworkInfo(i, ssid_scan, sec_scan, rssi_scan, BSSID_scan, chan_scan, hidden_scan);
-
-                bool known = false;
-                for(auto entry : APlist) {
-                    if(ssid_scan == entry.ssid) { // SSID match
-                        known = true;
-                        if(rssi_scan > bestNetworkDb) { // best network
-                            if(sec_scan == ENC_TYPE_NONE || entry.passphrase) { // check for passphrase if not open wlan
-                                bestNetworkDb = rssi_scan;
-                                bestChannel = chan_scan;
-                                bestNetwork = entry;
-                                memcpy((void*) &bestBSSID, (void*) BSSID_scan, sizeof(bestBSSID));
-                            }
-                        }
-                        break;
-                    }
-                }
 
-                if(known) {
-                    DEBUG_WIFI_MULTI(" ---> ");
-                } else {
-                    DEBUG_WIFI_MULTI("      ");
-                }
-
-                DEBUG_WIFI_MULTI(" %d: [%d][%02X:%02X:%02X:%02X:%02X:%02X] %s (%d) %c\n", i, chan_scan, BSSID_scan[0], BSSID_scan[1], BSSID_scan[2], BSSID_scan[3], BSSID_scan[4], BSSID_scan[5], ssid_scan.c_str(), rssi_scan, (sec_scan == ENC_TYPE_NONE) ? ' ' : '*');
-                delay(0);
+    switch(_state) {
+        case WIFI_MULTI_CONNECTED:
+            if(status == WL_CONNECTED) {
+                break;
             }
+            DEBUG_WIFI_MULTI("[WIFI] connection lost (%d)\n", status);
+            _setState(WIFI_MULTI_IDLE);
+            // fall through
+        case WIFI_MULTI_IDLE:
+            if(status == WL_CONNECTED) {
+                // connected by someone else, or by the SDK on its own
+                _setState(WIFI_MULTI_CONNECTED);
+                break;
+            }
+            _startScan();
+            break;
+
+        case WIFI_MULTI_SCANNING: {
+            int8_t scanResult = WiFi.scanComplete();
+            if(scanResult == WIFI_SCAN_RUNNING) {
+                // scan is running, do nothing yet
+                status = WL_NO_SSID_AVAIL;
+                break;
+            }
+            if(scanResult > 0) {
+                _connectBest(scanResult);
+            } else {
+                // scan failed or found nothing, start another one on the next run()
+                DEBUG_WIFI_MULTI("[WIFI] scan done, no networks found (%d)\n", scanResult);
+                WiFi.scanDelete();
+                _setState(WIFI_MULTI_IDLE);
+            }
+            status = WiFi.status();
+            break;
+        }
 
-            // clean up ram
-            WiFi.scanDelete();
-
-            DEBUG_WIFI_MULTI("\n\n");
-            delay(0);
+        case WIFI_MULTI_CONNECTING:
+            if(status == WL_CONNECTED) {
+#ifdef DEBUG_ESP_WIFI
+                IPAddress ip = WiFi.localIP();
+                uint8_t * mac = WiFi.BSSID();
+                DEBUG_WIFI_MULTI("[WIFI] Connecting done.\n");
+                DEBUG_WIFI_MULTI("[WIFI] SSID: %s\n", WiFi.SSID().c_str());
+                DEBUG_WIFI_MULTI("[WIFI] IP: %d.%d.%d.%d\n", ip[0], ip[1], ip[2], ip[3]);
+                DEBUG_WIFI_MULTI("[WIFI] MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+                DEBUG_WIFI_MULTI("[WIFI] Channel: %d\n", WiFi.channel());
+#endif
+                APlist[_connecting].failures = 0;
+                _connecting = -1;
+                _setState(WIFI_MULTI_CONNECTED);
+                break;
+            }
+            if(status == WL_NO_SSID_AVAIL || status == WL_CONNECT_FAILED || millis() - _connectStart > connectTimeout) {
+                DEBUG_WIFI_MULTI("[WIFI] Connecting Failed (%d).\n", status);
+                if(APlist[_connecting].failures < UINT8_MAX) {
+                    ++APlist[_connecting].failures;
+                }
+                _connecting = -1;
+                _setState(WIFI_MULTI_IDLE);
+            }
+            break;
+    }
+    return status;
+}
 
-            if(bestNetwork.ssid) {
-                DEBUG_WIFI_MULTI("[WIFI] Connecting BSSID: %02X:%02X:%02X:%02X:%02X:%02X SSID: %s Channel: %d (%d)\n", bestBSSID[0], bestBSSID[1], bestBSSID[2], bestBSSID[3], bestBSSID[4], bestBSSID[5], bestNetwork.ssid, bestChannel, bestNetworkDb);
+void ESP8266WiFiMulti::_setState(WiFiMultiState state) {
+    if(_state == state) {
+        return;
+    }
+    _state = state;
+    if(_onStateChange) {
+        _onStateChange(state);
+    }
+}
 
-                WiFi.begin(bestNetwork.ssid, bestNetwork.passphrase, bestChannel, bestBSSID);
-                status = WiFi.status();
+void ESP8266WiFiMulti::_startScan() {
+    DEBUG_WIFI_MULTI("[WIFI] delete old wifi config...\n");
+    WiFi.disconnect();
+    DEBUG_WIFI_MULTI("[WIFI] start scan\n");
+    // scan wifi async mode, run() waits for it with scanComplete()
+    WiFi.scanNetworks(true);
+    _setState(WIFI_MULTI_SCANNING);
+}
 
-                static const uint32_t connectTimeout = 5000; //5s timeout
-                
-                auto startTime = millis();
-                // wait for connection, fail, or timeout
-                while(status != WL_CONNECTED && status != WL_NO_SSID_AVAIL && status != WL_CONNECT_FAILED && (millis() - startTime) <= connectTimeout) {
-                    delay(10);
-                    status = WiFi.status();
-                }
-                
-#ifdef DEBUG_ESP_WIFI
-                IPAddress ip;
-                uint8_t * mac;
-                switch(status) {
-                    case WL_CONNECTED:
-                        ip = WiFi.localIP();
-                        mac = WiFi.BSSID();
-                        DEBUG_WIFI_MULTI("[WIFI] Connecting done.\n");
-                        DEBUG_WIFI_MULTI("[WIFI] SSID: %s\n", WiFi.SSID().c_str());
-                        DEBUG_WIFI_MULTI("[WIFI] IP: %d.%d.%d.%d\n", ip[0], ip[1], ip[2], ip[3]);
-                        DEBUG_WIFI_MULTI("[WIFI] MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-                        DEBUG_WIFI_MULTI("[WIFI] Channel: %d\n", WiFi.channel());
-                        break;
-                    case WL_NO_SSID_AVAIL:
-                        DEBUG_WIFI_MULTI("[WIFI] Connecting Failed AP not found.\n");
-                        break;
-                    case WL_CONNECT_FAILED:
-                        DEBUG_WIFI_MULTI("[WIFI] Connecting Failed.\n");
-                        break;
-                    default:
-                        DEBUG_WIFI_MULTI("[WIFI] Connecting Failed (%d).\n", status);
-                        break;
+void ESP8266WiFiMulti::_connectBest(int8_t scanResult) {
+    int bestNetwork = -1;
+    int bestScore = INT_MIN;
+    int32_t bestRSSI = 0;
+    uint8 bestBSSID[6];
+    int32_t bestChannel = 0;
+
+    DEBUG_WIFI_MULTI("[WIFI] scan done\n");
+    DEBUG_WIFI_MULTI("[WIFI] %d networks found\n", scanResult);
+    for(int8_t i = 0; i < scanResult; ++i) {
+
+        String ssid_scan;
+        int32_t rssi_scan;
+        uint8_t sec_scan;
+        uint8_t* BSSID_scan;
+        int32_t chan_scan;
+        bool hidden_scan;
+
+        WiFi.getNetworkInfo(i, ssid_scan, sec_scan, rssi_scan, BSSID_scan, chan_scan, hidden_scan);
+
+        bool known = false;
+        for(size_t n = 0; n < APlist.size(); ++n) {
+            const WifiAPEntry& entry = APlist[n];
+            if(ssid_scan == entry.ssid) { // SSID match
+                known = true;
+                int score = rssi_scan - 10 * entry.failures;
+                if(score > bestScore) { // best network
+                    if(sec_scan == ENC_TYPE_NONE || entry.passphrase) { // check for passphrase if not open wlan
+                        bestScore = score;
+                        bestRSSI = rssi_scan;
+                        bestChannel = chan_scan;
+                        bestNetwork = n;
+                        memcpy((void*) &bestBSSID, (void*) BSSID_scan, sizeof(bestBSSID));
+                    }
                 }
-#endif
-            } else {
-                DEBUG_WIFI_MULTI("[WIFI] no matching wifi found!\n");
+                break;
             }
+        }
 
-            return status;
+        if(known) {
+            DEBUG_WIFI_MULTI(" ---> ");
+        } else {
+            DEBUG_WIFI_MULTI("      ");
         }
-       
-       
-        // scan failed, or some other condition not handled above. Start another scan.
-        DEBUG_WIFI_MULTI("[WIFI] delete old wifi config...\n");
-        WiFi.disconnect();
-
-        DEBUG_WIFI_MULTI("[WIFI] start scan\n");
-        // scan wifi async mode
-        WiFi.scanNetworks(true);
+
+        DEBUG_WIFI_MULTI(" %d: [%d][%02X:%02X:%02X:%02X:%02X:%02X] %s (%d) %c\n", i, chan_scan, BSSID_scan[0], BSSID_scan[1], BSSID_scan[2], BSSID_scan[3], BSSID_scan[4], BSSID_scan[5], ssid_scan.c_str(), rssi_scan, (sec_scan == ENC_TYPE_NONE) ? ' ' : '*');
     }
-    return status;
+
+    // clean up ram
+    WiFi.scanDelete();
+
+    DEBUG_WIFI_MULTI("\n\n");
+
+    if(bestNetwork < 0) {
+        DEBUG_WIFI_MULTI("[WIFI] no matching wifi found!\n");
+        _setState(WIFI_MULTI_IDLE);
+        return;
+    }
+
+    DEBUG_WIFI_MULTI("[WIFI] Connecting BSSID: %02X:%02X:%02X:%02X:%02X:%02X SSID: %s Channel: %d (%d)\n", bestBSSID[0], bestBSSID[1], bestBSSID[2], bestBSSID[3], bestBSSID[4], bestBSSID[5], APlist[bestNetwork].ssid, bestChannel, bestRSSI);
+    (void) bestRSSI;
+
+    WiFi.begin(APlist[bestNetwork].ssid, APlist[bestNetwork].passphrase, bestChannel, bestBSSID);
+    _connecting = bestNetwork;
+    _connectStart = millis();
+    _setState(WIFI_MULTI_CONNECTING);
 }
 
 // ##################################################################################
@@ -215,6 +235,7 @@ bool ESP8266WiFiMulti::APlistAdd(const char* ssid, const char *passphrase) {
         return false;
     }
 
+    newAP.failures = 0;
     APlist.push_back(newAP);
     DEBUG_WIFI_MULTI("[WIFI][APlistAdd] add SSID: %s\n", newAP.ssid);
     return true;
@@ -230,5 +251,6 @@ void ESP8266WiFiMulti::APlistClean(void) {
         }
     }
     APlist.clear();
+    _connecting = -1;
 }
 
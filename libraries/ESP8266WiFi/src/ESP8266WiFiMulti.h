@@ -29,6 +29,7 @@
 
 #include "ESP8266WiFi.h"
 #include <vector>
+#include <functional>
 
 #ifdef DEBUG_ESP_WIFI
 #ifdef DEBUG_ESP_PORT
@@ -43,24 +44,53 @@
 struct WifiAPEntry {
     char * ssid;
     char * passphrase;
+    uint8_t failures;   // connections that failed since the last good one
 };
 
 typedef std::vector<WifiAPEntry> WifiAPlist;
 
+enum WiFiMultiState {
+    WIFI_MULTI_IDLE,        // not connected, a scan starts on the next run()
+    WIFI_MULTI_SCANNING,
+    WIFI_MULTI_CONNECTING,
+    WIFI_MULTI_CONNECTED
+};
+
 class ESP8266WiFiMulti {
     public:
+        typedef std::function<void(WiFiMultiState state)> StateCallback;
+
         ESP8266WiFiMulti();
         ~ESP8266WiFiMulti();
 
         bool addAP(const char* ssid, const char *passphrase = NULL);
 
+        // Does the next step and returns at once: starts a scan when not
+        // connected, picks the best known network when it is done, and
+        // connects to its BSSID and channel, giving up after connectTimeout.
+        // Networks are ranked by RSSI, minus 10 dB for every connection to
+        // them that failed since the last good one.
         wl_status_t run(void);
 
+        WiFiMultiState state() const { return _state; }
+        // called on every change of state(), from run()
+        void onStateChange(StateCallback callback) { _onStateChange = callback; }
+
+        static const uint32_t connectTimeout = 5000;
+
     private:
         WifiAPlist APlist;
         bool APlistAdd(const char* ssid, const char *passphrase = NULL);
         void APlistClean(void);
 
+        void _setState(WiFiMultiState state);
+        void _startScan();
+        void _connectBest(int8_t scanResult);
+
+        WiFiMultiState _state;
+        StateCallback _onStateChange;
+        int _connecting;    // in APlist, -1 when not connecting
+        uint32_t _connectStart;
 };
 
 #endif /* WIFICLIENTMULTI_H_ */
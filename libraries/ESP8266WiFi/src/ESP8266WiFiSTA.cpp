@@ -41,6 +41,7 @@ extern "C" {
 }
 
 #include "debug.h"
+#include "Schedule.h"
 
 extern "C" void esp_schedule();
 extern "C" void esp_yield();
@@ -86,6 +87,11 @@ static bool sta_config_equal(const station_config& lhs, const station_config& rh
 // -----------------------------------------------------------------------------------------------------------------------
 
 bool ESP8266WiFiSTAClass::_useStaticIp = false;
+uint32_t ESP8266WiFiSTAClass::_quickOffset = 96;
+uint32_t ESP8266WiFiSTAClass::_quickId = 0;
+bool ESP8266WiFiSTAClass::_quickTrying = false;
+WiFiEventHandler ESP8266WiFiSTAClass::_quickGotIP;
+WiFiEventHandler ESP8266WiFiSTAClass::_quickDisconnected;
 
 /**
  * Start Wifi connection
@@ -203,6 +209,95 @@ wl_status_t ESP8266WiFiSTAClass::begin() {
     return status();
 }
 
+extern "C" uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t length);
+
+// of a saved connection, from after its crc field
+static uint32_t quick_crc(const void* quick, size_t size) {
+    return crc_update(0xffffffff, reinterpret_cast<const uint8_t*>(quick) + sizeof(uint32_t), size - sizeof(uint32_t));
+}
+
+/**
+ * Start Wifi connection with the channel, BSSID and IP of the last one, see beginQuick() in ESP8266WiFiSTA.h
+ * @param ssid const char*          Pointer to the SSID string.
+ * @param passphrase const char *   Optional. Passphrase.
+ * @param rtc_offset                Optional. Where in RTC user memory the last connection is saved, in 4 byte blocks
+ * @return wl_status_t
+ */
+wl_status_t ESP8266WiFiSTAClass::beginQuick(const char* ssid, const char* passphrase, uint32_t rtc_offset) {
+    if(!ssid) {
+        return WL_CONNECT_FAILED;
+    }
+    _quickOffset = rtc_offset;
+    _quickId = crc_update(0xffffffff, reinterpret_cast<const uint8_t*>(ssid), strlen(ssid));
+    if(passphrase) {
+        _quickId = crc_update(_quickId, reinterpret_cast<const uint8_t*>(passphrase), strlen(passphrase));
+    }
+    if(!_quickGotIP) {
+        _quickGotIP = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP&) { _quickSave(); });
+        _quickDisconnected = WiFi.onStationModeDisconnected([](const WiFiEventStationModeDisconnected&) {
+            if(_quickTrying) {
+                _quickTrying = false;
+                // not from the SDK event callback
+                schedule_function(_quickFallback);
+            }
+        });
+    }
+
+    static_assert(sizeof(QuickConnect) <= WIFI_QUICK_RTC_BLOCKS * 4, "QuickConnect doesn't fit in its area of RtcMemoryMap.h");
+    QuickConnect quick;
+    if(ESP.rtcUserMemoryRead(_quickOffset, reinterpret_cast<uint32_t*>(&quick), sizeof(quick)) &&
+            quick.crc == quick_crc(&quick, sizeof(quick)) && quick.id == _quickId) {
+        _quickTrying = true;
+        config(IPAddress(quick.ip), IPAddress(quick.gateway), IPAddress(quick.subnet), IPAddress(quick.dns1), IPAddress(quick.dns2));
+        return begin(ssid, passphrase, quick.channel, quick.bssid);
+    }
+    _quickTrying = false;
+    config(0U, 0U, 0U);
+    return begin(ssid, passphrase);
+}
+
+/**
+ * Drop the connection saved by beginQuick()
+ */
+void ESP8266WiFiSTAClass::forgetQuick() {
+    QuickConnect quick;
+    memset(&quick, 0, sizeof(quick));
+    ESP.rtcUserMemoryWrite(_quickOffset, reinterpret_cast<uint32_t*>(&quick), sizeof(quick));
+}
+
+void ESP8266WiFiSTAClass::_quickSave() {
+    _quickTrying = false;
+    QuickConnect quick;
+    memset(&quick, 0, sizeof(quick));
+    quick.id = _quickId;
+    memcpy(quick.bssid, WiFi.BSSID(), sizeof(quick.bssid));
+    quick.channel = wifi_get_channel();
+    struct ip_info info;
+    wifi_get_ip_info(STATION_IF, &info);
+    quick.ip = info.ip.addr;
+    quick.gateway = info.gw.addr;
+    quick.subnet = info.netmask.addr;
+    quick.dns1 = WiFi.dnsIP(0);
+    quick.dns2 = WiFi.dnsIP(1);
+    quick.crc = quick_crc(&quick, sizeof(quick));
+    ESP.rtcUserMemoryWrite(_quickOffset, reinterpret_cast<uint32_t*>(&quick), sizeof(quick));
+}
+
+void ESP8266WiFiSTAClass::_quickFallback() {
+    WiFi.forgetQuick();
+    struct station_config conf;
+    wifi_station_get_config(&conf);
+    // the passphrase may be a 64 character PSK, without a 0 at the end
+    char ssid[sizeof(conf.ssid) + 1];
+    char passphrase[sizeof(conf.password) + 1];
+    memcpy(ssid, conf.ssid, sizeof(conf.ssid));
+    ssid[sizeof(conf.ssid)] = 0;
+    memcpy(passphrase, conf.password, sizeof(conf.password));
+    passphrase[sizeof(conf.password)] = 0;
+    WiFi.config(0U, 0U, 0U);
+    WiFi.begin(ssid, passphrase);
+}
+
 /**
  * Change IP configuration settings disabling the dhcp client
  * @param local_ip   Static ip configuration
@@ -26,6 +26,7 @@
 
 #include "ESP8266WiFiType.h"
 #include "ESP8266WiFiGeneric.h"
+#include <RtcMemoryMap.h>
 
 
 class ESP8266WiFiSTAClass {
@@ -57,6 +58,18 @@ class ESP8266WiFiSTAClass {
 
         uint8_t waitForConnectResult();
 
+        // Like begin(ssid, passphrase), reusing the channel, the BSSID and the
+        // DHCP lease of the last connection to the same network, which are
+        // saved in RTC user memory from rtc_offset on (in 4 byte blocks, 9 of
+        // them) every time the station gets an IP address, so that they
+        // survive deep sleep. The lease is set as a static IP, without DHCP.
+        // If that connection fails, the saved data is dropped and a normal
+        // connection with scan and DHCP is made instead. The default offset,
+        // WIFI_QUICK_RTC_OFFSET, is blocks 86 to 94 (see RtcMemoryMap.h).
+        wl_status_t beginQuick(const char* ssid, const char* passphrase = NULL, uint32_t rtc_offset = WIFI_QUICK_RTC_OFFSET);
+        // drop the saved data, the next beginQuick() makes a normal connection
+        void forgetQuick();
+
         // STA network info
         IPAddress localIP();
 
@@ -86,6 +99,28 @@ class ESP8266WiFiSTAClass {
 
       static bool _useStaticIp;
 
+      struct QuickConnect {
+          uint32_t crc;
+          uint32_t id;        // of the SSID and passphrase
+          uint8_t bssid[6];
+          uint8_t channel;
+          uint8_t reserved;
+          uint32_t ip;
+          uint32_t gateway;
+          uint32_t subnet;
+          uint32_t dns1;
+          uint32_t dns2;
+      };
+
+      static uint32_t _quickOffset;
+      static uint32_t _quickId;
+      static bool _quickTrying;
+      static WiFiEventHandler _quickGotIP;
+      static WiFiEventHandler _quickDisconnected;
+
+      static void _quickSave();
+      static void _quickFallback();
+
     // ----------------------------------------------------------------------------------------------
     // ------------------------------------ STA remote configure  -----------------------------------
     // ----------------------------------------------------------------------------------------------
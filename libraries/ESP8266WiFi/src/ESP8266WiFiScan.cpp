@@ -57,6 +57,17 @@ bool ESP8266WiFiScanClass::_scanComplete = false;
 
 size_t ESP8266WiFiScanClass::_scanCount = 0;
 void* ESP8266WiFiScanClass::_scanResult = 0;
+uint8_t ESP8266WiFiScanClass::_scanFields = WIFI_SCAN_ALL;
+uint8_t ESP8266WiFiScanClass::_scanMax = 0;
+
+// a record of _scanResult
+#define SCAN_RSSI 0
+#define SCAN_CHANNEL 1
+#define SCAN_AUTHMODE 2
+#define SCAN_HIDDEN 3
+#define SCAN_BSSID 4    // if kept, then the SSID with its length and a 0, if kept
+
+static const uint8_t scan_no_bssid[6] = { 0 };
 
 std::function<void(int)> ESP8266WiFiScanClass::_onComplete;
 
@@ -131,18 +142,92 @@ int8_t ESP8266WiFiScanClass::scanComplete() {
     return WIFI_SCAN_FAILED;
 }
 
+static uint8_t scan_ssid_length(const bss_info* it) {
+    // ssid has no 0 at the end when it is 32 long
+    return it->ssid_len < sizeof(it->ssid) ? it->ssid_len : sizeof(it->ssid);
+}
+
+static size_t scan_record_size(const bss_info* it, uint8_t fields) {
+    size_t size = SCAN_BSSID;
+    if(fields & WIFI_SCAN_BSSID) {
+        size += sizeof(it->bssid);
+    }
+    if(fields & WIFI_SCAN_SSID) {
+        size += scan_ssid_length(it) + 2;
+    }
+    return size;
+}
+
+// whether a network is kept: with a max, when fewer than that are stronger
+static bool scan_kept(bss_info* head, const bss_info* it, uint8_t max) {
+    if(!max) {
+        return true;
+    }
+    size_t stronger = 0;
+    bool before = true;
+    for(bss_info* other = head; other; other = STAILQ_NEXT(other, next)) {
+        if(other == it) {
+            before = false;
+        } else if(other->rssi > it->rssi || (other->rssi == it->rssi && before)) {
+            ++stronger;
+        }
+    }
+    return stronger < max;
+}
+
 /**
  * delete last scan result from RAM
  */
 void ESP8266WiFiScanClass::scanDelete() {
     if(ESP8266WiFiScanClass::_scanResult) {
-        delete[] reinterpret_cast<bss_info*>(ESP8266WiFiScanClass::_scanResult);
+        free(ESP8266WiFiScanClass::_scanResult);
         ESP8266WiFiScanClass::_scanResult = 0;
         ESP8266WiFiScanClass::_scanCount = 0;
     }
     _scanComplete = false;
 }
 
+/**
+ * set what the next scans keep
+ * @param fields    WIFI_SCAN_SSID and/or WIFI_SCAN_BSSID
+ * @param maxCount  how many networks at most, the strongest ones, 0 for all
+ */
+void ESP8266WiFiScanClass::scanKeep(uint8_t fields, uint8_t maxCount) {
+    // the records of the last scan have the old fields
+    scanDelete();
+    _scanFields = fields;
+    _scanMax = maxCount;
+}
+
+/**
+ * call fn for every network of the last scan, until it returns false
+ * @param fn    bool fn(const WiFiScanResult&)
+ */
+void ESP8266WiFiScanClass::scanForEach(std::function<bool(const WiFiScanResult&)> fn) {
+    WiFiScanResult result;
+    for(size_t i = 0; i < _scanCount; ++i) {
+        if(!_getScanResult(i, result) || !fn(result)) {
+            break;
+        }
+    }
+}
+
+static uint8_t scan_encryption_type(uint8_t authmode) {
+    switch(authmode) {
+        case AUTH_OPEN:
+            return ENC_TYPE_NONE;
+        case AUTH_WEP:
+            return ENC_TYPE_WEP;
+        case AUTH_WPA_PSK:
+            return ENC_TYPE_TKIP;
+        case AUTH_WPA2_PSK:
+            return ENC_TYPE_CCMP;
+        case AUTH_WPA_WPA2_PSK:
+            return ENC_TYPE_AUTO;
+        default:
+            return -1;
+    }
+}
 
 /**
  * loads all infos from a scanned wifi in to the ptr parameters
@@ -156,17 +241,17 @@ void ESP8266WiFiScanClass::scanDelete() {
  * @return (true if ok)
  */
 bool ESP8266WiFiScanClass::getNetworkInfo(uint8_t i, String &ssid, uint8_t &encType, int32_t &rssi, uint8_t* &bssid, int32_t &channel, bool &isHidden) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
-    if(!it) {
+    WiFiScanResult result;
+    if(!_getScanResult(i, result)) {
         return false;
     }
 
-    ssid = (const char*) it->ssid;
-    encType = encryptionType(i);
-    rssi = it->rssi;
-    bssid = it->bssid; // move ptr
-    channel = it->channel;
-    isHidden = (it->is_hidden != 0);
+    ssid = result.ssid;
+    encType = result.encryptionType;
+    rssi = result.rssi;
+    bssid = const_cast<uint8_t*>(result.bssid); // move ptr
+    channel = result.channel;
+    isHidden = result.isHidden;
 
     return true;
 }
@@ -178,12 +263,12 @@ bool ESP8266WiFiScanClass::getNetworkInfo(uint8_t i, String &ssid, uint8_t &encT
  * @return       ssid string of the specified item on the networks scanned list
  */
 String ESP8266WiFiScanClass::SSID(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
-    if(!it) {
+    WiFiScanResult result;
+    if(!_getScanResult(i, result)) {
         return "";
     }
 
-    return String(reinterpret_cast<const char*>(it->ssid));
+    return String(result.ssid);
 }
 
 
@@ -193,25 +278,11 @@ String ESP8266WiFiScanClass::SSID(uint8_t i) {
  * @return  encryption type (enum wl_enc_type) of the specified item on the networks scanned list
  */
 uint8_t ESP8266WiFiScanClass::encryptionType(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const uint8_t* it = _getScanInfoByIndex(i);
     if(!it) {
         return -1;
     }
-
-    switch(it->authmode) {
-        case AUTH_OPEN:
-            return ENC_TYPE_NONE;
-        case AUTH_WEP:
-            return ENC_TYPE_WEP;
-        case AUTH_WPA_PSK:
-            return ENC_TYPE_TKIP;
-        case AUTH_WPA2_PSK:
-            return ENC_TYPE_CCMP;
-        case AUTH_WPA_WPA2_PSK:
-            return ENC_TYPE_AUTO;
-        default:
-            return -1;
-    }
+    return scan_encryption_type(it[SCAN_AUTHMODE]);
 }
 
 /**
@@ -220,11 +291,11 @@ uint8_t ESP8266WiFiScanClass::encryptionType(uint8_t i) {
  * @return  signed value of RSSI of the specified item on the networks scanned list
  */
 int32_t ESP8266WiFiScanClass::RSSI(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const uint8_t* it = _getScanInfoByIndex(i);
     if(!it) {
         return 0;
     }
-    return it->rssi;
+    return (int8_t) it[SCAN_RSSI];
 }
 
 
@@ -234,11 +305,11 @@ int32_t ESP8266WiFiScanClass::RSSI(uint8_t i) {
  * @return uint8_t * MAC / BSSID of scanned wifi
  */
 uint8_t * ESP8266WiFiScanClass::BSSID(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
-    if(!it) {
+    WiFiScanResult result;
+    if(!_getScanResult(i, result)) {
         return 0;
     }
-    return it->bssid;
+    return const_cast<uint8_t*>(result.bssid);
 }
 
 /**
@@ -248,20 +319,21 @@ uint8_t * ESP8266WiFiScanClass::BSSID(uint8_t i) {
  */
 String ESP8266WiFiScanClass::BSSIDstr(uint8_t i) {
     char mac[18] = { 0 };
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
-    if(!it) {
+    WiFiScanResult result;
+    if(!_getScanResult(i, result)) {
         return String("");
     }
-    sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", it->bssid[0], it->bssid[1], it->bssid[2], it->bssid[3], it->bssid[4], it->bssid[5]);
+    const uint8_t* bssid = result.bssid;
+    sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
     return String(mac);
 }
 
 int32_t ESP8266WiFiScanClass::channel(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const uint8_t* it = _getScanInfoByIndex(i);
     if(!it) {
         return 0;
     }
-    return it->channel;
+    return it[SCAN_CHANNEL];
 }
 
 /**
@@ -270,11 +342,11 @@ int32_t ESP8266WiFiScanClass::channel(uint8_t i) {
  * @return bool (true == hidden)
  */
 bool ESP8266WiFiScanClass::isHidden(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const uint8_t* it = _getScanInfoByIndex(i);
     if(!it) {
         return false;
     }
-    return (it->is_hidden != 0);
+    return (it[SCAN_HIDDEN] != 0);
 }
 
 /**
@@ -284,27 +356,53 @@ bool ESP8266WiFiScanClass::isHidden(uint8_t i) {
  * @param status STATUS
  */
 void ESP8266WiFiScanClass::_scanDone(void* result, int status) {
-    if(status != OK) {
-        ESP8266WiFiScanClass::_scanCount = 0;
-        ESP8266WiFiScanClass::_scanResult = 0;
-    } else {
+    ESP8266WiFiScanClass::_scanCount = 0;
+    ESP8266WiFiScanClass::_scanResult = 0;
+    if(status == OK) {
 
-        int i = 0;
         bss_info* head = reinterpret_cast<bss_info*>(result);
 
-        for(bss_info* it = head; it; it = STAILQ_NEXT(it, next), ++i)
-            ;
-        ESP8266WiFiScanClass::_scanCount = i;
-        if(i == 0) {
-            ESP8266WiFiScanClass::_scanResult = 0;
-        } else {
-            bss_info* copied_info = new bss_info[i];
-            i = 0;
-            for(bss_info* it = head; it; it = STAILQ_NEXT(it, next), ++i) {
-                memcpy(copied_info + i, it, sizeof(bss_info));
+        // the records of the networks kept, the strongest ones with _scanMax
+        size_t count = 0;
+        size_t size = 0;
+        for(bss_info* it = head; it; it = STAILQ_NEXT(it, next)) {
+            if(scan_kept(head, it, _scanMax)) {
+                ++count;
+                size += scan_record_size(it, _scanFields);
+            }
+        }
+        if(count) {
+            uint8_t* copied_info = reinterpret_cast<uint8_t*>(malloc(count * sizeof(uint16_t) + size));
+            if(copied_info) {
+                uint16_t* offsets = reinterpret_cast<uint16_t*>(copied_info);
+                size_t offset = count * sizeof(uint16_t);
+                size_t i = 0;
+                for(bss_info* it = head; it; it = STAILQ_NEXT(it, next)) {
+                    if(!scan_kept(head, it, _scanMax)) {
+                        continue;
+                    }
+                    offsets[i++] = offset;
+                    uint8_t* record = copied_info + offset;
+                    record[SCAN_RSSI] = (uint8_t) it->rssi;
+                    record[SCAN_CHANNEL] = it->channel;
+                    record[SCAN_AUTHMODE] = it->authmode;
+                    record[SCAN_HIDDEN] = it->is_hidden;
+                    uint8_t* p = record + SCAN_BSSID;
+                    if(_scanFields & WIFI_SCAN_BSSID) {
+                        memcpy(p, it->bssid, sizeof(it->bssid));
+                        p += sizeof(it->bssid);
+                    }
+                    if(_scanFields & WIFI_SCAN_SSID) {
+                        uint8_t len = scan_ssid_length(it);
+                        *p++ = len;
+                        memcpy(p, it->ssid, len);
+                        p[len] = 0;
+                    }
+                    offset += scan_record_size(it, _scanFields);
+                }
+                ESP8266WiFiScanClass::_scanCount = count;
+                ESP8266WiFiScanClass::_scanResult = copied_info;
             }
-
-            ESP8266WiFiScanClass::_scanResult = copied_info;
         }
 
     }
@@ -323,11 +421,39 @@ void ESP8266WiFiScanClass::_scanDone(void* result, int status) {
 /**
  *
  * @param i specify from which network item want to get the information
- * @return bss_info *
+ * @return the record of the network
  */
-void * ESP8266WiFiScanClass::_getScanInfoByIndex(int i) {
-    if(!ESP8266WiFiScanClass::_scanResult || (size_t) i > ESP8266WiFiScanClass::_scanCount) {
+const uint8_t* ESP8266WiFiScanClass::_getScanInfoByIndex(int i) {
+    if(!ESP8266WiFiScanClass::_scanResult || i < 0 || (size_t) i >= ESP8266WiFiScanClass::_scanCount) {
         return 0;
     }
-    return reinterpret_cast<bss_info*>(ESP8266WiFiScanClass::_scanResult) + i;
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(ESP8266WiFiScanClass::_scanResult);
+    return base + reinterpret_cast<const uint16_t*>(base)[i];
+}
+
+/**
+ * @param i specify from which network item want to get the information
+ * @param result    of the network
+ * @return (true if ok)
+ */
+bool ESP8266WiFiScanClass::_getScanResult(int i, WiFiScanResult& result) {
+    const uint8_t* it = _getScanInfoByIndex(i);
+    if(!it) {
+        return false;
+    }
+    const uint8_t* p = it + SCAN_BSSID;
+    result.bssid = scan_no_bssid;
+    result.ssid = "";
+    if(_scanFields & WIFI_SCAN_BSSID) {
+        result.bssid = p;
+        p += sizeof(scan_no_bssid);
+    }
+    if(_scanFields & WIFI_SCAN_SSID) {
+        result.ssid = reinterpret_cast<const char*>(p + 1);
+    }
+    result.rssi = (int8_t) it[SCAN_RSSI];
+    result.channel = it[SCAN_CHANNEL];
+    result.encryptionType = scan_encryption_type(it[SCAN_AUTHMODE]);
+    result.isHidden = (it[SCAN_HIDDEN] != 0);
+    return true;
 }
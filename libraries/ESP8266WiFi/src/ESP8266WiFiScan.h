@@ -26,6 +26,23 @@
 #include "ESP8266WiFiType.h"
 #include "ESP8266WiFiGeneric.h"
 
+// what scans keep of every network, besides RSSI, channel, encryption and hidden
+enum WiFiScanFields {
+    WIFI_SCAN_SSID = 1,
+    WIFI_SCAN_BSSID = 2,
+    WIFI_SCAN_ALL = WIFI_SCAN_SSID | WIFI_SCAN_BSSID
+};
+
+// one network of the last scan, valid until the next one or scanDelete()
+struct WiFiScanResult {
+    const char* ssid;       // "" when not kept
+    const uint8_t* bssid;   // all 0 when not kept
+    int32_t rssi;
+    int32_t channel;
+    uint8_t encryptionType;
+    bool isHidden;
+};
+
 class ESP8266WiFiScanClass {
 
         // ----------------------------------------------------------------------------------------------
@@ -40,6 +57,15 @@ class ESP8266WiFiScanClass {
         int8_t scanComplete();
         void scanDelete();
 
+        // The fields the next scans keep, and how many of the networks
+        // found, the strongest ones (0 for all); drops the last results.
+        // Every network takes 6 bytes, 6 more with the BSSID and the
+        // length of the SSID plus 2 with it.
+        void scanKeep(uint8_t fields, uint8_t maxCount = 0);
+        // fn for every network of the last scan, in order, until it returns
+        // false; nothing is copied
+        void scanForEach(std::function<bool(const WiFiScanResult&)> fn);
+
         // scan result
         bool getNetworkInfo(uint8_t networkItem, String &ssid, uint8_t &encryptionType, int32_t &RSSI, uint8_t* &BSSID, int32_t &channel, bool &isHidden);
 
@@ -58,12 +84,16 @@ class ESP8266WiFiScanClass {
         static bool _scanComplete;
 
         static size_t _scanCount;
+        // uint16_t offsets of the _scanCount records, then the records
         static void* _scanResult;
+        static uint8_t _scanFields;
+        static uint8_t _scanMax;
 
         static std::function<void(int)> _onComplete;
 
         static void _scanDone(void* result, int status);
-        static void * _getScanInfoByIndex(int i);
+        static const uint8_t* _getScanInfoByIndex(int i);
+        static bool _getScanResult(int i, WiFiScanResult& result);
 
 };
 
@@ -0,0 +1,133 @@
+/*
+  TrustStore.h - CA certificates kept in flash for WiFiClientSecure
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TRUSTSTORE_H
+#define TRUSTSTORE_H
+
+#include <Arduino.h>
+
+// A bundle of DER certificates with an index by subject, as written by
+// tools/trust_store.py. Certificates stay where the bundle is (PROGMEM or
+// a file); when verifying a server, WiFiClientSecure only reads and loads
+// those whose subject matches the issuer of the server's certificate.
+//
+// Layout, all numbers little endian:
+//   "TSv1", uint16_t count, uint16_t reserved,
+//   count times { uint32_t subjectHash, uint32_t offset, uint32_t length },
+//   the certificates.
+// subjectHash is the FNV-1a hash of the subject common name, or of its
+// organization if it has no common name.
+class TrustStore
+{
+public:
+    virtual ~TrustStore() {}
+
+    static uint32_t hash(const char* name)
+    {
+        uint32_t h = 2166136261u;
+        while (name && *name) {
+            h = (h ^ (uint8_t) *name++) * 16777619u;
+        }
+        return h;
+    }
+
+    size_t count()
+    {
+        uint8_t head[8];
+        if (!_read(0, head, sizeof(head)) || memcmp(head, "TSv1", 4)) {
+            return 0;
+        }
+        return head[4] | (head[5] << 8);
+    }
+
+    // Index of the first certificate at or after start whose subject has
+    // the hash, -1 if there is none. Its length goes to length.
+    int find(uint32_t subjectHash, size_t start, size_t& length)
+    {
+        size_t n = count();
+        for (size_t i = start; i < n; ++i) {
+            uint8_t entry[12];
+            if (!_read(8 + 12 * i, entry, sizeof(entry))) {
+                return -1;
+            }
+            if (_u32(entry) == subjectHash) {
+                length = _u32(entry + 8);
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Copy certificate index (length as returned by find()) to buf.
+    bool read(size_t index, uint8_t* buf, size_t length)
+    {
+        uint8_t entry[12];
+        if (index >= count() || !_read(8 + 12 * index, entry, sizeof(entry)) || _u32(entry + 8) != length) {
+            return false;
+        }
+        return _read(_u32(entry + 4), buf, length);
+    }
+
+protected:
+    virtual bool _read(size_t offset, uint8_t* buf, size_t length) = 0;
+
+    static uint32_t _u32(const uint8_t* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+    }
+};
+
+// Bundle compiled into flash
+class ProgmemTrustStore : public TrustStore
+{
+public:
+    ProgmemTrustStore(PGM_VOID_P data, size_t size) : _data((const uint8_t*) data), _size(size) {}
+
+protected:
+    bool _read(size_t offset, uint8_t* buf, size_t length) override
+    {
+        if (offset + length > _size) {
+            return false;
+        }
+        memcpy_P(buf, _data + offset, length);
+        return true;
+    }
+
+    const uint8_t* _data;
+    size_t _size;
+};
+
+// Bundle in a file, e.g. on SPIFFS; the file has to stay open
+template<typename TFile>
+class FileTrustStore : public TrustStore
+{
+public:
+    FileTrustStore(TFile& file) : _file(file) {}
+
+protected:
+    bool _read(size_t offset, uint8_t* buf, size_t length) override
+    {
+        return _file.seek(offset) && _file.read(buf, length) == length;
+    }
+
+    TFile& _file;
+};
+
+#endif //TRUSTSTORE_H
@@ -0,0 +1,139 @@
+/*
+  UdpMulticast.cpp - UDP sockets shared by the multicast based responders
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define LWIP_INTERNAL
+
+#include "debug.h"
+#include "ESP8266WiFi.h"
+#include "lwip/opt.h"
+#include "lwip/udp.h"
+#include "lwip/inet.h"
+#include "lwip/igmp.h"
+#include "include/UdpContext.h"
+#include "include/UdpMulticast.h"
+
+struct UdpMulticast::Port {
+    uint16_t    port;
+    UdpContext* ctx;
+    Port*       next;
+};
+
+struct UdpMulticast::Subscriber {
+    const void* owner;
+    Port*       port;
+    uint32_t    group;
+    handler_t   handler;
+    filter_t    filter;
+    Subscriber* next;
+};
+
+UdpMulticast::Port* UdpMulticast::_ports = nullptr;
+UdpMulticast::Subscriber* UdpMulticast::_subscribers = nullptr;
+
+UdpContext* UdpMulticast::subscribe(const void* owner, uint32_t group, uint16_t port,
+                                    handler_t handler, filter_t filter)
+{
+    ip_addr_t group_addr;
+    group_addr.addr = group;
+    if (group && igmp_joingroup(IP_ADDR_ANY, &group_addr) != ERR_OK) {
+        DEBUGV("UM: join failed\r\n");
+        return nullptr;
+    }
+
+    Port* p = _ports;
+    while (p && p->port != port)
+        p = p->next;
+    if (!p) {
+        UdpContext* ctx = new UdpContext;
+        ctx->ref();
+        if (!ctx->listen(*IP_ADDR_ANY, port)) {
+            ctx->unref();
+            if (group)
+                igmp_leavegroup(IP_ADDR_ANY, &group_addr);
+            return nullptr;
+        }
+        p = new Port { port, ctx, _ports };
+        _ports = p;
+        ctx->onRx(std::bind(&UdpMulticast::_dispatch, p));
+    }
+
+    _subscribers = new Subscriber { owner, p, group, handler, filter, _subscribers };
+    return p->ctx;
+}
+
+void UdpMulticast::unsubscribe(const void* owner)
+{
+    for (Subscriber** link = &_subscribers; *link; ) {
+        Subscriber* s = *link;
+        if (s->owner != owner) {
+            link = &s->next;
+            continue;
+        }
+        *link = s->next;
+        if (s->group) {
+            ip_addr_t group_addr;
+            group_addr.addr = s->group;
+            igmp_leavegroup(IP_ADDR_ANY, &group_addr);
+        }
+        Port* p = s->port;
+        delete s;
+
+        bool used = false;
+        for (Subscriber* t = _subscribers; t && !used; t = t->next)
+            used = t->port == p;
+        if (!used) {
+            for (Port** plink = &_ports; *plink; plink = &(*plink)->next) {
+                if (*plink == p) {
+                    *plink = p->next;
+                    break;
+                }
+            }
+            p->ctx->onRx(nullptr);
+            p->ctx->unref();
+            delete p;
+        }
+    }
+}
+
+void UdpMulticast::dispatch(uint16_t port)
+{
+    for (Port* p = _ports; p; p = p->next) {
+        if (p->port == port) {
+            _dispatch(p);
+            return;
+        }
+    }
+}
+
+void UdpMulticast::_dispatch(Port* port)
+{
+    UdpContext* ctx = port->ctx;
+    while (ctx->next()) {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(ctx->peekBuffer());
+        size_t size = ctx->getSize();
+        for (Subscriber* s = _subscribers; s; s = s->next) {
+            if (s->port == port && (!s->filter || s->filter(data, size))) {
+                ctx->seek(0);
+                s->handler(*ctx);
+            }
+        }
+        ctx->flush();
+    }
+}
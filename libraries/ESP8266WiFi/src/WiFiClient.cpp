@@ -38,6 +38,11 @@ extern "C"
 #include "lwip/tcp.h"
 #include "lwip/inet.h"
 #include "lwip/netif.h"
+#if LWIP_VERSION_MAJOR == 1
+#include "lwip/tcp_impl.h"
+#else
+#include "lwip/priv/tcp_priv.h"
+#endif
 #include "include/ClientContext.h"
 #include "c_types.h"
 
@@ -108,6 +113,16 @@ int WiFiClient::connect(const String host, uint16_t port)
 }
 
 int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+    return _connect(ip, port, false);
+}
+
+int WiFiClient::connectAsync(IPAddress ip, uint16_t port)
+{
+    return _connect(ip, port, true);
+}
+
+int WiFiClient::_connect(IPAddress ip, uint16_t port, bool async)
 {
     ip_addr_t addr;
     addr.addr = ip;
@@ -140,7 +155,7 @@ int WiFiClient::connect(IPAddress ip, uint16_t port)
     _client = new ClientContext(pcb, nullptr, nullptr);
     _client->ref();
     _client->setTimeout(_timeout);
-    int res = _client->connect(&addr, port);
+    int res = async ? _client->connectAsync(&addr, port) : _client->connect(&addr, port);
     if (res == 0) {
         _client->unref();
         _client = nullptr;
@@ -156,12 +171,144 @@ void WiFiClient::setNoDelay(bool nodelay) {
     _client->setNoDelay(nodelay);
 }
 
+void WiFiClient::setCork(bool cork) {
+    if (!_client)
+        return;
+    _client->setCork(cork);
+}
+
+bool WiFiClient::getCork() {
+    if (!_client)
+        return false;
+    return _client->getCork();
+}
+
 bool WiFiClient::getNoDelay() {
     if (!_client)
         return false;
     return _client->getNoDelay();
 }
 
+void WiFiClient::setWriteChunkSize(size_t size) {
+    if (!_client)
+        return;
+    _client->setWriteChunkSize(size);
+}
+
+size_t WiFiClient::getWriteChunkSize() {
+    if (!_client)
+        return 0;
+    return _client->getWriteChunkSize();
+}
+
+void WiFiClient::setAsync(bool async) {
+    if (!_client)
+        return;
+    _client->setAsync(async);
+}
+
+bool WiFiClient::getAsync() {
+    if (!_client)
+        return false;
+    return _client->getAsync();
+}
+
+void WiFiClient::onSent(THandlerFunction_Sent handler) {
+    if (!_client)
+        return;
+    _client->onSent(handler);
+}
+
+void WiFiClient::onData(THandlerFunction handler) {
+    if (!_client)
+        return;
+    _client->onData(handler);
+}
+
+void WiFiClient::onDisconnect(THandlerFunction handler) {
+    if (!_client)
+        return;
+    _client->onDisconnect(handler);
+}
+
+void WiFiClient::setRxBufferLimit(size_t bytes) {
+    if (!_client)
+        return;
+    _client->setRxBufferLimit(bytes);
+}
+
+size_t WiFiClient::getRxBufferLimit() {
+    if (!_client)
+        return 0;
+    return _client->getRxBufferLimit();
+}
+
+void WiFiClient::setRxBufferTotalLimit(size_t bytes) {
+    ClientContext::rxBufferTotal().limit = bytes;
+}
+
+void WiFiClient::setProfile(const TcpProfile& profile) {
+    if (!_client)
+        return;
+    _client->setProfile(profile);
+}
+
+TcpProfile WiFiClient::getProfile() {
+    if (!_client)
+        return TcpProfile();
+    return _client->getProfile();
+}
+
+void WiFiClient::setDefaultProfile(const TcpProfile& profile) {
+    ClientContext::defaultProfile() = profile;
+}
+
+TcpProfile WiFiClient::getDefaultProfile() {
+    return ClientContext::defaultProfile();
+}
+
+bool WiFiClient::reserveContexts(size_t count) {
+    return ClientContext::pool_t::reserve(count);
+}
+
+ContextPoolStats WiFiClient::contextPoolStats() {
+    return ClientContext::pool_t::stats();
+}
+
+TcpStats WiFiClient::getStats() {
+    if (!_client)
+        return TcpStats();
+    return _client->getStats();
+}
+
+LwipStats WiFiClient::lwipStats() {
+    LwipStats stats = LwipStats();
+    for (tcp_pcb* pcb = tcp_active_pcbs; pcb; pcb = pcb->next) {
+        ++stats.tcpActive;
+        stats.sndQueued += pcb->snd_queuelen;
+    }
+    for (tcp_pcb* pcb = tcp_tw_pcbs; pcb; pcb = pcb->next) {
+        ++stats.tcpTimeWait;
+    }
+    // several WiFiClients can share a connection, count each once
+    for (WiFiClient* it = _s_first; it; it = it->_next) {
+        if (!it->_client)
+            continue;
+        WiFiClient* first = _s_first;
+        while (first->_client != it->_client)
+            first = first->_next;
+        if (first != it)
+            continue;
+        TcpStats client = it->_client->getStats();
+        ++stats.clients;
+        stats.rxPbufs += client.rxPbufs;
+        stats.rxBuffered += client.rxBuffered;
+    }
+    stats.rxBufferedTotal = ClientContext::rxBufferTotal().buffered;
+    stats.heapFree = ESP.getFreeHeap();
+    return stats;
+}
+
 size_t WiFiClient::availableForWrite ()
 {
     return _client? _client->availableForWrite(): 0;
@@ -198,6 +345,16 @@ size_t WiFiClient::write(Stream& stream)
     return _client->write(stream);
 }
 
+size_t WiFiClient::write(fs::File& file)
+{
+    if (!_client || !file.available())
+    {
+        return 0;
+    }
+    _client->setTimeout(_timeout);
+    return _client->write(file);
+}
+
 size_t WiFiClient::write_P(PGM_P buf, size_t size)
 {
     if (!_client || !size)
@@ -208,6 +365,35 @@ size_t WiFiClient::write_P(PGM_P buf, size_t size)
     return _client->write_P(buf, size);
 }
 
+size_t WiFiClient::writev(const IOVec* parts, size_t count)
+{
+    if (!_client || !count)
+    {
+        return 0;
+    }
+    DataSource** sources = new DataSource*[count];
+    bool async = true;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const IOVec& part = parts[i];
+        async = async && part.type != IOVec::STREAM;
+        switch (part.type)
+        {
+        case IOVec::RAM:
+            sources[i] = new BufferDataSource((const uint8_t*) part.data, part.size);
+            break;
+        case IOVec::FLASH:
+            sources[i] = new ProgmemDataSource((PGM_P) part.data, part.size);
+            break;
+        case IOVec::STREAM:
+            sources[i] = new BufferedStreamDataSource<Stream>(*(Stream*) part.data, part.size);
+            break;
+        }
+    }
+    _client->setTimeout(_timeout);
+    return _client->write(new ChainedDataSource(sources, count), async);
+}
+
 int WiFiClient::available()
 {
     if (!_client)
@@ -235,6 +421,28 @@ int WiFiClient::read(uint8_t* buf, size_t size)
     return (int) _client->read(reinterpret_cast<char*>(buf), size);
 }
 
+size_t WiFiClient::readBytes(char* buffer, size_t length)
+{
+    size_t count = 0;
+    unsigned long start = millis();
+    while (count < length) {
+        int avail = available();
+        if (avail > 0) {
+            int got = read(reinterpret_cast<uint8_t*>(buffer) + count, std::min(length - count, (size_t) avail));
+            if (got > 0) {
+                count += got;
+                start = millis();
+            }
+            continue;
+        }
+        if (!connected() || millis() - start >= _timeout) {
+            break;
+        }
+        yield();
+    }
+    return count;
+}
+
 int WiFiClient::peek()
 {
     if (!available())
@@ -264,10 +472,39 @@ size_t WiFiClient::peekBytes(uint8_t *buffer, size_t length) {
     return _client->peekBytes((char *)buffer, count);
 }
 
-void WiFiClient::flush()
+const char* WiFiClient::peekBuffer()
+{
+    if (!_client)
+        return nullptr;
+
+    return _client->peekBuffer();
+}
+
+size_t WiFiClient::peekAvailable()
+{
+    if (!_client)
+        return 0;
+
+    size_t result = _client->peekAvailable();
+
+    if (!result) {
+        optimistic_yield(100);
+    }
+    return result;
+}
+
+void WiFiClient::peekConsume(size_t consume)
 {
     if (_client)
+        _client->peekConsume(consume);
+}
+
+void WiFiClient::flush()
+{
+    if (_client) {
+        _client->flush();
         _client->wait_until_sent();
+    }
 }
 
 void WiFiClient::stop()
@@ -22,11 +22,15 @@
 #ifndef wificlient_h
 #define wificlient_h
 #include <memory>
+#include <functional>
 #include "Arduino.h"
 #include "Print.h"
 #include "Client.h"
 #include "IPAddress.h"
 #include "include/slist.h"
+#include "include/ContextPool.h"
+#include "include/TcpStats.h"
+#include "include/TcpProfile.h"
 
 #define WIFICLIENT_MAX_PACKET_SIZE 1460
 
@@ -37,6 +41,10 @@
 class ClientContext;
 class WiFiServer;
 
+namespace fs {
+class File;
+}
+
 class WiFiClient : public Client, public SList<WiFiClient> {
 protected:
   WiFiClient(ClientContext* client);
@@ -51,10 +59,32 @@ public:
   virtual int connect(IPAddress ip, uint16_t port);
   virtual int connect(const char *host, uint16_t port);
   virtual int connect(const String host, uint16_t port);
+  // start connecting and return at once, 0 if that is not possible;
+  // connected() turns true when established, which is also when the
+  // onSent() handler is called with 0, and failure shows as onDisconnect()
+  int connectAsync(IPAddress ip, uint16_t port);
   virtual size_t write(uint8_t);
   virtual size_t write(const uint8_t *buf, size_t size);
   virtual size_t write_P(PGM_P buf, size_t size);
   size_t write(Stream& stream);
+  // reads from the memory mapped flash where it can, see File::mapped()
+  size_t write(fs::File& file);
+
+  // one part of a vectored write, see writev()
+  struct IOVec {
+    enum Type : uint8_t { RAM, FLASH, STREAM };
+    IOVec(const uint8_t* buf, size_t size) : type(RAM), data(buf), size(size) {}
+    IOVec(const char* buf, size_t size) : type(RAM), data(buf), size(size) {}
+    IOVec(const String& str) : type(RAM), data(str.c_str()), size(str.length()) {}
+    IOVec(Stream& stream, size_t size) : type(STREAM), data(&stream), size(size) {}
+    static IOVec P(PGM_P buf, size_t size) { IOVec v(buf, size); v.type = FLASH; return v; }
+
+    Type        type;
+    const void* data;   // buffer or Stream*
+    size_t      size;
+  };
+  // send several buffers as one contiguous stream, packed into full segments
+  virtual size_t writev(const IOVec* parts, size_t count);
 
   // This one is deprecated, use write(Stream& instead)
   size_t write(Stream& stream, size_t unitSize) __attribute__ ((deprecated));
@@ -62,11 +92,31 @@ public:
   virtual int available();
   virtual int read();
   virtual int read(uint8_t *buf, size_t size);
+  // copies whole segments at a time, waiting as Stream::readBytes() does
+  size_t readBytes(char *buffer, size_t length) override;
+  size_t readBytes(uint8_t *buffer, size_t length) override {
+    return readBytes((char *) buffer, length);
+  }
   virtual int peek();
   virtual size_t peekBytes(uint8_t *buffer, size_t length);
   size_t peekBytes(char *buffer, size_t length) {
     return peekBytes((uint8_t *) buffer, length);
   }
+
+  // once closed, what was received is all there will be
+  bool inputCanTimeout() override {
+    return connected();
+  }
+
+  // zero-copy access to the received data of the current segment:
+  // peekBuffer() is valid for peekAvailable() bytes until peekConsume() or read()
+  bool hasPeekBufferAPI() const override {
+    return true;
+  }
+  const char* peekBuffer() override;
+  size_t peekAvailable() override;
+  void peekConsume(size_t consume) override;
+
   virtual void flush();
   virtual void stop();
   virtual uint8_t connected();
@@ -78,10 +128,46 @@ public:
   uint16_t  localPort();
   bool getNoDelay();
   void setNoDelay(bool nodelay);
+  // Corked, what is written is held until flush() (or a full send buffer)
+  // and then goes out in full segments: for a response made of many
+  // print()s. flush() doesn't uncork.
+  bool getCork();
+  void setCork(bool cork);
+  // amount of data queued per tcp_write(), 0 (default) to follow the MSS
+  void setWriteChunkSize(size_t size);
+  size_t getWriteChunkSize();
   static void setLocalPortStart(uint16_t port) { _localPort = port; }
+  // Received data held unread for this connection, and for all of them,
+  // beyond which more is left with the stack and the window stays closed
+  // until the sketch reads; see TCP_RX_BUFFER_LIMIT in ClientContext.h
+  void setRxBufferLimit(size_t bytes);
+  size_t getRxBufferLimit();
+  static void setRxBufferTotalLimit(size_t bytes);
+  // Memory this connection may take from lwIP, see TcpProfile.h; the
+  // default one is given to the connections made or accepted after it
+  void setProfile(const TcpProfile& profile);
+  TcpProfile getProfile();
+  static void setDefaultProfile(const TcpProfile& profile);
+  static TcpProfile getDefaultProfile();
 
   size_t availableForWrite();
 
+  // in async mode write(), write_P() and writev() of memory buffers return
+  // at once with the number of bytes accepted (possibly 0) instead of
+  // waiting for all data to go out; writes from a Stream still wait
+  virtual void setAsync(bool async);
+  bool getAsync();
+  // called from the network stack whenever sent data gets acknowledged,
+  // i.e. when more can be written; the handler must not block, nor drop
+  // the last WiFiClient referring to this connection
+  typedef std::function<void(size_t acked)> THandlerFunction_Sent;
+  void onSent(THandlerFunction_Sent handler);
+  // called from loop context (through schedule_function) when data has
+  // arrived, and when the connection is closed by the peer or lost
+  typedef std::function<void(void)> THandlerFunction;
+  void onData(THandlerFunction handler);
+  void onDisconnect(THandlerFunction handler);
+
   friend class WiFiServer;
 
   using Print::write;
@@ -89,6 +175,17 @@ public:
   static void stopAll();
   static void stopAllExcept(WiFiClient * c);
 
+  // set aside room for count connection contexts in one block, best early
+  // in setup() before the heap gets fragmented; see ContextPool.h
+  static bool reserveContexts(size_t count);
+  static ContextPoolStats contextPoolStats();
+
+  // counters of this connection and the state of its pcb, see TcpStats.h;
+  // all zero without a connection
+  TcpStats getStats();
+  // the pcbs, queued and received pbufs of all connections
+  static LwipStats lwipStats();
+
   void     keepAlive (uint16_t idle_sec = TCP_DEFAULT_KEEPALIVE_IDLE_SEC, uint16_t intv_sec = TCP_DEFAULT_KEEPALIVE_INTERVAL_SEC, uint8_t count = TCP_DEFAULT_KEEPALIVE_COUNT);
   bool     isKeepAliveEnabled () const;
   uint16_t getKeepAliveIdle () const;
@@ -101,6 +198,7 @@ protected:
   static int8_t _s_connected(void* arg, void* tpcb, int8_t err);
   static void _s_err(void* arg, int8_t err);
 
+  int _connect(IPAddress ip, uint16_t port, bool async);
   int8_t _connected(void* tpcb, int8_t err);
   void _err(int8_t err);
 
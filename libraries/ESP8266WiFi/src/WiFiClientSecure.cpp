@@ -27,9 +27,9 @@ extern "C"
 #include "osapi.h"
 #include "ets_sys.h"
 }
-#include <list>
 #include <errno.h>
 #include "debug.h"
+#include <StreamCopy.h>
 #include "ESP8266WiFi.h"
 #include "WiFiClientSecure.h"
 #include "WiFiClient.h"
@@ -51,25 +51,64 @@ extern "C"
 #define SSL_DEBUG_OPTS 0
 #endif
 
+// Number of servers whose TLS sessions are remembered for resumption, 0 to disable
+#ifndef SSL_SESSION_CACHE_SIZE
+#define SSL_SESSION_CACHE_SIZE 2
+#endif
 
-typedef struct BufferItem
+// Session id of the last connection to a server. A reconnect presents it
+// again so that the server can skip the key exchange. axTLS keeps the
+// master secrets in the client SSL_CTX, so the entries only live as long
+// as that does; it gets room for twice as many sessions, as sessions that
+// were not resumed stay there until they are pushed out.
+//
+// A reconnect that resumes the session also skips the verification of
+// the certificate, within SSL_VERIFY_CACHE_MS of the full one: the server
+// proves it holds the master secret of the handshake that was verified,
+// and sends no certificate to verify anyway.
+struct SSLSession
 {
-    BufferItem(const uint8_t* data_, size_t size_)
-    : size(size_), data(new uint8_t[size])
-    {
-        if (data.get() != nullptr) {
-            memcpy(data.get(), data_, size);
-        } else {
-            DEBUGV(":wcs alloc %d failed\r\n", size_);
-            size = 0;
-        }
-    }
+    uint32_t key;       // hash of the host name, or the address if there is none
+    uint16_t port;
+    uint8_t  idSize;    // 0: unused
+    uint8_t  id[SSL_SESSION_ID_SIZE];
+    uint32_t lastUsed;
+    uint8_t  verified;  // VERIFIED_* of the handshake that made the session
+    uint32_t verifiedName; // hash of the domain name it was verified for
+    uint32_t verifiedAt;
+    uint8_t  fingerprint[20];
+};
+
+// How long, in ms, a verification holds for the sessions resumed from the
+// handshake it was made for; 0 to verify every connection
+#ifndef SSL_VERIFY_CACHE_MS
+#define SSL_VERIFY_CACHE_MS 3600000
+#endif
 
-    size_t size;
-    std::unique_ptr<uint8_t[]> data;
-} BufferItem;
+enum {
+    VERIFIED_NONE,
+    VERIFIED_CHAIN,         // verifyCertChain()
+    VERIFIED_FINGERPRINT,   // verify()
+};
+
+// Number of trust store certificates remembered as loaded into the client
+// SSL_CTX, so that they are not loaded again on every verification
+#ifndef SSL_TRUSTED_CA_MAX
+#define SSL_TRUSTED_CA_MAX 8
+#endif
+
+// Number of client sessions the server remembers, so that a browser coming
+// back (a new connection of the same page) is spared the RSA key exchange
+#ifndef SSL_SERVER_SESSION_CACHE_SIZE
+#define SSL_SERVER_SESSION_CACHE_SIZE 4
+#endif
+
+struct TrustedCA
+{
+    const TrustStore* store;
+    int index;
+};
 
-typedef std::list<BufferItem> BufferList;
 
 class SSLContext
 {
@@ -79,14 +118,11 @@ public:
         _isServer = isServer;
         if (!_isServer) {
             if (_ssl_client_ctx_refcnt == 0) {
-                _ssl_client_ctx = ssl_ctx_new(SSL_SERVER_VERIFY_LATER | SSL_DEBUG_OPTS | SSL_CONNECT_IN_PARTS | SSL_READ_BLOCKING | SSL_NO_DEFAULT_KEY, 0);
+                _ssl_client_ctx = ssl_ctx_new(SSL_SERVER_VERIFY_LATER | SSL_DEBUG_OPTS | SSL_CONNECT_IN_PARTS | SSL_READ_BLOCKING | SSL_NO_DEFAULT_KEY, 2 * SSL_SESSION_CACHE_SIZE);
             }
             ++_ssl_client_ctx_refcnt;
         } else {
-            if (_ssl_svr_ctx_refcnt == 0) {
-                _ssl_svr_ctx = ssl_ctx_new(SSL_SERVER_VERIFY_LATER | SSL_DEBUG_OPTS | SSL_CONNECT_IN_PARTS | SSL_READ_BLOCKING | SSL_NO_DEFAULT_KEY, 0);
-            }
-            ++_ssl_svr_ctx_refcnt;
+            retainServer();
         }
     }
 
@@ -97,18 +133,38 @@ public:
             io_ctx = nullptr;
         }
         _ssl = nullptr;
+        free(_writeBuffer);
         if (!_isServer) {
             --_ssl_client_ctx_refcnt;
             if (_ssl_client_ctx_refcnt == 0) {
                 ssl_ctx_free(_ssl_client_ctx);
                 _ssl_client_ctx = nullptr;
+                _clearSessions();
             }
         } else {
-            --_ssl_svr_ctx_refcnt;
-            if (_ssl_svr_ctx_refcnt == 0) {
-                ssl_ctx_free(_ssl_svr_ctx);
-                _ssl_svr_ctx = nullptr;
-            }
+            releaseServer();
+        }
+    }
+
+    // The server SSL_CTX holds the key, the certificate and the sessions of
+    // past clients; WiFiServerSecure keeps a reference to it so that these
+    // outlive the connections.
+    static void retainServer()
+    {
+        if (_ssl_svr_ctx_refcnt == 0) {
+            _ssl_svr_ctx = ssl_ctx_new(SSL_SERVER_VERIFY_LATER | SSL_DEBUG_OPTS | SSL_CONNECT_IN_PARTS | SSL_READ_BLOCKING | SSL_NO_DEFAULT_KEY, SSL_SERVER_SESSION_CACHE_SIZE);
+        }
+        ++_ssl_svr_ctx_refcnt;
+    }
+
+    static void releaseServer()
+    {
+        --_ssl_svr_ctx_refcnt;
+        if (_ssl_svr_ctx_refcnt == 0) {
+            ssl_ctx_free(_ssl_svr_ctx);
+            _ssl_svr_ctx = nullptr;
+            _ssl_svr_key = nullptr;
+            _ssl_svr_cert = nullptr;
         }
     }
 
@@ -117,10 +173,16 @@ public:
         ssl_free(_to_del);
     }
 
-    void connect(ClientContext* ctx, const char* hostName, uint32_t timeout_ms)
+    void connect(ClientContext* ctx, const char* hostName, uint32_t timeout_ms, uint16_t maxFragmentLength = 0)
     {
         SSL_EXTENSIONS* ext = ssl_ext_new();
         ssl_ext_set_host_name(ext, hostName);
+        if (maxFragmentLength) {
+            ssl_ext_set_max_fragment_size(ext, maxFragmentLength);
+        }
+        _maxFragmentLength = maxFragmentLength;
+        _recordPayloadSize = 0;
+        _writeBufferLen = 0;
         if (_ssl) {
             /* Creating a new TLS session on top of a new TCP connection.
                ssl_free will want to send a close notify alert, but the old TCP connection
@@ -133,8 +195,16 @@ public:
         io_ctx = ctx;
         ctx->ref();
 
+        uint32_t key = _sessionKey(hostName, ctx->getRemoteAddress());
+        uint16_t port = ctx->getRemotePort();
+        SSLSession* session = _findSession(key, port);
+        _key = key;
+        _port = port;
+        _resumed = false;
+
         // Wrap the new SSL with a smart pointer, custom deleter to call ssl_free
-        SSL *_new_ssl = ssl_client_new(_ssl_client_ctx, reinterpret_cast<int>(this), nullptr, 0, ext);
+        SSL *_new_ssl = ssl_client_new(_ssl_client_ctx, reinterpret_cast<int>(this),
+                                       session ? session->id : nullptr, session ? session->idSize : 0, ext);
         std::shared_ptr<SSL> _new_ssl_shared(_new_ssl, _delete_shared_SSL);
         _ssl = _new_ssl_shared;
 
@@ -148,10 +218,22 @@ public:
                 break;
             }
         }
+
+        if (ssl_handshake_status(_ssl.get()) == SSL_OK) {
+            const uint8_t* id = ssl_get_session_id(_ssl.get());
+            uint8_t idSize = ssl_get_session_id_size(_ssl.get());
+            // the server took it up, returning the same id
+            _resumed = session && id && session->idSize == idSize && !memcmp(session->id, id, idSize);
+            _storeSession(key, port, id, idSize);
+        } else if (session) {
+            // don't offer the session again, the next attempt starts afresh
+            session->idSize = 0;
+        }
     }
 
     void connectServer(ClientContext *ctx, uint32_t timeout_ms)
     {
+        _recordPayloadSize = 0;
         io_ctx = ctx;
         ctx->ref();
 
@@ -275,6 +357,38 @@ public:
         return will_copy;
     }
 
+    const char* peekBuffer()
+    {
+        if (!_available) {
+            if (!_readAll()) {
+                return nullptr;
+            }
+        }
+        return reinterpret_cast<const char*>(_read_ptr);
+    }
+
+    size_t peekAvailable()
+    {
+        if (!_available) {
+            _readAll();
+        }
+        return _available;
+    }
+
+    void peekConsume(size_t consume)
+    {
+        size_t will_consume = (_available < consume) ? _available : consume;
+        _read_ptr += will_consume;
+        _available -= will_consume;
+        if (_available == 0) {
+            _read_ptr = nullptr;
+            /* Send pending outgoing data, if any */
+            if (_hasWriteBuffers()) {
+                _writeBuffersSend();
+            }
+        }
+    }
+
     int available()
     {
         auto cb = _available;
@@ -312,10 +426,73 @@ public:
     bool loadObject_P(int type, PGM_VOID_P data, size_t size)
     {
         std::unique_ptr<uint8_t[]> buf(new uint8_t[size]);
+        if (!buf.get()) {
+            DEBUGV("loadObject_P: failed to allocate memory\n");
+            return false;
+        }
         memcpy_P(buf.get(),data, size);
         return loadObject(type, buf.get(), size);
     }
 
+    // Load the certificates of store whose subject issued the server's
+    // certificate, one at a time, unless they were loaded before.
+    void loadTrusted(TrustStore& store)
+    {
+        if (!_ssl) {
+            return;
+        }
+        const char* issuer = ssl_get_cert_dn(_ssl.get(), SSL_X509_CA_CERT_COMMON_NAME);
+        if (!issuer) {
+            issuer = ssl_get_cert_dn(_ssl.get(), SSL_X509_CA_CERT_ORGANIZATION);
+        }
+        if (!issuer) {
+            return;
+        }
+        uint32_t hash = TrustStore::hash(issuer);
+        size_t length;
+        for (int index = store.find(hash, 0, length); index >= 0; index = store.find(hash, index + 1, length)) {
+            if (_isTrusted(&store, index)) {
+                continue;
+            }
+            std::unique_ptr<uint8_t[]> buf(new uint8_t[length]);
+            if (!buf.get()) {
+                DEBUGV("loadTrusted: failed to allocate memory\n");
+                return;
+            }
+            if (!store.read(index, buf.get(), length) || !loadObject(SSL_OBJ_X509_CACERT, buf.get(), length)) {
+                continue;
+            }
+            DEBUGV("loadTrusted: loaded CA %d for '%s'\n", index, issuer);
+            _markTrusted(&store, index);
+        }
+    }
+
+    // Loads the server key and certificate unless the server SSL_CTX already
+    // has these; parsing them again for every client costs more than the
+    // handshake of a resumed session.
+    void loadServerKeys(bool usePMEM, const uint8_t *rsakey, int rsakeyLen, const uint8_t *cert, int certLen)
+    {
+        if (rsakey == _ssl_svr_key && cert == _ssl_svr_cert) {
+            return;
+        }
+        if (rsakey && rsakeyLen) {
+            if (usePMEM) {
+                loadObject_P(SSL_OBJ_RSA_KEY, rsakey, rsakeyLen);
+            } else {
+                loadObject(SSL_OBJ_RSA_KEY, rsakey, rsakeyLen);
+            }
+        }
+        if (cert && certLen) {
+            if (usePMEM) {
+                loadObject_P(SSL_OBJ_X509_CERT, cert, certLen);
+            } else {
+                loadObject(SSL_OBJ_X509_CERT, cert, certLen);
+            }
+        }
+        _ssl_svr_key = rsakey;
+        _ssl_svr_cert = cert;
+    }
+
     bool loadObject(int type, const uint8_t* data, size_t size)
     {
         int rc = ssl_obj_memory_load(_isServer?_ssl_svr_ctx:_ssl_client_ctx, type, data, static_cast<int>(size), nullptr);
@@ -340,6 +517,34 @@ public:
         return true;
     }
 
+    // Whether this connection resumed a session whose handshake passed the
+    // same verification, see SSLSession
+    bool verifiedBefore(uint8_t kind, const char* domainName, const uint8_t* fingerprint)
+    {
+        if (!_resumed || !SSL_VERIFY_CACHE_MS) {
+            return false;
+        }
+        SSLSession* session = _findSession(_key, _port);
+        return session && session->verified == kind &&
+               session->verifiedName == _sessionKey(domainName, 0) &&
+               millis() - session->verifiedAt < SSL_VERIFY_CACHE_MS &&
+               (!fingerprint || !memcmp(session->fingerprint, fingerprint, sizeof(session->fingerprint)));
+    }
+
+    void setVerified(uint8_t kind, const char* domainName, const uint8_t* fingerprint)
+    {
+        SSLSession* session = _findSession(_key, _port);
+        if (!session) {
+            return;
+        }
+        session->verified = kind;
+        session->verifiedName = _sessionKey(domainName, 0);
+        session->verifiedAt = millis();
+        if (fingerprint) {
+            memcpy(session->fingerprint, fingerprint, sizeof(session->fingerprint));
+        }
+    }
+
     void allowSelfSignedCerts()
     {
         _allowSelfSignedCerts = true;
@@ -388,12 +593,30 @@ protected:
             return 0;
         }
 
-        int rc = ssl_write(_ssl.get(), src, size);
-        if (rc >= 0) {
+        size_t record = _recordPayload();
+        if (_maxFragmentLength && (!record || record > _maxFragmentLength)) {
+            // no larger than negotiated
+            record = _maxFragmentLength;
+        }
+        if (!record || size <= record) {
+            int rc = ssl_write(_ssl.get(), src, size);
+            if (rc < 0) {
+                DEBUGV(":wcs write rc=%d\r\n", rc);
+            }
             return rc;
         }
-        DEBUGV(":wcs write rc=%d\r\n", rc);
-        return rc;
+
+        size_t written = 0;
+        while (written < size) {
+            size_t chunk = std::min(size - written, record);
+            int rc = ssl_write(_ssl.get(), src + written, chunk);
+            if (rc < 0) {
+                DEBUGV(":wcs write rc=%d\r\n", rc);
+                return written ? (int) written : rc;
+            }
+            written += rc;
+        }
+        return written;
     }
 
     int _writeBufferAdd(const uint8_t* data, size_t size)
@@ -402,34 +625,135 @@ protected:
             return 0;
         }
 
-        _writeBuffers.emplace_back(data, size);
-        if (_writeBuffers.back().data.get() == nullptr) {
-            _writeBuffers.pop_back();
-            return 0;
+        // one buffer, grown as needed and kept for the next time
+        if (_writeBufferLen + size > _writeBufferCap) {
+            size_t cap = std::max(std::max(_writeBufferCap * 2, _writeBufferLen + size), (size_t) 256);
+            uint8_t* buf = (uint8_t*) realloc(_writeBuffer, cap);
+            if (!buf) {
+                DEBUGV(":wcs alloc %d failed\r\n", size);
+                return 0;
+            }
+            _writeBuffer = buf;
+            _writeBufferCap = cap;
         }
+        memcpy(_writeBuffer + _writeBufferLen, data, size);
+        _writeBufferLen += size;
         return size;
     }
 
     int _writeBuffersSend()
     {
-        while (!_writeBuffers.empty()) {
-            auto& first = _writeBuffers.front();
-            int rc = _write(first.data.get(), first.size);
-            _writeBuffers.pop_front();
-            if (rc < 0) {
-                if (_hasWriteBuffers()) {
-                    DEBUGV(":wcs _writeBuffersSend dropping unsent data\r\n");
-                    _writeBuffers.clear();
+        if (!_writeBufferLen) {
+            return 0;
+        }
+        int rc = _write(_writeBuffer, _writeBufferLen);
+        if (rc >= 0 && (size_t) rc < _writeBufferLen) {
+            DEBUGV(":wcs _writeBuffersSend dropping unsent data\r\n");
+        }
+        _writeBufferLen = 0;
+        return (rc < 0) ? rc : 0;
+    }
+
+    bool _hasWriteBuffers()
+    {
+        return _writeBufferLen != 0;
+    }
+
+    // Plaintext that makes a record as long as a TCP segment, so that
+    // records neither grow the axTLS buffer nor end in runt segments
+    size_t _recordPayload()
+    {
+        if (!_recordPayloadSize && io_ctx) {
+            size_t segment = io_ctx->getWriteChunkSize();
+            size_t len = segment;
+            while (len > 128 && (size_t) ssl_calculate_write_length(_ssl.get(), len) > segment) {
+                len -= 16;
+            }
+            _recordPayloadSize = len;
+        }
+        return _recordPayloadSize;
+    }
+
+    static uint32_t _sessionKey(const char* hostName, uint32_t addr)
+    {
+        if (!hostName) {
+            return addr;
+        }
+        // FNV-1a; a collision costs no more than a full handshake
+        uint32_t hash = 2166136261u;
+        for (const char* p = hostName; *p; ++p) {
+            hash = (hash ^ (uint8_t) tolower(*p)) * 16777619u;
+        }
+        return hash;
+    }
+
+    static SSLSession* _findSession(uint32_t key, uint16_t port)
+    {
+        for (size_t i = 0; i < SSL_SESSION_CACHE_SIZE; ++i) {
+            SSLSession& session = _sessions[i];
+            if (session.idSize && session.key == key && session.port == port) {
+                return &session;
+            }
+        }
+        return nullptr;
+    }
+
+    static void _storeSession(uint32_t key, uint16_t port, const uint8_t* id, uint8_t idSize)
+    {
+        if (!SSL_SESSION_CACHE_SIZE || !id || !idSize || idSize > SSL_SESSION_ID_SIZE) {
+            return;
+        }
+        // the server's entry, or else a free or the least recently used one
+        SSLSession* slot = _findSession(key, port);
+        for (size_t i = 0; !slot && i < SSL_SESSION_CACHE_SIZE; ++i) {
+            if (!_sessions[i].idSize) {
+                slot = &_sessions[i];
+            }
+        }
+        if (!slot) {
+            slot = &_sessions[0];
+            for (size_t i = 1; i < SSL_SESSION_CACHE_SIZE; ++i) {
+                if ((int32_t) (_sessions[i].lastUsed - slot->lastUsed) < 0) {
+                    slot = &_sessions[i];
                 }
-                return rc;
             }
         }
-        return 0;
+        if (slot->key != key || slot->port != port || slot->idSize != idSize || memcmp(slot->id, id, idSize)) {
+            // a new session, which has to be verified again
+            slot->verified = VERIFIED_NONE;
+        }
+        slot->key = key;
+        slot->port = port;
+        slot->idSize = idSize;
+        memcpy(slot->id, id, idSize);
+        slot->lastUsed = millis();
     }
 
-    bool _hasWriteBuffers()
+    static void _clearSessions()
+    {
+        for (size_t i = 0; i < SSL_SESSION_CACHE_SIZE; ++i) {
+            _sessions[i].idSize = 0;
+            _sessions[i].verified = VERIFIED_NONE;
+        }
+        _trustedCount = 0;
+    }
+
+    static bool _isTrusted(const TrustStore* store, int index)
     {
-        return !_writeBuffers.empty();
+        for (size_t i = 0; i < _trustedCount; ++i) {
+            if (_trusted[i].store == store && _trusted[i].index == index) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void _markTrusted(const TrustStore* store, int index)
+    {
+        // once full, certificates may get loaded again, which only costs heap
+        if (_trustedCount < SSL_TRUSTED_CA_MAX) {
+            _trusted[_trustedCount++] = { store, index };
+        }
     }
 
     bool _isServer = false;
@@ -437,11 +761,23 @@ protected:
     static int _ssl_client_ctx_refcnt;
     static SSL_CTX* _ssl_svr_ctx;
     static int _ssl_svr_ctx_refcnt;
+    static const uint8_t* _ssl_svr_key;
+    static const uint8_t* _ssl_svr_cert;
+    static SSLSession _sessions[SSL_SESSION_CACHE_SIZE ? SSL_SESSION_CACHE_SIZE : 1];
+    static TrustedCA _trusted[SSL_TRUSTED_CA_MAX];
+    static size_t _trustedCount;
     std::shared_ptr<SSL> _ssl = nullptr;
     const uint8_t* _read_ptr = nullptr;
     size_t _available = 0;
-    BufferList _writeBuffers;
+    uint8_t* _writeBuffer = nullptr;
+    size_t _writeBufferLen = 0;
+    size_t _writeBufferCap = 0;
+    size_t _recordPayloadSize = 0;
     bool _allowSelfSignedCerts = false;
+    uint16_t _maxFragmentLength = 0;
+    uint32_t _key = 0;      // of the session, see connect()
+    uint16_t _port = 0;
+    bool _resumed = false;
     ClientContext* io_ctx = nullptr;
 };
 
@@ -449,6 +785,11 @@ SSL_CTX* SSLContext::_ssl_client_ctx = nullptr;
 int SSLContext::_ssl_client_ctx_refcnt = 0;
 SSL_CTX* SSLContext::_ssl_svr_ctx = nullptr;
 int SSLContext::_ssl_svr_ctx_refcnt = 0;
+const uint8_t* SSLContext::_ssl_svr_key = nullptr;
+const uint8_t* SSLContext::_ssl_svr_cert = nullptr;
+SSLSession SSLContext::_sessions[SSL_SESSION_CACHE_SIZE ? SSL_SESSION_CACHE_SIZE : 1];
+TrustedCA SSLContext::_trusted[SSL_TRUSTED_CA_MAX];
+size_t SSLContext::_trustedCount = 0;
 
 WiFiClientSecure::WiFiClientSecure()
 {
@@ -478,24 +819,20 @@ WiFiClientSecure::WiFiClientSecure(ClientContext* client, bool usePMEM,
     std::shared_ptr<SSLContext> _new_ssl_shared(_new_ssl);
     _ssl = _new_ssl_shared;
 
-    if (usePMEM) {
-        if (rsakey && rsakeyLen) {
-            _ssl->loadObject_P(SSL_OBJ_RSA_KEY, rsakey, rsakeyLen);
-        }
-        if (cert && certLen) {
-            _ssl->loadObject_P(SSL_OBJ_X509_CERT, cert, certLen);
-        }
-    } else {
-        if (rsakey && rsakeyLen) {
-            _ssl->loadObject(SSL_OBJ_RSA_KEY, rsakey, rsakeyLen);
-        }
-        if (cert && certLen) {
-            _ssl->loadObject(SSL_OBJ_X509_CERT, cert, certLen);
-        }
-    }
+    _ssl->loadServerKeys(usePMEM, rsakey, rsakeyLen, cert, certLen);
     _ssl->connectServer(client, _timeout);
 }
 
+void WiFiClientSecure::_retainServerContext()
+{
+    SSLContext::retainServer();
+}
+
+void WiFiClientSecure::_releaseServerContext()
+{
+    SSLContext::releaseServer();
+}
+
 int WiFiClientSecure::connect(IPAddress ip, uint16_t port)
 {
     if (!WiFiClient::connect(ip, port)) {
@@ -527,7 +864,7 @@ int WiFiClientSecure::_connectSSL(const char* hostName)
     if (!_ssl) {
         _ssl = std::make_shared<SSLContext>();
     }
-    _ssl->connect(_client, hostName, _timeout);
+    _ssl->connect(_client, hostName, _timeout, _maxFragmentLength);
 
     auto status = ssl_handshake_status(*_ssl);
     if (status != SSL_OK) {
@@ -565,26 +902,47 @@ size_t WiFiClientSecure::write_P(PGM_P buf, size_t size)
 }
 
 // The axTLS bare libs don't understand anything about Arduino Streams,
-// so we have to manually read and send individual chunks.
+// so the data goes through write() in blocks.
 size_t WiFiClientSecure::write(Stream& stream)
 {
-    size_t totalSent = 0;
-    size_t countRead;
-    size_t countSent;
     if (!_ssl)
     {
         return 0;
     }
-    do {
-        uint8_t temp[256]; // Temporary chunk size same as ClientContext
-        countSent = 0;
-        countRead = stream.readBytes(temp, sizeof(temp));
-        if (countRead) {
-            countSent = write(temp, countRead);
-            totalSent += countSent;
+    return streamCopy(stream, *this);
+}
+
+// Records are built by axTLS from each buffer in turn, so parts are simply
+// written one after another.
+size_t WiFiClientSecure::writev(const IOVec* parts, size_t count)
+{
+    size_t totalSent = 0;
+    for (size_t i = 0; i < count && _ssl; ++i) {
+        const IOVec& part = parts[i];
+        size_t sent;
+        if (part.type == IOVec::RAM) {
+            sent = write((const uint8_t*) part.data, part.size);
+        } else if (part.type == IOVec::FLASH) {
+            sent = write_P((PGM_P) part.data, part.size);
+        } else {
+            Stream& stream = *(Stream*) part.data;
+            sent = 0;
+            while (sent < part.size) {
+                uint8_t temp[256];
+                size_t countRead = stream.readBytes(temp, std::min(sizeof(temp), part.size - sent));
+                size_t countSent = countRead ? write(temp, countRead) : 0;
+                sent += countSent;
+                if (!countSent || countSent != countRead) {
+                    break;
+                }
+                yield(); // Feed the WDT
+            }
+        }
+        totalSent += sent;
+        if (sent != part.size) {
+            break;
         }
-        yield(); // Feed the WDT
-    } while ( (countSent == countRead) && (countSent > 0) );
+    }
     return totalSent;
 }
 
@@ -641,6 +999,31 @@ size_t WiFiClientSecure::peekBytes(uint8_t *buffer, size_t length)
     return _ssl->peekBytes((char *)buffer, count);
 }
 
+const char* WiFiClientSecure::peekBuffer()
+{
+    if (!_ssl) {
+        return nullptr;
+    }
+
+    return _ssl->peekBuffer();
+}
+
+size_t WiFiClientSecure::peekAvailable()
+{
+    if (!_ssl) {
+        return 0;
+    }
+
+    return _ssl->peekAvailable();
+}
+
+void WiFiClientSecure::peekConsume(size_t consume)
+{
+    if (_ssl) {
+        _ssl->peekConsume(consume);
+    }
+}
+
 int WiFiClientSecure::available()
 {
     if (!_ssl) {
@@ -743,12 +1126,18 @@ bool WiFiClientSecure::verify(const char* fp, const char* domain_name)
         pos += 2;
         sha1[i] = low | (high << 4);
     }
+    if (_ssl->verifiedBefore(VERIFIED_FINGERPRINT, domain_name, sha1)) {
+        return true;
+    }
     if (ssl_match_fingerprint(*_ssl, sha1) != 0) {
         DEBUGV("fingerprint doesn't match\r\n");
         return false;
     }
-
-    return _verifyDN(domain_name);
+    if (!_verifyDN(domain_name)) {
+        return false;
+    }
+    _ssl->setVerified(VERIFIED_FINGERPRINT, domain_name, sha1);
+    return true;
 }
 
 bool WiFiClientSecure::_verifyDN(const char* domain_name)
@@ -784,10 +1173,21 @@ bool WiFiClientSecure::verifyCertChain(const char* domain_name)
     if (!_ssl) {
         return false;
     }
+    if (_ssl->verifiedBefore(VERIFIED_CHAIN, domain_name, nullptr)) {
+        DEBUGV("verifyCertChain: resumed a verified session\n");
+        return true;
+    }
+    if (_trustStore) {
+        _ssl->loadTrusted(*_trustStore);
+    }
     if (!_ssl->verifyCert()) {
         return false;
     }
-    return _verifyDN(domain_name);
+    if (!_verifyDN(domain_name)) {
+        return false;
+    }
+    _ssl->setVerified(VERIFIED_CHAIN, domain_name, nullptr);
+    return true;
 }
 
 void WiFiClientSecure::_initSSLContext()
@@ -803,6 +1203,12 @@ bool WiFiClientSecure::setCACert(const uint8_t* pk, size_t size)
     return _ssl->loadObject(SSL_OBJ_X509_CACERT, pk, size);
 }
 
+void WiFiClientSecure::setTrustStore(TrustStore* store)
+{
+    _initSSLContext();
+    _trustStore = store;
+}
+
 bool WiFiClientSecure::setCertificate(const uint8_t* pk, size_t size)
 {
     _initSSLContext();
@@ -857,6 +1263,157 @@ void WiFiClientSecure::allowSelfSignedCerts()
     _ssl->allowSelfSignedCerts();
 }
 
+// RFC 6066 code of a maximum fragment length, 0 if not a valid one
+static uint8_t maxFragmentLengthCode(uint16_t len)
+{
+    switch (len) {
+        case 512:  return 1;
+        case 1024: return 2;
+        case 2048: return 3;
+        case 4096: return 4;
+        default:   return 0;
+    }
+}
+
+bool WiFiClientSecure::setMaxFragmentLength(uint16_t len)
+{
+    if (len && !maxFragmentLengthCode(len)) {
+        return false;
+    }
+    _maxFragmentLength = len;
+    return true;
+}
+
+// Send a bare ClientHello asking for the fragment length, and see whether
+// the ServerHello agrees, which is only the case if it echoes the extension.
+static bool probeMaxFragmentLength(WiFiClient& client, const char* hostName, uint16_t len)
+{
+    uint8_t code = maxFragmentLengthCode(len);
+    if (!code) {
+        return false;
+    }
+    size_t hostLen = hostName ? strlen(hostName) : 0;
+    if (hostLen > 255) {
+        return false;
+    }
+
+    static const uint8_t suites[] PROGMEM = {
+        0x00, 0x2f, 0x00, 0x35, 0x00, 0x3c, 0x00, 0x3d, // AES128/256-SHA, AES128/256-SHA256
+    };
+    size_t extLen = 5 + (hostLen ? 9 + hostLen : 0);
+    size_t helloLen = 2 + 32 + 1 + 2 + sizeof(suites) + 2 + 2 + extLen;
+    size_t size = 5 + 4 + helloLen;
+    uint8_t* msg = new uint8_t[size];
+    if (!msg) {
+        return false;
+    }
+
+    uint8_t* p = msg;
+    *p++ = 0x16; *p++ = 0x03; *p++ = 0x01;                   // handshake record, TLS 1.0 for compatibility
+    *p++ = (4 + helloLen) >> 8; *p++ = (4 + helloLen) & 0xff;
+    *p++ = 0x01; *p++ = 0; *p++ = helloLen >> 8; *p++ = helloLen & 0xff; // ClientHello
+    *p++ = 0x03; *p++ = 0x03;                                 // TLS 1.2
+    for (int i = 0; i < 32; i += 4, p += 4) {                 // random
+        uint32_t r = RANDOM_REG32;
+        memcpy(p, &r, 4);
+    }
+    *p++ = 0;                                                 // no session id
+    *p++ = 0; *p++ = sizeof(suites);
+    memcpy_P(p, suites, sizeof(suites));
+    p += sizeof(suites);
+    *p++ = 1; *p++ = 0;                                       // no compression
+    *p++ = extLen >> 8; *p++ = extLen & 0xff;
+    if (hostLen) {                                            // server_name
+        *p++ = 0x00; *p++ = 0x00;
+        *p++ = (hostLen + 5) >> 8; *p++ = (hostLen + 5) & 0xff;
+        *p++ = (hostLen + 3) >> 8; *p++ = (hostLen + 3) & 0xff;
+        *p++ = 0; *p++ = 0; *p++ = hostLen;
+        memcpy(p, hostName, hostLen);
+        p += hostLen;
+    }
+    *p++ = 0x00; *p++ = 0x01; *p++ = 0x00; *p++ = 0x01; *p++ = code; // max_fragment_length
+
+    size_t sent = client.write(msg, size);
+    delete[] msg;
+    if (sent != size) {
+        return false;
+    }
+
+    // record and handshake headers, then the fixed part of the ServerHello
+    uint8_t head[5 + 4 + 2 + 32 + 1];
+    if (client.readBytes(head, sizeof(head)) != sizeof(head) || head[0] != 0x16 || head[5] != 0x02) {
+        DEBUGV(":wcs mfl no server hello\r\n");
+        return false;
+    }
+    size_t left = ((size_t) head[6] << 16 | head[7] << 8 | head[8]) - (2 + 32 + 1);
+    uint8_t buf[32 + 2 + 1 + 2];
+    size_t sessionLen = head[sizeof(head) - 1];
+    if (sessionLen > 32 || left < sessionLen + 3) {
+        return false;
+    }
+    if (client.readBytes(buf, sessionLen + 3) != sessionLen + 3) {
+        return false;
+    }
+    left -= sessionLen + 3;
+    if (left < 2 || client.readBytes(buf, 2) != 2) {
+        return false;                                         // no extensions at all
+    }
+    left -= 2;
+    size_t extsLen = buf[0] << 8 | buf[1];
+    while (extsLen >= 4 && left >= 4) {
+        if (client.readBytes(buf, 4) != 4) {
+            return false;
+        }
+        uint16_t type = buf[0] << 8 | buf[1];
+        uint16_t len = buf[2] << 8 | buf[3];
+        extsLen -= 4;
+        left -= 4;
+        if (len > extsLen || len > left) {
+            return false;
+        }
+        if (type == 0x0001) {
+            return len == 1 && client.readBytes(buf, 1) == 1 && buf[0] == code;
+        }
+        for (size_t i = 0; i < len; ++i) {
+            if (client.read() < 0) {
+                return false;
+            }
+        }
+        extsLen -= len;
+        left -= len;
+    }
+    return false;
+}
+
+bool WiFiClientSecure::probeMaxFragmentLength(IPAddress ip, uint16_t port, uint16_t len)
+{
+    WiFiClient client;
+    client.setTimeout(5000);
+    if (!client.connect(ip, port)) {
+        return false;
+    }
+    bool ok = ::probeMaxFragmentLength(client, nullptr, len);
+    client.stop();
+    return ok;
+}
+
+bool WiFiClientSecure::probeMaxFragmentLength(const char* hostName, uint16_t port, uint16_t len)
+{
+    WiFiClient client;
+    client.setTimeout(5000);
+    if (!client.connect(hostName, port)) {
+        return false;
+    }
+    bool ok = ::probeMaxFragmentLength(client, hostName, len);
+    client.stop();
+    return ok;
+}
+
+bool WiFiClientSecure::probeMaxFragmentLength(const String& hostName, uint16_t port, uint16_t len)
+{
+    return probeMaxFragmentLength(hostName.c_str(), port, len);
+}
+
 extern "C" int __ax_port_read(int fd, uint8_t* buffer, size_t count)
 {
     ClientContext* _client = SSLContext::getIOContext(fd);
@@ -24,6 +24,7 @@
 #define wificlientsecure_h
 #include "WiFiClient.h"
 #include "include/ssl.h"
+#include "TrustStore.h"
 
 
 class SSLContext;
@@ -37,6 +38,11 @@ public:
   int connect(const String host, uint16_t port) override;
   int connect(const char* name, uint16_t port) override;
 
+  // On a connection that resumed the TLS session of an earlier one, which
+  // passed the same verification for the same domain name, these return
+  // true without checking again (see SSL_VERIFY_CACHE_MS): the server
+  // sends no certificate then, and the session is bound to the one that
+  // was verified.
   bool verify(const char* fingerprint, const char* domain_name);
   bool verifyCertChain(const char* domain_name);
 
@@ -44,11 +50,17 @@ public:
   size_t write(const uint8_t *buf, size_t size) override;
   size_t write_P(PGM_P buf, size_t size) override;
   size_t write(Stream& stream); // Note this is not virtual
+  size_t writev(const IOVec* parts, size_t count) override;
+  // TLS records must reach the socket whole, writes always wait
+  void setAsync(bool async) override { (void) async; }
   int read(uint8_t *buf, size_t size) override;
   int available() override;
   int read() override;
   int peek() override;
   size_t peekBytes(uint8_t *buffer, size_t length) override;
+  const char* peekBuffer() override;
+  size_t peekAvailable() override;
+  void peekConsume(size_t consume) override;
   void stop() override;
 
   bool setCACert(const uint8_t* pk, size_t size);
@@ -65,6 +77,22 @@ public:
 
   void allowSelfSignedCerts();
 
+  // Take CA certificates from store, which has to outlive the client.
+  // verifyCertChain() loads just the ones that may have issued the
+  // server's certificate, instead of all of them up front.
+  void setTrustStore(TrustStore* store);
+
+  // Ask servers for TLS records of at most len bytes (512, 1024, 2048 or
+  // 4096; 0 for the usual 16 kB), which keeps the TLS buffer that small
+  // if the server agrees. Takes effect on the next connect().
+  bool setMaxFragmentLength(uint16_t len);
+  uint16_t getMaxFragmentLength() const { return _maxFragmentLength; }
+  // Whether a server agrees to records of at most len bytes. Many don't,
+  // and take up the full size whatever they were asked for.
+  static bool probeMaxFragmentLength(IPAddress ip, uint16_t port, uint16_t len);
+  static bool probeMaxFragmentLength(const char* hostName, uint16_t port, uint16_t len);
+  static bool probeMaxFragmentLength(const String& hostName, uint16_t port, uint16_t len);
+
   template<typename TFile>
   bool loadCertificate(TFile& file) {
     return loadCertificate(file, file.size());
@@ -84,6 +112,9 @@ friend class WiFiServerSecure; // Needs access to custom constructor below
 protected:
   // Only called by WiFiServerSecure
   WiFiClientSecure(ClientContext* client, bool usePMEM, const uint8_t *rsakey, int rsakeyLen, const uint8_t *cert, int certLen);
+  // Keep the server SSL context, with its keys and sessions, between clients
+  static void _retainServerContext();
+  static void _releaseServerContext();
 
 protected:
     void _initSSLContext();
@@ -91,6 +122,8 @@ protected:
     bool _verifyDN(const char* name);
 
     std::shared_ptr<SSLContext> _ssl = nullptr;
+    uint16_t _maxFragmentLength = 0;
+    TrustStore* _trustStore = nullptr;
 };
 
 #endif //wificlientsecure_h
@@ -36,6 +36,7 @@ extern "C" {
 #include "lwip/tcp.h"
 #include "lwip/inet.h"
 #include "include/ClientContext.h"
+#include <Schedule.h>
 
 WiFiServer::WiFiServer(IPAddress addr, uint16_t port)
 : _port(port)
@@ -95,6 +96,15 @@ bool WiFiServer::getNoDelay() {
     return _noDelay;
 }
 
+void WiFiServer::onConnect(THandlerFunction handler) {
+    _connectHandler = handler;
+}
+
+void WiFiServer::setBacklog(uint8_t backlog, WiFiServerOverflow overflow) {
+    _backlog = backlog;
+    _overflow = overflow;
+}
+
 bool WiFiServer::hasClient() {
     if (_unclaimed)
         return true;
@@ -106,6 +116,7 @@ WiFiClient WiFiServer::available(byte* status) {
     if (_unclaimed) {
         WiFiClient result(_unclaimed);
         _unclaimed = _unclaimed->next();
+        --_queued;
         result.setNoDelay(_noDelay);
         DEBUGV("WS:av\r\n");
         return result;
@@ -159,12 +170,52 @@ T* slist_append_tail(T* head, T* item) {
 long WiFiServer::_accept(tcp_pcb* apcb, long err) {
     (void) err;
     DEBUGV("WS:ac\r\n");
+    if (_backlog && _queued >= _backlog &&
+        (_overflow == OVERFLOW_REFUSE || !_dropUnclaimed())) {
+        DEBUGV("WS:ovf\r\n");
+        ++_dropped;
+        tcp_accepted(_pcb);
+        tcp_abort(apcb);
+        return ERR_ABRT;
+    }
     ClientContext* client = new ClientContext(apcb, &WiFiServer::_s_discard, this);
     _unclaimed = slist_append_tail(_unclaimed, client);
+    ++_queued;
+    ++_accepted;
     tcp_accepted(_pcb);
+    if (_connectHandler && !_connectPending) {
+        _connectPending = schedule_function(&WiFiServer::_s_connect, this);
+    }
     return ERR_OK;
 }
 
+// Reset one unclaimed connection to make room for a new one: the oldest
+// already closed by its peer if there is one, else simply the oldest.
+bool WiFiServer::_dropUnclaimed() {
+    if (!_unclaimed)
+        return false;
+    ClientContext* prev = nullptr;
+    ClientContext* victim = _unclaimed;
+    for (ClientContext* prevc = nullptr, *c = _unclaimed; c; prevc = c, c = c->next()) {
+        if (c->state() == CLOSED) {
+            prev = prevc;
+            victim = c;
+            break;
+        }
+    }
+    if (prev)
+        prev->next(victim->next());
+    else
+        _unclaimed = victim->next();
+    --_queued;
+    ++_dropped;
+    // nothing refers to an unclaimed context yet
+    victim->discard_received();
+    victim->abort();
+    delete victim;
+    return true;
+}
+
 void WiFiServer::_discard(ClientContext* client) {
     (void) client;
     // _discarded = slist_append_tail(_discarded, client);
@@ -175,6 +226,16 @@ long WiFiServer::_s_accept(void *arg, tcp_pcb* newpcb, long err) {
     return reinterpret_cast<WiFiServer*>(arg)->_accept(newpcb, err);
 }
 
+void WiFiServer::_connect() {
+    _connectPending = false;
+    if (_connectHandler && _unclaimed)
+        _connectHandler();
+}
+
+void WiFiServer::_s_connect(void* server) {
+    reinterpret_cast<WiFiServer*>(server)->_connect();
+}
+
 void WiFiServer::_s_discard(void* server, ClientContext* ctx) {
     reinterpret_cast<WiFiServer*>(server)->_discard(ctx);
 }
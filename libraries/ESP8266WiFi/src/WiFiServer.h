@@ -28,12 +28,19 @@ extern "C" {
   struct tcp_pcb;
 }
 
+#include <functional>
 #include "Server.h"
 #include "IPAddress.h"
 
 class ClientContext;
 class WiFiClient;
 
+// what happens to a new connection when the backlog is full, see setBacklog()
+enum WiFiServerOverflow {
+  OVERFLOW_REFUSE,      // reset the new connection
+  OVERFLOW_DROP_OLDEST  // reset the longest waiting unclaimed connection
+};
+
 class WiFiServer : public Server {
   // Secure server needs access to all the private entries here
 protected:
@@ -44,6 +51,13 @@ protected:
   ClientContext* _unclaimed;
   ClientContext* _discarded;
   bool _noDelay = false;
+  bool _connectPending = false;
+  uint8_t _backlog = 0;
+  WiFiServerOverflow _overflow = OVERFLOW_REFUSE;
+  uint16_t _queued = 0;
+  uint32_t _accepted = 0;
+  uint32_t _dropped = 0;
+  std::function<void(void)> _connectHandler;
 
 public:
   WiFiServer(IPAddress addr, uint16_t port);
@@ -55,6 +69,18 @@ public:
   void begin(uint16_t port);
   void setNoDelay(bool nodelay);
   bool getNoDelay();
+  // limit the number of accepted connections waiting for available();
+  // 0 (default) means no limit
+  void setBacklog(uint8_t backlog, WiFiServerOverflow overflow = OVERFLOW_REFUSE);
+  uint8_t getBacklog() const { return _backlog; }
+  uint16_t queued() const { return _queued; }      // connections waiting now
+  uint32_t accepted() const { return _accepted; }  // connections queued so far
+  uint32_t dropped() const { return _dropped; }    // connections reset due to the backlog
+  // called from loop context (through schedule_function) when new clients
+  // are waiting to be picked up with available(); the server must outlive
+  // a pending call
+  typedef std::function<void(void)> THandlerFunction;
+  void onConnect(THandlerFunction handler);
   virtual size_t write(uint8_t);
   virtual size_t write(const uint8_t *buf, size_t size);
   uint8_t status();
@@ -66,9 +92,12 @@ public:
 protected:
   long _accept(tcp_pcb* newpcb, long err);
   void   _discard(ClientContext* client);
+  bool   _dropUnclaimed();
+  void   _connect();
 
   static long _s_accept(void *arg, tcp_pcb* newpcb, long err);
   static void _s_discard(void* server, ClientContext* ctx);
+  static void _s_connect(void* server);
 };
 
 #endif
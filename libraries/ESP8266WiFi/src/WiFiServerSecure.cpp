@@ -44,8 +44,23 @@ WiFiServerSecure::WiFiServerSecure(uint16_t port) : WiFiServer(port)
 {
 }
 
+WiFiServerSecure::~WiFiServerSecure()
+{
+    _releaseContext();
+}
+
+// New keys go into a new server context, once the clients of the old one are gone
+void WiFiServerSecure::_releaseContext()
+{
+    if (_contextRetained) {
+        WiFiClientSecure::_releaseServerContext();
+        _contextRetained = false;
+    }
+}
+
 void WiFiServerSecure::setServerKeyAndCert(const uint8_t *key, int keyLen, const uint8_t *cert, int certLen)
 {
+    _releaseContext();
     this->usePMEM = false;
     this->rsakey = key;
     this->rsakeyLen = keyLen;
@@ -55,6 +70,7 @@ void WiFiServerSecure::setServerKeyAndCert(const uint8_t *key, int keyLen, const
 
 void WiFiServerSecure::setServerKeyAndCert_P(const uint8_t *key, int keyLen, const uint8_t *cert, int certLen)
 {
+    _releaseContext();
     this->usePMEM = true;
     this->rsakey = key;
     this->rsakeyLen = keyLen;
@@ -66,8 +82,14 @@ WiFiClientSecure WiFiServerSecure::available(uint8_t* status)
 {
     (void) status; // Unused
     if (_unclaimed) {
+        if (!_contextRetained) {
+            // the keys are loaded once, and clients that come back can resume their sessions
+            WiFiClientSecure::_retainServerContext();
+            _contextRetained = true;
+        }
         WiFiClientSecure result(_unclaimed, usePMEM, rsakey, rsakeyLen, cert, certLen);
         _unclaimed = _unclaimed->next();
+        --_queued;
         result.setNoDelay(_noDelay);
         DEBUGV("WS:av\r\n");
         return result;
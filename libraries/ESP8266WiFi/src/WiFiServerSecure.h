@@ -29,14 +29,17 @@ public:
   WiFiServerSecure(uint16_t port);
   void setServerKeyAndCert(const uint8_t *key, int keyLen, const uint8_t *cert, int certLen);
   void setServerKeyAndCert_P(const uint8_t *key, int keyLen, const uint8_t *cert, int certLen);
-  virtual ~WiFiServerSecure() {}
+  virtual ~WiFiServerSecure();
   WiFiClientSecure available(uint8_t* status = NULL);
 private:
+  void _releaseContext();
+
   bool usePMEM = false;
   const uint8_t *rsakey = nullptr;
   int rsakeyLen = 0;
   const uint8_t *cert = nullptr;
   int certLen = 0;
+  bool _contextRetained = false;
 };
 
 #endif
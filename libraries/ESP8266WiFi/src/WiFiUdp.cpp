@@ -204,6 +204,49 @@ size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
     return _ctx->append(reinterpret_cast<const char*>(buffer), size);
 }
 
+size_t WiFiUDP::write_P(PGM_P buffer, size_t size)
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->append_P(buffer, size);
+}
+
+uint8_t* WiFiUDP::reserve(size_t size)
+{
+    if (!_ctx)
+        return 0;
+
+    return reinterpret_cast<uint8_t*>(_ctx->reserve(size));
+}
+
+int WiFiUDP::beginBatch(size_t count, size_t size)
+{
+    if (!_ctx) {
+        _ctx = new UdpContext;
+        _ctx->ref();
+    }
+    return (_ctx->beginBatch(count, size)) ? 1 : 0;
+}
+
+int WiFiUDP::beginBatchPacket(IPAddress ip, uint16_t port)
+{
+    if (!_ctx)
+        return 0;
+
+    ip_addr_t addr;
+    addr.addr = ip;
+    return (_ctx->nextBatchPacket(addr, port)) ? 1 : 0;
+}
+
+size_t WiFiUDP::endBatch()
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->sendBatch();
+}
+
 int WiFiUDP::parsePacket()
 {
     if (!_ctx)
@@ -281,6 +324,73 @@ uint16_t WiFiUDP::localPort()
     return _ctx->getLocalPort();
 }
 
+uint32_t WiFiUDP::receiveTime()
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->getReceiveTime();
+}
+
+size_t WiFiUDP::parsePackets(THandlerFunction_Packet handler, size_t maxPackets)
+{
+    if (!_ctx)
+        return 0;
+
+    size_t count = 0;
+    UdpContext::Packet p;
+    while (count < maxPackets && _ctx->take(p))
+    {
+        PacketInfo info;
+        info.remoteIP = IPAddress(p.srcAddr);
+        info.remotePort = p.srcPort;
+        info.destinationIP = IPAddress(p.dstAddr);
+        info.time = p.time;
+        if (p.pb->len == p.pb->tot_len)
+        {
+            handler(reinterpret_cast<const uint8_t*>(p.pb->payload), p.pb->len, info);
+        }
+        else
+        {
+            // reassembled from fragments, spread over several pbufs
+            uint8_t* data = (uint8_t*) malloc(p.pb->tot_len);
+            if (data)
+            {
+                pbuf_copy_partial(p.pb, data, p.pb->tot_len, 0);
+                handler(data, p.pb->tot_len, info);
+                free(data);
+            }
+        }
+        pbuf_free(p.pb);
+        ++count;
+    }
+    return count;
+}
+
+size_t WiFiUDP::packetsQueued()
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->getRxQueued();
+}
+
+uint32_t WiFiUDP::packetsDropped()
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->getRxDropped();
+}
+
+bool WiFiUDP::setRxQueueSize(size_t size)
+{
+    if (!_ctx)
+        return false;
+
+    return _ctx->setRxQueueSize(size);
+}
+
 void WiFiUDP::stopAll()
 {
     for (WiFiUDP* it = _s_first; it; it = it->_next) {
@@ -297,3 +407,13 @@ void WiFiUDP::stopAllExcept(WiFiUDP * exC) {
         }
     }
 }
+
+bool WiFiUDP::reserveContexts(size_t count)
+{
+    return UdpContext::pool_t::reserve(count);
+}
+
+ContextPoolStats WiFiUDP::contextPoolStats()
+{
+    return UdpContext::pool_t::stats();
+}
@@ -22,8 +22,10 @@
 #ifndef WIFIUDP_H
 #define WIFIUDP_H
 
+#include <functional>
 #include <Udp.h>
 #include <include/slist.h>
+#include <include/ContextPool.h>
 
 #define UDP_TX_PACKET_MAX_SIZE 8192
 
@@ -74,6 +76,24 @@ public:
   virtual size_t write(uint8_t);
   // Write size bytes from buffer into the packet
   virtual size_t write(const uint8_t *buffer, size_t size);
+  // Write size bytes from PROGMEM into the packet
+  size_t write_P(PGM_P buffer, size_t size);
+  // Get room for the whole packet, to be filled in place right after
+  // beginPacket() and then sent by endPacket() without being copied
+  // Returns NULL if something was written already or memory is short
+  uint8_t* reserve(size_t size);
+
+  // Sending several packets at once
+  // Set aside room for count packets of up to size bytes each, allocated in
+  // one go; beginBatchPacket() starts each packet, write() fills it, and
+  // endBatch() sends them all back to back. Returns 1 if the room was found
+  int beginBatch(size_t count, size_t size = 512);
+  // Start the next packet of the batch, to ip and port
+  // Returns 1 if successful, 0 if the count given to beginBatch() is reached
+  int beginBatchPacket(IPAddress ip, uint16_t port);
+  // Send the packets of the batch and release the room of the others
+  // Returns the number of packets sent
+  size_t endBatch();
   
   using Print::write;
 
@@ -103,10 +123,36 @@ public:
   IPAddress destinationIP();
   // Return the local port for outgoing packets
   uint16_t localPort();
+  // Return the millis() value at which the current packet was received
+  uint32_t receiveTime();
+
+  // Receiving several packets at once
+
+  struct PacketInfo {
+    IPAddress remoteIP;
+    uint16_t  remotePort;
+    IPAddress destinationIP;
+    uint32_t  time;           // millis() when received
+  };
+  typedef std::function<void(const uint8_t* data, size_t size, const PacketInfo& info)> THandlerFunction_Packet;
+  // Hand up to maxPackets queued packets to handler, one after another and
+  // without copying them; the data is only valid during the call.
+  // Returns the number of packets processed. The current packet is left alone.
+  size_t parsePackets(THandlerFunction_Packet handler, size_t maxPackets = (size_t) -1);
+  // Number of received packets not processed yet
+  size_t packetsQueued();
+  // Number of packets dropped because UDP_RX_QUEUE_SIZE packets were queued
+  uint32_t packetsDropped();
+  // Change how many received packets may be queued, only while none are
+  bool setRxQueueSize(size_t size);
 
   static void stopAll();
   static void stopAllExcept(WiFiUDP * exC);
 
+  // set aside room for count socket contexts in one block, see ContextPool.h
+  static bool reserveContexts(size_t count);
+  static ContextPoolStats contextPoolStats();
+
 };
 
 #endif //WIFIUDP_H
@@ -21,15 +21,50 @@
 #ifndef CLIENTCONTEXT_H
 #define CLIENTCONTEXT_H
 
+#include <functional>
+
 class ClientContext;
 class WiFiClient;
 
 typedef void (*discard_cb_t)(void*, ClientContext*);
+typedef std::function<void(size_t acked)> senthandler_t;
+typedef std::function<void(void)> eventhandler_t;
 
 extern "C" void esp_yield();
 extern "C" void esp_schedule();
+extern "C" void net_activity();
 
+#include <Schedule.h>
 #include "DataSource.h"
+#include "ContextPool.h"
+#include "TcpStats.h"
+#include "TcpProfile.h"
+
+// lwIP's coarse timer period (lwip/priv/tcp_priv.h), the unit of the
+// pcb's RTT estimate and retransmission timeout
+#ifndef TCP_SLOW_INTERVAL
+#define TCP_SLOW_INTERVAL 500
+#endif
+
+// Received data held unread, per connection and for all of them. A pbuf
+// that would go over either is refused: lwIP keeps it, acknowledged but
+// out of the window, drops the segments that follow until the peer sends
+// them again, and offers it again from its fast timer (every 250 ms) or
+// with the next segment. So a fast sender only fills the pbufs of a slow
+// reader up to the limit. A connection holding nothing takes a pbuf
+// whatever its size, so that none can get stuck.
+#ifndef TCP_RX_BUFFER_LIMIT
+#define TCP_RX_BUFFER_LIMIT TCP_WND
+#endif
+
+#ifndef TCP_RX_BUFFER_TOTAL_LIMIT
+#define TCP_RX_BUFFER_TOTAL_LIMIT (4 * TCP_WND)
+#endif
+
+struct RxBufferTotal {
+    size_t limit;
+    size_t buffered;
+};
 
 class ClientContext
 {
@@ -43,6 +78,7 @@ public:
         tcp_sent(pcb, &_s_sent);
         tcp_err(pcb, &_s_error);
         tcp_poll(pcb, &_s_poll, 1);
+        setProfile(defaultProfile());
 
         // not enabled by default for 2.4.0
         //keepAlive();
@@ -88,6 +124,20 @@ public:
     {
     }
 
+    typedef ContextPool<ClientContext, TCP_CONTEXT_POOL_SIZE> pool_t;
+
+    static void* operator new(size_t size)
+    {
+        (void) size;
+        assert(size == sizeof(ClientContext));
+        return pool_t::alloc();
+    }
+
+    static void operator delete(void* ptr)
+    {
+        pool_t::release(ptr);
+    }
+
     ClientContext* next() const
     {
         return _next;
@@ -119,6 +169,44 @@ public:
         }
     }
 
+    // see TCP_RX_BUFFER_LIMIT
+    void setRxBufferLimit(size_t bytes)
+    {
+        _rx_limit = bytes;
+    }
+
+    size_t getRxBufferLimit() const
+    {
+        return _rx_limit;
+    }
+
+    // Takes effect at once: a smaller window is closed as the data coming
+    // in is read, a larger one opened with what was held back.
+    void setProfile(const TcpProfile& profile)
+    {
+        _profile = profile;
+        _rx_limit = profile.rxBufferLimit ? profile.rxBufferLimit : TCP_RX_BUFFER_LIMIT;
+        _recved(0);
+    }
+
+    const TcpProfile& getProfile() const
+    {
+        return _profile;
+    }
+
+    // the profile of the contexts created from now on
+    static TcpProfile& defaultProfile()
+    {
+        static TcpProfile profile = TcpProfile();
+        return profile;
+    }
+
+    static RxBufferTotal& rxBufferTotal()
+    {
+        static RxBufferTotal total = { TCP_RX_BUFFER_TOTAL_LIMIT, 0 };
+        return total;
+    }
+
     int connect(ip_addr_t* addr, uint16_t port)
     {
         err_t err = tcp_connect(_pcb, addr, port, &ClientContext::_s_connected);
@@ -142,9 +230,21 @@ public:
         return 1;
     }
 
+    // start connecting and return at once; once established the sent
+    // handler is called with 0, failure shows as a disconnect event
+    int connectAsync(ip_addr_t* addr, uint16_t port)
+    {
+        err_t err = tcp_connect(_pcb, addr, port, &ClientContext::_s_connected);
+        if (err != ERR_OK) {
+            return 0;
+        }
+        _op_start_time = millis();
+        return 1;
+    }
+
     size_t availableForWrite()
     {
-        return _pcb? tcp_sndbuf(_pcb): 0;
+        return _pcb? _sndroom(): 0;
     }
 
     void setNoDelay(bool nodelay)
@@ -167,6 +267,79 @@ public:
         return tcp_nagle_disabled(_pcb);
     }
 
+    // Corked, writes are only queued (with TCP_WRITE_FLAG_MORE) and go out
+    // on flush(), or when the send buffer is full, in as few full segments
+    // as they fill
+    void setCork(bool cork)
+    {
+        _cork = cork;
+    }
+
+    bool getCork() const
+    {
+        return _cork;
+    }
+
+    // sends what is queued, Nagle set aside for what a cork held back
+    void flush()
+    {
+        if (!_pcb) {
+            return;
+        }
+        if (_cork && !tcp_nagle_disabled(_pcb)) {
+            tcp_nagle_disable(_pcb);
+            tcp_output(_pcb);
+            tcp_nagle_enable(_pcb);
+        } else {
+            tcp_output(_pcb);
+        }
+    }
+
+    // bytes handed to each tcp_write(), 0 to follow the connection's MSS
+    void setWriteChunkSize(size_t size)
+    {
+        _write_chunk_size = size;
+    }
+
+    size_t getWriteChunkSize() const
+    {
+        if (!_write_chunk_size && _pcb) {
+            return tcp_mss(_pcb);
+        }
+        return _write_chunk_size;
+    }
+
+    // when set, writes of memory buffers queue what fits into the send
+    // buffer and return without waiting for the rest
+    void setAsync(bool async)
+    {
+        _async = async;
+    }
+
+    bool getAsync() const
+    {
+        return _async;
+    }
+
+    // called from the network stack when sent data has been acknowledged
+    // and send buffer space is free again
+    void onSent(senthandler_t handler)
+    {
+        _sent_handler = handler;
+    }
+
+    // called from loop context after data arrives, or the connection is
+    // closed by the peer or lost; see _schedule_event()
+    void onData(eventhandler_t handler)
+    {
+        _data_handler = handler;
+    }
+
+    void onDisconnect(eventhandler_t handler)
+    {
+        _disconnect_handler = handler;
+    }
+
     void setTimeout(int timeout_ms) 
     {
         _timeout_ms = timeout_ms;
@@ -283,19 +456,73 @@ public:
         return copy_size;
     }
 
+    // Direct access to the received data, without copying it out of lwIP.
+    // peekBuffer() returns the contiguous bytes of the current pbuf,
+    // peekAvailable() their count, and peekConsume() drops what was used.
+    const char* peekBuffer()
+    {
+        if(!_rx_buf) {
+            return nullptr;
+        }
+
+        return reinterpret_cast<const char*>(_rx_buf->payload) + _rx_buf_offset;
+    }
+
+    size_t peekAvailable()
+    {
+        if(!_rx_buf) {
+            return 0;
+        }
+
+        return _rx_buf->len - _rx_buf_offset;
+    }
+
+    void peekConsume(size_t consume)
+    {
+        DEBUGV(":pc %d\r\n", consume);
+        while(consume && _rx_buf) {
+            size_t buf_size = _rx_buf->len - _rx_buf_offset;
+            size_t step = (consume < buf_size) ? consume : buf_size;
+            _consume(step);
+            consume -= step;
+        }
+    }
+
     void discard_received()
     {
         if(!_rx_buf) {
             return;
         }
         if(_pcb) {
-            tcp_recved(_pcb, (size_t) _rx_buf->tot_len);
+            _recved(_rx_buf->tot_len);
         }
+        rxBufferTotal().buffered -= _rx_buf->tot_len;
         pbuf_free(_rx_buf);
         _rx_buf = 0;
         _rx_buf_offset = 0;
     }
 
+    TcpStats getStats()
+    {
+        TcpStats stats = _stats;
+        stats.rxPbufs = _rx_buf ? pbuf_clen(_rx_buf) : 0;
+        stats.rxBuffered = getSize();
+        stats.rxWindowHeld = _rx_held;
+        if (_pcb) {
+            _count_retransmits();
+            stats.retransmits = _stats.retransmits;
+            stats.cwnd = _pcb->cwnd;
+            stats.sndWnd = _pcb->snd_wnd;
+            stats.sndBuf = tcp_sndbuf(_pcb);
+            stats.sndQueued = _pcb->snd_queuelen;
+            stats.mss = tcp_mss(_pcb);
+            // sa is the smoothed RTT scaled by 8
+            stats.srttMs = (uint32_t) (_pcb->sa >> 3) * TCP_SLOW_INTERVAL;
+            stats.rtoMs = (uint32_t) _pcb->rto * TCP_SLOW_INTERVAL;
+        }
+        return stats;
+    }
+
     void wait_until_sent()
     {
         // fix option 1 in
@@ -327,7 +554,9 @@ public:
         if (!_pcb) {
             return 0;
         }
-        return _write_from_source(new BufferDataSource(data, size));
+        // the source lives no longer than the call, no need for the heap
+        BufferDataSource source(data, size);
+        return _write_from_source(&source, _async, false);
     }
 
     size_t write(Stream& stream)
@@ -335,7 +564,18 @@ public:
         if (!_pcb) {
             return 0;
         }
-        return _write_from_source(new BufferedStreamDataSource<Stream>(stream, stream.available()));
+        BufferedStreamDataSource<Stream> source(stream, stream.available());
+        return _write_from_source(&source, false, false);
+    }
+
+    size_t write(fs::File& file)
+    {
+        if (!_pcb) {
+            return 0;
+        }
+        MappedFileStream stream(file);
+        BufferedStreamDataSource<MappedFileStream> source(stream, file.available());
+        return _write_from_source(&source, false, false);
     }
 
     size_t write_P(PGM_P buf, size_t size)
@@ -344,7 +584,19 @@ public:
             return 0;
         }
         ProgmemStream stream(buf, size);
-        return _write_from_source(new BufferedStreamDataSource<ProgmemStream>(stream, size));
+        BufferedStreamDataSource<ProgmemStream> source(stream, size);
+        return _write_from_source(&source, _async, false);
+    }
+
+    // takes ownership of ds; only sources whose unsent data the caller can
+    // offer again (no streams) may be written asynchronously
+    size_t write(DataSource* ds, bool async = false)
+    {
+        if (!_pcb) {
+            delete ds;
+            return 0;
+        }
+        return _write_from_source(ds, async && _async);
     }
 
     void keepAlive (uint16_t idle_sec = TCP_DEFAULT_KEEPALIVE_IDLE_SEC, uint16_t intv_sec = TCP_DEFAULT_KEEPALIVE_INTERVAL_SEC, uint8_t count = TCP_DEFAULT_KEEPALIVE_COUNT)
@@ -393,12 +645,20 @@ protected:
         }
     }
 
-    size_t _write_from_source(DataSource* ds)
+    // deletes ds when done if owned
+    size_t _write_from_source(DataSource* ds, bool async = false, bool owned = true)
     {
         assert(_datasource == nullptr);
         assert(_send_waiting == 0);
         _datasource = ds;
+        _datasource_owned = owned;
         _written = 0;
+        if (async) {
+            // queue what fits now, the caller offers the rest again later
+            _write_some();
+            _release_source();
+            return _written;
+        }
         _op_start_time = millis();
         do {
             if (_write_some()) {
@@ -409,18 +669,27 @@ protected:
                 if (_is_timeout()) {
                     DEBUGV(":wtmo\r\n");
                 }
-                delete _datasource;
-                _datasource = nullptr;
+                _release_source();
                 break;
             }
 
             ++_send_waiting;
+            uint32_t blocked = millis();
             esp_yield();
+            _stats.writeBlockedMs += millis() - blocked;
         } while(true);
         _send_waiting = 0;
         return _written;
     }
 
+    void _release_source()
+    {
+        if (_datasource_owned) {
+            delete _datasource;
+        }
+        _datasource = nullptr;
+    }
+
     bool _write_some()
     {
         if (!_datasource || !_pcb) {
@@ -428,8 +697,14 @@ protected:
         }
 
         size_t left = _datasource->available();
-        size_t can_send = tcp_sndbuf(_pcb);
-        if (_pcb->snd_queuelen >= TCP_SND_QUEUELEN) {
+        size_t can_send = _sndroom();
+        if (can_send < left && can_send < tcp_sndbuf(_pcb) && _pcb->snd_queuelen < TCP_SND_QUEUELEN) {
+            ++_stats.writesLimited;
+        }
+        size_t chunk_size = getWriteChunkSize();
+        if (can_send < left && can_send < tcp_mss(_pcb) && _pcb->unacked) {
+            // rather than queue a runt segment, wait for the next ACK to
+            // open the window
             can_send = 0;
         }
         size_t will_send = (can_send < left) ? can_send : left;
@@ -437,17 +712,20 @@ protected:
         bool need_output = false;
         while( will_send && _datasource) {
             size_t next_chunk =
-                will_send > _write_chunk_size ? _write_chunk_size : will_send;
+                will_send > chunk_size ? chunk_size : will_send;
             const uint8_t* buf = _datasource->get_buffer(next_chunk);
             if (state() == CLOSED) {
                 need_output = false;
                 break;
             }
-            err_t err = tcp_write(_pcb, buf, next_chunk, TCP_WRITE_FLAG_COPY);
+            uint8_t flags = TCP_WRITE_FLAG_COPY | (_cork ? TCP_WRITE_FLAG_MORE : 0);
+            err_t err = tcp_write(_pcb, buf, next_chunk, flags);
             DEBUGV(":wrc %d %d %d\r\n", next_chunk, will_send, (int) err);
             if (err == ERR_OK) {
                 _datasource->release_buffer(buf, next_chunk);
                 _written += next_chunk;
+                _stats.bytesOut += next_chunk;
+                ++_stats.writesOut;
                 need_output = true;
             } else {
 		// ERR_MEM(-1) is a valid error meaning
@@ -456,11 +734,14 @@ protected:
             }
             will_send -= next_chunk;
         }
-        if( need_output ) {
+        if (_cork && _datasource && _datasource->available()) {
+            // corked, what is left doesn't fit: the ACKs for what goes
+            // out make the room
+            tcp_output(_pcb);
+        } else if( need_output && !_cork ) {
             tcp_output(_pcb);
-            return true;
         }
-        return false;
+        return need_output;
     }
 
     void _write_some_from_cb()
@@ -476,10 +757,85 @@ protected:
         (void) pcb;
         (void) len;
         DEBUGV(":sent %d\r\n", len);
+        net_activity();
         _write_some_from_cb();
+        if (_sent_handler) {
+            _sent_handler(len);
+        }
         return ERR_OK;
     }
 
+    enum : uint8_t { EVENT_DATA = 1, EVENT_DISCONNECT = 2 };
+
+    // Run the handler for event with the next scheduled functions, at most
+    // once until then. The context is kept alive by a reference meanwhile;
+    // the handler is skipped if no WiFiClient holds the connection anymore.
+    void _schedule_event(uint8_t event)
+    {
+        eventhandler_t& handler = (event == EVENT_DATA) ? _data_handler : _disconnect_handler;
+        if (!handler || (_pending_events & event)) {
+            return;
+        }
+        ++_refcnt;
+        _pending_events |= event;
+        bool scheduled = schedule_function((event == EVENT_DATA) ? &_s_data_event : &_s_disconnect_event, this);
+        if (!scheduled) {
+            // a handler was set through a WiFiClient, which still holds a reference
+            --_refcnt;
+            _pending_events &= ~event;
+        }
+    }
+
+    void _run_event(uint8_t event)
+    {
+        _pending_events &= ~event;
+        eventhandler_t handler = (event == EVENT_DATA) ? _data_handler : _disconnect_handler;
+        if (handler && _refcnt > 1) {
+            handler();
+        }
+        unref();
+    }
+
+    // Room for tcp_write(), within lwIP's and the profile's limits.
+    size_t _sndroom() const
+    {
+        size_t queuelen = (_profile.sndQueueLen && _profile.sndQueueLen < TCP_SND_QUEUELEN) ?
+                          _profile.sndQueueLen : TCP_SND_QUEUELEN;
+        if (_pcb->snd_queuelen >= queuelen) {
+            return 0;
+        }
+        size_t room = tcp_sndbuf(_pcb);
+        if (_profile.sndBuf && _profile.sndBuf < TCP_SND_BUF) {
+            size_t queued = TCP_SND_BUF - room;
+            size_t left = (_profile.sndBuf > queued) ? _profile.sndBuf - queued : 0;
+            room = (left < room) ? left : room;
+        }
+        if (queuelen < TCP_SND_QUEUELEN) {
+            // a pbuf per chunk at most
+            size_t chunks = (queuelen - _pcb->snd_queuelen) * getWriteChunkSize();
+            room = (chunks < room) ? chunks : room;
+        }
+        return room;
+    }
+
+    // Gives the window back for size bytes read, less what the profile
+    // holds back to keep it at rxWindow; lwIP offers the full TCP_WND to
+    // begin with, so the window shrinks to it over the first bytes read.
+    void _recved(size_t size)
+    {
+        if (!_pcb) {
+            return;
+        }
+        size_t hold = (_profile.rxWindow && _profile.rxWindow < TCP_WND) ?
+                      TCP_WND - _profile.rxWindow : 0;
+        size_t credit = size + _rx_held;
+        _rx_held = (hold < credit) ? hold : credit;
+        credit -= _rx_held;
+        if (credit) {
+            tcp_recved(_pcb, credit);
+        }
+    }
+
     void _consume(size_t size)
     {
         ptrdiff_t left = _rx_buf->len - _rx_buf_offset - size;
@@ -488,8 +844,9 @@ protected:
         } else if(!_rx_buf->next) {
             DEBUGV(":c0 %d, %d\r\n", size, _rx_buf->tot_len);
             if(_pcb) {
-                tcp_recved(_pcb, _rx_buf->len);
+                _recved(_rx_buf->len);
             }
+            rxBufferTotal().buffered -= _rx_buf->len;
             pbuf_free(_rx_buf);
             _rx_buf = 0;
             _rx_buf_offset = 0;
@@ -500,8 +857,9 @@ protected:
             _rx_buf_offset = 0;
             pbuf_ref(_rx_buf);
             if(_pcb) {
-                tcp_recved(_pcb, head->len);
+                _recved(head->len);
             }
+            rxBufferTotal().buffered -= head->len;
             pbuf_free(head);
         }
     }
@@ -514,9 +872,22 @@ protected:
             DEBUGV(":rcl\r\n");
             _notify_error();
             abort();
+            _schedule_event(EVENT_DISCONNECT);
             return ERR_ABRT;
         }
 
+        RxBufferTotal& total = rxBufferTotal();
+        if(_rx_buf && (_rx_buf->tot_len + pb->tot_len > _rx_limit ||
+                       total.buffered + pb->tot_len > total.limit)) {
+            DEBUGV(":rrf %d, %d\r\n", _rx_buf->tot_len, pb->tot_len);
+            ++_stats.pbufsRefused;
+            return ERR_MEM;
+        }
+        total.buffered += pb->tot_len;
+
+        net_activity();
+        _stats.bytesIn += pb->tot_len;
+        _stats.pbufsIn += pbuf_clen(pb);
         if(_rx_buf) {
             DEBUGV(":rch %d, %d\r\n", _rx_buf->tot_len, pb->tot_len);
             pbuf_cat(_rx_buf, pb);
@@ -525,6 +896,7 @@ protected:
             _rx_buf = pb;
             _rx_buf_offset = 0;
         }
+        _schedule_event(EVENT_DATA);
         return ERR_OK;
     }
 
@@ -538,6 +910,7 @@ protected:
         tcp_err(_pcb, NULL);
         _pcb = NULL;
         _notify_error();
+        _schedule_event(EVENT_DISCONNECT);
     }
 
     err_t _connected(struct tcp_pcb *pcb, err_t err)
@@ -545,13 +918,32 @@ protected:
         (void) err;
         (void) pcb;
         assert(pcb == _pcb);
-        assert(_connect_pending);
-        esp_schedule();
+        if (_connect_pending) {
+            esp_schedule();
+        } else if (_sent_handler) {
+            _sent_handler(0);
+        }
         return ERR_OK;
     }
 
+    // nrtx counts the retransmissions of the oldest unacknowledged segment
+    // and goes back to 0 with the ACK. The slow timer retransmits on
+    // timeout right before it polls, so sampled there none of those are
+    // missed; a fast retransmit acknowledged before the next poll is.
+    void _count_retransmits()
+    {
+        if (_pcb->nrtx >= _last_nrtx) {
+            _stats.retransmits += _pcb->nrtx - _last_nrtx;
+        } else {
+            // acknowledged since, and retransmitting again
+            _stats.retransmits += _pcb->nrtx;
+        }
+        _last_nrtx = _pcb->nrtx;
+    }
+
     err_t _poll(tcp_pcb*)
     {
+        _count_retransmits();
         _write_some_from_cb();
         return ERR_OK;
     }
@@ -581,22 +973,44 @@ protected:
         return reinterpret_cast<ClientContext*>(arg)->_connected(pcb, err);
     }
 
+    static void _s_data_event(void* arg)
+    {
+        reinterpret_cast<ClientContext*>(arg)->_run_event(EVENT_DATA);
+    }
+
+    static void _s_disconnect_event(void* arg)
+    {
+        reinterpret_cast<ClientContext*>(arg)->_run_event(EVENT_DISCONNECT);
+    }
+
 private:
     tcp_pcb* _pcb;
 
     pbuf* _rx_buf;
     size_t _rx_buf_offset;
+    size_t _rx_limit = TCP_RX_BUFFER_LIMIT;
+    size_t _rx_held = 0;
+    TcpProfile _profile = TcpProfile();
 
     discard_cb_t _discard_cb;
     void* _discard_cb_arg;
 
     DataSource* _datasource = nullptr;
+    bool _datasource_owned = true;
     size_t _written = 0;
-    size_t _write_chunk_size = 256;
+    size_t _write_chunk_size = 0;
+    bool _cork = false;
     uint32_t _timeout_ms = 5000;
     uint32_t _op_start_time = 0;
     uint8_t _send_waiting = 0;
     uint8_t _connect_pending = 0;
+    bool _async = false;
+    senthandler_t _sent_handler;
+    eventhandler_t _data_handler;
+    eventhandler_t _disconnect_handler;
+    uint8_t _pending_events = 0;
+    TcpStats _stats = TcpStats();
+    uint8_t _last_nrtx = 0;
 
     int8_t _refcnt;
     ClientContext* _next;
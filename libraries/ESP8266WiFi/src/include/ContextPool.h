@@ -0,0 +1,124 @@
+/* ContextPool.h - fixed-size storage for connection contexts
+ * This file is distributed under MIT license.
+ *
+ * Contexts of TCP connections and UDP sockets come and go for as long as
+ * the device runs. Allocated one by one, they end up scattered across the
+ * heap and break it into pieces too small for larger buffers. A pool
+ * reserves room for a number of contexts in one block, ideally early in
+ * setup(), and hands out slots of it; once all slots are taken, further
+ * contexts come from the heap as before.
+ *
+ * The initial size of the pools can be set at compile time through
+ * TCP_CONTEXT_POOL_SIZE and UDP_CONTEXT_POOL_SIZE (default 0: no pool), in
+ * which case the block is reserved when the first context is created.
+ */
+#ifndef CONTEXTPOOL_H
+#define CONTEXTPOOL_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifndef TCP_CONTEXT_POOL_SIZE
+#define TCP_CONTEXT_POOL_SIZE 0
+#endif
+
+#ifndef UDP_CONTEXT_POOL_SIZE
+#define UDP_CONTEXT_POOL_SIZE 0
+#endif
+
+struct ContextPoolStats {
+    size_t   capacity;   // slots reserved
+    size_t   used;       // slots in use
+    size_t   highWater;  // most slots ever in use at once
+    uint32_t overflows;  // contexts that had to be allocated from the heap
+};
+
+template<typename T, size_t DefaultSize>
+class ContextPool {
+public:
+    // Reserve count slots. Only possible while no slot is in use; the
+    // previous block, if any, is released.
+    static bool reserve(size_t count)
+    {
+        if (_stats.used) {
+            return false;
+        }
+        free(_storage);
+        _storage = nullptr;
+        _free = nullptr;
+        _stats.capacity = 0;
+        _reserved = true;
+        if (!count) {
+            return true;
+        }
+        _storage = (Slot*) malloc(count * sizeof(Slot));
+        if (!_storage) {
+            return false;
+        }
+        for (size_t i = count; i--; ) {
+            _storage[i].next = _free;
+            _free = &_storage[i];
+        }
+        _stats.capacity = count;
+        return true;
+    }
+
+    static void* alloc()
+    {
+        if (!_reserved) {
+            reserve(DefaultSize);
+        }
+        Slot* slot = _free;
+        if (!slot) {
+            ++_stats.overflows;
+            return malloc(sizeof(T));
+        }
+        _free = slot->next;
+        if (++_stats.used > _stats.highWater) {
+            _stats.highWater = _stats.used;
+        }
+        return slot;
+    }
+
+    static void release(void* ptr)
+    {
+        Slot* slot = (Slot*) ptr;
+        if (!_storage || slot < _storage || slot >= _storage + _stats.capacity) {
+            free(ptr);
+            return;
+        }
+        slot->next = _free;
+        _free = slot;
+        --_stats.used;
+    }
+
+    static const ContextPoolStats& stats()
+    {
+        return _stats;
+    }
+
+protected:
+    union Slot {
+        Slot* next;
+        alignas(T) uint8_t data[sizeof(T)];
+    };
+
+    static Slot* _storage;
+    static Slot* _free;
+    static bool _reserved;
+    static ContextPoolStats _stats;
+};
+
+template<typename T, size_t DefaultSize>
+typename ContextPool<T, DefaultSize>::Slot* ContextPool<T, DefaultSize>::_storage = nullptr;
+
+template<typename T, size_t DefaultSize>
+typename ContextPool<T, DefaultSize>::Slot* ContextPool<T, DefaultSize>::_free = nullptr;
+
+template<typename T, size_t DefaultSize>
+bool ContextPool<T, DefaultSize>::_reserved = false;
+
+template<typename T, size_t DefaultSize>
+ContextPoolStats ContextPool<T, DefaultSize>::_stats = { 0, 0, 0, 0 };
+
+#endif//CONTEXTPOOL_H
@@ -6,6 +6,7 @@
 #define DATASOURCE_H
 
 #include <assert.h>
+#include <FS.h>
 
 class DataSource {
 public:
@@ -150,5 +151,168 @@ protected:
     size_t _left;
 };
 
+// Reads a file for BufferedStreamDataSource, with memcpy_P() straight from
+// the memory mapped flash where the file system has the data there, rather
+// than through its read path (and the SPIFFS cache, one more copy).
+class MappedFileStream
+{
+public:
+    MappedFileStream(fs::File& file) :
+        _file(file)
+    {
+    }
+
+    size_t readBytes(char* dst, size_t size)
+    {
+        size_t done = 0;
+        while (done < size) {
+            size_t piece;
+            const uint8_t* data = _file.mapped(piece);
+            if (!data) {
+                done += _file.read(reinterpret_cast<uint8_t*>(dst) + done, size - done);
+                break;
+            }
+            if (piece > size - done) {
+                piece = size - done;
+            }
+            memcpy_P(dst + done, data, piece);
+            if (!_file.seek(piece, fs::SeekCur)) {
+                break;
+            }
+            done += piece;
+        }
+        return done;
+    }
+
+protected:
+    fs::File& _file;
+};
+
+class ProgmemDataSource : public DataSource {
+public:
+    ProgmemDataSource(PGM_P data, size_t size) :
+        _data(data),
+        _size(size)
+    {
+    }
+
+    size_t available() override
+    {
+        return _size - _pos;
+    }
+
+    const uint8_t* get_buffer(size_t size) override
+    {
+        assert(_pos + size <= _size);
+        if (_bufferSize < size) {
+            _buffer.reset(new uint8_t[size]);
+            _bufferSize = size;
+        }
+        memcpy_P(_buffer.get(), _data + _pos, size);
+        return _buffer.get();
+    }
+
+    void release_buffer(const uint8_t* buffer, size_t size) override
+    {
+        (void)buffer;
+        _pos += size;
+    }
+
+protected:
+    PGM_P _data;
+    const size_t _size;
+    size_t _pos = 0;
+    std::unique_ptr<uint8_t[]> _buffer;
+    size_t _bufferSize = 0;
+};
+
+// Concatenation of several sources, which it owns.
+// A buffer requested across the end of one part is assembled in a staging
+// buffer; the parts involved are then released by fetching their (already
+// read) data again, which every source above allows.
+class ChainedDataSource : public DataSource {
+public:
+    ChainedDataSource(DataSource** parts, size_t count) :
+        _parts(parts),
+        _count(count)
+    {
+    }
+
+    ~ChainedDataSource()
+    {
+        for (size_t i = 0; i < _count; ++i) {
+            delete _parts[i];
+        }
+        delete[] _parts;
+    }
+
+    size_t available() override
+    {
+        size_t result = 0;
+        for (size_t i = _current; i < _count; ++i) {
+            result += _parts[i]->available();
+        }
+        return result;
+    }
+
+    const uint8_t* get_buffer(size_t size) override
+    {
+        while (_current < _count && !_parts[_current]->available()) {
+            ++_current;
+        }
+        assert(_current < _count);
+        if (_parts[_current]->available() >= size) {
+            _staged = false;
+            return _parts[_current]->get_buffer(size);
+        }
+
+        if (_stageSize < size) {
+            _stage.reset(new uint8_t[size]);
+            _stageSize = size;
+        }
+        size_t pos = 0;
+        for (size_t i = _current; pos < size && i < _count; ++i) {
+            size_t part = _parts[i]->available();
+            if (part > size - pos) {
+                part = size - pos;
+            }
+            if (part) {
+                memcpy(_stage.get() + pos, _parts[i]->get_buffer(part), part);
+                pos += part;
+            }
+        }
+        assert(pos == size);
+        _staged = true;
+        return _stage.get();
+    }
+
+    void release_buffer(const uint8_t* buffer, size_t size) override
+    {
+        if (!_staged) {
+            _parts[_current]->release_buffer(buffer, size);
+            return;
+        }
+        for (size_t i = _current; size && i < _count; ++i) {
+            size_t part = _parts[i]->available();
+            if (part > size) {
+                part = size;
+            }
+            if (part) {
+                _parts[i]->release_buffer(_parts[i]->get_buffer(part), part);
+                size -= part;
+            }
+        }
+        _staged = false;
+    }
+
+protected:
+    DataSource** _parts;
+    const size_t _count;
+    size_t _current = 0;
+    std::unique_ptr<uint8_t[]> _stage;
+    size_t _stageSize = 0;
+    bool _staged = false;
+};
+
 
 #endif //DATASOURCE_H
@@ -0,0 +1,45 @@
+/* TcpProfile.h - how much memory a TCP connection may take from lwIP
+ * This file is distributed under MIT license.
+ *
+ * lwIP's TCP_WND, TCP_SND_BUF and TCP_SND_QUEUELEN are fixed when it is
+ * built, and are the most a connection can have. A profile lowers them
+ * for a connection: a smaller receive window has the peer send less
+ * ahead of the reads, a smaller send buffer leaves less data and fewer
+ * pbufs queued waiting for ACKs. Pbufs come from the heap
+ * (MEMP_MEM_MALLOC), so this is what sets the memory a connection holds,
+ * and a device with many connections can give each less of it, while one
+ * with a single busy connection keeps lwIP's maximums.
+ *
+ * A field at 0 is lwIP's value, or TCP_RX_BUFFER_LIMIT for rxBufferLimit.
+ * Compare TcpStats before and after a change to see what it does.
+ */
+#ifndef TCPPROFILE_H
+#define TCPPROFILE_H
+
+#include <stdint.h>
+
+struct TcpProfile {
+    uint16_t rxWindow;       // receive window offered, up to TCP_WND
+    uint16_t sndBuf;         // bytes queued and not acknowledged, up to TCP_SND_BUF
+    uint16_t sndQueueLen;    // pbufs queued for sending, up to TCP_SND_QUEUELEN
+    uint32_t rxBufferLimit;  // received data held unread, see TCP_RX_BUFFER_LIMIT
+
+    // lwIP's values: the most a connection gets
+    static TcpProfile fast()
+    {
+        return TcpProfile();
+    }
+
+    // a window and a send buffer of 2 segments each
+    static TcpProfile lowMemory(uint16_t mss = 536)
+    {
+        TcpProfile profile = TcpProfile();
+        profile.rxWindow = 2 * mss;
+        profile.sndBuf = 2 * mss;
+        profile.sndQueueLen = 8;
+        profile.rxBufferLimit = 2 * mss;
+        return profile;
+    }
+};
+
+#endif//TCPPROFILE_H
@@ -0,0 +1,55 @@
+/* TcpStats.h - counters of a TCP connection and of the lwIP stack
+ * This file is distributed under MIT license.
+ *
+ * TcpStats tells where a slow transfer loses its time: in retransmits,
+ * in a small peer window, or in the sketch not reading (data piling up
+ * in rxPbufs) or in writes waiting for room (writeBlockedMs). The counters
+ * run from the creation of the connection context; the rest is the state
+ * of the pcb when the snapshot is taken, zero once it is closed.
+ *
+ * lwIP is built without LWIP_STATS, so there are no memp pool counters to
+ * read; LwipStats is what can be found from the lists of pcbs and of
+ * clients. Pcbs and pbufs come from the heap (MEMP_MEM_MALLOC), heapFree
+ * goes with them.
+ */
+#ifndef TCPSTATS_H
+#define TCPSTATS_H
+
+#include <stdint.h>
+
+struct TcpStats {
+    // counted by the connection context
+    uint32_t bytesIn;        // received, read or not
+    uint32_t pbufsIn;        // received segments (pbufs)
+    uint32_t pbufsRefused;   // given back to lwIP for later, over a limit
+    uint32_t bytesOut;       // queued with tcp_write()
+    uint32_t writesOut;      // tcp_write() calls
+    uint32_t retransmits;    // seen in the pcb at each poll (every 500 ms)
+    uint32_t writeBlockedMs; // blocking writes waiting for room or ACKs
+    uint32_t writesLimited;  // writes the profile left less room than lwIP had
+    // what is held now
+    uint16_t rxPbufs;        // pbufs received and not read yet
+    uint32_t rxBuffered;     // their bytes
+    uint16_t rxWindowHeld;   // window read and not given back, see TcpProfile
+    // the pcb, now
+    uint32_t cwnd;           // congestion window
+    uint32_t sndWnd;         // window offered by the peer
+    uint16_t sndBuf;         // room left in the send buffer
+    uint16_t sndQueued;      // pbufs queued for sending
+    uint16_t mss;
+    uint32_t srttMs;         // smoothed round trip time
+    uint32_t rtoMs;          // retransmission timeout
+};
+
+struct LwipStats {
+    uint16_t tcpActive;      // pcbs connecting, connected or closing
+    uint16_t tcpTimeWait;    // pcbs in TIME-WAIT, until they expire
+    uint16_t sndQueued;      // pbufs queued for sending on all pcbs
+    uint16_t clients;        // connections held by WiFiClients
+    uint16_t rxPbufs;        // pbufs these hold, received and not read yet
+    uint32_t rxBuffered;     // their bytes
+    uint32_t rxBufferedTotal; // by all contexts, WiFiClients or not
+    uint32_t heapFree;
+};
+
+#endif//TCPSTATS_H
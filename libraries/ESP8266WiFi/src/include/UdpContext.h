@@ -26,10 +26,16 @@ class UdpContext;
 extern "C" {
 void esp_yield();
 void esp_schedule();
+void net_activity();
 #include "lwip/init.h" // LWIP_VERSION_
 #include <assert.h>
 }
 
+#include "ContextPool.h"
+
+#ifndef UDP_RX_QUEUE_SIZE
+#define UDP_RX_QUEUE_SIZE 8 // datagrams kept before new ones are dropped
+#endif
 
 #define GET_IP_HDR(pb) reinterpret_cast<ip_hdr*>(((uint8_t*)((pb)->payload)) - UDP_HLEN - IP_HLEN);
 #define GET_UDP_HDR(pb) reinterpret_cast<udp_hdr*>(((uint8_t*)((pb)->payload)) - UDP_HLEN);
@@ -40,15 +46,32 @@ public:
 
     typedef std::function<void(void)> rxhandler_t;
 
+    // received datagram and where it came from
+    struct Packet {
+        pbuf*    pb;
+        uint32_t srcAddr;
+        uint32_t dstAddr;
+        uint16_t srcPort;
+        uint32_t time;      // millis() when received
+    };
+
     UdpContext()
     : _pcb(0)
     , _rx_buf(0)
-    , _first_buf_taken(false)
     , _rx_buf_offset(0)
+    , _rx_queue(0)
+    , _rx_capacity(UDP_RX_QUEUE_SIZE)
+    , _rx_head(0)
+    , _rx_count(0)
+    , _rx_dropped(0)
     , _refcnt(0)
     , _tx_buf_head(0)
     , _tx_buf_cur(0)
     , _tx_buf_offset(0)
+    , _batch(0)
+    , _batch_capacity(0)
+    , _batch_count(0)
+    , _batch_size(0)
     {
         _pcb = udp_new();
 #ifdef LWIP_MAYBE_XCC
@@ -73,6 +96,26 @@ public:
             _rx_buf = 0;
             _rx_buf_offset = 0;
         }
+        while (_rx_count)
+        {
+            pbuf_free(_pop().pb);
+        }
+        delete[] _rx_queue;
+        _clearBatch();
+    }
+
+    typedef ContextPool<UdpContext, UDP_CONTEXT_POOL_SIZE> pool_t;
+
+    static void* operator new(size_t size)
+    {
+        (void) size;
+        assert(size == sizeof(UdpContext));
+        return pool_t::alloc();
+    }
+
+    static void operator delete(void* ptr)
+    {
+        pool_t::release(ptr);
     }
 
     void ref()
@@ -136,6 +179,30 @@ public:
         _on_rx = handler;
     }
 
+    // Number of datagrams kept until the application reads them; only
+    // changes while none are waiting.
+    bool setRxQueueSize(size_t size)
+    {
+        if (_rx_count || !size)
+            return false;
+        delete[] _rx_queue;
+        _rx_queue = 0;
+        _rx_capacity = size;
+        _rx_head = 0;
+        return true;
+    }
+
+    size_t getRxQueued() const
+    {
+        return _rx_count;
+    }
+
+    // datagrams dropped because the queue was full
+    uint32_t getRxDropped() const
+    {
+        return _rx_dropped;
+    }
+
     size_t getSize() const
     {
         if (!_rx_buf)
@@ -144,6 +211,15 @@ public:
         return _rx_buf->len - _rx_buf_offset;
     }
 
+    // data of the current datagram from the read position on
+    const char* peekBuffer() const
+    {
+        if (!_rx_buf)
+            return 0;
+
+        return reinterpret_cast<const char*>(_rx_buf->payload) + _rx_buf_offset;
+    }
+
     size_t tell() const
     {
         return _rx_buf_offset;
@@ -164,8 +240,7 @@ public:
         if (!_rx_buf)
             return 0;
 
-        ip_hdr* iphdr = GET_IP_HDR(_rx_buf);
-        return iphdr->src.addr;
+        return _rx_cur.srcAddr;
     }
 
     uint16_t getRemotePort()
@@ -173,8 +248,7 @@ public:
         if (!_rx_buf)
             return 0;
 
-        udp_hdr* udphdr = GET_UDP_HDR(_rx_buf);
-        return ntohs(udphdr->src);
+        return _rx_cur.srcPort;
     }
 
     uint32_t getDestAddress()
@@ -182,8 +256,16 @@ public:
         if (!_rx_buf)
             return 0;
 
-        ip_hdr* iphdr = GET_IP_HDR(_rx_buf);
-        return iphdr->dest.addr;
+        return _rx_cur.dstAddr;
+    }
+
+    // millis() at the time the current datagram was received
+    uint32_t getReceiveTime()
+    {
+        if (!_rx_buf)
+            return 0;
+
+        return _rx_cur.time;
     }
 
     uint16_t getLocalPort()
@@ -194,27 +276,34 @@ public:
         return _pcb->local_port;
     }
 
+    // Release the current datagram and make the next queued one current.
     bool next()
     {
-        if (!_rx_buf)
-            return false;
-
-        if (!_first_buf_taken)
+        if (_rx_buf)
         {
-            _first_buf_taken = true;
-            return true;
+            pbuf_free(_rx_buf);
+            _rx_buf = 0;
+            _rx_buf_offset = 0;
         }
 
-        auto head = _rx_buf;
-        _rx_buf = _rx_buf->next;
-        _rx_buf_offset = 0;
+        if (!_rx_count)
+            return false;
 
-        if (_rx_buf)
-        {
-            pbuf_ref(_rx_buf);
-        }
-        pbuf_free(head);
-        return _rx_buf != 0;
+        _rx_cur = _pop();
+        _rx_buf = _rx_cur.pb;
+        return true;
+    }
+
+    // Take the next queued datagram out of the queue without making it
+    // current; the caller frees p.pb. Used to process several datagrams
+    // without copying them.
+    bool take(Packet& p)
+    {
+        if (!_rx_count)
+            return false;
+
+        p = _pop();
+        return true;
     }
 
     int read()
@@ -260,6 +349,201 @@ public:
 
 
     size_t append(const char* data, size_t size)
+    {
+        if (_batch)
+            return _appendBatch(data, size, memcpy);
+        return _append(data, size, memcpy);
+    }
+
+    size_t append_P(PGM_P data, size_t size)
+    {
+        if (_batch)
+            return _appendBatch(data, size, memcpy_P);
+        return _append(data, size, memcpy_P);
+    }
+
+    // Room for the whole packet in one pbuf, to be filled in place and
+    // sent by send() without further copying; only for an empty packet.
+    char* reserve(size_t size)
+    {
+        if (_tx_buf_offset)
+            return 0;
+        if (_tx_buf_head)
+            pbuf_free(_tx_buf_head);
+        _tx_buf_head = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_RAM);
+        _tx_buf_cur = _tx_buf_head;
+        if (!_tx_buf_head)
+            return 0;
+        _tx_buf_offset = size;
+        return reinterpret_cast<char*>(_tx_buf_head->payload);
+    }
+
+    bool send(ip_addr_t* addr = 0, uint16_t port = 0)
+    {
+        size_t data_size = _tx_buf_offset;
+        pbuf* tx_copy;
+        if (_tx_buf_head && !_tx_buf_head->next)
+        {
+            // data is contiguous already, send the pbuf itself
+            tx_copy = _tx_buf_head;
+            pbuf_realloc(tx_copy, data_size);
+        }
+        else
+        {
+            tx_copy = _linearize(data_size);
+            if (_tx_buf_head)
+                pbuf_free(_tx_buf_head);
+        }
+        _tx_buf_head = 0;
+        _tx_buf_cur = 0;
+        _tx_buf_offset = 0;
+        if(!tx_copy){
+            return false;
+        }
+
+
+        if (!addr) {
+            addr = &_pcb->remote_ip;
+            port = _pcb->remote_port;
+        }
+        net_activity();
+        return _sendto(tx_copy, addr, port);
+    }
+
+    // A batch of datagrams: count pbufs of size bytes are allocated at
+    // once, nextBatchPacket() starts each datagram, append() fills it in
+    // place and sendBatch() hands them all to lwIP one after another.
+    // Nothing is sent the usual way while a batch is open.
+    bool beginBatch(size_t count, size_t size)
+    {
+        _clearBatch();
+        if (!count || size > 0xffff)
+            return false;
+        _batch = new BatchPacket[count];
+        if (!_batch)
+            return false;
+        _batch_capacity = count;
+        _batch_size = size;
+        for (size_t i = 0; i < count; ++i)
+        {
+            _batch[i].pb = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_RAM);
+            if (!_batch[i].pb)
+            {
+                DEBUGV(":ubatch alloc %d/%d\r\n", (int) i, (int) count);
+                _clearBatch();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Start the next datagram of the batch, to addr:port; false once all
+    // of them are taken.
+    bool nextBatchPacket(const ip_addr_t& addr, uint16_t port)
+    {
+        if (!_batch || _batch_count == _batch_capacity)
+            return false;
+        BatchPacket& b = _batch[_batch_count++];
+        ip_addr_copy(b.addr, addr);
+        b.port = port;
+        b.len = 0;
+        return true;
+    }
+
+    // datagrams started in the open batch
+    size_t getBatchCount() const
+    {
+        return _batch_count;
+    }
+
+    // Send the datagrams started and close the batch, releasing the pbufs
+    // not used. Returns how many lwIP took.
+    size_t sendBatch()
+    {
+        size_t sent = 0;
+        if (_batch_count)
+            net_activity();
+        for (size_t i = 0; i < _batch_count; ++i)
+        {
+            BatchPacket& b = _batch[i];
+            pbuf_realloc(b.pb, b.len);
+            pbuf* pb = b.pb;
+            b.pb = 0;
+            if (_sendto(pb, &b.addr, b.port))
+                ++sent;
+        }
+        _clearBatch();
+        return sent;
+    }
+
+    // Close the batch without sending anything.
+    void cancelBatch()
+    {
+        _clearBatch();
+    }
+
+private:
+
+    struct BatchPacket {
+        pbuf*     pb;
+        ip_addr_t addr;
+        uint16_t  port;
+        uint16_t  len;      // filled so far, pb->len is the room
+    };
+
+    // sends pb and frees it
+    bool _sendto(pbuf* pb, ip_addr_t* addr, uint16_t port)
+    {
+#ifdef LWIP_MAYBE_XCC
+        uint16_t old_ttl = _pcb->ttl;
+        if (ip_addr_ismulticast(addr)) {
+            _pcb->ttl = _mcast_ttl;
+        }
+#endif
+        err_t err = udp_sendto(_pcb, pb, addr, port);
+        if (err != ERR_OK) {
+            DEBUGV(":ust rc=%d\r\n", (int) err);
+        }
+#ifdef LWIP_MAYBE_XCC
+        _pcb->ttl = old_ttl;
+#endif
+        pbuf_free(pb);
+        return err == ERR_OK;
+    }
+
+    void _clearBatch()
+    {
+        if (!_batch)
+            return;
+        for (size_t i = 0; i < _batch_capacity; ++i)
+        {
+            if (_batch[i].pb)
+                pbuf_free(_batch[i].pb);
+        }
+        delete[] _batch;
+        _batch = 0;
+        _batch_capacity = 0;
+        _batch_count = 0;
+        _batch_size = 0;
+    }
+
+    typedef void* (*copy_fn_t)(void*, const void*, size_t);
+
+    // what doesn't fit the datagram is cut off
+    size_t _appendBatch(const char* data, size_t size, copy_fn_t copy)
+    {
+        if (!_batch_count)
+            return 0;
+        BatchPacket& b = _batch[_batch_count - 1];
+        size_t room = _batch_size - b.len;
+        if (size > room)
+            size = room;
+        copy(reinterpret_cast<char*>(b.pb->payload) + b.len, data, size);
+        b.len += size;
+        return size;
+    }
+
+    size_t _append(const char* data, size_t size, copy_fn_t copy)
     {
         if (!_tx_buf_head || _tx_buf_head->tot_len < _tx_buf_offset + size)
         {
@@ -283,7 +567,7 @@ public:
                 continue;
             }
             size_t will_copy = (left_to_copy < free_cur) ? left_to_copy : free_cur;
-            memcpy(reinterpret_cast<char*>(_tx_buf_cur->payload) + used_cur, data, will_copy);
+            copy(reinterpret_cast<char*>(_tx_buf_cur->payload) + used_cur, data, will_copy);
             _tx_buf_offset += will_copy;
             left_to_copy -= will_copy;
             data += will_copy;
@@ -291,61 +575,30 @@ public:
         return size;
     }
 
-    bool send(ip_addr_t* addr = 0, uint16_t port = 0)
+    pbuf* _linearize(size_t data_size)
     {
-        size_t data_size = _tx_buf_offset;
         pbuf* tx_copy = pbuf_alloc(PBUF_TRANSPORT, data_size, PBUF_RAM);
         if(!tx_copy){
             DEBUGV("failed pbuf_alloc");
+            return 0;
         }
-        else{
-            uint8_t* dst = reinterpret_cast<uint8_t*>(tx_copy->payload);
-            for (pbuf* p = _tx_buf_head; p; p = p->next) {
-                size_t will_copy = (data_size < p->len) ? data_size : p->len;
-                memcpy(dst, p->payload, will_copy);
-                dst += will_copy;
-                data_size -= will_copy;
-            }
-        }
-        if (_tx_buf_head)
-            pbuf_free(_tx_buf_head);
-        _tx_buf_head = 0;
-        _tx_buf_cur = 0;
-        _tx_buf_offset = 0;
-        if(!tx_copy){
-            return false;
-        }
-
-
-        if (!addr) {
-            addr = &_pcb->remote_ip;
-            port = _pcb->remote_port;
-        }
-#ifdef LWIP_MAYBE_XCC
-        uint16_t old_ttl = _pcb->ttl;
-        if (ip_addr_ismulticast(addr)) {
-            _pcb->ttl = _mcast_ttl;
-        }
-#endif
-        err_t err = udp_sendto(_pcb, tx_copy, addr, port);
-        if (err != ERR_OK) {
-            DEBUGV(":ust rc=%d\r\n", (int) err);
+        uint8_t* dst = reinterpret_cast<uint8_t*>(tx_copy->payload);
+        for (pbuf* p = _tx_buf_head; p; p = p->next) {
+            size_t will_copy = (data_size < p->len) ? data_size : p->len;
+            memcpy(dst, p->payload, will_copy);
+            dst += will_copy;
+            data_size -= will_copy;
         }
-#ifdef LWIP_MAYBE_XCC
-        _pcb->ttl = old_ttl;
-#endif
-        pbuf_free(tx_copy);
-        return err == ERR_OK;
+        return tx_copy;
     }
 
-private:
-
     void _reserve(size_t size)
     {
         const size_t pbuf_unit_size = 128;
         if (!_tx_buf_head)
         {
-            _tx_buf_head = pbuf_alloc(PBUF_TRANSPORT, pbuf_unit_size, PBUF_RAM);
+            // a packet written at once fits into a single pbuf
+            _tx_buf_head = pbuf_alloc(PBUF_TRANSPORT, size > pbuf_unit_size ? size : pbuf_unit_size, PBUF_RAM);
             if (!_tx_buf_head)
             {
                 return;
@@ -374,6 +627,14 @@ private:
         }
     }
 
+    Packet _pop()
+    {
+        Packet p = _rx_queue[_rx_head];
+        _rx_head = (_rx_head + 1) % _rx_capacity;
+        --_rx_count;
+        return p;
+    }
+
     void _consume(size_t size)
     {
         _rx_buf_offset += size;
@@ -387,21 +648,29 @@ private:
     {
         (void) upcb;
         (void) addr;
-        (void) port;
-        if (_rx_buf)
+        net_activity();
+        if (!_rx_queue)
         {
-            // there is some unread data
-            // chain the new pbuf to the existing one
-            DEBUGV(":urch %d, %d\r\n", _rx_buf->tot_len, pb->tot_len);
-            pbuf_cat(_rx_buf, pb);
+            _rx_queue = new Packet[_rx_capacity];
         }
-        else
+        if (!_rx_queue || _rx_count == _rx_capacity)
         {
-            DEBUGV(":urn %d\r\n", pb->tot_len);
-            _first_buf_taken = false;
-            _rx_buf = pb;
-            _rx_buf_offset = 0;
+            DEBUGV(":urdrop %d\r\n", pb->tot_len);
+            ++_rx_dropped;
+            pbuf_free(pb);
+            return;
         }
+
+        DEBUGV(":urn %d\r\n", pb->tot_len);
+        ip_hdr* iphdr = GET_IP_HDR(pb);
+        Packet& p = _rx_queue[(_rx_head + _rx_count) % _rx_capacity];
+        p.pb = pb;
+        p.srcAddr = iphdr->src.addr;
+        p.dstAddr = iphdr->dest.addr;
+        p.srcPort = port;
+        p.time = millis();
+        ++_rx_count;
+
         if (_on_rx) {
             _on_rx();
         }
@@ -423,13 +692,22 @@ private:
 
 private:
     udp_pcb* _pcb;
-    pbuf* _rx_buf;
-    bool _first_buf_taken;
+    pbuf* _rx_buf;          // current datagram, see next()
     size_t _rx_buf_offset;
+    Packet _rx_cur;
+    Packet* _rx_queue;      // ring of datagrams not yet current
+    size_t _rx_capacity;
+    size_t _rx_head;
+    size_t _rx_count;
+    uint32_t _rx_dropped;
     int _refcnt;
     pbuf* _tx_buf_head;
     pbuf* _tx_buf_cur;
     size_t _tx_buf_offset;
+    BatchPacket* _batch;    // see beginBatch()
+    size_t _batch_capacity;
+    size_t _batch_count;
+    size_t _batch_size;
     rxhandler_t _on_rx;
 #ifdef LWIP_MAYBE_XCC
     uint16_t _mcast_ttl;
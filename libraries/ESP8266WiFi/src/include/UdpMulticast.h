@@ -0,0 +1,88 @@
+/*
+  UdpMulticast.h - UDP sockets shared by the multicast based responders
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef UDPMULTICAST_H
+#define UDPMULTICAST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+class UdpContext;
+
+// Fixed header of DNS style messages (mDNS, LLMNR, NetBIOS name service),
+// read straight from a received datagram.
+struct DNSHeaderView {
+    uint16_t id;
+    uint16_t flags;
+    uint16_t qdcount;
+    uint16_t ancount;
+    uint16_t nscount;
+    uint16_t arcount;
+
+    bool parse(const uint8_t* data, size_t size)
+    {
+        if (size < 12)
+            return false;
+        uint16_t* fields[] = { &id, &flags, &qdcount, &ancount, &nscount, &arcount };
+        for (size_t i = 0; i < 6; ++i)
+            *fields[i] = (data[2 * i] << 8) | data[2 * i + 1];
+        return true;
+    }
+
+    bool isResponse() const { return flags & 0x8000; }
+    uint8_t opcode() const { return (flags >> 11) & 0xf; }
+};
+
+// Services listening on a well-known port (mDNS on 5353, LLMNR on 5355,
+// SSDP on 1900, ...) subscribe here instead of opening a socket each.
+// All subscribers of a port share one UdpContext, and group memberships
+// are joined and left along with the subscriptions. Every datagram is
+// first offered to a subscriber's filter, which can turn it down from its
+// first bytes; accepted ones are passed to the handler as the current
+// packet of the shared context, rewound for each handler. Handlers must
+// neither call next() nor unsubscribe(), and run from the network stack
+// as onRx handlers do.
+class UdpMulticast
+{
+public:
+    typedef std::function<bool(const uint8_t* data, size_t size)> filter_t;
+    typedef std::function<void(UdpContext& ctx)> handler_t;
+
+    // Subscribe owner to datagrams on port, joining group (a multicast
+    // address, or 0 for none). Returns the port's shared context for
+    // sending, valid until unsubscribe(), or nullptr on failure.
+    static UdpContext* subscribe(const void* owner, uint32_t group, uint16_t port,
+                                 handler_t handler, filter_t filter = nullptr);
+    // End all subscriptions of owner.
+    static void unsubscribe(const void* owner);
+    // Handle datagrams waiting on port now; for services that poll.
+    static void dispatch(uint16_t port);
+
+protected:
+    struct Port;
+    struct Subscriber;
+
+    static void _dispatch(Port* port);
+
+    static Port* _ports;
+    static Subscriber* _subscribers;
+};
+
+#endif//UDPMULTICAST_H
@@ -0,0 +1,42 @@
+#include <ESP8266WiFi.h>
+#include <ESP8266MeshNode.h>
+
+void receive(uint32_t from, const uint8_t* data, size_t size);
+
+/* Create the mesh node object: the node with the lowest id becomes the root */
+ESP8266MeshNode mesh_node(ESP.getChipId(), receive);
+
+unsigned long last_send = 0;
+
+/**
+   Callback for the frames other nodes send to this one, or to all
+
+   @from The id of the node that sent it
+   @data @size The payload
+*/
+void receive(uint32_t from, const uint8_t* data, size_t size) {
+  Serial.printf("from Mesh_Node%u: %.*s\n", from, (int)size, (const char*)data);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(10);
+
+  Serial.println();
+  Serial.println();
+  Serial.println("Setting up mesh node...");
+
+  mesh_node.begin();
+}
+
+void loop() {
+  /* Keeps the links up and moves the frames, without blocking */
+  mesh_node.update();
+
+  if (millis() - last_send > 1000) {
+    last_send = millis();
+    char message[40];
+    int len = sprintf(message, "uptime %lu s", millis() / 1000);
+    mesh_node.send(MESH_BROADCAST, (const uint8_t*)message, len);
+  }
+}
@@ -0,0 +1,333 @@
+/*
+  ESP8266MeshNode.cpp - Mesh network node with persistent links
+  Every node keeps a TCP link to one parent node, whose access point it joins as a station,
+  and accepts child nodes on its own access point. Binary frames are routed along these links.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+
+#include "ESP8266MeshNode.h"
+
+#define SSID_PREFIX			"Mesh_Node"
+#define SERVER_PORT			4011
+#define RETRY_INTERVAL		10000	// ms between scans, or connections to the parent
+#define HEADER_SIZE			12		// length:2 type:1 ttl:1 source:4 destination:4, little endian
+
+ESP8266MeshNode::ESP8266MeshNode(uint32_t id, ReceiveHandler handler)
+: _id(id)
+, _handler(handler)
+, _server(SERVER_PORT)
+, _scanning(false)
+, _parentId(0)
+, _lastAttempt(0)
+, _routeCount(0)
+{
+	for (int i = 0; i < LINK_COUNT; i++) {
+		_links[i].peer = 0;
+		_links[i].rxLen = 0;
+		_links[i].txLen = 0;
+	}
+}
+
+/**
+ * Every node gets a /24 of its own, 10.x.y.0 from the low bits of its id, so that the
+ * station of a node and its access point are never on the same subnet.
+ */
+void ESP8266MeshNode::begin()
+{
+	IPAddress local(10, (_id >> 8) & 0xff, _id & 0xff, 1);
+	IPAddress mask(255, 255, 255, 0);
+	String ssid = String(SSID_PREFIX) + String(_id);
+
+	WiFi.mode(WIFI_AP_STA);
+	WiFi.softAPConfig(local, local, mask);
+	WiFi.softAP(ssid.c_str(), NULL, 1, 0, MESH_MAX_CHILDREN);
+	_server.begin();
+	_server.setNoDelay(true);
+	_lastAttempt = millis() - RETRY_INTERVAL;
+}
+
+/**
+ * The parent is the node with the strongest signal among those with a lower id: links
+ * only go down from lower ids to higher ones and can't make a loop. The node with the
+ * lowest id finds none and is the root of the tree.
+ */
+void ESP8266MeshNode::_updateParent()
+{
+	Link& parent = _links[LINK_PARENT];
+	if (parent.client.connected())
+		return;
+
+	if (_scanning) {
+		int n = WiFi.scanComplete();
+		if (n == WIFI_SCAN_RUNNING)
+			return;
+		_scanning = false;
+		int best = -1;
+		uint32_t bestId = 0;
+		for (int i = 0; i < n; ++i) {
+			String ssid = WiFi.SSID(i);
+			if (!ssid.startsWith(SSID_PREFIX))
+				continue;
+			uint32_t node = strtoul(ssid.c_str() + strlen(SSID_PREFIX), NULL, 10);
+			if (node == 0 || node >= _id)
+				continue;
+			if (best < 0 || WiFi.RSSI(i) > WiFi.RSSI(best)) {
+				best = i;
+				bestId = node;
+			}
+		}
+		if (best >= 0) {
+			WiFi.begin(WiFi.SSID(best).c_str(), NULL, WiFi.channel(best), WiFi.BSSID(best));
+			_parentId = bestId;
+		}
+		WiFi.scanDelete();
+		_lastAttempt = millis();
+		return;
+	}
+
+	if (millis() - _lastAttempt < RETRY_INTERVAL)
+		return;
+	_lastAttempt = millis();
+
+	if (_parentId && WiFi.status() == WL_CONNECTED) {
+		_close(LINK_PARENT);
+		if (parent.client.connect(WiFi.gatewayIP(), SERVER_PORT)) {
+			parent.client.setNoDelay(true);
+			_queue(LINK_PARENT, FRAME_HELLO, 1, _id, 0, NULL, 0);
+		}
+		return;
+	}
+
+	// not joined, or the parent went away: look for one again
+	_parentId = 0;
+	WiFi.disconnect();
+	WiFi.scanNetworks(true);
+	_scanning = true;
+}
+
+void ESP8266MeshNode::_acceptChildren()
+{
+	WiFiClient client = _server.available();
+	while (client) {
+		int i = LINK_PARENT + 1;
+		while (i < LINK_COUNT && _links[i].client.connected())
+			i++;
+		if (i == LINK_COUNT) {
+			client.stop();
+		} else {
+			_close(i);
+			_links[i].client = client;
+			_links[i].client.setNoDelay(true);
+			_queue(i, FRAME_HELLO, 1, _id, 0, NULL, 0);
+		}
+		client = _server.available();
+	}
+}
+
+void ESP8266MeshNode::update()
+{
+	_updateParent();
+	_acceptChildren();
+
+	for (int i = 0; i < LINK_COUNT; i++) {
+		if (!_links[i].client.connected()) {
+			if (_links[i].peer || _links[i].rxLen || _links[i].txLen)
+				_close(i);
+			continue;
+		}
+		_read(i);
+	}
+
+	// what the frames read added to the buffers goes out in one write per link
+	for (int i = 0; i < LINK_COUNT; i++)
+		_flush(i);
+}
+
+bool ESP8266MeshNode::send(uint32_t to, const uint8_t* data, size_t size)
+{
+	if (size > MESH_MAX_PAYLOAD || to == _id)
+		return false;
+	return _forward(-1, MESH_TTL, _id, to, data, size);
+}
+
+static uint32_t read32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write32(uint8_t* p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+/**
+ * Reads what is available on a link without waiting for the rest of a frame:
+ * that stays in the link's buffer until the next update().
+ */
+void ESP8266MeshNode::_read(int link)
+{
+	Link& l = _links[link];
+	size_t available;
+	while ((available = l.client.available()) > 0) {
+		size_t frameSize = 2;
+		if (l.rxLen >= 2) {
+			frameSize = 2 + (l.rx[0] | (l.rx[1] << 8));
+			if (frameSize < HEADER_SIZE || frameSize > sizeof(l.rx)) {
+				// not a mesh node, or out of step: start over
+				_close(link);
+				return;
+			}
+		}
+		size_t want = frameSize - l.rxLen;
+		l.rxLen += l.client.read(l.rx + l.rxLen, want < available ? want : available);
+		if (l.rxLen == frameSize && frameSize > 2) {
+			l.rxLen = 0;
+			_frame(link, l.rx, frameSize);
+		}
+	}
+}
+
+void ESP8266MeshNode::_frame(int link, const uint8_t* frame, size_t size)
+{
+	uint8_t type = frame[2];
+	uint8_t ttl = frame[3];
+	uint32_t src = read32(frame + 4);
+	uint32_t dst = read32(frame + 8);
+	const uint8_t* data = frame + HEADER_SIZE;
+	size -= HEADER_SIZE;
+
+	if (src == 0 || src == _id)
+		return;
+	_learn(src, link);
+
+	if (type == FRAME_HELLO) {
+		_links[link].peer = src;
+		return;
+	}
+	if (type != FRAME_DATA)
+		return;
+
+	if (dst == _id || dst == MESH_BROADCAST) {
+		if (_handler)
+			_handler(src, data, size);
+	}
+	if (dst != _id && ttl > 1)
+		_forward(link, ttl - 1, src, dst, data, size);
+}
+
+/**
+ * Broadcasts go to every link but the one they came from. Other frames go to the link the
+ * destination was heard on, or up to the parent when it wasn't: the root has heard of every node.
+ */
+bool ESP8266MeshNode::_forward(int from, uint8_t ttl, uint32_t src, uint32_t dst, const uint8_t* data, size_t size)
+{
+	if (dst == MESH_BROADCAST) {
+		bool queued = false;
+		for (int i = 0; i < LINK_COUNT; i++) {
+			if (i != from && _links[i].peer)
+				queued |= _queue(i, FRAME_DATA, ttl, src, dst, data, size);
+		}
+		return queued;
+	}
+
+	int link = _route(dst);
+	if (link < 0)
+		link = LINK_PARENT;
+	if (link == from)
+		return false;
+	return _queue(link, FRAME_DATA, ttl, src, dst, data, size);
+}
+
+bool ESP8266MeshNode::_queue(int link, uint8_t type, uint8_t ttl, uint32_t src, uint32_t dst, const uint8_t* data, size_t size)
+{
+	Link& l = _links[link];
+	size_t frameSize = HEADER_SIZE + size;
+	if (!l.client.connected())
+		return false;
+	if (l.txLen + frameSize > sizeof(l.tx))
+		_flush(link);
+
+	uint8_t* p = l.tx + l.txLen;
+	p[0] = (frameSize - 2);
+	p[1] = (frameSize - 2) >> 8;
+	p[2] = type;
+	p[3] = ttl;
+	write32(p + 4, src);
+	write32(p + 8, dst);
+	if (size)
+		memcpy(p + HEADER_SIZE, data, size);
+	l.txLen += frameSize;
+	return true;
+}
+
+void ESP8266MeshNode::_flush(int link)
+{
+	Link& l = _links[link];
+	if (!l.txLen)
+		return;
+	size_t size = l.txLen;
+	l.txLen = 0;
+	// a frame cut in the middle would leave the other end out of step
+	if (l.client.write(l.tx, size) != size)
+		_close(link);
+}
+
+void ESP8266MeshNode::_close(int link)
+{
+	Link& l = _links[link];
+	l.client.stop();
+	l.peer = 0;
+	l.rxLen = 0;
+	l.txLen = 0;
+
+	size_t kept = 0;
+	for (size_t i = 0; i < _routeCount; i++) {
+		if (_routes[i].link != link)
+			_routes[kept++] = _routes[i];
+	}
+	_routeCount = kept;
+}
+
+void ESP8266MeshNode::_learn(uint32_t node, int link)
+{
+	for (size_t i = 0; i < _routeCount; i++) {
+		if (_routes[i].node == node) {
+			_routes[i].link = link;
+			return;
+		}
+	}
+	// when the table is full, the nodes not in it are reached through the parent
+	if (_routeCount < MESH_MAX_ROUTES) {
+		_routes[_routeCount].node = node;
+		_routes[_routeCount].link = link;
+		_routeCount++;
+	}
+}
+
+int ESP8266MeshNode::_route(uint32_t node)
+{
+	for (size_t i = 0; i < _routeCount; i++) {
+		if (_routes[i].node == node)
+			return _routes[i].link;
+	}
+	return -1;
+}
@@ -0,0 +1,133 @@
+/*
+  ESP8266MeshNode.h - Mesh network node with persistent links
+  Every node keeps a TCP link to one parent node, whose access point it joins as a station,
+  and accepts child nodes on its own access point. Binary frames are routed along these links.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __MESHNODE_H__
+#define __MESHNODE_H__
+
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+#include <functional>
+
+#ifndef MESH_MAX_CHILDREN
+#define MESH_MAX_CHILDREN	4	// stations the access point takes by default
+#endif
+#ifndef MESH_MAX_PAYLOAD
+#define MESH_MAX_PAYLOAD	240
+#endif
+#ifndef MESH_TX_BUFFER
+#define MESH_TX_BUFFER		512	// frames for a link wait here until update() sends them together
+#endif
+#ifndef MESH_MAX_ROUTES
+#define MESH_MAX_ROUTES		32
+#endif
+#ifndef MESH_TTL
+#define MESH_TTL		16	// hops a frame may take
+#endif
+
+#define MESH_BROADCAST		0xffffffff
+
+class ESP8266MeshNode {
+
+public:
+
+	/**
+	 * @from The id of the node that sent the data.
+	 * @data The payload, valid during the call only.
+	 * @size Its length.
+	 */
+	typedef std::function<void(uint32_t from, const uint8_t* data, size_t size)> ReceiveHandler;
+
+	/**
+	 * MeshNode Constructor method. Creates a mesh node, ready to be initialised.
+	 *
+	 * @id A unique identifier number for the node, not 0, like ESP.getChipId().
+	 * @handler The callback handler for the data other nodes send to this one.
+	 *
+	 */
+	ESP8266MeshNode(uint32_t id, ReceiveHandler handler);
+
+	/**
+	 * Initialises the node: starts its access point, on a subnet of its own, and its server.
+	 */
+	void begin();
+
+	/**
+	 * Does what is due and returns: looks for a parent among the nodes with a lower id and
+	 * connects to it, accepts children, reads and routes frames and sends the ones waiting.
+	 * Call it from loop().
+	 */
+	void update();
+
+	/**
+	 * Send data to a node, or to all of them with MESH_BROADCAST. It goes out on the next update().
+	 *
+	 * @to The id of the node.
+	 * @data The payload, up to MESH_MAX_PAYLOAD bytes.
+	 * @size Its length.
+	 * @returns: False if it is too long or there is no link to send it on.
+	 *
+	 */
+	bool send(uint32_t to, const uint8_t* data, size_t size);
+
+	uint32_t id() const { return _id; }
+	bool hasParent() { return _links[0].client.connected() && _links[0].peer; }
+	// nodes heard of through the links, and the link each one is behind
+	size_t routes() const { return _routeCount; }
+
+protected:
+
+	struct Link {
+		WiFiClient client;
+		uint32_t peer;		// from its HELLO, 0 until then
+		size_t rxLen;
+		size_t txLen;
+		uint8_t rx[12 + MESH_MAX_PAYLOAD];
+		uint8_t tx[MESH_TX_BUFFER];
+	};
+
+	struct Route {
+		uint32_t node;
+		uint8_t link;
+	};
+
+	enum { LINK_PARENT = 0, LINK_COUNT = 1 + MESH_MAX_CHILDREN };
+	enum { FRAME_HELLO = 1, FRAME_DATA = 2 };
+
+	uint32_t _id;
+	ReceiveHandler _handler;
+	WiFiServer _server;
+	bool _scanning;
+	uint32_t _parentId;	// the node whose access point the station joined, 0 if none
+	uint32_t _lastAttempt;	// millis() of the last scan or connection to the parent
+	Link _links[LINK_COUNT];
+	Route _routes[MESH_MAX_ROUTES];
+	size_t _routeCount;
+
+	void _updateParent();
+	void _acceptChildren();
+	void _read(int link);
+	void _frame(int link, const uint8_t* frame, size_t size);
+	bool _queue(int link, uint8_t type, uint8_t ttl, uint32_t src, uint32_t dst, const uint8_t* data, size_t size);
+	void _flush(int link);
+	void _close(int link);
+	void _learn(uint32_t node, int link);
+	int _route(uint32_t node);
+	bool _forward(int from, uint8_t ttl, uint32_t src, uint32_t dst, const uint8_t* data, size_t size);
+};
+
+#endif
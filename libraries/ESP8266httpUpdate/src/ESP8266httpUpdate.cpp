@@ -25,10 +25,13 @@
 
 #include "ESP8266httpUpdate.h"
 #include <StreamString.h>
+#include <DeltaPatcher.h>
 
 extern "C" uint32_t _SPIFFS_start;
 extern "C" uint32_t _SPIFFS_end;
 
+#define RESUME_MAGIC 0x52555045
+
 ESP8266HTTPUpdate::ESP8266HTTPUpdate(void)
 {
 }
@@ -190,7 +193,19 @@ HTTPUpdateResult ESP8266HTTPUpdate::handleUpdate(HTTPClient& http, const String&
         http.addHeader(F("x-ESP8266-version"), currentVersion);
     }
 
-    const char * headerkeys[] = { "x-MD5" };
+    // ask for the rest of an image that stopped part way; If-Range makes
+    // the server send all of it if it changed since
+    ResumeState resume;
+    bool resuming = _resume && readResume(resume) && resume.command == (uint32_t) (spiffs ? U_SPIFFS : U_FLASH);
+    if(resuming) {
+        DEBUG_HTTP_UPDATE("[httpUpdate] resuming at %u of %u\n", resume.written, resume.size);
+        http.addHeader(F("Range"), String(F("bytes=")) + resume.written + '-');
+        if(resume.etag) {
+            http.addHeader(F("If-Range"), resume.tag);
+        }
+    }
+
+    const char * headerkeys[] = { "x-MD5", "ETag", "Content-Range" };
     size_t headerkeyssize = sizeof(headerkeys) / sizeof(char*);
 
     // track these headers
@@ -225,8 +240,28 @@ HTTPUpdateResult ESP8266HTTPUpdate::handleUpdate(HTTPClient& http, const String&
         DEBUG_HTTP_UPDATE("[httpUpdate]  - current version: %s\n", currentVersion.c_str() );
     }
 
+    // the size of the whole image, and where this response starts in it
+    uint32_t offset = 0;
+    if(code == HTTP_CODE_PARTIAL_CONTENT) {
+        unsigned first, last, total;
+        String tag = http.header(resuming && resume.etag ? "ETag" : "x-MD5");
+        if(!resuming || tag != resume.tag ||
+                sscanf(http.header("Content-Range").c_str(), "bytes %u-%u/%u", &first, &last, &total) != 3 ||
+                first != resume.written || total != resume.size || len != (int) (total - first)) {
+            DEBUG_HTTP_UPDATE("[httpUpdate] not the rest of the image: %s\n", http.header("Content-Range").c_str());
+            code = HTTP_CODE_RANGE_NOT_SATISFIABLE;
+        } else {
+            offset = first;
+            len = total;
+        }
+    }
+    if(resuming && code != HTTP_CODE_PARTIAL_CONTENT) {
+        clearResume();
+    }
+
     switch(code) {
     case HTTP_CODE_OK:  ///< OK (Start Update)
+    case HTTP_CODE_PARTIAL_CONTENT:
         if(len > 0) {
             bool startUpdate = true;
             if(spiffs) {
@@ -264,7 +299,7 @@ HTTPUpdateResult ESP8266HTTPUpdate::handleUpdate(HTTPClient& http, const String&
                     DEBUG_HTTP_UPDATE("[httpUpdate] runUpdate flash...\n");
                 }
 
-                if(!spiffs) {
+                if(!spiffs && offset == 0) {
                     uint8_t buf[4];
                     if(tcp->peekBytes(&buf[0], 4) != 4) {
                         DEBUG_HTTP_UPDATE("[httpUpdate] peekBytes magic header failed\n");
@@ -273,8 +308,10 @@ HTTPUpdateResult ESP8266HTTPUpdate::handleUpdate(HTTPClient& http, const String&
                         return HTTP_UPDATE_FAILED;
                     }
 
-                    // check for valid first magic byte
-                    if(buf[0] != 0xE9) {
+                    // check for valid first magic byte; a gzip compressed
+                    // image or a patch is checked by the Updater once decoded
+                    bool encoded = (buf[0] == 0x1f && buf[1] == 0x8b) || DeltaPatcher::isPatch(buf, sizeof(buf));
+                    if(buf[0] != 0xE9 && !encoded) {
                         DEBUG_HTTP_UPDATE("[httpUpdate] Magic header does not start with 0xE9\n");
                         _lastError = HTTP_UE_BIN_VERIFY_HEADER_FAILED;
                         http.end();
@@ -285,7 +322,7 @@ HTTPUpdateResult ESP8266HTTPUpdate::handleUpdate(HTTPClient& http, const String&
                     uint32_t bin_flash_size = ESP.magicFlashChipSize((buf[3] & 0xf0) >> 4);
 
                     // check if new bin fits to SPI flash
-                    if(bin_flash_size > ESP.getFlashChipRealSize()) {
+                    if(!encoded && bin_flash_size > ESP.getFlashChipRealSize()) {
                         DEBUG_HTTP_UPDATE("[httpUpdate] New binary does not fit SPI Flash size\n");
                         _lastError = HTTP_UE_BIN_FOR_WRONG_FLASH;
                         http.end();
@@ -293,11 +330,16 @@ HTTPUpdateResult ESP8266HTTPUpdate::handleUpdate(HTTPClient& http, const String&
                     }
                 }
 
-                if(runUpdate(*tcp, len, http.header("x-MD5"), command)) {
+                if(runUpdate(*tcp, len, http.header("x-MD5"), command, offset)) {
                     ret = HTTP_UPDATE_OK;
                     DEBUG_HTTP_UPDATE("[httpUpdate] Update ok\n");
                     http.end();
 
+                    // for a sketch the bootloader command took the place
+                    if(_resume && spiffs) {
+                        clearResume();
+                    }
+
                     if(_rebootOnUpdate && !spiffs) {
                         ESP.restart();
                     }
@@ -305,6 +347,22 @@ HTTPUpdateResult ESP8266HTTPUpdate::handleUpdate(HTTPClient& http, const String&
                 } else {
                     ret = HTTP_UPDATE_FAILED;
                     DEBUG_HTTP_UPDATE("[httpUpdate] Update failed\n");
+                    // only what stopped for lack of data can go on later
+                    String etag = http.header("ETag");
+                    String tag = etag.length() ? etag : http.header("x-MD5");
+                    if(_resume && _lastError == UPDATE_ERROR_STREAM && Update.resumePoint() > 0 &&
+                            tag.length() && tag.length() < HTTP_UPDATE_RESUME_TAG) {
+                        resume.size = len;
+                        resume.command = command;
+                        resume.written = Update.resumePoint();
+                        resume.etag = etag.length() > 0;
+                        memset(resume.tag, 0, sizeof(resume.tag));
+                        strcpy(resume.tag, tag.c_str());
+                        writeResume(resume);
+                        DEBUG_HTTP_UPDATE("[httpUpdate] can resume at %u\n", resume.written);
+                    } else if(_resume) {
+                        clearResume();
+                    }
                 }
             }
         } else {
@@ -344,7 +402,7 @@ HTTPUpdateResult ESP8266HTTPUpdate::handleUpdate(HTTPClient& http, const String&
  * @param md5 String
  * @return true if Update ok
  */
-bool ESP8266HTTPUpdate::runUpdate(Stream& in, uint32_t size, String md5, int command)
+bool ESP8266HTTPUpdate::runUpdate(Stream& in, uint32_t size, String md5, int command, uint32_t offset)
 {
 
     StreamString error;
@@ -365,7 +423,15 @@ bool ESP8266HTTPUpdate::runUpdate(Stream& in, uint32_t size, String md5, int com
         }
     }
 
-    if(Update.writeStream(in) != size) {
+    if(offset && !Update.resume(offset)) {
+        _lastError = Update.getError();
+        Update.printError(error);
+        error.trim(); // remove line ending
+        DEBUG_HTTP_UPDATE("[httpUpdate] Update.resume failed! (%s)\n", error.c_str());
+        return false;
+    }
+
+    if(Update.writeStream(in) != size - offset) {
         _lastError = Update.getError();
         Update.printError(error);
         error.trim(); // remove line ending
@@ -384,6 +450,40 @@ bool ESP8266HTTPUpdate::runUpdate(Stream& in, uint32_t size, String md5, int com
     return true;
 }
 
+static uint32_t resumeChecksum(const uint8_t* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    while(size--) {
+        hash = (hash ^ *data++) * 16777619u;
+    }
+    return hash;
+}
+
+bool ESP8266HTTPUpdate::readResume(ResumeState& state)
+{
+    static_assert(sizeof(ResumeState) <= HTTP_UPDATE_RESUME_RTC_BLOCKS * 4,
+                  "the resume state doesn't fit in its area of RtcMemoryMap.h");
+    if(!ESP.rtcUserMemoryRead(HTTP_UPDATE_RESUME_RTC_OFFSET, (uint32_t*) &state, sizeof(state))) {
+        return false;
+    }
+    return state.magic == RESUME_MAGIC &&
+           state.checksum == resumeChecksum((const uint8_t*) &state, offsetof(ResumeState, checksum)) &&
+           state.tag[HTTP_UPDATE_RESUME_TAG - 1] == 0;
+}
+
+void ESP8266HTTPUpdate::writeResume(ResumeState& state)
+{
+    state.magic = RESUME_MAGIC;
+    state.checksum = resumeChecksum((const uint8_t*) &state, offsetof(ResumeState, checksum));
+    ESP.rtcUserMemoryWrite(HTTP_UPDATE_RESUME_RTC_OFFSET, (uint32_t*) &state, sizeof(state));
+}
+
+void ESP8266HTTPUpdate::clearResume()
+{
+    uint32_t magic = 0;
+    ESP.rtcUserMemoryWrite(HTTP_UPDATE_RESUME_RTC_OFFSET, &magic, sizeof(magic));
+}
+
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_HTTPUPDATE)
 ESP8266HTTPUpdate ESPhttpUpdate;
 #endif
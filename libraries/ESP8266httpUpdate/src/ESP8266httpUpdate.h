@@ -31,6 +31,7 @@
 #include <WiFiClient.h>
 #include <WiFiUdp.h>
 #include <ESP8266HTTPClient.h>
+#include <RtcMemoryMap.h>
 
 #ifdef DEBUG_ESP_HTTP_UPDATE
 #ifdef DEBUG_ESP_PORT
@@ -52,6 +53,12 @@
 #define HTTP_UE_BIN_VERIFY_HEADER_FAILED    (-106)
 #define HTTP_UE_BIN_FOR_WRONG_FLASH         (-107)
 
+// A download that stopped part way is noted in RTC user memory at
+// HTTP_UPDATE_RESUME_RTC_OFFSET, in the 4 byte blocks
+// ESP.rtcUserMemoryRead() and Write() count in: by default blocks 64 to
+// 85, see RtcMemoryMap.h.
+#define HTTP_UPDATE_RESUME_TAG 64
+
 enum HTTPUpdateResult {
     HTTP_UPDATE_FAILED,
     HTTP_UPDATE_NO_UPDATES,
@@ -71,6 +78,15 @@ public:
         _rebootOnUpdate = reboot;
     }
 
+    // When a download stops part way, keep what is on the flash and note
+    // it in RTC memory, so the next update of the same image, after a
+    // reset too, asks the server for the rest with a Range request. The
+    // server has to send an ETag or x-MD5 header to know it is the same.
+    void resumeDownloads(bool resume)
+    {
+        _resume = resume;
+    }
+
     // This function is deprecated, use rebootOnUpdate and the next one instead
     t_httpUpdate_return update(const String& url, const String& currentVersion,
                                const String& httpsFingerprint, bool reboot) __attribute__((deprecated));
@@ -99,10 +115,25 @@ public:
 
 protected:
     t_httpUpdate_return handleUpdate(HTTPClient& http, const String& currentVersion, bool spiffs = false);
-    bool runUpdate(Stream& in, uint32_t size, String md5, int command = U_FLASH);
+    bool runUpdate(Stream& in, uint32_t size, String md5, int command = U_FLASH, uint32_t offset = 0);
+
+    struct ResumeState {
+        uint32_t magic;
+        uint32_t size;
+        uint32_t command;
+        uint32_t written;
+        uint32_t etag; // tag is the ETag, else the x-MD5
+        char tag[HTTP_UPDATE_RESUME_TAG];
+        uint32_t checksum;
+    };
+
+    bool readResume(ResumeState& state);
+    void writeResume(ResumeState& state);
+    void clearResume();
 
     int _lastError;
     bool _rebootOnUpdate = true;
+    bool _resume = false;
 };
 
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_HTTPUPDATE)
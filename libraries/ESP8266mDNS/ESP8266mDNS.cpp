@@ -56,6 +56,8 @@ extern "C" {
 #include "lwip/igmp.h"
 #include "lwip/mem.h"
 #include "include/UdpContext.h"
+#include "include/UdpMulticast.h"
+#include <Schedule.h>
 
 
 
@@ -87,10 +89,43 @@ extern "C" {
 #define _conn_read8() _conn->read()
 #define _conn_readS(b,l) _conn->read((char*)(b),l);
 
+// the same answers are multicast at most once in this many ms
+#ifndef MDNS_RESPONSE_INTERVAL
+#define MDNS_RESPONSE_INTERVAL 1000
+#endif
+
 static const IPAddress MDNS_MULTICAST_ADDR(224, 0, 0, 251);
 static const int MDNS_MULTICAST_TTL = 1;
 static const int MDNS_PORT = 5353;
 
+// Records are indexed like the bits of the answer masks
+#define MDNS_RECORD_A     0
+#define MDNS_RECORD_SRV   1
+#define MDNS_RECORD_TXT   2
+#define MDNS_RECORD_PTR   3
+#define MDNS_RECORD_ENUM  4 // PTR of _services._dns-sd._udp.local
+#define MDNS_RECORD_COUNT 5
+
+static const uint32_t MDNS_RECORD_TTL[MDNS_RECORD_COUNT] = { 120, 120, 4500, 120, 4500 };
+
+#define MDNS_SENT_ENUM    0x100 // _sentMask of a type enumeration reply
+
+// the most service instances remembered from queries and browsing
+#ifndef MDNS_ANSWER_CACHE_SIZE
+#define MDNS_ANSWER_CACHE_SIZE 16
+#endif
+
+// Answers of a service, or of the host alone, serialized ahead of time so
+// that a reply is only a matter of copying them into the packet.
+struct MDNSRecords {
+  uint8_t* _data;
+  uint16_t _offset[MDNS_RECORD_COUNT + 1]; // record i is _data[_offset[i] .. _offset[i + 1])
+  // what was last multicast and where, for rate limiting
+  uint32_t _sentTime;
+  uint32_t _sentAddr;
+  uint16_t _sentMask;
+};
+
 struct MDNSService {
   MDNSService* _next;
   char _name[32];
@@ -98,6 +133,7 @@ struct MDNSService {
   uint16_t _port;
   uint16_t _txtLen; // length of all txts 
   struct MDNSTxt * _txts;
+  struct MDNSRecords _records;
 };
 
 struct MDNSTxt{
@@ -110,6 +146,9 @@ struct MDNSAnswer {
   uint8_t ip[4];
   uint16_t port;
   char *hostname;
+  char service[32];
+  char proto[4];
+  uint32_t expires; // millis() when the shortest lived of its records runs out
 };
 
 struct MDNSQuery {
@@ -117,13 +156,147 @@ struct MDNSQuery {
   char _proto[4];
 };
 
+// Writes DNS records to a buffer, or with no buffer only counts their size.
+class MDNSRecordWriter {
+public:
+  MDNSRecordWriter(uint8_t* buf) : _buf(buf), _pos(0) {}
+
+  size_t pos() const { return _pos; }
+
+  void bytes(const void* data, size_t len) {
+    if (_buf)
+      memcpy(_buf + _pos, data, len);
+    _pos += len;
+  }
+  void u8(uint8_t v) { bytes(&v, 1); }
+  void u16(uint16_t v) { u8(v >> 8); u8(v & 0xFF); }
+  void u32(uint32_t v) { u16(v >> 16); u16(v & 0xFFFF); }
+
+  void label(const char* name, bool underscore = false) {
+    size_t len = os_strlen(name);
+    u8(len + underscore);
+    if (underscore)
+      u8('_');
+    bytes(name, len);
+  }
+  void local() { label("local"); u8(0); }
+
+  // "esp8266.local"
+  void hostName(const char* host) { label(host); local(); }
+  // "_http._tcp.local"
+  void serviceName(const char* service, const char* proto) { label(service, true); label(proto, true); local(); }
+  // "My IOT device._http._tcp.local"
+  void instanceName(const char* instance, const char* service, const char* proto) { label(instance); serviceName(service, proto); }
+
+  // response + authoritative answer, no questions
+  void responseHeader(uint16_t answers, uint16_t additional) { u16(0); u16(0x8400); u16(0); u16(answers); u16(0); u16(additional); }
+  void attrs(uint16_t type, uint16_t cls, uint32_t ttl, uint16_t rdlength) { u16(type); u16(cls); u32(ttl); u16(rdlength); }
+
+protected:
+  uint8_t* _buf;
+  size_t _pos;
+};
+
+// All records of service, or only the A record of the host if there is no
+// service. The address in the A record is filled in when it is sent.
+static void _writeRecords(MDNSRecordWriter& w, MDNSRecords* records, const char* host, const char* instance, MDNSService* service) {
+  uint16_t* offset = records->_offset;
+
+  offset[MDNS_RECORD_A] = w.pos();
+  if (!service) {
+    w.hostName(host);
+    w.attrs(MDNS_TYPE_A, MDNS_CLASS_IN_FLUSH_CACHE, MDNS_RECORD_TTL[MDNS_RECORD_A], 4);
+    w.u32(0);
+  }
+
+  offset[MDNS_RECORD_SRV] = w.pos();
+  if (service) {
+    MDNSRecordWriter name(0);
+    name.hostName(host);
+    w.instanceName(instance, service->_name, service->_proto);
+    w.attrs(MDNS_TYPE_SRV, MDNS_CLASS_IN_FLUSH_CACHE, MDNS_RECORD_TTL[MDNS_RECORD_SRV], 6 + name.pos());
+    w.u16(0); // priority
+    w.u16(0); // weight
+    w.u16(service->_port);
+    w.hostName(host);
+  }
+
+  offset[MDNS_RECORD_TXT] = w.pos();
+  if (service) {
+    w.instanceName(instance, service->_name, service->_proto);
+    w.attrs(MDNS_TYPE_TXT, MDNS_CLASS_IN_FLUSH_CACHE, MDNS_RECORD_TTL[MDNS_RECORD_TXT], service->_txtLen);
+    for (MDNSTxt* txt = service->_txts; txt; txt = txt->_next) {
+      w.u8(txt->_txt.length());
+      w.bytes(txt->_txt.c_str(), txt->_txt.length());
+    }
+  }
+
+  offset[MDNS_RECORD_PTR] = w.pos();
+  if (service) {
+    MDNSRecordWriter name(0);
+    name.instanceName(instance, service->_name, service->_proto);
+    w.serviceName(service->_name, service->_proto);
+    w.attrs(MDNS_TYPE_PTR, MDNS_CLASS_IN, MDNS_RECORD_TTL[MDNS_RECORD_PTR], name.pos());
+    w.instanceName(instance, service->_name, service->_proto);
+  }
+
+  offset[MDNS_RECORD_ENUM] = w.pos();
+  if (service) {
+    MDNSRecordWriter name(0);
+    name.serviceName(service->_name, service->_proto);
+    w.label("services", true);
+    w.label("dns-sd", true);
+    w.label("udp", true);
+    w.local();
+    w.attrs(MDNS_TYPE_PTR, MDNS_CLASS_IN, MDNS_RECORD_TTL[MDNS_RECORD_ENUM], name.pos());
+    w.serviceName(service->_name, service->_proto);
+  }
+
+  offset[MDNS_RECORD_COUNT] = w.pos();
+}
+
+static size_t _recordSize(const MDNSRecords* records, int record) {
+  return records->_offset[record + 1] - records->_offset[record];
+}
+
+static void _copyRecord(MDNSRecordWriter& w, const MDNSRecords* records, int record) {
+  w.bytes(records->_data + records->_offset[record], _recordSize(records, record));
+}
+
+static bool _sentRecently(const MDNSRecords* records, uint16_t mask, uint32_t addr) {
+  return records->_sentMask == mask && records->_sentAddr == addr && millis() - records->_sentTime < MDNS_RESPONSE_INTERVAL;
+}
+
+static void _markSent(MDNSRecords* records, uint16_t mask, uint32_t addr) {
+  records->_sentMask = mask;
+  records->_sentAddr = addr;
+  records->_sentTime = millis();
+}
+
+static bool _serializeRecords(MDNSRecords* records, const char* host, const char* instance, MDNSService* service) {
+  MDNSRecordWriter sizer(0);
+  _writeRecords(sizer, records, host, instance, service);
+
+  os_free(records->_data);
+  records->_data = (uint8_t*) os_malloc(sizer.pos());
+  records->_sentMask = 0;
+  if (!records->_data) {
+    memset(records->_offset, 0, sizeof(records->_offset));
+    return false;
+  }
+  MDNSRecordWriter writer(records->_data);
+  _writeRecords(writer, records, host, instance, service);
+  return true;
+}
+
 
 MDNSResponder::MDNSResponder() : _conn(0) { 
   _services = 0;
+  _hostRecords = 0;
+  _recordsValid = false;
   _instanceName = ""; 
   _answers = 0;
   _query = 0;
-  _newQuery = false;
   _waitingForAnswers = false;
 }
 MDNSResponder::~MDNSResponder() {
@@ -133,18 +306,24 @@ MDNSResponder::~MDNSResponder() {
   }
 
   // Clear answer list
-  MDNSAnswer *answer;
-  int numAnswers = _getNumAnswers();
-  for (int n = numAnswers - 1; n >= 0; n--) {
-    answer = _getAnswerFromIdx(n);
+  while (_answers != 0) {
+    MDNSAnswer *answer = _answers;
+    _answers = answer->next;
     os_free(answer->hostname);
     os_free(answer);
-    answer = 0;
   }
-  _answers = 0;
+
+  if (_hostRecords) {
+    os_free(_hostRecords->_data);
+    os_free(_hostRecords);
+  }
+  for (MDNSService* servicePtr = _services; servicePtr; servicePtr = servicePtr->_next) {
+    os_free(servicePtr->_records._data);
+    servicePtr->_records._data = 0;
+  }
 
   if (_conn) {
-    _conn->unref();
+    UdpMulticast::unsubscribe(this);
   }
 }
 
@@ -160,6 +339,7 @@ bool MDNSResponder::begin(const char* hostname){
 
   // If instance name is not already set copy hostname to instance name
   if (_instanceName.equals("") ) _instanceName=hostname;
+  _recordsValid = false;
 
   _gotIPHandler = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP& event){
     (void) event;
@@ -180,7 +360,7 @@ void MDNSResponder::notifyAPChange() {
 
 void MDNSResponder::_restart() {
   if (_conn) {
-    _conn->unref();
+    UdpMulticast::unsubscribe(this);
     _conn = nullptr;
   }
   _listen();
@@ -195,27 +375,28 @@ bool MDNSResponder::_listen() {
     ip_addr_t multicast_addr;
     multicast_addr.addr = (uint32_t) MDNS_MULTICAST_ADDR;
 
-    if (igmp_joingroup(IP_ADDR_ANY, &multicast_addr)!= ERR_OK) {
-      return false;
-    }
-
-    _conn = new UdpContext;
-    _conn->ref();
-
-    if (!_conn->listen(*IP_ADDR_ANY, MDNS_PORT)) {
+    // answers are only of interest while a query is running
+    auto filter = [this](const uint8_t* data, size_t size) {
+      DNSHeaderView header;
+      if (!header.parse(data, size))
+        return false;
+      return header.isResponse() ? _waitingForAnswers : header.qdcount > 0;
+    };
+    _conn = UdpMulticast::subscribe(this, multicast_addr.addr, MDNS_PORT,
+                                    [this](UdpContext&) { _parsePacket(); }, filter);
+    if (!_conn) {
       return false;
     }
     _conn->setMulticastTTL(MDNS_MULTICAST_TTL);
-    _conn->onRx(std::bind(&MDNSResponder::update, this));
     _conn->connect(multicast_addr, MDNS_PORT);
   }
   return true;
 }
 
 void MDNSResponder::update() {
-  if (!_conn || !_conn->next()) 
+  if (!_conn) 
     return;
-  _parsePacket();
+  UdpMulticast::dispatch(MDNS_PORT);
 }
 
 
@@ -223,6 +404,7 @@ void MDNSResponder::setInstanceName(String name){
   if (name.length() > 63) 
     return;
   _instanceName = name;
+  _recordsValid = false;
 }
 
 
@@ -245,6 +427,7 @@ bool MDNSResponder::addServiceTxt(char *name, char *proto, char *key, char *valu
         //Adding First TXT to service
         servicePtr->_txts = newtxt;
         servicePtr->_txtLen += txtLen;
+        _recordsValid = false;
         return true;
       } else {
         MDNSTxt * txtPtr = servicePtr->_txts;
@@ -254,6 +437,7 @@ bool MDNSResponder::addServiceTxt(char *name, char *proto, char *key, char *valu
         //adding another TXT to service
         txtPtr->_next = newtxt;
         servicePtr->_txtLen += txtLen;
+        _recordsValid = false;
         return true;
       }
     }
@@ -273,6 +457,8 @@ void MDNSResponder::addService(char *name, char *proto, uint16_t port){
   srv->_next = 0;
   srv->_txts = 0;
   srv->_txtLen = 0;
+  memset(&srv->_records, 0, sizeof(srv->_records));
+  _recordsValid = false;
   
   if(_services == 0) {
     _services = srv;
@@ -285,20 +471,22 @@ void MDNSResponder::addService(char *name, char *proto, uint16_t port){
   
 }
 
-int MDNSResponder::queryService(char *service, char *proto) {
-#ifdef DEBUG_ESP_MDNS_TX
-  DEBUG_ESP_PORT.printf("queryService %s %s\n", service, proto);
-#endif  
-  
-  if (_query != 0) {
-    os_free(_query);
-    _query = 0;
+void MDNSResponder::_setQuery(const char *service, const char *proto) {
+  if (_query == 0) {
+    _query = (struct MDNSQuery*)(os_malloc(sizeof(struct MDNSQuery)));
+    if (_query == 0)
+      return;
   }
-  _query = (struct MDNSQuery*)(os_malloc(sizeof(struct MDNSQuery)));
-  os_strcpy(_query->_service, service);
-  os_strcpy(_query->_proto, proto);
-  _newQuery = true;
-  
+  os_strncpy(_query->_service, service, sizeof(_query->_service) - 1);
+  _query->_service[sizeof(_query->_service) - 1] = '\0';
+  os_strncpy(_query->_proto, proto, sizeof(_query->_proto) - 1);
+  _query->_proto[sizeof(_query->_proto) - 1] = '\0';
+}
+
+void MDNSResponder::_sendQuery() {
+  char *service = _query->_service;
+  char *proto = _query->_proto;
+
   char underscore[] = "_";
 
   // build service name with _
@@ -323,7 +511,6 @@ int MDNSResponder::queryService(char *service, char *proto) {
   // Only supports sending one PTR query
   uint8_t questionCount = 1;
 
-  _waitingForAnswers = true;
   for (int itfn = 0; itfn < 2; itfn++) {
     struct ip_info ip_info;
     ip_addr_t ifaddr;
@@ -364,6 +551,33 @@ int MDNSResponder::queryService(char *service, char *proto) {
     _conn->append(reinterpret_cast<const char*>(ptrAttrs), 4);
     _conn->send();
   }
+}
+
+int MDNSResponder::queryService(char *service, char *proto) {
+#ifdef DEBUG_ESP_MDNS_TX
+  DEBUG_ESP_PORT.printf("queryService %s %s\n", service, proto);
+#endif  
+
+  if (!_conn)
+    return 0;
+
+  stopBrowse();
+  _expireAnswers();
+  _setQuery(service, proto);
+  if (!_query)
+    return 0;
+
+  // answered from the cache while the instances found last time are fresh
+  int numAnswers = _getNumAnswers();
+  if (numAnswers > 0) {
+#ifdef DEBUG_ESP_MDNS_TX
+    DEBUG_ESP_PORT.printf("%d answers cached\n", numAnswers);
+#endif
+    return numAnswers;
+  }
+
+  _waitingForAnswers = true;
+  _sendQuery();
 
 #ifdef DEBUG_ESP_MDNS_TX
   DEBUG_ESP_PORT.println("Waiting for answers..");
@@ -375,6 +589,141 @@ int MDNSResponder::queryService(char *service, char *proto) {
   return _getNumAnswers();
 }
 
+bool MDNSResponder::browseService(const char *service, const char *proto, THandlerFunction_Browse handler) {
+#ifdef DEBUG_ESP_MDNS_TX
+  DEBUG_ESP_PORT.printf("browseService %s %s\n", service, proto);
+#endif
+
+  if (!_conn || !handler)
+    return false;
+
+  stopBrowse();
+  _expireAnswers();
+  _setQuery(service, proto);
+  if (!_query)
+    return false;
+
+  _browseHandler = handler;
+  _waitingForAnswers = true;
+
+  // instances still cached are reported again without asking the network
+  int numAnswers = _getNumAnswers();
+  for (int n = 0; n < numAnswers; n++) {
+    _reportAnswer(_getAnswerFromIdx(n));
+  }
+  if (numAnswers == 0) {
+    _sendQuery();
+  }
+  return true;
+}
+
+void MDNSResponder::stopBrowse() {
+  _browseHandler = nullptr;
+  _waitingForAnswers = false;
+}
+
+void MDNSResponder::_reportAnswer(MDNSAnswer *answer) {
+  // handlers run from loop(), not from the network stack
+  THandlerFunction_Browse handler = _browseHandler;
+  String hostname = answer->hostname;
+  IPAddress ip(answer->ip);
+  uint16_t port = answer->port;
+  schedule_function([handler, hostname, ip, port]() {
+    handler(hostname.c_str(), ip, port);
+  });
+}
+
+void MDNSResponder::_expireAnswers() {
+  uint32_t now = millis();
+  MDNSAnswer **link = &_answers;
+  while (*link != 0) {
+    MDNSAnswer *answer = *link;
+    if ((int32_t)(answer->expires - now) > 0) {
+      link = &answer->next;
+      continue;
+    }
+    *link = answer->next;
+    os_free(answer->hostname);
+    os_free(answer);
+  }
+}
+
+void MDNSResponder::_cacheAnswer(const char *hostname, const uint8_t *ip, uint16_t port, uint32_t ttl) {
+  MDNSAnswer *answer = 0;
+  MDNSAnswer **link;
+  int cached = 0;
+  for (link = &_answers; *link != 0; link = &(*link)->next) {
+    MDNSAnswer *entry = *link;
+    if (strcmp(entry->hostname, hostname) == 0 && strcmp(entry->service, _query->_service) == 0
+        && strcmp(entry->proto, _query->_proto) == 0) {
+      answer = entry;
+      break;
+    }
+    cached++;
+  }
+
+  if (ttl == 0) { // goodbye, the instance went away
+    if (answer != 0) {
+      *link = answer->next;
+      os_free(answer->hostname);
+      os_free(answer);
+    }
+    return;
+  }
+
+  // Keep the cached TTLs well below the wraparound of millis()
+  if (ttl > 24 * 3600)
+    ttl = 24 * 3600;
+  uint32_t expires = millis() + ttl * 1000;
+
+  if (answer != 0) {
+    bool changed = answer->port != port || memcmp(answer->ip, ip, 4) != 0;
+    answer->port = port;
+    memcpy(answer->ip, ip, 4);
+    answer->expires = expires;
+    if (changed && _browseHandler)
+      _reportAnswer(answer);
+    return;
+  }
+
+  if (cached >= MDNS_ANSWER_CACHE_SIZE) {
+    // make room by dropping the entry closest to expiry
+    _expireAnswers();
+    MDNSAnswer **oldest = 0;
+    for (link = &_answers; *link != 0; link = &(*link)->next) {
+      if (!oldest || (int32_t)((*link)->expires - (*oldest)->expires) < 0)
+        oldest = link;
+    }
+    if (oldest && *oldest) {
+      MDNSAnswer *victim = *oldest;
+      *oldest = victim->next;
+      os_free(victim->hostname);
+      os_free(victim);
+    }
+    for (link = &_answers; *link != 0; link = &(*link)->next);
+  }
+
+  answer = (struct MDNSAnswer*)(os_malloc(sizeof(struct MDNSAnswer)));
+  if (answer == 0)
+    return;
+  answer->hostname = (char *)os_malloc(strlen(hostname) + 1);
+  if (answer->hostname == 0) {
+    os_free(answer);
+    return;
+  }
+  os_strcpy(answer->hostname, hostname);
+  os_strcpy(answer->service, _query->_service);
+  os_strcpy(answer->proto, _query->_proto);
+  answer->port = port;
+  memcpy(answer->ip, ip, 4);
+  answer->expires = expires;
+  answer->next = 0;
+  *link = answer;
+
+  if (_browseHandler)
+    _reportAnswer(answer);
+}
+
 String MDNSResponder::hostname(int idx) {
   MDNSAnswer *answer = _getAnswerFromIdx(idx);
   if (answer == 0) {
@@ -399,46 +748,38 @@ uint16_t MDNSResponder::port(int idx) {
   return answer->port;
 }
 
+// Answers are cached for all services, the indices only count those of
+// the service last queried or browsed for.
+static bool _answerMatches(const MDNSAnswer *answer, const MDNSQuery *query) {
+  return query != 0 && strcmp(answer->service, query->_service) == 0 && strcmp(answer->proto, query->_proto) == 0;
+}
+
 MDNSAnswer* MDNSResponder::_getAnswerFromIdx(int idx) {
-  MDNSAnswer *answer = _answers;
-  while (answer != 0 && idx-- > 0) {
-    answer = answer->next;
-  }
-  if (idx > 0) {
-    return 0;
+  MDNSAnswer *answer;
+  for (answer = _answers; answer != 0; answer = answer->next) {
+    if (_answerMatches(answer, _query) && idx-- == 0) {
+      return answer;
+    }
   }
-  return answer;
+  return 0;
 }
 
 int MDNSResponder::_getNumAnswers() {
   int numAnswers = 0;
   MDNSAnswer *answer = _answers;
   while (answer != 0) {
-    numAnswers++;
+    if (_answerMatches(answer, _query))
+      numAnswers++;
     answer = answer->next;
   }
   return numAnswers;
 }
 
-MDNSTxt * MDNSResponder::_getServiceTxt(char *name, char *proto){
+MDNSService * MDNSResponder::_getService(char *name, char *proto){
   MDNSService* servicePtr;
   for (servicePtr = _services; servicePtr; servicePtr = servicePtr->_next) {
     if(servicePtr->_port > 0 && strcmp(servicePtr->_name, name) == 0 && strcmp(servicePtr->_proto, proto) == 0){
-      if (servicePtr->_txts == 0) 
-        return false;
-      return servicePtr->_txts;
-    }
-  }
-  return 0;
-}
-
-uint16_t MDNSResponder::_getServiceTxtLen(char *name, char *proto){
-  MDNSService* servicePtr;
-  for (servicePtr = _services; servicePtr; servicePtr = servicePtr->_next) {
-    if(servicePtr->_port > 0 && strcmp(servicePtr->_name, name) == 0 && strcmp(servicePtr->_proto, proto) == 0){
-      if (servicePtr->_txts == 0) 
-        return false;
-      return servicePtr->_txtLen;
+      return servicePtr;
     }
   }
   return 0;
@@ -481,7 +822,7 @@ void MDNSResponder::_parsePacket(){
 
   char serviceName[32];
   uint8_t serviceNameLen;
-  uint16_t servicePort = 0;
+  MDNSService* service = 0;
 
   char protoName[32];
   protoName[0] = 0;
@@ -520,25 +861,12 @@ void MDNSResponder::_parsePacket(){
     uint8_t answerIp[4] = { 0,0,0,0 };
     char answerHostName[255];
     bool serviceMatch = false;
-    MDNSAnswer *answer;
     uint8_t partsCollected = 0;
     uint8_t stringsRead = 0;
+    uint32_t minTtl = 0xFFFFFFFF;
 
     answerHostName[0] = '\0';
 
-    // Clear answer list
-    if (_newQuery) {
-      int oldAnswers = _getNumAnswers();
-      for (int n = oldAnswers - 1; n >= 0; n--) {
-        answer = _getAnswerFromIdx(n);
-        os_free(answer->hostname);
-        os_free(answer);
-        answer = 0;
-      }
-      _answers = 0;
-      _newQuery = false;
-    }
-
     while (numAnswers--) {
       // Read name
       stringsRead = 0;
@@ -610,7 +938,10 @@ void MDNSResponder::_parsePacket(){
       uint16_t answerRdlength = _conn_read16(); // Read rdlength
 
       (void) answerClass;
-      (void) answerTtl;
+      if (answerType == MDNS_TYPE_PTR || answerType == MDNS_TYPE_SRV || answerType == MDNS_TYPE_A) {
+        if (answerTtl < minTtl)
+          minTtl = answerTtl;
+      }
 
       if(answerRdlength > 255){
         if(answerType == MDNS_TYPE_TXT && answerRdlength < 1460){
@@ -730,29 +1061,7 @@ void MDNSResponder::_parsePacket(){
 #ifdef DEBUG_ESP_MDNS_RX
         DEBUG_ESP_PORT.println("All answers parsed, adding to _answers list..");
 #endif
-        // Add new answer to answer list
-        if (_answers == 0) {
-          _answers = (struct MDNSAnswer*)(os_malloc(sizeof(struct MDNSAnswer)));
-          answer = _answers;
-        }
-        else {
-          answer = _answers;
-          while (answer->next != 0) {
-            answer = answer->next;
-          }
-          answer->next = (struct MDNSAnswer*)(os_malloc(sizeof(struct MDNSAnswer)));
-          answer = answer->next;
-        }
-        answer->next = 0;
-        answer->hostname = 0;
-
-        // Populate new answer
-        answer->port = answerPort;
-        for (int i = 0; i < 4; i++) {
-          answer->ip[i] = answerIp[i];
-        }
-        answer->hostname = (char *)os_malloc(strlen(answerHostName) + 1);
-        os_strcpy(answer->hostname, answerHostName);
+        _cacheAnswer(answerHostName, answerIp, answerPort, minTtl);
         _conn->flush();
         return;
       }
@@ -858,8 +1167,8 @@ void MDNSResponder::_parsePacket(){
   }
 
   if(serviceNameLen > 0 && protoNameLen > 0){
-    servicePort = _getServicePort(serviceName, protoName);
-    if(servicePort == 0){
+    service = _getService(serviceName, protoName);
+    if(service == 0){
 #ifdef DEBUG_ESP_MDNS_ERR
       DEBUG_ESP_PORT.printf("ERR_NO_SERVICE: %s\n", serviceName);
 #endif
@@ -954,8 +1263,15 @@ void MDNSResponder::_parsePacket(){
     }
   }
 
+  // leave out what the querier already has
+  if(packetHeader[3] > 0 && packetHeader[2] <= 4){
+    uint8_t knownMask = _readKnownAnswers(packetHeader[3], service);
+    questionMask &= ~knownMask;
+    responseMask &= ~knownMask;
+  }
+
   IPAddress interface = _getRequestMulticastInterface();
-  return _replyToInstanceRequest(questionMask, responseMask, serviceName, protoName, servicePort, interface);
+  return _replyToInstanceRequest(questionMask, responseMask, service, interface);
 }
 
 void MDNSResponder::enableArduino(uint16_t port, bool auth){
@@ -967,299 +1283,216 @@ void MDNSResponder::enableArduino(uint16_t port, bool auth){
   addServiceTxt("arduino", "tcp", "auth_upload", (auth) ? "yes":"no");
 }
 
-void MDNSResponder::_replyToTypeEnumRequest(IPAddress multicastInterface) {
-  MDNSService* servicePtr;
-  for (servicePtr = _services; servicePtr; servicePtr = servicePtr->_next) {
-    if(servicePtr->_port > 0){
-      char *service = servicePtr->_name;
-      char *proto = servicePtr->_proto;
-      //uint16_t port = servicePtr->_port;
-
-#ifdef DEBUG_ESP_MDNS_TX
-      DEBUG_ESP_PORT.printf("TX: service:%s, proto:%s\n", service, proto);
-#endif
+bool MDNSResponder::_updateRecords() {
+  if (_recordsValid)
+    return true;
 
-      char sdHostName[] = "_services";
-      size_t sdHostNameLen = 9;
-      char sdServiceName[] = "_dns-sd";
-      size_t sdServiceNameLen = 7;
-      char sdProtoName[] = "_udp";
-      size_t sdProtoNameLen = 4;
+  if (!_hostRecords) {
+    _hostRecords = (struct MDNSRecords*)(os_malloc(sizeof(struct MDNSRecords)));
+    if (!_hostRecords)
+      return false;
+    memset(_hostRecords, 0, sizeof(struct MDNSRecords));
+  }
+  bool ok = _serializeRecords(_hostRecords, _hostName.c_str(), _instanceName.c_str(), 0);
+  for (MDNSService* servicePtr = _services; servicePtr; servicePtr = servicePtr->_next) {
+    ok = _serializeRecords(&servicePtr->_records, _hostName.c_str(), _instanceName.c_str(), servicePtr) && ok;
+  }
+  _recordsValid = ok;
+  return ok;
+}
 
-      char underscore[]  = "_";
+bool MDNSResponder::_readName(char *name, size_t size) {
+  size_t len = 0;
+  size_t resume = 0;
+  int jumps = 0;
+  for (;;) {
+    if (_conn->getSize() == 0)
+      return false;
+    uint8_t labelLen = _conn_read8();
+    if (labelLen == 0)
+      break;
+    if ((labelLen & 0xC0) == 0xC0) { // Compressed pointer
+      uint16_t offset = ((labelLen & ~0xC0) << 8) | _conn_read8();
+      if (++jumps > 8 || !_conn->isValidOffset(offset))
+        return false;
+      if (!resume)
+        resume = _conn->tell();
+      _conn->seek(offset);
+      continue;
+    }
+    if (labelLen > 63 || labelLen > _conn->getSize() || len + labelLen + 2 > size)
+      return false;
+    if (len)
+      name[len++] = '.';
+    _conn_readS(name + len, labelLen);
+    len += labelLen;
+  }
+  name[len] = '\0';
+  if (resume)
+    _conn->seek(resume);
+  return true;
+}
 
-      // build service name with _
-      char serviceName[os_strlen(service) + 2];
-      os_strcpy(serviceName, underscore);
-      os_strcat(serviceName, service);
-      size_t serviceNameLen = os_strlen(serviceName);
+uint8_t MDNSResponder::_readKnownAnswers(int count, MDNSService *service) {
+  String hostName = _hostName + ".local";
+  String serviceName;
+  String instanceName;
+  if (service) {
+    serviceName = String("_") + service->_name + "._" + service->_proto + ".local";
+    instanceName = _instanceName + "." + serviceName;
+  }
 
-      //build proto name with _
-      char protoName[5];
-      os_strcpy(protoName, underscore);
-      os_strcat(protoName, proto);
-      size_t protoNameLen = 4;
+  uint8_t knownMask = 0;
+  char name[128];
+  while (count-- > 0) {
+    if (!_readName(name, sizeof(name)) || _conn->getSize() < 10)
+      break;
+    uint16_t answerType = _conn_read16();
+    (void) _conn_read16(); // class
+    uint32_t answerTtl = _conn_read32();
+    uint16_t answerRdlength = _conn_read16();
+    if (answerRdlength > _conn->getSize())
+      break;
+    size_t next = _conn->tell() + answerRdlength;
+
+    int record = -1;
+    if (answerType == MDNS_TYPE_A && strcasecmp(name, hostName.c_str()) == 0) {
+      record = MDNS_RECORD_A;
+    } else if (service && answerType == MDNS_TYPE_SRV && strcasecmp(name, instanceName.c_str()) == 0) {
+      record = MDNS_RECORD_SRV;
+    } else if (service && answerType == MDNS_TYPE_TXT && strcasecmp(name, instanceName.c_str()) == 0) {
+      record = MDNS_RECORD_TXT;
+    } else if (service && answerType == MDNS_TYPE_PTR && strcasecmp(name, serviceName.c_str()) == 0) {
+      if (_readName(name, sizeof(name)) && strcasecmp(name, instanceName.c_str()) == 0)
+        record = MDNS_RECORD_PTR;
+    }
+    // known answers only count with at least half of their TTL left
+    if (record >= 0 && answerTtl >= MDNS_RECORD_TTL[record] / 2) {
+      knownMask |= 1 << record;
+    }
+    _conn->seek(next);
+  }
+#ifdef DEBUG_ESP_MDNS_RX
+  DEBUG_ESP_PORT.printf("Known answers: %01X\n", knownMask);
+#endif
+  return knownMask;
+}
 
-      //local string
-      char localName[] = "local";
-      size_t localNameLen = 5;
+void MDNSResponder::_replyToTypeEnumRequest(IPAddress multicastInterface) {
+  if (!_updateRecords())
+    return;
 
-      //terminator
-      char terminator[] = "\0";
+  uint32_t addr = multicastInterface;
+  if (_sentRecently(_hostRecords, MDNS_SENT_ENUM, addr)) {
+#ifdef DEBUG_ESP_MDNS_TX
+    DEBUG_ESP_PORT.println("TX: service types sent just now");
+#endif
+    return;
+  }
 
-      //Write the header
-      _conn->flush();
-      uint8_t head[12] = {
-        0x00, 0x00, //ID = 0
-        0x84, 0x00, //Flags = response + authoritative answer
-        0x00, 0x00, //Question count
-        0x00, 0x01, //Answer count
-        0x00, 0x00, //Name server records
-        0x00, 0x00, //Additional records
-      };
-      _conn->append(reinterpret_cast<const char*>(head), 12);
-
-      // Send the Name field (ie. "_services._dns-sd._udp.local")
-      _conn->append(reinterpret_cast<const char*>(&sdHostNameLen), 1);         // length of "_services"
-      _conn->append(reinterpret_cast<const char*>(sdHostName), sdHostNameLen); // "_services"
-      _conn->append(reinterpret_cast<const char*>(&sdServiceNameLen), 1);      // length of "_dns-sd"
-      _conn->append(reinterpret_cast<const char*>(sdServiceName), sdServiceNameLen);// "_dns-sd"
-      _conn->append(reinterpret_cast<const char*>(&sdProtoNameLen), 1);        // length of "_udp"
-      _conn->append(reinterpret_cast<const char*>(sdProtoName), sdProtoNameLen); // "_udp"
-      _conn->append(reinterpret_cast<const char*>(&localNameLen), 1);          // length "local"
-      _conn->append(reinterpret_cast<const char*>(localName), localNameLen);   // "local"
-      _conn->append(reinterpret_cast<const char*>(&terminator), 1);            // terminator
-
-      //Send the type, class, ttl and rdata length
-      uint8_t ptrDataLen = serviceNameLen + protoNameLen + localNameLen + 4;   // 4 is three label sizes and the terminator
-      uint8_t ptrAttrs[10] = {
-        0x00, 0x0c,             //PTR record query
-        0x00, 0x01,             //Class IN
-        0x00, 0x00, 0x11, 0x94, //TTL 4500
-        0x00, ptrDataLen,       //RData length
-      };
-      _conn->append(reinterpret_cast<const char*>(ptrAttrs), 10);
-
-      //Send the RData (ie. "_http._tcp.local")
-      _conn->append(reinterpret_cast<const char*>(&serviceNameLen), 1);        // length of "_http"
-      _conn->append(reinterpret_cast<const char*>(serviceName), serviceNameLen); // "_http"
-      _conn->append(reinterpret_cast<const char*>(&protoNameLen), 1);          // length of "_tcp"
-      _conn->append(reinterpret_cast<const char*>(protoName), protoNameLen);   // "_tcp"
-      _conn->append(reinterpret_cast<const char*>(&localNameLen), 1);          // length "local"
-      _conn->append(reinterpret_cast<const char*>(localName), localNameLen);   // "local"
-      _conn->append(reinterpret_cast<const char*>(&terminator), 1);            // terminator
-
-      ip_addr_t ifaddr;
-      ifaddr.addr = multicastInterface;
-      _conn->setMulticastInterface(ifaddr);
-      _conn->send();
+  // all service types go into one answer
+  uint16_t answerCount = 0;
+  size_t size = 12;
+  MDNSService* servicePtr;
+  for (servicePtr = _services; servicePtr; servicePtr = servicePtr->_next) {
+    if(servicePtr->_port > 0){
+#ifdef DEBUG_ESP_MDNS_TX
+      DEBUG_ESP_PORT.printf("TX: service:%s, proto:%s\n", servicePtr->_name, servicePtr->_proto);
+#endif
+      answerCount++;
+      size += _recordSize(&servicePtr->_records, MDNS_RECORD_ENUM);
     }
   }
+  if (answerCount == 0)
+    return;
+
+  _conn->flush();
+  uint8_t* packet = reinterpret_cast<uint8_t*>(_conn->reserve(size));
+  if (!packet)
+    return;
+  MDNSRecordWriter writer(packet);
+  writer.responseHeader(answerCount, 0);
+  for (servicePtr = _services; servicePtr; servicePtr = servicePtr->_next) {
+    if(servicePtr->_port > 0)
+      _copyRecord(writer, &servicePtr->_records, MDNS_RECORD_ENUM);
+  }
+
+  ip_addr_t ifaddr;
+  ifaddr.addr = addr;
+  _conn->setMulticastInterface(ifaddr);
+  if (_conn->send())
+    _markSent(_hostRecords, MDNS_SENT_ENUM, addr);
 }
 
-void MDNSResponder::_replyToInstanceRequest(uint8_t questionMask, uint8_t responseMask, char * service, char *proto, uint16_t port, IPAddress multicastInterface) {
+void MDNSResponder::_replyToInstanceRequest(uint8_t questionMask, uint8_t responseMask, MDNSService *service, IPAddress multicastInterface) {
   int i;
+  if(service == 0){ // only the host itself was asked for
+    questionMask &= MDNS_ANSWER_A;
+    responseMask &= MDNS_ANSWER_A;
+  }
   if(questionMask == 0) return;
   if(responseMask == 0) return;
 
 #ifdef DEBUG_ESP_MDNS_TX
-    DEBUG_ESP_PORT.printf("TX: qmask:%01X, rmask:%01X, service:%s, proto:%s, port:%u\n", questionMask, responseMask, service, proto, port);
+    DEBUG_ESP_PORT.printf("TX: qmask:%01X, rmask:%01X, service:%s, proto:%s\n", questionMask, responseMask, service ? service->_name : "", service ? service->_proto : "");
 #endif
 
-
-  String instanceName = _instanceName;
-  size_t instanceNameLen = instanceName.length();
-
-  String hostName = _hostName;
-  size_t hostNameLen = hostName.length();
-
-  char underscore[]  = "_";
- 
-  // build service name with _
-  char serviceName[os_strlen(service)+2];
-  os_strcpy(serviceName,underscore);
-  os_strcat(serviceName, service);
-  size_t serviceNameLen = os_strlen(serviceName);
-
-  //build proto name with _
-  char protoName[5];
-  os_strcpy(protoName,underscore);
-  os_strcat(protoName, proto);
-  size_t protoNameLen = 4;
-
-  //local string
-  char localName[] = "local";
-  size_t localNameLen = 5;
-
-  //terminator
-  char terminator[] = "\0";
+  if (!_updateRecords())
+    return;
+  MDNSRecords* records = service ? &service->_records : _hostRecords;
 
   uint8_t answerMask = responseMask & questionMask;
   uint8_t answerCount = 0;
   uint8_t additionalMask = responseMask & ~questionMask;
   uint8_t additionalCount = 0;
+
+  uint32_t addr = multicastInterface;
+  uint16_t sentMask = (answerMask << 4) | additionalMask;
+  if (_sentRecently(records, sentMask, addr)) {
+#ifdef DEBUG_ESP_MDNS_TX
+    DEBUG_ESP_PORT.println("TX: same answers sent just now");
+#endif
+    return;
+  }
+
+  size_t size = 12;
   for(i=0;i<4;i++){
-    if(answerMask & (1 << i)) 
+    const MDNSRecords* from = (i == MDNS_RECORD_A) ? _hostRecords : records;
+    if(answerMask & (1 << i)){
       answerCount++;
-    if(additionalMask & (1 << i)) 
+      size += _recordSize(from, i);
+    }
+    if(additionalMask & (1 << i)){
       additionalCount++;
+      size += _recordSize(from, i);
+    }
   }
 
-
- //Write the header
   _conn->flush();
-  uint8_t head[12] = {
-    0x00, 0x00, //ID = 0
-    0x84, 0x00, //Flags = response + authoritative answer
-    0x00, 0x00, //Question count
-    0x00, answerCount, //Answer count
-    0x00, 0x00, //Name server records
-    0x00, additionalCount, //Additional records
-  };
-  _conn->append(reinterpret_cast<const char*>(head), 12);
+  uint8_t* packet = reinterpret_cast<uint8_t*>(_conn->reserve(size));
+  if (!packet)
+    return;
+  MDNSRecordWriter writer(packet);
+  writer.responseHeader(answerCount, additionalCount);
 
   for(int responseSection = 0; responseSection < 2; ++responseSection) {
-
-    // PTR Response
-    if((responseSection == 0 ? answerMask : additionalMask) & 0x8){
-      // Send the Name field (ie. "_http._tcp.local")
-      _conn->append(reinterpret_cast<const char*>(&serviceNameLen), 1);        // length of "_http"
-      _conn->append(reinterpret_cast<const char*>(serviceName), serviceNameLen); // "_http"
-      _conn->append(reinterpret_cast<const char*>(&protoNameLen), 1);          // length of "_tcp"
-      _conn->append(reinterpret_cast<const char*>(protoName), protoNameLen);   // "_tcp"
-      _conn->append(reinterpret_cast<const char*>(&localNameLen), 1);          // length "local"
-      _conn->append(reinterpret_cast<const char*>(localName), localNameLen);   // "local"
-      _conn->append(reinterpret_cast<const char*>(&terminator), 1);            // terminator
-
-      //Send the type, class, ttl and rdata length
-      uint8_t ptrDataLen = instanceNameLen + serviceNameLen + protoNameLen + localNameLen + 5; // 5 is four label sizes and the terminator
-      uint8_t ptrAttrs[10] = {
-        0x00, 0x0c,             //PTR record query
-        0x00, 0x01,             //Class IN
-        0x00, 0x00, 0x00, 0x78, //TTL 120
-        0x00, ptrDataLen,       //RData length
-      };
-      _conn->append(reinterpret_cast<const char*>(ptrAttrs), 10);
-
-      //Send the RData (ie. "My IOT device._http._tcp.local")
-      _conn->append(reinterpret_cast<const char*>(&instanceNameLen), 1);       // length of "My IOT device"
-      _conn->append(reinterpret_cast<const char*>(instanceName.c_str()), instanceNameLen);// "My IOT device"
-      _conn->append(reinterpret_cast<const char*>(&serviceNameLen), 1);        // length of "_http"
-      _conn->append(reinterpret_cast<const char*>(serviceName), serviceNameLen); // "_http"
-      _conn->append(reinterpret_cast<const char*>(&protoNameLen), 1);          // length of "_tcp"
-      _conn->append(reinterpret_cast<const char*>(protoName), protoNameLen);   // "_tcp"
-      _conn->append(reinterpret_cast<const char*>(&localNameLen), 1);          // length "local"
-      _conn->append(reinterpret_cast<const char*>(localName), localNameLen);   // "local"
-      _conn->append(reinterpret_cast<const char*>(&terminator), 1);            // terminator
-    }
-
-    //TXT Responce
-    if((responseSection == 0 ? answerMask : additionalMask) & 0x4){
-      //Send the name field (ie. "My IOT device._http._tcp.local")
-      _conn->append(reinterpret_cast<const char*>(&instanceNameLen), 1);       // length of "My IOT device"
-      _conn->append(reinterpret_cast<const char*>(instanceName.c_str()), instanceNameLen);// "My IOT device"
-      _conn->append(reinterpret_cast<const char*>(&serviceNameLen), 1);        // length of "_http"
-      _conn->append(reinterpret_cast<const char*>(serviceName), serviceNameLen); // "_http"
-      _conn->append(reinterpret_cast<const char*>(&protoNameLen), 1);          // length of "_tcp"
-      _conn->append(reinterpret_cast<const char*>(protoName), protoNameLen);   // "_tcp"
-      _conn->append(reinterpret_cast<const char*>(&localNameLen), 1);          // length "local"
-      _conn->append(reinterpret_cast<const char*>(localName), localNameLen);   // "local"
-      _conn->append(reinterpret_cast<const char*>(&terminator), 1);            // terminator
-
-      //Send the type, class, ttl and rdata length
-      uint8_t txtDataLen = _getServiceTxtLen(service,proto);
-      uint8_t txtAttrs[10] = {
-        0x00, 0x10,             //TXT record query
-        0x80, 0x01,             //Class IN, with cache flush
-        0x00, 0x00, 0x11, 0x94, //TTL 4500
-        0x00, txtDataLen,       //RData length
-      };
-      _conn->append(reinterpret_cast<const char*>(txtAttrs), 10);
-
-      //Send the RData
-      MDNSTxt * txtPtr = _getServiceTxt(service,proto);
-      while(txtPtr !=0){
-        uint8_t txtLen = txtPtr->_txt.length();
-        _conn->append(reinterpret_cast<const char*>(&txtLen), 1);                  // length of txt
-        _conn->append(reinterpret_cast<const char*>(txtPtr->_txt.c_str()), txtLen);// the txt
-        txtPtr = txtPtr->_next;
-      }
-    }
-
-
-    //SRV Responce
-    if((responseSection == 0 ? answerMask : additionalMask) & 0x2){
-      //Send the name field (ie. "My IOT device._http._tcp.local")
-      _conn->append(reinterpret_cast<const char*>(&instanceNameLen), 1);       // length of "My IOT device"
-      _conn->append(reinterpret_cast<const char*>(instanceName.c_str()), instanceNameLen);// "My IOT device"
-      _conn->append(reinterpret_cast<const char*>(&serviceNameLen), 1);        // length of "_http"
-      _conn->append(reinterpret_cast<const char*>(serviceName), serviceNameLen); // "_http"
-      _conn->append(reinterpret_cast<const char*>(&protoNameLen), 1);          // length of "_tcp"
-      _conn->append(reinterpret_cast<const char*>(protoName), protoNameLen);   // "_tcp"
-      _conn->append(reinterpret_cast<const char*>(&localNameLen), 1);          // length "local"
-      _conn->append(reinterpret_cast<const char*>(localName), localNameLen);   // "local"
-      _conn->append(reinterpret_cast<const char*>(&terminator), 1);            // terminator
-
-      //Send the type, class, ttl, rdata length, priority and weight
-      uint8_t srvDataSize = hostNameLen + localNameLen + 3; // 3 is 2 lable size bytes and the terminator
-      srvDataSize += 6; // Size of Priority, weight and port
-      uint8_t srvAttrs[10] = {
-        0x00, 0x21,             //Type SRV
-        0x80, 0x01,             //Class IN, with cache flush
-        0x00, 0x00, 0x00, 0x78, //TTL 120
-        0x00, srvDataSize,      //RData length
-      };
-      _conn->append(reinterpret_cast<const char*>(srvAttrs), 10);
-
-      //Send the RData Priority weight and port
-      uint8_t srvRData[6] = {
-        0x00, 0x00,             //Priority 0
-        0x00, 0x00,             //Weight 0
-        (uint8_t)((port >> 8) & 0xFF), (uint8_t)(port & 0xFF)
-      };
-      _conn->append(reinterpret_cast<const char*>(srvRData), 6);
-      //Send the RData (ie. "esp8266.local")
-      _conn->append(reinterpret_cast<const char*>(&hostNameLen), 1);           // length of "esp8266"
-      _conn->append(reinterpret_cast<const char*>(hostName.c_str()), hostNameLen);// "esp8266"
-      _conn->append(reinterpret_cast<const char*>(&localNameLen), 1);          // length "local"
-      _conn->append(reinterpret_cast<const char*>(localName), localNameLen);   // "local"
-      _conn->append(reinterpret_cast<const char*>(&terminator), 1);            // terminator
-
-    }
-
-    // A Response
-    if((responseSection == 0 ? answerMask : additionalMask) & 0x1){
-      //Send the RData (ie. "esp8266.local")
-      _conn->append(reinterpret_cast<const char*>(&hostNameLen), 1);           // length of "esp8266"
-      _conn->append(reinterpret_cast<const char*>(hostName.c_str()), hostNameLen);// "esp8266"
-      _conn->append(reinterpret_cast<const char*>(&localNameLen), 1);          // length "local"
-      _conn->append(reinterpret_cast<const char*>(localName), localNameLen);   // "local"
-      _conn->append(reinterpret_cast<const char*>(&terminator), 1);            // terminator
-
-      uint8_t aaaAttrs[10] = {
-        0x00, 0x01,             //TYPE A
-        0x80, 0x01,             //Class IN, with cache flush
-        0x00, 0x00, 0x00, 0x78, //TTL 120
-        0x00, 0x04,             //DATA LEN
-      };
-      _conn->append(reinterpret_cast<const char*>(aaaAttrs), 10);
-
-      // Send RData
-      uint32_t ip = multicastInterface;
-      uint8_t aaaRData[4] = {
-        (uint8_t)(ip & 0xFF),         //IP first octet
-        (uint8_t)((ip >> 8) & 0xFF),  //IP second octet
-        (uint8_t)((ip >> 16) & 0xFF), //IP third octet
-        (uint8_t)((ip >> 24) & 0xFF)  //IP fourth octet
-      };
-      _conn->append(reinterpret_cast<const char*>(aaaRData), 4);
+    uint8_t mask = (responseSection == 0) ? answerMask : additionalMask;
+    // PTR, TXT, SRV, then A
+    for(i = MDNS_RECORD_PTR; i >= MDNS_RECORD_A; --i){
+      if(!(mask & (1 << i)))
+        continue;
+      const MDNSRecords* from = (i == MDNS_RECORD_A) ? _hostRecords : records;
+      _copyRecord(writer, from, i);
+      if(i == MDNS_RECORD_A) // the address of the interface the query came in on
+        memcpy(packet + writer.pos() - 4, &addr, 4);
     }
   }
 
   ip_addr_t ifaddr;
-  ifaddr.addr = multicastInterface;
+  ifaddr.addr = addr;
   _conn->setMulticastInterface(ifaddr);
-  _conn->send();
+  if (_conn->send())
+    _markSent(records, sentMask, addr);
 }
 
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_MDNS)
@@ -56,9 +56,12 @@ class UdpContext;
 struct MDNSService;
 struct MDNSTxt;
 struct MDNSAnswer;
+struct MDNSRecords;
 
 class MDNSResponder {
 public:
+  typedef std::function<void(const char* hostname, IPAddress ip, uint16_t port)> THandlerFunction_Browse;
+
   MDNSResponder();
   ~MDNSResponder();
   bool begin(const char* hostName);
@@ -95,6 +98,14 @@ public:
   int queryService(String service, String proto){
     return queryService(service.c_str(), proto.c_str());
   }
+  // Look for instances of a service without blocking. Each one found is
+  // passed to handler from loop(), until stopBrowse() or the next query.
+  bool browseService(const char *service, const char *proto, THandlerFunction_Browse handler);
+  bool browseService(String service, String proto, THandlerFunction_Browse handler){
+    return browseService(service.c_str(), proto.c_str(), handler);
+  }
+  void stopBrowse();
+
   String hostname(int idx);
   IPAddress IP(int idx);
   uint16_t port(int idx);
@@ -114,23 +125,32 @@ private:
   UdpContext* _conn;
   String _hostName;
   String _instanceName;
+  struct MDNSRecords * _hostRecords;
+  bool _recordsValid;
   struct MDNSAnswer * _answers;
   struct MDNSQuery * _query;
-  bool _newQuery;
   bool _waitingForAnswers;
+  THandlerFunction_Browse _browseHandler;
   WiFiEventHandler _disconnectedHandler;
   WiFiEventHandler _gotIPHandler;
   
 
   uint16_t _getServicePort(char *service, char *proto);
-  MDNSTxt * _getServiceTxt(char *name, char *proto);
-  uint16_t _getServiceTxtLen(char *name, char *proto);
+  MDNSService * _getService(char *name, char *proto);
   IPAddress _getRequestMulticastInterface();
   void _parsePacket();
   void _replyToTypeEnumRequest(IPAddress multicastInterface);
-  void _replyToInstanceRequest(uint8_t questionMask, uint8_t responseMask, char * service, char *proto, uint16_t port, IPAddress multicastInterface);
+  void _replyToInstanceRequest(uint8_t questionMask, uint8_t responseMask, MDNSService *service, IPAddress multicastInterface);
+  bool _updateRecords();
+  bool _readName(char *name, size_t size);
+  uint8_t _readKnownAnswers(int count, MDNSService *service);
   MDNSAnswer* _getAnswerFromIdx(int idx);
   int _getNumAnswers();
+  void _setQuery(const char *service, const char *proto);
+  void _sendQuery();
+  void _cacheAnswer(const char *hostname, const uint8_t *ip, uint16_t port, uint32_t ttl);
+  void _reportAnswer(MDNSAnswer *answer);
+  void _expireAnswers();
   bool _listen();
   void _restart();
 };
@@ -1,4 +1,5 @@
 #include "utility/w5100.h"
+#include "utility/socket.h"
 #include "Ethernet.h"
 #include "Dhcp.h"
 
@@ -26,6 +27,9 @@ int EthernetClass::begin(uint8_t *mac_address)
   W5100.setMACAddress(mac_address);
   W5100.setIPAddress(IPAddress(0,0,0,0).raw_address());
   SPI.endTransaction();
+  // the reset cleared the interrupt mask
+  if (_intPin >= 0)
+    socketInterruptPin(_intPin);
 
   // Now try to get our config info from a DHCP server
   int ret = _dhcp->beginWithDHCP(mac_address);
@@ -78,6 +82,14 @@ void EthernetClass::begin(uint8_t *mac, IPAddress local_ip, IPAddress dns_server
   W5100.setSubnetMask(subnet.raw_address());
   SPI.endTransaction();
   _dnsServerAddress = dns_server;
+  if (_intPin >= 0)
+    socketInterruptPin(_intPin);
+}
+
+void EthernetClass::setInterruptPin(int pin)
+{
+  _intPin = pin;
+  socketInterruptPin(pin);
 }
 
 int EthernetClass::maintain(){
@@ -14,6 +14,7 @@ class EthernetClass {
 private:
   IPAddress _dnsServerAddress;
   DhcpClass* _dhcp;
+  int _intPin = -1;
 public:
   static uint8_t _state[MAX_SOCK_NUM];
   static uint16_t _server_port[MAX_SOCK_NUM];
@@ -26,6 +27,10 @@ public:
   void begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dns_server, IPAddress gateway);
   void begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dns_server, IPAddress gateway, IPAddress subnet);
   int maintain();
+  // The W5100's INT pin is wired to GPIO pin: sockets are only read from
+  // again after the chip signals an event on them, instead of on every
+  // available() or parsePacket(). -1 for none.
+  void setInterruptPin(int pin);
 
   IPAddress localIP();
   IPAddress subnetMask();
@@ -1,8 +1,103 @@
 #include "w5100.h"
 #include "socket.h"
 
+#ifndef ICACHE_RAM_ATTR
+#define ICACHE_RAM_ATTR
+#endif
+
+// longest a status read before is trusted with the INT pin in use, in case
+// the chip changes one without an event
+#ifndef SOCKET_REFRESH_MS
+#define SOCKET_REFRESH_MS 500
+#endif
+
+#define IR_SOCKETS ((1 << MAX_SOCK_NUM) - 1)
+
 static uint16_t local_port;
 
+// With the INT pin, the status and received size of each socket are read
+// once and kept until the chip raises an interrupt for it or a command
+// changes it, so idle sockets cost no SPI traffic. The ISR only notes the
+// interrupt: a transaction may be under way, so the registers are read
+// when a socket is next asked about.
+static int s_intPin = -1;
+static volatile bool s_intPending = false;
+static uint8_t s_cached = 0;          // a bit for each socket with the values below
+static uint8_t s_status[MAX_SOCK_NUM];
+static int16_t s_rxSize[MAX_SOCK_NUM];
+static unsigned long s_readAt[MAX_SOCK_NUM];
+
+static void ICACHE_RAM_ATTR onSocketInterrupt()
+{
+  s_intPending = true;
+}
+
+static inline void forget(SOCKET s)
+{
+  s_cached &= ~(1 << s);
+}
+
+// the states that don't end without an interrupt or a command
+static bool isSettled(uint8_t status)
+{
+  return status == SnSR::CLOSED || status == SnSR::LISTEN || status == SnSR::ESTABLISHED ||
+         status == SnSR::CLOSE_WAIT || status == SnSR::UDP;
+}
+
+// Clears the sockets' interrupts and forgets them; the pin only falls
+// again once all are cleared.
+static void takeEvents()
+{
+  s_intPending = false;
+  SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+  for (uint8_t ir; (ir = W5100.readIR() & IR_SOCKETS) != 0; ) {
+    for (SOCKET s = 0; s < MAX_SOCK_NUM; s++) {
+      if (ir & (1 << s))
+        W5100.writeSnIR(s, W5100.readSnIR(s));
+    }
+    s_cached &= ~ir;
+  }
+  SPI.endTransaction();
+}
+
+// true with s_status[s] and s_rxSize[s] up to date
+static bool readCached(SOCKET s)
+{
+  if (s_intPin < 0)
+    return false;
+  if (s_intPending)
+    takeEvents();
+  if ((s_cached & (1 << s)) && millis() - s_readAt[s] < SOCKET_REFRESH_MS)
+    return true;
+  SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+  s_status[s] = W5100.readSnSR(s);
+  s_rxSize[s] = W5100.getRXReceivedSize(s);
+  SPI.endTransaction();
+  s_readAt[s] = millis();
+  if (isSettled(s_status[s]))
+    s_cached |= 1 << s;
+  else
+    forget(s);
+  return true;
+}
+
+void socketInterruptPin(int pin)
+{
+  if (s_intPin >= 0)
+    detachInterrupt(s_intPin);
+  s_intPin = pin;
+  s_cached = 0;
+  SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+  W5100.writeIMR(pin >= 0 ? IR_SOCKETS : 0);
+  SPI.endTransaction();
+  if (pin < 0)
+    return;
+  pinMode(pin, INPUT_PULLUP);
+  attachInterrupt(pin, onSocketInterrupt, FALLING);
+  // for what was signalled before
+  takeEvents();
+}
+
 /**
  * @brief	This Socket function initialize the channel in perticular mode, and set the port and wait for W5100 done it.
  * @return 	1 for success else 0.
@@ -24,6 +119,7 @@ uint8_t socket(SOCKET s, uint8_t protocol, uint16_t port, uint8_t flag)
 
     W5100.execCmdSn(s, Sock_OPEN);
     SPI.endTransaction();
+    forget(s);
     return 1;
   }
 
@@ -33,6 +129,8 @@ uint8_t socket(SOCKET s, uint8_t protocol, uint16_t port, uint8_t flag)
 
 uint8_t socketStatus(SOCKET s)
 {
+  if (readCached(s))
+    return s_status[s];
   SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
   uint8_t status = W5100.readSnSR(s);
   SPI.endTransaction();
@@ -49,6 +147,7 @@ void close(SOCKET s)
   W5100.execCmdSn(s, Sock_CLOSE);
   W5100.writeSnIR(s, 0xFF);
   SPI.endTransaction();
+  forget(s);
 }
 
 
@@ -65,6 +164,7 @@ uint8_t listen(SOCKET s)
   }
   W5100.execCmdSn(s, Sock_LISTEN);
   SPI.endTransaction();
+  forget(s);
   return 1;
 }
 
@@ -91,6 +191,7 @@ uint8_t connect(SOCKET s, uint8_t * addr, uint16_t port)
   W5100.writeSnDPORT(s, port);
   W5100.execCmdSn(s, Sock_CONNECT);
   SPI.endTransaction();
+  forget(s);
 
   return 1;
 }
@@ -106,6 +207,7 @@ void disconnect(SOCKET s)
   SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
   W5100.execCmdSn(s, Sock_DISCON);
   SPI.endTransaction();
+  forget(s);
 }
 
 
@@ -201,6 +303,7 @@ int16_t recv(SOCKET s, uint8_t *buf, int16_t len)
   {
     W5100.recv_data_processing(s, buf, ret);
     W5100.execCmdSn(s, Sock_RECV);
+    forget(s);
   }
   SPI.endTransaction();
   return ret;
@@ -209,6 +312,8 @@ int16_t recv(SOCKET s, uint8_t *buf, int16_t len)
 
 int16_t recvAvailable(SOCKET s)
 {
+  if (readCached(s))
+    return s_rxSize[s];
   SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
   int16_t ret = W5100.getRXReceivedSize(s);
   SPI.endTransaction();
@@ -355,6 +460,7 @@ uint16_t recvfrom(SOCKET s, uint8_t *buf, uint16_t len, uint8_t *addr, uint16_t
     }
     W5100.execCmdSn(s, Sock_RECV);
     SPI.endTransaction();
+    forget(s);
   }
   return data_len;
 }
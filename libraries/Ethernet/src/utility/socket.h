@@ -16,6 +16,10 @@ extern uint16_t peek(SOCKET s, uint8_t *buf);
 extern uint16_t sendto(SOCKET s, const uint8_t * buf, uint16_t len, uint8_t * addr, uint16_t port); // Send data (UDP/IP RAW)
 extern uint16_t recvfrom(SOCKET s, uint8_t * buf, uint16_t len, uint8_t * addr, uint16_t *port); // Receive data (UDP/IP RAW)
 extern void flush(SOCKET s); // Wait for transmission to complete
+// Use the W5100's INT pin, wired to GPIO pin, for socketStatus() and
+// recvAvailable() to answer from what they read last until the chip
+// signals an event on the socket. -1 goes back to reading every time.
+extern void socketInterruptPin(int pin);
 
 extern uint16_t igmpsend(SOCKET s, const uint8_t * buf, uint16_t len);
 
@@ -134,9 +134,20 @@ void W5100Class::read_data(SOCKET s, volatile uint16_t src, volatile uint8_t *ds
 }
 
 
+#if defined(ESP8266)
+// The W5100 has no burst mode: every byte is a frame of its own, opcode,
+// address and data, with SS raised in between. Each frame goes out as one
+// 32 bit SPI transfer instead of four 8 bit ones.
+#define W5100_FRAME(op, addr, data) (((uint32_t)(op) << 24) | ((uint32_t)(addr) << 8) | (data))
+#endif
+
 uint8_t W5100Class::write(uint16_t _addr, uint8_t _data)
 {
-#if defined(ARDUINO_ARCH_AVR) || defined(ESP8266)
+#if defined(ESP8266)
+  setSS();
+  SPI.write32(W5100_FRAME(0xF0, _addr, _data), true);
+  resetSS();
+#elif defined(ARDUINO_ARCH_AVR)
   setSS();  
   SPI.transfer(0xF0);
   SPI.transfer(_addr >> 8);
@@ -156,7 +167,12 @@ uint16_t W5100Class::write(uint16_t _addr, const uint8_t *_buf, uint16_t _len)
 {
   for (uint16_t i=0; i<_len; i++)
   {
-#if defined(ARDUINO_ARCH_AVR) || defined(ESP8266)
+#if defined(ESP8266)
+    setSS();
+    SPI.write32(W5100_FRAME(0xF0, _addr, _buf[i]), true);
+    _addr++;
+    resetSS();
+#elif defined(ARDUINO_ARCH_AVR)
     setSS();    
     SPI.transfer(0xF0);
     SPI.transfer(_addr >> 8);
@@ -177,7 +193,13 @@ uint16_t W5100Class::write(uint16_t _addr, const uint8_t *_buf, uint16_t _len)
 
 uint8_t W5100Class::read(uint16_t _addr)
 {
-#if defined(ARDUINO_ARCH_AVR) || defined(ESP8266)
+#if defined(ESP8266)
+  uint8_t frame[4] = { 0x0F, (uint8_t)(_addr >> 8), (uint8_t)(_addr & 0xFF), 0 };
+  setSS();
+  SPI.transferBytes(frame, frame, sizeof(frame));
+  resetSS();
+  uint8_t _data = frame[3];
+#elif defined(ARDUINO_ARCH_AVR)
   setSS();  
   SPI.transfer(0x0F);
   SPI.transfer(_addr >> 8);
@@ -197,7 +219,14 @@ uint16_t W5100Class::read(uint16_t _addr, uint8_t *_buf, uint16_t _len)
 {
   for (uint16_t i=0; i<_len; i++)
   {
-#if defined(ARDUINO_ARCH_AVR) || defined(ESP8266)
+#if defined(ESP8266)
+    uint8_t frame[4] = { 0x0F, (uint8_t)(_addr >> 8), (uint8_t)(_addr & 0xFF), 0 };
+    setSS();
+    SPI.transferBytes(frame, frame, sizeof(frame));
+    resetSS();
+    _addr++;
+    _buf[i] = frame[3];
+#elif defined(ARDUINO_ARCH_AVR)
     setSS();
     SPI.transfer(0x0F);
     SPI.transfer(_addr >> 8);
@@ -1,6 +1,62 @@
-#ifndef GDBSTUB_H
-#define GDBSTUB_H
+#ifndef GDBSTUB_LIB_H
+#define GDBSTUB_LIB_H
 
-// this header is intentionally left blank
+// Including this header links the stub into the sketch, which is all it
+// takes to debug with GDB. The functions below add non-stopping
+// debugging, for when halting would upset the timing of Wi-Fi: a
+// tracepoint or a data watchpoint records its hits in a ring and lets the
+// program go on. They take the one hardware breakpoint and the one
+// hardware watchpoint, which GDB can't use meanwhile.
 
-#endif //GDBSTUB_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// words of memory recorded with each hit
+#define GDBSTUB_TRACE_WORDS 4
+
+#define GDBSTUB_TRACE_BREAK 1
+#define GDBSTUB_TRACE_WATCH 2
+
+#define GDBSTUB_WATCH_READ   1
+#define GDBSTUB_WATCH_WRITE  2
+#define GDBSTUB_WATCH_ACCESS 3
+
+typedef struct {
+    uint32_t ccount;   // CPU cycle counter at the hit
+    uint32_t pc;       // of the instruction hit, or that made the access
+    uint32_t addr;     // tracepoint or watched address
+    uint32_t a[6];     // a0 (return address), a1 (stack pointer), a2 to a5
+    uint32_t mem[GDBSTUB_TRACE_WORDS];  // at the tracepoint's address, or watched, before the access
+    uint32_t after;    // watchpoint: first watched word after the access
+    uint8_t kind;      // GDBSTUB_TRACE_*
+} gdbstub_trace_t;
+
+// Record a hit whenever the instruction at pc is about to run, with the
+// registers and the first words (up to GDBSTUB_TRACE_WORDS) at mem.
+// mem may be NULL. Only RAM is read.
+bool gdbstub_set_tracepoint(const void* pc, const void* mem, size_t words);
+void gdbstub_del_tracepoint(void);
+
+// Record a hit whenever len bytes at addr (a power of 2 up to 64, and
+// aligned to it) are read, written or both (GDBSTUB_WATCH_*).
+bool gdbstub_set_trace_watchpoint(const void* addr, size_t len, int access);
+void gdbstub_del_trace_watchpoint(void);
+
+// Copy up to count of the last hits, oldest first, into entries and return
+// how many there were.
+size_t gdbstub_trace_read(gdbstub_trace_t* entries, size_t count);
+// Hits since the start or the last gdbstub_trace_reset(), including the
+// ones overwritten.
+uint32_t gdbstub_trace_count(void);
+void gdbstub_trace_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //GDBSTUB_LIB_H
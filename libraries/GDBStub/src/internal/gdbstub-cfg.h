@@ -46,6 +46,14 @@ breaking in the init routine; use the gdb 'c' command (continue) to start the pr
 #define GDBSTUB_BREAK_ON_INIT 0
 #endif
 
+/*
+Number of hits the tracepoint and the data watchpoint of GDBStub.h keep, the last ones. Each takes
+60 bytes of RAM. Set it to 0 to leave non-stopping debugging out.
+*/
+#ifndef GDBSTUB_TRACE_ENTRIES
+#define GDBSTUB_TRACE_ENTRIES 16
+#endif
+
 /*
 Function attributes for function types.
 Gdbstub functions are placed in flash or IRAM using attributes, as defined here. The gdbinit function
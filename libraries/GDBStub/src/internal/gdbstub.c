@@ -18,6 +18,8 @@
 #include "gdbstub.h"
 #include "gdbstub-entry.h"
 #include "gdbstub-cfg.h"
+#include "../GDBStub.h"
+#include "xtensa/config/specreg.h"
 
 
 //From xtruntime-frames.h
@@ -284,6 +286,18 @@ struct regfile {
 };
 
 
+//DBREAKC mask for a watchpoint of len bytes, -1 if len can't be watched.
+static int ATTR_GDBFN watchMask(int len) {
+	if (len==1) return 0x3F;
+	if (len==2) return 0x3E;
+	if (len==4) return 0x3C;
+	if (len==8) return 0x38;
+	if (len==16) return 0x30;
+	if (len==32) return 0x20;
+	if (len==64) return 0x00;
+	return -1;
+}
+
 //Send the reason execution is stopped to GDB.
 static void ATTR_GDBFN sendReason() {
 #if 0
@@ -425,14 +439,8 @@ static int ATTR_GDBFN gdbHandleCommand(unsigned char *cmd, int len) {
 			if (cmd[1]=='2') access=2; //write
 			if (cmd[1]=='3') access=1; //read
 			if (cmd[1]=='4') access=3; //access
-			if (j==1) mask=0x3F;
-			if (j==2) mask=0x3E;
-			if (j==4) mask=0x3C;
-			if (j==8) mask=0x38;
-			if (j==16) mask=0x30;
-			if (j==32) mask=0x20;
-			if (j==64) mask=0x00;
-			if (mask!=0 && gdbstub_set_hw_watchpoint(i,mask, access)) {
+			mask=watchMask(j);
+			if (mask>=0 && gdbstub_set_hw_watchpoint(i,mask, access)) {
 				gdbPacketStr("OK");
 			} else {
 				gdbPacketStr("E01");
@@ -564,9 +572,168 @@ static void ATTR_GDBFN emulLdSt() {
 	}
 }
 
+#if GDBSTUB_TRACE_ENTRIES
+/*
+Non-stopping tracepoint and watchpoint. A hit is recorded and, instead of waiting for GDB, the
+instruction is single-stepped with the break or watchpoint off (as it would trigger again
+otherwise) and then the break or watchpoint is set again, all from the debug exception: two
+exceptions of a few microseconds each, the watchdog and Wi-Fi don't notice.
+*/
+#define XSTR(x) #x
+#define STR(x) XSTR(x)
+#define RSR(reg, v) asm volatile("rsr %0, " STR(reg) : "=a"(v))
+#define WSR(reg, v) asm volatile("wsr %0, " STR(reg) "\nisync\n" :: "a"(v))
+
+#define DEBUGCAUSE_ICOUNT (1<<0)
+#define DEBUGCAUSE_IBREAK (1<<1)
+#define DEBUGCAUSE_DBREAK (1<<2)
+
+static gdbstub_trace_t traceRing[GDBSTUB_TRACE_ENTRIES];
+static uint32_t traceCount=0;
+static int traceNext=0;					//Entry the next hit goes to
+static const uint32_t *traceMem=NULL;	//What the tracepoint records
+static int traceWords=0;
+static int traceBreak=0;				//Tracepoint set
+static uint32_t traceDbreakc=0;			//DBREAKC of the watchpoint, 0 if none
+static int traceRearm=0;				//GDBSTUB_TRACE_* being stepped over
+static int32_t traceStepPs;
+static gdbstub_trace_t *traceLast;		//Entry of the hit being stepped over
+
+//A word of RAM, 0 for anything else (flash may not be readable in the debug exception)
+static uint32_t ATTR_GDBFN readRamWord(uint32_t p) {
+	if ((p>=0x3ff00000 && p<0x40000000) || (p>=0x40100000 && p<0x40110000)) return *(uint32_t*)(p&~3);
+	return 0;
+}
+
+static gdbstub_trace_t* ATTR_GDBFN traceRecord(int kind, uint32_t addr, uint32_t mem, int words) {
+	gdbstub_trace_t *e=&traceRing[traceNext];
+	int i;
+	if (++traceNext==GDBSTUB_TRACE_ENTRIES) traceNext=0;
+	RSR(CCOUNT, e->ccount);
+	e->pc=gdbstub_savedRegs.pc;
+	e->addr=addr;
+	e->a[0]=gdbstub_savedRegs.a0;
+	e->a[1]=gdbstub_savedRegs.a1;
+	for (i=2; i<6; i++) e->a[i]=gdbstub_savedRegs.a[i-2];
+	for (i=0; i<GDBSTUB_TRACE_WORDS; i++) e->mem[i]=(i<words)?readRamWord(mem+i*4):0;
+	e->after=0;
+	e->kind=kind;
+	traceCount++;
+	return e;
+}
+
+//Run the instruction at pc with the break or watchpoint off, see traceDebugException
+static void ATTR_GDBFN traceStepOver(int kind) {
+	traceRearm=kind;
+	traceStepPs=gdbstub_savedRegs.ps;
+	gdbstub_savedRegs.ps=(gdbstub_savedRegs.ps & ~0xf)|(XCHAL_DEBUGLEVEL-1);
+	gdbstub_icount_ena_single_step();
+}
+
+//Returns 1 if the debug exception was a trace hit, handled without stopping.
+static int ATTR_GDBFN traceDebugException() {
+	uint32_t cause=gdbstub_savedRegs.reason;
+	uint32_t v;
+	if (traceRearm && (cause&DEBUGCAUSE_ICOUNT)) {
+		//Stepped over the instruction hit: back on
+		v=0;
+		WSR(ICOUNTLEVEL, v);
+		if (traceRearm==GDBSTUB_TRACE_BREAK) {
+			v=traceBreak;
+			WSR(IBREAKENABLE, v);
+		} else {
+			traceLast->after=readRamWord(traceLast->addr);
+			WSR(DBREAKC, traceDbreakc);
+		}
+		gdbstub_savedRegs.ps=(gdbstub_savedRegs.ps&~0xf)|(traceStepPs&0xf);
+		traceRearm=0;
+		return 1;
+	}
+	if ((cause&DEBUGCAUSE_IBREAK) && traceBreak) {
+		RSR(IBREAKA, v);
+		traceLast=traceRecord(GDBSTUB_TRACE_BREAK, v, (uint32_t)traceMem, traceWords);
+		v=0;
+		WSR(IBREAKENABLE, v);
+		traceStepOver(GDBSTUB_TRACE_BREAK);
+		return 1;
+	}
+	if ((cause&DEBUGCAUSE_DBREAK) && traceDbreakc) {
+		RSR(DBREAKA, v);
+		traceLast=traceRecord(GDBSTUB_TRACE_WATCH, v, v, ((~traceDbreakc&0x3f)+4)/4);
+		v=0;
+		WSR(DBREAKC, v);
+		traceStepOver(GDBSTUB_TRACE_WATCH);
+		return 1;
+	}
+	return 0;
+}
+
+bool ATTR_GDBINIT gdbstub_set_tracepoint(const void* pc, const void* mem, size_t words) {
+	if (traceBreak || !gdbstub_set_hw_breakpoint((int)pc, 1)) return false;
+	traceMem=(const uint32_t*)mem;
+	traceWords=mem?((words<GDBSTUB_TRACE_WORDS)?words:GDBSTUB_TRACE_WORDS):0;
+	traceBreak=1;
+	return true;
+}
+
+void ATTR_GDBINIT gdbstub_del_tracepoint() {
+	uint32_t v;
+	if (!traceBreak) return;
+	RSR(IBREAKA, v);
+	traceBreak=0;
+	gdbstub_del_hw_breakpoint(v);
+}
+
+bool ATTR_GDBINIT gdbstub_set_trace_watchpoint(const void* addr, size_t len, int access) {
+	int mask=watchMask(len);
+	int dbreakc;
+	if (traceDbreakc || mask<0 || access<GDBSTUB_WATCH_READ || access>GDBSTUB_WATCH_ACCESS) return false;
+	dbreakc=gdbstub_set_hw_watchpoint((int)addr, mask, access);
+	if (!dbreakc) return false;
+	traceDbreakc=dbreakc;
+	return true;
+}
+
+void ATTR_GDBINIT gdbstub_del_trace_watchpoint() {
+	uint32_t v;
+	if (!traceDbreakc) return;
+	RSR(DBREAKA, v);
+	traceDbreakc=0;
+	gdbstub_del_hw_watchpoint(v);
+}
+
+size_t ATTR_GDBINIT gdbstub_trace_read(gdbstub_trace_t* entries, size_t count) {
+	uint32_t ps, total, i;
+	size_t n;
+	//Debug exceptions wait too at this level
+	asm volatile("rsil %0, 15" : "=a"(ps));
+	total=traceCount;
+	n=(total<GDBSTUB_TRACE_ENTRIES)?total:GDBSTUB_TRACE_ENTRIES;
+	if (n>count) n=count;
+	for (i=0; i<n; i++) entries[i]=traceRing[(traceNext+GDBSTUB_TRACE_ENTRIES-n+i)%GDBSTUB_TRACE_ENTRIES];
+	asm volatile("wsr %0, ps\nrsync\n" :: "a"(ps));
+	return n;
+}
+
+uint32_t ATTR_GDBINIT gdbstub_trace_count() {
+	return traceCount;
+}
+
+void ATTR_GDBINIT gdbstub_trace_reset() {
+	uint32_t ps;
+	asm volatile("rsil %0, 15" : "=a"(ps));
+	traceCount=0;
+	traceNext=0;
+	asm volatile("wsr %0, ps\nrsync\n" :: "a"(ps));
+}
+#endif
+
 //We just caught a debug exception and need to handle it. This is called from an assembly
 //routine in gdbstub-entry.S
 void ATTR_GDBFN gdbstub_handle_debug_exception() {
+#if GDBSTUB_TRACE_ENTRIES
+	if (traceDebugException()) return;
+#endif
 	ets_wdt_disable();
 
 	if (singleStepPs!=-1) {
@@ -27,6 +27,25 @@ void loop() {
   }
   Serial.println();
 
+  // usage in pieces, e.g. from a File or a WiFiClient with addStream()
+  // SHA1:a94a8fe5ccb19ba61c4c0873d391e987982fbbd3
+  SHA1Builder builder;
+  builder.begin();
+  builder.add("a");
+  builder.add("bc");
+  builder.calculate();
+  Serial.print("SHA1:");
+  Serial.println(builder.toString());
+
+  // keyed with HMAC, HMACSHA256Builder works the same
+  // HMAC-SHA1:effcdf6ae5eb2fa2d27416d5f184df9c259a7c79
+  HMACSHA1Builder hmac;
+  hmac.begin("Jefe");
+  hmac.add("what do ya want for nothing?");
+  hmac.calculate();
+  Serial.print("HMAC-SHA1:");
+  Serial.println(hmac.toString());
+
   delay(1000);
 }
 
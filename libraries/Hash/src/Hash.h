@@ -27,6 +27,12 @@
 
 //#define DEBUG_SHA1
 
+#include <SHA256Builder.h>
+#include <HMACBuilder.h>
+#include "SHA1Builder.h"
+
+typedef HMACBuilder<SHA1Builder, 20> HMACSHA1Builder;
+
 void sha1(uint8_t * data, uint32_t size, uint8_t hash[20]);
 void sha1(char * data, uint32_t size, uint8_t hash[20]);
 void sha1(const uint8_t * data, uint32_t size, uint8_t hash[20]);
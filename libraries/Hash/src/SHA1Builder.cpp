@@ -0,0 +1,89 @@
+/**
+ * @file SHA1Builder.cpp
+ *
+ * SHA-1 in pieces, like MD5Builder
+ *
+ * This file is part of the esp8266 core for Arduino environment.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <Arduino.h>
+
+#include "SHA1Builder.h"
+
+void SHA1Builder::begin(void) {
+    SHA1Init(&_ctx);
+    memset(_buf, 0x00, sizeof(_buf));
+}
+
+void SHA1Builder::add(const uint8_t * data, size_t len) {
+    SHA1Update(&_ctx, (uint8_t *) data, len);
+}
+
+bool SHA1Builder::addStream(Stream & stream, const size_t maxLen) {
+    // whole blocks, so that SHA1Update() hashes them straight from buf
+    const size_t bufSize = 1024;
+    size_t left = maxLen;
+    uint8_t * buf = (uint8_t *) malloc(bufSize);
+    if(!buf) {
+        return false;
+    }
+    bool ok = true;
+    while(left > 0) {
+        int available = stream.available();
+        if(available <= 0) {
+            break;
+        }
+        size_t len = (size_t) available;
+        if(len > left) {
+            len = left;
+        }
+        if(len > bufSize) {
+            len = bufSize;
+        }
+        size_t got = stream.readBytes(buf, len);
+        if(got == 0) {
+            ok = false;
+            break;
+        }
+        add(buf, got);
+        left -= got;
+        yield();      // time for network streams
+    }
+    free(buf);
+    return ok;
+}
+
+void SHA1Builder::calculate(void) {
+    SHA1Final(_buf, &_ctx);
+}
+
+void SHA1Builder::getBytes(uint8_t * output) {
+    memcpy(output, _buf, 20);
+}
+
+void SHA1Builder::getChars(char * output) {
+    for(uint8_t i = 0; i < 20; i++) {
+        sprintf(output + (i * 2), "%02x", _buf[i]);
+    }
+}
+
+String SHA1Builder::toString(void) {
+    char out[41];
+    getChars(out);
+    return String(out);
+}
@@ -0,0 +1,51 @@
+/**
+ * @file SHA1Builder.h
+ *
+ * SHA-1 in pieces, like MD5Builder
+ *
+ * This file is part of the esp8266 core for Arduino environment.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef SHA1BUILDER_H_
+#define SHA1BUILDER_H_
+
+#include <WString.h>
+#include <Stream.h>
+
+extern "C" {
+#include "sha1/sha1.h"
+}
+
+class SHA1Builder {
+  private:
+    SHA1_CTX _ctx;
+    uint8_t _buf[20];
+  public:
+    void begin(void);
+    void add(const uint8_t * data, size_t len);
+    void add(const char * data){ add((const uint8_t*)data, strlen(data)); }
+    void add(const String& data){ add((const uint8_t*)data.c_str(), data.length()); }
+    // reads up to maxLen bytes while the stream has them
+    bool addStream(Stream & stream, const size_t maxLen);
+    void calculate(void);
+    void getBytes(uint8_t * output);
+    void getChars(char * output);
+    String toString(void);
+};
+
+#endif /* SHA1BUILDER_H_ */
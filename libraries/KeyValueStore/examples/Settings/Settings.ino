@@ -0,0 +1,42 @@
+/*
+   Settings
+
+   Keeps a few settings and a boot counter in flash with KeyValueStore.
+   Reading them back at start is a lookup in RAM and one flash read
+   each, with nothing to parse.
+
+   It uses the last three sectors of the SPIFFS area, so this sketch
+   must not use SPIFFS, or has to be built with a flash layout that
+   leaves SPIFFS room for them.
+*/
+
+#include <KeyValueStore.h>
+
+extern "C" uint32_t _SPIFFS_end;
+
+#define STORE_SECTORS 3
+
+KeyValueStore settings(((uint32_t)&_SPIFFS_end - 0x40200000) / SPI_FLASH_SEC_SIZE - STORE_SECTORS, STORE_SECTORS);
+
+void setup() {
+  Serial.begin(115200);
+  if (!settings.begin()) {
+    Serial.println("\nno memory for the settings");
+    return;
+  }
+
+  if (!settings.isKey("name")) {
+    settings.putString("name", "esp8266");
+    settings.putUInt("interval", 1000);
+  }
+  uint32_t boots = settings.getUInt("boots") + 1;
+  settings.putUInt("boots", boots);
+
+  Serial.printf("\n%s started %u times, %u settings, %u bytes free\n",
+                settings.getString("name").c_str(), boots, settings.count(), settings.freeBytes());
+}
+
+void loop() {
+  // compacts a little at a time, so a put doesn't have to
+  settings.handle();
+}
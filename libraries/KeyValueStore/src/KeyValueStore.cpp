@@ -0,0 +1,764 @@
+/*
+  KeyValueStore.cpp - settings kept in flash by name, with an index in RAM
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "KeyValueStore.h"
+
+/*
+  A sector starts with the magic number and a sequence number, higher
+  than that of any sector before it. Then records, each
+
+    u8 type, u8 key length, u16 value length
+    u32 CRC-32 of the word before, the key and the value
+    the key and then the value, each padded to 4 with 0xff
+
+  up to an unwritten (0xffffffff) word. A removed key gets a record with
+  no value. The sectors are read in the order of their sequence numbers
+  and the last record of a key is the one that counts.
+*/
+#define KVS_MAGIC             0x3153564b
+#define KVS_HEADER_SIZE       8
+#define KVS_TYPE_DELETED      0x7f
+#define KVS_INITIAL_CAPACITY  16
+
+#define PAD4(x)               (((x) + 3) & ~3)
+
+static uint32_t kvsHash(const char* key, size_t length) {
+  uint32_t hash = 2166136261u;
+  while (length--) {
+    hash = (hash ^ (uint8_t) *key++) * 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t kvsCrc(uint32_t crc, const void* data, size_t size) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+  };
+  const uint8_t* p = (const uint8_t*) data;
+  crc = ~crc;
+  while (size--) {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ table[crc & 0xf];
+    crc = (crc >> 4) ^ table[crc & 0xf];
+  }
+  return ~crc;
+}
+
+static uint8_t recordType(uint32_t word) { return word & 0xff; }
+static size_t recordKeyLength(uint32_t word) { return (word >> 8) & 0xff; }
+static size_t recordValueLength(uint32_t word) { return word >> 16; }
+static size_t recordSize(uint32_t word) {
+  return KVS_HEADER_SIZE + PAD4(recordKeyLength(word)) + PAD4(recordValueLength(word));
+}
+
+KeyValueStore::KeyValueStore(uint32_t sector, size_t sectors)
+: _sector(sector)
+, _sectors(sectors)
+, _sequences(0)
+, _erased(0)
+, _head(sectors)
+, _writePos(KVS_SECTOR_SIZE)
+, _lastSequence(0)
+, _compacting(sectors)
+, _compactPos(0)
+, _slots(0)
+, _capacity(0)
+, _count(0)
+{
+}
+
+KeyValueStore::~KeyValueStore() {
+  end();
+}
+
+bool KeyValueStore::begin() {
+  end();
+  if (_sectors < 2)
+    return false;
+
+  _sequences = new uint32_t[_sectors];
+  _erased = new bool[_sectors];
+  _capacity = KVS_INITIAL_CAPACITY;
+  _slots = new Slot[_capacity];
+  if (!_sequences || !_erased || !_slots) {
+    end();
+    return false;
+  }
+  memset(_slots, 0, _capacity * sizeof(Slot));
+
+  for (size_t i = 0; i < _sectors; ++i) {
+    uint32_t header[2];
+    _sequences[i] = 0;
+    _erased[i] = false;
+    if (_flashRead(i * KVS_SECTOR_SIZE, header, sizeof(header)) && header[0] == KVS_MAGIC && header[1] != 0 && header[1] != 0xffffffff) {
+      _sequences[i] = header[1];
+      if (header[1] > _lastSequence)
+        _lastSequence = header[1];
+    }
+  }
+
+  // oldest first, so what comes later replaces it
+  uint32_t above = 0;
+  while (true) {
+    size_t next = _sectors;
+    for (size_t i = 0; i < _sectors; ++i) {
+      if (_sequences[i] > above && (next == _sectors || _sequences[i] < _sequences[next]))
+        next = i;
+    }
+    if (next == _sectors)
+      break;
+    if (!_scan(next)) {
+      end();
+      return false;
+    }
+    _head = next;
+    above = _sequences[next];
+  }
+  return true;
+}
+
+void KeyValueStore::end() {
+  delete[] _sequences;
+  delete[] _erased;
+  delete[] _slots;
+  _sequences = 0;
+  _erased = 0;
+  _slots = 0;
+  _capacity = 0;
+  _count = 0;
+  _head = _sectors;
+  _writePos = KVS_SECTOR_SIZE;
+  _lastSequence = 0;
+  _compacting = _sectors;
+}
+
+void KeyValueStore::handle() {
+  if (!_sequences)
+    return;
+  if (_compacting < _sectors) {
+    _compactStep();
+    return;
+  }
+  size_t free = 0;
+  size_t used = 0;
+  for (size_t i = 0; i < _sectors; ++i) {
+    if (_sequences[i]) {
+      ++used;
+    } else if (!_erased[i]) {
+      // one sector a call, so put() doesn't have to
+      if (_isBlank(i) || _flashErase(i))
+        _erased[i] = true;
+      return;
+    } else {
+      ++free;
+    }
+  }
+  // only the one kept for compacting is left: make another before the
+  // sector written to is full, but not out of that sector itself
+  if (free < 2 && used > 1)
+    _compactStep();
+}
+
+bool KeyValueStore::putBool(const char* key, bool value) {
+  uint8_t v = value;
+  return _put(key, KVS_TYPE_BOOL, &v, sizeof(v));
+}
+
+bool KeyValueStore::putInt(const char* key, int32_t value) {
+  return _put(key, KVS_TYPE_INT, &value, sizeof(value));
+}
+
+bool KeyValueStore::putUInt(const char* key, uint32_t value) {
+  return _put(key, KVS_TYPE_UINT, &value, sizeof(value));
+}
+
+bool KeyValueStore::putInt64(const char* key, int64_t value) {
+  return _put(key, KVS_TYPE_INT64, &value, sizeof(value));
+}
+
+bool KeyValueStore::putUInt64(const char* key, uint64_t value) {
+  return _put(key, KVS_TYPE_UINT64, &value, sizeof(value));
+}
+
+bool KeyValueStore::putFloat(const char* key, float value) {
+  return _put(key, KVS_TYPE_FLOAT, &value, sizeof(value));
+}
+
+bool KeyValueStore::putDouble(const char* key, double value) {
+  return _put(key, KVS_TYPE_DOUBLE, &value, sizeof(value));
+}
+
+bool KeyValueStore::putString(const char* key, const char* value) {
+  return _put(key, KVS_TYPE_STRING, value, strlen(value));
+}
+
+bool KeyValueStore::putString(const char* key, const String& value) {
+  return _put(key, KVS_TYPE_STRING, value.c_str(), value.length());
+}
+
+bool KeyValueStore::putBytes(const char* key, const void* value, size_t size) {
+  return _put(key, KVS_TYPE_BYTES, value, size);
+}
+
+bool KeyValueStore::getBool(const char* key, bool defaultValue) {
+  uint8_t v;
+  return _get(key, KVS_TYPE_BOOL, &v, sizeof(v)) ? v != 0 : defaultValue;
+}
+
+int32_t KeyValueStore::getInt(const char* key, int32_t defaultValue) {
+  int32_t v;
+  return _get(key, KVS_TYPE_INT, &v, sizeof(v)) ? v : defaultValue;
+}
+
+uint32_t KeyValueStore::getUInt(const char* key, uint32_t defaultValue) {
+  uint32_t v;
+  return _get(key, KVS_TYPE_UINT, &v, sizeof(v)) ? v : defaultValue;
+}
+
+int64_t KeyValueStore::getInt64(const char* key, int64_t defaultValue) {
+  int64_t v;
+  return _get(key, KVS_TYPE_INT64, &v, sizeof(v)) ? v : defaultValue;
+}
+
+uint64_t KeyValueStore::getUInt64(const char* key, uint64_t defaultValue) {
+  uint64_t v;
+  return _get(key, KVS_TYPE_UINT64, &v, sizeof(v)) ? v : defaultValue;
+}
+
+float KeyValueStore::getFloat(const char* key, float defaultValue) {
+  float v;
+  return _get(key, KVS_TYPE_FLOAT, &v, sizeof(v)) ? v : defaultValue;
+}
+
+double KeyValueStore::getDouble(const char* key, double defaultValue) {
+  double v;
+  return _get(key, KVS_TYPE_DOUBLE, &v, sizeof(v)) ? v : defaultValue;
+}
+
+String KeyValueStore::getString(const char* key, const String& defaultValue) {
+  uint32_t header[2];
+  uint32_t address = _lookup(key, header);
+  if (!address || recordType(header[0]) != KVS_TYPE_STRING)
+    return defaultValue;
+
+  String value;
+  size_t length = recordValueLength(header[0]);
+  uint32_t valueAddress = address + KVS_HEADER_SIZE + PAD4(recordKeyLength(header[0]));
+  if (!value.reserve(length))
+    return defaultValue;
+  uint32_t buf[16 + 1];
+  for (size_t done = 0; done < length; done += 64) {
+    size_t piece = (length - done < 64) ? length - done : 64;
+    if (!_flashRead(valueAddress + done, buf, PAD4(piece)))
+      return defaultValue;
+    ((char*) buf)[piece] = 0;
+    value.concat((const char*) buf);
+  }
+  return value;
+}
+
+size_t KeyValueStore::getBytes(const char* key, void* buffer, size_t size) {
+  uint32_t header[2];
+  uint32_t address = _lookup(key, header);
+  if (!address || recordType(header[0]) != KVS_TYPE_BYTES)
+    return 0;
+  size_t length = recordValueLength(header[0]);
+  if (!_readValue(address, header[0], buffer, (size < length) ? size : length))
+    return 0;
+  return length;
+}
+
+size_t KeyValueStore::getBytesLength(const char* key) {
+  uint32_t header[2];
+  uint32_t address = _lookup(key, header);
+  if (!address || recordType(header[0]) != KVS_TYPE_BYTES)
+    return 0;
+  return recordValueLength(header[0]);
+}
+
+KeyValueType KeyValueStore::getType(const char* key) {
+  uint32_t header[2];
+  if (!_lookup(key, header))
+    return KVS_TYPE_NONE;
+  return (KeyValueType) recordType(header[0]);
+}
+
+bool KeyValueStore::isKey(const char* key) {
+  uint32_t header[2];
+  return _lookup(key, header) != 0;
+}
+
+bool KeyValueStore::remove(const char* key) {
+  if (!isKey(key))
+    return false;
+  return _put(key, KVS_TYPE_DELETED, 0, 0);
+}
+
+bool KeyValueStore::clear() {
+  if (!_sequences)
+    return false;
+  bool ok = true;
+  for (size_t i = 0; i < _sectors; ++i) {
+    if (_flashErase(i)) {
+      _sequences[i] = 0;
+      _erased[i] = true;
+    } else {
+      ok = false;
+    }
+  }
+  memset(_slots, 0, _capacity * sizeof(Slot));
+  _count = 0;
+  _head = _sectors;
+  _writePos = KVS_SECTOR_SIZE;
+  _compacting = _sectors;
+  return ok;
+}
+
+size_t KeyValueStore::freeBytes() const {
+  if (!_sequences)
+    return 0;
+  size_t free = 0;
+  for (size_t i = 0; i < _sectors; ++i) {
+    if (!_sequences[i])
+      ++free;
+  }
+  size_t bytes = (free > 1) ? (free - 1) * (KVS_SECTOR_SIZE - KVS_HEADER_SIZE) : 0;
+  if (_head < _sectors)
+    bytes += KVS_SECTOR_SIZE - _writePos;
+  return bytes;
+}
+
+bool KeyValueStore::_put(const char* key, uint8_t type, const void* value, size_t size) {
+  if (!_slots || !key)
+    return false;
+  size_t keyLength = strlen(key);
+  if (keyLength == 0 || keyLength > KVS_MAX_KEY_LENGTH || size > KVS_MAX_VALUE_SIZE)
+    return false;
+
+  // the same value again isn't written
+  uint32_t header[2];
+  uint32_t address = _lookup(key, header);
+  if (address && recordType(header[0]) == type && recordValueLength(header[0]) == size) {
+    uint32_t valueAddress = address + KVS_HEADER_SIZE + PAD4(keyLength);
+    uint32_t buf[16];
+    size_t done = 0;
+    while (done < size) {
+      size_t piece = (size - done < sizeof(buf)) ? size - done : sizeof(buf);
+      if (!_flashRead(valueAddress + done, buf, PAD4(piece)) ||
+          memcmp(buf, (const uint8_t*) value + done, piece) != 0)
+        break;
+      done += piece;
+    }
+    if (done == size)
+      return true;
+  }
+
+  header[0] = type | (keyLength << 8) | (size << 16);
+  header[1] = kvsCrc(kvsCrc(kvsCrc(0, &header[0], 4), key, keyLength), value, size);
+  if (!_room(recordSize(header[0])))
+    return false;
+  address = _head * KVS_SECTOR_SIZE + _writePos;
+  if (!_append(header, key, value, size))
+    return false;
+
+  uint32_t hash = kvsHash(key, keyLength);
+  if (type == KVS_TYPE_DELETED) {
+    Slot* slot = _find(key, keyLength, hash);
+    if (slot)
+      _unindex(slot);
+    return true;
+  }
+  return _index(key, keyLength, hash, address);
+}
+
+bool KeyValueStore::_get(const char* key, uint8_t type, void* value, size_t size) {
+  uint32_t header[2];
+  uint32_t address = _lookup(key, header);
+  if (!address || recordType(header[0]) != type || recordValueLength(header[0]) != size)
+    return false;
+  return _readValue(address, header[0], value, size);
+}
+
+uint32_t KeyValueStore::_lookup(const char* key, uint32_t* header) {
+  if (!_slots || !key)
+    return 0;
+  size_t keyLength = strlen(key);
+  if (keyLength == 0 || keyLength > KVS_MAX_KEY_LENGTH)
+    return 0;
+  Slot* slot = _find(key, keyLength, kvsHash(key, keyLength));
+  if (!slot || !_flashRead(slot->address, header, KVS_HEADER_SIZE))
+    return 0;
+  return slot->address;
+}
+
+bool KeyValueStore::_readValue(uint32_t address, uint32_t word, void* value, size_t size) {
+  uint32_t valueAddress = address + KVS_HEADER_SIZE + PAD4(recordKeyLength(word));
+  uint32_t buf[16];
+  for (size_t done = 0; done < size; done += sizeof(buf)) {
+    size_t piece = (size - done < sizeof(buf)) ? size - done : sizeof(buf);
+    if (!_flashRead(valueAddress + done, buf, PAD4(piece)))
+      return false;
+    memcpy((uint8_t*) value + done, buf, piece);
+  }
+  return true;
+}
+
+bool KeyValueStore::_append(const uint32_t* header, const char* key, const void* value, size_t size) {
+  uint32_t address = _head * KVS_SECTOR_SIZE + _writePos;
+  size_t keyLength = recordKeyLength(header[0]);
+  uint32_t buf[16];
+  buf[0] = header[0];
+  buf[1] = header[1];
+  memset(buf + 2, 0xff, PAD4(keyLength));
+  memcpy(buf + 2, key, keyLength);
+  size_t pos = KVS_HEADER_SIZE + PAD4(keyLength);
+  if (!_flashWrite(address, buf, pos)) {
+    // nothing more goes after a record that may be half written
+    _writePos = KVS_SECTOR_SIZE;
+    return false;
+  }
+  for (size_t done = 0; done < size; done += sizeof(buf)) {
+    size_t piece = (size - done < sizeof(buf)) ? size - done : sizeof(buf);
+    memset((uint8_t*) buf + piece, 0xff, PAD4(piece) - piece);
+    memcpy(buf, (const uint8_t*) value + done, piece);
+    if (!_flashWrite(address + pos, buf, PAD4(piece))) {
+      _writePos = KVS_SECTOR_SIZE;
+      return false;
+    }
+    pos += PAD4(piece);
+  }
+  _writePos += pos;
+  return true;
+}
+
+// makes room for size bytes at the head, compacting if it has to
+bool KeyValueStore::_room(size_t size) {
+  for (size_t tries = 0; tries <= _sectors + 1; ++tries) {
+    if (_head < _sectors && _writePos + size <= KVS_SECTOR_SIZE)
+      return true;
+    if (_compacting == _sectors && _nextSector(false))
+      continue;
+    // finish the compaction under way, or a new one
+    do {
+      if (!_compactStep())
+        return false;
+    } while (_compacting < _sectors);
+  }
+  return false;
+}
+
+// starts a new sector at the head: reserve is true if it may be the last
+// free one, which only compaction uses
+bool KeyValueStore::_nextSector(bool reserve) {
+  size_t free = 0;
+  size_t next = _sectors;
+  for (size_t i = 0; i < _sectors; ++i) {
+    if (!_sequences[i]) {
+      ++free;
+      if (next == _sectors || (_erased[i] && !_erased[next]))
+        next = i;
+    }
+  }
+  if (next == _sectors || (!reserve && free < 2))
+    return false;
+  if (!_erased[next] && !_isBlank(next) && !_flashErase(next))
+    return false;
+  _erased[next] = false;
+
+  // the magic number goes last, so a sector with it has all of its sequence
+  uint32_t sequence = _lastSequence + 1;
+  uint32_t magic = KVS_MAGIC;
+  if (!_flashWrite(next * KVS_SECTOR_SIZE + 4, &sequence, 4) ||
+      !_flashWrite(next * KVS_SECTOR_SIZE, &magic, 4))
+    return false;
+  _lastSequence = sequence;
+  _sequences[next] = sequence;
+  _head = next;
+  _writePos = KVS_HEADER_SIZE;
+  return true;
+}
+
+// copies one current record out of the oldest sector, or erases it once
+// there are none left
+bool KeyValueStore::_compactStep() {
+  if (_compacting == _sectors) {
+    // the one with the fewest current values, of those the oldest; the
+    // sector written to only if it is the only one
+    size_t used = 0;
+    for (size_t i = 0; i < _sectors; ++i) {
+      if (_sequences[i])
+        ++used;
+    }
+    size_t best = _sectors;
+    size_t bestLive = 0;
+    for (size_t i = 0; i < _sectors; ++i) {
+      if (!_sequences[i] || (i == _head && used > 1))
+        continue;
+      size_t live = 0;
+      for (size_t j = 0; j < _capacity; ++j) {
+        if (_slots[j].address && _slots[j].address / KVS_SECTOR_SIZE == i)
+          ++live;
+      }
+      if (best == _sectors || live < bestLive ||
+          (live == bestLive && _sequences[i] < _sequences[best])) {
+        best = i;
+        bestLive = live;
+      }
+    }
+    if (best == _sectors)
+      return false;
+    if (best == _head && !_nextSector(true))
+      return false;
+    _compacting = best;
+    _compactPos = KVS_HEADER_SIZE;
+    return true;
+  }
+
+  uint32_t base = _compacting * KVS_SECTOR_SIZE;
+  uint32_t header[2];
+  char key[KVS_MAX_KEY_LENGTH + 1];
+  if (_compactPos + KVS_HEADER_SIZE <= KVS_SECTOR_SIZE &&
+      _readHeader(base + _compactPos, header, key)) {
+    uint32_t address = base + _compactPos;
+    size_t size = recordSize(header[0]);
+    size_t keyLength = recordKeyLength(header[0]);
+    Slot* slot = _find(key, keyLength, kvsHash(key, keyLength));
+    bool copy = slot && slot->address == address;
+    if (!slot && recordType(header[0]) == KVS_TYPE_DELETED) {
+      // a removal still hides what an older sector has for the key
+      for (size_t i = 0; i < _sectors; ++i) {
+        if (_sequences[i] && _sequences[i] < _sequences[_compacting])
+          copy = true;
+      }
+    }
+    if (copy) {
+      if (!(_head < _sectors && _writePos + size <= KVS_SECTOR_SIZE) && !_nextSector(true))
+        return false;
+      uint32_t to = _head * KVS_SECTOR_SIZE + _writePos;
+      uint32_t buf[16];
+      for (size_t done = 0; done < size; done += sizeof(buf)) {
+        size_t piece = (size - done < sizeof(buf)) ? size - done : sizeof(buf);
+        if (!_flashRead(address + done, buf, piece))
+          return false;
+        if (!_flashWrite(to + done, buf, piece)) {
+          _writePos = KVS_SECTOR_SIZE;
+          return false;
+        }
+      }
+      _writePos += size;
+      if (slot)
+        slot->address = to;
+    }
+    _compactPos += size;
+    return true;
+  }
+
+  if (!_flashErase(_compacting))
+    return false;
+  _sequences[_compacting] = 0;
+  _erased[_compacting] = true;
+  _compacting = _sectors;
+  return true;
+}
+
+bool KeyValueStore::_isBlank(size_t sector) {
+  uint32_t buf[16];
+  for (uint32_t pos = 0; pos < KVS_SECTOR_SIZE; pos += sizeof(buf)) {
+    if (!_flashRead(sector * KVS_SECTOR_SIZE + pos, buf, sizeof(buf)))
+      return false;
+    for (size_t i = 0; i < 16; ++i) {
+      if (buf[i] != 0xffffffff)
+        return false;
+    }
+  }
+  return true;
+}
+
+// indexes the records of a sector, up to the first that isn't whole
+bool KeyValueStore::_scan(size_t sector) {
+  uint32_t base = sector * KVS_SECTOR_SIZE;
+  uint32_t pos = KVS_HEADER_SIZE;
+  while (pos + KVS_HEADER_SIZE <= KVS_SECTOR_SIZE) {
+    uint32_t header[2];
+    char key[KVS_MAX_KEY_LENGTH + 1];
+    if (!_flashRead(base + pos, header, sizeof(header)))
+      break;
+    if (header[0] == 0xffffffff)
+      break;
+    if (!_readHeader(base + pos, header, key) || !_checkRecord(base + pos, header, key)) {
+      pos = KVS_SECTOR_SIZE;
+      break;
+    }
+    size_t keyLength = recordKeyLength(header[0]);
+    uint32_t hash = kvsHash(key, keyLength);
+    if (recordType(header[0]) == KVS_TYPE_DELETED) {
+      Slot* slot = _find(key, keyLength, hash);
+      if (slot)
+        _unindex(slot);
+    } else if (!_index(key, keyLength, hash, base + pos)) {
+      return false;
+    }
+    pos += recordSize(header[0]);
+  }
+  _writePos = pos;
+  return true;
+}
+
+// the header and key of a record, false if it doesn't look like one
+bool KeyValueStore::_readHeader(uint32_t address, uint32_t* header, char* key) {
+  if (!_flashRead(address, header, KVS_HEADER_SIZE) || header[0] == 0xffffffff)
+    return false;
+  uint8_t type = recordType(header[0]);
+  size_t keyLength = recordKeyLength(header[0]);
+  size_t valueLength = recordValueLength(header[0]);
+  if (!((type >= KVS_TYPE_BOOL && type <= KVS_TYPE_BYTES) || type == KVS_TYPE_DELETED) ||
+      keyLength == 0 || keyLength > KVS_MAX_KEY_LENGTH || valueLength > KVS_MAX_VALUE_SIZE ||
+      address % KVS_SECTOR_SIZE + recordSize(header[0]) > KVS_SECTOR_SIZE)
+    return false;
+  uint32_t buf[PAD4(KVS_MAX_KEY_LENGTH) / 4];
+  if (!_flashRead(address + KVS_HEADER_SIZE, buf, PAD4(keyLength)))
+    return false;
+  memcpy(key, buf, keyLength);
+  key[keyLength] = 0;
+  return true;
+}
+
+bool KeyValueStore::_checkRecord(uint32_t address, const uint32_t* header, const char* key) {
+  size_t keyLength = recordKeyLength(header[0]);
+  size_t size = recordValueLength(header[0]);
+  uint32_t valueAddress = address + KVS_HEADER_SIZE + PAD4(keyLength);
+  uint32_t crc = kvsCrc(kvsCrc(0, &header[0], 4), key, keyLength);
+  uint32_t buf[16];
+  for (size_t done = 0; done < size; done += sizeof(buf)) {
+    size_t piece = (size - done < sizeof(buf)) ? size - done : sizeof(buf);
+    if (!_flashRead(valueAddress + done, buf, PAD4(piece)))
+      return false;
+    crc = kvsCrc(crc, buf, piece);
+  }
+  return crc == header[1];
+}
+
+KeyValueStore::Slot* KeyValueStore::_find(const char* key, size_t keyLength, uint32_t hash) {
+  size_t mask = _capacity - 1;
+  for (size_t i = hash & mask; _slots[i].address; i = (i + 1) & mask) {
+    if (_slots[i].hash != hash)
+      continue;
+    uint32_t header[2];
+    char stored[KVS_MAX_KEY_LENGTH + 1];
+    if (_readHeader(_slots[i].address, header, stored) &&
+        recordKeyLength(header[0]) == keyLength && memcmp(stored, key, keyLength) == 0)
+      return &_slots[i];
+  }
+  return 0;
+}
+
+bool KeyValueStore::_index(const char* key, size_t keyLength, uint32_t hash, uint32_t address) {
+  Slot* slot = _find(key, keyLength, hash);
+  if (slot) {
+    slot->address = address;
+    return true;
+  }
+  if ((_count + 1) * 4 > _capacity * 3 && !_grow())
+    return false;
+  size_t mask = _capacity - 1;
+  size_t i = hash & mask;
+  while (_slots[i].address)
+    i = (i + 1) & mask;
+  _slots[i].address = address;
+  _slots[i].hash = hash;
+  ++_count;
+  return true;
+}
+
+// takes the slot out, moving up the ones after it that belong before it
+void KeyValueStore::_unindex(Slot* slot) {
+  size_t mask = _capacity - 1;
+  size_t i = slot - _slots;
+  for (size_t j = (i + 1) & mask; _slots[j].address; j = (j + 1) & mask) {
+    size_t home = _slots[j].hash & mask;
+    bool stays = (i < j) ? (home > i && home <= j) : (home > i || home <= j);
+    if (!stays) {
+      _slots[i] = _slots[j];
+      i = j;
+    }
+  }
+  _slots[i].address = 0;
+  --_count;
+}
+
+bool KeyValueStore::_grow() {
+  size_t capacity = _capacity * 2;
+  Slot* slots = new Slot[capacity];
+  if (!slots)
+    return false;
+  memset(slots, 0, capacity * sizeof(Slot));
+  for (size_t i = 0; i < _capacity; ++i) {
+    if (!_slots[i].address)
+      continue;
+    size_t j = _slots[i].hash & (capacity - 1);
+    while (slots[j].address)
+      j = (j + 1) & (capacity - 1);
+    slots[j] = _slots[i];
+  }
+  delete[] _slots;
+  _slots = slots;
+  _capacity = capacity;
+  return true;
+}
+
+#ifdef ARDUINO
+
+bool KeyValueStore::_flashRead(uint32_t address, uint32_t* data, size_t size) {
+  return ESP.flashRead(_sector * KVS_SECTOR_SIZE + address, data, size);
+}
+
+bool KeyValueStore::_flashWrite(uint32_t address, const uint32_t* data, size_t size) {
+  return ESP.flashWrite(_sector * KVS_SECTOR_SIZE + address, const_cast<uint32_t*>(data), size);
+}
+
+bool KeyValueStore::_flashErase(uint32_t sector) {
+  return ESP.flashEraseSector(_sector + sector);
+}
+
+#else
+
+// host tests give their own flash
+bool KeyValueStore::_flashRead(uint32_t address, uint32_t* data, size_t size) {
+  (void) address;
+  (void) data;
+  (void) size;
+  return false;
+}
+
+bool KeyValueStore::_flashWrite(uint32_t address, const uint32_t* data, size_t size) {
+  (void) address;
+  (void) data;
+  (void) size;
+  return false;
+}
+
+bool KeyValueStore::_flashErase(uint32_t sector) {
+  (void) sector;
+  return false;
+}
+
+#endif
@@ -0,0 +1,153 @@
+/*
+  KeyValueStore.h - settings kept in flash by name, with an index in RAM
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef KeyValueStore_h
+#define KeyValueStore_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <WString.h>
+
+/*
+  Values are appended to a log in two or more flash sectors of their own,
+  each with its key, type and a CRC. begin() reads the log once and keeps
+  where the latest value of every key is in a hash table in RAM, 8 bytes a
+  key, so a get is a lookup and one flash read.
+
+  When a sector is full the next one is used. One sector is always kept
+  free so that the oldest can be compacted: the values in it that are
+  still current are copied to the end of the log and it is erased. put()
+  does that when it must, handle() called from loop() does it a little at
+  a time before it is needed.
+
+  A put cut short by a reset is not seen by begin(), the value before it is.
+*/
+
+#define KVS_SECTOR_SIZE     4096
+#define KVS_MAX_KEY_LENGTH  15
+// the largest value that fits in a sector with its key
+#define KVS_MAX_VALUE_SIZE  (KVS_SECTOR_SIZE - 8 - 8 - 16)
+
+enum KeyValueType {
+  KVS_TYPE_NONE    = 0,
+  KVS_TYPE_BOOL    = 1,
+  KVS_TYPE_INT     = 2,
+  KVS_TYPE_UINT    = 3,
+  KVS_TYPE_INT64   = 4,
+  KVS_TYPE_UINT64  = 5,
+  KVS_TYPE_FLOAT   = 6,
+  KVS_TYPE_DOUBLE  = 7,
+  KVS_TYPE_STRING  = 8,
+  KVS_TYPE_BYTES   = 9,
+};
+
+class KeyValueStore {
+public:
+  KeyValueStore(uint32_t sector, size_t sectors);
+  virtual ~KeyValueStore();
+
+  // reads the log and builds the index, false if there's no RAM for it
+  bool begin();
+  void end();
+  // copies a little of the oldest sector when it will be needed soon
+  void handle();
+
+  bool putBool(const char* key, bool value);
+  bool putInt(const char* key, int32_t value);
+  bool putUInt(const char* key, uint32_t value);
+  bool putInt64(const char* key, int64_t value);
+  bool putUInt64(const char* key, uint64_t value);
+  bool putFloat(const char* key, float value);
+  bool putDouble(const char* key, double value);
+  bool putString(const char* key, const char* value);
+  bool putString(const char* key, const String& value);
+  bool putBytes(const char* key, const void* value, size_t size);
+
+  // the value, or defaultValue if there is none of that type
+  bool getBool(const char* key, bool defaultValue = false);
+  int32_t getInt(const char* key, int32_t defaultValue = 0);
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  int64_t getInt64(const char* key, int64_t defaultValue = 0);
+  uint64_t getUInt64(const char* key, uint64_t defaultValue = 0);
+  float getFloat(const char* key, float defaultValue = 0);
+  double getDouble(const char* key, double defaultValue = 0);
+  String getString(const char* key, const String& defaultValue = String());
+  // copies up to size bytes, returns the length of the value
+  size_t getBytes(const char* key, void* buffer, size_t size);
+  size_t getBytesLength(const char* key);
+
+  KeyValueType getType(const char* key);
+  bool isKey(const char* key);
+  bool remove(const char* key);
+  // erases all sectors
+  bool clear();
+
+  size_t count() const { return _count; }
+  // what can be written before compacting
+  size_t freeBytes() const;
+
+protected:
+  // the flash, addresses from the first sector given; true if it worked
+  virtual bool _flashRead(uint32_t address, uint32_t* data, size_t size);
+  virtual bool _flashWrite(uint32_t address, const uint32_t* data, size_t size);
+  virtual bool _flashErase(uint32_t sector);
+
+  struct Slot {
+    uint32_t address;   // of the record, 0 if the slot is empty
+    uint32_t hash;
+  };
+
+  bool _put(const char* key, uint8_t type, const void* value, size_t size);
+  bool _get(const char* key, uint8_t type, void* value, size_t size);
+  uint32_t _lookup(const char* key, uint32_t* header);
+  bool _readValue(uint32_t address, uint32_t word, void* value, size_t size);
+  bool _append(const uint32_t* header, const char* key, const void* value, size_t size);
+  bool _room(size_t size);
+  bool _nextSector(bool reserve);
+  bool _compactStep();
+  bool _isBlank(size_t sector);
+
+  bool _scan(size_t sector);
+  bool _readHeader(uint32_t address, uint32_t* header, char* key);
+  bool _checkRecord(uint32_t address, const uint32_t* header, const char* key);
+
+  Slot* _find(const char* key, size_t keyLength, uint32_t hash);
+  bool _index(const char* key, size_t keyLength, uint32_t hash, uint32_t address);
+  void _unindex(Slot* slot);
+  bool _grow();
+
+  uint32_t _sector;
+  size_t _sectors;
+  uint32_t* _sequences;   // of every sector, 0 if it is free
+  bool* _erased;          // free and known to be erased
+
+  size_t _head;           // the sector written to, _sectors if none yet
+  uint32_t _writePos;
+  uint32_t _lastSequence;
+
+  size_t _compacting;     // the sector being compacted, _sectors if none
+  uint32_t _compactPos;
+
+  Slot* _slots;
+  size_t _capacity;       // a power of 2
+  size_t _count;
+};
+
+#endif
@@ -310,16 +310,6 @@ boolean callback_openPath(SdFile& parentDir, char *filePathComponent,
 
 
 
-boolean callback_remove(SdFile& parentDir, char *filePathComponent, 
-			boolean isLastComponent, void *object) {
-  (void) object;
-
-  if (isLastComponent) {
-    return SdFile::remove(parentDir, filePathComponent);
-  }
-  return true;
-}
-
 boolean callback_rmdir(SdFile& parentDir, char *filePathComponent, 
 			boolean isLastComponent, void *object) {
   (void) object;
@@ -345,52 +335,98 @@ boolean SDClass::begin(uint8_t csPin, uint32_t speed) {
     Return true if initialization succeeds, false otherwise.
 
    */
+  clearDirCache();
+  root.close();
   return card.init(speed, csPin) &&
          volume.init(card) &&
          root.openRoot(volume);
 }
 
+void SDClass::clearDirCache() {
+  for (int i = 0; i < SD_DIR_CACHE_SIZE; i++) {
+    dirCache[i].dir.close();
+  }
+}
+
 // this little helper is used to traverse paths
-SdFile SDClass::getParentDir(const char *filepath, int *index) {
-  // get parent directory
-  SdFile d1 = root; // start with the mostparent, root!
+SdFile *SDClass::getParentDir(const char *filepath, int *index) {
+  // the file is named by what follows the last '/', its directory by what
+  // comes before
+  const char *name = strrchr(filepath, '/');
+  name = name ? name + 1 : filepath;
+  *index = (int)(name - filepath);
+
+  const char *path = filepath;
+  while (*path == '/') {
+    path++;
+  }
+  size_t len = name > path ? name - path : 0;
+  while (len && path[len - 1] == '/') {
+    len--;
+  }
+  if (!len) {
+    return &root;
+  }
+
+  // start from the longest cached directory the path is in
+  int cached = -1;
+  size_t offset = 0;
+  for (int i = 0; i < SD_DIR_CACHE_SIZE; i++) {
+    if (!dirCache[i].dir.isOpen())
+      continue;
+    size_t n = strlen(dirCache[i].path);
+    if (n > offset && n <= len && (n == len || path[n] == '/')
+        && !strncasecmp(dirCache[i].path, path, n)) {
+      cached = i;
+      offset = n;
+    }
+  }
+  if (cached >= 0 && offset == len) {
+    // move it to the front, the last one goes first
+    DirCacheEntry hit = dirCache[cached];
+    for (int i = cached; i > 0; i--) {
+      dirCache[i] = dirCache[i - 1];
+    }
+    dirCache[0] = hit;
+    return &dirCache[0].dir;
+  }
+
+  SdFile d1 = cached >= 0 ? dirCache[cached].dir : root;
   SdFile d2;
 
   // we'll use the pointers to swap between the two objects
   SdFile *parent = &d1;
   SdFile *subdir = &d2;
-  
-  const char *origpath = filepath;
 
-  while (strchr(filepath, '/')) {
+  // '.' and '..' would give the same directory another path
+  boolean cacheable = len < SD_DIR_CACHE_PATH_LEN;
 
-    // get rid of leading /'s
-    if (filepath[0] == '/') {
-      filepath++;
-      continue;
+  while (offset < len) {
+    while (path[offset] == '/') {
+      offset++;
     }
-    
-    if (! strchr(filepath, '/')) {
-      // it was in the root directory, so leave now
-      break;
+    size_t end = offset;
+    while (end < len && path[end] != '/') {
+      end++;
     }
 
-    // extract just the name of the next subdirectory
-    uint8_t idx = strchr(filepath, '/') - filepath;
-    if (idx > 12)
-      idx = 12;    // dont let them specify long names
-    char subdirname[13];
-    strncpy(subdirname, filepath, idx);
-    subdirname[idx] = 0;
+    // dont let them specify long names
+    size_t n = end - offset;
+    if (n > MAX_COMPONENT_LEN)
+      n = MAX_COMPONENT_LEN;
+    char subdirname[PATH_COMPONENT_BUFFER_LEN];
+    memcpy(subdirname, path + offset, n);
+    subdirname[n] = 0;
+    if (subdirname[0] == '.')
+      cacheable = false;
 
     // close the subdir (we reuse them) if open
     subdir->close();
     if (! subdir->open(parent, subdirname, O_READ)) {
       // failed to open one of the subdirectories
-      return SdFile();
+      return NULL;
     }
-    // move forward to the next subdirectory
-    filepath += idx;
+    offset = end;
 
     // we reuse the objects, close it.
     parent->close();
@@ -401,9 +437,21 @@ SdFile SDClass::getParentDir(const char *filepath, int *index) {
     subdir = t;
   }
 
-  *index = (int)(filepath - origpath);
+  if (!parent->isDir()) {
+    return NULL;
+  }
+  if (!cacheable) {
+    lookupDir = *parent;
+    return &lookupDir;
+  }
+  for (int i = SD_DIR_CACHE_SIZE - 1; i > 0; i--) {
+    dirCache[i] = dirCache[i - 1];
+  }
+  memcpy(dirCache[0].path, path, len);
+  dirCache[0].path[len] = 0;
+  dirCache[0].dir = *parent;
   // parent is now the parent diretory of the file!
-  return *parent;
+  return &dirCache[0].dir;
 }
 
 
@@ -434,36 +482,25 @@ File SDClass::open(const char *filepath, uint8_t mode) {
   int pathidx;
 
   // do the interative search
-  SdFile parentdir = getParentDir(filepath, &pathidx);
+  SdFile *parentdir = getParentDir(filepath, &pathidx);
   // no more subdirs!
 
+  // failed to open a subdir!
+  if (!parentdir)
+    return File();
+
   filepath += pathidx;
 
   if (! filepath[0]) {
     // it was the directory itself!
-    return File(parentdir, "/");
+    return File(*parentdir, "/");
   }
 
-  // Open the file itself
+  // Open the file itself, the parent stays open (it is the root or cached)
   SdFile file;
-
-  // failed to open a subdir!
-  if (!parentdir.isOpen())
+  if ( ! file.open(parentdir, filepath, mode)) {
+    // failed to open the file :(
     return File();
-
-  // there is a special case for the Root directory since its a static dir
-  if (parentdir.isRoot()) {
-    if ( ! file.open(root, filepath, mode)) {
-      // failed to open the file :(
-      return File();
-    }
-    // dont close the root!
-  } else {
-    if ( ! file.open(parentdir, filepath, mode)) {
-      return File();
-    }
-    // close the parent
-    parentdir.close();
   }
 
   if (mode & (O_APPEND | O_WRITE)) 
@@ -524,7 +561,20 @@ boolean SDClass::exists(const char *filepath) {
      Returns true if the supplied file path exists.
 
    */
-  return walkPath(filepath, root, callback_pathExists);
+  int pathidx;
+  SdFile *parentdir = getParentDir(filepath, &pathidx);
+  if (!parentdir)
+    return false;
+
+  filepath += pathidx;
+  if (! filepath[0])
+    return true;
+
+  SdFile child;
+  if (! child.open(parentdir, filepath, O_RDONLY))
+    return false;
+  child.close();
+  return true;
 }
 
 
@@ -547,6 +597,8 @@ boolean SDClass::mkdir(const char *filepath) {
     A rough equivalent to `mkdir -p`.
   
    */
+  // the parents' sizes change when they grow a cluster
+  clearDirCache();
   return walkPath(filepath, root, callback_makeDirPath);
 }
 
@@ -558,11 +610,16 @@ boolean SDClass::rmdir(const char *filepath) {
     A rough equivalent to `rm -rf`.
   
    */
+  clearDirCache();
   return walkPath(filepath, root, callback_rmdir);
 }
 
 boolean SDClass::remove(const char *filepath) {
-  return walkPath(filepath, root, callback_remove);
+  int pathidx;
+  SdFile *parentdir = getParentDir(filepath, &pathidx);
+  if (!parentdir || ! filepath[pathidx])
+    return false;
+  return SdFile::remove(parentdir, filepath + pathidx);
 }
 
 
@@ -23,6 +23,13 @@
 #define FILE_READ O_READ
 #define FILE_WRITE (O_READ | O_WRITE | O_CREAT)
 
+// Directories open() and exists() remember, so that they don't walk the path
+// from the root again for files in the same directory.
+#ifndef SD_DIR_CACHE_SIZE
+#define SD_DIR_CACHE_SIZE 4
+#endif
+#define SD_DIR_CACHE_PATH_LEN 32
+
 class File : public Stream {
  private:
   char _name[13]; // our name
@@ -81,9 +88,23 @@ private:
   Sd2Card card;
   SdVolume volume;
   SdFile root;
-  
-  // my quick&dirty iterator, should be replaced
-  SdFile getParentDir(const char *filepath, int *indx);
+
+  // The directories last looked up, most recent first, by their path
+  // without the leading and trailing '/'. The entries are the open
+  // directories themselves, so that files created in them through open()
+  // keep their size right; making or removing directories clears them.
+  struct DirCacheEntry {
+    char path[SD_DIR_CACHE_PATH_LEN];
+    SdFile dir;
+  };
+  DirCacheEntry dirCache[SD_DIR_CACHE_SIZE];
+  SdFile lookupDir; // for a path too long to be cached
+
+  // The directory the last component of filepath is in, which stays valid
+  // until the next call, or NULL if it doesn't exist. indx is set to where
+  // that component starts.
+  SdFile *getParentDir(const char *filepath, int *indx);
+  void clearDirCache();
 public:
   // This needs to be called to set up the connection to the SD card
   // before other methods are used.
@@ -129,6 +150,7 @@ private:
   int fileOpenMode;
   
   friend class File;
+  friend class SDFSImpl;
   friend boolean callback_openPath(SdFile&, char *, boolean, void *); 
 };
 
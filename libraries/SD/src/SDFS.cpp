@@ -0,0 +1,248 @@
+/*
+
+ SDFS - the SD card as an fs::FS
+
+ License: GNU General Public License V3
+          (Because sdfatlib is licensed with this.)
+
+ */
+
+#include "SDFS.h"
+#include <FSImpl.h>
+
+using namespace fs;
+
+static uint8_t sdOpenFlags(OpenMode openMode, AccessMode accessMode) {
+  uint8_t flags = 0;
+  if (accessMode & AM_READ)
+    flags |= O_READ;
+  if (accessMode & AM_WRITE)
+    flags |= O_WRITE;
+  if (openMode & OM_CREATE)
+    flags |= O_CREAT;
+  if (openMode & OM_APPEND)
+    flags |= O_APPEND;
+  if (openMode & OM_TRUNCATE)
+    flags |= O_TRUNC;
+  return flags;
+}
+
+class SDFSFileImpl : public FileImpl {
+public:
+  SDFSFileImpl(const SdFile &file, const char *path)
+    : _file(file), _path(path) {}
+
+  ~SDFSFileImpl() override {
+    close();
+  }
+
+  size_t write(const uint8_t *buf, size_t size) override {
+    // SdFile counts in 16 bits
+    size_t done = 0;
+    while (done < size) {
+      uint16_t chunk = std::min(size - done, (size_t)0x4000);
+      _file.clearWriteError();
+      _file.write(buf + done, chunk);
+      if (_file.getWriteError())
+        break;
+      done += chunk;
+    }
+    return done;
+  }
+
+  size_t read(uint8_t *buf, size_t size) override {
+    size_t done = 0;
+    while (done < size) {
+      uint16_t chunk = std::min(size - done, (size_t)0x4000);
+      int16_t got = _file.read(buf + done, chunk);
+      if (got <= 0)
+        break;
+      done += got;
+    }
+    return done;
+  }
+
+  void flush() override {
+    _file.sync();
+  }
+
+  bool seek(uint32_t pos, SeekMode mode) override {
+    if (mode == SeekCur)
+      pos += _file.curPosition();
+    else if (mode == SeekEnd)
+      pos = _file.fileSize() - pos;
+    return _file.seekSet(pos);
+  }
+
+  size_t position() const override {
+    return _file.curPosition();
+  }
+
+  size_t size() const override {
+    return _file.fileSize();
+  }
+
+  void close() override {
+    if (_file.isOpen())
+      _file.close();
+  }
+
+  const char *name() const override {
+    return _path.c_str();
+  }
+
+protected:
+  SdFile _file;
+  String _path;
+};
+
+class SDFSDirImpl : public DirImpl {
+public:
+  SDFSDirImpl(const SdFile &dir, const char *path)
+    : _dir(dir), _path(path), _index(-1), _size(0) {
+    if (!_path.endsWith("/"))
+      _path += '/';
+  }
+
+  FileImplPtr openFile(OpenMode openMode, AccessMode accessMode) override {
+    if (_index < 0)
+      return FileImplPtr();
+    // opening by index moves the directory to the entry, put it back after
+    uint32_t pos = _dir.curPosition();
+    SdFile file;
+    boolean opened = file.open(&_dir, _index, sdOpenFlags(openMode, accessMode) & ~O_CREAT);
+    _dir.seekSet(pos);
+    if (!opened)
+      return FileImplPtr();
+    return std::make_shared<SDFSFileImpl>(file, _name.c_str());
+  }
+
+  const char *fileName() override {
+    return _index < 0 ? nullptr : _name.c_str();
+  }
+
+  size_t fileSize() override {
+    return _size;
+  }
+
+  bool next() override {
+    dir_t p;
+    _index = -1;
+    while (_dir.readDir(&p) > 0) {
+      // done if past last used entry
+      if (p.name[0] == DIR_NAME_FREE)
+        break;
+      // skip deleted entry and entries for . and  ..
+      if (p.name[0] == DIR_NAME_DELETED || p.name[0] == '.')
+        continue;
+      // only list subdirectories and files
+      if (!DIR_IS_FILE_OR_SUBDIR(&p))
+        continue;
+
+      char name[13];
+      SdFile::dirName(p, name);
+      _name = _path + name;
+      _size = p.fileSize;
+      _index = _dir.curPosition() / sizeof(dir_t) - 1;
+      return true;
+    }
+    return false;
+  }
+
+protected:
+  SdFile _dir;
+  String _path;
+  String _name;
+  int32_t _index;   // of the current entry in _dir, -1 for none
+  uint32_t _size;
+};
+
+class SDFSImpl : public FSImpl {
+public:
+  SDFSImpl(SDClass &sd) : _sd(sd) {}
+
+  bool begin() override {
+    return _sd.root.isOpen() || _sd.begin();
+  }
+
+  void end() override {
+    _sd.clearDirCache();
+    _sd.root.close();
+  }
+
+  bool format() override {
+    return false;
+  }
+
+  bool info(FSInfo &info) override {
+    if (!_sd.root.isOpen())
+      return false;
+    uint64_t total = (uint64_t)_sd.totalClusters() * _sd.clusterSize();
+    info.totalBytes = total > SIZE_MAX ? SIZE_MAX : total;
+    // counting the free clusters would read the whole FAT
+    info.usedBytes = 0;
+    info.blockSize = _sd.clusterSize();
+    info.pageSize = _sd.blockSize();
+    // no limit but the heap
+    info.maxOpenFiles = 0;
+    info.maxPathLength = 0;
+    return true;
+  }
+
+  FileImplPtr open(const char *path, OpenMode openMode, AccessMode accessMode) override {
+    int index;
+    SdFile *dir = _sd.getParentDir(path, &index);
+    if (!dir || !path[index])
+      return FileImplPtr();
+    SdFile file;
+    if (!file.open(dir, path + index, sdOpenFlags(openMode, accessMode)))
+      return FileImplPtr();
+    if (file.isDir()) {
+      file.close();
+      return FileImplPtr();
+    }
+    return std::make_shared<SDFSFileImpl>(file, path);
+  }
+
+  bool exists(const char *path) override {
+    return _sd.exists(path);
+  }
+
+  DirImplPtr openDir(const char *path) override {
+    int index;
+    SdFile *parent = _sd.getParentDir(path, &index);
+    if (!parent)
+      return DirImplPtr();
+    SdFile dir;
+    if (!path[index])
+      dir = *parent;
+    else if (!dir.open(parent, path + index, O_READ))
+      return DirImplPtr();
+    if (!dir.isDir())
+      return DirImplPtr();
+    dir.rewind();
+    return std::make_shared<SDFSDirImpl>(dir, path);
+  }
+
+  bool rename(const char *pathFrom, const char *pathTo) override {
+    (void) pathFrom;
+    (void) pathTo;
+    return false;
+  }
+
+  bool remove(const char *path) override {
+    return _sd.remove(path);
+  }
+
+protected:
+  SDClass &_sd;
+};
+
+#if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_SDFS)
+static FSImplPtr makeSDFS()
+{
+    return FSImplPtr(new SDFSImpl(SD));
+}
+
+FS SDFS = FS(makeSDFS);
+#endif
@@ -0,0 +1,36 @@
+/*
+
+ SDFS - the SD card as an fs::FS
+
+ The card mounted by SD.begin() (or by SDFS.begin(), with the default chip
+ select and speed) is opened through the same fs::FS interface as SPIFFS,
+ so that code written for it, like ESP8266WebServer::serveStatic(), serves
+ files from the card as well:
+
+   SD.begin(D8);
+   server.serveStatic("/", SDFS, "/www/");
+
+ SD.h has a File class of its own, so the one of FS.h is fs::File here.
+ Directories are listed by Dir with their full path like on SPIFFS;
+ format() and rename() are not supported.
+
+ License: GNU General Public License V3
+          (Because sdfatlib is licensed with this.)
+
+ */
+
+#ifndef __SDFS_H__
+#define __SDFS_H__
+
+#include "SD.h"
+
+#ifndef FS_NO_GLOBALS
+#define FS_NO_GLOBALS
+#endif
+#include <FS.h>
+
+#if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_SDFS)
+extern fs::FS SDFS;
+#endif
+
+#endif
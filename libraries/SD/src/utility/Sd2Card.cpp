@@ -381,6 +381,27 @@ uint8_t Sd2Card::readBlock(uint32_t block, uint8_t* dst) {
   return readData(block, 0, 512, dst);
 }
 //------------------------------------------------------------------------------
+/**
+ * Read consecutive 512 byte blocks from an SD card device with one
+ * multiple block read command.
+ *
+ * \param[in] block First logical block to be read.
+ * \param[in] count Number of blocks to read.
+ * \param[out] dst Pointer to the location that will receive the data,
+ * count * 512 bytes.
+
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readBlocks(uint32_t block, uint16_t count, uint8_t* dst) {
+  if (count == 1) return readBlock(block, dst);
+  if (!readStart(block)) return false;
+  for (uint16_t i = 0; i < count; i++, dst += 512) {
+    if (!readData(dst)) return false;
+  }
+  return readStop();
+}
+//------------------------------------------------------------------------------
 /**
  * Read part of a 512 byte block from an SD card.
  *
@@ -440,7 +461,8 @@ uint8_t Sd2Card::readData(uint32_t block,
 #else  // OPTIMIZE_HARDWARE_SPI
 #ifdef ESP8266
   // skip data before offset
-  SPI.transferBytes(NULL, NULL, offset_);
+  SPI.transferBytes(NULL, NULL, offset - offset_);
+  offset_ = offset;
 
   // transfer data
   SPI.transferBytes(NULL, dst, count);
@@ -469,6 +491,68 @@ uint8_t Sd2Card::readData(uint32_t block,
   return false;
 }
 //------------------------------------------------------------------------------
+/** Start a read multiple blocks sequence.
+ *
+ * \param[in] blockNumber Address of first block in sequence.
+ *
+ * \note This function is used with readData() and readStop()
+ * for optimized multiple block reads.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStart(uint32_t blockNumber) {
+  // use address if not SDHC card
+  if (type()!= SD_CARD_TYPE_SDHC) blockNumber <<= 9;
+  if (cardCommand(CMD18, blockNumber)) {
+    error(SD_CARD_ERROR_CMD18);
+    chipSelectHigh();
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+/** Read one data block in a multiple block read sequence
+ *
+ * \param[out] dst Pointer to the location that will receive the data.
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readData(uint8_t* dst) {
+  if (!waitStartBlock()) return false;
+#ifdef ESP8266
+  SPI.transferBytes(NULL, dst, 512);
+#else
+  for (uint16_t i = 0; i < 512; i++) dst[i] = spiRec();
+#endif
+  spiRec();  // get first crc byte
+  spiRec();  // get second crc byte
+  return true;
+}
+//------------------------------------------------------------------------------
+/** End a read multiple blocks sequence.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStop(void) {
+  // the card keeps sending data: cardCommand() would wait for it to
+  // stop being busy first
+  spiSend(CMD12 | 0x40);
+  for (uint8_t i = 0; i < 4; i++) spiSend(0);
+  spiSend(0xFF);  // crc
+  spiRec();       // stuff byte
+  for (uint8_t i = 0; ((status_ = spiRec()) & 0x80) && i != 0xFF; i++)
+    ;
+  if (status_ || !waitNotBusy(SD_READ_TIMEOUT)) {
+    error(SD_CARD_ERROR_CMD12);
+    chipSelectHigh();
+    return false;
+  }
+  chipSelectHigh();
+  return true;
+}
+//------------------------------------------------------------------------------
 /** Skip remaining data in a block when in partial block read mode. */
 void Sd2Card::readEnd(void) {
   if (inBlock_) {
@@ -648,6 +732,26 @@ uint8_t Sd2Card::writeBlock(uint32_t blockNumber, const uint8_t* src) {
   return false;
 }
 //------------------------------------------------------------------------------
+/**
+ * Writes consecutive 512 byte blocks to an SD card with one multiple
+ * block write command, the blocks being pre-erased.
+ *
+ * \param[in] blockNumber First logical block to be written.
+ * \param[in] count Number of blocks to write.
+ * \param[in] src Pointer to the location of the data to be written,
+ * count * 512 bytes.
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::writeBlocks(uint32_t blockNumber, uint16_t count, const uint8_t* src) {
+  if (count == 1) return writeBlock(blockNumber, src);
+  if (!writeStart(blockNumber, count)) return false;
+  for (uint16_t i = 0; i < count; i++, src += 512) {
+    if (!writeData(src)) return false;
+  }
+  return writeStop();
+}
+//------------------------------------------------------------------------------
 /** Write one data block in a multiple block write sequence */
 uint8_t Sd2Card::writeData(const uint8_t* src) {
   // wait for previous write to finish
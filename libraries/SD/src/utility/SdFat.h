@@ -35,6 +35,14 @@
  */
 #define ALLOW_DEPRECATED_FUNCTIONS 1
 //------------------------------------------------------------------------------
+/**
+ * Number of FAT blocks cached apart from the directory and data block,
+ * from 1 to 8, 512 bytes of RAM each.
+ */
+#ifndef SD_FAT_CACHE_COUNT
+#define SD_FAT_CACHE_COUNT 2
+#endif
+//------------------------------------------------------------------------------
 // forward declaration since SdVolume is used in SdFile
 class SdVolume;
 //==============================================================================
@@ -503,7 +511,13 @@ class SdVolume {
   static uint32_t cacheBlockNumber_;  // Logical number of block in the cache
   static Sd2Card* sdCard_;            // Sd2Card object for cache
   static uint8_t cacheDirty_;         // cacheFlush() will write block if true
-  static uint32_t cacheMirrorBlock_;  // block number for mirror FAT
+  // FAT blocks have their own cache, so that following a cluster chain
+  // doesn't evict the data block and the other way round
+  static cache_t fatCache_[SD_FAT_CACHE_COUNT];
+  static uint32_t fatCacheBlockNumber_[SD_FAT_CACHE_COUNT];
+  static uint8_t fatCacheAge_[SD_FAT_CACHE_COUNT];  // 0 for the last used
+  static uint8_t fatCacheDirty_;      // bit set for each block to write
+  static uint32_t fatMirrorOffset_;   // from a block to the second FAT, or 0
 //
   uint32_t allocSearchStart_;   // start cluster for alloc search
   uint8_t blocksPerCluster_;    // cluster size in blocks
@@ -525,7 +539,11 @@ class SdVolume {
   uint32_t blockNumber(uint32_t cluster, uint32_t position) const {
            return clusterStartBlock(cluster) + blockOfCluster(position);}
   static uint8_t cacheFlush(void);
+  static uint8_t cacheFlushData(void);
   static uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action);
+  static cache_t* fatCacheBlock(uint32_t blockNumber, uint8_t action);
+  static uint8_t fatCacheFlush(void);
+  static uint8_t fatCacheWrite(uint8_t slot);
   static void cacheSetDirty(void) {cacheDirty_ |= CACHE_FOR_WRITE;}
   static uint8_t cacheZeroBlock(uint32_t blockNumber);
   uint8_t chainSize(uint32_t beginCluster, uint32_t* size) const;
@@ -540,6 +558,8 @@ class SdVolume {
   }
   uint8_t readBlock(uint32_t block, uint8_t* dst) {
     return sdCard_->readBlock(block, dst);}
+  uint8_t readBlocks(uint32_t block, uint16_t count, uint8_t* dst) {
+    return sdCard_->readBlocks(block, count, dst);}
   uint8_t readData(uint32_t block, uint16_t offset,
     uint16_t count, uint8_t* dst) {
       return sdCard_->readData(block, offset, count, dst);
@@ -547,5 +567,8 @@ class SdVolume {
   uint8_t writeBlock(uint32_t block, const uint8_t* dst) {
     return sdCard_->writeBlock(block, dst);
   }
+  uint8_t writeBlocks(uint32_t block, uint16_t count, const uint8_t* src) {
+    return sdCard_->writeBlocks(block, count, src);
+  }
 };
 #endif  // SdFat_h
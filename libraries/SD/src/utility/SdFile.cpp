@@ -702,9 +702,26 @@ int16_t SdFile::read(void* buf, uint16_t nbyte) {
     // amount to be read from current block
     if (n > (512 - offset)) n = 512 - offset;
 
-    // no buffering needed if n == 512 or user requests no buffering
-    if ((unbufferedRead() || n == 512) &&
+    // whole blocks up to the end of the cluster are read with one command,
+    // stopping before the one in the cache
+    uint16_t blocks = toRead >> 9;
+    if (n == 512 && blocks > 1 && type_ != FAT_FILE_TYPE_ROOT16) {
+      uint8_t left = vol_->blocksPerCluster() - vol_->blockOfCluster(curPosition_);
+      if (blocks > left) blocks = left;
+      if (SdVolume::cacheBlockNumber_ >= block &&
+        SdVolume::cacheBlockNumber_ < block + blocks) {
+        blocks = SdVolume::cacheBlockNumber_ - block;
+      }
+    } else {
+      blocks = 0;
+    }
+    if (blocks > 1) {
+      if (!vol_->readBlocks(block, blocks, dst)) return -1;
+      n = blocks << 9;
+      dst += n;
+    } else if ((unbufferedRead() || n == 512) &&
       block != SdVolume::cacheBlockNumber_) {
+      // no buffering needed if n == 512 or user requests no buffering
       if (!vol_->readData(block, offset, n, dst)) return -1;
       dst += n;
     } else {
@@ -1178,17 +1195,23 @@ size_t SdFile::write(const void* buf, uint16_t nbyte) {
     // block for data write
     uint32_t block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
     if (n == 512) {
-      // full block - don't need to use cache
-      // invalidate cache if block is in cache
-      if (SdVolume::cacheBlockNumber_ == block) {
+      // full blocks up to the end of the cluster - don't need to use cache,
+      // and go with one command when there are several
+      uint16_t blocks = nToWrite >> 9;
+      uint8_t left = vol_->blocksPerCluster() - blockOfCluster;
+      if (blocks > left) blocks = left;
+      // invalidate cache if one of the blocks is in cache
+      if (SdVolume::cacheBlockNumber_ >= block &&
+        SdVolume::cacheBlockNumber_ < block + blocks) {
         SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
       }
-      if (!vol_->writeBlock(block, src)) goto writeErrorReturn;
-      src += 512;
+      if (!vol_->writeBlocks(block, blocks, src)) goto writeErrorReturn;
+      n = blocks << 9;
+      src += n;
     } else {
       if (blockOffset == 0 && curPosition_ >= fileSize_) {
         // start of new block don't need to read into cache
-        if (!SdVolume::cacheFlush()) goto writeErrorReturn;
+        if (!SdVolume::cacheFlushData()) goto writeErrorReturn;
         SdVolume::cacheBlockNumber_ = block;
         SdVolume::cacheSetDirty();
       } else {
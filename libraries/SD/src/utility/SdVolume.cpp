@@ -25,7 +25,12 @@ uint32_t SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
 cache_t  SdVolume::cacheBuffer_;     // 512 byte cache for Sd2Card
 Sd2Card* SdVolume::sdCard_;          // pointer to SD card object
 uint8_t  SdVolume::cacheDirty_ = 0;  // cacheFlush() will write block if true
-uint32_t SdVolume::cacheMirrorBlock_ = 0;  // mirror  block for second FAT
+// FAT block cache
+cache_t  SdVolume::fatCache_[SD_FAT_CACHE_COUNT];
+uint32_t SdVolume::fatCacheBlockNumber_[SD_FAT_CACHE_COUNT];
+uint8_t  SdVolume::fatCacheAge_[SD_FAT_CACHE_COUNT];
+uint8_t  SdVolume::fatCacheDirty_ = 0;
+uint32_t SdVolume::fatMirrorOffset_ = 0;  // mirror block for second FAT
 //------------------------------------------------------------------------------
 // find a contiguous group of clusters
 uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
@@ -96,18 +101,17 @@ uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
   return true;
 }
 //------------------------------------------------------------------------------
+// write the data block and the FAT blocks
 uint8_t SdVolume::cacheFlush(void) {
+  return cacheFlushData() && fatCacheFlush();
+}
+//------------------------------------------------------------------------------
+// write the directory or data block only
+uint8_t SdVolume::cacheFlushData(void) {
   if (cacheDirty_) {
     if (!sdCard_->writeBlock(cacheBlockNumber_, cacheBuffer_.data)) {
       return false;
     }
-    // mirror FAT tables
-    if (cacheMirrorBlock_) {
-      if (!sdCard_->writeBlock(cacheMirrorBlock_, cacheBuffer_.data)) {
-        return false;
-      }
-      cacheMirrorBlock_ = 0;
-    }
     cacheDirty_ = 0;
   }
   return true;
@@ -115,7 +119,7 @@ uint8_t SdVolume::cacheFlush(void) {
 //------------------------------------------------------------------------------
 uint8_t SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action) {
   if (cacheBlockNumber_ != blockNumber) {
-    if (!cacheFlush()) return false;
+    if (!cacheFlushData()) return false;
     if (!sdCard_->readBlock(blockNumber, cacheBuffer_.data)) return false;
     cacheBlockNumber_ = blockNumber;
   }
@@ -125,7 +129,7 @@ uint8_t SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action) {
 //------------------------------------------------------------------------------
 // cache a zero block for blockNumber
 uint8_t SdVolume::cacheZeroBlock(uint32_t blockNumber) {
-  if (!cacheFlush()) return false;
+  if (!cacheFlushData()) return false;
 
   // loop take less flash than memset(cacheBuffer_.data, 0, 512);
   for (uint16_t i = 0; i < 512; i++) {
@@ -136,6 +140,53 @@ uint8_t SdVolume::cacheZeroBlock(uint32_t blockNumber) {
   return true;
 }
 //------------------------------------------------------------------------------
+// return the cache holding FAT block blockNumber, reading it in place of the
+// least recently used one if needed
+cache_t* SdVolume::fatCacheBlock(uint32_t blockNumber, uint8_t action) {
+  uint8_t slot = 0;
+  for (uint8_t i = 0; i < SD_FAT_CACHE_COUNT; i++) {
+    if (fatCacheBlockNumber_[i] == blockNumber) {
+      slot = i;
+      break;
+    }
+    if (fatCacheAge_[i] > fatCacheAge_[slot]) slot = i;
+  }
+  if (fatCacheBlockNumber_[slot] != blockNumber) {
+    if (!fatCacheWrite(slot)) return 0;
+    fatCacheBlockNumber_[slot] = 0XFFFFFFFF;
+    if (!sdCard_->readBlock(blockNumber, fatCache_[slot].data)) return 0;
+    fatCacheBlockNumber_[slot] = blockNumber;
+  }
+  for (uint8_t i = 0; i < SD_FAT_CACHE_COUNT; i++) {
+    if (fatCacheAge_[i] < fatCacheAge_[slot]) fatCacheAge_[i]++;
+  }
+  fatCacheAge_[slot] = 0;
+  if (action) fatCacheDirty_ |= 1 << slot;
+  return &fatCache_[slot];
+}
+//------------------------------------------------------------------------------
+// write a FAT cache block if dirty, and its mirror in the second FAT
+uint8_t SdVolume::fatCacheWrite(uint8_t slot) {
+  if (fatCacheDirty_ & (1 << slot)) {
+    uint32_t lba = fatCacheBlockNumber_[slot];
+    if (!sdCard_->writeBlock(lba, fatCache_[slot].data)) return false;
+    if (fatMirrorOffset_) {
+      if (!sdCard_->writeBlock(lba + fatMirrorOffset_, fatCache_[slot].data)) {
+        return false;
+      }
+    }
+    fatCacheDirty_ &= ~(1 << slot);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+uint8_t SdVolume::fatCacheFlush(void) {
+  for (uint8_t i = 0; i < SD_FAT_CACHE_COUNT; i++) {
+    if (!fatCacheWrite(i)) return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
 // return the size in bytes of a cluster chain
 uint8_t SdVolume::chainSize(uint32_t cluster, uint32_t* size) const {
   uint32_t s = 0;
@@ -152,13 +203,12 @@ uint8_t SdVolume::fatGet(uint32_t cluster, uint32_t* value) const {
   if (cluster > (clusterCount_ + 1)) return false;
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return false;
-  }
+  cache_t* pc = fatCacheBlock(lba, CACHE_FOR_READ);
+  if (!pc) return false;
   if (fatType_ == 16) {
-    *value = cacheBuffer_.fat16[cluster & 0XFF];
+    *value = pc->fat16[cluster & 0XFF];
   } else {
-    *value = cacheBuffer_.fat32[cluster & 0X7F] & FAT32MASK;
+    *value = pc->fat32[cluster & 0X7F] & FAT32MASK;
   }
   return true;
 }
@@ -175,19 +225,14 @@ uint8_t SdVolume::fatPut(uint32_t cluster, uint32_t value) {
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
 
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return false;
-  }
-  // store entry
+  cache_t* pc = fatCacheBlock(lba, CACHE_FOR_WRITE);
+  if (!pc) return false;
+  // store entry, the second FAT is written along when flushed
   if (fatType_ == 16) {
-    cacheBuffer_.fat16[cluster & 0XFF] = value;
+    pc->fat16[cluster & 0XFF] = value;
   } else {
-    cacheBuffer_.fat32[cluster & 0X7F] = value;
+    pc->fat32[cluster & 0X7F] = value;
   }
-  cacheSetDirty();
-
-  // mirror second FAT
-  if (fatCount_ > 1) cacheMirrorBlock_ = lba + blocksPerFat_;
   return true;
 }
 //------------------------------------------------------------------------------
@@ -226,6 +271,13 @@ uint8_t SdVolume::freeChain(uint32_t cluster) {
  */
 uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
   uint32_t volumeStartBlock = 0;
+  // write the FAT blocks of the previous volume, then forget them
+  if (sdCard_) fatCacheFlush();
+  for (uint8_t i = 0; i < SD_FAT_CACHE_COUNT; i++) {
+    fatCacheBlockNumber_[i] = 0XFFFFFFFF;
+    fatCacheAge_[i] = i;
+  }
+  fatCacheDirty_ = 0;
   sdCard_ = dev;
   // if part == 0 assume super floppy with FAT boot sector in block zero
   // if part > 0 assume mbr volume with partition table
@@ -261,6 +313,7 @@ uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
   }
   blocksPerFat_ = bpb->sectorsPerFat16 ?
                     bpb->sectorsPerFat16 : bpb->sectorsPerFat32;
+  fatMirrorOffset_ = fatCount_ > 1 ? blocksPerFat_ : 0;
 
   fatStartBlock_ = volumeStartBlock + bpb->reservedSectorCount;
 
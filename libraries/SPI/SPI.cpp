@@ -42,6 +42,16 @@ typedef union {
 SPIClass::SPIClass() {
     useHwCs = false;
     pinSet = SPI_PINS_HSPI;
+    _head = NULL;
+    _tail = NULL;
+    _isrAttached = false;
+}
+
+inline void SPIClass::waitIdle() {
+    if(_head) {
+        flush();
+    }
+    while(SPI1CMD & SPIBUSY) {}
 }
 
 bool SPIClass::pins(int8_t sck, int8_t miso, int8_t mosi, int8_t ss)
@@ -87,6 +97,12 @@ void SPIClass::begin() {
 }
 
 void SPIClass::end() {
+    flush();
+    if(_isrAttached) {
+        ETS_SPI_INTR_DISABLE();
+        ETS_SPI_INTR_ATTACH(NULL, NULL);
+        _isrAttached = false;
+    }
     switch (pinSet) {
     case SPI_PINS_HSPI:
         pinMode(SCK, INPUT);
@@ -140,7 +156,7 @@ void SPIClass::setHwCs(bool use) {
 }
 
 void SPIClass::beginTransaction(SPISettings settings) {
-    while(SPI1CMD & SPIBUSY) {}
+    waitIdle();
     setFrequency(settings._clock);
     setBitOrder(settings._bitOrder);
     setDataMode(settings._dataMode);
@@ -292,7 +308,7 @@ inline void SPIClass::setDataBits(uint16_t bits) {
 }
 
 uint8_t SPIClass::transfer(uint8_t data) {
-    while(SPI1CMD & SPIBUSY) {}
+    waitIdle();
     // reset to 8Bit mode
     setDataBits(8);
     SPI1W0 = data;
@@ -324,7 +340,7 @@ uint16_t SPIClass::transfer16(uint16_t data) {
 }
 
 void SPIClass::write(uint8_t data) {
-    while(SPI1CMD & SPIBUSY) {}
+    waitIdle();
     // reset to 8Bit mode
     setDataBits(8);
     SPI1W0 = data;
@@ -337,7 +353,7 @@ void SPIClass::write16(uint16_t data) {
 }
 
 void SPIClass::write16(uint16_t data, bool msb) {
-    while(SPI1CMD & SPIBUSY) {}
+    waitIdle();
     // Set to 16Bits transfer
     setDataBits(16);
     if(msb) {
@@ -356,7 +372,7 @@ void SPIClass::write32(uint32_t data) {
 }
 
 void SPIClass::write32(uint32_t data, bool msb) {
-    while(SPI1CMD & SPIBUSY) {}
+    waitIdle();
     // Set to 32Bits transfer
     setDataBits(32);
     if(msb) {
@@ -374,43 +390,61 @@ void SPIClass::write32(uint32_t data, bool msb) {
 }
 
 /**
- * Note:
- *  data need to be aligned to 32Bit
- *  or you get an Fatal exception (9)
- * @param data uint8_t *
- * @param size uint32_t
+ * copies size bytes (up to 64) from data to words, with
+ * aligned loads even if data isn't aligned
  */
-void SPIClass::writeBytes(const uint8_t * data, uint32_t size) {
-    while(size) {
-        if(size > 64) {
-            writeBytes_(data, 64);
-            size -= 64;
-            data += 64;
-        } else {
-            writeBytes_(data, size);
-            size = 0;
+static void ICACHE_RAM_ATTR loadWords(uint32_t * dst, const uint8_t * data, uint8_t size) {
+    uint32_t dataSize = ((size + 3) / 4);
+    uint32_t offset = ((uint32_t) data) & 3;
+    if(!offset) {
+        const uint32_t * dataPtr = (const uint32_t *) data;
+        while(dataSize--) {
+            *dst++ = *dataPtr++;
         }
+        return;
+    }
+    const uint32_t * dataPtr = (const uint32_t *) (data - offset);
+    uint32_t shift = offset * 8;
+    uint32_t lo = *dataPtr++;
+    while(dataSize--) {
+        uint32_t hi = *dataPtr++;
+        *dst++ = (lo >> shift) | (hi << (32 - shift));
+        lo = hi;
     }
 }
 
-void SPIClass::writeBytes_(const uint8_t * data, uint8_t size) {
-    while(SPI1CMD & SPIBUSY) {}
-    // Set Bits to transfer
-    setDataBits(size * 8);
-
-    uint32_t * fifoPtr = (uint32_t*)&SPI1W0;
-    const uint32_t * dataPtr = (uint32_t*) data;
-    uint32_t dataSize = ((size + 3) / 4);
-
-    while(dataSize--) {
-        *fifoPtr = *dataPtr;
-        dataPtr++;
-        fifoPtr++;
+/**
+ * copies size bytes (up to 64) the FIFO received to in, aligned or not
+ */
+static void storeWords(uint8_t * in, uint8_t size) {
+    volatile uint32_t * fifoPtr = &SPI1W0;
+    if(!(((uint32_t) in) & 3)) {
+        uint32_t * dataPtr = (uint32_t *) in;
+        for(; size >= 4; size -= 4) {
+            *dataPtr++ = *fifoPtr++;
+        }
+        in = (uint8_t *) dataPtr;
+    } else {
+        for(; size >= 4; size -= 4) {
+            uint32_t data = *fifoPtr++;
+            memcpy(in, &data, 4);
+            in += 4;
+        }
+    }
+    if(size) {
+        uint32_t data = *fifoPtr;
+        memcpy(in, &data, size);
     }
+}
 
-    __sync_synchronize();
-    SPI1CMD |= SPIBUSY;
-    while(SPI1CMD & SPIBUSY) {}
+/**
+ * sends size bytes from data, which can be anywhere, 64 at a time:
+ * the next 64 are read while the ones before are sent
+ * @param data uint8_t *
+ * @param size uint32_t
+ */
+void SPIClass::writeBytes(const uint8_t * data, uint32_t size) {
+    transferBytes(data, NULL, size);
 }
 
 /**
@@ -421,7 +455,7 @@ void SPIClass::writeBytes_(const uint8_t * data, uint8_t size) {
 void SPIClass::writePattern(const uint8_t * data, uint8_t size, uint32_t repeat) {
     if(size > 64) return; //max Hardware FIFO
 
-    while(SPI1CMD & SPIBUSY) {}
+    waitIdle();
 
     uint32_t buffer[16];
     uint8_t *bufferPtr=(uint8_t *)&buffer;
@@ -490,63 +524,182 @@ void SPIClass::writePattern(const uint8_t * data, uint8_t size, uint32_t repeat)
 }
 
 /**
- * Note:
- *  in and out need to be aligned to 32Bit
- *  or you get an Fatal exception (9)
+ * out and in can be anywhere, either can be NULL. The next 64 bytes
+ * of out are read while the ones before are sent.
  * @param out uint8_t *
  * @param in  uint8_t *
  * @param size uint32_t
  */
 void SPIClass::transferBytes(const uint8_t * out, uint8_t * in, uint32_t size) {
+    waitIdle();
+
+    uint32_t chunk[16];
+    uint8_t chunkSize = (size > 64) ? 64 : size;
+    if(out) {
+        loadWords(chunk, out, chunkSize);
+    } else {
+        // no out data only read fill with dummy data!
+        memset(chunk, 0xFF, sizeof(chunk));
+    }
+    uint8_t lastSize = 0;
+
     while(size) {
-        if(size > 64) {
-            transferBytes_(out, in, 64);
-            size -= 64;
-            if(out) out += 64;
-            if(in) in += 64;
-        } else {
-            transferBytes_(out, in, size);
-            size = 0;
+        if(chunkSize != lastSize) {
+            setDataBits(chunkSize * 8);
+            lastSize = chunkSize;
+        }
+        volatile uint32_t * fifoPtr = &SPI1W0;
+        uint8_t dataSize = ((chunkSize + 3) / 4);
+        for(uint8_t i = 0; i < dataSize; i++) {
+            fifoPtr[i] = chunk[i];
+        }
+        __sync_synchronize();
+        SPI1CMD |= SPIBUSY;
+
+        uint8_t sent = chunkSize;
+        size -= sent;
+        if(size) {
+            chunkSize = (size > 64) ? 64 : size;
+            if(out) {
+                out += sent;
+                loadWords(chunk, out, chunkSize);
+            }
+        }
+        while(SPI1CMD & SPIBUSY) {}
+
+        if(in) {
+            storeWords(in, sent);
+            in += sent;
         }
     }
 }
 
-void SPIClass::transferBytes_(const uint8_t * out, uint8_t * in, uint8_t size) {
-    while(SPI1CMD & SPIBUSY) {}
-    // Set in/out Bits to transfer
-
+/**
+ * loads the next chunk of the transfer at the head of the queue
+ * into the FIFO and starts it
+ */
+void ICACHE_RAM_ATTR SPIClass::startChunk() {
+    SPITransfer * t = _head;
+    uint32_t size = t->size - t->_pos;
+    if(size > 64) {
+        size = 64;
+    }
     setDataBits(size * 8);
 
     volatile uint32_t * fifoPtr = &SPI1W0;
-    uint8_t dataSize = ((size + 3) / 4);
-
-    if(out) {
-        uint32_t * dataPtr = (uint32_t*) out;
+    uint32_t dataSize = ((size + 3) / 4);
+    if(!t->out) {
         while(dataSize--) {
-            *fifoPtr = *dataPtr;
-            dataPtr++;
-            fifoPtr++;
+            *fifoPtr++ = 0xFFFFFFFF;
         }
-    } else {
-        // no out data only read fill with dummy data!
+    } else if(t->outRepeat) {
+        uint32_t at = t->_pos % t->outRepeat;
         while(dataSize--) {
-            *fifoPtr = 0xFFFFFFFF;
-            fifoPtr++;
+            *fifoPtr++ = *(const uint32_t *) (t->out + at);
+            at += 4;
+            if(at >= t->outRepeat) {
+                at = 0;
+            }
+        }
+    } else {
+        uint32_t chunk[16];
+        loadWords(chunk, t->out + t->_pos, size);
+        for(uint32_t i = 0; i < dataSize; i++) {
+            fifoPtr[i] = chunk[i];
         }
     }
 
+    __sync_synchronize();
     SPI1CMD |= SPIBUSY;
-    while(SPI1CMD & SPIBUSY) {}
+}
+
+/**
+ * SPI interrupt: a chunk is done, read what came in and start
+ * the next one, of this transfer or the next queued
+ */
+void ICACHE_RAM_ATTR SPIClass::_isr(void * arg) {
+    if(!(SPIIR & (1 << SPII1))) {
+        return;
+    }
+    SPI1S &= ~SPISTRIS;
 
-    if(in) {
+    SPIClass * spi = (SPIClass *) arg;
+    SPITransfer * t = spi->_head;
+    if(!t) {
+        SPI1S &= ~SPISTRIE;
+        return;
+    }
+    uint32_t size = t->size - t->_pos;
+    if(size > 64) {
+        size = 64;
+    }
+    if(t->in) {
         volatile uint8_t * fifoPtr8 = (volatile uint8_t *) &SPI1W0;
-        dataSize = size;
-        while(dataSize--) {
-            *in = *fifoPtr8;
-            in++;
-            fifoPtr8++;
+        uint8_t * in = t->in + t->_pos;
+        for(uint32_t i = 0; i < size; i++) {
+            in[i] = fifoPtr8[i];
         }
     }
+    t->_pos += size;
+    if(t->_pos < t->size) {
+        spi->startChunk();
+        return;
+    }
+
+    spi->_head = t->_next;
+    if(!spi->_head) {
+        spi->_tail = NULL;
+    }
+    t->_queued = false;
+    t->_done = true;
+    if(t->onDone) {
+        t->onDone(t);
+    }
+    t = spi->_head;
+    if(t) {
+        if(t->onStart) {
+            t->onStart(t);
+        }
+        spi->startChunk();
+    } else {
+        SPI1S &= ~SPISTRIE;
+    }
+}
+
+bool SPIClass::queue(SPITransfer & transfer) {
+    if(transfer._queued || !transfer.size) {
+        return false;
+    }
+    transfer._next = NULL;
+    transfer._pos = 0;
+    transfer._done = false;
+    transfer._queued = true;
+
+    if(!_isrAttached) {
+        ETS_SPI_INTR_ATTACH(_isr, this);
+        _isrAttached = true;
+    }
+    ETS_SPI_INTR_DISABLE();
+    if(_tail) {
+        _tail->_next = &transfer;
+        _tail = &transfer;
+    } else {
+        _head = _tail = &transfer;
+        while(SPI1CMD & SPIBUSY) {}
+        SPI1S = (SPI1S & ~SPISTRIS) | SPISTRIE;
+        if(transfer.onStart) {
+            transfer.onStart(&transfer);
+        }
+        startChunk();
+    }
+    ETS_SPI_INTR_ENABLE();
+    return true;
+}
+
+void SPIClass::flush() {
+    while(_head) {
+        optimistic_yield(1000);
+    }
 }
 
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_SPI)
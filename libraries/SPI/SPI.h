@@ -50,6 +50,33 @@ public:
   uint8_t  _dataMode;
 };
 
+// A transfer for SPIClass::queue(). It and its buffers must stay valid
+// until done() is true. out and in can be anywhere, either may be NULL,
+// no out sends 0xff. With outRepeat, out must be 32 bit aligned.
+struct SPITransfer {
+  SPITransfer(const uint8_t * out = NULL, uint8_t * in = NULL, uint32_t size = 0)
+  : out(out), in(in), size(size), outRepeat(0), onStart(NULL), onDone(NULL), arg(NULL),
+    _next(NULL), _pos(0), _queued(false), _done(false) {}
+
+  bool done() const { return _done; }
+
+  const uint8_t * out;
+  uint8_t * in;
+  uint32_t size;
+  // if not 0, out holds this many bytes (a multiple of 4), sent over and over
+  uint32_t outRepeat;
+  // called from the interrupt before the first byte and after the last,
+  // to set chip select for example; must be ICACHE_RAM_ATTR and short
+  void (*onStart)(SPITransfer * transfer);
+  void (*onDone)(SPITransfer * transfer);
+  void * arg;
+
+  SPITransfer * volatile _next;
+  volatile uint32_t _pos;
+  volatile bool _queued;
+  volatile bool _done;
+};
+
 class SPIClass {
 public:
   SPIClass();
@@ -73,11 +100,24 @@ public:
   void writePattern(const uint8_t * data, uint8_t size, uint32_t repeat);
   void transferBytes(const uint8_t * out, uint8_t * in, uint32_t size);
   void endTransaction(void);
+
+  // runs the transfer after those queued before it, 64 bytes at a time
+  // from the interrupt, with the settings of the current transaction;
+  // false if it is already queued or empty. The other functions wait
+  // for the queue to empty first.
+  bool queue(SPITransfer & transfer);
+  bool busy() const { return _head != NULL; }
+  // waits for the queued transfers to end
+  void flush();
 private:
   bool useHwCs;
   uint8_t pinSet;
-  void writeBytes_(const uint8_t * data, uint8_t size);
-  void transferBytes_(const uint8_t * out, uint8_t * in, uint8_t size);
+  SPITransfer * volatile _head;
+  SPITransfer * volatile _tail;
+  bool _isrAttached;
+  inline void waitIdle();
+  void startChunk();
+  static void _isr(void * arg);
   inline void setDataBits(uint16_t bits);
 };
 
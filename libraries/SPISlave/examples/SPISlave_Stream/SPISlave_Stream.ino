@@ -0,0 +1,41 @@
+/*
+    SPI Slave stream demo sketch
+    Connect the SPI Master device as in the SPISlave_Test example.
+
+    Whatever the master writes is sent back to it. The master reads the
+    status register to pace itself:
+      - HSPI_SLAVE_STREAM_RX_FREE(status): 32 byte writes it may make
+      - HSPI_SLAVE_STREAM_TX_LEN(status): bytes its next read gets
+      - HSPI_SLAVE_STREAM_TX_FULL(status): full reads that may follow it
+    Between two transfers it leaves the slave a few microseconds to move
+    the data registers.
+*/
+
+#include "SPISlave.h"
+
+void setup() {
+  Serial.begin(115200);
+
+  // 2 KB each way
+  if (!SPISlave.beginStream(2048, 2048)) {
+    Serial.println("No memory for the buffers");
+  }
+}
+
+void loop() {
+  uint8_t buffer[256];
+  size_t len = SPISlave.availableForWrite();
+  if (len > sizeof(buffer)) {
+    len = sizeof(buffer);
+  }
+  len = SPISlave.read(buffer, len);
+  if (len) {
+    SPISlave.write(buffer, len);
+  }
+
+  static uint32_t lost = 0;
+  if (SPISlave.overflows() != lost) {
+    lost = SPISlave.overflows();
+    Serial.printf("%u writes of the master lost\n", lost);
+  }
+}
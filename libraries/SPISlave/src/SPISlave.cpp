@@ -72,6 +72,20 @@ void SPISlaveClass::begin()
     hspi_slave_onStatusSent(&_s_status_tx);
     hspi_slave_begin(4, this);
 }
+bool SPISlaveClass::beginStream(size_t rxSize, size_t txSize)
+{
+    end();
+    _rx_ring = new uint8_t[rxSize];
+    _tx_ring = new uint8_t[txSize];
+    hspi_slave_begin(4, this);
+    if(!hspi_slave_stream_begin(_rx_ring, rxSize, _tx_ring, txSize)) {
+        end();
+        return false;
+    }
+    hspi_slave_onStatus(&_s_status_rx);
+    hspi_slave_onStatusSent(&_s_status_tx);
+    return true;
+}
 void SPISlaveClass::end()
 {
     hspi_slave_onData(nullptr);
@@ -79,6 +93,30 @@ void SPISlaveClass::end()
     hspi_slave_onStatus(nullptr);
     hspi_slave_onStatusSent(nullptr);
     hspi_slave_end();
+    delete[] _rx_ring;
+    delete[] _tx_ring;
+    _rx_ring = NULL;
+    _tx_ring = NULL;
+}
+size_t SPISlaveClass::available()
+{
+    return hspi_slave_available();
+}
+size_t SPISlaveClass::read(uint8_t * data, size_t len)
+{
+    return hspi_slave_read(data, len);
+}
+size_t SPISlaveClass::availableForWrite()
+{
+    return hspi_slave_availableForWrite();
+}
+size_t SPISlaveClass::write(const uint8_t * data, size_t len)
+{
+    return hspi_slave_write(data, len);
+}
+uint32_t SPISlaveClass::overflows()
+{
+    return hspi_slave_overflows();
 }
 void SPISlaveClass::setData(uint8_t * data, size_t len)
 {
@@ -43,16 +43,32 @@ protected:
     static void _s_status_rx(void *arg, uint32_t data);
     static void _s_data_tx(void *arg);
     static void _s_status_tx(void *arg);
+    uint8_t * _rx_ring;
+    uint8_t * _tx_ring;
 public:
     SPISlaveClass()
         : _data_cb(NULL)
         , _status_cb(NULL)
         , _data_sent_cb(NULL)
         , _status_sent_cb(NULL)
+        , _rx_ring(NULL)
+        , _tx_ring(NULL)
     {}
     ~SPISlaveClass() {}
     void begin();
+    // Streams the data through ring buffers of these sizes (powers of 2)
+    // instead of the data callbacks, read() and write() reach them from
+    // loop(). The master reads the status register (which isn't set with
+    // setStatus() then) to know how much it may transfer back to back,
+    // see HSPI_SLAVE_STREAM_* in hspi_slave.h.
+    bool beginStream(size_t rxSize = 1024, size_t txSize = 1024);
     void end();
+    size_t available();
+    size_t read(uint8_t * data, size_t len);
+    size_t availableForWrite();
+    size_t write(const uint8_t * data, size_t len);
+    // writes of the master lost because the receive buffer was full
+    uint32_t overflows();
     void setData(uint8_t * data, size_t len);
     void setData(const char * data)
     {
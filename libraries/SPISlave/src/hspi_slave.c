@@ -21,6 +21,7 @@
 #include "hspi_slave.h"
 #include "esp8266_peri.h"
 #include "ets_sys.h"
+#include <string.h>
 
 static void (*_hspi_slave_rx_data_cb)(void * arg, uint8_t * data, uint8_t len) = NULL;
 static void (*_hspi_slave_tx_data_cb)(void * arg) = NULL;
@@ -28,6 +29,75 @@ static void (*_hspi_slave_rx_status_cb)(void * arg, uint32_t data) = NULL;
 static void (*_hspi_slave_tx_status_cb)(void * arg) = NULL;
 static uint8_t _hspi_slave_buffer[33];
 
+//the counters only grow, the ring positions are them masked
+typedef struct {
+    uint8_t *rx;
+    uint32_t rx_mask;
+    volatile uint32_t rx_in;            //moved by the interrupt, by 32
+    volatile uint32_t rx_out;
+    uint8_t *tx;
+    uint32_t tx_mask;
+    volatile uint32_t tx_in;
+    volatile uint32_t tx_out;           //moved by the interrupt
+    volatile uint8_t tx_loaded;         //bytes in the data registers
+    volatile uint32_t overflows;
+} hspi_slave_stream_t;
+
+static hspi_slave_stream_t _hspi_slave_stream;
+static volatile bool _hspi_slave_streaming = false;
+
+static void ICACHE_RAM_ATTR _hspi_slave_stream_status(void)
+{
+    hspi_slave_stream_t *s = &_hspi_slave_stream;
+    uint32_t rx_free = (s->rx_mask + 1 - (s->rx_in - s->rx_out)) / 32;
+    uint32_t tx_full = (s->tx_in - s->tx_out) / 32;
+    SPI1WS = ((rx_free > 0xff) ? 0xff : rx_free) | (s->tx_loaded << 8) | (((tx_full > 0xffff) ? 0xffff : tx_full) << 16);
+}
+
+//the next read of the master, a short one only if there is nothing more
+static void ICACHE_RAM_ATTR _hspi_slave_stream_load(void)
+{
+    hspi_slave_stream_t *s = &_hspi_slave_stream;
+    uint32_t queued = s->tx_in - s->tx_out;
+    uint32_t n = (queued < 32) ? queued : 32;
+    uint32_t i;
+    uint8_t wi = 8;
+    for(i=0; i<8; i++) {
+        uint32_t out = 0;
+        uint32_t b;
+        for(b=0; b<4 && (i<<2)+b < n; b++) {
+            out |= s->tx[(s->tx_out + (i<<2) + b) & s->tx_mask] << (b * 8);
+        }
+        SPI1W(wi) = out;
+        wi++;
+    }
+    s->tx_out += n;
+    s->tx_loaded = n;
+}
+
+static void ICACHE_RAM_ATTR _hspi_slave_stream_isr(uint32_t status)
+{
+    hspi_slave_stream_t *s = &_hspi_slave_stream;
+    if((status & SPISWBIS) != 0) {
+        if(s->rx_mask + 1 - (s->rx_in - s->rx_out) >= 32) {
+            //whole writes keep rx_in aligned
+            uint32_t *dst = (uint32_t *)(s->rx + (s->rx_in & s->rx_mask));
+            uint8_t i;
+            for(i=0; i<8; i++) {
+                dst[i] = SPI1W(i);
+            }
+            s->rx_in += 32;
+        } else {
+            s->overflows++;
+        }
+    }
+    if((status & SPISRBIS) != 0) {
+        s->tx_loaded = 0;
+        _hspi_slave_stream_load();
+    }
+    _hspi_slave_stream_status();
+}
+
 void ICACHE_RAM_ATTR _hspi_slave_isr_handler(void *arg)
 {
     uint32_t status;
@@ -42,6 +112,10 @@ void ICACHE_RAM_ATTR _hspi_slave_isr_handler(void *arg)
         SPI1S &= ~(0x1F);//clear interrupts
         SPI1S |= (0x3E0);//enable interrupts
 
+        if(_hspi_slave_streaming) {
+            _hspi_slave_stream_isr(status);
+            status &= ~(SPISRBIS | SPISWBIS);
+        }
         if((status & SPISRBIS) != 0 && (_hspi_slave_tx_data_cb)) {
             _hspi_slave_tx_data_cb(arg);
         }
@@ -99,6 +173,7 @@ void hspi_slave_begin(uint8_t status_len, void * arg)
 
 void hspi_slave_end()
 {
+  _hspi_slave_streaming = false;
   ETS_SPI_INTR_DISABLE();
   ETS_SPI_INTR_ATTACH(NULL, NULL);
 
@@ -157,3 +232,107 @@ void hspi_slave_onStatusSent(void (*txs_cb)(void *))
 {
     _hspi_slave_tx_status_cb = txs_cb;
 }
+
+bool hspi_slave_stream_begin(uint8_t *rx, size_t rx_size, uint8_t *tx, size_t tx_size)
+{
+    if(!rx || !tx || rx_size < 32 || tx_size < 32 || (rx_size & (rx_size - 1)) || (tx_size & (tx_size - 1))) {
+        return false;
+    }
+    hspi_slave_stream_t *s = &_hspi_slave_stream;
+    uint32_t saved = xt_rsil(15);
+    s->rx = rx;
+    s->rx_mask = rx_size - 1;
+    s->rx_in = 0;
+    s->rx_out = 0;
+    s->tx = tx;
+    s->tx_mask = tx_size - 1;
+    s->tx_in = 0;
+    s->tx_out = 0;
+    s->tx_loaded = 0;
+    s->overflows = 0;
+    _hspi_slave_stream_load();
+    _hspi_slave_stream_status();
+    _hspi_slave_streaming = true;
+    xt_wsr_ps(saved);
+    return true;
+}
+
+void hspi_slave_stream_end()
+{
+    _hspi_slave_streaming = false;
+}
+
+size_t hspi_slave_available()
+{
+    if(!_hspi_slave_streaming) {
+        return 0;
+    }
+    return _hspi_slave_stream.rx_in - _hspi_slave_stream.rx_out;
+}
+
+size_t hspi_slave_read(uint8_t *data, size_t len)
+{
+    hspi_slave_stream_t *s = &_hspi_slave_stream;
+    size_t used = hspi_slave_available();
+    if(len > used) {
+        len = used;
+    }
+    if(!len) {
+        return 0;
+    }
+    uint32_t pos = s->rx_out & s->rx_mask;
+    size_t first = s->rx_mask + 1 - pos;
+    if(first > len) {
+        first = len;
+    }
+    memcpy(data, s->rx + pos, first);
+    memcpy(data + first, s->rx, len - first);
+
+    uint32_t saved = xt_rsil(15);
+    s->rx_out += len;
+    _hspi_slave_stream_status();
+    xt_wsr_ps(saved);
+    return len;
+}
+
+size_t hspi_slave_availableForWrite()
+{
+    if(!_hspi_slave_streaming) {
+        return 0;
+    }
+    return _hspi_slave_stream.tx_mask + 1 - (_hspi_slave_stream.tx_in - _hspi_slave_stream.tx_out);
+}
+
+size_t hspi_slave_write(const uint8_t *data, size_t len)
+{
+    hspi_slave_stream_t *s = &_hspi_slave_stream;
+    size_t room = hspi_slave_availableForWrite();
+    if(len > room) {
+        len = room;
+    }
+    if(!len) {
+        return 0;
+    }
+    uint32_t pos = s->tx_in & s->tx_mask;
+    size_t first = s->tx_mask + 1 - pos;
+    if(first > len) {
+        first = len;
+    }
+    memcpy(s->tx + pos, data, first);
+    memcpy(s->tx, data + first, len - first);
+
+    uint32_t saved = xt_rsil(15);
+    s->tx_in += len;
+    //the master has read what there was, this is its next read
+    if(!s->tx_loaded) {
+        _hspi_slave_stream_load();
+    }
+    _hspi_slave_stream_status();
+    xt_wsr_ps(saved);
+    return len;
+}
+
+uint32_t hspi_slave_overflows()
+{
+    return _hspi_slave_stream.overflows;
+}
@@ -41,4 +41,26 @@ void hspi_slave_onDataSent(void (*txd_cb)(void *));
 void hspi_slave_onStatus(void (*rxs_cb)(void *, uint32_t));
 void hspi_slave_onStatusSent(void (*txs_cb)(void *));
 
+//Stream mode, after hspi_slave_begin(4, ...): the interrupt moves the data
+//registers to and from ring buffers (sizes powers of 2, at least 32), with
+//no callback in between, and keeps the status register for the master:
+//how many 32 byte writes it may make, how many bytes its next read gets
+//(0 to 32) and how many full 32 byte reads may follow that one. The data
+//callbacks and hspi_slave_setStatus() are not to be used meanwhile.
+#define HSPI_SLAVE_STREAM_RX_FREE(status)  ((status) & 0xff)
+#define HSPI_SLAVE_STREAM_TX_LEN(status)   (((status) >> 8) & 0xff)
+#define HSPI_SLAVE_STREAM_TX_FULL(status)  ((status) >> 16)
+
+bool hspi_slave_stream_begin(uint8_t *rx, size_t rx_size, uint8_t *tx, size_t tx_size);
+void hspi_slave_stream_end();
+
+//from loop(), they return how many bytes were taken
+size_t hspi_slave_available();
+size_t hspi_slave_read(uint8_t *data, size_t len);
+size_t hspi_slave_availableForWrite();
+size_t hspi_slave_write(const uint8_t *data, size_t len);
+
+//32 byte writes of the master dropped for want of room
+uint32_t hspi_slave_overflows();
+
 #endif
@@ -1,5 +1,5 @@
 /*
-  Servo.h - Interrupt driven Servo library for Esp8266 using timers
+  Servo.h - Interrupt driven Servo library for Esp8266 using timer1
   Copyright (c) 2015 Michael C. Miller. All right reserved.
 
   This library is free software; you can redistribute it and/or
@@ -23,12 +23,10 @@
 //   The servos are pulsed in the background using the value most recently
 //   written using the write() method.
 //
-//   This library uses timer0 and timer1.
-//   Note that timer0 may be repurposed when the first servo is attached.
-//
-//   Timers are seized as needed in groups of 12 servos - 24 servos use two
-//   timers, there are only two timers for the esp8266 so the support stops here
-//   The sequence used to sieze timers is defined in timers.h
+//   This library uses timer1, through the pulse frames of pwm_frames.h in the
+//   core, which it shares with analogWrite(): every 20ms all the servos
+//   start their pulse together and end it in the order of the widths, timed
+//   on the CPU cycle counter. Any pin from 0 to 16 can have a servo.
 //
 //   The methods are:
 //
@@ -58,15 +56,9 @@
 #define DEFAULT_PULSE_WIDTH  1500     // default pulse width when servo is attached
 #define REFRESH_INTERVAL    20000     // minumim time to refresh servos in microseconds 
 
-// NOTE: to maintain a strict refresh interval the user needs to not exceede 8 servos 
-#define SERVOS_PER_TIMER       12     // the maximum number of servos controlled by one timer 
-#define MAX_SERVOS   (ServoTimerSequence_COUNT  * SERVOS_PER_TIMER)
-
-#if defined(ESP8266)
-
-#include "esp8266/ServoTimers.h"
+#define MAX_SERVOS             17     // one on each of the pins 0 to 16
 
-#else
+#if !defined(ESP8266)
 
 #error "This library only supports esp8266 boards."
 
@@ -20,42 +20,26 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 
 #include <Arduino.h>
 #include <Servo.h>
-
+#include <pwm_frames.h>
 
 #define INVALID_SERVO         255     // flag indicating an invalid servo index
 
-const uint32_t c_CycleCompensation = 4;  // compensation us to trim adjust for digitalWrite delays
-
 #define INVALID_PIN           63    // flag indicating never attached servo
 
 struct ServoInfo  {
     uint8_t pin : 6;             // a pin number from 0 to 62, 63 reserved
     uint8_t isActive : 1;        // true if this channel is enabled, pin not pulsed if false
-    uint8_t isDetaching : 1;     // true if this channel is being detached, maintains pulse integrity
 };
 
 struct ServoState {
     ServoInfo info;
-    volatile uint16_t usPulse;
+    uint16_t usPulse;
 };
 
-#if !defined (SERVO_EXCLUDE_TIMER0)
-ServoTimer0 s_servoTimer0;
-#endif
-
-#if !defined (SERVO_EXCLUDE_TIMER1)
-ServoTimer1 s_servoTimer1;
-#endif
-
 static ServoState s_servos[MAX_SERVOS];     // static array of servo structures
 
 static uint8_t s_servoCount = 0;            // the total number of attached s_servos
 
-
-// inconvenience macros
-#define SERVO_INDEX_TO_TIMER(servoIndex) ((ServoTimerSequence)(servoIndex / SERVOS_PER_TIMER)) // returns the timer controlling this servo
-#define SERVO_INDEX(timerId, channel)  ((timerId * SERVOS_PER_TIMER) + channel)     // macro to access servo index by timer and channel
-
 // similiar to map but will have increased accuracy that provides a more
 // symetric api (call it and use result to reverse will provide the original value)
 // 
@@ -71,127 +55,6 @@ int improved_map(int value, int minIn, int maxIn, int minOut, int maxOut)
     return ((deltaIn * rangeOut * fixedDecimal) / (rangeIn) + fixedHalfDecimal) / fixedDecimal + minOut;
 }
 
-//------------------------------------------------------------------------------
-// Interrupt handler template method that takes a class that implements
-// a standard set of methods for the timer abstraction
-//------------------------------------------------------------------------------
-template <class T>
-static void Servo_Handler(T* timer) ICACHE_RAM_ATTR;
-
-template <class T>
-static void Servo_Handler(T* timer)
-{
-    uint8_t servoIndex;
-
-    // clear interrupt
-    timer->ResetInterrupt();
-
-    if (timer->isEndOfCycle()) {
-        timer->StartCycle();
-    }
-    else {
-        servoIndex = SERVO_INDEX(timer->timerId(), timer->getCurrentChannel());
-        if (servoIndex < s_servoCount && s_servos[servoIndex].info.isActive) {
-            // pulse this channel low if activated
-            digitalWrite(s_servos[servoIndex].info.pin, LOW);
-
-            if (s_servos[servoIndex].info.isDetaching) {
-                s_servos[servoIndex].info.isActive = false;
-                s_servos[servoIndex].info.isDetaching = false;
-            }
-        }
-        timer->nextChannel();
-    }
-
-    servoIndex = SERVO_INDEX(timer->timerId(), timer->getCurrentChannel());
-
-    if (servoIndex < s_servoCount &&
-        timer->getCurrentChannel() < SERVOS_PER_TIMER) {
-        timer->SetPulseCompare(timer->usToTicks(s_servos[servoIndex].usPulse) - c_CycleCompensation);
-
-        if (s_servos[servoIndex].info.isActive) {
-            if (s_servos[servoIndex].info.isDetaching) {
-                // it was active, reset state and leave low
-                s_servos[servoIndex].info.isActive = false;
-                s_servos[servoIndex].info.isDetaching = false;
-            }
-            else {
-                // its an active channel so pulse it high
-                digitalWrite(s_servos[servoIndex].info.pin, HIGH);
-            }
-        }
-    }
-    else {
-        if (!isTimerActive(timer->timerId())) {
-            // no active running channels on this timer, stop the ISR
-            finISR(timer->timerId());
-        }
-        else {
-            // finished all channels so wait for the refresh period to expire before starting over
-            // allow a few ticks to ensure the next match is not missed
-            uint32_t refreshCompare = timer->usToTicks(REFRESH_INTERVAL);
-            if ((timer->GetCycleCount() + c_CycleCompensation * 2) < refreshCompare) {
-                timer->SetCycleCompare(refreshCompare - c_CycleCompensation);
-            }
-            else {
-                // at least REFRESH_INTERVAL has elapsed
-                timer->SetCycleCompare(timer->GetCycleCount() + c_CycleCompensation * 2);
-            }
-        }
-
-        timer->setEndOfCycle();
-    }
-}
-
-static void handler0() ICACHE_RAM_ATTR;
-static void handler0()
-{
-    Servo_Handler<ServoTimer0>(&s_servoTimer0);
-}
-
-static void handler1() ICACHE_RAM_ATTR;
-static void handler1()
-{
-    Servo_Handler<ServoTimer1>(&s_servoTimer1);
-}
-
-static void initISR(ServoTimerSequence timerId)
-{
-#if !defined (SERVO_EXCLUDE_TIMER0)
-    if (timerId == ServoTimerSequence_Timer0)
-        s_servoTimer0.InitInterrupt(&handler0);
-#endif
-#if !defined (SERVO_EXCLUDE_TIMER1)
-    if (timerId == ServoTimerSequence_Timer1)
-        s_servoTimer1.InitInterrupt(&handler1);
-#endif
-}
-
-static void finISR(ServoTimerSequence timerId) ICACHE_RAM_ATTR;
-static void finISR(ServoTimerSequence timerId)
-{
-#if !defined (SERVO_EXCLUDE_TIMER0)
-    if (timerId == ServoTimerSequence_Timer0)
-        s_servoTimer0.StopInterrupt();
-#endif
-#if !defined (SERVO_EXCLUDE_TIMER1)
-    if (timerId == ServoTimerSequence_Timer1)
-        s_servoTimer1.StopInterrupt();
-#endif
-}
-
-// returns true if any servo is active on this timer
-static boolean isTimerActive(ServoTimerSequence timerId) ICACHE_RAM_ATTR;
-static boolean isTimerActive(ServoTimerSequence timerId)
-{
-    for (uint8_t channel = 0; channel < SERVOS_PER_TIMER; channel++) {
-        if (s_servos[SERVO_INDEX(timerId, channel)].info.isActive) {
-            return true;
-        }
-    }
-    return false;
-}
-
 //-------------------------------------------------------------------
 // Servo class methods
 
@@ -208,7 +71,6 @@ Servo::Servo()
         _maxUs = MAX_PULSE_WIDTH;
 
         s_servos[_servoIndex].info.isActive = false;
-        s_servos[_servoIndex].info.isDetaching = false;
         s_servos[_servoIndex].info.pin = INVALID_PIN;
     }
     else {
@@ -223,12 +85,11 @@ uint8_t Servo::attach(int pin)
 
 uint8_t Servo::attach(int pin, uint16_t minUs, uint16_t maxUs)
 {
-    ServoTimerSequence timerId;
-
-    if (_servoIndex < MAX_SERVOS) {
-        if (s_servos[_servoIndex].info.pin == INVALID_PIN) {
-            pinMode(pin, OUTPUT);       // set servo pin to output
-            digitalWrite(pin, LOW);
+    if (_servoIndex < MAX_SERVOS && pin >= 0 && pin < MAX_SERVOS) {
+        if (s_servos[_servoIndex].info.pin != pin) {
+            if (s_servos[_servoIndex].info.isActive) {
+                pwm_frame_write(s_servos[_servoIndex].info.pin, 0);
+            }
             s_servos[_servoIndex].info.pin = pin;
         }
 
@@ -238,21 +99,18 @@ uint8_t Servo::attach(int pin, uint16_t minUs, uint16_t maxUs)
         _maxUs = max((uint16_t)250, min((uint16_t)3000, maxUs));
         _minUs = max((uint16_t)200, min(_maxUs, minUs));
 
-        // initialize the timerId if it has not already been initialized
-        timerId = SERVO_INDEX_TO_TIMER(_servoIndex);
-        if (!isTimerActive(timerId)) {
-            initISR(timerId);
-        }
-        s_servos[_servoIndex].info.isDetaching = false;
-        s_servos[_servoIndex].info.isActive = true;  // this must be set after the check for isTimerActive
+        s_servos[_servoIndex].info.isActive = true;
+        pwm_frame_write(pin, s_servos[_servoIndex].usPulse);
     }
     return _servoIndex;
 }
 
 void Servo::detach()
 {
-    if (s_servos[_servoIndex].info.isActive) {
-        s_servos[_servoIndex].info.isDetaching = true;
+    if (_servoIndex < MAX_SERVOS && s_servos[_servoIndex].info.isActive) {
+        // the current pulse is sent whole
+        pwm_frame_write(s_servos[_servoIndex].info.pin, 0);
+        s_servos[_servoIndex].info.isActive = false;
     }
 }
 
@@ -277,6 +135,9 @@ void Servo::writeMicroseconds(int value)
         value = constrain(value, _minUs, _maxUs);
 
         s_servos[_servoIndex].usPulse = value;
+        if (s_servos[_servoIndex].info.isActive) {
+            pwm_frame_write(s_servos[_servoIndex].info.pin, value);
+        }
     }
 }
 
@@ -302,7 +163,7 @@ int Servo::readMicroseconds()
 
 bool Servo::attached()
 {
-    return s_servos[_servoIndex].info.isActive;
+    return _servoIndex < MAX_SERVOS && s_servos[_servoIndex].info.isActive;
 }
 
 #endif
@@ -23,6 +23,57 @@
 #include <TFTv2.h>
 #include <SPI.h>
 
+/* fills are sent from the SPI interrupt while the sketch goes on, the next */
+/* command waits for them to end                                            */
+static uint32_t fillPattern;
+static SPITransfer fillTransfer;
+
+static void ICACHE_RAM_ATTR fillDone(SPITransfer *)
+{
+    TFT_CS_HIGH;
+}
+
+static void fillPixels(INT16U color, unsigned long pixels)
+{
+    if(pixels == 0)
+    {
+        TFT_CS_HIGH;
+        return;
+    }
+    INT8U *pattern = (INT8U *)&fillPattern;
+    pattern[0] = color>>8;
+    pattern[1] = color&0xff;
+    pattern[2] = pattern[0];
+    pattern[3] = pattern[1];
+
+    fillTransfer.out = pattern;
+    fillTransfer.outRepeat = sizeof(fillPattern);
+    fillTransfer.size = pixels*2;
+    fillTransfer.onDone = fillDone;
+
+    TFT_DC_HIGH;
+    TFT_CS_LOW;
+    SPI.queue(fillTransfer);
+}
+
+/* to the window started, a FIFO load at a time, in the display's order     */
+static void pushPixels(const uint16_t *pixels, unsigned long count)
+{
+    INT8U chunk[64];
+    while(count)
+    {
+        INT8U n = count < sizeof(chunk)/2 ? count : sizeof(chunk)/2;
+        for(INT8U i=0; i<n; i++)
+        {
+            chunk[2*i] = pixels[i]>>8;
+            chunk[2*i+1] = pixels[i]&0xff;
+        }
+        SPI.writeBytes(chunk, n*2);
+        pixels += n;
+        count -= n;
+    }
+}
+
 
 void TFT::TFTinit (void)
 {
@@ -190,7 +241,6 @@ void TFT::setPage(INT16U StartPage,INT16U EndPage)
 void TFT::fillScreen(INT16U XL, INT16U XR, INT16U YU, INT16U YD, INT16U color)
 {
     unsigned long  XY=0;
-    unsigned long i=0;
 
     if(XL > XR)
     {
@@ -212,64 +262,28 @@ void TFT::fillScreen(INT16U XL, INT16U XR, INT16U YU, INT16U YD, INT16U color)
     XY = (XR-XL+1);
     XY = XY*(YD-YU+1);
 
-    Tft.setCol(XL,XR);
-    Tft.setPage(YU, YD);
-    Tft.sendCMD(0x2c);                                                  
-    
-    TFT_DC_HIGH;
-    TFT_CS_LOW;
-
-    INT8U Hcolor = color>>8;
-    INT8U Lcolor = color&0xff;
-    for(i=0; i < XY; i++)
-    {
-        SPI.transfer(Hcolor);
-        SPI.transfer(Lcolor);
-    }
-
-    TFT_CS_HIGH;
+    startWindow(XL, XR, YU, YD);
+    fillPixels(color, XY);
 }
 
 void TFT::fillScreen(void)
 {
-    Tft.setCol(0, 239);
-    Tft.setPage(0, 319);
-    Tft.sendCMD(0x2c);                                                  /* start to write to display ram */
-
-    TFT_DC_HIGH;
-    TFT_CS_LOW;
-    for(INT16U i=0; i<38400; i++)
-    {
-        SPI.transfer(0);
-        SPI.transfer(0);
-        SPI.transfer(0);
-        SPI.transfer(0);
-    }
-    TFT_CS_HIGH;
+    startWindow(0, 239, 0, 319);                                        /* start to write to display ram */
+    fillPixels(0, 240UL*320);
 }
 
 
 void TFT::setXY(INT16U poX, INT16U poY)
 {
-    setCol(poX, poX);
-    setPage(poY, poY);
-    sendCMD(0x2c);
+    startWindow(poX, poX, poY, poY);
+    TFT_CS_HIGH;
 }
 
 void TFT::setPixel(INT16U poX, INT16U poY,INT16U color)
 {
-
-    sendCMD(0x2A);                                                      /* Column Command address       */
-    sendData(poX);
-    sendData(poX);
-
-    sendCMD(0x2B);                                                      /* Column Command address       */
-    sendData(poY);
-    sendData(poY);
-    
-    sendCMD(0x2c);
-
-    sendData(color);
+    startWindow(poX, poX, poY, poY);
+    SPI.write16(color);
+    TFT_CS_HIGH;
 }
 
 void TFT::drawChar( INT8U ascii, INT16U poX, INT16U poY,INT16U size, INT16U fgcolor)
@@ -318,15 +332,22 @@ void TFT::fillRectangle(INT16U poX, INT16U poY, INT16U length, INT16U width, INT
 void  TFT::drawHorizontalLine( INT16U poX, INT16U poY,
 INT16U length,INT16U color)
 {
-    setCol(poX,poX + length);
-    setPage(poY,poY);
-    sendCMD(0x2c);
-    for(INT16U i=0; i<length; i++)
-    sendData(color);
+    startWindow(poX, poX + length, poY, poY);
+    fillPixels(color, length);
 }
 
 void TFT::drawLine( INT16U x0,INT16U y0,INT16U x1, INT16U y1,INT16U color)
 {
+    if(y0 == y1)                                                        /* in one go                    */
+    {
+        fillScreen(x0, x1, y0, y0, color);
+        return;
+    }
+    if(x0 == x1)
+    {
+        fillScreen(x0, x0, y0, y1, color);
+        return;
+    }
 
     int x = x1-x0;
     int y = y1-y0;
@@ -350,11 +371,8 @@ void TFT::drawLine( INT16U x0,INT16U y0,INT16U x1, INT16U y1,INT16U color)
 
 void TFT::drawVerticalLine( INT16U poX, INT16U poY, INT16U length,INT16U color)
 {
-    setCol(poX,poX);
-    setPage(poY,poY+length);
-    sendCMD(0x2c);
-    for(INT16U i=0; i<length; i++)
-    sendData(color);
+    startWindow(poX, poX, poY, poY + length);
+    fillPixels(color, length);
 }
 
 void TFT::drawRectangle(INT16U poX, INT16U poY, INT16U length, INT16U width,INT16U color)
@@ -407,6 +425,125 @@ void TFT::drawTraingle( int poX1, int poY1, int poX2, int poY2, int poX3, int po
     drawLine(poX2, poY2, poX3, poY3,color);
 }
 
+void TFT::drawBitmap(INT16U poX, INT16U poY, INT16U length, INT16U width, const uint16_t *pixels, INT16U stride)
+{
+    if(length == 0 || width == 0)
+    {
+        return;
+    }
+    if(stride == 0)
+    {
+        stride = length;
+    }
+    startWindow(poX, poX + length - 1, poY, poY + width - 1);
+    if(stride == length)
+    {
+        pushPixels(pixels, (unsigned long)length*width);
+    }
+    else
+    {
+        for(INT16U i=0; i<width; i++)
+        {
+            pushPixels(pixels, length);
+            pixels += stride;
+        }
+    }
+    TFT_CS_HIGH;
+}
+
+void TFT::markDirty(INT16U poX, INT16U poY, INT16U length, INT16U width)
+{
+    if(length == 0 || width == 0 || poX > MAX_X || poY > MAX_Y)
+    {
+        return;
+    }
+    Rect add = {poX, (INT16U)min((unsigned)poX + length - 1, (unsigned)MAX_X),
+                poY, (INT16U)min((unsigned)poY + width - 1, (unsigned)MAX_Y)};
+
+    /* anything it touches is taken in, which may touch more                */
+    for(INT8U i=0; i<dirtyCount; )
+    {
+        Rect &r = dirty[i];
+        if(add.XL <= r.XR + 1 && r.XL <= add.XR + 1 && add.YU <= r.YD + 1 && r.YU <= add.YD + 1)
+        {
+            add.XL = min(add.XL, r.XL);
+            add.XR = max(add.XR, r.XR);
+            add.YU = min(add.YU, r.YU);
+            add.YD = max(add.YD, r.YD);
+            dirty[i] = dirty[--dirtyCount];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    if(dirtyCount == TFT_DIRTY_RECTS)
+    {
+        /* full, it goes with the one that grows the least                  */
+        INT8U best = 0;
+        unsigned long bestGrowth = ~0UL;
+        for(INT8U i=0; i<dirtyCount; i++)
+        {
+            Rect &r = dirty[i];
+            unsigned long area = (unsigned long)(max(add.XR, r.XR) - min(add.XL, r.XL) + 1)
+                               * (max(add.YD, r.YD) - min(add.YU, r.YU) + 1);
+            unsigned long growth = area - (unsigned long)(r.XR - r.XL + 1)*(r.YD - r.YU + 1);
+            if(growth < bestGrowth)
+            {
+                best = i;
+                bestGrowth = growth;
+            }
+        }
+        Rect r = dirty[best];
+        dirty[best] = dirty[--dirtyCount];
+        markDirty(min(add.XL, r.XL), min(add.YU, r.YU),
+                  max(add.XR, r.XR) - min(add.XL, r.XL) + 1, max(add.YD, r.YD) - min(add.YU, r.YU) + 1);
+        return;
+    }
+    dirty[dirtyCount++] = add;
+}
+
+void TFT::updateDirty(TFTPixelSource source, void *arg)
+{
+    uint16_t pixels[32];
+    for(INT8U i=0; i<dirtyCount; i++)
+    {
+        Rect &r = dirty[i];
+        startWindow(r.XL, r.XR, r.YU, r.YD);
+        for(INT16U y=r.YU; y<=r.YD; y++)
+        {
+            for(INT16U x=r.XL; x<=r.XR; )
+            {
+                INT16U n = min((unsigned)(r.XR - x + 1), (unsigned)(sizeof(pixels)/sizeof(pixels[0])));
+                source(x, y, n, pixels, arg);
+                pushPixels(pixels, n);
+                x += n;
+            }
+        }
+        TFT_CS_HIGH;
+    }
+    dirtyCount = 0;
+}
+
+void TFT::updateDirty(const uint16_t *frame, INT16U frameX, INT16U frameY, INT16U frameLength, INT16U frameWidth)
+{
+    for(INT8U i=0; i<dirtyCount; i++)
+    {
+        Rect &r = dirty[i];
+        /* what is outside the frame is left alone                          */
+        int XL = max((int)r.XL, (int)frameX);
+        int XR = min((int)r.XR, (int)(frameX + frameLength) - 1);
+        int YU = max((int)r.YU, (int)frameY);
+        int YD = min((int)r.YD, (int)(frameY + frameWidth) - 1);
+        if(XL > XR || YU > YD)
+        {
+            continue;
+        }
+        drawBitmap(XL, YU, XR - XL + 1, YD - YU + 1,
+                   frame + (unsigned long)(YU - frameY)*frameLength + (XL - frameX), frameLength);
+    }
+    dirtyCount = 0;
+}
+
 INT8U TFT::drawNumber(long long_num,INT16U poX, INT16U poY,INT16U size,INT16U fgcolor)
 {
     INT8U char_buffer[10] = "";
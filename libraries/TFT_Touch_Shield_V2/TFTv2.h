@@ -111,6 +111,14 @@ Modified by Sermus for ESP8266
 #define FONT_X 8
 #define FONT_Y 8
 
+//regions kept apart by markDirty(), more are merged
+#ifndef TFT_DIRTY_RECTS
+#define TFT_DIRTY_RECTS 4
+#endif
+
+//gets length pixels of the row poY from poX on, for updateDirty()
+typedef void (*TFTPixelSource)(INT16U poX, INT16U poY, INT16U length, uint16_t *pixels, void *arg);
+
 
 extern INT8U simpleFont[][8];
 
@@ -119,12 +127,19 @@ class TFT
 
 private:
 
+    struct Rect
+    {
+        INT16U XL, XR, YU, YD;                                          /* inclusive                    */
+    };
 
+    Rect dirty[TFT_DIRTY_RECTS];
+    INT8U dirtyCount = 0;
 
 public:
 
     inline void sendCMD(INT8U index)
     {
+        SPI.flush();                                                    /* a fill may still be running  */
         TFT_DC_LOW;
         TFT_CS_LOW;
         SPI.transfer(index);
@@ -133,6 +148,7 @@ public:
 
     inline void WRITE_DATA(INT8U data)
     {
+        SPI.flush();
         TFT_DC_HIGH;
         TFT_CS_LOW;
         SPI.transfer(data);
@@ -143,6 +159,7 @@ public:
     {
         INT8U data1 = data>>8;
         INT8U data2 = data&0xff;
+        SPI.flush();
         TFT_DC_HIGH;
         TFT_CS_LOW;
         SPI.transfer(data1);
@@ -150,11 +167,32 @@ public:
         TFT_CS_HIGH;
     }
 
+    /* sets the window and starts writing to it, the pixels come next       */
+    void startWindow(INT16U XL,INT16U XR,INT16U YU,INT16U YD)
+    {
+        SPI.flush();
+        TFT_CS_LOW;                                                     /* once for the three commands  */
+        TFT_DC_LOW;
+        SPI.write(0x2A);
+        TFT_DC_HIGH;
+        SPI.write16(XL);
+        SPI.write16(XR);
+        TFT_DC_LOW;
+        SPI.write(0x2B);
+        TFT_DC_HIGH;
+        SPI.write16(YU);
+        SPI.write16(YD);
+        TFT_DC_LOW;
+        SPI.write(0x2c);
+        TFT_DC_HIGH;
+    }
+
     void WRITE_Package(INT16U *data, INT8U howmany)
     {
         INT16U  data1 = 0;
         INT8U   data2 = 0;
 
+        SPI.flush();
         TFT_DC_HIGH;
         TFT_CS_LOW;
         INT8U count=0;
@@ -206,6 +244,19 @@ public:
     void fillCircle(int poX, int poY, int r,INT16U color);
 	
 	void drawTraingle(int poX1, int poY1, int poX2, int poY2, int poX3, int poY3, INT16U color);
+
+    /* RGB565 pixels, row after row, stride apart (0 for length)            */
+    void drawBitmap(INT16U poX, INT16U poY, INT16U length, INT16U width, const uint16_t *pixels, INT16U stride = 0);
+
+    /* Partial updates: the sketch marks what it changed, length by width   */
+    /* pixels, and updateDirty() sends only that, then forgets it           */
+    void markDirty(INT16U poX, INT16U poY, INT16U length, INT16U width);
+    bool isDirty(void) const { return dirtyCount != 0; }
+    void clearDirty(void) { dirtyCount = 0; }
+    void updateDirty(TFTPixelSource source, void *arg = NULL);
+    /* from a frame of the sketch, frameLength by frameWidth pixels shown   */
+    /* at frameX, frameY                                                    */
+    void updateDirty(const uint16_t *frame, INT16U frameX, INT16U frameY, INT16U frameLength, INT16U frameWidth);
     
     INT8U drawNumber(long long_num,INT16U poX, INT16U poY,INT16U size,INT16U fgcolor);
     INT8U drawFloat(float floatNumber,INT8U decimal,INT16U poX, INT16U poY,INT16U size,INT16U fgcolor);
@@ -107,7 +107,7 @@ void bmpdraw(File f, int x, int y) {
       uint8_t buffidx = 0;
       int offset_x = j * BUFFPIXEL;
 
-      unsigned int __color[BUFFPIXEL];
+      uint16_t __color[BUFFPIXEL];
 
       for (int k = 0; k < BUFFPIXEL; k++) {
         __color[k] = sdbuffer[buffidx + 2] >> 3;                    // read
@@ -117,19 +117,7 @@ void bmpdraw(File f, int x, int y) {
         buffidx += 3;
       }
 
-      Tft.setCol(offset_x, offset_x + BUFFPIXEL);
-      Tft.setPage(i, i);
-      Tft.sendCMD(0x2c);
-
-      TFT_DC_HIGH;
-      TFT_CS_LOW;
-
-      for (int m = 0; m < BUFFPIXEL; m++) {
-        SPI.transfer(__color[m] >> 8);
-        SPI.transfer(__color[m]);
-      }
-
-      TFT_CS_HIGH;
+      Tft.drawBitmap(offset_x, i, BUFFPIXEL, 1, __color);
     }
 
   }
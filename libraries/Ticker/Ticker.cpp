@@ -31,9 +31,15 @@ static const int ONCE   = 0;
 static const int REPEAT = 1;
 
 #include "Ticker.h"
+#include "Schedule.h"
 
 Ticker::Ticker()
 : _timer(nullptr)
+, _callback(nullptr)
+, _arg(0)
+, _handle(0)
+, _repeat(false)
+, _dispatch(TIMER)
 {
 }
 
@@ -44,6 +50,26 @@ Ticker::~Ticker()
 
 void Ticker::_attach_ms(uint32_t milliseconds, bool repeat, callback_with_arg_t callback, uint32_t arg)
 {
+	if (_dispatch == SCHEDULED)
+	{
+		detach();
+		_callback = callback;
+		_arg = arg;
+		_repeat = repeat;
+		// only this in the lambda, which std::function keeps without allocating
+		if (repeat)
+			_handle = schedule_recurrent_function_us(milliseconds * 1000, [this]() { _runScheduled(); });
+		else
+			_handle = schedule_delayed_function(milliseconds * 1000, [this]() { _runScheduled(); });
+		return;
+	}
+
+	if (_handle)
+	{
+		schedule_cancel(_handle);
+		_handle = 0;
+	}
+
 	if (_timer)
 	{
 		os_timer_disarm(_timer);
@@ -57,8 +83,21 @@ void Ticker::_attach_ms(uint32_t milliseconds, bool repeat, callback_with_arg_t
 	os_timer_arm(_timer, milliseconds, (repeat)?REPEAT:ONCE);
 }
 
+void Ticker::_runScheduled()
+{
+	if (!_repeat)
+		_handle = 0;
+	_callback(reinterpret_cast<void*>(_arg));
+}
+
 void Ticker::detach()
 {
+	if (_handle)
+	{
+		schedule_cancel(_handle);
+		_handle = 0;
+	}
+
 	if (!_timer)
 		return;
 
@@ -69,5 +108,5 @@ void Ticker::detach()
 
 bool Ticker::active()
 {
-	return (bool)_timer;
+	return _timer || _handle;
 }
@@ -38,6 +38,12 @@ public:
 	typedef void (*callback_t)(void);
 	typedef void (*callback_with_arg_t)(void*);
 
+	enum dispatch_t
+	{
+		TIMER,
+		SCHEDULED
+	};
+
 	void attach(float seconds, callback_t callback)
 	{
 		_attach_ms(seconds * 1000, true, reinterpret_cast<callback_with_arg_t>(callback), 0);
@@ -93,15 +99,30 @@ public:
 		_attach_ms(milliseconds, false, reinterpret_cast<callback_with_arg_t>(callback), arg32);
 	}
 
+	// Where the callback runs, from the next attach() or once() on: from
+	// the SDK timer, or with SCHEDULED from loop() as a timed function of
+	// Schedule.h. Then it may block, is coalesced with the other timed
+	// functions (schedule_set_coalesce_us()) and keeps time across
+	// WiFi.lightSleep(), but is late by as much as loop() takes. Periods
+	// are then limited to 2^32 us, about 71 minutes.
+	void dispatch(dispatch_t how) { _dispatch = how; }
+
 	void detach();
 	bool active();
 
 protected:	
 	void _attach_ms(uint32_t milliseconds, bool repeat, callback_with_arg_t callback, uint32_t arg);
+	void _runScheduled();
 
 
 protected:
 	ETSTimer* _timer;
+	// SCHEDULED only
+	callback_with_arg_t _callback;
+	uint32_t _arg;
+	uint32_t _handle;
+	bool _repeat;
+	dispatch_t _dispatch;
 };
 
 
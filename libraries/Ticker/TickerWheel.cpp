@@ -0,0 +1,282 @@
+/*
+  TickerWheel.cpp - many Tickers on one SDK timer
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include <Schedule.h>
+
+#include "c_types.h"
+#include "eagle_soc.h"
+#include "ets_sys.h"
+#include "osapi.h"
+
+#include "TickerWheel.h"
+
+TickerWheel::TickerWheel(uint32_t resolution_ms)
+: _resolution(resolution_ms ? resolution_ms : 1)
+, _timer(nullptr)
+, _now(0)
+, _nowMs(0)
+, _count(0)
+, _scheduled(false)
+, _expired(nullptr)
+, _due(nullptr)
+{
+	memset(_slots0, 0, sizeof(_slots0));
+	memset(_slots, 0, sizeof(_slots));
+}
+
+TickerWheel::~TickerWheel()
+{
+	if (_timer)
+	{
+		os_timer_disarm(_timer);
+		delete _timer;
+	}
+}
+
+TickerWheel& TickerWheel::global()
+{
+	static TickerWheel wheel;
+	return wheel;
+}
+
+// Puts ticker in the slot of its _expires: the first level when that is
+// less than 64 ticks away, else the level whose slots span it.
+void TickerWheel::_add(WheelTicker* ticker)
+{
+	uint32_t delta = ticker->_expires - _now;
+	WheelTicker** list;
+	if (delta < (1UL << L0_BITS))
+	{
+		list = &_slots0[ticker->_expires & ((1 << L0_BITS) - 1)];
+	}
+	else
+	{
+		int level = 0;
+		int shift = L0_BITS;
+		while (level < LEVELS - 1 && delta >= (1UL << (shift + LN_BITS)))
+		{
+			level++;
+			shift += LN_BITS;
+		}
+		list = &_slots[level][(ticker->_expires >> shift) & ((1 << LN_BITS) - 1)];
+	}
+	_link(list, ticker);
+	if (!_timer)
+	{
+		_timer = new ETSTimer;
+		_nowMs = millis();
+		os_timer_setfn(_timer, reinterpret_cast<ETSTimerFunc*>(_onTimer), this);
+		os_timer_arm(_timer, _resolution, 1);
+	}
+}
+
+void TickerWheel::_remove(WheelTicker* ticker)
+{
+	if (!ticker->_list)
+		return;
+	if (ticker->_prev)
+		ticker->_prev->_next = ticker->_next;
+	else
+		*ticker->_list = ticker->_next;
+	if (ticker->_next)
+		ticker->_next->_prev = ticker->_prev;
+	ticker->_next = nullptr;
+	ticker->_prev = nullptr;
+	ticker->_list = nullptr;
+	_count--;
+}
+
+void TickerWheel::_link(WheelTicker** list, WheelTicker* ticker)
+{
+	ticker->_prev = nullptr;
+	ticker->_next = *list;
+	if (*list)
+		(*list)->_prev = ticker;
+	*list = ticker;
+	ticker->_list = list;
+	_count++;
+}
+
+// Moves the tickers of the current slot of level down, where they are less
+// than one slot of level away.
+void TickerWheel::_cascade(int level)
+{
+	int shift = L0_BITS + level * LN_BITS;
+	WheelTicker** slot = &_slots[level][(_now >> shift) & ((1 << LN_BITS) - 1)];
+	WheelTicker* ticker = *slot;
+	*slot = nullptr;
+	while (ticker)
+	{
+		WheelTicker* next = ticker->_next;
+		ticker->_next = nullptr;
+		ticker->_prev = nullptr;
+		ticker->_list = nullptr;
+		_count--;
+		_add(ticker);
+		ticker = next;
+	}
+}
+
+void TickerWheel::_tick()
+{
+	_now++;
+	uint32_t index = _now & ((1 << L0_BITS) - 1);
+	for (int level = 0; index == 0 && level < LEVELS; level++)
+	{
+		_cascade(level);
+		index = (_now >> (L0_BITS + level * LN_BITS)) & ((1 << LN_BITS) - 1);
+	}
+
+	// taken off the slot first, so that the callbacks can attach tickers
+	// to it again, or detach the ones still to run
+	WheelTicker** slot = &_slots0[_now & ((1 << L0_BITS) - 1)];
+	_expired = *slot;
+	*slot = nullptr;
+	for (WheelTicker* ticker = _expired; ticker; ticker = ticker->_next)
+		ticker->_list = &_expired;
+
+	while (_expired)
+	{
+		WheelTicker* ticker = _expired;
+		_remove(ticker);
+		if (ticker->_dispatch == WheelTicker::SCHEDULED)
+		{
+			_link(&_due, ticker);
+			continue;
+		}
+		if (ticker->_period)
+		{
+			ticker->_expires += ticker->_period;
+			_add(ticker);
+		}
+		ticker->_run();
+	}
+}
+
+void TickerWheel::_runScheduled()
+{
+	_scheduled = false;
+	while (_due)
+	{
+		WheelTicker* ticker = _due;
+		_remove(ticker);
+		if (ticker->_period)
+		{
+			// late: skip the periods it missed
+			uint32_t late = _now - ticker->_expires;
+			ticker->_expires += (late / ticker->_period + 1) * ticker->_period;
+			_add(ticker);
+		}
+		ticker->_run();
+	}
+}
+
+void TickerWheel::_onTimer(void* arg)
+{
+	TickerWheel* wheel = reinterpret_cast<TickerWheel*>(arg);
+	// the SDK timer may come late: make up for the ticks it missed
+	uint32_t ms = millis();
+	while (ms - wheel->_nowMs >= wheel->_resolution)
+	{
+		wheel->_nowMs += wheel->_resolution;
+		wheel->_tick();
+	}
+	if (wheel->_due && !wheel->_scheduled)
+	{
+		wheel->_scheduled = schedule_function(_onScheduled, wheel);
+	}
+	if (wheel->_count == 0)
+	{
+		os_timer_disarm(wheel->_timer);
+		delete wheel->_timer;
+		wheel->_timer = nullptr;
+	}
+}
+
+void TickerWheel::_onScheduled(void* arg)
+{
+	reinterpret_cast<TickerWheel*>(arg)->_runScheduled();
+}
+
+WheelTicker::WheelTicker(TickerWheel& wheel)
+: _wheel(wheel)
+, _callbackWithArg(nullptr)
+, _arg(0)
+, _expires(0)
+, _period(0)
+, _dispatch(TIMER)
+, _next(nullptr)
+, _prev(nullptr)
+, _list(nullptr)
+{
+}
+
+WheelTicker::~WheelTicker()
+{
+	detach();
+}
+
+void WheelTicker::_attach_ms(uint32_t milliseconds, bool repeat, callback_function_t callback)
+{
+	_callback = callback;
+	_callbackWithArg = nullptr;
+	_arm(milliseconds, repeat);
+}
+
+void WheelTicker::_attach_ms(uint32_t milliseconds, bool repeat, callback_with_arg_t callback, uint32_t arg)
+{
+	_callback = nullptr;
+	_callbackWithArg = callback;
+	_arg = arg;
+	_arm(milliseconds, repeat);
+}
+
+void WheelTicker::_arm(uint32_t milliseconds, bool repeat)
+{
+	_wheel._remove(this);
+	uint32_t ticks = (milliseconds + _wheel._resolution / 2) / _wheel._resolution;
+	if (ticks == 0)
+		ticks = 1;
+	else if (ticks > TickerWheel::MAX_TICKS)
+		ticks = TickerWheel::MAX_TICKS;
+	_period = repeat ? ticks : 0;
+	_expires = _wheel._now + ticks;
+	_wheel._add(this);
+}
+
+void WheelTicker::_run()
+{
+	if (_callbackWithArg)
+		_callbackWithArg(reinterpret_cast<void*>(_arg));
+	else if (_callback)
+		_callback();
+}
+
+void WheelTicker::detach()
+{
+	_wheel._remove(this);
+	_period = 0;
+}
+
+bool WheelTicker::active()
+{
+	return _list != nullptr;
+}
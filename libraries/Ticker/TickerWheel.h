@@ -0,0 +1,182 @@
+/*
+  TickerWheel.h - many Tickers on one SDK timer
+
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TICKERWHEEL_H
+#define TICKERWHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <functional>
+
+extern "C" {
+	typedef struct _ETSTIMER_ ETSTimer;
+}
+
+class WheelTicker;
+
+// Every Ticker arms an SDK timer of its own, and the SDK keeps them in one
+// sorted list. A TickerWheel instead runs one SDK timer, every resolution
+// milliseconds while it has WheelTickers attached, and keeps those in a
+// hierarchical timer wheel: 64 slots for the next 64 ticks and three more
+// levels of 64 slots for the later ones, which move down a level as their
+// time comes closer. Attaching, detaching and running a WheelTicker takes
+// the same time however many there are. Delays are limited to 2^24 ticks,
+// about 4.6 hours at a 1 ms resolution.
+class TickerWheel
+{
+public:
+	TickerWheel(uint32_t resolution_ms = 1);
+	~TickerWheel();
+
+	uint32_t resolution() const { return _resolution; }
+
+	// the one WheelTickers use when none is given
+	static TickerWheel& global();
+
+protected:
+	friend class WheelTicker;
+
+	static const int L0_BITS = 6;
+	static const int LN_BITS = 6;
+	static const int LEVELS = 3;
+	static const uint32_t MAX_TICKS = (1UL << (L0_BITS + LEVELS * LN_BITS)) - 1;
+
+	void _add(WheelTicker* ticker);
+	void _link(WheelTicker** list, WheelTicker* ticker);
+	void _remove(WheelTicker* ticker);
+	void _cascade(int level);
+	void _tick();
+	void _runScheduled();
+	static void _onTimer(void* arg);
+	static void _onScheduled(void* arg);
+
+	uint32_t _resolution;
+	ETSTimer* _timer;
+	uint32_t _now;      // ticks done
+	uint32_t _nowMs;    // millis() of the last tick done
+	size_t _count;
+	bool _scheduled;    // _onScheduled() is queued
+	WheelTicker* _slots0[1 << L0_BITS];
+	WheelTicker* _slots[LEVELS][1 << LN_BITS];
+	WheelTicker* _expired;  // the ones due in this tick
+	WheelTicker* _due;      // due, waiting for schedule_function() to run them
+};
+
+// A Ticker on a TickerWheel. Besides the Ticker callbacks, it takes a
+// std::function: a function, a lambda capturing nothing or a pointer or
+// two, are kept inside it without allocating. The callback runs from the
+// SDK timer like a Ticker's, or with dispatch(WheelTicker::SCHEDULED) from
+// loop() through schedule_function(), where it may block.
+class WheelTicker
+{
+public:
+	typedef void (*callback_with_arg_t)(void*);
+	typedef std::function<void(void)> callback_function_t;
+
+	enum dispatch_t
+	{
+		TIMER,
+		SCHEDULED
+	};
+
+	WheelTicker(TickerWheel& wheel = TickerWheel::global());
+	~WheelTicker();
+
+	void attach(float seconds, callback_function_t callback)
+	{
+		_attach_ms(seconds * 1000, true, callback);
+	}
+
+	void attach_ms(uint32_t milliseconds, callback_function_t callback)
+	{
+		_attach_ms(milliseconds, true, callback);
+	}
+
+	template<typename TArg>
+	void attach(float seconds, void (*callback)(TArg), TArg arg)
+	{
+		static_assert(sizeof(TArg) <= sizeof(uint32_t), "attach() callback argument size must be <= 4 bytes");
+		uint32_t arg32 = (uint32_t)arg;
+		_attach_ms(seconds * 1000, true, reinterpret_cast<callback_with_arg_t>(callback), arg32);
+	}
+
+	template<typename TArg>
+	void attach_ms(uint32_t milliseconds, void (*callback)(TArg), TArg arg)
+	{
+		static_assert(sizeof(TArg) <= sizeof(uint32_t), "attach_ms() callback argument size must be <= 4 bytes");
+		uint32_t arg32 = (uint32_t)arg;
+		_attach_ms(milliseconds, true, reinterpret_cast<callback_with_arg_t>(callback), arg32);
+	}
+
+	void once(float seconds, callback_function_t callback)
+	{
+		_attach_ms(seconds * 1000, false, callback);
+	}
+
+	void once_ms(uint32_t milliseconds, callback_function_t callback)
+	{
+		_attach_ms(milliseconds, false, callback);
+	}
+
+	template<typename TArg>
+	void once(float seconds, void (*callback)(TArg), TArg arg)
+	{
+		static_assert(sizeof(TArg) <= sizeof(uint32_t), "attach() callback argument size must be <= 4 bytes");
+		uint32_t arg32 = (uint32_t)(arg);
+		_attach_ms(seconds * 1000, false, reinterpret_cast<callback_with_arg_t>(callback), arg32);
+	}
+
+	template<typename TArg>
+	void once_ms(uint32_t milliseconds, void (*callback)(TArg), TArg arg)
+	{
+		static_assert(sizeof(TArg) <= sizeof(uint32_t), "attach_ms() callback argument size must be <= 4 bytes");
+		uint32_t arg32 = (uint32_t)(arg);
+		_attach_ms(milliseconds, false, reinterpret_cast<callback_with_arg_t>(callback), arg32);
+	}
+
+	// where the callback runs, from the next time on
+	void dispatch(dispatch_t how) { _dispatch = how; }
+
+	void detach();
+	bool active();
+
+protected:
+	friend class TickerWheel;
+
+	void _attach_ms(uint32_t milliseconds, bool repeat, callback_function_t callback);
+	void _attach_ms(uint32_t milliseconds, bool repeat, callback_with_arg_t callback, uint32_t arg);
+	void _arm(uint32_t milliseconds, bool repeat);
+	void _run();
+
+	TickerWheel& _wheel;
+	callback_function_t _callback;
+	callback_with_arg_t _callbackWithArg;
+	uint32_t _arg;
+	uint32_t _expires;  // in ticks of the wheel
+	uint32_t _period;   // 0 for once
+	dispatch_t _dispatch;
+	// in one of the lists of the wheel, doubly linked so that leaving it is cheap
+	WheelTicker* _next;
+	WheelTicker* _prev;
+	WheelTicker** _list;
+};
+
+#endif//TICKERWHEEL_H
@@ -51,6 +51,8 @@ uint8_t TwoWire::txBufferLength = 0;
 uint8_t TwoWire::transmitting = 0;
 void (*TwoWire::user_onRequest)(void);
 void (*TwoWire::user_onReceive)(int);
+void (*TwoWire::user_onAsyncDone)(uint8_t);
+uint8_t TwoWire::asyncRequested = 0;
 
 static int default_sda_pin = SDA;
 static int default_scl_pin = SCL;
@@ -78,11 +80,11 @@ void TwoWire::begin(void){
 }
 
 void TwoWire::begin(uint8_t address){
-  (void)address;
-  // twi_setAddress(address);
-  // twi_attachSlaveTxEvent(onRequestService);
-  // twi_attachSlaveRxEvent(onReceiveService);
+  twi_setAddress(address);
+  twi_attachSlaveTxEvent(onRequestService);
+  twi_attachSlaveRxEvent(onReceiveService);
   begin();
+  twi_enableSlaveMode();
 }
 
 uint8_t TwoWire::status(){
@@ -128,6 +130,10 @@ uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop){
 }
 
 void TwoWire::beginTransmission(uint8_t address){
+  while(twi_busy()){
+    // txBuffer may still be being sent
+    optimistic_yield(1000);
+  }
   transmitting = 1;
   txAddress = address;
   txBufferIndex = 0;
@@ -150,6 +156,53 @@ uint8_t TwoWire::endTransmission(void){
   return endTransmission(true);
 }
 
+void ICACHE_RAM_ATTR TwoWire::onAsyncDone(uint8_t status, void*){
+  if(asyncRequested){
+    rxBufferIndex = 0;
+    rxBufferLength = (status == 0)?asyncRequested:0;
+    asyncRequested = 0;
+  }
+  if(user_onAsyncDone){
+    user_onAsyncDone(status);
+  }
+}
+
+bool TwoWire::endTransmissionAsync(void (*callback)(uint8_t), bool sendStop){
+  if(twi_busy()){
+    return false;
+  }
+  user_onAsyncDone = callback;
+  asyncRequested = 0;
+  if(!twi_writeToAsync(txAddress, txBuffer, txBufferLength, sendStop, onAsyncDone, NULL)){
+    return false;
+  }
+  // txBuffer is sent from the interrupt, beginTransmission() waits for it
+  transmitting = 0;
+  return true;
+}
+
+bool TwoWire::requestFromAsync(uint8_t address, size_t size, void (*callback)(uint8_t), bool sendStop){
+  if(twi_busy() || size == 0){
+    return false;
+  }
+  if(size > BUFFER_LENGTH){
+    size = BUFFER_LENGTH;
+  }
+  user_onAsyncDone = callback;
+  rxBufferIndex = 0;
+  rxBufferLength = 0;
+  asyncRequested = size;
+  if(!twi_readFromAsync(address, rxBuffer, size, sendStop, onAsyncDone, NULL)){
+    asyncRequested = 0;
+    return false;
+  }
+  return true;
+}
+
+bool TwoWire::busy(){
+  return twi_busy();
+}
+
 size_t TwoWire::write(uint8_t data){
   if(transmitting){
     if(txBufferLength >= BUFFER_LENGTH){
@@ -160,7 +213,11 @@ size_t TwoWire::write(uint8_t data){
     ++txBufferIndex;
     txBufferLength = txBufferIndex;
   } else {
-    // i2c_slave_transmit(&data, 1);
+    // in an onRequest handler
+    if(twi_transmit(&data, 1)){
+      setWriteError();
+      return 0;
+    }
   }
   return 1;
 }
@@ -171,7 +228,10 @@ size_t TwoWire::write(const uint8_t *data, size_t quantity){
       if(!write(data[i])) return i;
     }
   }else{
-    // i2c_slave_transmit(data, quantity);
+    if(quantity > BUFFER_LENGTH || twi_transmit(data, quantity)){
+      setWriteError();
+      return 0;
+    }
   }
   return quantity;
 }
@@ -214,51 +274,47 @@ void TwoWire::flush(void){
 
 void TwoWire::onReceiveService(uint8_t* inBytes, int numBytes)
 {
-  (void)inBytes;
-  (void)numBytes;
   // don't bother if user hasn't registered a callback
-  // if(!user_onReceive){
-  //   return;
-  // }
-  // // don't bother if rx buffer is in use by a master requestFrom() op
-  // // i know this drops data, but it allows for slight stupidity
-  // // meaning, they may not have read all the master requestFrom() data yet
-  // if(rxBufferIndex < rxBufferLength){
-  //   return;
-  // }
-  // // copy twi rx buffer into local read buffer
-  // // this enables new reads to happen in parallel
-  // for(uint8_t i = 0; i < numBytes; ++i){
-  //   rxBuffer[i] = inBytes[i];
-  // }
-  // // set rx iterator vars
-  // rxBufferIndex = 0;
-  // rxBufferLength = numBytes;
-  // // alert user program
-  // user_onReceive(numBytes);
+  if(!user_onReceive){
+    return;
+  }
+  // don't bother if rx buffer is in use by a master requestFrom() op
+  // i know this drops data, but it allows for slight stupidity
+  // meaning, they may not have read all the master requestFrom() data yet
+  if(rxBufferIndex < rxBufferLength){
+    return;
+  }
+  // copy twi rx buffer into local read buffer
+  // this enables new reads to happen in parallel
+  for(uint8_t i = 0; i < numBytes; ++i){
+    rxBuffer[i] = inBytes[i];
+  }
+  // set rx iterator vars
+  rxBufferIndex = 0;
+  rxBufferLength = numBytes;
+  // alert user program
+  user_onReceive(numBytes);
 }
 
 void TwoWire::onRequestService(void){
-  // // don't bother if user hasn't registered a callback
-  // if(!user_onRequest){
-  //   return;
-  // }
-  // // reset tx buffer iterator vars
-  // // !!! this will kill any pending pre-master sendTo() activity
-  // txBufferIndex = 0;
-  // txBufferLength = 0;
-  // // alert user program
-  // user_onRequest();
+  // don't bother if user hasn't registered a callback
+  if(!user_onRequest){
+    return;
+  }
+  // reset tx buffer iterator vars
+  // !!! this will kill any pending pre-master sendTo() activity
+  txBufferIndex = 0;
+  txBufferLength = 0;
+  // alert user program
+  user_onRequest();
 }
 
 void TwoWire::onReceive( void (*function)(int) ){
-  (void)function;
-  //user_onReceive = function;
+  user_onReceive = function;
 }
 
 void TwoWire::onRequest( void (*function)(void) ){
-  (void)function;
-  //user_onRequest = function;
+  user_onRequest = function;
 }
 
 // Preinstantiate Objects //////////////////////////////////////////////////////
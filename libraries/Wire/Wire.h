@@ -48,6 +48,10 @@ class TwoWire : public Stream
     static void (*user_onReceive)(int);
     static void onRequestService(void);
     static void onReceiveService(uint8_t*, int);
+
+    static void (*user_onAsyncDone)(uint8_t);
+    static uint8_t asyncRequested;
+    static void onAsyncDone(uint8_t, void*);
   public:
     TwoWire();
     void begin(int sda, int scl);
@@ -64,6 +68,15 @@ class TwoWire : public Stream
     size_t requestFrom(uint8_t address, size_t size, bool sendStop);
 	uint8_t status();
 
+    // like endTransmission() and requestFrom(), but they return at once,
+    // false if a transaction is running. callback gets the status
+    // endTransmission() would return, 0 when requestFrom() read all bytes.
+    // It is called from the timer1 interrupt: it must be ICACHE_RAM_ATTR and
+    // short, and may start the next transaction.
+    bool endTransmissionAsync(void (*callback)(uint8_t), bool sendStop = true);
+    bool requestFromAsync(uint8_t address, size_t size, void (*callback)(uint8_t), bool sendStop = true);
+    bool busy();
+
     uint8_t requestFrom(uint8_t, uint8_t);
     uint8_t requestFrom(uint8_t, uint8_t, uint8_t);
     uint8_t requestFrom(int, int);
@@ -0,0 +1,283 @@
+/*
+ fs_bench.h - file system benchmark, shared by tests/device/test_FS and
+ tests/host/fs
+ Copyright © 2016 Ivan Grokhotkov
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef fs_bench_h
+#define fs_bench_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <FS.h>
+
+/*
+ Times open, exists, sequential and random reads, appends and rewrites
+ (which make SPIFFS collect garbage once it fills up) with the file system
+ empty, half and mostly full. Every operation at every fill level comes out
+ as one line of JSON:
+
+   {"bench":"fs","op":"read_random","fill":50,"n":64,"errors":0,
+    "p50_us":120,"p90_us":180,"p99_us":410,"max_us":410,
+    "flash_reads":130,"flash_read_bytes":33280,"flash_writes":0,
+    "flash_write_bytes":0,"flash_erases":0}
+
+ The flash_ counts are totals for the n operations, and only there when
+ counters() is given them (the host mock counts, the device doesn't). They
+ don't depend on how fast the machine is, so they are what to compare
+ between runs on the host.
+*/
+
+struct FsBenchCounters {
+    uint32_t reads;
+    uint32_t readBytes;
+    uint32_t writes;
+    uint32_t writeBytes;
+    uint32_t erases;
+};
+
+class FsBench
+{
+public:
+    typedef void (*Output)(const char* line);
+
+    FsBench(fs::FS& fs, Output output)
+        : _fs(fs), _output(output) { }
+    virtual ~FsBench() { }
+
+    // Formats the file system, then runs everything at each fill level.
+    // Returns false if the file system couldn't be set up or filled.
+    bool run()
+    {
+        if (!_fs.format()) {
+            return false;
+        }
+        for (size_t i = 0; i < sizeof(_pattern); ++i) {
+            _pattern[i] = 'a' + i % 26;
+        }
+        for (int i = 0; i < FILES; ++i) {
+            if (!_write(_name("/b/", i), 64)) {
+                return false;
+            }
+        }
+        if (!_write("/b/seq", SEQ_SIZE)) {
+            return false;
+        }
+        static const int fills[] = {0, 50, 80};
+        for (int fill : fills) {
+            if (!_fill(fill)) {
+                return false;
+            }
+            _runAll(fill);
+        }
+        return true;
+    }
+
+protected:
+    enum {
+        FILES = 16,
+        SAMPLES = 64,
+        READ_CHUNK = 256,
+        RANDOM_READ = 64,
+        APPEND = 64,
+        SEQ_SIZE = READ_CHUNK * SAMPLES,
+        FILLER_SIZE = 4096,
+        REWRITE_SIZE = 4096,
+    };
+
+    // Flash operations so far, false if there is no way to count them.
+    virtual bool counters(FsBenchCounters& counters)
+    {
+        (void) counters;
+        return false;
+    }
+
+    void _runAll(int fill)
+    {
+        uint32_t seed = 1;
+
+        _begin("open", fill);
+        for (int i = 0; i < SAMPLES; ++i) {
+            String name = _name("/b/", _random(seed) % FILES);
+            unsigned long start = micros();
+            File f = _fs.open(name, "r");
+            bool ok = f;
+            f.close();
+            _sample(start, ok);
+        }
+        _end();
+
+        _begin("exists_missing", fill);
+        for (int i = 0; i < SAMPLES; ++i) {
+            String name = _name("/m/", i);
+            unsigned long start = micros();
+            bool ok = !_fs.exists(name);
+            _sample(start, ok);
+        }
+        _end();
+
+        uint8_t buf[READ_CHUNK];
+        {
+            File f = _fs.open("/b/seq", "r");
+            _begin("read_seq", fill);
+            for (int i = 0; i < SAMPLES; ++i) {
+                unsigned long start = micros();
+                bool ok = f && f.read(buf, READ_CHUNK) == READ_CHUNK;
+                _sample(start, ok);
+            }
+            _end();
+
+            _begin("read_random", fill);
+            for (int i = 0; i < SAMPLES; ++i) {
+                uint32_t pos = _random(seed) % (SEQ_SIZE - RANDOM_READ);
+                unsigned long start = micros();
+                bool ok = f && f.seek(pos, fs::SeekSet) && f.read(buf, RANDOM_READ) == RANDOM_READ;
+                _sample(start, ok);
+            }
+            _end();
+        }
+
+        _begin("append", fill);
+        for (int i = 0; i < SAMPLES; ++i) {
+            unsigned long start = micros();
+            File f = _fs.open("/b/log", "a");
+            bool ok = f && f.write(_pattern, APPEND) == APPEND;
+            f.close();
+            _sample(start, ok);
+        }
+        _end();
+
+        _begin("rewrite", fill);
+        for (int i = 0; i < SAMPLES / 2; ++i) {
+            unsigned long start = micros();
+            bool ok = _write("/b/churn", REWRITE_SIZE);
+            _sample(start, ok);
+        }
+        _end();
+    }
+
+    bool _fill(int percent)
+    {
+        fs::FSInfo info;
+        if (!_fs.info(info)) {
+            return false;
+        }
+        while (info.usedBytes * 100 < info.totalBytes * percent) {
+            if (!_write(_name("/f/", _fillers++), FILLER_SIZE) || !_fs.info(info)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void _begin(const char* op, int fill)
+    {
+        _op = op;
+        _fillLevel = fill;
+        _count = 0;
+        _errors = 0;
+        _hasCounters = counters(_start);
+    }
+
+    void _sample(unsigned long start, bool ok)
+    {
+        unsigned long took = micros() - start;
+        if (!ok) {
+            ++_errors;
+        }
+        if (_count < SAMPLES) {
+            _samples[_count++] = took;
+        }
+    }
+
+    void _end()
+    {
+        qsort(_samples, _count, sizeof(_samples[0]), [](const void* a, const void* b) {
+            uint32_t x = *(const uint32_t*) a;
+            uint32_t y = *(const uint32_t*) b;
+            return (x > y) - (x < y);
+        });
+        char line[320];
+        int len = snprintf(line, sizeof(line),
+                           "{\"bench\":\"fs\",\"op\":\"%s\",\"fill\":%d,\"n\":%u,\"errors\":%u,"
+                           "\"p50_us\":%u,\"p90_us\":%u,\"p99_us\":%u,\"max_us\":%u",
+                           _op, _fillLevel, (unsigned) _count, (unsigned) _errors,
+                           (unsigned) _percentile(50), (unsigned) _percentile(90),
+                           (unsigned) _percentile(99), (unsigned) _percentile(100));
+        FsBenchCounters now;
+        if (_hasCounters && counters(now) && len > 0 && len < (int) sizeof(line)) {
+            snprintf(line + len, sizeof(line) - len,
+                     ",\"flash_reads\":%u,\"flash_read_bytes\":%u,\"flash_writes\":%u,"
+                     "\"flash_write_bytes\":%u,\"flash_erases\":%u}",
+                     (unsigned) (now.reads - _start.reads), (unsigned) (now.readBytes - _start.readBytes),
+                     (unsigned) (now.writes - _start.writes), (unsigned) (now.writeBytes - _start.writeBytes),
+                     (unsigned) (now.erases - _start.erases));
+        } else if (len > 0 && len < (int) sizeof(line) - 1) {
+            line[len] = '}';
+            line[len + 1] = 0;
+        }
+        _output(line);
+    }
+
+    uint32_t _percentile(int percent) const
+    {
+        if (_count == 0) {
+            return 0;
+        }
+        size_t index = (_count * percent + 99) / 100;
+        return _samples[index ? index - 1 : 0];
+    }
+
+    bool _write(const String& name, size_t size)
+    {
+        File f = _fs.open(name, "w");
+        if (!f) {
+            return false;
+        }
+        for (size_t done = 0; done < size; done += sizeof(_pattern)) {
+            size_t piece = (size - done < sizeof(_pattern)) ? size - done : sizeof(_pattern);
+            if (f.write(_pattern, piece) != piece) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static String _name(const char* dir, int index)
+    {
+        String name = dir;
+        name += index;
+        return name;
+    }
+
+    // the same sequence on every run and machine
+    static uint32_t _random(uint32_t& seed)
+    {
+        seed = seed * 1103515245u + 12345u;
+        return seed >> 8;
+    }
+
+    fs::FS& _fs;
+    Output _output;
+    const char* _op = nullptr;
+    int _fillLevel = 0;
+    size_t _count = 0;
+    size_t _errors = 0;
+    uint32_t _samples[SAMPLES];
+    uint8_t _pattern[READ_CHUNK];
+    FsBenchCounters _start;
+    bool _hasCounters = false;
+    int _fillers = 0;
+};
+
+#endif //fs_bench_h
@@ -1,6 +1,7 @@
 #include <ESP8266WiFi.h>
 #include "FS.h"
 #include <BSTest.h>
+#include "fs_bench.h"
 
 BS_ENV_DECLARE();
 
@@ -138,6 +139,18 @@ TEST_CASE("Can reopen empty file","[fs]")
     }
 }
 
+static void benchOutput(const char* line)
+{
+    Serial.println(line);
+}
+
+TEST_CASE("File system benchmark", "[fs][benchmark]")
+{
+    REQUIRE(SPIFFS.begin());
+    FsBench bench(SPIFFS, benchOutput);
+    CHECK(bench.run());
+}
+
 void loop()
 {
 }
@@ -0,0 +1,237 @@
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include <WiFiClientSecure.h>
+#include <ESP8266WebServer.h>
+#include <ESP8266mDNS.h>
+#include <BSTest.h>
+#include <test_config.h>
+#include <lwip/init.h>
+#include <lwip/opt.h>
+
+/*
+ Network benchmarks, driven by test_net_bench.py on the PC. Each test comes
+ out as one line of JSON in the test output, with the lwIP build it ran on
+ and the free heap once the test has released everything:
+
+   {"bench":"net","op":"tcp_rx","lwip":"2.0","mss":536,"bytes":1048576,
+    "ms":2210,"kbps":3795,"heap":38760}
+
+ The PC side appends its own lines (HTTP latencies and requests/s, as seen by
+ the client) to the file named by NET_BENCH_OUTPUT. `make bench` runs this
+ for every lwIP variant.
+*/
+
+BS_ENV_DECLARE();
+
+#define BENCH_TCP_PORT   5001
+#define BENCH_UDP_PORT   5002
+#define BENCH_TLS_PORT   8443
+#define BENCH_TCP_BYTES  (1024 * 1024)
+#define BENCH_TLS_ROUNDS 4
+
+static uint8_t buffer[TCP_MSS];
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial.setDebugOutput(true);
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(STA_SSID, STA_PASS);
+    while (WiFi.status() != WL_CONNECTED) {
+        delay(500);
+    }
+    MDNS.begin("etd");
+    BS_RUN(Serial);
+}
+
+static void benchLine(const char* op, const char* fields)
+{
+    Serial.printf("{\"bench\":\"net\",\"op\":\"%s\",\"lwip\":\"%d.%d\",\"mss\":%d,%s,\"heap\":%u}\n",
+                  op, LWIP_VERSION_MAJOR, LWIP_VERSION_MINOR, TCP_MSS, fields, ESP.getFreeHeap());
+}
+
+static WiFiClient waitClient(WiFiServer& server, uint32_t timeout_ms)
+{
+    uint32_t start = millis();
+    while (millis() - start < timeout_ms) {
+        WiFiClient client = server.available();
+        if (client) {
+            return client;
+        }
+        MDNS.update();
+        delay(1);
+    }
+    return WiFiClient();
+}
+
+static void tcpLine(const char* op, size_t bytes, uint32_t ms)
+{
+    char fields[64];
+    snprintf(fields, sizeof(fields), "\"bytes\":%u,\"ms\":%u,\"kbps\":%u",
+             (unsigned) bytes, ms, ms ? (uint32_t) ((uint64_t) bytes * 8 / ms) : 0);
+    benchLine(op, fields);
+}
+
+TEST_CASE("TCP receive throughput", "[net][benchmark]")
+{
+    WiFiServer server(BENCH_TCP_PORT);
+    server.begin();
+    WiFiClient client = waitClient(server, 15000);
+    REQUIRE(client);
+
+    size_t total = 0;
+    uint32_t start = millis();
+    uint32_t last = start;
+    while (total < BENCH_TCP_BYTES && millis() - last < 5000) {
+        size_t available = client.available();
+        if (available) {
+            total += client.read(buffer, std::min(available, sizeof(buffer)));
+            last = millis();
+        } else if (!client.connected()) {
+            break;
+        } else {
+            yield();
+        }
+    }
+    uint32_t ms = millis() - start;
+    client.stop();
+    server.stop();
+    tcpLine("tcp_rx", total, ms);
+    CHECK(total == BENCH_TCP_BYTES);
+}
+
+TEST_CASE("TCP send throughput", "[net][benchmark]")
+{
+    WiFiServer server(BENCH_TCP_PORT);
+    server.begin();
+    WiFiClient client = waitClient(server, 15000);
+    REQUIRE(client);
+
+    for (size_t i = 0; i < sizeof(buffer); ++i) {
+        buffer[i] = 'a' + i % 26;
+    }
+    size_t total = 0;
+    uint32_t start = millis();
+    while (total < BENCH_TCP_BYTES && client.connected()) {
+        size_t written = client.write(buffer, std::min(sizeof(buffer), (size_t) (BENCH_TCP_BYTES - total)));
+        if (!written) {
+            break;
+        }
+        total += written;
+    }
+    client.flush();
+    uint32_t ms = millis() - start;
+    client.stop();
+    server.stop();
+    tcpLine("tcp_tx", total, ms);
+    CHECK(total == BENCH_TCP_BYTES);
+}
+
+// The PC sends numbered datagrams as fast as it can for a few seconds
+TEST_CASE("UDP receive rate", "[net][benchmark]")
+{
+    WiFiUDP udp;
+    REQUIRE(udp.begin(BENCH_UDP_PORT));
+
+    uint32_t packets = 0;
+    uint32_t bytes = 0;
+    uint32_t maxSeq = 0;
+    uint32_t first = 0;
+    uint32_t last = millis();
+    bool started = false;
+    while (millis() - last < (started ? 2000 : 15000)) {
+        int size = udp.parsePacket();
+        if (size <= 0) {
+            yield();
+            continue;
+        }
+        last = millis();
+        if (!started) {
+            first = last;
+            started = true;
+        }
+        uint32_t seq = 0;
+        if (udp.read((uint8_t*) &seq, sizeof(seq)) == sizeof(seq) && seq > maxSeq) {
+            maxSeq = seq;
+        }
+        ++packets;
+        bytes += size;
+    }
+    udp.stop();
+    REQUIRE(packets);
+
+    // the PC numbers them from 1
+    uint32_t ms = last - first;
+    char fields[128];
+    snprintf(fields, sizeof(fields), "\"packets\":%u,\"sent\":%u,\"bytes\":%u,\"ms\":%u,\"pps\":%u",
+             packets, maxSeq, bytes, ms, ms ? (uint32_t) ((uint64_t) packets * 1000 / ms) : 0);
+    benchLine("udp_rx", fields);
+}
+
+// The first handshake is a full one, the others resume its session
+TEST_CASE("TLS handshake time", "[net][benchmark]")
+{
+    // one client for all rounds, its session cache goes with the last one
+    WiFiClientSecure client;
+    uint32_t times[BENCH_TLS_ROUNDS];
+    for (int i = 0; i < BENCH_TLS_ROUNDS; ++i) {
+        uint32_t start = millis();
+        uint32_t deadline = start + 15000;
+        bool connected = false;
+        // the PC side may still be starting up
+        while (!connected && (int32_t) (deadline - millis()) > 0) {
+            start = millis();
+            connected = client.connect(SERVER_IP, BENCH_TLS_PORT);
+        }
+        times[i] = millis() - start;
+        REQUIRE(connected);
+        client.stop();
+    }
+    uint32_t resumed = 0;
+    for (int i = 1; i < BENCH_TLS_ROUNDS; ++i) {
+        resumed += times[i];
+    }
+    char fields[96];
+    snprintf(fields, sizeof(fields), "\"full_ms\":%u,\"resumed_ms\":%u,\"rounds\":%d",
+             times[0], resumed / (BENCH_TLS_ROUNDS - 1), BENCH_TLS_ROUNDS);
+    benchLine("tls_handshake", fields);
+}
+
+// The PC measures the latencies, the device only counts and keeps an eye on
+// the heap; /done ends the test.
+TEST_CASE("HTTP server requests", "[net][benchmark]")
+{
+    ESP8266WebServer server(80);
+    uint32_t hits = 0;
+    bool done = false;
+    server.on("/bench", [&]() {
+        ++hits;
+        server.send(200, "text/plain", "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+    });
+    server.on("/done", [&]() {
+        server.send(200, "text/plain", "");
+        done = true;
+    });
+    server.setKeepAlive(true);
+    server.begin();
+
+    uint32_t minHeap = ESP.getFreeHeap();
+    uint32_t start = millis();
+    while (!done && millis() - start < 60000) {
+        server.handleClient();
+        MDNS.update();
+        minHeap = std::min(minHeap, ESP.getFreeHeap());
+    }
+    uint32_t ms = millis() - start;
+    server.close();
+    char fields[96];
+    snprintf(fields, sizeof(fields), "\"requests\":%u,\"ms\":%u,\"min_heap\":%u", hits, ms, minHeap);
+    benchLine("http_server", fields);
+    CHECK(done);
+}
+
+void loop()
+{
+}
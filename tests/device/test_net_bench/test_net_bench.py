@@ -0,0 +1,224 @@
+from mock_decorators import setup, teardown
+from threading import Thread
+import httplib
+import json
+import os
+import socket
+import ssl
+import struct
+import sys
+import time
+
+DEVICE = 'etd.local'
+TCP_PORT = 5001
+UDP_PORT = 5002
+TLS_PORT = 8443
+TCP_BYTES = 1024 * 1024
+UDP_SECONDS = 3
+UDP_SIZE = 512
+HTTP_REQUESTS = 200
+
+# lines of JSON go to the file named by NET_BENCH_OUTPUT, appended to, or to stderr
+def bench_line(fields):
+    line = json.dumps(fields, sort_keys=True)
+    path = os.environ.get('NET_BENCH_OUTPUT')
+    if path:
+        with open(path, 'a') as f:
+            f.write(line + '\n')
+    else:
+        print >>sys.stderr, line
+
+def device_address():
+    return socket.gethostbyname(DEVICE)
+
+# the device starts listening when its test begins, after setup
+def connect_device(port, timeout=15):
+    start = time.time()
+    while time.time() - start < timeout:
+        try:
+            return socket.create_connection((device_address(), port), 2)
+        except Exception:
+            time.sleep(0.2)
+    return None
+
+def percentile(values, p):
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+def run_thread(e, target):
+    e['thread'] = Thread(target=target)
+    e['thread'].start()
+
+def join_thread(e):
+    e['thread'].join()
+    return 0
+
+
+@setup('TCP receive throughput')
+def setup_tcp_rx(e):
+    def run():
+        sock = connect_device(TCP_PORT)
+        if not sock:
+            return
+        data = 'a' * 4096
+        sent = 0
+        while sent < TCP_BYTES:
+            sock.sendall(data[:TCP_BYTES - sent])
+            sent += min(len(data), TCP_BYTES - sent)
+        sock.close()
+    run_thread(e, run)
+
+@teardown('TCP receive throughput')
+def teardown_tcp_rx(e):
+    return join_thread(e)
+
+
+@setup('TCP send throughput')
+def setup_tcp_tx(e):
+    def run():
+        sock = connect_device(TCP_PORT)
+        if not sock:
+            return
+        sock.settimeout(10)
+        received = 0
+        start = time.time()
+        try:
+            while True:
+                data = sock.recv(65536)
+                if not data:
+                    break
+                received += len(data)
+        except socket.timeout:
+            pass
+        elapsed = time.time() - start
+        sock.close()
+        bench_line({'bench': 'net', 'op': 'tcp_tx_host', 'bytes': received,
+                    'ms': int(elapsed * 1000), 'kbps': int(received * 8 / elapsed / 1000) if elapsed else 0})
+    run_thread(e, run)
+
+@teardown('TCP send throughput')
+def teardown_tcp_tx(e):
+    return join_thread(e)
+
+
+@setup('UDP receive rate')
+def setup_udp_rx(e):
+    def run():
+        # give the device time to open its socket
+        time.sleep(2)
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        address = (device_address(), UDP_PORT)
+        padding = 'u' * (UDP_SIZE - 4)
+        seq = 0
+        start = time.time()
+        while time.time() - start < UDP_SECONDS:
+            seq += 1
+            try:
+                sock.sendto(struct.pack('<I', seq) + padding, address)
+            except socket.error:
+                # the host's queue is full, the device can't keep up anyway
+                time.sleep(0.001)
+        sock.close()
+        bench_line({'bench': 'net', 'op': 'udp_tx_host', 'packets': seq, 'size': UDP_SIZE,
+                    'ms': int((time.time() - start) * 1000)})
+    run_thread(e, run)
+
+@teardown('UDP receive rate')
+def teardown_udp_rx(e):
+    return join_thread(e)
+
+
+@setup('TLS handshake time')
+def setup_tls_handshake(e):
+    # the certificate of the HTTPS client test
+    p = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'test_http_client')
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(('0.0.0.0', TLS_PORT))
+    listener.listen(1)
+    listener.settimeout(1.0)
+    context = ssl.SSLContext(ssl.PROTOCOL_SSLv23)
+    context.load_cert_chain(os.path.join(p, 'server.crt'), os.path.join(p, 'server.key'))
+    # what axTLS speaks; the server side session cache is on by default
+    context.set_ciphers('AES128-SHA256:AES128-SHA:AES256-SHA256:AES256-SHA')
+    e['running'] = True
+    def run():
+        while e['running']:
+            try:
+                conn, address = listener.accept()
+            except socket.timeout:
+                continue
+            try:
+                tls = context.wrap_socket(conn, server_side=True)
+                tls.close()
+            except Exception as ex:
+                print >>sys.stderr, 'handshake failed:', ex
+                conn.close()
+        listener.close()
+    run_thread(e, run)
+
+@teardown('TLS handshake time')
+def teardown_tls_handshake(e):
+    e['running'] = False
+    return join_thread(e)
+
+
+def http_requests(keep_alive):
+    latencies = []
+    errors = 0
+    conn = None
+    start = time.time()
+    for i in range(HTTP_REQUESTS):
+        t = time.time()
+        try:
+            if not conn:
+                conn = httplib.HTTPConnection(device_address(), 80, timeout=5)
+            conn.request('GET', '/bench')
+            response = conn.getresponse()
+            response.read()
+            if response.status != 200:
+                errors += 1
+            if not keep_alive or response.getheader('connection', '').lower() == 'close':
+                conn.close()
+                conn = None
+        except Exception:
+            errors += 1
+            if conn:
+                conn.close()
+            conn = None
+            continue
+        latencies.append((time.time() - t) * 1000)
+    elapsed = time.time() - start
+    if conn:
+        conn.close()
+    bench_line({'bench': 'net', 'op': 'http_keepalive' if keep_alive else 'http_close',
+                'n': HTTP_REQUESTS, 'errors': errors,
+                'rps': int(len(latencies) / elapsed) if elapsed else 0,
+                'p50_ms': round(percentile(latencies, 50), 1),
+                'p90_ms': round(percentile(latencies, 90), 1),
+                'p99_ms': round(percentile(latencies, 99), 1),
+                'max_ms': round(max(latencies) if latencies else 0, 1)})
+
+@setup('HTTP server requests')
+def setup_http_server(e):
+    def run():
+        sock = connect_device(80)
+        if not sock:
+            return
+        sock.close()
+        http_requests(False)
+        http_requests(True)
+        try:
+            conn = httplib.HTTPConnection(device_address(), 80, timeout=5)
+            conn.request('GET', '/done')
+            conn.getresponse().read()
+            conn.close()
+        except Exception:
+            pass
+    run_thread(e, run)
+
+@teardown('HTTP server requests')
+def teardown_http_server(e):
+    return join_thread(e)
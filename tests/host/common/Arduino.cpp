@@ -19,11 +19,19 @@
 #include "Arduino.h"
 
 
+// 32 bits as on the device: code keeps the values in uint32_t
 extern "C" unsigned long millis()
 {
     timeval time;
     gettimeofday(&time, NULL);
-    return (time.tv_sec * 1000) + (time.tv_usec / 1000);
+    return (uint32_t) ((time.tv_sec * 1000) + (time.tv_usec / 1000));
+}
+
+extern "C" unsigned long micros()
+{
+    timeval time;
+    gettimeofday(&time, NULL);
+    return (uint32_t) ((time.tv_sec * 1000000) + time.tv_usec);
 }
 
 
@@ -31,6 +39,34 @@ extern "C" void yield()
 {
 }
 
+extern "C" void optimistic_yield(uint32_t interval_us)
+{
+}
+
+static uint32_t s_yield_budget_us[YIELD_OP_COUNT] = YIELD_BUDGET_DEFAULTS_US;
+
+extern "C" void yield_budget(yield_op_t op)
+{
+}
+
+extern "C" void yield_budget_set(yield_op_t op, uint32_t us)
+{
+    for (int i = 0; i < YIELD_OP_COUNT; ++i) {
+        if (op == YIELD_OP_ALL || op == i) {
+            s_yield_budget_us[i] = us;
+        }
+    }
+}
+
+extern "C" uint32_t yield_budget_get(yield_op_t op)
+{
+    return (op < YIELD_OP_COUNT) ? s_yield_budget_us[op] : 0;
+}
+
+extern "C" void yield_budget_auto(uint32_t target_us)
+{
+}
+
 
 extern "C" void __panic_func(const char* file, int line, const char* func) {
     abort();
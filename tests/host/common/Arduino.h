@@ -36,6 +36,7 @@ extern "C" {
 #include "binary.h"
 #include "twi.h"
 #include "core_esp8266_features.h"
+#include "yield_budget.h"
     
 #define HIGH 0x1
 #define LOW  0x0
@@ -153,8 +154,9 @@ extern "C" {
     // level 15 will disable ALL interrupts,
     // level 0 will enable ALL interrupts,
     //
-#define xt_rsil(level) (__extension__({uint32_t state; __asm__ __volatile__("rsil %0," __STRINGIFY(level) : "=a" (state)); state;}))
-#define xt_wsr_ps(state)  __asm__ __volatile__("wsr %0,ps; isync" :: "a" (state) : "memory")
+    // on the host there are no interrupts to hold
+#define xt_rsil(level) ((uint32_t) (level))
+#define xt_wsr_ps(state) ((void) (state))
     
 #define interrupts() xt_rsil(0)
 #define noInterrupts() xt_rsil(15)
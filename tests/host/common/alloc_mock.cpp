@@ -0,0 +1,97 @@
+/*
+ alloc_mock.cpp - heap allocation counters and failures for host side tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <stdlib.h>
+#include "alloc_mock.h"
+
+static AllocMock::Counters s_counters;
+static size_t s_failAbove;
+
+const AllocMock::Counters& AllocMock::counters()
+{
+    return s_counters;
+}
+
+void AllocMock::failAbove(size_t size)
+{
+    s_failAbove = size;
+}
+
+static bool refused(size_t size)
+{
+    return s_failAbove && size > s_failAbove;
+}
+
+#ifdef __GLIBC__
+
+// glibc exports its allocator under these names too, definitions of malloc
+// and friends in the program take the place of its own
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void __libc_free(void* ptr);
+
+    void* malloc(size_t size)
+    {
+        ++s_counters.allocs;
+        s_counters.allocBytes += size;
+        if (refused(size)) {
+            return nullptr;
+        }
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        ++s_counters.allocs;
+        s_counters.allocBytes += count * size;
+        if (refused(count * size)) {
+            return nullptr;
+        }
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size)
+    {
+        ++s_counters.allocs;
+        s_counters.allocBytes += size;
+        if (refused(size)) {
+            return nullptr;
+        }
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr)
+    {
+        if (ptr) {
+            ++s_counters.frees;
+        }
+        __libc_free(ptr);
+    }
+}
+
+bool AllocMock::available()
+{
+    return true;
+}
+
+#else
+
+bool AllocMock::available()
+{
+    return false;
+}
+
+#endif
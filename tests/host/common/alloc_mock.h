@@ -0,0 +1,41 @@
+/*
+ alloc_mock.h - heap allocation counters and failures for host side tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef alloc_mock_hpp
+#define alloc_mock_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+// malloc, calloc, realloc and free (and so new and delete) are counted for
+// the whole program; compare two snapshots around the code of interest.
+class AllocMock {
+public:
+    struct Counters {
+        uint64_t allocs;     // malloc, calloc and realloc calls
+        uint64_t allocBytes; // bytes asked for by these
+        uint64_t frees;      // free calls with a non null pointer
+    };
+
+    // false where the C library's allocator can't be wrapped, the counters
+    // stay 0 then
+    static bool available();
+    static const Counters& counters();
+
+    // from now on, allocations of more than size bytes fail; 0 lifts the
+    // limit again. Has no effect where available() is false.
+    static void failAbove(size_t size);
+};
+
+#endif /* alloc_mock_hpp */
@@ -0,0 +1,27 @@
+/*
+ c_types.h - the SDK's c_types.h on the host side, as far as core files
+ built for the host tests need it
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef c_types_mock_h
+#define c_types_mock_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ICACHE_FLASH_ATTR
+#define ICACHE_RAM_ATTR
+#define ICACHE_RODATA_ATTR
+
+#endif /* c_types_mock_h */
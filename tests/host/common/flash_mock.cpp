@@ -0,0 +1,56 @@
+/*
+ flash_mock.cpp - flash in RAM for the host tests of flash backed storage
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string.h>
+#include "flash_mock.h"
+
+bool RamFlash::read(uint32_t address, uint32_t* dst, size_t size)
+{
+    REQUIRE((address % 4) == 0);
+    REQUIRE((size % 4) == 0);
+    REQUIRE((address + size) <= data.size());
+    memcpy(dst, &data[address], size);
+    ++reads;
+    return true;
+}
+
+bool RamFlash::write(uint32_t address, const uint32_t* src, size_t size)
+{
+    REQUIRE((address % 4) == 0);
+    REQUIRE((size % 4) == 0);
+    REQUIRE((address + size) <= data.size());
+    const uint8_t* bytes = (const uint8_t*) src;
+    for (size_t i = 0; i < size; ++i) {
+        if (writeBudget == 0) {
+            return false;
+        }
+        if (writeBudget > 0) {
+            --writeBudget;
+        }
+        data[address + i] &= bytes[i];
+    }
+    return true;
+}
+
+bool RamFlash::erase(uint32_t sector)
+{
+    REQUIRE(sector < sectors());
+    if (writeBudget == 0) {
+        return false;
+    }
+    memset(&data[sector * SECTOR_SIZE], 0xff, SECTOR_SIZE);
+    ++erases;
+    return true;
+}
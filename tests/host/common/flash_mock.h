@@ -0,0 +1,70 @@
+/*
+ flash_mock.h - flash in RAM for the host tests of flash backed storage
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef flash_mock_hpp
+#define flash_mock_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// flash in RAM: writing only clears bits, and after writeBudget bytes
+// nothing more is written, as if the power went off
+class RamFlash
+{
+public:
+    enum { SECTOR_SIZE = 4096 };
+
+    RamFlash(size_t sectors) : data(sectors * SECTOR_SIZE, 0xff) { }
+
+    size_t sectors() const { return data.size() / SECTOR_SIZE; }
+
+    bool read(uint32_t address, uint32_t* dst, size_t size);
+    bool write(uint32_t address, const uint32_t* src, size_t size);
+    bool erase(uint32_t sector);
+
+    std::vector<uint8_t> data;
+    size_t erases = 0;
+    size_t reads = 0;
+    long writeBudget = -1;
+};
+
+// Store (EEPROMJournal, KeyValueStore...) on a RamFlash, starting at its
+// sector 0
+template<typename Store>
+class FlashMock : public Store
+{
+public:
+    FlashMock(RamFlash& flash) : Store(0, flash.sectors()), _flash(flash) { }
+
+protected:
+    bool _flashRead(uint32_t address, uint32_t* data, size_t size) override
+    {
+        return _flash.read(address, data, size);
+    }
+
+    bool _flashWrite(uint32_t address, const uint32_t* data, size_t size) override
+    {
+        return _flash.write(address, data, size);
+    }
+
+    bool _flashErase(uint32_t sector) override
+    {
+        return _flash.erase(sector);
+    }
+
+    RamFlash& _flash;
+};
+
+#endif /* flash_mock_hpp */
@@ -0,0 +1,48 @@
+/*
+ lwip/err.h - host mock of the lwIP basic types and error codes
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_err_mock_h
+#define lwip_err_mock_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t  u8_t;
+typedef int8_t   s8_t;
+typedef uint16_t u16_t;
+typedef int16_t  s16_t;
+typedef uint32_t u32_t;
+typedef int32_t  s32_t;
+
+typedef s8_t err_t;
+
+#define ERR_OK    0
+#define ERR_MEM  -1
+#define ERR_BUF  -2
+#define ERR_TIMEOUT -3
+#define ERR_RTE  -4
+#define ERR_INPROGRESS -5
+#define ERR_VAL  -6
+#define ERR_WOULDBLOCK -7
+#define ERR_USE  -8
+#define ERR_ALREADY -9
+#define ERR_ISCONN -10
+#define ERR_CONN -11
+#define ERR_IF   -12
+#define ERR_ABRT -13
+#define ERR_RST  -14
+#define ERR_CLSD -15
+#define ERR_ARG  -16
+
+#endif // lwip_err_mock_h
@@ -0,0 +1,22 @@
+/*
+ lwip/init.h - host mock, the lwIP version the core is built with
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_init_mock_h
+#define lwip_init_mock_h
+
+#define LWIP_VERSION_MAJOR 2
+#define LWIP_VERSION_MINOR 0
+#define LWIP_VERSION_REVISION 1
+
+#endif // lwip_init_mock_h
@@ -0,0 +1,35 @@
+/*
+ lwip/ip.h - host mock of the IPv4 header
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_ip_mock_h
+#define lwip_ip_mock_h
+
+#include "lwip/ip_addr.h"
+
+#define IP_HLEN 20
+
+struct ip_hdr {
+    u8_t  _v_hl;
+    u8_t  _tos;
+    u16_t _len;
+    u16_t _id;
+    u16_t _offset;
+    u8_t  _ttl;
+    u8_t  _proto;
+    u16_t _chksum;
+    ip4_addr_p_t src;
+    ip4_addr_p_t dest;
+} __attribute__((packed));
+
+#endif // lwip_ip_mock_h
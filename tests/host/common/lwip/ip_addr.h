@@ -0,0 +1,31 @@
+/*
+ lwip/ip_addr.h - host mock of the IPv4 addresses of lwIP
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_ip_addr_mock_h
+#define lwip_ip_addr_mock_h
+
+#include "lwip/err.h"
+
+typedef struct ip4_addr { u32_t addr; } ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+typedef ip4_addr_t ip4_addr_p_t;
+
+#define IPADDR_ANY ((u32_t) 0x00000000UL)
+
+#define ip_addr_copy(dest, src) ((dest).addr = (src).addr)
+#define ip_addr_set_zero(ipaddr) ((ipaddr)->addr = 0)
+// 224.0.0.0/4, addresses are in network order
+#define ip_addr_ismulticast(ipaddr) (((ipaddr)->addr & 0xf0) == 0xe0)
+
+#endif // lwip_ip_addr_mock_h
@@ -0,0 +1,31 @@
+/*
+ lwip/opt.h - host mock, the lwIP options the core's network code uses
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_opt_mock_h
+#define lwip_opt_mock_h
+
+#include "lwip/err.h"
+
+// as in the lwIP 2 build with the default (536) MSS, see
+// tools/sdk/lwip2/include/lwipopts.h
+#ifndef TCP_MSS
+#define TCP_MSS 536
+#endif
+#define TCP_WND          (4 * TCP_MSS)
+#define TCP_SND_BUF      (2 * TCP_MSS)
+#define TCP_SND_QUEUELEN ((4 * TCP_SND_BUF + (TCP_MSS - 1)) / TCP_MSS)
+
+#define PBUF_POOL_BUFSIZE 1536
+
+#endif // lwip_opt_mock_h
@@ -0,0 +1,67 @@
+/*
+ lwip/pbuf.h - host mock of the lwIP packet buffers, see lwip_mock.cpp
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_pbuf_mock_h
+#define lwip_pbuf_mock_h
+
+#include "lwip/opt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// room kept in front of the payload for the headers of each layer
+#define PBUF_TRANSPORT_HLEN 20
+#define PBUF_IP_HLEN        20
+#define PBUF_LINK_HLEN      14
+
+typedef enum {
+    PBUF_TRANSPORT,
+    PBUF_IP,
+    PBUF_LINK,
+    PBUF_RAW
+} pbuf_layer;
+
+typedef enum {
+    PBUF_RAM,
+    PBUF_ROM,
+    PBUF_REF,
+    PBUF_POOL
+} pbuf_type;
+
+struct pbuf {
+    struct pbuf* next;
+    void* payload;
+    u16_t tot_len;
+    u16_t len;
+    u8_t  type;
+    u8_t  flags;
+    u16_t ref;
+};
+
+struct pbuf* pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+void pbuf_realloc(struct pbuf* p, u16_t size);
+u8_t pbuf_free(struct pbuf* p);
+void pbuf_ref(struct pbuf* p);
+void pbuf_cat(struct pbuf* head, struct pbuf* tail);
+u16_t pbuf_clen(const struct pbuf* p);
+u16_t pbuf_copy_partial(const struct pbuf* p, void* dataptr, u16_t len, u16_t offset);
+err_t pbuf_take(struct pbuf* p, const void* dataptr, u16_t len);
+u8_t pbuf_get_at(const struct pbuf* p, u16_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // lwip_pbuf_mock_h
@@ -0,0 +1,123 @@
+/*
+ lwip/tcp.h - host mock of the lwIP raw TCP API, see lwip_mock.cpp
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_tcp_mock_h
+#define lwip_tcp_mock_h
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum tcp_state {
+    CLOSED      = 0,
+    LISTEN      = 1,
+    SYN_SENT    = 2,
+    SYN_RCVD    = 3,
+    ESTABLISHED = 4,
+    FIN_WAIT_1  = 5,
+    FIN_WAIT_2  = 6,
+    CLOSE_WAIT  = 7,
+    CLOSING     = 8,
+    LAST_ACK    = 9,
+    TIME_WAIT   = 10
+};
+
+struct tcp_pcb;
+
+typedef err_t (*tcp_accept_fn)(void* arg, struct tcp_pcb* newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void* arg, struct tcp_pcb* tpcb, struct pbuf* p, err_t err);
+typedef err_t (*tcp_sent_fn)(void* arg, struct tcp_pcb* tpcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void* arg, struct tcp_pcb* tpcb);
+typedef void  (*tcp_err_fn)(void* arg, err_t err);
+typedef err_t (*tcp_connected_fn)(void* arg, struct tcp_pcb* tpcb, err_t err);
+
+#define TCP_PRIO_MIN    1
+#define TCP_PRIO_NORMAL 64
+#define TCP_PRIO_MAX    127
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+#define SOF_REUSEADDR 0x04U
+#define SOF_KEEPALIVE 0x08U
+
+#define TF_NODELAY 0x40U
+
+struct tcp_seg;
+
+struct tcp_pcb {
+    ip_addr_t local_ip;
+    ip_addr_t remote_ip;
+    u8_t so_options;
+    u8_t prio;
+    u16_t local_port;
+    u16_t remote_port;
+    enum tcp_state state;
+    u8_t flags;
+    u16_t mss;
+    u16_t snd_buf;
+    u16_t snd_queuelen;
+    u32_t snd_wnd;
+    u32_t cwnd;
+    s16_t sa, sv;               // smoothed RTT (scaled by 8) and variance, in slow timer ticks
+    s16_t rto;
+    u8_t nrtx;
+    u32_t rcv_wnd;
+    struct tcp_seg* unacked;    // not null while sent data waits for its ACK
+    u32_t keep_idle;
+    u32_t keep_intvl;
+    u8_t keep_cnt;
+
+    void* callback_arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_poll_fn poll;
+    tcp_err_fn errf;
+    tcp_connected_fn connected;
+    u8_t pollinterval;
+};
+
+#define tcp_sndbuf(pcb)          ((pcb)->snd_buf)
+#define tcp_sndqueuelen(pcb)     ((pcb)->snd_queuelen)
+#define tcp_mss(pcb)             ((pcb)->mss)
+#define tcp_nagle_disable(pcb)   ((pcb)->flags |= TF_NODELAY)
+#define tcp_nagle_enable(pcb)    ((pcb)->flags &= ~TF_NODELAY)
+#define tcp_nagle_disabled(pcb)  (((pcb)->flags & TF_NODELAY) != 0)
+
+struct tcp_pcb* tcp_new(void);
+void tcp_arg(struct tcp_pcb* pcb, void* arg);
+void tcp_recv(struct tcp_pcb* pcb, tcp_recv_fn recv);
+void tcp_sent(struct tcp_pcb* pcb, tcp_sent_fn sent);
+void tcp_poll(struct tcp_pcb* pcb, tcp_poll_fn poll, u8_t interval);
+void tcp_err(struct tcp_pcb* pcb, tcp_err_fn err);
+void tcp_accept(struct tcp_pcb* pcb, tcp_accept_fn accept);
+void tcp_setprio(struct tcp_pcb* pcb, u8_t prio);
+void tcp_recved(struct tcp_pcb* pcb, u16_t len);
+err_t tcp_bind(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port);
+err_t tcp_connect(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port, tcp_connected_fn connected);
+err_t tcp_write(struct tcp_pcb* pcb, const void* dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb* pcb);
+err_t tcp_close(struct tcp_pcb* pcb);
+void tcp_abort(struct tcp_pcb* pcb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // lwip_tcp_mock_h
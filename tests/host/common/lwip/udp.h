@@ -0,0 +1,69 @@
+/*
+ lwip/udp.h - host mock of the lwIP raw UDP API, see lwip_mock.cpp
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_udp_mock_h
+#define lwip_udp_mock_h
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+#include "lwip/ip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UDP_HLEN 8
+
+struct udp_hdr {
+    u16_t src;
+    u16_t dest;
+    u16_t len;
+    u16_t chksum;
+} __attribute__((packed));
+
+struct udp_pcb;
+
+typedef void (*udp_recv_fn)(void* arg, struct udp_pcb* pcb, struct pbuf* p,
+                            const ip_addr_t* addr, u16_t port);
+
+struct udp_pcb {
+    ip_addr_t local_ip;
+    ip_addr_t remote_ip;
+    u16_t local_port;
+    u16_t remote_port;
+    u8_t ttl;
+    ip4_addr_t multicast_ip;
+    u8_t mcast_ttl;
+    udp_recv_fn recv;
+    void* recv_arg;
+};
+
+#define udp_set_multicast_netif_addr(pcb, ip4addr) ((pcb)->multicast_ip = *(ip4addr))
+#define udp_set_multicast_ttl(pcb, value) ((pcb)->mcast_ttl = (value))
+
+struct udp_pcb* udp_new(void);
+void udp_remove(struct udp_pcb* pcb);
+err_t udp_bind(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port);
+err_t udp_connect(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port);
+void udp_disconnect(struct udp_pcb* pcb);
+void udp_recv(struct udp_pcb* pcb, udp_recv_fn recv, void* recv_arg);
+err_t udp_sendto(struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* dst_ip, u16_t dst_port);
+err_t udp_send(struct udp_pcb* pcb, struct pbuf* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // lwip_udp_mock_h
@@ -0,0 +1,656 @@
+/*
+ lwip_mock.cpp - lwIP on the host, for ClientContext and UdpContext
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include "lwip_mock.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+
+namespace
+{
+    struct PcbState
+    {
+        std::string sent;
+        std::deque<size_t> segments;  // not acknowledged, one per write
+        size_t unsent = 0;            // of those, the last ones not output yet
+        bool closed = false;
+    };
+
+    struct ScheduledFn
+    {
+        schedule_fn_ptr_t fn;
+        void* arg;
+    };
+
+    std::map<const tcp_pcb*, PcbState> s_pcbs;
+    std::vector<tcp_pcb*> s_closed;
+    std::vector<udp_pcb*> s_udpPcbs;
+    std::vector<LwipMock::Datagram> s_datagrams;
+    std::vector<ScheduledFn> s_scheduled;
+    LwipMock::Counters s_counters;
+    uint32_t s_pbufsLive = 0;
+    bool s_autoAck = true;
+
+    // stands for the unacked segment list, only ever compared with null
+    char s_unacked;
+
+    u16_t layerOffset(pbuf_layer layer)
+    {
+        switch (layer) {
+        case PBUF_TRANSPORT:
+            return PBUF_TRANSPORT_HLEN + PBUF_IP_HLEN + PBUF_LINK_HLEN;
+        case PBUF_IP:
+            return PBUF_IP_HLEN + PBUF_LINK_HLEN;
+        case PBUF_LINK:
+            return PBUF_LINK_HLEN;
+        default:
+            return 0;
+        }
+    }
+
+    pbuf* newPbuf(u16_t offset, u16_t length, pbuf_type type)
+    {
+        // the payload stays aligned after the headers
+        size_t head = (sizeof(pbuf) + offset + 7) & ~7;
+        pbuf* p = (pbuf*) malloc(head + length);
+        if (!p) {
+            return nullptr;
+        }
+        p->next = nullptr;
+        p->payload = (char*) p + head;
+        p->tot_len = length;
+        p->len = length;
+        p->type = type;
+        p->flags = 0;
+        p->ref = 1;
+        ++s_counters.pbufAllocs;
+        ++s_pbufsLive;
+        return p;
+    }
+
+    void updateUnacked(tcp_pcb* pcb, PcbState& state)
+    {
+        pcb->unacked = state.segments.size() > state.unsent ? (struct tcp_seg*) &s_unacked : nullptr;
+    }
+
+    void detach(tcp_pcb* pcb)
+    {
+        PcbState& state = s_pcbs[pcb];
+        state.closed = true;
+        pcb->state = CLOSED;
+        pcb->callback_arg = nullptr;
+        pcb->recv = nullptr;
+        pcb->sent = nullptr;
+        pcb->poll = nullptr;
+        pcb->errf = nullptr;
+        pcb->connected = nullptr;
+        s_closed.push_back(pcb);
+    }
+}
+
+extern "C" {
+
+// pbufs
+
+struct pbuf* pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    u16_t offset = layerOffset(layer);
+    if (type != PBUF_POOL) {
+        return newPbuf(offset, length, type);
+    }
+    // a chain of pool buffers, headers in the first one
+    pbuf* head = nullptr;
+    pbuf* last = nullptr;
+    u16_t left = length;
+    do {
+        u16_t room = (u16_t) (PBUF_POOL_BUFSIZE - (head ? 0 : offset));
+        u16_t len = std::min(left, room);
+        pbuf* p = newPbuf(head ? 0 : offset, len, type);
+        if (!p) {
+            pbuf_free(head);
+            return nullptr;
+        }
+        p->tot_len = left;
+        if (last) {
+            last->next = p;
+        } else {
+            head = p;
+        }
+        last = p;
+        left -= len;
+    } while (left);
+    return head;
+}
+
+void pbuf_realloc(struct pbuf* p, u16_t size)
+{
+    if (size >= p->tot_len) {
+        // pbufs don't grow
+        return;
+    }
+    u16_t shrink = p->tot_len - size;
+    u16_t left = size;
+    pbuf* q = p;
+    while (left > q->len) {
+        left -= q->len;
+        q->tot_len -= shrink;
+        q = q->next;
+    }
+    q->len = left;
+    q->tot_len = left;
+    if (q->next) {
+        pbuf_free(q->next);
+        q->next = nullptr;
+    }
+}
+
+u8_t pbuf_free(struct pbuf* p)
+{
+    u8_t count = 0;
+    while (p) {
+        if (--p->ref) {
+            // still held, and so is the rest of the chain
+            break;
+        }
+        pbuf* next = p->next;
+        free(p);
+        ++s_counters.pbufFrees;
+        --s_pbufsLive;
+        ++count;
+        p = next;
+    }
+    return count;
+}
+
+void pbuf_ref(struct pbuf* p)
+{
+    if (p) {
+        ++p->ref;
+    }
+}
+
+void pbuf_cat(struct pbuf* head, struct pbuf* tail)
+{
+    pbuf* p = head;
+    for (; p->next; p = p->next) {
+        p->tot_len += tail->tot_len;
+    }
+    p->tot_len += tail->tot_len;
+    p->next = tail;
+}
+
+u16_t pbuf_clen(const struct pbuf* p)
+{
+    u16_t count = 0;
+    for (; p; p = p->next) {
+        ++count;
+    }
+    return count;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf* p, void* dataptr, u16_t len, u16_t offset)
+{
+    u16_t copied = 0;
+    for (; p && len; p = p->next) {
+        if (offset >= p->len) {
+            offset -= p->len;
+            continue;
+        }
+        u16_t piece = std::min<u16_t>(p->len - offset, len);
+        memcpy((char*) dataptr + copied, (const char*) p->payload + offset, piece);
+        copied += piece;
+        len -= piece;
+        offset = 0;
+    }
+    return copied;
+}
+
+err_t pbuf_take(struct pbuf* p, const void* dataptr, u16_t len)
+{
+    if (!p || p->tot_len < len) {
+        return ERR_ARG;
+    }
+    const char* src = (const char*) dataptr;
+    for (; len; p = p->next) {
+        u16_t piece = std::min(p->len, len);
+        memcpy(p->payload, src, piece);
+        src += piece;
+        len -= piece;
+    }
+    return ERR_OK;
+}
+
+u8_t pbuf_get_at(const struct pbuf* p, u16_t offset)
+{
+    for (; p; p = p->next) {
+        if (offset < p->len) {
+            return ((const u8_t*) p->payload)[offset];
+        }
+        offset -= p->len;
+    }
+    return 0;
+}
+
+// TCP
+
+struct tcp_pcb* tcp_new(void)
+{
+    tcp_pcb* pcb = (tcp_pcb*) calloc(1, sizeof(tcp_pcb));
+    pcb->state = CLOSED;
+    pcb->prio = TCP_PRIO_NORMAL;
+    pcb->mss = TCP_MSS;
+    pcb->snd_buf = TCP_SND_BUF;
+    pcb->snd_wnd = TCP_WND;
+    pcb->cwnd = pcb->mss;
+    pcb->rto = 3000 / 500;
+    pcb->rcv_wnd = TCP_WND;
+    s_pcbs[pcb] = PcbState();
+    return pcb;
+}
+
+void tcp_arg(struct tcp_pcb* pcb, void* arg)
+{
+    pcb->callback_arg = arg;
+}
+
+void tcp_recv(struct tcp_pcb* pcb, tcp_recv_fn recv)
+{
+    pcb->recv = recv;
+}
+
+void tcp_sent(struct tcp_pcb* pcb, tcp_sent_fn sent)
+{
+    pcb->sent = sent;
+}
+
+void tcp_poll(struct tcp_pcb* pcb, tcp_poll_fn poll, u8_t interval)
+{
+    pcb->poll = poll;
+    pcb->pollinterval = interval;
+}
+
+void tcp_err(struct tcp_pcb* pcb, tcp_err_fn err)
+{
+    pcb->errf = err;
+}
+
+void tcp_accept(struct tcp_pcb* pcb, tcp_accept_fn accept)
+{
+    pcb->accept = accept;
+}
+
+void tcp_setprio(struct tcp_pcb* pcb, u8_t prio)
+{
+    pcb->prio = prio;
+}
+
+void tcp_recved(struct tcp_pcb* pcb, u16_t len)
+{
+    pcb->rcv_wnd = std::min<u32_t>(pcb->rcv_wnd + len, TCP_WND);
+    s_counters.tcpRecved += len;
+}
+
+err_t tcp_bind(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port)
+{
+    pcb->local_ip.addr = ipaddr ? ipaddr->addr : IPADDR_ANY;
+    pcb->local_port = port;
+    return ERR_OK;
+}
+
+// the other end is always there and answers at once
+err_t tcp_connect(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port, tcp_connected_fn connected)
+{
+    pcb->remote_ip.addr = ipaddr->addr;
+    pcb->remote_port = port;
+    pcb->local_ip.addr = 0x0201a8c0; // 192.168.1.2
+    pcb->local_port = 50000;
+    pcb->state = ESTABLISHED;
+    pcb->connected = connected;
+    if (connected) {
+        connected(pcb->callback_arg, pcb, ERR_OK);
+    }
+    return ERR_OK;
+}
+
+err_t tcp_write(struct tcp_pcb* pcb, const void* dataptr, u16_t len, u8_t apiflags)
+{
+    if (pcb->state != ESTABLISHED && pcb->state != CLOSE_WAIT) {
+        return ERR_CONN;
+    }
+    PcbState& state = s_pcbs[pcb];
+    // as with TCP_OVERSIZE, copied data goes into the last unsent segment
+    // while it fits
+    bool join = (apiflags & TCP_WRITE_FLAG_COPY) && state.unsent && state.segments.back() + len <= TCP_MSS;
+    if (len > pcb->snd_buf || (!join && pcb->snd_queuelen >= TCP_SND_QUEUELEN)) {
+        return ERR_MEM;
+    }
+    state.sent.append((const char*) dataptr, len);
+    if (join) {
+        state.segments.back() += len;
+    } else {
+        state.segments.push_back(len);
+        ++state.unsent;
+        ++pcb->snd_queuelen;
+    }
+    pcb->snd_buf -= len;
+    ++s_counters.tcpWrites;
+    s_counters.tcpWritten += len;
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb* pcb)
+{
+    PcbState& state = s_pcbs[pcb];
+    state.unsent = 0;
+    updateUnacked(pcb, state);
+    ++s_counters.tcpOutputs;
+    return ERR_OK;
+}
+
+err_t tcp_close(struct tcp_pcb* pcb)
+{
+    detach(pcb);
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb* pcb)
+{
+    // as lwIP does, the error callback is told
+    tcp_err_fn errf = pcb->errf;
+    void* arg = pcb->callback_arg;
+    detach(pcb);
+    if (errf) {
+        errf(arg, ERR_ABRT);
+    }
+}
+
+// UDP
+
+struct udp_pcb* udp_new(void)
+{
+    udp_pcb* pcb = (udp_pcb*) calloc(1, sizeof(udp_pcb));
+    pcb->ttl = 255;
+    s_udpPcbs.push_back(pcb);
+    return pcb;
+}
+
+void udp_remove(struct udp_pcb* pcb)
+{
+    s_udpPcbs.erase(std::remove(s_udpPcbs.begin(), s_udpPcbs.end(), pcb), s_udpPcbs.end());
+    free(pcb);
+}
+
+err_t udp_bind(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port)
+{
+    pcb->local_ip.addr = ipaddr ? ipaddr->addr : IPADDR_ANY;
+    pcb->local_port = port;
+    return ERR_OK;
+}
+
+err_t udp_connect(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port)
+{
+    pcb->remote_ip.addr = ipaddr->addr;
+    pcb->remote_port = port;
+    return ERR_OK;
+}
+
+void udp_disconnect(struct udp_pcb* pcb)
+{
+    pcb->remote_ip.addr = IPADDR_ANY;
+    pcb->remote_port = 0;
+}
+
+void udp_recv(struct udp_pcb* pcb, udp_recv_fn recv, void* recv_arg)
+{
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* dst_ip, u16_t dst_port)
+{
+    (void) pcb;
+    LwipMock::Datagram datagram;
+    datagram.data.resize(p->tot_len);
+    pbuf_copy_partial(p, &datagram.data[0], p->tot_len, 0);
+    datagram.addr = dst_ip->addr;
+    datagram.port = dst_port;
+    s_datagrams.push_back(datagram);
+    ++s_counters.udpSent;
+    return ERR_OK;
+}
+
+err_t udp_send(struct udp_pcb* pcb, struct pbuf* p)
+{
+    return udp_sendto(pcb, p, &pcb->remote_ip, pcb->remote_port);
+}
+
+// what the core provides around lwIP
+
+void esp_yield()
+{
+    if (!s_autoAck) {
+        return;
+    }
+    std::vector<tcp_pcb*> pcbs;
+    for (auto& pcb : s_pcbs) {
+        if (!pcb.second.closed && pcb.second.segments.size() > pcb.second.unsent) {
+            pcbs.push_back(const_cast<tcp_pcb*>(pcb.first));
+        }
+    }
+    for (tcp_pcb* pcb : pcbs) {
+        LwipMock::ack(pcb);
+    }
+}
+
+void esp_schedule()
+{
+}
+
+void net_activity()
+{
+}
+
+} // extern "C"
+
+bool schedule_function(schedule_fn_ptr_t fn, void* arg)
+{
+    s_scheduled.push_back({ fn, arg });
+    return true;
+}
+
+void run_scheduled_functions()
+{
+    // those scheduled meanwhile wait for the next round, as on the device
+    std::vector<ScheduledFn> functions;
+    functions.swap(s_scheduled);
+    for (const ScheduledFn& f : functions) {
+        f.fn(f.arg);
+    }
+}
+
+namespace LwipMock
+{
+
+tcp_pcb* accept(uint16_t localPort, uint16_t remotePort)
+{
+    tcp_pcb* pcb = tcp_new();
+    pcb->local_ip.addr = 0x0101a8c0; // 192.168.1.1
+    pcb->local_port = localPort;
+    pcb->remote_ip.addr = 0x0201a8c0;
+    pcb->remote_port = remotePort;
+    pcb->state = ESTABLISHED;
+    return pcb;
+}
+
+size_t receive(tcp_pcb* pcb, const void* data, size_t size, size_t segment)
+{
+    const char* src = (const char*) data;
+    size_t taken = 0;
+    while (taken < size && pcb->recv && pcb->state == ESTABLISHED) {
+        u16_t len = (u16_t) std::min(std::min(size - taken, segment), (size_t) pcb->rcv_wnd);
+        if (!len) {
+            // the window is closed until the application reads
+            break;
+        }
+        pbuf* p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+        pbuf_take(p, src + taken, len);
+        pcb->rcv_wnd -= len;
+        err_t err = pcb->recv(pcb->callback_arg, pcb, p, ERR_OK);
+        if (err == ERR_MEM) {
+            // refused: lwIP would hold it and offer it again later, here
+            // it is left to the next receive()
+            pcb->rcv_wnd += len;
+            pbuf_free(p);
+            break;
+        }
+        if (err != ERR_OK) {
+            break;
+        }
+        taken += len;
+    }
+    return taken;
+}
+
+void receiveClose(tcp_pcb* pcb)
+{
+    if (pcb->state == ESTABLISHED) {
+        pcb->state = CLOSE_WAIT;
+    }
+    if (pcb->recv) {
+        pcb->recv(pcb->callback_arg, pcb, nullptr, ERR_OK);
+    }
+}
+
+void fail(tcp_pcb* pcb, err_t err)
+{
+    tcp_err_fn errf = pcb->errf;
+    void* arg = pcb->callback_arg;
+    detach(pcb);
+    if (errf) {
+        errf(arg, err);
+    }
+}
+
+size_t ack(tcp_pcb* pcb, size_t bytes)
+{
+    PcbState& state = s_pcbs[pcb];
+    size_t acked = 0;
+    while (state.segments.size() > state.unsent && acked < bytes) {
+        size_t& first = state.segments.front();
+        size_t piece = std::min(first, bytes - acked);
+        first -= piece;
+        acked += piece;
+        if (!first) {
+            state.segments.pop_front();
+            --pcb->snd_queuelen;
+        }
+    }
+    pcb->snd_buf += acked;
+    if (acked) {
+        pcb->nrtx = 0;
+    }
+    updateUnacked(pcb, state);
+    for (size_t left = acked; left && pcb->sent; ) {
+        u16_t len = (u16_t) std::min<size_t>(left, 0xffff);
+        left -= len;
+        pcb->sent(pcb->callback_arg, pcb, len);
+    }
+    return acked;
+}
+
+void setAutoAck(bool autoAck)
+{
+    s_autoAck = autoAck;
+}
+
+void poll(tcp_pcb* pcb)
+{
+    if (pcb->poll) {
+        pcb->poll(pcb->callback_arg, pcb);
+    }
+}
+
+std::string& sent(tcp_pcb* pcb)
+{
+    return s_pcbs[pcb].sent;
+}
+
+bool closed(const tcp_pcb* pcb)
+{
+    auto it = s_pcbs.find(pcb);
+    return it == s_pcbs.end() || it->second.closed;
+}
+
+bool receiveUdp(udp_pcb* pcb, const void* data, size_t size,
+                uint32_t srcAddr, uint16_t srcPort, uint32_t dstAddr)
+{
+    if (!pcb->recv) {
+        return false;
+    }
+    // the headers are in front of the payload, as lwIP leaves them
+    pbuf* p = pbuf_alloc(PBUF_TRANSPORT, (u16_t) size, PBUF_RAM);
+    if (!p) {
+        return false;
+    }
+    memcpy(p->payload, data, size);
+    ip_hdr* iphdr = (ip_hdr*) ((char*) p->payload - UDP_HLEN - IP_HLEN);
+    memset(iphdr, 0, IP_HLEN + UDP_HLEN);
+    iphdr->src.addr = srcAddr;
+    iphdr->dest.addr = dstAddr;
+    ip_addr_t addr = { srcAddr };
+    pcb->recv(pcb->recv_arg, pcb, p, &addr, srcPort);
+    return true;
+}
+
+udp_pcb* findUdp(uint16_t localPort)
+{
+    for (udp_pcb* pcb : s_udpPcbs) {
+        if (pcb->local_port == localPort) {
+            return pcb;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<Datagram>& sentDatagrams()
+{
+    return s_datagrams;
+}
+
+Counters counters()
+{
+    return s_counters;
+}
+
+uint32_t pbufsLive()
+{
+    return s_pbufsLive;
+}
+
+void clear()
+{
+    for (tcp_pcb* pcb : s_closed) {
+        s_pcbs.erase(pcb);
+        free(pcb);
+    }
+    s_closed.clear();
+    s_datagrams.clear();
+    s_scheduled.clear();
+    s_counters = Counters();
+    s_autoAck = true;
+}
+
+} // namespace LwipMock
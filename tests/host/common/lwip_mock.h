@@ -0,0 +1,104 @@
+/*
+ lwip_mock.h - lwIP on the host, for ClientContext and UdpContext
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_mock_h
+#define lwip_mock_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <osapi.h>
+#include <debug.h>
+#include <Schedule.h>
+#include "lwip/init.h"
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+
+// as in WiFiClient.h, which ClientContext.h expects to come first
+#ifndef TCP_DEFAULT_KEEPALIVE_IDLE_SEC
+#define TCP_DEFAULT_KEEPALIVE_IDLE_SEC     7200
+#define TCP_DEFAULT_KEEPALIVE_INTERVAL_SEC 75
+#define TCP_DEFAULT_KEEPALIVE_COUNT        9
+#endif
+
+// With this included first, the real include/ClientContext.h and
+// include/UdpContext.h build for the host. LwipMock plays the network and
+// the other end of the connections: what it receives is handed to the
+// callbacks the contexts set, what they write is kept here to be looked at.
+// Nothing runs by itself: esp_yield() (a blocking write waiting for room)
+// acknowledges what was sent, unless setAutoAck(false); scheduled
+// functions (the contexts' data and disconnect events) run with
+// run_scheduled_functions().
+//
+// pcbs stay allocated after tcp_close(), until clear(), so that what was
+// sent on a closed connection can still be read.
+namespace LwipMock
+{
+    struct Counters
+    {
+        uint32_t pbufAllocs;
+        uint32_t pbufFrees;
+        uint32_t tcpWrites;    // tcp_write() calls that queued data
+        uint32_t tcpOutputs;
+        uint64_t tcpWritten;   // bytes
+        uint64_t tcpRecved;    // bytes the application gave back to the window
+        uint32_t udpSent;      // datagrams
+    };
+
+    struct Datagram
+    {
+        std::string data;
+        uint32_t    addr;
+        uint16_t    port;
+    };
+
+    // An established connection from 192.168.1.2 to localPort, as a
+    // server's accept callback would get it
+    tcp_pcb* accept(uint16_t localPort = 80, uint16_t remotePort = 50000);
+    // The other end sends size bytes, given to the recv callback in pbufs of
+    // at most segment bytes. Returns the bytes the callback took.
+    size_t receive(tcp_pcb* pcb, const void* data, size_t size, size_t segment = TCP_MSS);
+    // The other end closes its side
+    void receiveClose(tcp_pcb* pcb);
+    // The connection is lost: the error callback, and the pcb is gone
+    void fail(tcp_pcb* pcb, err_t err = ERR_RST);
+    // Up to bytes of what went out are acknowledged, the send buffer grows
+    // by as much and the sent callback is told. Returns the bytes acknowledged.
+    size_t ack(tcp_pcb* pcb, size_t bytes = SIZE_MAX);
+    void setAutoAck(bool autoAck);
+    // The slow timer tick for pcb (every 500 ms in lwIP): the poll callback.
+    // What it retransmits on timeout shows as pcb->nrtx, set by the test.
+    void poll(tcp_pcb* pcb);
+    // All the bytes written to pcb so far, flushed or not
+    std::string& sent(tcp_pcb* pcb);
+    bool closed(const tcp_pcb* pcb);
+
+    // The pcb bound to localPort, e.g. by UdpContext::listen()
+    udp_pcb* findUdp(uint16_t localPort);
+    // A datagram for pcb, as from srcAddr:srcPort to dstAddr (network order)
+    bool receiveUdp(udp_pcb* pcb, const void* data, size_t size,
+                    uint32_t srcAddr, uint16_t srcPort, uint32_t dstAddr);
+    std::vector<Datagram>& sentDatagrams();
+
+    Counters counters();
+    // pbufs allocated and not freed: what a context is holding, or leaking
+    uint32_t pbufsLive();
+    // Forgets the closed pcbs, the sent datagrams and the counters
+    void clear();
+}
+
+#endif // lwip_mock_h
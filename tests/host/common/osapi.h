@@ -0,0 +1,28 @@
+/*
+ osapi.h - host mock of the SDK's memory functions
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef osapi_mock_h
+#define osapi_mock_h
+
+#include <string.h>
+
+#define os_memcmp memcmp
+#define os_memcpy memcpy
+#define os_memmove memmove
+#define os_memset memset
+#define os_strlen strlen
+#define os_strcmp strcmp
+#define os_strncpy strncpy
+
+#endif /* osapi_mock_h */
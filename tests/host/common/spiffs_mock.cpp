@@ -31,7 +31,9 @@ extern "C"
     uint8_t* s_phys_data = nullptr;
 }
 
-FS SPIFFS(nullptr);
+FS SPIFFS(FSImplPtr(nullptr));
+
+static SpiffsMock::Counters s_counters;
 
 SpiffsMock::SpiffsMock(size_t fs_size, size_t fs_block, size_t fs_page)
 {
@@ -41,12 +43,19 @@ SpiffsMock::SpiffsMock(size_t fs_size, size_t fs_block, size_t fs_page)
     s_phys_page  = static_cast<uint32_t>(fs_page);
     s_phys_block = static_cast<uint32_t>(fs_block);
     s_phys_data  = m_fs.data();
+    s_counters = SpiffsMock::Counters();
     reset();
 }
 
+static FSImplPtr makeSPIFFS()
+{
+    return FSImplPtr(new SPIFFSImpl(0, s_phys_size, s_phys_page, s_phys_block, 5));
+}
+
+// made on first use, as the global of spiffs_api.cpp
 void SpiffsMock::reset()
 {
-    SPIFFS = FS(FSImplPtr(new SPIFFSImpl(0, s_phys_size, s_phys_page, s_phys_block, 5)));
+    SPIFFS = FS(makeSPIFFS);
 }
     
 SpiffsMock::~SpiffsMock()
@@ -59,12 +68,21 @@ SpiffsMock::~SpiffsMock()
     SPIFFS = FS(FSImplPtr(nullptr));
 }
 
+const SpiffsMock::Counters& SpiffsMock::counters()
+{
+    return s_counters;
+}
+
 int32_t spiffs_hal_read(uint32_t addr, uint32_t size, uint8_t *dst) {
+    ++s_counters.reads;
+    s_counters.readBytes += size;
     memcpy(dst, s_phys_data + addr, size);
     return SPIFFS_OK;
 }
 
 int32_t spiffs_hal_write(uint32_t addr, uint32_t size, uint8_t *src) {
+    ++s_counters.writes;
+    s_counters.writeBytes += size;
     memcpy(s_phys_data + addr, src, size);
     return SPIFFS_OK;
 }
@@ -76,6 +94,7 @@ int32_t spiffs_hal_erase(uint32_t addr, uint32_t size) {
     }
     const uint32_t sector = addr / FLASH_SECTOR_SIZE;
     const uint32_t sectorCount = size / FLASH_SECTOR_SIZE;
+    s_counters.erases += sectorCount;
     for (uint32_t i = 0; i < sectorCount; ++i) {
         memset(s_phys_data + (sector + i) * FLASH_SECTOR_SIZE, 0xff, FLASH_SECTOR_SIZE);
     }
@@ -23,9 +23,20 @@
 
 class SpiffsMock {
 public:
+    // flash operations since the mock was made
+    struct Counters {
+        uint32_t reads;
+        uint32_t readBytes;
+        uint32_t writes;
+        uint32_t writeBytes;
+        uint32_t erases;
+    };
+
     SpiffsMock(size_t fs_size, size_t fs_block, size_t fs_page);
     void reset();
     ~SpiffsMock();
+
+    static const Counters& counters();
     
 protected:
     std::vector<uint8_t> m_fs;
@@ -0,0 +1,305 @@
+/*
+ bench_core.cpp - timings and heap use of core primitives on the host
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <Arduino.h>
+#include <pgmspace.h>
+#include <cbuf.h>
+#include <MD5Builder.h>
+#include <base64.h>
+#include "../common/alloc_mock.h"
+
+// One JSON object per line and operation, the keys always in the same order:
+//   {"bench":"core","op":"string_concat","size":256,"n":1024,"ns_per_op":812,
+//    "allocs_per_op":9.00,"alloc_bytes_per_op":1520.00}
+// Heap figures don't depend on the machine, so any change in them is a
+// change in the code; timings are only comparable on the same machine.
+// The lines go to the file named by CORE_BENCH_OUTPUT, appended to, or to
+// stdout.
+
+static FILE* s_benchOutput = nullptr;
+
+// Inputs of these sizes, each operation runs on about BENCH_BYTES bytes
+static const size_t s_sizes[] = { 16, 256, 4096 };
+static const size_t BENCH_BYTES = 256 * 1024;
+
+// Takes everything, so that what is printed costs nothing but the printing
+class NullPrint : public Print {
+public:
+    size_t write(uint8_t) override { ++bytes; return 1; }
+    size_t write(const uint8_t*, size_t size) override { bytes += size; return size; }
+    size_t bytes = 0;
+};
+
+// Runs fn about BENCH_BYTES / size times and returns what it returned the
+// last time, for the caller to check
+template<typename TOp>
+static size_t bench(const char* op, size_t size, TOp fn)
+{
+    uint32_t n = BENCH_BYTES / size;
+    // kept buffers get their size in the first round
+    size_t result = fn();
+    AllocMock::Counters before = AllocMock::counters();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n; ++i) {
+        result = fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    AllocMock::Counters after = AllocMock::counters();
+
+    unsigned long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / n;
+    fprintf(s_benchOutput ? s_benchOutput : stdout,
+            "{\"bench\":\"core\",\"op\":\"%s\",\"size\":%u,\"n\":%u,\"ns_per_op\":%llu,"
+            "\"allocs_per_op\":%.2f,\"alloc_bytes_per_op\":%.2f}\n",
+            op, (unsigned) size, n, ns,
+            (double) (after.allocs - before.allocs) / n,
+            (double) (after.allocBytes - before.allocBytes) / n);
+    return result;
+}
+
+static String makeText(size_t size)
+{
+    String text;
+    text.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        text += (char) ('a' + i % 26);
+    }
+    return text;
+}
+
+static void benchString(size_t size)
+{
+    String text = makeText(size);
+    const char* chars = text.c_str();
+
+    REQUIRE(bench("string_concat", size, [&]() {
+        String s;
+        for (size_t i = 0; i < size; ++i) {
+            s += chars[i];
+        }
+        return s.length();
+    }) == size);
+
+    REQUIRE(bench("string_concat_reserved", size, [&]() {
+        String s;
+        s.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            s += chars[i];
+        }
+        return s.length();
+    }) == size);
+
+    REQUIRE(bench("string_concat_string", size, [&]() {
+        String s;
+        for (size_t i = 0; i < 8; ++i) {
+            s += text;
+        }
+        return s.length();
+    }) == 8 * size);
+
+    // every 26 characters "xyz" becomes "XYZW": the string grows
+    REQUIRE(bench("string_replace", size, [&]() {
+        String s = text;
+        s.replace("xyz", "XYZW");
+        return s.length();
+    }) == size + size / 26);
+
+    // a template: the placeholder of every 26 characters gets one of two
+    // values, in a single pass
+    String page = text;
+    page.replace("xyz", "%A%");
+    static const char* const keys[] = { "%B%", "%A%" };
+    const String values[] = { "-", "ABCD" };
+    REQUIRE(bench("string_replace_many", size, [&]() {
+        String s = page;
+        s.replace(keys, values, 2);
+        return s.length();
+    }) == size + size / 26);
+
+    String haystack = text;
+    haystack += "needle!";
+    REQUIRE(bench("string_indexof", size, [&]() {
+        return (size_t) haystack.indexOf("needle");
+    }) == size);
+
+    REQUIRE(bench("string_indexof_char", size, [&]() {
+        return (size_t) haystack.indexOf('!');
+    }) == size + 6);
+}
+
+static void benchCbuf(size_t size)
+{
+    String text = makeText(size);
+    cbuf buffer(1024);
+    char out[256];
+
+    // in and out in pieces, so that the data wraps around the end
+    REQUIRE(bench("cbuf_write_read", size, [&]() {
+        size_t written = 0;
+        size_t read = 0;
+        while (read < size) {
+            while (written < size && buffer.room()) {
+                size_t piece = std::min<size_t>(size - written, 100);
+                written += buffer.write(text.c_str() + written, piece);
+            }
+            read += buffer.read(out, sizeof(out));
+        }
+        return read;
+    }) == size);
+    REQUIRE(buffer.empty());
+
+    spsc_cbuf spsc(1024);
+    REQUIRE(bench("spsc_cbuf_write_read", size, [&]() {
+        size_t written = 0;
+        size_t read = 0;
+        while (read < size) {
+            while (written < size && spsc.room()) {
+                size_t piece = std::min<size_t>(size - written, 100);
+                written += spsc.write(text.c_str() + written, piece);
+            }
+            read += spsc.read(out, sizeof(out));
+        }
+        return read;
+    }) == size);
+    REQUIRE(spsc.empty());
+}
+
+static void benchPgmspace(size_t size)
+{
+    String text = makeText(size);
+    const char* flash = text.c_str();
+    char* ram = (char*) malloc(size + 1);
+
+    bench("memcpy_P", size, [&]() {
+        memcpy_P(ram, flash, size + 1);
+        return (size_t) 0;
+    });
+    REQUIRE(strcmp(ram, flash) == 0);
+
+    REQUIRE(bench("strlen_P", size, [&]() {
+        return strlen_P(flash);
+    }) == size);
+
+    REQUIRE(bench("strncmp_P", size, [&]() {
+        return (size_t) strncmp_P(ram, flash, size);
+    }) == 0);
+
+    memset(ram, 0, size + 1);
+    bench("strncpy_P", size, [&]() {
+        strncpy_P(ram, flash, size + 1);
+        return (size_t) 0;
+    });
+    REQUIRE(strcmp(ram, flash) == 0);
+
+    free(ram);
+}
+
+static void benchPrint(size_t size)
+{
+    String text = makeText(size);
+    NullPrint out;
+
+    REQUIRE(bench("print_printf", size, [&]() {
+        return out.printf("%s=%d (%08x) %s\n", "value", 12345, 0xbeef, text.c_str());
+    }) == size + 24);
+
+    REQUIRE(bench("print_string", size, [&]() {
+        return out.print(text);
+    }) == size);
+
+    // telemetry style: a number every 8 bytes or so
+    size_t count = size / 8;
+    REQUIRE(bench("print_int", size, [&]() {
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i) {
+            n += out.print((long) (i * 2654435761u % 100000000));
+        }
+        return n;
+    }) > count);
+
+    REQUIRE(bench("print_float", size, [&]() {
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i) {
+            n += out.print(i * 0.37 - 25.0, 2);
+        }
+        return n;
+    }) > count);
+
+    REQUIRE(bench("string_float", size, [&]() {
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i) {
+            n += String(i * 1.7f, 3).length();
+        }
+        return n;
+    }) > count);
+}
+
+static void benchHash(size_t size)
+{
+    String text = makeText(size);
+    const uint8_t* data = (const uint8_t*) text.c_str();
+    char hex[33];
+
+    bench("md5", size, [&]() {
+        MD5Builder md5;
+        md5.begin();
+        md5.add(data, size);
+        md5.calculate();
+        md5.getChars(hex);
+        return (size_t) 0;
+    });
+    REQUIRE(strlen(hex) == 32);
+}
+
+static void benchBase64(size_t size)
+{
+    String text = makeText(size);
+    uint8_t* data = (uint8_t*) text.begin();
+    size_t encoded = (size + 2) / 3 * 4;
+
+    REQUIRE(bench("base64_encode", size, [&]() {
+        return (size_t) base64::encode(data, size, false).length();
+    }) == encoded);
+
+    NullPrint out;
+    REQUIRE(bench("base64_encoder", size, [&]() {
+        size_t before = out.bytes;
+        Base64Encoder encoder(out, false);
+        encoder.write(data, size);
+        encoder.end();
+        return out.bytes - before;
+    }) == encoded);
+}
+
+TEST_CASE("Core primitives benchmark", "[core][.benchmark]")
+{
+    const char* path = getenv("CORE_BENCH_OUTPUT");
+    s_benchOutput = path ? fopen(path, "a") : nullptr;
+    for (size_t size : s_sizes) {
+        benchString(size);
+        benchCbuf(size);
+        benchPgmspace(size);
+        benchPrint(size);
+        benchHash(size);
+        benchBase64(size);
+    }
+    if (s_benchOutput) {
+        fclose(s_benchOutput);
+        s_benchOutput = nullptr;
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ test_base64.cpp - base64 encoder and decoder tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <Arduino.h>
+#include <StreamString.h>
+#include <base64.h>
+
+TEST_CASE("Base64Encoder gives what base64::encode does", "[core][base64]")
+{
+    uint8_t data[1000];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i * 7 + 3;
+    }
+    for (bool newLines : {true, false}) {
+        String expected = base64::encode(data, sizeof(data), newLines);
+        for (size_t piece : {(size_t) 1, (size_t) 2, (size_t) 100, (size_t) 500, sizeof(data)}) {
+            StreamString out;
+            {
+                Base64Encoder encoder(out, newLines);
+                for (size_t pos = 0; pos < sizeof(data); pos += piece) {
+                    size_t len = (sizeof(data) - pos < piece) ? sizeof(data) - pos : piece;
+                    REQUIRE(encoder.write(data + pos, len) == len);
+                }
+            }
+            REQUIRE(out == expected);
+        }
+    }
+
+    StreamString out;
+    Base64Encoder encoder(out, false);
+    encoder.print("hello");
+    encoder.end();
+    REQUIRE(out == "aGVsbG8=");
+    REQUIRE(encoder.write('x') == 0);
+}
+
+TEST_CASE("Base64Decoder and Base64DecodeStream undo the encoding", "[core][base64]")
+{
+    String data;
+    for (int i = 0; i < 1000; ++i) {
+        data += (char) ('a' + (i * 7) % 26);
+    }
+    String code = base64::encode(data);
+    REQUIRE(code.indexOf('\n') > 0);
+
+    for (size_t piece : {(size_t) 1, (size_t) 3, (size_t) 100, (size_t) code.length()}) {
+        StreamString out;
+        Base64Decoder decoder(out);
+        for (size_t pos = 0; pos < code.length(); pos += piece) {
+            size_t len = (code.length() - pos < piece) ? code.length() - pos : piece;
+            REQUIRE(decoder.write((const uint8_t*) code.c_str() + pos, len) == len);
+        }
+        REQUIRE(out == data);
+    }
+
+    StreamString in;
+    in.print(code);
+    Base64DecodeStream stream(in);
+    REQUIRE(stream.available() > 0);
+    REQUIRE(stream.peek() == data[0]);
+    REQUIRE(stream.read() == data[0]);
+    char buf[1000];
+    size_t len = stream.readBytes(buf, sizeof(buf));
+    REQUIRE(len == data.length() - 1);
+    REQUIRE(memcmp(buf, data.c_str() + 1, len) == 0);
+    REQUIRE(stream.read() == -1);
+}
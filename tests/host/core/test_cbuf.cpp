@@ -0,0 +1,115 @@
+/*
+ test_cbuf.cpp - circular buffer tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <string>
+#include <cbuf.h>
+
+static std::string spanString(const cbuf_span& span)
+{
+    return std::string(span.first, span.firstSize) + std::string(span.second, span.secondSize);
+}
+
+TEST_CASE("cbuf spans wrap around the end", "[core][cbuf]")
+{
+    cbuf buffer(8);
+    // one byte always stays free
+    CHECK(buffer.getWriteSpan().size() == 7);
+    CHECK(buffer.getWriteSpan().secondSize == 0);
+    REQUIRE(buffer.write("abcdef", 6) == 6);
+    REQUIRE(buffer.remove(4) == 2);
+
+    cbuf_span room = buffer.getWriteSpan();
+    CHECK(room.firstSize == 2);
+    CHECK(room.secondSize == 3);
+    memcpy(room.first, "ghijk", 2);
+    memcpy(room.second, "ijk", 3);
+    CHECK(buffer.commitWrite(10) == 5);
+    CHECK(buffer.full());
+
+    cbuf_span data = buffer.getReadSpan();
+    CHECK(data.firstSize == 4);
+    CHECK(data.secondSize == 3);
+    CHECK(spanString(data) == "efghijk");
+    buffer.remove(5);
+    CHECK(spanString(buffer.getReadSpan()) == "jk");
+
+    char out[8];
+    REQUIRE(buffer.read(out, sizeof(out)) == 2);
+    CHECK(buffer.empty());
+    CHECK(buffer.getReadSpan().size() == 0);
+}
+
+TEST_CASE("spsc_cbuf uses all of a power of two", "[core][cbuf]")
+{
+    spsc_cbuf buffer(12);
+    REQUIRE(buffer.size() == 16);
+    CHECK(buffer.room() == 16);
+    CHECK(buffer.peek() == -1);
+    CHECK(buffer.read() == -1);
+
+    std::string data = "0123456789abcdefXYZ";
+    REQUIRE(buffer.write(data.data(), data.size()) == 16);
+    CHECK(buffer.full());
+    CHECK(buffer.write('!') == 0);
+    CHECK(buffer.peek() == '0');
+    CHECK(buffer.read() == '0');
+    CHECK(buffer.write('!') == 1);
+
+    char out[32];
+    REQUIRE(buffer.peek(out, 4) == 4);
+    CHECK(std::string(out, 4) == "1234");
+    REQUIRE(buffer.read(out, sizeof(out)) == 16);
+    CHECK(std::string(out, 16) == data.substr(1, 15) + "!");
+    CHECK(buffer.empty());
+
+    buffer.write("abc", 3);
+    buffer.flush();
+    CHECK(buffer.empty());
+    CHECK(buffer.room() == 16);
+}
+
+TEST_CASE("spsc_cbuf spans across the wrap", "[core][cbuf]")
+{
+    spsc_cbuf buffer(8);
+    std::string written;
+    std::string read;
+    char next = 'a';
+
+    // producer and consumer in turns of different sizes, so that the ends
+    // wrap at every position
+    for (size_t round = 0; round < 100; ++round) {
+        cbuf_span room = buffer.getWriteSpan();
+        size_t n = std::min<size_t>(room.size(), round % 7 + 1);
+        for (size_t i = 0; i < n; ++i) {
+            char* p = (i < room.firstSize) ? room.first + i : room.second + (i - room.firstSize);
+            *p = next;
+            written += next;
+            next = (next == 'z') ? 'a' : next + 1;
+        }
+        REQUIRE(buffer.commitWrite(n) == n);
+
+        cbuf_span data = buffer.getReadSpan();
+        CHECK(data.size() == buffer.available());
+        size_t m = std::min<size_t>(data.size(), round % 5 + 1);
+        read += spanString(data).substr(0, m);
+        REQUIRE(buffer.commitRead(m) == m);
+    }
+    read += spanString(buffer.getReadSpan());
+    size_t left = buffer.available();
+    CHECK(buffer.commitRead(100) == left);
+    CHECK(buffer.empty());
+    CHECK(read == written);
+}
@@ -0,0 +1,157 @@
+/*
+ test_deflater.cpp - Deflater tests
+ This file is part of the esp8266 core for Arduino environment.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <Deflater.h>
+#include <Inflater.h>
+
+class VectorDeflater : public Deflater
+{
+public:
+    std::vector<uint8_t> out;
+    size_t outputs = 0;
+    size_t maxPiece = 0;
+
+protected:
+    bool output(const uint8_t* data, size_t size) override
+    {
+        out.insert(out.end(), data, data + size);
+        ++outputs;
+        maxPiece = (size > maxPiece) ? size : maxPiece;
+        return true;
+    }
+};
+
+class VectorInflater : public Inflater
+{
+public:
+    std::vector<uint8_t> out;
+
+protected:
+    bool output(const uint8_t* data, size_t size) override
+    {
+        out.insert(out.end(), data, data + size);
+        return true;
+    }
+
+    bool history(size_t pos, uint8_t* dst, size_t size) override
+    {
+        if (pos + size > out.size()) {
+            return false;
+        }
+        memcpy(dst, &out[pos], size);
+        return true;
+    }
+};
+
+static std::vector<uint8_t> sampleText(size_t size)
+{
+    static const char* words[] = { "<tr><td>", "sensor", "</td><td>", "21.5", "</td></tr>\n", "humidity", "48", "%" };
+    std::vector<uint8_t> data;
+    uint32_t seed = 1;
+    while (data.size() < size) {
+        seed = seed * 1103515245u + 12345u;
+        const char* word = words[(seed >> 16) % 8];
+        data.insert(data.end(), word, word + strlen(word));
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::vector<uint8_t> sampleNoise(size_t size)
+{
+    std::vector<uint8_t> data;
+    uint32_t seed = 7;
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        data.push_back(seed >> 16);
+    }
+    return data;
+}
+
+static std::vector<uint8_t> roundTrip(const std::vector<uint8_t>& compressed, bool gzip)
+{
+    VectorInflater inflater;
+    inflater.begin(gzip);
+    REQUIRE(inflater.write(compressed.data(), compressed.size()));
+    REQUIRE(inflater.end());
+    REQUIRE(inflater.finished());
+    return inflater.out;
+}
+
+TEST_CASE("Deflater output inflates back in pieces of any size", "[core][Deflater]")
+{
+    for (size_t piece : {(size_t) 1, (size_t) 100, (size_t) 1500, (size_t) 20000}) {
+        for (bool noise : {false, true}) {
+            std::vector<uint8_t> data = noise ? sampleNoise(20000) : sampleText(20000);
+            VectorDeflater deflater;
+            deflater.begin();
+            for (size_t pos = 0; pos < data.size(); pos += piece) {
+                size_t size = (data.size() - pos < piece) ? data.size() - pos : piece;
+                REQUIRE(deflater.write(data.data() + pos, size));
+            }
+            REQUIRE(deflater.end());
+            REQUIRE(deflater.inputSize() == data.size());
+            REQUIRE(deflater.outputSize() == deflater.out.size());
+            REQUIRE(deflater.maxPiece <= DEFLATER_OUTPUT);
+            REQUIRE(roundTrip(deflater.out, true) == data);
+            if (!noise) {
+                REQUIRE(deflater.out.size() < data.size() / 3);
+            }
+        }
+    }
+}
+
+TEST_CASE("Deflater flushes to a byte that inflates on its own", "[core][Deflater]")
+{
+    std::vector<uint8_t> data = sampleText(3000);
+    VectorDeflater deflater;
+    deflater.begin();
+    REQUIRE(deflater.write(data.data(), 1000));
+    REQUIRE(deflater.flush());
+    size_t flushed = deflater.out.size();
+    REQUIRE(flushed >= 4);
+    REQUIRE(deflater.out[flushed - 2] == 0xff);
+    REQUIRE(deflater.out[flushed - 1] == 0xff);
+    REQUIRE(deflater.out[flushed - 3] == 0x00);
+
+    REQUIRE(deflater.write(data.data() + 1000, 2000));
+    REQUIRE(deflater.flush());
+    REQUIRE(deflater.end());
+    VectorInflater inflater;
+    inflater.begin();
+    REQUIRE(inflater.write(deflater.out.data(), deflater.out.size()));
+    REQUIRE(inflater.end());
+    REQUIRE(inflater.out == data);
+}
+
+TEST_CASE("Deflater writes raw deflate and empty streams", "[core][Deflater]")
+{
+    std::vector<uint8_t> data = sampleText(5000);
+    VectorDeflater deflater;
+    deflater.begin(false);
+    REQUIRE(deflater.write(data.data(), data.size()));
+    REQUIRE(deflater.end());
+    REQUIRE(roundTrip(deflater.out, false) == data);
+
+    VectorDeflater empty;
+    empty.begin();
+    REQUIRE(empty.end());
+    REQUIRE(roundTrip(empty.out, true).empty());
+    REQUIRE_FALSE(empty.write(data.data(), 1));
+}
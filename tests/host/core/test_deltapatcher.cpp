@@ -0,0 +1,153 @@
+/*
+ test_deltapatcher.cpp - DeltaPatcher tests
+ This file is part of the esp8266 core for Arduino environment.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <DeltaPatcher.h>
+
+static const std::string s_old = "The quick brown fox jumps over the lazy dog";
+
+static void putU32(std::vector<uint8_t>& patch, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        patch.push_back(value >> (8 * i));
+    }
+}
+
+static std::vector<uint8_t> patchHeader(uint32_t newSize)
+{
+    std::vector<uint8_t> patch;
+    putU32(patch, DELTA_MAGIC);
+    putU32(patch, s_old.size());
+    putU32(patch, newSize);
+    for (int i = 0; i < 16; ++i) {
+        patch.push_back(i);
+    }
+    return patch;
+}
+
+// add bytes come from new, the difference to old is worked out here
+static void patchRecord(std::vector<uint8_t>& patch, size_t oldPos, const std::string& add,
+                        const std::string& extra, int32_t seek)
+{
+    putU32(patch, add.size());
+    putU32(patch, extra.size());
+    putU32(patch, (uint32_t) seek);
+    for (size_t i = 0; i < add.size(); ++i) {
+        patch.push_back((uint8_t) add[i] - (uint8_t) s_old[oldPos + i]);
+    }
+    patch.insert(patch.end(), extra.begin(), extra.end());
+}
+
+// moves words of s_old around and changes a few of them
+static std::vector<uint8_t> makePatch()
+{
+    std::string expected = "The lazy cat jumps over the quick red fox!";
+    std::vector<uint8_t> patch = patchHeader(expected.size());
+    // "The " from 0, then on to "lazy dog" at 35, changed to "lazy cat"
+    patchRecord(patch, 0, "The ", "", 31);
+    patchRecord(patch, 35, "lazy cat", "", 20 - 43);
+    // " jumps over the " from 19, then back to "quick " at 4 and on to
+    // " fox" at 16, with a new word in between
+    patchRecord(patch, 20, " jumps over the ", "", 4 - 36);
+    patchRecord(patch, 4, "quick ", "red", 16 - 10);
+    patchRecord(patch, 16, " fox", "!", 0);
+    return patch;
+}
+
+class VectorPatcher : public DeltaPatcher
+{
+public:
+    std::string out;
+    bool accept = true;
+
+protected:
+    bool header() override
+    {
+        return accept && oldSize() == s_old.size();
+    }
+
+    bool source(size_t pos, uint8_t* dst, size_t size) override
+    {
+        if (pos + size > s_old.size()) {
+            return false;
+        }
+        memcpy(dst, s_old.data() + pos, size);
+        return true;
+    }
+
+    bool output(const uint8_t* data, size_t size) override
+    {
+        out.append((const char*) data, size);
+        return true;
+    }
+};
+
+TEST_CASE("DeltaPatcher applies patches in pieces of any size", "[core][DeltaPatcher]")
+{
+    std::vector<uint8_t> patch = makePatch();
+    REQUIRE(DeltaPatcher::isPatch(patch.data(), patch.size()));
+    REQUIRE_FALSE(DeltaPatcher::isPatch((const uint8_t*) "\xe9\x03", 2));
+    for (size_t piece : {(size_t) 1, (size_t) 5, (size_t) 13, patch.size()}) {
+        VectorPatcher patcher;
+        patcher.begin();
+        for (size_t pos = 0; pos < patch.size(); pos += piece) {
+            size_t size = (patch.size() - pos < piece) ? patch.size() - pos : piece;
+            REQUIRE(patcher.write(patch.data() + pos, size));
+        }
+        REQUIRE(patcher.finished());
+        REQUIRE(patcher.end());
+        REQUIRE(patcher.out == "The lazy cat jumps over the quick red fox!");
+        REQUIRE(patcher.newSize() == patcher.out.size());
+        REQUIRE(patcher.oldMD5()[15] == 15);
+    }
+}
+
+TEST_CASE("DeltaPatcher rejects bad and truncated patches", "[core][DeltaPatcher]")
+{
+    std::vector<uint8_t> patch = makePatch();
+    WHEN("it is for another image") {
+        VectorPatcher patcher;
+        patcher.accept = false;
+        patcher.begin();
+        REQUIRE_FALSE(patcher.write(patch.data(), patch.size()));
+        REQUIRE(patcher.out.empty());
+    }
+    WHEN("a seek goes before the start of the old image") {
+        patch = patchHeader(8);
+        patchRecord(patch, 0, "The ", "", -10);
+        patchRecord(patch, 0, "", "lazy", 0);
+        VectorPatcher patcher;
+        patcher.begin();
+        REQUIRE_FALSE(patcher.write(patch.data(), patch.size()));
+        REQUIRE(patcher.out == "The ");
+    }
+    WHEN("a record makes more than the new size") {
+        patch = patchHeader(4);
+        patchRecord(patch, 0, "The ", "!", 0);
+        VectorPatcher patcher;
+        patcher.begin();
+        REQUIRE_FALSE(patcher.write(patch.data(), patch.size()));
+    }
+    WHEN("the patch stops early") {
+        VectorPatcher patcher;
+        patcher.begin();
+        REQUIRE(patcher.write(patch.data(), patch.size() - 2));
+        REQUIRE_FALSE(patcher.finished());
+        REQUIRE_FALSE(patcher.end());
+    }
+}
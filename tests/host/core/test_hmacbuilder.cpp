@@ -0,0 +1,58 @@
+/*
+ test_hmacbuilder.cpp - HMACBuilder tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <HMACBuilder.h>
+#include <StreamString.h>
+
+TEST_CASE("HMACSHA256Builder gives the RFC 4231 digests", "[core][HMACBuilder]")
+{
+    HMACSHA256Builder builder;
+    uint8_t key[131];
+
+    memset(key, 0x0b, 20);
+    builder.begin(key, 20);
+    builder.add("Hi There");
+    builder.calculate();
+    REQUIRE(builder.toString() == "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+
+    builder.begin("Jefe");
+    builder.add("what do ya want ");
+    builder.add("for nothing?");
+    builder.calculate();
+    REQUIRE(builder.toString() == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+    // longer than a block, the key is hashed first
+    memset(key, 0xaa, sizeof(key));
+    builder.begin(key, sizeof(key));
+    builder.add("Test Using Larger Than Block-Size Key - Hash Key First");
+    builder.calculate();
+    REQUIRE(builder.toString() == "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
+
+TEST_CASE("HMACMD5Builder reads the message from a stream", "[core][HMACBuilder]")
+{
+    HMACMD5Builder builder;
+    StreamString stream;
+    stream.print("what do ya want for nothing?");
+    builder.begin("Jefe");
+    REQUIRE(builder.addStream(stream, stream.available()));
+    builder.calculate();
+    REQUIRE(builder.toString() == "750c783e6ab0b503eaa86e310a5db738");
+    uint8_t bytes[16];
+    builder.getBytes(bytes);
+    REQUIRE(bytes[0] == 0x75);
+    REQUIRE(bytes[15] == 0x38);
+}
@@ -0,0 +1,175 @@
+/*
+ test_inflater.cpp - Inflater tests
+ This file is part of the esp8266 core for Arduino environment.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <vector>
+#include <Inflater.h>
+
+// three copies of 2500 bytes, so the matches reach further back than the
+// window; gzip -9 with the file name image.bin
+static const uint8_t s_gzipped[] = {
+    0x1f, 0x8b, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x69, 0x6d, 0x61, 0x67, 0x65, 0x2e,
+    0x62, 0x69, 0x6e, 0x00, 0xed, 0x96, 0xd9, 0x95, 0x1c, 0x31, 0x0c, 0x03, 0x63, 0xe5, 0x91, 0x7f,
+    0x0c, 0x16, 0xaa, 0xd4, 0x63, 0x27, 0xe0, 0x3f, 0xbd, 0xf1, 0x7a, 0x67, 0xbb, 0x25, 0x0a, 0x04,
+    0x41, 0x88, 0x33, 0xbd, 0xbb, 0xb3, 0x75, 0x7e, 0x57, 0xf5, 0x9e, 0xcf, 0xcc, 0xf0, 0xa8, 0xe7,
+    0x3c, 0xc8, 0xf7, 0xe9, 0xae, 0xbc, 0x3b, 0x5f, 0x76, 0xe6, 0x7c, 0xdf, 0x2c, 0x69, 0x36, 0x9e,
+    0x9d, 0x9d, 0x1d, 0x53, 0xe7, 0xdf, 0xf9, 0xb6, 0xbc, 0xdf, 0xae, 0xf3, 0xe9, 0x3a, 0x31, 0xce,
+    0xfb, 0x3c, 0xe4, 0x87, 0x3f, 0x4e, 0xd8, 0xb3, 0xf2, 0x2c, 0xcf, 0xea, 0xc4, 0x9e, 0x9c, 0x73,
+    0x36, 0xe5, 0x74, 0xd6, 0x6f, 0x22, 0x77, 0x02, 0xe4, 0x8c, 0x6c, 0xcb, 0x92, 0x09, 0x52, 0x82,
+    0x0f, 0x60, 0x4e, 0xf4, 0xc9, 0x39, 0x41, 0x9c, 0xef, 0x49, 0x40, 0x30, 0x59, 0x70, 0x42, 0x57,
+    0x8e, 0x3a, 0x8f, 0xb2, 0x94, 0x67, 0x27, 0xf8, 0xd9, 0x57, 0x09, 0x51, 0xc1, 0xb2, 0x20, 0xe7,
+    0xc0, 0xa4, 0x95, 0x8c, 0x26, 0x48, 0xb3, 0x32, 0x20, 0xc2, 0xc9, 0x92, 0x96, 0x48, 0xa5, 0xe4,
+    0x2c, 0x3f, 0x70, 0x97, 0xb8, 0xf0, 0xd6, 0xfd, 0xa5, 0xdc, 0x7b, 0x53, 0x2f, 0x56, 0x6f, 0x43,
+    0x54, 0x01, 0x24, 0x69, 0x9e, 0xb0, 0xbd, 0x5f, 0xd0, 0xc3, 0x02, 0xe9, 0xc0, 0xde, 0xc0, 0x57,
+    0xd6, 0x25, 0x70, 0xf2, 0x27, 0x93, 0xca, 0x83, 0x0e, 0xfe, 0x66, 0x27, 0x9c, 0x53, 0x88, 0xa4,
+    0x0d, 0x90, 0xc3, 0xe6, 0x01, 0x41, 0x06, 0x14, 0xab, 0x2c, 0x65, 0x03, 0xbf, 0x42, 0xb5, 0x45,
+    0x4b, 0x30, 0xa0, 0x6c, 0xf0, 0x2e, 0x9f, 0x22, 0x0c, 0xb5, 0x0c, 0x64, 0xb3, 0x97, 0x1b, 0x8a,
+    0xdc, 0x94, 0xb5, 0xdd, 0x95, 0xfd, 0x01, 0x32, 0x96, 0x69, 0xa9, 0x01, 0xe4, 0x73, 0x30, 0xf0,
+    0xca, 0xc4, 0x12, 0x2e, 0x87, 0xdd, 0x1a, 0x34, 0xe5, 0x9e, 0x22, 0x7b, 0x37, 0x99, 0x45, 0x28,
+    0x87, 0xbe, 0x1d, 0x16, 0x58, 0xea, 0x85, 0x66, 0x70, 0xe5, 0xa4, 0x24, 0x94, 0x4a, 0x03, 0x39,
+    0x01, 0x38, 0x18, 0xb1, 0x92, 0x26, 0x67, 0x6c, 0xdd, 0xaa, 0x5f, 0xba, 0xb2, 0xb0, 0xf8, 0x8d,
+    0x26, 0x65, 0x3b, 0xb8, 0x78, 0x56, 0xf2, 0x19, 0xfe, 0x43, 0x68, 0x48, 0xa3, 0x18, 0xf9, 0x9d,
+    0xed, 0x28, 0xa5, 0x55, 0xbd, 0x0b, 0x97, 0xc2, 0x94, 0x68, 0xc6, 0xd4, 0x0a, 0x80, 0xa5, 0xe2,
+    0x49, 0xa1, 0x2f, 0x93, 0x0d, 0x03, 0x1c, 0x37, 0xc8, 0xad, 0xbf, 0xaf, 0xe8, 0x23, 0xcb, 0x61,
+    0x43, 0x91, 0xa4, 0x48, 0xc8, 0xa9, 0xa8, 0xa3, 0xff, 0x85, 0x66, 0x82, 0x96, 0xda, 0xaf, 0x9f,
+    0x7c, 0xc2, 0x94, 0x2d, 0x67, 0x29, 0x79, 0x97, 0x7e, 0x1d, 0xc0, 0x0f, 0x45, 0x5a, 0xd1, 0xff,
+    0x02, 0xda, 0x9a, 0x41, 0xce, 0xe6, 0xec, 0xef, 0xb9, 0x94, 0xda, 0x52, 0x09, 0x1c, 0x0d, 0x64,
+    0xc5, 0xc0, 0x3b, 0x02, 0x67, 0x35, 0x62, 0x8c, 0xac, 0xad, 0xa4, 0xd5, 0x5d, 0x2a, 0xaa, 0xdc,
+    0x2e, 0x10, 0x5e, 0x73, 0xea, 0xde, 0x1e, 0x99, 0xaf, 0xe7, 0x69, 0xae, 0x32, 0x59, 0x3a, 0x6a,
+    0xc9, 0xda, 0xdd, 0x59, 0x0b, 0x8c, 0xa5, 0xa7, 0xd5, 0x54, 0x4b, 0x75, 0xab, 0x01, 0x81, 0x20,
+    0xc1, 0x50, 0xd9, 0x9e, 0x02, 0x8b, 0x66, 0x06, 0x18, 0xcf, 0x59, 0xaa, 0x0d, 0xdb, 0xa3, 0x37,
+    0x61, 0x27, 0x24, 0x49, 0xcf, 0xe7, 0x8f, 0x55, 0xdd, 0x24, 0x59, 0x73, 0x8d, 0x00, 0x45, 0xa2,
+    0xa1, 0x1c, 0xad, 0xd6, 0xed, 0x15, 0xf0, 0xe8, 0x6f, 0xe1, 0x98, 0x2e, 0x4d, 0x05, 0xe8, 0x3c,
+    0x7e, 0xb3, 0x97, 0x73, 0x11, 0x27, 0x75, 0x43, 0x04, 0x29, 0x2c, 0x07, 0x93, 0x45, 0xfd, 0x53,
+    0x71, 0xe8, 0xc2, 0x0e, 0xda, 0x9f, 0xc5, 0x26, 0xf6, 0x23, 0xcc, 0xc6, 0x82, 0xce, 0x30, 0xb5,
+    0x9f, 0x3a, 0x2d, 0xb3, 0xe4, 0xd3, 0xc7, 0xa3, 0xab, 0xe6, 0x43, 0xc7, 0xad, 0xc6, 0x47, 0x7b,
+    0x84, 0xe8, 0xc6, 0x00, 0x46, 0x8b, 0xa2, 0x9d, 0xb4, 0x7a, 0x5b, 0x69, 0xcb, 0x0a, 0xe3, 0x3e,
+    0x70, 0xaa, 0x0e, 0x10, 0xaa, 0x9a, 0x45, 0x83, 0x08, 0x7a, 0x75, 0xbe, 0xbd, 0x3e, 0xfc, 0x09,
+    0x51, 0x37, 0x02, 0x4c, 0x69, 0x76, 0xd4, 0xfd, 0x3a, 0x30, 0x8d, 0x64, 0x69, 0x5b, 0xdf, 0x5c,
+    0xe5, 0x0f, 0x5c, 0xfd, 0x5c, 0x37, 0x57, 0x4d, 0x92, 0x5f, 0x9f, 0xd5, 0x68, 0xdc, 0xe4, 0x67,
+    0x93, 0x0b, 0x44, 0x80, 0x09, 0xfa, 0x7b, 0x77, 0xab, 0x47, 0xba, 0x90, 0x26, 0xbb, 0x63, 0x13,
+    0x41, 0x9e, 0x57, 0x1c, 0x36, 0x8f, 0xe4, 0x00, 0x67, 0x5c, 0x6f, 0x3d, 0xc4, 0xd8, 0xb7, 0x9b,
+    0xbb, 0xf6, 0x7b, 0x6b, 0xbf, 0x96, 0xd2, 0x53, 0xd4, 0x6b, 0xf9, 0x10, 0xce, 0xfe, 0x9a, 0x63,
+    0x0d, 0x6e, 0x35, 0xbd, 0xbd, 0x24, 0xff, 0xa6, 0x8b, 0xfe, 0xfa, 0xda, 0x34, 0xb7, 0x8b, 0x71,
+    0xc7, 0xdb, 0xcb, 0xfc, 0x7b, 0xf4, 0x68, 0x4e, 0xa0, 0x3b, 0x57, 0x17, 0xd5, 0x5a, 0x46, 0x0b,
+    0x2c, 0x95, 0xb0, 0x8a, 0x15, 0x8b, 0x1e, 0x0c, 0x38, 0x99, 0xa3, 0xc9, 0xc0, 0xb1, 0x31, 0x02,
+    0x83, 0xe2, 0x79, 0xc3, 0x70, 0xe9, 0x7a, 0xbb, 0x11, 0xc8, 0xfe, 0x46, 0x01, 0xb6, 0x64, 0xdd,
+    0x06, 0x69, 0x1d, 0x01, 0x31, 0x17, 0xb0, 0x6e, 0x32, 0x18, 0x7e, 0x69, 0x1a, 0x0d, 0x5b, 0xb4,
+    0xc7, 0x75, 0x1d, 0x60, 0x0a, 0x45, 0x72, 0x74, 0x71, 0xdc, 0x78, 0x6d, 0x14, 0x9b, 0xcc, 0x56,
+    0xee, 0x7b, 0xbf, 0x6a, 0x52, 0x09, 0x72, 0xab, 0xa3, 0x5f, 0xc2, 0xcf, 0x35, 0x04, 0xc9, 0x72,
+    0x8c, 0x80, 0x0a, 0x8d, 0x6a, 0xfe, 0xca, 0xb5, 0x34, 0xf2, 0x35, 0x77, 0xd4, 0xf8, 0x0d, 0x12,
+    0x57, 0x41, 0x75, 0xef, 0xa2, 0xd1, 0xfc, 0xca, 0xab, 0xbc, 0xee, 0x71, 0xdc, 0x99, 0x1a, 0x72,
+    0xbe, 0xcc, 0xbd, 0xec, 0x47, 0x61, 0x22, 0x7f, 0x1d, 0x83, 0x53, 0x88, 0xba, 0x5e, 0xa6, 0x0e,
+    0x30, 0x6a, 0xa9, 0xd7, 0x96, 0x82, 0xf5, 0xdb, 0xce, 0xd4, 0xf3, 0xb6, 0x22, 0xe7, 0x5d, 0xce,
+    0xf7, 0x46, 0x5f, 0x08, 0xfb, 0xae, 0xd3, 0xf5, 0x8e, 0xb9, 0x55, 0x77, 0x54, 0x00, 0x47, 0x93,
+    0xe9, 0x4d, 0x79, 0xde, 0x0c, 0xf7, 0x66, 0xb8, 0x37, 0xc3, 0xbd, 0x19, 0xee, 0xcd, 0x70, 0x6f,
+    0x86, 0x7b, 0x33, 0xdc, 0x9b, 0xe1, 0xde, 0x0c, 0xf7, 0x66, 0xb8, 0x37, 0xc3, 0xbd, 0x19, 0xee,
+    0xcd, 0x70, 0x6f, 0x86, 0x7b, 0x33, 0xdc, 0x9b, 0xe1, 0xde, 0x0c, 0xf7, 0x66, 0xb8, 0x37, 0xc3,
+    0xfd, 0xf7, 0x19, 0xee, 0x0f, 0x77, 0xb1, 0x08, 0xaf, 0x4c, 0x1d, 0x00, 0x00,
+};
+// "hello, stored block" as a raw deflate stored block
+static const uint8_t s_stored[] = {
+    0x01, 0x13, 0x00, 0xec, 0xff, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x2c, 0x20, 0x73, 0x74, 0x6f, 0x72,
+    0x65, 0x64, 0x20, 0x62, 0x6c, 0x6f, 0x63, 0x6b,
+};
+
+static std::vector<uint8_t> expectedImage()
+{
+    std::vector<uint8_t> data;
+    uint32_t seed = 1;
+    for (int i = 0; i < 2500; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        data.push_back('a' + ((seed >> 16) & 3));
+    }
+    for (int i = 0; i < 5000; ++i) {
+        data.push_back(data[i]);
+    }
+    return data;
+}
+
+class VectorInflater : public Inflater
+{
+public:
+    std::vector<uint8_t> out;
+    size_t historyReads = 0;
+
+protected:
+    bool output(const uint8_t* data, size_t size) override
+    {
+        out.insert(out.end(), data, data + size);
+        return true;
+    }
+
+    bool history(size_t pos, uint8_t* dst, size_t size) override
+    {
+        if (pos + size > out.size()) {
+            return false;
+        }
+        memcpy(dst, &out[pos], size);
+        ++historyReads;
+        return true;
+    }
+};
+
+TEST_CASE("Inflater decodes gzip in pieces of any size", "[core][Inflater]")
+{
+    for (size_t piece : {(size_t) 1, (size_t) 7, (size_t) 300, sizeof(s_gzipped)}) {
+        VectorInflater inflater;
+        inflater.begin();
+        for (size_t pos = 0; pos < sizeof(s_gzipped); pos += piece) {
+            size_t size = (sizeof(s_gzipped) - pos < piece) ? sizeof(s_gzipped) - pos : piece;
+            REQUIRE(inflater.write(s_gzipped + pos, size));
+        }
+        REQUIRE(inflater.end());
+        REQUIRE(inflater.finished());
+        REQUIRE(inflater.out == expectedImage());
+        REQUIRE(inflater.outputSize() == 7500);
+        REQUIRE(inflater.historyReads > 0);
+    }
+}
+
+TEST_CASE("Inflater decodes raw stored blocks", "[core][Inflater]")
+{
+    VectorInflater inflater;
+    inflater.begin(false);
+    REQUIRE(inflater.write(s_stored, sizeof(s_stored)));
+    REQUIRE(inflater.end());
+    REQUIRE(std::string(inflater.out.begin(), inflater.out.end()) == "hello, stored block");
+}
+
+TEST_CASE("Inflater rejects damaged and truncated data", "[core][Inflater]")
+{
+    std::vector<uint8_t> data(s_gzipped, s_gzipped + sizeof(s_gzipped));
+    WHEN("the CRC is wrong") {
+        data[data.size() - 8] ^= 1;
+        VectorInflater inflater;
+        inflater.begin();
+        REQUIRE(inflater.write(data.data(), data.size()));
+        REQUIRE_FALSE(inflater.end());
+    }
+    WHEN("the stream stops early") {
+        VectorInflater inflater;
+        inflater.begin();
+        REQUIRE(inflater.write(data.data(), data.size() / 2));
+        REQUIRE_FALSE(inflater.end());
+    }
+    WHEN("it isn't gzip") {
+        data[0] = 0xe9;
+        VectorInflater inflater;
+        inflater.begin();
+        REQUIRE_FALSE(inflater.write(data.data(), data.size()));
+    }
+}
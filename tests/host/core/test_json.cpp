@@ -0,0 +1,142 @@
+/*
+ test_json.cpp - JsonWriter and JsonReader tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <Arduino.h>
+#include <StreamString.h>
+#include <JsonWriter.h>
+#include <JsonReader.h>
+
+TEST_CASE("JsonWriter puts in the separators and escapes", "[core][json]")
+{
+    StreamString out;
+    JsonWriter json(out);
+    json.beginObject()
+        .member("name", "a \"quoted\"\\ line\n")
+        .member(F("count"), 42)
+        .member("neg", -7L)
+        .key("ratio").value(0.5, 2)
+        .member("on", true)
+        .key("none").null()
+        .key("list").beginArray().value(1).value("x").beginObject().endObject().beginArray().endArray().endArray()
+        .member("ctl", "\x01")
+        .endObject();
+    REQUIRE(json.ok());
+    REQUIRE(out == "{\"name\":\"a \\\"quoted\\\"\\\\ line\\n\",\"count\":42,\"neg\":-7,\"ratio\":0.50,"
+                   "\"on\":true,\"none\":null,\"list\":[1,\"x\",{},[]],\"ctl\":\"\\u0001\"}");
+
+    StreamString bad;
+    JsonWriter wrong(bad);
+    wrong.beginObject().value(1);
+    REQUIRE_FALSE(wrong.ok());
+    JsonWriter unbalanced(bad);
+    unbalanced.beginArray().endObject();
+    REQUIRE_FALSE(unbalanced.ok());
+}
+
+TEST_CASE("JsonReader gives the tokens of a document", "[core][json]")
+{
+    StreamString in;
+    in.print(" {\"ssid\" : \"home\\u00e9\\ud83d\\ude00\", \"port\": -80, \"pi\": 3.25e0,"
+             " \"list\": [true, false, null, [], {\"deep\": [1]}], \"empty\": {} } ");
+    char text[16];
+    JsonReader json(in, text, sizeof(text));
+    REQUIRE(json.next() == JsonReader::BEGIN_OBJECT);
+    REQUIRE(json.next() == JsonReader::KEY);
+    REQUIRE(strcmp(text, "ssid") == 0);
+    REQUIRE(json.next() == JsonReader::STRING);
+    REQUIRE(strcmp(text, "home\xc3\xa9\xf0\x9f\x98\x80") == 0);
+    REQUIRE(json.next() == JsonReader::KEY);
+    REQUIRE(json.next() == JsonReader::NUMBER);
+    REQUIRE(json.toInt() == -80);
+    REQUIRE(json.next() == JsonReader::KEY);
+    REQUIRE(json.next() == JsonReader::NUMBER);
+    REQUIRE(json.toFloat() == 3.25);
+    REQUIRE(json.next() == JsonReader::KEY);
+    REQUIRE(strcmp(text, "list") == 0);
+    REQUIRE(json.next() == JsonReader::BEGIN_ARRAY);
+    REQUIRE(json.next() == JsonReader::TRUE_VALUE);
+    REQUIRE(json.next() == JsonReader::FALSE_VALUE);
+    REQUIRE(json.next() == JsonReader::NULL_VALUE);
+    REQUIRE(json.skip());
+    REQUIRE(json.skip());
+    REQUIRE(json.next() == JsonReader::END_ARRAY);
+    REQUIRE(json.next() == JsonReader::KEY);
+    REQUIRE(json.next() == JsonReader::BEGIN_OBJECT);
+    REQUIRE(json.depth() == 2);
+    REQUIRE(json.next() == JsonReader::END_OBJECT);
+    REQUIRE(json.next() == JsonReader::END_OBJECT);
+    REQUIRE(json.next() == JsonReader::END);
+    REQUIRE(json.depth() == 0);
+}
+
+TEST_CASE("JsonReader truncates long text and finds errors", "[core][json]")
+{
+    {
+        StreamString in;
+        in.print("[\"a string longer than the buffer\", 1]");
+        char text[8];
+        JsonReader json(in, text, sizeof(text));
+        REQUIRE(json.next() == JsonReader::BEGIN_ARRAY);
+        REQUIRE(json.next() == JsonReader::STRING);
+        REQUIRE(json.truncated());
+        REQUIRE(strcmp(text, "a strin") == 0);
+        REQUIRE(json.next() == JsonReader::NUMBER);
+        REQUIRE_FALSE(json.truncated());
+        REQUIRE(json.next() == JsonReader::END_ARRAY);
+        REQUIRE(json.next() == JsonReader::END);
+    }
+    for (const char* doc : {"[1,]", "{\"a\" 1}", "{\"a\":}", "[1 2]", "[tru]", "{1:2}", "[\"open"}) {
+        StreamString in;
+        in.print(doc);
+        in.setTimeout(0);
+        char text[8];
+        JsonReader json(in, text, sizeof(text));
+        JsonReader::Token token;
+        do {
+            token = json.next();
+        } while (token != JsonReader::END && token != JsonReader::ERROR);
+        REQUIRE(token == JsonReader::ERROR);
+    }
+}
+
+TEST_CASE("JsonReader reads what JsonWriter writes, in bounded memory", "[core][json]")
+{
+    StreamString doc;
+    JsonWriter writer(doc);
+    writer.beginObject().key("items").beginArray();
+    for (int i = 0; i < 2000; ++i) {
+        writer.beginObject().member("id", i).member("name", String("item ") + i).endObject();
+    }
+    writer.endArray().endObject();
+    REQUIRE(writer.ok());
+    REQUIRE(doc.length() > 30000);
+
+    char text[16];
+    JsonReader json(doc, text, sizeof(text));
+    long sum = 0;
+    int count = 0;
+    JsonReader::Token token;
+    while ((token = json.next()) != JsonReader::END) {
+        REQUIRE(token != JsonReader::ERROR);
+        if (token == JsonReader::KEY && !strcmp(text, "id")) {
+            REQUIRE(json.next() == JsonReader::NUMBER);
+            sum += json.toInt();
+            count++;
+        }
+    }
+    REQUIRE(count == 2000);
+    REQUIRE(sum == 1999L * 2000 / 2);
+}
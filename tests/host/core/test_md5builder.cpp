@@ -16,6 +16,7 @@
 #include <catch.hpp>
 #include <string.h>
 #include <MD5Builder.h>
+#include <Arduino.h>
 #include <StreamString.h>
 
 TEST_CASE("MD5Builder::add works as expected", "[core][MD5Builder]")
@@ -81,3 +82,88 @@ TEST_CASE("MD5Builder::addStream works", "[core][MD5Builder]"){
         REQUIRE(builder.toString() == "bc4a2006e9d7787ee15fe3d4ef9cdb46");
     }
 }
+
+// a stream of length bytes of 'a' to 'z' that reads without copying around
+class PatternStream : public Stream
+{
+public:
+    PatternStream(size_t length) : _left(length), _pos(0) { }
+    int available() override { return _left; }
+    int read() override
+    {
+        char c;
+        return readBytes(&c, 1) ? c : -1;
+    }
+    int peek() override { return _left ? 'a' + _pos % 26 : -1; }
+    size_t write(uint8_t) override { return 0; }
+    size_t readBytes(char* buffer, size_t length) override
+    {
+        if (length > _left) {
+            length = _left;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            buffer[i] = 'a' + _pos++ % 26;
+        }
+        _left -= length;
+        return length;
+    }
+
+protected:
+    size_t _left;
+    size_t _pos;
+};
+
+TEST_CASE("MD5Builder::addStream keeps its buffer across calls", "[core][MD5Builder]")
+{
+    PatternStream stream(5000);
+    MD5Builder builder;
+    builder.begin();
+    REQUIRE(builder.addStream(stream, 1000));
+    // a copy goes on from the same state with a buffer of its own
+    MD5Builder copy = builder;
+    REQUIRE(builder.addStream(stream, 4000));
+    builder.calculate();
+    REQUIRE(builder.toString() == "cdbcf2a14f7d6777414b4c53f26fdba7");
+
+    PatternStream rest(5000);
+    char skip[1000];
+    rest.readBytes(skip, sizeof(skip));
+    REQUIRE(copy.addStream(rest, rest.available()));
+    copy.calculate();
+    char hex[33];
+    copy.getChars(hex);
+    REQUIRE(strcmp(hex, "cdbcf2a14f7d6777414b4c53f26fdba7") == 0);
+}
+
+// host times compare the versions of the code with each other only
+TEST_CASE("MD5Builder benchmark", "[core][MD5Builder][.benchmark]")
+{
+    const size_t size = 1 << 20;
+    MD5Builder builder;
+    PatternStream stream(size);
+    auto start = micros();
+    builder.begin();
+    REQUIRE(builder.addStream(stream, size));
+    builder.calculate();
+    auto elapsed = micros() - start;
+    printf("{\"bench\":\"md5\",\"op\":\"addStream\",\"size\":%u,\"us\":%u,\"kBps\":%u}\n",
+           (unsigned) size, (unsigned) elapsed, (unsigned) (elapsed ? (uint64_t) size * 1000000 / 1024 / elapsed : 0));
+
+    const int rounds = 20000;
+    volatile size_t sink = 0;
+    start = micros();
+    for (int i = 0; i < rounds; ++i) {
+        sink += builder.toString().length();
+    }
+    elapsed = micros() - start;
+    printf("{\"bench\":\"md5\",\"op\":\"toString\",\"ns\":%u}\n", (unsigned) (elapsed * 1000 / rounds));
+    char hex[33];
+    start = micros();
+    for (int i = 0; i < rounds; ++i) {
+        builder.getChars(hex);
+        sink += hex[0];
+    }
+    elapsed = micros() - start;
+    printf("{\"bench\":\"md5\",\"op\":\"getChars\",\"ns\":%u}\n", (unsigned) (elapsed * 1000 / rounds));
+    (void) sink;
+}
@@ -0,0 +1,112 @@
+/*
+ test_metrics.cpp - the metrics registry and its report
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <Arduino.h>
+#include <StreamString.h>
+#include <Metrics.h>
+
+static uint32_t s_gaugeValue = 0;
+static uint32_t readGauge()
+{
+    return s_gaugeValue;
+}
+
+namespace {
+METRIC_COUNTER(s_frames, "test.frames");
+METRIC_GAUGE(s_queued, "test.queued", readGauge);
+METRIC_HISTOGRAM(s_latency, "test.latency_us");
+}
+
+static size_t metricsCount()
+{
+    size_t count = 0;
+    for (Metric* m = Metric::first(); m; m = m->next()) {
+        ++count;
+    }
+    return count;
+}
+
+static std::string report()
+{
+    StreamString out;
+    REQUIRE(metrics_print(out) == metricsCount());
+    return out.c_str();
+}
+
+TEST_CASE("Metrics count and report", "[core][metrics]")
+{
+    metrics_reset();
+    s_frames.add();
+    s_frames.add(9);
+    s_gaugeValue = 42;
+    CHECK(s_frames.value() == 10);
+
+    std::string text = report();
+    CHECK(text.find("test.frames 10\n") != std::string::npos);
+    CHECK(text.find("test.queued 42\n") != std::string::npos);
+    CHECK(text.find("test.latency_us 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n") != std::string::npos);
+    // in the order they were defined
+    CHECK(text.find("test.frames") < text.find("test.queued"));
+
+    metrics_reset();
+    CHECK(s_frames.value() == 0);
+    // a gauge is read each time
+    s_gaugeValue = 7;
+    CHECK(report().find("test.queued 7\n") != std::string::npos);
+}
+
+TEST_CASE("Metrics histograms fill powers of two", "[core][metrics]")
+{
+    metrics_reset();
+    s_latency.record(0);
+    s_latency.record(1);
+    s_latency.record(3);
+    s_latency.record(4);
+    s_latency.record(1000);
+    s_latency.record(0xffffffff);
+    CHECK(s_latency.count() == 6);
+    CHECK(s_latency.maximum() == 0xffffffff);
+    CHECK(s_latency.bucket(0) == 1);
+    CHECK(s_latency.bucket(1) == 1);
+    CHECK(s_latency.bucket(2) == 1);
+    CHECK(s_latency.bucket(3) == 1);
+    // 1000 is under 2^10
+    CHECK(s_latency.bucket(10) == 1);
+    CHECK(s_latency.bucket(METRICS_HISTOGRAM_BUCKETS - 1) == 1);
+
+    s_latency.reset();
+    CHECK(s_latency.count() == 0);
+    CHECK(s_latency.bucket(10) == 0);
+}
+
+TEST_CASE("Metrics report in pieces", "[core][metrics]")
+{
+    metrics_reset();
+    std::string whole = report();
+
+    // as metrics_send() cuts it into datagrams, whole lines each
+    std::string joined;
+    size_t pieces = 0;
+    for (size_t next = 0; next < metricsCount(); ++pieces) {
+        StreamString out;
+        next = metrics_print(out, next, 20);
+        CHECK(out.length() > 0);
+        CHECK(out.c_str()[out.length() - 1] == '\n');
+        joined += out.c_str();
+    }
+    CHECK(joined == whole);
+    CHECK(pieces == metricsCount());
+}
@@ -0,0 +1,159 @@
+/*
+ test_noniso.cpp - number to text conversions of the core
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <Arduino.h>
+#include <StreamString.h>
+#include "stdlib_noniso.h"
+
+// the digits of value in base, the slow way
+static String digits(unsigned long long value, unsigned base, bool upper)
+{
+    const char* set = upper ? "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ" : "0123456789abcdefghijklmnopqrstuvwxyz";
+    String s;
+    do {
+        s = String(set[value % base]) + s;
+        value /= base;
+    } while (value);
+    return s;
+}
+
+TEST_CASE("ulltoa_end writes the digits in any base", "[core][noniso]")
+{
+    const unsigned long long values[] = {
+        0, 1, 9, 10, 99, 100, 101, 999, 1000, 9999, 10000, 10001, 65535, 65536,
+        99999999, 100000000, 123456789, 999999999, 1000000000, 4294967295ULL,
+        4294967296ULL, 9999999999ULL, 12345678901234567890ULL, 18446744073709551615ULL
+    };
+    char buf[65];
+    char* end = &buf[sizeof(buf)];
+    for (unsigned long long value : values) {
+        for (unsigned base = 2; base <= 36; ++base) {
+            for (bool upper : {false, true}) {
+                char* start = ulltoa_end(value, end, base, upper);
+                REQUIRE(String(start).substring(0, end - start) == digits(value, base, upper));
+            }
+        }
+    }
+    for (unsigned long long value = 0; value < 300000; value += 7) {
+        char* start = ulltoa_end(value, end, 10, false);
+        REQUIRE(strtoull(String(start).substring(0, end - start).c_str(), nullptr, 10) == value);
+    }
+}
+
+TEST_CASE("ltoa and ultoa", "[core][noniso]")
+{
+    char buf[2 + 8 * sizeof(long)];
+    CHECK(String(ltoa(-123456, buf, 10)) == "-123456");
+    CHECK(String(ltoa(0, buf, 10)) == "0");
+    CHECK(String(ltoa(-255, buf, 16)) == "-ff");
+    CHECK(String(ltoa(35, buf, 36)) == "z");
+    snprintf(buf, sizeof(buf), "%ld", LONG_MIN);
+    String expected = buf;
+    CHECK(String(ltoa(LONG_MIN, buf, 10)) == expected);
+    CHECK(String(ultoa(4294967295UL, buf, 10)) == "4294967295");
+    CHECK(String(ultoa(5, buf, 2)) == "101");
+    CHECK(String(ultoa(5, buf, 37)) == "");
+}
+
+static void checkFixed(double value, unsigned prec)
+{
+    char expected[400];
+    char buf[24 + 256];
+    snprintf(expected, sizeof(expected), "%.*f", prec, value);
+    size_t len = dtoa_fixed(value, prec, buf);
+    INFO(expected);
+    if (!len) {
+        // left to printf
+        REQUIRE(fabs(value) < ldexp(1, -75));
+        REQUIRE(prec > 22);
+        return;
+    }
+    REQUIRE(len == strlen(expected));
+    REQUIRE(String(buf) == expected);
+}
+
+TEST_CASE("dtoa_fixed rounds as printf does", "[core][noniso]")
+{
+    const double values[] = {
+        0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.375, 1.005, 1.999, 9.9999, 99.5, 0.05,
+        0.15, 0.25, 0.35, 1e-5, 5e-7, 4.9e-324, 2.2250738585072014e-308, 1e-20,
+        3.14159265358979, -3.14159265358979, 123456.789, 4294967295.5,
+        9007199254740993.0, 1e18, 18446744073709549568.0, -1e19
+    };
+    for (double value : values) {
+        for (unsigned prec = 0; prec <= 30; ++prec) {
+            checkFixed(value, prec);
+        }
+        checkFixed(value, 255);
+    }
+    // numbers of all sizes, with all their bits set in patterns
+    uint64_t seed = 1;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        int exp = (int) (seed >> 57) - 100;   // 2^-100 to 2^27
+        double value = ldexp((double) (seed & ((1ULL << 53) - 1)), exp - 53);
+        checkFixed((seed & 1) ? -value : value, (seed >> 40) % 40);
+    }
+    for (int cents = -100000; cents <= 100000; ++cents) {
+        checkFixed(cents / 100.0, 2);
+        checkFixed(cents / 1000.0, 2);
+    }
+
+    char buf[32];
+    CHECK(dtoa_fixed(NAN, 2, buf) == 0);
+    CHECK(dtoa_fixed(INFINITY, 2, buf) == 0);
+    CHECK(dtoa_fixed(18446744073709551616.0, 2, buf) == 0);
+}
+
+TEST_CASE("dtostrf pads and goes past 2^64", "[core][noniso]")
+{
+    char buf[400];
+    CHECK(String(dtostrf(3.14159, 8, 2, buf)) == "    3.14");
+    CHECK(String(dtostrf(-3.14159, 8, 3, buf)) == "  -3.142");
+    CHECK(String(dtostrf(12345.678, 2, 1, buf)) == "12345.7");
+    CHECK(String(dtostrf(NAN, 8, 2, buf)) == "nan");
+    CHECK(String(dtostrf(-INFINITY, 8, 2, buf)) == "inf");
+    CHECK(String(dtostrf(1e20, 2, 1, buf)) == "100000000000000000000.0");
+}
+
+TEST_CASE("Print and String format numbers", "[core][noniso]")
+{
+    StreamString out;
+    out.print(255, HEX);
+    out.print(' ');
+    out.print(-42);
+    out.print(' ');
+    out.print(1.999, 2);
+    out.print(' ');
+    out.print(-0.0051, 2);
+    out.print(' ');
+    out.print(2.5, 0);
+    out.print(' ');
+    out.print(5000000000.0, 1);
+    CHECK(out == "FF -42 2.00 -0.01 2 ovf");
+    CHECK(String(0.1f, 3) == "0.100");
+    CHECK(String(-12.3456, 2) == "-12.35");
+    CHECK(String(7, 2) == "111");
+    CHECK(String(-7) == "-7");
+    String s;
+    s += 1.5f;
+    s += ' ';
+    s += 4294967295UL;
+    CHECK(s == "1.50 4294967295");
+}
@@ -15,6 +15,8 @@
 
 #include <catch.hpp>
 #include <string.h>
+#include <string>
+#include <Arduino.h>
 #include <pgmspace.h>
 
 TEST_CASE("strstr_P works as strstr", "[core][pgmspace]")
@@ -53,3 +55,107 @@ TEST_CASE("strstr_P works as strstr", "[core][pgmspace]")
     t("_foo_foo", "foo");
     t("A", "a");
 }
+
+// at every alignment of the source, so the bytes before and after the
+// words read whole are covered
+alignas(4) static const char s_text[] PROGMEM = "Content-Type: text/html; charset=utf-8\r\nContent-Length: 0\r\n";
+
+TEST_CASE("strnlen_P, memcpy_P, strncpy_P work as the functions without _P", "[core][pgmspace]")
+{
+    for (size_t offset = 0; offset < 8; ++offset) {
+        const char* src = s_text + offset;
+        for (size_t size = 0; size < sizeof(s_text) + 4; ++size) {
+            REQUIRE(strnlen_P(src, size) == strnlen(src, size));
+
+            char expected[sizeof(s_text) + 16];
+            char result[sizeof(s_text) + 16];
+            for (size_t destOffset = 0; destOffset < 4; ++destOffset) {
+                size_t count = (size < sizeof(s_text) - offset) ? size : sizeof(s_text) - offset;
+                memset(expected, '#', sizeof(expected));
+                memset(result, '#', sizeof(result));
+                memcpy(expected + destOffset, src, count);
+                REQUIRE(memcpy_P(result + destOffset, src, count) == result + destOffset);
+                REQUIRE(memcmp(expected, result, sizeof(result)) == 0);
+
+                memset(expected, '#', sizeof(expected));
+                memset(result, '#', sizeof(result));
+                strncpy(expected + destOffset, src, size);
+                REQUIRE(strncpy_P(result + destOffset, src, size) == result + destOffset);
+                REQUIRE(memcmp(expected, result, sizeof(result)) == 0);
+            }
+        }
+        REQUIRE(strlen_P(src) == strlen(src));
+        char copy[sizeof(s_text)];
+        strcpy_P(copy, src);
+        REQUIRE(strcmp(copy, src) == 0);
+    }
+}
+
+TEST_CASE("strncmp_P works as strncmp", "[core][pgmspace]")
+{
+    auto sign = [](int x) { return (x > 0) - (x < 0); };
+    for (size_t offset = 0; offset < 8; ++offset) {
+        const char* p = s_text + offset;
+        std::string same(p);
+        std::string longer = same + "x";
+        std::string shorter = same.substr(0, same.size() / 2);
+        std::string changed = same;
+        changed[changed.size() - 3] = 'Z';
+        for (size_t size = 0; size < sizeof(s_text) + 4; ++size) {
+            REQUIRE(sign(strncmp_P(same.c_str(), p, size)) == sign(strncmp(same.c_str(), p, size)));
+            REQUIRE(sign(strncmp_P(longer.c_str(), p, size)) == sign(strncmp(longer.c_str(), p, size)));
+            REQUIRE(sign(strncmp_P(shorter.c_str(), p, size)) == sign(strncmp(shorter.c_str(), p, size)));
+            REQUIRE(sign(strncmp_P(changed.c_str(), p, size)) == sign(strncmp(changed.c_str(), p, size)));
+        }
+        REQUIRE(strcmp_P(same.c_str(), p) == 0);
+        REQUIRE(strcmp_P(changed.c_str(), p) != 0);
+    }
+}
+
+TEST_CASE("String from a flash string", "[core][pgmspace]")
+{
+    for (size_t offset = 0; offset < 4; ++offset) {
+        const __FlashStringHelper* f = reinterpret_cast<const __FlashStringHelper*>(s_text + offset);
+        String s(f);
+        REQUIRE(s == String(s_text + offset));
+        String t("head ");
+        t += f;
+        REQUIRE(t == String("head ") + String(s_text + offset));
+    }
+}
+
+template<typename F>
+static void benchPgmspace(const char* op, size_t size, F f)
+{
+    const int rounds = 20000;
+    auto start = micros();
+    for (int i = 0; i < rounds; ++i) {
+        f();
+    }
+    auto elapsed = micros() - start;
+    printf("{\"bench\":\"pgmspace\",\"op\":\"%s\",\"size\":%u,\"ns\":%u}\n",
+           op, (unsigned) size, (unsigned) (elapsed * 1000 / rounds));
+}
+
+// times on the host only compare the functions with each other, on the
+// device every load from flash goes through the cache
+TEST_CASE("pgmspace benchmark", "[core][pgmspace][.benchmark]")
+{
+    static const size_t sizes[] = { 8, 32, 256 };
+    alignas(4) static char flash[257];
+    for (size_t i = 0; i < 256; ++i) {
+        flash[i] = 'a' + i % 26;
+    }
+    char ram[260];
+    volatile size_t sink = 0;
+    for (size_t size : sizes) {
+        flash[size] = 0;
+        benchPgmspace("strnlen_P", size, [&] { sink += strnlen_P(flash + 1, SIZE_IRRELEVANT); });
+        benchPgmspace("memcpy_P", size, [&] { memcpy_P(ram, flash + 1, size - 1); sink += ram[0]; });
+        benchPgmspace("strncpy_P", size, [&] { strncpy_P(ram, flash + 1, SIZE_IRRELEVANT); sink += ram[0]; });
+        strcpy(ram, flash + 1);
+        benchPgmspace("strncmp_P", size, [&] { sink += strncmp_P(ram, flash + 1, SIZE_IRRELEVANT); });
+        flash[size] = 'a' + size % 26;
+    }
+    (void) sink;
+}
@@ -0,0 +1,84 @@
+/*
+ test_sha256builder.cpp - SHA256Builder tests
+ This file is part of the esp8266 core for Arduino environment.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <SHA256Builder.h>
+#include <StreamString.h>
+
+TEST_CASE("SHA256Builder gives the FIPS 180-2 digests", "[core][SHA256Builder]")
+{
+    SHA256Builder builder;
+    builder.begin();
+    builder.calculate();
+    REQUIRE(builder.toString() == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    builder.begin();
+    builder.add("abc");
+    builder.calculate();
+    REQUIRE(builder.toString() == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    // 56 bytes, the padding takes a block of its own
+    builder.begin();
+    builder.add("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+    builder.calculate();
+    REQUIRE(builder.toString() == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST_CASE("SHA256Builder::add takes pieces of any size", "[core][SHA256Builder]")
+{
+    uint8_t data[1000];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i;
+    }
+    for (size_t piece : {(size_t) 1, (size_t) 63, (size_t) 64, (size_t) 100, sizeof(data)}) {
+        SHA256Builder builder;
+        builder.begin();
+        for (size_t pos = 0; pos < sizeof(data); pos += piece) {
+            builder.add(data + pos, (sizeof(data) - pos < piece) ? sizeof(data) - pos : piece);
+        }
+        builder.calculate();
+        REQUIRE(builder.toString() == "a8af099bf2e878609558dbf69d8f88f4a31040a8cf84b549a0cfa912f12ffc3f");
+        uint8_t bytes[32];
+        builder.getBytes(bytes);
+        REQUIRE(bytes[0] == 0xa8);
+        REQUIRE(bytes[31] == 0x3f);
+    }
+}
+
+TEST_CASE("SHA256Builder::addStream reads in chunks up to maxLen", "[core][SHA256Builder]")
+{
+    SHA256Builder builder;
+    {
+        StreamString stream;
+        for (int i = 0; i < 3000; ++i) {
+            stream.print((char) ('a' + i % 26));
+        }
+        builder.begin();
+        REQUIRE(builder.addStream(stream, stream.available()));
+        builder.calculate();
+        REQUIRE(builder.toString() == "9c81a321274950833a44af66aea4d47aaac4957b66e728aa3f2744b9a30e541e");
+    }
+    {
+        StreamString stream;
+        for (int i = 0; i < 3000; ++i) {
+            stream.print((char) ('a' + i % 26));
+        }
+        builder.begin();
+        REQUIRE(builder.addStream(stream, 100));
+        builder.calculate();
+        REQUIRE(builder.toString() == "2ac123dcd759eebabfa1b17c0332b88b3815ef3f95fbfcceb5fac07e233235bd");
+    }
+}
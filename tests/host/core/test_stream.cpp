@@ -0,0 +1,118 @@
+/*
+ test_stream.cpp - Stream parsing methods, with and without a peek buffer
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <Arduino.h>
+#include <StreamString.h>
+
+// A stream of bytes without a peek buffer, for the read() per byte path
+class ByteStream: public Stream {
+public:
+    ByteStream(const char* data) : _data(data) {}
+
+    int available() override {
+        return strlen(_data);
+    }
+    int read() override {
+        return *_data ? (uint8_t) *_data++ : -1;
+    }
+    int peek() override {
+        return *_data ? (uint8_t) *_data : -1;
+    }
+    size_t write(uint8_t) override {
+        return 0;
+    }
+
+protected:
+    const char* _data;
+};
+
+// The same in pieces of a few bytes, as from pbufs
+class PieceStream: public ByteStream {
+public:
+    PieceStream(const char* data, size_t piece) : ByteStream(data), _piece(piece) {}
+
+    bool hasPeekBufferAPI() const override {
+        return true;
+    }
+    const char* peekBuffer() override {
+        return _data;
+    }
+    size_t peekAvailable() override {
+        return std::min(strlen(_data), _piece);
+    }
+    void peekConsume(size_t consume) override {
+        _data += consume;
+    }
+
+protected:
+    size_t _piece;
+};
+
+static const char s_text[] = "GET /path HTTP/1.1\r\nHost: esp\r\nContent-Length: -42, 3.25\r\n\r\nbody";
+
+template<typename TStream>
+static void checkParsing(TStream& stream)
+{
+    stream.setTimeout(0);
+    CHECK(stream.readStringUntil(' ') == "GET");
+    char buffer[32];
+    size_t got = stream.readBytesUntil('\n', buffer, sizeof(buffer));
+    CHECK(String(buffer).substring(0, got) == "/path HTTP/1.1\r");
+    CHECK(stream.find("Content-Length:"));
+    CHECK(stream.parseInt() == -42);
+    CHECK(stream.parseFloat() == 3.25f);
+    CHECK(stream.findUntil("body", "\r\n\r\n") == false);
+    got = stream.readBytes(buffer, 2);
+    CHECK(got == 2);
+    CHECK(memcmp(buffer, "bo", 2) == 0);
+    CHECK(stream.readString() == "dy");
+    CHECK(stream.readStringUntil('\n') == "");
+    CHECK_FALSE(stream.find("x"));
+}
+
+TEST_CASE("Stream parses the same with a peek buffer", "[core][stream]")
+{
+    ByteStream bytes(s_text);
+    checkParsing(bytes);
+    for (size_t piece : { 1, 3, 7, 100 }) {
+        PieceStream pieces(s_text, piece);
+        checkParsing(pieces);
+    }
+    StreamString string;
+    string += s_text;
+    checkParsing(string);
+    CHECK(string.length() == 0);
+}
+
+TEST_CASE("Stream find goes across pieces", "[core][stream]")
+{
+    for (size_t piece : { 1, 2, 5 }) {
+        PieceStream stream("xxabcabdxxend", piece);
+        stream.setTimeout(0);
+        REQUIRE(stream.find("abd"));
+        CHECK(stream.peek() == 'x');
+        CHECK_FALSE(stream.findUntil("zz", "end"));
+        CHECK(stream.available() == 0);
+    }
+    // a null ends the search, as with read() per byte
+    static const char withNull[] = "ab\0cd";
+    ByteStream bytes(withNull);
+    PieceStream pieces(withNull, 10);
+    bytes.setTimeout(0);
+    pieces.setTimeout(0);
+    CHECK_FALSE(bytes.find("cd"));
+    CHECK_FALSE(pieces.find("cd"));
+}
@@ -0,0 +1,151 @@
+/*
+ test_streamcopy.cpp - streamCopy() from sources with and without a peek buffer
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <string>
+#include <Arduino.h>
+#include <StreamString.h>
+#include <StreamCopy.h>
+
+// A source without a peek buffer, which may have more to come
+class ByteSource: public Stream {
+public:
+    ByteSource(const std::string& data, bool ends) : _data(data), _ends(ends) {}
+
+    int available() override {
+        return _data.size() - _pos;
+    }
+    int read() override {
+        return (_pos < _data.size()) ? (uint8_t) _data[_pos++] : -1;
+    }
+    int peek() override {
+        return (_pos < _data.size()) ? (uint8_t) _data[_pos] : -1;
+    }
+    size_t readBytes(char* buffer, size_t length) override {
+        ++reads;
+        size_t n = std::min(length, _data.size() - _pos);
+        memcpy(buffer, _data.data() + _pos, n);
+        _pos += n;
+        return n;
+    }
+    size_t write(uint8_t) override {
+        return 0;
+    }
+    bool inputCanTimeout() override {
+        return !_ends;
+    }
+
+    int reads = 0;
+
+protected:
+    std::string _data;
+    size_t _pos = 0;
+    bool _ends;
+};
+
+// Takes at most limit bytes per write, none once full
+class SlowSink: public Print {
+public:
+    SlowSink(size_t limit, size_t capacity = SIZE_MAX) : _limit(limit), _capacity(capacity) {}
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        size = std::min(std::min(size, _limit), _capacity - data.size());
+        data.append((const char*) buffer, size);
+        return size;
+    }
+    using Print::setWriteError;
+
+    std::string data;
+
+protected:
+    size_t _limit;
+    size_t _capacity;
+};
+
+static std::string makeData(size_t size)
+{
+    std::string data;
+    for (size_t i = 0; i < size; ++i) {
+        data += (char) ('A' + i % 23);
+    }
+    return data;
+}
+
+TEST_CASE("streamCopy writes from the peek buffer", "[core][streamcopy]")
+{
+    std::string data = makeData(3000);
+    StreamString src;
+    src += data.c_str();
+    SlowSink dst(100);
+    StreamCopyStats stats;
+    REQUIRE(streamCopy(src, dst, SIZE_MAX, 100, &stats) == data.size());
+    CHECK(dst.data == data);
+    CHECK(stats.bytes == data.size());
+    CHECK(stats.zeroCopy);
+    // a StreamString has nothing more to wait for
+    CHECK(stats.result == STREAMCOPY_END);
+    CHECK(src.length() == 0);
+}
+
+TEST_CASE("streamCopy goes through a buffer otherwise", "[core][streamcopy]")
+{
+    std::string data = makeData(1000);
+    ByteSource src(data, true);
+    SlowSink dst(70);
+    StreamCopyStats stats;
+    REQUIRE(streamCopy(src, dst, 600, 100, &stats) == 600);
+    CHECK(dst.data == data.substr(0, 600));
+    CHECK_FALSE(stats.zeroCopy);
+    CHECK(stats.result == STREAMCOPY_DONE);
+    // 256 bytes at a time on the stack
+    CHECK(src.reads == 3);
+
+    REQUIRE(streamCopyBuffer(1024));
+    src.reads = 0;
+    REQUIRE(streamCopy(src, dst, SIZE_MAX, 100, &stats) == 400);
+    CHECK(dst.data == data);
+    CHECK(src.reads == 1);
+    CHECK(stats.result == STREAMCOPY_END);
+    REQUIRE(streamCopyBuffer(0));
+}
+
+TEST_CASE("streamCopy times out on either side", "[core][streamcopy]")
+{
+    std::string data = makeData(500);
+    // the source may still send more
+    ByteSource open(data, false);
+    SlowSink dst(SIZE_MAX);
+    StreamCopyStats stats;
+    REQUIRE(streamCopy(open, dst, SIZE_MAX, 20, &stats) == data.size());
+    CHECK(stats.result == STREAMCOPY_SOURCE_TIMEOUT);
+    CHECK(stats.ms >= 20);
+    CHECK(stats.waits > 0);
+
+    StreamString src;
+    src += data.c_str();
+    SlowSink full(SIZE_MAX, 300);
+    REQUIRE(streamCopy(src, full, SIZE_MAX, 20, &stats) == 300);
+    CHECK(stats.result == STREAMCOPY_WRITE_TIMEOUT);
+    // what wasn't written stays in a peek buffer source
+    CHECK(src.length() == 200);
+
+    SlowSink failing(SIZE_MAX);
+    failing.setWriteError();
+    CHECK(streamCopy(src, failing, SIZE_MAX, 20, &stats) == 200);
+    CHECK(stats.result == STREAMCOPY_WRITE_ERROR);
+}
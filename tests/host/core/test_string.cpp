@@ -0,0 +1,353 @@
+/*
+ test_string.cpp - String editing
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <WString.h>
+#include "../common/alloc_mock.h"
+
+// a String that shows where its text is kept
+class StringProbe : public String
+{
+public:
+    StringProbe(const char* cstr = "") : String(cstr) {}
+    StringProbe(const String& str) : String(str) {}
+    StringProbe(String&& str) : String(std::move(str)) {}
+    using String::operator=;
+
+    bool isInline() const { return isSSO(); }
+    unsigned int cap() const { return capacity(); }
+    static unsigned int inlineSize() { return SSOSIZE; }
+    static unsigned int capacityMax() { return CAPACITY_MAX; }
+};
+
+static std::string repeat(char c, size_t n)
+{
+    return std::string(n, c);
+}
+
+TEST_CASE("String stays inline up to SSOSIZE", "[core][String]")
+{
+    const unsigned int longest = StringProbe::inlineSize() - 1;
+    StringProbe s(repeat('a', longest).c_str());
+    CHECK(s.isInline());
+    CHECK(s.length() == longest);
+    CHECK(s.cap() == longest);
+
+    // one more char moves it to the heap, text and length along
+    s += 'b';
+    CHECK(!s.isInline());
+    CHECK(s.length() == longest + 1);
+    CHECK(std::string(s.c_str()) == repeat('a', longest) + "b");
+    CHECK(strlen(s.c_str()) == s.length());
+
+    StringProbe direct(repeat('c', longest + 1).c_str());
+    CHECK(!direct.isInline());
+    CHECK(direct.length() == longest + 1);
+
+    StringProbe empty;
+    CHECK(empty.isInline());
+    CHECK(empty.length() == 0);
+    CHECK(empty == "");
+}
+
+TEST_CASE("String copy between inline and heap values", "[core][String]")
+{
+    const std::string shortText = "short";
+    const std::string longText = repeat('x', StringProbe::inlineSize() * 3);
+
+    StringProbe small(shortText.c_str());
+    StringProbe big(longText.c_str());
+
+    StringProbe copy(big);
+    CHECK(!copy.isInline());
+    CHECK(copy.c_str() != big.c_str());
+    CHECK(std::string(copy.c_str()) == longText);
+
+    // inline onto heap and heap onto inline
+    copy = small;
+    CHECK(std::string(copy.c_str()) == shortText);
+    CHECK(copy.length() == shortText.length());
+    StringProbe other(small);
+    CHECK(other.isInline());
+    other = big;
+    CHECK(!other.isInline());
+    CHECK(std::string(other.c_str()) == longText);
+
+    // the copies don't share anything
+    other.setCharAt(0, 'y');
+    copy.setCharAt(0, 'S');
+    CHECK(big[0] == 'x');
+    CHECK(small[0] == 's');
+}
+
+TEST_CASE("String move between inline and heap values", "[core][String]")
+{
+    const std::string longText = repeat('m', StringProbe::inlineSize() * 2);
+
+    // a heap string changes owner, the buffer isn't copied
+    StringProbe big(longText.c_str());
+    const char* buffer = big.c_str();
+    StringProbe moved(std::move(big));
+    CHECK(moved.c_str() == buffer);
+    CHECK(std::string(moved.c_str()) == longText);
+    CHECK(big.length() == 0);
+    CHECK(big == "");
+
+    // an inline one is copied, the source is left empty
+    StringProbe small("tiny");
+    StringProbe movedSmall(std::move(small));
+    CHECK(movedSmall.isInline());
+    CHECK(movedSmall == "tiny");
+    CHECK(small.length() == 0);
+    CHECK(small == "");
+
+    // into a heap string with room: copied, nothing reallocated
+    StringProbe roomy(repeat('r', StringProbe::inlineSize() * 4).c_str());
+    const char* roomyBuffer = roomy.c_str();
+    StringProbe source(longText.c_str());
+    roomy = std::move(source);
+    CHECK(roomy.c_str() == roomyBuffer);
+    CHECK(std::string(roomy.c_str()) == longText);
+    CHECK(source.length() == 0);
+
+    // a heap string moved onto an inline one
+    StringProbe target("abc");
+    StringProbe heap(longText.c_str());
+    buffer = heap.c_str();
+    target = std::move(heap);
+    CHECK(!target.isInline());
+    CHECK(target.c_str() == buffer);
+    CHECK(std::string(target.c_str()) == longText);
+
+    // and an inline one onto a heap one
+    StringProbe heapTarget(longText.c_str());
+    StringProbe inlineSource("xyz");
+    heapTarget = std::move(inlineSource);
+    CHECK(heapTarget == "xyz");
+    CHECK(heapTarget.length() == 3);
+}
+
+TEST_CASE("String appends a part of itself", "[core][String]")
+{
+    // inline to heap on the way
+    StringProbe s("0123456789");
+    std::string ref = "0123456789";
+    s += s;
+    ref += ref;
+    CHECK(std::string(s.c_str()) == ref);
+    s.concat(s.c_str() + 3, 5);
+    ref += ref.substr(3, 5);
+    CHECK(std::string(s.c_str()) == ref);
+
+    // full, so that the append reallocates what it copies from
+    while (s.length() < s.cap()) {
+        s += 'f';
+        ref += 'f';
+    }
+    s.concat(s.c_str() + 1, s.length() - 1);
+    ref += ref.substr(1);
+    CHECK(std::string(s.c_str()) == ref);
+    CHECK(s.length() == ref.length());
+
+    s += s.c_str() + s.length() - 4;
+    ref += ref.substr(ref.length() - 4);
+    CHECK(std::string(s.c_str()) == ref);
+}
+
+TEST_CASE("String capacity is limited to 65535", "[core][String]")
+{
+    const unsigned int max = StringProbe::capacityMax();
+    REQUIRE(max == 65535);
+
+    StringProbe s("start");
+    CHECK(!s.reserve(max + 1));
+    CHECK(s == "start");
+    REQUIRE(s.reserve(max));
+    CHECK(s.cap() == max);
+
+    std::string text = repeat('z', max);
+    s = text.c_str();
+    CHECK(s.length() == max);
+    // no room for more, and the string is left as it was
+    CHECK(!s.concat('!'));
+    CHECK(!s.concat("more"));
+    CHECK(s.length() == max);
+    CHECK(std::string(s.c_str()) == text);
+
+    StringProbe tooLong(repeat('q', max + 1).c_str());
+    CHECK(!tooLong);
+}
+
+TEST_CASE("String grows geometrically when appended to", "[core][String]")
+{
+    StringProbe s;
+    std::vector<unsigned int> caps;
+    caps.reserve(64);
+    caps.push_back(s.cap());
+
+    AllocMock::Counters before = AllocMock::counters();
+    for (int i = 0; i < 10000; ++i) {
+        s += 'g';
+        if (s.cap() != caps.back() && caps.size() < caps.capacity()) {
+            caps.push_back(s.cap());
+        }
+    }
+    AllocMock::Counters after = AllocMock::counters();
+
+    REQUIRE(s.length() == 10000);
+    REQUIRE(caps.size() < caps.capacity());
+    // each step grows by half at least, a dozen or so in all
+    for (size_t i = 1; i < caps.size(); ++i) {
+        CHECK(caps[i] >= caps[i - 1] + caps[i - 1] / 2);
+    }
+    CHECK(caps.size() <= 20);
+    if (AllocMock::available()) {
+        uint64_t allocs = after.allocs - before.allocs;
+        CHECK(allocs == caps.size() - 1);
+    }
+}
+
+TEST_CASE("String shrink_to_fit moves short text back inline", "[core][String]")
+{
+    StringProbe s(repeat('h', StringProbe::inlineSize() * 4).c_str());
+    REQUIRE(!s.isInline());
+    s.remove(5);
+    CHECK(!s.isInline());
+    s.shrink_to_fit();
+    CHECK(s.isInline());
+    CHECK(s == "hhhhh");
+    CHECK(s.length() == 5);
+    s += "!";
+    CHECK(s == "hhhhh!");
+
+    // long enough to stay on the heap, the buffer is cut to size
+    StringProbe t;
+    REQUIRE(t.reserve(1000));
+    t = repeat('t', StringProbe::inlineSize() + 10).c_str();
+    t.shrink_to_fit();
+    CHECK(!t.isInline());
+    CHECK(t.cap() < 1000);
+    CHECK(t.cap() >= t.length());
+    CHECK(std::string(t.c_str()) == repeat('t', StringProbe::inlineSize() + 10));
+}
+
+TEST_CASE("String growth falls back to the exact size", "[core][String]")
+{
+    if (!AllocMock::available()) {
+        return;
+    }
+    StringProbe s;
+    REQUIRE(s.reserve(1000));
+    const unsigned int cap = s.cap();
+    s = repeat('e', cap).c_str();
+    REQUIRE(s.cap() == cap);
+
+    // the headroom doesn't fit under the limit, one more char does
+    AllocMock::failAbove(cap + 1 + 64);
+    bool appended = s.concat('!');
+    AllocMock::failAbove(0);
+    CHECK(appended);
+    CHECK(s.length() == cap + 1);
+    CHECK(s.cap() >= cap + 1);
+    CHECK(s.cap() < cap + cap / 2);
+    CHECK(std::string(s.c_str()) == repeat('e', cap) + "!");
+
+    // nothing fits, the string is left alone
+    std::string more = repeat('x', s.cap());
+    AllocMock::failAbove(s.cap());
+    appended = s.concat(more.c_str());
+    AllocMock::failAbove(0);
+    CHECK(!appended);
+    CHECK(s.length() == cap + 1);
+    CHECK(std::string(s.c_str()) == repeat('e', cap) + "!");
+}
+
+TEST_CASE("String::replace of the same length", "[core][String]")
+{
+    String s = "one two one";
+    s.replace("one", "ONE");
+    CHECK(s == "ONE two ONE");
+    s.replace("zzz", "yyy");
+    CHECK(s == "ONE two ONE");
+}
+
+TEST_CASE("String::replace shrinks the string", "[core][String]")
+{
+    String s = "<b>bold</b> and <b>more</b>";
+    s.replace("<b>", "*");
+    CHECK(s == "*bold</b> and *more</b>");
+    CHECK(s.length() == strlen(s.c_str()));
+    s.replace("</b>", "");
+    CHECK(s == "*bold and *more");
+    s.replace("*bold and *more", "");
+    CHECK(s == "");
+    CHECK(s.length() == 0);
+}
+
+TEST_CASE("String::replace grows the string", "[core][String]")
+{
+    // inline, then on the heap
+    String s = "a-b-c";
+    s.replace("-", ", ");
+    CHECK(s == "a, b, c");
+    s.replace(", ", " and then a much longer separator ");
+    CHECK(s == "a and then a much longer separator b and then a much longer separator c");
+    CHECK(s.length() == strlen(s.c_str()));
+
+    // matches at both ends, and back to back
+    s = "xxaxx";
+    s.replace("x", "yz");
+    CHECK(s == "yzyzayzyz");
+    s = "aaaa";
+    s.replace("aa", "b");
+    CHECK(s == "bb");
+    s = "aaa";
+    s.replace("aa", "bbb");
+    CHECK(s == "bbba");
+}
+
+TEST_CASE("String::replace of several finds at once", "[core][String]")
+{
+    static const char* const keys[] = { "%TITLE%", "%NAME%", "%TITLE" };
+    String values[] = { "Status", "a rather long device name, to go past the inline buffer", "unused" };
+    String page = "<h1>%TITLE%</h1><p>%NAME% is up</p><!--%TITLE%-->%TITLE";
+    page.replace(keys, values, 3);
+    CHECK(page == "<h1>Status</h1><p>a rather long device name, to go past the inline buffer is up</p>"
+                  "<!--Status-->unused");
+
+    // shrinking, and nothing to replace
+    String small = "%NAME%%NAME%";
+    values[1] = "n";
+    small.replace(keys, values, 2);
+    CHECK(small == "nn");
+    small.replace(keys, values, 2);
+    CHECK(small == "nn");
+    String empty;
+    empty.replace(keys, values, 2);
+    CHECK(empty == "");
+}
+
+TEST_CASE("String::trim", "[core][String]")
+{
+    String s = "   the quick brown fox jumps over the lazy dog  \r\n";
+    s.trim();
+    CHECK(s == "the quick brown fox jumps over the lazy dog");
+    s = " \t ";
+    s.trim();
+    CHECK(s == "");
+}
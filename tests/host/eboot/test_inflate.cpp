@@ -0,0 +1,422 @@
+/*
+ test_inflate.cpp - tests of eboot's decompressor
+ This file is part of the esp8266 core for Arduino environment.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <vector>
+
+// flash in RAM, for the ROM functions eboot calls: writing only clears bits
+static std::vector<uint8_t> s_flash(0x40000, 0xff);
+static size_t s_erases;
+static size_t s_writes;
+static uint8_t s_window[0x8000];
+
+extern "C" {
+
+#define INFLATE_WINDOW s_window
+#include "../../bootloaders/eboot/inflate.c"
+
+int SPIRead(uint32_t addr, void* dest, size_t size)
+{
+    if (addr + size > s_flash.size()) {
+        return 1;
+    }
+    memcpy(dest, &s_flash[addr], size);
+    return 0;
+}
+
+int SPIWrite(uint32_t addr, void* src, size_t size)
+{
+    if ((addr & 3) || (size & 3) || addr + size > s_flash.size()) {
+        return 1;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        s_flash[addr + i] &= ((const uint8_t*) src)[i];
+    }
+    ++s_writes;
+    return 0;
+}
+
+int SPIEraseSector(uint32_t sector)
+{
+    if ((sector + 1) * FLASH_SECTOR_SIZE > s_flash.size()) {
+        return 1;
+    }
+    memset(&s_flash[sector * FLASH_SECTOR_SIZE], 0xff, FLASH_SECTOR_SIZE);
+    ++s_erases;
+    return 0;
+}
+
+}
+
+// gzip -9 of image() below: dynamic blocks, with matches 10300 bytes back
+static const uint8_t s_dynamic[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xed, 0x98, 0x4b, 0x96, 0x1c, 0x29,
+    0x0c, 0x45, 0xbd, 0x55, 0x7e, 0x92, 0x40, 0x42, 0xb0, 0xff, 0x51, 0x5f, 0xb2, 0x37, 0xe0, 0x89,
+    0x67, 0x51, 0xe7, 0xd8, 0xed, 0xca, 0xce, 0x20, 0x40, 0x7a, 0x3f, 0xa1, 0xa7, 0x46, 0x44, 0x8b,
+    0xa1, 0x79, 0xf7, 0xae, 0x56, 0x6f, 0x3d, 0xda, 0xae, 0x99, 0xda, 0xf2, 0xb9, 0x97, 0x6b, 0x8f,
+    0x26, 0x75, 0xee, 0x21, 0xd7, 0x8e, 0x84, 0xb7, 0x35, 0x77, 0x77, 0x3d, 0x77, 0xad, 0x7b, 0xaf,
+    0x9e, 0x3e, 0x33, 0xfd, 0xa8, 0x0f, 0x3d, 0x7b, 0xe5, 0xb9, 0x5a, 0x4b, 0x89, 0x5b, 0xa7, 0x14,
+    0x59, 0xbb, 0xa7, 0xc7, 0x5c, 0xad, 0xb7, 0xd4, 0xeb, 0xd2, 0xb4, 0xf3, 0x4b, 0x3d, 0xbb, 0xcd,
+    0xba, 0x9b, 0x4a, 0xd5, 0x6b, 0xba, 0x52, 0x7d, 0x0e, 0x99, 0xdb, 0x76, 0x8d, 0xac, 0xe7, 0x96,
+    0x65, 0x35, 0x6e, 0xcf, 0x5a, 0x52, 0x32, 0xa3, 0xe7, 0x39, 0xf7, 0xe8, 0x1c, 0xea, 0xb5, 0xf7,
+    0x3a, 0x87, 0x85, 0x97, 0x52, 0xfb, 0x5d, 0xc5, 0x5a, 0x97, 0x52, 0xab, 0x49, 0x93, 0x79, 0xcf,
+    0x59, 0x31, 0x6e, 0xc9, 0x75, 0x3c, 0xb4, 0x14, 0x96, 0xde, 0x2a, 0x9c, 0x20, 0x4a, 0xd8, 0x1a,
+    0x6c, 0x61, 0x16, 0x51, 0x13, 0xb3, 0x5d, 0x46, 0xf4, 0xc1, 0x5e, 0x76, 0x17, 0xbe, 0xec, 0xbd,
+    0x64, 0x54, 0x9e, 0xde, 0xb6, 0x6a, 0xf7, 0x23, 0xde, 0xf7, 0xac, 0x5a, 0x43, 0x6c, 0x38, 0x47,
+    0xd4, 0x56, 0xb2, 0x4a, 0x33, 0xaa, 0x70, 0x6e, 0xea, 0xdc, 0x7c, 0x7d, 0xd4, 0x1d, 0x36, 0xac,
+    0x67, 0xeb, 0x83, 0x63, 0xd4, 0x3a, 0xa7, 0xdd, 0x3a, 0x52, 0xa2, 0xdc, 0x2e, 0x83, 0x0a, 0x51,
+    0x06, 0xef, 0x26, 0xd1, 0x5a, 0xeb, 0xbb, 0x68, 0xd5, 0x91, 0xcd, 0x77, 0x6a, 0x5d, 0xbd, 0xd5,
+    0x1b, 0xae, 0x9b, 0x0a, 0xcc, 0xc8, 0x51, 0xba, 0x78, 0x53, 0xd7, 0x99, 0xbb, 0xca, 0x91, 0x56,
+    0xfa, 0x65, 0x5f, 0x3d, 0x7a, 0x91, 0x3c, 0x5a, 0xaa, 0x96, 0x5e, 0xef, 0x9a, 0x67, 0x51, 0xee,
+    0x53, 0xeb, 0x0a, 0x0a, 0x72, 0xef, 0x11, 0x11, 0x8a, 0x75, 0xdf, 0x2a, 0xc3, 0xef, 0x54, 0xab,
+    0x7a, 0x28, 0x5e, 0xbb, 0x7d, 0xd8, 0xa6, 0x50, 0x7b, 0x2d, 0x9b, 0x9e, 0x73, 0x7b, 0xa9, 0x19,
+    0xee, 0xac, 0xa0, 0x83, 0xed, 0xed, 0x23, 0xbd, 0x66, 0xdd, 0x36, 0x7b, 0xb1, 0x32, 0x73, 0xad,
+    0x5e, 0x9b, 0x5b, 0xe6, 0x98, 0xe6, 0xbd, 0xb5, 0xa5, 0x76, 0xc7, 0xf1, 0x5b, 0x38, 0x42, 0xf3,
+    0xd5, 0x5a, 0x69, 0xa7, 0x8e, 0xa9, 0xeb, 0xa6, 0xcf, 0x1a, 0xbc, 0xae, 0xb6, 0x34, 0x76, 0xda,
+    0x63, 0xd7, 0x6e, 0x35, 0x4d, 0xd8, 0x95, 0x1c, 0xbd, 0xf2, 0x5a, 0xc9, 0xa3, 0x5b, 0xc6, 0xa9,
+    0x32, 0xcb, 0xba, 0x1b, 0x1c, 0x50, 0x1e, 0xdf, 0x6b, 0xe4, 0x3e, 0xaa, 0x3c, 0xcb, 0x97, 0xee,
+    0xad, 0x79, 0x97, 0x59, 0x52, 0x85, 0x6d, 0x29, 0x1c, 0x4c, 0x4a, 0x70, 0x8a, 0xd3, 0x06, 0x40,
+    0xe2, 0xad, 0x11, 0xa2, 0xa3, 0x5c, 0x51, 0xef, 0x7c, 0xd7, 0xc7, 0xdd, 0x7c, 0x6a, 0xcb, 0x8a,
+    0xed, 0xc8, 0x38, 0xbc, 0x38, 0x4c, 0xfa, 0x9c, 0xf4, 0xb2, 0x2c, 0xb9, 0x9d, 0xdd, 0xb5, 0x5e,
+    0x3c, 0xce, 0x18, 0xe0, 0x98, 0xaf, 0xc8, 0x6c, 0x7d, 0xdd, 0x56, 0x56, 0x69, 0x21, 0xac, 0x10,
+    0xba, 0x73, 0x52, 0xc8, 0x96, 0xc0, 0x05, 0x64, 0xd4, 0x51, 0xd8, 0xeb, 0xba, 0xd3, 0xb2, 0x88,
+    0x81, 0xb5, 0x3b, 0x4c, 0x07, 0x55, 0xa6, 0xf4, 0x2e, 0xb7, 0xee, 0xb9, 0x34, 0x96, 0x70, 0x9c,
+    0x09, 0x9e, 0x24, 0x6d, 0xc3, 0x81, 0x7d, 0xad, 0x8c, 0x7a, 0xa8, 0x9b, 0x9f, 0x18, 0xdb, 0xa2,
+    0xcc, 0x73, 0x02, 0x00, 0xf6, 0x43, 0x17, 0x59, 0xc1, 0x47, 0xab, 0x6e, 0x15, 0xf8, 0x5f, 0xf1,
+    0x94, 0x5d, 0x9a, 0x24, 0xfd, 0x1b, 0x7b, 0xde, 0x2b, 0xfc, 0x2e, 0x3e, 0x4a, 0x99, 0xd7, 0xd6,
+    0x9e, 0xa5, 0x8f, 0x43, 0x95, 0x96, 0x27, 0xb8, 0x5a, 0x63, 0xe8, 0x0c, 0x36, 0x4e, 0xd1, 0xdd,
+    0xd6, 0x79, 0x1b, 0xd4, 0xb9, 0xbc, 0x46, 0xdf, 0x71, 0x4a, 0x69, 0x3c, 0x47, 0x1f, 0xb4, 0xed,
+    0x6c, 0xd4, 0x9b, 0xff, 0x7f, 0x5a, 0x3e, 0x92, 0xfa, 0x8a, 0x9a, 0x34, 0xb6, 0x4d, 0xa5, 0x66,
+    0xde, 0xbd, 0x6b, 0x76, 0x08, 0x24, 0xdb, 0x69, 0x4b, 0x65, 0xdd, 0x32, 0x35, 0x52, 0x87, 0xde,
+    0xb5, 0x65, 0xc1, 0x40, 0xd7, 0x5b, 0x54, 0x57, 0x6d, 0xb5, 0x6a, 0xcb, 0x96, 0x7d, 0xf6, 0x6d,
+    0x80, 0xb7, 0xdb, 0x19, 0xaf, 0x05, 0xb3, 0x7b, 0xdc, 0xed, 0xf0, 0x7f, 0xad, 0x06, 0x75, 0x02,
+    0xfa, 0xe7, 0x52, 0x89, 0xbd, 0x00, 0x22, 0x75, 0xc9, 0xbd, 0x8a, 0x37, 0x8e, 0x28, 0x36, 0xaf,
+    0x2b, 0x47, 0x2c, 0x46, 0x8b, 0x39, 0xa0, 0x08, 0x08, 0xab, 0x3b, 0x47, 0x9b, 0x73, 0x6b, 0xc0,
+    0xbe, 0x84, 0xa9, 0xdb, 0xdb, 0x09, 0x8a, 0xb0, 0x80, 0x58, 0xed, 0x6d, 0x9b, 0x8c, 0xcd, 0xc9,
+    0x11, 0x8a, 0x6a, 0xb3, 0x8d, 0x0e, 0x5c, 0x5d, 0xe2, 0xce, 0x5a, 0xee, 0x02, 0x81, 0x3c, 0x75,
+    0x15, 0x7c, 0xaf, 0xc6, 0x17, 0x20, 0x64, 0x69, 0xd4, 0x22, 0x2a, 0x35, 0x41, 0x68, 0x16, 0xf4,
+    0x18, 0x0b, 0xda, 0xe7, 0x94, 0xb3, 0xc6, 0x2b, 0x56, 0x1c, 0x8e, 0xfa, 0x4e, 0x76, 0x4e, 0xd3,
+    0xd9, 0x72, 0x08, 0xe7, 0xcd, 0x60, 0x2d, 0xdd, 0x77, 0x8f, 0x4d, 0xfd, 0x50, 0x17, 0x3f, 0xa3,
+    0x1b, 0x85, 0xe2, 0x90, 0x9c, 0x6f, 0xc1, 0xf5, 0xcc, 0x79, 0xfb, 0xa9, 0xc7, 0x0b, 0x7c, 0x43,
+    0xa3, 0x86, 0xf2, 0x61, 0x8b, 0x99, 0xca, 0x0e, 0xe5, 0x52, 0x13, 0x4e, 0xa5, 0xa1, 0xf0, 0x35,
+    0x72, 0x06, 0x4c, 0xe9, 0xc9, 0x33, 0x7d, 0xa1, 0x20, 0x8e, 0x46, 0xd2, 0xb5, 0x5e, 0x28, 0x0e,
+    0x64, 0xd2, 0xa8, 0x94, 0x75, 0x59, 0xbb, 0x6d, 0xf0, 0x92, 0x03, 0x5a, 0x37, 0xe0, 0xdc, 0x32,
+    0xb5, 0x0d, 0x3a, 0xe0, 0x22, 0xfd, 0x52, 0x61, 0x00, 0x85, 0x1c, 0xf2, 0x04, 0x38, 0xaa, 0x63,
+    0xb7, 0x62, 0xb7, 0xf0, 0xc2, 0x72, 0x46, 0x22, 0x82, 0x5a, 0x69, 0x4e, 0x46, 0x83, 0xd0, 0xde,
+    0x4a, 0xa4, 0x43, 0xb0, 0x44, 0x07, 0xc5, 0x1d, 0xb4, 0x72, 0x50, 0xb3, 0xbe, 0x3d, 0xd0, 0x8e,
+    0x5e, 0x11, 0x20, 0xb8, 0x8f, 0x3c, 0x6b, 0x9d, 0x36, 0xf5, 0xb2, 0xbf, 0x71, 0x8e, 0x9c, 0xa9,
+    0x83, 0x3f, 0xb4, 0x3c, 0xcf, 0xb0, 0x56, 0xf8, 0xf8, 0x8e, 0xf5, 0xc4, 0x1d, 0x89, 0x58, 0x90,
+    0x58, 0x1d, 0x8d, 0x43, 0x2d, 0x67, 0x51, 0x76, 0x33, 0x38, 0x19, 0xf2, 0x03, 0x0b, 0x2b, 0xc0,
+    0xae, 0x77, 0x64, 0x52, 0x10, 0x40, 0x68, 0x5e, 0x0e, 0xe4, 0x09, 0x2b, 0xba, 0x77, 0x41, 0x0b,
+    0xc1, 0xfa, 0xad, 0x60, 0x10, 0x91, 0x42, 0xd1, 0xeb, 0xed, 0x34, 0x89, 0x67, 0x47, 0xef, 0xe8,
+    0x76, 0x2e, 0xe7, 0x67, 0x5d, 0x09, 0x59, 0x36, 0xa4, 0xef, 0x3b, 0xf7, 0xf6, 0x8d, 0x1a, 0x95,
+    0xd8, 0xe9, 0x14, 0x1b, 0xb7, 0x98, 0x06, 0x91, 0x84, 0xe3, 0x19, 0x6a, 0x43, 0x5b, 0xef, 0x72,
+    0x08, 0x45, 0x5b, 0x17, 0xb2, 0xee, 0xaf, 0x0d, 0x33, 0x83, 0x66, 0x46, 0x1d, 0xc0, 0x2b, 0xef,
+    0x93, 0xfc, 0x00, 0x9f, 0x03, 0xbf, 0xa9, 0x70, 0xdb, 0x12, 0x1e, 0xf7, 0x70, 0x80, 0xf3, 0x8a,
+    0x8a, 0x45, 0x48, 0x8e, 0x65, 0x57, 0xcb, 0x2e, 0x34, 0x6b, 0xa1, 0xb3, 0x90, 0x8f, 0x8e, 0x8d,
+    0x59, 0xd1, 0xc4, 0x58, 0xa1, 0xab, 0x1c, 0x94, 0xcc, 0x50, 0xd1, 0x30, 0x00, 0xeb, 0xad, 0xed,
+    0xe2, 0xce, 0x0b, 0x7e, 0xe7, 0xa6, 0xac, 0xc8, 0xfc, 0x18, 0x7b, 0xf4, 0xb8, 0xb1, 0x0b, 0x6c,
+    0x63, 0x27, 0x07, 0x29, 0x50, 0xe4, 0x38, 0x59, 0x72, 0x26, 0x86, 0x78, 0x1e, 0x8b, 0xca, 0x33,
+    0xb0, 0xb3, 0xe7, 0x41, 0x11, 0xce, 0x3a, 0xd4, 0x6a, 0x8c, 0xe9, 0x81, 0x99, 0x80, 0xbb, 0xdb,
+    0x26, 0xb6, 0xa8, 0xb3, 0x9e, 0x62, 0x21, 0x7b, 0x4d, 0xd5, 0x9c, 0x33, 0x2a, 0xf5, 0xa5, 0xc7,
+    0xa8, 0xf0, 0x39, 0x38, 0xe5, 0x69, 0x70, 0x0a, 0x31, 0x46, 0xd6, 0x38, 0xee, 0x23, 0x2e, 0xaa,
+    0xc1, 0x0e, 0x11, 0x16, 0x74, 0xa1, 0x2e, 0x18, 0xa6, 0xbd, 0xac, 0xad, 0x5b, 0xea, 0xf3, 0x5b,
+    0x44, 0xa0, 0x81, 0x4a, 0x83, 0x00, 0x36, 0x4e, 0x41, 0xef, 0x07, 0x42, 0xa0, 0xcf, 0xc6, 0xf4,
+    0x0c, 0x70, 0x34, 0x9d, 0x8d, 0xd4, 0x4e, 0xf9, 0x47, 0x17, 0xb4, 0x0e, 0x77, 0xbb, 0xd4, 0x8b,
+    0xf5, 0x17, 0xf6, 0x2d, 0xe5, 0xa0, 0xf9, 0xd8, 0x94, 0x9b, 0xef, 0x40, 0x6c, 0xc0, 0xfe, 0x93,
+    0x05, 0x6d, 0xe8, 0x62, 0x9f, 0x54, 0x7a, 0xc4, 0x0f, 0x94, 0x0b, 0x28, 0xb4, 0x52, 0x45, 0x30,
+    0xfe, 0x71, 0xf9, 0x75, 0xc8, 0x1e, 0xcf, 0xfa, 0x71, 0x28, 0x14, 0xb3, 0x60, 0x40, 0x60, 0x07,
+    0x2f, 0xc7, 0xa0, 0x90, 0x2d, 0x64, 0x88, 0x23, 0xa2, 0xbf, 0x76, 0x14, 0x21, 0xd5, 0x8d, 0xce,
+    0x0f, 0xea, 0x7a, 0x0f, 0x02, 0x0a, 0x54, 0x2f, 0x82, 0x16, 0xb4, 0xaf, 0xcc, 0x66, 0xa8, 0x0e,
+    0xfa, 0xe3, 0x32, 0x1d, 0xc9, 0xfa, 0x5f, 0xf5, 0xde, 0x2e, 0x01, 0x9b, 0x62, 0xdf, 0x12, 0x4b,
+    0x31, 0xe6, 0x59, 0xce, 0xe9, 0x9e, 0x65, 0x50, 0xdc, 0x67, 0xe2, 0xa7, 0xa3, 0x32, 0x08, 0x9b,
+    0x15, 0xe7, 0x6c, 0x18, 0x76, 0xd8, 0xa5, 0x2e, 0x94, 0x12, 0xa1, 0x82, 0x2b, 0x6e, 0x14, 0xe0,
+    0x2e, 0x96, 0x60, 0xbf, 0x0d, 0x5d, 0xfb, 0xbd, 0x63, 0x3d, 0x7a, 0x88, 0x9e, 0xea, 0x18, 0x3b,
+    0xda, 0xba, 0x71, 0x48, 0x40, 0x47, 0xae, 0xc1, 0x06, 0x89, 0x11, 0x83, 0xbe, 0xa1, 0x3c, 0x97,
+    0x3d, 0x35, 0x84, 0x02, 0xeb, 0x9d, 0xc7, 0x38, 0xf1, 0x32, 0xbf, 0x3c, 0x87, 0xb6, 0xb3, 0x17,
+    0xec, 0x19, 0xc0, 0xe3, 0x00, 0x45, 0xca, 0x86, 0xff, 0x10, 0x5a, 0x9f, 0xe0, 0x37, 0xeb, 0x47,
+    0x3b, 0x82, 0x4f, 0xde, 0x70, 0x23, 0xc6, 0xa8, 0xb5, 0x6a, 0x37, 0x51, 0xc4, 0xe6, 0xed, 0xce,
+    0x86, 0x31, 0x42, 0x84, 0x97, 0x87, 0x86, 0x60, 0x6f, 0xf0, 0xa1, 0x0f, 0xd8, 0x84, 0x75, 0x3d,
+    0xb2, 0x9e, 0x6c, 0xf3, 0x01, 0xfb, 0x16, 0xc2, 0xc5, 0x93, 0x07, 0x87, 0x55, 0xd9, 0x0f, 0x7c,
+    0xdd, 0x35, 0xf9, 0x2b, 0xc8, 0x55, 0x10, 0x8c, 0x9e, 0x3f, 0x65, 0xa1, 0xcc, 0xbd, 0x21, 0x18,
+    0x03, 0x01, 0x36, 0x82, 0x05, 0xfb, 0x22, 0xfc, 0xbc, 0xc3, 0x81, 0xf8, 0x32, 0xa8, 0x11, 0x6f,
+    0x92, 0x16, 0x00, 0xc8, 0xe6, 0x24, 0x05, 0x35, 0xb2, 0xd6, 0x7e, 0xa4, 0x96, 0xa7, 0x40, 0x6c,
+    0x62, 0x03, 0x6e, 0xde, 0x89, 0x5e, 0xcc, 0xf2, 0x68, 0xa1, 0x41, 0x50, 0x58, 0x10, 0x01, 0x53,
+    0xad, 0x6a, 0x53, 0x70, 0xb5, 0x53, 0xc6, 0x7d, 0x30, 0x69, 0xda, 0x80, 0x31, 0x1d, 0xc4, 0xdf,
+    0x5b, 0x27, 0x5c, 0x51, 0x60, 0x7c, 0x92, 0xdc, 0xb1, 0x90, 0x83, 0xfe, 0x98, 0x88, 0x03, 0x5e,
+    0x50, 0x84, 0xa3, 0xc0, 0xa0, 0xa4, 0xc3, 0x88, 0xcf, 0xa8, 0xed, 0xfd, 0x8d, 0x1e, 0x53, 0x25,
+    0x14, 0x56, 0x47, 0x3f, 0x85, 0xac, 0xe3, 0x46, 0x02, 0x71, 0x64, 0x01, 0x3b, 0x43, 0x58, 0x0c,
+    0xff, 0x80, 0x38, 0xa8, 0x0e, 0xd8, 0x09, 0x50, 0x2a, 0xab, 0x6f, 0x32, 0xe6, 0x93, 0x76, 0xcc,
+    0x14, 0x64, 0x93, 0x59, 0x14, 0xc7, 0x5e, 0xb8, 0xfc, 0x98, 0xbd, 0xe3, 0x66, 0x0f, 0x01, 0x8d,
+    0x2e, 0x0e, 0x82, 0x9a, 0x68, 0x52, 0xcc, 0x21, 0xb4, 0x05, 0xf6, 0x8f, 0x06, 0x80, 0x0b, 0xf1,
+    0x05, 0x35, 0x2f, 0x09, 0x4b, 0x05, 0xc6, 0x22, 0xbb, 0xb6, 0x16, 0x30, 0x67, 0xf7, 0x33, 0x48,
+    0xa4, 0x08, 0x20, 0x32, 0x1e, 0x79, 0x9d, 0x5a, 0x10, 0x3e, 0x8e, 0xc0, 0x2c, 0xf8, 0x05, 0xdc,
+    0xd0, 0xd6, 0xc2, 0xab, 0x27, 0x92, 0xf0, 0x92, 0xdd, 0x69, 0x46, 0xca, 0x21, 0x48, 0x90, 0x6c,
+    0x57, 0x96, 0x84, 0x87, 0xde, 0x84, 0xdf, 0xf0, 0x10, 0x62, 0xc9, 0x72, 0x1c, 0xa7, 0x60, 0x75,
+    0x5d, 0x9e, 0x5a, 0x23, 0x07, 0x49, 0xe3, 0xa8, 0x31, 0x74, 0x6e, 0x40, 0x08, 0x51, 0x38, 0xc8,
+    0x27, 0xbe, 0x8c, 0xa8, 0x94, 0x8b, 0x95, 0xbe, 0x28, 0xf3, 0x6c, 0x03, 0xb7, 0x27, 0xa7, 0xb4,
+    0xd5, 0x39, 0x3c, 0xb1, 0x66, 0xa3, 0x44, 0x8a, 0x29, 0xda, 0x8b, 0x2b, 0x02, 0x3a, 0x25, 0x30,
+    0x07, 0x24, 0xd4, 0x0e, 0xb9, 0x90, 0x95, 0x21, 0xe7, 0x39, 0x60, 0x2a, 0x36, 0x55, 0x43, 0xcd,
+    0xa8, 0xe7, 0xc5, 0xa4, 0xf7, 0x61, 0x6d, 0x28, 0x81, 0x32, 0x1e, 0x1a, 0xc1, 0xba, 0x84, 0x31,
+    0x18, 0x7c, 0x64, 0xd1, 0xfe, 0x9c, 0x64, 0xc2, 0x9b, 0x13, 0x6f, 0x4a, 0x78, 0xe0, 0x77, 0x4f,
+    0x50, 0x0c, 0x86, 0xf8, 0x17, 0x51, 0x03, 0x32, 0x36, 0x04, 0xa1, 0x5f, 0x14, 0x35, 0xba, 0x23,
+    0x99, 0x48, 0x94, 0x02, 0x36, 0x3d, 0x7c, 0xa5, 0xe0, 0xd5, 0xe8, 0x04, 0x7b, 0xa6, 0x49, 0x04,
+    0x43, 0x22, 0xea, 0xa8, 0xb4, 0x2d, 0x1f, 0x51, 0x4f, 0x22, 0x3d, 0xca, 0x89, 0x90, 0x03, 0x28,
+    0x34, 0xf2, 0xd0, 0xfc, 0x98, 0x4f, 0x34, 0x89, 0x48, 0xfb, 0xc0, 0xac, 0xad, 0x09, 0x98, 0x26,
+    0x69, 0x56, 0x1a, 0xfc, 0x23, 0x15, 0xd8, 0xd3, 0x18, 0x6c, 0x3c, 0xea, 0xf4, 0xfb, 0x34, 0x3d,
+    0x3b, 0x12, 0xa3, 0x68, 0xfd, 0x15, 0xf4, 0xe3, 0xdc, 0xd0, 0xf1, 0x42, 0x7b, 0x87, 0x38, 0x84,
+    0xd5, 0xd2, 0x6e, 0x12, 0x7a, 0x31, 0x6a, 0x3a, 0x4c, 0xce, 0x56, 0x1a, 0x84, 0xcf, 0x23, 0xac,
+    0x84, 0xaa, 0xf6, 0x64, 0x75, 0x36, 0x4a, 0x44, 0xa0, 0x21, 0x7c, 0xc0, 0x5b, 0xe3, 0x79, 0x02,
+    0x7f, 0xc1, 0x66, 0x07, 0x76, 0xdf, 0x88, 0x6f, 0x10, 0xa0, 0x4b, 0x2a, 0x2f, 0x3d, 0x96, 0x01,
+    0x15, 0x36, 0x22, 0xd0, 0x39, 0x07, 0xe9, 0x3b, 0xb0, 0xae, 0xdd, 0xf8, 0x22, 0x4b, 0x50, 0xa2,
+    0x8d, 0x03, 0x4d, 0x62, 0x1f, 0x4d, 0xbf, 0x7c, 0x0e, 0xa7, 0x70, 0xd8, 0xca, 0x49, 0xd9, 0x32,
+    0xa2, 0x47, 0x5c, 0x9d, 0x84, 0x38, 0xac, 0x9e, 0xce, 0x8b, 0x93, 0x9a, 0x82, 0xfc, 0x82, 0xb9,
+    0xa7, 0xb5, 0xf9, 0x48, 0xe1, 0x83, 0x0c, 0xa7, 0x32, 0xa9, 0x05, 0x47, 0x87, 0x95, 0x9d, 0x6d,
+    0xf7, 0x78, 0x1e, 0xbf, 0x58, 0x2f, 0xc6, 0xda, 0x9b, 0xd9, 0xc6, 0xd1, 0x57, 0xf2, 0x3d, 0xed,
+    0xa3, 0x30, 0xfe, 0x24, 0xf0, 0x56, 0x52, 0xeb, 0x33, 0x47, 0x82, 0xdb, 0x3b, 0x08, 0xc6, 0x8c,
+    0x77, 0x06, 0x7a, 0x06, 0xa6, 0xdd, 0x2b, 0x89, 0xab, 0x85, 0xba, 0x24, 0x83, 0x0c, 0x99, 0x0f,
+    0xf4, 0x4d, 0xde, 0x45, 0x08, 0x5b, 0xc4, 0xa6, 0x45, 0x54, 0x80, 0x8e, 0x25, 0xdb, 0x5b, 0x6d,
+    0xe0, 0x82, 0xf6, 0x52, 0x6a, 0x63, 0xff, 0x38, 0x40, 0xb1, 0xc4, 0xfe, 0xfd, 0x3a, 0x96, 0x85,
+    0x4c, 0xb7, 0x44, 0xb3, 0xee, 0xb3, 0x0d, 0x04, 0x02, 0xea, 0x12, 0xbf, 0x68, 0xe6, 0xb8, 0xde,
+    0x48, 0x40, 0xe5, 0x7a, 0xa1, 0x27, 0x4f, 0x9c, 0x48, 0x69, 0x3e, 0xfd, 0x99, 0x11, 0xbd, 0x8d,
+    0xb7, 0xc7, 0x0e, 0x25, 0xdb, 0xaa, 0x34, 0xa1, 0xcb, 0x24, 0xc0, 0xad, 0x37, 0x70, 0x2c, 0x58,
+    0xa4, 0xcf, 0x43, 0xc8, 0xe2, 0x1c, 0xbd, 0x00, 0x6e, 0x25, 0x63, 0x80, 0x4e, 0x02, 0x2b, 0x47,
+    0xc5, 0x7e, 0xf4, 0x81, 0x85, 0x54, 0xe7, 0x91, 0xa4, 0xea, 0x37, 0x14, 0x60, 0x0d, 0x40, 0xfc,
+    0x0d, 0x85, 0xbe, 0x9f, 0x23, 0xb1, 0x4d, 0xfa, 0x12, 0xfb, 0xbe, 0x0c, 0xbc, 0x99, 0x82, 0xc0,
+    0x09, 0xf3, 0xc5, 0xa6, 0xb8, 0xbc, 0xf4, 0x60, 0x96, 0x2f, 0x2e, 0x08, 0x21, 0x88, 0x91, 0xae,
+    0x56, 0x7c, 0x58, 0x27, 0x64, 0x66, 0x4a, 0x7a, 0xa1, 0xf4, 0xd4, 0xf2, 0xd2, 0x01, 0xd8, 0x59,
+    0x04, 0x3f, 0x9a, 0x9b, 0xec, 0xf6, 0x15, 0x83, 0xe9, 0xd2, 0x60, 0x38, 0x11, 0x68, 0x8f, 0xf6,
+    0x50, 0xce, 0x12, 0x70, 0x71, 0x4f, 0x68, 0x85, 0xaf, 0x09, 0x09, 0x01, 0x97, 0x87, 0x26, 0x49,
+    0xac, 0x22, 0xae, 0xa1, 0x7a, 0x54, 0x88, 0x7c, 0xcd, 0x84, 0x88, 0x4d, 0x90, 0xb1, 0x80, 0xdb,
+    0x45, 0x25, 0x2e, 0xca, 0x16, 0x58, 0xb1, 0x55, 0x9e, 0x80, 0xaa, 0x52, 0xae, 0xbd, 0x48, 0xa3,
+    0xb4, 0x1b, 0x2a, 0xe2, 0x0a, 0x36, 0x2a, 0x9a, 0x8b, 0x7d, 0x31, 0xe6, 0x76, 0x44, 0xbe, 0x1d,
+    0x2c, 0x86, 0x70, 0xdd, 0x41, 0x3b, 0xa9, 0x8f, 0xe9, 0x8f, 0x9a, 0xd2, 0x0e, 0xc2, 0x02, 0x46,
+    0x63, 0x98, 0x62, 0x5d, 0x0f, 0x9c, 0x8a, 0x57, 0xe1, 0xce, 0x0c, 0xcd, 0x0c, 0x43, 0x4c, 0x41,
+    0x4f, 0x1b, 0x68, 0xa7, 0x6d, 0x11, 0x30, 0xff, 0x5e, 0xc4, 0x76, 0xdf, 0x3c, 0x4d, 0xa6, 0x22,
+    0x86, 0x1d, 0x30, 0x66, 0x6f, 0x24, 0xa6, 0x1c, 0x03, 0x5b, 0xa4, 0x37, 0xf6, 0x3a, 0xd1, 0x11,
+    0x34, 0x2c, 0x7c, 0x6f, 0xbe, 0x49, 0xca, 0x7d, 0x33, 0x14, 0xfe, 0x0d, 0x86, 0x48, 0xa4, 0x90,
+    0x84, 0x29, 0x04, 0x30, 0x62, 0xe7, 0xa8, 0x11, 0xc3, 0x03, 0xc1, 0xa5, 0xb0, 0x79, 0x7a, 0x42,
+    0xd4, 0x9f, 0xb2, 0x26, 0x9a, 0x8f, 0xf4, 0xd3, 0xb8, 0x83, 0xc4, 0x02, 0xca, 0x46, 0x2a, 0xed,
+    0xf8, 0xe3, 0x7a, 0xd6, 0x8f, 0x52, 0xb3, 0x64, 0xbf, 0xed, 0xe4, 0x45, 0x70, 0xa1, 0xa3, 0xf5,
+    0xe7, 0x3c, 0x4c, 0x8e, 0x8c, 0x91, 0x28, 0xdf, 0xb9, 0xb5, 0x43, 0x3d, 0x46, 0x4f, 0xc6, 0x10,
+    0xc3, 0x56, 0x30, 0xd2, 0x4e, 0x4e, 0x51, 0x70, 0x47, 0x90, 0x5f, 0x1c, 0xbc, 0x77, 0x9c, 0x6f,
+    0x77, 0x25, 0xfc, 0x94, 0x5d, 0xc9, 0x41, 0x28, 0xe4, 0xe3, 0x3e, 0xff, 0x65, 0xf6, 0x63, 0xcc,
+    0xed, 0x2f, 0x62, 0x80, 0x70, 0x54, 0x3d, 0x99, 0x38, 0xe7, 0x04, 0x99, 0x24, 0x02, 0x9a, 0x42,
+    0xe9, 0x5f, 0xe8, 0x8c, 0x03, 0x49, 0x9f, 0x63, 0x1d, 0x66, 0x3b, 0x10, 0x75, 0x02, 0x0d, 0xeb,
+    0x44, 0x7a, 0x63, 0xb4, 0xc8, 0xe7, 0xa0, 0xc0, 0x2a, 0x90, 0x0a, 0x7f, 0xc3, 0x2f, 0xf4, 0x44,
+    0x55, 0x18, 0x52, 0x82, 0x94, 0x80, 0x75, 0x90, 0xe9, 0x05, 0x6c, 0x02, 0x1e, 0xe6, 0x4b, 0x64,
+    0xf4, 0x92, 0xe6, 0x06, 0x51, 0x8d, 0x6c, 0x16, 0x0c, 0x07, 0x28, 0x02, 0x29, 0xe1, 0x92, 0xff,
+    0x91, 0xfc, 0x7e, 0x41, 0x05, 0xe6, 0x7a, 0xe6, 0xcb, 0x53, 0x93, 0x01, 0x92, 0x59, 0xf8, 0x30,
+    0x20, 0x82, 0x4c, 0xd6, 0x05, 0x4d, 0x2b, 0x1d, 0xcd, 0xae, 0xa0, 0x99, 0x54, 0x01, 0xff, 0x13,
+    0x55, 0x23, 0xf0, 0x92, 0xa5, 0x2a, 0x4d, 0x7c, 0x65, 0x61, 0x78, 0x63, 0xf2, 0x62, 0xf0, 0x64,
+    0x1f, 0x4c, 0x5e, 0xf9, 0x43, 0x36, 0xf3, 0xe9, 0x3b, 0x0f, 0xe3, 0xfa, 0x8b, 0x81, 0x8a, 0xae,
+    0xe2, 0xfa, 0xbf, 0x2e, 0xd6, 0xc3, 0x6c, 0x8e, 0xcc, 0xf4, 0x24, 0x8e, 0x96, 0x37, 0x83, 0x16,
+    0xe6, 0x17, 0xeb, 0xd4, 0xc8, 0x95, 0xf1, 0x8b, 0x79, 0x18, 0xba, 0x38, 0xb3, 0x1b, 0x1f, 0xcf,
+    0xe4, 0x83, 0xf6, 0x62, 0xc1, 0xc3, 0xeb, 0xc3, 0x5a, 0x7f, 0xe1, 0x90, 0x8e, 0x98, 0x61, 0x67,
+    0xd1, 0x3b, 0xea, 0x68, 0xab, 0xa0, 0xfd, 0x90, 0xf6, 0x99, 0x23, 0xfa, 0x4b, 0x1f, 0x3b, 0x8c,
+    0x67, 0xdc, 0xa6, 0x33, 0x4c, 0xf3, 0x4c, 0xd1, 0xbc, 0xcb, 0x3a, 0x53, 0xf4, 0x7d, 0x26, 0x8c,
+    0x8e, 0xd2, 0x2b, 0x66, 0xb8, 0x17, 0xcc, 0xc9, 0xb2, 0xe4, 0x5b, 0xa6, 0x43, 0xd2, 0x9b, 0x0f,
+    0xba, 0x8d, 0x10, 0x3c, 0x10, 0x18, 0x24, 0x82, 0x61, 0xec, 0x73, 0x1d, 0xa4, 0x20, 0xe8, 0x57,
+    0x30, 0x4a, 0xf0, 0x55, 0x54, 0x01, 0xcd, 0x7c, 0xf4, 0xc0, 0xe6, 0xea, 0x96, 0x37, 0x64, 0xc3,
+    0xf5, 0x4b, 0xc4, 0x3d, 0x2f, 0xb7, 0x42, 0x2a, 0x3a, 0xf8, 0xa6, 0x60, 0xc5, 0xf8, 0x98, 0x47,
+    0x99, 0x8f, 0x78, 0x0b, 0x26, 0x40, 0x40, 0xe7, 0x64, 0x8c, 0x4e, 0xfa, 0x62, 0x09, 0xae, 0xcb,
+    0x82, 0x7c, 0x42, 0x61, 0x27, 0xdc, 0x50, 0xa6, 0x28, 0xa6, 0x46, 0x46, 0x3c, 0x02, 0x1e, 0xb9,
+    0x16, 0xfb, 0x25, 0x26, 0x60, 0xdb, 0x04, 0xfb, 0x37, 0x90, 0x42, 0xbf, 0x80, 0x5f, 0xec, 0x13,
+    0xa6, 0x88, 0x91, 0x91, 0x36, 0xc2, 0x48, 0x79, 0xa0, 0x29, 0xe3, 0xca, 0x14, 0xe2, 0x22, 0x83,
+    0x0a, 0xa3, 0xee, 0xa6, 0x87, 0x9a, 0x2f, 0x65, 0xb3, 0x65, 0xde, 0x5b, 0x0e, 0x00, 0x59, 0xf4,
+    0x06, 0xa2, 0x31, 0xa1, 0xb3, 0x0d, 0x02, 0x34, 0x73, 0xb7, 0x29, 0x02, 0x7b, 0x89, 0x7e, 0x9d,
+    0x30, 0x80, 0x62, 0xbe, 0x8b, 0x2d, 0xf2, 0x00, 0xbf, 0xe1, 0xa4, 0xe9, 0x58, 0x0d, 0x64, 0x16,
+    0x10, 0x41, 0x82, 0x7a, 0x30, 0x42, 0x65, 0x26, 0xc9, 0x81, 0xa1, 0x8d, 0xa4, 0xc1, 0x7c, 0xe6,
+    0x54, 0xe8, 0x4d, 0x9f, 0x95, 0xf2, 0x90, 0xec, 0x48, 0x9e, 0x54, 0xd5, 0x21, 0x20, 0x36, 0x5f,
+    0x0f, 0x45, 0x01, 0x8c, 0xc8, 0x0f, 0x13, 0x40, 0x7d, 0x01, 0x16, 0x9d, 0xec, 0x2e, 0xf4, 0xaa,
+    0xc6, 0x9b, 0x17, 0xcf, 0x18, 0xb1, 0x88, 0x69, 0xf2, 0xc6, 0x7c, 0xa6, 0x9f, 0x03, 0xe6, 0xa1,
+    0x7e, 0x65, 0x1e, 0x35, 0x3a, 0xc5, 0xb0, 0xb5, 0xd0, 0x49, 0xd3, 0xef, 0x1e, 0xee, 0xbb, 0x87,
+    0xfb, 0xee, 0xe1, 0xbe, 0x7b, 0xb8, 0xef, 0x1e, 0xee, 0xbb, 0x87, 0xfb, 0xee, 0xe1, 0xbe, 0x7b,
+    0xb8, 0xef, 0x1e, 0xee, 0xbb, 0x87, 0xfb, 0xee, 0xe1, 0xbe, 0x7b, 0xb8, 0xef, 0x1e, 0xee, 0xbb,
+    0x87, 0xfb, 0xee, 0xe1, 0xbe, 0x7b, 0xb8, 0xef, 0x1e, 0xee, 0xbb, 0x87, 0xfb, 0xee, 0xe1, 0xfe,
+    0xf9, 0x3d, 0xdc, 0x9f, 0xef, 0xe7, 0xaf, 0x7f, 0xbe, 0x3b, 0xcb, 0xef, 0xce, 0xf2, 0xbb, 0xb3,
+    0xfc, 0xee, 0x2c, 0xbf, 0x3b, 0xcb, 0xef, 0xce, 0xf2, 0xbb, 0xb3, 0xfc, 0xee, 0x2c, 0xbf, 0x3b,
+    0xcb, 0xef, 0xce, 0xf2, 0xbb, 0xb3, 0xfc, 0xee, 0x2c, 0xbf, 0x3b, 0xcb, 0xef, 0xce, 0xf2, 0xbb,
+    0xb3, 0xfc, 0xee, 0x2c, 0xbf, 0x3b, 0xcb, 0xef, 0xce, 0xf2, 0xbb, 0xb3, 0xfc, 0xf7, 0x77, 0x96,
+    0xff, 0x01, 0xfb, 0xd1, 0x16, 0x81, 0xc4, 0x3b, 0x00, 0x00,
+};
+
+// 600 bytes of generate(600, 7) at level 0, a stored block
+static const uint8_t s_stored[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03, 0x01, 0x58, 0x02, 0xa7, 0xfd, 0x6d,
+    0x6f, 0x65, 0x63, 0x64, 0x66, 0x63, 0x6f, 0x62, 0x62, 0x6e, 0x64, 0x6f, 0x63, 0x6e, 0x63, 0x6a,
+    0x67, 0x6f, 0x65, 0x6d, 0x64, 0x68, 0x6b, 0x6e, 0x61, 0x68, 0x62, 0x6b, 0x67, 0x66, 0x6f, 0x63,
+    0x6b, 0x65, 0x64, 0x64, 0x69, 0x69, 0x65, 0x68, 0x6f, 0x6d, 0x6e, 0x6f, 0x6f, 0x6f, 0x61, 0x6b,
+    0x62, 0x62, 0x70, 0x6e, 0x6c, 0x62, 0x6f, 0x63, 0x64, 0x65, 0x67, 0x6e, 0x6f, 0x66, 0x69, 0x65,
+    0x62, 0x61, 0x69, 0x6b, 0x64, 0x6d, 0x66, 0x61, 0x65, 0x6d, 0x6a, 0x6b, 0x61, 0x65, 0x66, 0x64,
+    0x62, 0x6c, 0x6c, 0x61, 0x69, 0x66, 0x69, 0x65, 0x6a, 0x6f, 0x68, 0x6a, 0x6a, 0x66, 0x68, 0x6a,
+    0x6a, 0x6f, 0x69, 0x61, 0x61, 0x67, 0x68, 0x63, 0x6a, 0x66, 0x70, 0x6d, 0x63, 0x66, 0x6d, 0x6c,
+    0x70, 0x65, 0x6e, 0x6f, 0x63, 0x6c, 0x62, 0x6d, 0x6d, 0x6d, 0x70, 0x66, 0x70, 0x6f, 0x63, 0x6c,
+    0x6c, 0x69, 0x6c, 0x6d, 0x66, 0x70, 0x66, 0x67, 0x68, 0x70, 0x67, 0x6a, 0x6b, 0x6c, 0x6b, 0x6c,
+    0x65, 0x66, 0x70, 0x70, 0x62, 0x6d, 0x62, 0x63, 0x63, 0x69, 0x64, 0x6c, 0x69, 0x68, 0x63, 0x70,
+    0x70, 0x66, 0x6b, 0x68, 0x6c, 0x6f, 0x65, 0x65, 0x65, 0x64, 0x67, 0x6d, 0x62, 0x6e, 0x6a, 0x6c,
+    0x67, 0x65, 0x6a, 0x6b, 0x6e, 0x70, 0x70, 0x6f, 0x65, 0x6b, 0x6e, 0x61, 0x6d, 0x69, 0x6f, 0x61,
+    0x6f, 0x6e, 0x6d, 0x6a, 0x6c, 0x6b, 0x6f, 0x64, 0x6b, 0x69, 0x69, 0x6c, 0x61, 0x64, 0x62, 0x63,
+    0x6f, 0x6c, 0x63, 0x69, 0x6e, 0x6d, 0x64, 0x68, 0x6c, 0x69, 0x66, 0x70, 0x64, 0x6a, 0x70, 0x65,
+    0x6f, 0x6a, 0x6b, 0x6b, 0x6c, 0x6e, 0x6c, 0x6d, 0x70, 0x67, 0x64, 0x70, 0x6e, 0x66, 0x6a, 0x6a,
+    0x65, 0x62, 0x63, 0x62, 0x6c, 0x6c, 0x67, 0x66, 0x6e, 0x6d, 0x63, 0x6f, 0x66, 0x64, 0x6d, 0x65,
+    0x69, 0x61, 0x6c, 0x62, 0x65, 0x70, 0x63, 0x67, 0x6d, 0x66, 0x61, 0x70, 0x62, 0x6d, 0x6a, 0x69,
+    0x61, 0x70, 0x63, 0x6d, 0x6f, 0x65, 0x70, 0x63, 0x64, 0x6d, 0x6d, 0x67, 0x6a, 0x6d, 0x6f, 0x69,
+    0x65, 0x6a, 0x68, 0x68, 0x6f, 0x67, 0x6c, 0x6c, 0x6a, 0x6e, 0x67, 0x66, 0x65, 0x70, 0x6b, 0x68,
+    0x6b, 0x6c, 0x6a, 0x63, 0x6e, 0x70, 0x68, 0x65, 0x66, 0x63, 0x6d, 0x70, 0x6a, 0x6f, 0x6d, 0x68,
+    0x6a, 0x6f, 0x68, 0x64, 0x62, 0x6d, 0x70, 0x62, 0x6f, 0x68, 0x6f, 0x68, 0x6f, 0x66, 0x64, 0x6e,
+    0x6b, 0x70, 0x61, 0x6c, 0x63, 0x66, 0x66, 0x65, 0x6d, 0x66, 0x6b, 0x61, 0x6c, 0x61, 0x6f, 0x6b,
+    0x62, 0x68, 0x64, 0x6f, 0x66, 0x68, 0x67, 0x62, 0x65, 0x6a, 0x70, 0x6e, 0x68, 0x6a, 0x6e, 0x64,
+    0x68, 0x62, 0x6f, 0x70, 0x64, 0x6e, 0x62, 0x6b, 0x6f, 0x6f, 0x6d, 0x63, 0x6a, 0x6b, 0x6e, 0x6a,
+    0x64, 0x6b, 0x63, 0x61, 0x63, 0x62, 0x67, 0x63, 0x62, 0x6e, 0x62, 0x61, 0x68, 0x61, 0x70, 0x61,
+    0x6c, 0x6c, 0x6d, 0x66, 0x6b, 0x70, 0x65, 0x6e, 0x65, 0x64, 0x6e, 0x6d, 0x6a, 0x66, 0x61, 0x6d,
+    0x68, 0x61, 0x6d, 0x62, 0x61, 0x62, 0x6a, 0x6e, 0x6e, 0x6b, 0x6e, 0x69, 0x67, 0x64, 0x62, 0x6f,
+    0x6e, 0x65, 0x62, 0x67, 0x6e, 0x64, 0x66, 0x67, 0x66, 0x6f, 0x63, 0x69, 0x65, 0x68, 0x61, 0x6b,
+    0x65, 0x63, 0x6b, 0x69, 0x68, 0x61, 0x68, 0x6b, 0x63, 0x6a, 0x6c, 0x6e, 0x6d, 0x6c, 0x6d, 0x64,
+    0x65, 0x66, 0x66, 0x6b, 0x66, 0x63, 0x6e, 0x6d, 0x6c, 0x67, 0x66, 0x6d, 0x64, 0x6b, 0x65, 0x6c,
+    0x65, 0x68, 0x64, 0x6f, 0x70, 0x65, 0x68, 0x61, 0x68, 0x61, 0x62, 0x67, 0x61, 0x70, 0x69, 0x68,
+    0x6b, 0x65, 0x62, 0x69, 0x6b, 0x63, 0x64, 0x6a, 0x6e, 0x64, 0x6f, 0x61, 0x6d, 0x66, 0x66, 0x6a,
+    0x6e, 0x68, 0x70, 0x6b, 0x70, 0x68, 0x63, 0x69, 0x65, 0x6a, 0x6b, 0x6d, 0x6d, 0x68, 0x6c, 0x64,
+    0x66, 0x6c, 0x6d, 0x6a, 0x66, 0x6e, 0x61, 0x64, 0x64, 0x6e, 0x65, 0x6f, 0x69, 0x61, 0x6b, 0x6b,
+    0x6a, 0x6c, 0x68, 0x67, 0x62, 0x61, 0x6f, 0x6b, 0x62, 0x6c, 0x6c, 0x68, 0x68, 0x6c, 0x61, 0x70,
+    0x70, 0x62, 0x70, 0x65, 0x6d, 0x6b, 0x6c, 0x63, 0x65, 0x6e, 0x70, 0x6d, 0x70, 0x64, 0x6c, 0x68,
+    0x6f, 0x6a, 0x64, 0x69, 0x6d, 0x68, 0x67, 0x6f, 0x66, 0x6f, 0x6f, 0x70, 0x69, 0x64, 0x6d, 0x64,
+    0x6f, 0x6f, 0x62, 0x64, 0x69, 0x62, 0x6e, 0x6f, 0x0d, 0x87, 0xf7, 0x58, 0x02, 0x00, 0x00,
+};
+
+// 33 bytes, a fixed code block
+static const uint8_t s_fixed[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x4b, 0x4d, 0xca, 0xcf, 0x2f, 0x51,
+    0x48, 0x45, 0x90, 0x3a, 0x0a, 0x29, 0xa9, 0xc9, 0xf9, 0xb9, 0x05, 0x45, 0xa9, 0xc5, 0xc5, 0x99,
+    0x79, 0xe9, 0x00, 0xc7, 0xde, 0xae, 0x6f, 0x20, 0x00, 0x00, 0x00,
+};
+
+static std::vector<uint8_t> generate(size_t size, uint32_t seed)
+{
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        data.push_back("abcdefghijklmnop"[(seed >> 16) & 15]);
+    }
+    return data;
+}
+
+static std::vector<uint8_t> image()
+{
+    std::vector<uint8_t> block = generate(5000, 1);
+    std::vector<uint8_t> data = block;
+    data.insert(data.end(), block.begin(), block.end());
+    data.insert(data.end(), 300, 0);
+    data.insert(data.end(), block.begin(), block.end());
+    return data;
+}
+
+#define SRC 0x20000
+
+static void stage(const uint8_t* gzipped, size_t size)
+{
+    std::fill(s_flash.begin(), s_flash.end(), 0x5a);
+    memcpy(&s_flash[SRC], gzipped, size);
+    s_erases = 0;
+    s_writes = 0;
+}
+
+static bool flashHas(uint32_t addr, const std::vector<uint8_t>& data)
+{
+    return memcmp(&s_flash[addr], data.data(), data.size()) == 0;
+}
+
+TEST_CASE("eboot decompresses a gzip image", "[eboot][inflate]")
+{
+    std::vector<uint8_t> expected = image();
+    stage(s_dynamic, sizeof(s_dynamic));
+    uint32_t head = 0;
+
+    SECTION("checking writes nothing")
+    {
+        REQUIRE(inflate_gzip(SRC, sizeof(s_dynamic), 0, SRC, false, &head) == expected.size());
+        CHECK(head == 0x6c626f67);
+        CHECK(s_erases == 0);
+        CHECK(s_writes == 0);
+        CHECK(s_flash[0] == 0x5a);
+    }
+    SECTION("writing")
+    {
+        REQUIRE(inflate_gzip(SRC, sizeof(s_dynamic), 0, SRC, true, &head) == expected.size());
+        CHECK(flashHas(0, expected));
+        CHECK(s_erases == (expected.size() + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE);
+        // the rest of the last sector is erased, what follows is untouched
+        CHECK(s_flash[expected.size() + 4] == 0xff);
+        CHECK(s_flash[0x4000] == 0x5a);
+        CHECK(memcmp(&s_flash[SRC], s_dynamic, sizeof(s_dynamic)) == 0);
+    }
+    SECTION("to another sector")
+    {
+        REQUIRE(inflate_gzip(SRC, sizeof(s_dynamic), 0x3000, SRC - 0x3000, true, &head) == expected.size());
+        CHECK(flashHas(0x3000, expected));
+        CHECK(s_flash[0] == 0x5a);
+    }
+}
+
+TEST_CASE("eboot decompresses stored and fixed code blocks", "[eboot][inflate]")
+{
+    uint32_t head;
+    stage(s_stored, sizeof(s_stored));
+    REQUIRE(inflate_gzip(SRC, sizeof(s_stored), 0, SRC, true, &head) == 600);
+    CHECK(flashHas(0, generate(600, 7)));
+
+    stage(s_fixed, sizeof(s_fixed));
+    const char* text = "eboot eboot eboot, decompressing";
+    REQUIRE(inflate_gzip(SRC, sizeof(s_fixed), 0, SRC, true, &head) == strlen(text));
+    CHECK(memcmp(&s_flash[0], text, strlen(text)) == 0);
+}
+
+TEST_CASE("eboot rejects a bad gzip image", "[eboot][inflate]")
+{
+    uint32_t head;
+    std::vector<uint8_t> gzipped(s_dynamic, s_dynamic + sizeof(s_dynamic));
+
+    SECTION("CRC")
+    {
+        gzipped[gzipped.size() - 8] ^= 1;
+    }
+    SECTION("size")
+    {
+        gzipped[gzipped.size() - 4] ^= 1;
+    }
+    SECTION("data")
+    {
+        gzipped[gzipped.size() / 2] ^= 0x10;
+    }
+    SECTION("header")
+    {
+        gzipped[2] = 7;
+    }
+    stage(gzipped.data(), gzipped.size());
+    CHECK(inflate_gzip(SRC, gzipped.size(), 0, SRC, false, &head) == 0);
+    CHECK(s_writes == 0);
+}
+
+TEST_CASE("eboot doesn't decompress past the space it has", "[eboot][inflate]")
+{
+    uint32_t head;
+    stage(s_dynamic, sizeof(s_dynamic));
+    // 15300 bytes need four sectors
+    CHECK(inflate_gzip(SRC, sizeof(s_dynamic), 0, 0x3000, false, &head) == 0);
+    CHECK(inflate_gzip(SRC, sizeof(s_dynamic), 0, 0x4000, false, &head) == image().size());
+    // nor reads past the end of the data
+    CHECK(inflate_gzip(SRC, sizeof(s_dynamic) - 5, 0, SRC, false, &head) == 0);
+}
@@ -0,0 +1,139 @@
+/*
+ test_eeprom_journal.cpp - EEPROMJournal tests
+ This file is part of the esp8266 core for Arduino environment.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <vector>
+#include <EEPROMJournal.h>
+#include "../common/flash_mock.h"
+
+static_assert(EEPROM_JOURNAL_SECTOR_SIZE == RamFlash::SECTOR_SIZE, "the mock flash has other sectors");
+
+typedef FlashMock<EEPROMJournal> TestJournal;
+
+TEST_CASE("EEPROMJournal keeps what was committed", "[eeprom][journal]")
+{
+    RamFlash flash(2);
+    {
+        TestJournal journal(flash);
+        journal.begin(512);
+        REQUIRE(journal.length() == 512);
+        REQUIRE(journal.read(0) == 0xff);
+        REQUIRE(journal.read(511) == 0xff);
+        journal.write(3, 42);
+        uint32_t value = 0x12345678;
+        journal.put(100, value);
+        REQUIRE(journal.commit());
+        journal.write(511, 7);
+        journal.end();
+    }
+    TestJournal journal(flash);
+    journal.begin(512);
+    uint32_t value = 0;
+    REQUIRE(journal.read(3) == 42);
+    REQUIRE(journal.get(100, value) == 0x12345678);
+    REQUIRE(journal.read(511) == 7);
+    REQUIRE(journal.read(4) == 0xff);
+}
+
+TEST_CASE("EEPROMJournal erases seldom", "[eeprom][journal]")
+{
+    RamFlash flash(2);
+    TestJournal journal(flash);
+    journal.begin(1024);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        journal.put(16, i);
+        REQUIRE(journal.commit());
+    }
+    // each commit of four bytes takes 16 of the sector
+    CHECK(flash.erases < 10);
+
+    TestJournal again(flash);
+    again.begin(1024);
+    uint32_t value = 0;
+    REQUIRE(again.get(16, value) == 999);
+}
+
+TEST_CASE("EEPROMJournal writes everything when most of it changed", "[eeprom][journal]")
+{
+    RamFlash flash(2);
+    TestJournal journal(flash);
+    journal.begin(256);
+    REQUIRE(journal.commit());
+    uint8_t* data = journal.getDataPtr();
+    for (int i = 0; i < 256; ++i) {
+        data[i] = i;
+    }
+    REQUIRE(journal.commit());
+    REQUIRE(journal.commit());
+
+    TestJournal again(flash);
+    again.begin(256);
+    for (int i = 0; i < 256; ++i) {
+        REQUIRE(again.read(i) == i);
+    }
+}
+
+TEST_CASE("EEPROMJournal survives a commit cut short", "[eeprom][journal]")
+{
+    RamFlash flash(3);
+    uint32_t committed = 0;
+    for (long budget = 0; budget < 64; ++budget) {
+        TestJournal journal(flash);
+        journal.begin(64);
+        uint32_t value = 0;
+        journal.get(8, value);
+        // one cut short where what was left to write was 0xff is all there
+        if (value == committed + 1) {
+            ++committed;
+        }
+        REQUIRE(value == (committed ? committed : 0xffffffff));
+
+        journal.put(8, committed + 1);
+        flash.writeBudget = budget;
+        if (journal.commit()) {
+            ++committed;
+        }
+        flash.writeBudget = -1;
+    }
+    REQUIRE(committed > 0);
+}
+
+TEST_CASE("EEPROMJournal survives moving to the next sector cut short", "[eeprom][journal]")
+{
+    RamFlash flash(2);
+    {
+        TestJournal journal(flash);
+        journal.begin(EEPROM_JOURNAL_MAX_SIZE);
+        for (size_t i = 0; i < journal.length(); ++i) {
+            journal.write(i, i * 7);
+        }
+        REQUIRE(journal.commit());
+    }
+    size_t erases = flash.erases;
+    for (long budget = 0; budget < 8192; budget += 97) {
+        TestJournal journal(flash);
+        journal.begin(EEPROM_JOURNAL_MAX_SIZE);
+        for (size_t i = 0; i < journal.length(); ++i) {
+            REQUIRE(journal.read(i) == (uint8_t)(i * 7));
+        }
+        // a full copy doesn't fit after the one there and has to move
+        journal.getDataPtr();
+        flash.writeBudget = budget;
+        journal.commit();
+        flash.writeBudget = -1;
+    }
+    REQUIRE(flash.erases > erases);
+}
@@ -0,0 +1,64 @@
+/*
+ bench_fs.cpp - file system benchmark on the host side SPIFFS mock
+ This file is part of the esp8266 core for Arduino environment.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <FS.h>
+#include "../common/spiffs_mock.h"
+#include "../../device/test_FS/fs_bench.h"
+
+// the JSON lines go to the file named by FS_BENCH_OUTPUT, appended to, or
+// to stdout
+static FILE* s_benchOutput = nullptr;
+
+static void benchOutput(const char* line)
+{
+    fprintf(s_benchOutput ? s_benchOutput : stdout, "%s\n", line);
+}
+
+class MockFsBench : public FsBench
+{
+public:
+    MockFsBench(fs::FS& fs) : FsBench(fs, benchOutput) { }
+
+protected:
+    bool counters(FsBenchCounters& counters) override
+    {
+        const SpiffsMock::Counters& mock = SpiffsMock::counters();
+        counters.reads = mock.reads;
+        counters.readBytes = mock.readBytes;
+        counters.writes = mock.writes;
+        counters.writeBytes = mock.writeBytes;
+        counters.erases = mock.erases;
+        return true;
+    }
+};
+
+TEST_CASE("File system benchmark", "[fs][.benchmark]")
+{
+    // the layout the device has, smaller
+    SPIFFS_MOCK_DECLARE(256, 8, 256);
+    REQUIRE(SPIFFS.begin());
+    const char* path = getenv("FS_BENCH_OUTPUT");
+    s_benchOutput = path ? fopen(path, "a") : nullptr;
+    MockFsBench bench(SPIFFS);
+    bool ok = bench.run();
+    if (s_benchOutput) {
+        fclose(s_benchOutput);
+        s_benchOutput = nullptr;
+    }
+    REQUIRE(ok);
+}
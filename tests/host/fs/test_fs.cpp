@@ -15,10 +15,14 @@
 
 #include <catch.hpp>
 #include <map>
+#include <vector>
 #include <FS.h>
+#include <AssetFS.h>
 #include "../common/spiffs_mock.h"
 #include <spiffs/spiffs.h>
 
+extern int32_t spiffs_hal_write(uint32_t addr, uint32_t size, uint8_t *src);
+
 static void createFile (const char* name, const char* content)
 {
     auto f = SPIFFS.open(name, "w");
@@ -66,6 +70,26 @@ TEST_CASE("Before begin is called, open will fail","[fs]")
     REQUIRE_FALSE(SPIFFS.open("/foo", "w"));
 }
 
+static int s_fsMade = 0;
+
+static fs::FSImplPtr makeNoFS()
+{
+    ++s_fsMade;
+    return fs::FSImplPtr();
+}
+
+TEST_CASE("FS makes its implementation on first use","[fs]")
+{
+    s_fsMade = 0;
+    FS fs(makeNoFS);
+    fs.end();
+    CHECK(s_fsMade == 0);
+    CHECK_FALSE(fs.begin());
+    CHECK(s_fsMade == 1);
+    CHECK_FALSE(fs.exists("/foo"));
+    CHECK(s_fsMade == 2);
+}
+
 TEST_CASE("FS can create file","[fs]")
 {
     SPIFFS_MOCK_DECLARE(64, 8, 512);
@@ -184,3 +208,210 @@ TEST_CASE("#1819 Can list all files with openDir(\"\")", "[fs][bugreport]")
     auto files = listDir("");
     REQUIRE(files.size() == 4);
 }
+
+TEST_CASE("Reads from a file with a mapped index", "[fs]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    REQUIRE(SPIFFS.begin());
+    {
+        auto f = SPIFFS.open("/log", "w");
+        REQUIRE(f);
+        for (int i = 0; i < 4000; ++i) {
+            f.printf("%04d", i);
+        }
+    }
+    auto f = SPIFFS.open("/log", "r");
+    REQUIRE(f);
+    REQUIRE(f.mapIndex());
+    for (int i : {3999, 0, 1234, 2500, 17}) {
+        char buf[5] = {0};
+        REQUIRE(f.seek(i * 4));
+        REQUIRE(f.read((uint8_t*) buf, 4) == 4);
+        REQUIRE(atoi(buf) == i);
+    }
+    f.unmapIndex();
+    REQUIRE(f.seek(100 * 4));
+    REQUIRE(f.readString().substring(0, 4) == "0100");
+}
+
+TEST_CASE("gc() erases the blocks of removed files", "[fs]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    FSConfig config;
+    config.gcFreeBlocks = 6;
+    REQUIRE(SPIFFS.setConfig(config));
+    REQUIRE(SPIFFS.begin());
+    String data;
+    for (int i = 0; i < 1000; ++i) {
+        data += "0123456789";
+    }
+    for (int i = 0; i < 4; ++i) {
+        String name = String("/file") + i;
+        createFile(name.c_str(), data.c_str());
+    }
+    for (int i = 0; i < 4; ++i) {
+        String name = String("/file") + i;
+        REQUIRE(SPIFFS.remove(name));
+    }
+    REQUIRE(SPIFFS.gc(1000000));
+    createFile("/after", "text");
+    REQUIRE(readFile("/after") == "text");
+}
+
+TEST_CASE("Name index finds, renames and forgets files", "[fs]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    FSConfig config;
+    config.nameIndex = true;
+    REQUIRE(SPIFFS.setConfig(config));
+    REQUIRE(SPIFFS.begin());
+    createFile("/a", "first");
+    createFile("/b", "second");
+    REQUIRE(SPIFFS.exists("/a"));
+    REQUIRE_FALSE(SPIFFS.exists("/c"));
+    REQUIRE_FALSE(SPIFFS.open("/c", "r"));
+    {
+        auto f = SPIFFS.open("/a", "a");
+        REQUIRE(f);
+        f.print(" and more");
+    }
+    REQUIRE(readFile("/a") == "first and more");
+    REQUIRE(SPIFFS.rename("/b", "/c"));
+    REQUIRE_FALSE(SPIFFS.exists("/b"));
+    REQUIRE(readFile("/c") == "second");
+    REQUIRE(SPIFFS.remove("/a"));
+    REQUIRE_FALSE(SPIFFS.exists("/a"));
+    REQUIRE_FALSE(SPIFFS.open("/a", "r"));
+    createFile("/a", "again");
+    REQUIRE(readFile("/a") == "again");
+    SPIFFS.end();
+    REQUIRE(SPIFFS.begin());
+    REQUIRE(readFile("/a") == "again");
+    REQUIRE(readFile("/c") == "second");
+    REQUIRE_FALSE(SPIFFS.exists("/b"));
+}
+
+struct Asset {
+    const char* path;
+    const char* contentType;
+    const char* data;
+    bool gzip;
+};
+
+// what tools/assetfs_pack.py makes of a sorted list of files
+static void writeAssetImage (const std::vector<Asset>& assets, uint16_t slots)
+{
+    std::vector<uint8_t> image(16 + slots * 2 + assets.size() * 28);
+    auto put32 = [&image](size_t at, uint32_t v) { memcpy(&image[at], &v, 4); };
+    auto put16 = [&image](size_t at, uint16_t v) { memcpy(&image[at], &v, 2); };
+    auto addString = [&image](const char* s) {
+        uint32_t at = image.size();
+        image.insert(image.end(), s, s + strlen(s) + 1);
+        return at;
+    };
+    for (size_t i = 0; i < assets.size(); ++i) {
+        const Asset& a = assets[i];
+        uint32_t hash = 2166136261u;
+        for (const char* p = a.path; *p; ++p) {
+            hash = (hash ^ (uint8_t) *p) * 16777619u;
+        }
+        uint16_t slot = hash & (slots - 1);
+        uint16_t index;
+        while (memcpy(&index, &image[16 + slot * 2], 2), index) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        put16(16 + slot * 2, i + 1);
+        size_t entry = 16 + slots * 2 + i * 28;
+        put32(entry, hash);
+        put32(entry + 4, addString(a.path));
+        put32(entry + 8, addString(a.contentType));
+        put32(entry + 12, addString("\"etag\""));
+        while (image.size() % 4) {
+            image.push_back(0xff);
+        }
+        put32(entry + 16, image.size());
+        put32(entry + 20, strlen(a.data));
+        put32(entry + 24, a.gzip ? 1 : 0);
+        image.insert(image.end(), a.data, a.data + strlen(a.data));
+    }
+    put32(0, 0x31534641);
+    put16(4, 1);
+    put16(6, assets.size());
+    put16(8, slots);
+    put16(10, 0);
+    put32(12, image.size());
+    spiffs_hal_write(0, image.size(), image.data());
+}
+
+TEST_CASE("AssetFS opens and lists packed files", "[fs]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    AssetFS assets(0, 64 * 1024);
+    REQUIRE_FALSE(assets.begin());
+    writeAssetImage({
+        {"/css/style.css", "text/css", "body{}", true},
+        {"/index.html", "text/html", "<html></html>", false},
+        {"/js/app.js", "application/javascript", "run();", false},
+    }, 4);
+    REQUIRE(assets.begin());
+    REQUIRE(assets.exists("/index.html"));
+    REQUIRE_FALSE(assets.exists("/index.htm"));
+    auto f = assets.open("/js/app.js", "r");
+    REQUIRE(f);
+    REQUIRE(f.size() == 6);
+    REQUIRE(String(f.name()) == "/js/app.js");
+    REQUIRE(f.readString() == "run();");
+    REQUIRE(f.seek(1, SeekEnd));
+    REQUIRE(f.read() == ';');
+    REQUIRE_FALSE(assets.open("/js/app.js", "w"));
+    REQUIRE_FALSE(assets.remove("/js/app.js"));
+    AssetInfo info;
+    REQUIRE(assets.stat("/css/style.css", info));
+    REQUIRE(info.contentType == "text/css");
+    REQUIRE(info.etag == "\"etag\"");
+    REQUIRE(info.gzip);
+    REQUIRE(info.size == 6);
+    std::set<String> files;
+    Dir dir = assets.openDir("/");
+    while (dir.next()) {
+        files.insert(dir.fileName());
+    }
+    REQUIRE(files == (std::set<String>{"/css/style.css", "/index.html", "/js/app.js"}));
+    dir = assets.openDir("/css");
+    REQUIRE(dir.next());
+    REQUIRE(String(dir.fileName()) == "/css/style.css");
+    REQUIRE(dir.openFile("r").readString() == "body{}");
+    REQUIRE_FALSE(dir.next());
+}
+
+TEST_CASE("Buffered files read and write like unbuffered ones", "[fs]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    REQUIRE(SPIFFS.begin());
+    {
+        File f = SPIFFS.open("/log.csv", "w");
+        REQUIRE(f.setBufferSize(100));
+        for (int i = 0; i < 50; ++i) {
+            f.printf("%04d,row\n", i);
+        }
+        REQUIRE(f.size() == 50 * 9);
+        REQUIRE(f.position() == 50 * 9);
+    }
+    REQUIRE(readFile("/log.csv").length() == 50 * 9);
+    File f = SPIFFS.open("/log.csv", "r+");
+    REQUIRE(f.setBufferSize(64));
+    REQUIRE(f.readStringUntil('\n') == "0000,row");
+    REQUIRE(f.position() == 9);
+    REQUIRE(f.peek() == '0');
+    REQUIRE(f.seek(9 * 3, SeekCur));
+    REQUIRE(f.readStringUntil('\n') == "0004,row");
+    REQUIRE(f.seek(9 * 40));
+    REQUIRE(f.readStringUntil('\n') == "0040,row");
+    REQUIRE(f.seek(9 * 10));
+    REQUIRE(f.write((const uint8_t*) "XXXX", 4) == 4);
+    REQUIRE(f.readStringUntil('\n') == ",row");
+    f.close();
+    String all = readFile("/log.csv");
+    REQUIRE(all.substring(9 * 10, 9 * 11) == "XXXX,row\n");
+    REQUIRE(all.substring(9 * 49) == "0049,row\n");
+}
@@ -0,0 +1,174 @@
+/*
+ test_tar_extractor.cpp - host side tests of TarExtractor
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string.h>
+#include <string>
+#include <FS.h>
+#include <TarExtractor.h>
+#include "../common/spiffs_mock.h"
+
+// a ustar entry as tar(1) writes it: header, data, padding
+static void addEntry(std::string& tar, const std::string& name, const std::string& data, char type = '0')
+{
+    char header[512];
+    memset(header, 0, sizeof(header));
+    strncpy(header, name.c_str(), 100);
+    snprintf(header + 100, 8, "%07o", 0644);
+    snprintf(header + 124, 12, "%011o", (unsigned) data.size());
+    header[156] = type;
+    memcpy(header + 257, "ustar\0" "00", 8);
+    memset(header + 148, ' ', 8);
+    unsigned sum = 0;
+    for (size_t i = 0; i < sizeof(header); ++i) {
+        sum += (uint8_t) header[i];
+    }
+    snprintf(header + 148, 8, "%06o", sum);
+    tar.append(header, sizeof(header));
+    tar += data;
+    tar.append((512 - data.size() % 512) % 512, '\0');
+}
+
+static std::string endArchive(std::string tar)
+{
+    tar.append(1024, '\0');
+    return tar;
+}
+
+static String readFile(const char* name)
+{
+    auto f = SPIFFS.open(name, "r");
+    return f ? f.readString() : String();
+}
+
+// fed in pieces of piece bytes
+static bool extract(const std::string& tar, size_t piece, TarExtractorStats* stats = nullptr)
+{
+    TarExtractor tx(SPIFFS, "/www");
+    REQUIRE(tx.begin());
+    for (size_t pos = 0; pos < tar.size(); pos += piece) {
+        size_t n = std::min(piece, tar.size() - pos);
+        if (tx.write(reinterpret_cast<const uint8_t*>(tar.data()) + pos, n) != n) {
+            break;
+        }
+    }
+    bool ok = tx.end(0);
+    if (stats) {
+        *stats = tx.stats();
+    }
+    return ok;
+}
+
+TEST_CASE("TarExtractor writes the files of an archive", "[fs][tar]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    REQUIRE(SPIFFS.begin());
+
+    std::string big(3000, 'x');
+    for (size_t i = 0; i < big.size(); ++i) {
+        big[i] = 'a' + i % 26;
+    }
+    std::string tar;
+    addEntry(tar, "./", "", '5');
+    addEntry(tar, "./index.html", "<html></html>");
+    addEntry(tar, "js/app.js", big);
+    addEntry(tar, "empty", "");
+    tar = endArchive(tar);
+
+    for (size_t piece : { (size_t) 1, (size_t) 100, (size_t) 4096 }) {
+        SPIFFS.remove("/www/index.html");
+        SPIFFS.remove("/www/js/app.js");
+        SPIFFS.remove("/www/empty");
+        TarExtractorStats stats;
+        REQUIRE(extract(tar, piece, &stats));
+        CHECK(stats.files == 3);
+        CHECK(stats.written == 3);
+        CHECK(stats.unchanged == 0);
+        CHECK(stats.skipped == 1);
+        CHECK(stats.bytes == tar.size());
+        CHECK(readFile("/www/index.html") == "<html></html>");
+        CHECK(readFile("/www/js/app.js") == big.c_str());
+        CHECK(SPIFFS.exists("/www/empty"));
+        CHECK_FALSE(SPIFFS.exists(TAR_EXTRACTOR_TEMP));
+    }
+}
+
+TEST_CASE("TarExtractor leaves files that didn't change alone", "[fs][tar]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    REQUIRE(SPIFFS.begin());
+
+    std::string big(2500, 'q');
+    std::string tar;
+    addEntry(tar, "a.css", "body{}");
+    addEntry(tar, "b.js", big);
+    REQUIRE(extract(endArchive(tar), 512));
+
+    // the same again: nothing is written
+    uint32_t writes = SpiffsMock::counters().writes;
+    TarExtractorStats stats;
+    REQUIRE(extract(endArchive(tar), 300, &stats));
+    CHECK(stats.unchanged == 2);
+    CHECK(stats.written == 0);
+    CHECK(SpiffsMock::counters().writes == writes);
+
+    // the same size, a difference past the first buffer
+    std::string changed = big;
+    changed[2000] = 'z';
+    tar.clear();
+    addEntry(tar, "a.css", "body{}");
+    addEntry(tar, "b.js", changed);
+    REQUIRE(extract(endArchive(tar), 700, &stats));
+    CHECK(stats.unchanged == 1);
+    CHECK(stats.written == 1);
+    CHECK(readFile("/www/b.js") == changed.c_str());
+    CHECK(readFile("/www/a.css") == "body{}");
+}
+
+TEST_CASE("TarExtractor keeps the old file when the archive stops", "[fs][tar]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    REQUIRE(SPIFFS.begin());
+
+    std::string tar;
+    addEntry(tar, "page.html", "old page");
+    REQUIRE(extract(endArchive(tar), 512));
+
+    tar.clear();
+    addEntry(tar, "page.html", std::string(1500, 'n'));
+    tar.resize(512 + 800);
+    TarExtractor tx(SPIFFS, "/www");
+    REQUIRE(tx.begin());
+    CHECK(tx.write(reinterpret_cast<const uint8_t*>(tar.data()), tar.size()) == tar.size());
+    CHECK_FALSE(tx.end(0));
+    CHECK(tx.error() == TAR_ERROR_TRUNCATED);
+    CHECK(readFile("/www/page.html") == "old page");
+    CHECK_FALSE(SPIFFS.exists(TAR_EXTRACTOR_TEMP));
+}
+
+TEST_CASE("TarExtractor rejects what isn't an archive", "[fs][tar]")
+{
+    SPIFFS_MOCK_DECLARE(64, 8, 512);
+    REQUIRE(SPIFFS.begin());
+
+    std::string tar;
+    addEntry(tar, "x", "data");
+    tar[148] ^= 1;
+    TarExtractor tx(SPIFFS);
+    REQUIRE(tx.begin());
+    CHECK(tx.write(reinterpret_cast<const uint8_t*>(tar.data()), tar.size()) == 0);
+    CHECK_FALSE(tx.end(0));
+    CHECK(tx.error() == TAR_ERROR_HEADER);
+    CHECK_FALSE(SPIFFS.exists("/x"));
+}
@@ -0,0 +1,371 @@
+/*
+ heap_replay.cpp - runs a heap trace from a device against the host build of
+ umm_malloc
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include "heap_replay.h"
+#include "umm_malloc_host.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#ifdef UMM_SLAB
+#define HOST_SLAB 1
+#else
+#define HOST_SLAB 0
+#endif
+
+static const char* s_kindNames[] = { "malloc", "calloc", "realloc", "free" };
+
+// bytes umm_malloc gives a block of n blocks
+static size_t blocksBytes(unsigned n)
+{
+    return n * 8 - 4;
+}
+
+HeapReplay::HeapReplay(Output output, void* arg, uint32_t sampleEvery)
+: _output(output), _arg(arg), _sampleEvery(sampleEvery)
+{
+}
+
+void HeapReplay::_print(const char* format, ...)
+{
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    _output(buffer, _arg);
+}
+
+bool HeapReplay::line(const char* text)
+{
+    // the trace may be mixed with other output on the same line
+    const char* p = text;
+    while ((p = strchr(p, '~')) != nullptr) {
+        if (p[1] && strchr("hlmcrf", p[1]) && p[2] == ' ') {
+            break;
+        }
+        ++p;
+    }
+    if (!p) {
+        return false;
+    }
+
+    char tag = p[1];
+    p += 3;
+    unsigned a = 0, b = 0, c = 0;
+    int poison = 0, slab = 0;
+    int used = 0;
+    char site[128] = "";
+
+    switch (tag) {
+    case 'h':
+        if (sscanf(p, "%x %u %d %d", &a, &b, &poison, &slab) != 4) {
+            return false;
+        }
+        _start(a, b, poison, slab);
+        return true;
+    case 'l':
+        if (!_started || sscanf(p, "%x %u", &a, &b) != 2) {
+            return false;
+        }
+        _live(a, b);
+        return true;
+    case 'f':
+        if (!_started || sscanf(p, "%x", &a) != 1) {
+            return false;
+        }
+        _endLive();
+        _free(a);
+        return true;
+    case 'm':
+    case 'c':
+        if (!_started || sscanf(p, "%x %u%n", &a, &b, &used) != 2) {
+            return false;
+        }
+        sscanf(p + used, " %127s", site);
+        _endLive();
+        _alloc(tag == 'm' ? KIND_MALLOC : KIND_CALLOC, a, b, site);
+        return true;
+    case 'r':
+        if (!_started || sscanf(p, "%x %x %u%n", &a, &b, &c, &used) != 3) {
+            return false;
+        }
+        sscanf(p + used, " %127s", site);
+        _endLive();
+        _realloc(a, b, c, site);
+        return true;
+    }
+    return false;
+}
+
+void* HeapReplay::hostPointer(uint32_t devicePtr) const
+{
+    auto it = _blocks.find(devicePtr);
+    return it == _blocks.end() ? nullptr : it->second;
+}
+
+void HeapReplay::_start(uint32_t heapAddr, uint32_t heapSize, int poison, int slab)
+{
+    if (_started) {
+        finish();
+    }
+    umm_host_init(heapSize);
+    _started = true;
+    _inLive = true;
+    _heapAddr = heapAddr;
+    _firstBlock = _nextBlock = umm_host_first_free();
+    _fillers.clear();
+    _blocks.clear();
+    for (auto& latencies : _latencies) {
+        latencies.clear();
+    }
+    _stats = Stats();
+    _stats.exactLayout = !poison && slab == HOST_SLAB && heapSize <= UMM_HOST_HEAP_MAX;
+    _stats.minFree = umm_free_heap_size();
+    _stats.minMaxFree = umm_max_free_block_size();
+    _print("{\"event\":\"start\",\"variant\":\"%s\",\"heap\":%u,\"device_poison\":%d,"
+           "\"device_slab\":%d,\"exact_layout\":%s}",
+           UMM_HOST_VARIANT, (unsigned) umm_host_heap_size, poison, slab,
+           _stats.exactLayout ? "true" : "false");
+}
+
+void HeapReplay::_live(uint32_t ptr, uint32_t size)
+{
+    if (!_inLive) {
+        // the live blocks come before anything else
+        return;
+    }
+    void* host = nullptr;
+    unsigned block = (ptr - _heapAddr) / 8;
+    if (_stats.exactLayout && block >= _firstBlock) {
+        // the gap before it is taken, for now, so that it goes where it was
+        if (block > _nextBlock) {
+            void* filler = umm_malloc(blocksBytes(block - _nextBlock));
+            if (filler) {
+                _fillers.push_back(filler);
+            }
+        }
+        host = umm_malloc(size);
+        if (host && umm_host_block(host) != block) {
+            _stats.exactLayout = false;
+        }
+        _nextBlock = umm_host_first_free();
+    } else {
+        // slab slots, or no way to put it where it was
+        host = umm_malloc(size);
+    }
+    ++_stats.ops;
+    if (!host) {
+        _stats.exactLayout = false;
+        ++_stats.failures;
+        _fail(KIND_MALLOC, size, "live");
+    }
+    _blocks[ptr] = host;
+}
+
+void HeapReplay::_endLive()
+{
+    if (!_inLive) {
+        return;
+    }
+    _inLive = false;
+    for (void* filler : _fillers) {
+        umm_free(filler);
+    }
+    _fillers.clear();
+    _stats.minFree = umm_free_heap_size();
+    _stats.minMaxFree = umm_max_free_block_size();
+    _stats.minMaxFreeOp = _stats.ops;
+    _sample();
+}
+
+void HeapReplay::_alloc(Kind kind, uint32_t ptr, uint32_t size, const char* site)
+{
+    auto start = std::chrono::steady_clock::now();
+    void* host = kind == KIND_CALLOC ? umm_calloc(1, size) : umm_malloc(size);
+    _done(kind, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+    if (!ptr) {
+        ++_stats.deviceFailures;
+        if (host) {
+            // the device went on without it
+            umm_free(host);
+        } else {
+            ++_stats.bothFailed;
+        }
+    } else {
+        if (!host) {
+            ++_stats.failures;
+            _fail(kind, size, site);
+        }
+        auto it = _blocks.find(ptr);
+        if (it != _blocks.end() && it->second) {
+            // its free isn't in the trace
+            ++_stats.unknown;
+            umm_free(it->second);
+        }
+        _blocks[ptr] = host;
+    }
+    _sample();
+}
+
+void HeapReplay::_realloc(uint32_t ptr, uint32_t oldPtr, uint32_t size, const char* site)
+{
+    void* old = nullptr;
+    if (oldPtr) {
+        auto it = _blocks.find(oldPtr);
+        if (it == _blocks.end()) {
+            ++_stats.unknown;
+            if (!size) {
+                return;
+            }
+        } else {
+            // null if it failed here, it is allocated anew
+            old = it->second;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    void* host = umm_realloc(old, size);
+    _done(KIND_REALLOC, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+    if (!size) {
+        // a free
+        _blocks.erase(oldPtr);
+    } else if (!ptr) {
+        // the old block stays with the device, here it may have moved
+        ++_stats.deviceFailures;
+        if (host) {
+            if (old) {
+                _blocks[oldPtr] = host;
+            } else {
+                umm_free(host);
+            }
+        } else {
+            ++_stats.bothFailed;
+        }
+    } else {
+        if (old) {
+            _blocks.erase(oldPtr);
+        }
+        if (!host) {
+            ++_stats.failures;
+            _fail(KIND_REALLOC, size, site);
+            // what the device got under its new pointer is here still the old block
+            host = old;
+        }
+        _blocks[ptr] = host;
+    }
+    _sample();
+}
+
+void HeapReplay::_free(uint32_t ptr)
+{
+    auto it = _blocks.find(ptr);
+    if (it == _blocks.end()) {
+        ++_stats.unknown;
+        return;
+    }
+    void* host = it->second;
+    _blocks.erase(it);
+    if (!host) {
+        // it failed here
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    umm_free(host);
+    _done(KIND_FREE, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    _sample();
+}
+
+void HeapReplay::_done(Kind kind, uint64_t ns)
+{
+    ++_stats.ops;
+    _latencies[kind].push_back(ns > UINT32_MAX ? UINT32_MAX : (uint32_t) ns);
+
+    size_t freeBytes = umm_free_heap_size();
+    size_t maxFree = umm_max_free_block_size();
+    _stats.minFree = std::min(_stats.minFree, freeBytes);
+    if (maxFree < _stats.minMaxFree) {
+        _stats.minMaxFree = maxFree;
+        _stats.minMaxFreeOp = _stats.ops;
+    }
+}
+
+void HeapReplay::_fail(Kind kind, uint32_t size, const char* site)
+{
+    // sites are file:line, nothing to escape but in a broken capture
+    char clean[128];
+    size_t i = 0;
+    for (; site[i] && i < sizeof(clean) - 1; ++i) {
+        clean[i] = (site[i] == '"' || site[i] == '\\') ? '_' : site[i];
+    }
+    clean[i] = 0;
+    _print("{\"event\":\"fail\",\"op\":%u,\"kind\":\"%s\",\"size\":%u,\"site\":\"%s\","
+           "\"free\":%u,\"max_free\":%u}",
+           _stats.ops, s_kindNames[kind], size, clean,
+           (unsigned) umm_free_heap_size(), (unsigned) umm_max_free_block_size());
+}
+
+// blocks the device has that are here as well
+static unsigned liveBlocks(const std::map<uint32_t, void*>& blocks)
+{
+    unsigned n = 0;
+    for (const auto& block : blocks) {
+        if (block.second) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+void HeapReplay::_sample()
+{
+    if (_inLive || (_sampleEvery && _stats.ops % _sampleEvery)) {
+        return;
+    }
+    _print("{\"event\":\"sample\",\"op\":%u,\"free\":%u,\"max_free\":%u,\"frag\":%d,"
+           "\"free_blocks\":%u,\"live\":%u}",
+           _stats.ops, (unsigned) umm_free_heap_size(), (unsigned) umm_max_free_block_size(),
+           umm_fragmentation_metric(), (unsigned) umm_free_block_count(), liveBlocks(_blocks));
+}
+
+void HeapReplay::finish()
+{
+    if (!_started) {
+        return;
+    }
+    _endLive();
+    for (int kind = 0; kind < KIND_COUNT; ++kind) {
+        std::vector<uint32_t>& latencies = _latencies[kind];
+        if (latencies.empty()) {
+            continue;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        size_t n = latencies.size();
+        _print("{\"event\":\"latency\",\"kind\":\"%s\",\"n\":%u,\"p50_ns\":%u,\"p99_ns\":%u,\"max_ns\":%u}",
+               s_kindNames[kind], (unsigned) n, latencies[n / 2],
+               latencies[std::min(n - 1, n * 99 / 100)], latencies[n - 1]);
+    }
+    _print("{\"event\":\"end\",\"variant\":\"%s\",\"ops\":%u,\"failures\":%u,\"device_failures\":%u,"
+           "\"both_failed\":%u,\"unknown\":%u,\"min_free\":%u,\"min_max_free\":%u,\"min_max_free_op\":%u,"
+           "\"live\":%u,\"exact_layout\":%s}",
+           UMM_HOST_VARIANT, _stats.ops, _stats.failures, _stats.deviceFailures, _stats.bothFailed,
+           _stats.unknown, (unsigned) _stats.minFree, (unsigned) _stats.minMaxFree, _stats.minMaxFreeOp,
+           liveBlocks(_blocks), _stats.exactLayout ? "true" : "false");
+    _started = false;
+}
@@ -0,0 +1,97 @@
+/*
+ heap_replay.h - runs a heap trace from a device against the host build of
+ umm_malloc
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef heap_replay_h
+#define heap_replay_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+// Reads the lines heap_trace_start() makes a DEBUG_ESP_HEAP_TRACE build
+// print (see cores/esp8266/heap.c) and does the same allocations on a host
+// heap of the same size, with whatever variant of umm_malloc this was built
+// with. The blocks that were live when the trace started are put where they
+// were on the device, as long as the device heap had the same layout (no
+// poisoning, slabs or not as here).
+//
+// What comes out is JSON, one object per line:
+//   {"event":"start","variant":"best_fit","heap":40000,"exact_layout":true}
+//   {"event":"sample","op":100,"free":21032,"max_free":9200,"frag":56,...}
+//   {"event":"fail","op":812,"kind":"malloc","size":1460,"site":"..."...}
+//   {"event":"latency","kind":"malloc","n":5210,"p50_ns":90,...}
+//   {"event":"end","ops":12000,"failures":1,...}
+// A fail event is an allocation that failed here but not on the device.
+class HeapReplay
+{
+public:
+    typedef void (*Output)(const char* line, void* arg);
+
+    struct Stats
+    {
+        uint32_t ops = 0;             // operations replayed, live blocks included
+        uint32_t failures = 0;        // failed here, not on the device
+        uint32_t deviceFailures = 0;  // failed on the device
+        uint32_t bothFailed = 0;      // of those, failed here as well
+        uint32_t unknown = 0;         // freed or reallocated, never allocated
+        size_t   minFree = 0;
+        size_t   minMaxFree = 0;      // the smallest "largest free block"
+        uint32_t minMaxFreeOp = 0;
+        bool     exactLayout = false; // the live blocks are where they were
+    };
+
+    HeapReplay(Output output, void* arg = nullptr, uint32_t sampleEvery = 100);
+
+    // One line of a capture; returns false when it isn't a trace line.
+    // Debug output around the lines is fine.
+    bool line(const char* text);
+    // The latency and end events of the trace going on
+    void finish();
+
+    const Stats& stats() const { return _stats; }
+    // Where the block the device has at devicePtr is here, nullptr if none
+    void* hostPointer(uint32_t devicePtr) const;
+
+protected:
+    enum Kind { KIND_MALLOC, KIND_CALLOC, KIND_REALLOC, KIND_FREE, KIND_COUNT };
+
+    void _start(uint32_t heapAddr, uint32_t heapSize, int poison, int slab);
+    void _live(uint32_t ptr, uint32_t size);
+    void _endLive();
+    void _alloc(Kind kind, uint32_t ptr, uint32_t size, const char* site);
+    void _realloc(uint32_t ptr, uint32_t oldPtr, uint32_t size, const char* site);
+    void _free(uint32_t ptr);
+    void _done(Kind kind, uint64_t ns);
+    void _fail(Kind kind, uint32_t size, const char* site);
+    void _sample();
+    void _print(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    Output   _output;
+    void*    _arg;
+    uint32_t _sampleEvery;
+    bool     _started = false;
+    bool     _inLive = false;
+    uint32_t _heapAddr = 0;
+    unsigned _firstBlock = 0;          // the first free block of an empty heap
+    unsigned _nextBlock = 0;           // where the next live block goes
+    std::vector<void*> _fillers;       // hold the gaps between live blocks
+    std::map<uint32_t, void*> _blocks; // device pointer -> host pointer, null
+                                       // when it failed here
+    std::vector<uint32_t> _latencies[KIND_COUNT];
+    Stats    _stats;
+};
+
+#endif // heap_replay_h
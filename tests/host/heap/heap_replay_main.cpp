@@ -0,0 +1,73 @@
+/*
+ heap_replay_main.cpp - replays a captured heap trace, see heap_replay.h
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heap_replay.h"
+
+// usage: heap_replay [-s <ops per sample>] [capture file]
+// The capture is the serial output of a DEBUG_ESP_HEAP_TRACE build, read
+// from stdin when no file is given. `make heap-replay` builds one binary
+// per umm_malloc variant; the same capture through each of them compares
+// how they fragment.
+
+static void printLine(const char* line, void* arg)
+{
+    (void) arg;
+    printf("%s\n", line);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t sampleEvery = 100;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            sampleEvery = strtoul(argv[++i], nullptr, 10);
+        } else if (argv[i][0] == '-' && argv[i][1]) {
+            fprintf(stderr, "usage: %s [-s <ops per sample>] [capture file]\n", argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    FILE* input = stdin;
+    if (path && strcmp(path, "-")) {
+        input = fopen(path, "r");
+        if (!input) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    HeapReplay replay(printLine, nullptr, sampleEvery);
+    char line[512];
+    uint32_t lines = 0;
+    while (fgets(line, sizeof(line), input)) {
+        if (replay.line(line)) {
+            ++lines;
+        }
+    }
+    replay.finish();
+    if (input != stdin) {
+        fclose(input);
+    }
+    if (!lines) {
+        fprintf(stderr, "no heap trace in the input\n");
+        return 1;
+    }
+    return replay.stats().failures ? 3 : 0;
+}
@@ -0,0 +1,149 @@
+/*
+ test_heap_replay.cpp - host side tests for the heap trace replay
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../heap/heap_replay.h"
+#include "../heap/umm_malloc_host.h"
+
+static const uint32_t HEAP_ADDR = 0x3fff0000;
+
+static void collect(const char* line, void* arg)
+{
+    ((std::vector<std::string>*) arg)->push_back(line);
+}
+
+// the pointer a device gives for an allocation at block b
+static uint32_t devicePtr(unsigned block)
+{
+    return HEAP_ADDR + block * 8 + 4;
+}
+
+static std::string format(const char* fmt, uint32_t a, uint32_t b = 0, uint32_t c = 0)
+{
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), fmt, a, b, c);
+    return buffer;
+}
+
+static size_t countEvents(const std::vector<std::string>& lines, const char* event)
+{
+    std::string key = std::string("{\"event\":\"") + event + "\"";
+    size_t n = 0;
+    for (const std::string& line : lines) {
+        if (line.compare(0, key.size(), key) == 0) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+TEST_CASE("Live blocks are put where they were", "[heap][replay]")
+{
+    std::vector<std::string> lines;
+    HeapReplay replay(collect, &lines, 1);
+    // where an empty heap starts giving blocks
+    umm_host_init(8192);
+    unsigned first = umm_host_first_free();
+
+    REQUIRE(replay.line(format("~h %x %u 0 0", HEAP_ADDR, 8192).c_str()));
+    // 3 blocks, a hole of 6, then 1 block
+    REQUIRE(replay.line(format("~l %x %u", devicePtr(first), 20).c_str()));
+    REQUIRE(replay.line(format("~l %x %u", devicePtr(first + 9), 4).c_str()));
+    // a best fit goes into the hole, a first fit too
+    REQUIRE(replay.line(format("~m %x %u main.cpp:12", devicePtr(first + 3), 8).c_str()));
+
+    CHECK(umm_host_block(replay.hostPointer(devicePtr(first))) == first);
+    CHECK(umm_host_block(replay.hostPointer(devicePtr(first + 9))) == first + 9);
+    CHECK(umm_host_block(replay.hostPointer(devicePtr(first + 3))) == first + 3);
+    CHECK(replay.stats().exactLayout);
+
+    REQUIRE(replay.line(format("~f %x", devicePtr(first + 9)).c_str()));
+    CHECK(replay.hostPointer(devicePtr(first + 9)) == nullptr);
+    replay.finish();
+
+    CHECK(replay.stats().ops == 4);
+    CHECK(replay.stats().failures == 0);
+    CHECK(countEvents(lines, "start") == 1);
+    CHECK(countEvents(lines, "sample") >= 2);
+    CHECK(countEvents(lines, "latency") == 2);
+    CHECK(countEvents(lines, "end") == 1);
+}
+
+TEST_CASE("Allocations that fail only here are reported", "[heap][replay]")
+{
+    std::vector<std::string> lines;
+    HeapReplay replay(collect, &lines, 0);
+
+    REQUIRE(replay.line(format("~h %x %u 1 0", HEAP_ADDR, 1024).c_str()));
+    CHECK_FALSE(replay.stats().exactLayout);
+    // the device had room for it, this heap doesn't
+    REQUIRE(replay.line(format("~m %x %u WString.cpp:150", devicePtr(10), 2000).c_str()));
+    // the device had no room either
+    REQUIRE(replay.line(format("~c 0 %u", 4000).c_str()));
+    // fits here, not on the device: it is freed right away
+    REQUIRE(replay.line(format("~m 0 %u", 16).c_str()));
+    CHECK(umm_free_block_count() == 1);
+    replay.finish();
+
+    CHECK(replay.stats().failures == 1);
+    CHECK(replay.stats().deviceFailures == 2);
+    CHECK(replay.stats().bothFailed == 1);
+    REQUIRE(countEvents(lines, "fail") == 1);
+    bool found = false;
+    for (const std::string& line : lines) {
+        if (line.find("\"site\":\"WString.cpp:150\"") != std::string::npos) {
+            found = true;
+        }
+    }
+    CHECK(found);
+}
+
+TEST_CASE("Reallocations follow their blocks", "[heap][replay]")
+{
+    std::vector<std::string> lines;
+    HeapReplay replay(collect, &lines, 0);
+
+    // other output on the serial port is skipped
+    CHECK_FALSE(replay.line("connected, IP 192.168.1.10"));
+    CHECK_FALSE(replay.line(format("~m %x %u", devicePtr(1), 10).c_str()));
+    REQUIRE(replay.line(format("1234 ~h %x %u 0 0\r\n", HEAP_ADDR, 4096).c_str()));
+
+    REQUIRE(replay.line(format("~m %x %u", devicePtr(1), 10).c_str()));
+    void* block = replay.hostPointer(devicePtr(1));
+    REQUIRE(block);
+    memcpy(block, "abcdefghi", 10);
+    // a realloc that moves, on the device
+    REQUIRE(replay.line(format("~r %x %x %u", devicePtr(40), devicePtr(1), 100).c_str()));
+    CHECK(replay.hostPointer(devicePtr(1)) == nullptr);
+    void* moved = replay.hostPointer(devicePtr(40));
+    REQUIRE(moved);
+    CHECK(strcmp((const char*) moved, "abcdefghi") == 0);
+    // realloc(NULL) and realloc(p, 0)
+    REQUIRE(replay.line(format("~r %x 0 %u", devicePtr(80), 30).c_str()));
+    CHECK(replay.hostPointer(devicePtr(80)));
+    REQUIRE(replay.line(format("~r 0 %x 0", devicePtr(80)).c_str()));
+    CHECK(replay.hostPointer(devicePtr(80)) == nullptr);
+    // never allocated as far as the trace goes
+    REQUIRE(replay.line(format("~f %x", devicePtr(200)).c_str()));
+    REQUIRE(replay.line(format("~f %x", devicePtr(40)).c_str()));
+    replay.finish();
+
+    CHECK(replay.stats().unknown == 1);
+    CHECK(replay.stats().failures == 0);
+    CHECK(umm_free_block_count() == 1);
+}
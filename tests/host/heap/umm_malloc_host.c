@@ -0,0 +1,39 @@
+/*
+ umm_malloc_host.c - the core's umm_malloc built for the host
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include "umm_malloc_host.h"
+#include "../../../cores/esp8266/umm_malloc/umm_malloc.c"
+
+char umm_host_heap[UMM_HOST_HEAP_MAX] __attribute__((aligned(8)));
+size_t umm_host_heap_size = UMM_HOST_HEAP_MAX;
+
+void *umm_last_fail_alloc_addr = NULL;
+int umm_last_fail_alloc_size = 0;
+
+void umm_host_init(size_t size)
+{
+    umm_host_heap_size = size < UMM_HOST_HEAP_MAX ? size : UMM_HOST_HEAP_MAX;
+    umm_init();
+}
+
+unsigned umm_host_block(const void* ptr)
+{
+    /* the data of block b is 4 bytes into it */
+    return (unsigned) (((const char*) ptr - (const char*) umm_heap) / sizeof(umm_block));
+}
+
+unsigned umm_host_first_free(void)
+{
+    return UMM_NFREE(0);
+}
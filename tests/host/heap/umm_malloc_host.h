@@ -0,0 +1,87 @@
+/*
+ umm_malloc_host.h - the core's umm_malloc built for the host, on a heap of
+ any size up to what a device can have
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef umm_malloc_host_h
+#define umm_malloc_host_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <c_types.h>
+
+// This stands in for umm_malloc_cfg.h, which needs the SDK. Build with
+// -DUMM_FIRST_FIT or -DUMM_SLAB to try those; poisoning stays off.
+#define _UMM_MALLOC_CFG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the most umm_malloc can address: 32767 blocks of 8 bytes
+#define UMM_HOST_HEAP_MAX (0x7fff * 8)
+
+extern char umm_host_heap[UMM_HOST_HEAP_MAX];
+extern size_t umm_host_heap_size;
+
+#define UMM_MALLOC_CFG__HEAP_ADDR   ((uintptr_t)umm_host_heap)
+#define UMM_MALLOC_CFG__HEAP_SIZE   (umm_host_heap_size)
+
+#define UMM_H_ATTPACKPRE
+#define UMM_H_ATTPACKSUF __attribute__((__packed__))
+
+#define UMM_CRITICAL_ENTRY()
+#define UMM_CRITICAL_EXIT()
+
+#define UMM_POISON_SIZE_BEFORE 4
+#define UMM_POISON_SIZE_AFTER  4
+#define UMM_POISONED_BLOCK_LEN_TYPE uint32_t
+
+#define UMM_HEAP_CORRUPTION_CB() abort()
+
+#ifndef UMM_CHECK_BLOCKS_PER_CALL
+#define UMM_CHECK_BLOCKS_PER_CALL 8
+#endif
+
+#ifndef UMM_SLAB_CLASSES
+#define UMM_SLAB_CLASSES 4
+#endif
+
+#ifndef UMM_SLAB_SLOTS
+#define UMM_SLAB_SLOTS 16
+#endif
+
+#if defined(UMM_FIRST_FIT)
+#define UMM_HOST_VARIANT "first_fit"
+#elif defined(UMM_SLAB)
+#define UMM_HOST_VARIANT "best_fit_slab"
+#else
+#define UMM_HOST_VARIANT "best_fit"
+#endif
+
+// (Re)starts with an empty heap of size bytes, size is capped at UMM_HOST_HEAP_MAX
+void umm_host_init(size_t size);
+// umm block number of an allocation, as on the device
+unsigned umm_host_block(const void* ptr);
+// where the next allocation goes, if it fits: the first free block
+unsigned umm_host_first_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include <umm_malloc/umm_malloc.h>
+
+#endif /* umm_malloc_host_h */
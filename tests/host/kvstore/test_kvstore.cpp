@@ -0,0 +1,225 @@
+/*
+ test_kvstore.cpp - KeyValueStore tests
+ This file is part of the esp8266 core for Arduino environment.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ */
+
+#include <catch.hpp>
+#include <string.h>
+#include <vector>
+#include <KeyValueStore.h>
+#include "../common/flash_mock.h"
+
+static_assert(KVS_SECTOR_SIZE == RamFlash::SECTOR_SIZE, "the mock flash has other sectors");
+
+typedef FlashMock<KeyValueStore> TestStore;
+
+TEST_CASE("KeyValueStore keeps typed values", "[kvstore]")
+{
+    RamFlash flash(3);
+    {
+        TestStore store(flash);
+        REQUIRE(store.begin());
+        REQUIRE(store.count() == 0);
+        REQUIRE(store.getInt("missing", -5) == -5);
+        REQUIRE(store.putBool("on", true));
+        REQUIRE(store.putInt("offset", -1234));
+        REQUIRE(store.putUInt("port", 8266));
+        REQUIRE(store.putInt64("big", -(1LL << 40)));
+        REQUIRE(store.putUInt64("bigger", 1ULL << 63));
+        REQUIRE(store.putFloat("gain", 1.5f));
+        REQUIRE(store.putDouble("pi", 3.141592653589793));
+        REQUIRE(store.putString("ssid", "some network"));
+        uint8_t key[20];
+        for (size_t i = 0; i < sizeof(key); ++i) {
+            key[i] = i * 13;
+        }
+        REQUIRE(store.putBytes("psk", key, sizeof(key)));
+        REQUIRE(store.count() == 9);
+        REQUIRE_FALSE(store.putInt("", 1));
+        REQUIRE_FALSE(store.putInt("a_key_that_is_too_long", 1));
+    }
+
+    TestStore store(flash);
+    REQUIRE(store.begin());
+    REQUIRE(store.count() == 9);
+    REQUIRE(store.getBool("on") == true);
+    REQUIRE(store.getInt("offset") == -1234);
+    REQUIRE(store.getUInt("port") == 8266);
+    REQUIRE(store.getInt64("big") == -(1LL << 40));
+    REQUIRE(store.getUInt64("bigger") == 1ULL << 63);
+    REQUIRE(store.getFloat("gain") == 1.5f);
+    REQUIRE(store.getDouble("pi") == 3.141592653589793);
+    REQUIRE(store.getString("ssid") == "some network");
+    REQUIRE(store.getBytesLength("psk") == 20);
+    uint8_t key[20] = { 0 };
+    REQUIRE(store.getBytes("psk", key, sizeof(key)) == 20);
+    for (size_t i = 0; i < sizeof(key); ++i) {
+        REQUIRE(key[i] == (uint8_t)(i * 13));
+    }
+    // the wrong type gives the default
+    REQUIRE(store.getInt("port", 7) == 7);
+    REQUIRE(store.getType("port") == KVS_TYPE_UINT);
+    REQUIRE(store.getType("nothing") == KVS_TYPE_NONE);
+}
+
+TEST_CASE("KeyValueStore replaces and removes", "[kvstore]")
+{
+    RamFlash flash(3);
+    {
+        TestStore store(flash);
+        REQUIRE(store.begin());
+        REQUIRE(store.putUInt("a", 1));
+        REQUIRE(store.putUInt("b", 2));
+        REQUIRE(store.putUInt("a", 3));
+        REQUIRE(store.putString("b", "two"));
+        REQUIRE(store.remove("a"));
+        REQUIRE_FALSE(store.remove("a"));
+        REQUIRE_FALSE(store.isKey("a"));
+        REQUIRE(store.count() == 1);
+
+        // the same value again leaves the flash as it is
+        std::vector<uint8_t> before = flash.data;
+        REQUIRE(store.putString("b", "two"));
+        REQUIRE(flash.data == before);
+    }
+    TestStore store(flash);
+    REQUIRE(store.begin());
+    REQUIRE(store.count() == 1);
+    REQUIRE_FALSE(store.isKey("a"));
+    REQUIRE(store.getString("b") == "two");
+    REQUIRE(store.clear());
+    REQUIRE(store.count() == 0);
+    REQUIRE_FALSE(store.isKey("b"));
+}
+
+TEST_CASE("KeyValueStore compacts", "[kvstore]")
+{
+    RamFlash flash(3);
+    TestStore store(flash);
+    REQUIRE(store.begin());
+    char key[16];
+    for (int i = 0; i < 100; ++i) {
+        snprintf(key, sizeof(key), "key%d", i);
+        REQUIRE(store.putInt(key, i));
+    }
+    // many more writes than fit in the sectors
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < 100; i += 7) {
+            snprintf(key, sizeof(key), "key%d", i);
+            REQUIRE(store.putInt(key, i + round * 1000));
+            store.handle();
+        }
+    }
+    REQUIRE(flash.erases > 3);
+    REQUIRE(store.count() == 100);
+
+    TestStore again(flash);
+    REQUIRE(again.begin());
+    REQUIRE(again.count() == 100);
+    for (int i = 0; i < 100; ++i) {
+        snprintf(key, sizeof(key), "key%d", i);
+        REQUIRE(again.getInt(key, -1) == ((i % 7) ? i : i + 49 * 1000));
+    }
+}
+
+TEST_CASE("KeyValueStore compacts two sectors without handle()", "[kvstore]")
+{
+    RamFlash flash(2);
+    TestStore store(flash);
+    REQUIRE(store.begin());
+    std::vector<uint8_t> blob(1000, 0x5a);
+    REQUIRE(store.putBytes("blob", blob.data(), blob.size()));
+    for (uint32_t i = 0; i < 2000; ++i) {
+        REQUIRE(store.putUInt("counter", i));
+    }
+    TestStore again(flash);
+    REQUIRE(again.begin());
+    REQUIRE(again.getUInt("counter") == 1999);
+    REQUIRE(again.getBytesLength("blob") == 1000);
+}
+
+TEST_CASE("KeyValueStore doesn't bring back what was removed", "[kvstore]")
+{
+    RamFlash flash(4);
+    TestStore store(flash);
+    REQUIRE(store.begin());
+    REQUIRE(store.putString("gone", "old value"));
+    REQUIRE(store.putUInt("counter", 0));
+    REQUIRE(store.remove("gone"));
+    for (uint32_t i = 1; i < 3000; ++i) {
+        REQUIRE(store.putUInt("counter", i));
+        store.handle();
+    }
+    TestStore again(flash);
+    REQUIRE(again.begin());
+    REQUIRE_FALSE(again.isKey("gone"));
+    REQUIRE(again.getUInt("counter") == 2999);
+}
+
+TEST_CASE("KeyValueStore refuses what doesn't fit", "[kvstore]")
+{
+    RamFlash flash(2);
+    TestStore store(flash);
+    REQUIRE(store.begin());
+    std::vector<uint8_t> blob(3000, 1);
+    REQUIRE(store.putBytes("one", blob.data(), blob.size()));
+    REQUIRE_FALSE(store.putBytes("two", blob.data(), blob.size()));
+    REQUIRE(store.getBytesLength("one") == 3000);
+    REQUIRE_FALSE(store.isKey("two"));
+}
+
+TEST_CASE("KeyValueStore survives a put cut short", "[kvstore]")
+{
+    RamFlash flash(3);
+    {
+        TestStore store(flash);
+        REQUIRE(store.begin());
+        REQUIRE(store.putString("name", "fixed"));
+    }
+    uint32_t committed = 0;
+    for (long budget = 0; budget < 600; budget += 3) {
+        TestStore store(flash);
+        REQUIRE(store.begin());
+        uint32_t value = store.getUInt("value", 0);
+        // one cut short where what was left to write was 0xff is all there
+        if (value == committed + 1) {
+            ++committed;
+        }
+        REQUIRE(value == committed);
+        REQUIRE(store.getString("name") == "fixed");
+
+        flash.writeBudget = budget;
+        store.putString("name", "fixed");
+        if (store.putUInt("value", committed + 1)) {
+            ++committed;
+        }
+        flash.writeBudget = -1;
+    }
+    REQUIRE(committed > 0);
+}
+
+TEST_CASE("KeyValueStore gets with one read", "[kvstore]")
+{
+    RamFlash flash(3);
+    TestStore store(flash);
+    REQUIRE(store.begin());
+    char key[16];
+    for (int i = 0; i < 200; ++i) {
+        snprintf(key, sizeof(key), "k%d", i);
+        REQUIRE(store.putUInt(key, i));
+    }
+    size_t reads = flash.reads;
+    REQUIRE(store.getUInt("k123") == 123);
+    // the key to check it, the header and the value
+    REQUIRE((flash.reads - reads) <= 4);
+}
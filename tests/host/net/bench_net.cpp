@@ -0,0 +1,175 @@
+/*
+ bench_net.cpp - timings and heap use of ClientContext and UdpContext on
+ the host lwIP mock
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include "../common/lwip_mock.h"
+#include "../common/alloc_mock.h"
+#include "include/ClientContext.h"
+#include "include/UdpContext.h"
+
+// The lines of bench_core.cpp, with "bench":"net"; they go to the same
+// CORE_BENCH_OUTPUT file. What the mock costs (receiving, acknowledging) is
+// in the times but small next to per byte work, which is what this is for:
+// the read and write paths under a profiler.
+
+static FILE* s_benchOutput = nullptr;
+
+static const size_t s_sizes[] = { 64, 536, 4096 };
+static const size_t BENCH_BYTES = 256 * 1024;
+
+template<typename TOp>
+static size_t bench(const char* op, size_t size, TOp fn)
+{
+    uint32_t n = BENCH_BYTES / size;
+    size_t result = fn();
+    AllocMock::Counters before = AllocMock::counters();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n; ++i) {
+        result = fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    AllocMock::Counters after = AllocMock::counters();
+
+    unsigned long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / n;
+    fprintf(s_benchOutput ? s_benchOutput : stdout,
+            "{\"bench\":\"net\",\"op\":\"%s\",\"size\":%u,\"n\":%u,\"ns_per_op\":%llu,"
+            "\"allocs_per_op\":%.2f,\"alloc_bytes_per_op\":%.2f}\n",
+            op, (unsigned) size, n, ns,
+            (double) (after.allocs - before.allocs) / n,
+            (double) (after.allocBytes - before.allocBytes) / n);
+    return result;
+}
+
+static void benchTcp(size_t size)
+{
+    std::string data(size, 'a');
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = new ClientContext(pcb, nullptr, nullptr);
+    ctx->ref();
+    char buffer[256];
+
+    // the receive window is smaller than the larger sizes: it opens again
+    // as the data is read
+    REQUIRE(bench("tcp_read_char", size, [&]() {
+        size_t read = 0;
+        while (read < size) {
+            LwipMock::receive(pcb, data.data() + read, size - read);
+            while (ctx->getSize()) {
+                ctx->read();
+                ++read;
+            }
+        }
+        return read;
+    }) == size);
+
+    REQUIRE(bench("tcp_read_buffer", size, [&]() {
+        size_t read = 0;
+        while (read < size) {
+            LwipMock::receive(pcb, data.data() + read, size - read);
+            while (ctx->getSize()) {
+                read += ctx->read(buffer, sizeof(buffer));
+            }
+        }
+        return read;
+    }) == size);
+
+    REQUIRE(bench("tcp_peek_consume", size, [&]() {
+        size_t read = 0;
+        while (read < size) {
+            LwipMock::receive(pcb, data.data() + read, size - read);
+            while (size_t available = ctx->peekAvailable()) {
+                const char* p = ctx->peekBuffer();
+                read += memchr(p, 'b', available) ? 0 : available;
+                ctx->peekConsume(available);
+            }
+        }
+        return read;
+    }) == size);
+
+    REQUIRE(bench("tcp_write", size, [&]() {
+        LwipMock::sent(pcb).clear();
+        return ctx->write((const uint8_t*) data.data(), size);
+    }) == size);
+
+    REQUIRE(bench("tcp_write_P", size, [&]() {
+        LwipMock::sent(pcb).clear();
+        return ctx->write_P(data.data(), size);
+    }) == size);
+
+    ctx->unref();
+}
+
+static void benchUdp(size_t size)
+{
+    std::string data(size, 'u');
+    UdpContext* ctx = new UdpContext;
+    ctx->ref();
+    ip_addr_t any = { IPADDR_ANY };
+    REQUIRE(ctx->listen(any, 5000));
+    udp_pcb* pcb = LwipMock::findUdp(5000);
+    ip_addr_t peer = { 0x0a01a8c0 };
+    char buffer[256];
+
+    REQUIRE(bench("udp_receive_read", size, [&]() {
+        LwipMock::receiveUdp(pcb, data.data(), size, peer.addr, 1234, 0x0101a8c0);
+        size_t read = 0;
+        while (ctx->next()) {
+            while (size_t got = ctx->read(buffer, sizeof(buffer))) {
+                read += got;
+            }
+        }
+        return read;
+    }) == size);
+
+    REQUIRE(bench("udp_append_send", size, [&]() {
+        LwipMock::sentDatagrams().clear();
+        ctx->append(data.data(), size / 2);
+        ctx->append(data.data() + size / 2, size - size / 2);
+        ctx->send(&peer, 4000);
+        return LwipMock::sentDatagrams().back().data.size();
+    }) == size);
+
+    REQUIRE(bench("udp_reserve_send", size, [&]() {
+        LwipMock::sentDatagrams().clear();
+        char* packet = ctx->reserve(size);
+        memcpy(packet, data.data(), size);
+        ctx->send(&peer, 4000);
+        return LwipMock::sentDatagrams().back().data.size();
+    }) == size);
+
+    ctx->unref();
+}
+
+TEST_CASE("Network contexts benchmark", "[net][.benchmark]")
+{
+    const char* path = getenv("CORE_BENCH_OUTPUT");
+    s_benchOutput = path ? fopen(path, "a") : nullptr;
+    LwipMock::clear();
+    for (size_t size : s_sizes) {
+        benchTcp(size);
+        benchUdp(size);
+    }
+    CHECK(LwipMock::pbufsLive() == 0);
+    LwipMock::clear();
+    if (s_benchOutput) {
+        fclose(s_benchOutput);
+        s_benchOutput = nullptr;
+    }
+}
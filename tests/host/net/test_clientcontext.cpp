@@ -0,0 +1,373 @@
+/*
+ test_clientcontext.cpp - ClientContext on the host lwIP mock
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string.h>
+#include <string>
+#include "../common/lwip_mock.h"
+#include <StreamString.h>
+#include "include/ClientContext.h"
+
+static const char s_request[] = "GET /index.html HTTP/1.1\r\nHost: esp8266\r\n\r\n";
+static const size_t s_requestLength = sizeof(s_request) - 1;
+
+static std::string makeData(size_t size)
+{
+    std::string data;
+    for (size_t i = 0; i < size; ++i) {
+        data += (char) ('a' + i % 26);
+    }
+    return data;
+}
+
+// as a WiFiClient holds it
+static ClientContext* newContext(tcp_pcb* pcb)
+{
+    ClientContext* ctx = new ClientContext(pcb, nullptr, nullptr);
+    ctx->ref();
+    return ctx;
+}
+
+TEST_CASE("ClientContext reads across pbufs", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+
+    // in pbufs of 4 bytes
+    REQUIRE(LwipMock::receive(pcb, s_request, s_requestLength, 4) == s_requestLength);
+    CHECK(ctx->getSize() == s_requestLength);
+    CHECK(ctx->peekAvailable() == 4);
+    CHECK(ctx->peek() == 'G');
+    CHECK(ctx->read() == 'G');
+
+    char buffer[64];
+    REQUIRE(ctx->read(buffer, 10) == 10);
+    CHECK(memcmp(buffer, s_request + 1, 10) == 0);
+    // peekBytes() stays in the current pbuf
+    CHECK(ctx->peekBytes(buffer, 10) == 1);
+    CHECK(buffer[0] == s_request[11]);
+    CHECK(std::string(ctx->peekBuffer(), ctx->peekAvailable()) == std::string(s_request + 11, 1));
+    ctx->peekConsume(5);
+    CHECK(ctx->getSize() == s_requestLength - 16);
+
+    REQUIRE(ctx->read(buffer, sizeof(buffer)) == s_requestLength - 16);
+    CHECK(memcmp(buffer, s_request + 16, s_requestLength - 16) == 0);
+    CHECK(ctx->getSize() == 0);
+    CHECK(ctx->read() == 0);
+    // all of it went back to the window, none of the pbufs is left
+    CHECK(LwipMock::counters().tcpRecved == s_requestLength);
+    CHECK(LwipMock::pbufsLive() == 0);
+
+    ctx->unref();
+    CHECK(LwipMock::closed(pcb));
+}
+
+TEST_CASE("ClientContext discards what wasn't read", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+
+    REQUIRE(LwipMock::receive(pcb, s_request, s_requestLength, 10) == s_requestLength);
+    CHECK(LwipMock::pbufsLive() == 5);
+    ctx->discard_received();
+    CHECK(ctx->getSize() == 0);
+    CHECK(LwipMock::pbufsLive() == 0);
+    CHECK(LwipMock::counters().tcpRecved == s_requestLength);
+
+    // and when it goes
+    REQUIRE(LwipMock::receive(pcb, s_request, s_requestLength) == s_requestLength);
+    ctx->unref();
+    CHECK(LwipMock::pbufsLive() == 0);
+}
+
+TEST_CASE("ClientContext writes in chunks that fit", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+    std::string data = makeData(5000);
+
+    // more than the send buffer: it waits for the ACKs, which come on yield
+    REQUIRE(ctx->write((const uint8_t*) data.data(), data.size()) == data.size());
+    CHECK(LwipMock::sent(pcb) == data);
+    CHECK(LwipMock::counters().tcpWrites >= data.size() / TCP_MSS);
+    // the last of it is still waiting for its ACK
+    CHECK(ctx->availableForWrite() < TCP_SND_BUF);
+    LwipMock::ack(pcb);
+    CHECK(ctx->availableForWrite() == TCP_SND_BUF);
+
+    LwipMock::sent(pcb).clear();
+    REQUIRE(ctx->write_P(data.data(), 1000) == 1000);
+    CHECK(LwipMock::sent(pcb) == data.substr(0, 1000));
+
+    LwipMock::sent(pcb).clear();
+    StreamString stream;
+    stream += data.substr(0, 2000).c_str();
+    REQUIRE(ctx->write(stream) == 2000);
+    CHECK(LwipMock::sent(pcb) == data.substr(0, 2000));
+    CHECK(stream.available() == 0);
+
+    uint32_t writes = LwipMock::counters().tcpWrites;
+    ctx->setWriteChunkSize(100);
+    REQUIRE(ctx->write((const uint8_t*) data.data(), 1000) == 1000);
+    CHECK(LwipMock::counters().tcpWrites == writes + 10);
+
+    ctx->unref();
+}
+
+TEST_CASE("ClientContext holds corked writes until flush", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+    ctx->setCork(true);
+
+    uint32_t outputs = LwipMock::counters().tcpOutputs;
+    for (int i = 0; i < 20; ++i) {
+        REQUIRE(ctx->write((const uint8_t*) "header: value\r\n", 15) == 15);
+    }
+    // all queued, none of it sent
+    CHECK(LwipMock::counters().tcpOutputs == outputs);
+    CHECK(LwipMock::ack(pcb) == 0);
+    ctx->flush();
+    CHECK(LwipMock::counters().tcpOutputs == outputs + 1);
+    CHECK(LwipMock::ack(pcb) == 20 * 15);
+    // Nagle is back on
+    CHECK_FALSE(ctx->getNoDelay());
+
+    // more than the send buffer: it goes out as the buffer fills
+    std::string data = makeData(5000);
+    LwipMock::sent(pcb).clear();
+    REQUIRE(ctx->write((const uint8_t*) data.data(), data.size()) == data.size());
+    ctx->flush();
+    LwipMock::ack(pcb);
+    CHECK(LwipMock::sent(pcb) == data);
+    CHECK(ctx->availableForWrite() == TCP_SND_BUF);
+
+    ctx->unref();
+}
+
+TEST_CASE("ClientContext counts what goes in and out", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+
+    REQUIRE(LwipMock::receive(pcb, s_request, s_requestLength, 10) == s_requestLength);
+    TcpStats stats = ctx->getStats();
+    CHECK(stats.bytesIn == s_requestLength);
+    CHECK(stats.pbufsIn == 5);
+    CHECK(stats.rxPbufs == 5);
+    CHECK(stats.rxBuffered == s_requestLength);
+    char buffer[16];
+    ctx->read(buffer, 15);
+    stats = ctx->getStats();
+    CHECK(stats.rxPbufs == 4);
+    CHECK(stats.rxBuffered == s_requestLength - 15);
+
+    std::string data = makeData(1000);
+    REQUIRE(ctx->write((const uint8_t*) data.data(), data.size()) == data.size());
+    stats = ctx->getStats();
+    CHECK(stats.bytesOut == data.size());
+    CHECK(stats.writesOut == LwipMock::counters().tcpWrites);
+    CHECK(stats.mss == TCP_MSS);
+    CHECK(stats.sndWnd == TCP_WND);
+    CHECK(stats.rtoMs == 3000);
+
+    // retransmitted twice, then acknowledged
+    pcb->nrtx = 2;
+    LwipMock::poll(pcb);
+    LwipMock::ack(pcb);
+    pcb->nrtx = 1;
+    CHECK(ctx->getStats().retransmits == 3);
+    CHECK(ctx->getStats().retransmits == 3);
+
+    ctx->unref();
+}
+
+TEST_CASE("ClientContext queues asynchronous writes", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    LwipMock::setAutoAck(false);
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+    std::string data = makeData(5000);
+    size_t acked = 0;
+    ctx->onSent([&](size_t len) { acked += len; });
+    ctx->setAsync(true);
+
+    // what fits, at once
+    REQUIRE(ctx->write((const uint8_t*) data.data(), data.size()) == TCP_SND_BUF);
+    CHECK(ctx->availableForWrite() == 0);
+    CHECK(ctx->write((const uint8_t*) data.data(), data.size()) == 0);
+
+    REQUIRE(LwipMock::ack(pcb, 100) == 100);
+    CHECK(acked == 100);
+    // no runt segment while data is still unacknowledged
+    CHECK(ctx->write((const uint8_t*) data.data() + TCP_SND_BUF, 100) == 100);
+    CHECK(ctx->write((const uint8_t*) data.data() + TCP_SND_BUF + 100, data.size()) == 0);
+    LwipMock::ack(pcb);
+    CHECK(acked == TCP_SND_BUF + 100);
+    CHECK(ctx->availableForWrite() == TCP_SND_BUF);
+    CHECK(LwipMock::sent(pcb) == data.substr(0, TCP_SND_BUF + 100));
+
+    ctx->unref();
+    LwipMock::setAutoAck(true);
+}
+
+TEST_CASE("ClientContext events run from the scheduler", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+    int dataEvents = 0;
+    int disconnectEvents = 0;
+    ctx->onData([&]() { ++dataEvents; });
+    ctx->onDisconnect([&]() { ++disconnectEvents; });
+
+    LwipMock::receive(pcb, "abc", 3);
+    LwipMock::receive(pcb, "def", 3);
+    CHECK(dataEvents == 0);
+    run_scheduled_functions();
+    // once for both
+    CHECK(dataEvents == 1);
+    CHECK(ctx->getSize() == 6);
+
+    LwipMock::receiveClose(pcb);
+    CHECK(ctx->state() == CLOSED);
+    run_scheduled_functions();
+    CHECK(disconnectEvents == 1);
+    // what came before the close can still be read
+    CHECK(ctx->getSize() == 6);
+
+    ctx->unref();
+    CHECK(LwipMock::pbufsLive() == 0);
+}
+
+TEST_CASE("ClientContext loses its connection", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+    int disconnectEvents = 0;
+    ctx->onDisconnect([&]() { ++disconnectEvents; });
+
+    LwipMock::fail(pcb);
+    CHECK(ctx->state() == CLOSED);
+    CHECK(ctx->write((const uint8_t*) "x", 1) == 0);
+    run_scheduled_functions();
+    CHECK(disconnectEvents == 1);
+    ctx->unref();
+}
+
+TEST_CASE("ClientContext refuses pbufs over its limits", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+    std::string data = makeData(2000);
+
+    ctx->setRxBufferLimit(1000);
+    REQUIRE(LwipMock::receive(pcb, data.data(), data.size()) == TCP_MSS);
+    CHECK(ctx->getStats().pbufsRefused == 1);
+    CHECK(ClientContext::rxBufferTotal().buffered == TCP_MSS);
+    char buffer[TCP_MSS];
+    REQUIRE(ctx->read(buffer, sizeof(buffer)) == TCP_MSS);
+    CHECK(ClientContext::rxBufferTotal().buffered == 0);
+    REQUIRE(LwipMock::receive(pcb, data.data() + TCP_MSS, 100) == 100);
+
+    // one that holds nothing takes one whatever the limit
+    ctx->setRxBufferLimit(TCP_MSS);
+    ctx->discard_received();
+    REQUIRE(LwipMock::receive(pcb, data.data(), data.size(), 1000) == 1000);
+    ctx->discard_received();
+
+    // the total, for all connections
+    ctx->setRxBufferLimit(TCP_WND);
+    ClientContext::rxBufferTotal().limit = 600;
+    tcp_pcb* other_pcb = LwipMock::accept();
+    ClientContext* other = newContext(other_pcb);
+    REQUIRE(LwipMock::receive(pcb, data.data(), data.size()) == TCP_MSS);
+    REQUIRE(LwipMock::receive(other_pcb, data.data(), data.size()) == TCP_MSS);
+    CHECK(ClientContext::rxBufferTotal().buffered == 2 * TCP_MSS);
+    other->unref();
+    CHECK(ClientContext::rxBufferTotal().buffered == TCP_MSS);
+    ctx->unref();
+    CHECK(ClientContext::rxBufferTotal().buffered == 0);
+    CHECK(LwipMock::pbufsLive() == 0);
+    ClientContext::rxBufferTotal().limit = TCP_RX_BUFFER_TOTAL_LIMIT;
+}
+
+TEST_CASE("ClientContext keeps to its profile", "[net][clientcontext]")
+{
+    LwipMock::clear();
+    LwipMock::setAutoAck(false);
+    tcp_pcb* pcb = LwipMock::accept();
+    ClientContext* ctx = newContext(pcb);
+    std::string data = makeData(5000);
+    char buffer[TCP_WND];
+
+    // the window closes to rxWindow as the data is read
+    TcpProfile profile = TcpProfile();
+    profile.rxWindow = TCP_MSS;
+    ctx->setProfile(profile);
+    REQUIRE(LwipMock::receive(pcb, data.data(), data.size()) == TCP_WND);
+    REQUIRE(ctx->read(buffer, sizeof(buffer)) == TCP_WND);
+    CHECK(pcb->rcv_wnd == TCP_MSS);
+    CHECK(ctx->getStats().rxWindowHeld == TCP_WND - TCP_MSS);
+    REQUIRE(LwipMock::receive(pcb, data.data(), data.size()) == TCP_MSS);
+    REQUIRE(ctx->read(buffer, sizeof(buffer)) == TCP_MSS);
+    CHECK(pcb->rcv_wnd == TCP_MSS);
+    // and opens at once with a larger one
+    ctx->setProfile(TcpProfile::fast());
+    CHECK(pcb->rcv_wnd == TCP_WND);
+    CHECK(ctx->getStats().rxWindowHeld == 0);
+    CHECK(LwipMock::counters().tcpRecved == TCP_WND + TCP_MSS);
+
+    // less queued than the send buffer would take
+    profile = TcpProfile();
+    profile.sndBuf = TCP_MSS;
+    ctx->setProfile(profile);
+    ctx->setAsync(true);
+    CHECK(ctx->availableForWrite() == TCP_MSS);
+    REQUIRE(ctx->write((const uint8_t*) data.data(), data.size()) == TCP_MSS);
+    CHECK(ctx->availableForWrite() == 0);
+    CHECK(ctx->getStats().writesLimited == 1);
+    LwipMock::ack(pcb);
+    CHECK(ctx->availableForWrite() == TCP_MSS);
+
+    // and fewer pbufs
+    profile = TcpProfile();
+    profile.sndQueueLen = 1;
+    ctx->setProfile(profile);
+    REQUIRE(ctx->write((const uint8_t*) data.data(), data.size()) == TCP_MSS);
+    CHECK(pcb->snd_queuelen == 1);
+    CHECK(ctx->availableForWrite() == 0);
+    LwipMock::ack(pcb);
+
+    // the default goes to the contexts created after it
+    ClientContext::defaultProfile() = TcpProfile::lowMemory(TCP_MSS);
+    tcp_pcb* other_pcb = LwipMock::accept();
+    ClientContext* other = newContext(other_pcb);
+    CHECK(other->getProfile().sndBuf == 2 * TCP_MSS);
+    CHECK(other->getRxBufferLimit() == 2 * TCP_MSS);
+    CHECK(ctx->getProfile().sndQueueLen == 1);
+    ClientContext::defaultProfile() = TcpProfile();
+
+    other->unref();
+    ctx->unref();
+    LwipMock::setAutoAck(true);
+}
@@ -0,0 +1,168 @@
+/*
+ test_udpcontext.cpp - UdpContext on the host lwIP mock
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string.h>
+#include <string>
+#include "../common/lwip_mock.h"
+#include "include/UdpContext.h"
+
+static const uint32_t s_peer  = 0x0a01a8c0; // 192.168.1.10
+static const uint32_t s_local = 0x0101a8c0; // 192.168.1.1
+
+static UdpContext* newListener(uint16_t port)
+{
+    UdpContext* ctx = new UdpContext;
+    ctx->ref();
+    ip_addr_t any = { IPADDR_ANY };
+    REQUIRE(ctx->listen(any, port));
+    return ctx;
+}
+
+TEST_CASE("UdpContext queues datagrams", "[net][udpcontext]")
+{
+    LwipMock::clear();
+    UdpContext* ctx = newListener(5000);
+    udp_pcb* pcb = LwipMock::findUdp(5000);
+    REQUIRE(pcb);
+    int received = 0;
+    ctx->onRx([&]() { ++received; });
+
+    REQUIRE(LwipMock::receiveUdp(pcb, "hello", 5, s_peer, 1234, s_local));
+    REQUIRE(LwipMock::receiveUdp(pcb, "world!", 6, s_peer, 1235, s_local));
+    CHECK(received == 2);
+    CHECK(ctx->getRxQueued() == 2);
+    CHECK(ctx->getSize() == 0);
+
+    char buffer[16];
+    REQUIRE(ctx->next());
+    CHECK(ctx->getSize() == 5);
+    CHECK(ctx->getRemoteAddress() == s_peer);
+    CHECK(ctx->getRemotePort() == 1234);
+    CHECK(ctx->getDestAddress() == s_local);
+    CHECK(ctx->peek() == 'h');
+    REQUIRE(ctx->read(buffer, sizeof(buffer)) == 5);
+    CHECK(memcmp(buffer, "hello", 5) == 0);
+    CHECK(ctx->read() == -1);
+
+    REQUIRE(ctx->next());
+    CHECK(ctx->getRemotePort() == 1235);
+    CHECK(std::string(ctx->peekBuffer(), ctx->getSize()) == "world!");
+    ctx->seek(5);
+    CHECK(ctx->read() == '!');
+    CHECK_FALSE(ctx->next());
+    CHECK(LwipMock::pbufsLive() == 0);
+
+    ctx->unref();
+}
+
+TEST_CASE("UdpContext drops datagrams when its queue is full", "[net][udpcontext]")
+{
+    LwipMock::clear();
+    UdpContext* ctx = newListener(5001);
+    udp_pcb* pcb = LwipMock::findUdp(5001);
+    REQUIRE(ctx->setRxQueueSize(2));
+
+    for (int i = 0; i < 5; ++i) {
+        LwipMock::receiveUdp(pcb, "x", 1, s_peer, 1234, s_local);
+    }
+    CHECK(ctx->getRxQueued() == 2);
+    CHECK(ctx->getRxDropped() == 3);
+    CHECK(LwipMock::pbufsLive() == 2);
+    CHECK_FALSE(ctx->setRxQueueSize(4));
+
+    // the ones still queued go with it
+    ctx->unref();
+    CHECK(LwipMock::pbufsLive() == 0);
+}
+
+TEST_CASE("UdpContext sends what was appended", "[net][udpcontext]")
+{
+    LwipMock::clear();
+    UdpContext* ctx = new UdpContext;
+    ctx->ref();
+    ip_addr_t peer = { s_peer };
+    ctx->connect(peer, 4000);
+
+    // more than the first pbuf holds: sent from a copy
+    std::string data(300, 'u');
+    REQUIRE(ctx->append("abc", 3) == 3);
+    REQUIRE(ctx->append(data.data(), data.size()) == data.size());
+    REQUIRE(ctx->send());
+    REQUIRE(LwipMock::sentDatagrams().size() == 1);
+    CHECK(LwipMock::sentDatagrams()[0].data == "abc" + data);
+    CHECK(LwipMock::sentDatagrams()[0].addr == s_peer);
+    CHECK(LwipMock::sentDatagrams()[0].port == 4000);
+
+    // filled in place
+    char* packet = ctx->reserve(8);
+    REQUIRE(packet);
+    memcpy(packet, "reserved", 8);
+    ip_addr_t other = { s_local };
+    REQUIRE(ctx->send(&other, 4001));
+    REQUIRE(LwipMock::sentDatagrams().size() == 2);
+    CHECK(LwipMock::sentDatagrams()[1].data == "reserved");
+    CHECK(LwipMock::sentDatagrams()[1].port == 4001);
+
+    ctx->unref();
+    CHECK(LwipMock::pbufsLive() == 0);
+}
+
+TEST_CASE("UdpContext sends a batch back to back", "[net][udpcontext]")
+{
+    LwipMock::clear();
+    UdpContext* ctx = new UdpContext;
+    ctx->ref();
+    REQUIRE(ctx->beginBatch(3, 16));
+    CHECK(LwipMock::pbufsLive() == 3);
+
+    ip_addr_t peer = { s_peer };
+    ip_addr_t other = { s_local };
+    REQUIRE(ctx->nextBatchPacket(peer, 5000));
+    CHECK(ctx->append("first", 5) == 5);
+    REQUIRE(ctx->nextBatchPacket(other, 5001));
+    CHECK(ctx->append("second", 6) == 6);
+    // cut off at the size set aside
+    CHECK(ctx->append("0123456789abcdef", 16) == 10);
+    CHECK(ctx->getBatchCount() == 2);
+    CHECK(LwipMock::sentDatagrams().empty());
+
+    // the third pbuf isn't used and goes away with the batch
+    CHECK(ctx->sendBatch() == 2);
+    CHECK(LwipMock::pbufsLive() == 0);
+    REQUIRE(LwipMock::sentDatagrams().size() == 2);
+    CHECK(LwipMock::sentDatagrams()[0].data == "first");
+    CHECK(LwipMock::sentDatagrams()[0].addr == s_peer);
+    CHECK(LwipMock::sentDatagrams()[0].port == 5000);
+    CHECK(LwipMock::sentDatagrams()[1].data == "second0123456789");
+    CHECK(LwipMock::sentDatagrams()[1].addr == s_local);
+    CHECK(LwipMock::sentDatagrams()[1].port == 5001);
+
+    // no more room than asked for
+    REQUIRE(ctx->beginBatch(1, 8));
+    REQUIRE(ctx->nextBatchPacket(peer, 5000));
+    CHECK_FALSE(ctx->nextBatchPacket(peer, 5000));
+    ctx->cancelBatch();
+    CHECK(LwipMock::pbufsLive() == 0);
+    CHECK(ctx->sendBatch() == 0);
+
+    // and the usual path is back
+    ctx->connect(peer, 4000);
+    REQUIRE(ctx->append("single", 6) == 6);
+    REQUIRE(ctx->send());
+    CHECK(LwipMock::sentDatagrams().size() == 3);
+
+    ctx->unref();
+    CHECK(LwipMock::pbufsLive() == 0);
+}
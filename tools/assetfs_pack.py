@@ -0,0 +1,199 @@
+#!/usr/bin/env python
+#
+# assetfs_pack.py - pack a directory into an AssetFS image
+#
+# Makes the read only image cores/esp8266/AssetFS.h mounts: the files under
+# the directory, each one with its path (relative to the directory, starting
+# with '/'), content type, ETag and whether it is gzip compressed. A file
+# foo.ext.gz is stored as foo.ext with the gzip flag, so it is found under
+# the name it is served as; --gzip compresses the text files on the way.
+#
+# The image is uploaded where the SPIFFS image would go, for example with
+# esptool.py write_flash <spiffs start> assets.bin
+#
+# use it like: python assetfs_pack.py data assets.bin
+# or:          python assetfs_pack.py --gzip --size 0x30000 data assets.bin
+
+from __future__ import print_function
+import argparse
+import gzip
+import hashlib
+import io
+import os
+import struct
+import sys
+
+MAGIC = 0x31534641
+VERSION = 1
+FLAG_GZIP = 1
+HEADER_SIZE = 16
+ENTRY_SIZE = 28
+# paths and strings are shorter than this, see AssetFS.cpp
+MAX_STRING = 64
+
+# the same as libraries/ESP8266WebServer/src/detail/mimetable.cpp
+MIME_TYPES = [
+    ('.html', 'text/html'),
+    ('.htm', 'text/html'),
+    ('.css', 'text/css'),
+    ('.txt', 'text/plain'),
+    ('.js', 'application/javascript'),
+    ('.json', 'application/json'),
+    ('.png', 'image/png'),
+    ('.gif', 'image/gif'),
+    ('.jpg', 'image/jpeg'),
+    ('.ico', 'image/x-icon'),
+    ('.svg', 'image/svg+xml'),
+    ('.ttf', 'application/x-font-ttf'),
+    ('.otf', 'application/x-font-opentype'),
+    ('.woff', 'application/font-woff'),
+    ('.woff2', 'application/font-woff2'),
+    ('.eot', 'application/vnd.ms-fontobject'),
+    ('.sfnt', 'application/font-sfnt'),
+    ('.xml', 'text/xml'),
+    ('.pdf', 'application/pdf'),
+    ('.zip', 'application/zip'),
+    ('.gz', 'application/x-gzip'),
+    ('.appcache', 'text/cache-manifest'),
+]
+DEFAULT_MIME = 'application/octet-stream'
+
+COMPRESSIBLE = ('text/', 'application/javascript', 'application/json',
+                'image/svg+xml', 'text/xml')
+
+
+def fnv1a(data):
+    '''The hash AssetFS.cpp looks paths up with'''
+    h = 2166136261
+    for b in bytearray(data):
+        h ^= b
+        h = (h * 16777619) & 0xffffffff
+    return h
+
+
+def mime_type(path):
+    for ext, mime in MIME_TYPES:
+        if path.endswith(ext):
+            return mime
+    return DEFAULT_MIME
+
+
+def compress(data):
+    out = io.BytesIO()
+    # mtime 0 keeps the image the same for the same files
+    with gzip.GzipFile(fileobj=out, mode='wb', compresslevel=9, mtime=0) as f:
+        f.write(data)
+    return out.getvalue()
+
+
+def collect(root, use_gzip):
+    '''Return a list of (path, mime, etag, flags, data), sorted by path'''
+    files = {}
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for name in sorted(filenames):
+            full = os.path.join(dirpath, name)
+            path = '/' + os.path.relpath(full, root).replace(os.sep, '/')
+            with open(full, 'rb') as f:
+                data = f.read()
+            flags = 0
+            if path.endswith('.gz'):
+                path = path[:-3]
+                flags = FLAG_GZIP
+            mime = mime_type(path)
+            if not flags and use_gzip and mime.startswith(COMPRESSIBLE):
+                packed = compress(data)
+                if len(packed) < len(data):
+                    data = packed
+                    flags = FLAG_GZIP
+            if path in files:
+                sys.exit('%s is there twice, once compressed' % path)
+            etag = '"%s"' % hashlib.md5(data).hexdigest()
+            files[path] = (path, mime, etag, flags, data)
+    entries = [files[p] for p in sorted(files)]
+    for path, mime, etag, flags, data in entries:
+        if len(path.encode('utf-8')) >= MAX_STRING:
+            sys.exit('%s: path longer than %d bytes' % (path, MAX_STRING - 1))
+    if len(entries) > 0x8000:
+        sys.exit('too many files')
+    return entries
+
+
+def pack(entries):
+    count = len(entries)
+    # at most half full, so a lookup rarely needs a second probe
+    slots = 1
+    while slots < 2 * count:
+        slots *= 2
+    slots_size = (slots * 2 + 3) & ~3
+    strings_at = HEADER_SIZE + slots_size + count * ENTRY_SIZE
+
+    strings = bytearray()
+    string_offsets = {}
+
+    def add_string(s):
+        if s not in string_offsets:
+            string_offsets[s] = strings_at + len(strings)
+            strings.extend(s.encode('utf-8') + b'\0')
+        return string_offsets[s]
+
+    table = []
+    for path, mime, etag, flags, data in entries:
+        table.append([fnv1a(path.encode('utf-8')), add_string(path),
+                      add_string(mime), add_string(etag), 0, len(data), flags])
+
+    image = bytearray()
+    data_at = strings_at + len(strings)
+    blobs = bytearray()
+    for entry, (path, mime, etag, flags, data) in zip(table, entries):
+        pad = (-(data_at + len(blobs))) % 4
+        blobs.extend(b'\xff' * pad)
+        entry[4] = data_at + len(blobs)
+        blobs.extend(data)
+
+    slot_table = [0] * slots
+    for index, entry in enumerate(table):
+        slot = entry[0] & (slots - 1)
+        while slot_table[slot]:
+            slot = (slot + 1) & (slots - 1)
+        slot_table[slot] = index + 1
+
+    size = data_at + len(blobs)
+    image.extend(struct.pack('<IHHHHI', MAGIC, VERSION, count, slots, 0, size))
+    image.extend(struct.pack('<%dH' % slots, *slot_table))
+    image.extend(b'\0' * (slots_size - slots * 2))
+    for entry in table:
+        image.extend(struct.pack('<7I', *entry))
+    image.extend(strings)
+    image.extend(blobs)
+    return image
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack a directory into an AssetFS image')
+    parser.add_argument('-z', '--gzip', action='store_true',
+                        help='compress text files with gzip where that makes them smaller')
+    parser.add_argument('-s', '--size', type=lambda v: int(v, 0),
+                        help='size of the flash area, the image is padded to it')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='list the files packed')
+    parser.add_argument('directory', help='directory to pack')
+    parser.add_argument('image', help='image file to write')
+    args = parser.parse_args()
+
+    entries = collect(args.directory, args.gzip)
+    image = pack(entries)
+    if args.size is not None:
+        if len(image) > args.size:
+            sys.exit('image is %d bytes, more than the %d there are' % (len(image), args.size))
+        image.extend(b'\xff' * (args.size - len(image)))
+    with open(args.image, 'wb') as f:
+        f.write(image)
+    if args.verbose:
+        for path, mime, etag, flags, data in entries:
+            print('%-40s %7d %s%s' % (path, len(data), mime, ' gzip' if flags else ''))
+    print('%d files, %d bytes' % (len(entries), len(image)))
+
+
+if __name__ == '__main__':
+    main()
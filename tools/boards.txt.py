@@ -980,7 +980,7 @@ def all_debug ():
 ################################################################
 # flash size
 
-def flash_size (size_bytes, display, optname, ld, desc, max_upload_size, spiffs_start = 0, spiffs_size = 0, spiffs_blocksize = 0):
+def flash_size (size_bytes, display, optname, ld, desc, max_upload_size, spiffs_start = 0, spiffs_size = 0, spiffs_blocksize = 0, ab = False):
     menu = '.menu.FlashSize.' + optname
     menub = menu + '.build.'
     d = collections.OrderedDict([
@@ -1027,9 +1027,13 @@ def flash_size (size_bytes, display, optname, ld, desc, max_upload_size, spiffs_
         print "/* sketch %dKB */" % (max_upload_size / 1024)
         if spiffs_size > 0:
             empty_size = spiffs_start - max_upload_size - 4096
-            if empty_size > 1024:
+            if ab:
+                print "/* slot B %dKB */" % (empty_size / 1024)
+            elif empty_size > 1024:
                 print "/* empty  %dKB */" % (empty_size / 1024)
             print "/* spiffs %dKB */" % (spiffs_size / 1024)
+        if ab:
+            print "/* slot log 4KB */"
         print "/* eeprom 20KB */"
         print ""
         print "MEMORY"
@@ -1045,6 +1049,10 @@ def flash_size (size_bytes, display, optname, ld, desc, max_upload_size, spiffs_
         print "PROVIDE ( _SPIFFS_page = 0x%X );" % page
         print "PROVIDE ( _SPIFFS_block = 0x%X );" % block
         print ""
+        if ab:
+            print "/* maps the slot eboot started, see eboot_command.h */"
+            print "EXTERN ( app_slot_booted )"
+            print ""
         print 'INCLUDE "../ld/eagle.app.v6.common.ld"'
 
         if ldgen:
@@ -1068,6 +1076,8 @@ def all_flash_size ():
     f2m =       flash_size(0x200000,   '2M', '2M',      'eagle.flash.2m.ld',        '1M SPIFFS', 1044464, 0x100000,   0xFB000, 8192)
     f4m =       flash_size(0x400000,   '4M', '4M1M',    'eagle.flash.4m1m.ld',      '1M SPIFFS', 1044464, 0x300000,   0xFB000, 8192)
     f4m.update( flash_size(0x400000,   '4M', '4M2M',    'eagle.flash.4m2m.ld',      '2M SPIFFS', 1044464, 0x200000,  0x1FB000, 8192))
+    # only the ld script: not in the menu until bootloaders/eboot/eboot.elf is rebuilt with the slot log
+    flash_size(0x400000,               '4M', '4M2M_AB', 'eagle.flash.4m2m.ab.ld', '2M SPIFFS, A/B OTA', 1044464, 0x200000, 0x1FA000, 8192, ab = True)
     f4m.update( flash_size(0x400000,   '4M', '4M3M',    'eagle.flash.4m.ld',        '3M SPIFFS', 1044464, 0x100000,  0x2FB000, 8192))
     f8m =       flash_size(0x800000,   '8M', '8M7M',    'eagle.flash.8m.ld',        '7M SPIFFS', 1044464, 0x100000,  0x6FB000, 8192)
     f16m =      flash_size(0x1000000, '16M', '16M15M',  'eagle.flash.16m.ld',      '15M SPIFFS', 1044464, 0x100000,  0xEFB000, 8192)
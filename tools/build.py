@@ -95,6 +95,8 @@ def parse_args():
     parser.add_argument('--debug_port', help='Debug port',
                         choices=['Serial', 'Serial1'])
     parser.add_argument('--debug_level', help='Debug level')
+    parser.add_argument('--size_report', action='store_true',
+                        help='Print the IRAM, DRAM and flash every object uses')
     parser.add_argument('sketch_path', help='Sketch file path')
     return parser.parse_args()
 
@@ -138,6 +140,10 @@ def main():
     if args.output_binary is not None:
         shutil.copy(output_name, args.output_binary)
 
+    if args.size_report:
+        map_name = tmp_dir + '/' + os.path.basename(sketch_path) + '.map'
+        subprocess.call([sys.executable, os.path.dirname(os.path.realpath(__file__)) + '/size_report.py', map_name])
+
     if created_tmp_dir and not args.keep:
         shutil.rmtree(tmp_dir, ignore_errors=True)
 
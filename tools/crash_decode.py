@@ -0,0 +1,205 @@
+#!/usr/bin/env python
+#
+# crash_decode.py - turn a crash record saved by CrashDump.h into a report
+#
+# Reads the record crash_dump_read() returned, as the raw bytes or as hex
+# text (the way a sketch might print or upload it), checks its CRC and
+# prints what the postmortem handler would have printed over the UART,
+# then the code addresses found in the registers and on the stack, looked
+# up in the ELF of the sketch with addr2line. Panic and assert messages
+# are read from the ELF too, the record only has their addresses.
+#
+# use it like: python crash_decode.py -e sketch.ino.elf crash.bin
+# or:          python crash_decode.py -e sketch.ino.elf --raw crash.hex
+#
+# With --raw only the serial style dump is printed, for tools that decode
+# those, e.g. the exception decoder of the IDE.
+
+from __future__ import print_function
+import argparse
+import binascii
+import re
+import struct
+import subprocess
+import sys
+import zlib
+
+MAGIC = 0x48535243
+VERSION = 1
+HEADER = struct.Struct('<IHHI21I')
+FIELDS = ('reason', 'exccause', 'epc1', 'epc2', 'epc3', 'excvaddr', 'depc',
+          'panic_file', 'panic_func', 'panic_what', 'panic_line', 'flags',
+          'sp', 'stack_start', 'stack_end', 'stack_size', 'cont_stack_free',
+          'heap_free', 'last_fail_alloc_addr', 'last_fail_alloc_size', 'time_us')
+
+FLAG_CONT = 0x01
+FLAG_ABORT = 0x02
+
+REASON_WDT_RST = 1
+REASON_EXCEPTION_RST = 2
+REASON_SOFT_WDT_RST = 3
+
+EXCEPTIONS = {
+    0: 'IllegalInstruction', 1: 'SyscallCause', 2: 'InstructionFetchError',
+    3: 'LoadStoreError', 4: 'Level1Interrupt', 5: 'Alloca',
+    6: 'IntegerDivideByZero', 8: 'Privileged', 9: 'LoadStoreAlignment',
+    12: 'InstrPIFDataError', 13: 'LoadStorePIFDataError',
+    14: 'InstrPIFAddrError', 15: 'LoadStorePIFAddrError', 16: 'InstTLBMiss',
+    17: 'InstTLBMultiHit', 18: 'InstFetchPrivilege', 20: 'InstFetchProhibited',
+    24: 'LoadStoreTLBMiss', 25: 'LoadStoreTLBMultihit',
+    26: 'LoadStorePrivilege', 28: 'LoadProhibited', 29: 'StoreProhibited',
+}
+
+# where code runs from: IRAM, and the flash through the cache
+CODE_RANGES = ((0x40100000, 0x40110000), (0x40200000, 0x40300000))
+
+
+def is_code(addr):
+    return any(start <= addr < end for start, end in CODE_RANGES)
+
+
+def read_record(path):
+    '''Return the bytes of the record in path, raw or written as hex'''
+    with open(path, 'rb') as f:
+        data = f.read()
+    text = re.sub(br'\s+', b'', data)
+    if text and re.match(br'^[0-9a-fA-F]+$', text) and len(text) % 2 == 0:
+        return binascii.unhexlify(text)
+    return data
+
+
+def parse_record(data):
+    '''Return (fields, stack words) of the record, raise ValueError if not one'''
+    if len(data) < HEADER.size:
+        raise ValueError('too short for a crash record')
+    values = HEADER.unpack_from(data)
+    magic, version, header_size, crc = values[:4]
+    if magic != MAGIC:
+        raise ValueError('not a crash record')
+    if version != VERSION or header_size != HEADER.size:
+        raise ValueError('crash record version %d, this reads version %d' % (version, VERSION))
+    dump = dict(zip(FIELDS, values[4:]))
+    size = header_size + dump['stack_size']
+    if len(data) < size:
+        raise ValueError('crash record cut short, %d of %d bytes' % (len(data), size))
+    check = data[:8] + b'\0\0\0\0' + data[12:size]
+    if zlib.crc32(check) & 0xffffffff != crc:
+        raise ValueError('crash record CRC mismatch')
+    words = struct.unpack_from('<%dI' % (dump['stack_size'] // 4), data, header_size)
+    return dump, words
+
+
+class Elf(object):
+    '''Just enough of an ELF32 reader to find strings by address'''
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF':
+            raise ValueError('%s is not an ELF file' % path)
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2e)
+        self.sections = []
+        for i in range(shnum):
+            sh = struct.unpack_from('<10I', self.data, shoff + i * shentsize)
+            sh_type, sh_addr, sh_offset, sh_size = sh[1], sh[3], sh[4], sh[5]
+            # SHT_NOBITS (.bss) has no contents in the file
+            if sh_addr and sh_type != 8:
+                self.sections.append((sh_addr, sh_size, sh_offset))
+
+    def string(self, addr):
+        for start, size, offset in self.sections:
+            if start <= addr < start + size:
+                pos = offset + addr - start
+                end = self.data.find(b'\0', pos, offset + size)
+                if end < 0:
+                    end = offset + size
+                return self.data[pos:end].decode('utf-8', 'replace')
+        return '0x%08x' % addr
+
+
+def symbolize(addr2line, elf, addrs):
+    '''Return {addr: (function, location)} for addrs'''
+    if not addrs:
+        return {}
+    cmd = [addr2line, '-C', '-f', '-e', elf] + ['0x%08x' % a for a in addrs]
+    out = subprocess.check_output(cmd).decode('utf-8', 'replace').splitlines()
+    return dict((a, (out[2 * i], out[2 * i + 1])) for i, a in enumerate(addrs))
+
+
+def print_dump(dump, words, strings):
+    '''What core_esp8266_postmortem.c prints for the crash'''
+    if dump['panic_line']:
+        line = '\nPanic %s:%d %s' % (strings(dump['panic_file']), dump['panic_line'],
+                                     strings(dump['panic_func']))
+        if dump['panic_what']:
+            line += ": Assertion '%s' failed." % strings(dump['panic_what'])
+        print(line)
+    elif dump['flags'] & FLAG_ABORT:
+        print('\nAbort called')
+    elif dump['reason'] == REASON_EXCEPTION_RST:
+        print('\nException (%d):\nepc1=0x%08x epc2=0x%08x epc3=0x%08x excvaddr=0x%08x depc=0x%08x' %
+              (dump['exccause'], dump['epc1'], dump['epc2'], dump['epc3'], dump['excvaddr'], dump['depc']))
+    elif dump['reason'] == REASON_SOFT_WDT_RST:
+        print('\nSoft WDT reset')
+    elif dump['reason'] == REASON_WDT_RST:
+        print('\nWDT reset')
+
+    print('\nctx: %s ' % ('cont' if dump['flags'] & FLAG_CONT else 'sys'))
+    print('sp: %08x end: %08x offset: %04x' %
+          (dump['sp'], dump['stack_end'], dump['stack_start'] - dump['sp']))
+    print('\n>>>stack>>>')
+    for i in range(0, len(words) - 3, 4):
+        pos = dump['stack_start'] + 4 * i
+        frame = '<' if words[i + 2] == pos + 0x10 else ' '
+        print('%08x:  %08x %08x %08x %08x %s' % ((pos,) + tuple(words[i:i + 4]) + (frame,)))
+    print('<<<stack<<<')
+    if dump['last_fail_alloc_addr']:
+        print('\nlast failed alloc call: %08X(%d)' %
+              (dump['last_fail_alloc_addr'], dump['last_fail_alloc_size']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode a crash record saved by CrashDump.h')
+    parser.add_argument('-e', '--elf', help='ELF file of the sketch')
+    parser.add_argument('-t', '--addr2line', default='xtensa-lx106-elf-addr2line', help='addr2line to use')
+    parser.add_argument('--raw', action='store_true', help='only print the dump as the serial port would show it')
+    parser.add_argument('record', help='file with the record, binary or hex')
+    args = parser.parse_args()
+
+    try:
+        dump, words = parse_record(read_record(args.record))
+        elf = Elf(args.elf) if args.elf else None
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        return 1
+    strings = elf.string if elf else (lambda addr: '0x%08x' % addr)
+
+    print_dump(dump, words, strings)
+    if args.raw:
+        return 0
+
+    print('\nuptime %.3f s, heap free %d, loop stack never used %d bytes' %
+          (dump['time_us'] / 1e6, dump['heap_free'], dump['cont_stack_free']))
+    if dump['reason'] == REASON_EXCEPTION_RST and not dump['panic_line']:
+        print('exception %d: %s' % (dump['exccause'], EXCEPTIONS.get(dump['exccause'], 'reserved')))
+    if not elf:
+        return 0
+
+    registers = [(name, dump[name]) for name in ('epc1', 'epc2', 'epc3', 'excvaddr', 'depc',
+                                                 'last_fail_alloc_addr') if is_code(dump[name])]
+    stack = [w for w in words if is_code(w)]
+    names = symbolize(args.addr2line, args.elf, sorted(set([v for _, v in registers] + stack)))
+    for name, value in registers:
+        function, location = names[value]
+        print('%-20s 0x%08x: %s at %s' % (name, value, function, location))
+    print('\nDecoding stack results')
+    for addr in stack:
+        function, location = names[addr]
+        if function != '??':
+            print('0x%08x: %s at %s' % (addr, function, location))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
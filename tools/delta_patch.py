@@ -0,0 +1,155 @@
+#!/usr/bin/env python
+#
+# delta_patch.py - make a patch from one sketch binary to the next
+#
+# The Updater applies the patch to the sketch that is running, so only the
+# difference has to be sent; see cores/esp8266/DeltaPatcher.h for the format
+# and doc/ota_updates/readme.rst for how it is used. The patch names the old
+# image by its size and MD5, the one ESP.getSketchMD5() gives, and a device
+# running anything else refuses it.
+#
+# use it like: python delta_patch.py old.bin new.bin patch.bin
+# or:          python delta_patch.py --gzip old.bin new.bin patch.bin.gz
+
+from __future__ import print_function
+import argparse
+import gzip
+import hashlib
+import io
+import struct
+import sys
+
+MAGIC = 0x44505345
+# pieces of the new image are looked up in the old one by their first K bytes
+K = 8
+# positions kept for each K bytes, more finds more but takes longer
+POSITIONS = 8
+# a match shorter than this costs more in its record than it saves
+MIN_MATCH = 32
+# a match is extended until this many bytes in a row made it no better
+GIVE_UP = 64
+
+
+def index(old):
+    positions = {}
+    for i in range(len(old) - K + 1):
+        key = bytes(old[i:i + K])
+        found = positions.get(key)
+        if found is None:
+            positions[key] = [i]
+        elif len(found) < POSITIONS:
+            found.append(i)
+    return positions
+
+
+def extend(old, new, o, n):
+    # how far the new image from n follows the old one from o, allowing
+    # for a few changed bytes: returns (length, matches - mismatches)
+    score = best_score = best_len = 0
+    i = misses = 0
+    end = min(len(old) - o, len(new) - n)
+    while i < end:
+        if old[o + i:o + i + 32] == new[n + i:n + i + 32] and i + 32 <= end:
+            i += 32
+            score += 32
+        else:
+            score += 1 if old[o + i] == new[n + i] else -1
+            i += 1
+        if score > best_score:
+            best_score = score
+            best_len = i
+            misses = 0
+        else:
+            misses += 1
+            if misses > GIVE_UP:
+                break
+    return best_len, best_score
+
+
+def diff(old, new):
+    positions = index(old)
+    records = []
+    add_old = add_new = add_len = 0
+    literal = 0
+    n = 0
+    while n < len(new):
+        candidates = positions.get(bytes(new[n:n + K]), [])
+        if add_len:
+            # carrying on where the last match left off, past changed bytes
+            candidates = [add_old + n - add_new] + candidates
+        best = None
+        for o in candidates:
+            if o < 0 or o + K > len(old) or old[o:o + K] != new[n:n + K]:
+                continue
+            length, score = extend(old, new, o, n)
+            if score >= MIN_MATCH and (best is None or score > best[2]):
+                best = (o, length, score)
+        if best is None:
+            n += 1
+            continue
+        o, length, score = best
+        records.append((add_old, add_new, add_len, literal, n, o - (add_old + add_len)))
+        add_old, add_new, add_len = o, n, length
+        n += length
+        literal = n
+    records.append((add_old, add_new, add_len, literal, len(new), 0))
+
+    patch = bytearray()
+    for add_old, add_new, add_len, literal, literal_end, seek in records:
+        patch.extend(struct.pack('<IIi', add_len, literal_end - literal, seek))
+        patch.extend((new[add_new + i] - old[add_old + i]) & 0xff for i in range(add_len))
+        patch.extend(new[literal:literal_end])
+    return patch
+
+
+def apply(old, patch):
+    # what DeltaPatcher.cpp does, to check the patch before it is used
+    magic, old_size, new_size = struct.unpack_from('<III', patch, 0)
+    pos = 28
+    old_pos = 0
+    new = bytearray()
+    while len(new) < new_size:
+        add_len, extra, seek = struct.unpack_from('<IIi', patch, pos)
+        pos += 12
+        new.extend((old[old_pos + i] + patch[pos + i]) & 0xff for i in range(add_len))
+        pos += add_len
+        old_pos += add_len
+        new.extend(patch[pos:pos + extra])
+        pos += extra
+        old_pos += seek
+    return new
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Make a patch from one sketch binary to the next')
+    parser.add_argument('-z', '--gzip', action='store_true',
+                        help='compress the patch, the Updater takes it like that too')
+    parser.add_argument('old', help='binary of the sketch the device runs')
+    parser.add_argument('new', help='binary of the sketch to update to')
+    parser.add_argument('patch', help='patch file to write')
+    args = parser.parse_args()
+
+    with open(args.old, 'rb') as f:
+        old = bytearray(f.read())
+    with open(args.new, 'rb') as f:
+        new = bytearray(f.read())
+
+    patch = bytearray(struct.pack('<III', MAGIC, len(old), len(new)))
+    patch.extend(hashlib.md5(old).digest())
+    patch.extend(diff(old, new))
+    if apply(old, patch) != new:
+        sys.exit('the patch does not make the new image, this is a bug')
+    size = len(patch)
+    if args.gzip:
+        out = io.BytesIO()
+        with gzip.GzipFile(fileobj=out, mode='wb', mtime=0) as f:
+            f.write(bytes(patch))
+        patch = out.getvalue()
+    with open(args.patch, 'wb') as f:
+        f.write(patch)
+    print('%d bytes to %d bytes: patch of %d bytes%s' %
+          (len(old), len(new), size, ', %d compressed' % len(patch) if args.gzip else ''))
+
+
+if __name__ == '__main__':
+    main()
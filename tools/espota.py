@@ -42,6 +42,21 @@ FLASH = 0
 SPIFFS = 100
 AUTH = 200
 PROGRESS = False
+# most sent ahead of the device's acknowledgements, it answers with what it
+# takes, see libraries/ArduinoOTA/ArduinoOTA.cpp
+WINDOW = 65536
+# a block at a time when the device acknowledges every block
+BLOCK = 1460
+
+def parse_ok(data):
+  # "OK", or "OK W<window>" from a device that streams; None if not OK
+  words = data.split()
+  if not words or words[0] != 'OK':
+    return None
+  if len(words) > 1 and words[1].startswith('W') and words[1][1:].isdigit():
+    return int(words[1][1:])
+  return 0
+
 # update_progress() : Displays or updates a console progress bar
 ## Accepts a float between 0 and 1. Any int will be converted to a float.
 ## A value under 0 represents a 'halt'.
@@ -86,7 +101,8 @@ def serve(remoteAddr, localAddr, remotePort, localPort, password, filename, comm
   file_md5 = hashlib.md5(f.read()).hexdigest()
   f.close()
   logging.info('Upload size: %d', content_size)
-  message = '%d %d %d %s\n' % (command, localPort, content_size, file_md5)
+  # the window goes on its own line, which devices that don't stream skip
+  message = '%d %d %d %s\nW%d\n' % (command, localPort, content_size, file_md5, WINDOW)
 
   # Wait for a connection
   logging.info('Sending invitation to: %s', remoteAddr)
@@ -100,7 +116,8 @@ def serve(remoteAddr, localAddr, remotePort, localPort, password, filename, comm
     logging.error('No Answer')
     sock2.close()
     return 1
-  if (data != "OK"):
+  window = parse_ok(data)
+  if (window is None):
     if(data.startswith('AUTH')):
       nonce = data.split()[1]
       cnonce_text = '%s%u%s%s' % (filename, content_size, file_md5, remoteAddr)
@@ -120,7 +137,8 @@ def serve(remoteAddr, localAddr, remotePort, localPort, password, filename, comm
         logging.error('No Answer to our Authentication')
         sock2.close()
         return 1
-      if (data != "OK"):
+      window = parse_ok(data)
+      if (window is None):
         sys.stderr.write('FAIL\n')
         logging.error('%s', data)
         sock2.close()
@@ -152,18 +170,38 @@ def serve(remoteAddr, localAddr, remotePort, localPort, password, filename, comm
       sys.stderr.write('Uploading')
       sys.stderr.flush()
     offset = 0
+    # streaming, the device acknowledges the total it got, a line at a time
+    acked = 0
+    received = ''
     while True:
-      chunk = f.read(1460)
-      if not chunk: break
-      offset += len(chunk)
-      update_progress(offset/float(content_size))
       connection.settimeout(10)
       try:
+        if window:
+          while offset - acked >= window:
+            res = connection.recv(64).decode()
+            if not res:
+              raise IOError('connection closed')
+            received += res
+            lines = received.split('\n')
+            received = lines.pop()
+            for line in lines:
+              if not line.strip().isdigit():
+                raise IOError(line)
+              acked = int(line)
+            update_progress(acked/float(content_size))
+          chunk = f.read(window - (offset - acked))
+        else:
+          chunk = f.read(BLOCK)
+        if not chunk: break
+        offset += len(chunk)
         connection.sendall(chunk)
-        res = connection.recv(4)
-      except:
+        if not window:
+          update_progress(offset/float(content_size))
+          # the digits of what the device wrote, maybe the OK at the end
+          received = (received + connection.recv(4).decode())[-4:]
+      except Exception as e:
         sys.stderr.write('\n')
-        logging.error('Error Uploading')
+        logging.error('Error Uploading: %s', e)
         connection.close()
         f.close()
         sock.close()
@@ -176,13 +214,18 @@ def serve(remoteAddr, localAddr, remotePort, localPort, password, filename, comm
     # the connection before receiving the 'O' of 'OK'
     try:
       connection.settimeout(60)
-      while True:
-        if connection.recv(32).decode().find('O') >= 0: break
+      while received.find('O') < 0:
+        res = connection.recv(32).decode()
+        if not res:
+          raise IOError('connection closed')
+        received += res
+      if window:
+        update_progress(1)
       logging.info('Result: OK')
       connection.close()
       f.close()
       sock.close()
-      if (data != "OK"):
+      if (parse_ok(data) is None):
         sys.stderr.write('\n')
         logging.error('%s', data)
         return 1;
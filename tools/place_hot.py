@@ -0,0 +1,122 @@
+#!/usr/bin/env python
+#
+# place_hot.py - move the functions a sketch lists to IRAM, or together in flash
+#
+# Runs before linking when the sketch folder has a hot_functions.txt (see
+# the prelink hook in platform.txt). With -ffunction-sections every
+# function is in a section of its own, .text.<name>, holding its literals
+# too (-mtext-section-literals). This renames the sections of the listed
+# functions in the objects of the build directory, so that the linker
+# script places them:
+#
+#   iram   .text.<name> becomes .iram.text.<name>, which goes to IRAM like
+#          ICACHE_RAM_ATTR functions do
+#   flash  .text.<name> becomes .text.hot.<name>, which goes to the start
+#          of the flash code along with the functions GCC was told are
+#          hot, so that they share few cache lines with the rest
+#
+# hot_functions.txt has one function a line, its place and its mangled
+# name, which profiler_report.py -H writes; # starts a comment:
+#
+#   iram  _ZN14HardwareSerial5writeEh
+#   flash _Z4loopv
+#
+# Objects are changed in place: after taking a function off the list,
+# rebuild everything.
+#
+# use it like: python place_hot.py hot_functions.txt build_directory
+
+from __future__ import print_function
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+PREFIX = {
+    'iram': '.iram.text.',
+    'flash': '.text.hot.',
+}
+
+
+def read_list(path):
+    '''Return {section now: section wanted} for the functions listed'''
+    renames = {}
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.split('#', 1)[0].split()
+            if not line:
+                continue
+            if len(line) != 2 or line[0] not in PREFIX:
+                raise ValueError('%s:%d: expected "iram <name>" or "flash <name>"' % (path, number))
+            renames['.text.' + line[1]] = PREFIX[line[0]] + line[1]
+    return renames
+
+
+def objects(build):
+    for root, dirs, files in os.walk(build):
+        for name in files:
+            if name.endswith('.o') or name.endswith('.ar') or name.endswith('.a'):
+                yield os.path.join(root, name)
+
+
+def sections(objdump, paths):
+    '''Return {path: set of section names} of the objects, archives merged'''
+    found = dict((path, set()) for path in paths)
+    out = subprocess.check_output([objdump, '-h'] + paths)
+    path = None
+    for line in out.decode('utf-8', 'replace').splitlines():
+        if line.startswith('In archive '):
+            path = line[len('In archive '):].rstrip(':')
+            continue
+        m = re.match(r'^(.+):\s+file format', line)
+        if m:
+            # a member of the archive above, or an object of its own
+            if m.group(1) in found:
+                path = m.group(1)
+            continue
+        m = re.match(r'^\s*\d+\s+(\S+)\s', line)
+        if m and path in found:
+            found[path].add(m.group(1))
+    return found
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Place listed functions in IRAM or together in flash')
+    parser.add_argument('--objcopy', default='xtensa-lx106-elf-objcopy', help='objcopy to use')
+    parser.add_argument('--objdump', default='xtensa-lx106-elf-objdump', help='objdump to use')
+    parser.add_argument('list', help='hot_functions.txt')
+    parser.add_argument('build', help='build directory')
+    args = parser.parse_args()
+
+    try:
+        renames = read_list(args.list)
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        return 1
+    if not renames:
+        return 0
+
+    paths = list(objects(args.build))
+    if not paths:
+        return 0
+    placed = set()
+    for path, names in sorted(sections(args.objdump, paths).items()):
+        # in this object: the ones still to rename, and the ones done before
+        todo = [name for name in names if name in renames]
+        placed.update(todo)
+        placed.update(old for old, new in renames.items() if new in names)
+        if not todo:
+            continue
+        cmd = [args.objcopy]
+        for name in todo:
+            cmd += ['--rename-section', '%s=%s' % (name, renames[name])]
+        subprocess.check_call(cmd + [path])
+
+    for name in sorted(set(renames) - placed):
+        print('place_hot.py: %s not found, is the name mangled?' % name[len('.text.'):], file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+#
+# profiler_report.py - turn a profiler_print() dump into a per function profile
+#
+# Reads the lines profiler_print() (cores/esp8266/Profiler.h) wrote, from a
+# file or a serial log saved with them, looks the addresses up in the ELF of
+# the sketch with addr2line and prints the functions the samples fell in,
+# busiest first.
+#
+# use it like: python profiler_report.py -e sketch.ino.elf serial.log
+# or:          python profiler_report.py -e sketch.ino.elf -l serial.log
+#
+# With -H hot_functions.txt it also writes the busiest functions that run
+# from flash in the form tools/place_hot.py reads, all as "flash" to be
+# grouped at the start of the flash code; change the ones that must not
+# wait for the cache to "iram".
+
+from __future__ import print_function
+import argparse
+import re
+import subprocess
+import sys
+
+HEADER = re.compile(r'profile: (\d+) samples (\d+) dropped (\d+) Hz')
+SAMPLE = re.compile(r'^([0-9a-fA-F]{8}) (\d+)$')
+
+# code read through the flash cache is mapped from here
+FLASH_START = 0x40200000
+
+
+def read_dump(f):
+    '''Return (samples, dropped, rate, {pc: count}) of the last dump in f'''
+    header = None
+    counts = {}
+    inside = False
+    for line in f:
+        line = line.strip()
+        m = HEADER.search(line)
+        if m:
+            header = tuple(int(v) for v in m.groups())
+            counts = {}
+            inside = True
+            continue
+        if not inside:
+            continue
+        if line == 'end':
+            inside = False
+            continue
+        m = SAMPLE.match(line)
+        if m:
+            pc = int(m.group(1), 16)
+            counts[pc] = counts.get(pc, 0) + int(m.group(2))
+    if header is None:
+        return None
+    return header + (counts,)
+
+
+def symbolize(addr2line, elf, pcs, lines, demangle=True):
+    '''Return {pc: (function, location)} for pcs'''
+    cmd = [addr2line, '-f', '-e', elf]
+    if demangle:
+        cmd.insert(1, '-C')
+    out = subprocess.check_output(cmd + ['0x%08x' % pc for pc in pcs])
+    out = out.decode('utf-8', 'replace').splitlines()
+    names = {}
+    for i, pc in enumerate(pcs):
+        function = out[2 * i]
+        location = out[2 * i + 1] if lines else ''
+        if function == '??':
+            function = '0x%08x' % pc
+        names[pc] = (function, location)
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Symbolize a profiler_print() dump')
+    parser.add_argument('-e', '--elf', required=True, help='ELF file of the sketch')
+    parser.add_argument('-t', '--addr2line', default='xtensa-lx106-elf-addr2line', help='addr2line to use')
+    parser.add_argument('-l', '--lines', action='store_true', help='count per source line instead of per function')
+    parser.add_argument('-n', '--count', type=int, default=40, help='number of entries to show')
+    parser.add_argument('-H', '--hot', help='write the busiest flash functions to this hot_functions.txt')
+    parser.add_argument('dump', nargs='?', help='file with the dump, standard input if missing')
+    args = parser.parse_args()
+
+    if args.dump:
+        with open(args.dump) as f:
+            dump = read_dump(f)
+    else:
+        dump = read_dump(sys.stdin)
+    if dump is None or not dump[3]:
+        print('no profile found', file=sys.stderr)
+        return 1
+    samples, dropped, rate, counts = dump
+
+    pcs = sorted(counts)
+    names = symbolize(args.addr2line, args.elf, pcs, args.lines)
+    totals = {}
+    for pc in pcs:
+        key = names[pc]
+        totals[key] = totals.get(key, 0) + counts[pc]
+
+    print('%d samples at %d Hz, %d not in the table' % (samples, rate, dropped))
+    ranked = sorted(totals.items(), key=lambda item: item[1], reverse=True)
+    for (function, location), count in ranked[:args.count]:
+        share = 100.0 * count / samples if samples else 0
+        if location:
+            print('%6.2f%% %8d  %s  %s' % (share, count, function, location))
+        else:
+            print('%6.2f%% %8d  %s' % (share, count, function))
+
+    if args.hot:
+        write_hot(args, pcs, counts, samples)
+    return 0
+
+
+def write_hot(args, pcs, counts, samples):
+    '''Write the args.count busiest functions in flash, by mangled name'''
+    pcs = [pc for pc in pcs if pc >= FLASH_START]
+    if not pcs:
+        return
+    names = symbolize(args.addr2line, args.elf, pcs, False, demangle=False)
+    totals = {}
+    for pc in pcs:
+        function = names[pc][0]
+        if not function.startswith('0x'):
+            totals[function] = totals.get(function, 0) + counts[pc]
+    ranked = sorted(totals.items(), key=lambda item: item[1], reverse=True)
+    with open(args.hot, 'w') as f:
+        f.write('# written by profiler_report.py from %d samples\n' % samples)
+        for function, count in ranked[:args.count]:
+            share = 100.0 * count / samples if samples else 0
+            f.write('flash %s  # %.2f%%\n' % (function, share))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -14,3 +14,10 @@ xtensa-lx106-elf-objcopy --redefine-sym default_hostname=wifi_station_default_ho
 xtensa-lx106-elf-objcopy --redefine-sym default_hostname=wifi_station_default_hostname eagle_lwip_if.o 
 xtensa-lx106-elf-ar r libmain.a eagle_lwip_if.o user_interface.o 
 rm eagle_lwip_if.o user_interface.o
+
+# Make Cache_Read_Enable_New weak, for the A/B layouts to map the slot running
+# (core_esp8266_app_slots_mmap.c):
+xtensa-lx106-elf-ar x libmain.a app_main.o
+xtensa-lx106-elf-objcopy -W Cache_Read_Enable_New app_main.o
+xtensa-lx106-elf-ar r libmain.a app_main.o
+rm app_main.o
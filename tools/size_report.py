@@ -0,0 +1,113 @@
+#!/usr/bin/env python
+#
+# size_report.py - IRAM, DRAM and flash used by every object of a sketch
+#
+# Reads the map file the linker writes next to the ELF (sketch.ino.map in
+# the build directory) and adds up, per object file, the input sections
+# that went to IRAM (.text), DRAM (.data, .rodata, .bss) and flash
+# (.irom0.text). The 32 KB of IRAM are what functions marked
+# ICACHE_RAM_ATTR, or listed in hot_functions.txt, compete for.
+#
+# use it like: python size_report.py sketch.ino.map
+# or:          python size_report.py -s flash -n 50 sketch.ino.map
+
+from __future__ import print_function
+import argparse
+import os
+import re
+import sys
+
+IRAM_SIZE = 0x8000
+
+# output section: which memory its input sections count against
+REGIONS = {
+    '.text': 'iram',
+    '.data': 'dram',
+    '.rodata': 'dram',
+    '.bss': 'dram',
+    '.irom0.text': 'flash',
+}
+
+OUTPUT = re.compile(r'^(\.\S+)(?:\s+0x[0-9a-fA-F]+\s+0x[0-9a-fA-F]+)?\s*$')
+INPUT = re.compile(r'^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+))?$')
+CONTINUED = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$')
+
+
+def object_name(path):
+    '''libmain.a(user_interface.o) or the file name of an object'''
+    path = path.strip()
+    m = re.match(r'^(.*?)([^/\\]+\.a)\((.+)\)$', path)
+    if m:
+        return '%s(%s)' % (m.group(2), m.group(3))
+    return os.path.basename(path)
+
+
+def read_map(f):
+    '''Return {object: {region: bytes}} and {region: bytes} from a map file'''
+    per_object = {}
+    totals = {}
+    region = None
+    pending = None
+    started = False
+    for line in f:
+        line = line.rstrip('\r\n')
+        if not started:
+            started = line.startswith('Linker script and memory map')
+            continue
+        m = OUTPUT.match(line)
+        if m:
+            region = REGIONS.get(m.group(1))
+            pending = None
+            continue
+        if region is None:
+            continue
+        size = path = None
+        m = INPUT.match(line)
+        if m and not m.group(1).startswith('*'):
+            if m.group(2) is None:
+                # a long section name, the numbers are on the next line
+                pending = m.group(1)
+                continue
+            size, path = int(m.group(3), 16), m.group(4)
+        elif pending:
+            m = CONTINUED.match(line)
+            if m:
+                size, path = int(m.group(2), 16), m.group(3)
+        pending = None
+        if not size:
+            continue
+        name = object_name(path)
+        sizes = per_object.setdefault(name, {})
+        sizes[region] = sizes.get(region, 0) + size
+        totals[region] = totals.get(region, 0) + size
+    return per_object, totals
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Print the memory every object of a sketch uses')
+    parser.add_argument('-s', '--sort', choices=['iram', 'dram', 'flash'], default='iram',
+                        help='memory to sort by')
+    parser.add_argument('-n', '--count', type=int, default=30, help='number of objects to show')
+    parser.add_argument('map', help='map file of the sketch (sketch.ino.map)')
+    args = parser.parse_args()
+
+    with open(args.map) as f:
+        per_object, totals = read_map(f)
+    if not per_object:
+        print('no sections found in %s' % args.map, file=sys.stderr)
+        return 1
+
+    iram = totals.get('iram', 0)
+    print('IRAM %d of %d bytes (%.1f%%), DRAM %d, flash %d' %
+          (iram, IRAM_SIZE, 100.0 * iram / IRAM_SIZE, totals.get('dram', 0), totals.get('flash', 0)))
+    print('%8s %8s %8s  %s' % ('iram', 'dram', 'flash', 'object'))
+    ranked = sorted(per_object.items(), key=lambda item: item[1].get(args.sort, 0), reverse=True)
+    for name, sizes in ranked[:args.count]:
+        if not sizes.get(args.sort, 0):
+            break
+        print('%8d %8d %8d  %s' % (sizes.get('iram', 0), sizes.get('dram', 0), sizes.get('flash', 0), name))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,134 @@
+#!/usr/bin/env python
+#
+# trust_store.py - bundle CA certificates for WiFiClientSecure::setTrustStore()
+#
+# Reads PEM or DER certificates and writes them, indexed by subject, in the
+# layout described in libraries/ESP8266WiFi/src/TrustStore.h: either as a
+# binary file (e.g. for the data directory of a SPIFFS image) or as a C
+# header with a PROGMEM array.
+#
+# use it like: python trust_store.py -o certs.bin ca1.pem ca2.der ...
+# or:          python trust_store.py -c -n trustStore -o certs.h ca1.pem ...
+
+from __future__ import print_function
+import argparse
+import base64
+import re
+import struct
+import sys
+
+OID_COMMON_NAME = b'\x55\x04\x03'
+OID_ORGANIZATION = b'\x55\x04\x0a'
+
+
+def der_item(data, pos):
+    '''Return (tag, start of contents, end of contents) of the item at pos'''
+    tag = ord(data[pos:pos + 1])
+    length = ord(data[pos + 1:pos + 2])
+    pos += 2
+    if length & 0x80:
+        count = length & 0x7f
+        length = 0
+        for b in bytearray(data[pos:pos + count]):
+            length = (length << 8) | b
+        pos += count
+    return tag, pos, pos + length
+
+
+def der_children(data, start, end):
+    items = []
+    while start < end:
+        item = der_item(data, start)
+        items.append(item)
+        start = item[2]
+    return items
+
+
+def subject_name(der):
+    '''Common name of the subject, or its organization if it has none'''
+    _, start, end = der_item(der, 0)
+    _, start, end = der_children(der, start, end)[0]
+    fields = der_children(der, start, end)
+    if fields[0][0] == 0xa0:
+        fields = fields[1:]
+    # serial, signature, issuer, validity, subject
+    _, start, end = fields[4]
+    names = {}
+    for _, set_start, set_end in der_children(der, start, end):
+        for _, seq_start, seq_end in der_children(der, set_start, set_end):
+            oid, value = der_children(der, seq_start, seq_end)[:2]
+            key = der[oid[1]:oid[2]]
+            if key not in names:
+                names[key] = der[value[1]:value[2]]
+    return names.get(OID_COMMON_NAME, names.get(OID_ORGANIZATION))
+
+
+def subject_hash(name):
+    h = 2166136261
+    for b in bytearray(name or b''):
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def read_certificates(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    pems = re.findall(b'-----BEGIN CERTIFICATE-----(.*?)-----END CERTIFICATE-----', data, re.S)
+    if not pems:
+        return [data]
+    return [base64.b64decode(b''.join(pem.split())) for pem in pems]
+
+
+def build(certs):
+    header_size = 8 + 12 * len(certs)
+    index = b''
+    offset = header_size
+    for cert in certs:
+        index += struct.pack('<III', subject_hash(subject_name(cert)), offset, len(cert))
+        offset += len(cert)
+    return b'TSv1' + struct.pack('<HH', len(certs), 0) + index + b''.join(certs)
+
+
+def write_header(f, name, blob):
+    f.write('// generated by trust_store.py\n')
+    f.write('#include <pgmspace.h>\n\n')
+    f.write('static const uint8_t %s[] PROGMEM = {\n' % name)
+    data = bytearray(blob)
+    for i in range(0, len(data), 16):
+        f.write('    ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',\n')
+    f.write('};\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Bundle CA certificates into a trust store')
+    parser.add_argument('-o', '--output', required=True, help='file to write')
+    parser.add_argument('-c', '--header', action='store_true', help='write a C header instead of binary data')
+    parser.add_argument('-n', '--name', default='trustStore', help='name of the array in the header')
+    parser.add_argument('certs', nargs='+', help='PEM or DER certificate files')
+    args = parser.parse_args()
+
+    certs = []
+    for path in args.certs:
+        for cert in read_certificates(path):
+            name = subject_name(cert)
+            if name is None:
+                print('%s: certificate without a common name or organization, skipped' % path, file=sys.stderr)
+                continue
+            certs.append(cert)
+    if len(certs) > 0xffff:
+        print('too many certificates', file=sys.stderr)
+        return 1
+
+    blob = build(certs)
+    if args.header:
+        with open(args.output, 'w') as f:
+            write_header(f, args.name, blob)
+    else:
+        with open(args.output, 'wb') as f:
+            f.write(blob)
+    print('%d certificates, %d bytes' % (len(certs), len(blob)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())